@@ -131,4 +131,17 @@ int msm_pcie_shadow_control(struct pci_dev *dev, bool enable);
  * Return: 0 on success, negative value on error
  */
 int msm_pcie_access_control(struct pci_dev *dev, bool enable);
+
+/**
+ * msm_pcie_report_traffic - report endpoint traffic to the PCIe bus driver.
+ * @dev:	pci device structure
+ * @bytes:	bytes moved over the link since the last report
+ *
+ * Endpoint device drivers call this from their data path, e.g. once per
+ * interrupt or poll. The bus driver picks the link speed and L1 substates
+ * of the link from the throughput seen in every window.
+ *
+ * Return: 0 on success, negative value on error
+ */
+int msm_pcie_report_traffic(struct pci_dev *dev, u64 bytes);
 #endif
@@ -24,9 +24,11 @@
 #include <linux/gpio.h>
 #include <linux/iopoll.h>
 #include <linux/kernel.h>
+#include <linux/math64.h>
 #include <linux/pci.h>
 #include <linux/platform_device.h>
 #include <linux/regulator/consumer.h>
+#include <linux/seq_file.h>
 #include <linux/slab.h>
 #include <linux/types.h>
 #include <linux/of_gpio.h>
@@ -66,6 +68,7 @@
 
 #define PCIE20_CAP                     0x70
 #define PCIE20_CAP_LINKCTRLSTATUS      (PCIE20_CAP + 0x10)
+#define PCIE20_CAP_LINKCTRL2           (PCIE20_CAP + 0x30)
 
 #define PCIE20_COMMAND_STATUS          0x04
 #define PCIE20_HEADER_TYPE		0x0C
@@ -77,6 +80,7 @@
 
 #define PCIE20_ACK_F_ASPM_CTRL_REG     0x70C
 #define PCIE20_ACK_N_FTS               0xff00
+#define PCIE20_GEN2_CTRL_REG           0x80C
 
 #define PCIE20_PLR_IATU_VIEWPORT       0x900
 #define PCIE20_PLR_IATU_CTRL1          0x904
@@ -106,6 +110,8 @@
 #define PHY_STABILIZATION_DELAY_US_MIN        995
 #define PHY_STABILIZATION_DELAY_US_MAX        1005
 #define REQ_EXIT_L1_DELAY_US                  1
+#define LINK_RETRAIN_POLL_US                  10
+#define LINK_RETRAIN_TIMEOUT_US               10000
 
 #define PHY_READY_TIMEOUT_COUNT               10
 #define XMLH_LINK_UP                          0x400
@@ -123,6 +129,39 @@ static int msm_pcie_debug_mask;
 module_param_named(debug_mask, msm_pcie_debug_mask,
 			    int, S_IRUGO | S_IWUSR | S_IWGRP);
 
+/*
+ * Link power policy. Every lp_window_ms the traffic reported by the
+ * endpoint driver is turned into a rate; above lp_gen2_kbps the link goes
+ * to full speed, above lp_l1_kbps L1 substates are disabled as well. A
+ * level is only left downwards after the rate stayed below lp_down_pct
+ * percent of the threshold that raised it for lp_down_windows windows.
+ */
+static bool msm_pcie_lp_enable = true;
+module_param_named(lp_enable, msm_pcie_lp_enable,
+			    bool, S_IRUGO | S_IWUSR | S_IWGRP);
+
+static unsigned int msm_pcie_lp_window_ms = 100;
+module_param_named(lp_window_ms, msm_pcie_lp_window_ms,
+			    uint, S_IRUGO | S_IWUSR | S_IWGRP);
+
+static unsigned int msm_pcie_lp_gen2_kbps = 40000;
+module_param_named(lp_gen2_kbps, msm_pcie_lp_gen2_kbps,
+			    uint, S_IRUGO | S_IWUSR | S_IWGRP);
+
+static unsigned int msm_pcie_lp_l1_kbps = 160000;
+module_param_named(lp_l1_kbps, msm_pcie_lp_l1_kbps,
+			    uint, S_IRUGO | S_IWUSR | S_IWGRP);
+
+static unsigned int msm_pcie_lp_down_pct = 50;
+module_param_named(lp_down_pct, msm_pcie_lp_down_pct,
+			    uint, S_IRUGO | S_IWUSR | S_IWGRP);
+
+static unsigned int msm_pcie_lp_down_windows = 5;
+module_param_named(lp_down_windows, msm_pcie_lp_down_windows,
+			    uint, S_IRUGO | S_IWUSR | S_IWGRP);
+
+static struct dentry *msm_pcie_debugfs;
+
 /* Table to track info of PCIe devices */
 static struct msm_pcie_device_info
 	msm_pcie_dev_tbl[MAX_RC_NUM * MAX_DEVICE_NUM];
@@ -986,6 +1025,258 @@ static void msm_pcie_config_l1ss(struct msm_pcie_dev_t *dev)
 		readl_relaxed(dev->conf + PCIE20_DEVICE_CONTROL2_STATUS2));
 }
 
+static const char * const msm_pcie_lp_level_name[MSM_PCIE_LP_MAX] = {
+	[MSM_PCIE_LP_LOW] = "low",
+	[MSM_PCIE_LP_MID] = "mid",
+	[MSM_PCIE_LP_HIGH] = "high",
+};
+
+static u32 msm_pcie_lp_up_kbps(enum msm_pcie_lp_level level)
+{
+	return level == MSM_PCIE_LP_LOW ? msm_pcie_lp_gen2_kbps :
+					  msm_pcie_lp_l1_kbps;
+}
+
+static void msm_pcie_lp_set_l1ss(struct msm_pcie_dev_t *dev, bool enable)
+{
+	u32 offset = dev->rc_idx ? 0 : PCIE20_EP_L1SUB_CTL1_OFFSET;
+	u32 mask = BIT(3)|BIT(2)|BIT(1)|BIT(0);
+
+	/* Enable upstream first, disable downstream first */
+	if (enable) {
+		msm_pcie_write_mask(dev->dm_core + PCIE20_L1SUB_CONTROL1,
+					0, mask);
+		msm_pcie_write_mask(dev->conf + PCIE20_L1SUB_CONTROL1 +
+					offset, 0, mask);
+	} else {
+		msm_pcie_write_mask(dev->conf + PCIE20_L1SUB_CONTROL1 +
+					offset, mask, 0);
+		msm_pcie_write_mask(dev->dm_core + PCIE20_L1SUB_CONTROL1,
+					mask, 0);
+	}
+	readl_relaxed(dev->elbi);
+
+	if (dev->shadow_en) {
+		dev->rc_shadow[PCIE20_L1SUB_CONTROL1 / 4] =
+			readl_relaxed(dev->dm_core + PCIE20_L1SUB_CONTROL1);
+		dev->ep_shadow[0][PCIE20_L1SUB_CONTROL1 / 4 + offset / 4] =
+			readl_relaxed(dev->conf +
+			PCIE20_L1SUB_CONTROL1 + offset);
+	}
+}
+
+/* Retrain the link to the given speed; returns the time it took in us */
+static int msm_pcie_lp_set_speed(struct msm_pcie_dev_t *dev, u32 gen)
+{
+	ktime_t start = ktime_get();
+	u32 val;
+	int ret;
+
+	msm_pcie_write_mask(dev->dm_core + PCIE20_CAP_LINKCTRL2, 0xf, gen);
+	/* directed speed change */
+	msm_pcie_write_mask(dev->dm_core + PCIE20_GEN2_CTRL_REG, 0, BIT(17));
+
+	ret = readl_poll_timeout(dev->dm_core + PCIE20_CAP_LINKCTRLSTATUS,
+			val, ((val >> 16) & 0xf) == gen && !(val & BIT(27)),
+			LINK_RETRAIN_POLL_US, LINK_RETRAIN_TIMEOUT_US);
+	if (ret) {
+		PCIE_ERR(dev,
+			"PCIe: RC%d: link failed to retrain to Gen%d:0x%x\n",
+			dev->rc_idx, gen, val);
+		return ret;
+	}
+
+	return ktime_us_delta(ktime_get(), start);
+}
+
+static void msm_pcie_lp_account(struct msm_pcie_dev_t *dev, ktime_t now)
+{
+	struct msm_pcie_lp_info *lp = &dev->lp;
+
+	lp->residency_us[lp->level] += ktime_us_delta(now, lp->enter);
+	lp->enter = now;
+}
+
+/* Called with setup_lock held and the link up */
+static void msm_pcie_lp_apply(struct msm_pcie_dev_t *dev,
+				enum msm_pcie_lp_level to)
+{
+	struct msm_pcie_lp_info *lp = &dev->lp;
+	bool l1ss = lp->level != MSM_PCIE_LP_HIGH;
+	bool want_l1ss = to != MSM_PCIE_LP_HIGH;
+	u32 gen = lp->level == MSM_PCIE_LP_LOW ? 1 : lp->max_gen;
+	u32 want_gen = to == MSM_PCIE_LP_LOW ? 1 : lp->max_gen;
+	ktime_t start = ktime_get();
+	u32 us;
+	int ret;
+
+	if (dev->l1ss_supported && l1ss && !want_l1ss)
+		msm_pcie_lp_set_l1ss(dev, false);
+
+	if (gen != want_gen) {
+		ret = msm_pcie_lp_set_speed(dev, want_gen);
+		if (ret < 0) {
+			lp->failures++;
+			if (dev->l1ss_supported && l1ss && !want_l1ss)
+				msm_pcie_lp_set_l1ss(dev, true);
+			return;
+		}
+		lp->retrain_max_us = max_t(u32, lp->retrain_max_us, ret);
+	}
+
+	if (dev->l1ss_supported && !l1ss && want_l1ss)
+		msm_pcie_lp_set_l1ss(dev, true);
+
+	us = ktime_us_delta(ktime_get(), start);
+	lp->transitions++;
+	lp->latency_total_us += us;
+	lp->latency_max_us = max(lp->latency_max_us, us);
+
+	msm_pcie_lp_account(dev, start);
+	lp->level = to;
+	lp->entered[to]++;
+
+	PCIE_DBG(dev, "PCIe: RC%d: link policy %s at %u kbps, took %u us\n",
+		dev->rc_idx, msm_pcie_lp_level_name[to], lp->kbps, us);
+}
+
+static void msm_pcie_lp_work(struct work_struct *work)
+{
+	struct msm_pcie_lp_info *lp = container_of(to_delayed_work(work),
+					struct msm_pcie_lp_info, work);
+	struct msm_pcie_dev_t *dev = container_of(lp, struct msm_pcie_dev_t,
+					lp);
+	enum msm_pcie_lp_level target;
+	ktime_t now;
+	u64 elapsed_us, bytes;
+
+	mutex_lock(&dev->setup_lock);
+
+	if (!dev->power_on || dev->link_status != MSM_PCIE_LINK_ENABLED ||
+		dev->suspending)
+		goto out;
+
+	now = ktime_get();
+	elapsed_us = ktime_us_delta(now, lp->sample);
+	lp->sample = now;
+	bytes = atomic64_xchg(&lp->bytes, 0);
+	if (!elapsed_us)
+		goto requeue;
+	lp->kbps = min_t(u64, div64_u64(bytes * 8000, elapsed_us), U32_MAX);
+
+	if (!msm_pcie_lp_enable)
+		goto requeue;
+
+	target = lp->level;
+	while (target < lp->max_level &&
+		lp->kbps >= msm_pcie_lp_up_kbps(target))
+		target++;
+
+	if (target == lp->level && lp->level > lp->min_level &&
+		(u64)lp->kbps * 100 < (u64)msm_pcie_lp_up_kbps(lp->level - 1) *
+						msm_pcie_lp_down_pct) {
+		if (++lp->down_windows >= msm_pcie_lp_down_windows)
+			target = lp->level - 1;
+	} else {
+		lp->down_windows = 0;
+	}
+
+	if (target != lp->level) {
+		lp->down_windows = 0;
+		msm_pcie_lp_apply(dev, target);
+	}
+
+requeue:
+	queue_delayed_work(system_power_efficient_wq, &lp->work,
+		msecs_to_jiffies(max(msm_pcie_lp_window_ms, 10U)));
+out:
+	mutex_unlock(&dev->setup_lock);
+}
+
+/* Called with setup_lock held once the link is up */
+static void msm_pcie_lp_start(struct msm_pcie_dev_t *dev)
+{
+	struct msm_pcie_lp_info *lp = &dev->lp;
+
+	/* The link trains to the best speed both ends support */
+	lp->max_gen = (readl_relaxed(dev->dm_core + PCIE20_CAP_LINKCTRLSTATUS)
+			>> 16) & 0xf;
+	lp->min_level = lp->max_gen > 1 ? MSM_PCIE_LP_LOW : MSM_PCIE_LP_MID;
+	lp->max_level = dev->l1ss_supported ? MSM_PCIE_LP_HIGH :
+						MSM_PCIE_LP_MID;
+	lp->level = MSM_PCIE_LP_MID;
+
+	lp->down_windows = 0;
+	lp->kbps = 0;
+	lp->sample = lp->enter = ktime_get();
+	lp->entered[lp->level]++;
+	atomic64_set(&lp->bytes, 0);
+
+	queue_delayed_work(system_power_efficient_wq, &lp->work,
+		msecs_to_jiffies(max(msm_pcie_lp_window_ms, 10U)));
+}
+
+/* Called with setup_lock held before the link goes down */
+static void msm_pcie_lp_stop(struct msm_pcie_dev_t *dev)
+{
+	struct msm_pcie_lp_info *lp = &dev->lp;
+
+	msm_pcie_lp_account(dev, ktime_get());
+	cancel_delayed_work(&lp->work);
+
+	/* Let the next link up train to full speed again */
+	if (lp->level == MSM_PCIE_LP_LOW)
+		msm_pcie_write_mask(dev->dm_core + PCIE20_CAP_LINKCTRL2,
+					0xf, lp->max_gen);
+}
+
+static int msm_pcie_lp_show(struct seq_file *m, void *unused)
+{
+	int i, j;
+
+	for (i = 0; i < MAX_RC_NUM; i++) {
+		struct msm_pcie_dev_t *dev = &msm_pcie_dev[i];
+		struct msm_pcie_lp_info *lp = &dev->lp;
+
+		if (!dev->pdev)
+			continue;
+
+		mutex_lock(&dev->setup_lock);
+		if (dev->power_on)
+			msm_pcie_lp_account(dev, ktime_get());
+
+		seq_printf(m, "RC%d: %s, level %s, max Gen%u, %u kbps\n", i,
+			dev->power_on ? "on" : "off",
+			msm_pcie_lp_level_name[lp->level], lp->max_gen,
+			lp->kbps);
+		for (j = 0; j < MSM_PCIE_LP_MAX; j++)
+			seq_printf(m, "  %-4s entered %u residency %llu ms\n",
+				msm_pcie_lp_level_name[j], lp->entered[j],
+				div_u64(lp->residency_us[j], USEC_PER_MSEC));
+		seq_printf(m,
+			"  transitions %u failures %u latency avg %llu max %u us retrain max %u us\n",
+			lp->transitions, lp->failures,
+			lp->transitions ? div_u64(lp->latency_total_us,
+						  lp->transitions) : 0,
+			lp->latency_max_us, lp->retrain_max_us);
+		mutex_unlock(&dev->setup_lock);
+	}
+
+	return 0;
+}
+
+static int msm_pcie_lp_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, msm_pcie_lp_show, NULL);
+}
+
+static const struct file_operations msm_pcie_lp_fops = {
+	.open		= msm_pcie_lp_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 static int msm_pcie_get_resources(struct msm_pcie_dev_t *dev,
 					struct platform_device *pdev)
 {
@@ -1429,6 +1720,7 @@ int msm_pcie_enable(struct msm_pcie_dev_t *dev, u32 options)
 	dev->link_status = MSM_PCIE_LINK_ENABLED;
 	dev->power_on = true;
 	dev->suspending = false;
+	msm_pcie_lp_start(dev);
 	goto out;
 
 link_fail:
@@ -1457,6 +1749,7 @@ void msm_pcie_disable(struct msm_pcie_dev_t *dev, u32 options)
 		return;
 	}
 
+	msm_pcie_lp_stop(dev);
 	dev->link_status = MSM_PCIE_LINK_DISABLED;
 	dev->power_on = false;
 
@@ -2031,6 +2324,8 @@ static int __init pcie_init(void)
 		mutex_init(&msm_pcie_dev[i].recovery_lock);
 		spin_lock_init(&msm_pcie_dev[i].linkdown_lock);
 		spin_lock_init(&msm_pcie_dev[i].wakeup_lock);
+		INIT_DEFERRABLE_WORK(&msm_pcie_dev[i].lp.work,
+					msm_pcie_lp_work);
 	}
 	for (i = 0; i < MAX_RC_NUM * MAX_DEVICE_NUM; i++) {
 		msm_pcie_dev_tbl[i].bdf = 0;
@@ -2040,6 +2335,11 @@ static int __init pcie_init(void)
 		msm_pcie_dev_tbl[i].phy_address = 0;
 	}
 
+	msm_pcie_debugfs = debugfs_create_dir("msm_pcie", NULL);
+	if (!IS_ERR_OR_NULL(msm_pcie_debugfs))
+		debugfs_create_file("link_policy", S_IRUGO, msm_pcie_debugfs,
+					NULL, &msm_pcie_lp_fops);
+
 	ret = platform_driver_register(&msm_pcie_driver);
 
 	return ret;
@@ -2050,6 +2350,7 @@ static void __exit pcie_exit(void)
 	pr_debug("pcie:%s.\n", __func__);
 
 	platform_driver_unregister(&msm_pcie_driver);
+	debugfs_remove_recursive(msm_pcie_debugfs);
 }
 
 subsys_initcall_sync(pcie_init);
@@ -2524,3 +2825,22 @@ int msm_pcie_access_control(struct pci_dev *dev, bool allow_access)
 	return ret;
 }
 EXPORT_SYMBOL(msm_pcie_access_control);
+
+int msm_pcie_report_traffic(struct pci_dev *dev, u64 bytes)
+{
+	struct msm_pcie_dev_t *pcie_dev;
+
+	if (!dev) {
+		pr_err("PCIe: the input pci dev is NULL.\n");
+		return -ENODEV;
+	}
+
+	pcie_dev = PCIE_BUS_PRIV_DATA(dev);
+	if (!pcie_dev)
+		return -ENODEV;
+
+	atomic64_add(bytes, &pcie_dev->lp.bytes);
+
+	return 0;
+}
+EXPORT_SYMBOL(msm_pcie_report_traffic);
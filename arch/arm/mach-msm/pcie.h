@@ -20,6 +20,9 @@
 #include <linux/regulator/consumer.h>
 #include <linux/types.h>
 #include <linux/pm_wakeup.h>
+#include <linux/workqueue.h>
+#include <linux/ktime.h>
+#include <linux/atomic.h>
 #include <mach/msm_pcie.h>
 
 #define MSM_PCIE_MAX_VREG 3
@@ -139,6 +142,40 @@ enum msm_pcie_link_status {
 	MSM_PCIE_LINK_DISABLED
 };
 
+/*
+ * Link power policy levels, from the most power saving to the fastest:
+ * LOW is Gen1 with L1 substates, MID the maximum speed with L1 substates
+ * and HIGH the maximum speed with L1 substates disabled, so that L1 exit
+ * does not add to the latency of busy traffic.
+ */
+enum msm_pcie_lp_level {
+	MSM_PCIE_LP_LOW,
+	MSM_PCIE_LP_MID,
+	MSM_PCIE_LP_HIGH,
+	MSM_PCIE_LP_MAX
+};
+
+/* link power policy state and counters */
+struct msm_pcie_lp_info {
+	struct delayed_work	work;
+	atomic64_t		bytes;
+	enum msm_pcie_lp_level	level;
+	enum msm_pcie_lp_level	min_level;
+	enum msm_pcie_lp_level	max_level;
+	u32			max_gen;
+	u32			down_windows;
+	u32			kbps;
+	ktime_t			sample;
+	ktime_t			enter;
+	u64			residency_us[MSM_PCIE_LP_MAX];
+	u32			entered[MSM_PCIE_LP_MAX];
+	u32			transitions;
+	u32			failures;
+	u64			latency_total_us;
+	u32			latency_max_us;
+	u32			retrain_max_us;
+};
+
 /* gpio info structure */
 struct msm_pcie_gpio_info_t {
 	char      *name;
@@ -262,6 +299,7 @@ struct msm_pcie_dev_t {
 	bool                         shadow_en;
 	struct msm_pcie_register_event *event_reg;
 	bool                         power_on;
+	struct msm_pcie_lp_info      lp;
 	void                         *ipc_log;
 	void                         *ipc_log_long;
 };
@@ -0,0 +1,85 @@
+/*
+ * CRC32 and CRC32C using the optional ARMv8 CRC32 instructions
+ *
+ * Copyright (C) 2016 HTC Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * The CRC32 instructions work on general purpose registers, so no FPSIMD
+ * state needs saving. Callers must check HWCAP_CRC32 and be built with
+ * -march=armv8-a+crc.
+ */
+#ifndef __ASM_CRC32_H
+#define __ASM_CRC32_H
+
+#include <linux/types.h>
+#include <asm/unaligned.h>
+
+#define CRC32X(crc, value)	asm("crc32x %w[c], %w[c], %x[v]" \
+				    : [c] "+r" (crc) : [v] "r" (value))
+#define CRC32W(crc, value)	asm("crc32w %w[c], %w[c], %w[v]" \
+				    : [c] "+r" (crc) : [v] "r" (value))
+#define CRC32H(crc, value)	asm("crc32h %w[c], %w[c], %w[v]" \
+				    : [c] "+r" (crc) : [v] "r" (value))
+#define CRC32B(crc, value)	asm("crc32b %w[c], %w[c], %w[v]" \
+				    : [c] "+r" (crc) : [v] "r" (value))
+#define CRC32CX(crc, value)	asm("crc32cx %w[c], %w[c], %x[v]" \
+				    : [c] "+r" (crc) : [v] "r" (value))
+#define CRC32CW(crc, value)	asm("crc32cw %w[c], %w[c], %w[v]" \
+				    : [c] "+r" (crc) : [v] "r" (value))
+#define CRC32CH(crc, value)	asm("crc32ch %w[c], %w[c], %w[v]" \
+				    : [c] "+r" (crc) : [v] "r" (value))
+#define CRC32CB(crc, value)	asm("crc32cb %w[c], %w[c], %w[v]" \
+				    : [c] "+r" (crc) : [v] "r" (value))
+
+/*
+ * The tail is folded with the low bits of the (negative) remaining length,
+ * which still hold len % 8 after the 8 byte loop overshoots.
+ */
+static inline u32 crc32_arm64_le_hw(u32 crc, const u8 *p, size_t len)
+{
+	s64 length = len;
+
+	while ((length -= sizeof(u64)) >= 0) {
+		CRC32X(crc, get_unaligned_le64(p));
+		p += sizeof(u64);
+	}
+	if (length & sizeof(u32)) {
+		CRC32W(crc, get_unaligned_le32(p));
+		p += sizeof(u32);
+	}
+	if (length & sizeof(u16)) {
+		CRC32H(crc, get_unaligned_le16(p));
+		p += sizeof(u16);
+	}
+	if (length & sizeof(u8))
+		CRC32B(crc, *p);
+
+	return crc;
+}
+
+static inline u32 crc32c_arm64_le_hw(u32 crc, const u8 *p, size_t len)
+{
+	s64 length = len;
+
+	while ((length -= sizeof(u64)) >= 0) {
+		CRC32CX(crc, get_unaligned_le64(p));
+		p += sizeof(u64);
+	}
+	if (length & sizeof(u32)) {
+		CRC32CW(crc, get_unaligned_le32(p));
+		p += sizeof(u32);
+	}
+	if (length & sizeof(u16)) {
+		CRC32CH(crc, get_unaligned_le16(p));
+		p += sizeof(u16);
+	}
+	if (length & sizeof(u8))
+		CRC32CB(crc, *p);
+
+	return crc;
+}
+
+#endif /* __ASM_CRC32_H */
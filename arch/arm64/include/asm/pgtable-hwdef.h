@@ -52,6 +52,20 @@
 #define PMD_SECT_PXN		(_AT(pmdval_t, 1) << 53)
 #define PMD_SECT_UXN		(_AT(pmdval_t, 1) << 54)
 
+/*
+ * Contiguous hint: a naturally aligned run of CONT_PTES entries mapping
+ * physically contiguous memory with identical attributes may be cached as a
+ * single TLB entry.
+ */
+#ifdef CONFIG_ARM64_64K_PAGES
+#define CONT_SHIFT		5
+#else
+#define CONT_SHIFT		4
+#endif
+#define CONT_PTES		(1 << CONT_SHIFT)
+#define CONT_SIZE		(_AC(1, UL) << (CONT_SHIFT + PAGE_SHIFT))
+#define CONT_MASK		(~(CONT_SIZE - 1))
+
 /*
  * AttrIndx[2:0] encoding (mapping attributes defined in the MAIR* registers).
  */
@@ -70,6 +84,7 @@
 #define PTE_SHARED		(_AT(pteval_t, 3) << 8)		/* SH[1:0], inner shareable */
 #define PTE_AF			(_AT(pteval_t, 1) << 10)	/* Access Flag */
 #define PTE_NG			(_AT(pteval_t, 1) << 11)	/* nG */
+#define PTE_CONT		(_AT(pteval_t, 1) << 52)	/* Contiguous range */
 #define PTE_PXN			(_AT(pteval_t, 1) << 53)	/* Privileged XN */
 #define PTE_UXN			(_AT(pteval_t, 1) << 54)	/* User XN */
 
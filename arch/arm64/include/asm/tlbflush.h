@@ -63,6 +63,10 @@ extern struct cpu_tlb_fns cpu_tlb;
  *		- vaddr - virtual address (may not be aligned)
  *		- vma	- vma_struct describing address range
  *
+ *	local_flush_tlb_all()
+ *
+ *		Invalidate the entire TLB of the calling CPU only.
+ *
  *	flush_kern_tlb_page(kaddr)
  *
  *		Invalidate the TLB entry for the specified page.  The address
@@ -78,6 +82,14 @@ static inline void flush_tlb_all(void)
 	isb();
 }
 
+static inline void local_flush_tlb_all(void)
+{
+	dsb(nshst);
+	asm("tlbi	vmalle1");
+	dsb(nsh);
+	isb();
+}
+
 static inline bool msm8994_needs_tlbi_wa(void)
 {
 #ifdef CONFIG_ARCH_MSM8994_V1_TLBI_WA
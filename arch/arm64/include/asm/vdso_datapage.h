@@ -28,8 +28,13 @@ struct vdso_data {
 	__u64 xtime_coarse_nsec;
 	__u64 wtm_clock_sec;	/* Wall to monotonic time */
 	__u64 wtm_clock_nsec;
+	__u64 btm_clock_sec;	/* Monotonic to boot time */
+	__u64 btm_clock_nsec;
+	__u64 raw_time_sec;	/* Raw time */
+	__u64 raw_time_nsec;
 	__u32 tb_seq_count;	/* Timebase sequence counter */
 	__u32 cs_mult;		/* Clocksource multiplier */
+	__u32 cs_raw_mult;	/* Raw clocksource multiplier */
 	__u32 cs_shift;		/* Clocksource shift */
 	__u32 tz_minuteswest;	/* Whacky timezone stuff */
 	__u32 tz_dsttime;
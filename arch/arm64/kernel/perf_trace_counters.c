@@ -12,6 +12,7 @@
 #include <linux/uaccess.h>
 #include <linux/debugfs.h>
 #include <linux/cpu.h>
+#include <linux/perf_event.h>
 #include <linux/tracepoint.h>
 #include <trace/events/sched.h>
 #define CREATE_TRACE_POINTS
@@ -25,6 +26,305 @@ DEFINE_PER_CPU(u32[NUM_L1_CTRS], previous_l1_cnts);
 DEFINE_PER_CPU(u32, old_pid);
 DEFINE_PER_CPU(u32, hotplug_flag);
 
+#ifdef CONFIG_TASK_PMU_ACCOUNTING
+/*
+ * Sampled per-task PMU accounting. Pinned per-CPU events count cycles,
+ * instructions and L2 refills. Every acct period'th context switch of a
+ * CPU samples the incoming task: the counters are read when it switches
+ * in and again when it switches out and the deltas go to its pmuac. The
+ * period of each CPU adapts so that the cycles spent sampling stay within
+ * acct_budget, in units of 0.01% of the cycles the CPU was busy.
+ */
+enum {
+	ACCT_CYCLES,
+	ACCT_INSTRUCTIONS,
+	ACCT_L2_REFILLS,
+	ACCT_NR_EVENTS,
+};
+
+#define ACCT_MAX_PERIOD		1024
+#define ACCT_WINDOW_CYCLES	(1ULL << 28)
+#define ARMV8_L2D_CACHE_REFILL	0x17
+
+struct tracectr_acct {
+	bool active;
+	u32 countdown;
+	u32 period;
+	int cluster;
+	struct task_struct *sampled;
+	u64 start[ACCT_NR_EVENTS];
+	u64 start_ns;
+	u64 window_start;
+	u64 overhead;
+	struct perf_event *event[ACCT_NR_EVENTS];
+};
+
+static DEFINE_PER_CPU(struct tracectr_acct, tracectr_acct);
+static DEFINE_MUTEX(acct_mutex);
+static unsigned int acct_state;
+static u32 acct_budget = 20;
+
+static struct perf_event_attr acct_attr[ACCT_NR_EVENTS] = {
+	[ACCT_CYCLES] = {
+		.type	= PERF_TYPE_HARDWARE,
+		.config	= PERF_COUNT_HW_CPU_CYCLES,
+	},
+	[ACCT_INSTRUCTIONS] = {
+		.type	= PERF_TYPE_HARDWARE,
+		.config	= PERF_COUNT_HW_INSTRUCTIONS,
+	},
+	[ACCT_L2_REFILLS] = {
+		.type	= PERF_TYPE_RAW,
+		.config	= ARMV8_L2D_CACHE_REFILL,
+	},
+};
+
+/* Runs on the local CPU with interrupts off, like perf's own reads */
+static bool acct_read(struct tracectr_acct *acct, u64 *val)
+{
+	int i;
+
+	for (i = 0; i < ACCT_NR_EVENTS; i++) {
+		struct perf_event *event = acct->event[i];
+
+		if (event->state != PERF_EVENT_STATE_ACTIVE)
+			return false;
+		event->pmu->read(event);
+		val[i] = local64_read(&event->count);
+	}
+	return true;
+}
+
+static void acct_budget_check(struct tracectr_acct *acct, u64 cycles)
+{
+	u64 window = cycles - acct->window_start;
+
+	if (window < ACCT_WINDOW_CYCLES)
+		return;
+
+	if (acct->overhead * 10000 > window * acct_budget)
+		acct->period = min_t(u32, acct->period * 2, ACCT_MAX_PERIOD);
+	else if (acct->overhead * 20000 < window * acct_budget &&
+		 acct->period > 1)
+		acct->period /= 2;
+
+	acct->window_start = cycles;
+	acct->overhead = 0;
+}
+
+static void tracectr_acct_notifier(void *ignore, struct task_struct *prev,
+					struct task_struct *next)
+{
+	struct tracectr_acct *acct = this_cpu_ptr(&tracectr_acct);
+	struct task_pmu_accounting *pmuac = &prev->pmuac;
+	u64 val[ACCT_NR_EVENTS], now;
+	int i;
+
+	if (!ACCESS_ONCE(acct->active))
+		return;
+	smp_rmb();
+
+	if (--acct->countdown && !acct->sampled)
+		return;
+
+	if (!acct_read(acct, val)) {
+		acct->sampled = NULL;
+		goto out;
+	}
+	now = local_clock();
+
+	if (acct->sampled == prev) {
+		pmuac->cycles[acct->cluster] += val[ACCT_CYCLES] -
+						 acct->start[ACCT_CYCLES];
+		pmuac->instructions[acct->cluster] +=
+			val[ACCT_INSTRUCTIONS] - acct->start[ACCT_INSTRUCTIONS];
+		pmuac->l2_refills[acct->cluster] +=
+			val[ACCT_L2_REFILLS] - acct->start[ACCT_L2_REFILLS];
+		pmuac->sampled_ns[acct->cluster] += now - acct->start_ns;
+	}
+	acct->sampled = NULL;
+
+	if (!acct->countdown && !is_idle_task(next)) {
+		acct->sampled = next;
+		for (i = 0; i < ACCT_NR_EVENTS; i++)
+			acct->start[i] = val[i];
+		acct->start_ns = now;
+	}
+
+	acct->event[ACCT_CYCLES]->pmu->read(acct->event[ACCT_CYCLES]);
+	acct->overhead += local64_read(&acct->event[ACCT_CYCLES]->count) -
+			  val[ACCT_CYCLES];
+	acct_budget_check(acct, val[ACCT_CYCLES]);
+out:
+	if (!acct->countdown)
+		acct->countdown = acct->period;
+}
+
+static void acct_free_events(struct tracectr_acct *acct)
+{
+	int i;
+
+	for (i = 0; i < ACCT_NR_EVENTS; i++) {
+		if (acct->event[i])
+			perf_event_release_kernel(acct->event[i]);
+		acct->event[i] = NULL;
+	}
+}
+
+/* Called with acct_mutex held and the CPU online */
+static int acct_start_cpu(int cpu)
+{
+	struct tracectr_acct *acct = &per_cpu(tracectr_acct, cpu);
+	struct perf_event_attr attr;
+	struct perf_event *event;
+	int i;
+
+	for (i = 0; i < ACCT_NR_EVENTS; i++) {
+		attr = acct_attr[i];
+		attr.size = sizeof(attr);
+		attr.pinned = 1;
+		event = perf_event_create_kernel_counter(&attr, cpu, NULL,
+							 NULL, NULL);
+		if (IS_ERR(event)) {
+			pr_err("tracectr: cpu%d: no counter for event %d: %ld\n",
+				cpu, i, PTR_ERR(event));
+			acct_free_events(acct);
+			return PTR_ERR(event);
+		}
+		acct->event[i] = event;
+	}
+
+	acct->cluster = topology_physical_package_id(cpu) !=
+			topology_physical_package_id(0);
+	acct->sampled = NULL;
+	acct->period = 1;
+	acct->countdown = 1;
+	acct->window_start = 0;
+	acct->overhead = 0;
+	smp_wmb();
+	acct->active = true;
+	return 0;
+}
+
+/* Called with acct_mutex held */
+static void acct_stop_cpus(const struct cpumask *mask)
+{
+	int cpu;
+
+	for_each_cpu(cpu, mask)
+		per_cpu(tracectr_acct, cpu).active = false;
+
+	/* The hook runs with interrupts off */
+	synchronize_sched();
+
+	for_each_cpu(cpu, mask)
+		acct_free_events(&per_cpu(tracectr_acct, cpu));
+}
+
+static void enable_acct(void)
+{
+	int cpu;
+
+	get_online_cpus();
+	mutex_lock(&acct_mutex);
+	if (acct_state == 0) {
+		for_each_online_cpu(cpu)
+			acct_start_cpu(cpu);
+		register_trace_sched_switch(tracectr_acct_notifier, NULL);
+		acct_state = 1;
+	}
+	mutex_unlock(&acct_mutex);
+	put_online_cpus();
+}
+
+static void disable_acct(void)
+{
+	get_online_cpus();
+	mutex_lock(&acct_mutex);
+	if (acct_state == 1) {
+		acct_state = 0;
+		unregister_trace_sched_switch(tracectr_acct_notifier, NULL);
+		acct_stop_cpus(cpu_possible_mask);
+	}
+	mutex_unlock(&acct_mutex);
+	put_online_cpus();
+}
+
+static void acct_cpu_hotplug(unsigned long action, int cpu)
+{
+	switch (action & ~CPU_TASKS_FROZEN) {
+	case CPU_ONLINE:
+	case CPU_DOWN_FAILED:
+		mutex_lock(&acct_mutex);
+		if (acct_state == 1 && !per_cpu(tracectr_acct, cpu).active)
+			acct_start_cpu(cpu);
+		mutex_unlock(&acct_mutex);
+		break;
+	case CPU_DOWN_PREPARE:
+		mutex_lock(&acct_mutex);
+		acct_stop_cpus(cpumask_of(cpu));
+		mutex_unlock(&acct_mutex);
+		break;
+	}
+}
+
+static ssize_t read_enabled_acct_file_bool(struct file *file,
+		char __user *user_buf, size_t count, loff_t *ppos)
+{
+	char buf[2];
+
+	buf[0] = acct_state ? '1' : '0';
+	buf[1] = '\n';
+	return simple_read_from_buffer(user_buf, count, ppos, buf, 2);
+}
+
+static ssize_t write_enabled_acct_file_bool(struct file *file,
+		const char __user *user_buf, size_t count, loff_t *ppos)
+{
+	char buf[32];
+	size_t buf_size;
+
+	buf_size = min(count, (sizeof(buf)-1));
+	if (copy_from_user(buf, user_buf, buf_size))
+		return -EFAULT;
+	switch (buf[0]) {
+	case 'y':
+	case 'Y':
+	case '1':
+		enable_acct();
+		break;
+	case 'n':
+	case 'N':
+	case '0':
+		disable_acct();
+		break;
+	}
+
+	return count;
+}
+
+static const struct file_operations fops_acct = {
+	.read =		read_enabled_acct_file_bool,
+	.write =	write_enabled_acct_file_bool,
+	.llseek =	default_llseek,
+};
+
+static void __init init_acct(struct dentry *dir)
+{
+	debugfs_create_file("acct_enabled", 0660, dir, NULL, &fops_acct);
+	debugfs_create_u32("acct_budget", 0660, dir, &acct_budget);
+	enable_acct();
+}
+#else
+static inline void acct_cpu_hotplug(unsigned long action, int cpu)
+{
+}
+
+static inline void init_acct(struct dentry *dir)
+{
+}
+#endif /* CONFIG_TASK_PMU_ACCOUNTING */
+
 static int tracectr_cpu_hotplug_notifier(struct notifier_block *self,
 					 unsigned long action, void *hcpu)
 {
@@ -33,6 +333,8 @@ static int tracectr_cpu_hotplug_notifier(struct notifier_block *self,
 	if ((action & (~CPU_TASKS_FROZEN)) == CPU_STARTING)
 		per_cpu(hotplug_flag, cpu) = 1;
 
+	acct_cpu_hotplug(action, cpu);
+
 	return NOTIFY_OK;
 }
 
@@ -168,6 +470,7 @@ int __init init_tracecounters(void)
 	for_each_possible_cpu(cpu)
 		per_cpu(old_pid, cpu) = -1;
 	register_cpu_notifier(&tracectr_cpu_hotplug_notifier_block);
+	init_acct(dir);
 	return 0;
 }
 
@@ -509,14 +509,15 @@ static int gpr_set(struct task_struct *target, const struct user_regset *regset,
 	return 0;
 }
 
-/*
- * TODO: update fp accessors for lazy context switching (sync/flush hwstate)
- */
 static int fpr_get(struct task_struct *target, const struct user_regset *regset,
 		   unsigned int pos, unsigned int count,
 		   void *kbuf, void __user *ubuf)
 {
 	struct user_fpsimd_state *uregs;
+
+	if (target == current)
+		fpsimd_preserve_current_state();
+
 	uregs = &target->thread.fpsimd_state.user_fpsimd;
 	return user_regset_copyout(&pos, &count, &kbuf, &ubuf, uregs, 0, -1);
 }
@@ -534,6 +535,7 @@ static int fpr_set(struct task_struct *target, const struct user_regset *regset,
 		return ret;
 
 	target->thread.fpsimd_state.user_fpsimd = newstate;
+	fpsimd_flush_task_state(target);
 	return ret;
 }
 
@@ -785,6 +787,9 @@ static int compat_vfp_get(struct task_struct *target,
 	compat_ulong_t fpscr;
 	int ret;
 
+	if (target == current)
+		fpsimd_preserve_current_state();
+
 	uregs = &target->thread.fpsimd_state.user_fpsimd;
 
 	/*
@@ -826,6 +831,7 @@ static int compat_vfp_set(struct task_struct *target,
 		uregs->fpcr = fpscr & VFP_FPSCR_CTRL_MASK;
 	}
 
+	fpsimd_flush_task_state(target);
 	return ret;
 }
 
@@ -222,12 +222,18 @@ void update_vsyscall(struct timekeeper *tk)
 	vdso_data->xtime_coarse_nsec		= xtime_coarse.tv_nsec;
 	vdso_data->wtm_clock_sec		= tk->wall_to_monotonic.tv_sec;
 	vdso_data->wtm_clock_nsec		= tk->wall_to_monotonic.tv_nsec;
+	vdso_data->btm_clock_sec		= tk->total_sleep_time.tv_sec;
+	vdso_data->btm_clock_nsec		= tk->total_sleep_time.tv_nsec;
 
 	if (!use_syscall) {
 		vdso_data->cs_cycle_last	= tk->clock->cycle_last;
 		vdso_data->xtime_clock_sec	= tk->xtime_sec;
 		vdso_data->xtime_clock_nsec	= tk->xtime_nsec;
+		/* raw_time is in plain ns, the clocksource mult is not NTP adjusted */
+		vdso_data->raw_time_sec		= tk->raw_time.tv_sec;
+		vdso_data->raw_time_nsec	= tk->raw_time.tv_nsec;
 		vdso_data->cs_mult		= tk->mult;
+		vdso_data->cs_raw_mult		= tk->clock->mult;
 		vdso_data->cs_shift		= tk->shift;
 	}
 
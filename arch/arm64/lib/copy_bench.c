@@ -0,0 +1,146 @@
+/*
+ * Throughput of memcpy and the user copy routines on each cluster
+ *
+ * Copyright (C) 2016 HTC Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * Loading the module runs every size class on the first online cpu of
+ * each cluster and logs GB/s. The user copies run under KERNEL_DS on
+ * kernel buffers, which exercises the same load/store paths.
+ */
+
+#include <linux/cpu.h>
+#include <linux/kernel.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/module.h>
+#include <linux/string.h>
+#include <linux/uaccess.h>
+#include <linux/vmalloc.h>
+#include <linux/workqueue.h>
+
+#include <asm/topology.h>
+
+#define COPY_BENCH_BUF		(256 * 1024)
+
+static unsigned int copy_bench_mb = 64;
+module_param_named(mb, copy_bench_mb, uint, 0444);
+MODULE_PARM_DESC(mb, "Megabytes copied per size class and routine");
+
+static const size_t copy_bench_sizes[] = {
+	16, 64, 256, 1024, 4096, 16384, 65536,
+};
+
+enum {
+	COPY_BENCH_MEMCPY,
+	COPY_BENCH_FROM_USER,
+	COPY_BENCH_TO_USER,
+	COPY_BENCH_NR,
+};
+
+static const char * const copy_bench_names[COPY_BENCH_NR] = {
+	"memcpy", "copy_from_user", "copy_to_user",
+};
+
+static u8 *copy_bench_src, *copy_bench_dst;
+
+static s64 copy_bench_run(int kind, size_t size, unsigned long loops)
+{
+	u8 *src = copy_bench_src, *dst = copy_bench_dst;
+	unsigned long i;
+	ktime_t start;
+
+	start = ktime_get();
+	for (i = 0; i < loops; i++) {
+		switch (kind) {
+		case COPY_BENCH_MEMCPY:
+			memcpy(dst, src, size);
+			break;
+		case COPY_BENCH_FROM_USER:
+			__copy_from_user(dst, (const void __user *)src, size);
+			break;
+		default:
+			__copy_to_user((void __user *)dst, src, size);
+			break;
+		}
+	}
+	return ktime_to_ns(ktime_sub(ktime_get(), start));
+}
+
+static long copy_bench_cpu(void *arg)
+{
+	mm_segment_t fs = get_fs();
+	unsigned int cpu = smp_processor_id();
+	int i, kind;
+
+	set_fs(KERNEL_DS);
+	for (i = 0; i < ARRAY_SIZE(copy_bench_sizes); i++) {
+		size_t size = copy_bench_sizes[i];
+		unsigned long loops = max_t(unsigned long, 1,
+				((u64)copy_bench_mb << 20) / size);
+		u64 gbs[COPY_BENCH_NR];
+
+		for (kind = 0; kind < COPY_BENCH_NR; kind++) {
+			/* warm the caches and the branch predictor */
+			copy_bench_run(kind, size, min(loops, 1024UL));
+			/* bytes per ns == GB/s, kept in hundredths */
+			gbs[kind] = div64_u64((u64)loops * size * 100,
+				max_t(s64, copy_bench_run(kind, size, loops),
+					1));
+		}
+		pr_info("copy_bench: cpu%u cluster %d %6zu bytes: %s %llu.%02llu GB/s, %s %llu.%02llu GB/s, %s %llu.%02llu GB/s\n",
+			cpu, topology_physical_package_id(cpu), size,
+			copy_bench_names[0], gbs[0] / 100, gbs[0] % 100,
+			copy_bench_names[1], gbs[1] / 100, gbs[1] % 100,
+			copy_bench_names[2], gbs[2] / 100, gbs[2] % 100);
+	}
+	set_fs(fs);
+	return 0;
+}
+
+static int __init copy_bench_init(void)
+{
+	int cpu, other;
+
+	copy_bench_src = vmalloc(COPY_BENCH_BUF);
+	copy_bench_dst = vmalloc(COPY_BENCH_BUF);
+	if (!copy_bench_src || !copy_bench_dst) {
+		vfree(copy_bench_src);
+		vfree(copy_bench_dst);
+		return -ENOMEM;
+	}
+	memset(copy_bench_src, 0x5a, COPY_BENCH_BUF);
+	memset(copy_bench_dst, 0, COPY_BENCH_BUF);
+
+	get_online_cpus();
+	for_each_online_cpu(cpu) {
+		/* one cpu per cluster */
+		for_each_online_cpu(other) {
+			if (other >= cpu)
+				break;
+			if (topology_physical_package_id(other) ==
+					topology_physical_package_id(cpu))
+				break;
+		}
+		if (other < cpu)
+			continue;
+		work_on_cpu(cpu, copy_bench_cpu, NULL);
+	}
+	put_online_cpus();
+
+	vfree(copy_bench_src);
+	vfree(copy_bench_dst);
+	return 0;
+}
+
+static void __exit copy_bench_exit(void)
+{
+}
+
+module_init(copy_bench_init);
+module_exit(copy_bench_exit);
+MODULE_DESCRIPTION("arm64 memcpy and user copy benchmark");
+MODULE_LICENSE("GPL v2");
@@ -0,0 +1,122 @@
+/*
+ * crc32_le() and __crc32c_le() using the optional ARMv8 CRC32 instructions
+ *
+ * Copyright (C) 2016 HTC Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * These override the weak table driven versions in lib/crc32.c, which are
+ * still used before the cpu features are known and on cores without the
+ * CRC32 instructions.
+ */
+
+#include <linux/crc32.h>
+#include <linux/kernel.h>
+
+#include <asm/crc32.h>
+#include <asm/hwcap.h>
+
+u32 __pure crc32_le(u32 crc, unsigned char const *p, size_t len)
+{
+	if (!(elf_hwcap & HWCAP_CRC32))
+		return crc32_le_base(crc, p, len);
+	return crc32_arm64_le_hw(crc, p, len);
+}
+
+u32 __pure __crc32c_le(u32 crc, unsigned char const *p, size_t len)
+{
+	if (!(elf_hwcap & HWCAP_CRC32))
+		return __crc32c_le_base(crc, p, len);
+	return crc32c_arm64_le_hw(crc, p, len);
+}
+
+#ifdef CONFIG_CRC32_ARM64_SELFTEST
+
+#include <linux/init.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/random.h>
+#include <linux/vmalloc.h>
+
+#define CRC32_TEST_LEN		(64 * 1024)
+#define CRC32_TEST_RUNS		256
+#define CRC32_BENCH_ROUNDS	64
+
+static int __init crc32_arm64_selftest(void)
+{
+	u8 *buf;
+	ktime_t start;
+	s64 ns_hw = 0, ns_base = 0, ns_c_hw = 0, ns_c_base = 0;
+	u32 crc, seed;
+	int i, ret = 0;
+
+	if (!(elf_hwcap & HWCAP_CRC32)) {
+		pr_info("crc32_arm64: no CRC32 instructions, using tables\n");
+		return 0;
+	}
+
+	buf = vmalloc(CRC32_TEST_LEN);
+	if (!buf)
+		return -ENOMEM;
+	prandom_bytes(buf, CRC32_TEST_LEN);
+
+	/* every alignment and tail length of the 8 byte loop */
+	for (i = 0; i < CRC32_TEST_RUNS; i++) {
+		size_t off = prandom_u32() % 64;
+		size_t len = prandom_u32() % (CRC32_TEST_LEN - off);
+
+		seed = prandom_u32();
+		crc = crc32_le_base(seed, buf + off, len);
+		if (crc32_le(seed, buf + off, len) != crc) {
+			pr_err("crc32_arm64: crc32 mismatch off %zu len %zu\n",
+				off, len);
+			ret = -EINVAL;
+			goto out_free;
+		}
+		crc = __crc32c_le_base(seed, buf + off, len);
+		if (__crc32c_le(seed, buf + off, len) != crc) {
+			pr_err("crc32_arm64: crc32c mismatch off %zu len %zu\n",
+				off, len);
+			ret = -EINVAL;
+			goto out_free;
+		}
+	}
+
+	/* 4K blocks, the f2fs and jbd2 case */
+	for (i = 0; i < CRC32_BENCH_ROUNDS * (CRC32_TEST_LEN / PAGE_SIZE);
+			i++) {
+		u8 *p = buf + (i % (CRC32_TEST_LEN / PAGE_SIZE)) * PAGE_SIZE;
+
+		start = ktime_get();
+		crc32_le(~0, p, PAGE_SIZE);
+		ns_hw += ktime_to_ns(ktime_sub(ktime_get(), start));
+
+		start = ktime_get();
+		crc32_le_base(~0, p, PAGE_SIZE);
+		ns_base += ktime_to_ns(ktime_sub(ktime_get(), start));
+
+		start = ktime_get();
+		__crc32c_le(~0, p, PAGE_SIZE);
+		ns_c_hw += ktime_to_ns(ktime_sub(ktime_get(), start));
+
+		start = ktime_get();
+		__crc32c_le_base(~0, p, PAGE_SIZE);
+		ns_c_base += ktime_to_ns(ktime_sub(ktime_get(), start));
+	}
+
+	/* bytes per ns * 1000 == MB/s */
+#define CRC32_MBS(ns)	div64_s64((s64)CRC32_BENCH_ROUNDS * CRC32_TEST_LEN * \
+				1000, max_t(s64, ns, 1))
+	pr_info("crc32_arm64: self-test passed, 4K blocks: crc32 %lld MB/s (tables %lld MB/s), crc32c %lld MB/s (tables %lld MB/s)\n",
+		CRC32_MBS(ns_hw), CRC32_MBS(ns_base),
+		CRC32_MBS(ns_c_hw), CRC32_MBS(ns_c_base));
+#undef CRC32_MBS
+
+out_free:
+	vfree(buf);
+	return ret;
+}
+late_initcall(crc32_arm64_selftest);
+#endif /* CONFIG_CRC32_ARM64_SELFTEST */
@@ -0,0 +1,337 @@
+/*
+ * LZ4 decompressor tuned for ARMv8
+ *
+ * Copyright (C) 2016 HTC Corporation.
+ *
+ * Based on the generic decompressor in lib/lz4/lz4_decompress.c.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * The generic decoder copies literals and matches in 8 byte steps. Here
+ * literals and long-distance matches move 16 bytes per step, which gcc
+ * turns into a single LDP/STP pair of general purpose registers, and short
+ * distance (overlapping) matches are expanded once to an 8 byte period
+ * before switching to 8 byte steps. The kernel is built with
+ * -mgeneral-regs-only, and saving the FPSIMD state for NEON would cost
+ * more than it gains on a 4K page, so no vector registers are used.
+ *
+ * The wide copies may write up to WILDCOPY_MARGIN bytes past the end of a
+ * literal run or match, so the last bytes of the output are always produced
+ * with exact copies.
+ */
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/string.h>
+#include <linux/lz4.h>
+
+#include <asm/unaligned.h>
+
+#define ML_BITS		4
+#define ML_MASK		((1U << ML_BITS) - 1)
+#define RUN_BITS	(8 - ML_BITS)
+#define RUN_MASK	((1U << RUN_BITS) - 1)
+#define MINMATCH	4
+
+#define WILDCOPY_MARGIN	16
+
+static const int dec32table[] = {0, 3, 2, 3, 0, 0, 0, 0};
+static const int dec64table[] = {0, 0, 0, -1, 0, 1, 2, 3};
+
+static __always_inline void copy8(u8 *d, const u8 *s)
+{
+	put_unaligned(get_unaligned((const u64 *)s), (u64 *)d);
+}
+
+static __always_inline void copy16(u8 *d, const u8 *s)
+{
+	u64 lo = get_unaligned((const u64 *)s);
+	u64 hi = get_unaligned((const u64 *)(s + 8));
+
+	put_unaligned(lo, (u64 *)d);
+	put_unaligned(hi, (u64 *)(d + 8));
+}
+
+/* copy [s, s + (e - d)) to d in 16 byte steps, may overrun e by 15 bytes */
+static __always_inline u8 *wildcopy16(u8 *d, const u8 *s, u8 *e)
+{
+	do {
+		copy16(d, s);
+		d += 16;
+		s += 16;
+	} while (d < e);
+
+	return d;
+}
+
+/*
+ * copy a match whose source starts @offset bytes before @d; overlapping
+ * sources (offset < 8) are first expanded so that they repeat with a
+ * period of at least 8 bytes. Returns the end of what was written, which
+ * lies within 15 bytes past @e.
+ */
+static __always_inline u8 *copy_match(u8 *d, const u8 *ref,
+				size_t offset, u8 *e)
+{
+	if (offset >= 16)
+		return wildcopy16(d, ref, e);
+
+	if (offset < 8) {
+		d[0] = ref[0];
+		d[1] = ref[1];
+		d[2] = ref[2];
+		d[3] = ref[3];
+		d += 4;
+		ref += 4;
+		ref -= dec32table[offset];
+		put_unaligned(get_unaligned((const u32 *)ref), (u32 *)d);
+		d += 4;
+		ref -= dec64table[offset];
+	}
+
+	while (d < e) {
+		copy8(d, ref);
+		d += 8;
+		ref += 8;
+	}
+
+	return d;
+}
+
+static __always_inline int read_length(const u8 **ip, const u8 *iend,
+				size_t *length)
+{
+	unsigned int s;
+
+	do {
+		if (unlikely(*ip >= iend))
+			return -1;
+		s = *(*ip)++;
+		*length += s;
+	} while (s == 255);
+
+	return 0;
+}
+
+int lz4_decompress_arm64(const unsigned char *src, size_t src_len,
+		unsigned char *dest, size_t *dest_len)
+{
+	const u8 *ip = src;
+	const u8 *const iend = ip + src_len;
+	u8 *op = dest;
+	u8 *const oend = op + *dest_len;
+	const u8 *ref;
+	unsigned int token;
+	size_t length, offset;
+
+	if (unlikely(!src_len))
+		return -1;
+
+	while (1) {
+		token = *ip++;
+
+		/* literals */
+		length = token >> ML_BITS;
+		if (length == RUN_MASK && read_length(&ip, iend, &length))
+			return -1;
+
+		if (likely(length + WILDCOPY_MARGIN <= (size_t)(iend - ip) &&
+				length + WILDCOPY_MARGIN <= (size_t)(oend - op))) {
+			wildcopy16(op, ip, op + length);
+		} else {
+			if (unlikely(length > (size_t)(iend - ip) ||
+					length > (size_t)(oend - op)))
+				return -1;
+			memcpy(op, ip, length);
+		}
+		ip += length;
+		op += length;
+
+		/* the last sequence carries literals only */
+		if (ip == iend)
+			break;
+
+		/* match offset */
+		if (unlikely(iend - ip < 2))
+			return -1;
+		offset = get_unaligned_le16(ip);
+		ip += 2;
+		if (unlikely(!offset || offset > (size_t)(op - dest)))
+			return -1;
+		ref = op - offset;
+
+		/* match length */
+		length = token & ML_MASK;
+		if (length == ML_MASK && read_length(&ip, iend, &length))
+			return -1;
+		length += MINMATCH;
+
+		if (unlikely(length > (size_t)(oend - op)))
+			return -1;
+
+		if (likely(length + WILDCOPY_MARGIN <= (size_t)(oend - op))) {
+			copy_match(op, ref, offset, op + length);
+		} else {
+			/*
+			 * a match close to the end of the page, typically the
+			 * long run of a mostly zero page: copy wide up to the
+			 * margin and finish byte by byte.
+			 */
+			u8 *cpy = op + length;
+			u8 *d = op;
+
+			if ((size_t)(oend - op) > 2 * WILDCOPY_MARGIN)
+				d = copy_match(op, ref, offset,
+					       oend - WILDCOPY_MARGIN);
+			while (d < cpy) {
+				*d = *(d - offset);
+				d++;
+			}
+		}
+		op += length;
+
+		if (unlikely(ip >= iend))
+			return -1;
+	}
+
+	*dest_len = op - dest;
+	return 0;
+}
+EXPORT_SYMBOL(lz4_decompress_arm64);
+
+#ifdef CONFIG_LZ4_DECOMPRESS_ARM64_SELFTEST
+
+#include <linux/init.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/random.h>
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+
+#define LZ4_TEST_PAGES		32
+#define LZ4_BENCH_ROUNDS	64
+
+/*
+ * Fill @page with data that exercises every copy path: runs repeating with
+ * a period of 1 to 31 bytes (overlapping matches), long literal runs of
+ * random bytes, and matches of various distances.
+ */
+static void __init lz4_test_fill(u8 *page, int nr)
+{
+	int period = (nr % 31) + 1;
+	int i;
+
+	switch (nr % 4) {
+	case 0:
+		for (i = 0; i < PAGE_SIZE; i++)
+			page[i] = (i % period) * 7;
+		break;
+	case 1:
+		prandom_bytes(page, PAGE_SIZE);
+		break;
+	case 2:
+		prandom_bytes(page, PAGE_SIZE / 2);
+		memcpy(page + PAGE_SIZE / 2, page, PAGE_SIZE / 2);
+		break;
+	default:
+		prandom_bytes(page, 64);
+		for (i = 64; i < PAGE_SIZE; i++)
+			page[i] = (i & 0x100) ? page[i % 64] : page[i - period];
+		break;
+	}
+}
+
+static int __init lz4_arm64_selftest(void)
+{
+	u8 *orig, *comp, *out;
+	size_t clen[LZ4_TEST_PAGES];
+	size_t comp_stride = lz4_compressbound(PAGE_SIZE);
+	void *wrkmem;
+	ktime_t start;
+	s64 ns_arm64 = 0, ns_generic = 0;
+	int i, round, ret = -ENOMEM;
+
+	orig = vmalloc(LZ4_TEST_PAGES * PAGE_SIZE);
+	comp = vmalloc(LZ4_TEST_PAGES * comp_stride);
+	out = vmalloc(PAGE_SIZE);
+	wrkmem = vmalloc(LZ4_MEM_COMPRESS);
+	if (!orig || !comp || !out || !wrkmem)
+		goto out_free;
+
+	for (i = 0; i < LZ4_TEST_PAGES; i++) {
+		u8 *page = orig + i * PAGE_SIZE;
+
+		lz4_test_fill(page, i);
+		ret = lz4_compress(page, PAGE_SIZE, comp + i * comp_stride,
+				&clen[i], wrkmem);
+		if (ret) {
+			pr_err("lz4_arm64: compression of page %d failed\n", i);
+			goto out_free;
+		}
+	}
+
+	for (i = 0; i < LZ4_TEST_PAGES; i++) {
+		size_t dlen = PAGE_SIZE;
+
+		memset(out, 0, PAGE_SIZE);
+		ret = lz4_decompress_arm64(comp + i * comp_stride, clen[i],
+				out, &dlen);
+		if (ret || dlen != PAGE_SIZE ||
+				memcmp(out, orig + i * PAGE_SIZE, PAGE_SIZE)) {
+			pr_err("lz4_arm64: page %d mismatch (ret %d, len %zu)\n",
+				i, ret, dlen);
+			ret = -EINVAL;
+			goto out_free;
+		}
+
+		/* a truncated stream must be rejected, never overrun */
+		dlen = PAGE_SIZE;
+		if (!lz4_decompress_arm64(comp + i * comp_stride, clen[i] / 2,
+				out, &dlen) && dlen == PAGE_SIZE) {
+			pr_err("lz4_arm64: truncated page %d accepted\n", i);
+			ret = -EINVAL;
+			goto out_free;
+		}
+	}
+
+	for (round = 0; round < LZ4_BENCH_ROUNDS; round++) {
+		for (i = 0; i < LZ4_TEST_PAGES; i++) {
+			size_t dlen = PAGE_SIZE;
+
+			start = ktime_get();
+			lz4_decompress_arm64(comp + i * comp_stride, clen[i],
+					out, &dlen);
+			ns_arm64 += ktime_to_ns(ktime_sub(ktime_get(), start));
+
+			dlen = PAGE_SIZE;
+			start = ktime_get();
+			lz4_decompress_unknownoutputsize(comp + i * comp_stride,
+					clen[i], out, &dlen);
+			ns_generic += ktime_to_ns(ktime_sub(ktime_get(), start));
+		}
+	}
+
+	/* bytes per ns * 1000 == MB/s */
+	pr_info("lz4_arm64: self-test passed, 4K pages: arm64 %lld MB/s, generic %lld MB/s\n",
+		div64_s64((s64)LZ4_BENCH_ROUNDS * LZ4_TEST_PAGES * PAGE_SIZE *
+			1000, max_t(s64, ns_arm64, 1)),
+		div64_s64((s64)LZ4_BENCH_ROUNDS * LZ4_TEST_PAGES * PAGE_SIZE *
+			1000, max_t(s64, ns_generic, 1)));
+	ret = 0;
+
+out_free:
+	vfree(wrkmem);
+	vfree(out);
+	vfree(comp);
+	vfree(orig);
+	return ret;
+}
+late_initcall(lz4_arm64_selftest);
+#endif /* CONFIG_LZ4_DECOMPRESS_ARM64_SELFTEST */
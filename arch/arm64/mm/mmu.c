@@ -271,10 +271,23 @@ static void __init *early_alloc(unsigned long sz)
 	return ptr;
 }
 
+#define cont_addr_end(addr, end)					\
+({	unsigned long __boundary = ((addr) + CONT_SIZE) & CONT_MASK;	\
+	(__boundary - 1 < (end) - 1) ? __boundary : (end);		\
+})
+
+/*
+ * Runs of CONT_PTES pages that are naturally aligned both virtually and
+ * physically get the contiguous hint, so they occupy a single TLB entry.
+ * This is not done when the caller asked for page mappings, since those
+ * are later changed one page at a time by set_memory_*().
+ */
 static void __init alloc_init_pte(pmd_t *pmd, unsigned long addr,
 				  unsigned long end, unsigned long pfn,
-				  pgprot_t prot)
+				  pgprot_t prot, bool cont)
 {
+	unsigned long next;
+	pgprot_t __prot;
 	pte_t *pte;
 
 	if (pmd_none(*pmd)) {
@@ -285,9 +298,16 @@ static void __init alloc_init_pte(pmd_t *pmd, unsigned long addr,
 
 	pte = pte_offset_kernel(pmd, addr);
 	do {
-		set_pte(pte, pfn_pte(pfn, prot));
-		pfn++;
-	} while (pte++, addr += PAGE_SIZE, addr != end);
+		next = cont_addr_end(addr, end);
+		__prot = prot;
+		if (cont && ((addr | next | __pfn_to_phys(pfn)) & ~CONT_MASK) == 0)
+			__prot = __pgprot(pgprot_val(prot) | PTE_CONT);
+
+		do {
+			set_pte(pte, pfn_pte(pfn, __prot));
+			pfn++;
+		} while (pte++, addr += PAGE_SIZE, addr != next);
+	} while (addr != end);
 }
 
 #ifdef CONFIG_STRICT_MEMORY_RWX
@@ -352,7 +372,7 @@ static void __init alloc_init_pmd(pud_t *pud, unsigned long addr,
 				flush_tlb_all();
 		} else {
 			alloc_init_pte(pmd, addr, next, __phys_to_pfn(phys),
-				       prot_pte);
+				       prot_pte, !pages);
 		}
 		phys += next - addr;
 	} while (pmd++, addr = next, addr != end);
@@ -619,6 +619,7 @@ struct request_queue *blk_alloc_queue_node(gfp_t gfp_mask, int node_id)
 	q->backing_dev_info.capabilities = BDI_CAP_MAP_COPY;
 	q->backing_dev_info.name = "block";
 	q->node = node_id;
+	q->fg_io_stamp = jiffies;
 
 	err = bdi_init(&q->backing_dev_info);
 	if (err)
@@ -755,6 +756,9 @@ blk_init_allocated_queue(struct request_queue *q, request_fn_proc *rfn,
 
 	q->sg_reserved_size = INT_MAX;
 
+	if (wbt_init(q))
+		return NULL;
+
 	/* Protect q->elevator from elevator_change */
 	mutex_lock(&q->sysfs_lock);
 
@@ -1364,6 +1368,7 @@ void __blk_put_request(struct request_queue *q, struct request *req)
 	blk_pm_put_request(req);
 
 	elv_completed_request(q, req);
+	wbt_put(q, req);
 
 	/* this is a bio leak if the bio is not tagged with BIO_DONTFREE */
 	WARN_ON(req->bio && !bio_flagged(req->bio, BIO_DONTFREE));
@@ -1558,6 +1563,7 @@ void blk_queue_bio(struct request_queue *q, struct bio *bio)
 	int el_ret, rw_flags, where = ELEVATOR_INSERT_SORT;
 	struct request *req;
 	unsigned int request_count = 0;
+	bool wb_tracked;
 
 	/*
 	 * low level driver can indicate that it wants pages above a
@@ -1618,15 +1624,25 @@ get_rq:
 	 */
 	rw_flags |= (bio->bi_rw & (REQ_META | REQ_PRIO));
 
+	/*
+	 * Keep background writeback from flooding the device while reads
+	 * are slow. This may drop the queue lock and sleep.
+	 */
+	wb_tracked = wbt_wait(q, bio);
+
 	/*
 	 * Grab a free request. This is might sleep but can not fail.
 	 * Returns with the queue unlocked.
 	 */
 	req = get_request(q, rw_flags, bio, GFP_NOIO);
 	if (unlikely(!req)) {
+		if (wb_tracked)
+			wbt_cancel(q);
 		bio_endio(bio, -ENODEV);	/* @q is dead */
 		goto out_unlock;
 	}
+	if (wb_tracked)
+		wbt_track(req);
 
 	/*
 	 * After dropping the lock and possibly sleeping here, our request
@@ -1848,6 +1864,12 @@ generic_make_request_checks(struct bio *bio)
 	if (blk_throtl_bio(q, bio))
 		return false;	/* throttled, will be resubmitted later */
 
+	if (bio_data_dir(bio) == READ ? !(bio->bi_rw & REQ_RAHEAD) :
+	    (bio->bi_rw & REQ_SYNC)) {
+		q->fg_io_count++;
+		q->fg_io_stamp = jiffies;
+	}
+
 	trace_block_bio_queue(q, bio);
 	return true;
 
@@ -2352,6 +2374,7 @@ void blk_start_request(struct request *req)
 
 	BUG_ON(test_bit(REQ_ATOM_COMPLETE, &req->atomic_flags));
 	blk_add_timer(req);
+	wbt_issue(req->q, req);
 }
 EXPORT_SYMBOL(blk_start_request);
 
@@ -2577,6 +2600,7 @@ static void blk_finish_request(struct request *req, int error)
 
 
 	blk_account_io_done(req);
+	wbt_done(req->q, req);
 
 	if (req->end_io)
 		req->end_io(req, error);
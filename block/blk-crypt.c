@@ -0,0 +1,51 @@
+/*
+ * Inline encryption keys carried by bios
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <linux/blk-crypt.h>
+#include <linux/module.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+
+/**
+ * blk_crypt_key_alloc - allocate a key for inline encryption
+ * @raw: the key material
+ * @size: length of @raw, at most BLK_CRYPT_MAX_KEY_SIZE
+ * @gfp: allocation flags
+ *
+ * The caller owns the only reference, drop it with blk_crypt_key_put().
+ */
+struct blk_crypt_key *blk_crypt_key_alloc(const u8 *raw, unsigned int size,
+					  gfp_t gfp)
+{
+	struct blk_crypt_key *key;
+
+	if (size > BLK_CRYPT_MAX_KEY_SIZE)
+		return ERR_PTR(-EINVAL);
+
+	key = kzalloc(sizeof(*key), gfp);
+	if (!key)
+		return ERR_PTR(-ENOMEM);
+
+	atomic_set(&key->ref, 1);
+	key->size = size;
+	memcpy(key->raw, raw, size);
+	return key;
+}
+EXPORT_SYMBOL_GPL(blk_crypt_key_alloc);
+
+void blk_crypt_key_put(struct blk_crypt_key *key)
+{
+	if (atomic_dec_and_test(&key->ref))
+		kzfree(key);
+}
+EXPORT_SYMBOL_GPL(blk_crypt_key_put);
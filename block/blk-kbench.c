@@ -0,0 +1,159 @@
+/*
+ * Block request latency benchmark
+ *
+ * Copyright (C) 2016 HTC Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * Times single synchronous reads of size bytes from the block device
+ * target, bypassing the page cache, at queue depth one. mode=seqread
+ * walks the device from the start, mode=randread picks size aligned
+ * offsets at random. The device is only ever read; iosched-bench is
+ * the tool for replaying real mixed workloads.
+ */
+#define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
+
+#include <linux/bio.h>
+#include <linux/blkdev.h>
+#include <linux/fs.h>
+#include <linux/gfp.h>
+#include <linux/kbench.h>
+#include <linux/math64.h>
+#include <linux/random.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+
+#define BLK_KBENCH_MAX_PAGES	64
+
+struct blk_kbench {
+	struct block_device *bdev;
+	struct page *pages[BLK_KBENCH_MAX_PAGES];
+	unsigned int nr_pages;
+	u64 nr_blocks;
+	u64 next;
+	bool random;
+};
+
+static void blk_kbench_release(struct blk_kbench *bb)
+{
+	while (bb->nr_pages)
+		__free_page(bb->pages[--bb->nr_pages]);
+	if (bb->bdev)
+		blkdev_put(bb->bdev, FMODE_READ);
+	kfree(bb);
+}
+
+static int blk_kbench_setup(struct kbench_ctx *ctx)
+{
+	struct blk_kbench *bb;
+	unsigned int nr_pages;
+	int ret;
+
+	if (!ctx->target[0] || !ctx->size || ctx->size & (PAGE_SIZE - 1))
+		return -EINVAL;
+	nr_pages = ctx->size >> PAGE_SHIFT;
+	if (nr_pages > BLK_KBENCH_MAX_PAGES)
+		return -EINVAL;
+
+	bb = kzalloc(sizeof(*bb), GFP_KERNEL);
+	if (!bb)
+		return -ENOMEM;
+
+	if (!ctx->mode[0] || !strcmp(ctx->mode, "seqread")) {
+		bb->random = false;
+	} else if (!strcmp(ctx->mode, "randread")) {
+		bb->random = true;
+	} else {
+		ret = -EINVAL;
+		goto err;
+	}
+
+	bb->bdev = blkdev_get_by_path(ctx->target, FMODE_READ, bb);
+	if (IS_ERR(bb->bdev)) {
+		ret = PTR_ERR(bb->bdev);
+		bb->bdev = NULL;
+		goto err;
+	}
+
+	bb->nr_blocks = div_u64(i_size_read(bb->bdev->bd_inode), ctx->size);
+	if (!bb->nr_blocks) {
+		ret = -ENOSPC;
+		goto err;
+	}
+
+	while (bb->nr_pages < nr_pages) {
+		bb->pages[bb->nr_pages] = alloc_page(GFP_KERNEL);
+		if (!bb->pages[bb->nr_pages]) {
+			ret = -ENOMEM;
+			goto err;
+		}
+		bb->nr_pages++;
+	}
+
+	ctx->bytes = ctx->size;
+	ctx->priv = bb;
+	return 0;
+err:
+	blk_kbench_release(bb);
+	return ret;
+}
+
+static int blk_kbench_op(struct kbench_ctx *ctx, unsigned int i)
+{
+	struct blk_kbench *bb = ctx->priv;
+	struct bio *bio;
+	unsigned int j;
+	u64 block;
+	int ret;
+
+	if (bb->random) {
+		block = (u64)prandom_u32() << 32 | prandom_u32();
+		div64_u64_rem(block, bb->nr_blocks, &block);
+	} else {
+		block = bb->next++;
+		if (bb->next == bb->nr_blocks)
+			bb->next = 0;
+	}
+
+	bio = bio_alloc(GFP_KERNEL, bb->nr_pages);
+	if (!bio)
+		return -ENOMEM;
+	bio->bi_bdev = bb->bdev;
+	bio->bi_sector = block * (ctx->size >> 9);
+	for (j = 0; j < bb->nr_pages; j++) {
+		if (bio_add_page(bio, bb->pages[j], PAGE_SIZE, 0) != PAGE_SIZE) {
+			bio_put(bio);
+			return -EINVAL;
+		}
+	}
+
+	ret = submit_bio_wait(READ_SYNC, bio);
+	bio_put(bio);
+	return ret;
+}
+
+static void blk_kbench_teardown(struct kbench_ctx *ctx)
+{
+	blk_kbench_release(ctx->priv);
+}
+
+static struct kbench blk_kbench = {
+	.name		= "blk",
+	.help		= "mode=seqread|randread target=device size=bytes (page multiple)",
+	.setup		= blk_kbench_setup,
+	.op		= blk_kbench_op,
+	.teardown	= blk_kbench_teardown,
+};
+
+static int __init blk_kbench_init(void)
+{
+	return kbench_register(&blk_kbench);
+}
+late_initcall(blk_kbench_init);
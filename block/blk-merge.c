@@ -7,6 +7,7 @@
 #include <linux/blkdev.h>
 #include <linux/scatterlist.h>
 #include <linux/security.h>
+#include <linux/blk-crypt.h>
 
 #include "blk.h"
 
@@ -480,6 +481,9 @@ static int attempt_merge(struct request_queue *q, struct request *req,
 	    !blk_write_same_mergeable(req->bio, next->bio))
 		return 0;
 
+	if (!bio_crypt_mergeable(req->biotail, next->bio))
+		return 0;
+
 	/*
 	 * If we are allowed to merge, then append bio list
 	 * from next to rq and release next. merge_requests_fn
@@ -588,6 +592,18 @@ bool blk_rq_merge_ok(struct request *rq, struct bio *bio)
 	if (!security_allow_merge_bio(rq->bio, bio))
 		return false;
 
+	/*
+	 * Nor bios the storage controller encrypts with another key or a
+	 * tweak that does not carry on across the merge. Only the back merge
+	 * position is told apart, anything else is checked as a front merge.
+	 */
+	if (blk_rq_pos(rq) + blk_rq_sectors(rq) == bio->bi_sector) {
+		if (!bio_crypt_mergeable(rq->biotail, bio))
+			return false;
+	} else if (!bio_crypt_mergeable(bio, rq->bio)) {
+		return false;
+	}
+
 	return true;
 }
 
@@ -0,0 +1,262 @@
+/*
+ * Background writeback throttling
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * Background writes (flusher threads, kswapd) get a budget of requests
+ * they may have allocated at a time. Every window the fastest read of the
+ * window is compared with the latency target: if even that read missed
+ * the target the device is backed up with writes and the budget is
+ * halved, otherwise it is doubled back towards the queue depth. Writers
+ * over budget sleep in blk_queue_bio() before they get a request, so
+ * this works the same under every elevator.
+ */
+
+#include <linux/kernel.h>
+#include <linux/blkdev.h>
+#include <linux/blktrace_api.h>
+#include <linux/slab.h>
+#include <linux/wait.h>
+#include <linux/sched.h>
+
+#include "blk.h"
+
+#define WBT_DEF_LAT_NSEC	(2 * NSEC_PER_MSEC)
+#define WBT_WIN_NSEC		(100 * NSEC_PER_MSEC)
+
+enum {
+	WBT_STATE_DEFAULT,	/* on for non-rotational queues */
+	WBT_STATE_ON,		/* set through sysfs */
+};
+
+struct rq_wb {
+	unsigned int		depth;		/* background write budget */
+	atomic_t		inflight;
+	wait_queue_head_t	wait;
+
+	u64			min_lat_nsec;	/* read latency target, 0 off */
+	int			state;
+
+	/* reads completed in the current window */
+	u64			win_start;
+	u64			win_min_lat;
+	unsigned int		win_reads;
+};
+
+static unsigned int wbt_max_depth(struct request_queue *q)
+{
+	return max_t(unsigned int, q->nr_requests, 1);
+}
+
+static bool wbt_enabled(struct request_queue *q)
+{
+	struct rq_wb *rwb = q->rq_wb;
+
+	if (!rwb || !rwb->min_lat_nsec)
+		return false;
+	return rwb->state == WBT_STATE_ON || blk_queue_nonrot(q);
+}
+
+static bool wbt_inflight_inc_below(struct rq_wb *rwb)
+{
+	int cur = atomic_read(&rwb->inflight);
+
+	for (;;) {
+		int old;
+
+		if (cur >= rwb->depth)
+			return false;
+		old = atomic_cmpxchg(&rwb->inflight, cur, cur + 1);
+		if (old == cur)
+			return true;
+		cur = old;
+	}
+}
+
+/*
+ * Close the window if it is over and pick the budget for the next one.
+ * Called with the queue lock held.
+ */
+static void wbt_window_check(struct request_queue *q, u64 now)
+{
+	struct rq_wb *rwb = q->rq_wb;
+	unsigned int max_depth = wbt_max_depth(q);
+	unsigned int depth = rwb->depth;
+
+	if (now - rwb->win_start < WBT_WIN_NSEC)
+		return;
+
+	if (!rwb->win_reads)
+		depth = max_depth;
+	else if (rwb->win_min_lat > rwb->min_lat_nsec)
+		depth = max(depth / 2, 1U);
+	else
+		depth = min(depth * 2, max_depth);
+
+	if (depth != rwb->depth) {
+		blk_add_trace_msg(q, "wbt: reads min %lluus, depth %u -> %u",
+				  div_u64(rwb->win_min_lat, NSEC_PER_USEC),
+				  rwb->depth, depth);
+		if (depth > rwb->depth)
+			wake_up_all(&rwb->wait);
+		rwb->depth = depth;
+	}
+
+	rwb->win_start = now;
+	rwb->win_min_lat = U64_MAX;
+	rwb->win_reads = 0;
+}
+
+static bool wbt_should_throttle(struct bio *bio)
+{
+	if (bio_data_dir(bio) != WRITE)
+		return false;
+	return !(bio->bi_rw & (REQ_SYNC | REQ_FLUSH | REQ_FUA | REQ_DISCARD));
+}
+
+/**
+ * wbt_wait - wait for a background write slot
+ * @q: request queue, its lock held
+ * @bio: bio that will get a new request
+ *
+ * Sleeps with the queue lock dropped while the background writes in
+ * flight are at the budget. Returns true if the request that is allocated
+ * for @bio must be accounted with wbt_track().
+ */
+bool wbt_wait(struct request_queue *q, struct bio *bio)
+{
+	struct rq_wb *rwb = q->rq_wb;
+	DEFINE_WAIT(wait);
+
+	if (!wbt_should_throttle(bio) || !wbt_enabled(q))
+		return false;
+
+	wbt_window_check(q, ktime_to_ns(ktime_get()));
+	if (wbt_inflight_inc_below(rwb))
+		return true;
+
+	for (;;) {
+		prepare_to_wait_exclusive(&rwb->wait, &wait,
+					  TASK_UNINTERRUPTIBLE);
+		if (wbt_inflight_inc_below(rwb))
+			break;
+		spin_unlock_irq(q->queue_lock);
+		io_schedule();
+		spin_lock_irq(q->queue_lock);
+	}
+	finish_wait(&rwb->wait, &wait);
+
+	return true;
+}
+
+/* give back a slot taken by wbt_wait() that ended up without a request */
+void wbt_cancel(struct request_queue *q)
+{
+	struct rq_wb *rwb = q->rq_wb;
+
+	if (atomic_dec_return(&rwb->inflight) < (int)rwb->depth &&
+	    waitqueue_active(&rwb->wait))
+		wake_up(&rwb->wait);
+}
+
+/* called with the queue lock held as the request goes to the driver */
+void wbt_issue(struct request_queue *q, struct request *rq)
+{
+	if (rq->cmd_type == REQ_TYPE_FS && rq_data_dir(rq) == READ &&
+	    wbt_enabled(q)) {
+		rq->process_time = ktime_get();
+		rq->wbt_flags |= WBT_READ;
+	}
+}
+
+/* called with the queue lock held as the request completes */
+void wbt_done(struct request_queue *q, struct request *rq)
+{
+	struct rq_wb *rwb = q->rq_wb;
+	u64 now, lat;
+
+	if (!(rq->wbt_flags & WBT_READ))
+		return;
+	rq->wbt_flags &= ~WBT_READ;
+
+	now = ktime_to_ns(ktime_get());
+	lat = now - ktime_to_ns(rq->process_time);
+	if (!rwb->win_reads++ || lat < rwb->win_min_lat)
+		rwb->win_min_lat = lat;
+	wbt_window_check(q, now);
+}
+
+/* called with the queue lock held as the request is freed */
+void wbt_put(struct request_queue *q, struct request *rq)
+{
+	if (rq->wbt_flags & WBT_TRACKED) {
+		rq->wbt_flags &= ~WBT_TRACKED;
+		wbt_cancel(q);
+	}
+}
+
+ssize_t wbt_lat_show(struct request_queue *q, char *page)
+{
+	if (!q->rq_wb)
+		return -EINVAL;
+	return sprintf(page, "%llu\n",
+		       div_u64(q->rq_wb->min_lat_nsec, NSEC_PER_USEC));
+}
+
+ssize_t wbt_lat_store(struct request_queue *q, const char *page,
+		      size_t count)
+{
+	struct rq_wb *rwb = q->rq_wb;
+	unsigned long val;
+	int ret;
+
+	if (!rwb)
+		return -EINVAL;
+
+	ret = kstrtoul(page, 10, &val);
+	if (ret)
+		return ret;
+
+	spin_lock_irq(q->queue_lock);
+	rwb->min_lat_nsec = (u64)val * NSEC_PER_USEC;
+	rwb->state = WBT_STATE_ON;
+	if (!val) {
+		rwb->depth = wbt_max_depth(q);
+		wake_up_all(&rwb->wait);
+	}
+	spin_unlock_irq(q->queue_lock);
+
+	return count;
+}
+
+int wbt_init(struct request_queue *q)
+{
+	struct rq_wb *rwb;
+
+	rwb = kzalloc_node(sizeof(*rwb), GFP_KERNEL, q->node);
+	if (!rwb)
+		return -ENOMEM;
+
+	atomic_set(&rwb->inflight, 0);
+	init_waitqueue_head(&rwb->wait);
+	rwb->depth = wbt_max_depth(q);
+	rwb->min_lat_nsec = WBT_DEF_LAT_NSEC;
+	rwb->state = WBT_STATE_DEFAULT;
+	rwb->win_min_lat = U64_MAX;
+	q->rq_wb = rwb;
+
+	return 0;
+}
+
+void wbt_exit(struct request_queue *q)
+{
+	kfree(q->rq_wb);
+	q->rq_wb = NULL;
+}
@@ -230,4 +230,42 @@ static inline int blk_throtl_init(struct request_queue *q) { return 0; }
 static inline void blk_throtl_exit(struct request_queue *q) { }
 #endif /* CONFIG_BLK_DEV_THROTTLING */
 
+/*
+ * Background writeback throttling, see blk-wbt.c
+ */
+enum {
+	WBT_TRACKED	= 1 << 0,	/* holds a background write slot */
+	WBT_READ	= 1 << 1,	/* read timed from issue */
+};
+
+#ifdef CONFIG_BLK_WBT
+extern bool wbt_wait(struct request_queue *q, struct bio *bio);
+extern void wbt_cancel(struct request_queue *q);
+extern void wbt_issue(struct request_queue *q, struct request *rq);
+extern void wbt_done(struct request_queue *q, struct request *rq);
+extern void wbt_put(struct request_queue *q, struct request *rq);
+extern ssize_t wbt_lat_show(struct request_queue *q, char *page);
+extern ssize_t wbt_lat_store(struct request_queue *q, const char *page,
+			     size_t count);
+extern int wbt_init(struct request_queue *q);
+extern void wbt_exit(struct request_queue *q);
+
+static inline void wbt_track(struct request *rq)
+{
+	rq->wbt_flags |= WBT_TRACKED;
+}
+#else /* CONFIG_BLK_WBT */
+static inline bool wbt_wait(struct request_queue *q, struct bio *bio)
+{
+	return false;
+}
+static inline void wbt_cancel(struct request_queue *q) { }
+static inline void wbt_issue(struct request_queue *q, struct request *rq) { }
+static inline void wbt_done(struct request_queue *q, struct request *rq) { }
+static inline void wbt_put(struct request_queue *q, struct request *rq) { }
+static inline int wbt_init(struct request_queue *q) { return 0; }
+static inline void wbt_exit(struct request_queue *q) { }
+static inline void wbt_track(struct request *rq) { }
+#endif /* CONFIG_BLK_WBT */
+
 #endif /* BLK_INTERNAL_H */
@@ -0,0 +1,605 @@
+/*
+ * I/O scheduler replay benchmark
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * Replays the queue events of a blktrace capture against a block device,
+ * on the timeline they were captured with, under whatever elevator the
+ * device runs. Latency and throughput of every request class are then
+ * reported, so schedulers can be compared on recorded workloads.
+ *
+ * All files live in debugfs under iosched-bench/:
+ *	device		block device to replay on, e.g. /dev/block/mmcblk0p40
+ *	trace		blktrace output (the per cpu files) is appended here
+ *	speed		percent of the captured rate, 0 replays back to back
+ *	write_enable	writes are skipped unless set, the data is garbage
+ *	run		a write replays the trace and returns once it is done
+ *	clear		a write drops the trace and the results
+ *	results		outcome of the last run
+ */
+#define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
+
+#include <linux/blkdev.h>
+#include <linux/bio.h>
+#include <linux/blktrace_api.h>
+#include <linux/debugfs.h>
+#include <linux/delay.h>
+#include <linux/elevator.h>
+#include <linux/ktime.h>
+#include <linux/module.h>
+#include <linux/mutex.h>
+#include <linux/seq_file.h>
+#include <linux/sort.h>
+#include <linux/uaccess.h>
+#include <linux/vmalloc.h>
+#include <linux/wait.h>
+
+#define BENCH_MAX_IOS		(256 * 1024)
+#define BENCH_MAX_PAGES		128	/* the largest replayed I/O, 512k */
+#define BENCH_SLACK_US		50	/* submit early rather than sleep less */
+
+enum bench_class {
+	BENCH_READ,
+	BENCH_SWRITE,
+	BENCH_WRITE,
+	BENCH_NR_CLASSES,
+};
+
+static const char * const bench_class_name[BENCH_NR_CLASSES] = {
+	[BENCH_READ]	= "read",
+	[BENCH_SWRITE]	= "sync_write",
+	[BENCH_WRITE]	= "write",
+};
+
+static const int bench_class_rw[BENCH_NR_CLASSES] = {
+	[BENCH_READ]	= READ,
+	[BENCH_SWRITE]	= WRITE_SYNC,
+	[BENCH_WRITE]	= WRITE,
+};
+
+struct bench_io {
+	u64			time;		/* ns, as captured */
+	sector_t		sector;
+	unsigned int		bytes;
+	enum bench_class	class;
+
+	/* filled in by a run */
+	ktime_t			issue;
+	unsigned int		len;
+	u32			lat_us;
+	int			error;
+};
+
+struct bench_result {
+	unsigned int		nr;
+	u64			bytes;
+	u32			p50;
+	u32			p99;
+	u32			p999;
+	u32			max;
+};
+
+struct bench {
+	struct mutex		lock;		/* everything below */
+	struct dentry		*root;
+
+	char			path[64];
+	u32			speed;
+	u32			write_enable;
+
+	struct bench_io		*ios;
+	unsigned int		nr_ios;
+	unsigned int		max_ios;
+
+	/* blktrace record split across writes to the trace file */
+	struct blk_io_trace	hdr;
+	unsigned int		hdr_len;
+	unsigned int		pdu_skip;
+
+	struct page		*pages[BENCH_MAX_PAGES];
+	atomic_t		inflight;
+	wait_queue_head_t	wait;
+
+	/* last run */
+	bool			done;
+	char			disk[BDEVNAME_SIZE];
+	char			elevator[ELV_NAME_MAX];
+	u64			duration_ns;
+	unsigned int		nr_skipped;
+	unsigned int		nr_errors;
+	struct bench_result	res[BENCH_NR_CLASSES];
+};
+
+static struct bench bench = {
+	.lock	= __MUTEX_INITIALIZER(bench.lock),
+	.speed	= 100,
+	.wait	= __WAIT_QUEUE_HEAD_INITIALIZER(bench.wait),
+};
+
+static int bench_add_trace(struct blk_io_trace *t)
+{
+	u32 tc = t->action >> BLK_TC_SHIFT;
+	struct bench_io *io;
+
+	if ((t->magic & 0xffffff00) != BLK_IO_TRACE_MAGIC ||
+	    (t->magic & 0xff) != BLK_IO_TRACE_VERSION) {
+		pr_err("not a blktrace record at %u\n", bench.nr_ios);
+		return -EINVAL;
+	}
+
+	/* only queued fs requests describe what was submitted */
+	if ((t->action & 0xffff) != __BLK_TA_QUEUE || !t->bytes ||
+	    (tc & (BLK_TC_PC | BLK_TC_NOTIFY | BLK_TC_DISCARD)))
+		return 0;
+
+	if (bench.nr_ios == bench.max_ios) {
+		unsigned int max = bench.max_ios ? 2 * bench.max_ios : 1024;
+		struct bench_io *ios;
+
+		if (max > BENCH_MAX_IOS)
+			return -ENOSPC;
+		ios = vmalloc(max * sizeof(*ios));
+		if (!ios)
+			return -ENOMEM;
+		if (bench.ios) {
+			memcpy(ios, bench.ios, bench.nr_ios * sizeof(*ios));
+			vfree(bench.ios);
+		}
+		bench.ios = ios;
+		bench.max_ios = max;
+	}
+
+	io = &bench.ios[bench.nr_ios++];
+	memset(io, 0, sizeof(*io));
+	io->time = t->time;
+	io->sector = t->sector;
+	io->bytes = t->bytes;
+	if (!(tc & BLK_TC_WRITE))
+		io->class = BENCH_READ;
+	else if (tc & BLK_TC_SYNC)
+		io->class = BENCH_SWRITE;
+	else
+		io->class = BENCH_WRITE;
+
+	return 0;
+}
+
+static void bench_clear(void)
+{
+	vfree(bench.ios);
+	bench.ios = NULL;
+	bench.nr_ios = 0;
+	bench.max_ios = 0;
+	bench.hdr_len = 0;
+	bench.pdu_skip = 0;
+	bench.done = false;
+}
+
+static int bench_cmp_time(const void *a, const void *b)
+{
+	const struct bench_io *x = a, *y = b;
+
+	if (x->time == y->time)
+		return 0;
+	return x->time < y->time ? -1 : 1;
+}
+
+static int bench_cmp_u32(const void *a, const void *b)
+{
+	u32 x = *(const u32 *)a, y = *(const u32 *)b;
+
+	if (x == y)
+		return 0;
+	return x < y ? -1 : 1;
+}
+
+static void bench_end_io(struct bio *bio, int err)
+{
+	struct bench_io *io = bio->bi_private;
+
+	io->lat_us = ktime_us_delta(ktime_get(), io->issue);
+	io->error = err;
+	bio_put(bio);
+
+	if (atomic_dec_and_test(&bench.inflight))
+		wake_up(&bench.wait);
+}
+
+/*
+ * The capture comes from another device or partition, so its offsets are
+ * folded into @nr_sects and its sizes clipped to what one bio can take.
+ */
+static void bench_submit(struct block_device *bdev, struct bench_io *io,
+			 sector_t nr_sects, unsigned int max_bytes)
+{
+	unsigned int lbs = bdev_logical_block_size(bdev);
+	unsigned int bytes = min(io->bytes, max_bytes);
+	unsigned int nr_pages, done = 0;
+	sector_t span, sector;
+	struct bio *bio;
+	int i;
+
+	bytes = max(round_down(bytes, lbs), lbs);
+	nr_pages = DIV_ROUND_UP(bytes, PAGE_SIZE);
+
+	span = nr_sects - (bytes >> 9);
+	sector = io->sector;
+	if (sector > span)
+		sector = sector_div(sector, span + 1);
+	sector = round_down(sector, lbs >> 9);
+
+	bio = bio_alloc(GFP_NOIO, nr_pages);
+	bio->bi_bdev = bdev;
+	bio->bi_sector = sector;
+	bio->bi_end_io = bench_end_io;
+	bio->bi_private = io;
+
+	for (i = 0; i < nr_pages; i++) {
+		unsigned int len = min_t(unsigned int, bytes - done,
+					 PAGE_SIZE);
+
+		if (bio_add_page(bio, bench.pages[i], len, 0) != len)
+			break;
+		done += len;
+	}
+
+	io->len = bio->bi_size;
+	atomic_inc(&bench.inflight);
+	io->issue = ktime_get();
+	submit_bio(bench_class_rw[io->class], bio);
+}
+
+static u32 bench_percentile(u32 *lat, unsigned int nr, unsigned int permille)
+{
+	unsigned int idx = div_u64((u64)nr * permille, 1000);
+
+	return lat[min(idx, nr - 1)];
+}
+
+static void bench_collect(u32 *lat)
+{
+	int c, i;
+
+	memset(bench.res, 0, sizeof(bench.res));
+	bench.nr_errors = 0;
+
+	for (c = 0; c < BENCH_NR_CLASSES; c++) {
+		struct bench_result *res = &bench.res[c];
+
+		for (i = 0; i < bench.nr_ios; i++) {
+			struct bench_io *io = &bench.ios[i];
+
+			if (io->class != c || !ktime_to_ns(io->issue))
+				continue;
+			if (io->error) {
+				bench.nr_errors++;
+				continue;
+			}
+			lat[res->nr++] = io->lat_us;
+			res->bytes += io->len;
+		}
+		if (!res->nr)
+			continue;
+
+		sort(lat, res->nr, sizeof(*lat), bench_cmp_u32, NULL);
+		res->p50 = bench_percentile(lat, res->nr, 500);
+		res->p99 = bench_percentile(lat, res->nr, 990);
+		res->p999 = bench_percentile(lat, res->nr, 999);
+		res->max = lat[res->nr - 1];
+	}
+}
+
+static int bench_run(void)
+{
+	fmode_t mode = FMODE_READ | (bench.write_enable ? FMODE_WRITE : 0);
+	struct block_device *bdev;
+	struct request_queue *q;
+	unsigned int max_bytes;
+	sector_t nr_sects;
+	ktime_t start;
+	u64 base;
+	u32 *lat;
+	int i, ret = 0;
+
+	if (!bench.nr_ios)
+		return -ENODATA;
+
+	lat = vmalloc(bench.nr_ios * sizeof(*lat));
+	if (!lat)
+		return -ENOMEM;
+
+	for (i = 0; i < BENCH_MAX_PAGES; i++) {
+		bench.pages[i] = alloc_page(GFP_KERNEL);
+		if (!bench.pages[i]) {
+			ret = -ENOMEM;
+			goto free_pages;
+		}
+	}
+
+	bdev = blkdev_get_by_path(bench.path, mode, &bench);
+	if (IS_ERR(bdev)) {
+		ret = PTR_ERR(bdev);
+		pr_err("can't open %s: %d\n", bench.path, ret);
+		goto free_pages;
+	}
+
+	q = bdev_get_queue(bdev);
+	bdevname(bdev, bench.disk);
+	spin_lock_irq(q->queue_lock);
+	strlcpy(bench.elevator, q->elevator ?
+		q->elevator->type->elevator_name : "none",
+		sizeof(bench.elevator));
+	spin_unlock_irq(q->queue_lock);
+
+	nr_sects = i_size_read(bdev->bd_inode) >> 9;
+	max_bytes = min_t(unsigned int, BENCH_MAX_PAGES * PAGE_SIZE,
+			  queue_max_sectors(q) << 9);
+	if (nr_sects < (max_bytes >> 9)) {
+		ret = -ENOSPC;
+		goto put_bdev;
+	}
+
+	/* the per cpu files of a capture are appended one after the other */
+	sort(bench.ios, bench.nr_ios, sizeof(*bench.ios), bench_cmp_time,
+	     NULL);
+	base = bench.ios[0].time;
+	bench.nr_skipped = 0;
+
+	pr_info("replaying %u ios on %s (%s) at %u%%\n", bench.nr_ios,
+		bench.disk, bench.elevator, bench.speed);
+
+	start = ktime_get();
+	for (i = 0; i < bench.nr_ios; i++) {
+		struct bench_io *io = &bench.ios[i];
+
+		io->issue = ktime_set(0, 0);
+		if (ret)
+			continue;
+
+		if (io->class != BENCH_READ && !bench.write_enable) {
+			bench.nr_skipped++;
+			continue;
+		}
+
+		if (bench.speed) {
+			s64 due = div_u64((io->time - base) * 100, bench.speed);
+			s64 ahead = due - ktime_to_ns(ktime_sub(ktime_get(),
+							       start));
+
+			if (ahead > BENCH_SLACK_US * NSEC_PER_USEC)
+				usleep_range(div_u64(ahead, NSEC_PER_USEC),
+					     div_u64(ahead, NSEC_PER_USEC) +
+					     BENCH_SLACK_US);
+		}
+
+		bench_submit(bdev, io, nr_sects, max_bytes);
+
+		if (signal_pending(current))
+			ret = -EINTR;
+	}
+
+	wait_event(bench.wait, !atomic_read(&bench.inflight));
+	bench.duration_ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	bench_collect(lat);
+	bench.done = true;
+
+put_bdev:
+	blkdev_put(bdev, mode);
+free_pages:
+	for (i = 0; i < BENCH_MAX_PAGES && bench.pages[i]; i++) {
+		__free_page(bench.pages[i]);
+		bench.pages[i] = NULL;
+	}
+	vfree(lat);
+	return ret;
+}
+
+static ssize_t bench_trace_write(struct file *file, const char __user *ubuf,
+				 size_t count, loff_t *ppos)
+{
+	size_t n, done = 0;
+	int ret = 0;
+
+	mutex_lock(&bench.lock);
+	while (done < count) {
+		if (bench.pdu_skip) {
+			n = min_t(size_t, count - done, bench.pdu_skip);
+			bench.pdu_skip -= n;
+			done += n;
+			continue;
+		}
+
+		n = min(count - done, sizeof(bench.hdr) - bench.hdr_len);
+		if (copy_from_user((u8 *)&bench.hdr + bench.hdr_len,
+				   ubuf + done, n)) {
+			ret = -EFAULT;
+			break;
+		}
+		bench.hdr_len += n;
+		done += n;
+		if (bench.hdr_len < sizeof(bench.hdr))
+			continue;
+
+		bench.hdr_len = 0;
+		bench.pdu_skip = bench.hdr.pdu_len;
+		ret = bench_add_trace(&bench.hdr);
+		if (ret)
+			break;
+	}
+	mutex_unlock(&bench.lock);
+
+	return ret ? ret : count;
+}
+
+static const struct file_operations bench_trace_fops = {
+	.open		= simple_open,
+	.write		= bench_trace_write,
+	.llseek		= noop_llseek,
+};
+
+static ssize_t bench_device_read(struct file *file, char __user *ubuf,
+				 size_t count, loff_t *ppos)
+{
+	char buf[sizeof(bench.path) + 1];
+	int len;
+
+	mutex_lock(&bench.lock);
+	len = scnprintf(buf, sizeof(buf), "%s\n", bench.path);
+	mutex_unlock(&bench.lock);
+
+	return simple_read_from_buffer(ubuf, count, ppos, buf, len);
+}
+
+static ssize_t bench_device_write(struct file *file, const char __user *ubuf,
+				  size_t count, loff_t *ppos)
+{
+	char buf[sizeof(bench.path)];
+
+	if (count >= sizeof(buf))
+		return -EINVAL;
+	if (copy_from_user(buf, ubuf, count))
+		return -EFAULT;
+	buf[count] = '\0';
+
+	mutex_lock(&bench.lock);
+	strlcpy(bench.path, strim(buf), sizeof(bench.path));
+	bench.done = false;
+	mutex_unlock(&bench.lock);
+
+	return count;
+}
+
+static const struct file_operations bench_device_fops = {
+	.open		= simple_open,
+	.read		= bench_device_read,
+	.write		= bench_device_write,
+	.llseek		= noop_llseek,
+};
+
+static ssize_t bench_run_write(struct file *file, const char __user *ubuf,
+			       size_t count, loff_t *ppos)
+{
+	int ret;
+
+	mutex_lock(&bench.lock);
+	ret = bench_run();
+	mutex_unlock(&bench.lock);
+
+	return ret ? ret : count;
+}
+
+static const struct file_operations bench_run_fops = {
+	.open		= simple_open,
+	.write		= bench_run_write,
+	.llseek		= noop_llseek,
+};
+
+static ssize_t bench_clear_write(struct file *file, const char __user *ubuf,
+				 size_t count, loff_t *ppos)
+{
+	mutex_lock(&bench.lock);
+	bench_clear();
+	mutex_unlock(&bench.lock);
+
+	return count;
+}
+
+static const struct file_operations bench_clear_fops = {
+	.open		= simple_open,
+	.write		= bench_clear_write,
+	.llseek		= noop_llseek,
+};
+
+static int bench_results_show(struct seq_file *s, void *unused)
+{
+	u64 duration_us;
+	int c;
+
+	mutex_lock(&bench.lock);
+	if (!bench.done) {
+		seq_printf(s, "no results, %u ios in trace\n", bench.nr_ios);
+		goto out;
+	}
+
+	duration_us = max_t(u64, div_u64(bench.duration_ns, NSEC_PER_USEC), 1);
+	seq_printf(s, "device: %s\nelevator: %s\n", bench.disk,
+		   bench.elevator);
+	seq_printf(s, "ios: %u skipped: %u errors: %u duration_ms: %llu\n",
+		   bench.nr_ios, bench.nr_skipped, bench.nr_errors,
+		   div_u64(duration_us, USEC_PER_MSEC));
+	seq_printf(s, "%-12s %8s %10s %8s %8s %8s %8s %8s\n", "class", "ios",
+		   "kb/s", "iops", "p50_us", "p99_us", "p999_us", "max_us");
+
+	for (c = 0; c < BENCH_NR_CLASSES; c++) {
+		struct bench_result *res = &bench.res[c];
+
+		seq_printf(s, "%-12s %8u %10llu %8llu %8u %8u %8u %8u\n",
+			   bench_class_name[c], res->nr,
+			   div64_u64(res->bytes * USEC_PER_SEC,
+				     duration_us * 1024),
+			   div64_u64((u64)res->nr * USEC_PER_SEC, duration_us),
+			   res->p50, res->p99, res->p999, res->max);
+	}
+out:
+	mutex_unlock(&bench.lock);
+	return 0;
+}
+
+static int bench_results_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, bench_results_show, NULL);
+}
+
+static const struct file_operations bench_results_fops = {
+	.open		= bench_results_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init bench_init(void)
+{
+	bench.root = debugfs_create_dir("iosched-bench", NULL);
+	if (IS_ERR_OR_NULL(bench.root))
+		return -ENOENT;
+
+	if (!debugfs_create_file("device", S_IRUGO | S_IWUSR, bench.root,
+				 NULL, &bench_device_fops) ||
+	    !debugfs_create_file("trace", S_IWUSR, bench.root, NULL,
+				 &bench_trace_fops) ||
+	    !debugfs_create_u32("speed", S_IRUGO | S_IWUSR, bench.root,
+				&bench.speed) ||
+	    !debugfs_create_u32("write_enable", S_IRUGO | S_IWUSR, bench.root,
+				&bench.write_enable) ||
+	    !debugfs_create_file("run", S_IWUSR, bench.root, NULL,
+				 &bench_run_fops) ||
+	    !debugfs_create_file("clear", S_IWUSR, bench.root, NULL,
+				 &bench_clear_fops) ||
+	    !debugfs_create_file("results", S_IRUGO, bench.root, NULL,
+				 &bench_results_fops)) {
+		debugfs_remove_recursive(bench.root);
+		return -ENOENT;
+	}
+
+	return 0;
+}
+
+static void __exit bench_exit(void)
+{
+	debugfs_remove_recursive(bench.root);
+	bench_clear();
+}
+
+module_init(bench_init);
+module_exit(bench_exit);
+
+MODULE_LICENSE("GPL v2");
+MODULE_DESCRIPTION("I/O scheduler replay benchmark");
@@ -26,6 +26,7 @@
 #include <linux/compiler.h>
 #include <linux/blktrace_api.h>
 #include <linux/hrtimer.h>
+#include <linux/blk-cgroup.h>
 
 /*
  * enum row_queue_prio - Priorities of the ROW queues
@@ -100,16 +101,30 @@ static const struct row_queue_params row_queues_def[] = {
 #define ROW_IDLE_TIME_MSEC 5
 #define ROW_READ_FREQ_MSEC 5
 
+/*
+ * Think time samples are kept in 8.8 fixed point and decay by 1/8 on every
+ * insertion. A queue is idled on only once it has seen a few requests.
+ */
+#define ROW_TTIME_DECAY_SHIFT	3
+#define ROW_TTIME_MIN_SAMPLES	80
+
 /**
  * struct rowq_idling_data -  parameters for idling on the queue
  * @last_insert_time:	time the last request was inserted
  *			to the queue
  * @begin_idling:	flag indicating wether we should idle
+ * @ttime_samples:	decayed number of think time samples
+ * @ttime_total:	decayed sum of think time samples (usec)
+ * @ttime_mean:		predicted time to the next insertion (usec)
  *
  */
 struct rowq_idling_data {
 	ktime_t			last_insert_time;
 	bool			begin_idling;
+
+	unsigned long		ttime_samples;
+	u64			ttime_total;
+	s64			ttime_mean;
 };
 
 /**
@@ -144,9 +159,9 @@ struct row_queue {
 
 /**
  * struct idling_data - data for idling on empty rqueue
- * @idle_time_ms:		idling duration (msec)
- * @freq_ms:		min time between two requests that
- *			triger idling (msec)
+ * @idle_time_ms:		max idling duration (msec)
+ * @freq_ms:		max mean think time of a queue that
+ *			triggers idling (msec)
  * @hr_timer:	idling timer
  * @idle_work:	the work to be scheduled when idling timer expires
  * @idling_queue_idx:	index of the queues we're idling on
@@ -191,6 +206,8 @@ struct starvation_data {
  * @reg_prio_starvation: starvation data for REGULAR priority queues
  * @low_prio_starvation: starvation data for LOW priority queues
  * @cycle_flags:	used for marking unserved queueus
+ * @bg_read_weight:	reads from blkio cgroups weighted below this are
+ *			served one priority class lower, 0 disables
  *
  */
 struct row_data {
@@ -211,6 +228,8 @@ struct row_data {
 
 	unsigned int			cycle_flags;
 	unsigned int last_update_jiffies;
+
+	int				bg_read_weight;
 };
 
 #define RQ_ROWQ(rq) ((struct row_queue *) ((rq)->elv.priv[0]))
@@ -365,6 +384,91 @@ static inline bool row_low_req_pending(struct row_data *rd)
 	return false;
 }
 
+/*
+ * row_update_ttime() - Account a new request in the queue think time
+ * @rd:		pointer to struct row_data
+ * @rqueue:	queue the request was added to
+ * @diff_us:	time since the previous insertion (usec)
+ *
+ * Long gaps are clipped to twice the idling frequency so a single pause
+ * doesn't mask a reader that resumes issuing back to back.
+ */
+static void row_update_ttime(struct row_data *rd, struct row_queue *rqueue,
+			     s64 diff_us)
+{
+	struct rowq_idling_data *idle = &rqueue->idle_data;
+	u64 ttime = min_t(s64, diff_us,
+			  2 * rd->rd_idle_data.freq_ms * USEC_PER_MSEC);
+
+	idle->ttime_samples = (7 * idle->ttime_samples + 256) >>
+				ROW_TTIME_DECAY_SHIFT;
+	idle->ttime_total = (7 * idle->ttime_total + 256 * ttime) >>
+				ROW_TTIME_DECAY_SHIFT;
+	idle->ttime_mean = div64_u64(idle->ttime_total + 128,
+				     idle->ttime_samples);
+}
+
+/*
+ * row_get_idle_window() - Return how long to idle on an empty queue
+ * @rd:		pointer to struct row_data
+ * @qnum:	queue to idle on
+ *
+ * The next request is expected within twice the mean think time of the
+ * last one. Once that point has passed the reader has stopped issuing,
+ * so idling is disabled for the queue until it sees requests again.
+ *
+ * Returns the idling time in usec, 0 if the queue shouldn't be idled on.
+ */
+static s64 row_get_idle_window(struct row_data *rd, enum row_queue_prio qnum)
+{
+	struct rowq_idling_data *idle = &rd->row_queues[qnum].idle_data;
+	s64 window;
+
+	if (!idle->begin_idling || !row_queues_def[qnum].idling_enabled)
+		return 0;
+
+	window = 2 * idle->ttime_mean -
+		ktime_us_delta(ktime_get(), idle->last_insert_time);
+	if (window <= 0) {
+		idle->begin_idling = false;
+		row_log_rowq(rd, qnum, "Reader stopped issuing, disable idling");
+		return 0;
+	}
+
+	return min_t(s64, window, rd->rd_idle_data.idle_time_ms * USEC_PER_MSEC);
+}
+
+#ifdef CONFIG_BLK_CGROUP
+/*
+ * row_bio_is_background() - Check if a bio belongs to a background cgroup
+ * @rd:		pointer to struct row_data
+ * @bio:	the bio being queued, may be NULL
+ *
+ * Android puts background apps in a blkio cgroup with a low weight, so
+ * the weight tells the background readers from the foreground app.
+ */
+static bool row_bio_is_background(struct row_data *rd, struct bio *bio)
+{
+	struct blkcg *blkcg;
+	bool ret;
+
+	if (!rd->bg_read_weight)
+		return false;
+
+	rcu_read_lock();
+	blkcg = bio_blkcg(bio);
+	ret = blkcg != &blkcg_root && blkcg->cfq_weight < rd->bg_read_weight;
+	rcu_read_unlock();
+
+	return ret;
+}
+#else
+static inline bool row_bio_is_background(struct row_data *rd, struct bio *bio)
+{
+	return false;
+}
+#endif
+
 /******************* Elevator callback functions *********************/
 
 /*
@@ -378,7 +482,8 @@ static void row_add_request(struct request_queue *q,
 {
 	struct row_data *rd = (struct row_data *)q->elevator->elevator_data;
 	struct row_queue *rqueue = RQ_ROWQ(rq);
-	s64 diff_ms;
+	ktime_t now;
+	s64 diff_us;
 	bool queue_was_empty = list_empty(&rqueue->fifo);
 
 	list_add_tail(&rq->queuelist, &rqueue->fifo);
@@ -404,24 +509,29 @@ static void row_add_request(struct request_queue *q,
 					ROWQ_MAX_PRIO;
 			}
 		}
-		diff_ms = ktime_to_ms(ktime_sub(ktime_get(),
-				rqueue->idle_data.last_insert_time));
-		if (unlikely(diff_ms < 0)) {
-			pr_err("%s(): time delta error: diff_ms < 0",
+		now = ktime_get();
+		diff_us = ktime_us_delta(now,
+				rqueue->idle_data.last_insert_time);
+		if (unlikely(diff_us < 0)) {
+			pr_err("%s(): time delta error: diff_us < 0",
 				__func__);
 			rqueue->idle_data.begin_idling = false;
 			return;
 		}
-		if (diff_ms < rd->rd_idle_data.freq_ms) {
+		row_update_ttime(rd, rqueue, diff_us);
+		if (rqueue->idle_data.ttime_samples > ROW_TTIME_MIN_SAMPLES &&
+		    rqueue->idle_data.ttime_mean <
+		    rd->rd_idle_data.freq_ms * USEC_PER_MSEC) {
 			rqueue->idle_data.begin_idling = true;
-			row_log_rowq(rd, rqueue->prio, "Enable idling");
+			row_log_rowq(rd, rqueue->prio, "Enable idling (%lldus)",
+				rqueue->idle_data.ttime_mean);
 		} else {
 			rqueue->idle_data.begin_idling = false;
-			row_log_rowq(rd, rqueue->prio, "Disable idling (%ldms)",
-				(long)diff_ms);
+			row_log_rowq(rd, rqueue->prio, "Disable idling (%lldus)",
+				rqueue->idle_data.ttime_mean);
 		}
 
-		rqueue->idle_data.last_insert_time = ktime_get();
+		rqueue->idle_data.last_insert_time = now;
 	}
 	if (row_queues_def[rqueue->prio].is_urgent &&
 	    !rd->pending_urgent_rq && !rd->urgent_in_flight) {
@@ -618,6 +728,7 @@ static int row_get_ioprio_class_to_serve(struct row_data *rd, int force)
 {
 	int i;
 	int ret = IOPRIO_CLASS_NONE;
+	s64 idle_us;
 
 	if (!rd->nr_reqs[READ] && !rd->nr_reqs[WRITE]) {
 		row_log(rd->dispatch_queue, "No more requests in scheduler");
@@ -664,8 +775,8 @@ static int row_get_ioprio_class_to_serve(struct row_data *rd, int force)
 check_idling:
 	/* Check for (high priority) idling and enable if needed */
 	for (i = 0; i < ROWQ_REG_PRIO_IDX && !force; i++) {
-		if (rd->row_queues[i].idle_data.begin_idling &&
-		    row_queues_def[i].idling_enabled)
+		idle_us = row_get_idle_window(rd, i);
+		if (idle_us)
 			goto initiate_idling;
 	}
 
@@ -673,8 +784,10 @@ check_idling:
 	for (i = ROWQ_REG_PRIO_IDX; i < ROWQ_LOW_PRIO_IDX; i++) {
 		if (list_empty(&rd->row_queues[i].fifo)) {
 			/* We can idle only if this is not a forced dispatch */
-			if (rd->row_queues[i].idle_data.begin_idling &&
-			    !force && row_queues_def[i].idling_enabled)
+			if (force)
+				continue;
+			idle_us = row_get_idle_window(rd, i);
+			if (idle_us)
 				goto initiate_idling;
 		} else {
 			if (row_low_req_pending(rd) &&
@@ -693,11 +806,11 @@ check_idling:
 
 initiate_idling:
 	hrtimer_start(&rd->rd_idle_data.hr_timer,
-		ktime_set(0, rd->rd_idle_data.idle_time_ms * NSEC_PER_MSEC),
-		HRTIMER_MODE_REL);
+		ns_to_ktime(idle_us * NSEC_PER_USEC), HRTIMER_MODE_REL);
 
 	rd->rd_idle_data.idling_queue_idx = i;
-	row_log_rowq(rd, i, "Scheduled delayed work on %d. exiting", i);
+	row_log_rowq(rd, i, "Scheduled delayed work on %d for %lldus. exiting",
+		i, idle_us);
 
 done:
 	return ret;
@@ -921,6 +1034,7 @@ static int row_init_queue(struct request_queue *q, struct elevator_type *e)
 	 */
 	rdata->rd_idle_data.idle_time_ms = ROW_IDLE_TIME_MSEC;
 	rdata->rd_idle_data.freq_ms = ROW_READ_FREQ_MSEC;
+	rdata->bg_read_weight = CFQ_WEIGHT_DEFAULT;
 	hrtimer_init(&rdata->rd_idle_data.hr_timer,
 		CLOCK_MONOTONIC, HRTIMER_MODE_REL);
 	rdata->rd_idle_data.hr_timer.function = &row_idle_hrtimer_fn;
@@ -987,7 +1101,7 @@ static void row_merged_requests(struct request_queue *q, struct request *rq,
  *
  */
 static enum row_queue_prio row_get_queue_prio(struct request *rq,
-				struct row_data *rd)
+				struct row_data *rd, struct bio *bio)
 {
 	const int data_dir = rq_data_dir(rq);
 	const bool is_sync = rq_is_sync(rq);
@@ -1029,6 +1143,17 @@ static enum row_queue_prio row_get_queue_prio(struct request *rq,
 		break;
 	}
 
+	/*
+	 * Reads from background cgroups are served one class lower so they
+	 * never compete with the reads of the foreground app.
+	 */
+	if (data_dir == READ && row_bio_is_background(rd, bio)) {
+		if (q_type == ROWQ_PRIO_HIGH_READ)
+			q_type = ROWQ_PRIO_REG_READ;
+		else if (q_type == ROWQ_PRIO_REG_READ)
+			q_type = ROWQ_PRIO_LOW_READ;
+	}
+
 	return q_type;
 }
 
@@ -1048,7 +1173,7 @@ row_set_request(struct request_queue *q, struct request *rq, struct bio *bio,
 
 	spin_lock_irqsave(q->queue_lock, flags);
 	rq->elv.priv[0] =
-		(void *)(&rd->row_queues[row_get_queue_prio(rq, rd)]);
+		(void *)(&rd->row_queues[row_get_queue_prio(rq, rd, bio)]);
 	spin_unlock_irqrestore(q->queue_lock, flags);
 
 	return 0;
@@ -1095,6 +1220,7 @@ SHOW_FUNCTION(row_reg_starv_limit_show,
 	rowd->reg_prio_starvation.starvation_limit);
 SHOW_FUNCTION(row_low_starv_limit_show,
 	rowd->low_prio_starvation.starvation_limit);
+SHOW_FUNCTION(row_bg_read_weight_show, rowd->bg_read_weight);
 #undef SHOW_FUNCTION
 
 #define STORE_FUNCTION(__FUNC, __PTR, MIN, MAX)			\
@@ -1141,6 +1267,8 @@ STORE_FUNCTION(row_reg_starv_limit_store,
 STORE_FUNCTION(row_low_starv_limit_store,
 			&rowd->low_prio_starvation.starvation_limit,
 			1, INT_MAX);
+STORE_FUNCTION(row_bg_read_weight_store, &rowd->bg_read_weight,
+			0, CFQ_WEIGHT_MAX);
 
 #undef STORE_FUNCTION
 
@@ -1160,6 +1288,7 @@ static struct elv_fs_entry row_attrs[] = {
 	ROW_ATTR(rd_idle_data_freq),
 	ROW_ATTR(reg_starv_limit),
 	ROW_ATTR(low_starv_limit),
+	ROW_ATTR(bg_read_weight),
 	__ATTR_NULL
 };
 
@@ -72,11 +72,19 @@
 #include <linux/security.h>
 #include <linux/spinlock.h>
 #include <linux/ratelimit.h>
+#include <linux/stacktrace.h>
 
 #include <uapi/linux/android/binder.h>
 #include "binder_alloc.h"
 #include "binder_trace.h"
 
+#ifdef CONFIG_ANDROID_BINDER_LOOPER_AFFINITY
+#ifndef BINDER_SET_LOOPER_CPUS
+/* pin the looper threads of the calling proc, __u64 cpu bitmap, 0 unpins */
+#define BINDER_SET_LOOPER_CPUS		_IOW('b', 64, __u64)
+#endif
+#endif
+
 static HLIST_HEAD(binder_deferred_list);
 static DEFINE_MUTEX(binder_deferred_lock);
 
@@ -241,6 +249,61 @@ struct binder_transaction_log {
 static struct binder_transaction_log binder_transaction_log;
 static struct binder_transaction_log binder_transaction_log_failed;
 
+#ifdef CONFIG_ANDROID_BINDER_TXN_LATENCY
+/*
+ * Send to reply latency of synchronous transactions, per serving proc and
+ * transaction code, in log2 buckets of microseconds: bucket n counts the
+ * transactions that took [2^(n-1), 2^n) us, the last bucket everything
+ * slower. Codes that do not fit in BINDER_LAT_CODES are counted together.
+ */
+#define BINDER_LAT_BUCKETS	21
+#define BINDER_LAT_CODES	16
+
+struct binder_lat_code {
+	uint32_t code;
+	uint32_t count;
+	uint32_t max_us;
+	uint32_t buckets[BINDER_LAT_BUCKETS];
+};
+
+struct binder_lat_hist {
+	spinlock_t lock;
+	int nr_codes;
+	struct binder_lat_code codes[BINDER_LAT_CODES];
+	struct binder_lat_code other;
+};
+
+/* transactions slower than this are logged with both stacks, 0 disables */
+static unsigned int binder_slow_txn_ms;
+module_param_named(slow_transaction_ms, binder_slow_txn_ms, uint, 0644);
+
+#define BINDER_SLOW_TXN_DEPTH	16
+
+struct binder_slow_txn_entry {
+	int debug_id;
+	int from_proc;
+	int from_thread;
+	int to_proc;
+	int to_thread;
+	uint32_t code;
+	u64 latency_us;
+	unsigned int nr_from;
+	unsigned int nr_to;
+	unsigned long from_stack[BINDER_SLOW_TXN_DEPTH];
+	unsigned long to_stack[BINDER_SLOW_TXN_DEPTH];
+};
+
+struct binder_slow_txn_log {
+	spinlock_t lock;
+	unsigned int cur;
+	bool full;
+	struct binder_slow_txn_entry entry[16];
+};
+static struct binder_slow_txn_log binder_slow_txn_log = {
+	.lock = __SPIN_LOCK_UNLOCKED(binder_slow_txn_log.lock),
+};
+#endif
+
 static struct binder_transaction_log_entry *binder_transaction_log_add(
 	struct binder_transaction_log *log)
 {
@@ -539,6 +602,14 @@ struct binder_priority {
  * @inner_lock:           can nest under outer_lock and/or node lock
  * @outer_lock:           no nesting under innor or node lock
  *                        Lock order: 1) outer, 2) node, 3) inner
+ * @looper_cpus:          cpus looper threads are pinned to, empty if
+ *                        they are not pinned
+ *                        (protected by @inner_lock)
+ * @looper_cpus_seq:      bumped whenever @looper_cpus changes
+ *                        (protected by @inner_lock)
+ * @lat_hist:             latency histograms of transactions this proc
+ *                        replied to, allocated on the first reply
+ *                        (set once, protected by its own lock)
  *
  * Bookkeeping structure for binder processes
  */
@@ -570,6 +641,13 @@ struct binder_proc {
 	struct binder_context *context;
 	spinlock_t inner_lock;
 	spinlock_t outer_lock;
+#ifdef CONFIG_ANDROID_BINDER_LOOPER_AFFINITY
+	struct cpumask looper_cpus;
+	unsigned int looper_cpus_seq;
+#endif
+#ifdef CONFIG_ANDROID_BINDER_TXN_LATENCY
+	struct binder_lat_hist *lat_hist;
+#endif
 };
 
 enum {
@@ -615,6 +693,8 @@ enum {
  *                        when outstanding transactions are cleaned up
  *                        (protected by @proc->inner_lock)
  * @task:                 struct task_struct for this thread
+ * @looper_cpus_seq:      @proc->looper_cpus_seq last applied to this thread
+ *                        (only accessed by this thread)
  *
  * Bookkeeping structure for binder threads.
  */
@@ -635,6 +715,9 @@ struct binder_thread {
 	atomic_t tmp_ref;
 	bool is_dead;
 	struct task_struct *task;
+#ifdef CONFIG_ANDROID_BINDER_LOOPER_AFFINITY
+	unsigned int looper_cpus_seq;
+#endif
 };
 
 struct binder_transaction {
@@ -656,6 +739,9 @@ struct binder_transaction {
 	bool    set_priority_called;
 	kuid_t	sender_euid;
 	binder_uintptr_t security_ctx;
+#ifdef CONFIG_ANDROID_BINDER_TXN_LATENCY
+	ktime_t start_time;
+#endif
 	/**
 	 * @lock:  protects @from, @to_proc, and @to_thread
 	 *
@@ -1278,6 +1364,53 @@ static void binder_transaction_priority(struct task_struct *task,
 	binder_set_priority(task, desired_prio);
 }
 
+#ifdef CONFIG_ANDROID_BINDER_LOOPER_AFFINITY
+/**
+ * binder_apply_looper_cpus() - move a looper thread to the proc's looper cpus
+ * @thread:	current binder thread, about to wait for proc work
+ *
+ * Looper threads pick up a change of @proc->looper_cpus the next time they
+ * wait for proc work. The affinity is set through sched_setaffinity() so
+ * the cpuset of the process still applies.
+ */
+static void binder_apply_looper_cpus(struct binder_thread *thread)
+{
+	struct binder_proc *proc = thread->proc;
+	cpumask_var_t cpus;
+	unsigned int seq;
+	long ret;
+
+	binder_inner_proc_lock(proc);
+	seq = proc->looper_cpus_seq;
+	binder_inner_proc_unlock(proc);
+	if (seq == thread->looper_cpus_seq)
+		return;
+
+	if (!alloc_cpumask_var(&cpus, GFP_KERNEL))
+		return;
+
+	binder_inner_proc_lock(proc);
+	seq = proc->looper_cpus_seq;
+	cpumask_copy(cpus, &proc->looper_cpus);
+	binder_inner_proc_unlock(proc);
+
+	if (cpumask_empty(cpus))
+		cpumask_copy(cpus, cpu_possible_mask);
+
+	ret = sched_setaffinity(0, cpus);
+	if (ret)
+		binder_debug(BINDER_DEBUG_THREADS,
+			     "%d:%d failed to set looper cpus, %ld\n",
+			     proc->pid, thread->pid, ret);
+	thread->looper_cpus_seq = seq;
+	free_cpumask_var(cpus);
+}
+#else
+static inline void binder_apply_looper_cpus(struct binder_thread *thread)
+{
+}
+#endif
+
 static struct binder_node *binder_get_node_ilocked(struct binder_proc *proc,
 						   binder_uintptr_t ptr)
 {
@@ -2876,6 +3009,123 @@ static struct binder_node *binder_get_node_refs_for_txn(
 	return target_node;
 }
 
+#ifdef CONFIG_ANDROID_BINDER_TXN_LATENCY
+static void binder_lat_code_add(struct binder_lat_code *c, u64 us)
+{
+	int bucket = us ? min_t(int, fls64(us), BINDER_LAT_BUCKETS - 1) : 0;
+
+	c->count++;
+	c->buckets[bucket]++;
+	if (us > c->max_us)
+		c->max_us = min_t(u64, us, U32_MAX);
+}
+
+static void binder_slow_txn_add(struct binder_proc *proc,
+				struct binder_thread *thread,
+				struct binder_thread *from,
+				struct binder_transaction *t, u64 us)
+{
+	struct binder_slow_txn_log *log = &binder_slow_txn_log;
+	struct binder_slow_txn_entry *e;
+
+	spin_lock(&log->lock);
+	e = &log->entry[log->cur];
+	if (++log->cur == ARRAY_SIZE(log->entry)) {
+		log->cur = 0;
+		log->full = true;
+	}
+	memset(e, 0, sizeof(*e));
+	e->debug_id = t->debug_id;
+	e->from_proc = from->proc->pid;
+	e->from_thread = from->pid;
+	e->to_proc = proc->pid;
+	e->to_thread = thread->pid;
+	e->code = t->code;
+	e->latency_us = us;
+#ifdef CONFIG_STACKTRACE
+	{
+		struct stack_trace trace = {
+			.max_entries = BINDER_SLOW_TXN_DEPTH,
+		};
+
+		/* @from is still blocked waiting for this reply */
+		trace.entries = e->from_stack;
+		save_stack_trace_tsk(from->task, &trace);
+		e->nr_from = trace.nr_entries;
+
+		trace.nr_entries = 0;
+		trace.entries = e->to_stack;
+		save_stack_trace(&trace);
+		e->nr_to = trace.nr_entries;
+	}
+#endif
+	spin_unlock(&log->lock);
+}
+
+/**
+ * binder_txn_latency_record() - account the latency of a transaction
+ * @proc:	proc replying to @t
+ * @thread:	thread replying to @t
+ * @from:	thread that sent @t, waiting for the reply
+ * @t:		transaction being replied to
+ *
+ * Adds the send to reply time of @t to the histogram of its code in
+ * @proc, and logs both threads when it took longer than
+ * binder_slow_txn_ms.
+ */
+static void binder_txn_latency_record(struct binder_proc *proc,
+				      struct binder_thread *thread,
+				      struct binder_thread *from,
+				      struct binder_transaction *t)
+{
+	struct binder_lat_hist *hist = READ_ONCE(proc->lat_hist);
+	struct binder_lat_code *c = NULL;
+	unsigned int slow_ms = READ_ONCE(binder_slow_txn_ms);
+	u64 us;
+	int i;
+
+	us = ktime_to_us(ktime_sub(ktime_get(), t->start_time));
+
+	if (slow_ms && us >= (u64)slow_ms * USEC_PER_MSEC)
+		binder_slow_txn_add(proc, thread, from, t, us);
+
+	if (!hist) {
+		struct binder_lat_hist *new;
+
+		new = kzalloc(sizeof(*new), GFP_KERNEL);
+		if (!new)
+			return;
+		spin_lock_init(&new->lock);
+		hist = cmpxchg(&proc->lat_hist, NULL, new);
+		if (hist)
+			kfree(new);
+		else
+			hist = new;
+	}
+
+	spin_lock(&hist->lock);
+	for (i = 0; i < hist->nr_codes; i++) {
+		if (hist->codes[i].code == t->code) {
+			c = &hist->codes[i];
+			break;
+		}
+	}
+	if (!c && hist->nr_codes < BINDER_LAT_CODES) {
+		c = &hist->codes[hist->nr_codes++];
+		c->code = t->code;
+	}
+	binder_lat_code_add(c ? c : &hist->other, us);
+	spin_unlock(&hist->lock);
+}
+#else
+static inline void binder_txn_latency_record(struct binder_proc *proc,
+					     struct binder_thread *thread,
+					     struct binder_thread *from,
+					     struct binder_transaction *t)
+{
+}
+#endif
+
 static void binder_transaction(struct binder_proc *proc,
 			       struct binder_thread *thread,
 			       struct binder_transaction_data *tr, int reply,
@@ -3098,6 +3348,9 @@ static void binder_transaction(struct binder_proc *proc,
 	}
 	binder_stats_created(BINDER_STAT_TRANSACTION);
 	spin_lock_init(&t->lock);
+#ifdef CONFIG_ANDROID_BINDER_TXN_LATENCY
+	t->start_time = ktime_get();
+#endif
 
 	tcomplete = kzalloc(sizeof(*tcomplete), GFP_KERNEL);
 	if (tcomplete == NULL) {
@@ -3400,6 +3653,8 @@ static void binder_transaction(struct binder_proc *proc,
 	t->work.type = BINDER_WORK_TRANSACTION;
 
 	if (reply) {
+		binder_txn_latency_record(proc, thread, target_thread,
+					  in_reply_to);
 		binder_enqueue_thread_work(thread, tcomplete);
 		binder_inner_proc_lock(target_proc);
 		if (target_thread->is_dead) {
@@ -4106,6 +4361,7 @@ retry:
 						 binder_stop_on_user_error < 2);
 		}
 		binder_restore_priority(current, proc->default_priority);
+		binder_apply_looper_cpus(thread);
 	}
 
 	if (non_block) {
@@ -4559,6 +4815,9 @@ static void binder_free_proc(struct binder_proc *proc)
 	binder_alloc_deferred_release(&proc->alloc);
 	put_task_struct(proc->tsk);
 	binder_stats_deleted(BINDER_STAT_PROC);
+#ifdef CONFIG_ANDROID_BINDER_TXN_LATENCY
+	kfree(proc->lat_hist);
+#endif
 	kfree(proc);
 }
 
@@ -4856,6 +5115,41 @@ static int binder_ioctl_get_node_debug_info(struct binder_proc *proc,
 	return 0;
 }
 
+#ifdef CONFIG_ANDROID_BINDER_LOOPER_AFFINITY
+static int binder_ioctl_set_looper_cpus(struct binder_proc *proc,
+					void __user *ubuf)
+{
+	cpumask_var_t cpus;
+	__u64 bits;
+	int cpu;
+
+	if (copy_from_user(&bits, ubuf, sizeof(bits)))
+		return -EFAULT;
+
+	if (!zalloc_cpumask_var(&cpus, GFP_KERNEL))
+		return -ENOMEM;
+
+	for (cpu = 0; cpu < min_t(int, nr_cpu_ids, 64); cpu++)
+		if (bits & (1ULL << cpu))
+			cpumask_set_cpu(cpu, cpus);
+	cpumask_and(cpus, cpus, cpu_possible_mask);
+	if (bits && cpumask_empty(cpus)) {
+		free_cpumask_var(cpus);
+		return -EINVAL;
+	}
+
+	binder_inner_proc_lock(proc);
+	cpumask_copy(&proc->looper_cpus, cpus);
+	proc->looper_cpus_seq++;
+	binder_inner_proc_unlock(proc);
+
+	binder_debug(BINDER_DEBUG_THREADS, "%d looper cpus %llx\n",
+		     proc->pid, (u64)bits);
+	free_cpumask_var(cpus);
+	return 0;
+}
+#endif
+
 static long binder_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 {
 	int ret;
@@ -4917,6 +5211,13 @@ static long binder_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 		if (ret)
 			goto err;
 		break;
+#ifdef CONFIG_ANDROID_BINDER_LOOPER_AFFINITY
+	case BINDER_SET_LOOPER_CPUS:
+		ret = binder_ioctl_set_looper_cpus(proc, ubuf);
+		if (ret)
+			goto err;
+		break;
+#endif
 
 	case BINDER_THREAD_EXIT:
 		binder_debug(BINDER_DEBUG_THREADS, "%d:%d exit\n",
@@ -5824,6 +6125,109 @@ static int binder_stats_show(struct seq_file *m, void *unused)
 	return 0;
 }
 
+#ifdef CONFIG_ANDROID_BINDER_TXN_LATENCY
+static void print_binder_lat_code(struct seq_file *m,
+				  struct binder_lat_code *c, bool other)
+{
+	int i;
+
+	if (!c->count)
+		return;
+	if (other)
+		seq_puts(m, "  other codes:");
+	else
+		seq_printf(m, "  code %u:", c->code);
+	seq_printf(m, " count %u max %uus\n   ", c->count, c->max_us);
+	for (i = 0; i < BINDER_LAT_BUCKETS; i++) {
+		if (!c->buckets[i])
+			continue;
+		if (i == BINDER_LAT_BUCKETS - 1)
+			seq_printf(m, " >=%luus:%u", 1UL << (i - 1),
+				   c->buckets[i]);
+		else
+			seq_printf(m, " <%luus:%u", 1UL << i, c->buckets[i]);
+	}
+	seq_puts(m, "\n");
+}
+
+static int binder_transaction_latency_show(struct seq_file *m, void *unused)
+{
+	struct binder_lat_hist *hist, *snap;
+	struct binder_proc *proc;
+	int i;
+
+	snap = kmalloc(sizeof(*snap), GFP_KERNEL);
+	if (!snap)
+		return -ENOMEM;
+
+	seq_puts(m, "binder transaction latency:\n");
+	mutex_lock(&binder_procs_lock);
+	hlist_for_each_entry(proc, &binder_procs, proc_node) {
+		hist = READ_ONCE(proc->lat_hist);
+		if (!hist)
+			continue;
+		spin_lock(&hist->lock);
+		memcpy(snap, hist, sizeof(*snap));
+		spin_unlock(&hist->lock);
+
+		seq_printf(m, "proc %d\n", proc->pid);
+		for (i = 0; i < snap->nr_codes; i++)
+			print_binder_lat_code(m, &snap->codes[i], false);
+		print_binder_lat_code(m, &snap->other, true);
+	}
+	mutex_unlock(&binder_procs_lock);
+	kfree(snap);
+
+	return 0;
+}
+
+static void print_binder_slow_txn_stack(struct seq_file *m, const char *name,
+					unsigned long *stack, unsigned int nr)
+{
+	unsigned int i;
+
+	seq_printf(m, "  %s:\n", name);
+	for (i = 0; i < nr && stack[i] != ULONG_MAX; i++)
+		seq_printf(m, "    [<%p>] %pS\n", (void *)stack[i],
+			   (void *)stack[i]);
+}
+
+static int binder_slow_transactions_show(struct seq_file *m, void *unused)
+{
+	struct binder_slow_txn_log *log = &binder_slow_txn_log;
+	struct binder_slow_txn_entry *e;
+	unsigned int count, cur, i;
+
+	e = kmalloc(sizeof(*e), GFP_KERNEL);
+	if (!e)
+		return -ENOMEM;
+
+	spin_lock(&log->lock);
+	count = log->full ? ARRAY_SIZE(log->entry) : log->cur;
+	cur = log->full ? log->cur : 0;
+	spin_unlock(&log->lock);
+
+	seq_printf(m, "binder slow transactions (threshold %ums):\n",
+		   READ_ONCE(binder_slow_txn_ms));
+	for (i = 0; i < count; i++) {
+		spin_lock(&log->lock);
+		memcpy(e, &log->entry[(cur + i) % ARRAY_SIZE(log->entry)],
+		       sizeof(*e));
+		spin_unlock(&log->lock);
+
+		seq_printf(m, "%d: from %d:%d to %d:%d code %u %lluus\n",
+			   e->debug_id, e->from_proc, e->from_thread,
+			   e->to_proc, e->to_thread, e->code, e->latency_us);
+		print_binder_slow_txn_stack(m, "from", e->from_stack,
+					    e->nr_from);
+		print_binder_slow_txn_stack(m, "to", e->to_stack, e->nr_to);
+	}
+	kfree(e);
+
+	return 0;
+}
+#endif
+
 static int binder_transactions_show(struct seq_file *m, void *unused)
 {
 	struct binder_proc *proc;
@@ -5912,10 +6316,26 @@ static const struct file_operations binder_fops = {
 	.release = binder_release,
 };
 
+#ifdef CONFIG_KBENCH
+/* For the allocator benchmark, which opens and maps a proc of its own */
+struct binder_alloc *binder_alloc_from_file(struct file *filp)
+{
+	struct binder_proc *proc = filp->private_data;
+
+	if (filp->f_op != &binder_fops)
+		return NULL;
+	return &proc->alloc;
+}
+#endif
+
 BINDER_DEBUG_ENTRY(state);
 BINDER_DEBUG_ENTRY(stats);
 BINDER_DEBUG_ENTRY(transactions);
 BINDER_DEBUG_ENTRY(transaction_log);
+#ifdef CONFIG_ANDROID_BINDER_TXN_LATENCY
+BINDER_DEBUG_ENTRY(transaction_latency);
+BINDER_DEBUG_ENTRY(slow_transactions);
+#endif
 
 static int __init init_binder_device(const char *name)
 {
@@ -5989,6 +6409,18 @@ static int __init binder_init(void)
 				    binder_debugfs_dir_entry_root,
 				    &binder_transaction_log_failed,
 				    &binder_transaction_log_fops);
+#ifdef CONFIG_ANDROID_BINDER_TXN_LATENCY
+		debugfs_create_file("transaction_latency",
+				    0444,
+				    binder_debugfs_dir_entry_root,
+				    NULL,
+				    &binder_transaction_latency_fops);
+		debugfs_create_file("slow_transactions",
+				    0444,
+				    binder_debugfs_dir_entry_root,
+				    NULL,
+				    &binder_slow_transactions_fops);
+#endif
 	}
 
 	/*
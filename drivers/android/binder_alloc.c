@@ -59,12 +59,24 @@ static struct binder_buffer *binder_buffer_prev(struct binder_buffer *buffer)
 	return list_entry(buffer->entry.prev, struct binder_buffer, entry);
 }
 
+#ifdef CONFIG_ANDROID_BINDER_SLOT_ALLOC
+static int binder_slot_class(struct binder_alloc *alloc,
+			     struct binder_buffer *buffer)
+{
+	return ((u8 *)buffer->data - (u8 *)alloc->slot_area) /
+		BINDER_SLOT_CLASS_SIZE;
+}
+#endif
+
 static size_t binder_alloc_buffer_size(struct binder_alloc *alloc,
 				       struct binder_buffer *buffer)
 {
+#ifdef CONFIG_ANDROID_BINDER_SLOT_ALLOC
+	if (binder_alloc_is_slot(alloc, buffer))
+		return BINDER_SLOT_MIN_SIZE << binder_slot_class(alloc, buffer);
+#endif
 	if (list_is_last(&buffer->entry, &alloc->buffers))
-		return (u8 *)alloc->buffer +
-			alloc->buffer_size - (u8 *)buffer->data;
+		return (u8 *)alloc->slot_area - (u8 *)buffer->data;
 	return (u8 *)binder_buffer_next(buffer)->data - (u8 *)buffer->data;
 }
 
@@ -283,6 +295,110 @@ err_no_vma:
 	return vma ? -ENOMEM : -ESRCH;
 }
 
+static void binder_alloc_buf_set_used(struct binder_alloc *alloc,
+				      struct binder_buffer *buffer,
+				      size_t size,
+				      size_t data_size,
+				      size_t offsets_size,
+				      size_t extra_buffers_size,
+				      int is_async)
+{
+	buffer->free = 0;
+	buffer->allow_user_free = 0;
+	binder_insert_allocated_buffer_locked(alloc, buffer);
+	binder_alloc_debug(BINDER_DEBUG_BUFFER_ALLOC,
+		     "%d: binder_alloc_buf size %zd got %pK\n",
+		      alloc->pid, size, buffer);
+	buffer->data_size = data_size;
+	buffer->offsets_size = offsets_size;
+	buffer->async_transaction = is_async;
+	buffer->extra_buffers_size = extra_buffers_size;
+	if (is_async) {
+		alloc->free_async_space -= size + sizeof(struct binder_buffer);
+		binder_alloc_debug(BINDER_DEBUG_BUFFER_ALLOC_ASYNC,
+			     "%d: binder_alloc_buf size %zd async free %zd\n",
+			      alloc->pid, size, alloc->free_async_space);
+	}
+}
+
+#ifdef CONFIG_ANDROID_BINDER_SLOT_ALLOC
+/* take a free slot of the smallest class that fits @size, if any */
+static struct binder_buffer *binder_alloc_get_slot(struct binder_alloc *alloc,
+						   size_t size)
+{
+	struct binder_buffer *buffer;
+	int class;
+
+	if (!alloc->slot_buffers || size > BINDER_SLOT_MAX_SIZE)
+		return NULL;
+
+	class = size <= BINDER_SLOT_MIN_SIZE ? 0 :
+		ilog2(size - 1) + 1 - BINDER_SLOT_MIN_SHIFT;
+	for (; class < BINDER_SLOT_CLASSES; class++) {
+		buffer = list_first_entry_or_null(&alloc->free_slots[class],
+						  struct binder_buffer, entry);
+		if (buffer) {
+			list_del_init(&buffer->entry);
+			return buffer;
+		}
+	}
+	return NULL;
+}
+
+/*
+ * Carve the slot area out of the end of the mmap'd space and map its
+ * pages up front, so that small transactions never fault pages in. Slots
+ * are an optimization only: on any failure the whole space stays with the
+ * rbtree allocator.
+ */
+static void binder_alloc_init_slots(struct binder_alloc *alloc,
+				    struct vm_area_struct *vma)
+{
+	struct binder_buffer *buffer;
+	void *slot_area;
+	int class, i, nr_slots = 0;
+
+	for (class = 0; class < BINDER_SLOT_CLASSES; class++)
+		INIT_LIST_HEAD(&alloc->free_slots[class]);
+
+	/* leave at least three quarters of the space to the rbtree */
+	if (alloc->buffer_size < 4 * BINDER_SLOT_AREA_SIZE)
+		return;
+
+	for (class = 0; class < BINDER_SLOT_CLASSES; class++)
+		nr_slots += BINDER_SLOT_CLASS_SIZE /
+			(BINDER_SLOT_MIN_SIZE << class);
+
+	alloc->slot_buffers = kcalloc(nr_slots, sizeof(*alloc->slot_buffers),
+				      GFP_KERNEL);
+	if (!alloc->slot_buffers)
+		return;
+
+	slot_area = (u8 *)alloc->buffer + alloc->buffer_size -
+		BINDER_SLOT_AREA_SIZE;
+	if (binder_update_page_range(alloc, 1, slot_area,
+			(u8 *)slot_area + BINDER_SLOT_AREA_SIZE, vma)) {
+		kfree(alloc->slot_buffers);
+		alloc->slot_buffers = NULL;
+		return;
+	}
+
+	buffer = alloc->slot_buffers;
+	for (class = 0; class < BINDER_SLOT_CLASSES; class++) {
+		size_t slot_size = BINDER_SLOT_MIN_SIZE << class;
+
+		for (i = 0; i < BINDER_SLOT_CLASS_SIZE / slot_size; i++) {
+			buffer->data = (u8 *)slot_area +
+				class * BINDER_SLOT_CLASS_SIZE + i * slot_size;
+			buffer->free = 1;
+			list_add_tail(&buffer->entry, &alloc->free_slots[class]);
+			buffer++;
+		}
+	}
+	alloc->slot_area = slot_area;
+}
+#endif
+
 static struct binder_buffer *binder_alloc_new_buf_locked(
 				struct binder_alloc *alloc,
 				size_t data_size,
@@ -332,6 +448,16 @@ static struct binder_buffer *binder_alloc_new_buf_locked(
 	/* Pad 0-size buffers so they get assigned unique addresses */
 	size = max(size, sizeof(void *));
 
+#ifdef CONFIG_ANDROID_BINDER_SLOT_ALLOC
+	buffer = binder_alloc_get_slot(alloc, size);
+	if (buffer) {
+		binder_alloc_buf_set_used(alloc, buffer, size, data_size,
+					  offsets_size, extra_buffers_size,
+					  is_async);
+		return buffer;
+	}
+#endif
+
 	while (n) {
 		buffer = rb_entry(n, struct binder_buffer, rb_node);
 		BUG_ON(!buffer->free);
@@ -417,22 +543,8 @@ static struct binder_buffer *binder_alloc_new_buf_locked(
 	}
 
 	rb_erase(best_fit, &alloc->free_buffers);
-	buffer->free = 0;
-	buffer->allow_user_free = 0;
-	binder_insert_allocated_buffer_locked(alloc, buffer);
-	binder_alloc_debug(BINDER_DEBUG_BUFFER_ALLOC,
-		     "%d: binder_alloc_buf size %zd got %pK\n",
-		      alloc->pid, size, buffer);
-	buffer->data_size = data_size;
-	buffer->offsets_size = offsets_size;
-	buffer->async_transaction = is_async;
-	buffer->extra_buffers_size = extra_buffers_size;
-	if (is_async) {
-		alloc->free_async_space -= size + sizeof(struct binder_buffer);
-		binder_alloc_debug(BINDER_DEBUG_BUFFER_ALLOC_ASYNC,
-			     "%d: binder_alloc_buf size %zd async free %zd\n",
-			      alloc->pid, size, alloc->free_async_space);
-	}
+	binder_alloc_buf_set_used(alloc, buffer, size, data_size,
+				  offsets_size, extra_buffers_size, is_async);
 	return buffer;
 
 err_alloc_buf_struct_failed:
@@ -558,6 +670,17 @@ static void binder_free_buf_locked(struct binder_alloc *alloc,
 			      alloc->pid, size, alloc->free_async_space);
 	}
 
+#ifdef CONFIG_ANDROID_BINDER_SLOT_ALLOC
+	if (binder_alloc_is_slot(alloc, buffer)) {
+		/* slot pages stay mapped until the proc goes away */
+		rb_erase(&buffer->rb_node, &alloc->allocated_buffers);
+		buffer->free = 1;
+		list_add(&buffer->entry,
+			 &alloc->free_slots[binder_slot_class(alloc, buffer)]);
+		return;
+	}
+#endif
+
 	binder_update_page_range(alloc, 0,
 		(void *)PAGE_ALIGN((uintptr_t)buffer->data),
 		(void *)(((uintptr_t)buffer->data + buffer_size) & PAGE_MASK),
@@ -659,6 +782,10 @@ int binder_alloc_mmap_handler(struct binder_alloc *alloc,
 		goto err_alloc_pages_failed;
 	}
 	alloc->buffer_size = vma->vm_end - vma->vm_start;
+	alloc->slot_area = (u8 *)alloc->buffer + alloc->buffer_size;
+#ifdef CONFIG_ANDROID_BINDER_SLOT_ALLOC
+	binder_alloc_init_slots(alloc, vma);
+#endif
 
 	buffer = kzalloc(sizeof(*buffer), GFP_KERNEL);
 	if (!buffer) {
@@ -679,6 +806,14 @@ int binder_alloc_mmap_handler(struct binder_alloc *alloc,
 	return 0;
 
 err_alloc_buf_struct_failed:
+#ifdef CONFIG_ANDROID_BINDER_SLOT_ALLOC
+	if (alloc->slot_buffers) {
+		binder_update_page_range(alloc, 0, alloc->slot_area,
+			(u8 *)alloc->slot_area + BINDER_SLOT_AREA_SIZE, vma);
+		kfree(alloc->slot_buffers);
+		alloc->slot_buffers = NULL;
+	}
+#endif
 	kfree(alloc->pages);
 	alloc->pages = NULL;
 err_alloc_pages_failed:
@@ -724,6 +859,12 @@ void binder_alloc_deferred_release(struct binder_alloc *alloc)
 		kfree(buffer);
 	}
 
+#ifdef CONFIG_ANDROID_BINDER_SLOT_ALLOC
+	/* slot pages are released with the rest of alloc->pages below */
+	kfree(alloc->slot_buffers);
+	alloc->slot_buffers = NULL;
+#endif
+
 	page_count = 0;
 	if (alloc->pages) {
 		int i;
@@ -24,9 +24,24 @@
 
 struct binder_transaction;
 
+#ifdef CONFIG_ANDROID_BINDER_SLOT_ALLOC
+/*
+ * Transactions of up to BINDER_SLOT_MAX_SIZE bytes are served from fixed
+ * size slots in power of two classes starting at BINDER_SLOT_MIN_SIZE,
+ * one pre-mapped page per class at the end of the mmap'd space.
+ */
+#define BINDER_SLOT_MIN_SHIFT	6
+#define BINDER_SLOT_MIN_SIZE	(1U << BINDER_SLOT_MIN_SHIFT)
+#define BINDER_SLOT_CLASSES	3
+#define BINDER_SLOT_MAX_SIZE	(BINDER_SLOT_MIN_SIZE << (BINDER_SLOT_CLASSES - 1))
+#define BINDER_SLOT_CLASS_SIZE	PAGE_SIZE
+#define BINDER_SLOT_AREA_SIZE	(BINDER_SLOT_CLASS_SIZE * BINDER_SLOT_CLASSES)
+#endif
+
 /**
  * struct binder_buffer - buffer used for binder transactions
- * @entry:              entry alloc->buffers
+ * @entry:              entry alloc->buffers, or alloc->free_slots while
+ *                      a free slot
  * @rb_node:            node for allocated_buffers/free_buffers rb trees
  * @free:               true if buffer is free
  * @allow_user_free:    describe the second member of struct blah,
@@ -78,6 +93,12 @@ struct binder_buffer {
  *                      page of mmap'd space
  * @buffer_size:        size of address space specified via mmap
  * @pid:                pid for associated binder_proc (invariant after init)
+ * @slot_area:          start of the slot area, which is also the end of
+ *                      the space managed by @free_buffers; equal to
+ *                      @buffer + @buffer_size when there are no slots
+ *                      (invariant after mmap)
+ * @slot_buffers:       binder_buffer for each slot
+ * @free_slots:         free slots of each size class
  *
  * Bookkeeping structure for per-proc address space management for binder
  * buffers. It is normally initialized during binder_init() and binder_mmap()
@@ -99,6 +120,11 @@ struct binder_alloc {
 	size_t buffer_size;
 	uint32_t buffer_free;
 	int pid;
+	void *slot_area;
+#ifdef CONFIG_ANDROID_BINDER_SLOT_ALLOC
+	struct binder_buffer *slot_buffers;
+	struct list_head free_slots[BINDER_SLOT_CLASSES];
+#endif
 };
 
 #ifdef CONFIG_ANDROID_BINDER_IPC_SELFTEST
@@ -106,6 +132,9 @@ void binder_selftest_alloc(struct binder_alloc *alloc);
 #else
 static inline void binder_selftest_alloc(struct binder_alloc *alloc) {}
 #endif
+#ifdef CONFIG_KBENCH
+struct binder_alloc *binder_alloc_from_file(struct file *filp);
+#endif
 extern struct binder_buffer *binder_alloc_new_buf(struct binder_alloc *alloc,
 						  size_t data_size,
 						  size_t offsets_size,
@@ -125,6 +154,19 @@ extern int binder_alloc_get_allocated_count(struct binder_alloc *alloc);
 extern void binder_alloc_print_allocated(struct seq_file *m,
 					 struct binder_alloc *alloc);
 
+/**
+ * binder_alloc_is_slot() - check if a buffer is a fixed size slot
+ * @alloc:	binder_alloc for this proc
+ * @buffer:	buffer to check
+ *
+ * Return:	true if @buffer lies in the slot area
+ */
+static inline bool binder_alloc_is_slot(struct binder_alloc *alloc,
+					struct binder_buffer *buffer)
+{
+	return buffer->data >= alloc->slot_area;
+}
+
 /**
  * binder_alloc_get_free_async_space() - get free space available for async
  * @alloc:	binder_alloc for this proc
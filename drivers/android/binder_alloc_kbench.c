@@ -0,0 +1,152 @@
+/* binder_alloc_kbench.c
+ *
+ * Android IPC Subsystem
+ *
+ * Copyright (C) 2016 HTC Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * Transaction buffer allocator benchmark. The running task opens and
+ * maps its own binder proc on target (default /dev/binder), keeps n - 1
+ * buffers allocated to fragment the free space, and times allocating
+ * and freeing one more buffer of size bytes, as binder_transaction()
+ * and BC_FREE_BUFFER do. A full transaction needs a second process and
+ * is left to user space benchmarks.
+ */
+
+#define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
+
+#include <linux/err.h>
+#include <linux/fs.h>
+#include <linux/kbench.h>
+#include <linux/mm.h>
+#include <linux/mman.h>
+#include <linux/sched.h>
+#include <linux/sizes.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+#include "binder_alloc.h"
+
+#define BINDER_KBENCH_MAP_SIZE	SZ_1M
+#define BINDER_KBENCH_MAX_HELD	256
+
+struct binder_alloc_kbench {
+	struct file *filp;
+	struct binder_alloc *alloc;
+	unsigned long addr;
+	int is_async;
+	unsigned int nr_held;
+	struct binder_buffer *held[BINDER_KBENCH_MAX_HELD];
+};
+
+static void binder_alloc_kbench_release(struct binder_alloc_kbench *bb)
+{
+	while (bb->nr_held)
+		binder_alloc_free_buf(bb->alloc, bb->held[--bb->nr_held]);
+	if (bb->addr)
+		vm_munmap(bb->addr, BINDER_KBENCH_MAP_SIZE);
+	filp_close(bb->filp, current->files);
+	kfree(bb);
+}
+
+static int binder_alloc_kbench_setup(struct kbench_ctx *ctx)
+{
+	struct binder_alloc_kbench *bb;
+	struct binder_buffer *buffer;
+	unsigned long addr;
+	int ret = 0;
+
+	if (!ctx->n || ctx->n > BINDER_KBENCH_MAX_HELD + 1)
+		return -EINVAL;
+
+	bb = kzalloc(sizeof(*bb), GFP_KERNEL);
+	if (!bb)
+		return -ENOMEM;
+
+	if (!ctx->mode[0] || !strcmp(ctx->mode, "sync")) {
+		bb->is_async = 0;
+	} else if (!strcmp(ctx->mode, "async")) {
+		bb->is_async = 1;
+	} else {
+		kfree(bb);
+		return -EINVAL;
+	}
+
+	bb->filp = filp_open(ctx->target[0] ? ctx->target : "/dev/binder",
+			     O_RDWR, 0);
+	if (IS_ERR(bb->filp)) {
+		ret = PTR_ERR(bb->filp);
+		kfree(bb);
+		return ret;
+	}
+
+	bb->alloc = binder_alloc_from_file(bb->filp);
+	if (!bb->alloc) {
+		ret = -ENODEV;
+		goto err;
+	}
+
+	addr = vm_mmap(bb->filp, 0, BINDER_KBENCH_MAP_SIZE, PROT_READ,
+		       MAP_PRIVATE, 0);
+	if (IS_ERR_VALUE(addr)) {
+		ret = (int)addr;
+		goto err;
+	}
+	bb->addr = addr;
+
+	while (bb->nr_held < ctx->n - 1) {
+		buffer = binder_alloc_new_buf(bb->alloc, ctx->size, 0, 0,
+					      bb->is_async);
+		if (IS_ERR_OR_NULL(buffer)) {
+			ret = buffer ? PTR_ERR(buffer) : -ENOMEM;
+			goto err;
+		}
+		bb->held[bb->nr_held++] = buffer;
+	}
+
+	ctx->bytes = ctx->size;
+	ctx->priv = bb;
+	return 0;
+err:
+	binder_alloc_kbench_release(bb);
+	return ret;
+}
+
+static int binder_alloc_kbench_op(struct kbench_ctx *ctx, unsigned int i)
+{
+	struct binder_alloc_kbench *bb = ctx->priv;
+	struct binder_buffer *buffer;
+
+	buffer = binder_alloc_new_buf(bb->alloc, ctx->size, 0, 0,
+				      bb->is_async);
+	if (IS_ERR_OR_NULL(buffer))
+		return buffer ? PTR_ERR(buffer) : -ENOMEM;
+	binder_alloc_free_buf(bb->alloc, buffer);
+	return 0;
+}
+
+static void binder_alloc_kbench_teardown(struct kbench_ctx *ctx)
+{
+	binder_alloc_kbench_release(ctx->priv);
+}
+
+static struct kbench binder_alloc_kbench = {
+	.name		= "binder",
+	.help		= "mode=sync|async target=device size=bytes n=live buffers",
+	.setup		= binder_alloc_kbench_setup,
+	.op		= binder_alloc_kbench_op,
+	.teardown	= binder_alloc_kbench_teardown,
+};
+
+static int __init binder_alloc_kbench_init(void)
+{
+	return kbench_register(&binder_alloc_kbench);
+}
+late_initcall(binder_alloc_kbench_init);
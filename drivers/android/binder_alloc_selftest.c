@@ -19,6 +19,7 @@
 
 #include <linux/mm_types.h>
 #include <linux/err.h>
+#include <linux/ktime.h>
 #include "binder_alloc.h"
 
 #define BUFFER_NUM 5
@@ -145,7 +146,11 @@ static void binder_selftest_free_buf(struct binder_alloc *alloc,
 		binder_alloc_free_buf(alloc, buffers[seq[i]]);
 
 	for (i = 0; i < (alloc->buffer_size / PAGE_SIZE); i++) {
-		if ((!alloc->pages[i]) == (i == 0)) {
+		/* pages of the slot area are mapped for the proc lifetime */
+		bool mapped = i == 0 ||
+			alloc->buffer + i * PAGE_SIZE >= alloc->slot_area;
+
+		if (!alloc->pages[i] == mapped) {
 			pr_err("incorrect free state at page index %d\n", i);
 			binder_selftest_failures++;
 		}
@@ -210,7 +215,8 @@ static void binder_selftest_alloc_size(struct binder_alloc *alloc,
 	 * Only BUFFER_NUM - 1 buffer sizes are adjustable since
 	 * we need one giant buffer before getting to the last page.
 	 */
-	back_sizes[0] += alloc->buffer_size - end_offset[BUFFER_NUM - 1];
+	back_sizes[0] += (alloc->slot_area - alloc->buffer) -
+		end_offset[BUFFER_NUM - 1];
 	binder_selftest_free_seq(alloc, front_sizes, seq, 0);
 	binder_selftest_free_seq(alloc, back_sizes, seq, 0);
 }
@@ -240,6 +246,93 @@ static void binder_selftest_alloc_offset(struct binder_alloc *alloc,
 	}
 }
 
+#ifdef CONFIG_ANDROID_BINDER_SLOT_ALLOC
+#define SLOT_LATENCY_ROUNDS 1000
+
+/* time an alloc and free pair of @size bytes, in ns */
+static u64 binder_selftest_latency(struct binder_alloc *alloc, size_t size)
+{
+	struct binder_buffer *buffer;
+	ktime_t start;
+	int i;
+
+	start = ktime_get();
+	for (i = 0; i < SLOT_LATENCY_ROUNDS; i++) {
+		buffer = binder_alloc_new_buf(alloc, size, 0, 0, 0);
+		if (IS_ERR(buffer)) {
+			pr_err("latency alloc of size %zu failed\n", size);
+			binder_selftest_failures++;
+			return 0;
+		}
+		binder_alloc_free_buf(alloc, buffer);
+	}
+	return ktime_to_ns(ktime_sub(ktime_get(), start)) /
+		SLOT_LATENCY_ROUNDS;
+}
+
+/**
+ * binder_selftest_slots() - Test the fixed size slot path.
+ * @alloc: Pointer to alloc struct.
+ *
+ * Exhaust the slots of each size class, check that every buffer comes from
+ * the slot area of its class and that one more allocation falls back to
+ * the rbtree, then free everything. Finally compare the per transaction
+ * latency of the slot and of the rbtree path.
+ */
+static void binder_selftest_slots(struct binder_alloc *alloc)
+{
+	struct binder_buffer *buffers[BINDER_SLOT_CLASS_SIZE /
+				      BINDER_SLOT_MIN_SIZE];
+	struct binder_buffer *extra;
+	int class, i, nr;
+
+	if (!alloc->slot_buffers) {
+		pr_info("no slots, mmap'd space too small\n");
+		return;
+	}
+
+	for (class = 0; class < BINDER_SLOT_CLASSES; class++) {
+		size_t size = BINDER_SLOT_MIN_SIZE << class;
+		void *start = alloc->slot_area +
+			class * BINDER_SLOT_CLASS_SIZE;
+
+		nr = BINDER_SLOT_CLASS_SIZE / size;
+		for (i = 0; i < nr; i++) {
+			buffers[i] = binder_alloc_new_buf(alloc, size, 0, 0, 0);
+			if (IS_ERR(buffers[i]) || buffers[i]->data < start ||
+			    buffers[i]->data >= start + BINDER_SLOT_CLASS_SIZE) {
+				pr_err("slot %d of class %d: bad buffer\n",
+				       i, class);
+				binder_selftest_failures++;
+				nr = i;
+				break;
+			}
+		}
+
+		/* smaller classes are full, so this must come from the rbtree */
+		extra = binder_alloc_new_buf(alloc, size, 0, 0, 0);
+		if (class == BINDER_SLOT_CLASSES - 1 &&
+		    (IS_ERR(extra) || binder_alloc_is_slot(alloc, extra))) {
+			pr_err("no rbtree fallback for size %zu\n", size);
+			binder_selftest_failures++;
+		}
+		if (!IS_ERR(extra))
+			binder_alloc_free_buf(alloc, extra);
+
+		for (i = 0; i < nr; i++)
+			binder_alloc_free_buf(alloc, buffers[i]);
+	}
+
+	pr_info("alloc+free latency: slot %llu ns, rbtree %llu ns\n",
+		binder_selftest_latency(alloc, BINDER_SLOT_MAX_SIZE),
+		binder_selftest_latency(alloc, BINDER_SLOT_MAX_SIZE + 1));
+}
+#else
+static inline void binder_selftest_slots(struct binder_alloc *alloc)
+{
+}
+#endif
+
 /**
  * binder_selftest_alloc() - Test alloc and free of buffer pages.
  * @alloc: Pointer to alloc struct.
@@ -259,6 +352,7 @@ void binder_selftest_alloc(struct binder_alloc *alloc)
 		goto done;
 	pr_info("STARTED\n");
 	binder_selftest_alloc_offset(alloc, end_offset, 0);
+	binder_selftest_slots(alloc);
 	binder_selftest_run = false;
 	if (binder_selftest_failures > 0)
 		pr_info("%d tests FAILED\n", binder_selftest_failures);
@@ -23,8 +23,10 @@
 #include <linux/kthread.h>
 #include <linux/wait.h>
 #include <linux/async.h>
+#include <linux/of.h>
 #include <linux/pm_runtime.h>
 #include <linux/pinctrl/devinfo.h>
+#include <linux/boot_profile.h>
 
 #include "base.h"
 #include "power/power.h"
@@ -171,8 +173,16 @@ static void driver_deferred_probe_trigger(void)
 	queue_work(deferred_wq, &deferred_probe_work);
 }
 
+/* asynchronous probes; waited for by async_synchronize_full() as well */
+static ASYNC_DOMAIN(async_probe_domain);
+
 static void enable_trigger_defer_cycle(void)
 {
+	/*
+	 * Let the asynchronous probes started at this initcall level finish
+	 * first, so that deferred devices see the resources they provide.
+	 */
+	async_synchronize_full_domain(&async_probe_domain);
 	driver_deferred_probe_enable = true;
 	driver_deferred_probe_trigger();
 	/*
@@ -302,7 +312,9 @@ static int really_probe(struct device *dev, struct device_driver *drv)
 {
 	int ret = 0;
 	int local_trigger_count = atomic_read(&deferred_trigger_count);
+	struct boot_profile_mark bp;
 
+	boot_profile_begin(&bp);
 	atomic_inc(&probe_count);
 	pr_debug("bus: '%s': %s: probing driver %s with device %s\n",
 		 drv->bus->name, __func__, drv->name, dev_name(dev));
@@ -332,12 +344,14 @@ static int really_probe(struct device *dev, struct device_driver *drv)
 	}
 
 	driver_bound(dev);
+	boot_profile_probe_end(&bp, dev, drv, 0);
 	ret = 1;
 	pr_debug("bus: '%s': %s: bound device %s to driver %s\n",
 		 drv->bus->name, __func__, dev_name(dev), drv->name);
 	goto done;
 
 probe_failed:
+	boot_profile_probe_end(&bp, dev, drv, ret);
 	devres_release_all(dev);
 	driver_sysfs_remove(dev);
 	dev->driver = NULL;
@@ -491,6 +505,45 @@ out_unlock:
 }
 EXPORT_SYMBOL_GPL(device_attach);
 
+static bool driver_allows_async_probing(struct device_driver *drv,
+					struct device *dev)
+{
+	switch (drv->probe_type) {
+	case PROBE_PREFER_ASYNCHRONOUS:
+		return true;
+
+	case PROBE_FORCE_SYNCHRONOUS:
+		return false;
+
+	default:
+		return dev->of_node &&
+			of_property_read_bool(dev->of_node, "linux,async-probe");
+	}
+}
+
+static void __driver_attach_async_helper(void *_dev, async_cookie_t cookie)
+{
+	struct device *dev = _dev;
+	struct device_driver *drv;
+
+	if (dev->parent)	/* Needed for USB */
+		device_lock(dev->parent);
+	device_lock(dev);
+	drv = dev->p->async_driver;
+	dev->p->async_driver = NULL;
+	/*
+	 * Someone may have bound a driver, or the device may have gone
+	 * away, while we were waiting to run.
+	 */
+	if (drv && !dev->driver)
+		driver_probe_device(drv, dev);
+	device_unlock(dev);
+	if (dev->parent)
+		device_unlock(dev->parent);
+
+	put_device(dev);
+}
+
 static int __driver_attach(struct device *dev, void *data)
 {
 	struct device_driver *drv = data;
@@ -508,6 +561,25 @@ static int __driver_attach(struct device *dev, void *data)
 	if (!driver_match_device(drv, dev))
 		return 0;
 
+	if (driver_allows_async_probing(drv, dev)) {
+		/*
+		 * Probe the device from the async probe domain instead, so
+		 * that registration of other drivers can go on meanwhile.
+		 * Only take the device lock here to make the check of
+		 * dev->driver and the update of async_driver atomic.
+		 */
+		dev_dbg(dev, "probing driver %s asynchronously\n", drv->name);
+		device_lock(dev);
+		if (!dev->driver && !dev->p->async_driver) {
+			get_device(dev);
+			dev->p->async_driver = drv;
+			async_schedule_domain(__driver_attach_async_helper, dev,
+					      &async_probe_domain);
+		}
+		device_unlock(dev);
+		return 0;
+	}
+
 	if (dev->parent)	/* Needed for USB */
 		device_lock(dev->parent);
 	device_lock(dev);
@@ -601,6 +673,9 @@ void driver_detach(struct device_driver *drv)
 	struct device_private *dev_prv;
 	struct device *dev;
 
+	/* don't race with probes of this driver still queued */
+	async_synchronize_full_domain(&async_probe_domain);
+
 	for (;;) {
 		spin_lock(&drv->p->klist_devices.k_lock);
 		if (list_empty(&drv->p->klist_devices.k_list)) {
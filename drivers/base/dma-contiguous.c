@@ -37,6 +37,7 @@
 #include <linux/slab.h>
 #include <linux/swap.h>
 #include <linux/mm_types.h>
+#include <linux/ktime.h>
 #include <linux/dma-contiguous.h>
 #include <linux/dma-removed.h>
 #include <linux/delay.h>
@@ -597,6 +598,7 @@ unsigned long dma_alloc_from_contiguous(struct device *dev, size_t count,
 	int ret = 0;
 	int tries = 0;
 	int retry_after_sleep = 0;
+	ktime_t start_time;
 
 	if (!cma || !cma->count)
 		return 0;
@@ -614,7 +616,7 @@ unsigned long dma_alloc_from_contiguous(struct device *dev, size_t count,
 		return 0;
 
 	mask = (1 << align) - 1;
-
+	start_time = ktime_get();
 
 	for (;;) {
 		mutex_lock(&cma->lock);
@@ -672,6 +674,8 @@ unsigned long dma_alloc_from_contiguous(struct device *dev, size_t count,
 		start = pageno + mask + 1;
 	}
 
+	trace_dma_alloc_contiguous(pfn, count, align, tries,
+			ktime_us_delta(ktime_get(), start_time));
 	pr_debug("%s(): returned %lx\n", __func__, pfn);
 	return pfn;
 }
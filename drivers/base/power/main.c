@@ -31,6 +31,7 @@
 #include <linux/cpuidle.h>
 #include <linux/timer.h>
 #include <linux/wakeup_reason.h>
+#include <linux/of.h>
 
 #include "../base.h"
 #include "power.h"
@@ -205,17 +206,59 @@ static void initcall_debug_report(struct device *dev, ktime_t calltime,
 	}
 }
 
+/*
+ * Devices are handled asynchronously if their drivers asked for it, or if
+ * they were found to be independent leaves in device_prepare().
+ */
+static bool dpm_async(struct device *dev)
+{
+	return dev->power.async_suspend || dev->power.async_leaf;
+}
+
+static int dpm_has_child_fn(struct device *dev, void *data)
+{
+	return 1;
+}
+
+/*
+ * The PM core only orders a device against its parent and children. A
+ * device with no children and no DT supply phandles has no other
+ * dependency the core knows of, so it can go async without its driver
+ * opting in.
+ */
+static bool dpm_leaf_async(struct device *dev)
+{
+	struct property *pp;
+	size_t len;
+
+	if (!pm_async_leaf_enabled)
+		return false;
+
+	if (device_for_each_child(dev, NULL, dpm_has_child_fn))
+		return false;
+
+	if (dev->of_node) {
+		for_each_property_of_node(dev->of_node, pp) {
+			len = strlen(pp->name);
+			if (len > 7 && !strcmp(pp->name + len - 7, "-supply"))
+				return false;
+		}
+	}
+
+	return true;
+}
+
 /**
  * dpm_wait - Wait for a PM operation to complete.
  * @dev: Device to wait for.
- * @async: If unset, wait only if the device's power.async_suspend flag is set.
+ * @async: If unset, wait only if the device is handled asynchronously.
  */
 static void dpm_wait(struct device *dev, bool async)
 {
 	if (!dev)
 		return;
 
-	if (async || (pm_async_enabled && dev->power.async_suspend))
+	if (async || (pm_async_enabled && dpm_async(dev)))
 		wait_for_completion(&dev->power.completion);
 }
 
@@ -388,18 +431,20 @@ static void dpm_show_time(ktime_t starttime, pm_message_t state, char *info)
 static int dpm_run_callback(pm_callback_t cb, struct device *dev,
 			    pm_message_t state, char *info)
 {
-	ktime_t calltime;
+	ktime_t calltime, start;
 	int error;
 
 	if (!cb)
 		return 0;
 
 	calltime = initcall_debug_start(dev);
+	start = ktime_get();
 
 	pm_dev_dbg(dev, state, info);
 	error = cb(dev);
 	suspend_report_result(cb, error);
 
+	suspend_time_dev_record(dev, state, ktime_us_delta(ktime_get(), start));
 	initcall_debug_report(dev, calltime, error);
 
 	return error;
@@ -732,7 +777,7 @@ static void async_resume(void *data, async_cookie_t cookie)
 
 static bool is_async(struct device *dev)
 {
-	return dev->power.async_suspend && pm_async_enabled
+	return dpm_async(dev) && pm_async_enabled
 		&& !pm_trace_is_enabled();
 }
 
@@ -1121,13 +1166,15 @@ static int legacy_suspend(struct device *dev, pm_message_t state,
 			  int (*cb)(struct device *dev, pm_message_t state))
 {
 	int error;
-	ktime_t calltime;
+	ktime_t calltime, start;
 
 	calltime = initcall_debug_start(dev);
+	start = ktime_get();
 
 	error = cb(dev, state);
 	suspend_report_result(cb, error);
 
+	suspend_time_dev_record(dev, state, ktime_us_delta(ktime_get(), start));
 	initcall_debug_report(dev, calltime, error);
 
 	return error;
@@ -1257,7 +1304,7 @@ static int device_suspend(struct device *dev)
 {
 	INIT_COMPLETION(dev->power.completion);
 
-	if (pm_async_enabled && dev->power.async_suspend) {
+	if (pm_async_enabled && dpm_async(dev)) {
 		get_device(dev);
 		async_schedule(async_suspend, dev);
 		return 0;
@@ -1341,6 +1388,7 @@ static int device_prepare(struct device *dev, pm_message_t state)
 	device_lock(dev);
 
 	dev->power.wakeup_path = device_may_wakeup(dev);
+	dev->power.async_leaf = dpm_leaf_async(dev);
 
 	if (dev->pm_domain) {
 		info = "preparing power domain ";
@@ -1383,6 +1431,8 @@ int dpm_prepare(pm_message_t state)
 
 	might_sleep();
 
+	suspend_time_dev_new_cycle();
+
 	mutex_lock(&dpm_list_mtx);
 	while (!list_empty(&dpm_list)) {
 		struct device *dev = to_device(dpm_list.next);
@@ -1449,7 +1499,7 @@ EXPORT_SYMBOL_GPL(__suspend_report_result);
  */
 int device_pm_wait_for_dev(struct device *subordinate, struct device *dev)
 {
-	dpm_wait(dev, subordinate->power.async_suspend);
+	dpm_wait(dev, dpm_async(subordinate));
 	return async_error;
 }
 EXPORT_SYMBOL_GPL(device_pm_wait_for_dev);
@@ -15,6 +15,7 @@
 #include <linux/seq_file.h>
 #include <linux/debugfs.h>
 #include <linux/types.h>
+#include <linux/moduleparam.h>
 #include <trace/events/power.h>
 
 #include "power.h"
@@ -58,6 +59,27 @@ static LIST_HEAD(wakeup_sources);
 
 static DECLARE_WAIT_QUEUE_HEAD(wakeup_count_wait_queue);
 
+/*
+ * Wakeup cost attribution.  The first wakeup source activated after the
+ * system comes out of suspend is taken to be the one that woke it up and is
+ * charged with the time spent awake until the next suspend attempt.
+ */
+static DEFINE_SPINLOCK(attrib_lock);
+static struct wakeup_source *attrib_ws;
+static bool attrib_armed;
+static ktime_t attrib_start;
+
+/*
+ * Kernel wakeup sources reporting more than ratelimit_budget events per
+ * minute get their processing time capped at ratelimit_hold_ms, so that a
+ * chatty source cannot keep the system out of suspend.  0 disables it.
+ */
+static unsigned int wakeup_ratelimit_budget;
+module_param_named(ratelimit_budget, wakeup_ratelimit_budget, uint, 0644);
+
+static unsigned int wakeup_ratelimit_hold_ms = 100;
+module_param_named(ratelimit_hold_ms, wakeup_ratelimit_hold_ms, uint, 0644);
+
 static ktime_t last_read_time;
 
 /**
@@ -159,6 +181,16 @@ void wakeup_source_add(struct wakeup_source *ws)
 }
 EXPORT_SYMBOL_GPL(wakeup_source_add);
 
+static void wakeup_source_attrib_forget(struct wakeup_source *ws)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&attrib_lock, flags);
+	if (attrib_ws == ws)
+		attrib_ws = NULL;
+	spin_unlock_irqrestore(&attrib_lock, flags);
+}
+
 /**
  * wakeup_source_remove - Remove given object from the wakeup sources list.
  * @ws: Wakeup source object to remove from the list.
@@ -173,6 +205,7 @@ void wakeup_source_remove(struct wakeup_source *ws)
 	spin_lock_irqsave(&events_lock, flags);
 	list_del_rcu(&ws->entry);
 	spin_unlock_irqrestore(&events_lock, flags);
+	wakeup_source_attrib_forget(ws);
 	synchronize_rcu();
 }
 EXPORT_SYMBOL_GPL(wakeup_source_remove);
@@ -195,6 +228,7 @@ static void wakeup_source_remove_async(struct wakeup_source *ws)
 	spin_lock_irqsave(&events_lock, flags);
 	list_del_rcu(&ws->entry);
 	spin_unlock_irqrestore(&events_lock, flags);
+	wakeup_source_attrib_forget(ws);
 }
 
 /**
@@ -448,6 +482,16 @@ static void wakeup_source_activate(struct wakeup_source *ws)
 	if (ws->autosleep_enabled)
 		ws->start_prevent_time = ws->last_time;
 
+	if (unlikely(attrib_armed)) {
+		spin_lock(&attrib_lock);
+		if (attrib_armed) {
+			attrib_armed = false;
+			attrib_ws = ws;
+			ws->irq_wakeup_count++;
+		}
+		spin_unlock(&attrib_lock);
+	}
+
 	/* Increment the counter of events in progress. */
 	cec = atomic_inc_return(&combined_event_count);
 
@@ -469,6 +513,44 @@ static void wakeup_source_report_event(struct wakeup_source *ws)
 		wakeup_source_activate(ws);
 }
 
+/**
+ * pm_wakeup_attrib_start - Start charging the wakeup that resumed the system.
+ *
+ * Called with interrupts off once the platform has come out of suspend.  The
+ * next wakeup source to be activated is charged with this wakeup.
+ */
+void pm_wakeup_attrib_start(void)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&attrib_lock, flags);
+	attrib_ws = NULL;
+	attrib_armed = true;
+	attrib_start = ktime_get();
+	spin_unlock_irqrestore(&attrib_lock, flags);
+}
+
+/**
+ * pm_wakeup_attrib_stop - Charge the time spent awake since the last resume.
+ *
+ * Called when the next suspend attempt starts.
+ */
+void pm_wakeup_attrib_stop(void)
+{
+	unsigned long flags;
+	ktime_t delta;
+
+	spin_lock_irqsave(&attrib_lock, flags);
+	if (attrib_ws) {
+		delta = ktime_sub(ktime_get(), attrib_start);
+		attrib_ws->wakeup_awake_time =
+			ktime_add(attrib_ws->wakeup_awake_time, delta);
+	}
+	attrib_ws = NULL;
+	attrib_armed = false;
+	spin_unlock_irqrestore(&attrib_lock, flags);
+}
+
 /**
  * __pm_stay_awake - Notify the PM core of a wakeup event.
  * @ws: Wakeup source object associated with the source of the event.
@@ -661,6 +743,25 @@ static void pm_wakeup_timer_fn(unsigned long data)
  *
  * It is safe to call this function from interrupt context.
  */
+static bool wakeup_source_ratelimited(struct wakeup_source *ws)
+{
+	unsigned int budget = wakeup_ratelimit_budget;
+
+	if (!budget || ws->userspace)
+		return false;
+
+	if (time_after(jiffies, ws->ratelimit_start + 60 * HZ)) {
+		ws->ratelimit_start = jiffies;
+		ws->ratelimit_events = 0;
+	}
+
+	if (++ws->ratelimit_events <= budget)
+		return false;
+
+	ws->ratelimited_count++;
+	return true;
+}
+
 void __pm_wakeup_event(struct wakeup_source *ws, unsigned int msec)
 {
 	unsigned long flags;
@@ -673,6 +774,9 @@ void __pm_wakeup_event(struct wakeup_source *ws, unsigned int msec)
 
 	wakeup_source_report_event(ws);
 
+	if (wakeup_source_ratelimited(ws))
+		msec = min(msec, wakeup_ratelimit_hold_ms);
+
 	if (!msec) {
 		wakeup_source_deactivate(ws);
 		goto unlock;
@@ -744,6 +848,10 @@ void pm_get_active_wakeup_sources(char *pending_wakeup_source, size_t max)
 }
 EXPORT_SYMBOL_GPL(pm_get_active_wakeup_sources);
 
+/*
+ * Also charges the suspend abort to the active wakeup sources or, if there are
+ * none, to the one that was active last.
+ */
 static void print_active_wakeup_sources(void)
 {
 	struct wakeup_source *ws;
@@ -754,6 +862,8 @@ static void print_active_wakeup_sources(void)
 	list_for_each_entry_rcu(ws, &wakeup_sources, entry) {
 		if (ws->active) {
 			pr_info("active wakeup source: %s\n", ws->name);
+			/* This is racy, but the counter is approximate anyway. */
+			ws->abort_count++;
 			active = 1;
 		} else if (!active &&
 			   (!last_activity_ws ||
@@ -763,9 +873,11 @@ static void print_active_wakeup_sources(void)
 		}
 	}
 
-	if (!active && last_activity_ws)
+	if (!active && last_activity_ws) {
 		pr_info("last active wakeup source: %s\n",
 			last_activity_ws->name);
+		last_activity_ws->abort_count++;
+	}
 	rcu_read_unlock();
 }
 
@@ -1028,10 +1140,53 @@ static const struct file_operations wakeup_sources_stats_fops = {
 	.release = single_release,
 };
 
+/**
+ * wakeup_sources_cost_show - Print per wakeup source cost information.
+ * @m: seq_file to print the statistics into.
+ */
+static int wakeup_sources_cost_show(struct seq_file *m, void *unused)
+{
+	struct wakeup_source *ws;
+	unsigned long flags;
+	ktime_t awake_time;
+
+	seq_puts(m, "name\t\tabort_count\tirq_wakeup_count\t"
+		"wakeup_awake_time\tratelimited_count\n");
+
+	rcu_read_lock();
+	list_for_each_entry_rcu(ws, &wakeup_sources, entry) {
+		spin_lock_irqsave(&attrib_lock, flags);
+		awake_time = ws->wakeup_awake_time;
+		spin_unlock_irqrestore(&attrib_lock, flags);
+
+		seq_printf(m, "%-12s\t%lu\t\t%lu\t\t\t%lld\t\t\t%lu\n",
+			   ws->name, ws->abort_count, ws->irq_wakeup_count,
+			   ktime_to_ms(awake_time), ws->ratelimited_count);
+	}
+	rcu_read_unlock();
+
+	return 0;
+}
+
+static int wakeup_sources_cost_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, wakeup_sources_cost_show, NULL);
+}
+
+static const struct file_operations wakeup_sources_cost_fops = {
+	.owner = THIS_MODULE,
+	.open = wakeup_sources_cost_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
 static int __init wakeup_sources_debugfs_init(void)
 {
 	wakeup_sources_stats_dentry = debugfs_create_file("wakeup_sources",
 			S_IRUGO, NULL, NULL, &wakeup_sources_stats_fops);
+	debugfs_create_file("wakeup_sources_cost", S_IRUGO, NULL, NULL,
+			&wakeup_sources_cost_fops);
 	return 0;
 }
 
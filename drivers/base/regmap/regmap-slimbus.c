@@ -0,0 +1,177 @@
+/*
+ * Register map access API - SLIMbus support
+ *
+ * Copyright (C) 2016 HTC Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <linux/regmap.h>
+#include <linux/slimbus/slimbus.h>
+#include <linux/module.h>
+#include <linux/init.h>
+
+/*
+ * Registers are mapped 1:1 onto the value element map of the device,
+ * with 16 bit big endian register addresses and 8 bit values. Raw
+ * writes are cut into the value element sizes the bus allows and sent
+ * as one batch.
+ */
+#define SLIM_VE_MAX_BYTES	16
+#define SLIM_VE_MAX_ADDR	0xC00
+#define SLIM_BULK_MSGS		16
+
+static const u8 slim_ve_sizes[] = { 16, 12, 8, 6, 4, 3, 2, 1 };
+
+static u8 regmap_slimbus_chunk(size_t len)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(slim_ve_sizes); i++)
+		if (slim_ve_sizes[i] <= len)
+			break;
+	return slim_ve_sizes[i];
+}
+
+static int regmap_slimbus_gather_write(void *context,
+				       const void *reg, size_t reg_size,
+				       const void *val, size_t val_size)
+{
+	struct slim_device *sb = context;
+	struct slim_val_inf msgs[SLIM_BULK_MSGS];
+	const u8 *buf = val;
+	unsigned int addr;
+	int n = 0, ret;
+
+	if (reg_size != 2)
+		return -EINVAL;
+	addr = ((const u8 *)reg)[0] << 8 | ((const u8 *)reg)[1];
+	if (addr + val_size > SLIM_VE_MAX_ADDR)
+		return -EINVAL;
+
+	while (val_size) {
+		u8 len = regmap_slimbus_chunk(val_size);
+
+		msgs[n].start_offset = addr;
+		msgs[n].num_bytes = len;
+		msgs[n].wbuf = buf;
+		addr += len;
+		buf += len;
+		val_size -= len;
+
+		if (++n == SLIM_BULK_MSGS || !val_size) {
+			ret = slim_bulk_change_val_element(sb, msgs, n);
+			if (ret)
+				return ret;
+			n = 0;
+		}
+	}
+
+	return 0;
+}
+
+static int regmap_slimbus_write(void *context, const void *data, size_t count)
+{
+	if (count < 2)
+		return -EINVAL;
+
+	return regmap_slimbus_gather_write(context, data, 2,
+					   (const u8 *)data + 2, count - 2);
+}
+
+static int regmap_slimbus_read(void *context,
+			       const void *reg, size_t reg_size,
+			       void *val, size_t val_size)
+{
+	struct slim_device *sb = context;
+	struct slim_ele_access msg = { 0 };
+	u8 *buf = val;
+	unsigned int addr;
+	int ret;
+
+	if (reg_size != 2)
+		return -EINVAL;
+	addr = ((const u8 *)reg)[0] << 8 | ((const u8 *)reg)[1];
+	if (addr + val_size > SLIM_VE_MAX_ADDR)
+		return -EINVAL;
+
+	while (val_size) {
+		msg.start_offset = addr;
+		msg.num_bytes = regmap_slimbus_chunk(val_size);
+		ret = slim_request_val_element(sb, &msg, buf, msg.num_bytes);
+		if (ret)
+			return ret;
+		addr += msg.num_bytes;
+		buf += msg.num_bytes;
+		val_size -= msg.num_bytes;
+	}
+
+	return 0;
+}
+
+static struct regmap_bus regmap_slimbus = {
+	.write = regmap_slimbus_write,
+	.gather_write = regmap_slimbus_gather_write,
+	.read = regmap_slimbus_read,
+	.reg_format_endian_default = REGMAP_ENDIAN_BIG,
+	.val_format_endian_default = REGMAP_ENDIAN_BIG,
+};
+
+static int regmap_slimbus_check(const struct regmap_config *config)
+{
+	if (config->reg_bits != 16 || config->val_bits != 8 ||
+	    config->pad_bits)
+		return -EINVAL;
+	return 0;
+}
+
+/**
+ * regmap_init_slimbus(): Initialise register map
+ *
+ * @slimbus: Device that will be interacted with
+ * @config: Configuration for register map, 16 bit registers, 8 bit values
+ *
+ * The return value will be an ERR_PTR() on error or a valid pointer to
+ * a struct regmap.
+ */
+struct regmap *regmap_init_slimbus(struct slim_device *slimbus,
+				   const struct regmap_config *config)
+{
+	int ret = regmap_slimbus_check(config);
+
+	if (ret)
+		return ERR_PTR(ret);
+	return regmap_init(&slimbus->dev, &regmap_slimbus, slimbus, config);
+}
+EXPORT_SYMBOL_GPL(regmap_init_slimbus);
+
+/**
+ * devm_regmap_init_slimbus(): Initialise managed register map
+ *
+ * @slimbus: Device that will be interacted with
+ * @config: Configuration for register map, 16 bit registers, 8 bit values
+ *
+ * The return value will be an ERR_PTR() on error or a valid pointer
+ * to a struct regmap.  The regmap will be automatically freed by the
+ * device management code.
+ */
+struct regmap *devm_regmap_init_slimbus(struct slim_device *slimbus,
+					const struct regmap_config *config)
+{
+	int ret = regmap_slimbus_check(config);
+
+	if (ret)
+		return ERR_PTR(ret);
+	return devm_regmap_init(&slimbus->dev, &regmap_slimbus, slimbus,
+				config);
+}
+EXPORT_SYMBOL_GPL(devm_regmap_init_slimbus);
+
+MODULE_LICENSE("GPL v2");
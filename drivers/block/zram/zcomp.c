@@ -13,6 +13,8 @@
 #include <linux/slab.h>
 #include <linux/wait.h>
 #include <linux/sched.h>
+#include <linux/percpu.h>
+#include <linux/cpumask.h>
 
 #include "zcomp.h"
 #include "zcomp_lzo.h"
@@ -43,10 +45,20 @@ struct zcomp_strm_multi {
 	wait_queue_head_t strm_wait;
 };
 
+/*
+ * per-cpu zcomp_strm backend
+ */
+struct zcomp_strm_percpu {
+	struct zcomp_strm * __percpu *strm;
+};
+
 static struct zcomp_backend *backends[] = {
 	&zcomp_lzo,
 #ifdef CONFIG_ZRAM_LZ4_COMPRESS
 	&zcomp_lz4,
+#endif
+#ifdef CONFIG_ZRAM_MULTI_COMP
+	&zcomp_lz4hc,
 #endif
 	NULL
 };
@@ -226,6 +238,83 @@ static int zcomp_strm_multi_create(struct zcomp *comp, int max_strm)
 	return 0;
 }
 
+/*
+ * return this CPU's stream with preemption disabled, so the caller must
+ * not sleep until zcomp_strm_release(). No lock is taken.
+ */
+static struct zcomp_strm *zcomp_strm_percpu_find(struct zcomp *comp)
+{
+	struct zcomp_strm_percpu *zs = comp->stream;
+
+	return *get_cpu_ptr(zs->strm);
+}
+
+static void zcomp_strm_percpu_release(struct zcomp *comp,
+		struct zcomp_strm *zstrm)
+{
+	struct zcomp_strm_percpu *zs = comp->stream;
+
+	put_cpu_ptr(zs->strm);
+}
+
+static bool zcomp_strm_percpu_set_max_streams(struct zcomp *comp,
+		int num_strm)
+{
+	/* there is always exactly one stream per CPU */
+	return true;
+}
+
+static void zcomp_strm_percpu_destroy(struct zcomp *comp)
+{
+	struct zcomp_strm_percpu *zs = comp->stream;
+	struct zcomp_strm *zstrm;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		zstrm = *per_cpu_ptr(zs->strm, cpu);
+		if (zstrm)
+			zcomp_strm_free(comp, zstrm);
+	}
+	free_percpu(zs->strm);
+	kfree(zs);
+}
+
+/*
+ * streams are allocated for every possible CPU up front, so CPU hotplug
+ * never has to allocate memory in the swapout path.
+ */
+static int zcomp_strm_percpu_create(struct zcomp *comp)
+{
+	struct zcomp_strm_percpu *zs;
+	struct zcomp_strm *zstrm;
+	int cpu;
+
+	comp->destroy = zcomp_strm_percpu_destroy;
+	comp->strm_find = zcomp_strm_percpu_find;
+	comp->strm_release = zcomp_strm_percpu_release;
+	comp->set_max_streams = zcomp_strm_percpu_set_max_streams;
+	zs = kmalloc(sizeof(struct zcomp_strm_percpu), GFP_KERNEL);
+	if (!zs)
+		return -ENOMEM;
+
+	comp->stream = zs;
+	zs->strm = alloc_percpu(struct zcomp_strm *);
+	if (!zs->strm) {
+		kfree(zs);
+		return -ENOMEM;
+	}
+
+	for_each_possible_cpu(cpu) {
+		zstrm = zcomp_strm_alloc(comp, GFP_KERNEL);
+		if (!zstrm) {
+			zcomp_strm_percpu_destroy(comp);
+			return -ENOMEM;
+		}
+		*per_cpu_ptr(zs->strm, cpu) = zstrm;
+	}
+	return 0;
+}
+
 static struct zcomp_strm *zcomp_strm_single_find(struct zcomp *comp)
 {
 	struct zcomp_strm_single *zs = comp->stream;
@@ -339,9 +428,10 @@ void zcomp_destroy(struct zcomp *comp)
  * backend pointer or ERR_PTR if things went bad. ERR_PTR(-EINVAL)
  * if requested algorithm is not supported, ERR_PTR(-ENOMEM) in
  * case of allocation error, or any other error potentially
- * returned by functions zcomp_strm_{multi,single}_create.
+ * returned by functions zcomp_strm_{percpu,multi,single}_create.
  */
-struct zcomp *zcomp_create(const char *compress, int max_strm)
+static struct zcomp *__zcomp_create(const char *compress, int max_strm,
+		bool percpu)
 {
 	struct zcomp *comp;
 	struct zcomp_backend *backend;
@@ -356,7 +446,9 @@ struct zcomp *zcomp_create(const char *compress, int max_strm)
 		return ERR_PTR(-ENOMEM);
 
 	comp->backend = backend;
-	if (max_strm > 1)
+	if (percpu)
+		error = zcomp_strm_percpu_create(comp);
+	else if (max_strm > 1)
 		error = zcomp_strm_multi_create(comp, max_strm);
 	else
 		error = zcomp_strm_single_create(comp);
@@ -366,3 +458,19 @@ struct zcomp *zcomp_create(const char *compress, int max_strm)
 	}
 	return comp;
 }
+
+struct zcomp *zcomp_create(const char *compress, int max_strm)
+{
+	return __zcomp_create(compress, max_strm,
+			IS_ENABLED(CONFIG_ZRAM_PERCPU_STREAMS));
+}
+
+/*
+ * same as zcomp_create(), but always with a single stream. Meant for
+ * rarely used compressors whose working memory is too large to keep
+ * one copy per CPU.
+ */
+struct zcomp *zcomp_create_single(const char *compress)
+{
+	return __zcomp_create(compress, 1, false);
+}
@@ -44,7 +44,11 @@ static int zcomp_lz4_decompress(const unsigned char *src, size_t src_len,
 {
 	size_t dst_len = PAGE_SIZE;
 	/* return  : Success if return 0 */
+#ifdef CONFIG_LZ4_DECOMPRESS_ARM64
+	return lz4_decompress_arm64(src, src_len, dst, &dst_len);
+#else
 	return lz4_decompress_unknownoutputsize(src, src_len, dst, &dst_len);
+#endif
 }
 
 struct zcomp_backend zcomp_lz4 = {
@@ -54,3 +58,33 @@ struct zcomp_backend zcomp_lz4 = {
 	.destroy = zcomp_lz4_destroy,
 	.name = "lz4",
 };
+
+#ifdef CONFIG_ZRAM_MULTI_COMP
+static void *zcomp_lz4hc_create(gfp_t flags)
+{
+	void *ret;
+
+	ret = kmalloc(LZ4HC_MEM_COMPRESS, flags);
+	if (!ret)
+		ret = __vmalloc(LZ4HC_MEM_COMPRESS,
+				flags | __GFP_HIGHMEM,
+				PAGE_KERNEL);
+	return ret;
+}
+
+static int zcomp_lz4hc_compress(const unsigned char *src, unsigned char *dst,
+		size_t *dst_len, void *private)
+{
+	/* return  : Success if return 0 */
+	return lz4hc_compress(src, PAGE_SIZE, dst, dst_len, private);
+}
+
+/* lz4hc produces a regular lz4 stream, so it shares the decompressor */
+struct zcomp_backend zcomp_lz4hc = {
+	.compress = zcomp_lz4hc_compress,
+	.decompress = zcomp_lz4_decompress,
+	.create = zcomp_lz4hc_create,
+	.destroy = zcomp_lz4_destroy,
+	.name = "lz4hc",
+};
+#endif
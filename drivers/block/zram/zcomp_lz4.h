@@ -13,5 +13,8 @@
 #include "zcomp.h"
 
 extern struct zcomp_backend zcomp_lz4;
+#ifdef CONFIG_ZRAM_MULTI_COMP
+extern struct zcomp_backend zcomp_lz4hc;
+#endif
 
 #endif /* _ZCOMP_LZ4_H_ */
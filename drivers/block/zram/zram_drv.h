@@ -65,18 +65,31 @@ static const size_t max_zpage_size = PAGE_SIZE / 10 * 9;
 
 /* Flags for zram pages (table[page_no].value) */
 enum zram_pageflags {
-	/* Page consists entirely of zeros */
-	ZRAM_ZERO = ZRAM_FLAG_SHIFT,
+	/* Page consists the same element */
+	ZRAM_SAME = ZRAM_FLAG_SHIFT,
 	ZRAM_ACCESS,	/* page is now accessed */
+	ZRAM_WB,	/* page is stored on backing_device */
+	ZRAM_UNDER_WB,	/* page is under writeback */
+	ZRAM_HUGE,	/* incompressible page */
+	ZRAM_IDLE,	/* not accessed page since last idle marking */
+	ZRAM_RECOMP,	/* compressed with zram->recomp */
+	ZRAM_UNDER_RECOMP,	/* page is being recompressed */
 
 	__NR_ZRAM_PAGEFLAGS,
 };
 
 /*-- Data structures */
 
-/* Allocated for each disk page */
+/*
+ * Allocated for each disk page. For ZRAM_WB pages, handle holds
+ * the block index on the backing device instead of a zsmalloc handle,
+ * and ZRAM_SAME pages keep their fill pattern in element.
+ */
 struct zram_table_entry {
-	unsigned long handle;
+	union {
+		unsigned long handle;
+		unsigned long element;
+	};
 	unsigned long value;
 };
 
@@ -90,8 +103,19 @@ struct zram_stats {
 	atomic64_t invalid_io;	/* non-page-aligned I/O requests */
 	atomic64_t notify_free;	/* no. of swap slot free notifications */
 	atomic64_t zero_pages;		/* no. of zero filled pages */
+	atomic64_t same_pages;		/* no. of same element filled pages */
 	atomic64_t pages_stored;	/* no. of pages currently stored */
 	atomic_long_t max_used_pages;	/* no. of maximum pages stored */
+	atomic64_t huge_pages;		/* no. of huge pages */
+#ifdef CONFIG_ZRAM_WRITEBACK
+	atomic64_t bd_count;		/* no. of pages in backing device */
+	atomic64_t bd_reads;		/* no. of reads from backing device */
+	atomic64_t bd_writes;		/* no. of writes to backing device */
+#endif
+#ifdef CONFIG_ZRAM_MULTI_COMP
+	atomic64_t recomp_pages;	/* no. of pages stored recompressed */
+	atomic64_t recomp_saved;	/* bytes saved by recompression */
+#endif
 };
 
 struct zram_meta {
@@ -121,5 +145,24 @@ struct zram {
 	 */
 	u64 disksize;	/* bytes */
 	char compressor[10];
+#ifdef CONFIG_ZRAM_WRITEBACK
+	struct block_device *bdev;
+	char *backing_dev;	/* path of the backing device */
+	unsigned long nr_pages;	/* no. of PAGE_SIZE blocks on bdev */
+	unsigned long *bitmap;	/* allocated blocks on bdev */
+#endif
+#ifdef CONFIG_ZRAM_MULTI_COMP
+	/* higher-ratio compressor for cold pages, see recompress_store() */
+	struct zcomp *recomp;
+	char recomp_algorithm[10];
+#endif
 };
+
+#ifdef CONFIG_KBENCH
+int zram_kbench_init(void);
+void zram_kbench_exit(void);
+#else
+static inline int zram_kbench_init(void) { return 0; }
+static inline void zram_kbench_exit(void) { }
+#endif
 #endif
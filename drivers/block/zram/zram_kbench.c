@@ -0,0 +1,150 @@
+/*
+ * Copyright (C) 2016 HTC Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * zram compressor benchmark. Compresses or decompresses one page with
+ * the backend named by target (default lzo) through the same zcomp
+ * calls zram_bvec_write()/zram_decompress_page() use. The page is a
+ * repeating pattern with n percent of its bytes made random, which
+ * sets how well it compresses.
+ */
+
+#include <linux/err.h>
+#include <linux/kbench.h>
+#include <linux/mm.h>
+#include <linux/random.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+
+#include "zcomp.h"
+#include "zram_drv.h"
+
+struct zram_kbench {
+	struct zcomp *comp;
+	unsigned char *src;
+	unsigned char *dst;
+	size_t clen;
+	bool decompress;
+};
+
+static int zram_kbench_setup(struct kbench_ctx *ctx)
+{
+	struct zram_kbench *zb;
+	struct zcomp_strm *zstrm;
+	unsigned int i, nr_rand;
+	int ret;
+
+	if (ctx->n > 100)
+		return -EINVAL;
+
+	zb = kzalloc(sizeof(*zb), GFP_KERNEL);
+	if (!zb)
+		return -ENOMEM;
+
+	if (!ctx->mode[0] || !strcmp(ctx->mode, "compress"))
+		zb->decompress = false;
+	else if (!strcmp(ctx->mode, "decompress"))
+		zb->decompress = true;
+	else {
+		ret = -EINVAL;
+		goto err;
+	}
+
+	zb->comp = zcomp_create_single(ctx->target[0] ? ctx->target : "lzo");
+	if (IS_ERR(zb->comp)) {
+		ret = PTR_ERR(zb->comp);
+		goto err;
+	}
+
+	zb->src = kmalloc(PAGE_SIZE, GFP_KERNEL);
+	zb->dst = kmalloc(PAGE_SIZE, GFP_KERNEL);
+	if (!zb->src || !zb->dst) {
+		ret = -ENOMEM;
+		goto err_free;
+	}
+
+	for (i = 0; i < PAGE_SIZE; i++)
+		zb->src[i] = i % 61;
+	nr_rand = PAGE_SIZE * ctx->n / 100;
+	if (nr_rand)
+		prandom_bytes(zb->src, nr_rand);
+
+	/* Keep the compressed copy around for the decompress runs */
+	zstrm = zcomp_strm_find(zb->comp);
+	ret = zcomp_compress(zb->comp, zstrm, zb->src, &zb->clen);
+	if (!ret && zb->clen <= PAGE_SIZE)
+		memcpy(zb->dst, zstrm->buffer, zb->clen);
+	zcomp_strm_release(zb->comp, zstrm);
+	if (ret)
+		goto err_free;
+
+	/* zram stores such a page uncompressed */
+	if (zb->decompress && zb->clen >= PAGE_SIZE) {
+		ret = -EINVAL;
+		goto err_free;
+	}
+
+	ctx->bytes = PAGE_SIZE;
+	ctx->priv = zb;
+	return 0;
+
+err_free:
+	kfree(zb->dst);
+	kfree(zb->src);
+	zcomp_destroy(zb->comp);
+err:
+	kfree(zb);
+	return ret;
+}
+
+static int zram_kbench_op(struct kbench_ctx *ctx, unsigned int i)
+{
+	struct zram_kbench *zb = ctx->priv;
+	struct zcomp_strm *zstrm;
+	size_t clen;
+	int ret;
+
+	if (zb->decompress)
+		return zcomp_decompress(zb->comp, zb->dst, zb->clen, zb->src);
+
+	zstrm = zcomp_strm_find(zb->comp);
+	ret = zcomp_compress(zb->comp, zstrm, zb->src, &clen);
+	zcomp_strm_release(zb->comp, zstrm);
+	return ret;
+}
+
+static void zram_kbench_teardown(struct kbench_ctx *ctx)
+{
+	struct zram_kbench *zb = ctx->priv;
+
+	kfree(zb->dst);
+	kfree(zb->src);
+	zcomp_destroy(zb->comp);
+	kfree(zb);
+}
+
+static struct kbench zram_kbench = {
+	.name		= "zram",
+	.help		= "mode=compress|decompress target=compressor n=percent random",
+	.setup		= zram_kbench_setup,
+	.op		= zram_kbench_op,
+	.teardown	= zram_kbench_teardown,
+};
+
+int zram_kbench_init(void)
+{
+	return kbench_register(&zram_kbench);
+}
+
+void zram_kbench_exit(void)
+{
+	kbench_unregister(&zram_kbench);
+}
@@ -15,6 +15,7 @@
 #include <linux/slab.h>
 #include <linux/debugfs.h>
 #include "diagchar.h"
+#include "diagchar_hdlc.h"
 #include "diagfwd.h"
 #include "diagfwd_bridge.h"
 #include "diagfwd_hsic.h"
@@ -460,6 +461,30 @@ static ssize_t diag_dbgfs_read_power(struct file *file, char __user *ubuf,
 	return ret;
 }
 
+static ssize_t diag_dbgfs_read_hdlc_bench(struct file *file,
+				char __user *ubuf, size_t count, loff_t *ppos)
+{
+	char *buf;
+	int ret;
+
+	/* Run the benchmark once per open/read sequence */
+	if (*ppos)
+		return 0;
+
+	buf = kzalloc(sizeof(char) * DEBUG_BUF_SIZE, GFP_KERNEL);
+	if (!buf) {
+		pr_err("diag: %s, Error allocating memory\n", __func__);
+		return -ENOMEM;
+	}
+
+	ret = diag_hdlc_bench(buf, ksize(buf));
+	if (ret > 0)
+		ret = simple_read_from_buffer(ubuf, count, ppos, buf, ret);
+
+	kfree(buf);
+	return ret;
+}
+
 static ssize_t diag_dbgfs_read_workpending(struct file *file,
 				char __user *ubuf, size_t count, loff_t *ppos)
 {
@@ -1008,6 +1033,10 @@ const struct file_operations diag_dbgfs_power_ops = {
 	.read = diag_dbgfs_read_power,
 };
 
+const struct file_operations diag_dbgfs_hdlc_bench_ops = {
+	.read = diag_dbgfs_read_hdlc_bench,
+};
+
 int diag_debugfs_init(void)
 {
 	struct dentry *entry = NULL;
@@ -1051,6 +1080,11 @@ int diag_debugfs_init(void)
 	if (!entry)
 		goto err;
 
+	entry = debugfs_create_file("hdlc_bench", 0444, diag_dbgfs_dent, 0,
+				    &diag_dbgfs_hdlc_bench_ops);
+	if (!entry)
+		goto err;
+
 #ifdef CONFIG_DIAGFWD_BRIDGE_CODE
 	entry = debugfs_create_file("bridge", 0444, diag_dbgfs_dent, 0,
 				    &diag_dbgfs_bridge_ops);
@@ -2678,6 +2678,7 @@ static int __init diagchar_init(void)
 	init_waitqueue_head(&driver->smd_wait_q);
 	INIT_WORK(&(driver->diag_drain_work), diag_drain_work_fn);
 	diag_ws_init();
+	diag_hdlc_init();
 	ret = diag_real_time_info_init();
 	if (ret)
 		goto fail;
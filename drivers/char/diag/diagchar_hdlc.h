@@ -51,6 +51,13 @@ struct diag_hdlc_decode_type {
 void diag_hdlc_encode(struct diag_send_desc_type *src_desc,
 		      struct diag_hdlc_dest_type *enc);
 
+int diag_hdlc_encode_frame(const uint8_t *src, unsigned int len,
+			   uint8_t *dest, unsigned int dest_size);
+
+void diag_hdlc_init(void);
+
+int diag_hdlc_bench(char *buf, unsigned int size);
+
 int diag_hdlc_decode(struct diag_hdlc_decode_type *hdlc);
 
 int crc_check(uint8_t *buf, uint16_t len);
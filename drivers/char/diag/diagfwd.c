@@ -50,6 +50,16 @@
 #define STM_RSP_NUM_BYTES		9
 
 #define SMD_DRAIN_BUF_SIZE 4096
+
+/*
+ * Number of raw bytes a data channel that is HDLC encoded on the apps side
+ * may collect from back-to-back SMD packets before the batch is encoded
+ * and handed to the mux in a single write. 0 restores one write per packet.
+ */
+static unsigned int diag_smd_batch_bytes = IN_BUF_SIZE;
+module_param(diag_smd_batch_bytes, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(diag_smd_batch_bytes,
+	"Max raw bytes batched per SMD data channel read");
 /*++ 2014/09/18, USB Team, PCN00002 ++*/
 extern unsigned diag7k_debug_mask;
 extern unsigned diag9k_debug_mask;
@@ -249,8 +259,6 @@ int diag_add_hdlc_encoding(struct diag_smd_info *smd_info, void *buf,
 			   int total_recd, uint8_t *encode_buf,
 			   int *encoded_length)
 {
-	struct diag_send_desc_type send = { NULL, NULL, DIAG_STATE_START, 0 };
-	struct diag_hdlc_dest_type enc = { NULL, NULL, 0 };
 	struct data_header {
 		uint8_t control_char;
 		uint8_t version;
@@ -296,25 +304,22 @@ int diag_add_hdlc_encoding(struct diag_smd_info *smd_info, void *buf,
 			break;
 		}
 
-		/* Prepare for encoding the data */
-		send.state = DIAG_STATE_START;
-		send.pkt = payload;
-		send.last = (void *)(payload + header->length - 1);
-		send.terminate = 1;
-
-		enc.dest = temp_encode_buf;
-		enc.dest_last = (void *)(temp_encode_buf + max_size);
-		enc.crc = 0;
-		diag_hdlc_encode(&send, &enc);
+		encoded_pkt_length = diag_hdlc_encode_frame(payload,
+						header->length,
+						temp_encode_buf,
+						bytes_remaining);
+		if (encoded_pkt_length < 0) {
+			success = 0;
+			break;
+		}
 
 		/* Prepare for next packet */
 		src_pkt_len = (header_size + header->length + 1);
 		total_processed += src_pkt_len;
 		temp_buf += src_pkt_len;
 
-		encoded_pkt_length = (uint8_t *)enc.dest - temp_encode_buf;
 		bytes_remaining -= encoded_pkt_length;
-		temp_encode_buf = enc.dest;
+		temp_encode_buf += encoded_pkt_length;
 	}
 
 	*encoded_length = (int)(temp_encode_buf - encode_buf);
@@ -551,6 +556,28 @@ static int diag_smd_resize_buf(struct diag_smd_info *smd_info, void **buf,
 	return success;
 }
 
+/*
+ * Only packets in the raw, apps-encoded format carry their own framing and
+ * can be concatenated safely; the peripheral-encoded path inspects the first
+ * packet of every buffer (XPST routing and the qxdm2sd drop logic).
+ */
+static int diag_smd_can_batch(struct diag_smd_info *smd_info)
+{
+	return smd_info->type == SMD_DATA_TYPE && smd_info->encode_hdlc &&
+		diag_smd_batch_bytes && !driver->qxdm2sd_drop;
+}
+
+static int diag_smd_batch_full(int total_recd, int pkt_len, int buf_size)
+{
+	int limit = min_t(int, buf_size, diag_smd_batch_bytes);
+
+	/* the whole batch must still fit in the encode buffer once escaped */
+	if (2 * (total_recd + pkt_len) + 3 > MAX_IN_BUF_SIZE)
+		return 1;
+
+	return total_recd + pkt_len > limit;
+}
+
 void diag_smd_send_req(struct diag_smd_info *smd_info)
 {
 	void *buf = NULL, *temp_buf = NULL;
@@ -614,6 +641,11 @@ drop:	/*++ 2015/02/02, USB Team, PCN00002 ++*/
 		while ((pkt_len = smd_cur_packet_size(smd_info->ch)) != 0) {
 			total_recd_partial = 0;
 
+		/* A batched data channel must never grow its buffer */
+		if (total_recd && smd_info->type == SMD_DATA_TYPE &&
+		    diag_smd_batch_full(total_recd, pkt_len, buf_size))
+			break;
+
 		required_size = pkt_len + total_recd;
 		if (required_size > buf_size)
 			resize_success = diag_smd_resize_buf(smd_info, &buf,
@@ -719,7 +751,8 @@ drop:	/*++ 2015/02/02, USB Team, PCN00002 ++*/
 		/*-- 2015/02/02, USB Team, PCN00002 --*/
 
 		if ((smd_info->type != SMD_CNTL_TYPE &&
-				smd_info->type != SMD_CMD_TYPE)
+				smd_info->type != SMD_CMD_TYPE &&
+				!diag_smd_can_batch(smd_info))
 					|| buf_full)
 			break;
 
@@ -2301,7 +2334,8 @@ int diagfwd_init(void)
 			goto err;
 		kmemleak_not_leak(driver->apps_rsp_buf);
 	}
-	driver->diag_wq = create_singlethread_workqueue("diag_wq");
+	driver->diag_wq = alloc_ordered_workqueue("diag_wq",
+					WQ_MEM_RECLAIM | WQ_POWER_EFFICIENT);
 	if (!driver->diag_wq)
 		goto err;
 	ret = diag_mux_register(DIAG_LOCAL_PROC, DIAG_LOCAL_PROC,
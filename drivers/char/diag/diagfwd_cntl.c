@@ -1200,7 +1200,8 @@ int diagfwd_cntl_init(void)
 	reg_dirty = 0;
 	driver->polling_reg_flag = 0;
 	driver->log_on_demand_support = 1;
-	driver->diag_cntl_wq = create_singlethread_workqueue("diag_cntl_wq");
+	driver->diag_cntl_wq = alloc_ordered_workqueue("diag_cntl_wq",
+					WQ_MEM_RECLAIM | WQ_POWER_EFFICIENT);
 	if (!driver->diag_cntl_wq)
 		goto err;
 
@@ -32,6 +32,7 @@
 #include <linux/coresight.h>
 #include <linux/pm_wakeup.h>
 #include <asm/sections.h>
+#include <asm/cputype.h>
 #include <soc/qcom/socinfo.h>
 #include <soc/qcom/memory_dump.h>
 
@@ -232,7 +233,8 @@ module_param_named(
 	boot_reset, boot_reset, int, S_IRUGO
 );
 
-#ifdef CONFIG_CORESIGHT_ETMV4_DEFAULT_ENABLE
+#if defined(CONFIG_CORESIGHT_ETMV4_DEFAULT_ENABLE) || \
+	defined(CONFIG_CORESIGHT_FLIGHT_RECORDER)
 static int boot_enable = 1;
 #else
 static int boot_enable;
@@ -241,6 +243,19 @@ module_param_named(
 	boot_enable, boot_enable, int, S_IRUGO
 );
 
+/*
+ * Restrict boot time enable to cores with this MIDR part number, 0 enables
+ * all cores. The flight recorder only traces the big cluster by default.
+ */
+#ifdef CONFIG_CORESIGHT_FLIGHT_RECORDER
+static int boot_enable_part = ARM_CPU_PART_CORTEX_A57;
+#else
+static int boot_enable_part;
+#endif
+module_param_named(
+	boot_enable_part, boot_enable_part, int, S_IRUGO
+);
+
 enum etm_addr_type {
 	ETM_ADDR_TYPE_NONE,
 	ETM_ADDR_TYPE_SINGLE,
@@ -291,6 +306,7 @@ struct etm_drvdata {
 	struct mutex			mutex;
 	struct wakeup_source		ws;
 	int				cpu;
+	unsigned int			cpu_part;
 	uint8_t				arch;
 	bool				enable;
 	bool				sticky_enable;
@@ -2935,6 +2951,8 @@ static void etm_init_arch_data(void *info)
 	uint32_t etmidr5;
 	struct etm_drvdata *drvdata = info;
 
+	drvdata->cpu_part = read_cpuid_part_number();
+
 	ETM_UNLOCK(drvdata);
 
 	/* find all capabilities */
@@ -3120,6 +3138,13 @@ static void etm_init_arch_data(void *info)
 	ETM_LOCK(drvdata);
 }
 
+static bool etm_boot_enable_cpu(struct etm_drvdata *drvdata)
+{
+	/* Part number is only known once the cpu has been brought up */
+	return !boot_enable_part || !drvdata->cpu_part ||
+	       drvdata->cpu_part == boot_enable_part;
+}
+
 static void etm_init_default_data(struct etm_drvdata *drvdata)
 {
 	int i;
@@ -3263,7 +3288,7 @@ static int etm_late_init(struct etm_drvdata *drvdata)
 	if (boot_reset)
 		etm_reset_data(drvdata);
 
-	if (boot_enable) {
+	if (boot_enable && etm_boot_enable_cpu(drvdata)) {
 		coresight_enable(drvdata->csdev);
 		drvdata->boot_enable = true;
 	}
@@ -3335,7 +3360,8 @@ static int etm_cpu_callback(struct notifier_block *nfb, unsigned long action,
 		}
 
 		if (etmdrvdata[cpu]->boot_enable &&
-		    !etmdrvdata[cpu]->sticky_enable)
+		    !etmdrvdata[cpu]->sticky_enable &&
+		    etm_boot_enable_cpu(etmdrvdata[cpu]))
 			coresight_enable(etmdrvdata[cpu]->csdev);
 		break;
 
@@ -27,6 +27,8 @@
 #include <linux/bitmap.h>
 #include <linux/of.h>
 #include <linux/sched.h>
+#include <linux/hardirq.h>
+#include <linux/console.h>
 #include <linux/of_coresight.h>
 #include <linux/coresight.h>
 #include <linux/coresight-stm.h>
@@ -81,6 +83,7 @@ do {									\
 #define STMITATBCTR0			(0xEF8)
 
 #define NR_STM_CHANNEL			(32)
+#define STM_NR_PERCPU_CTX		(4)
 #define BYTES_PER_CHANNEL		(256)
 #define STM_TRACE_BUF_SIZE		(4096)
 #define STM_USERSPACE_HEADER_SIZE	(8)
@@ -125,6 +128,16 @@ module_param_named(
 	boot_nr_channel, boot_nr_channel, int, S_IRUGO
 );
 
+/*
+ * Give each cpu a private channel per context (task, softirq, irq, nmi) so
+ * that tracing does not contend on the shared channel allocator.
+ */
+static int boot_percpu_channel = 1;
+
+module_param_named(
+	boot_percpu_channel, boot_percpu_channel, int, S_IRUGO
+);
+
 struct channel_space {
 	void __iomem		*base;
 	unsigned long		*bitmap;
@@ -142,6 +155,8 @@ struct stm_drvdata {
 	DECLARE_BITMAP(entities, OST_ENTITY_MAX);
 	bool			write_64bit;
 	bool			data_barrier;
+	bool			percpu;
+	uint32_t		percpu_base;
 };
 
 static struct stm_drvdata *stmdrvdata;
@@ -590,6 +605,28 @@ static int stm_trace_ost_tail(unsigned long ch_addr, uint32_t options)
 	return stm_send(addr, &tail, sizeof(tail));
 }
 
+/*
+ * A packet is written with several stores, so only a context that cannot be
+ * interrupted by another writer on the same cpu may share a channel.
+ * Preemption must be disabled by the caller.
+ */
+static inline uint32_t stm_percpu_channel(struct stm_drvdata *drvdata)
+{
+	uint32_t ctx;
+
+	if (in_nmi())
+		ctx = 3;
+	else if (in_irq())
+		ctx = 2;
+	else if (in_softirq())
+		ctx = 1;
+	else
+		ctx = 0;
+
+	return drvdata->percpu_base +
+	       smp_processor_id() * STM_NR_PERCPU_CTX + ctx;
+}
+
 static inline int __stm_trace(uint32_t options, uint8_t entity_id,
 			      uint8_t proto_id, const void *data, uint32_t size)
 {
@@ -599,7 +636,12 @@ static inline int __stm_trace(uint32_t options, uint8_t entity_id,
 	unsigned long ch_addr;
 
 	/* allocate channel and get the channel address */
-	ch = stm_channel_alloc(0);
+	if (drvdata->percpu) {
+		preempt_disable_notrace();
+		ch = stm_percpu_channel(drvdata);
+	} else {
+		ch = stm_channel_alloc(0);
+	}
 	ch_addr = (unsigned long)stm_channel_addr(drvdata, ch);
 
 	if (drvdata->write_64bit) {
@@ -625,7 +667,10 @@ static inline int __stm_trace(uint32_t options, uint8_t entity_id,
 	}
 
 	/* we are done, free the channel */
-	stm_channel_free(ch);
+	if (drvdata->percpu)
+		preempt_enable_notrace();
+	else
+		stm_channel_free(ch);
 
 	return len;
 }
@@ -661,6 +706,21 @@ int stm_trace(uint32_t options, uint8_t entity_id, uint8_t proto_id,
 }
 EXPORT_SYMBOL(stm_trace);
 
+#ifdef CONFIG_CORESIGHT_STM_CONSOLE
+static void stm_console_write(struct console *con, const char *buf,
+			      unsigned int len)
+{
+	stm_trace(STM_OPTION_TIMESTAMPED, OST_ENTITY_CONSOLE, 0, buf, len);
+}
+
+static struct console stm_console = {
+	.name	= "stm",
+	.write	= stm_console_write,
+	.flags	= CON_ENABLED,
+	.index	= -1,
+};
+#endif
+
 static ssize_t stm_write(struct file *file, const char __user *data,
 			 size_t size, loff_t *ppos)
 {
@@ -893,6 +953,14 @@ static int stm_probe(struct platform_device *pdev)
 				 BYTES_PER_CHANNEL), resource_size(res));
 		bitmap_size = NR_STM_CHANNEL * sizeof(long);
 	}
+	/* per cpu channels follow the allocatable ones when space permits */
+	if (boot_percpu_channel &&
+	    resource_size(res) >= res_size + nr_cpu_ids * STM_NR_PERCPU_CTX *
+				  BYTES_PER_CHANNEL) {
+		drvdata->percpu_base = res_size / BYTES_PER_CHANNEL;
+		res_size += nr_cpu_ids * STM_NR_PERCPU_CTX * BYTES_PER_CHANNEL;
+		drvdata->percpu = true;
+	}
 	drvdata->chs.base = devm_ioremap(dev, res->start, res_size);
 	if (!drvdata->chs.base)
 		return -ENOMEM;
@@ -949,6 +1017,10 @@ static int stm_probe(struct platform_device *pdev)
 	/* Store the driver data pointer for use in exported functions */
 	stmdrvdata = drvdata;
 
+#ifdef CONFIG_CORESIGHT_STM_CONSOLE
+	register_console(&stm_console);
+#endif
+
 	return 0;
 err:
 	coresight_unregister(drvdata->csdev);
@@ -959,6 +1031,9 @@ static int stm_remove(struct platform_device *pdev)
 {
 	struct stm_drvdata *drvdata = platform_get_drvdata(pdev);
 
+#ifdef CONFIG_CORESIGHT_STM_CONSOLE
+	unregister_console(&stm_console);
+#endif
 	misc_deregister(&drvdata->miscdev);
 	coresight_unregister(drvdata->csdev);
 	return 0;
@@ -35,11 +35,15 @@
 #include <linux/cdev.h>
 #include <linux/usb/usb_qdss.h>
 #include <linux/dma-mapping.h>
+#include <linux/sizes.h>
 #include <linux/msm-sps.h>
 #include <linux/usb_bam.h>
 #include <asm/cacheflush.h>
 #include <soc/qcom/memory_dump.h>
 #include <soc/qcom/jtag.h>
+#ifdef CONFIG_HTC_DEBUG_FOOTPRINT
+#include <htc_mnemosyne/htc_mnemosyne.h>
+#endif
 
 #include "coresight-priv.h"
 
@@ -87,6 +91,8 @@ do {									\
 #define TMC_ITATBCTR0			(0xEF8)
 
 #define BYTES_PER_WORD			4
+#define TMC_ETR_FLIGHT_MAGIC_ARMED	(0x43455246)	/* "FREC" */
+#define TMC_ETR_FLIGHT_MAGIC_FROZEN	(0x4E5A5246)	/* "FRZN" */
 #define TMC_ETR_BAM_PIPE_INDEX		0
 #define TMC_ETR_BAM_NR_PIPES		2
 
@@ -212,8 +218,40 @@ struct tmc_drvdata {
 	int			sg_blk_num;
 	bool			notify;
 	struct notifier_block	jtag_save_blk;
+	bool			flight;
+	struct notifier_block	panic_blk;
 };
 
+#ifdef CONFIG_CORESIGHT_FLIGHT_RECORDER
+/* ETR buffer size used for always-on flight recording */
+static int flight_mem_size = SZ_1M;
+module_param_named(
+	flight_mem_size, flight_mem_size, int, S_IRUGO
+);
+#endif
+
+/*
+ * Publish the flight recorder buffer location in mnemosyne so that it can be
+ * located after a reset. magic is written last so a partial update is never
+ * mistaken for a valid record.
+ */
+static void tmc_etr_flight_record(struct tmc_drvdata *drvdata, uint32_t magic,
+				  uint64_t rwp, uint32_t sts)
+{
+#ifdef CONFIG_HTC_DEBUG_FOOTPRINT
+	if (!drvdata->flight || drvdata->memtype != TMC_ETR_MEM_TYPE_CONTIG)
+		return;
+
+	MNEMOSYNE_SET(etr_flight_paddr, drvdata->paddr);
+	MNEMOSYNE_SET(etr_flight_size, drvdata->size);
+	MNEMOSYNE_SET(etr_flight_rwp, rwp);
+	MNEMOSYNE_SET(etr_flight_sts, sts);
+	mb();
+	MNEMOSYNE_SET(etr_flight_magic, magic);
+	mb();
+#endif
+}
+
 static void tmc_wait_for_flush(struct tmc_drvdata *drvdata)
 {
 	int count;
@@ -822,6 +860,9 @@ static void __tmc_etr_enable_to_mem(struct tmc_drvdata *drvdata)
 	__tmc_enable(drvdata);
 
 	TMC_LOCK(drvdata);
+
+	tmc_etr_flight_record(drvdata, TMC_ETR_FLIGHT_MAGIC_ARMED,
+			      drvdata->paddr, 0);
 }
 
 static void __tmc_etf_enable(struct tmc_drvdata *drvdata)
@@ -1127,10 +1168,19 @@ static void tmc_etr_sg_rwp_pos(struct tmc_drvdata *drvdata, uint32_t rwp)
 
 static void __tmc_etr_dump(struct tmc_drvdata *drvdata)
 {
-	uint32_t rwp, rwphi;
+	uint32_t rwp, rwphi, sts;
 
 	rwp = tmc_readl(drvdata, TMC_RWP);
 	rwphi = tmc_readl(drvdata, TMC_RWPHI);
+	sts = tmc_readl(drvdata, TMC_STS);
+
+	/*
+	 * Freeze the flight record on abort; a regular disable invalidates it
+	 * until the next enable re-arms the buffer.
+	 */
+	tmc_etr_flight_record(drvdata, drvdata->aborting ?
+			      TMC_ETR_FLIGHT_MAGIC_FROZEN : 0,
+			      ((uint64_t)rwphi << 32) | rwp, sts);
 
 	if (drvdata->memtype == TMC_ETR_MEM_TYPE_CONTIG) {
 		if (BVAL(tmc_readl(drvdata, TMC_STS), 0))
@@ -1286,6 +1336,20 @@ out1:
 	spin_unlock_irqrestore(&drvdata->spinlock, flags);
 }
 
+#ifdef CONFIG_CORESIGHT_FLIGHT_RECORDER
+static int tmc_etr_flight_panic(struct notifier_block *this,
+				unsigned long event, void *ptr)
+{
+	struct tmc_drvdata *drvdata = container_of(this, struct tmc_drvdata,
+						   panic_blk);
+
+	/* coresight_abort may already have frozen the buffer */
+	if (drvdata->enable)
+		tmc_abort(drvdata->csdev);
+	return NOTIFY_DONE;
+}
+#endif
+
 static const struct coresight_ops_sink tmc_sink_ops = {
 	.enable		= tmc_enable_sink,
 	.disable	= tmc_disable_sink,
@@ -2420,6 +2484,18 @@ static int tmc_probe(struct platform_device *pdev)
 			else
 				drvdata->memtype = TMC_ETR_MEM_TYPE_CONTIG;
 
+#ifdef CONFIG_CORESIGHT_FLIGHT_RECORDER
+			/*
+			 * Flight recording uses a small contiguous buffer so it
+			 * can be recovered from its physical address alone.
+			 */
+			drvdata->flight = true;
+			drvdata->memtype = TMC_ETR_MEM_TYPE_CONTIG;
+			if (flight_mem_size > 0 &&
+			    flight_mem_size < drvdata->size)
+				drvdata->size = PAGE_ALIGN(flight_mem_size);
+			drvdata->mem_size = drvdata->size;
+#endif
 			drvdata->mem_type = drvdata->memtype;
 
 			drvdata->byte_cntr_present = !of_property_read_bool
@@ -2604,6 +2680,14 @@ static int tmc_probe(struct platform_device *pdev)
 		}
 	}
 
+#ifdef CONFIG_CORESIGHT_FLIGHT_RECORDER
+	if (drvdata->flight) {
+		drvdata->panic_blk.notifier_call = tmc_etr_flight_panic;
+		atomic_notifier_chain_register(&panic_notifier_list,
+					       &drvdata->panic_blk);
+	}
+#endif
+
 	dev_info(dev, "TMC initialized\n");
 	return 0;
 err3:
@@ -2622,6 +2706,11 @@ static int tmc_remove(struct platform_device *pdev)
 
 	if (drvdata->notify)
 		msm_jtag_save_unregister(&drvdata->jtag_save_blk);
+#ifdef CONFIG_CORESIGHT_FLIGHT_RECORDER
+	if (drvdata->flight)
+		atomic_notifier_chain_unregister(&panic_notifier_list,
+						 &drvdata->panic_blk);
+#endif
 	tmc_etr_byte_cntr_exit(drvdata);
 	misc_deregister(&drvdata->miscdev);
 	coresight_unregister(drvdata->csdev);
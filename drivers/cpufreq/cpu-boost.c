@@ -15,6 +15,7 @@
 
 #include <linux/kernel.h>
 #include <linux/init.h>
+#include <linux/cpu_boost.h>
 #include <linux/notifier.h>
 #include <linux/cpufreq.h>
 #include <linux/cpu.h>
@@ -69,6 +70,24 @@ module_param(sched_boost_on_input, bool, 0644);
 
 static bool sched_boost_active;
 
+/*
+ * Frame driven input boost: when frame_boost_vsyncs is set, an input boost
+ * lasts for as long as display commits or GPU submissions keep coming in
+ * at most frame_boost_vsyncs vsync periods apart, up to frame_boost_max_ms,
+ * instead of for a fixed input_boost_ms.
+ */
+static unsigned int frame_boost_vsyncs;
+module_param(frame_boost_vsyncs, uint, 0644);
+
+static unsigned int frame_boost_vsync_us = 16667;
+module_param(frame_boost_vsync_us, uint, 0644);
+
+static unsigned int frame_boost_max_ms = 3000;
+module_param(frame_boost_max_ms, uint, 0644);
+
+static bool frame_boost_active;
+static unsigned long frame_boost_end;
+
 static struct delayed_work input_boost_rem;
 static u64 last_input_time;
 
@@ -177,9 +196,11 @@ static int boost_adjust_notify(struct notifier_block *nb, unsigned long val,
 			 cpu, policy->min);
 		break;
 
+#ifndef CONFIG_SCHED_FREQ_INPUT
 	case CPUFREQ_START:
 		set_cpus_allowed(s->thread, *cpumask_of(cpu));
 		break;
+#endif
 	}
 
 	return NOTIFY_OK;
@@ -190,6 +211,7 @@ static struct notifier_block boost_adjust_nb = {
 	.priority = INT_MAX-2,
 };
 
+#ifndef CONFIG_SCHED_FREQ_INPUT
 static void do_boost_rem(struct work_struct *work)
 {
 	struct cpu_sync *s = container_of(work, struct cpu_sync,
@@ -200,6 +222,7 @@ static void do_boost_rem(struct work_struct *work)
 	/* Force policy re-evaluation to trigger adjust notifier. */
 	cpufreq_update_policy(s->cpu);
 }
+#endif
 
 static void update_policy_online(void)
 {
@@ -234,6 +257,8 @@ static void do_input_boost_rem(struct work_struct *work)
 		i_sync_info->input_boost_min = 0;
 	}
 
+	frame_boost_active = false;
+
 	/* Update policies for all online CPUs */
 	update_policy_online();
 
@@ -245,6 +270,12 @@ static void do_input_boost_rem(struct work_struct *work)
 	}
 }
 
+/*
+ * With CONFIG_SCHED_FREQ_INPUT the window based demand of a task moves with
+ * it (fixup_busy_time()) and the scheduler alerts the governors of both
+ * clusters on migration, so the sync threads below are not needed.
+ */
+#ifndef CONFIG_SCHED_FREQ_INPUT
 static int boost_mig_sync_thread(void *data)
 {
 	int dest_cpu = (long) data;
@@ -356,6 +387,7 @@ static int boost_migration_notify(struct notifier_block *nb,
 static struct notifier_block boost_migration_nb = {
 	.notifier_call = boost_migration_notify,
 };
+#endif
 
 static void do_input_boost(struct work_struct *work)
 {
@@ -401,12 +433,50 @@ static void do_input_boost(struct work_struct *work)
 			sched_boost_active = true;
 	}
 
+	if (frame_boost_vsyncs) {
+		frame_boost_end = jiffies + msecs_to_jiffies(frame_boost_max_ms);
+		frame_boost_active = true;
+		queue_delayed_work(cpu_boost_wq, &input_boost_rem,
+			usecs_to_jiffies(frame_boost_vsyncs *
+					 frame_boost_vsync_us));
+		return;
+	}
+
 	queue_delayed_work(cpu_boost_wq, &input_boost_rem,
 					msecs_to_jiffies(input_boost_ms));
 }
 
-static void cpuboost_input_event(struct input_handle *handle,
-		unsigned int type, unsigned int code, int value)
+/**
+ * cpu_boost_frame_event - report that the UI produced a frame
+ *
+ * Called on display commits and GPU submissions. While a frame driven
+ * input boost is active, this pushes its end out to frame_boost_vsyncs
+ * vsync periods from now.
+ */
+void cpu_boost_frame_event(void)
+{
+	unsigned long delay;
+
+	if (!ACCESS_ONCE(frame_boost_active))
+		return;
+
+	if (time_after_eq(jiffies, frame_boost_end))
+		return;
+
+	delay = usecs_to_jiffies(frame_boost_vsyncs * frame_boost_vsync_us);
+	delay = min(delay, frame_boost_end - jiffies);
+	mod_delayed_work(cpu_boost_wq, &input_boost_rem, delay);
+}
+EXPORT_SYMBOL(cpu_boost_frame_event);
+
+/**
+ * cpu_boost_kick - start an input boost ahead of the input event
+ *
+ * Lets input drivers start the boost from their interrupt handler, before
+ * the event has been read from the device. The usual rate limiting of
+ * input boosts applies.
+ */
+void cpu_boost_kick(void)
 {
 	u64 now;
 
@@ -423,6 +493,13 @@ static void cpuboost_input_event(struct input_handle *handle,
 	queue_work(cpu_boost_wq, &input_boost_work);
 	last_input_time = ktime_to_us(ktime_get());
 }
+EXPORT_SYMBOL(cpu_boost_kick);
+
+static void cpuboost_input_event(struct input_handle *handle,
+		unsigned int type, unsigned int code, int value)
+{
+	cpu_boost_kick();
+}
 
 static int cpuboost_input_connect(struct input_handler *handler,
 		struct input_dev *dev, const struct input_device_id *id)
@@ -510,16 +587,20 @@ static int cpu_boost_init(void)
 	for_each_possible_cpu(cpu) {
 		s = &per_cpu(sync_info, cpu);
 		s->cpu = cpu;
+#ifndef CONFIG_SCHED_FREQ_INPUT
 		init_waitqueue_head(&s->sync_wq);
 		spin_lock_init(&s->lock);
 		INIT_DELAYED_WORK(&s->boost_rem, do_boost_rem);
 		s->thread = kthread_run(boost_mig_sync_thread,
 				(void *) (long)cpu, "boost_sync/%d", cpu);
 		set_cpus_allowed(s->thread, *cpumask_of(cpu));
+#endif
 	}
 	cpufreq_register_notifier(&boost_adjust_nb, CPUFREQ_POLICY_NOTIFIER);
+#ifndef CONFIG_SCHED_FREQ_INPUT
 	atomic_notifier_chain_register(&migration_notifier_head,
 					&boost_migration_nb);
+#endif
 	ret = input_register_handler(&cpuboost_input_handler);
 
 	return 0;
@@ -25,6 +25,7 @@
 #include <linux/kernel_stat.h>
 #include <linux/module.h>
 #include <linux/mutex.h>
+#include <linux/pm_qos.h>
 #include <linux/slab.h>
 #include <linux/syscore_ops.h>
 #include <linux/tick.h>
@@ -1999,6 +2000,7 @@ static int cpufreq_set_policy(struct cpufreq_policy *policy,
 				struct cpufreq_policy *new_policy)
 {
 	int ret = 0, failed = 1;
+	s32 qos_min;
 
 	pr_debug("setting new policy for CPU %u: %u - %u kHz\n", new_policy->cpu,
 		new_policy->min, new_policy->max);
@@ -2020,6 +2022,14 @@ static int cpufreq_set_policy(struct cpufreq_policy *policy,
 	blocking_notifier_call_chain(&cpufreq_policy_notifier_list,
 			CPUFREQ_ADJUST, new_policy);
 
+	/* PM QoS floors of this policy's cpus, never above its max */
+	qos_min = pm_qos_request_for_cpumask(PM_QOS_CPU_FREQ_MIN,
+					     new_policy->cpus);
+	if (qos_min > 0 && qos_min > new_policy->min)
+		cpufreq_verify_within_limits(new_policy,
+				min_t(unsigned int, qos_min, new_policy->max),
+				new_policy->max);
+
 	/* adjust if necessary - hardware incompatibility*/
 	blocking_notifier_call_chain(&cpufreq_policy_notifier_list,
 			CPUFREQ_INCOMPATIBLE, new_policy);
@@ -2302,11 +2312,67 @@ int cpufreq_unregister_driver(struct cpufreq_driver *driver)
 }
 EXPORT_SYMBOL_GPL(cpufreq_unregister_driver);
 
+static DEFINE_SPINLOCK(cpufreq_qos_lock);
+static struct cpumask cpufreq_qos_pending;
+
+static void cpufreq_qos_update(struct work_struct *work)
+{
+	struct cpufreq_policy *policy;
+	struct cpumask cpus;
+	unsigned long flags;
+	unsigned int cpu;
+
+	spin_lock_irqsave(&cpufreq_qos_lock, flags);
+	cpumask_copy(&cpus, &cpufreq_qos_pending);
+	cpumask_clear(&cpufreq_qos_pending);
+	spin_unlock_irqrestore(&cpufreq_qos_lock, flags);
+
+	get_online_cpus();
+	for_each_cpu_and(cpu, &cpus, cpu_online_mask) {
+		policy = cpufreq_cpu_get(cpu);
+		if (!policy)
+			continue;
+		/* One update per policy is enough */
+		cpumask_andnot(&cpus, &cpus, policy->cpus);
+		cpufreq_cpu_put(policy);
+		cpufreq_update_policy(cpu);
+	}
+	put_online_cpus();
+}
+static DECLARE_WORK(cpufreq_qos_work, cpufreq_qos_update);
+
+/*
+ * Policies are updated from a work, requests may be made with locks held
+ * that the policy update path takes as well.
+ */
+static int cpufreq_qos_notify(struct notifier_block *nb, unsigned long val,
+			      void *data)
+{
+	struct cpumask *cpus = data;
+	unsigned long flags;
+
+	spin_lock_irqsave(&cpufreq_qos_lock, flags);
+	if (cpus)
+		cpumask_or(&cpufreq_qos_pending, &cpufreq_qos_pending, cpus);
+	else
+		cpumask_setall(&cpufreq_qos_pending);
+	spin_unlock_irqrestore(&cpufreq_qos_lock, flags);
+
+	schedule_work(&cpufreq_qos_work);
+	return NOTIFY_OK;
+}
+
+static struct notifier_block cpufreq_qos_nb = {
+	.notifier_call = cpufreq_qos_notify,
+};
+
 static int __init cpufreq_core_init(void)
 {
 	if (cpufreq_disabled())
 		return -ENODEV;
 
+	pm_qos_add_notifier(PM_QOS_CPU_FREQ_MIN, &cpufreq_qos_nb);
+
 	cpufreq_global_kobject = kobject_create();
 	BUG_ON(!cpufreq_global_kobject);
 	register_syscore_ops(&cpufreq_syscore_ops);
@@ -0,0 +1,380 @@
+/*
+ * drivers/cpufreq/cpufreq_sched.c
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * Scheduler driven cpufreq governor.
+ *
+ * Frequency is chosen from the busy time the HMP window accounting
+ * reports for the cpus of a policy (sched_get_cpus_busy()). There are no
+ * governor timers: the scheduler calls into the governor through
+ * sched_set_freq_hook() on every tick, which re-evaluates once per load
+ * window, and on every load alert (sched_freq_inc_notify/dec_notify),
+ * which re-evaluates immediately. Since the hook may run under scheduler
+ * locks, it only queues an irq_work that in turn wakes the per policy
+ * thread performing the frequency change. An idle cluster has no ticks
+ * and is therefore left alone until it runs again.
+ */
+
+#include <linux/cpu.h>
+#include <linux/cpumask.h>
+#include <linux/cpufreq.h>
+#include <linux/init.h>
+#include <linux/irq_work.h>
+#include <linux/kthread.h>
+#include <linux/module.h>
+#include <linux/mutex.h>
+#include <linux/sched.h>
+#include <linux/sched/rt.h>
+#include <linux/slab.h>
+
+#define DEFAULT_WINDOW_US	20000
+#define DEFAULT_TARGET_LOAD	80
+
+struct sg_policy {
+	struct cpufreq_policy *policy;
+	struct task_struct *thread;
+	struct irq_work irq_work;
+	/* serializes frequency changes against GOV_LIMITS and GOV_STOP */
+	struct mutex lock;
+	raw_spinlock_t update_lock;
+	u64 last_window;
+	bool pending;
+	unsigned long busy[NR_CPUS];
+};
+
+struct sg_cpu {
+	struct sched_freq_hook hook;
+	struct sg_policy *sg_policy;
+};
+
+static DEFINE_PER_CPU(struct sg_cpu, sg_cpu);
+
+static unsigned int window_us = DEFAULT_WINDOW_US;
+static unsigned int target_load = DEFAULT_TARGET_LOAD;
+static unsigned int io_is_busy;
+
+static DEFINE_MUTEX(gov_lock);
+static int gov_enable;
+
+static int sg_set_window(void)
+{
+	unsigned long step = usecs_to_jiffies(window_us);
+	u64 start = get_jiffies_64();
+
+	/* start the window on the next multiple of its size */
+	do_div(start, step);
+	return sched_set_window((start + 1) * step, step);
+}
+
+static void sg_update(struct sched_freq_hook *hook, int cpu,
+		      u64 window_start, unsigned int flags)
+{
+	struct sg_policy *sg_policy = container_of(hook, struct sg_cpu,
+						   hook)->sg_policy;
+	unsigned long flags_irq;
+
+	raw_spin_lock_irqsave(&sg_policy->update_lock, flags_irq);
+	if (!(flags & SCHED_FREQ_ALERT) &&
+	    window_start == sg_policy->last_window) {
+		raw_spin_unlock_irqrestore(&sg_policy->update_lock, flags_irq);
+		return;
+	}
+	sg_policy->last_window = window_start;
+	sg_policy->pending = true;
+	raw_spin_unlock_irqrestore(&sg_policy->update_lock, flags_irq);
+
+	irq_work_queue(&sg_policy->irq_work);
+}
+
+static void sg_irq_work(struct irq_work *irq_work)
+{
+	struct sg_policy *sg_policy = container_of(irq_work, struct sg_policy,
+						   irq_work);
+
+	wake_up_process(sg_policy->thread);
+}
+
+static unsigned int sg_next_freq(struct sg_policy *sg_policy)
+{
+	struct cpufreq_policy *policy = sg_policy->policy;
+	unsigned long max_busy = 0;
+	u64 freq;
+	int i;
+
+	sched_get_cpus_busy(sg_policy->busy, policy->cpus);
+	for (i = 0; i < cpumask_weight(policy->cpus); i++)
+		max_busy = max(max_busy, sg_policy->busy[i]);
+
+	/* busy time is in us at the maximum frequency of the cluster */
+	freq = (u64)max_busy * policy->cpuinfo.max_freq * 100;
+	do_div(freq, window_us * target_load);
+
+	return clamp_t(unsigned int, freq, policy->min, policy->max);
+}
+
+static void sg_evaluate(struct sg_policy *sg_policy)
+{
+	struct cpufreq_policy *policy = sg_policy->policy;
+	unsigned int freq;
+
+	mutex_lock(&sg_policy->lock);
+	freq = sg_next_freq(sg_policy);
+	if (freq != policy->cur)
+		__cpufreq_driver_target(policy, freq, CPUFREQ_RELATION_L);
+	mutex_unlock(&sg_policy->lock);
+}
+
+static int sg_thread(void *data)
+{
+	struct sg_policy *sg_policy = data;
+	bool pending;
+
+	while (1) {
+		set_current_state(TASK_INTERRUPTIBLE);
+		if (kthread_should_stop())
+			break;
+
+		raw_spin_lock_irq(&sg_policy->update_lock);
+		pending = sg_policy->pending;
+		sg_policy->pending = false;
+		raw_spin_unlock_irq(&sg_policy->update_lock);
+
+		if (!pending) {
+			schedule();
+			continue;
+		}
+
+		set_current_state(TASK_RUNNING);
+		sg_evaluate(sg_policy);
+	}
+	set_current_state(TASK_RUNNING);
+
+	return 0;
+}
+
+/************************** sysfs interface ************************/
+
+static ssize_t show_window_us(struct kobject *kobj,
+			      struct attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", window_us);
+}
+
+static ssize_t store_window_us(struct kobject *kobj, struct attribute *attr,
+			       const char *buf, size_t count)
+{
+	unsigned int val, old;
+	int ret;
+
+	ret = kstrtouint(buf, 0, &val);
+	if (ret < 0)
+		return ret;
+
+	mutex_lock(&gov_lock);
+	old = window_us;
+	window_us = val;
+	ret = sg_set_window();
+	if (ret)
+		window_us = old;
+	mutex_unlock(&gov_lock);
+
+	return ret ? ret : count;
+}
+
+static ssize_t show_target_load(struct kobject *kobj,
+				struct attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", target_load);
+}
+
+static ssize_t store_target_load(struct kobject *kobj, struct attribute *attr,
+				 const char *buf, size_t count)
+{
+	unsigned int val;
+	int ret;
+
+	ret = kstrtouint(buf, 0, &val);
+	if (ret < 0)
+		return ret;
+	if (!val || val > 100)
+		return -EINVAL;
+
+	target_load = val;
+	return count;
+}
+
+static ssize_t show_io_is_busy(struct kobject *kobj,
+			       struct attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", io_is_busy);
+}
+
+static ssize_t store_io_is_busy(struct kobject *kobj, struct attribute *attr,
+				const char *buf, size_t count)
+{
+	unsigned int val;
+	int ret;
+
+	ret = kstrtouint(buf, 0, &val);
+	if (ret < 0)
+		return ret;
+
+	io_is_busy = !!val;
+	sched_set_io_is_busy(io_is_busy);
+	return count;
+}
+
+define_one_global_rw(window_us);
+define_one_global_rw(target_load);
+define_one_global_rw(io_is_busy);
+
+static struct attribute *sg_attributes[] = {
+	&window_us.attr,
+	&target_load.attr,
+	&io_is_busy.attr,
+	NULL
+};
+
+static struct attribute_group sg_attr_group = {
+	.attrs = sg_attributes,
+	.name = "sched",
+};
+
+/************************** sysfs end ************************/
+
+static int sg_start(struct cpufreq_policy *policy)
+{
+	struct sched_param param = { .sched_priority = MAX_RT_PRIO - 1 };
+	struct sg_policy *sg_policy;
+	int cpu, rc;
+
+	sg_policy = kzalloc(sizeof(*sg_policy), GFP_KERNEL);
+	if (!sg_policy)
+		return -ENOMEM;
+
+	sg_policy->policy = policy;
+	mutex_init(&sg_policy->lock);
+	raw_spin_lock_init(&sg_policy->update_lock);
+	init_irq_work(&sg_policy->irq_work, sg_irq_work);
+
+	sg_policy->thread = kthread_create(sg_thread, sg_policy, "cfsched/%d",
+					   policy->cpu);
+	if (IS_ERR(sg_policy->thread)) {
+		rc = PTR_ERR(sg_policy->thread);
+		kfree(sg_policy);
+		return rc;
+	}
+	sched_setscheduler_nocheck(sg_policy->thread, SCHED_FIFO, &param);
+	wake_up_process(sg_policy->thread);
+
+	mutex_lock(&gov_lock);
+	if (!gov_enable++) {
+		rc = sysfs_create_group(cpufreq_global_kobject,
+					&sg_attr_group);
+		if (rc) {
+			gov_enable--;
+			mutex_unlock(&gov_lock);
+			kthread_stop(sg_policy->thread);
+			kfree(sg_policy);
+			return rc;
+		}
+		sched_set_io_is_busy(io_is_busy);
+		if (sg_set_window())
+			pr_warn("cpufreq_sched: window of %uus rejected\n",
+				window_us);
+	}
+	mutex_unlock(&gov_lock);
+
+	policy->governor_data = sg_policy;
+	for_each_cpu(cpu, policy->cpus) {
+		struct sg_cpu *sg_cpu = &per_cpu(sg_cpu, cpu);
+
+		sg_cpu->sg_policy = sg_policy;
+		sg_cpu->hook.func = sg_update;
+		sched_set_freq_hook(cpu, &sg_cpu->hook);
+	}
+
+	return 0;
+}
+
+static void sg_stop(struct cpufreq_policy *policy)
+{
+	struct sg_policy *sg_policy = policy->governor_data;
+	int cpu;
+
+	for_each_cpu(cpu, policy->cpus)
+		sched_set_freq_hook(cpu, NULL);
+	synchronize_sched();
+	irq_work_sync(&sg_policy->irq_work);
+	kthread_stop(sg_policy->thread);
+
+	mutex_lock(&gov_lock);
+	if (!--gov_enable)
+		sysfs_remove_group(cpufreq_global_kobject, &sg_attr_group);
+	mutex_unlock(&gov_lock);
+
+	policy->governor_data = NULL;
+	kfree(sg_policy);
+}
+
+static void sg_limits(struct cpufreq_policy *policy)
+{
+	struct sg_policy *sg_policy = policy->governor_data;
+
+	mutex_lock(&sg_policy->lock);
+	if (policy->max < policy->cur)
+		__cpufreq_driver_target(policy, policy->max,
+					CPUFREQ_RELATION_H);
+	else if (policy->min > policy->cur)
+		__cpufreq_driver_target(policy, policy->min,
+					CPUFREQ_RELATION_L);
+	mutex_unlock(&sg_policy->lock);
+}
+
+static int cpufreq_governor_sched(struct cpufreq_policy *policy,
+				  unsigned int event)
+{
+	switch (event) {
+	case CPUFREQ_GOV_START:
+		if (!policy->cur)
+			return -EINVAL;
+		return sg_start(policy);
+
+	case CPUFREQ_GOV_STOP:
+		sg_stop(policy);
+		break;
+
+	case CPUFREQ_GOV_LIMITS:
+		sg_limits(policy);
+		break;
+	}
+	return 0;
+}
+
+#ifndef CONFIG_CPU_FREQ_DEFAULT_GOV_SCHED
+static
+#endif
+struct cpufreq_governor cpufreq_gov_sched = {
+	.name = "sched",
+	.governor = cpufreq_governor_sched,
+	.owner = THIS_MODULE,
+};
+
+static int __init cpufreq_gov_sched_init(void)
+{
+	return cpufreq_register_governor(&cpufreq_gov_sched);
+}
+
+#ifdef CONFIG_CPU_FREQ_DEFAULT_GOV_SCHED
+fs_initcall(cpufreq_gov_sched_init);
+#else
+module_init(cpufreq_gov_sched_init);
+#endif
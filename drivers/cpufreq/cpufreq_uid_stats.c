@@ -0,0 +1,325 @@
+/*
+ * drivers/cpufreq/cpufreq_uid_stats.c
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * Per UID, per cluster time in state.
+ *
+ * The time a task runs is charged to the UID of the task and the current
+ * frequency of its cpu at every context switch and scheduler tick. Each
+ * UID entry has a cache line aligned row of counters per cpu, so the hot
+ * path takes no lock: it only ever touches the row of the local cpu, with
+ * interrupts disabled. Readers sum the rows of the cpus of each cluster.
+ *
+ * /proc/uid_time_in_state_bin is a native endian binary dump:
+ *
+ *	u32 nr_clusters
+ *	nr_clusters times:
+ *		u32 nr_freqs
+ *		u32 freq[nr_freqs]			(kHz)
+ *	then for each uid:
+ *		u32 uid
+ *		u32 reserved
+ *		u64 time[sum of nr_freqs]		(us, cluster by cluster)
+ */
+
+#define pr_fmt(fmt) "cpufreq_uid_stats: " fmt
+
+#include <linux/cache.h>
+#include <linux/cpu.h>
+#include <linux/cpufreq.h>
+#include <linux/hashtable.h>
+#include <linux/init.h>
+#include <linux/proc_fs.h>
+#include <linux/rculist.h>
+#include <linux/sched.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+
+#define UID_STATS_HASH_BITS	8
+#define UID_STATS_ROW_ALIGN	(SMP_CACHE_BYTES / sizeof(u64))
+
+struct uid_stats_cluster {
+	unsigned int nr_freqs;
+	unsigned int *freqs;
+};
+
+struct uid_stats_entry {
+	uid_t uid;
+	struct hlist_node hash;
+	struct rcu_head rcu;
+	u64 time[0] ____cacheline_aligned;
+};
+
+static DEFINE_HASHTABLE(uid_stats_hash, UID_STATS_HASH_BITS);
+static DEFINE_SPINLOCK(uid_stats_lock); /* uid_stats_hash updates */
+
+static struct uid_stats_cluster clusters[NR_CPUS];
+static unsigned int nr_clusters;
+static unsigned int nr_freqs_total;
+static size_t entry_size;
+static bool uid_stats_ready;
+
+/* first counter of each cpu's row in uid_stats_entry::time */
+static unsigned int row_offset[NR_CPUS];
+static int cpu_cluster[NR_CPUS] = { [0 ... NR_CPUS - 1] = -1 };
+
+static DEFINE_PER_CPU(u64, last_account);
+static DEFINE_PER_CPU(int, freq_index) = -1;
+
+static struct uid_stats_entry *find_or_register_uid(uid_t uid)
+{
+	struct uid_stats_entry *entry;
+	unsigned long flags;
+
+	hash_for_each_possible_rcu(uid_stats_hash, entry, hash, uid)
+		if (entry->uid == uid)
+			return entry;
+
+	spin_lock_irqsave(&uid_stats_lock, flags);
+	hash_for_each_possible(uid_stats_hash, entry, hash, uid)
+		if (entry->uid == uid)
+			goto out;
+
+	entry = kzalloc(entry_size, GFP_ATOMIC | __GFP_NOWARN);
+	if (entry) {
+		entry->uid = uid;
+		hash_add_rcu(uid_stats_hash, &entry->hash, uid);
+	}
+out:
+	spin_unlock_irqrestore(&uid_stats_lock, flags);
+	return entry;
+}
+
+/**
+ * cpufreq_uid_stats_account - charge the run time of a task
+ * @p: task that ran on this cpu since the last call
+ *
+ * Called by the scheduler on the local cpu, without the runqueue lock,
+ * when @p is switched out and from the tick for the current task.
+ */
+void cpufreq_uid_stats_account(struct task_struct *p)
+{
+	struct uid_stats_entry *entry;
+	unsigned long flags;
+	int cpu, idx;
+	u64 now, delta;
+
+	if (!uid_stats_ready)
+		return;
+
+	local_irq_save(flags);
+	cpu = smp_processor_id();
+	now = sched_clock();
+	delta = now - __this_cpu_read(last_account);
+	__this_cpu_write(last_account, now);
+
+	idx = __this_cpu_read(freq_index);
+	if (idx < 0 || is_idle_task(p))
+		goto out;
+
+	rcu_read_lock();
+	entry = find_or_register_uid(from_kuid_munged(&init_user_ns,
+						      task_uid(p)));
+	if (entry)
+		entry->time[row_offset[cpu] + idx] += delta;
+	rcu_read_unlock();
+out:
+	local_irq_restore(flags);
+}
+
+static void uid_stats_free_rcu(struct rcu_head *rcu)
+{
+	kfree(container_of(rcu, struct uid_stats_entry, rcu));
+}
+
+void cpufreq_uid_stats_remove_uids(uid_t uid_start, uid_t uid_end)
+{
+	struct uid_stats_entry *entry;
+	struct hlist_node *tmp;
+	unsigned long flags;
+
+	spin_lock_irqsave(&uid_stats_lock, flags);
+	for (; uid_start <= uid_end; uid_start++) {
+		hash_for_each_possible_safe(uid_stats_hash, entry, tmp,
+					    hash, uid_start) {
+			if (entry->uid == uid_start) {
+				hash_del_rcu(&entry->hash);
+				call_rcu(&entry->rcu, uid_stats_free_rcu);
+			}
+		}
+	}
+	spin_unlock_irqrestore(&uid_stats_lock, flags);
+}
+
+static int freq_to_index(struct uid_stats_cluster *cl, unsigned int freq)
+{
+	int i;
+
+	for (i = 0; i < cl->nr_freqs; i++)
+		if (cl->freqs[i] == freq)
+			return i;
+	return -1;
+}
+
+static int uid_stats_notifier_trans(struct notifier_block *nb,
+				    unsigned long val, void *data)
+{
+	struct cpufreq_freqs *freq = data;
+	int cl = cpu_cluster[freq->cpu];
+
+	if (val != CPUFREQ_POSTCHANGE || cl < 0)
+		return NOTIFY_OK;
+
+	per_cpu(freq_index, freq->cpu) = freq_to_index(&clusters[cl],
+						       freq->new);
+	return NOTIFY_OK;
+}
+
+static struct notifier_block uid_stats_trans_nb = {
+	.notifier_call = uid_stats_notifier_trans,
+};
+
+static int uid_stats_show(struct seq_file *m, void *v)
+{
+	struct uid_stats_entry *entry;
+	u64 *time;
+	unsigned long bkt;
+	unsigned int i, c, cpu, base;
+	u32 hdr[2];
+
+	seq_write(m, &nr_clusters, sizeof(u32));
+	for (c = 0; c < nr_clusters; c++) {
+		seq_write(m, &clusters[c].nr_freqs, sizeof(u32));
+		seq_write(m, clusters[c].freqs,
+			  clusters[c].nr_freqs * sizeof(u32));
+	}
+
+	time = kmalloc(nr_freqs_total * sizeof(u64), GFP_KERNEL);
+	if (!time)
+		return -ENOMEM;
+
+	rcu_read_lock();
+	hash_for_each_rcu(uid_stats_hash, bkt, entry, hash) {
+		memset(time, 0, nr_freqs_total * sizeof(u64));
+		for_each_possible_cpu(cpu) {
+			if (cpu_cluster[cpu] < 0)
+				continue;
+			c = cpu_cluster[cpu];
+			for (base = 0, i = 0; i < c; i++)
+				base += clusters[i].nr_freqs;
+			for (i = 0; i < clusters[c].nr_freqs; i++)
+				time[base + i] +=
+					entry->time[row_offset[cpu] + i];
+		}
+		for (i = 0; i < nr_freqs_total; i++)
+			do_div(time[i], NSEC_PER_USEC);
+
+		hdr[0] = entry->uid;
+		hdr[1] = 0;
+		seq_write(m, hdr, sizeof(hdr));
+		seq_write(m, time, nr_freqs_total * sizeof(u64));
+	}
+	rcu_read_unlock();
+
+	kfree(time);
+	return 0;
+}
+
+static int uid_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, uid_stats_show, NULL);
+}
+
+static const struct file_operations uid_stats_fops = {
+	.open		= uid_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init uid_stats_add_cluster(struct cpufreq_policy *policy)
+{
+	struct cpufreq_frequency_table *table;
+	struct uid_stats_cluster *cl = &clusters[nr_clusters];
+	unsigned int i, n = 0;
+
+	table = cpufreq_frequency_get_table(policy->cpu);
+	if (!table)
+		return -ENODEV;
+
+	for (i = 0; table[i].frequency != CPUFREQ_TABLE_END; i++)
+		if (table[i].frequency != CPUFREQ_ENTRY_INVALID)
+			n++;
+
+	cl->freqs = kcalloc(n, sizeof(*cl->freqs), GFP_KERNEL);
+	if (!cl->freqs)
+		return -ENOMEM;
+
+	for (i = 0; table[i].frequency != CPUFREQ_TABLE_END; i++)
+		if (table[i].frequency != CPUFREQ_ENTRY_INVALID &&
+		    freq_to_index(cl, table[i].frequency) < 0)
+			cl->freqs[cl->nr_freqs++] = table[i].frequency;
+
+	nr_freqs_total += cl->nr_freqs;
+	return nr_clusters++;
+}
+
+static int __init cpufreq_uid_stats_init(void)
+{
+	struct cpufreq_policy *policy;
+	unsigned int cpu, other, rows = 0;
+	int cl;
+
+	for_each_possible_cpu(cpu) {
+		policy = cpufreq_cpu_get(cpu);
+		if (!policy)
+			continue;
+
+		cl = -1;
+		for (other = 0; other < cpu; other++) {
+			if (cpu_cluster[other] >= 0 &&
+			    cpumask_test_cpu(other, policy->related_cpus)) {
+				cl = cpu_cluster[other];
+				break;
+			}
+		}
+		if (cl < 0)
+			cl = uid_stats_add_cluster(policy);
+		if (cl >= 0) {
+			cpu_cluster[cpu] = cl;
+			row_offset[cpu] = rows;
+			rows += ALIGN(clusters[cl].nr_freqs,
+				      UID_STATS_ROW_ALIGN);
+			per_cpu(freq_index, cpu) =
+				freq_to_index(&clusters[cl], policy->cur);
+		}
+		cpufreq_cpu_put(policy);
+	}
+
+	if (!nr_clusters) {
+		pr_err("no cpufreq policies\n");
+		return -ENODEV;
+	}
+
+	entry_size = sizeof(struct uid_stats_entry) + rows * sizeof(u64);
+	cpufreq_register_notifier(&uid_stats_trans_nb,
+				  CPUFREQ_TRANSITION_NOTIFIER);
+	proc_create("uid_time_in_state_bin", 0444, NULL, &uid_stats_fops);
+
+	for_each_possible_cpu(cpu)
+		per_cpu(last_account, cpu) = sched_clock();
+	smp_wmb();
+	uid_stats_ready = true;
+
+	return 0;
+}
+late_initcall(cpufreq_uid_stats_init);
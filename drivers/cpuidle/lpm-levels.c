@@ -34,6 +34,9 @@
 #include <linux/moduleparam.h>
 #include <linux/sched.h>
 #include <linux/cpu_pm.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/regulator/rpm-smd-regulator.h>
 #include <soc/qcom/spm.h>
 #include <soc/qcom/pm.h>
 #include <soc/qcom/rpm-notifier.h>
@@ -108,6 +111,19 @@ module_param_named(
 	print_parsed_dt, print_parsed_dt, bool, S_IRUGO | S_IWUSR | S_IWGRP
 );
 
+static bool lpm_prediction = true;
+module_param_named(
+	lpm_prediction, lpm_prediction, bool, S_IRUGO | S_IWUSR | S_IWGRP
+);
+
+static DEFINE_PER_CPU(struct lpm_history, cpu_history);
+
+static bool lpm_cluster_coordinate = true;
+module_param_named(
+	cluster_coordinate, lpm_cluster_coordinate, bool,
+	S_IRUGO | S_IWUSR | S_IWGRP
+);
+
 s32 msm_cpuidle_get_deep_idle_latency(void)
 {
 	return 10;
@@ -228,6 +244,33 @@ int set_cci_mode(struct low_power_ops *ops, int mode, bool notify_rpm)
 	return msm_spm_config_low_power_mode(ops->spm, mode, notify_rpm);
 }
 
+static void lpm_history_add(struct lpm_history *history, uint32_t resi_us)
+{
+	history->resi[history->hptr] = resi_us;
+	history->hptr = (history->hptr + 1) % LPM_HISTORY_SAMPLES;
+	if (history->nsamp < LPM_HISTORY_SAMPLES)
+		history->nsamp++;
+}
+
+/*
+ * Longest of the recent residencies, or ~0U while the history is not full
+ * or prediction is disabled. A level whose break-even time exceeds it has
+ * been useless for every one of the last LPM_HISTORY_SAMPLES idle periods.
+ */
+static uint32_t lpm_history_predict(struct lpm_history *history)
+{
+	uint32_t max = 0;
+	int i;
+
+	if (!lpm_prediction || history->nsamp < LPM_HISTORY_SAMPLES)
+		return ~0U;
+
+	for (i = 0; i < LPM_HISTORY_SAMPLES; i++)
+		max = max(max, history->resi[i]);
+
+	return max;
+}
+
 static int cpu_power_select(struct cpuidle_device *dev,
 		struct lpm_cpu *cpu, int *index)
 {
@@ -244,11 +287,13 @@ static int cpu_power_select(struct cpuidle_device *dev,
 	uint32_t lvl_latency_us = 0;
 	uint32_t lvl_overhead_us = 0;
 	uint32_t lvl_overhead_energy = 0;
+	uint32_t predicted_us;
 
 	if (!cpu)
 		return -EINVAL;
 
 	next_event_us = (uint32_t)(ktime_to_us(get_next_event_time(dev->cpu)));
+	predicted_us = lpm_history_predict(&per_cpu(cpu_history, dev->cpu));
 
 	for (i = 0; i < cpu->nlevels; i++) {
 		struct lpm_cpu_level *level = &cpu->levels[i];
@@ -283,6 +328,11 @@ static int cpu_power_select(struct cpuidle_device *dev,
 		if (next_wakeup_us <= pwr_params->time_overhead_us)
 			continue;
 
+		/* recent wakeups were all earlier than this level breaks even */
+		if (best_level >= 0 &&
+				predicted_us <= pwr_params->time_overhead_us)
+			continue;
+
 		/*
 		 * If wakeup time greater than overhead by a factor of 1000
 		 * assume that core steady state power dominates the power
@@ -356,6 +406,67 @@ static uint64_t get_cluster_sleep_time(struct lpm_cluster *cluster,
 		return 0;
 }
 
+static bool cluster_level_is_pc(struct lpm_cluster *cluster, int idx)
+{
+	int i;
+
+	for (i = 0; i < cluster->ndevices; i++)
+		if (cluster->levels[idx].mode[i] == MSM_SPM_MODE_POWER_COLLAPSE)
+			return true;
+	return false;
+}
+
+/*
+ * Time until the next event of the idle cpus of the other clusters under
+ * the same parent; such a wakeup is likely to hand work back to this
+ * cluster, e.g. through up-migration of the task it wakes.
+ */
+static uint32_t get_sibling_sleep_time(struct lpm_cluster *cluster)
+{
+	struct lpm_cluster *sibling;
+	struct tick_device *td;
+	ktime_t next_event, now;
+	int cpu;
+
+	if (!cluster->parent)
+		return ~0U;
+
+	next_event.tv64 = KTIME_MAX;
+	list_for_each_entry(sibling, &cluster->parent->child, list) {
+		if (sibling == cluster)
+			continue;
+
+		for_each_cpu_and(cpu, &sibling->child_cpus, cpu_online_mask) {
+			if (!idle_cpu(cpu))
+				continue;
+			td = &per_cpu(tick_cpu_device, cpu);
+			if (td->evtdev->next_event.tv64 < next_event.tv64)
+				next_event.tv64 = td->evtdev->next_event.tv64;
+		}
+	}
+
+	if (next_event.tv64 == KTIME_MAX)
+		return ~0U;
+
+	now = ktime_get();
+	if (next_event.tv64 <= now.tv64)
+		return 0;
+
+	return (uint32_t)min_t(s64, ktime_us_delta(next_event, now), ~0U);
+}
+
+static void cluster_pc_residency_add(struct lpm_cluster *cluster, int idx,
+		uint32_t resi_us)
+{
+	int bucket = 0;
+
+	if (resi_us >= 128)
+		bucket = min(ilog2(resi_us) - 6, LPM_PC_RESIDENCY_BUCKETS - 1);
+
+	cluster->pc_residency[bucket]++;
+	trace_cluster_pc_residency(cluster->cluster_name, idx, resi_us);
+}
+
 static int cluster_select(struct lpm_cluster *cluster, bool from_idle)
 {
 	int best_level = -1;
@@ -365,11 +476,17 @@ static int cluster_select(struct lpm_cluster *cluster, bool from_idle)
 	struct cpumask mask;
 	uint32_t latency_us = ~0U;
 	uint32_t sleep_us;
+	uint32_t predicted_us = ~0U;
+	uint32_t sibling_us = ~0U;
 
 	if (!cluster)
 		return -EINVAL;
 
 	sleep_us = (uint32_t)get_cluster_sleep_time(cluster, NULL, from_idle);
+	if (from_idle)
+		predicted_us = lpm_history_predict(&cluster->history);
+	if (from_idle && lpm_cluster_coordinate)
+		sibling_us = get_sibling_sleep_time(cluster);
 
 	if (cpumask_and(&mask, cpu_online_mask, &cluster->child_cpus))
 		latency_us = pm_qos_request_for_cpumask(PM_QOS_CPU_DMA_LATENCY,
@@ -407,6 +524,19 @@ static int cluster_select(struct lpm_cluster *cluster, bool from_idle)
 		if (sleep_us < pwr_params->time_overhead_us)
 			continue;
 
+		if (best_level >= 0 &&
+				predicted_us <= pwr_params->time_overhead_us)
+			continue;
+
+		/* keep the cache retained if a sibling will wake it first */
+		if (best_level >= 0 && sibling_us < pwr_params->time_overhead_us
+				&& cluster_level_is_pc(cluster, i)) {
+			cluster->retained++;
+			trace_cluster_retain(cluster->cluster_name, i, sleep_us,
+					sibling_us);
+			continue;
+		}
+
 		if (suspend_in_progress && from_idle && level->notify_rpm)
 			continue;
 
@@ -475,6 +605,13 @@ static int cluster_configure(struct lpm_cluster *cluster, int idx,
 
 		us = get_cluster_sleep_time(cluster, &nextcpu, from_idle);
 
+		ret = rpm_regulator_flush_sleep_requests();
+		if (ret) {
+			pr_info("Failed to flush regulator sleep requests rc = %d\n",
+					ret);
+			goto failed_set_mode;
+		}
+
 		ret = msm_rpm_enter_sleep(0, &nextcpu);
 		if (ret) {
 			pr_info("Failed msm_rpm_enter_sleep() rc = %d\n", ret);
@@ -536,6 +673,8 @@ static void cluster_prepare(struct lpm_cluster *cluster,
 		spin_unlock(&cluster->sync_lock);
 		return;
 	}
+	if (from_idle)
+		cluster->sync_time_us = ktime_to_us(ktime_get());
 	spin_unlock(&cluster->sync_lock);
 
 	i = cluster_select(cluster, from_idle);
@@ -556,6 +695,7 @@ static void cluster_unprepare(struct lpm_cluster *cluster,
 	struct lpm_cluster_level *level;
 	bool first_cpu;
 	int last_level, i, ret;
+	uint32_t resi_us = 0;
 
 	if (!cluster)
 		return;
@@ -570,6 +710,13 @@ static void cluster_unprepare(struct lpm_cluster *cluster,
 	cpumask_andnot(&cluster->num_childs_in_sync,
 			&cluster->num_childs_in_sync, cpu);
 
+	/* the cluster was idle from the last cpu going down until now */
+	if (first_cpu && cluster->sync_time_us) {
+		resi_us = ktime_to_us(ktime_get()) - cluster->sync_time_us;
+		lpm_history_add(&cluster->history, resi_us);
+		cluster->sync_time_us = 0;
+	}
+
 	for (i = 0; i < cluster->nlevels; i++) {
 		struct lpm_cluster_level *lvl = &cluster->levels[i];
 
@@ -584,6 +731,11 @@ static void cluster_unprepare(struct lpm_cluster *cluster,
 	lpm_stats_cluster_exit(cluster->stats, cluster->last_level, true);
 
 	level = &cluster->levels[cluster->last_level];
+	if (from_idle && resi_us < level->pwr.time_overhead_us)
+		lpm_stats_cluster_mispredict(cluster->stats,
+				cluster->last_level);
+	if (from_idle && cluster_level_is_pc(cluster, cluster->last_level))
+		cluster_pc_residency_add(cluster, cluster->last_level, resi_us);
 	if (level->notify_rpm) {
 		msm_rpm_exit_sleep();
 
@@ -709,6 +861,10 @@ static int lpm_cpuidle_enter(struct cpuidle_device *dev,
 	do_div(time, 1000);
 	dev->last_residency = (int)time;
 
+	lpm_history_add(&per_cpu(cpu_history, dev->cpu), (uint32_t)time);
+	if (success && time < pwr_params->time_overhead_us)
+		lpm_stats_cpu_mispredict(idx);
+
 exit:
 	local_irq_enable();
 	trace_cpu_idle_rcuidle(PWR_EVENT_EXIT, dev->cpu);
@@ -923,6 +1079,41 @@ static const struct platform_suspend_ops lpm_suspend_ops = {
 	.wake = lpm_suspend_wake,
 };
 
+static void pc_residency_print(struct seq_file *m, struct lpm_cluster *cl)
+{
+	struct lpm_cluster *child;
+	int i;
+
+	seq_printf(m, "%s: retained %u\n", cl->cluster_name, cl->retained);
+	seq_printf(m, "\t<%6uus: %u\n", 128, cl->pc_residency[0]);
+	for (i = 1; i < LPM_PC_RESIDENCY_BUCKETS - 1; i++)
+		seq_printf(m, "\t<%6uus: %u\n", 1U << (i + 7),
+				cl->pc_residency[i]);
+	seq_printf(m, "\t>=%5uus: %u\n", 1U << (i + 6), cl->pc_residency[i]);
+
+	list_for_each_entry(child, &cl->child, list)
+		pc_residency_print(m, child);
+}
+
+static int pc_residency_show(struct seq_file *m, void *v)
+{
+	if (lpm_root_node)
+		pc_residency_print(m, lpm_root_node);
+	return 0;
+}
+
+static int pc_residency_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, pc_residency_show, NULL);
+}
+
+static const struct file_operations pc_residency_fops = {
+	.open		= pc_residency_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 static int lpm_probe(struct platform_device *pdev)
 {
 	int ret;
@@ -963,6 +1154,8 @@ static int lpm_probe(struct platform_device *pdev)
 	lpm_debug = dma_alloc_coherent(&pdev->dev, size,
 			&lpm_debug_phys, GFP_KERNEL);
 	register_cluster_lpm_stats(lpm_root_node, NULL);
+	debugfs_create_file("lpm_pc_residency", S_IRUGO, NULL, NULL,
+			&pc_residency_fops);
 
 	ret = cluster_cpuidle_register(lpm_root_node);
 	if (ret) {
@@ -14,6 +14,9 @@
 #include <soc/qcom/spm.h>
 
 #define NR_LPM_LEVELS 8
+#define LPM_HISTORY_SAMPLES 8
+/* bucket 0 is < 128us, bucket n is [2^(n+6), 2^(n+7)) us, the last is open */
+#define LPM_PC_RESIDENCY_BUCKETS 14
 
 struct lpm_lookup_table {
 	uint32_t modes;
@@ -27,6 +30,13 @@ struct power_params {
 	uint32_t time_overhead_us;	/* Enter + exit overhead */
 };
 
+/* Recent actual idle residencies, in us */
+struct lpm_history {
+	uint32_t resi[LPM_HISTORY_SAMPLES];
+	int nsamp;
+	int hptr;
+};
+
 struct lpm_cpu_level {
 	const char *name;
 	enum msm_pm_sleep_mode mode;
@@ -88,6 +98,10 @@ struct lpm_cluster {
 	struct lpm_cluster *parent;
 	struct lpm_stats *stats;
 	bool no_saw_devices;
+	struct lpm_history history;
+	uint64_t sync_time_us;
+	uint32_t pc_residency[LPM_PC_RESIDENCY_BUCKETS];
+	uint32_t retained;
 };
 
 int set_l2_mode(struct low_power_ops *ops, int mode, bool notify_rpm);
@@ -22,6 +22,9 @@
 #include <linux/device-mapper.h>
 #include <linux/blk_types.h>
 #include <linux/blkdev.h>
+#include <linux/blk-crypt.h>
+#include <linux/slab.h>
+#include <asm/cacheflush.h>
 #include <crypto/ice.h>
 #include "iceregs.h"
 
@@ -41,6 +44,40 @@
 #define TZ_OS_KS_RESTORE_KEY_ID_PARAM_ID \
 	TZ_SYSCALL_CREATE_PARAM_ID_0
 
+#define TZ_OWNER_SIP			2
+#define TZ_SVC_ES			16	/* Enterprise Security */
+
+#define TZ_ES_CONFIG_SET_ICE_KEY_ID \
+	TZ_SYSCALL_CREATE_SMC_ID(TZ_OWNER_SIP, TZ_SVC_ES, 0x04)
+
+#define TZ_ES_CONFIG_SET_ICE_KEY_PARAM_ID \
+	SCM_ARGS(5, SCM_VAL, SCM_RW, SCM_VAL, SCM_RW, SCM_VAL)
+
+/*
+ * LUT slots handed out to inline file based encryption. The slots below
+ * QCOM_ICE_FBE_FIRST_SLOT are left to TZ, which keeps the full disk
+ * encryption key there and restores it after a reset.
+ */
+#define QCOM_ICE_NUM_KEY_SLOTS		32
+#define QCOM_ICE_FBE_FIRST_SLOT		2
+#define QCOM_ICE_FBE_NUM_SLOTS \
+	(QCOM_ICE_NUM_KEY_SLOTS - QCOM_ICE_FBE_FIRST_SLOT)
+/* AES-256-XTS: the data key followed by the tweak key */
+#define QCOM_ICE_FBE_KEY_SIZE		64
+
+/*
+ * A LUT slot and the key it holds. Slots nobody has a request in flight
+ * with sit on ice_device.key_lru, least recently used first, and are the
+ * ones a key that misses evicts.
+ */
+struct ice_key_slot {
+	struct list_head	lru;
+	int			refcnt;
+	bool			valid;	/* programmed since the last reset */
+	unsigned int		size;
+	u8			raw[QCOM_ICE_FBE_KEY_SIZE];
+};
+
 const struct qcom_ice_variant_ops qcom_ice_ops;
 static LIST_HEAD(ice_devices);
 /*
@@ -59,6 +96,9 @@ struct ice_device {
 	ice_error_cb		error_cb;
 	void			*host_controller_data; /* UFS/EMMC/other? */
 	spinlock_t		lock;
+	struct ice_key_slot	key_slots[QCOM_ICE_FBE_NUM_SLOTS];
+	struct list_head	key_lru;
+	u8			*key_buf;	/* key handed to TZ */
 };
 
 static void qcom_ice_low_power_mode_enable(struct ice_device *ice_dev)
@@ -259,6 +299,146 @@ out:
 	return rc;
 }
 
+static void qcom_ice_init_key_slots(struct ice_device *ice_dev)
+{
+	int i;
+
+	INIT_LIST_HEAD(&ice_dev->key_lru);
+	for (i = 0; i < QCOM_ICE_FBE_NUM_SLOTS; i++)
+		list_add_tail(&ice_dev->key_slots[i].lru, &ice_dev->key_lru);
+}
+
+/*
+ * A reset or power collapse wipes the LUT. Keys are programmed again the
+ * next time a request uses them.
+ */
+static void qcom_ice_invalidate_key_slots(struct ice_device *ice_dev)
+{
+	unsigned long flags;
+	int i;
+
+	spin_lock_irqsave(&ice_dev->lock, flags);
+	for (i = 0; i < QCOM_ICE_FBE_NUM_SLOTS; i++)
+		ice_dev->key_slots[i].valid = false;
+	spin_unlock_irqrestore(&ice_dev->lock, flags);
+}
+
+/*
+ * Called with ice_dev->lock held from the request submission path, hence
+ * the atomic scm call. It only happens on a key cache miss.
+ */
+static int qcom_ice_program_key(struct ice_device *ice_dev,
+				struct ice_key_slot *slot)
+{
+	struct scm_desc desc = {0};
+	unsigned int half = slot->size / 2;
+	u8 *buf = ice_dev->key_buf;
+	int ret;
+
+	memcpy(buf, slot->raw, slot->size);
+	dmac_flush_range(buf, buf + slot->size);
+
+	desc.arginfo = TZ_ES_CONFIG_SET_ICE_KEY_PARAM_ID;
+	desc.args[0] = QCOM_ICE_FBE_FIRST_SLOT + (slot - ice_dev->key_slots);
+	desc.args[1] = virt_to_phys(buf);
+	desc.args[2] = half;
+	desc.args[3] = virt_to_phys(buf + half);
+	desc.args[4] = half;
+	ret = scm_call2_atomic(TZ_ES_CONFIG_SET_ICE_KEY_ID, &desc);
+
+	memset(buf, 0, slot->size);
+	dmac_flush_range(buf, buf + slot->size);
+
+	if (ret)
+		pr_err("%s: Error: 0x%x\n", __func__, ret);
+	slot->valid = !ret;
+	return ret;
+}
+
+/* must be called with ice_dev->lock held */
+static struct ice_key_slot *qcom_ice_find_key_slot(struct ice_device *ice_dev,
+						   struct blk_crypt_key *key)
+{
+	struct ice_key_slot *slot;
+	int i;
+
+	for (i = 0; i < QCOM_ICE_FBE_NUM_SLOTS; i++) {
+		slot = &ice_dev->key_slots[i];
+		if (slot->size == key->size &&
+		    !memcmp(slot->raw, key->raw, key->size))
+			return slot;
+	}
+	return NULL;
+}
+
+/**
+ * qcom_ice_get_key_slot() - take a reference on the LUT slot holding a key
+ * @ice_dev:	ICE device
+ * @key:	the key of the request
+ *
+ * A key that is not in the LUT evicts the least recently used slot that
+ * has no request in flight.
+ *
+ * Return: the LUT index of the key, -EAGAIN if every slot is in use by
+ * requests in flight, another negative error code otherwise.
+ */
+static int qcom_ice_get_key_slot(struct ice_device *ice_dev,
+				 struct blk_crypt_key *key)
+{
+	struct ice_key_slot *slot;
+	unsigned long flags;
+	int ret;
+
+	if (key->size != QCOM_ICE_FBE_KEY_SIZE)
+		return -EINVAL;
+
+	spin_lock_irqsave(&ice_dev->lock, flags);
+	slot = qcom_ice_find_key_slot(ice_dev, key);
+	if (!slot) {
+		if (list_empty(&ice_dev->key_lru)) {
+			ret = -EAGAIN;
+			goto out;
+		}
+		slot = list_first_entry(&ice_dev->key_lru,
+					struct ice_key_slot, lru);
+		slot->size = key->size;
+		memcpy(slot->raw, key->raw, key->size);
+		slot->valid = false;
+	}
+
+	if (!slot->valid) {
+		ret = qcom_ice_program_key(ice_dev, slot);
+		if (ret) {
+			/* don't match the key against a slot that lacks it */
+			if (!slot->refcnt) {
+				slot->size = 0;
+				memset(slot->raw, 0, sizeof(slot->raw));
+			}
+			goto out;
+		}
+	}
+
+	if (!slot->refcnt++)
+		list_del_init(&slot->lru);
+	ret = QCOM_ICE_FBE_FIRST_SLOT + (slot - ice_dev->key_slots);
+out:
+	spin_unlock_irqrestore(&ice_dev->lock, flags);
+	return ret;
+}
+
+static void qcom_ice_put_key_slot(struct ice_device *ice_dev,
+				  struct blk_crypt_key *key)
+{
+	struct ice_key_slot *slot;
+	unsigned long flags;
+
+	spin_lock_irqsave(&ice_dev->lock, flags);
+	slot = qcom_ice_find_key_slot(ice_dev, key);
+	if (!WARN_ON(!slot || !slot->refcnt) && !--slot->refcnt)
+		list_add_tail(&slot->lru, &ice_dev->key_lru);
+	spin_unlock_irqrestore(&ice_dev->lock, flags);
+}
+
 static int qcom_ice_probe(struct platform_device *pdev)
 {
 	struct ice_device *ice_dev;
@@ -288,6 +468,15 @@ static int qcom_ice_probe(struct platform_device *pdev)
 		goto err_ice_dev;
 	}
 
+	/* TZ reads the key by physical address, so it can't be on the stack */
+	ice_dev->key_buf = kzalloc(QCOM_ICE_FBE_KEY_SIZE, GFP_KERNEL);
+	if (!ice_dev->key_buf) {
+		rc = -ENOMEM;
+		goto err_ice_dev;
+	}
+	spin_lock_init(&ice_dev->lock);
+	qcom_ice_init_key_slots(ice_dev);
+
 	if (pdev->dev.of_node)
 		rc = qcom_ice_get_device_tree_data(pdev, ice_dev);
 	else {
@@ -311,6 +500,7 @@ static int qcom_ice_probe(struct platform_device *pdev)
 	goto out;
 
 err_ice_dev:
+	kfree(ice_dev->key_buf);
 	kfree(ice_dev);
 out:
 	return rc;
@@ -332,6 +522,8 @@ static int qcom_ice_remove(struct platform_device *pdev)
 		iounmap(ice_dev->mmio);
 
 	list_del_init(&ice_dev->list);
+	kzfree(ice_dev->key_buf);
+	memset(ice_dev->key_slots, 0, sizeof(ice_dev->key_slots));
 	kfree(ice_dev);
 
 	return 1;
@@ -543,6 +735,7 @@ static void qcom_ice_finish_power_collapse(void *data, async_cookie_t cookie)
 		if (qcom_ice_restore_config())
 			ice_dev->error_cb(ice_dev->host_controller_data,
 					ICE_ERROR_ICE_KEY_RESTORE_FAILED);
+		qcom_ice_invalidate_key_slots(ice_dev);
 
 		if (ice_dev->is_clear_irq_pending)
 			qcom_ice_clear_irq(ice_dev);
@@ -620,7 +813,9 @@ static int qcom_ice_config(struct platform_device *pdev, struct request *req,
 {
 	struct ice_crypto_setting *crypto_data;
 	struct ice_device *ice_dev;
+	struct blk_crypt_key *key;
 	union map_info *info;
+	int ret;
 
 	if (!pdev || !req || !setting) {
 		pr_err("%s: Invalid params passed\n", __func__);
@@ -642,6 +837,28 @@ static int qcom_ice_config(struct platform_device *pdev, struct request *req,
 		return 0;
 	}
 
+	/* file based encryption, the key came down with the bio */
+	key = bio_crypt_key(req->bio);
+	if (key) {
+		ice_dev = platform_get_drvdata(pdev);
+		if (!ice_dev || ice_dev->is_ice_disable_fuse_blown)
+			return -ENODEV;
+
+		ret = qcom_ice_get_key_slot(ice_dev, key);
+		if (ret < 0)
+			return ret;
+
+		setting->crypto_data.key_size = ICE_CRYPTO_KEY_SIZE_256;
+		setting->crypto_data.algo_mode = ICE_CRYPTO_ALGO_MODE_AES_XTS;
+		setting->crypto_data.key_mode = ICE_CRYPTO_USE_LUT_SW_KEY;
+		setting->crypto_data.key_index = ret;
+		if (rq_data_dir(req) == WRITE)
+			setting->encr_bypass = false;
+		else
+			setting->decr_bypass = false;
+		return 0;
+	}
+
 	/*
 	 * info field in req->end_io_data could be used by mulitple dm or
 	 * non-dm entities. To ensure that we are running operation on dm
@@ -692,6 +909,34 @@ static int qcom_ice_config(struct platform_device *pdev, struct request *req,
 }
 EXPORT_SYMBOL(qcom_ice_config);
 
+/*
+ * Drops the LUT slot reference qcom_ice_config() took for a request that
+ * carries its own key.
+ */
+static int qcom_ice_config_end(struct platform_device *pdev,
+			struct request *req)
+{
+	struct ice_device *ice_dev;
+	struct blk_crypt_key *key;
+
+	if (!pdev || !req) {
+		pr_err("%s: Invalid params passed\n", __func__);
+		return -EINVAL;
+	}
+
+	key = bio_crypt_key(req->bio);
+	if (!key)
+		return 0;
+
+	ice_dev = platform_get_drvdata(pdev);
+	if (!ice_dev)
+		return -ENODEV;
+
+	qcom_ice_put_key_slot(ice_dev, key);
+	return 0;
+}
+EXPORT_SYMBOL(qcom_ice_config_end);
+
 static int qcom_ice_status(struct platform_device *pdev)
 {
 	struct ice_device *ice_dev;
@@ -729,6 +974,7 @@ const struct qcom_ice_variant_ops qcom_ice_ops = {
 	.resume           = qcom_ice_resume,
 	.suspend          = qcom_ice_suspend,
 	.config           = qcom_ice_config,
+	.config_end       = qcom_ice_config_end,
 	.status           = qcom_ice_status,
 };
 
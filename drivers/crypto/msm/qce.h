@@ -34,6 +34,11 @@
 
 #define AES_CE_BLOCK_SIZE		16
 
+/* max ablkcipher requests chained into one engine transfer */
+#define QCE_MAX_BATCH			4
+/* largest request accepted as part of a chained transfer */
+#define QCE_BATCH_MAX_LEN		(16 * 1024)
+
 /* key size in bytes */
 #define HMAC_KEY_SIZE			(SHA1_DIGESTSIZE)    /* hmac-sha1 */
 #define SHA_HMAC_KEY_SIZE		64
@@ -123,6 +128,7 @@ struct ce_hw_support {
 	bool use_sw_hmac_algo;
 	bool use_sw_aes_ccm_algo;
 	bool clk_mgmt_sus_res;
+	unsigned int max_batch; /* ablkcipher requests per transfer */
 	unsigned int ce_device;
 	unsigned int ce_hw_instance;
 };
@@ -179,6 +185,8 @@ void *qce_open(struct platform_device *pdev, int *rc);
 int qce_close(void *handle);
 int qce_aead_req(void *handle, struct qce_req *req);
 int qce_ablk_cipher_req(void *handle, struct qce_req *req);
+int qce_ablk_cipher_req_batch(void *handle, struct qce_req *req,
+				unsigned int nreq);
 int qce_hw_support(void *handle, struct ce_hw_support *support);
 int qce_process_sha_req(void *handle, struct qce_sha_req *s_req);
 int qce_enable_clk(void *handle);
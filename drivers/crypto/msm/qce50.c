@@ -41,6 +41,7 @@
 #define CRYPTO_CONFIG_RESET 0xE001F
 #define QCE_MAX_NUM_DSCR    0x500
 #define QCE_SECTOR_SIZE	    0x200
+#define QCE_BATCH_CMDLIST_SIZE	0x400
 #define CE_CLK_100MHZ	100000000
 #define CE_CLK_DIV	1000000
 
@@ -57,6 +58,21 @@ struct bam_registration_info {
 };
 static LIST_HEAD(qce50_bam_list);
 
+/*
+ * One ablkcipher request of a chained transfer. The cipher command list
+ * is patched in place and then copied to the slot, so every request of
+ * the chain carries its own key, iv and segment size.
+ */
+struct qce_batch_slot {
+	void *areq;
+	qce_comp_func_ptr_t qce_cb;
+	enum qce_cipher_mode_enum mode;
+	int src_nents;
+	int dst_nents;
+	unsigned char *cmdlist;		/* command list copy */
+	struct ce_result_dump_format *result;	/* result dump of request */
+};
+
 /*
  * CE HW device structure.
  * Each engine has an instance of the structure.
@@ -113,6 +129,9 @@ struct qce_device {
 	bool use_sw_ahash_algo;
 	bool use_sw_hmac_algo;
 	bool use_sw_aes_ccm_algo;
+
+	struct qce_batch_slot batch[QCE_MAX_BATCH];
+	unsigned int batch_cnt;		/* requests in chained transfer */
 };
 
 /* Standard initialization vector for SHA-1, source: FIPS 180-2 */
@@ -2249,6 +2268,74 @@ static int _ablk_cipher_complete(struct qce_device *pce_dev)
 	return 0;
 };
 
+static int _ablk_cipher_batch_complete(struct qce_device *pce_dev)
+{
+	struct ablkcipher_request *areq;
+	struct qce_batch_slot *slot;
+	unsigned char iv[NUM_OF_CRYPTO_CNTR_IV_REG * CRYPTO_REG_SIZE];
+	uint32_t status;
+	int32_t result_status;
+	unsigned int i, cnt;
+
+	cnt = pce_dev->batch_cnt;
+	pce_dev->batch_cnt = 0;
+	for (i = 0; i < cnt; i++) {
+		slot = &pce_dev->batch[i];
+		areq = (struct ablkcipher_request *) slot->areq;
+		if (areq->src != areq->dst)
+			qce_dma_unmap_sg(pce_dev->pdev, areq->dst,
+				slot->dst_nents, DMA_FROM_DEVICE);
+		qce_dma_unmap_sg(pce_dev->pdev, areq->src, slot->src_nents,
+			(areq->src == areq->dst) ? DMA_BIDIRECTIONAL :
+							DMA_TO_DEVICE);
+	}
+
+	/* read status before unlock */
+	status = readl_relaxed(pce_dev->iobase + CRYPTO_STATUS_REG);
+
+	if (_qce_unlock_other_pipes(pce_dev))
+		return -EINVAL;
+
+	/*
+	 * The device status covers the whole chain, the engine stops at the
+	 * first failing request, so an error fails every request of it.
+	 */
+	if (status & ((1 << CRYPTO_SW_ERR) | (1 << CRYPTO_AXI_ERR)
+			| (1 <<  CRYPTO_HSD_ERR))) {
+		pr_err("ablk_cipher batch operation error. Status %x\n",
+				status);
+		result_status = -ENXIO;
+	} else if (pce_dev->ce_sps.consumer_status |
+				pce_dev->ce_sps.producer_status)  {
+		pr_err("ablk_cipher batch sps operation error. sps status %x %x\n",
+				pce_dev->ce_sps.consumer_status,
+				pce_dev->ce_sps.producer_status);
+		result_status = -ENXIO;
+	} else if ((status & (1 << CRYPTO_OPERATION_DONE)) == 0) {
+		pr_err("ablk_cipher batch operation not done? Status %x, sps status %x %x\n",
+			status,
+			pce_dev->ce_sps.consumer_status,
+			pce_dev->ce_sps.producer_status);
+		result_status = -ENXIO;
+	} else {
+		result_status = 0;
+	}
+
+	for (i = 0; i < cnt; i++) {
+		slot = &pce_dev->batch[i];
+		if (slot->mode == QCE_MODE_ECB) {
+			slot->qce_cb(slot->areq, NULL, NULL,
+					pce_dev->ce_sps.consumer_status |
+					result_status);
+		} else {
+			memcpy(iv, (char *)(slot->result->encr_cntr_iv),
+					sizeof(iv));
+			slot->qce_cb(slot->areq, NULL, iv, result_status);
+		}
+	}
+	return 0;
+}
+
 static int _f8_complete(struct qce_device *pce_dev)
 {
 	uint32_t status;
@@ -2917,6 +3004,23 @@ static void _ablk_cipher_sps_producer_callback(struct sps_event_notify *notify)
 	}
 };
 
+static void _ablk_cipher_batch_sps_producer_callback(
+					struct sps_event_notify *notify)
+{
+	struct qce_device *pce_dev = (struct qce_device *)
+		((struct sps_event_notify *)notify)->user;
+
+	pce_dev->ce_sps.notify = *notify;
+	pr_debug("sps ev_id=%d, addr=0x%x, size=0x%x, flags=0x%x\n",
+			notify->event_id,
+			notify->data.transfer.iovec.addr,
+			notify->data.transfer.iovec.size,
+			notify->data.transfer.iovec.flags);
+
+	pce_dev->ce_sps.producer_state = QCE_PIPE_STATE_IDLE;
+	_ablk_cipher_batch_complete(pce_dev);
+};
+
 static void qce_add_cmd_element(struct qce_device *pdev,
 			struct sps_command_element **cmd_ptr, u32 addr,
 			u32 data, struct sps_command_element **populate)
@@ -4028,6 +4132,20 @@ static int qce_setup_ce_sps_data(struct qce_device *pce_dev)
 	pce_dev->ce_sps.ignore_buffer = (uintptr_t)vaddr;
 	vaddr += pce_dev->ce_sps.ce_burst_size * 2;
 
+	if (pce_dev->support_cmd_dscr) {
+		int i;
+
+		for (i = 0; i < QCE_MAX_BATCH; i++) {
+			vaddr = (unsigned char *)ALIGN(((uintptr_t)vaddr),
+					pce_dev->ce_sps.ce_burst_size);
+			pce_dev->batch[i].cmdlist = vaddr;
+			vaddr += QCE_BATCH_CMDLIST_SIZE;
+			pce_dev->batch[i].result =
+				(struct ce_result_dump_format *)vaddr;
+			vaddr += CRYPTO_RESULT_DUMP_SIZE;
+		}
+	}
+
 	if ((vaddr - pce_dev->coh_vmem) > pce_dev->memsize)
 		panic("qce50: Not enough coherent memory. Allocate %x , need %lx\n",
 				 pce_dev->memsize, (uintptr_t)vaddr -
@@ -4793,6 +4911,130 @@ bad:
 }
 EXPORT_SYMBOL(qce_ablk_cipher_req);
 
+/*
+ * Chain up to QCE_MAX_BATCH ablkcipher requests into one consumer and one
+ * producer transfer. Each request contributes its own command list copy,
+ * data descriptors and result dump, so the BAM descriptor setup, the pipe
+ * lock and the completion interrupt are paid once per chain. Callbacks run
+ * in submission order from the single producer event.
+ */
+int qce_ablk_cipher_req_batch(void *handle, struct qce_req *c_req,
+				unsigned int nreq)
+{
+	int rc = 0;
+	struct qce_device *pce_dev = (struct qce_device *) handle;
+	struct ablkcipher_request *areq;
+	struct qce_cmdlist_info *cmdlistinfo;
+	struct qce_cmdlist_info slot_cmd;
+	struct qce_batch_slot *slot;
+	unsigned int i;
+
+	if (nreq == 1)
+		return qce_ablk_cipher_req(handle, c_req);
+	if (nreq == 0 || nreq > QCE_MAX_BATCH ||
+			pce_dev->support_cmd_dscr == false ||
+			pce_dev->ce_sps.minor_version == 0)
+		return -EINVAL;
+
+	pce_dev->batch_cnt = 0;
+	_qce_sps_iovec_count_init(pce_dev);
+	for (i = 0; i < nreq; i++, c_req++) {
+		areq = (struct ablkcipher_request *) c_req->areq;
+		slot = &pce_dev->batch[i];
+
+		if (areq->nbytes > QCE_BATCH_MAX_LEN) {
+			rc = -EINVAL;
+			goto bad;
+		}
+		cmdlistinfo = _ce_get_cipher_cmdlistinfo(pce_dev, c_req);
+		if (cmdlistinfo == NULL ||
+				cmdlistinfo->size > QCE_BATCH_CMDLIST_SIZE) {
+			pr_err("Unsupported batch cipher algorithm %d, mode %d\n",
+						c_req->alg, c_req->mode);
+			rc = -EINVAL;
+			goto bad;
+		}
+		rc = _ce_setup_cipher(pce_dev, c_req, areq->nbytes, 0,
+							cmdlistinfo);
+		if (rc < 0)
+			goto bad;
+		memcpy(slot->cmdlist, (void *)cmdlistinfo->cmdlist,
+						cmdlistinfo->size);
+
+		slot->areq = areq;
+		slot->qce_cb = c_req->qce_cb;
+		slot->mode = c_req->mode;
+		slot->src_nents = count_sg(areq->src, areq->nbytes);
+		qce_dma_map_sg(pce_dev->pdev, areq->src, slot->src_nents,
+			(areq->src == areq->dst) ? DMA_BIDIRECTIONAL :
+							DMA_TO_DEVICE);
+		if (areq->src != areq->dst) {
+			slot->dst_nents = count_sg(areq->dst, areq->nbytes);
+			qce_dma_map_sg(pce_dev->pdev, areq->dst,
+				slot->dst_nents, DMA_FROM_DEVICE);
+		} else {
+			slot->dst_nents = slot->src_nents;
+		}
+		pce_dev->batch_cnt++;
+
+		/* only the head of the chain takes the pipe lock */
+		slot_cmd.cmdlist = (uintptr_t)slot->cmdlist;
+		slot_cmd.size = cmdlistinfo->size;
+		_qce_sps_add_cmd(pce_dev, i ? 0 : SPS_IOVEC_FLAG_LOCK,
+				&slot_cmd, &pce_dev->ce_sps.in_transfer);
+		if (_qce_sps_add_sg_data(pce_dev, areq->src, areq->nbytes,
+					&pce_dev->ce_sps.in_transfer)) {
+			rc = -ENOMEM;
+			goto bad;
+		}
+		_qce_set_flag(&pce_dev->ce_sps.in_transfer,
+				SPS_IOVEC_FLAG_EOT|SPS_IOVEC_FLAG_NWD);
+
+		if (_qce_sps_add_sg_data(pce_dev, areq->dst, areq->nbytes,
+					&pce_dev->ce_sps.out_transfer)) {
+			rc = -ENOMEM;
+			goto bad;
+		}
+		if (_qce_sps_add_data(GET_PHYS_ADDR(slot->result),
+				CRYPTO_RESULT_DUMP_SIZE,
+				&pce_dev->ce_sps.out_transfer)) {
+			rc = -ENOMEM;
+			goto bad;
+		}
+	}
+	/* one interrupt for the whole chain */
+	_qce_set_flag(&pce_dev->ce_sps.out_transfer, SPS_IOVEC_FLAG_INT);
+
+	pce_dev->ce_sps.producer.event.callback =
+				_ablk_cipher_batch_sps_producer_callback;
+	pce_dev->ce_sps.producer.event.options = SPS_O_DESC_DONE;
+	rc = sps_register_event(pce_dev->ce_sps.producer.pipe,
+					&pce_dev->ce_sps.producer.event);
+	if (rc) {
+		pr_err("Producer callback registration failed rc = %d\n", rc);
+		goto bad;
+	}
+	pce_dev->ce_sps.producer_state = QCE_PIPE_STATE_COMP;
+	rc = _qce_sps_transfer(pce_dev);
+	if (rc)
+		goto bad;
+	return 0;
+bad:
+	for (i = 0; i < pce_dev->batch_cnt; i++) {
+		slot = &pce_dev->batch[i];
+		areq = (struct ablkcipher_request *) slot->areq;
+		if (areq->src != areq->dst)
+			qce_dma_unmap_sg(pce_dev->pdev, areq->dst,
+				slot->dst_nents, DMA_FROM_DEVICE);
+		qce_dma_unmap_sg(pce_dev->pdev, areq->src, slot->src_nents,
+				(areq->src == areq->dst) ?
+				DMA_BIDIRECTIONAL : DMA_TO_DEVICE);
+	}
+	pce_dev->batch_cnt = 0;
+	return rc;
+}
+EXPORT_SYMBOL(qce_ablk_cipher_req_batch);
+
 int qce_process_sha_req(void *handle, struct qce_sha_req *sreq)
 {
 	struct qce_device *pce_dev = (struct qce_device *) handle;
@@ -5426,7 +5668,9 @@ void *qce_open(struct platform_device *pdev, int *rc)
 		goto err_pce_dev;
 	}
 
-	pce_dev->memsize = 10 * PAGE_SIZE;
+	pce_dev->memsize = 10 * PAGE_SIZE + PAGE_ALIGN(QCE_MAX_BATCH *
+			(QCE_BATCH_CMDLIST_SIZE + CRYPTO_RESULT_DUMP_SIZE +
+			MAX_CE_BAM_BURST_SIZE));
 	pce_dev->coh_vmem = dma_alloc_coherent(pce_dev->pdev,
 			pce_dev->memsize, &pce_dev->coh_pmem, GFP_KERNEL);
 	if (pce_dev->coh_vmem == NULL) {
@@ -5549,6 +5793,10 @@ int qce_hw_support(void *handle, struct ce_hw_support *ce_support)
 				pce_dev->use_sw_hmac_algo;
 	ce_support->use_sw_aes_ccm_algo =
 				pce_dev->use_sw_aes_ccm_algo;
+	if (pce_dev->support_cmd_dscr && pce_dev->ce_sps.minor_version)
+		ce_support->max_batch = QCE_MAX_BATCH;
+	else
+		ce_support->max_batch = 1;
 	ce_support->ce_device = pce_dev->ce_sps.ce_device;
 	ce_support->ce_hw_instance = pce_dev->ce_sps.ce_hw_instance;
 	return 0;
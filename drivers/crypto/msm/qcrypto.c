@@ -28,6 +28,7 @@
 #include <linux/sched.h>
 #include <linux/init.h>
 #include <linux/cache.h>
+#include <linux/ktime.h>
 #include <linux/platform_data/qcom_crypto_device.h>
 #include <linux/msm-bus.h>
 #include <linux/qcrypto.h>
@@ -98,6 +99,8 @@ struct crypto_stat {
 	u64 ablk_cipher_3des_dec;
 	u64 ablk_cipher_op_success;
 	u64 ablk_cipher_op_fail;
+	u64 ablk_cipher_aes_sw;
+	u64 ablk_cipher_batched;
 	u64 sha1_digest;
 	u64 sha256_digest;
 	u64 sha1_hmac_digest;
@@ -109,6 +112,25 @@ static struct crypto_stat _qcrypto_stat;
 static struct dentry *_debug_dent;
 static char _debug_read_buf[DEBUG_MAX_RW_BUF];
 static bool _qcrypto_init_assign;
+
+/*
+ * AES ecb/cbc/ctr requests of at most this many bytes run on the cpu
+ * fallback (ARMv8 CE instructions when available) since DMA setup and BAM
+ * latency dominate for small buffers. Indexed by qce_cipher_mode_enum and
+ * measured at boot unless sw_calibrate is cleared.
+ */
+static unsigned int _qcrypto_sw_threshold[QCE_MODE_XTS];
+module_param_array_named(sw_threshold, _qcrypto_sw_threshold, uint, NULL,
+			 0644);
+static bool _qcrypto_sw_calibrate = true;
+module_param_named(sw_calibrate, _qcrypto_sw_calibrate, bool, 0444);
+
+/*
+ * Queued ablkcipher requests chained into one engine transfer, capped by
+ * what the engine reports in ce_support.max_batch. 1 disables chaining.
+ */
+static unsigned int _qcrypto_batch_max = QCE_MAX_BATCH;
+module_param_named(batch_max, _qcrypto_batch_max, uint, 0644);
 struct crypto_priv;
 struct crypto_engine {
 	struct list_head elist;
@@ -144,6 +166,12 @@ struct crypto_engine {
 	u32    last_active_seq;
 
 	bool   check_flag;
+
+	/* ablkcipher requests chained behind req in the same transfer */
+	struct crypto_async_request *batch_req[QCE_MAX_BATCH - 1];
+	struct qcrypto_resp_ctx *batch_arsp[QCE_MAX_BATCH - 1];
+	int batch_res[QCE_MAX_BATCH - 1];
+	unsigned int batch_cnt;
 };
 
 struct crypto_priv {
@@ -293,6 +321,7 @@ struct qcrypto_cipher_ctx {
 
 	unsigned int authsize;
 	unsigned int auth_key_len;
+	bool fb_keyed;		/* fallback holds the current key */
 
 	u8 ccm4309_nonce[QCRYPTO_CCM4309_NONCE_LEN];
 
@@ -311,6 +340,7 @@ struct qcrypto_resp_ctx {
 struct qcrypto_cipher_req_ctx {
 	struct qcrypto_resp_ctx rsp_entry;/* rsp entry. */
 	struct crypto_engine *pengine;  /* engine assigned to this request */
+	unsigned int batch_idx;		/* position in chained transfer */
 	u8 *iv;
 	u8 rfc4309_iv[QCRYPTO_MAX_IV_LENGTH];
 	unsigned int ivsize;
@@ -898,6 +928,12 @@ static int _disp_stats(int id)
 	len += scnprintf(_debug_read_buf + len, DEBUG_MAX_RW_BUF - len - 1,
 			"   ABLK CIPHER AES decryption          : %llu\n",
 					pstat->ablk_cipher_aes_dec);
+	len += scnprintf(_debug_read_buf + len, DEBUG_MAX_RW_BUF - len - 1,
+			"   ABLK CIPHER AES cpu dispatch        : %llu\n",
+					pstat->ablk_cipher_aes_sw);
+	len += scnprintf(_debug_read_buf + len, DEBUG_MAX_RW_BUF - len - 1,
+			"   ABLK CIPHER chained requests        : %llu\n",
+					pstat->ablk_cipher_batched);
 
 	len += scnprintf(_debug_read_buf + len, DEBUG_MAX_RW_BUF - len - 1,
 			"   ABLK CIPHER DES encryption          : %llu\n",
@@ -1108,24 +1144,24 @@ static int _qcrypto_check_aes_keylen(struct crypto_ablkcipher *cipher,
 	return 0;
 }
 
-static int _qcrypto_setkey_aes_192_fallback(struct crypto_ablkcipher *cipher,
-		const u8 *key)
+static int _qcrypto_setkey_aes_fallback(struct crypto_ablkcipher *cipher,
+		const u8 *key, unsigned int len)
 {
 	struct crypto_tfm *tfm = crypto_ablkcipher_tfm(cipher);
 	struct qcrypto_cipher_ctx *ctx = crypto_tfm_ctx(tfm);
 	int ret;
 
-	ctx->enc_key_len = AES_KEYSIZE_192;
+	ctx->enc_key_len = len;
 	ctx->fallback.cipher_fb->base.crt_flags &= ~CRYPTO_TFM_REQ_MASK;
 	ctx->fallback.cipher_fb->base.crt_flags |=
 			(cipher->base.crt_flags & CRYPTO_TFM_REQ_MASK);
-	ret = crypto_ablkcipher_setkey(ctx->fallback.cipher_fb, key,
-			AES_KEYSIZE_192);
+	ret = crypto_ablkcipher_setkey(ctx->fallback.cipher_fb, key, len);
 	if (ret) {
 		tfm->crt_flags &= ~CRYPTO_TFM_RES_MASK;
 		tfm->crt_flags |=
 			(cipher->base.crt_flags & CRYPTO_TFM_RES_MASK);
 	}
+	ctx->fb_keyed = !ret;
 	return ret;
 }
 
@@ -1136,12 +1172,19 @@ static int _qcrypto_setkey_aes(struct crypto_ablkcipher *cipher, const u8 *key,
 	struct qcrypto_cipher_ctx *ctx = crypto_tfm_ctx(tfm);
 	struct crypto_priv *cp = ctx->cp;
 
+	ctx->fb_keyed = false;
 	if ((ctx->flags & QCRYPTO_CTX_USE_HW_KEY) == QCRYPTO_CTX_USE_HW_KEY)
 		return 0;
 
 	if ((len == AES_KEYSIZE_192) && (!cp->ce_support.aes_key_192)
 					&& ctx->fallback.cipher_fb)
-		return _qcrypto_setkey_aes_192_fallback(cipher, key);
+		return _qcrypto_setkey_aes_fallback(cipher, key, len);
+
+	/* keep the fallback keyed so small requests can bypass the engine */
+	if (ctx->fallback.cipher_fb && key &&
+	    !(ctx->flags & QCRYPTO_CTX_USE_PIPE_KEY) &&
+	    !_qcrypto_check_aes_keylen(cipher, cp, len))
+		_qcrypto_setkey_aes_fallback(cipher, key, len);
 
 	if (_qcrypto_check_aes_keylen(cipher, cp, len)) {
 		return -EINVAL;
@@ -1294,6 +1337,35 @@ again:
 	}
 }
 
+/*
+ * Publish the results of the requests chained behind pengine->req and
+ * collect their tfm contexts, skipping duplicates, for completion after
+ * the lock is dropped. Completing a tfm twice could touch it after its
+ * owner freed it. Called with cp->lock held.
+ */
+static unsigned int _qcrypto_batch_done(struct crypto_engine *pengine,
+				void **batch_ctx, void *head_ctx)
+{
+	struct crypto_async_request *areq;
+	unsigned int i, j, n = 0;
+	void *ctx;
+
+	for (i = 0; i < pengine->batch_cnt; i++) {
+		areq = pengine->batch_req[i];
+		pengine->batch_arsp[i]->res = pengine->batch_res[i];
+		ctx = crypto_tfm_ctx(areq->tfm);
+		if (ctx == head_ctx)
+			continue;
+		for (j = 0; j < n; j++)
+			if (batch_ctx[j] == ctx)
+				break;
+		if (j == n)
+			batch_ctx[n++] = ctx;
+	}
+	pengine->batch_cnt = 0;
+	return n;
+}
+
 static void req_done(unsigned long data)
 {
 	struct crypto_async_request *areq;
@@ -1304,6 +1376,8 @@ static void req_done(unsigned long data)
 	int res;
 	u32 type = 0;
 	void *tfm_ctx = NULL;
+	void *batch_ctx[QCE_MAX_BATCH - 1];
+	unsigned int i, cnt;
 
 	cp = pengine->pcp;
 	spin_lock_irqsave(&cp->lock, flags);
@@ -1318,10 +1392,14 @@ static void req_done(unsigned long data)
 		tfm_ctx = crypto_tfm_ctx(areq->tfm);
 		arsp->res = res;
 	}
+	cnt = _qcrypto_batch_done(pengine, batch_ctx, tfm_ctx);
 	spin_unlock_irqrestore(&cp->lock, flags);
 	_start_qcrypto_process(cp, pengine);
 	if (areq)
 		_qcrypto_tfm_complete(cp, type, tfm_ctx);
+	for (i = 0; i < cnt; i++)
+		_qcrypto_tfm_complete(cp, CRYPTO_ALG_TYPE_ABLKCIPHER,
+					batch_ctx[i]);
 }
 
 static void _qce_ahash_complete(void *cookie, unsigned char *digest,
@@ -1385,6 +1463,7 @@ static void _qce_ablk_cipher_complete(void *cookie, unsigned char *icb,
 	struct crypto_stat *pstat;
 	struct qcrypto_cipher_req_ctx *rctx;
 	struct crypto_engine *pengine;
+	int *pres;
 
 	pstat = &_qcrypto_stat;
 	rctx = ablkcipher_request_ctx(areq);
@@ -1396,11 +1475,15 @@ static void _qce_ablk_cipher_complete(void *cookie, unsigned char *icb,
 	if (iv)
 		memcpy(ctx->iv, iv, crypto_ablkcipher_ivsize(ablk));
 
+	if (rctx->batch_idx)
+		pres = &pengine->batch_res[rctx->batch_idx - 1];
+	else
+		pres = &pengine->res;
 	if (ret) {
-		pengine->res = -ENXIO;
+		*pres = -ENXIO;
 		pstat->ablk_cipher_op_fail++;
 	} else {
-		pengine->res = 0;
+		*pres = 0;
 		pstat->ablk_cipher_op_success++;
 	}
 
@@ -1422,7 +1505,9 @@ static void _qce_ablk_cipher_complete(void *cookie, unsigned char *icb,
 		kzfree(rctx->data);
 	}
 
-	tasklet_schedule(&pengine->done_tasklet);
+	/* a chain is done once its last request has called back */
+	if (rctx->batch_idx == pengine->batch_cnt)
+		tasklet_schedule(&pengine->done_tasklet);
 };
 
 
@@ -1628,6 +1713,48 @@ static int qcrypto_aead_ccm_format_adata(struct qce_req *qreq, uint32_t alen,
 	return 0;
 }
 
+static void _qcrypto_ablkcipher_qreq(struct qce_req *qreq,
+				struct ablkcipher_request *req)
+{
+	struct qcrypto_cipher_req_ctx *rctx = ablkcipher_request_ctx(req);
+	struct qcrypto_cipher_ctx *cipher_ctx = crypto_tfm_ctx(req->base.tfm);
+	struct crypto_ablkcipher *tfm = crypto_ablkcipher_reqtfm(req);
+
+	qreq->op = QCE_REQ_ABLK_CIPHER;
+	qreq->qce_cb = _qce_ablk_cipher_complete;
+	qreq->areq = req;
+	qreq->alg = rctx->alg;
+	qreq->dir = rctx->dir;
+	qreq->mode = rctx->mode;
+	qreq->enckey = cipher_ctx->enc_key;
+	qreq->encklen = cipher_ctx->enc_key_len;
+	qreq->iv = req->info;
+	qreq->ivsize = crypto_ablkcipher_ivsize(tfm);
+	qreq->cryptlen = req->nbytes;
+	qreq->use_pmem = 0;
+	qreq->flags = cipher_ctx->flags;
+}
+
+static int _qcrypto_process_ablkcipher_batch(struct crypto_engine *pengine,
+				struct crypto_async_request *async_req)
+{
+	struct qce_req qreq[QCE_MAX_BATCH];
+	struct ablkcipher_request *req;
+	struct qcrypto_cipher_req_ctx *rctx;
+	unsigned int i;
+
+	for (i = 0; i <= pengine->batch_cnt; i++) {
+		req = container_of(i ? pengine->batch_req[i - 1] : async_req,
+					struct ablkcipher_request, base);
+		rctx = ablkcipher_request_ctx(req);
+		rctx->pengine = pengine;
+		_qcrypto_ablkcipher_qreq(&qreq[i], req);
+	}
+	_qcrypto_stat.ablk_cipher_batched += pengine->batch_cnt;
+	return qce_ablk_cipher_req_batch(pengine->qce, qreq,
+					pengine->batch_cnt + 1);
+}
+
 static int _qcrypto_process_ablkcipher(struct crypto_engine *pengine,
 				struct crypto_async_request *async_req)
 {
@@ -1636,13 +1763,13 @@ static int _qcrypto_process_ablkcipher(struct crypto_engine *pengine,
 	struct qcrypto_cipher_req_ctx *rctx;
 	struct qcrypto_cipher_ctx *cipher_ctx;
 	struct ablkcipher_request *req;
-	struct crypto_ablkcipher *tfm;
 
 	req = container_of(async_req, struct ablkcipher_request, base);
 	cipher_ctx = crypto_tfm_ctx(async_req->tfm);
 	rctx = ablkcipher_request_ctx(req);
 	rctx->pengine = pengine;
-	tfm = crypto_ablkcipher_reqtfm(req);
+	if (pengine->batch_cnt)
+		return _qcrypto_process_ablkcipher_batch(pengine, async_req);
 	if (pengine->pcp->ce_support.aligned_only) {
 		uint32_t bytes = 0;
 		uint32_t num_sg = 0;
@@ -1669,19 +1796,7 @@ static int _qcrypto_process_ablkcipher(struct crypto_engine *pengine,
 		req->src = &rctx->dsg;
 		req->dst = &rctx->dsg;
 	}
-	qreq.op = QCE_REQ_ABLK_CIPHER;
-	qreq.qce_cb = _qce_ablk_cipher_complete;
-	qreq.areq = req;
-	qreq.alg = rctx->alg;
-	qreq.dir = rctx->dir;
-	qreq.mode = rctx->mode;
-	qreq.enckey = cipher_ctx->enc_key;
-	qreq.encklen = cipher_ctx->enc_key_len;
-	qreq.iv = req->info;
-	qreq.ivsize = crypto_ablkcipher_ivsize(tfm);
-	qreq.cryptlen = req->nbytes;
-	qreq.use_pmem = 0;
-	qreq.flags = cipher_ctx->flags;
+	_qcrypto_ablkcipher_qreq(&qreq, req);
 
 	if ((cipher_ctx->enc_key_len == 0) &&
 			(pengine->pcp->platform_support.hw_key_support == 0))
@@ -1972,12 +2087,81 @@ static struct crypto_engine *_qcrypto_static_assign_engine(
 	return pengine;
 }
 
+static bool _qcrypto_batch_allowed(struct crypto_priv *cp,
+				struct crypto_async_request *async_req)
+{
+	struct ablkcipher_request *req;
+	struct qcrypto_cipher_ctx *cipher_ctx;
+
+	if (crypto_tfm_alg_type(async_req->tfm) != CRYPTO_ALG_TYPE_ABLKCIPHER)
+		return false;
+	req = container_of(async_req, struct ablkcipher_request, base);
+	cipher_ctx = crypto_tfm_ctx(async_req->tfm);
+	if (req->nbytes > QCE_BATCH_MAX_LEN)
+		return false;
+	if ((cipher_ctx->enc_key_len == 0) &&
+			(cp->platform_support.hw_key_support == 0))
+		return false;
+	return true;
+}
+
+/*
+ * Pull the ablkcipher requests queued right behind the head request so
+ * they can be chained into its transfer. Stops at the first request that
+ * cannot be chained to keep the queue order. Called with cp->lock held.
+ */
+static void _qcrypto_batch_gather(struct crypto_priv *cp,
+				struct crypto_engine *pengine,
+				struct crypto_queue *queue,
+				struct crypto_async_request *head,
+				struct crypto_async_request **backlog)
+{
+	struct crypto_async_request *async_req;
+	struct ablkcipher_request *req;
+	struct qcrypto_cipher_req_ctx *rctx;
+	struct qcrypto_resp_ctx *arsp;
+	unsigned int max, n = 0;
+
+	max = min(_qcrypto_batch_max, cp->ce_support.max_batch);
+	if (max <= 1 || cp->ce_support.aligned_only ||
+			!_qcrypto_batch_allowed(cp, head))
+		goto done;
+
+	while (n + 1 < max && queue->qlen) {
+		async_req = list_first_entry(&queue->list,
+				struct crypto_async_request, list);
+		if (!_qcrypto_batch_allowed(cp, async_req))
+			break;
+		backlog[n] = crypto_get_backlog(queue);
+		crypto_dequeue_request(queue);
+
+		req = container_of(async_req, struct ablkcipher_request, base);
+		rctx = ablkcipher_request_ctx(req);
+		rctx->batch_idx = n + 1;
+		arsp = &rctx->rsp_entry;
+		list_add_tail(&arsp->list,
+			&((struct qcrypto_cipher_ctx *)
+				crypto_tfm_ctx(async_req->tfm))->rsp_queue);
+		arsp->res = -EINPROGRESS;
+		arsp->async_req = async_req;
+		pengine->batch_req[n] = async_req;
+		pengine->batch_arsp[n] = arsp;
+		n++;
+	}
+done:
+	pengine->batch_cnt = n;
+}
+
 static int _start_qcrypto_process(struct crypto_priv *cp,
 				struct crypto_engine *pengine)
 {
 	struct crypto_async_request *async_req = NULL;
 	struct crypto_async_request *backlog_eng = NULL;
 	struct crypto_async_request *backlog_cp = NULL;
+	struct crypto_async_request *backlog_batch[QCE_MAX_BATCH - 1];
+	struct crypto_queue *queue;
+	void *batch_ctx[QCE_MAX_BATCH - 1];
+	unsigned int i, cnt;
 	unsigned long flags;
 	u32 type;
 	int ret = 0;
@@ -2008,14 +2192,16 @@ again:
 	}
 
 	/* try to get request from request queue of the engine first */
-	async_req = crypto_dequeue_request(&pengine->req_queue);
+	queue = &pengine->req_queue;
+	async_req = crypto_dequeue_request(queue);
 	if (!async_req) {
 		/*
 		 * if no request from the engine,
 		 * try to  get from request queue of driver
 		 */
-		backlog_cp = crypto_get_backlog(&cp->req_queue);
-		async_req = crypto_dequeue_request(&cp->req_queue);
+		queue = &cp->req_queue;
+		backlog_cp = crypto_get_backlog(queue);
+		async_req = crypto_dequeue_request(queue);
 		if (!async_req) {
 			spin_unlock_irqrestore(&cp->lock, flags);
 			return 0;
@@ -2040,6 +2226,7 @@ again:
 		ablkcipher_req = container_of(async_req,
 			struct ablkcipher_request, base);
 		cipher_rctx = ablkcipher_request_ctx(ablkcipher_req);
+		cipher_rctx->batch_idx = 0;
 		arsp = &cipher_rctx->rsp_entry;
 		list_add_tail(
 			&arsp->list,
@@ -2065,12 +2252,18 @@ again:
 	pengine->arsp = arsp;
 	pengine->active_seq++;
 	pengine->check_flag = true;
+	_qcrypto_batch_gather(cp, pengine, queue, async_req, backlog_batch);
+	cnt = pengine->batch_cnt;
 
 	spin_unlock_irqrestore(&cp->lock, flags);
 	if (backlog_eng)
 		backlog_eng->complete(backlog_eng, -EINPROGRESS);
 	if (backlog_cp)
 		backlog_cp->complete(backlog_cp, -EINPROGRESS);
+	for (i = 0; i < cnt; i++)
+		if (backlog_batch[i])
+			backlog_batch[i]->complete(backlog_batch[i],
+							-EINPROGRESS);
 	switch (type) {
 	case CRYPTO_ALG_TYPE_ABLKCIPHER:
 		ret = _qcrypto_process_ablkcipher(pengine, async_req);
@@ -2084,13 +2277,18 @@ again:
 	default:
 		ret = -EINVAL;
 	};
-	pengine->total_req++;
+	pengine->total_req += 1 + cnt;
 	if (ret) {
 		arsp->res = ret;
-		pengine->err_req++;
+		pengine->err_req += 1 + cnt;
 		spin_lock_irqsave(&cp->lock, flags);
 		pengine->req = NULL;
 		pengine->arsp = NULL;
+		for (i = 0; i < cnt; i++)
+			pengine->batch_res[i] = ret;
+		if (type == CRYPTO_ALG_TYPE_ABLKCIPHER)
+			pstat->ablk_cipher_op_fail += cnt;
+		cnt = _qcrypto_batch_done(pengine, batch_ctx, tfm_ctx);
 		spin_unlock_irqrestore(&cp->lock, flags);
 
 		if (type == CRYPTO_ALG_TYPE_ABLKCIPHER)
@@ -2102,6 +2300,9 @@ again:
 				pstat->aead_op_fail++;
 
 		_qcrypto_tfm_complete(cp, type, tfm_ctx);
+		for (i = 0; i < cnt; i++)
+			_qcrypto_tfm_complete(cp, CRYPTO_ALG_TYPE_ABLKCIPHER,
+						batch_ctx[i]);
 		goto again;
 	};
 	return ret;
@@ -2164,7 +2365,25 @@ static int _qcrypto_queue_req(struct crypto_priv *cp,
 	return ret;
 }
 
-static int _qcrypto_enc_aes_192_fallback(struct ablkcipher_request *req)
+static bool _qcrypto_aes_use_fallback(struct qcrypto_cipher_ctx *ctx,
+				      struct ablkcipher_request *req,
+				      enum qce_cipher_mode_enum mode)
+{
+	if (!ctx->fallback.cipher_fb)
+		return false;
+
+	if ((ctx->enc_key_len == AES_KEYSIZE_192) &&
+			(!ctx->cp->ce_support.aes_key_192))
+		return true;
+
+	if (ctx->fb_keyed && req->nbytes <= _qcrypto_sw_threshold[mode]) {
+		_qcrypto_stat.ablk_cipher_aes_sw++;
+		return true;
+	}
+	return false;
+}
+
+static int _qcrypto_enc_aes_fallback(struct ablkcipher_request *req)
 {
 	struct crypto_tfm *tfm =
 		crypto_ablkcipher_tfm(crypto_ablkcipher_reqtfm(req));
@@ -2177,7 +2396,7 @@ static int _qcrypto_enc_aes_192_fallback(struct ablkcipher_request *req)
 	return err;
 }
 
-static int _qcrypto_dec_aes_192_fallback(struct ablkcipher_request *req)
+static int _qcrypto_dec_aes_fallback(struct ablkcipher_request *req)
 {
 	struct crypto_tfm *tfm =
 		crypto_ablkcipher_tfm(crypto_ablkcipher_reqtfm(req));
@@ -2206,10 +2425,8 @@ static int _qcrypto_enc_aes_ecb(struct ablkcipher_request *req)
 	dev_info(&ctx->pengine->pdev->dev, "_qcrypto_enc_aes_ecb: %p\n", req);
 #endif
 
-	if ((ctx->enc_key_len == AES_KEYSIZE_192) &&
-			(!cp->ce_support.aes_key_192) &&
-				ctx->fallback.cipher_fb)
-		return _qcrypto_enc_aes_192_fallback(req);
+	if (_qcrypto_aes_use_fallback(ctx, req, QCE_MODE_ECB))
+		return _qcrypto_enc_aes_fallback(req);
 
 	rctx = ablkcipher_request_ctx(req);
 	rctx->aead = 0;
@@ -2236,10 +2453,8 @@ static int _qcrypto_enc_aes_cbc(struct ablkcipher_request *req)
 	dev_info(&ctx->pengine->pdev->dev, "_qcrypto_enc_aes_cbc: %p\n", req);
 #endif
 
-	if ((ctx->enc_key_len == AES_KEYSIZE_192) &&
-			(!cp->ce_support.aes_key_192) &&
-				ctx->fallback.cipher_fb)
-		return _qcrypto_enc_aes_192_fallback(req);
+	if (_qcrypto_aes_use_fallback(ctx, req, QCE_MODE_CBC))
+		return _qcrypto_enc_aes_fallback(req);
 
 	rctx = ablkcipher_request_ctx(req);
 	rctx->aead = 0;
@@ -2266,10 +2481,8 @@ static int _qcrypto_enc_aes_ctr(struct ablkcipher_request *req)
 	dev_info(&ctx->pengine->pdev->dev, "_qcrypto_enc_aes_ctr: %p\n", req);
 #endif
 
-	if ((ctx->enc_key_len == AES_KEYSIZE_192) &&
-			(!cp->ce_support.aes_key_192) &&
-				ctx->fallback.cipher_fb)
-		return _qcrypto_enc_aes_192_fallback(req);
+	if (_qcrypto_aes_use_fallback(ctx, req, QCE_MODE_CTR))
+		return _qcrypto_enc_aes_fallback(req);
 
 	rctx = ablkcipher_request_ctx(req);
 	rctx->aead = 0;
@@ -2450,10 +2663,8 @@ static int _qcrypto_dec_aes_ecb(struct ablkcipher_request *req)
 	dev_info(&ctx->pengine->pdev->dev, "_qcrypto_dec_aes_ecb: %p\n", req);
 #endif
 
-	if ((ctx->enc_key_len == AES_KEYSIZE_192) &&
-			(!cp->ce_support.aes_key_192) &&
-				ctx->fallback.cipher_fb)
-		return _qcrypto_dec_aes_192_fallback(req);
+	if (_qcrypto_aes_use_fallback(ctx, req, QCE_MODE_ECB))
+		return _qcrypto_dec_aes_fallback(req);
 
 	rctx = ablkcipher_request_ctx(req);
 	rctx->aead = 0;
@@ -2480,10 +2691,8 @@ static int _qcrypto_dec_aes_cbc(struct ablkcipher_request *req)
 	dev_info(&ctx->pengine->pdev->dev, "_qcrypto_dec_aes_cbc: %p\n", req);
 #endif
 
-	if ((ctx->enc_key_len == AES_KEYSIZE_192) &&
-			(!cp->ce_support.aes_key_192) &&
-				ctx->fallback.cipher_fb)
-		return _qcrypto_dec_aes_192_fallback(req);
+	if (_qcrypto_aes_use_fallback(ctx, req, QCE_MODE_CBC))
+		return _qcrypto_dec_aes_fallback(req);
 
 	rctx = ablkcipher_request_ctx(req);
 	rctx->aead = 0;
@@ -2510,10 +2719,8 @@ static int _qcrypto_dec_aes_ctr(struct ablkcipher_request *req)
 	dev_info(&ctx->pengine->pdev->dev, "_qcrypto_dec_aes_ctr: %p\n", req);
 #endif
 
-	if ((ctx->enc_key_len == AES_KEYSIZE_192) &&
-			(!cp->ce_support.aes_key_192) &&
-				ctx->fallback.cipher_fb)
-		return _qcrypto_dec_aes_192_fallback(req);
+	if (_qcrypto_aes_use_fallback(ctx, req, QCE_MODE_CTR))
+		return _qcrypto_dec_aes_fallback(req);
 
 	rctx = ablkcipher_request_ctx(req);
 	rctx->aead = 0;
@@ -4473,6 +4680,131 @@ static struct crypto_alg _qcrypto_aead_rfc4309_ccm_algo = {
 	}
 };
 
+#define QCRYPTO_CAL_MIN_LEN	64
+#define QCRYPTO_CAL_MAX_LEN	4096
+#define QCRYPTO_CAL_ITER	8
+
+struct qcrypto_cal_result {
+	struct completion completion;
+	int err;
+};
+
+static const char * const _qcrypto_cal_alg[QCE_MODE_XTS][2] = {
+	[QCE_MODE_CBC] = { "qcrypto-cbc-aes", "cbc(aes)" },
+	[QCE_MODE_ECB] = { "qcrypto-ecb-aes", "ecb(aes)" },
+	[QCE_MODE_CTR] = { "qcrypto-ctr-aes", "ctr(aes)" },
+};
+
+static void _qcrypto_cal_complete(struct crypto_async_request *req, int err)
+{
+	struct qcrypto_cal_result *res = req->data;
+
+	if (err == -EINPROGRESS)
+		return;
+	res->err = err;
+	complete(&res->completion);
+}
+
+/* returns the time in ns for QCRYPTO_CAL_ITER encryptions of len bytes */
+static s64 _qcrypto_cal_time(struct crypto_ablkcipher *tfm,
+			     struct scatterlist *sg, unsigned int len, int iter)
+{
+	struct ablkcipher_request *req;
+	struct qcrypto_cal_result res;
+	u8 iv[AES_BLOCK_SIZE] = { 0 };
+	ktime_t start;
+	int i, ret = 0;
+	s64 delta;
+
+	req = ablkcipher_request_alloc(tfm, GFP_KERNEL);
+	if (!req)
+		return -ENOMEM;
+	ablkcipher_request_set_callback(req, CRYPTO_TFM_REQ_MAY_BACKLOG,
+					_qcrypto_cal_complete, &res);
+	ablkcipher_request_set_crypt(req, sg, sg, len, iv);
+
+	start = ktime_get();
+	for (i = 0; i < iter && !ret; i++) {
+		init_completion(&res.completion);
+		ret = crypto_ablkcipher_encrypt(req);
+		if (ret == -EINPROGRESS || ret == -EBUSY) {
+			wait_for_completion(&res.completion);
+			ret = res.err;
+		}
+	}
+	delta = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	ablkcipher_request_free(req);
+	return ret ? ret : delta;
+}
+
+/*
+ * Find the largest power of two request size for which the cpu fallback
+ * is at least as fast as the engine, including bus voting and BAM setup.
+ */
+static unsigned int _qcrypto_cal_mode(enum qce_cipher_mode_enum mode,
+				      struct scatterlist *sg)
+{
+	struct crypto_ablkcipher *hw, *sw;
+	u8 key[AES_KEYSIZE_128] = { 0 };
+	unsigned int len, threshold = 0;
+	s64 hw_ns, sw_ns;
+
+	hw = crypto_alloc_ablkcipher(_qcrypto_cal_alg[mode][0], 0, 0);
+	if (IS_ERR(hw))
+		return 0;
+	sw = crypto_alloc_ablkcipher(_qcrypto_cal_alg[mode][1], 0,
+			CRYPTO_ALG_ASYNC | CRYPTO_ALG_NEED_FALLBACK);
+	if (IS_ERR(sw))
+		goto out_hw;
+
+	if (crypto_ablkcipher_setkey(hw, key, sizeof(key)) ||
+	    crypto_ablkcipher_setkey(sw, key, sizeof(key)))
+		goto out;
+
+	/* warm up the bus vote and caches before timing */
+	if (_qcrypto_cal_time(hw, sg, QCRYPTO_CAL_MAX_LEN, 1) < 0 ||
+	    _qcrypto_cal_time(sw, sg, QCRYPTO_CAL_MAX_LEN, 1) < 0)
+		goto out;
+
+	for (len = QCRYPTO_CAL_MIN_LEN; len <= QCRYPTO_CAL_MAX_LEN;
+	     len <<= 1) {
+		hw_ns = _qcrypto_cal_time(hw, sg, len, QCRYPTO_CAL_ITER);
+		sw_ns = _qcrypto_cal_time(sw, sg, len, QCRYPTO_CAL_ITER);
+		if (hw_ns < 0 || sw_ns < 0 || sw_ns > hw_ns)
+			break;
+		threshold = len;
+	}
+out:
+	crypto_free_ablkcipher(sw);
+out_hw:
+	crypto_free_ablkcipher(hw);
+	return threshold;
+}
+
+static void _qcrypto_cal_work_fn(struct work_struct *work)
+{
+	struct scatterlist sg;
+	void *buf;
+	int mode;
+
+	buf = kzalloc(QCRYPTO_CAL_MAX_LEN, GFP_KERNEL);
+	if (!buf)
+		return;
+	sg_init_one(&sg, buf, QCRYPTO_CAL_MAX_LEN);
+
+	for (mode = 0; mode < ARRAY_SIZE(_qcrypto_cal_alg); mode++) {
+		/* time the engine path with dispatch disabled */
+		_qcrypto_sw_threshold[mode] = 0;
+		_qcrypto_sw_threshold[mode] = _qcrypto_cal_mode(mode, &sg);
+		pr_info("qcrypto: %s cpu dispatch up to %u bytes\n",
+			_qcrypto_cal_alg[mode][1], _qcrypto_sw_threshold[mode]);
+	}
+
+	kfree(buf);
+}
+
+static DECLARE_DELAYED_WORK(_qcrypto_cal_work, _qcrypto_cal_work_fn);
 
 static int  _qcrypto_probe(struct platform_device *pdev)
 {
@@ -4901,6 +5233,15 @@ fips_selftest:
 
 	is_fips_qcrypto_tests_done = true;
 
+	/*
+	 * Calibrate once all engines had a chance to probe and the cpu
+	 * implementations are registered.
+	 */
+	if (_qcrypto_sw_calibrate &&
+	    !cp->ce_support.use_sw_aes_cbc_ecb_ctr_algo)
+		schedule_delayed_work(&_qcrypto_cal_work,
+				      msecs_to_jiffies(5000));
+
 	return 0;
 err:
 	_qcrypto_remove_engine(pengine);
@@ -5139,6 +5480,7 @@ static void __exit _qcrypto_exit(void)
 {
 	pr_debug("%s Unregister QCRYPTO\n", __func__);
 	debugfs_remove_recursive(_debug_dent);
+	cancel_delayed_work_sync(&_qcrypto_cal_work);
 	platform_driver_unregister(&_qualcomm_crypto);
 }
 
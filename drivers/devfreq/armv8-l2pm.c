@@ -0,0 +1,355 @@
+/*
+ * Copyright (C) 2016 HTC Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#define pr_fmt(fmt) "armv8-l2pm: " fmt
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/init.h>
+#include <linux/err.h>
+#include <linux/errno.h>
+#include <linux/cpu.h>
+#include <linux/cpumask.h>
+#include <linux/mutex.h>
+#include <linux/spinlock.h>
+#include <linux/percpu.h>
+#include <linux/perf_event.h>
+#include <linux/platform_device.h>
+#include <linux/of.h>
+#include <linux/slab.h>
+#include "governor.h"
+#include "governor_cache_hwmon.h"
+
+/*
+ * Cache HW monitor for ARMv8 clusters. The L2 and CCI traffic of a cluster
+ * is read from the architected PMU events of its CPUs through the perf
+ * kernel counter API, so that profiling tools keep working alongside it.
+ *
+ * Requests are grouped for the cache_hwmon governor as:
+ *  HIGH - L2 refills, the requests that leave the cluster through the CCI
+ *  MED  - L2 hits
+ *  LOW  - remaining bus traffic (write backs, non-cacheable accesses)
+ */
+
+enum l2pm_event_idx {
+	L2_ACCESS,
+	L2_REFILL,
+	BUS_ACCESS,
+	NUM_EVENTS,
+};
+
+static const u32 l2pm_event_ids[NUM_EVENTS] = {
+	[L2_ACCESS]	= 0x16,	/* L2D_CACHE */
+	[L2_REFILL]	= 0x17,	/* L2D_CACHE_REFILL */
+	[BUS_ACCESS]	= 0x19,	/* BUS_ACCESS */
+};
+
+struct l2pm_cpu_data {
+	struct perf_event *ev[NUM_EVENTS];
+	u64 prev[NUM_EVENTS];
+	u64 delta[NUM_EVENTS];
+};
+
+struct l2pm_cluster {
+	struct cache_hwmon hw;
+	cpumask_t cpus;
+	struct l2pm_cpu_data __percpu *data;
+	/* Protects the ev[] pointers against CPU hotplug */
+	spinlock_t lock;
+	bool active;
+	struct list_head list;
+};
+
+#define to_cluster(hwmon) container_of(hwmon, struct l2pm_cluster, hw)
+
+static LIST_HEAD(cluster_list);
+static DEFINE_MUTEX(cluster_lock);
+
+static int l2pm_create_events(struct l2pm_cluster *c, int cpu)
+{
+	struct l2pm_cpu_data *d = per_cpu_ptr(c->data, cpu);
+	struct perf_event *ev[NUM_EVENTS];
+	struct perf_event_attr attr = {
+		.type = PERF_TYPE_RAW,
+		.size = sizeof(struct perf_event_attr),
+		.pinned = 1,
+	};
+	int i, ret;
+
+	for (i = 0; i < NUM_EVENTS; i++) {
+		attr.config = l2pm_event_ids[i];
+		ev[i] = perf_event_create_kernel_counter(&attr, cpu, NULL,
+								NULL, NULL);
+		if (IS_ERR(ev[i])) {
+			ret = PTR_ERR(ev[i]);
+			pr_err("Unable to create event %#x on CPU%d (%d)\n",
+					l2pm_event_ids[i], cpu, ret);
+			while (i--)
+				perf_event_release_kernel(ev[i]);
+			return ret;
+		}
+	}
+
+	/*
+	 * Not irqsave: readers hold this lock while waiting for an IPI to
+	 * the CPU that may be spinning here.
+	 */
+	spin_lock(&c->lock);
+	for (i = 0; i < NUM_EVENTS; i++) {
+		d->ev[i] = ev[i];
+		d->prev[i] = 0;
+		d->delta[i] = 0;
+	}
+	spin_unlock(&c->lock);
+
+	return 0;
+}
+
+static void l2pm_release_events(struct l2pm_cluster *c, int cpu)
+{
+	struct l2pm_cpu_data *d = per_cpu_ptr(c->data, cpu);
+	struct perf_event *ev[NUM_EVENTS];
+	int i;
+
+	spin_lock(&c->lock);
+	for (i = 0; i < NUM_EVENTS; i++) {
+		ev[i] = d->ev[i];
+		d->ev[i] = NULL;
+	}
+	spin_unlock(&c->lock);
+
+	for (i = 0; i < NUM_EVENTS; i++)
+		if (ev[i])
+			perf_event_release_kernel(ev[i]);
+}
+
+/* Runs on the CPU owning the events, so the PMU can be read directly. */
+static void l2pm_read_cpu(void *info)
+{
+	struct l2pm_cluster *c = info;
+	struct l2pm_cpu_data *d = this_cpu_ptr(c->data);
+	struct perf_event *ev;
+	u64 cnt;
+	int i;
+
+	for (i = 0; i < NUM_EVENTS; i++) {
+		ev = d->ev[i];
+		if (!ev)
+			continue;
+
+		if (ev->state == PERF_EVENT_STATE_ACTIVE)
+			ev->pmu->read(ev);
+		cnt = local64_read(&ev->count);
+		d->delta[i] = cnt - d->prev[i];
+		d->prev[i] = cnt;
+	}
+}
+
+/* Returns million requests/sec for the sampling window. */
+static unsigned long count_to_mrps(u64 count, unsigned int us)
+{
+	do_div(count, us);
+	return count;
+}
+
+static unsigned long l2pm_meas_mrps_and_set_irq(struct cache_hwmon *hw,
+					unsigned int tol, unsigned int us,
+					struct mrps_stats *mrps)
+{
+	struct l2pm_cluster *c = to_cluster(hw);
+	struct l2pm_cpu_data *d;
+	u64 total[NUM_EVENTS] = { 0 };
+	u64 hits = 0, other = 0;
+	int cpu, i;
+
+	spin_lock(&c->lock);
+	for_each_cpu_and(cpu, &c->cpus, cpu_online_mask) {
+		d = per_cpu_ptr(c->data, cpu);
+		smp_call_function_single(cpu, l2pm_read_cpu, c, true);
+		for (i = 0; i < NUM_EVENTS; i++)
+			total[i] += d->delta[i];
+	}
+	spin_unlock(&c->lock);
+
+	if (total[L2_ACCESS] > total[L2_REFILL])
+		hits = total[L2_ACCESS] - total[L2_REFILL];
+	if (total[BUS_ACCESS] > total[L2_REFILL])
+		other = total[BUS_ACCESS] - total[L2_REFILL];
+
+	mrps->mrps[HIGH] = count_to_mrps(total[L2_REFILL], us);
+	mrps->mrps[MED] = count_to_mrps(hits, us);
+	mrps->mrps[LOW] = count_to_mrps(other, us);
+	mrps->busy_percent = 100;
+
+	return 0;
+}
+
+static int l2pm_start_hwmon(struct cache_hwmon *hw, struct mrps_stats *mrps)
+{
+	struct l2pm_cluster *c = to_cluster(hw);
+	int cpu, ret = 0;
+
+	get_online_cpus();
+	mutex_lock(&cluster_lock);
+	for_each_cpu_and(cpu, &c->cpus, cpu_online_mask) {
+		ret = l2pm_create_events(c, cpu);
+		if (ret)
+			break;
+	}
+
+	if (ret) {
+		for_each_cpu(cpu, &c->cpus)
+			l2pm_release_events(c, cpu);
+	} else {
+		c->active = true;
+	}
+	mutex_unlock(&cluster_lock);
+	put_online_cpus();
+
+	return ret;
+}
+
+static void l2pm_stop_hwmon(struct cache_hwmon *hw)
+{
+	struct l2pm_cluster *c = to_cluster(hw);
+	int cpu;
+
+	get_online_cpus();
+	mutex_lock(&cluster_lock);
+	c->active = false;
+	for_each_cpu(cpu, &c->cpus)
+		l2pm_release_events(c, cpu);
+	mutex_unlock(&cluster_lock);
+	put_online_cpus();
+}
+
+/*
+ * perf drops the per-CPU events of a CPU that goes offline, so they are
+ * released before that and created again once the CPU is back.
+ */
+static int l2pm_cpu_callback(struct notifier_block *nb,
+				unsigned long action, void *hcpu)
+{
+	int cpu = (long)hcpu;
+	struct l2pm_cluster *c;
+
+	mutex_lock(&cluster_lock);
+	list_for_each_entry(c, &cluster_list, list) {
+		if (!c->active || !cpumask_test_cpu(cpu, &c->cpus))
+			continue;
+
+		switch (action & ~CPU_TASKS_FROZEN) {
+		case CPU_ONLINE:
+			l2pm_create_events(c, cpu);
+			break;
+		case CPU_DOWN_PREPARE:
+			l2pm_release_events(c, cpu);
+			break;
+		}
+	}
+	mutex_unlock(&cluster_lock);
+
+	return NOTIFY_OK;
+}
+
+static struct notifier_block l2pm_cpu_nb = {
+	.notifier_call = l2pm_cpu_callback,
+};
+
+static int armv8_l2pm_driver_probe(struct platform_device *pdev)
+{
+	struct device *dev = &pdev->dev;
+	struct l2pm_cluster *c;
+	const __be32 *prop;
+	int len, i, ret;
+	u32 cpu;
+
+	c = devm_kzalloc(dev, sizeof(*c), GFP_KERNEL);
+	if (!c)
+		return -ENOMEM;
+
+	prop = of_get_property(dev->of_node, "qcom,cpus", &len);
+	if (!prop || !len) {
+		dev_err(dev, "qcom,cpus missing\n");
+		return -EINVAL;
+	}
+
+	for (i = 0; i < len / sizeof(u32); i++) {
+		cpu = be32_to_cpup(prop + i);
+		if (cpu >= nr_cpu_ids) {
+			dev_err(dev, "Invalid CPU %u\n", cpu);
+			return -EINVAL;
+		}
+		cpumask_set_cpu(cpu, &c->cpus);
+	}
+
+	c->hw.of_node = of_parse_phandle(dev->of_node, "qcom,target-dev", 0);
+	if (!c->hw.of_node)
+		return -EINVAL;
+
+	c->data = alloc_percpu(struct l2pm_cpu_data);
+	if (!c->data)
+		return -ENOMEM;
+
+	spin_lock_init(&c->lock);
+	c->hw.start_hwmon = &l2pm_start_hwmon;
+	c->hw.stop_hwmon = &l2pm_stop_hwmon;
+	c->hw.meas_mrps_and_set_irq = &l2pm_meas_mrps_and_set_irq;
+
+	mutex_lock(&cluster_lock);
+	list_add_tail(&c->list, &cluster_list);
+	mutex_unlock(&cluster_lock);
+
+	ret = register_cache_hwmon(dev, &c->hw);
+	if (ret) {
+		pr_err("Cache hwmon registration failed\n");
+		mutex_lock(&cluster_lock);
+		list_del(&c->list);
+		mutex_unlock(&cluster_lock);
+		free_percpu(c->data);
+		return ret;
+	}
+
+	return 0;
+}
+
+static struct of_device_id match_table[] = {
+	{ .compatible = "qcom,armv8-l2pm" },
+	{}
+};
+
+static struct platform_driver armv8_l2pm_driver = {
+	.probe = armv8_l2pm_driver_probe,
+	.driver = {
+		.name = "armv8-l2pm",
+		.of_match_table = match_table,
+		.owner = THIS_MODULE,
+	},
+};
+
+static int __init armv8_l2pm_init(void)
+{
+	register_cpu_notifier(&l2pm_cpu_nb);
+	return platform_driver_register(&armv8_l2pm_driver);
+}
+module_init(armv8_l2pm_init);
+
+static void __exit armv8_l2pm_exit(void)
+{
+	platform_driver_unregister(&armv8_l2pm_driver);
+	unregister_cpu_notifier(&l2pm_cpu_nb);
+}
+module_exit(armv8_l2pm_exit);
+
+MODULE_DESCRIPTION("ARMv8 L2 and CCI traffic monitor for cache frequency");
+MODULE_LICENSE("GPL v2");
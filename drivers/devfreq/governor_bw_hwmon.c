@@ -24,6 +24,7 @@
 #include <linux/err.h>
 #include <linux/errno.h>
 #include <linux/mutex.h>
+#include <linux/slab.h>
 #include <linux/interrupt.h>
 #include <linux/platform_device.h>
 #include <linux/of.h>
@@ -31,12 +32,26 @@
 #include "governor.h"
 #include "governor_bw_hwmon.h"
 
+#define NUM_BURST_BUCKETS	8
+#define BURST_UNIT_MBPS		100
+#define BURST_HIST_MAX		256
+#define BURST_GAP_MAX_US	(500 * USEC_PER_MSEC)
+
 struct hwmon_node {
 	unsigned int tolerance_percent;
 	unsigned int guard_band_mbps;
 	unsigned int decay_rate;
 	unsigned int io_percent;
 	unsigned int bw_step;
+	unsigned int up_scale;
+	unsigned int burst_percent;
+	unsigned int burst_hist[NUM_BURST_BUCKETS];
+	unsigned int burst_total;
+	unsigned int burst_gap_us;
+	ktime_t last_burst_ts;
+	bool irq_ramp;
+	u64 *residency_us;
+	ktime_t residency_ts;
 	unsigned long prev_ab;
 	unsigned long *dev_ab;
 	unsigned long resume_freq;
@@ -122,19 +137,86 @@ static unsigned long measure_bw_and_set_irq(struct hwmon_node *node)
 	return mbps;
 }
 
+/*
+ * Bursts are binned by size in power of two multiples of BURST_UNIT_MBPS.
+ * The histogram is halved once it holds BURST_HIST_MAX bursts so that it
+ * follows the current workload.
+ */
+static void record_burst(struct hwmon_node *node, int mbps, ktime_t now)
+{
+	unsigned int b, gap;
+	int i;
+
+	b = min(fls(mbps / BURST_UNIT_MBPS), NUM_BURST_BUCKETS - 1);
+
+	if (node->burst_total >= BURST_HIST_MAX) {
+		node->burst_total = 0;
+		for (i = 0; i < NUM_BURST_BUCKETS; i++) {
+			node->burst_hist[i] /= 2;
+			node->burst_total += node->burst_hist[i];
+		}
+	}
+	node->burst_hist[b]++;
+	node->burst_total++;
+
+	if (ktime_to_us(node->last_burst_ts)) {
+		gap = min_t(s64, ktime_us_delta(now, node->last_burst_ts),
+							BURST_GAP_MAX_US);
+		if (node->burst_gap_us)
+			node->burst_gap_us = (3 * node->burst_gap_us + gap) / 4;
+		else
+			node->burst_gap_us = gap;
+	}
+	node->last_burst_ts = now;
+}
+
+/*
+ * Bandwidth to hold on to while the next burst is expected: the size that
+ * covers burst_percent of the recent bursts. Once twice the usual gap
+ * between bursts has passed without one, normal decay takes over.
+ */
+static int burst_floor(struct hwmon_node *node, ktime_t now)
+{
+	unsigned int target, sum = 0;
+	int i;
+
+	if (!node->burst_percent || !node->burst_total || !node->burst_gap_us)
+		return 0;
+
+	if (ktime_us_delta(now, node->last_burst_ts) > 2 * node->burst_gap_us)
+		return 0;
+
+	target = DIV_ROUND_UP(node->burst_total * node->burst_percent, 100);
+	for (i = 0; i < NUM_BURST_BUCKETS - 1; i++) {
+		sum += node->burst_hist[i];
+		if (sum >= target)
+			break;
+	}
+
+	return BURST_UNIT_MBPS << i;
+}
+
 static void compute_bw(struct hwmon_node *node, int mbps,
 			unsigned long *freq, unsigned long *ab)
 {
 	int new_bw;
+	ktime_t now = ktime_get();
 
 	mbps += node->guard_band_mbps;
 
 	if (mbps > node->prev_ab) {
 		new_bw = mbps;
+		/* Overshoot when the threshold IRQ caught a ramp */
+		if (node->irq_ramp)
+			new_bw = mult_frac(new_bw, node->up_scale, 100);
+		if (mbps > node->prev_ab + node->bw_step)
+			record_burst(node, mbps, now);
 	} else {
 		new_bw = mbps * node->decay_rate
 			+ node->prev_ab * (100 - node->decay_rate);
 		new_bw /= 100;
+		new_bw = max_t(int, new_bw,
+			min_t(int, burst_floor(node, now), node->prev_ab));
 	}
 
 	node->prev_ab = new_bw;
@@ -161,6 +243,24 @@ static struct hwmon_node *find_hwmon_node(struct devfreq *df)
 	return found;
 }
 
+static void update_residency(struct devfreq *df, struct hwmon_node *node)
+{
+	ktime_t now = ktime_get();
+	int i;
+
+	if (!node->residency_us)
+		return;
+
+	for (i = 0; i < df->profile->max_state; i++) {
+		if (df->profile->freq_table[i] == df->previous_freq) {
+			node->residency_us[i] += ktime_us_delta(now,
+							node->residency_ts);
+			break;
+		}
+	}
+	node->residency_ts = now;
+}
+
 #define TOO_SOON_US	(1 * USEC_PER_MSEC)
 int update_bw_hwmon(struct bw_hwmon *hwmon)
 {
@@ -199,7 +299,9 @@ int update_bw_hwmon(struct bw_hwmon *hwmon)
 	us = ktime_to_us(ktime_sub(ts, node->prev_ts));
 	if (us > TOO_SOON_US) {
 		mutex_lock(&df->lock);
+		node->irq_ramp = true;
 		ret = update_devfreq(df);
+		node->irq_ramp = false;
 		if (ret)
 			dev_err(df->dev.parent,
 				"Unable to update freq on request!\n");
@@ -225,6 +327,10 @@ static int start_monitor(struct devfreq *df, bool init)
 		node->prev_ab = 0;
 		node->resume_freq = 0;
 		node->resume_ab = 0;
+		memset(node->burst_hist, 0, sizeof(node->burst_hist));
+		node->burst_total = 0;
+		node->burst_gap_us = 0;
+		node->last_burst_ts = ktime_set(0, 0);
 		mbps = (df->previous_freq * node->io_percent) / 100;
 		ret = hw->start_hwmon(hw, mbps);
 	} else {
@@ -286,6 +392,12 @@ static int gov_start(struct devfreq *df)
 	else
 		node->dev_ab = stat.private_data;
 
+	if (df->profile->freq_table && df->profile->max_state) {
+		node->residency_us = kcalloc(df->profile->max_state,
+					sizeof(*node->residency_us), GFP_KERNEL);
+		node->residency_ts = ktime_get();
+	}
+
 	hw->df = df;
 	node->orig_data = df->data;
 	df->data = node;
@@ -306,6 +418,8 @@ err_start:
 	node->orig_data = NULL;
 	hw->df = NULL;
 	node->dev_ab = NULL;
+	kfree(node->residency_us);
+	node->residency_us = NULL;
 	return ret;
 }
 
@@ -328,6 +442,8 @@ static void gov_stop(struct devfreq *df)
 	if (node->dev_ab)
 		*node->dev_ab = 0;
 	node->dev_ab = NULL;
+	kfree(node->residency_us);
+	node->residency_us = NULL;
 }
 
 static int gov_suspend(struct devfreq *df)
@@ -385,6 +501,8 @@ static int devfreq_bw_hwmon_get_freq(struct devfreq *df,
 	unsigned long mbps;
 	struct hwmon_node *node = df->data;
 
+	update_residency(df, node);
+
 	/* Suspend/resume sequence */
 	if (!node->mon_started) {
 		*freq = node->resume_freq;
@@ -403,6 +521,28 @@ gov_attr(guard_band_mbps, 0U, 2000U);
 gov_attr(decay_rate, 0U, 100U);
 gov_attr(io_percent, 1U, 100U);
 gov_attr(bw_step, 50U, 1000U);
+gov_attr(up_scale, 100U, 500U);
+gov_attr(burst_percent, 0U, 100U);
+
+static ssize_t show_residency(struct device *dev,
+			struct device_attribute *attr, char *buf)
+{
+	struct devfreq *df = to_devfreq(dev);
+	struct hwmon_node *node = df->data;
+	ssize_t cnt = 0;
+	int i;
+
+	if (!node->residency_us)
+		return -ENODEV;
+
+	for (i = 0; i < df->profile->max_state; i++)
+		cnt += scnprintf(buf + cnt, PAGE_SIZE - cnt, "%u %llu\n",
+				df->profile->freq_table[i],
+				div_u64(node->residency_us[i], USEC_PER_MSEC));
+
+	return cnt;
+}
+static DEVICE_ATTR(residency, 0444, show_residency, NULL);
 
 static struct attribute *dev_attr[] = {
 	&dev_attr_tolerance_percent.attr,
@@ -410,6 +550,9 @@ static struct attribute *dev_attr[] = {
 	&dev_attr_decay_rate.attr,
 	&dev_attr_io_percent.attr,
 	&dev_attr_bw_step.attr,
+	&dev_attr_up_scale.attr,
+	&dev_attr_burst_percent.attr,
+	&dev_attr_residency.attr,
 	NULL,
 };
 
@@ -523,6 +666,8 @@ int register_bw_hwmon(struct device *dev, struct bw_hwmon *hwmon)
 	node->decay_rate = 90;
 	node->io_percent = 16;
 	node->bw_step = 190;
+	node->up_scale = 125;
+	node->burst_percent = 50;
 	node->hw = hwmon;
 
 	mutex_lock(&list_lock);
@@ -0,0 +1,321 @@
+/* Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+/*
+ * Frame deadline governor for the Adreno GPU.
+ *
+ * KGSL sends ADRENO_DEVFREQ_NOTIFY_FRAME when the end of frame command
+ * batch of a context (the one submitted at eglSwapBuffers) retires. The
+ * GPU work between two of those is measured in cycles, which unlike busy
+ * time doesn't depend on the frequency the frame happened to run at. The
+ * prediction for the next frame follows a bigger frame right away and
+ * decays slowly after a smaller one, and the lowest frequency that gets
+ * the predicted cycles done in the vsync period (less the headroom) is
+ * picked.
+ *
+ * A frame that is still open when it already used more cycles than were
+ * predicted raises the prediction on the spot, and content that doesn't
+ * mark its frames is treated as a frame every two vsync periods.
+ */
+
+#include <linux/errno.h>
+#include <linux/module.h>
+#include <linux/devfreq.h>
+#include <linux/math64.h>
+#include <linux/slab.h>
+#include <linux/msm_adreno_devfreq.h>
+#include "governor.h"
+
+#define TAG "msm_adreno_frame: "
+
+#define DEFAULT_VSYNC_US	16667
+#define DEFAULT_HEADROOM	10
+#define DEFAULT_DECAY		25
+
+struct frame_gov {
+	struct notifier_block nb;
+	struct devfreq *df;
+	void *orig_data;
+
+	/* tunables */
+	unsigned int vsync_us;
+	unsigned int headroom_percent;
+	unsigned int decay_percent;
+
+	bool frame_end;			/* a frame marker retired */
+	u64 frame_cycles;		/* cycles of the open frame */
+	u64 frame_time;			/* wall time of the open frame, us */
+	u64 predicted_cycles;
+	u64 last_cycles;
+};
+
+static u64 frame_deadline_cycles(struct frame_gov *fg, unsigned long freq)
+{
+	u64 us = (u64)fg->vsync_us * (100 - fg->headroom_percent) / 100;
+
+	return us * (freq / USEC_PER_SEC);
+}
+
+static void frame_predict(struct frame_gov *fg, u64 cycles)
+{
+	u64 p = fg->predicted_cycles;
+
+	if (cycles >= p)
+		p = cycles;
+	else
+		p -= div_u64((p - cycles) * fg->decay_percent, 100);
+
+	fg->predicted_cycles = p;
+	fg->last_cycles = cycles;
+}
+
+static int frame_get_target_freq(struct devfreq *devfreq, unsigned long *freq,
+				u32 *flag)
+{
+	struct frame_gov *fg = devfreq->data;
+	struct devfreq_dev_status stats;
+	int level, result;
+
+	result = devfreq->profile->get_dev_status(devfreq->dev.parent, &stats);
+	if (result) {
+		pr_err(TAG "get_status failed %d\n", result);
+		return result;
+	}
+
+	*freq = stats.current_frequency;
+
+	fg->frame_cycles += (u64)stats.busy_time *
+		(stats.current_frequency / USEC_PER_SEC);
+	fg->frame_time += stats.total_time;
+
+	if (fg->frame_end || fg->frame_time >= 2 * fg->vsync_us) {
+		frame_predict(fg, fg->frame_cycles);
+		fg->frame_cycles = 0;
+		fg->frame_time = 0;
+		fg->frame_end = false;
+	} else if (fg->frame_cycles > fg->predicted_cycles) {
+		/* The open frame is already bigger than predicted */
+		fg->predicted_cycles = fg->frame_cycles;
+	} else {
+		return 0;
+	}
+
+	/* freq_table is sorted from the highest to the lowest frequency */
+	for (level = devfreq->profile->max_state - 1; level > 0; level--)
+		if (fg->predicted_cycles <= frame_deadline_cycles(fg,
+				devfreq->profile->freq_table[level]))
+			break;
+
+	*freq = devfreq->profile->freq_table[level];
+	return 0;
+}
+
+static int frame_notify(struct notifier_block *nb, unsigned long type,
+			void *devp)
+{
+	struct frame_gov *fg = container_of(nb, struct frame_gov, nb);
+	struct devfreq *devfreq = devp;
+	int result = 0;
+
+	switch (type) {
+	case ADRENO_DEVFREQ_NOTIFY_FRAME:
+	case ADRENO_DEVFREQ_NOTIFY_RETIRE:
+		mutex_lock(&devfreq->lock);
+		if (type == ADRENO_DEVFREQ_NOTIFY_FRAME)
+			fg->frame_end = true;
+		result = update_devfreq(devfreq);
+		mutex_unlock(&devfreq->lock);
+		break;
+	/* ignored by this governor */
+	case ADRENO_DEVFREQ_NOTIFY_SUBMIT:
+	case ADRENO_DEVFREQ_NOTIFY_IDLE:
+	default:
+		break;
+	}
+	return notifier_from_errno(result);
+}
+
+#define show_attr(name) \
+static ssize_t show_##name(struct device *dev,				\
+			struct device_attribute *attr, char *buf)	\
+{									\
+	struct devfreq *df = to_devfreq(dev);				\
+	struct frame_gov *fg = df->data;				\
+	return snprintf(buf, PAGE_SIZE, "%u\n", fg->name);		\
+}
+
+#define store_attr(name, _min, _max) \
+static ssize_t store_##name(struct device *dev,				\
+			struct device_attribute *attr, const char *buf,	\
+			size_t count)					\
+{									\
+	struct devfreq *df = to_devfreq(dev);				\
+	struct frame_gov *fg = df->data;				\
+	int ret;							\
+	unsigned int val;						\
+	ret = sscanf(buf, "%u", &val);					\
+	if (ret != 1)							\
+		return -EINVAL;						\
+	val = max(val, _min);						\
+	val = min(val, _max);						\
+	fg->name = val;							\
+	return count;							\
+}
+
+#define gov_attr(__attr, min, max)	\
+show_attr(__attr)			\
+store_attr(__attr, min, max)		\
+static DEVICE_ATTR(__attr, 0644, show_##__attr, store_##__attr)
+
+gov_attr(vsync_us, 4000U, 100000U);
+gov_attr(headroom_percent, 0U, 50U);
+gov_attr(decay_percent, 1U, 100U);
+
+static ssize_t show_predicted_us(struct device *dev,
+			struct device_attribute *attr, char *buf)
+{
+	struct devfreq *df = to_devfreq(dev);
+	struct frame_gov *fg = df->data;
+	unsigned long mhz = df->previous_freq / USEC_PER_SEC;
+
+	if (!mhz)
+		return snprintf(buf, PAGE_SIZE, "0\n");
+	return snprintf(buf, PAGE_SIZE, "%llu\n",
+			div_u64(fg->predicted_cycles, mhz));
+}
+static DEVICE_ATTR(predicted_us, 0444, show_predicted_us, NULL);
+
+static struct attribute *dev_attr[] = {
+	&dev_attr_vsync_us.attr,
+	&dev_attr_headroom_percent.attr,
+	&dev_attr_decay_percent.attr,
+	&dev_attr_predicted_us.attr,
+	NULL,
+};
+
+static struct attribute_group dev_attr_group = {
+	.name = "adreno_frame",
+	.attrs = dev_attr,
+};
+
+static int frame_start(struct devfreq *devfreq)
+{
+	struct frame_gov *fg;
+	int ret;
+
+	fg = kzalloc(sizeof(*fg), GFP_KERNEL);
+	if (fg == NULL)
+		return -ENOMEM;
+
+	fg->nb.notifier_call = frame_notify;
+	fg->vsync_us = DEFAULT_VSYNC_US;
+	fg->headroom_percent = DEFAULT_HEADROOM;
+	fg->decay_percent = DEFAULT_DECAY;
+	fg->df = devfreq;
+	fg->orig_data = devfreq->data;
+	devfreq->data = fg;
+
+	ret = sysfs_create_group(&devfreq->dev.kobj, &dev_attr_group);
+	if (ret)
+		goto err;
+
+	ret = kgsl_devfreq_add_notifier(devfreq->dev.parent, &fg->nb);
+	if (ret) {
+		sysfs_remove_group(&devfreq->dev.kobj, &dev_attr_group);
+		goto err;
+	}
+
+	return 0;
+err:
+	devfreq->data = fg->orig_data;
+	kfree(fg);
+	return ret;
+}
+
+static int frame_stop(struct devfreq *devfreq)
+{
+	struct frame_gov *fg = devfreq->data;
+
+	kgsl_devfreq_del_notifier(devfreq->dev.parent, &fg->nb);
+	sysfs_remove_group(&devfreq->dev.kobj, &dev_attr_group);
+
+	devfreq->data = fg->orig_data;
+	kfree(fg);
+	return 0;
+}
+
+static int frame_suspend(struct devfreq *devfreq)
+{
+	struct frame_gov *fg = devfreq->data;
+
+	/* The prediction is kept for the first frame after the wake up */
+	fg->frame_cycles = 0;
+	fg->frame_time = 0;
+	fg->frame_end = false;
+	return 0;
+}
+
+static int frame_handler(struct devfreq *devfreq, unsigned int event,
+			void *data)
+{
+	int result;
+
+	BUG_ON(devfreq == NULL);
+
+	switch (event) {
+	case DEVFREQ_GOV_START:
+		result = frame_start(devfreq);
+		break;
+
+	case DEVFREQ_GOV_STOP:
+		result = frame_stop(devfreq);
+		break;
+
+	case DEVFREQ_GOV_SUSPEND:
+		result = frame_suspend(devfreq);
+		break;
+
+	case DEVFREQ_GOV_RESUME:
+	case DEVFREQ_GOV_INTERVAL:
+		/* ignored, this governor doesn't use polling */
+	default:
+		result = 0;
+		break;
+	}
+
+	return result;
+}
+
+static struct devfreq_governor msm_adreno_frame = {
+	.name = "msm-adreno-frame",
+	.get_target_freq = frame_get_target_freq,
+	.event_handler = frame_handler,
+};
+
+static int __init msm_adreno_frame_init(void)
+{
+	return devfreq_add_governor(&msm_adreno_frame);
+}
+subsys_initcall(msm_adreno_frame_init);
+
+static void __exit msm_adreno_frame_exit(void)
+{
+	int ret;
+
+	ret = devfreq_remove_governor(&msm_adreno_frame);
+	if (ret)
+		pr_err(TAG "failed to remove governor %d\n", ret);
+}
+module_exit(msm_adreno_frame_exit);
+
+MODULE_LICENSE("GPLv2");
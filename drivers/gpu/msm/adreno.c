@@ -939,6 +939,8 @@ static int adreno_remove(struct platform_device *pdev)
 	if (test_bit(ADRENO_DEVICE_CMDBATCH_PROFILE, &adreno_dev->priv))
 		kgsl_free_global(&adreno_dev->cmdbatch_profile_buffer);
 
+	adreno_perfring_close(adreno_dev);
+
 #ifdef CONFIG_INPUT
 	input_unregister_handler(&adreno_input_handler);
 #endif
@@ -1094,6 +1096,7 @@ static int adreno_init(struct kgsl_device *device)
 				PAGE_SIZE);
 		}
 
+		adreno_perfring_init(adreno_dev);
 	}
 
 	return ret;
@@ -2095,6 +2098,10 @@ static int adreno_init_sysfs(struct kgsl_device *device)
 		goto done;
 
 	ret  = sysfs_create_file(&device->ppd_kobj, &attr_enable.attr);
+	if (ret)
+		goto done;
+
+	ret = adreno_perfring_init_sysfs(device);
 
 done:
 	return ret;
@@ -2102,6 +2109,8 @@ done:
 
 static void adreno_uninit_sysfs(struct kgsl_device *device)
 {
+	adreno_perfring_uninit_sysfs(device);
+
 	sysfs_remove_file(&device->ppd_kobj, &attr_enable.attr);
 
 	kobject_put(&device->ppd_kobj);
@@ -18,6 +18,7 @@
 #include "adreno_drawctxt.h"
 #include "adreno_ringbuffer.h"
 #include "adreno_profile.h"
+#include "adreno_perfring.h"
 #include "adreno_dispatch.h"
 #include "kgsl_iommu.h"
 #include <linux/stat.h>
@@ -247,6 +248,7 @@ struct adreno_device {
 
 	struct kgsl_memdesc cmdbatch_profile_buffer;
 	unsigned int cmdbatch_profile_index;
+	struct adreno_perfring perfring;
 };
 
 /**
@@ -199,6 +199,9 @@ static int ctx_print(struct seq_file *s, void *unused)
 		   queued, consumed, retired,
 		   drawctxt->internal_timestamp);
 
+	seq_printf(s, "gpu time: %llu us\n",
+		   div_u64(drawctxt->gpu_time, NSEC_PER_USEC));
+
 	seq_puts(s, "cmdqueue:\n");
 
 	spin_lock(&drawctxt->lock);
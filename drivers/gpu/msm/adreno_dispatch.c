@@ -16,6 +16,7 @@
 #include <linux/sched.h>
 #include <linux/jiffies.h>
 #include <linux/err.h>
+#include <linux/cpu_boost.h>
 
 #include "kgsl.h"
 #include "kgsl_cffdump.h"
@@ -58,6 +59,24 @@ static unsigned int _dispatcher_q_inflight_hi = 15;
  */
 static unsigned int _dispatcher_q_inflight_lo = 4;
 
+/*
+ * Contexts with a priority value below _dispatcher_hp_priority (a lower
+ * value is a higher priority) are latency sensitive, like the compositor.
+ * For _dispatcher_hp_window milliseconds after one of them queued work the
+ * other contexts may only keep _dispatcher_q_inflight_preempt command
+ * batches on the ringbuffer, so the high priority work is never stuck
+ * behind a deep queue of background frames.
+ */
+static unsigned int _dispatcher_hp_priority = 8;
+static unsigned int _dispatcher_hp_window = 100;
+static unsigned int _dispatcher_q_inflight_preempt = 2;
+
+/*
+ * Half life (in milliseconds) of the recent GPU time of a context, which
+ * picks between the pending contexts of the same priority
+ */
+static unsigned int _context_gpu_time_halflife = 100;
+
 /* Command batch timeout (in milliseconds) */
 static unsigned int _cmdbatch_timeout = 2000;
 
@@ -137,6 +156,111 @@ _cmdqueue_inflight(struct adreno_dispatcher_cmdqueue *cmdqueue)
 		? _dispatcher_q_inflight_lo : _dispatcher_q_inflight_hi;
 }
 
+/*
+ * Return the recent GPU time of the context decayed to now. Called with
+ * the dispatcher mutex held.
+ */
+static uint64_t _context_recent_gpu_time(struct adreno_context *drawctxt)
+{
+	unsigned long period = msecs_to_jiffies(_context_gpu_time_halflife);
+	unsigned long halves = (jiffies - drawctxt->recent_stamp) / period;
+
+	if (halves) {
+		drawctxt->recent_gpu_time = halves < 64 ?
+			drawctxt->recent_gpu_time >> halves : 0;
+		drawctxt->recent_stamp += halves * period;
+	}
+
+	return drawctxt->recent_gpu_time;
+}
+
+/*
+ * Charge the GPU time of a retired command batch to its context and
+ * process. Batches on one ringbuffer run one after the other, so the batch
+ * ran from when it was submitted or the one before it retired, whichever
+ * is later. The CP start and retire ticks are used instead when kernel
+ * profiling is on.
+ */
+static void _account_gpu_time(struct adreno_dispatcher_cmdqueue *dispatch_q,
+		struct kgsl_cmdbatch *cmdbatch, uint64_t start_ticks,
+		uint64_t retire_ticks)
+{
+	struct adreno_context *drawctxt = ADRENO_CONTEXT(cmdbatch->context);
+	uint64_t now = local_clock();
+	uint64_t busy;
+
+	if (test_bit(CMDBATCH_FLAG_PROFILE, &cmdbatch->priv) &&
+		retire_ticks > start_ticks)
+		/* the always on counter runs at 19.2 MHz */
+		busy = div_u64((retire_ticks - start_ticks) * 10000, 192);
+	else
+		busy = now - max(cmdbatch->submit_time, dispatch_q->retire_time);
+
+	dispatch_q->retire_time = now;
+
+	drawctxt->gpu_time += busy;
+	drawctxt->recent_gpu_time = _context_recent_gpu_time(drawctxt) + busy;
+	if (cmdbatch->context->proc_priv)
+		atomic64_add(busy, &cmdbatch->context->proc_priv->gpu_time);
+}
+
+/*
+ * Pick the next context to dispatch from: the highest priority class goes
+ * first and within it the context that used the least GPU time lately.
+ * Called with the plist lock held and the pending list not empty.
+ */
+static struct adreno_context *_pick_context(struct adreno_dispatcher *dispatcher)
+{
+	struct adreno_context *drawctxt, *best;
+	uint64_t best_time;
+
+	best = plist_first_entry(&dispatcher->pending, struct adreno_context,
+		pending);
+	best_time = _context_recent_gpu_time(best);
+
+	plist_for_each_entry(drawctxt, &dispatcher->pending, pending) {
+		uint64_t t;
+
+		if (drawctxt->pending.prio != best->pending.prio)
+			break;
+
+		t = _context_recent_gpu_time(drawctxt);
+		if (t < best_time) {
+			best = drawctxt;
+			best_time = t;
+		}
+	}
+
+	return best;
+}
+
+static inline bool _context_is_hp(struct adreno_context *drawctxt)
+{
+	return drawctxt->base.priority < _dispatcher_hp_priority;
+}
+
+/*
+ * The inflight limit for a context: lower priority contexts get the small
+ * preemption limit while high priority work is around.
+ */
+static int _context_inflight(struct adreno_dispatcher *dispatcher,
+		struct adreno_context *drawctxt, bool *throttled)
+{
+	int inflight = _cmdqueue_inflight(&drawctxt->rb->dispatch_q);
+
+	*throttled = false;
+
+	if (!_context_is_hp(drawctxt) &&
+		time_before(jiffies, dispatcher->hp_jiffies +
+			msecs_to_jiffies(_dispatcher_hp_window)) &&
+		inflight > _dispatcher_q_inflight_preempt) {
+		inflight = _dispatcher_q_inflight_preempt;
+		*throttled = true;
+	}
+
+	return inflight;
+}
+
 /**
  * fault_detect_read() - Read the set of fault detect registers
  * @device: Pointer to the KGSL device struct
@@ -570,6 +694,17 @@ static int sendcmd(struct adreno_device *adreno_dev,
 		time.ticks, (unsigned long) secs, nsecs / 1000);
 
 	cmdbatch->submit_ticks = time.ticks;
+	cmdbatch->submit_time = time.ktime;
+
+	if (_context_is_hp(ADRENO_CONTEXT(cmdbatch->context))) {
+		unsigned int lat = (unsigned int) ktime_us_delta(ktime_get(),
+			cmdbatch->queued_time);
+
+		dispatcher->hp_submitted++;
+		dispatcher->hp_latency_total += lat;
+		if (lat > dispatcher->hp_latency_max)
+			dispatcher->hp_latency_max = lat;
+	}
 
 	dispatch_q->cmd_q[dispatch_q->tail] = cmdbatch;
 	dispatch_q->tail = (dispatch_q->tail + 1) %
@@ -615,15 +750,20 @@ static int sendcmd(struct adreno_device *adreno_dev,
 static int dispatcher_context_sendcmds(struct adreno_device *adreno_dev,
 		struct adreno_context *drawctxt)
 {
+	struct adreno_dispatcher *dispatcher = &adreno_dev->dispatcher;
 	struct adreno_dispatcher_cmdqueue *dispatch_q =
 					&(drawctxt->rb->dispatch_q);
 	int count = 0;
 	int ret = 0;
-	int inflight = _cmdqueue_inflight(dispatch_q);
+	bool throttled;
+	int inflight = _context_inflight(dispatcher, drawctxt, &throttled);
 	unsigned int timestamp;
 
-	if (dispatch_q->inflight >= inflight)
+	if (dispatch_q->inflight >= inflight) {
+		if (throttled)
+			dispatcher->preempt_throttled++;
 		return -EBUSY;
+	}
 
 	/*
 	 * Each context can send a specific number of command batches per cycle
@@ -748,8 +888,7 @@ static void _adreno_dispatcher_issuecmds(struct adreno_device *adreno_dev)
 		}
 
 		/* Get the next entry on the list */
-		drawctxt = plist_first_entry(&dispatcher->pending,
-			struct adreno_context, pending);
+		drawctxt = _pick_context(dispatcher);
 
 		plist_del(&drawctxt->pending, &dispatcher->pending);
 
@@ -1054,11 +1193,16 @@ int adreno_dispatcher_queue_cmd(struct adreno_device *adreno_dev,
 	drawctxt->queued++;
 	trace_adreno_cmdbatch_queued(cmdbatch, drawctxt->queued);
 
+	cmdbatch->queued_time = ktime_get();
+	if (_context_is_hp(drawctxt))
+		adreno_dev->dispatcher.hp_jiffies = jiffies;
+
 	_track_context(dispatch_q, drawctxt->base.id);
 
 	spin_unlock(&drawctxt->lock);
 
 	kgsl_pwrctrl_update_l2pc(&adreno_dev->dev);
+	cpu_boost_frame_event();
 
 	/* Add the context to the dispatcher pending list */
 	dispatcher_queue_context(adreno_dev, drawctxt);
@@ -1841,6 +1985,15 @@ static int adreno_dispatch_process_cmdqueue(struct adreno_device *adreno_dev,
 				(int) dispatcher->inflight, start_ticks,
 				retire_ticks);
 
+			_account_gpu_time(dispatch_q, cmdbatch, start_ticks,
+				retire_ticks);
+
+			adreno_perfring_retire(adreno_dev, cmdbatch);
+
+			/* Let a frame based governor know a frame is done */
+			if (cmdbatch->flags & KGSL_CMDBATCH_END_OF_FRAME)
+				kgsl_pwrscale_frame(device);
+
 			/* Record the delta between submit and retire ticks */
 			drawctxt->submit_retire_ticks[drawctxt->ticks_index] =
 				retire_ticks - cmdbatch->submit_ticks;
@@ -2202,6 +2355,30 @@ static DISPATCHER_UINT_ATTR(fault_throttle_time, 0644, 0,
 	_fault_throttle_time);
 static DISPATCHER_UINT_ATTR(fault_throttle_burst, 0644, 0,
 	_fault_throttle_burst);
+static DISPATCHER_UINT_ATTR(gpu_time_halflife, 0644, 0,
+	_context_gpu_time_halflife);
+static DISPATCHER_UINT_ATTR(hp_priority, 0644, 16, _dispatcher_hp_priority);
+static DISPATCHER_UINT_ATTR(hp_window, 0644, 0, _dispatcher_hp_window);
+static DISPATCHER_UINT_ATTR(inflight_preempt, 0644,
+	ADRENO_DISPATCH_CMDQUEUE_SIZE, _dispatcher_q_inflight_preempt);
+
+static ssize_t _show_preempt_stats(struct adreno_dispatcher *dispatcher,
+		struct dispatcher_attribute *attr,
+		char *buf)
+{
+	unsigned int count = dispatcher->hp_submitted;
+
+	return snprintf(buf, PAGE_SIZE,
+		"hp_submitted %u\nhp_latency_avg_us %llu\n"
+		"hp_latency_max_us %u\nthrottled %u\n", count,
+		count ? div_u64(dispatcher->hp_latency_total, count) : 0,
+		dispatcher->hp_latency_max, dispatcher->preempt_throttled);
+}
+
+static struct dispatcher_attribute dispatcher_attr_preempt_stats = {
+	.attr = { .name = "preempt_stats", .mode = 0444 },
+	.show = _show_preempt_stats,
+};
 
 static struct attribute *dispatcher_attrs[] = {
 	&dispatcher_attr_inflight.attr,
@@ -2213,6 +2390,11 @@ static struct attribute *dispatcher_attrs[] = {
 	&dispatcher_attr_fault_detect_interval.attr,
 	&dispatcher_attr_fault_throttle_time.attr,
 	&dispatcher_attr_fault_throttle_burst.attr,
+	&dispatcher_attr_gpu_time_halflife.attr,
+	&dispatcher_attr_hp_priority.attr,
+	&dispatcher_attr_hp_window.attr,
+	&dispatcher_attr_inflight_preempt.attr,
+	&dispatcher_attr_preempt_stats.attr,
 	NULL,
 };
 
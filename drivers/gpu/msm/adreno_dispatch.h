@@ -40,6 +40,7 @@ struct adreno_context_list {
  * @tail: Queues tail pointer
  * @active_contexts: List of most recently seen contexts
  * @active_context_count: Number of active contexts in the active_contexts list
+ * @retire_time: local_clock() when the last command batch in the q retired
  */
 struct adreno_dispatcher_cmdqueue {
 	struct kgsl_cmdbatch *cmd_q[ADRENO_DISPATCH_CMDQUEUE_SIZE];
@@ -48,6 +49,7 @@ struct adreno_dispatcher_cmdqueue {
 	unsigned int tail;
 	struct adreno_context_list active_contexts[ACTIVE_CONTEXT_LIST_MAX];
 	int active_context_count;
+	uint64_t retire_time;
 };
 
 /**
@@ -62,6 +64,12 @@ struct adreno_dispatcher_cmdqueue {
  * @work: work_struct to put the dispatcher in a work queue
  * @kobj: kobject for the dispatcher directory in the device sysfs node
  * @idle_gate: Gate to wait on for dispatcher to idle
+ * @hp_jiffies: Last time a high priority context queued a command batch
+ * @hp_submitted: Number of high priority command batches submitted
+ * @hp_latency_total: Sum of the queue to submit latencies of those (usecs)
+ * @hp_latency_max: Largest queue to submit latency of those (usecs)
+ * @preempt_throttled: Times a lower priority context was held back for
+ * high priority work
  */
 struct adreno_dispatcher {
 	struct mutex mutex;
@@ -75,6 +83,11 @@ struct adreno_dispatcher {
 	struct kthread_work work;
 	struct kobject kobj;
 	struct completion idle_gate;
+	unsigned long hp_jiffies;
+	unsigned int hp_submitted;
+	u64 hp_latency_total;
+	unsigned int hp_latency_max;
+	unsigned int preempt_throttled;
 };
 
 enum adreno_dispatcher_flags {
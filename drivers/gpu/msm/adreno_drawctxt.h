@@ -51,6 +51,9 @@ struct kgsl_context;
  *                       to retire
  * @ticks_index: The index into submit_retire_ticks[] where the new delta will
  *		 be written.
+ * @gpu_time: GPU time used by the retired command batches (nsecs)
+ * @recent_gpu_time: GPU time used lately, decayed by the dispatcher (nsecs)
+ * @recent_stamp: jiffies that @recent_gpu_time was last decayed at
  */
 struct adreno_context {
 	struct kgsl_context base;
@@ -76,6 +79,9 @@ struct adreno_context {
 	unsigned int submitted_timestamp;
 	uint64_t submit_retire_ticks[SUBMIT_RETIRE_TICKS_SIZE];
 	int ticks_index;
+	uint64_t gpu_time;
+	uint64_t recent_gpu_time;
+	unsigned long recent_stamp;
 };
 
 /* Flag definitions for flag field in adreno_context */
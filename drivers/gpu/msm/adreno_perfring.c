@@ -0,0 +1,449 @@
+/* Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+/*
+ * Always on perfcounter ring. While it is enabled every command batch
+ * gets a few CP_REG_TO_MEM packets around its IBs that copy the always on
+ * counter and a small fixed set of perfcounters into the next entry of a
+ * ring in global memory. The entry is published by writing its sequence
+ * number once the command batch retires, so a reader that maps the ring
+ * only ever looks at finished samples and never has to call into the
+ * driver. When the ring is disabled the submission path pays a single
+ * flag test.
+ */
+
+#include <linux/mm.h>
+#include <linux/sysfs.h>
+
+#include "adreno.h"
+#include "adreno_perfring.h"
+#include "kgsl_sharedmem.h"
+
+/* dwords for reading one 64 bit counter in two halves */
+#define PERFRING_COUNTER_DWORDS	6
+#define PERFRING_TICKS_DWORDS	3
+
+static struct kgsl_perfring_header *_header(struct adreno_perfring *ring)
+{
+	return ring->memdesc.hostptr;
+}
+
+static struct kgsl_perfring_entry *_entry(struct adreno_perfring *ring,
+		unsigned int seq)
+{
+	struct kgsl_perfring_entry *entries = ring->memdesc.hostptr +
+		sizeof(struct kgsl_perfring_header);
+
+	return &entries[seq % ADRENO_PERFRING_ENTRIES];
+}
+
+static unsigned int _entry_gpuaddr(struct adreno_perfring *ring,
+		unsigned int seq, size_t offset)
+{
+	return ring->memdesc.gpuaddr + sizeof(struct kgsl_perfring_header) +
+		(seq % ADRENO_PERFRING_ENTRIES) *
+		sizeof(struct kgsl_perfring_entry) + offset;
+}
+
+static unsigned int *_reg_to_mem(unsigned int *cmds, unsigned int reg,
+		unsigned int gpuaddr)
+{
+	*cmds++ = cp_type3_packet(CP_REG_TO_MEM, 2);
+	*cmds++ = reg;
+	*cmds++ = gpuaddr;
+	return cmds;
+}
+
+static unsigned int *_read_counters(struct adreno_device *adreno_dev,
+		unsigned int *cmds, unsigned int seq, size_t counters,
+		size_t ticks)
+{
+	struct adreno_perfring *ring = &adreno_dev->perfring;
+	int i;
+
+	cmds = _reg_to_mem(cmds,
+		adreno_getreg(adreno_dev, ADRENO_REG_RBBM_ALWAYSON_COUNTER_LO),
+		_entry_gpuaddr(ring, seq, ticks));
+
+	for (i = 0; i < ring->count; i++) {
+		unsigned int addr = _entry_gpuaddr(ring, seq,
+			counters + i * sizeof(uint64_t));
+
+		cmds = _reg_to_mem(cmds, ring->offset[i], addr);
+		cmds = _reg_to_mem(cmds, ring->offset_hi[i],
+			addr + sizeof(uint32_t));
+	}
+
+	return cmds;
+}
+
+/**
+ * adreno_perfring_dwords() - Ringbuffer space the ring adds to a submission
+ * @adreno_dev: Pointer to an adreno device
+ */
+unsigned int adreno_perfring_dwords(struct adreno_device *adreno_dev)
+{
+	struct adreno_perfring *ring = &adreno_dev->perfring;
+
+	return 2 * (PERFRING_TICKS_DWORDS +
+		ring->count * PERFRING_COUNTER_DWORDS);
+}
+
+/**
+ * adreno_perfring_start() - Sample the counters as a command batch starts
+ * @adreno_dev: Pointer to an adreno device
+ * @cmdbatch: Command batch that is being submitted
+ * @cmds: Ringbuffer commands to write the packets to
+ *
+ * Claims the next entry of the ring for @cmdbatch and fills in the CPU side
+ * of it. Returns the number of dwords written to @cmds. Called with the
+ * device mutex held.
+ */
+unsigned int adreno_perfring_start(struct adreno_device *adreno_dev,
+		struct kgsl_cmdbatch *cmdbatch, unsigned int *cmds)
+{
+	struct adreno_perfring *ring = &adreno_dev->perfring;
+	struct kgsl_perfring_entry *entry;
+	unsigned int *start = cmds;
+
+	/* 0 is never a valid sequence number */
+	if (++ring->seq == 0)
+		ring->seq = 1;
+
+	cmdbatch->perfring_seq = ring->seq;
+	set_bit(CMDBATCH_FLAG_PERFRING, &cmdbatch->priv);
+
+	entry = _entry(ring, ring->seq);
+	entry->seq = 0;
+	entry->context_id = cmdbatch->context->id;
+	entry->timestamp = cmdbatch->timestamp;
+	entry->pid = cmdbatch->context->proc_priv->pid;
+	entry->flags = cmdbatch->flags;
+
+	cmds = _read_counters(adreno_dev, cmds, ring->seq,
+		offsetof(struct kgsl_perfring_entry, start),
+		offsetof(struct kgsl_perfring_entry, ticks_start));
+
+	return cmds - start;
+}
+
+/**
+ * adreno_perfring_end() - Sample the counters as a command batch finishes
+ * @adreno_dev: Pointer to an adreno device
+ * @cmdbatch: Command batch that is being submitted
+ * @cmds: Ringbuffer commands to write the packets to
+ *
+ * Returns the number of dwords written to @cmds.
+ */
+unsigned int adreno_perfring_end(struct adreno_device *adreno_dev,
+		struct kgsl_cmdbatch *cmdbatch, unsigned int *cmds)
+{
+	unsigned int *start = cmds;
+
+	cmds = _read_counters(adreno_dev, cmds, cmdbatch->perfring_seq,
+		offsetof(struct kgsl_perfring_entry, end),
+		offsetof(struct kgsl_perfring_entry, ticks_end));
+
+	return cmds - start;
+}
+
+/**
+ * adreno_perfring_retire() - Publish the entry of a retired command batch
+ * @adreno_dev: Pointer to an adreno device
+ * @cmdbatch: Command batch that retired
+ */
+void adreno_perfring_retire(struct adreno_device *adreno_dev,
+		struct kgsl_cmdbatch *cmdbatch)
+{
+	struct adreno_perfring *ring = &adreno_dev->perfring;
+	struct kgsl_perfring_header *header;
+	unsigned int seq = cmdbatch->perfring_seq;
+
+	if (!test_and_clear_bit(CMDBATCH_FLAG_PERFRING, &cmdbatch->priv))
+		return;
+
+	header = _header(ring);
+
+	/* The GPU wrote the counters before the retire timestamp */
+	rmb();
+	_entry(ring, seq)->seq = seq;
+	wmb();
+
+	if ((int)(seq - header->head) > 0)
+		header->head = seq;
+}
+
+static void _put_counters(struct adreno_device *adreno_dev)
+{
+	struct adreno_perfring *ring = &adreno_dev->perfring;
+	int i;
+
+	for (i = 0; i < ring->count; i++)
+		adreno_perfcounter_put(adreno_dev, ring->groupid[i],
+			ring->countable[i], PERFCOUNTER_FLAG_KERNEL);
+}
+
+static int _get_counters(struct adreno_device *adreno_dev)
+{
+	struct adreno_perfring *ring = &adreno_dev->perfring;
+	unsigned int count = ring->count;
+	int i, ret = 0;
+
+	for (i = 0; i < count; i++) {
+		ret = adreno_perfcounter_get(adreno_dev, ring->groupid[i],
+			ring->countable[i], &ring->offset[i],
+			&ring->offset_hi[i], PERFCOUNTER_FLAG_KERNEL);
+		if (ret)
+			break;
+	}
+
+	if (ret) {
+		ring->count = i;
+		_put_counters(adreno_dev);
+		ring->count = count;
+	}
+
+	return ret;
+}
+
+static int _perfring_enable(struct adreno_device *adreno_dev)
+{
+	struct kgsl_device *device = &adreno_dev->dev;
+	struct adreno_perfring *ring = &adreno_dev->perfring;
+	struct kgsl_perfring_header *header = _header(ring);
+	int i, ret;
+
+	ret = kgsl_active_count_get(device);
+	if (ret)
+		return ret;
+
+	ret = _get_counters(adreno_dev);
+	if (ret == 0) {
+		kgsl_sharedmem_set(device, &ring->memdesc, 0, 0,
+			ring->memdesc.size);
+
+		header->version = KGSL_PERFRING_VERSION;
+		header->num_entries = ADRENO_PERFRING_ENTRIES;
+		header->num_counters = ring->count;
+		for (i = 0; i < ring->count; i++)
+			header->countables[i] = (ring->groupid[i] << 16) |
+				ring->countable[i];
+		header->head = ring->seq;
+		wmb();
+
+		ring->enabled = true;
+	}
+
+	kgsl_active_count_put(device);
+	return ret;
+}
+
+static ssize_t _perfring_enable_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count)
+{
+	struct kgsl_device *device = kgsl_device_from_dev(dev);
+	struct adreno_device *adreno_dev;
+	unsigned int val = 0;
+	int ret;
+
+	if (device == NULL)
+		return -ENODEV;
+
+	adreno_dev = ADRENO_DEVICE(device);
+	if (adreno_dev->perfring.memdesc.hostptr == NULL)
+		return -ENODEV;
+
+	ret = kgsl_sysfs_store(buf, &val);
+	if (ret)
+		return ret;
+
+	mutex_lock(&device->mutex);
+	if (val && !adreno_dev->perfring.enabled) {
+		ret = _perfring_enable(adreno_dev);
+	} else if (!val && adreno_dev->perfring.enabled) {
+		adreno_dev->perfring.enabled = false;
+		_put_counters(adreno_dev);
+	}
+	mutex_unlock(&device->mutex);
+
+	return ret ? ret : count;
+}
+
+static ssize_t _perfring_enable_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct kgsl_device *device = kgsl_device_from_dev(dev);
+
+	if (device == NULL)
+		return 0;
+
+	return snprintf(buf, PAGE_SIZE, "%d\n",
+		ADRENO_DEVICE(device)->perfring.enabled);
+}
+
+/* Counters are set as "group:countable" pairs, only while disabled */
+static ssize_t _perfring_counters_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count)
+{
+	struct kgsl_device *device = kgsl_device_from_dev(dev);
+	struct adreno_perfring *ring;
+	unsigned int groupid[KGSL_PERFRING_MAX_COUNTERS];
+	unsigned int countable[KGSL_PERFRING_MAX_COUNTERS];
+	const char *p = buf;
+	int n = 0, len, ret = 0;
+
+	if (device == NULL)
+		return -ENODEV;
+
+	while (n < KGSL_PERFRING_MAX_COUNTERS &&
+		sscanf(p, "%u:%u%n", &groupid[n], &countable[n], &len) == 2) {
+		p += len;
+		n++;
+	}
+
+	ring = &ADRENO_DEVICE(device)->perfring;
+
+	mutex_lock(&device->mutex);
+	if (ring->enabled) {
+		ret = -EBUSY;
+	} else {
+		memcpy(ring->groupid, groupid, n * sizeof(groupid[0]));
+		memcpy(ring->countable, countable, n * sizeof(countable[0]));
+		ring->count = n;
+	}
+	mutex_unlock(&device->mutex);
+
+	return ret ? ret : count;
+}
+
+static ssize_t _perfring_counters_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct kgsl_device *device = kgsl_device_from_dev(dev);
+	struct adreno_perfring *ring;
+	ssize_t len = 0;
+	int i;
+
+	if (device == NULL)
+		return 0;
+
+	ring = &ADRENO_DEVICE(device)->perfring;
+
+	mutex_lock(&device->mutex);
+	for (i = 0; i < ring->count; i++)
+		len += snprintf(buf + len, PAGE_SIZE - len, "%u:%u ",
+			ring->groupid[i], ring->countable[i]);
+	mutex_unlock(&device->mutex);
+
+	len += snprintf(buf + len, PAGE_SIZE - len, "\n");
+	return len;
+}
+
+static DEVICE_ATTR(perfring_enable, 0644, _perfring_enable_show,
+	_perfring_enable_store);
+static DEVICE_ATTR(perfring_counters, 0644, _perfring_counters_show,
+	_perfring_counters_store);
+
+static const struct device_attribute *_perfring_attr_list[] = {
+	&dev_attr_perfring_enable,
+	&dev_attr_perfring_counters,
+	NULL,
+};
+
+static int _perfring_mmap(struct file *filep, struct kobject *kobj,
+		struct bin_attribute *attr, struct vm_area_struct *vma)
+{
+	struct kgsl_device *device =
+		kgsl_device_from_dev(container_of(kobj, struct device, kobj));
+	struct kgsl_memdesc *memdesc;
+	unsigned long size = vma->vm_end - vma->vm_start;
+
+	if (device == NULL)
+		return -ENODEV;
+
+	memdesc = &ADRENO_DEVICE(device)->perfring.memdesc;
+	if (memdesc->hostptr == NULL)
+		return -ENODEV;
+
+	if (vma->vm_pgoff || size > PAGE_ALIGN(memdesc->size))
+		return -EINVAL;
+
+	/* Only the GPU and the driver write to the ring */
+	if (vma->vm_flags & VM_WRITE)
+		return -EPERM;
+	vma->vm_flags &= ~VM_MAYWRITE;
+
+	vma->vm_page_prot = pgprot_writecombine(vma->vm_page_prot);
+
+	return remap_pfn_range(vma, vma->vm_start,
+		memdesc->physaddr >> PAGE_SHIFT, size, vma->vm_page_prot);
+}
+
+static struct bin_attribute perfring_attr = {
+	.attr.name = "perfring",
+	.attr.mode = 0444,
+	.size = ADRENO_PERFRING_SIZE,
+	.mmap = _perfring_mmap,
+};
+
+int adreno_perfring_init_sysfs(struct kgsl_device *device)
+{
+	int ret;
+
+	ret = kgsl_create_device_sysfs_files(device->dev, _perfring_attr_list);
+	if (ret)
+		return ret;
+
+	return sysfs_create_bin_file(&device->dev->kobj, &perfring_attr);
+}
+
+void adreno_perfring_uninit_sysfs(struct kgsl_device *device)
+{
+	sysfs_remove_bin_file(&device->dev->kobj, &perfring_attr);
+	kgsl_remove_device_sysfs_files(device->dev, _perfring_attr_list);
+}
+
+/**
+ * adreno_perfring_init() - Allocate the ring
+ * @adreno_dev: Pointer to an adreno device
+ *
+ * The ring is a global allocation so that every pagetable can write to it,
+ * which means it has to exist before the first pagetable is created. It is
+ * only used on targets with the always on counter.
+ */
+void adreno_perfring_init(struct adreno_device *adreno_dev)
+{
+	struct adreno_perfring *ring = &adreno_dev->perfring;
+
+	if (ring->memdesc.hostptr)
+		return;
+
+	if (kgsl_allocate_global(&adreno_dev->dev, &ring->memdesc,
+			PAGE_ALIGN(ADRENO_PERFRING_SIZE), 0, 0))
+		return;
+
+	/* Default to ALU busy and memory traffic */
+	ring->groupid[0] = KGSL_PERFCOUNTER_GROUP_SP;
+	ring->countable[0] = SP_ALU_ACTIVE_CYCLES;
+	ring->groupid[1] = KGSL_PERFCOUNTER_GROUP_VBIF;
+	ring->countable[1] = VBIF_AXI_TOTAL_BEATS;
+	ring->count = 2;
+}
+
+void adreno_perfring_close(struct adreno_device *adreno_dev)
+{
+	struct adreno_perfring *ring = &adreno_dev->perfring;
+
+	if (ring->memdesc.hostptr)
+		kgsl_free_global(&ring->memdesc);
+}
@@ -0,0 +1,66 @@
+/* Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+#ifndef __ADRENO_PERFRING_H
+#define __ADRENO_PERFRING_H
+
+#include <linux/msm_kgsl.h>
+
+#define ADRENO_PERFRING_ENTRIES 256
+
+#define ADRENO_PERFRING_SIZE (sizeof(struct kgsl_perfring_header) + \
+	ADRENO_PERFRING_ENTRIES * sizeof(struct kgsl_perfring_entry))
+
+/**
+ * struct adreno_perfring - Always on perfcounter sampling per command batch
+ * @memdesc: Ring shared with the GPU and mapped read only to userspace
+ * @enabled: True if the command batches are sampled
+ * @seq: Sequence number given to the last sampled command batch
+ * @count: Number of counters in use
+ * @groupid: Perfcounter group of every counter
+ * @countable: Countable of every counter
+ * @offset: Register offset of the low half of every counter
+ * @offset_hi: Register offset of the high half of every counter
+ */
+struct adreno_perfring {
+	struct kgsl_memdesc memdesc;
+	bool enabled;
+	unsigned int seq;
+	unsigned int count;
+	unsigned int groupid[KGSL_PERFRING_MAX_COUNTERS];
+	unsigned int countable[KGSL_PERFRING_MAX_COUNTERS];
+	unsigned int offset[KGSL_PERFRING_MAX_COUNTERS];
+	unsigned int offset_hi[KGSL_PERFRING_MAX_COUNTERS];
+};
+
+struct adreno_device;
+struct kgsl_cmdbatch;
+
+void adreno_perfring_init(struct adreno_device *adreno_dev);
+void adreno_perfring_close(struct adreno_device *adreno_dev);
+int adreno_perfring_init_sysfs(struct kgsl_device *device);
+void adreno_perfring_uninit_sysfs(struct kgsl_device *device);
+
+unsigned int adreno_perfring_dwords(struct adreno_device *adreno_dev);
+unsigned int adreno_perfring_start(struct adreno_device *adreno_dev,
+		struct kgsl_cmdbatch *cmdbatch, unsigned int *cmds);
+unsigned int adreno_perfring_end(struct adreno_device *adreno_dev,
+		struct kgsl_cmdbatch *cmdbatch, unsigned int *cmds);
+void adreno_perfring_retire(struct adreno_device *adreno_dev,
+		struct kgsl_cmdbatch *cmdbatch);
+
+static inline bool adreno_perfring_enabled(struct adreno_perfring *ring)
+{
+	return ring->enabled;
+}
+
+#endif /* __ADRENO_PERFRING_H */
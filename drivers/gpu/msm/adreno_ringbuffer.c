@@ -1358,6 +1358,7 @@ int adreno_ringbuffer_submitcmd(struct adreno_device *adreno_dev,
 	bool use_preamble = true;
 	bool cmdbatch_user_profiling = false;
 	bool cmdbatch_kernel_profiling = false;
+	bool perfring = adreno_perfring_enabled(&adreno_dev->perfring);
 	int flags = KGSL_CMD_FLAGS_NONE;
 	int ret;
 	struct adreno_ringbuffer *rb;
@@ -1452,6 +1453,9 @@ int adreno_ringbuffer_submitcmd(struct adreno_device *adreno_dev,
 		dwords += 6;
 	}
 
+	if (perfring)
+		dwords += adreno_perfring_dwords(adreno_dev);
+
 	link = kzalloc(sizeof(unsigned int) *  dwords, GFP_KERNEL);
 	if (!link) {
 		ret = -ENOMEM;
@@ -1481,6 +1485,9 @@ int adreno_ringbuffer_submitcmd(struct adreno_device *adreno_dev,
 			gpu_ticks_submitted));
 	}
 
+	if (perfring)
+		cmds += adreno_perfring_start(adreno_dev, cmdbatch, cmds);
+
 	if (numibs) {
 		list_for_each_entry(ib, &cmdbatch->cmdlist, node) {
 			/* use the preamble? */
@@ -1520,6 +1527,9 @@ int adreno_ringbuffer_submitcmd(struct adreno_device *adreno_dev,
 			gpu_ticks_retired));
 	}
 
+	if (perfring)
+		cmds += adreno_perfring_end(adreno_dev, cmdbatch, cmds);
+
 	*cmds++ = cp_nop_packet(1);
 	*cmds++ = KGSL_END_OF_IB_IDENTIFIER;
 
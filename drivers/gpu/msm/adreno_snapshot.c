@@ -177,12 +177,12 @@ static inline void parse_ib(struct kgsl_device *device,
 {
 	struct adreno_device *adreno_dev = ADRENO_DEVICE(device);
 	unsigned int ib1base;
-	struct adreno_ib_object_list *ib_obj_list;
 
 	/*
 	 * Check the IB address - if it is either the last executed IB1
 	 * then push it into the static blob otherwise put it in the dynamic
-	 * list
+	 * list. The dynamic IBs are parsed by the snapshot worker so they
+	 * don't hold up the recovery.
 	 */
 
 	adreno_readreg(adreno_dev, ADRENO_REG_CP_IB1_BASE, &ib1base);
@@ -197,13 +197,7 @@ static inline void parse_ib(struct kgsl_device *device,
 					gpuaddr, dwords << 2))
 		return;
 
-	if (-E2BIG == adreno_ib_create_object_list(device, process,
-				gpuaddr, dwords, &ib_obj_list))
-		ib_max_objs = 1;
-
-	if (ib_obj_list)
-		kgsl_snapshot_add_ib_obj_list(snapshot, ib_obj_list);
-
+	kgsl_snapshot_defer_ib(snapshot, process, gpuaddr, dwords);
 }
 
 /* Snapshot the ringbuffer memory */
@@ -37,6 +37,7 @@
 #include "kgsl_cffdump.h"
 #include "kgsl_log.h"
 #include "kgsl_sharedmem.h"
+#include "kgsl_pool.h"
 #include "kgsl_device.h"
 #include "kgsl_trace.h"
 #include "kgsl_sync.h"
@@ -80,6 +81,13 @@ struct kgsl_dma_buf_meta {
 	struct dma_buf_attachment *attach;
 	struct dma_buf *dmabuf;
 	struct sg_table *table;
+	/* import cache, see kgsl_setup_dma_buf() */
+	struct list_head node;
+	unsigned int users;
+	struct device *dev;
+	unsigned int secure;
+	size_t size;
+	unsigned int sglen;
 };
 
 static void kgsl_mem_entry_detach_process(struct kgsl_mem_entry *entry);
@@ -219,20 +227,144 @@ kgsl_mem_entry_create(void)
 	return entry;
 }
 #ifdef CONFIG_DMA_SHARED_BUFFER
+/*
+ * Compositors import the same dma-buf (a BufferQueue slot) again for
+ * every frame. The attachment and the sg table of an import are kept
+ * after the last mem entry using them is freed, so the next import of
+ * the buffer doesn't have to map it again. An idle mapping is dropped
+ * once the cache holds the last reference to its dma-buf, or when it is
+ * the oldest of more than KGSL_DMA_BUF_CACHE_MAX idle mappings.
+ */
+#define KGSL_DMA_BUF_CACHE_MAX	64
+#define KGSL_DMA_BUF_CACHE_SCAN	msecs_to_jiffies(1000)
+
+/* most recently used first */
+static LIST_HEAD(kgsl_dma_buf_cache);
+static DEFINE_MUTEX(kgsl_dma_buf_cache_lock);
+static unsigned int kgsl_dma_buf_cache_idle;
+
+static void kgsl_dma_buf_cache_scan(struct work_struct *work);
+static DECLARE_DELAYED_WORK(kgsl_dma_buf_cache_work, kgsl_dma_buf_cache_scan);
+
+static void kgsl_dma_buf_unmap(struct kgsl_dma_buf_meta *meta)
+{
+	dma_buf_unmap_attachment(meta->attach, meta->table, DMA_FROM_DEVICE);
+	dma_buf_detach(meta->dmabuf, meta->attach);
+	dma_buf_put(meta->dmabuf);
+	kfree(meta);
+}
+
+/* Move idle mappings that have to go to @freelist, cache lock held */
+static void _dma_buf_cache_prune(struct list_head *freelist, bool all)
+{
+	struct kgsl_dma_buf_meta *meta, *tmp;
+
+	list_for_each_entry_safe_reverse(meta, tmp, &kgsl_dma_buf_cache,
+		node) {
+		if (meta->users)
+			continue;
+
+		if (!all && kgsl_dma_buf_cache_idle <= KGSL_DMA_BUF_CACHE_MAX &&
+			file_count(meta->dmabuf->file) > 1)
+			continue;
+
+		list_move(&meta->node, freelist);
+		kgsl_dma_buf_cache_idle--;
+	}
+}
+
+static void kgsl_dma_buf_cache_free(struct list_head *freelist)
+{
+	struct kgsl_dma_buf_meta *meta, *tmp;
+
+	list_for_each_entry_safe(meta, tmp, freelist, node) {
+		list_del(&meta->node);
+		kgsl_dma_buf_unmap(meta);
+	}
+}
+
+/* Look for a mapping of @dmabuf and take it, cache lock held */
+static struct kgsl_dma_buf_meta *_dma_buf_cache_get(struct dma_buf *dmabuf,
+		struct device *dev, unsigned int secure)
+{
+	struct kgsl_dma_buf_meta *meta;
+
+	list_for_each_entry(meta, &kgsl_dma_buf_cache, node) {
+		if (meta->dmabuf != dmabuf || meta->dev != dev ||
+			meta->secure != secure)
+			continue;
+
+		if (meta->users++ == 0)
+			kgsl_dma_buf_cache_idle--;
+		list_move(&meta->node, &kgsl_dma_buf_cache);
+		return meta;
+	}
+
+	return NULL;
+}
+
+/*
+ * There is no callback when userspace lets go of a dma-buf, so the idle
+ * mappings are checked every KGSL_DMA_BUF_CACHE_SCAN while there are any
+ */
+static void kgsl_dma_buf_cache_scan(struct work_struct *work)
+{
+	LIST_HEAD(freelist);
+	bool idle;
+
+	mutex_lock(&kgsl_dma_buf_cache_lock);
+	_dma_buf_cache_prune(&freelist, false);
+	idle = kgsl_dma_buf_cache_idle != 0;
+	mutex_unlock(&kgsl_dma_buf_cache_lock);
+
+	kgsl_dma_buf_cache_free(&freelist);
+
+	if (idle)
+		schedule_delayed_work(&kgsl_dma_buf_cache_work,
+			KGSL_DMA_BUF_CACHE_SCAN);
+}
+
 static void kgsl_destroy_ion(struct kgsl_dma_buf_meta *meta)
 {
-	if (meta != NULL) {
-		dma_buf_unmap_attachment(meta->attach, meta->table,
-			DMA_FROM_DEVICE);
-		dma_buf_detach(meta->dmabuf, meta->attach);
-		dma_buf_put(meta->dmabuf);
-		kfree(meta);
+	LIST_HEAD(freelist);
+
+	if (meta == NULL)
+		return;
+
+	mutex_lock(&kgsl_dma_buf_cache_lock);
+	if (--meta->users == 0) {
+		kgsl_dma_buf_cache_idle++;
+		_dma_buf_cache_prune(&freelist, false);
 	}
+	mutex_unlock(&kgsl_dma_buf_cache_lock);
+
+	kgsl_dma_buf_cache_free(&freelist);
+
+	schedule_delayed_work(&kgsl_dma_buf_cache_work,
+		KGSL_DMA_BUF_CACHE_SCAN);
+}
+
+static void kgsl_dma_buf_cache_exit(void)
+{
+	LIST_HEAD(freelist);
+
+	cancel_delayed_work_sync(&kgsl_dma_buf_cache_work);
+
+	mutex_lock(&kgsl_dma_buf_cache_lock);
+	_dma_buf_cache_prune(&freelist, true);
+	mutex_unlock(&kgsl_dma_buf_cache_lock);
+
+	kgsl_dma_buf_cache_free(&freelist);
 }
 #else
 static void kgsl_destroy_ion(struct kgsl_dma_buf_meta *meta)
 {
 
+}
+
+static void kgsl_dma_buf_cache_exit(void)
+{
+
 }
 #endif
 
@@ -3028,6 +3160,16 @@ static int kgsl_setup_ashmem(struct kgsl_mem_entry *entry,
 #endif
 
 #ifdef CONFIG_DMA_SHARED_BUFFER
+/*
+ * The mapping of a dma-buf is shared by all the mem entries that import
+ * it, and it owns the dma-buf reference of the first import. On success
+ * the reference passed in by the caller is either kept by a new mapping
+ * or dropped because a cached mapping already holds one.
+ *
+ * Only the attachment and the sg table are cached: the GPU address of
+ * an import belongs to its mem entry and is mapped in the pagetable when
+ * the entry is attached.
+ */
 static int kgsl_setup_dma_buf(struct kgsl_mem_entry *entry,
 				struct kgsl_pagetable *pagetable,
 				struct kgsl_device *device,
@@ -3035,9 +3177,21 @@ static int kgsl_setup_dma_buf(struct kgsl_mem_entry *entry,
 {
 	int ret = 0;
 	struct scatterlist *s;
-	struct sg_table *sg_table;
+	struct sg_table *sg_table = NULL;
 	struct dma_buf_attachment *attach = NULL;
 	struct kgsl_dma_buf_meta *meta;
+	unsigned int priv = (entry->memdesc.priv & KGSL_MEMDESC_SECURE) ? 1 : 0;
+
+	mutex_lock(&kgsl_dma_buf_cache_lock);
+	meta = _dma_buf_cache_get(dmabuf, device->dev, priv);
+	if (meta)
+		kgsl_driver.stats.dmabuf_cache_hits++;
+	mutex_unlock(&kgsl_dma_buf_cache_lock);
+
+	if (meta) {
+		dma_buf_put(dmabuf);
+		goto done;
+	}
 
 	meta = kzalloc(sizeof(*meta), GFP_KERNEL);
 	if (!meta)
@@ -3049,34 +3203,16 @@ static int kgsl_setup_dma_buf(struct kgsl_mem_entry *entry,
 		goto out;
 	}
 
-	meta->dmabuf = dmabuf;
-	meta->attach = attach;
-
-	entry->priv_data = meta;
-	entry->memdesc.pagetable = pagetable;
-	entry->memdesc.size = 0;
-	/* USE_CPU_MAP is not impemented for ION. */
-	entry->memdesc.flags &= ~KGSL_MEMFLAGS_USE_CPU_MAP;
-	entry->memdesc.flags |= KGSL_MEMFLAGS_USERMEM_ION;
-
 	sg_table = dma_buf_map_attachment(attach, DMA_TO_DEVICE);
 
 	if (IS_ERR_OR_NULL(sg_table)) {
-		ret = PTR_ERR(sg_table);
+		ret = sg_table ? PTR_ERR(sg_table) : -EINVAL;
 		goto out;
 	}
 
-	meta->table = sg_table;
-	entry->priv_data = meta;
-	entry->memdesc.sg = sg_table->sgl;
-
 	/* Calculate the size of the memdesc from the sglist */
 
-	entry->memdesc.sglen = 0;
-
-	for (s = entry->memdesc.sg; s != NULL; s = sg_next(s)) {
-		int priv = (entry->memdesc.priv & KGSL_MEMDESC_SECURE) ? 1 : 0;
-
+	for (s = sg_table->sgl; s != NULL; s = sg_next(s)) {
 		/*
 		 * Check that each chunk of of the sg table matches the secure
 		 * flag.
@@ -3087,20 +3223,42 @@ static int kgsl_setup_dma_buf(struct kgsl_mem_entry *entry,
 			goto out;
 		}
 
-		entry->memdesc.size += s->length;
-		entry->memdesc.sglen++;
+		meta->size += s->length;
+		meta->sglen++;
 	}
 
-	entry->memdesc.size = PAGE_ALIGN(entry->memdesc.size);
+	meta->dmabuf = dmabuf;
+	meta->attach = attach;
+	meta->table = sg_table;
+	meta->dev = device->dev;
+	meta->secure = priv;
+	meta->size = PAGE_ALIGN(meta->size);
+	meta->users = 1;
 
-out:
-	if (ret) {
-		if (!IS_ERR_OR_NULL(attach))
-			dma_buf_detach(dmabuf, attach);
+	mutex_lock(&kgsl_dma_buf_cache_lock);
+	list_add(&meta->node, &kgsl_dma_buf_cache);
+	kgsl_driver.stats.dmabuf_cache_misses++;
+	mutex_unlock(&kgsl_dma_buf_cache_lock);
 
+done:
+	entry->priv_data = meta;
+	entry->memdesc.pagetable = pagetable;
+	/* USE_CPU_MAP is not impemented for ION. */
+	entry->memdesc.flags &= ~KGSL_MEMFLAGS_USE_CPU_MAP;
+	entry->memdesc.flags |= KGSL_MEMFLAGS_USERMEM_ION;
+	entry->memdesc.sg = meta->table->sgl;
+	entry->memdesc.sglen = meta->sglen;
+	entry->memdesc.size = meta->size;
 
-		kfree(meta);
-	}
+	return 0;
+
+out:
+	if (!IS_ERR_OR_NULL(sg_table))
+		dma_buf_unmap_attachment(attach, sg_table, DMA_TO_DEVICE);
+	if (!IS_ERR_OR_NULL(attach))
+		dma_buf_detach(dmabuf, attach);
+
+	kfree(meta);
 
 	return ret;
 }
@@ -4807,7 +4965,8 @@ int kgsl_device_platform_probe(struct kgsl_device *device)
 	}
 
 
-	device->events_wq = create_workqueue("kgsl-events");
+	device->events_wq = alloc_workqueue("kgsl-events",
+				WQ_MEM_RECLAIM | WQ_POWER_EFFICIENT, 1);
 
 	/* Initalize the snapshot engine */
 	kgsl_device_snapshot_init(device);
@@ -4892,6 +5051,8 @@ static void kgsl_core_exit(void)
 		kmem_cache_destroy(memobjs_cache);
 
 	kgsl_memfree_exit();
+	kgsl_dma_buf_cache_exit();
+	kgsl_pool_exit();
 	unregister_chrdev_region(kgsl_driver.major, KGSL_DEVICE_MAX);
 }
 
@@ -4984,6 +5145,7 @@ static int __init kgsl_core_init(void)
 	}
 
 	kgsl_memfree_init();
+	kgsl_pool_init();
 
 	kgsl_driver_htc_init(&kgsl_driver.priv);
 
@@ -26,6 +26,7 @@
 #include <linux/mm.h>
 #include <linux/dma-attrs.h>
 #include <linux/kthread.h>
+#include <linux/llist.h>
 
 #include "kgsl_htc.h"
 
@@ -96,6 +97,8 @@ struct kgsl_driver {
 		unsigned int secure_max;
 		unsigned int mapped;
 		unsigned int mapped_max;
+		unsigned int dmabuf_cache_hits;
+		unsigned int dmabuf_cache_misses;
 	} stats;
 	unsigned int full_cache_threshold;
 	struct kgsl_driver_htc_priv priv;
@@ -232,7 +235,7 @@ typedef void (*kgsl_event_func)(struct kgsl_device *, struct kgsl_event_group *,
  * @priv: Private data passed to the callback function
  * @node: List node for the kgsl_event_group list
  * @created: Jiffies when the event was created
- * @work: Work struct for dispatching the callback
+ * @llnode: Node for the list of events waiting for their callback
  * @result: KGSL event result type to pass to the callback
  * group: The event group this event belongs to
  */
@@ -244,7 +247,7 @@ struct kgsl_event {
 	void *priv;
 	struct list_head node;
 	unsigned int created;
-	struct kthread_work work;
+	struct llist_node llnode;
 	int result;
 	struct kgsl_event_group *group;
 };
@@ -256,7 +259,7 @@ typedef int (*readtimestamp_func)(struct kgsl_device *, void *,
  * struct event_group - A list of GPU events
  * @context: Pointer to the active context for the events
  * @lock: Spinlock for protecting the list
- * @events: List of active GPU events
+ * @events: List of active GPU events, sorted by timestamp
  * @group: Node for the master group list
  * @processed: Last processed timestamp
  * @name: String name for the group (for the debugfs file)
@@ -256,6 +256,12 @@ void kgsl_core_debugfs_init(void)
 {
 	kgsl_debugfs_dir = debugfs_create_dir("kgsl", 0);
 	proc_d_debugfs = debugfs_create_dir("proc", kgsl_debugfs_dir);
+
+	/* dma-buf imports that reused a cached mapping or had to map */
+	debugfs_create_u32("dmabuf_cache_hits", 0444, kgsl_debugfs_dir,
+		&kgsl_driver.stats.dmabuf_cache_hits);
+	debugfs_create_u32("dmabuf_cache_misses", 0444, kgsl_debugfs_dir,
+		&kgsl_driver.stats.dmabuf_cache_misses);
 }
 
 void kgsl_core_debugfs_close(void)
@@ -245,6 +245,9 @@ struct kgsl_memobj_node {
  * userspace.
  * @timeout_jiffies: For a syncpoint cmdbatch the jiffies at which the
  * timer will expire
+ * @queued_time: When the cmdbatch was queued to the dispatcher
+ * @submit_time: local_clock() when the cmdbatch went to the ringbuffer
+ * @perfring_seq: Sequence number of the perfring entry of the cmdbatch
  */
 struct kgsl_cmdbatch {
 	struct kgsl_device *device;
@@ -268,6 +271,9 @@ struct kgsl_cmdbatch {
 	uint64_t submit_ticks;
 	unsigned int global_ts;
 	unsigned long timeout_jiffies;
+	ktime_t queued_time;
+	uint64_t submit_time;
+	unsigned int perfring_seq;
 };
 
 /**
@@ -301,6 +307,7 @@ struct kgsl_cmdbatch_sync_event {
  * in the profiling buffer
  * @CMDBATCH_FLAG_FENCE_LOG - Set if the cmdbatch is dumping fence logs via the
  * cmdbatch timer - this is used to avoid recursion
+ * @CMDBATCH_FLAG_PERFRING - The counters are sampled into the perfring
  */
 
 enum kgsl_cmdbatch_priv {
@@ -309,6 +316,7 @@ enum kgsl_cmdbatch_priv {
 	CMDBATCH_FLAG_WFI,
 	CMDBATCH_FLAG_PROFILE,
 	CMDBATCH_FLAG_FENCE_LOG,
+	CMDBATCH_FLAG_PERFRING,
 };
 
 struct kgsl_device {
@@ -513,6 +521,7 @@ struct kgsl_process_private {
 	struct idr syncsource_idr;
 	spinlock_t syncsource_lock;
 	int fd_count;
+	atomic64_t gpu_time;
 };
 
 /**
@@ -539,10 +548,13 @@ struct kgsl_device_private {
  * @mempool_size: Size of the memory pool
  * @obj_list: List of frozen GPU buffers that are waiting to be dumped.
  * @cp_list: List of IB's to be dumped.
+ * @ib_list: List of IB's to be parsed by the worker, see
+ * kgsl_snapshot_defer_ib()
  * @work: worker to dump the frozen memory
  * @dump_gate: completion gate signaled by worker when it is finished.
  * @process: the process that caused the hang, if known.
  * @sysfs_read: An atomic for concurrent snapshot reads via syfs.
+ * @device: the device that was snapshotted
  */
 struct kgsl_snapshot {
 	u8 *start;
@@ -554,10 +566,12 @@ struct kgsl_snapshot {
 	size_t mempool_size;
 	struct list_head obj_list;
 	struct list_head cp_list;
+	struct list_head ib_list;
 	struct work_struct work;
 	struct completion dump_gate;
 	struct kgsl_process_private *process;
 	atomic_t sysfs_read;
+	struct kgsl_device *device;
 };
 
 /**
@@ -994,6 +1008,10 @@ struct adreno_ib_object_list;
 int kgsl_snapshot_add_ib_obj_list(struct kgsl_snapshot *snapshot,
 	struct adreno_ib_object_list *ib_obj_list);
 
+int kgsl_snapshot_defer_ib(struct kgsl_snapshot *snapshot,
+	struct kgsl_process_private *process, unsigned int gpuaddr,
+	unsigned int dwords);
+
 void kgsl_snapshot_dump_skipped_regs(struct kgsl_device *device,
 	struct kgsl_snapshot_registers_list *list);
 
@@ -27,33 +27,67 @@
 static struct kmem_cache *events_cache;
 static struct dentry *events_dentry;
 
+static void _kgsl_events_worker(struct kthread_work *work);
+
+/*
+ * Events that are retired or cancelled go on a lockless list that a
+ * single work item drains, so a burst of retired timestamps costs one
+ * wakeup of the worker instead of one per event.
+ */
+static LLIST_HEAD(events_retired);
+static DEFINE_KTHREAD_WORK(events_work, _kgsl_events_worker);
+
+static void queue_event(struct kgsl_event *event, int result)
+{
+	event->result = result;
+	if (llist_add(&event->llnode, &events_retired))
+		queue_kthread_work(&kgsl_driver.worker, &events_work);
+}
+
 static inline void signal_event(struct kgsl_device *device,
 		struct kgsl_event *event, int result)
 {
 	list_del(&event->node);
-	event->result = result;
-	queue_kthread_work(&kgsl_driver.worker, &event->work);
+	queue_event(event, result);
 }
 
 /**
- * _kgsl_event_worker() - Work handler for processing GPU event callbacks
- * @work: Pointer to the work_struct for the event
+ * _kgsl_events_worker() - Work handler for processing GPU event callbacks
+ * @work: Pointer to the kthread_work for the events
  *
- * Each event callback has its own work struct and is run on a event specific
- * workqeuue.  This is the worker that queues up the event callback function.
+ * Runs the callbacks of all the events queued since the last run, in the
+ * order they were signalled.
  */
-static void _kgsl_event_worker(struct kthread_work *work)
+static void _kgsl_events_worker(struct kthread_work *work)
 {
-	struct kgsl_event *event = container_of(work, struct kgsl_event, work);
-	int id = KGSL_CONTEXT_ID(event->context);
+	struct llist_node *node = llist_del_all(&events_retired);
+	struct llist_node *list = NULL;
+
+	/* llist_del_all() hands the newest event first */
+	while (node) {
+		struct llist_node *next = node->next;
+
+		node->next = list;
+		list = node;
+		node = next;
+	}
 
-	trace_kgsl_fire_event(id, event->timestamp, event->result,
-		jiffies - event->created, event->func);
+	while (list) {
+		struct kgsl_event *event = llist_entry(list, struct kgsl_event,
+			llnode);
+		int id = KGSL_CONTEXT_ID(event->context);
 
-	event->func(event->device, event->group, event->priv, event->result);
+		list = list->next;
 
-	kgsl_context_put(event->context);
-	kmem_cache_free(events_cache, event);
+		trace_kgsl_fire_event(id, event->timestamp, event->result,
+			jiffies - event->created, event->func);
+
+		event->func(event->device, event->group, event->priv,
+			event->result);
+
+		kgsl_context_put(event->context);
+		kmem_cache_free(events_cache, event);
+	}
 }
 
 static void _process_event_group(struct kgsl_device *device,
@@ -82,12 +116,14 @@ static void _process_event_group(struct kgsl_device *device,
 	if (!flush && timestamp_cmp(timestamp, group->processed) <= 0)
 		goto out;
 
+	/* The list is sorted so stop at the first pending event */
 	list_for_each_entry_safe(event, tmp, &group->events, node) {
 		if (timestamp_cmp(event->timestamp, timestamp) <= 0)
 			signal_event(device, event, KGSL_EVENT_RETIRED);
 		else if (flush)
 			signal_event(device, event, KGSL_EVENT_CANCELLED);
-
+		else
+			break;
 	}
 
 	group->processed = timestamp;
@@ -227,7 +263,7 @@ int kgsl_add_event(struct kgsl_device *device, struct kgsl_event_group *group,
 {
 	unsigned int queued;
 	struct kgsl_context *context = group->context;
-	struct kgsl_event *event;
+	struct kgsl_event *event, *pos;
 	unsigned int retired;
 
 	if (!func)
@@ -261,8 +297,6 @@ int kgsl_add_event(struct kgsl_device *device, struct kgsl_event_group *group,
 	event->created = jiffies;
 	event->group = group;
 
-	init_kthread_work(&event->work, _kgsl_event_worker);
-
 	trace_kgsl_register_event(KGSL_CONTEXT_ID(context), timestamp, func);
 
 	spin_lock(&group->lock);
@@ -275,14 +309,20 @@ int kgsl_add_event(struct kgsl_device *device, struct kgsl_event_group *group,
 		&retired);
 
 	if (timestamp_cmp(retired, timestamp) >= 0) {
-		event->result = KGSL_EVENT_RETIRED;
-		queue_kthread_work(&kgsl_driver.worker, &event->work);
+		queue_event(event, KGSL_EVENT_RETIRED);
 		spin_unlock(&group->lock);
 		return 0;
 	}
 
-	/* Add the event to the group list */
-	list_add_tail(&event->node, &group->events);
+	/*
+	 * Keep the group list in timestamp order. Events mostly come in
+	 * order so look for the spot from the tail.
+	 */
+	list_for_each_entry_reverse(pos, &group->events, node) {
+		if (timestamp_cmp(pos->timestamp, timestamp) <= 0)
+			break;
+	}
+	list_add(&event->node, &pos->node);
 
 	spin_unlock(&group->lock);
 
@@ -1699,27 +1699,30 @@ kgsl_iommu_unmap(struct kgsl_pagetable *pt,
 }
 
 /*
- * _create_sg_no_large_pages - Create a sg list from a given sg list w/o
- * greater that 64K pages
- * @memdesc - The memory descriptor containing the sg
+ * _create_sg_large_pages - Create a sg list from the pages of a memdesc
+ * @memdesc - The memory descriptor containing the pages
+ *
+ * Chunks that are physically contiguous are merged into one entry, so
+ * the IOMMU driver can map the range with the largest page size that the
+ * alignment of the entry allows (64K, 1M, or 2M with LPAE) instead of
+ * 4K PTEs.
  *
  * Returns the new sg list else error pointer on failure
  */
-struct scatterlist *_create_sg_no_large_pages(struct kgsl_memdesc *memdesc)
+static struct scatterlist *_create_sg_large_pages(struct kgsl_memdesc *memdesc)
 {
 	struct scatterlist *s_temp, *sg_temp;
-	int sglen, sglen_alloc = 0;
-	uint64_t offset, pg_size;
+	int sglen_alloc = 0;
+	phys_addr_t next = 0;
 	int i;
 
 	for (i = 0; i < memdesc->page_count;) {
 		struct page *p = memdesc->pages[i];
 		unsigned int length = (1 << compound_order(p)) << PAGE_SHIFT;
 
-		if (SZ_1M <= length)
-			sglen_alloc += length >> 16;
-		else
+		if (!sglen_alloc || page_to_phys(p) != next)
 			sglen_alloc++;
+		next = page_to_phys(p) + length;
 
 		i += length >> PAGE_SHIFT;
 	}
@@ -1729,31 +1732,24 @@ struct scatterlist *_create_sg_no_large_pages(struct kgsl_memdesc *memdesc)
 		return ERR_PTR(-ENOMEM);
 
 	sg_init_table(sg_temp, sglen_alloc);
-	s_temp = sg_temp;
+	s_temp = NULL;
 
 	for (i = 0; i < memdesc->page_count;) {
 		struct page *p = memdesc->pages[i];
 		unsigned int length = (1 << compound_order(p)) << PAGE_SHIFT;
 
-		if (SZ_1M <= length) {
-			for (offset = 0; offset < length; s_temp++) {
-				pg_size = (length - offset) >= SZ_64K ?
-						SZ_64K : SZ_4K;
-				sg_set_page(s_temp, p, pg_size, offset);
-				offset += pg_size;
-			}
+		if (s_temp && page_to_phys(p) == next) {
+			s_temp->length += length;
 		} else {
+			s_temp = s_temp ? s_temp + 1 : sg_temp;
 			sg_set_page(s_temp, p, length, 0);
-			s_temp++;
 		}
-		i += length >> PAGE_SHIFT;
+		next = page_to_phys(p) + length;
 
+		i += length >> PAGE_SHIFT;
 	}
-	sglen = (int)(s_temp - sg_temp);
-	sg_mark_end(&sg_temp[sglen - 1]);
 
 	return sg_temp;
-
 }
 
 /**
@@ -1852,7 +1848,7 @@ kgsl_iommu_map(struct kgsl_pagetable *pt,
 		mutex_unlock(&device->mutex);
 	} else {
 		if (memdesc->pages != NULL)
-			sg_temp = _create_sg_no_large_pages(memdesc);
+			sg_temp = _create_sg_large_pages(memdesc);
 
 		if (IS_ERR(sg_temp))
 			return PTR_ERR(sg_temp);
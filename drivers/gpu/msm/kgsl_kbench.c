@@ -0,0 +1,110 @@
+/* Copyright (C) 2016 HTC Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * kgsl page allocation benchmark. Every operation allocates size bytes
+ * through the same path as GPUMEM_ALLOC and frees them again, without a
+ * pagetable so no GPU mapping is made. mode picks what is timed: alloc,
+ * free, or both (alloc_free).
+ */
+
+#include <linux/kbench.h>
+#include <linux/module.h>
+#include <linux/string.h>
+
+#include "kgsl.h"
+#include "kgsl_sharedmem.h"
+
+enum {
+	KGSL_KBENCH_ALLOC,
+	KGSL_KBENCH_FREE,
+	KGSL_KBENCH_ALLOC_FREE,
+};
+
+struct kgsl_kbench {
+	struct kgsl_memdesc memdesc;
+	int mode;
+};
+
+static struct kgsl_kbench kgsl_kbench_state;
+
+static int kgsl_kbench_alloc(struct kbench_ctx *ctx)
+{
+	struct kgsl_kbench *kb = ctx->priv;
+
+	memset(&kb->memdesc, 0, sizeof(kb->memdesc));
+	return kgsl_sharedmem_page_alloc_user(&kb->memdesc, NULL, ctx->size);
+}
+
+static int kgsl_kbench_setup(struct kbench_ctx *ctx)
+{
+	struct kgsl_kbench *kb = &kgsl_kbench_state;
+
+	if (!ctx->mode[0] || !strcmp(ctx->mode, "alloc"))
+		kb->mode = KGSL_KBENCH_ALLOC;
+	else if (!strcmp(ctx->mode, "free"))
+		kb->mode = KGSL_KBENCH_FREE;
+	else if (!strcmp(ctx->mode, "alloc_free"))
+		kb->mode = KGSL_KBENCH_ALLOC_FREE;
+	else
+		return -EINVAL;
+
+	if (!ctx->size)
+		return -EINVAL;
+
+	memset(&kb->memdesc, 0, sizeof(kb->memdesc));
+	ctx->bytes = PAGE_ALIGN(ctx->size);
+	ctx->priv = kb;
+	return 0;
+}
+
+static int kgsl_kbench_prepare(struct kbench_ctx *ctx, unsigned int i)
+{
+	struct kgsl_kbench *kb = ctx->priv;
+
+	if (kb->mode == KGSL_KBENCH_FREE)
+		return kgsl_kbench_alloc(ctx);
+	return 0;
+}
+
+static int kgsl_kbench_op(struct kbench_ctx *ctx, unsigned int i)
+{
+	struct kgsl_kbench *kb = ctx->priv;
+	int ret = 0;
+
+	if (kb->mode != KGSL_KBENCH_FREE)
+		ret = kgsl_kbench_alloc(ctx);
+	if (!ret && kb->mode != KGSL_KBENCH_ALLOC)
+		kgsl_sharedmem_free(&kb->memdesc);
+	return ret;
+}
+
+static void kgsl_kbench_post(struct kbench_ctx *ctx, unsigned int i)
+{
+	struct kgsl_kbench *kb = ctx->priv;
+
+	/* A no-op on a memdesc that was already freed */
+	kgsl_sharedmem_free(&kb->memdesc);
+}
+
+static struct kbench kgsl_kbench = {
+	.name		= "kgsl",
+	.help		= "mode=alloc|free|alloc_free size=bytes",
+	.setup		= kgsl_kbench_setup,
+	.prepare	= kgsl_kbench_prepare,
+	.op		= kgsl_kbench_op,
+	.post		= kgsl_kbench_post,
+};
+
+static int __init kgsl_kbench_init(void)
+{
+	return kbench_register(&kgsl_kbench);
+}
+late_initcall(kgsl_kbench_init);
@@ -0,0 +1,337 @@
+/* Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include <linux/highmem.h>
+#include <linux/list.h>
+#include <linux/mm.h>
+#include <linux/shrinker.h>
+#include <linux/spinlock.h>
+#include <linux/workqueue.h>
+#include <asm/cacheflush.h>
+
+#include "kgsl_pool.h"
+
+/*
+ * Pages handed to the GPU have to be zeroed and flushed out of the CPU
+ * caches before userspace can see them. Doing that on the allocating
+ * thread is the slow part of a large allocation, so every IOMMU page size
+ * gets a pool of pages that are already zeroed.
+ *
+ * Freed pages are parked on the dirty list of their pool. Once the
+ * allocations and frees stop for KGSL_POOL_REFILL_DELAY the refill work
+ * zeroes the dirty pages and tops the clean list up to the reserve, so
+ * the next burst of allocations is served without touching the memory.
+ * Everything in the pools is given back to the system by the shrinker.
+ */
+
+#define KGSL_POOL_REFILL_DELAY	msecs_to_jiffies(100)
+
+struct kgsl_page_pool {
+	unsigned int order;
+	unsigned int reserve;	/* clean entries the refill work keeps */
+	unsigned int max;	/* entries the pool holds at most */
+	spinlock_t lock;
+	unsigned int clean_count;
+	struct list_head clean;
+	unsigned int dirty_count;
+	struct list_head dirty;
+};
+
+#define KGSL_POOL(_i, _order, _reserve, _max) {			\
+	.order = _order,						\
+	.reserve = _reserve,						\
+	.max = _max,							\
+	.lock = __SPIN_LOCK_UNLOCKED(kgsl_pools[_i].lock),		\
+	.clean = LIST_HEAD_INIT(kgsl_pools[_i].clean),			\
+	.dirty = LIST_HEAD_INIT(kgsl_pools[_i].dirty),			\
+}
+
+#define KGSL_POOL_MAX_ORDER	(ilog2(KGSL_POOL_MAX_PAGE_SIZE) - PAGE_SHIFT)
+
+/* 4K, 64K and 1M (2M with LPAE) entries, each pool holds at most 8M */
+static struct kgsl_page_pool kgsl_pools[] = {
+	KGSL_POOL(0, 0, 128, 2048),
+	KGSL_POOL(1, 4, 16, 128),
+	KGSL_POOL(2, KGSL_POOL_MAX_ORDER, 1, SZ_8M / KGSL_POOL_MAX_PAGE_SIZE),
+};
+
+#define KGSL_NUM_POOLS	ARRAY_SIZE(kgsl_pools)
+
+static void kgsl_pool_refill(struct work_struct *work);
+static DECLARE_DELAYED_WORK(kgsl_pool_refill_work, kgsl_pool_refill);
+
+static struct kgsl_page_pool *kgsl_pool_find(unsigned int order)
+{
+	int i;
+
+	for (i = 0; i < KGSL_NUM_POOLS; i++)
+		if (kgsl_pools[i].order == order)
+			return &kgsl_pools[i];
+
+	return NULL;
+}
+
+static void kgsl_pool_zero_page(struct page *page, unsigned int order)
+{
+	int i;
+
+	for (i = 0; i < (1 << order); i++) {
+		void *ptr = kmap_atomic(nth_page(page, i));
+
+		memset(ptr, 0, PAGE_SIZE);
+		dmac_flush_range(ptr, ptr + PAGE_SIZE);
+		kunmap_atomic(ptr);
+	}
+}
+
+static struct page *kgsl_pool_new_page(unsigned int order, gfp_t gfp_mask)
+{
+	gfp_mask |= __GFP_HIGHMEM;
+
+	/*
+	 * Don't do some of the more aggressive memory recovery
+	 * techniques for large order allocations
+	 */
+	if (order)
+		gfp_mask |= __GFP_COMP | __GFP_NORETRY |
+			__GFP_NO_KSWAPD | __GFP_NOWARN;
+
+	return alloc_pages(gfp_mask, order);
+}
+
+static void kgsl_pool_schedule_refill(void)
+{
+	mod_delayed_work(system_unbound_wq, &kgsl_pool_refill_work,
+		KGSL_POOL_REFILL_DELAY);
+}
+
+/* Move one entry from the dirty to the clean list, false if none left */
+static bool kgsl_pool_clean_one(struct kgsl_page_pool *pool)
+{
+	struct page *page;
+
+	spin_lock(&pool->lock);
+	page = list_first_entry_or_null(&pool->dirty, struct page, lru);
+	if (page) {
+		list_del(&page->lru);
+		pool->dirty_count--;
+	}
+	spin_unlock(&pool->lock);
+
+	if (page == NULL)
+		return false;
+
+	kgsl_pool_zero_page(page, pool->order);
+
+	spin_lock(&pool->lock);
+	list_add_tail(&page->lru, &pool->clean);
+	pool->clean_count++;
+	spin_unlock(&pool->lock);
+
+	return true;
+}
+
+static void kgsl_pool_refill(struct work_struct *work)
+{
+	int i;
+
+	for (i = 0; i < KGSL_NUM_POOLS; i++) {
+		struct kgsl_page_pool *pool = &kgsl_pools[i];
+
+		while (kgsl_pool_clean_one(pool))
+			cond_resched();
+
+		/* Top up without pushing anything else out of memory */
+		while (ACCESS_ONCE(pool->clean_count) < pool->reserve) {
+			struct page *page = kgsl_pool_new_page(pool->order,
+				GFP_KERNEL | __GFP_NORETRY | __GFP_NOWARN |
+				__GFP_NO_KSWAPD);
+
+			if (page == NULL)
+				break;
+
+			kgsl_pool_zero_page(page, pool->order);
+
+			spin_lock(&pool->lock);
+			list_add_tail(&page->lru, &pool->clean);
+			pool->clean_count++;
+			spin_unlock(&pool->lock);
+			cond_resched();
+		}
+	}
+}
+
+/**
+ * kgsl_pool_alloc_page() - Get a zeroed page for the GPU
+ * @page_size: Size of the page, a compound page if more than PAGE_SIZE
+ *
+ * Returns a page that is zeroed and flushed from the CPU caches. Pages
+ * from the pool are used first, a new page is only allocated (and zeroed
+ * here) when the pool has none.
+ */
+struct page *kgsl_pool_alloc_page(unsigned int page_size)
+{
+	unsigned int order = get_order(page_size);
+	struct kgsl_page_pool *pool = kgsl_pool_find(order);
+	struct page *page = NULL;
+	bool zeroed = false;
+
+	if (pool) {
+		spin_lock(&pool->lock);
+		if (pool->clean_count) {
+			page = list_first_entry(&pool->clean, struct page,
+				lru);
+			pool->clean_count--;
+			zeroed = true;
+		} else if (pool->dirty_count) {
+			page = list_first_entry(&pool->dirty, struct page,
+				lru);
+			pool->dirty_count--;
+		}
+		if (page)
+			list_del(&page->lru);
+		spin_unlock(&pool->lock);
+
+		kgsl_pool_schedule_refill();
+	}
+
+	if (page == NULL)
+		page = kgsl_pool_new_page(order, GFP_KERNEL);
+	if (page == NULL)
+		return NULL;
+
+	if (!zeroed)
+		kgsl_pool_zero_page(page, order);
+
+	return page;
+}
+
+/**
+ * kgsl_pool_free_page() - Give a GPU page back
+ * @page: Page from kgsl_pool_alloc_page()
+ *
+ * The page is kept to be zeroed in the background if its pool has room,
+ * otherwise it goes straight back to the system.
+ */
+void kgsl_pool_free_page(struct page *page)
+{
+	unsigned int order = compound_order(page);
+	struct kgsl_page_pool *pool = kgsl_pool_find(order);
+
+	if (pool) {
+		spin_lock(&pool->lock);
+		if (pool->clean_count + pool->dirty_count < pool->max) {
+			list_add_tail(&page->lru, &pool->dirty);
+			pool->dirty_count++;
+			page = NULL;
+		}
+		spin_unlock(&pool->lock);
+
+		if (page == NULL) {
+			kgsl_pool_schedule_refill();
+			return;
+		}
+	}
+
+	__free_pages(page, order);
+}
+
+/* Number of PAGE_SIZE pages held in all the pools */
+unsigned int kgsl_pool_size_total(void)
+{
+	unsigned int total = 0;
+	int i;
+
+	for (i = 0; i < KGSL_NUM_POOLS; i++) {
+		struct kgsl_page_pool *pool = &kgsl_pools[i];
+
+		total += (ACCESS_ONCE(pool->clean_count) +
+			ACCESS_ONCE(pool->dirty_count)) << pool->order;
+	}
+
+	return total;
+}
+
+/* Free up to @nr_pages pages of @pool, dirty entries first */
+static int kgsl_pool_trim(struct kgsl_page_pool *pool, int nr_pages)
+{
+	int freed = 0;
+
+	while (freed < nr_pages) {
+		struct page *page = NULL;
+
+		spin_lock(&pool->lock);
+		if (pool->dirty_count) {
+			page = list_first_entry(&pool->dirty, struct page,
+				lru);
+			pool->dirty_count--;
+		} else if (pool->clean_count) {
+			page = list_first_entry(&pool->clean, struct page,
+				lru);
+			pool->clean_count--;
+		}
+		if (page)
+			list_del(&page->lru);
+		spin_unlock(&pool->lock);
+
+		if (page == NULL)
+			break;
+
+		__free_pages(page, pool->order);
+		freed += 1 << pool->order;
+	}
+
+	return freed;
+}
+
+static int kgsl_pool_shrink(struct shrinker *shrinker,
+		struct shrink_control *sc)
+{
+	int nr = sc->nr_to_scan;
+	int i;
+
+	/* Small pages go first, the large ones are the hardest to get back */
+	for (i = 0; i < KGSL_NUM_POOLS && nr > 0; i++)
+		nr -= kgsl_pool_trim(&kgsl_pools[i], nr);
+
+	return kgsl_pool_size_total();
+}
+
+static struct shrinker kgsl_pool_shrinker = {
+	.shrink = kgsl_pool_shrink,
+	.seeks = DEFAULT_SEEKS,
+};
+
+static bool kgsl_pool_registered;
+
+void kgsl_pool_init(void)
+{
+	register_shrinker(&kgsl_pool_shrinker);
+	kgsl_pool_registered = true;
+	kgsl_pool_schedule_refill();
+}
+
+/* Also called on a failed driver init, before kgsl_pool_init() */
+void kgsl_pool_exit(void)
+{
+	int i;
+
+	if (kgsl_pool_registered) {
+		unregister_shrinker(&kgsl_pool_shrinker);
+		kgsl_pool_registered = false;
+	}
+	cancel_delayed_work_sync(&kgsl_pool_refill_work);
+
+	for (i = 0; i < KGSL_NUM_POOLS; i++)
+		kgsl_pool_trim(&kgsl_pools[i], INT_MAX);
+}
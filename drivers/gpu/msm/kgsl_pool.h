@@ -0,0 +1,33 @@
+/* Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+#ifndef __KGSL_POOL_H
+#define __KGSL_POOL_H
+
+#include <linux/mm_types.h>
+#include <linux/sizes.h>
+
+/* largest IOMMU page size that a single page of the pool backs */
+#ifdef CONFIG_IOMMU_LPAE
+#define KGSL_POOL_MAX_PAGE_SIZE	SZ_2M
+#else
+#define KGSL_POOL_MAX_PAGE_SIZE	SZ_1M
+#endif
+
+struct page *kgsl_pool_alloc_page(unsigned int page_size);
+void kgsl_pool_free_page(struct page *page);
+unsigned int kgsl_pool_size_total(void);
+
+void kgsl_pool_init(void);
+void kgsl_pool_exit(void);
+
+#endif /* __KGSL_POOL_H */
@@ -19,6 +19,7 @@
 #include <linux/msm-bus-board.h>
 #include <linux/ktime.h>
 #include <linux/delay.h>
+#include <linux/math64.h>
 #include <linux/msm_adreno_devfreq.h>
 #include <linux/of_device.h>
 
@@ -54,6 +55,14 @@
 #define DEFAULT_BUS_P 25
 #define DEFAULT_BUS_DIV (100 / DEFAULT_BUS_P)
 
+/*
+ * Bytes moved by one VBIF_AXI_TOTAL_BEATS beat on the 128 bit GPU AXI
+ * port, and the default headroom over the measured traffic for the
+ * bus_traffic votes.
+ */
+#define VBIF_BYTES_PER_BEAT	16
+#define DEFAULT_BUS_HEADROOM	25
+
 /*
  * The effective duration of qos request in usecs. After
  * timeout, qos request is cancelled automatically.
@@ -176,6 +185,8 @@ static void _ab_buslevel_update(struct kgsl_pwrctrl *pwr,
 		return;
 	if (ib == 0)
 		*ab = 0;
+	else if (pwr->bus_traffic && pwr->bus_ab_mbps)
+		*ab = pwr->bus_ab_mbps;
 	else if (!pwr->bus_percent_ab)
 		*ab = DEFAULT_BUS_P * ib / 100;
 	else
@@ -207,7 +218,9 @@ static unsigned int _adjust_pwrlevel(struct kgsl_pwrctrl *pwr, int level,
 	max_pwrlevel = max_t(unsigned int, therm_pwrlevel,
 		pwr->max_pwrlevel);
 	min_pwrlevel = max_t(unsigned int, therm_pwrlevel,
-		pwr->min_pwrlevel);
+		min_t(unsigned int, pwr->min_pwrlevel, pwr->floor_pwrlevel));
+	/* A hint floor never lifts the GPU over its user or thermal cap */
+	min_pwrlevel = max_t(unsigned int, min_pwrlevel, max_pwrlevel);
 
 	switch (pwrc->type) {
 	case KGSL_CONSTRAINT_PWRLEVEL: {
@@ -256,13 +269,23 @@ void kgsl_pwrctrl_buslevel_update(struct kgsl_device *device,
 	 * If the bus should remain on calculate our request and submit it,
 	 * otherwise request bus level 0, off.
 	 */
-	if (on) {
+	if (on && pwr->bus_traffic && pwr->bus_traffic_level) {
+		struct kgsl_pwrlevel *pl = &pwr->pwrlevels[pwr->active_pwrlevel];
+
+		/* The measured level only moves inside the GPU level limits */
+		buslevel = clamp_t(int, pwr->bus_traffic_level,
+				pl->bus_min, pl->bus_max);
+		buslevel = max_t(int, buslevel, 1);
+	} else if (on) {
 		buslevel = min_t(int, pwr->pwrlevels[0].bus_max,
 				cur + pwr->bus_mod);
 		buslevel = max_t(int, buslevel, 1);
 	} else {
 		/* If the bus is being turned off, reset to default level */
 		pwr->bus_mod = 0;
+		pwr->bus_traffic_level = 0;
+		pwr->bus_ab_mbps = 0;
+		pwr->bus_peak_mbps = 0;
 	}
 	trace_kgsl_buslevel(device, pwr->active_pwrlevel, buslevel);
 	last_vote_buslevel = buslevel;
@@ -288,6 +311,50 @@ void kgsl_pwrctrl_buslevel_update(struct kgsl_device *device,
 }
 EXPORT_SYMBOL(kgsl_pwrctrl_buslevel_update);
 
+/**
+ * kgsl_pwrctrl_bus_traffic_update() - Vote the bus from measured traffic
+ * @device: Pointer to the kgsl_device struct
+ * @beats: VBIF AXI beats counted in the sample
+ * @total_time: Length of the sample in usecs
+ *
+ * AB follows the average traffic of the sample and IB a peak that is
+ * raised at once and decays by a quarter every sample, so that bursts of
+ * texture streaming between two samples still find the bus fast enough.
+ * Both get bus_headroom percent on top. Called with the device mutex held.
+ */
+void kgsl_pwrctrl_bus_traffic_update(struct kgsl_device *device,
+			u64 beats, s64 total_time)
+{
+	struct kgsl_pwrctrl *pwr = &device->pwrctrl;
+	struct kgsl_pwrlevel *pl = &pwr->pwrlevels[pwr->active_pwrlevel];
+	unsigned int mbps, peak, ib;
+	int i;
+
+	BUG_ON(!mutex_is_locked(&device->mutex));
+
+	if (total_time <= 0)
+		return;
+
+	/* bytes per usec to Mbytes per second */
+	mbps = div64_u64(beats * VBIF_BYTES_PER_BEAT * USEC_PER_SEC,
+			(u64)total_time * 1048576);
+
+	peak = pwr->bus_peak_mbps - pwr->bus_peak_mbps / 4;
+	pwr->bus_peak_mbps = max(mbps, peak);
+
+	pwr->bus_ab_mbps = mbps * (100 + pwr->bus_headroom) / 100;
+	ib = pwr->bus_peak_mbps * (100 + pwr->bus_headroom) / 100;
+
+	/* The lowest level that covers the peak */
+	for (i = max_t(int, pl->bus_min, 1); i < pl->bus_max; i++)
+		if (ib_votes[i] >= ib)
+			break;
+
+	pwr->bus_traffic_level = i;
+	kgsl_pwrctrl_buslevel_update(device, true);
+}
+EXPORT_SYMBOL(kgsl_pwrctrl_bus_traffic_update);
+
 /**
  * kgsl_pwrctrl_pwrlevel_change_settings() - Program h/w during powerlevel
  * transitions
@@ -1055,6 +1122,76 @@ static ssize_t kgsl_pwrctrl_bus_split_store(struct device *dev,
 	return count;
 }
 
+static ssize_t kgsl_pwrctrl_bus_traffic_show(struct device *dev,
+					struct device_attribute *attr,
+					char *buf)
+{
+	struct kgsl_device *device = kgsl_device_from_dev(dev);
+	if (device == NULL)
+		return 0;
+	return snprintf(buf, PAGE_SIZE, "%d\n",
+		device->pwrctrl.bus_traffic);
+}
+
+static ssize_t kgsl_pwrctrl_bus_traffic_store(struct device *dev,
+					struct device_attribute *attr,
+					const char *buf, size_t count)
+{
+	unsigned int val = 0;
+	struct kgsl_device *device = kgsl_device_from_dev(dev);
+	int ret;
+
+	if (device == NULL)
+		return 0;
+
+	ret = kgsl_sysfs_store(buf, &val);
+	if (ret)
+		return ret;
+
+	mutex_lock(&device->mutex);
+	device->pwrctrl.bus_traffic = val ? true : false;
+	device->pwrctrl.bus_traffic_level = 0;
+	device->pwrctrl.bus_ab_mbps = 0;
+	device->pwrctrl.bus_peak_mbps = 0;
+	kgsl_pwrctrl_buslevel_update(device, true);
+	mutex_unlock(&device->mutex);
+
+	return count;
+}
+
+static ssize_t kgsl_pwrctrl_bus_headroom_show(struct device *dev,
+					struct device_attribute *attr,
+					char *buf)
+{
+	struct kgsl_device *device = kgsl_device_from_dev(dev);
+	if (device == NULL)
+		return 0;
+	return snprintf(buf, PAGE_SIZE, "%u\n",
+		device->pwrctrl.bus_headroom);
+}
+
+static ssize_t kgsl_pwrctrl_bus_headroom_store(struct device *dev,
+					struct device_attribute *attr,
+					const char *buf, size_t count)
+{
+	unsigned int val = 0;
+	struct kgsl_device *device = kgsl_device_from_dev(dev);
+	int ret;
+
+	if (device == NULL)
+		return 0;
+
+	ret = kgsl_sysfs_store(buf, &val);
+	if (ret)
+		return ret;
+
+	mutex_lock(&device->mutex);
+	device->pwrctrl.bus_headroom = min_t(unsigned int, val, 200);
+	mutex_unlock(&device->mutex);
+
+	return count;
+}
+
 static ssize_t kgsl_pwrctrl_default_pwrlevel_show(struct device *dev,
 					struct device_attribute *attr,
 					char *buf)
@@ -1177,6 +1314,12 @@ static DEVICE_ATTR(force_rail_on, 0644,
 static DEVICE_ATTR(bus_split, 0644,
 	kgsl_pwrctrl_bus_split_show,
 	kgsl_pwrctrl_bus_split_store);
+static DEVICE_ATTR(bus_traffic, 0644,
+	kgsl_pwrctrl_bus_traffic_show,
+	kgsl_pwrctrl_bus_traffic_store);
+static DEVICE_ATTR(bus_headroom, 0644,
+	kgsl_pwrctrl_bus_headroom_show,
+	kgsl_pwrctrl_bus_headroom_store);
 static DEVICE_ATTR(default_pwrlevel, 0644,
 	kgsl_pwrctrl_default_pwrlevel_show,
 	kgsl_pwrctrl_default_pwrlevel_store);
@@ -1198,6 +1341,8 @@ static const struct device_attribute *pwrctrl_attr_list[] = {
 	&dev_attr_force_bus_on,
 	&dev_attr_force_rail_on,
 	&dev_attr_bus_split,
+	&dev_attr_bus_traffic,
+	&dev_attr_bus_headroom,
 	&dev_attr_default_pwrlevel,
 	&dev_attr_popp,
 	NULL
@@ -1490,6 +1635,7 @@ int kgsl_pwrctrl_init(struct kgsl_device *device)
 
 	pwr->max_pwrlevel = 0;
 	pwr->min_pwrlevel = pdata->num_levels - 2;
+	pwr->floor_pwrlevel = pdata->num_levels - 2;
 	pwr->thermal_pwrlevel = 0;
 
 	pwr->active_pwrlevel = pdata->init_level;
@@ -1576,6 +1722,7 @@ int kgsl_pwrctrl_init(struct kgsl_device *device)
 
 	/* Set if independent bus BW voting is supported */
 	pwr->bus_control = pdata->bus_control;
+	pwr->bus_headroom = DEFAULT_BUS_HEADROOM;
 
 	/* Check if gpu bandwidth vote device is defined in dts */
 	if (pwr->bus_control) {
@@ -2534,3 +2681,63 @@ unsigned int kgsl_pwr_limits_get_freq(enum kgsl_deviceid id)
 	return freq;
 }
 EXPORT_SYMBOL(kgsl_pwr_limits_get_freq);
+
+/**
+ * kgsl_pwr_limits_get_busy() - Get the recent utilization
+ * @id: Device ID
+ *
+ * Get the percentage of time the device was busy over the last
+ * completed busy stats period
+ */
+unsigned int kgsl_pwr_limits_get_busy(enum kgsl_deviceid id)
+{
+	struct kgsl_device *device = kgsl_get_device(id);
+	struct kgsl_clk_stats *stats;
+	unsigned int busy, total;
+
+	if (IS_ERR_OR_NULL(device))
+		return 0;
+	stats = &device->pwrctrl.clk_stats;
+	mutex_lock(&device->mutex);
+	busy = stats->busy_old;
+	total = stats->total_old;
+	mutex_unlock(&device->mutex);
+
+	total /= 100;
+	return total ? min(100U, busy / total) : 0;
+}
+EXPORT_SYMBOL(kgsl_pwr_limits_get_busy);
+
+/**
+ * kgsl_pwr_floor_set_freq() - Set a minimum GPU frequency
+ * @id: Device ID
+ * @freq: Lowest frequency the GPU may run at, 0 to drop the floor
+ *
+ * The floor is rounded up to the next supported power level. User max and
+ * thermal limits still apply on top of it.
+ */
+int kgsl_pwr_floor_set_freq(enum kgsl_deviceid id, unsigned int freq)
+{
+	struct kgsl_device *device = kgsl_get_device(id);
+	struct kgsl_pwrctrl *pwr;
+	int level;
+
+	if (IS_ERR_OR_NULL(device))
+		return -ENODEV;
+	pwr = &device->pwrctrl;
+
+	mutex_lock(&device->mutex);
+	level = pwr->num_pwrlevels - 2;
+	if (freq) {
+		while (level > 0 && pwr->pwrlevels[level].gpu_freq < freq)
+			level--;
+	}
+	if (pwr->floor_pwrlevel != level) {
+		pwr->floor_pwrlevel = level;
+		kgsl_pwrctrl_pwrlevel_change(device, pwr->active_pwrlevel);
+	}
+	mutex_unlock(&device->mutex);
+
+	return 0;
+}
+EXPORT_SYMBOL(kgsl_pwr_floor_set_freq);
@@ -90,6 +90,7 @@ struct kgsl_pwr_constraint {
  * @init_pwrlevel - device inital power level
  * @max_pwrlevel - maximum allowable powerlevel per the user
  * @min_pwrlevel - minimum allowable powerlevel per the user
+ * @floor_pwrlevel - minimum powerlevel requested by in-kernel performance hints
  * @num_pwrlevels - number of available power levels
  * @interval_timeout - timeout in jiffies to be idle before a power event
  * @strtstp_sleepwake - true if the device supports low latency GPU start/stop
@@ -107,6 +108,11 @@ struct kgsl_pwr_constraint {
  * @bus_control - true if the bus calculation is independent
  * @bus_mod - modifier from the current power level for the bus vote
  * @bus_percent_ab - current percent of total possible bus usage
+ * @bus_traffic - true if the bus is voted from the measured VBIF traffic
+ * @bus_headroom - percent voted on top of the measured traffic
+ * @bus_traffic_level - bus level picked from the measured traffic
+ * @bus_ab_mbps - AB vote from the measured traffic
+ * @bus_peak_mbps - decaying peak of the measured traffic
  * @bus_index - default bus index into the bus_ib table
  * @bus_ib - the set of unique ib requests needed for the bus calculation
  * @constraint - currently active power constraint
@@ -136,6 +142,7 @@ struct kgsl_pwrctrl {
 	unsigned int wakeup_maxpwrlevel;
 	unsigned int max_pwrlevel;
 	unsigned int min_pwrlevel;
+	unsigned int floor_pwrlevel;
 	unsigned int num_pwrlevels;
 	unsigned long interval_timeout;
 	bool strtstp_sleepwake;
@@ -153,6 +160,11 @@ struct kgsl_pwrctrl {
 	bool bus_control;
 	int bus_mod;
 	unsigned int bus_percent_ab;
+	bool bus_traffic;
+	unsigned int bus_headroom;
+	int bus_traffic_level;
+	unsigned int bus_ab_mbps;
+	unsigned int bus_peak_mbps;
 	struct device *devbw;
 	unsigned int bus_index[KGSL_MAX_PWRLEVELS];
 	uint64_t bus_ib[KGSL_MAX_PWRLEVELS];
@@ -175,6 +187,8 @@ void kgsl_idle_check(struct work_struct *work);
 void kgsl_pre_hwaccess(struct kgsl_device *device);
 void kgsl_pwrctrl_pwrlevel_change(struct kgsl_device *device,
 	unsigned int level);
+void kgsl_pwrctrl_bus_traffic_update(struct kgsl_device *device,
+			u64 beats, s64 total_time);
 void kgsl_pwrctrl_buslevel_update(struct kgsl_device *device,
 	bool on);
 int kgsl_pwrctrl_init_sysfs(struct kgsl_device *device);
@@ -43,6 +43,7 @@ static struct kgsl_popp popp_param[POPP_MAX] = {
 static void do_devfreq_suspend(struct work_struct *work);
 static void do_devfreq_resume(struct work_struct *work);
 static void do_devfreq_notify(struct work_struct *work);
+static void do_devfreq_frame(struct work_struct *work);
 
 /*
  * These variables are used to keep the latest data
@@ -186,6 +187,24 @@ void kgsl_pwrscale_update(struct kgsl_device *device)
 }
 EXPORT_SYMBOL(kgsl_pwrscale_update);
 
+/**
+ * kgsl_pwrscale_frame() - tell the governor that a frame retired
+ * @device: The device
+ *
+ * Called when the end of frame command batch of a context retires. Unlike
+ * kgsl_pwrscale_update() this is not rate limited so that a governor that
+ * works on frame boundaries sees every one of them.
+ */
+void kgsl_pwrscale_frame(struct kgsl_device *device)
+{
+	if (!device->pwrscale.enabled || !device->pwrscale.devfreqptr)
+		return;
+
+	queue_work(device->pwrscale.devfreq_wq,
+		&device->pwrscale.devfreq_frame_ws);
+}
+EXPORT_SYMBOL(kgsl_pwrscale_frame);
+
 /*
  * kgsl_pwrscale_disable - temporarily disable the governor
  * @device: The device
@@ -692,6 +711,17 @@ int kgsl_busmon_target(struct device *dev, unsigned long *freq, u32 flags)
 	bus_flag = device->pwrscale.bus_profile.flag;
 	device->pwrscale.bus_profile.flag = 0;
 
+	/* Vote for the traffic of the last sample rather than the hints */
+	if (pwr->bus_traffic) {
+		struct xstats *last_b =
+			(struct xstats *)last_status.private_data;
+
+		kgsl_pwrctrl_bus_traffic_update(device, last_b->ram_time,
+				last_status.total_time);
+		mutex_unlock(&device->mutex);
+		return 0;
+	}
+
 	/*
 	 * Bus devfreq governor has calculated its recomendations
 	 * when gpu was running with *freq frequency.
@@ -827,6 +857,7 @@ int kgsl_pwrscale_init(struct device *dev, const char *governor)
 	INIT_WORK(&pwrscale->devfreq_suspend_ws, do_devfreq_suspend);
 	INIT_WORK(&pwrscale->devfreq_resume_ws, do_devfreq_resume);
 	INIT_WORK(&pwrscale->devfreq_notify_ws, do_devfreq_notify);
+	INIT_WORK(&pwrscale->devfreq_frame_ws, do_devfreq_frame);
 
 	pwrscale->next_governor_call = ktime_add_us(ktime_get(),
 			KGSL_GOVERNOR_CALL_INTERVAL);
@@ -896,3 +927,13 @@ static void do_devfreq_notify(struct work_struct *work)
 				 ADRENO_DEVFREQ_NOTIFY_RETIRE,
 				 devfreq);
 }
+
+static void do_devfreq_frame(struct work_struct *work)
+{
+	struct kgsl_pwrscale *pwrscale = container_of(work,
+			struct kgsl_pwrscale, devfreq_frame_ws);
+	struct devfreq *devfreq = pwrscale->devfreqptr;
+	srcu_notifier_call_chain(&pwrscale->nh,
+				 ADRENO_DEVFREQ_NOTIFY_FRAME,
+				 devfreq);
+}
@@ -25,6 +25,7 @@
 #include "kgsl_cffdump.h"
 #include "kgsl_device.h"
 #include "kgsl_log.h"
+#include "kgsl_pool.h"
 
 static DEFINE_MUTEX(kernel_map_global_lock);
 
@@ -131,6 +132,19 @@ mem_entry_max_show(struct kgsl_process_private *priv, int type, char *buf)
 	return snprintf(buf, PAGE_SIZE, "%d\n", priv->stats[type].max);
 }
 
+/**
+ * Show the GPU time used by the contexts of the process in microseconds
+ */
+
+static ssize_t
+gpu_busy_show(struct kgsl_process_private *priv, int type, char *buf)
+{
+	return snprintf(buf, PAGE_SIZE, "%llu\n",
+		div_u64(atomic64_read(&priv->gpu_time), NSEC_PER_USEC));
+}
+
+static struct kgsl_mem_entry_attribute gpu_busy_attr =
+	__MEM_ENTRY_ATTR(0, gpu_busy, gpu_busy_show);
 
 static void mem_entry_sysfs_release(struct kobject *kobj)
 {
@@ -187,6 +201,7 @@ kgsl_process_uninit_sysfs(struct kgsl_process_private *private)
 		sysfs_remove_file(&private->kobj,
 			&mem_stats[i].max_attr.attr);
 	}
+	sysfs_remove_file(&private->kobj, &gpu_busy_attr.attr);
 
 	kobject_put(&private->kobj);
 }
@@ -227,6 +242,7 @@ kgsl_process_init_sysfs(struct kgsl_device *device,
 		ret = sysfs_create_file(&private->kobj,
 			&mem_stats[i].max_attr.attr);
 	}
+	ret = sysfs_create_file(&private->kobj, &gpu_busy_attr.attr);
 	return ret;
 }
 
@@ -378,7 +394,7 @@ static void kgsl_page_alloc_unmap_kernel(struct kgsl_memdesc *memdesc)
 	memdesc->hostptr_count--;
 	if (memdesc->hostptr_count)
 		goto done;
-	vunmap(memdesc->hostptr);
+	vm_unmap_ram(memdesc->hostptr, memdesc->page_count);
 	kgsl_driver.stats.vmalloc -= memdesc->size;
 	memdesc->hostptr = NULL;
 done:
@@ -407,7 +423,7 @@ static void kgsl_page_alloc_free(struct kgsl_memdesc *memdesc)
 			struct page *p = memdesc->pages[i];
 
 			i += 1 << compound_order(p);
-			__free_pages(p, compound_order(p));
+			kgsl_pool_free_page(p);
 		}
 	}
 
@@ -431,8 +447,12 @@ static int kgsl_page_alloc_map_kernel(struct kgsl_memdesc *memdesc)
 	if ((!memdesc->hostptr) && (memdesc->pages != NULL)) {
 		pgprot_t page_prot = pgprot_writecombine(PAGE_KERNEL);
 
-		memdesc->hostptr = vmap(memdesc->pages, memdesc->page_count,
-					VM_IOREMAP, page_prot);
+		/*
+		 * Small buffers are mapped from the per cpu vmap blocks,
+		 * whose TLB flush is deferred until the block is purged
+		 */
+		memdesc->hostptr = vm_map_ram(memdesc->pages,
+					memdesc->page_count, -1, page_prot);
 		if (memdesc->hostptr)
 			KGSL_STATS_ADD(memdesc->size, kgsl_driver.stats.vmalloc,
 				kgsl_driver.stats.vmalloc_max);
@@ -665,6 +685,9 @@ EXPORT_SYMBOL(kgsl_cache_range_op);
 #ifndef CONFIG_ALLOC_BUFFERS_IN_4K_CHUNKS
 static inline int get_page_size(size_t size, unsigned int align)
 {
+	if (align >= ilog2(KGSL_POOL_MAX_PAGE_SIZE) &&
+			size >= KGSL_POOL_MAX_PAGE_SIZE)
+		return KGSL_POOL_MAX_PAGE_SIZE;
 	return (align >= ilog2(SZ_64K) && size >= SZ_64K)
 					? SZ_64K : PAGE_SIZE;
 }
@@ -681,12 +704,9 @@ _kgsl_sharedmem_page_alloc(struct kgsl_memdesc *memdesc,
 			size_t size)
 {
 	int pcount = 0, ret = 0;
-	int j, page_size, sglen_alloc;
+	int page_size, sglen_alloc;
 	size_t len;
-	pgprot_t page_prot = pgprot_writecombine(PAGE_KERNEL);
-	void *ptr;
 	unsigned int align;
-	int step = ((VMALLOC_END - VMALLOC_START)/8) >> PAGE_SHIFT;
 
 	size = PAGE_ALIGN(size);
 	if (size == 0 || size > UINT_MAX)
@@ -738,30 +758,26 @@ _kgsl_sharedmem_page_alloc(struct kgsl_memdesc *memdesc,
 
 	len = size;
 
+	/*
+	 * All memory that goes to the user has to be zeroed out and flushed
+	 * from the dcache before it gets exposed to userspace. The pages come
+	 * from kgsl_pool, which hands out pages that were zeroed in the
+	 * background where it can and zeroes the rest itself.
+	 */
 	while (len > 0) {
 		struct page *page;
-		unsigned int gfp_mask = __GFP_HIGHMEM;
 		int j;
 
 		/* don't waste space at the end of the allocation*/
-		if (len < page_size)
-			page_size = PAGE_SIZE;
+		while (len < page_size && page_size != PAGE_SIZE)
+			page_size = (page_size > SZ_64K) ? SZ_64K : PAGE_SIZE;
 
-		/*
-		 * Don't do some of the more aggressive memory recovery
-		 * techniques for large order allocations
-		 */
-		if (page_size != PAGE_SIZE)
-			gfp_mask |= __GFP_COMP | __GFP_NORETRY |
-				__GFP_NO_KSWAPD | __GFP_NOWARN;
-		else
-			gfp_mask |= GFP_KERNEL;
-
-		page = alloc_pages(gfp_mask, get_order(page_size));
+		page = kgsl_pool_alloc_page(page_size);
 
 		if (page == NULL) {
 			if (page_size != PAGE_SIZE) {
-				page_size = PAGE_SIZE;
+				page_size = (page_size > SZ_64K) ?
+					SZ_64K : PAGE_SIZE;
 				continue;
 			}
 
@@ -783,48 +799,6 @@ _kgsl_sharedmem_page_alloc(struct kgsl_memdesc *memdesc,
 	}
 	memdesc->size = size;
 
-	/*
-	 * All memory that goes to the user has to be zeroed out before it gets
-	 * exposed to userspace. This means that the memory has to be mapped in
-	 * the kernel, zeroed (memset) and then unmapped.  This also means that
-	 * the dcache has to be flushed to ensure coherency between the kernel
-	 * and user pages. We used to pass __GFP_ZERO to alloc_page which mapped
-	 * zeroed and unmaped each individual page, and then we had to turn
-	 * around and call flush_dcache_page() on that page to clear the caches.
-	 * This was killing us for performance. Instead, we found it is much
-	 * faster to allocate the pages without GFP_ZERO, map a chunk of the
-	 * range ('step' pages), memset it, flush it and then unmap
-	 * - this results in a factor of 4 improvement for speed for large
-	 * buffers. There is a small decrease in speed for small buffers,
-	 * but only on the order of a few microseconds at best. The 'step'
-	 * size is based on a guess at the amount of free vmalloc space, but
-	 * will scale down if there's not enough free space.
-	 */
-	for (j = 0; j < pcount; j += step) {
-		step = min(step, pcount - j);
-
-		ptr = vmap(&memdesc->pages[j], step, VM_IOREMAP, page_prot);
-
-		if (ptr != NULL) {
-			memset(ptr, 0, step * PAGE_SIZE);
-			dmac_flush_range(ptr, ptr + step * PAGE_SIZE);
-			vunmap(ptr);
-		} else {
-			int k;
-			/* Very, very, very slow path */
-
-			for (k = j; k < j + step; k++) {
-				ptr = kmap_atomic(memdesc->pages[k]);
-				memset(ptr, 0, PAGE_SIZE);
-				dmac_flush_range(ptr, ptr + PAGE_SIZE);
-				kunmap_atomic(ptr);
-			}
-			/* scale down the step size to avoid this path */
-			if (step > 1)
-				step >>= 1;
-		}
-	}
-
 done:
 	KGSL_STATS_ADD(memdesc->size, kgsl_driver.stats.page_alloc,
 		kgsl_driver.stats.page_alloc_max);
@@ -31,6 +31,15 @@ struct kgsl_snapshot_cp_obj {
 	struct list_head node;
 };
 
+/* An IB from the ringbuffer that the snapshot worker parses for objects */
+
+struct kgsl_snapshot_deferred_ib {
+	struct kgsl_mem_entry *entry;
+	unsigned int gpuaddr;
+	unsigned int dwords;
+	struct list_head node;
+};
+
 struct snapshot_obj_itr {
 	u8 *buf;      /* Buffer pointer to write to */
 	int pos;        /* Current position in the sequence */
@@ -230,9 +239,17 @@ int kgsl_snapshot_have_object(struct kgsl_snapshot *snapshot,
 {
 	struct kgsl_snapshot_object *obj;
 	struct kgsl_snapshot_cp_obj *obj_cp;
+	struct kgsl_snapshot_deferred_ib *ib;
 	struct adreno_ib_object *ib_obj;
 	int i;
 
+	/* Check whether the IB is already waiting to be parsed */
+	list_for_each_entry(ib, &snapshot->ib_list, node) {
+		if (ib->entry->priv == process && gpuaddr >= ib->gpuaddr &&
+			(gpuaddr + size) <= (ib->gpuaddr + (ib->dwords << 2)))
+			return 1;
+	}
+
 	/* Check whether the object is tracked already in ib list */
 	list_for_each_entry(obj_cp, &snapshot->cp_list, node) {
 		if (obj_cp->ib_obj_list == NULL
@@ -389,6 +406,45 @@ err_put:
 }
 EXPORT_SYMBOL(kgsl_snapshot_get_object);
 
+/**
+ * kgsl_snapshot_defer_ib() - Parse an IB after the snapshot is taken
+ * @snapshot: The snapshot data
+ * @process: The process that owns the IB
+ * @gpuaddr: The gpu address of the IB
+ * @dwords: The size of the IB in dwords
+ *
+ * Finding the objects used by the IBs of the ringbuffer means parsing
+ * every IB, which is too slow to do while the GPU waits to be recovered.
+ * The IB is held here and parsed by the snapshot worker instead, which
+ * freezes the objects the same way as kgsl_snapshot_add_ib_obj_list().
+ * Returns 0 on success or an error code.
+ */
+int kgsl_snapshot_defer_ib(struct kgsl_snapshot *snapshot,
+	struct kgsl_process_private *process, unsigned int gpuaddr,
+	unsigned int dwords)
+{
+	struct kgsl_snapshot_deferred_ib *ib;
+	struct kgsl_mem_entry *entry;
+
+	entry = kgsl_sharedmem_find_region(process, gpuaddr, dwords << 2);
+	if (entry == NULL)
+		return -EINVAL;
+
+	ib = kzalloc(sizeof(*ib), GFP_KERNEL);
+	if (ib == NULL) {
+		kgsl_mem_entry_put(entry);
+		return -ENOMEM;
+	}
+
+	ib->entry = entry;
+	ib->gpuaddr = gpuaddr;
+	ib->dwords = dwords;
+	list_add_tail(&ib->node, &snapshot->ib_list);
+
+	return 0;
+}
+EXPORT_SYMBOL(kgsl_snapshot_defer_ib);
+
 /**
  * kgsl_snapshot_dump_regs - helper function to dump device registers
  * @device - the device to dump registers from
@@ -681,8 +737,11 @@ int kgsl_device_snapshot(struct kgsl_device *device,
 	init_completion(&snapshot->dump_gate);
 	INIT_LIST_HEAD(&snapshot->obj_list);
 	INIT_LIST_HEAD(&snapshot->cp_list);
+	INIT_LIST_HEAD(&snapshot->ib_list);
 	INIT_WORK(&snapshot->work, kgsl_snapshot_save_frozen_objs);
 
+	snapshot->device = device;
+
 	snapshot->start = device->snapshot_memory.ptr;
 	snapshot->ptr = device->snapshot_memory.ptr;
 	snapshot->remain = device->snapshot_memory.size;
@@ -724,9 +783,9 @@ int kgsl_device_snapshot(struct kgsl_device *device,
 	sysfs_notify(&device->snapshot_kobj, NULL, "timestamp");
 
 	/*
-	 * Queue a work item that will save the IB data in snapshot into
-	 * static memory to prevent loss of data due to overwriting of
-	 * memory.
+	 * Queue a work item that will parse the deferred IBs and save the IB
+	 * data in snapshot into static memory to prevent loss of data due to
+	 * overwriting of memory. This runs while the GPU is being recovered.
 	 *
 	 */
 	queue_work(device->work_queue, &snapshot->work);
@@ -769,6 +828,36 @@ static void kgsl_snapshot_process_ib_obj_list(struct kgsl_snapshot *snapshot)
 	}
 }
 
+/*
+ * kgsl_snapshot_parse_deferred_ibs() - Parse the IBs that were held by
+ * kgsl_snapshot_defer_ib() and add the objects they use to the snapshot
+ * @snapshot: The snapshot data
+ */
+static void kgsl_snapshot_parse_deferred_ibs(struct kgsl_snapshot *snapshot)
+{
+	struct kgsl_snapshot_deferred_ib *ib, *tmp;
+	struct adreno_ib_object_list *ib_obj_list;
+	bool max_objs = false;
+
+	list_for_each_entry_safe(ib, tmp, &snapshot->ib_list, node) {
+		if (-E2BIG == adreno_ib_create_object_list(snapshot->device,
+				ib->entry->priv, ib->gpuaddr, ib->dwords,
+				&ib_obj_list))
+			max_objs = true;
+
+		if (ib_obj_list &&
+			kgsl_snapshot_add_ib_obj_list(snapshot, ib_obj_list))
+			adreno_ib_destroy_obj_list(ib_obj_list);
+
+		list_del(&ib->node);
+		kgsl_mem_entry_put(ib->entry);
+		kfree(ib);
+	}
+
+	if (max_objs)
+		KGSL_CORE_ERR("snapshot: Max objects found in IB\n");
+}
+
 #define to_snapshot_attr(a) \
 container_of(a, struct kgsl_snapshot_attribute, attr)
 
@@ -1104,6 +1193,7 @@ void kgsl_snapshot_save_frozen_objs(struct work_struct *work)
 	size_t size = 0;
 	void *ptr;
 
+	kgsl_snapshot_parse_deferred_ibs(snapshot);
 	kgsl_snapshot_process_ib_obj_list(snapshot);
 
 	list_for_each_entry(obj, &snapshot->obj_list, node) {
@@ -15,10 +15,14 @@
 #include <linux/kernel.h>
 #include <linux/io.h>
 #include <linux/sched.h>
+#include <linux/cpufreq.h>
+#include <linux/log2.h>
+#include <linux/moduleparam.h>
 #include <asm/smp_plat.h>
 #include "../../../drivers/power/qcom/idle.h"
 #include <htc_mnemosyne/htc_mnemosyne.h>
 #include <htc_mnemosyne/htc_footprint.h>
+#include <htc_mnemosyne/htc_perf_footprint.h>
 
 #define APPS_WDOG_FOOT_PRINT_MAGIC			0xACBDFE00
 
@@ -397,6 +401,142 @@ void set_hotplug_on_footprint(unsigned cpu, unsigned value)
 	mb();
 }
 
+#ifdef CONFIG_HTC_PERF_FOOTPRINT
+#define PERF_FOOTPRINT_MAX_NR	256
+
+struct static_key htc_perf_footprint_key = STATIC_KEY_INIT_FALSE;
+
+/* Record handlers running longer than this with interrupts off */
+static unsigned int perf_irq_threshold_us = 1000;
+module_param_named(perf_irq_threshold_us, perf_irq_threshold_us, uint, 0644);
+
+/* Record tasks left runnable longer than this */
+static unsigned int perf_sched_threshold_us = 20000;
+module_param_named(perf_sched_threshold_us, perf_sched_threshold_us, uint, 0644);
+
+static struct perf_footprint_rec *perf_footprint_rings;
+static unsigned int perf_footprint_nr;
+static unsigned int perf_footprint_max[NR_CPUS];
+static unsigned int perf_footprint_min[NR_CPUS];
+
+/*
+ * Each cpu only writes its own ring, with interrupts off, so no lock is
+ * needed. type is cleared first and written last, so that a record cut
+ * short by a reset is recognizable.
+ */
+static void perf_footprint_record(u32 type, u32 id, u64 value, u64 arg)
+{
+	struct perf_footprint_rec *rec;
+	unsigned long flags;
+	u64 head;
+	int cpu;
+
+	local_irq_save(flags);
+	cpu = S2H(smp_processor_id());
+	head = MNEMOSYNE_GET_I(perf_footprint_head, cpu);
+	rec = &perf_footprint_rings[cpu * perf_footprint_nr +
+				    (head & (perf_footprint_nr - 1))];
+	rec->type = 0;
+	barrier();
+	rec->ts = sched_clock();
+	rec->id = id;
+	rec->value = value;
+	rec->arg = arg;
+	barrier();
+	rec->type = PERF_FOOT_PRINT_MAGIC | type;
+	MNEMOSYNE_SET_I(perf_footprint_head, cpu, head + 1);
+	local_irq_restore(flags);
+}
+
+void __htc_perf_footprint_irq(unsigned int irq, void *handler, u64 ns)
+{
+	if (ns > (u64)perf_irq_threshold_us * NSEC_PER_USEC)
+		perf_footprint_record(PERF_FP_IRQ, irq, ns,
+				      (unsigned long)handler);
+}
+
+void __htc_perf_footprint_sched(struct task_struct *p, u64 ns)
+{
+	u64 comm = 0;
+
+	if (ns <= (u64)perf_sched_threshold_us * NSEC_PER_USEC)
+		return;
+
+	memcpy(&comm, p->comm, sizeof(comm));
+	perf_footprint_record(PERF_FP_SCHED_DELAY, p->pid, ns, comm);
+}
+
+/* Thermal and other cpufreq limits all end up in the policy min/max */
+static int perf_footprint_cpufreq_cb(struct notifier_block *nb,
+				     unsigned long event, void *data)
+{
+	struct cpufreq_policy *policy = data;
+
+	if (event != CPUFREQ_NOTIFY || policy->cpu >= NR_CPUS)
+		return NOTIFY_OK;
+
+	if (perf_footprint_max[policy->cpu] != policy->max ||
+	    perf_footprint_min[policy->cpu] != policy->min) {
+		perf_footprint_max[policy->cpu] = policy->max;
+		perf_footprint_min[policy->cpu] = policy->min;
+		perf_footprint_record(PERF_FP_FREQ_LIMIT, policy->cpu,
+				      policy->max, policy->min);
+	}
+
+	return NOTIFY_OK;
+}
+
+static struct notifier_block perf_footprint_cpufreq_nb = {
+	.notifier_call = perf_footprint_cpufreq_cb,
+};
+
+/*
+ * The rings take the part of the reserved area not used by
+ * struct mnemosyne_data.
+ */
+static int __init perf_footprint_init(void)
+{
+	unsigned long offset, nr;
+	struct mnemosyne_data *base = mnemosyne_get_base();
+
+	if (!base)
+		return -ENODEV;
+
+	offset = ALIGN(sizeof(struct mnemosyne_data), L1_CACHE_BYTES);
+	if (mnemosyne_size <= offset)
+		return -ENOSPC;
+
+	nr = (mnemosyne_size - offset) /
+		(NR_CPUS * sizeof(struct perf_footprint_rec));
+	if (nr < 2) {
+		pr_warn("%s: no room for perf footprint rings.\n", __func__);
+		return -ENOSPC;
+	}
+	nr = min_t(unsigned long, rounddown_pow_of_two(nr),
+			PERF_FOOTPRINT_MAX_NR);
+
+	perf_footprint_rings = (void *)base + offset;
+	perf_footprint_nr = nr;
+	memset(perf_footprint_rings, 0,
+	       NR_CPUS * nr * sizeof(struct perf_footprint_rec));
+	memset(MNEMOSYNE_GET_ADDR(perf_footprint_head), 0,
+	       sizeof(base->perf_footprint_head));
+	MNEMOSYNE_SET(perf_footprint_offset, offset);
+	MNEMOSYNE_SET(perf_footprint_nr, nr);
+	MNEMOSYNE_SET(perf_footprint_magic, PERF_FOOT_PRINT_MAGIC);
+	mb();
+
+	cpufreq_register_notifier(&perf_footprint_cpufreq_nb,
+				  CPUFREQ_POLICY_NOTIFIER);
+	static_key_slow_inc(&htc_perf_footprint_key);
+	pr_info("%s: %lu records per cpu at offset %lu.\n", __func__,
+		nr, offset);
+
+	return 0;
+}
+late_initcall(perf_footprint_init);
+#endif /* CONFIG_HTC_PERF_FOOTPRINT */
+
 /*
  * This function will initialize cpu footprint on booting a device.
  * Core0 is on already to execute these codes.
@@ -14,6 +14,7 @@
 #define EVDEV_MINORS		32
 #define EVDEV_MIN_BUFFER_SIZE	64U
 #define EVDEV_BUF_PACKETS	8
+#define EVDEV_MAX_BATCH_US	(100 * USEC_PER_MSEC)
 
 #include <linux/poll.h>
 #include <linux/sched.h>
@@ -26,6 +27,7 @@
 #include <linux/major.h>
 #include <linux/device.h>
 #include <linux/cdev.h>
+#include <linux/hrtimer.h>
 #include <linux/wakelock.h>
 #include "input-compat.h"
 
@@ -54,10 +56,64 @@ struct evdev_client {
 	struct evdev *evdev;
 	struct list_head node;
 	int clkid;
+	/*
+	 * Wakeup batching: with a nonzero budget, readers are woken at most
+	 * once per budget for packets without key or switch events. Packets
+	 * are held back from poll() and blocking read() while batch_pending.
+	 */
+	unsigned int batch_us;
+	bool batch_pending;
+	struct hrtimer batch_timer;
 	unsigned int bufsize;
 	struct input_event buffer[];
 };
 
+static inline bool evdev_client_ready(struct evdev_client *client)
+{
+	return client->packet_head != client->tail && !client->batch_pending;
+}
+
+static enum hrtimer_restart evdev_batch_timer_fn(struct hrtimer *timer)
+{
+	struct evdev_client *client =
+		container_of(timer, struct evdev_client, batch_timer);
+
+	spin_lock(&client->buffer_lock);
+	client->batch_pending = false;
+	spin_unlock(&client->buffer_lock);
+
+	wake_up_interruptible(&client->evdev->wait);
+
+	return HRTIMER_NORESTART;
+}
+
+/*
+ * Decide whether a completed packet should wake the reader now. Called with
+ * buffer_lock held.
+ */
+static bool evdev_batch_wakeup(struct evdev_client *client, bool urgent)
+{
+	if (!client->batch_us)
+		return true;
+
+	if (urgent) {
+		if (client->batch_pending) {
+			hrtimer_try_to_cancel(&client->batch_timer);
+			client->batch_pending = false;
+		}
+		return true;
+	}
+
+	if (!client->batch_pending) {
+		client->batch_pending = true;
+		hrtimer_start(&client->batch_timer,
+			      ns_to_ktime((u64)client->batch_us * NSEC_PER_USEC),
+			      HRTIMER_MODE_REL);
+	}
+
+	return false;
+}
+
 static void __pass_event(struct evdev_client *client,
 			 const struct input_event *event)
 {
@@ -97,6 +153,7 @@ static void evdev_pass_values(struct evdev_client *client,
 	const struct input_value *v;
 	struct input_event event;
 	bool wakeup = false;
+	bool urgent = false;
 
 	event.time = ktime_to_timeval(client->clkid == CLOCK_MONOTONIC ?
 				      mono : real);
@@ -111,8 +168,13 @@ static void evdev_pass_values(struct evdev_client *client,
 		__pass_event(client, &event);
 		if (v->type == EV_SYN && v->code == SYN_REPORT)
 			wakeup = true;
+		else if (v->type == EV_KEY || v->type == EV_SW)
+			urgent = true;
 	}
 
+	if (wakeup)
+		wakeup = evdev_batch_wakeup(client, urgent);
+
 	spin_unlock(&client->buffer_lock);
 
 	if (wakeup)
@@ -299,6 +361,7 @@ static int evdev_release(struct inode *inode, struct file *file)
 	mutex_unlock(&evdev->mutex);
 
 	evdev_detach_client(evdev, client);
+	hrtimer_cancel(&client->batch_timer);
 	if (client->use_wake_lock)
 		wake_lock_destroy(&client->wake_lock);
 
@@ -339,6 +402,8 @@ static int evdev_open(struct inode *inode, struct file *file)
 	client->clkid = CLOCK_MONOTONIC;
 	client->bufsize = bufsize;
 	spin_lock_init(&client->buffer_lock);
+	hrtimer_init(&client->batch_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	client->batch_timer.function = evdev_batch_timer_fn;
 	snprintf(client->name, sizeof(client->name), "%s-%d",
 			dev_name(&evdev->dev), task_tgid_vnr(current));
 	client->evdev = evdev;
@@ -458,7 +523,7 @@ static ssize_t evdev_read(struct file *file, char __user *buffer,
 
 		if (!(file->f_flags & O_NONBLOCK)) {
 			error = wait_event_interruptible(evdev->wait,
-					client->packet_head != client->tail ||
+					evdev_client_ready(client) ||
 					!evdev->exist);
 			if (error)
 				return error;
@@ -478,7 +543,7 @@ static unsigned int evdev_poll(struct file *file, poll_table *wait)
 	poll_wait(file, &evdev->wait, wait);
 
 	mask = evdev->exist ? POLLOUT | POLLWRNORM : POLLHUP | POLLERR;
-	if (client->packet_head != client->tail)
+	if (evdev_client_ready(client))
 		mask |= POLLIN | POLLRDNORM;
 
 	return mask;
@@ -727,6 +792,27 @@ static int evdev_disable_suspend_block(struct evdev *evdev,
 	return 0;
 }
 
+static int evdev_set_batch(struct evdev_client *client, unsigned int us)
+{
+	bool flush;
+
+	spin_lock_irq(&client->buffer_lock);
+	client->batch_us = us;
+	flush = !us && client->batch_pending;
+	spin_unlock_irq(&client->buffer_lock);
+
+	/* Turning batching off releases whatever is being held back */
+	if (flush) {
+		hrtimer_cancel(&client->batch_timer);
+		spin_lock_irq(&client->buffer_lock);
+		client->batch_pending = false;
+		spin_unlock_irq(&client->buffer_lock);
+		wake_up_interruptible(&client->evdev->wait);
+	}
+
+	return 0;
+}
+
 static long evdev_do_ioctl(struct file *file, unsigned int cmd,
 			   void __user *p, int compat_mode)
 {
@@ -817,6 +903,16 @@ static long evdev_do_ioctl(struct file *file, unsigned int cmd,
 			return evdev_enable_suspend_block(evdev, client);
 		else
 			return evdev_disable_suspend_block(evdev, client);
+
+	case EVIOCGBATCH:
+		return put_user(client->batch_us, ip);
+
+	case EVIOCSBATCH:
+		if (get_user(u, ip))
+			return -EFAULT;
+		if (u > EVDEV_MAX_BATCH_US)
+			return -EINVAL;
+		return evdev_set_batch(client, u);
 	}
 
 	size = _IOC_SIZE(cmd);
@@ -1269,6 +1269,11 @@
 
 #define MAX_FIFO_F_LEVEL 32
 #define MAX_FIFO_F_BYTES 6
+/* Frames buffered before the FIFO is drained, with room for late drains */
+#define BMA2X2_FIFO_WM_LEVEL 24
+
+#define BMA2X2_FIFO_MODE_BYPASS 0
+#define BMA2X2_FIFO_MODE_STREAM 2
 #define BMA_MAX_RETRY_I2C_XFER (100)
 
 #ifdef CONFIG_DOUBLE_TAP
@@ -1492,6 +1497,13 @@ struct bma2x2_data {
 	unsigned int chip_type;
 	unsigned int fifo_count;
 	unsigned char fifo_datasel;
+	struct mutex fifo_mutex;
+	struct delayed_work fifo_work;
+	unsigned int latency_ms;
+	unsigned int fifo_period_ms;
+	unsigned int flush_count;
+	ktime_t fifo_ts;
+	bool batching;
 	unsigned char mode;
 	signed char sensor_type;
 	struct input_dev *input;
@@ -4974,26 +4986,20 @@ static int bma2x2_get_sensitivity(struct bma2x2_data *bma2x2, int range)
 	return 0;
 }
 
-static int bma2x2_read_accel_xyz(struct i2c_client *client,
-		signed char sensor_type, struct bma2x2acc *acc)
+/* Convert one X/Y/Z frame, as found in the data or FIFO registers. */
+static void bma2x2_decode_frame(struct bma2x2_data *client_data,
+		const unsigned char *data, struct bma2x2acc *acc)
 {
-	int comres = 0;
-	unsigned char data[6];
-	struct bma2x2_data *client_data = i2c_get_clientdata(client);
 #ifndef BMA2X2_SENSOR_IDENTIFICATION_ENABLE
 	int bitwidth;
 #endif
-	comres = bma2x2_smbus_read_byte_block(client,
-				BMA2X2_ACC_X12_LSB__REG, data, 6);
-	if (sensor_type >= 4)
-		return -EINVAL;
 
 	acc->x = (data[1]<<8)|data[0];
 	acc->y = (data[3]<<8)|data[2];
 	acc->z = (data[5]<<8)|data[4];
 
 #ifndef BMA2X2_SENSOR_IDENTIFICATION_ENABLE
-	bitwidth = bma2x2_sensor_bitwidth[sensor_type];
+	bitwidth = bma2x2_sensor_bitwidth[client_data->sensor_type];
 
 	acc->x = (acc->x >> (16 - bitwidth));
 	acc->y = (acc->y >> (16 - bitwidth));
@@ -5001,9 +5007,40 @@ static int bma2x2_read_accel_xyz(struct i2c_client *client,
 #endif
 
 	bma2x2_remap_sensor_data(acc, client_data);
+}
+
+static int bma2x2_read_accel_xyz(struct i2c_client *client,
+		signed char sensor_type, struct bma2x2acc *acc)
+{
+	int comres = 0;
+	unsigned char data[6];
+	struct bma2x2_data *client_data = i2c_get_clientdata(client);
+
+	comres = bma2x2_smbus_read_byte_block(client,
+				BMA2X2_ACC_X12_LSB__REG, data, 6);
+	if (sensor_type >= 4)
+		return -EINVAL;
+
+	bma2x2_decode_frame(client_data, data, acc);
 	return comres;
 }
 
+static void bma2x2_report_value(struct bma2x2_data *bma2x2,
+			struct bma2x2acc *value, ktime_t ts)
+{
+	input_report_abs(bma2x2->input, ABS_X,
+			(int)value->x << bma2x2->sensitivity);
+	input_report_abs(bma2x2->input, ABS_Y,
+			(int)value->y << bma2x2->sensitivity);
+	input_report_abs(bma2x2->input, ABS_Z,
+			(int)value->z << bma2x2->sensitivity);
+	input_event(bma2x2->input, EV_SYN, SYN_TIME_SEC,
+			ktime_to_timespec(ts).tv_sec);
+	input_event(bma2x2->input, EV_SYN, SYN_TIME_NSEC,
+			ktime_to_timespec(ts).tv_nsec);
+	input_sync(bma2x2->input);
+}
+
 static void bma2x2_report_axis_data(struct bma2x2_data *bma2x2,
 			struct bma2x2acc *value)
 {
@@ -5018,17 +5055,83 @@ static void bma2x2_report_axis_data(struct bma2x2_data *bma2x2,
 			"read accel data failed! err = %d\n", err);
 		return;
 	}
-	input_report_abs(bma2x2->input, ABS_X,
-			(int)value->x << bma2x2->sensitivity);
-	input_report_abs(bma2x2->input, ABS_Y,
-			(int)value->y << bma2x2->sensitivity);
-	input_report_abs(bma2x2->input, ABS_Z,
-			(int)value->z << bma2x2->sensitivity);
-	input_event(bma2x2->input, EV_SYN, SYN_TIME_SEC,
-			ktime_to_timespec(ts).tv_sec);
-	input_event(bma2x2->input, EV_SYN, SYN_TIME_NSEC,
-			ktime_to_timespec(ts).tv_nsec);
-	input_sync(bma2x2->input);
+	bma2x2_report_value(bma2x2, value, ts);
+}
+
+/* Sample period of the current bandwidth setting. */
+static u32 bma2x2_sample_interval_us(struct bma2x2_data *bma2x2)
+{
+	unsigned char bw = BMA2X2_BW_SET;
+
+	bma2x2_get_bandwidth(bma2x2->bma2x2_client, &bw);
+	bw = clamp_t(unsigned char, bw, BMA2X2_BW_7_81HZ, BMA2X2_BW_1000HZ);
+
+	return 64000 >> (bw - BMA2X2_BW_7_81HZ);
+}
+
+/*
+ * Drain the FIFO in one burst and report its frames. The frames are given
+ * timestamps spread evenly between the previous drain and now, unless the
+ * FIFO overran, in which case they are laid out backwards from now at the
+ * nominal sample period.
+ */
+static void bma2x2_fifo_flush(struct bma2x2_data *bma2x2)
+{
+	struct i2c_client *client = bma2x2->bma2x2_client;
+	unsigned char buf[MAX_FIFO_F_LEVEL * MAX_FIFO_F_BYTES];
+	unsigned char status;
+	struct bma2x2acc value;
+	ktime_t now, start;
+	s64 step_ns;
+	int cnt, i;
+
+	mutex_lock(&bma2x2->fifo_mutex);
+	if (bma2x2_smbus_read_byte(client, BMA2X2_STATUS_FIFO_REG, &status))
+		goto exit;
+
+	cnt = BMA2X2_GET_BITSLICE(status, BMA2X2_FIFO_FRAME_COUNTER_S);
+	if (!cnt)
+		goto exit;
+
+	if (bma_i2c_burst_read(client, BMA2X2_FIFO_DATA_OUTPUT_REG, buf,
+				cnt * MAX_FIFO_F_BYTES) < 0) {
+		dev_err(&client->dev, "read fifo failed\n");
+		goto exit;
+	}
+
+	now = ktime_get();
+	if (BMA2X2_GET_BITSLICE(status, BMA2X2_FIFO_OVERRUN_S) ||
+			!ktime_to_ns(bma2x2->fifo_ts)) {
+		step_ns = (s64)bma2x2_sample_interval_us(bma2x2) *
+				NSEC_PER_USEC;
+		start = ktime_sub_ns(now, step_ns * cnt);
+	} else {
+		start = bma2x2->fifo_ts;
+		step_ns = div_s64(ktime_to_ns(ktime_sub(now, start)), cnt);
+	}
+	bma2x2->fifo_ts = now;
+
+	for (i = 0; i < cnt; i++) {
+		bma2x2_decode_frame(bma2x2, buf + i * MAX_FIFO_F_BYTES, &value);
+		bma2x2_report_value(bma2x2, &value,
+				ktime_add_ns(start, step_ns * (i + 1)));
+	}
+
+	mutex_lock(&bma2x2->value_mutex);
+	bma2x2->value = value;
+	mutex_unlock(&bma2x2->value_mutex);
+exit:
+	mutex_unlock(&bma2x2->fifo_mutex);
+}
+
+static void bma2x2_fifo_work_func(struct work_struct *work)
+{
+	struct bma2x2_data *bma2x2 = container_of((struct delayed_work *)work,
+			struct bma2x2_data, fifo_work);
+
+	bma2x2_fifo_flush(bma2x2);
+	queue_delayed_work(bma2x2->data_wq, &bma2x2->fifo_work,
+			msecs_to_jiffies(bma2x2->fifo_period_ms));
 }
 
 static void bma2x2_work_func(struct work_struct *work)
@@ -5338,11 +5441,100 @@ exit:
 	return err;
 }
 
+static int bma2x2_set_fifo_wm_int(struct bma2x2_data *bma2x2, int enable)
+{
+	struct i2c_client *client = bma2x2->bma2x2_client;
+	unsigned char data;
+	int err;
+
+	err = bma2x2_smbus_read_byte(client, BMA2X2_INT_FWM_EN_INT__REG, &data);
+	data = BMA2X2_SET_BITSLICE(data, BMA2X2_INT_FWM_EN_INT, enable);
+	err |= bma2x2_smbus_write_byte(client, BMA2X2_INT_FWM_EN_INT__REG,
+			&data);
+
+	err |= bma2x2_smbus_read_byte(client, BMA2X2_INT_DATA_SEL_REG, &data);
+	if (bma2x2->pdata->use_int2)
+		data = BMA2X2_SET_BITSLICE(data, BMA2X2_EN_INT2_PAD_FWM, enable);
+	else
+		data = BMA2X2_SET_BITSLICE(data, BMA2X2_EN_INT1_PAD_FWM, enable);
+	err |= bma2x2_smbus_write_byte(client, BMA2X2_INT_DATA_SEL_REG, &data);
+
+	return err ? -EIO : 0;
+}
+
+/*
+ * Switch the sensor to batching: samples go to the hardware FIFO and are
+ * read out in bursts, on the FIFO watermark interrupt when the new data
+ * interrupt would otherwise be used, or from a timer.
+ */
+static int bma2x2_batch_start(struct bma2x2_data *bma2x2)
+{
+	struct i2c_client *client = bma2x2->bma2x2_client;
+	u32 interval_us = bma2x2_sample_interval_us(bma2x2);
+	unsigned int frames;
+	unsigned char data;
+	int err;
+
+	frames = bma2x2->latency_ms * USEC_PER_MSEC / interval_us;
+	frames = clamp_t(unsigned int, frames, 1, BMA2X2_FIFO_WM_LEVEL);
+	bma2x2->fifo_period_ms = max_t(unsigned int,
+			frames * interval_us / USEC_PER_MSEC, 1);
+
+	/* Writing the FIFO configuration also clears the FIFO */
+	err = bma2x2_set_fifo_data_sel(client, 0);
+	err |= bma2x2_set_fifo_mode(client, BMA2X2_FIFO_MODE_STREAM);
+	if (err)
+		return -EIO;
+	bma2x2->fifo_ts = ktime_get();
+
+	if (bma2x2->pdata->int_en && BMA2x2_IS_NEWDATA_INT_ENABLED()) {
+		err = bma2x2_smbus_read_byte(client,
+				BMA2X2_FIFO_WML_TRIG_RETAIN__REG, &data);
+		data = BMA2X2_SET_BITSLICE(data, BMA2X2_FIFO_WML_TRIG_RETAIN,
+				frames);
+		err |= bma2x2_smbus_write_byte(client,
+				BMA2X2_FIFO_WML_TRIG_RETAIN__REG, &data);
+		if (err)
+			return -EIO;
+
+		err = bma2x2_config_interrupt(bma2x2, true);
+		if (err)
+			return err;
+		err = bma2x2_set_fifo_wm_int(bma2x2, 1);
+		if (err)
+			return err;
+		bma2x2_pinctrl_state(bma2x2, true);
+		enable_irq(bma2x2->IRQ);
+	} else {
+		queue_delayed_work(bma2x2->data_wq, &bma2x2->fifo_work,
+				msecs_to_jiffies(bma2x2->fifo_period_ms));
+	}
+
+	bma2x2->batching = true;
+	return 0;
+}
+
+static void bma2x2_batch_stop(struct bma2x2_data *bma2x2)
+{
+	if (bma2x2->pdata->int_en && BMA2x2_IS_NEWDATA_INT_ENABLED()) {
+		disable_irq(bma2x2->IRQ);
+		bma2x2_set_fifo_wm_int(bma2x2, 0);
+	} else {
+		cancel_delayed_work_sync(&bma2x2->fifo_work);
+	}
+
+	/* Hand over what is still buffered before the FIFO is dropped */
+	bma2x2_fifo_flush(bma2x2);
+	bma2x2_set_fifo_mode(bma2x2->bma2x2_client, BMA2X2_FIFO_MODE_BYPASS);
+	bma2x2->batching = false;
+}
+
 static void bma2x2_set_enable(struct device *dev, int enable)
 {
 	struct i2c_client *client = to_i2c_client(dev);
 	struct bma2x2_data *bma2x2 = i2c_get_clientdata(client);
 	int pre_enable = atomic_read(&bma2x2->enable);
+	bool was_batching;
 
 	mutex_lock(&bma2x2->enable_mutex);
 	if (enable) {
@@ -5357,7 +5549,13 @@ static void bma2x2_set_enable(struct device *dev, int enable)
 			}
 			bma2x2_set_mode(bma2x2->bma2x2_client,
 					BMA2X2_MODE_NORMAL);
-			if ((bma2x2->pdata->int_en) &&
+			if (bma2x2->latency_ms) {
+				if (bma2x2_batch_start(bma2x2)) {
+					dev_err(&client->dev,
+						"start batching failed\n");
+					goto mutex_exit;
+				}
+			} else if ((bma2x2->pdata->int_en) &&
 				(BMA2x2_IS_NEWDATA_INT_ENABLED())) {
 				if (bma2x2_config_interrupt(bma2x2, true)) {
 					dev_err(&client->dev,
@@ -5387,10 +5585,15 @@ static void bma2x2_set_enable(struct device *dev, int enable)
 				dev_err(dev, "set state failed\n");
 				goto mutex_exit;
 			}
+			was_batching = bma2x2->batching;
+			if (was_batching)
+				bma2x2_batch_stop(bma2x2);
 			bma2x2_set_mode(bma2x2->bma2x2_client,
 					BMA2X2_MODE_SUSPEND);
 			bma2x2_pinctrl_state(bma2x2, false);
-			if ((bma2x2->pdata->int_en) &&
+			if (was_batching) {
+				/* Interrupt or timer already stopped */
+			} else if ((bma2x2->pdata->int_en) &&
 				(BMA2x2_IS_NEWDATA_INT_ENABLED())) {
 				disable_irq(bma2x2->IRQ);
 				bma2x2_pinctrl_state(bma2x2, false);
@@ -5451,6 +5654,48 @@ static int bma2x2_cdev_enable(struct sensors_classdev *sensors_cdev,
 	return 0;
 }
 
+/*
+ * Batch when the requested latency is longer than the sampling period,
+ * like the other batching sensor drivers. The sensor is restarted to
+ * switch modes.
+ */
+static int bma2x2_cdev_set_latency(struct sensors_classdev *sensors_cdev,
+				unsigned int max_latency)
+{
+	struct bma2x2_data *data = container_of(sensors_cdev,
+					struct bma2x2_data, cdev);
+	struct device *dev = &data->bma2x2_client->dev;
+	int enabled = atomic_read(&data->enable);
+
+	if (max_latency <= atomic_read(&data->delay))
+		max_latency = 0;
+	if (max_latency > POLL_INTERVAL_MAX_MS)
+		max_latency = POLL_INTERVAL_MAX_MS;
+	if (max_latency == data->latency_ms)
+		return 0;
+
+	if (enabled)
+		bma2x2_set_enable(dev, 0);
+	data->latency_ms = max_latency;
+	if (enabled)
+		bma2x2_set_enable(dev, 1);
+
+	return 0;
+}
+
+static int bma2x2_cdev_flush(struct sensors_classdev *sensors_cdev)
+{
+	struct bma2x2_data *data = container_of(sensors_cdev,
+					struct bma2x2_data, cdev);
+
+	if (data->batching)
+		bma2x2_fifo_flush(data);
+	input_event(data->input, EV_SYN, SYN_CONFIG, data->flush_count++);
+	input_sync(data->input);
+
+	return 0;
+}
+
 static int bma2x2_is_power_enabled(struct bma2x2_data *data)
 {
 	return atomic_read(&data->enable);
@@ -6937,6 +7182,14 @@ static int bma2x2_data_ready_handle(struct bma2x2_data *bma2x2)
 		return -EIO;
 	}
 
+	if (bma2x2->batching) {
+		if (status & BMA2X2_FIFO_WM_INT_S__MSK) {
+			bma2x2_fifo_flush(bma2x2);
+			return 0;
+		}
+		return -EAGAIN;
+	}
+
 	if ((status & 0x80) == 0x80) {
 		bma2x2_read_new_data(bma2x2);
 		return 0;
@@ -7586,6 +7839,8 @@ static int bma2x2_probe(struct i2c_client *client,
 	mutex_init(&data->value_mutex);
 	mutex_init(&data->mode_mutex);
 	mutex_init(&data->enable_mutex);
+	mutex_init(&data->fifo_mutex);
+	INIT_DELAYED_WORK(&data->fifo_work, bma2x2_fifo_work_func);
 	data->bandwidth = BMA2X2_BW_SET;
 	data->range = BMA2X2_RANGE_SET;
 	data->sensitivity = bosch_sensor_range_map[0];
@@ -7849,6 +8104,9 @@ static int bma2x2_probe(struct i2c_client *client,
 	data->cdev.sensors_enable = bma2x2_cdev_enable;
 	data->cdev.sensors_poll_delay = bma2x2_cdev_poll_delay;
 	data->cdev.sensors_self_test = bma2x2_self_calibration_xyz;
+	data->cdev.sensors_set_latency = bma2x2_cdev_set_latency;
+	data->cdev.sensors_flush = bma2x2_cdev_flush;
+	data->cdev.fifo_max_event_count = MAX_FIFO_F_LEVEL;
 	data->cdev.resolution = sensor_type_map[data->chip_type].resolution;
 	if (pdata->int_en)
 		data->cdev.max_delay = BMA_INT_MAX_DELAY;
@@ -25,6 +25,8 @@
 #include <linux/gpio.h>
 #include <linux/platform_device.h>
 #include <linux/regulator/consumer.h>
+#include <linux/of.h>
+#include <linux/cpu_boost.h>
 #include <linux/input/synaptics_dsx_htc.h>
 #ifdef CONFIG_TOUCHSCREEN_SYNAPTICS_DSX_WAKEUP_GESTURE
 #include <linux/sensor_hub.h>
@@ -182,6 +184,12 @@ static ssize_t synaptics_rmi4_early_suspend_store(struct device *dev,
 		struct device_attribute *attr, const char *buf, size_t count);
 #endif
 
+static ssize_t synaptics_rmi4_latency_show(struct device *dev,
+		struct device_attribute *attr, char *buf);
+
+static ssize_t synaptics_rmi4_latency_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count);
+
 #ifdef CONFIG_TOUCHSCREEN_SYNAPTICS_DSX_WAKEUP_GESTURE
 static int facedown_status_handler_func(struct notifier_block *this,
 	unsigned long status, void *unused);
@@ -426,6 +434,9 @@ static struct device_attribute attrs[] = {
 	__ATTR(wake_gesture, (S_IRUGO | S_IWUSR),
 			synaptics_rmi4_wake_gesture_show,
 			synaptics_rmi4_wake_gesture_store),
+	__ATTR(latency, (S_IRUGO | S_IWUSR),
+			synaptics_rmi4_latency_show,
+			synaptics_rmi4_latency_store),
 };
 
 static char state2char(int status)
@@ -695,6 +706,45 @@ static ssize_t synaptics_rmi4_wake_gesture_store(struct device *dev,
 	return count;
 }
 
+static ssize_t synaptics_rmi4_latency_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct synaptics_rmi4_data *rmi4_data = dev_get_drvdata(dev);
+	static const char * const names[TOUCH_LATENCY_BUCKETS] = {
+		"<1ms", "<2ms", "<4ms", "<8ms", "<16ms", ">=16ms",
+	};
+	u64 avg = 0;
+	ssize_t count;
+	int i;
+
+	if (rmi4_data->latency_count) {
+		avg = rmi4_data->latency_total_us;
+		do_div(avg, rmi4_data->latency_count);
+	}
+
+	count = snprintf(buf, PAGE_SIZE, "count: %lu avg: %llu us max: %u us\n",
+			rmi4_data->latency_count, avg,
+			rmi4_data->latency_max_us);
+	for (i = 0; i < TOUCH_LATENCY_BUCKETS; i++)
+		count += snprintf(buf + count, PAGE_SIZE - count, "%s: %u\n",
+				names[i], rmi4_data->latency_hist[i]);
+
+	return count;
+}
+
+static ssize_t synaptics_rmi4_latency_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count)
+{
+	struct synaptics_rmi4_data *rmi4_data = dev_get_drvdata(dev);
+
+	rmi4_data->latency_count = 0;
+	rmi4_data->latency_total_us = 0;
+	rmi4_data->latency_max_us = 0;
+	memset(rmi4_data->latency_hist, 0, sizeof(rmi4_data->latency_hist));
+
+	return count;
+}
+
 static ssize_t synaptics_debug_show(struct device *dev, struct device_attribute *attr,
 	char *buf)
 {
@@ -998,7 +1048,8 @@ static ssize_t int_status_store(struct device *dev,
 		return -EINVAL;
 
 	if (value) {
-		ret = request_threaded_irq(rmi4_data->irq, NULL,
+		ret = request_threaded_irq(rmi4_data->irq,
+				synaptics_rmi4_hardirq,
 				synaptics_rmi4_irq, bdata->irq_flags,
 				PLATFORM_DRIVER_NAME, rmi4_data);
 		if (ret == 0) {
@@ -1883,6 +1934,7 @@ static int synaptics_rmi4_f12_abs_report(struct synaptics_rmi4_data *rmi4_data,
 	unsigned char detected_gestures;
 	unsigned short data_addr;
 	unsigned short glove_status = 0;
+	bool burst;
 	int x;
 	int y;
 	int z;
@@ -1923,15 +1975,36 @@ static int synaptics_rmi4_f12_abs_report(struct synaptics_rmi4_data *rmi4_data,
 		return 0;
 	}
 
-	/* Determine the total number of fingers to process */
-	if (extra_data->data15_size) {
+	/*
+	 * Data1 and Data15 are adjacent registers on most configurations, so
+	 * the finger data and the finger presence bits can be fetched in one
+	 * transfer straight into fhandler->data, which has room for both.
+	 */
+	burst = rmi4_data->burst_read && extra_data->data15_size &&
+		(extra_data->data15_offset == extra_data->data1_offset + 1);
+	if (burst) {
+		retval = synaptics_rmi4_reg_read(rmi4_data,
+				data_addr + extra_data->data1_offset,
+				(unsigned char *)fhandler->data,
+				fhandler->data_size + extra_data->data15_size);
+		if (retval < 0)
+			return 0;
+
+		memcpy(extra_data->data15_data,
+				(unsigned char *)fhandler->data +
+				fhandler->data_size,
+				extra_data->data15_size);
+	} else if (extra_data->data15_size) {
 		retval = synaptics_rmi4_reg_read(rmi4_data,
 				data_addr + extra_data->data15_offset,
 				extra_data->data15_data,
 				extra_data->data15_size);
 		if (retval < 0)
 			return 0;
+	}
 
+	/* Determine the total number of fingers to process */
+	if (extra_data->data15_size) {
 		/* Start checking from the highest bit */
 		temp = extra_data->data15_size - 1; /* Highest byte */
 		if (temp > (F12_FINGERS_TO_SUPPORT + 7) / 8)
@@ -1965,12 +2038,14 @@ static int synaptics_rmi4_f12_abs_report(struct synaptics_rmi4_data *rmi4_data,
 		return 0;
 	}
 
-	retval = synaptics_rmi4_reg_read(rmi4_data,
-			data_addr + extra_data->data1_offset,
-			(unsigned char *)fhandler->data,
-			fingers_to_process * size_of_2d_data);
-	if (retval < 0)
-		return 0;
+	if (!burst) {
+		retval = synaptics_rmi4_reg_read(rmi4_data,
+				data_addr + extra_data->data1_offset,
+				(unsigned char *)fhandler->data,
+				fingers_to_process * size_of_2d_data);
+		if (retval < 0)
+			return 0;
+	}
 
 	data = (struct synaptics_rmi4_f12_finger_data *)fhandler->data;
 
@@ -2339,6 +2414,24 @@ static void synaptics_rmi4_f54_report(struct synaptics_rmi4_data *rmi4_data)
 	wake_up(&syn_data_ready_wq);
 }
 
+/*
+ * The IRQ thread runs as SCHED_FIFO already; while fingers are down move the
+ * interrupt, and the thread with it, to the CPUs given in DT.
+ */
+static void synaptics_rmi4_irq_affinity(struct synaptics_rmi4_data *rmi4_data)
+{
+	if (!rmi4_data->irq_cpus_valid ||
+			rmi4_data->irq_on_big == rmi4_data->fingers_on_2d)
+		return;
+
+	if (rmi4_data->fingers_on_2d)
+		irq_set_affinity(rmi4_data->irq, &rmi4_data->irq_cpus);
+	else
+		irq_set_affinity(rmi4_data->irq, cpu_possible_mask);
+
+	rmi4_data->irq_on_big = rmi4_data->fingers_on_2d;
+}
+
 static void synaptics_rmi4_report_touch(struct synaptics_rmi4_data *rmi4_data,
 		struct synaptics_rmi4_fn *fhandler)
 {
@@ -2366,6 +2459,8 @@ static void synaptics_rmi4_report_touch(struct synaptics_rmi4_data *rmi4_data,
 			rmi4_data->fingers_on_2d = true;
 		else
 			rmi4_data->fingers_on_2d = false;
+
+		synaptics_rmi4_irq_affinity(rmi4_data);
 		break;
 	case SYNAPTICS_RMI4_F1A:
 		synaptics_rmi4_f1a_report(rmi4_data, fhandler);
@@ -2448,6 +2543,31 @@ static void synaptics_rmi4_sensor_report(struct synaptics_rmi4_data *rmi4_data)
 	return;
 }
 
+static void synaptics_rmi4_record_latency(struct synaptics_rmi4_data *rmi4_data)
+{
+	unsigned int us, ms;
+	int bucket;
+
+	us = ktime_to_us(ktime_sub(ktime_get(), rmi4_data->irq_time));
+	ms = us / USEC_PER_MSEC;
+	bucket = ms ? min(fls(ms), TOUCH_LATENCY_BUCKETS - 1) : 0;
+
+	rmi4_data->latency_hist[bucket]++;
+	rmi4_data->latency_count++;
+	rmi4_data->latency_total_us += us;
+	if (us > rmi4_data->latency_max_us)
+		rmi4_data->latency_max_us = us;
+}
+
+static irqreturn_t synaptics_rmi4_hardirq(int irq, void *data)
+{
+	struct synaptics_rmi4_data *rmi4_data = data;
+
+	rmi4_data->irq_time = ktime_get();
+
+	return IRQ_WAKE_THREAD;
+}
+
 static irqreturn_t synaptics_rmi4_irq(int irq, void *data)
 {
 	struct synaptics_rmi4_data *rmi4_data = data;
@@ -2461,7 +2581,15 @@ static irqreturn_t synaptics_rmi4_irq(int irq, void *data)
 	if (gpio_get_value(bdata->irq_gpio) != bdata->irq_on_state)
 		goto exit;
 
+	/*
+	 * Most likely a touch down: get the CPUs going while the report is
+	 * still being read rather than on the first input event.
+	 */
+	if (!rmi4_data->fingers_on_2d)
+		cpu_boost_kick();
+
 	synaptics_rmi4_sensor_report(rmi4_data);
+	synaptics_rmi4_record_latency(rmi4_data);
 
 	if (debug_mask & BIT(2)) {
 		getnstimeofday(&time_end);
@@ -2891,7 +3019,8 @@ static int synaptics_rmi4_f12_init(struct synaptics_rmi4_data *rmi4_data,
 
 	/* Allocate memory for finger data storage space */
 	fhandler->data_size = num_of_fingers * size_of_2d_data;
-	fhandler->data = kmalloc(fhandler->data_size, GFP_KERNEL);
+	fhandler->data = kmalloc(fhandler->data_size + extra_data->data15_size,
+			GFP_KERNEL);
 
 	if (bdata->support_cover || bdata->support_glove) {
 		extra_data->ctrl9_offset = ctrl_9_offset;
@@ -4392,8 +4521,10 @@ static int check_chip_exist(struct synaptics_rmi4_data *rmi4_data)
 
 static int synaptics_rmi4_probe(struct platform_device *pdev)
 {
-	int retval = 0, i = 0;
+	int retval = 0, i = 0, cpu;
 	unsigned char attr_count;
+	u32 irq_cpus;
+	struct device_node *np;
 	struct synaptics_rmi4_data *rmi4_data;
 	const struct synaptics_dsx_hw_interface *hw_if;
 	const struct synaptics_dsx_board_data *bdata;
@@ -4570,7 +4701,19 @@ static int synaptics_rmi4_probe(struct platform_device *pdev)
 
 	rmi4_data->irq = gpio_to_irq(bdata->irq_gpio);
 
-	retval = request_threaded_irq(rmi4_data->irq, NULL,
+	np = rmi4_data->pdev->dev.parent->of_node;
+	rmi4_data->burst_read = of_property_read_bool(np,
+			"synaptics,burst-read");
+	if (!of_property_read_u32(np, "synaptics,irq-cpus", &irq_cpus)) {
+		cpumask_clear(&rmi4_data->irq_cpus);
+		for (cpu = 0; cpu < min_t(int, nr_cpu_ids, 32); cpu++)
+			if (irq_cpus & BIT(cpu))
+				cpumask_set_cpu(cpu, &rmi4_data->irq_cpus);
+		rmi4_data->irq_cpus_valid =
+			!cpumask_empty(&rmi4_data->irq_cpus);
+	}
+
+	retval = request_threaded_irq(rmi4_data->irq, synaptics_rmi4_hardirq,
 			synaptics_rmi4_irq, bdata->irq_flags,
 			PLATFORM_DRIVER_NAME, rmi4_data);
 	if (retval < 0) {
@@ -31,6 +31,8 @@
 #ifdef CONFIG_FB
 #include <linux/notifier.h>
 #include <linux/fb.h>
+#include <linux/ktime.h>
+#include <linux/cpumask.h>
 #endif
 
 #if (LINUX_VERSION_CODE > KERNEL_VERSION(2, 6, 38))
@@ -116,6 +118,9 @@
 #define MAX_NUMBER_OF_BUTTONS 4
 #define MAX_INTR_REGISTERS 4
 
+/* Touch latency histogram buckets: <1, <2, <4, <8, <16, >=16 ms */
+#define TOUCH_LATENCY_BUCKETS 6
+
 #define MASK_16BIT 0xFFFF
 #define MASK_8BIT 0xFF
 #define MASK_7BIT 0x7F
@@ -406,6 +411,15 @@ struct synaptics_rmi4_data {
 	uint8_t glove_mode_setting[10];
 	struct synaptics_rmi4_noise_state noise_state;
 	uint8_t hall_block_touch_event;
+	bool burst_read;
+	bool irq_cpus_valid;
+	bool irq_on_big;
+	cpumask_t irq_cpus;
+	ktime_t irq_time;
+	unsigned long latency_count;
+	u64 latency_total_us;
+	unsigned int latency_max_us;
+	unsigned int latency_hist[TOUCH_LATENCY_BUCKETS];
 };
 
 struct synaptics_dsx_bus_access {
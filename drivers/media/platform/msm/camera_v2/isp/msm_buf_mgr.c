@@ -144,10 +144,8 @@ static int msm_isp_prepare_isp_buf(struct msm_isp_buf_mgr *buf_mgr,
 {
 	int i, rc = -1;
 	struct msm_isp_buffer_mapped_info *mapped_info;
-	struct buffer_cmd *buf_pending = NULL;
 	int domain_num;
 	uint32_t accu_length = 0;
-	unsigned long flags;
 
 	if (buf_mgr->secure_enable == NON_SECURE_MODE)
 		domain_num = buf_mgr->iommu_domain_num;
@@ -177,17 +175,6 @@ static int msm_isp_prepare_isp_buf(struct msm_isp_buf_mgr *buf_mgr,
 		accu_length += qbuf_buf->planes[i].length;
 		CDBG("%s: plane: %d addr:%lu\n",
 			__func__, i, (unsigned long)mapped_info->paddr);
-
-		buf_pending = kzalloc(sizeof(struct buffer_cmd), GFP_ATOMIC);
-		if (!buf_pending) {
-			pr_err("No free memory for buf_pending\n");
-			return rc;
-		}
-
-		buf_pending->mapped_info = mapped_info;
-		spin_lock_irqsave(&buf_mgr->bufq_list_lock, flags);
-		list_add_tail(&buf_pending->list, &buf_mgr->buffer_q);
-		spin_unlock_irqrestore(&buf_mgr->bufq_list_lock, flags);
 	}
 	buf_info->num_planes = qbuf_buf->num_planes;
 	return 0;
@@ -195,7 +182,7 @@ ion_map_error:
 	for (--i; i >= 0; i--) {
 		mapped_info = &buf_info->mapped_info[i];
 		ion_unmap_iommu(buf_mgr->client, mapped_info->handle,
-		buf_mgr->iommu_domain_num, 0);
+			domain_num, 0);
 		ion_free(buf_mgr->client, mapped_info->handle);
 	}
 	return rc;
@@ -203,41 +190,33 @@ ion_map_error:
 
 static void msm_isp_unprepare_v4l2_buf(
 	struct msm_isp_buf_mgr *buf_mgr,
+	struct msm_isp_bufq *bufq,
 	struct msm_isp_buffer *buf_info)
 {
 	int i;
 	struct msm_isp_buffer_mapped_info *mapped_info;
-	struct buffer_cmd *buf_pending = NULL;
 	int domain_num;
 	unsigned long flags;
+	uint8_t mapped;
 
 	if (buf_mgr->secure_enable == NON_SECURE_MODE)
 		domain_num = buf_mgr->iommu_domain_num;
 	else
 		domain_num = buf_mgr->iommu_domain_num_secure;
 
+	/* get_buf() doesn't hand the buffer out once this is cleared */
+	spin_lock_irqsave(&bufq->bufq_lock, flags);
+	mapped = buf_info->mapped;
+	buf_info->mapped = 0;
+	spin_unlock_irqrestore(&bufq->bufq_lock, flags);
+	if (!mapped)
+		return;
+
 	for (i = 0; i < buf_info->num_planes; i++) {
 		mapped_info = &buf_info->mapped_info[i];
-		spin_lock_irqsave(&buf_mgr->bufq_list_lock, flags);
-		list_for_each_entry(buf_pending, &buf_mgr->buffer_q, list) {
-			if (!buf_pending)
-				break;
-
-			if (buf_pending->mapped_info == mapped_info) {
-				list_del(&buf_pending->list);
-				kfree(buf_pending);
-				spin_unlock_irqrestore(
-					&buf_mgr->bufq_list_lock, flags);
-				ion_unmap_iommu(buf_mgr->client,
-					mapped_info->handle,
-					domain_num, 0);
-				ion_free(buf_mgr->client, mapped_info->handle);
-				spin_lock_irqsave(
-					&buf_mgr->bufq_list_lock, flags);
-				break;
-			}
-		}
-		spin_unlock_irqrestore(&buf_mgr->bufq_list_lock, flags);
+		ion_unmap_iommu(buf_mgr->client, mapped_info->handle,
+			domain_num, 0);
+		ion_free(buf_mgr->client, mapped_info->handle);
 	}
 	return;
 }
@@ -295,6 +274,7 @@ static int msm_isp_buf_prepare(struct msm_isp_buf_mgr *buf_mgr,
 	}
 	spin_lock_irqsave(&bufq->bufq_lock, flags);
 	buf_info->state = MSM_ISP_BUFFER_STATE_PREPARED;
+	buf_info->mapped = 1;
 	spin_unlock_irqrestore(&bufq->bufq_lock, flags);
 	return rc;
 }
@@ -328,7 +308,7 @@ static int msm_isp_buf_unprepare_all(struct msm_isp_buf_mgr *buf_mgr,
 				buf_mgr->vb2_ops->put_buf(buf_info->vb2_buf,
 					bufq->session_id, bufq->stream_id);
 		}
-		msm_isp_unprepare_v4l2_buf(buf_mgr, buf_info);
+		msm_isp_unprepare_v4l2_buf(buf_mgr, bufq, buf_info);
 	}
 	return 0;
 }
@@ -400,7 +380,7 @@ static int msm_isp_buf_unprepare(struct msm_isp_buf_mgr *buf_mgr,
 			buf_mgr->vb2_ops->put_buf(buf_info->vb2_buf,
 				bufq->session_id, bufq->stream_id);
 	}
-	msm_isp_unprepare_v4l2_buf(buf_mgr, buf_info);
+	msm_isp_unprepare_v4l2_buf(buf_mgr, bufq, buf_info);
 
 	return 0;
 }
@@ -410,13 +390,10 @@ static int msm_isp_get_buf(struct msm_isp_buf_mgr *buf_mgr, uint32_t id,
 	uint32_t *buf_cnt)
 {
 	int rc = -1;
-	unsigned long flags, irq_state;
+	unsigned long flags;
 	struct msm_isp_buffer *temp_buf_info;
 	struct msm_isp_bufq *bufq = NULL;
 	struct vb2_buffer *vb2_buf = NULL;
-	struct buffer_cmd *buf_pending = NULL;
-	struct msm_isp_buffer_mapped_info *mped_info_tmp1;
-	struct msm_isp_buffer_mapped_info *mped_info_tmp2;
 	bufq = msm_isp_get_bufq(buf_mgr, bufq_handle);
 	if (!bufq) {
 		pr_err("%s: Invalid bufq\n", __func__);
@@ -459,32 +436,11 @@ static int msm_isp_get_buf(struct msm_isp_buf_mgr *buf_mgr, uint32_t id,
 		list_for_each_entry(temp_buf_info, &bufq->head, list) {
 			if (temp_buf_info->state ==
 					MSM_ISP_BUFFER_STATE_QUEUED) {
-					spin_lock_irqsave(
-						&buf_mgr->bufq_list_lock,
-						irq_state);
-					list_for_each_entry(buf_pending,
-						&buf_mgr->buffer_q, list) {
-					if (!buf_pending)
-						break;
-					mped_info_tmp1 =
-						buf_pending->mapped_info;
-					mped_info_tmp2 =
-						&temp_buf_info->mapped_info[0];
-
-					if (mped_info_tmp1 == mped_info_tmp2
-						&& (mped_info_tmp1->len ==
-							mped_info_tmp2->len)
-						&& (mped_info_tmp1->paddr ==
-						mped_info_tmp2->paddr)) {
-						/* found one buf */
-						list_del(
-							&temp_buf_info->list);
-						*buf_info = temp_buf_info;
-						break;
-					}
+				if (temp_buf_info->mapped) {
+					/* found one buf */
+					list_del(&temp_buf_info->list);
+					*buf_info = temp_buf_info;
 				}
-				spin_unlock_irqrestore(
-					&buf_mgr->bufq_list_lock, irq_state);
 				break;
 			}
 		}
@@ -494,31 +450,12 @@ static int msm_isp_get_buf(struct msm_isp_buf_mgr *buf_mgr, uint32_t id,
 			bufq->session_id, bufq->stream_id);
 		if (vb2_buf) {
 			if (vb2_buf->v4l2_buf.index < bufq->num_bufs) {
-				spin_lock_irqsave(
-					&buf_mgr->bufq_list_lock, irq_state);
-				list_for_each_entry(buf_pending,
-						&buf_mgr->buffer_q, list) {
-					if (!buf_pending)
-						break;
-					mped_info_tmp1 =
-						buf_pending->mapped_info;
-					mped_info_tmp2 =
-					&bufq->bufs[vb2_buf->v4l2_buf.index]
-						.mapped_info[0];
-
-					if (mped_info_tmp1 == mped_info_tmp2
-						&& (mped_info_tmp1->len ==
-							mped_info_tmp2->len)
-						&& (mped_info_tmp1->paddr ==
-						mped_info_tmp2->paddr)) {
-						*buf_info =
+				temp_buf_info =
 					&bufq->bufs[vb2_buf->v4l2_buf.index];
-						(*buf_info)->vb2_buf = vb2_buf;
-						break;
-					}
+				if (temp_buf_info->mapped) {
+					temp_buf_info->vb2_buf = vb2_buf;
+					*buf_info = temp_buf_info;
 				}
-				spin_unlock_irqrestore(
-					&buf_mgr->bufq_list_lock, irq_state);
 			} else {
 				pr_err("%s: Incorrect buf index %d\n",
 					__func__, vb2_buf->v4l2_buf.index);
@@ -1222,7 +1159,6 @@ static int msm_isp_init_isp_buf_mgr(
 	}
 	CDBG("%s: E\n", __func__);
 
-	INIT_LIST_HEAD(&buf_mgr->buffer_q);
 	buf_mgr->num_buf_q = num_buf_q;
 	buf_mgr->bufq =
 		kzalloc(sizeof(struct msm_isp_bufq) * num_buf_q,
@@ -1393,7 +1329,6 @@ int msm_isp_create_isp_buf_mgr(
 	buf_mgr->secure_enable = NON_SECURE_MODE;
 	buf_mgr->attach_state = MSM_ISP_BUF_MGR_DETACH;
 	mutex_init(&buf_mgr->lock);
-	spin_lock_init(&buf_mgr->bufq_list_lock);
 
 	for (i = 0; i < MAX_PROTECTION_MODE; i++)
 		for (j = 0; j < MAX_IOMMU_CTX; j++)
@@ -361,6 +361,12 @@ struct msm_vfe_axi_stream {
 	enum msm_stream_memory_input_t  memory_input;
 	struct msm_isp_sw_framskip sw_skip;
 	uint8_t sw_ping_pong_bit;
+
+	/*Buffer batching, frames not read by userspace yet*/
+	uint32_t batch_size;
+	uint32_t batch_cnt; /*frames since the last batch event*/
+	uint32_t batch_num;
+	struct msm_isp_buf_batch_entry batch[MSM_ISP_BUF_BATCH_MAX];
 };
 
 struct msm_vfe_axi_composite_info {
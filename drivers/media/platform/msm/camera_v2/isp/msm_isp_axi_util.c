@@ -14,6 +14,7 @@
 #include <asm/div64.h>
 #include "msm_isp_util.h"
 #include "msm_isp_axi_util.h"
+#include <trace/events/msm_cam.h>
 //HTC_START, count sensor fps
 #include <linux/time.h>
 #define SENSOR_ISP_MAX 2
@@ -719,6 +720,8 @@ void msm_isp_notify(struct vfe_device *vfe_dev, uint32_t event_type,
 		ISP_DBG("%s: frame_src %d frame id: %u\n", __func__,
 			frame_src,
 			vfe_dev->axi_data.src_info[frame_src].frame_id);
+		trace_msm_cam_isp_sof(vfe_dev->pdev->id, frame_src,
+			vfe_dev->axi_data.src_info[frame_src].frame_id);
 	}
 		break;
 
@@ -1405,6 +1408,144 @@ buf_error:
 	return rc;
 }
 
+static void msm_isp_buf_batch_event(struct vfe_device *vfe_dev,
+	struct msm_vfe_axi_stream *stream_info,
+	struct msm_isp_buf_batch_entry *last)
+{
+	struct msm_isp_event_data buf_event;
+
+	memset(&buf_event, 0, sizeof(buf_event));
+	buf_event.frame_id = last->frame_id;
+	buf_event.timestamp.tv_sec = last->tv_sec;
+	buf_event.timestamp.tv_usec = last->tv_usec;
+	buf_event.u.buf_done.session_id = stream_info->session_id;
+	buf_event.u.buf_done.stream_id = stream_info->stream_id;
+	buf_event.u.buf_done.handle = last->handle;
+	buf_event.u.buf_done.buf_idx = last->buf_idx;
+	buf_event.u.buf_done.output_format = last->output_format;
+	msm_isp_send_event(vfe_dev, ISP_EVENT_BUF_BATCH, &buf_event);
+}
+
+/*
+ * Queue the frame of @buf_event on a batched stream, the batch event is
+ * sent once batch_size frames are queued. Returns false if the stream
+ * isn't batched, or userspace is so far behind that nothing fits, and the
+ * per frame event has to be sent.
+ */
+static bool msm_isp_buf_batch_add(struct vfe_device *vfe_dev,
+	struct msm_vfe_axi_stream *stream_info,
+	struct msm_isp_event_data *buf_event)
+{
+	struct msm_isp_buf_batch_entry entry;
+	unsigned long flags;
+	bool send = false;
+
+	entry.frame_id = buf_event->frame_id;
+	entry.handle = buf_event->u.buf_done.handle;
+	entry.buf_idx = buf_event->u.buf_done.buf_idx;
+	entry.output_format = buf_event->u.buf_done.output_format;
+	entry.tv_sec = buf_event->timestamp.tv_sec;
+	entry.tv_usec = buf_event->timestamp.tv_usec;
+
+	spin_lock_irqsave(&stream_info->lock, flags);
+	if (stream_info->batch_size <= 1 ||
+		stream_info->batch_num == MSM_ISP_BUF_BATCH_MAX) {
+		spin_unlock_irqrestore(&stream_info->lock, flags);
+		return false;
+	}
+	stream_info->batch[stream_info->batch_num++] = entry;
+	if (++stream_info->batch_cnt >= stream_info->batch_size) {
+		stream_info->batch_cnt = 0;
+		send = true;
+	}
+	spin_unlock_irqrestore(&stream_info->lock, flags);
+
+	if (send)
+		msm_isp_buf_batch_event(vfe_dev, stream_info, &entry);
+	return true;
+}
+
+/* Send the event for a partial batch, so its frames are not held back */
+static void msm_isp_buf_batch_flush(struct vfe_device *vfe_dev,
+	struct msm_vfe_axi_stream *stream_info)
+{
+	struct msm_isp_buf_batch_entry last;
+	unsigned long flags;
+	bool send = false;
+
+	spin_lock_irqsave(&stream_info->lock, flags);
+	if (stream_info->batch_cnt && stream_info->batch_num) {
+		last = stream_info->batch[stream_info->batch_num - 1];
+		send = true;
+	}
+	stream_info->batch_cnt = 0;
+	spin_unlock_irqrestore(&stream_info->lock, flags);
+
+	if (send)
+		msm_isp_buf_batch_event(vfe_dev, stream_info, &last);
+}
+
+static struct msm_vfe_axi_stream *msm_isp_get_batch_stream(
+	struct vfe_device *vfe_dev, uint32_t stream_handle)
+{
+	struct msm_vfe_axi_stream *stream_info;
+
+	if (HANDLE_TO_IDX(stream_handle) >= VFE_AXI_SRC_MAX) {
+		pr_err("%s: Invalid stream handle\n", __func__);
+		return NULL;
+	}
+	stream_info = &vfe_dev->axi_data.stream_info[
+		HANDLE_TO_IDX(stream_handle)];
+	if (stream_info->state == AVALIABLE ||
+		stream_info->stream_handle != stream_handle) {
+		pr_err("%s: Stream 0x%x not requested\n", __func__,
+			stream_handle);
+		return NULL;
+	}
+	return stream_info;
+}
+
+int msm_isp_cfg_buf_batch(struct vfe_device *vfe_dev, void *arg)
+{
+	struct msm_isp_buf_batch_cfg *cfg = arg;
+	struct msm_vfe_axi_stream *stream_info;
+	unsigned long flags;
+
+	if (cfg->batch_size > MSM_ISP_BUF_BATCH_MAX) {
+		pr_err("%s: Invalid batch size %d\n", __func__,
+			cfg->batch_size);
+		return -EINVAL;
+	}
+	stream_info = msm_isp_get_batch_stream(vfe_dev, cfg->stream_handle);
+	if (!stream_info)
+		return -EINVAL;
+
+	msm_isp_buf_batch_flush(vfe_dev, stream_info);
+	spin_lock_irqsave(&stream_info->lock, flags);
+	stream_info->batch_size = cfg->batch_size;
+	spin_unlock_irqrestore(&stream_info->lock, flags);
+	return 0;
+}
+
+int msm_isp_get_buf_batch(struct vfe_device *vfe_dev, void *arg)
+{
+	struct msm_isp_buf_batch *batch = arg;
+	struct msm_vfe_axi_stream *stream_info;
+	unsigned long flags;
+
+	stream_info = msm_isp_get_batch_stream(vfe_dev, batch->stream_handle);
+	if (!stream_info)
+		return -EINVAL;
+
+	spin_lock_irqsave(&stream_info->lock, flags);
+	batch->num_entries = stream_info->batch_num;
+	memcpy(batch->entries, stream_info->batch,
+		sizeof(stream_info->batch[0]) * stream_info->batch_num);
+	stream_info->batch_num = 0;
+	spin_unlock_irqrestore(&stream_info->lock, flags);
+	return 0;
+}
+
 static void msm_isp_process_done_buf(struct vfe_device *vfe_dev,
 	struct msm_vfe_axi_stream *stream_info, struct msm_isp_buffer *buf,
 	struct msm_isp_timestamp *ts)
@@ -1542,7 +1683,15 @@ static void msm_isp_process_done_buf(struct vfe_device *vfe_dev,
 		buf_event.u.buf_done.buf_idx = buf->buf_idx;
 		buf_event.u.buf_done.output_format =
 			stream_info->runtime_output_format;
-		if (stream_info->buf_divert &&
+		if (msm_isp_buf_batch_add(vfe_dev, stream_info, &buf_event)) {
+			if (!stream_info->buf_divert ||
+				buf_src == MSM_ISP_BUFFER_SRC_SCRATCH)
+				vfe_dev->buf_mgr->ops->buf_done(
+					vfe_dev->buf_mgr,
+					buf->bufq_handle, buf->buf_idx,
+					time_stamp, frame_id,
+					stream_info->runtime_output_format);
+		} else if (stream_info->buf_divert &&
 			buf_src != MSM_ISP_BUFFER_SRC_SCRATCH) {
 			ISP_DBG(
 				"%s: vfe_id %d send buf_divert buf-id %d bufq %x\n",
@@ -2237,6 +2386,7 @@ static int msm_isp_stop_axi_stream(struct vfe_device *vfe_dev,
 		msm_isp_deinit_stream_ping_pong_reg(vfe_dev, stream_info);
 		vfe_dev->reg_update_requested &=
 			~(BIT(SRC_TO_INTF(stream_info->stream_src)));
+		msm_isp_buf_batch_flush(vfe_dev, stream_info);
 	}
 
 	return rc;
@@ -47,6 +47,8 @@ int msm_isp_request_axi_stream(struct vfe_device *vfe_dev, void *arg);
 int msm_isp_cfg_axi_stream(struct vfe_device *vfe_dev, void *arg);
 int msm_isp_release_axi_stream(struct vfe_device *vfe_dev, void *arg);
 int msm_isp_update_axi_stream(struct vfe_device *vfe_dev, void *arg);
+int msm_isp_cfg_buf_batch(struct vfe_device *vfe_dev, void *arg);
+int msm_isp_get_buf_batch(struct vfe_device *vfe_dev, void *arg);
 void msm_isp_axi_cfg_update(struct vfe_device *vfe_dev,
 	enum msm_vfe_input_src frame_src);
 int msm_isp_axi_halt(struct vfe_device *vfe_dev,
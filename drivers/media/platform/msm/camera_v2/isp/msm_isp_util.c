@@ -849,6 +849,16 @@ static long msm_isp_ioctl_unlocked(struct v4l2_subdev *sd,
 		rc = msm_isp_update_axi_stream(vfe_dev, arg);
 		mutex_unlock(&vfe_dev->core_mutex);
 		break;
+	case VIDIOC_MSM_ISP_CFG_BUF_BATCH:
+		mutex_lock(&vfe_dev->core_mutex);
+		rc = msm_isp_cfg_buf_batch(vfe_dev, arg);
+		mutex_unlock(&vfe_dev->core_mutex);
+		break;
+	case VIDIOC_MSM_ISP_GET_BUF_BATCH:
+		mutex_lock(&vfe_dev->realtime_mutex);
+		rc = msm_isp_get_buf_batch(vfe_dev, arg);
+		mutex_unlock(&vfe_dev->realtime_mutex);
+		break;
 	case VIDIOC_MSM_ISP_SMMU_ATTACH:
 		mutex_lock(&vfe_dev->core_mutex);
 		rc = msm_isp_smmu_attach(vfe_dev->buf_mgr, arg);
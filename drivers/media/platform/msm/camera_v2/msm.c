@@ -29,6 +29,8 @@
 #include "msm_vb2.h"
 #include "msm_sd.h"
 #include <media/msmb_generic_buf_mgr.h>
+#define CREATE_TRACE_POINTS
+#include <trace/events/msm_cam.h>
 
 
 static struct v4l2_device *msm_v4l2_dev;
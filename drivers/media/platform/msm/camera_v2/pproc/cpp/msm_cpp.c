@@ -80,6 +80,7 @@ static int msm_cpp_buffer_ops(struct cpp_device *cpp_dev,
 	uint32_t buff_mgr_ops, struct msm_buf_mngr_info *buff_mgr_info);
 static int msm_cpp_send_frame_to_hardware(struct cpp_device *cpp_dev,
 	struct msm_queue_cmd *frame_qcmd);
+static void msm_cpp_send_pending_frames(struct cpp_device *cpp_dev);
 static int msm_cpp_send_command_to_hardware(struct cpp_device *cpp_dev,
 	uint32_t *cmd_msg, uint32_t payload_size);
 
@@ -355,6 +356,19 @@ static void msm_cpp_timer_queue_update(struct cpp_device *cpp_dev)
 	}
 }
 
+/* A slot of the microcontroller queue is free, feed it from process context */
+static void msm_cpp_kick_pending(struct cpp_device *cpp_dev)
+{
+	uint32_t prio;
+
+	for (prio = 0; prio < CPP_PRIO_MAX; prio++) {
+		if (cpp_dev->pending_q[prio].len) {
+			queue_work(cpp_dev->timer_wq, &cpp_dev->pending_work);
+			break;
+		}
+	}
+}
+
 static uint32_t msm_cpp_read(void __iomem *cpp_base)
 {
 	uint32_t tmp, retry = 0;
@@ -834,12 +848,14 @@ void msm_cpp_do_tasklet(unsigned long data)
 					CPP_DBG("delete timer.\n");
 					msm_cpp_timer_queue_update(cpp_dev);
 					msm_cpp_notify_frame_done(cpp_dev, 0);
+					msm_cpp_kick_pending(cpp_dev);
 				} else if (msg_id ==
 					MSM_CPP_MSG_ID_FRAME_NACK) {
 					pr_err("NACK error from hw!!\n");
 					CPP_DBG("delete timer.\n");
 					msm_cpp_timer_queue_update(cpp_dev);
 					msm_cpp_notify_frame_done(cpp_dev, 0);
+					msm_cpp_kick_pending(cpp_dev);
 				}
 				i += cmd_len + 2;
 			}
@@ -1424,6 +1440,9 @@ static int cpp_close_node(struct v4l2_subdev *sd, struct v4l2_subdev_fh *fh)
 		}
 		cpp_deinit_mem(cpp_dev);
 		msm_cpp_empty_list(processing_q, list_frame);
+		for (i = 0; i < CPP_PRIO_MAX; i++)
+			msm_cpp_empty_list((&cpp_dev->pending_q[i]),
+				list_frame);
 		msm_cpp_empty_list(eventData_q, list_eventdata);
 		cpp_dev->state = CPP_STATE_OFF;
 	}
@@ -1654,6 +1673,7 @@ static void msm_cpp_do_timeout_work(struct work_struct *work)
 		for (i = 0; i < MAX_CPP_PROCESSING_FRAME; i++)
 			cpp_timer.data.processed_frame[i] = NULL;
 		cpp_dev->timeout_trial_cnt = 0;
+		msm_cpp_send_pending_frames(cpp_dev);
 		goto end;
 	}
 
@@ -1735,15 +1755,19 @@ static int msm_cpp_send_frame_to_hardware(struct cpp_device *cpp_dev,
 		queue_len = cpp_dev->processing_q.len;
 		spin_unlock_irqrestore(&cpp_timer.data.processed_frame_lock,
 			flags);
-		if (queue_len == 1) {
+		/*
+		 * The timer runs for the oldest frame only, the frame done
+		 * of that one restarts it for the next in the queue.
+		 */
+		if (queue_len == 1 || !atomic_read(&cpp_timer.used)) {
 			atomic_set(&cpp_timer.used, 1);
+			CPP_DBG("Starting timer to fire in %d ms. (jiffies=%lu)\n",
+				CPP_CMD_TIMEOUT_MS, jiffies);
+			ret = mod_timer(&cpp_timer.cpp_timer,
+				jiffies + msecs_to_jiffies(CPP_CMD_TIMEOUT_MS));
+			if (ret)
+				CPP_DBG("Timer has not expired yet\n");
 		}
-		CPP_DBG("Starting timer to fire in %d ms. (jiffies=%lu)\n",
-			CPP_CMD_TIMEOUT_MS, jiffies);
-		ret = mod_timer(&cpp_timer.cpp_timer,
-			jiffies + msecs_to_jiffies(CPP_CMD_TIMEOUT_MS));
-		if (ret)
-			CPP_DBG("Timer has not expired yet\n");
 
 		msm_cpp_write(0x6, cpp_dev->base);
 		/* send top level and plane level */
@@ -1775,6 +1799,63 @@ static int msm_cpp_send_frame_to_hardware(struct cpp_device *cpp_dev,
 	return rc;
 }
 
+static struct msm_device_queue *msm_cpp_get_pending_queue(
+	struct cpp_device *cpp_dev, struct msm_cpp_frame_info_t *frame)
+{
+	if (frame->frame_type == MSM_CPP_REALTIME_FRAME)
+		return &cpp_dev->pending_q[CPP_PRIO_REALTIME];
+	return &cpp_dev->pending_q[CPP_PRIO_OFFLINE];
+}
+
+/* Called with cpp_dev->mutex held */
+static void msm_cpp_send_pending_frames(struct cpp_device *cpp_dev)
+{
+	struct msm_queue_cmd *frame_qcmd;
+	uint32_t prio;
+
+	while (cpp_dev->processing_q.len < MAX_CPP_PROCESSING_FRAME) {
+		frame_qcmd = NULL;
+		for (prio = 0; prio < CPP_PRIO_MAX && !frame_qcmd; prio++)
+			frame_qcmd = msm_dequeue(&cpp_dev->pending_q[prio],
+				list_frame);
+		if (!frame_qcmd)
+			break;
+		msm_cpp_send_frame_to_hardware(cpp_dev, frame_qcmd);
+	}
+}
+
+static void msm_cpp_do_pending_work(struct work_struct *work)
+{
+	struct cpp_device *cpp_dev =
+		container_of(work, struct cpp_device, pending_work);
+
+	mutex_lock(&cpp_dev->mutex);
+	if (cpp_dev->state == CPP_STATE_ACTIVE)
+		msm_cpp_send_pending_frames(cpp_dev);
+	mutex_unlock(&cpp_dev->mutex);
+}
+
+/*
+ * Frames wait in the pending queue of their priority while the
+ * microcontroller queue is full, so the frames of one stream don't get
+ * dropped because those of another are in flight.
+ */
+static int msm_cpp_queue_frame(struct cpp_device *cpp_dev,
+	struct msm_queue_cmd *frame_qcmd)
+{
+	struct msm_device_queue *queue =
+		msm_cpp_get_pending_queue(cpp_dev, frame_qcmd->command);
+
+	if (queue->len >= MAX_CPP_PENDING_FRAME) {
+		pr_err("%s queue full. drop frame\n", queue->name);
+		return -EAGAIN;
+	}
+
+	msm_enqueue(queue, &frame_qcmd->list_frame);
+	msm_cpp_send_pending_frames(cpp_dev);
+	return 0;
+}
+
 static int msm_cpp_send_command_to_hardware(struct cpp_device *cpp_dev,
 	uint32_t *cmd_msg, uint32_t payload_size)
 {
@@ -2170,7 +2251,7 @@ static int msm_cpp_cfg_frame(struct cpp_device *cpp_dev,
 
 	atomic_set(&frame_qcmd->on_heap, 1);
 	frame_qcmd->command = new_frame;
-	rc = msm_cpp_send_frame_to_hardware(cpp_dev, frame_qcmd);
+	rc = msm_cpp_queue_frame(cpp_dev, frame_qcmd);
 	if (rc < 0) {
 		pr_err("%s: error cannot send frame to hardware\n", __func__);
 		rc = -EINVAL;
@@ -2215,15 +2296,13 @@ static int msm_cpp_cfg(struct cpp_device *cpp_dev,
 	return rc;
 }
 
-void msm_cpp_clean_queue(struct cpp_device *cpp_dev)
+static void msm_cpp_free_frame_queue(struct msm_device_queue *queue)
 {
 	struct msm_queue_cmd *frame_qcmd = NULL;
 	struct msm_cpp_frame_info_t *processed_frame = NULL;
-	struct msm_device_queue *queue = NULL;
 
-	while (cpp_dev->processing_q.len) {
-		pr_info("queue len:%d\n", cpp_dev->processing_q.len);
-		queue = &cpp_dev->processing_q;
+	while (queue->len) {
+		pr_info("%s queue len:%d\n", queue->name, queue->len);
 		frame_qcmd = msm_dequeue(queue, list_frame);
 		if (frame_qcmd) {
 			processed_frame = frame_qcmd->command;
@@ -2235,6 +2314,15 @@ void msm_cpp_clean_queue(struct cpp_device *cpp_dev)
 	}
 }
 
+void msm_cpp_clean_queue(struct cpp_device *cpp_dev)
+{
+	uint32_t prio;
+
+	msm_cpp_free_frame_queue(&cpp_dev->processing_q);
+	for (prio = 0; prio < CPP_PRIO_MAX; prio++)
+		msm_cpp_free_frame_queue(&cpp_dev->pending_q[prio]);
+}
+
 #ifdef CONFIG_COMPAT
 static int msm_cpp_copy_from_ioctl_ptr(void *dst_ptr,
 	struct msm_camera_v4l2_ioctl_t *ioctl_ptr)
@@ -3616,6 +3704,10 @@ static int cpp_probe(struct platform_device *pdev)
 
 	msm_queue_init(&cpp_dev->eventData_q, "eventdata");
 	msm_queue_init(&cpp_dev->processing_q, "frame");
+	msm_queue_init(&cpp_dev->pending_q[CPP_PRIO_REALTIME], "pending_rt");
+	msm_queue_init(&cpp_dev->pending_q[CPP_PRIO_OFFLINE],
+		"pending_offline");
+	INIT_WORK(&cpp_dev->pending_work, msm_cpp_do_pending_work);
 	INIT_LIST_HEAD(&cpp_dev->tasklet_q);
 	tasklet_init(&cpp_dev->cpp_tasklet, msm_cpp_do_tasklet,
 		(unsigned long)cpp_dev);
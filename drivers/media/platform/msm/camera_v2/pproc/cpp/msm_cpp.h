@@ -38,6 +38,7 @@
 
 #define MAX_ACTIVE_CPP_INSTANCE 8
 #define MAX_CPP_PROCESSING_FRAME 2
+#define MAX_CPP_PENDING_FRAME 8
 #define MAX_CPP_V4l2_EVENTS 30
 
 #define MSM_CPP_MICRO_BASE          0x4000
@@ -170,6 +171,12 @@ struct msm_cpp_buff_queue_info_t {
 	struct list_head native_buff_head;
 };
 
+enum msm_cpp_frame_prio {
+	CPP_PRIO_REALTIME,
+	CPP_PRIO_OFFLINE,
+	CPP_PRIO_MAX,
+};
+
 struct msm_cpp_work_t {
 	struct work_struct my_work;
 	struct cpp_device *cpp_dev;
@@ -230,6 +237,13 @@ struct cpp_device {
 	 */
 	struct msm_device_queue processing_q;
 
+	/* Pending Queue
+	 * frames waiting for a free slot in the microcontroller queue,
+	 * realtime streams are sent ahead of offline ones
+	 */
+	struct msm_device_queue pending_q[CPP_PRIO_MAX];
+	struct work_struct pending_work;
+
 	struct msm_cpp_buff_queue_info_t *buff_queue;
 	uint32_t num_buffq;
 	struct v4l2_subdev *buf_mgr_subdev;
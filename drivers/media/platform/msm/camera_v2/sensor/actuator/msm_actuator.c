@@ -16,6 +16,7 @@
 #include "msm_sd.h"
 #include "msm_actuator.h"
 #include "msm_cci.h"
+#include <trace/events/msm_cam.h>
 
 DEFINE_MSM_MUTEX(msm_actuator_mutex);
 
@@ -2150,7 +2151,9 @@ static int32_t msm_actuator_config(struct msm_actuator_ctrl_t *a_ctrl,
 		break;
 /*HTC_END, HTC_VCM*/
 	case CFG_ACTUATOR_INIT:
+		trace_msm_cam_stage_start("actuator_init", a_ctrl->subdev_id);
 		rc = msm_actuator_init(a_ctrl);
+		trace_msm_cam_stage_end("actuator_init", a_ctrl->subdev_id);
 		if (rc < 0)
 			pr_err("msm_actuator_init failed %d\n", rc);
 		break;
@@ -2199,7 +2202,10 @@ static int32_t msm_actuator_config(struct msm_actuator_ctrl_t *a_ctrl,
 		break;
 
 	case CFG_ACTUATOR_POWERUP:
+		trace_msm_cam_stage_start("actuator_power_up",
+			a_ctrl->subdev_id);
 		rc = msm_actuator_power_up(a_ctrl);
+		trace_msm_cam_stage_end("actuator_power_up", a_ctrl->subdev_id);
 		if (rc < 0)
 			pr_err("Failed actuator power up%d\n", rc);
 		break;
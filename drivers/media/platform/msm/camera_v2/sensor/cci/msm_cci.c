@@ -22,6 +22,7 @@
 #include "msm_cci.h"
 #include "msm_cam_cci_hwreg.h"
 #include "msm_camera_io_util.h"
+#include <trace/events/msm_cam.h>
 
 #define V4L2_IDENT_CCI 50005
 #define CCI_I2C_QUEUE_0_SIZE 64
@@ -326,6 +327,55 @@ static int32_t msm_cci_data_queue(struct cci_device *cci_dev,
 	return rc;
 }
 
+/* Queue all the sequential writes of a table in one CCI transaction */
+static int32_t msm_cci_seq_table_queue(struct cci_device *cci_dev,
+	struct msm_camera_cci_ctrl *c_ctrl, enum cci_i2c_queue_t queue)
+{
+	struct msm_camera_i2c_seq_reg_setting *seq_cfg =
+		&c_ctrl->cfg.cci_i2c_write_seq_cfg;
+	struct msm_camera_i2c_seq_reg_array *seq = seq_cfg->reg_setting;
+	struct msm_camera_i2c_reg_array *reg_array;
+	struct msm_camera_cci_ctrl seq_ctrl;
+	uint16_t i, j;
+	int32_t rc = 0;
+
+	if (seq == NULL) {
+		pr_err("%s:%d Failed line\n", __func__, __LINE__);
+		return -EINVAL;
+	}
+
+	reg_array = kzalloc(I2C_SEQ_REG_DATA_MAX *
+		sizeof(struct msm_camera_i2c_reg_array), GFP_KERNEL);
+	if (!reg_array) {
+		pr_err("%s:%d no memory\n", __func__, __LINE__);
+		return -ENOMEM;
+	}
+
+	seq_ctrl.cmd = MSM_CCI_I2C_WRITE_SEQ;
+	seq_ctrl.cci_info = c_ctrl->cci_info;
+	seq_ctrl.cfg.cci_i2c_write_cfg.reg_setting = reg_array;
+	seq_ctrl.cfg.cci_i2c_write_cfg.addr_type = seq_cfg->addr_type;
+	seq_ctrl.cfg.cci_i2c_write_cfg.data_type = MSM_CAMERA_I2C_BYTE_DATA;
+
+	for (i = 0; i < seq_cfg->size; i++, seq++) {
+		if (seq->reg_data_size > I2C_SEQ_REG_DATA_MAX) {
+			pr_err("%s:%d Failed line\n", __func__, __LINE__);
+			rc = -EINVAL;
+			break;
+		}
+		reg_array[0].reg_addr = seq->reg_addr;
+		for (j = 0; j < seq->reg_data_size; j++)
+			reg_array[j].reg_data = seq->reg_data[j];
+		seq_ctrl.cfg.cci_i2c_write_cfg.size = seq->reg_data_size;
+		rc = msm_cci_data_queue(cci_dev, &seq_ctrl, queue);
+		if (rc < 0)
+			break;
+	}
+
+	kfree(reg_array);
+	return rc;
+}
+
 static int32_t msm_cci_write_i2c_queue(struct cci_device *cci_dev,
 	uint32_t val,
 	enum cci_i2c_master_t master,
@@ -634,7 +684,10 @@ static int32_t msm_cci_i2c_write(struct v4l2_subdev *sd,
 		goto ERROR;
 	}
 
-	rc = msm_cci_data_queue(cci_dev, c_ctrl, queue);
+	if (c_ctrl->cmd == MSM_CCI_I2C_WRITE_SEQ_TABLE)
+		rc = msm_cci_seq_table_queue(cci_dev, c_ctrl, queue);
+	else
+		rc = msm_cci_data_queue(cci_dev, c_ctrl, queue);
 	if (rc < 0) {
 		CDBG("%s failed line %d\n", __func__, __LINE__);
 		goto ERROR;
@@ -685,6 +738,10 @@ static int32_t msm_cci_i2c_write(struct v4l2_subdev *sd,
 
 ERROR:
 	mutex_unlock(&cci_dev->cci_master_info[master].mutex);
+	trace_msm_cam_cci_write(master, c_ctrl->cci_info->sid,
+		c_ctrl->cmd == MSM_CCI_I2C_WRITE_SEQ_TABLE ?
+		c_ctrl->cfg.cci_i2c_write_seq_cfg.size :
+		c_ctrl->cfg.cci_i2c_write_cfg.size, rc);
 	return rc;
 }
 
@@ -999,6 +1056,7 @@ static int32_t msm_cci_config(struct v4l2_subdev *sd,
 		break;
 	case MSM_CCI_I2C_WRITE:
 	case MSM_CCI_I2C_WRITE_SEQ:
+	case MSM_CCI_I2C_WRITE_SEQ_TABLE:
 		rc = msm_cci_i2c_write(sd, cci_ctrl);
 		break;
 	case MSM_CCI_GPIO_WRITE:
@@ -64,6 +64,7 @@ enum msm_cci_cmd_type {
 	MSM_CCI_I2C_WRITE,
 	MSM_CCI_I2C_WRITE_SEQ,
 	MSM_CCI_GPIO_WRITE,
+	MSM_CCI_I2C_WRITE_SEQ_TABLE,
 };
 
 struct msm_camera_cci_wait_sync_cfg {
@@ -96,6 +97,7 @@ struct msm_camera_cci_ctrl {
 	enum msm_cci_cmd_type cmd;
 	union {
 		struct msm_camera_i2c_reg_setting cci_i2c_write_cfg;
+		struct msm_camera_i2c_seq_reg_setting cci_i2c_write_seq_cfg;
 		struct msm_camera_cci_i2c_read_cfg cci_i2c_read_cfg;
 		struct msm_camera_cci_wait_sync_cfg cci_wait_sync_cfg;
 		struct msm_camera_cci_gpio_cfg gpio_cfg;
@@ -230,10 +230,8 @@ int32_t msm_camera_cci_i2c_write_seq_table(
 	struct msm_camera_i2c_client *client,
 	struct msm_camera_i2c_seq_reg_setting *write_setting)
 {
-	int i;
 	int32_t rc = -EFAULT;
-	struct msm_camera_i2c_seq_reg_array *reg_setting;
-	uint16_t client_addr_type;
+	struct msm_camera_cci_ctrl cci_ctrl;
 
 	if (!client || !write_setting)
 		return rc;
@@ -245,30 +243,25 @@ int32_t msm_camera_cci_i2c_write_seq_table(
 		return rc;
 	}
 
-	reg_setting = write_setting->reg_setting;
-	client_addr_type = client->addr_type;
-	client->addr_type = write_setting->addr_type;
-
-	if (reg_setting->reg_data_size > I2C_SEQ_REG_DATA_MAX) {
-		pr_err("%s: number of bytes %u exceeding the max supported %d\n",
-		__func__, reg_setting->reg_data_size, I2C_SEQ_REG_DATA_MAX);
+	/* The whole table is written in a single CCI transaction */
+	cci_ctrl.cmd = MSM_CCI_I2C_WRITE_SEQ_TABLE;
+	cci_ctrl.cci_info = client->cci_client;
+	cci_ctrl.cfg.cci_i2c_write_seq_cfg = *write_setting;
+	rc = v4l2_subdev_call(client->cci_client->cci_subdev,
+			core, ioctl, VIDIOC_MSM_CCI_CFG, &cci_ctrl);
+	if (rc < 0) {
+		pr_err("%s: line %d rc = %d\n", __func__, __LINE__, rc);
 		return rc;
 	}
-
-	for (i = 0; i < write_setting->size; i++) {
-		rc = msm_camera_cci_i2c_write_seq(client, reg_setting->reg_addr,
-			reg_setting->reg_data, reg_setting->reg_data_size);
-		if (rc < 0)
-			return rc;
-		reg_setting++;
-	}
+	rc = cci_ctrl.status;
+	if (rc < 0)
+		return rc;
 	if (write_setting->delay > 20)
 		msleep(write_setting->delay);
 	else if (write_setting->delay)
 		usleep_range(write_setting->delay * 1000, (write_setting->delay
 			* 1000) + 1000);
 
-	client->addr_type = client_addr_type;
 	return rc;
 }
 
@@ -312,25 +305,35 @@ int32_t msm_camera_cci_i2c_write_table_w_microdelay_htc(
 {
 	int32_t rc = -EFAULT;
 	int i;
-	struct msm_camera_i2c_seq_reg_array reg_setting;
+	struct msm_camera_i2c_seq_reg_setting seq_setting;
+	struct msm_camera_i2c_seq_reg_array *reg_setting;
 
 	if (!client || !write_setting)
 		return rc;
 
 	if (client->addr_type == MSM_CAMERA_I2C_WORD_ADDR && write_setting->data_type == MSM_CAMERA_I2C_DWORD_DATA) {
+		reg_setting = kzalloc(write_setting->size *
+			sizeof(struct msm_camera_i2c_seq_reg_array), GFP_KERNEL);
+		if (!reg_setting) {
+			pr_err("%s:%d no memory\n", __func__, __LINE__);
+			return -ENOMEM;
+		}
 		for (i=0; i<write_setting->size; i++) {
-			reg_setting.reg_addr = write_setting->reg_setting[i].reg_addr;
-			reg_setting.reg_data[0] = 0;
-			reg_setting.reg_data[1] = 0;
-			reg_setting.reg_data[2] = (uint8_t)((write_setting->reg_setting[i].reg_data & 0xFF00) >> 8);
-			reg_setting.reg_data[3] = (uint8_t)(write_setting->reg_setting[i].reg_data & 0x00FF);
-			reg_setting.reg_data_size = 4;
-			rc = msm_camera_cci_i2c_write_seq(client, reg_setting.reg_addr, reg_setting.reg_data, reg_setting.reg_data_size);
-			if (rc < 0) {
-				pr_err("i2c write sequence error:%d\n", rc);
-				return rc;
-			}
+			reg_setting[i].reg_addr = write_setting->reg_setting[i].reg_addr;
+			reg_setting[i].reg_data[0] = 0;
+			reg_setting[i].reg_data[1] = 0;
+			reg_setting[i].reg_data[2] = (uint8_t)((write_setting->reg_setting[i].reg_data & 0xFF00) >> 8);
+			reg_setting[i].reg_data[3] = (uint8_t)(write_setting->reg_setting[i].reg_data & 0x00FF);
+			reg_setting[i].reg_data_size = 4;
 		}
+		seq_setting.reg_setting = reg_setting;
+		seq_setting.size = write_setting->size;
+		seq_setting.addr_type = client->addr_type;
+		seq_setting.delay = 0;
+		rc = msm_camera_cci_i2c_write_seq_table(client, &seq_setting);
+		if (rc < 0)
+			pr_err("i2c write sequence error:%d\n", rc);
+		kfree(reg_setting);
 		return rc;
 	} else {
 		rc = msm_camera_cci_i2c_write_table_w_microdelay(client, write_setting);
@@ -17,6 +17,7 @@
 #include "msm_camera_i2c_mux.h"
 #include <linux/regulator/rpm-smd-regulator.h>
 #include <linux/regulator/consumer.h>
+#include <trace/events/msm_cam.h>
 /*HTC_START*/
 #ifdef CONFIG_OIS_CALIBRATION
 #include "lc898123F40_htc.h"
@@ -994,7 +995,10 @@ int msm_sensor_config32(struct msm_sensor_ctrl_t *s_ctrl,
 			if (s_ctrl->sensordata->misc_regulator)
 				msm_sensor_misc_regulator(s_ctrl, 1);
 
+			trace_msm_cam_stage_start("sensor_power_up",
+				s_ctrl->id);
 			rc = s_ctrl->func_tbl->sensor_power_up(s_ctrl);
+			trace_msm_cam_stage_end("sensor_power_up", s_ctrl->id);
 			if (rc < 0) {
 				pr_err("%s:%d failed rc %d\n", __func__,
 					__LINE__, rc);
@@ -1423,7 +1427,10 @@ int msm_sensor_config(struct msm_sensor_ctrl_t *s_ctrl, void __user *argp)
 			if (s_ctrl->sensordata->misc_regulator)
 				msm_sensor_misc_regulator(s_ctrl, 1);
 
+			trace_msm_cam_stage_start("sensor_power_up",
+				s_ctrl->id);
 			rc = s_ctrl->func_tbl->sensor_power_up(s_ctrl);
+			trace_msm_cam_stage_end("sensor_power_up", s_ctrl->id);
 			if (rc < 0) {
 				pr_err("%s:%d failed rc %d\n", __func__,
 					__LINE__, rc);
@@ -16,6 +16,7 @@
 #include "msm_sd.h"
 #include "msm_ois.h"
 #include "msm_cci.h"
+#include <trace/events/msm_cam.h>
 
 DEFINE_MSM_MUTEX(msm_ois_mutex);
 /*#define MSM_OIS_DEBUG*/
@@ -260,7 +261,9 @@ static int32_t msm_ois_config(struct msm_ois_ctrl_t *o_ctrl,
 	CDBG("%s type %d\n", __func__, cdata->cfgtype);
 	switch (cdata->cfgtype) {
 	case CFG_OIS_INIT:
+		trace_msm_cam_stage_start("ois_init", o_ctrl->subdev_id);
 		rc = msm_ois_init(o_ctrl);
+		trace_msm_cam_stage_end("ois_init", o_ctrl->subdev_id);
 		if (rc < 0)
 			pr_err("msm_ois_init failed %d\n", rc);
 		break;
@@ -270,7 +273,9 @@ static int32_t msm_ois_config(struct msm_ois_ctrl_t *o_ctrl,
 			pr_err("msm_ois_power_down failed %d\n", rc);
 		break;
 	case CFG_OIS_POWERUP:
+		trace_msm_cam_stage_start("ois_power_up", o_ctrl->subdev_id);
 		rc = msm_ois_power_up(o_ctrl);
+		trace_msm_cam_stage_end("ois_power_up", o_ctrl->subdev_id);
 		if (rc < 0)
 			pr_err("Failed ois power up%d\n", rc);
 		break;
@@ -43,6 +43,8 @@ void *htc_msm_smem_new_client(enum smem_type mtype,
                         client->clnt_alloc = clnt_alloc;
                         client->res = res;
                         client->inst = NULL;
+                        mutex_init(&client->map_lock);
+                        INIT_LIST_HEAD(&client->map_cache);
                 }
         } else {
                 if (clnt_alloc == NULL) {
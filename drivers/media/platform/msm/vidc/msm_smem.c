@@ -32,6 +32,101 @@ struct smem_client {
 #endif
 /* HTC_END */
 
+/*
+ * Imported buffers stay mapped in the IOMMU after the client lets go of
+ * them, so a buffer that comes back (output buffers in dynamic mode,
+ * buffers requeued after a seek or a reconfig) is not mapped again.
+ * Entries are refcounted by the msm_smem that use them, up to
+ * SMEM_MAP_CACHE_UNUSED unused entries are kept and the rest are
+ * unmapped oldest first. Everything goes when the client is deleted,
+ * at the end of the session.
+ */
+#define SMEM_MAP_CACHE_UNUSED 16
+
+struct smem_map_entry {
+	struct list_head list;
+	struct ion_handle *hndl;
+	enum hal_buffer buffer_type;
+	unsigned long flags;
+	ion_phys_addr_t iova;
+	unsigned long size;
+	int refcount;
+};
+
+static void put_device_address(struct smem_client *smem_client,
+	struct ion_handle *hndl, int domain_num, int partition_num, u32 flags);
+
+static struct smem_map_entry *smem_map_cache_find(struct smem_client *client,
+		struct ion_handle *hndl, enum hal_buffer buffer_type)
+{
+	struct smem_map_entry *e;
+
+	list_for_each_entry(e, &client->map_cache, list)
+		if (e->hndl == hndl && e->buffer_type == buffer_type)
+			return e;
+	return NULL;
+}
+
+/* Called with the map lock held */
+static void smem_map_entry_release(struct smem_client *client,
+		struct smem_map_entry *e)
+{
+	int domain, partition;
+
+	list_del(&e->list);
+	if (!msm_smem_get_domain_partition(client, e->flags,
+			e->buffer_type, &domain, &partition))
+		put_device_address(client, e->hndl, domain, partition,
+			e->flags);
+	ion_free(client->clnt, e->hndl);
+	kfree(e);
+}
+
+/* Drops a user of @mem, false if the buffer isn't in the cache */
+static bool smem_map_cache_put(struct smem_client *client,
+		struct msm_smem *mem)
+{
+	struct smem_map_entry *e, *tmp;
+
+	mutex_lock(&client->map_lock);
+	e = smem_map_cache_find(client, mem->smem_priv, mem->buffer_type);
+	if (!e) {
+		mutex_unlock(&client->map_lock);
+		return false;
+	}
+
+	if (--e->refcount == 0) {
+		list_move_tail(&e->list, &client->map_cache);
+		client->map_unused++;
+	}
+
+	list_for_each_entry_safe(e, tmp, &client->map_cache, list) {
+		if (client->map_unused <= SMEM_MAP_CACHE_UNUSED)
+			break;
+		if (e->refcount)
+			continue;
+		client->map_unused--;
+		smem_map_entry_release(client, e);
+	}
+	mutex_unlock(&client->map_lock);
+	return true;
+}
+
+static void smem_map_cache_flush(struct smem_client *client)
+{
+	struct smem_map_entry *e, *tmp;
+
+	mutex_lock(&client->map_lock);
+	list_for_each_entry_safe(e, tmp, &client->map_cache, list) {
+		if (e->refcount)
+			dprintk(VIDC_WARN, "%s: buffer %pK still in use\n",
+				__func__, e->hndl);
+		smem_map_entry_release(client, e);
+	}
+	client->map_unused = 0;
+	mutex_unlock(&client->map_lock);
+}
+
 static int get_device_address(struct smem_client *smem_client,
 		struct ion_handle *hndl, unsigned long align,
 		ion_phys_addr_t *iova, unsigned long *buffer_size,
@@ -125,6 +220,7 @@ static int ion_user_to_kernel(struct smem_client *client, int fd, u32 offset,
 	unsigned long buffer_size = 0;
 	int rc = 0;
 	unsigned long align = SZ_4K;
+	struct smem_map_entry *entry = NULL;
 
 	hndl = ion_import_dma_buf(client->clnt, fd);
 	if (IS_ERR_OR_NULL(hndl)) {
@@ -134,6 +230,35 @@ static int ion_user_to_kernel(struct smem_client *client, int fd, u32 offset,
 		goto fail_import_fd;
 	}
 	mem->kvaddr = NULL;
+
+	mutex_lock(&client->map_lock);
+	entry = smem_map_cache_find(client, hndl, buffer_type);
+	if (entry) {
+		if (entry->refcount++ == 0)
+			client->map_unused--;
+		list_move_tail(&entry->list, &client->map_cache);
+		mutex_unlock(&client->map_lock);
+
+		/* The entry holds the reference of the first import */
+		ion_free(client->clnt, hndl);
+		mem->mem_type = client->mem_type;
+		mem->smem_priv = hndl;
+		mem->flags = entry->flags;
+		mem->buffer_type = buffer_type;
+		mem->device_addr = entry->iova;
+		mem->size = entry->size;
+		dprintk(VIDC_DBG,
+			"%s: cached ion_handle = 0x%pK, fd = %d, device_addr = 0x%pa\n",
+			__func__, hndl, fd, &mem->device_addr);
+		return 0;
+	}
+	mutex_unlock(&client->map_lock);
+
+	entry = kzalloc(sizeof(*entry), GFP_KERNEL);
+	if (!entry) {
+		rc = -ENOMEM;
+		goto fail_device_address;
+	}
 	rc = ion_handle_get_flags(client->clnt, hndl, &mem->flags);
 	if (rc) {
 		dprintk(VIDC_ERR, "Failed to get ion flags: %d\n", rc);
@@ -160,6 +285,17 @@ static int ion_user_to_kernel(struct smem_client *client, int fd, u32 offset,
 			&iova, (u32)mem->device_addr);
 		goto fail_device_address;
 	}
+
+	entry->hndl = hndl;
+	entry->buffer_type = buffer_type;
+	entry->flags = mem->flags;
+	entry->iova = iova;
+	entry->size = buffer_size;
+	entry->refcount = 1;
+	mutex_lock(&client->map_lock);
+	list_add_tail(&entry->list, &client->map_cache);
+	mutex_unlock(&client->map_lock);
+
 	dprintk(VIDC_DBG,
 		"%s: ion_handle = 0x%pK, fd = %d, device_addr = 0x%pa, size = %zx, kvaddr = 0x%pK, buffer_type = %d, flags = 0x%lx\n",
 		__func__, mem->smem_priv, fd, &mem->device_addr, mem->size,
@@ -194,6 +330,7 @@ static int ion_user_to_kernel(struct smem_client *client, int fd, u32 offset,
         /* HTC_END */
 	return rc;
 fail_device_address:
+	kfree(entry);
 	ion_free(client->clnt, hndl);
 fail_import_fd:
 	return rc;
@@ -572,6 +709,8 @@ void *msm_smem_new_client(enum smem_type mtype,
                         client->clnt_import = NULL;
 			client->res = res;
                         client->inst = NULL;
+			mutex_init(&client->map_lock);
+			INIT_LIST_HEAD(&client->map_cache);
 		}
 	} else {
 		dprintk(VIDC_ERR, "Failed to create new client: mtype = %d\n",
@@ -628,6 +767,8 @@ void msm_smem_free(void *clt, struct msm_smem *mem)
 	}
 	switch (client->mem_type) {
 	case SMEM_ION:
+		if (smem_map_cache_put(client, mem))
+			break;
                 /* HTC_START: ION debug mechanism enhancement
                  * Switch ion_client from clnt_import to clnt_alloc here due to
                  * scratch buffer is allocated by clnt_alloc
@@ -665,6 +806,7 @@ void msm_smem_delete_client(void *clt)
 	}
 	switch (client->mem_type) {
 	case SMEM_ION:
+		smem_map_cache_flush(client);
 		ion_delete_client(client);
 		break;
 	default:
@@ -1573,6 +1573,7 @@ fail_start:
 static inline int stop_streaming(struct msm_vidc_inst *inst)
 {
 	int rc = 0;
+	msm_comm_flush_batch(inst, false);
 	rc = msm_comm_try_state(inst, MSM_VIDC_RELEASE_RESOURCES_DONE);
 	if (rc)
 		dprintk(VIDC_ERR,
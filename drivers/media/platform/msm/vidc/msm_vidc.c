@@ -1323,6 +1323,8 @@ void *msm_vidc_open(int core_id, int session_type)
 	mutex_init(&inst->bufq[CAPTURE_PORT].lock);
 	mutex_init(&inst->bufq[OUTPUT_PORT].lock);
 	mutex_init(&inst->lock);
+	mutex_init(&inst->batch.lock);
+	INIT_DELAYED_WORK(&inst->batch.work, msm_comm_batch_work);
 
 	INIT_MSM_VIDC_LIST(&inst->pendingq);
 	INIT_MSM_VIDC_LIST(&inst->scratchbufs);
@@ -1493,6 +1495,8 @@ int msm_vidc_close(void *instance)
 
 	core = inst->core;
 
+	msm_comm_flush_batch(inst, false);
+
 	mutex_lock(&core->lock);
 	list_for_each_entry_safe(temp, inst_dummy, &core->instances, list) {
 		if (temp == inst)
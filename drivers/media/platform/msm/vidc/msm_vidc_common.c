@@ -53,6 +53,12 @@
 #define IS_SYS_CMD_VALID(cmd) (((cmd) >= SYS_MSG_START) && \
 		((cmd) <= SYS_MSG_END))
 
+#define FRAME_RATE_MAX_INTERVAL_US	USEC_PER_SEC
+#define FRAME_RATE_MIN_SAMPLES		8
+#define FRAME_RATE_AVG_SHIFT		3
+/* re-vote when the rate differs by more than 1/4 */
+#define FRAME_RATE_VOTE_SHIFT		2
+
 struct getprop_buf {
 	struct list_head list;
 	void *data;
@@ -101,6 +107,16 @@ enum multi_stream msm_comm_get_stream_output_mode(struct msm_vidc_inst *inst)
 	return HAL_VIDEO_DECODER_PRIMARY;
 }
 
+/*
+ * The fps the client has set is often just a default, the rate of the
+ * content is taken from the timestamps of the frames once there are
+ * enough of them.
+ */
+static inline int msm_comm_get_fps(struct msm_vidc_inst *inst)
+{
+	return inst->frame_rate.fps ?: inst->prop.fps;
+}
+
 static int msm_comm_get_mbs_per_sec(struct msm_vidc_inst *inst)
 {
 	int output_port_mbs, capture_port_mbs;
@@ -118,7 +134,56 @@ static int msm_comm_get_mbs_per_sec(struct msm_vidc_inst *inst)
 		fps = (ctrl.value >> 16)? ctrl.value >> 16: 1;
 		return max(output_port_mbs, capture_port_mbs) * fps;
 	} else
-		return max(output_port_mbs, capture_port_mbs) * inst->prop.fps;
+		return max(output_port_mbs, capture_port_mbs) *
+			msm_comm_get_fps(inst);
+}
+
+/*
+ * Moving average of the frame interval. Decoders are sampled at FBD,
+ * where the frames are in presentation order, encoders at ETB.
+ */
+static void msm_comm_update_frame_rate(struct msm_vidc_inst *inst,
+		s64 time_usec)
+{
+	struct msm_vidc_frame_rate *fr = &inst->frame_rate;
+	s64 delta = time_usec - fr->last_ts;
+
+	fr->last_ts = time_usec;
+	/* A seek, a pause or a frame out of order */
+	if (delta <= 0 || delta > FRAME_RATE_MAX_INTERVAL_US)
+		return;
+
+	if (!fr->samples)
+		fr->avg_interval = (u32)delta;
+	else
+		fr->avg_interval = max_t(u32, fr->avg_interval -
+			(fr->avg_interval >> FRAME_RATE_AVG_SHIFT) +
+			((u32)delta >> FRAME_RATE_AVG_SHIFT), 1);
+
+	if (fr->samples < FRAME_RATE_MIN_SAMPLES) {
+		fr->samples++;
+		return;
+	}
+	fr->fps = DIV_ROUND_CLOSEST(USEC_PER_SEC, fr->avg_interval);
+}
+
+/* Vote again once the measured rate moved away from the voted one */
+static void msm_comm_check_frame_rate(struct msm_vidc_inst *inst)
+{
+	struct msm_vidc_frame_rate *fr = &inst->frame_rate;
+	u32 fps = fr->fps;
+
+	if (!fps || inst->dcvs_mode)
+		return;
+
+	if (abs((int)fps - (int)fr->voted_fps) <=
+			(fr->voted_fps >> FRAME_RATE_VOTE_SHIFT))
+		return;
+
+	dprintk(VIDC_DBG, "%s: inst %pK fps %u -> %u\n",
+		__func__, inst, fr->voted_fps, fps);
+	fr->voted_fps = fps;
+	msm_comm_scale_clocks_and_bus(inst);
 }
 
 int msm_comm_get_inst_load(struct msm_vidc_inst *inst,
@@ -1574,6 +1639,8 @@ static void handle_fbd(enum command_response cmd, void *data)
 		if (fill_buf_done->filled_len1)
 			msm_vidc_debugfs_update(inst,
 				MSM_VIDC_DEBUGFS_EVENT_FBD);
+		if (time_usec && inst->session_type == MSM_VIDC_DECODER)
+			msm_comm_update_frame_rate(inst, time_usec);
 
 		if (extra_idx && (extra_idx < VIDEO_MAX_PLANES)) {
 			dprintk(VIDC_DBG,
@@ -2984,6 +3051,147 @@ int msm_comm_compute_idle_time(struct msm_vidc_inst *inst)
 	return rc;
 }
 
+/*
+ * Decoders running at a high frame rate (or many at once) send the
+ * output buffers in batches, which is one doorbell to the firmware for
+ * the whole batch. Only buffers the firmware doesn't need right away are
+ * held: it keeps more than its minimum of outputs without them. A batch
+ * goes out when it is full, with the next input buffer or after
+ * msm_vidc_batch_timeout_ms, whichever comes first.
+ */
+static bool msm_comm_batch_ftb(struct msm_vidc_inst *inst)
+{
+	struct hal_buffer_requirements *bufreq;
+	int held;
+
+	if (inst->session_type != MSM_VIDC_DECODER ||
+		msm_vidc_batch_size <= 1 || is_thumbnail_session(inst))
+		return false;
+
+	if (msm_comm_get_load(inst->core, MSM_VIDC_DECODER,
+			LOAD_CALC_IGNORE_THUMBNAIL_LOAD) <
+			NUM_MBS_PER_SEC(1088, 1920, 60))
+		return false;
+
+	bufreq = get_buff_req_buffer(inst,
+			msm_comm_get_hal_output_buffer(inst));
+	held = inst->count.ftb - inst->count.fbd;
+	return bufreq && held > (int)bufreq->buffer_count_min;
+}
+
+/* Called with the batch lock held */
+static int msm_comm_send_batch(struct msm_vidc_inst *inst,
+		struct vidc_frame_data *etb)
+{
+	struct msm_vidc_batch *batch = &inst->batch;
+	struct hfi_device *hdev = inst->core->device;
+	int num_ftbs = batch->num_ftbs;
+	int rc = 0, i;
+
+	batch->num_ftbs = 0;
+	if (!etb && !num_ftbs)
+		return 0;
+
+	if (inst->state != MSM_VIDC_START_DONE) {
+		dprintk(VIDC_DBG, "%s: dropping %d ftbs in state %d\n",
+			__func__, num_ftbs, inst->state);
+		return etb ? -EINVAL : 0;
+	}
+
+	if (hdev->session_process_batch) {
+		rc = call_hfi_op(hdev, session_process_batch, inst->session,
+				etb ? 1 : 0, etb, num_ftbs, batch->ftbs);
+	} else {
+		if (etb)
+			rc = call_hfi_op(hdev, session_etb, inst->session, etb);
+		for (i = 0; i < num_ftbs && !rc; i++)
+			rc = call_hfi_op(hdev, session_ftb, inst->session,
+					&batch->ftbs[i]);
+	}
+	if (rc) {
+		dprintk(VIDC_ERR, "%s: failed to send batch: %d\n",
+			__func__, rc);
+		return rc;
+	}
+
+	if (etb)
+		msm_vidc_debugfs_update(inst, MSM_VIDC_DEBUGFS_EVENT_ETB);
+	for (i = 0; i < num_ftbs; i++)
+		msm_vidc_debugfs_update(inst, MSM_VIDC_DEBUGFS_EVENT_FTB);
+	if (num_ftbs) {
+		batch->batches++;
+		batch->batched_bufs += num_ftbs;
+	}
+	return 0;
+}
+
+static int msm_comm_queue_batch_ftb(struct msm_vidc_inst *inst,
+		struct vidc_frame_data *ftb)
+{
+	struct msm_vidc_batch *batch = &inst->batch;
+	int size = min_t(int, msm_vidc_batch_size, VIDC_MAX_BATCH);
+	int rc = 0;
+
+	mutex_lock(&batch->lock);
+	batch->ftbs[batch->num_ftbs++] = *ftb;
+	if (batch->num_ftbs >= size)
+		rc = msm_comm_send_batch(inst, NULL);
+	else if (batch->num_ftbs == 1)
+		schedule_delayed_work(&batch->work,
+			msecs_to_jiffies(msm_vidc_batch_timeout_ms));
+	mutex_unlock(&batch->lock);
+	return rc;
+}
+
+static int msm_comm_etb(struct msm_vidc_inst *inst,
+		struct vidc_frame_data *etb)
+{
+	struct msm_vidc_batch *batch = &inst->batch;
+	int rc;
+
+	mutex_lock(&batch->lock);
+	rc = msm_comm_send_batch(inst, etb);
+	mutex_unlock(&batch->lock);
+	return rc;
+}
+
+void msm_comm_batch_work(struct work_struct *work)
+{
+	struct msm_vidc_batch *batch = container_of(to_delayed_work(work),
+			struct msm_vidc_batch, work);
+	struct msm_vidc_inst *inst = container_of(batch,
+			struct msm_vidc_inst, batch);
+
+	mutex_lock(&batch->lock);
+	if (batch->num_ftbs) {
+		batch->timeouts++;
+		msm_comm_send_batch(inst, NULL);
+	}
+	mutex_unlock(&batch->lock);
+}
+
+/**
+ * msm_comm_flush_batch() - Empty the output buffer batch of a session
+ * @inst: The session
+ * @send: Send the held buffers to the firmware instead of dropping them
+ *
+ * Held buffers have to reach the firmware before a flush or a stop so
+ * they are returned with the others. Not to be called with the batch
+ * lock held.
+ */
+void msm_comm_flush_batch(struct msm_vidc_inst *inst, bool send)
+{
+	struct msm_vidc_batch *batch = &inst->batch;
+
+	cancel_delayed_work_sync(&batch->work);
+
+	mutex_lock(&batch->lock);
+	if (send)
+		msm_comm_send_batch(inst, NULL);
+	batch->num_ftbs = 0;
+	mutex_unlock(&batch->lock);
+}
+
 int msm_comm_qbuf(struct vb2_buffer *vb)
 {
 	int rc = 0;
@@ -3128,12 +3336,13 @@ int msm_comm_qbuf(struct vb2_buffer *vb)
 			if (core->resources.dynamic_bw_update)
 				msm_comm_compute_idle_time(inst);
 
+			if (frame_data.filled_len &&
+				inst->session_type == MSM_VIDC_ENCODER)
+				msm_comm_update_frame_rate(inst, time_usec);
+			msm_comm_check_frame_rate(inst);
+
 			msm_dcvs_check_and_scale_clocks(inst, true);
-			rc = call_hfi_op(hdev, session_etb, (void *)
-					inst->session, &frame_data);
-			if (!rc)
-				msm_vidc_debugfs_update(inst,
-					MSM_VIDC_DEBUGFS_EVENT_ETB);
+			rc = msm_comm_etb(inst, &frame_data);
 			dprintk(VIDC_DBG, "Sent etb to HAL\n");
 		} else if (q->type == V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE) {
 			struct vidc_seq_hdr seq_hdr;
@@ -3177,11 +3386,17 @@ int msm_comm_qbuf(struct vb2_buffer *vb)
 				atomic_dec(&inst->seq_hdr_reqs);
 			} else {
 				msm_dcvs_check_and_scale_clocks(inst, false);
-				rc = call_hfi_op(hdev, session_ftb,
-					(void *) inst->session, &frame_data);
-				if (!rc)
-					msm_vidc_debugfs_update(inst,
+				if (msm_comm_batch_ftb(inst)) {
+					rc = msm_comm_queue_batch_ftb(inst,
+						&frame_data);
+				} else {
+					rc = call_hfi_op(hdev, session_ftb,
+						(void *) inst->session,
+						&frame_data);
+					if (!rc)
+						msm_vidc_debugfs_update(inst,
 						MSM_VIDC_DEBUGFS_EVENT_FTB);
+				}
 			}
 		} else {
 			dprintk(VIDC_ERR,
@@ -3834,6 +4049,7 @@ int msm_comm_flush(struct msm_vidc_inst *inst, u32 flags)
 	}
 
 	msm_comm_flush_dynamic_buffers(inst);
+	msm_comm_flush_batch(inst, true);
 	if (inst->state == MSM_VIDC_CORE_INVALID ||
 		core->state == VIDC_CORE_UNINIT ||
 		core->state == VIDC_CORE_INVALID) {
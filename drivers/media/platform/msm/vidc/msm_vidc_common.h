@@ -44,6 +44,8 @@ int msm_comm_set_persist_buffers(struct msm_vidc_inst *inst);
 int msm_comm_set_output_buffers(struct msm_vidc_inst *inst);
 int msm_comm_queue_output_buffers(struct msm_vidc_inst *inst);
 int msm_comm_qbuf(struct vb2_buffer *vb);
+void msm_comm_batch_work(struct work_struct *work);
+void msm_comm_flush_batch(struct msm_vidc_inst *inst, bool send);
 void msm_comm_scale_clocks_and_bus(struct msm_vidc_inst *inst);
 int msm_comm_scale_clocks(struct msm_vidc_core *core);
 int msm_comm_scale_clocks_load(struct msm_vidc_core *core, int num_mbs_per_sec);
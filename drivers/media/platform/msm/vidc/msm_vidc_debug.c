@@ -30,6 +30,8 @@ int msm_vidc_enc_dcvs_mode = 0x1;
 int msm_vidc_sys_idle_indicator = 0x0;
 u32 msm_vidc_firmware_unload_delay = 15000;
 int msm_vidc_thermal_mitigation_disabled = 0x0;
+u32 msm_vidc_batch_size = 4;
+u32 msm_vidc_batch_timeout_ms = 4;
 
 #define DYNAMIC_BUF_OWNER(__binfo) ({ \
 	atomic_read(&__binfo->ref_count) == 2 ? "video driver" : "firmware";\
@@ -241,6 +243,18 @@ struct dentry *msm_vidc_debugfs_init_drv(void)
 			"debugfs_create_file: disable_thermal_mitigation fail\n");
 		goto failed_create_dir;
 	}
+	if (!debugfs_create_u32("batch_size", S_IRUGO | S_IWUSR,
+			dir, &msm_vidc_batch_size)) {
+		dprintk(VIDC_ERR,
+			"debugfs_create_file: batch_size fail\n");
+		goto failed_create_dir;
+	}
+	if (!debugfs_create_u32("batch_timeout_ms", S_IRUGO | S_IWUSR,
+			dir, &msm_vidc_batch_timeout_ms)) {
+		dprintk(VIDC_ERR,
+			"debugfs_create_file: batch_timeout_ms fail\n");
+		goto failed_create_dir;
+	}
 	return dir;
 
 failed_create_dir:
@@ -428,6 +442,11 @@ static ssize_t inst_info_read(struct file *file, char __user *buf,
 	cur += write_str(cur, end - cur, "EBD Count: %d\n", inst->count.ebd);
 	cur += write_str(cur, end - cur, "FTB Count: %d\n", inst->count.ftb);
 	cur += write_str(cur, end - cur, "FBD Count: %d\n", inst->count.fbd);
+	cur += write_str(cur, end - cur, "Batches: %u\n", inst->batch.batches);
+	cur += write_str(cur, end - cur, "Batched FTBs: %u\n",
+		inst->batch.batched_bufs);
+	cur += write_str(cur, end - cur, "Batch timeouts: %u\n",
+		inst->batch.timeouts);
 
 	publish_unreleased_reference(inst, &cur, end);
 	len = simple_read_from_buffer(buf, count, ppos,
@@ -65,6 +65,8 @@ extern int msm_vidc_enc_dcvs_mode;
 extern int msm_vidc_sys_idle_indicator;
 extern u32 msm_vidc_firmware_unload_delay;
 extern int msm_vidc_thermal_mitigation_disabled;
+extern u32 msm_vidc_batch_size;
+extern u32 msm_vidc_batch_timeout_ms;
 
 #define VIDC_MSG_PRIO2STRING(__level) ({ \
 	char *__str; \
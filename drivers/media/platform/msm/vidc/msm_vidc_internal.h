@@ -203,6 +203,26 @@ struct dcvs_stats {
 	bool is_additional_buff_added;
 };
 
+struct msm_vidc_frame_rate {
+	s64 last_ts;		/* timestamp of the last frame, us */
+	u32 avg_interval;	/* moving average of the frame interval, us */
+	u32 samples;
+	u32 fps;		/* 0 until enough frames were seen */
+	u32 voted_fps;		/* fps of the last clock and bus vote */
+};
+
+#define VIDC_MAX_BATCH 8
+
+struct msm_vidc_batch {
+	struct mutex lock;
+	struct vidc_frame_data ftbs[VIDC_MAX_BATCH];
+	int num_ftbs;
+	struct delayed_work work;	/* sends a batch that didn't fill up */
+	u32 batches;
+	u32 batched_bufs;
+	u32 timeouts;
+};
+
 struct profile_data {
 	int start;
 	int stop;
@@ -306,6 +326,8 @@ struct msm_vidc_inst {
 	struct msm_vidc_debug debug;
 	struct buf_count count;
 	struct dcvs_stats dcvs;
+	struct msm_vidc_frame_rate frame_rate;
+	struct msm_vidc_batch batch;
 	enum msm_vidc_modes flags;
 	struct msm_vidc_core_capability capability;
 	enum buffer_mode_type buffer_mode_set[MAX_PORT_NUM];
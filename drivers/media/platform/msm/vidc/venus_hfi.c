@@ -1085,15 +1085,8 @@ fail_vote:
 static int venus_hfi_iface_cmdq_write_nolock(struct venus_hfi_device *device,
 					void *pkt);
 
-static int venus_hfi_iface_cmdq_write(struct venus_hfi_device *device,
-					void *pkt)
+static void venus_hfi_defer_power_collapse(struct venus_hfi_device *device)
 {
-	int result = -EPERM;
-	if (!device || !pkt) {
-		dprintk(VIDC_ERR, "Invalid Params");
-		return -EINVAL;
-	}
-
 	if (device->res->sw_power_collapsible) {
 		dprintk(VIDC_DBG,
 			"Cancel and queue delayed work from %s\n",
@@ -1107,6 +1100,18 @@ static int venus_hfi_iface_cmdq_write(struct venus_hfi_device *device,
 				"PM work already scheduled\n");
 		}
 	}
+}
+
+static int venus_hfi_iface_cmdq_write(struct venus_hfi_device *device,
+					void *pkt)
+{
+	int result = -EPERM;
+	if (!device || !pkt) {
+		dprintk(VIDC_ERR, "Invalid Params");
+		return -EINVAL;
+	}
+
+	venus_hfi_defer_power_collapse(device);
 
 	mutex_lock(&device->write_lock);
 	result = venus_hfi_iface_cmdq_write_nolock(device, pkt);
@@ -1784,24 +1789,19 @@ static int venus_hfi_scale_clocks(void *dev, int load, int codecs_enabled)
 	return rc;
 }
 
-static int venus_hfi_iface_cmdq_write_nolock(struct venus_hfi_device *device,
-					void *pkt)
+/* Queue a packet without raising the interrupt to the firmware */
+static int venus_hfi_iface_cmdq_write_relaxed(
+		struct venus_hfi_device *device, void *pkt, u32 *rx_req_is_set)
 {
-	u32 rx_req_is_set = 0;
 	struct vidc_iface_q_info *q_info;
 	struct vidc_hal_cmd_pkt_hdr *cmd_packet;
 	int result = -EPERM;
 
-	if (!device || !pkt) {
-		dprintk(VIDC_ERR, "Invalid Params\n");
-		return -EINVAL;
-	}
 	WARN(!mutex_is_locked(&device->write_lock),
 		"Cmd queue write lock must be acquired");
 	if (!venus_hfi_core_in_valid_state(device)) {
 		dprintk(VIDC_DBG, "%s - fw not in init state\n", __func__);
-		result = -EINVAL;
-		goto err_q_null;
+		return -EINVAL;
 	}
 
 	cmd_packet = (struct vidc_hal_cmd_pkt_hdr *)pkt;
@@ -1810,38 +1810,60 @@ static int venus_hfi_iface_cmdq_write_nolock(struct venus_hfi_device *device,
 	q_info = &device->iface_queues[VIDC_IFACEQ_CMDQ_IDX];
 	if (!q_info) {
 		dprintk(VIDC_ERR, "cannot write to shared Q's\n");
-		goto err_q_null;
+		return result;
 	}
 
 	if (!q_info->q_array.align_virtual_addr) {
 		dprintk(VIDC_ERR, "cannot write to shared CMD Q's\n");
-		result = -ENODATA;
-		goto err_q_null;
+		return -ENODATA;
 	}
 
 	venus_hfi_sim_modify_cmd_packet((u8 *)pkt, device);
-	if (!venus_hfi_write_queue(q_info, (u8 *)pkt, &rx_req_is_set)) {
+	if (venus_hfi_write_queue(q_info, (u8 *)pkt, rx_req_is_set)) {
+		dprintk(VIDC_ERR, "venus_hfi_iface_cmdq_write:queue_full\n");
+		return result;
+	}
 
-		if (venus_hfi_power_on(device)) {
-			dprintk(VIDC_ERR, "%s: Power on failed\n", __func__);
-			goto err_q_write;
-		}
-		if (venus_hfi_scale_clocks(device, device->clk_load,
-			 device->codecs_enabled)) {
-			dprintk(VIDC_ERR, "Clock scaling failed\n");
-			goto err_q_write;
-		}
-		if (rx_req_is_set)
-			venus_hfi_write_register(
-				device, VIDC_CPU_IC_SOFTINT,
-				1 << VIDC_CPU_IC_SOFTINT_H2A_SHFT);
+	return 0;
+}
 
-		result = 0;
-	} else {
-		dprintk(VIDC_ERR, "venus_hfi_iface_cmdq_write:queue_full\n");
+/* Power up and ring the doorbell for the packets queued so far */
+static int venus_hfi_iface_cmdq_kick(struct venus_hfi_device *device,
+		u32 rx_req_is_set)
+{
+	if (venus_hfi_power_on(device)) {
+		dprintk(VIDC_ERR, "%s: Power on failed\n", __func__);
+		return -EPERM;
+	}
+	if (venus_hfi_scale_clocks(device, device->clk_load,
+		 device->codecs_enabled)) {
+		dprintk(VIDC_ERR, "Clock scaling failed\n");
+		return -EPERM;
+	}
+	if (rx_req_is_set)
+		venus_hfi_write_register(
+			device, VIDC_CPU_IC_SOFTINT,
+			1 << VIDC_CPU_IC_SOFTINT_H2A_SHFT);
+
+	return 0;
+}
+
+static int venus_hfi_iface_cmdq_write_nolock(struct venus_hfi_device *device,
+					void *pkt)
+{
+	u32 rx_req_is_set = 0;
+	int result;
+
+	if (!device || !pkt) {
+		dprintk(VIDC_ERR, "Invalid Params\n");
+		return -EINVAL;
 	}
-err_q_write:
-err_q_null:
+
+	result = venus_hfi_iface_cmdq_write_relaxed(device, pkt,
+			&rx_req_is_set);
+	if (!result)
+		result = venus_hfi_iface_cmdq_kick(device, rx_req_is_set);
+
 	return result;
 }
 
@@ -2916,6 +2938,76 @@ err_create_pkt:
 	return rc;
 }
 
+/*
+ * Queue the input and output buffers of a session with one lock of the
+ * command queue and one interrupt to the firmware for all of them.
+ */
+static int venus_hfi_session_process_batch(void *sess,
+		int num_etbs, struct vidc_frame_data etbs[],
+		int num_ftbs, struct vidc_frame_data ftbs[])
+{
+	int rc = 0, i;
+	u32 rx_req_is_set = 0, rx_req = 0;
+	struct hal_session *session = sess;
+	struct venus_hfi_device *device;
+
+	if (!session || !session->device) {
+		dprintk(VIDC_ERR, "Invalid Params\n");
+		return -EINVAL;
+	}
+	device = session->device;
+
+	venus_hfi_defer_power_collapse(device);
+
+	mutex_lock(&device->write_lock);
+	for (i = 0; i < num_etbs && !rc; i++) {
+		if (session->is_decoder) {
+			struct hfi_cmd_session_empty_buffer_compressed_packet
+				pkt;
+
+			rc = call_hfi_pkt_op(device, session_etb_decoder,
+					&pkt, session, &etbs[i]);
+			if (!rc)
+				rc = venus_hfi_iface_cmdq_write_relaxed(device,
+						&pkt, &rx_req);
+		} else {
+			struct
+			hfi_cmd_session_empty_buffer_uncompressed_plane0_packet
+				pkt;
+
+			rc = call_hfi_pkt_op(device, session_etb_encoder,
+					&pkt, session, &etbs[i]);
+			if (!rc)
+				rc = venus_hfi_iface_cmdq_write_relaxed(device,
+						&pkt, &rx_req);
+		}
+		rx_req_is_set |= rx_req;
+	}
+
+	for (i = 0; i < num_ftbs && !rc; i++) {
+		struct hfi_cmd_session_fill_buffer_packet pkt;
+
+		rc = call_hfi_pkt_op(device, session_ftb,
+				&pkt, session, &ftbs[i]);
+		if (!rc)
+			rc = venus_hfi_iface_cmdq_write_relaxed(device,
+					&pkt, &rx_req);
+		rx_req_is_set |= rx_req;
+	}
+
+	/* Whatever made it to the queue still has to reach the firmware */
+	if (venus_hfi_iface_cmdq_kick(device, rx_req_is_set) && !rc)
+		rc = -EPERM;
+	mutex_unlock(&device->write_lock);
+
+	if (rc) {
+		dprintk(VIDC_ERR, "%s: failed to queue batch: %d\n",
+			__func__, rc);
+		rc = -ENOTEMPTY;
+	}
+	return rc;
+}
+
 static int venus_hfi_session_parse_seq_hdr(void *sess,
 					struct vidc_seq_hdr *seq_hdr)
 {
@@ -4436,6 +4528,7 @@ static void venus_init_hfi_callbacks(struct hfi_device *hdev)
 	hdev->session_stop = venus_hfi_session_stop;
 	hdev->session_etb = venus_hfi_session_etb;
 	hdev->session_ftb = venus_hfi_session_ftb;
+	hdev->session_process_batch = venus_hfi_session_process_batch;
 	hdev->session_parse_seq_hdr = venus_hfi_session_parse_seq_hdr;
 	hdev->session_get_seq_hdr = venus_hfi_session_get_seq_hdr;
 	hdev->session_get_buf_req = venus_hfi_session_get_buf_req;
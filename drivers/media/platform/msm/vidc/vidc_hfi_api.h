@@ -1332,6 +1332,9 @@ struct hfi_device {
 			struct vidc_frame_data *input_frame);
 	int (*session_ftb)(void *sess,
 			struct vidc_frame_data *output_frame);
+	int (*session_process_batch)(void *sess,
+			int num_etbs, struct vidc_frame_data etbs[],
+			int num_ftbs, struct vidc_frame_data ftbs[]);
 	int (*session_parse_seq_hdr)(void *sess,
 			struct vidc_seq_hdr *seq_hdr);
 	int (*session_get_seq_hdr)(void *sess,
@@ -79,6 +79,7 @@
 
 #define QSEECOM_SEND_CMD_CRYPTO_TIMEOUT	2000
 #define QSEECOM_LOAD_APP_CRYPTO_TIMEOUT	2000
+#define QSEECOM_PERF_HOLD_TIMEOUT	100
 #define TWO 2
 #define QSEECOM_ICE_CE_NUM 10
 #define QSEECOM_ICE_FDE_KEY_INDEX 0
@@ -109,6 +110,17 @@ static dev_t qseecom_device_no;
 static DEFINE_MUTEX(qsee_bw_mutex);
 static DEFINE_MUTEX(app_access_lock);
 static DEFINE_MUTEX(clk_access_lock);
+static DEFINE_MUTEX(qsee_perf_hold_mutex);
+
+/*
+ * Without bus scaling every command votes for the crypto clocks and
+ * the bus. Keep one vote for this long after the last command so that
+ * bursts of commands (fingerprint match, DRM key ops) do not ramp the
+ * clocks up and down for each call. 0 drops the vote right away.
+ */
+static unsigned int qseecom_perf_hold_ms = QSEECOM_PERF_HOLD_TIMEOUT;
+module_param_named(perf_hold_ms, qseecom_perf_hold_ms, uint, 0644);
+MODULE_PARM_DESC(perf_hold_ms, "ms to keep the clock vote after a command");
 
 struct sglist_info {
 	uint32_t indexAndFlags;
@@ -225,6 +237,8 @@ struct qseecom_control {
 	bool no_clock_support;
 	unsigned int ce_opp_freq_hz;
 	bool appsbl_qseecom_support;
+	struct delayed_work perf_hold_work;
+	bool perf_held;
 };
 
 struct qseecom_client_handle {
@@ -261,6 +275,9 @@ struct qseecom_dev_handle {
 	bool use_legacy_cmd;
 };
 
+/* Owner of the vote held across command bursts */
+static struct qseecom_dev_handle qseecom_perf_hold_data;
+
 struct qseecom_sg_entry {
 	uint32_t phys_addr;
 	uint32_t len;
@@ -1141,6 +1158,45 @@ perf_enable_exit:
 	return ret;
 }
 
+static void qseecom_perf_hold_release(void)
+{
+	mutex_lock(&qsee_perf_hold_mutex);
+	if (qseecom.perf_held) {
+		qsee_disable_clock_vote(&qseecom_perf_hold_data, CLK_DFAB);
+		qsee_disable_clock_vote(&qseecom_perf_hold_data, CLK_SFPB);
+		qseecom.perf_held = false;
+	}
+	mutex_unlock(&qsee_perf_hold_mutex);
+}
+
+static void qseecom_perf_hold_work(struct work_struct *work)
+{
+	qseecom_perf_hold_release();
+}
+
+/*
+ * Drop the clock votes taken by qseecom_perf_enable() for one command.
+ * The first command of a burst takes an extra vote while its own is
+ * still up, so that this costs no bus request, and the extra vote is
+ * dropped once no command came in for qseecom_perf_hold_ms.
+ */
+static void qseecom_perf_disable(struct qseecom_dev_handle *data)
+{
+	unsigned int hold_ms = ACCESS_ONCE(qseecom_perf_hold_ms);
+
+	mutex_lock(&qsee_perf_hold_mutex);
+	if (hold_ms && !qseecom.perf_held &&
+			!qseecom_perf_enable(&qseecom_perf_hold_data))
+		qseecom.perf_held = true;
+	if (qseecom.perf_held)
+		mod_delayed_work(system_wq, &qseecom.perf_hold_work,
+					msecs_to_jiffies(hold_ms));
+	mutex_unlock(&qsee_perf_hold_mutex);
+
+	qsee_disable_clock_vote(data, CLK_DFAB);
+	qsee_disable_clock_vote(data, CLK_SFPB);
+}
+
 static int qseecom_scale_bus_bandwidth(struct qseecom_dev_handle *data,
 						void __user *argp)
 {
@@ -1230,6 +1286,8 @@ static int qseecom_set_client_mem_param(struct qseecom_dev_handle *data,
 	ion_phys_addr_t pa;
 	int32_t ret;
 	struct qseecom_set_sb_mem_param_req req;
+	struct ion_handle *ihandle;
+	char *sb_virt;
 	size_t len;
 
 	/* Copy the relevant information needed for loading the image */
@@ -1247,37 +1305,62 @@ static int qseecom_set_client_mem_param(struct qseecom_dev_handle *data,
 		return -EFAULT;
 
 	/* Get the handle of the shared fd */
-	data->client.ihandle = ion_import_dma_buf(qseecom.ion_clnt,
-						req.ifd_data_fd);
-	if (IS_ERR_OR_NULL(data->client.ihandle)) {
+	ihandle = ion_import_dma_buf(qseecom.ion_clnt, req.ifd_data_fd);
+	if (IS_ERR_OR_NULL(ihandle)) {
 		pr_err("Ion client could not retrieve the handle\n");
 		return -ENOMEM;
 	}
 	/* Get the physical address of the ION BUF */
-	ret = ion_phys(qseecom.ion_clnt, data->client.ihandle, &pa, &len);
+	ret = ion_phys(qseecom.ion_clnt, ihandle, &pa, &len);
 	if (ret) {
 
 		pr_err("Cannot get phys_addr for the Ion Client, ret = %d\n",
 			ret);
-		return ret;
+		goto err_free;
 	}
 
 	if (len < req.sb_len) {
 		pr_err("Requested length (0x%x) is > allocated (0x%zu)\n",
 			req.sb_len, len);
-		return -EINVAL;
+		ret = -EINVAL;
+		goto err_free;
+	}
+
+	/*
+	 * Clients that set up the same buffer again, e.g. on every session
+	 * they open, get the mapping they already have. ion hands back the
+	 * same handle for the same buffer, drop the reference taken above.
+	 */
+	if (ihandle == data->client.ihandle && data->client.sb_virt) {
+		ion_free(qseecom.ion_clnt, ihandle);
+		goto done;
 	}
+
 	/* Populate the structure for sending scm call to load image */
-	data->client.sb_virt = (char *) ion_map_kernel(qseecom.ion_clnt,
-							data->client.ihandle);
-	if (IS_ERR_OR_NULL(data->client.sb_virt)) {
+	sb_virt = (char *) ion_map_kernel(qseecom.ion_clnt, ihandle);
+	if (IS_ERR_OR_NULL(sb_virt)) {
 		pr_err("ION memory mapping for client shared buf failed\n");
-		return -ENOMEM;
+		ret = -ENOMEM;
+		goto err_free;
+	}
+	/* A different buffer replaces the one set up before */
+	if (!IS_ERR_OR_NULL(data->client.ihandle)) {
+		if (data->client.sb_virt)
+			ion_unmap_kernel(qseecom.ion_clnt,
+						data->client.ihandle);
+		ion_free(qseecom.ion_clnt, data->client.ihandle);
 	}
+	data->client.ihandle = ihandle;
+	data->client.sb_virt = sb_virt;
+done:
 	data->client.sb_phys = (phys_addr_t)pa;
 	data->client.sb_length = req.sb_len;
 	data->client.user_virt_sb_base = (uintptr_t)req.virt_sb_base;
 	return 0;
+
+err_free:
+	ion_free(qseecom.ion_clnt, ihandle);
+	return ret;
 }
 
 static int __qseecom_listener_has_sent_rsp(struct qseecom_dev_handle *data)
@@ -2042,8 +2125,7 @@ static int qseecom_send_service_cmd(struct qseecom_dev_handle *data,
 	if (ret) {
 		pr_err("qseecom_scm_call failed with err: %d\n", ret);
 		if (!qseecom.support_bus_scaling) {
-			qsee_disable_clock_vote(data, CLK_DFAB);
-			qsee_disable_clock_vote(data, CLK_SFPB);
+			qseecom_perf_disable(data);
 		} else {
 			__qseecom_add_bw_scale_down_timer(
 				QSEECOM_SEND_CMD_CRYPTO_TIMEOUT);
@@ -2078,8 +2160,7 @@ static int qseecom_send_service_cmd(struct qseecom_dev_handle *data,
 		break;
 	}
 	if (!qseecom.support_bus_scaling) {
-		qsee_disable_clock_vote(data, CLK_DFAB);
-		qsee_disable_clock_vote(data, CLK_SFPB);
+		qseecom_perf_disable(data);
 	} else {
 		__qseecom_add_bw_scale_down_timer(
 			QSEECOM_SEND_CMD_CRYPTO_TIMEOUT);
@@ -3283,10 +3364,8 @@ int qseecom_send_command(struct qseecom_handle *handle, void *send_buf,
 		__qseecom_add_bw_scale_down_timer(
 			QSEECOM_SEND_CMD_CRYPTO_TIMEOUT);
 
-	if (perf_enabled) {
-		qsee_disable_clock_vote(data, CLK_DFAB);
-		qsee_disable_clock_vote(data, CLK_SFPB);
-	}
+	if (perf_enabled)
+		qseecom_perf_disable(data);
 
 	atomic_dec(&data->ioctl_count);
 	mutex_unlock(&app_access_lock);
@@ -5136,10 +5215,8 @@ long qseecom_ioctl(struct file *file, unsigned cmd, unsigned long arg)
 		if (qseecom.support_bus_scaling)
 			__qseecom_add_bw_scale_down_timer(
 				QSEECOM_SEND_CMD_CRYPTO_TIMEOUT);
-		if (perf_enabled) {
-			qsee_disable_clock_vote(data, CLK_DFAB);
-			qsee_disable_clock_vote(data, CLK_SFPB);
-		}
+		if (perf_enabled)
+			qseecom_perf_disable(data);
 		atomic_dec(&data->ioctl_count);
 		wake_up_all(&data->abort_wq);
 		mutex_unlock(&app_access_lock);
@@ -5196,10 +5273,8 @@ long qseecom_ioctl(struct file *file, unsigned cmd, unsigned long arg)
 		if (qseecom.support_bus_scaling)
 			__qseecom_add_bw_scale_down_timer(
 				QSEECOM_SEND_CMD_CRYPTO_TIMEOUT);
-		if (perf_enabled) {
-			qsee_disable_clock_vote(data, CLK_DFAB);
-			qsee_disable_clock_vote(data, CLK_SFPB);
-		}
+		if (perf_enabled)
+			qseecom_perf_disable(data);
 		atomic_dec(&data->ioctl_count);
 		wake_up_all(&data->abort_wq);
 		mutex_unlock(&app_access_lock);
@@ -6217,6 +6292,7 @@ static int qseecom_probe(struct platform_device *pdev)
 				qseecom_scale_bus_bandwidth_timer_callback;
 	}
 	qseecom.timer_running = false;
+	INIT_DELAYED_WORK(&qseecom.perf_hold_work, qseecom_perf_hold_work);
 	qseecom.qsee_perf_client = msm_bus_scale_register_client(
 					qseecom_platform_support);
 
@@ -6287,6 +6363,9 @@ exit_irqrestore:
 	if (qseecom.qseos_version > QSEEE_VERSION_00)
 		qseecom_unload_commonlib_image();
 
+	cancel_delayed_work_sync(&qseecom.perf_hold_work);
+	qseecom_perf_hold_release();
+
 	if (qseecom.qsee_perf_client)
 		msm_bus_scale_client_update_request(qseecom.qsee_perf_client,
 									0);
@@ -6328,6 +6407,9 @@ static int qseecom_suspend(struct platform_device *pdev, pm_message_t state)
 	if (qseecom.no_clock_support)
 		return 0;
 
+	cancel_delayed_work_sync(&qseecom.perf_hold_work);
+	qseecom_perf_hold_release();
+
 	mutex_lock(&qsee_bw_mutex);
 	mutex_lock(&clk_access_lock);
 
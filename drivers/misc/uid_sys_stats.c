@@ -216,6 +216,7 @@ static ssize_t uid_remove_write(struct file *file,
 	 * from both here as well as from cpufreq uid_time_in_state
 	 */
 	cpufreq_task_stats_remove_uids(uid_start, uid_end);
+	cpufreq_uid_stats_remove_uids(uid_start, uid_end);
 
 	rt_mutex_lock(&uid_lock);
 
@@ -135,6 +135,7 @@ struct mmc_blk_data {
 #define MMC_BLK_DISCARD		BIT(2)
 #define MMC_BLK_SECDISCARD	BIT(3)
 #define MMC_BLK_FLUSH		BIT(4)
+#define MMC_BLK_CMDQ		BIT(5)
 
 
 	/*
@@ -820,6 +821,11 @@ static int mmc_blk_ioctl_cmd(struct block_device *bdev,
 	if (mmc_card_get_bkops_en_manual(card))
 		mmc_stop_bkops(card);
 
+	/* user commands may be anything, keep the command queue out of it */
+	err = mmc_cmdq_switch(card, false);
+	if (err)
+		goto cmd_rel_host;
+
 	err = mmc_blk_part_switch(card, md);
 	if (err)
 		goto cmd_rel_host;
@@ -1187,6 +1193,11 @@ static inline int mmc_blk_part_switch(struct mmc_card *card,
 	if (mmc_card_mmc(card)) {
 		u8 part_config = card->ext_csd.part_config;
 
+		/* the command queue only serves the user area */
+		ret = mmc_cmdq_switch(card, false);
+		if (ret)
+			return ret;
+
 		part_config &= ~EXT_CSD_PART_CONFIG_ACC_MASK;
 		part_config |= md->part_type;
 
@@ -3107,6 +3118,200 @@ out:
 	return ret;
 }
 
+#define MMC_CMDQ_MAX_RETRIES	2
+
+static void mmc_blk_cmdq_req_done(struct mmc_request *mrq)
+{
+	struct mmc_queue_req *mqrq = container_of(mrq->cmdq_req,
+					struct mmc_queue_req, cmdq_req);
+
+	blk_complete_request(mqrq->req);
+}
+
+/*
+ * Softirq completion of a command queue task. Tasks the host handed back
+ * on disable are requeued, failed ones are retried a few times; either
+ * way the queue thread takes it from here.
+ */
+static void mmc_blk_cmdq_complete_rq(struct request *req)
+{
+	struct request_queue *q = req->q;
+	struct mmc_queue *mq = q->queuedata;
+	struct mmc_queue_req *mqrq = &mq->mqrq_cmdq[req->tag];
+	struct mmc_cmdq_req *cqr = &mqrq->cmdq_req;
+	int err = cqr->data.error;
+	unsigned long flags;
+
+	mmc_cmdq_post_req(mq->card->host, &cqr->mrq, err);
+	mqrq->req = NULL;
+	clear_bit(cqr->tag, &mq->cmdq_busy);
+
+	if (err && err != -EAGAIN) {
+		pr_err("%s: command queue task %u failed %d\n",
+		       req->rq_disk->disk_name, cqr->tag, err);
+		set_bit(MMC_QUEUE_CMDQ_ERR, &mq->flags);
+	}
+
+	if (err == -EAGAIN || (err && req->retries++ < MMC_CMDQ_MAX_RETRIES)) {
+		spin_lock_irqsave(q->queue_lock, flags);
+		blk_requeue_request(q, req);
+		spin_unlock_irqrestore(q->queue_lock, flags);
+	} else {
+		blk_end_request_all(req, err);
+	}
+
+	wake_up_process(mq->thread);
+}
+
+static void mmc_blk_cmdq_rw_prep(struct mmc_queue *mq,
+				 struct mmc_queue_req *mqrq)
+{
+	struct mmc_blk_data *md = mq->data;
+	struct mmc_card *card = md->queue.card;
+	struct request *req = mqrq->req;
+	struct mmc_cmdq_req *cqr = &mqrq->cmdq_req;
+	struct mmc_data *data = &cqr->data;
+	bool write = rq_data_dir(req) == WRITE;
+
+	memset(cqr, 0, sizeof(*cqr));
+	cqr->tag = req->tag;
+	cqr->blk_addr = blk_rq_pos(req);
+	if (!mmc_card_blockaddr(card))
+		cqr->blk_addr <<= 9;
+
+	if (!write)
+		cqr->flags |= MMC_CMDQ_READ;
+	if (req->cmd_flags & REQ_URGENT)
+		cqr->flags |= MMC_CMDQ_PRIO;
+	if (write && (req->cmd_flags & REQ_FUA) && (md->flags & MMC_BLK_REL_WR))
+		cqr->flags |= MMC_CMDQ_REL_WR;
+	if (write && (req->cmd_flags & REQ_META) &&
+	    card->ext_csd.data_tag_unit_size &&
+	    blk_rq_bytes(req) >= card->ext_csd.data_tag_unit_size)
+		cqr->flags |= MMC_CMDQ_DATA_TAG;
+
+	data->blksz = 512;
+	data->blocks = blk_rq_sectors(req);
+	data->flags = write ? MMC_DATA_WRITE : MMC_DATA_READ;
+	data->sg = mqrq->sg;
+	data->sg_len = mmc_queue_map_sg(mq, mqrq);
+
+	cqr->mrq.data = data;
+	cqr->mrq.cmdq_req = cqr;
+	cqr->mrq.done = mmc_blk_cmdq_req_done;
+}
+
+static void mmc_blk_cmdq_recover(struct mmc_queue *mq)
+{
+	struct mmc_blk_data *md = mq->data;
+	struct mmc_card *card = md->queue.card;
+
+	clear_bit(MMC_QUEUE_CMDQ_ERR, &mq->flags);
+	if (!mmc_card_cmdq(card))
+		return;
+
+	/* the tasks still queued come back with -EAGAIN and are requeued */
+	if (mmc_cmdq_switch(card, false) &&
+	    !mmc_blk_reset(md, card->host, MMC_BLK_CMDQ))
+		mmc_blk_reset_success(md, MMC_BLK_CMDQ);
+}
+
+/*
+ * Issue path of a user area queue running on the card's command queue.
+ * The queue thread calls it for every request it has a tag for, and with
+ * no request when there is nothing to start: then it recovers from a
+ * failed task, or, once nothing is in flight, halts the engine and lets
+ * go of the host. Flushes and discards are only started with nothing in
+ * flight and go out as legacy commands on the halted engine.
+ */
+static int mmc_blk_cmdq_issue_rq(struct mmc_queue *mq, struct request *req)
+{
+	struct mmc_blk_data *md = mq->data;
+	struct mmc_card *card = md->queue.card;
+	struct mmc_host *host = card->host;
+	struct mmc_queue_req *mqrq;
+	unsigned long flags;
+	int ret;
+
+	if (!req) {
+		if (test_bit(MMC_QUEUE_CMDQ_ERR, &mq->flags))
+			mmc_blk_cmdq_recover(mq);
+		if (mq->cmdq_claimed && !mq->cmdq_busy) {
+			if (mmc_card_cmdq(card))
+				mmc_cmdq_halt(host, true);
+			if (mmc_card_need_bkops(card))
+				mmc_start_bkops(card, false);
+			mq->cmdq_claimed = false;
+			mmc_release_host(host);
+			mmc_rpm_release(host, &card->dev);
+		}
+		return 0;
+	}
+
+	if (!mq->cmdq_claimed) {
+		mmc_rpm_hold(host, &card->dev);
+		mmc_claim_host(host);
+#ifdef CONFIG_MMC_BLOCK_DEFERRED_RESUME
+		if (mmc_bus_needs_resume(host))
+			mmc_resume_bus(host);
+#endif
+		if (mmc_card_get_bkops_en_manual(card))
+			mmc_stop_bkops(card);
+		mq->cmdq_claimed = true;
+	}
+
+	ret = mmc_blk_part_switch(card, md);
+	if (ret) {
+		blk_end_request_all(req, -EIO);
+		return 0;
+	}
+
+	if (req->cmd_flags & MMC_REQ_SPECIAL_MASK) {
+		if (mmc_card_cmdq(card))
+			mmc_cmdq_halt(host, true);
+		if (req->cmd_flags & REQ_FLUSH)
+			return mmc_blk_issue_flush(mq, req);
+		if ((req->cmd_flags & REQ_SECURE) &&
+		    !(card->quirks & MMC_QUIRK_SEC_ERASE_TRIM_BROKEN))
+			return mmc_blk_issue_secdiscard_rq(mq, req);
+		return mmc_blk_issue_discard_rq(mq, req);
+	}
+
+	if (!mmc_card_cmdq(card)) {
+		ret = mmc_cmdq_switch(card, true);
+		if (ret) {
+			blk_end_request_all(req, -EIO);
+			return 0;
+		}
+	}
+	ret = mmc_cmdq_halt(host, false);
+	if (ret) {
+		blk_end_request_all(req, -EIO);
+		return 0;
+	}
+
+	mqrq = &mq->mqrq_cmdq[req->tag];
+	mqrq->req = req;
+	mmc_blk_cmdq_rw_prep(mq, mqrq);
+
+	set_bit(req->tag, &mq->cmdq_busy);
+	ret = mmc_cmdq_start_req(host, &mqrq->cmdq_req.mrq);
+	if (ret) {
+		clear_bit(req->tag, &mq->cmdq_busy);
+		mqrq->req = NULL;
+		if (ret == -EBUSY) {
+			/* only a failed engine turns tasks away */
+			set_bit(MMC_QUEUE_CMDQ_ERR, &mq->flags);
+			spin_lock_irqsave(mq->queue->queue_lock, flags);
+			blk_requeue_request(mq->queue, req);
+			spin_unlock_irqrestore(mq->queue->queue_lock, flags);
+		} else {
+			blk_end_request_all(req, ret);
+		}
+	}
+	return 0;
+}
+
 static int sd_blk_issue_rw_rq(struct mmc_queue *mq, struct request *rqc)
 {
 	struct mmc_blk_data *md = mq->data;
@@ -3465,7 +3670,11 @@ static struct mmc_blk_data *mmc_blk_alloc_req(struct mmc_card *card,
 
 	if(mmc_card_sd(card))
 		md->queue.issue_fn = sd_blk_issue_rq;
-	else
+	else if (md->queue.cmdq_depth) {
+		md->queue.issue_fn = mmc_blk_cmdq_issue_rq;
+		blk_queue_softirq_done(md->queue.queue,
+				       mmc_blk_cmdq_complete_rq);
+	} else
 		md->queue.issue_fn = mmc_blk_issue_rq;
 	md->queue.data = md;
 
@@ -136,6 +136,70 @@ static int mmc_queue_thread(void *d)
 	return 0;
 }
 
+/*
+ * The queue thread of a command queueing card: start every request there
+ * is a tag for without waiting, and come back when a task completes.
+ * Flushes and discards wait for the queue to drain. While tasks are in
+ * flight the thread keeps thread_sem, so suspend waits for them.
+ */
+static int mmc_cmdq_thread(void *d)
+{
+	struct mmc_queue *mq = d;
+	struct request_queue *q = mq->queue;
+	struct mmc_card *card = mq->card;
+	struct sched_param scheduler_params = {0};
+
+	scheduler_params.sched_priority = 1;
+	sched_setscheduler(current, SCHED_FIFO, &scheduler_params);
+
+	current->flags |= PF_MEMALLOC;
+	if (card->host->wakeup_on_idle)
+		set_wake_up_idle(true);
+
+	down(&mq->thread_sem);
+	do {
+		struct request *req = NULL;
+
+		spin_lock_irq(q->queue_lock);
+		set_current_state(TASK_INTERRUPTIBLE);
+		if (!test_bit(MMC_QUEUE_CMDQ_ERR, &mq->flags))
+			req = blk_peek_request(q);
+		if (req && (req->cmd_flags & MMC_REQ_SPECIAL_MASK) &&
+		    mq->cmdq_busy)
+			req = NULL;
+		if (req && blk_queue_start_tag(q, req))
+			req = NULL;
+		if (req)
+			req->process_time = ktime_get();
+		spin_unlock_irq(q->queue_lock);
+
+		if (req) {
+			set_current_state(TASK_RUNNING);
+			mq->issue_fn(mq, req);
+			cond_resched();
+		} else if (test_bit(MMC_QUEUE_CMDQ_ERR, &mq->flags) ||
+			   (mq->cmdq_claimed && !mq->cmdq_busy)) {
+			set_current_state(TASK_RUNNING);
+			mq->issue_fn(mq, NULL);
+		} else if (mq->cmdq_busy) {
+			/* a completion wakes us */
+			schedule();
+		} else {
+			if (kthread_should_stop()) {
+				set_current_state(TASK_RUNNING);
+				break;
+			}
+			mmc_start_delayed_bkops(card);
+			up(&mq->thread_sem);
+			schedule();
+			down(&mq->thread_sem);
+		}
+	} while (1);
+	up(&mq->thread_sem);
+
+	return 0;
+}
+
 static int sd_queue_thread(void *d)
 {
 	struct mmc_queue *mq = d;
@@ -320,6 +384,67 @@ static void mmc_queue_setup_discard(struct request_queue *q,
 		queue_flag_set_unlocked(QUEUE_FLAG_SECDISCARD, q);
 }
 
+static bool mmc_cmdq_capable(struct mmc_card *card)
+{
+	struct mmc_host *host = card->host;
+
+	return mmc_card_mmc(card) && card->ext_csd.cmdq_support &&
+		host->cmdq_ops && (host->caps2 & MMC_CAP2_CMD_QUEUE);
+}
+
+static void mmc_cmdq_free(struct mmc_queue *mq)
+{
+	unsigned int i;
+
+	if (!mq->mqrq_cmdq)
+		return;
+
+	for (i = 0; i < mq->cmdq_depth; i++)
+		kfree(mq->mqrq_cmdq[i].sg);
+	kfree(mq->mqrq_cmdq);
+	mq->mqrq_cmdq = NULL;
+	mq->cmdq_depth = 0;
+}
+
+/*
+ * Tag the queue with as many tags as both the card and the host can keep
+ * queued, each with a request of its own.
+ */
+static int mmc_cmdq_init(struct mmc_queue *mq, struct mmc_card *card)
+{
+	struct mmc_host *host = card->host;
+	unsigned int depth, i;
+	unsigned short max_segs;
+	int ret;
+
+	depth = min_t(unsigned int, card->ext_csd.cmdq_depth,
+		      host->cmdq_slots);
+	depth = min_t(unsigned int, depth, BITS_PER_LONG);
+	max_segs = min(host->max_segs, host->cmdq_max_segs);
+
+	mq->mqrq_cmdq = kcalloc(depth, sizeof(*mq->mqrq_cmdq), GFP_KERNEL);
+	if (!mq->mqrq_cmdq)
+		return -ENOMEM;
+	mq->cmdq_depth = depth;
+
+	for (i = 0; i < depth; i++) {
+		mq->mqrq_cmdq[i].sg = mmc_alloc_sg(max_segs, &ret);
+		if (ret)
+			goto free;
+	}
+
+	ret = blk_queue_init_tags(mq->queue, depth, NULL);
+	if (ret)
+		goto free;
+
+	blk_queue_max_segments(mq->queue, max_segs);
+	return 0;
+
+free:
+	mmc_cmdq_free(mq);
+	return ret;
+}
+
 /**
  * mmc_init_queue - initialise a queue structure.
  * @mq: mmc queue
@@ -483,14 +608,23 @@ cur_sg_alloc_failed:
 success:
 	sema_init(&mq->thread_sem, 1);
 
+	/* !subname is the user area, the only one the command queue serves */
+	if (!subname && mmc_cmdq_capable(card) && mmc_cmdq_init(mq, card))
+		pr_warn("%s: command queueing not available\n",
+			mmc_card_name(card));
+
 	if (mmc_card_sd(card))
 		mq->thread = kthread_run(sd_queue_thread, mq, "sd-qd");
+	else if (mq->cmdq_depth)
+		mq->thread = kthread_run(mmc_cmdq_thread, mq, "mmcqd/%d",
+			host->index);
 	else
 		mq->thread = kthread_run(mmc_queue_thread, mq, "mmcqd/%d%s",
 			host->index, subname ? subname : "");
 
 	if (IS_ERR(mq->thread)) {
 		ret = PTR_ERR(mq->thread);
+		mmc_cmdq_free(mq);
 		goto free_bounce_sg;
 	}
 
@@ -560,6 +694,7 @@ void mmc_cleanup_queue(struct mmc_queue *mq)
 		kfree(mqrq_prev->bounce_buf);
 		mqrq_prev->bounce_buf = NULL;
 	}
+	mmc_cmdq_free(mq);
 	mq->card = NULL;
 }
 EXPORT_SYMBOL(mmc_cleanup_queue);
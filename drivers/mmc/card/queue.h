@@ -41,6 +41,7 @@ struct mmc_queue_req {
 	struct mmc_async_req	mmc_active;
 	enum mmc_packed_type	cmd_type;
 	struct mmc_packed	*packed;
+	struct mmc_cmdq_req	cmdq_req;
 };
 
 struct mmc_queue {
@@ -51,6 +52,7 @@ struct mmc_queue {
 #define MMC_QUEUE_SUSPENDED		0
 #define MMC_QUEUE_NEW_REQUEST		1
 #define MMC_QUEUE_URGENT_REQUEST	2
+#define MMC_QUEUE_CMDQ_ERR		3
 
 	int			(*issue_fn)(struct mmc_queue *, struct request *);
 	void			*data;
@@ -64,6 +66,12 @@ struct mmc_queue {
 	bool			no_pack_for_random;
 	int (*err_check_fn) (struct mmc_card *, struct mmc_async_req *);
 	void (*packed_test_fn) (struct request_queue *, struct mmc_queue_req *);
+
+	/* command queueing, only on the user area */
+	unsigned int		cmdq_depth;	/* 0 when not in use */
+	struct mmc_queue_req	*mqrq_cmdq;	/* one for every tag */
+	unsigned long		cmdq_busy;	/* tags issued to the host */
+	bool			cmdq_claimed;	/* host claimed by the thread */
 };
 
 extern int mmc_init_queue(struct mmc_queue *, struct mmc_card *, spinlock_t *,
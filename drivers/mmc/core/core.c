@@ -1501,6 +1501,67 @@ void mmc_wait_for_req(struct mmc_host *host, struct mmc_request *mrq)
 }
 EXPORT_SYMBOL(mmc_wait_for_req);
 
+/**
+ *	mmc_cmdq_start_req - queue a task on the command queue engine
+ *	@host: MMC host with command queueing enabled
+ *	@mrq: request with cmdq_req set up
+ *
+ *	Hand a data transfer to the host's command queue engine without
+ *	waiting for it. mrq->done is called once the task completes, after
+ *	which the caller must call mmc_cmdq_post_req(). The host clock is
+ *	held from here to mmc_cmdq_post_req().
+ */
+int mmc_cmdq_start_req(struct mmc_host *host, struct mmc_request *mrq)
+{
+	int err;
+
+	mrq->host = host;
+	mrq->data->error = 0;
+	mrq->data->bytes_xfered = 0;
+	mrq->data->mrq = mrq;
+
+	mmc_host_clk_hold(host);
+	err = host->cmdq_ops->request(host, mrq);
+	if (err)
+		mmc_host_clk_release(host);
+	return err;
+}
+EXPORT_SYMBOL(mmc_cmdq_start_req);
+
+/**
+ *	mmc_cmdq_post_req - post process a completed command queue task
+ *	@host: MMC host the task ran on
+ *	@mrq: the completed request
+ *	@err: the error the task completed with
+ */
+void mmc_cmdq_post_req(struct mmc_host *host, struct mmc_request *mrq,
+		       int err)
+{
+	if (host->cmdq_ops->post_req)
+		host->cmdq_ops->post_req(host, mrq, err);
+	mmc_host_clk_release(host);
+}
+EXPORT_SYMBOL(mmc_cmdq_post_req);
+
+/**
+ *	mmc_cmdq_halt - halt or resume the command queue engine
+ *	@host: MMC host with command queueing enabled
+ *	@halt: true to halt, false to resume
+ *
+ *	A halted engine finishes the task in progress and lets legacy
+ *	commands through; queued tasks stay queued until it is resumed.
+ */
+int mmc_cmdq_halt(struct mmc_host *host, bool halt)
+{
+	int err;
+
+	mmc_host_clk_hold(host);
+	err = host->cmdq_ops->halt(host, halt);
+	mmc_host_clk_release(host);
+	return err;
+}
+EXPORT_SYMBOL(mmc_cmdq_halt);
+
 bool mmc_card_is_prog_state(struct mmc_card *card)
 {
 	bool rc;
@@ -629,6 +629,14 @@ static int mmc_read_ext_csd(struct mmc_card *card, u8 *ext_csd)
 		card->ext_csd.data_sector_size = 512;
 	}
 
+	/* eMMC v5.1 or later */
+	if (card->ext_csd.rev >= 8) {
+		card->ext_csd.cmdq_support = ext_csd[EXT_CSD_CMDQ_SUPPORT] &
+			EXT_CSD_CMDQ_SUPPORTED;
+		card->ext_csd.cmdq_depth = (ext_csd[EXT_CSD_CMDQ_DEPTH] &
+			EXT_CSD_CMDQ_DEPTH_MASK) + 1;
+	}
+
 	if (mmc_card_mmc(card)) {
 		char *buf;
 		int i, j;
@@ -1449,6 +1457,12 @@ static int mmc_init_card(struct mmc_host *host, u32 ocr,
 	BUG_ON(!host);
 	WARN_ON(!host->claimed);
 
+	/* the card leaves command queueing mode on reset, so must the host */
+	if (oldcard && mmc_card_cmdq(oldcard)) {
+		host->cmdq_ops->disable(host);
+		mmc_card_clr_cmdq(oldcard);
+	}
+
 	/* Set correct bus mode for MMC before attempting init */
 	if (!mmc_host_is_spi(host))
 		mmc_set_bus_mode(host, MMC_BUSMODE_OPENDRAIN);
@@ -1947,6 +1961,10 @@ static int _mmc_suspend(struct mmc_host *host, bool is_suspend)
 	 */
 	mmc_disable_clk_scaling(host);
 
+	err = mmc_cmdq_switch(host->card, false);
+	if (err)
+		goto out;
+
 	err = mmc_flush_cache(host->card);
 	if (err)
 		goto out;
@@ -651,3 +651,67 @@ int mmc_send_hpi_cmd(struct mmc_card *card, u32 *status)
 
 	return 0;
 }
+
+static int mmc_cmdq_discard_queue(struct mmc_card *card)
+{
+	struct mmc_command cmd = {0};
+
+	cmd.opcode = MMC_CMDQ_TASK_MGMT;
+	cmd.arg = MMC_CMDQ_DISCARD_QUEUE;
+	cmd.flags = MMC_RSP_R1B | MMC_CMD_AC;
+
+	return mmc_wait_for_cmd(card->host, &cmd, 0);
+}
+
+/**
+ *	mmc_cmdq_switch - turn command queueing on the card on or off
+ *	@card: eMMC card with ext_csd.cmdq_support
+ *	@enable: new state
+ *
+ *	Must be called with the host claimed. Going off, the host engine is
+ *	stopped first, so its queued tasks complete with -EAGAIN, and
+ *	whatever the card still holds in its queue is discarded.
+ */
+int mmc_cmdq_switch(struct mmc_card *card, bool enable)
+{
+	struct mmc_host *host = card->host;
+	int err;
+
+	if (!!mmc_card_cmdq(card) == enable)
+		return 0;
+
+	if (!enable) {
+		mmc_host_clk_hold(host);
+		host->cmdq_ops->disable(host);
+		mmc_host_clk_release(host);
+		mmc_card_clr_cmdq(card);
+
+		err = mmc_cmdq_discard_queue(card);
+		if (err)
+			pr_warn("%s: discarding the command queue failed %d\n",
+				mmc_hostname(host), err);
+	}
+
+	err = mmc_switch(card, EXT_CSD_CMD_SET_NORMAL, EXT_CSD_CMDQ_MODE_EN,
+			 enable, card->ext_csd.generic_cmd6_time);
+	if (err) {
+		pr_err("%s: turning command queueing %s failed %d\n",
+		       mmc_hostname(host), enable ? "on" : "off", err);
+		return err;
+	}
+
+	if (enable) {
+		mmc_host_clk_hold(host);
+		err = host->cmdq_ops->enable(host);
+		mmc_host_clk_release(host);
+		if (err) {
+			mmc_switch(card, EXT_CSD_CMD_SET_NORMAL,
+				   EXT_CSD_CMDQ_MODE_EN, 0,
+				   card->ext_csd.generic_cmd6_time);
+			return err;
+		}
+		mmc_card_set_cmdq(card);
+	}
+	return 0;
+}
+EXPORT_SYMBOL(mmc_cmdq_switch);
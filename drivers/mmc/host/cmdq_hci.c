@@ -0,0 +1,496 @@
+/*
+ * Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * Command queue engine of eMMC 5.1 host controllers. The engine fetches
+ * tasks from a descriptor list in memory, sends CMD44/CMD45 for them and
+ * executes whichever the device reports ready, so the block layer can
+ * keep up to 32 requests queued on the card.
+ *
+ * The engine is kept halted while no task is queued: a halted engine lets
+ * the controller send legacy commands, which is what everything but
+ * read/write I/O still uses. Direct commands (DCMD) are not used, so all
+ * 32 slots carry data.
+ */
+
+#include <linux/dma-mapping.h>
+#include <linux/io.h>
+#include <linux/module.h>
+#include <linux/scatterlist.h>
+#include <linux/slab.h>
+#include <linux/mmc/card.h>
+#include <linux/mmc/core.h>
+#include <linux/mmc/host.h>
+
+#include "cmdq_hci.h"
+
+static inline u32 cmdq_readl(struct cmdq_host *cq_host, int reg)
+{
+	return readl_relaxed(cq_host->mmio + reg);
+}
+
+static inline void cmdq_writel(struct cmdq_host *cq_host, u32 val, int reg)
+{
+	writel_relaxed(val, cq_host->mmio + reg);
+}
+
+static inline u8 *get_desc(struct cmdq_host *cq_host, unsigned int tag)
+{
+	return cq_host->desc_base + tag * cq_host->slot_sz;
+}
+
+static inline u8 *get_link_desc(struct cmdq_host *cq_host, unsigned int tag)
+{
+	return get_desc(cq_host, tag) + cq_host->task_desc_len;
+}
+
+static inline size_t trans_desc_slot_sz(struct cmdq_host *cq_host)
+{
+	return cq_host->trans_desc_len * CMDQ_MAX_SEGS;
+}
+
+static inline u8 *get_trans_desc(struct cmdq_host *cq_host, unsigned int tag)
+{
+	return cq_host->trans_desc_base + tag * trans_desc_slot_sz(cq_host);
+}
+
+static inline dma_addr_t get_trans_desc_dma(struct cmdq_host *cq_host,
+					    unsigned int tag)
+{
+	return cq_host->trans_desc_dma_base + tag * trans_desc_slot_sz(cq_host);
+}
+
+static void cmdq_dumpregs(struct cmdq_host *cq_host)
+{
+	struct mmc_host *mmc = cq_host->mmc;
+
+	pr_info("%s: ========== CMDQ REGISTER DUMP ==========\n",
+		mmc_hostname(mmc));
+	pr_info("%s: Caps: 0x%08x | Version: 0x%08x\n", mmc_hostname(mmc),
+		cmdq_readl(cq_host, CQCAP), cmdq_readl(cq_host, CQVER));
+	pr_info("%s: Config: 0x%08x | Control: 0x%08x\n", mmc_hostname(mmc),
+		cmdq_readl(cq_host, CQCFG), cmdq_readl(cq_host, CQCTL));
+	pr_info("%s: Int stat: 0x%08x | Int enab: 0x%08x\n", mmc_hostname(mmc),
+		cmdq_readl(cq_host, CQIS), cmdq_readl(cq_host, CQISTE));
+	pr_info("%s: Int sig: 0x%08x | Int Coal: 0x%08x\n", mmc_hostname(mmc),
+		cmdq_readl(cq_host, CQISGE), cmdq_readl(cq_host, CQIC));
+	pr_info("%s: TDL base: 0x%08x | TDL up32: 0x%08x\n", mmc_hostname(mmc),
+		cmdq_readl(cq_host, CQTDLBA), cmdq_readl(cq_host, CQTDLBAU));
+	pr_info("%s: Doorbell: 0x%08x | Comp Notif: 0x%08x\n",
+		mmc_hostname(mmc), cmdq_readl(cq_host, CQTDBR),
+		cmdq_readl(cq_host, CQTCN));
+	pr_info("%s: Dev queue: 0x%08x | Dev Pend: 0x%08x\n", mmc_hostname(mmc),
+		cmdq_readl(cq_host, CQDQS), cmdq_readl(cq_host, CQDPT));
+	pr_info("%s: Task clr: 0x%08x | Send stat 1: 0x%08x\n",
+		mmc_hostname(mmc), cmdq_readl(cq_host, CQTCLR),
+		cmdq_readl(cq_host, CQSSC1));
+	pr_info("%s: Send stat 2: 0x%08x | DCMD resp: 0x%08x\n",
+		mmc_hostname(mmc), cmdq_readl(cq_host, CQSSC2),
+		cmdq_readl(cq_host, CQCRDCT));
+	pr_info("%s: Resp err mask: 0x%08x | Task err: 0x%08x\n",
+		mmc_hostname(mmc), cmdq_readl(cq_host, CQRMEM),
+		cmdq_readl(cq_host, CQTERRI));
+	pr_info("%s: Resp idx 0x%08x | Resp arg: 0x%08x\n", mmc_hostname(mmc),
+		cmdq_readl(cq_host, CQCRI), cmdq_readl(cq_host, CQCRA));
+	pr_info("%s: ===========================================\n",
+		mmc_hostname(mmc));
+
+	if (cq_host->ops->dumpregs)
+		cq_host->ops->dumpregs(mmc);
+}
+
+static int cmdq_alloc_desc(struct cmdq_host *cq_host)
+{
+	struct device *dev = mmc_dev(cq_host->mmc);
+	size_t desc_size, trans_size;
+
+	if (cq_host->desc_base)
+		return 0;
+
+	desc_size = cq_host->slot_sz * CMDQ_NUM_SLOTS;
+	trans_size = trans_desc_slot_sz(cq_host) * CMDQ_NUM_SLOTS;
+
+	cq_host->desc_base = dmam_alloc_coherent(dev, desc_size,
+						 &cq_host->desc_dma_base,
+						 GFP_KERNEL);
+	cq_host->trans_desc_base = dmam_alloc_coherent(dev, trans_size,
+					&cq_host->trans_desc_dma_base,
+					GFP_KERNEL);
+	if (!cq_host->desc_base || !cq_host->trans_desc_base) {
+		if (cq_host->desc_base)
+			dmam_free_coherent(dev, desc_size, cq_host->desc_base,
+					   cq_host->desc_dma_base);
+		if (cq_host->trans_desc_base)
+			dmam_free_coherent(dev, trans_size,
+					   cq_host->trans_desc_base,
+					   cq_host->trans_desc_dma_base);
+		cq_host->desc_base = NULL;
+		cq_host->trans_desc_base = NULL;
+		return -ENOMEM;
+	}
+
+	memset(cq_host->desc_base, 0, desc_size);
+	return 0;
+}
+
+/* point the link descriptor of every slot at the slot's transfer list */
+static void cmdq_setup_links(struct cmdq_host *cq_host)
+{
+	dma_addr_t trans;
+	__le32 *link;
+	unsigned int i;
+
+	for (i = 0; i < CMDQ_NUM_SLOTS; i++) {
+		link = (__le32 *)get_link_desc(cq_host, i);
+		trans = get_trans_desc_dma(cq_host, i);
+		link[0] = cpu_to_le32(VALID(1) | ACT(0x6) | END(0));
+		if (cq_host->dma64)
+			*(__le64 *)(link + 1) = cpu_to_le64(trans);
+		else
+			link[1] = cpu_to_le32(trans);
+	}
+}
+
+static int cmdq_enable(struct mmc_host *mmc)
+{
+	struct cmdq_host *cq_host = mmc->cmdq_private;
+	unsigned long flags;
+	u32 cqcfg;
+	int err;
+
+	if (cq_host->enabled)
+		return 0;
+
+	err = cmdq_alloc_desc(cq_host);
+	if (err)
+		return err;
+	cmdq_setup_links(cq_host);
+
+	cqcfg = cq_host->task_desc_len == 16 ? CQ_TASK_DESC_SZ : 0;
+	cmdq_writel(cq_host, cqcfg, CQCFG);
+
+	cmdq_writel(cq_host, lower_32_bits(cq_host->desc_dma_base), CQTDLBA);
+	cmdq_writel(cq_host, upper_32_bits(cq_host->desc_dma_base), CQTDLBAU);
+	cmdq_writel(cq_host, mmc->card->rca, CQSSC2);
+
+	cmdq_writel(cq_host, CQIS_MASK, CQISTE);
+	cmdq_writel(cq_host, CQIS_MASK, CQISGE);
+
+	/* come up halted, the first request resumes the engine */
+	cmdq_writel(cq_host, cqcfg | CQ_ENABLE, CQCFG);
+	cmdq_writel(cq_host, HALT, CQCTL);
+	/* make sure the engine is set up before it is used */
+	mb();
+
+	spin_lock_irqsave(&cq_host->lock, flags);
+	cq_host->enabled = true;
+	cq_host->halted = true;
+	cq_host->err = false;
+	spin_unlock_irqrestore(&cq_host->lock, flags);
+	return 0;
+}
+
+static int cmdq_halt(struct mmc_host *mmc, bool halt)
+{
+	struct cmdq_host *cq_host = mmc->cmdq_private;
+	unsigned long flags;
+	bool done;
+
+	if (halt == cq_host->halted)
+		return 0;
+
+	if (!halt) {
+		cmdq_writel(cq_host, CQIS_MASK, CQIS);
+		cq_host->ops->enable(mmc);
+		spin_lock_irqsave(&cq_host->lock, flags);
+		cq_host->halted = false;
+		spin_unlock_irqrestore(&cq_host->lock, flags);
+		cmdq_writel(cq_host, cmdq_readl(cq_host, CQCTL) & ~HALT, CQCTL);
+		return 0;
+	}
+
+	spin_lock_irqsave(&cq_host->lock, flags);
+	cq_host->halted = true;
+	spin_unlock_irqrestore(&cq_host->lock, flags);
+
+	INIT_COMPLETION(cq_host->halt_comp);
+	cmdq_writel(cq_host, cmdq_readl(cq_host, CQCTL) | HALT, CQCTL);
+	done = wait_for_completion_timeout(&cq_host->halt_comp,
+				msecs_to_jiffies(CMDQ_HALT_TIMEOUT_MS));
+	if (!done && !(cmdq_readl(cq_host, CQCTL) & HALT)) {
+		pr_err("%s: %s: command queue engine did not halt\n",
+		       mmc_hostname(mmc), __func__);
+		cmdq_dumpregs(cq_host);
+		cq_host->ops->disable(mmc, true);
+		return -ETIMEDOUT;
+	}
+
+	cq_host->ops->disable(mmc, false);
+	return 0;
+}
+
+static void cmdq_disable(struct mmc_host *mmc)
+{
+	struct cmdq_host *cq_host = mmc->cmdq_private;
+	struct mmc_request *mrq;
+	unsigned long flags;
+	unsigned int tag;
+
+	if (!cq_host->enabled)
+		return;
+
+	cmdq_halt(mmc, true);
+	cmdq_writel(cq_host, cmdq_readl(cq_host, CQCTL) | CLEAR_ALL_TASKS,
+		    CQCTL);
+	cmdq_writel(cq_host, 0, CQCFG);
+	cmdq_writel(cq_host, 0, CQISTE);
+	cmdq_writel(cq_host, 0, CQISGE);
+	cmdq_writel(cq_host, CQIS_MASK, CQIS);
+
+	/* whatever was still queued is handed back to be issued again */
+	for (tag = 0; tag < CMDQ_NUM_SLOTS; tag++) {
+		spin_lock_irqsave(&cq_host->lock, flags);
+		mrq = cq_host->mrq_slot[tag];
+		cq_host->mrq_slot[tag] = NULL;
+		spin_unlock_irqrestore(&cq_host->lock, flags);
+		if (mrq) {
+			mrq->data->error = -EAGAIN;
+			mrq->done(mrq);
+		}
+	}
+
+	spin_lock_irqsave(&cq_host->lock, flags);
+	cq_host->enabled = false;
+	cq_host->err = false;
+	spin_unlock_irqrestore(&cq_host->lock, flags);
+}
+
+static void cmdq_prep_task_desc(struct cmdq_host *cq_host,
+				struct mmc_request *mrq)
+{
+	struct mmc_cmdq_req *cqr = mrq->cmdq_req;
+	unsigned int flags = cqr->flags;
+	__le64 *task = (__le64 *)get_desc(cq_host, cqr->tag);
+
+	*task = cpu_to_le64(VALID(1) | END(1) | INT(1) | ACT(0x5) |
+			FORCED_PROG(!!(flags & MMC_CMDQ_FORCED_PRG)) |
+			CONTEXT(0) |
+			DATA_TAG(!!(flags & MMC_CMDQ_DATA_TAG)) |
+			DATA_DIR(!!(flags & MMC_CMDQ_READ)) |
+			PRIORITY(!!(flags & MMC_CMDQ_PRIO)) |
+			QBAR(0) |
+			REL_WRITE(!!(flags & MMC_CMDQ_REL_WR)) |
+			BLK_COUNT(mrq->data->blocks) |
+			BLK_ADDR(cqr->blk_addr));
+}
+
+static int cmdq_prep_trans_desc(struct cmdq_host *cq_host,
+				struct mmc_request *mrq)
+{
+	struct mmc_data *data = mrq->data;
+	struct scatterlist *sg;
+	__le32 *desc;
+	int i, sg_count;
+
+	sg_count = dma_map_sg(mmc_dev(cq_host->mmc), data->sg, data->sg_len,
+			      (data->flags & MMC_DATA_READ) ?
+			      DMA_FROM_DEVICE : DMA_TO_DEVICE);
+	if (!sg_count)
+		return -ENOMEM;
+	if (sg_count > CMDQ_MAX_SEGS) {
+		dma_unmap_sg(mmc_dev(cq_host->mmc), data->sg, data->sg_len,
+			     (data->flags & MMC_DATA_READ) ?
+			     DMA_FROM_DEVICE : DMA_TO_DEVICE);
+		return -EINVAL;
+	}
+
+	desc = (__le32 *)get_trans_desc(cq_host, mrq->cmdq_req->tag);
+	for_each_sg(data->sg, sg, sg_count, i) {
+		desc[0] = cpu_to_le32(VALID(1) | END(i == sg_count - 1) |
+				INT(0) | ACT(0x4) | DAT_LENGTH(sg_dma_len(sg)));
+		if (cq_host->dma64)
+			*(__le64 *)(desc + 1) =
+				cpu_to_le64(sg_dma_address(sg));
+		else
+			desc[1] = cpu_to_le32(sg_dma_address(sg));
+		desc += cq_host->trans_desc_len / sizeof(*desc);
+	}
+	return 0;
+}
+
+static int cmdq_request(struct mmc_host *mmc, struct mmc_request *mrq)
+{
+	struct cmdq_host *cq_host = mmc->cmdq_private;
+	unsigned int tag = mrq->cmdq_req->tag;
+	unsigned long flags;
+	int err;
+
+	if (tag >= CMDQ_NUM_SLOTS)
+		return -EINVAL;
+
+	spin_lock_irqsave(&cq_host->lock, flags);
+	if (!cq_host->enabled || cq_host->halted || cq_host->err ||
+	    cq_host->mrq_slot[tag]) {
+		spin_unlock_irqrestore(&cq_host->lock, flags);
+		return -EBUSY;
+	}
+
+	err = cmdq_prep_trans_desc(cq_host, mrq);
+	if (err) {
+		spin_unlock_irqrestore(&cq_host->lock, flags);
+		return err;
+	}
+	cmdq_prep_task_desc(cq_host, mrq);
+	cq_host->mrq_slot[tag] = mrq;
+	/* the descriptors must be in memory before the doorbell rings */
+	wmb();
+	cmdq_writel(cq_host, 1 << tag, CQTDBR);
+	spin_unlock_irqrestore(&cq_host->lock, flags);
+	return 0;
+}
+
+static void cmdq_post_req(struct mmc_host *mmc, struct mmc_request *mrq,
+			  int err)
+{
+	struct mmc_data *data = mrq->data;
+
+	dma_unmap_sg(mmc_dev(mmc), data->sg, data->sg_len,
+		     (data->flags & MMC_DATA_READ) ?
+		     DMA_FROM_DEVICE : DMA_TO_DEVICE);
+}
+
+static void cmdq_finish_data(struct cmdq_host *cq_host, unsigned int tag,
+			     int err)
+{
+	struct mmc_request *mrq;
+
+	spin_lock(&cq_host->lock);
+	mrq = cq_host->mrq_slot[tag];
+	cq_host->mrq_slot[tag] = NULL;
+	spin_unlock(&cq_host->lock);
+
+	if (!mrq)
+		return;
+
+	mrq->data->error = err;
+	if (!err)
+		mrq->data->bytes_xfered = mrq->data->blksz * mrq->data->blocks;
+	mrq->done(mrq);
+}
+
+static void cmdq_handle_error(struct cmdq_host *cq_host, int err)
+{
+	u32 terri = cmdq_readl(cq_host, CQTERRI);
+	unsigned int tag;
+
+	pr_err("%s: command queue error %d, task error info 0x%08x\n",
+	       mmc_hostname(cq_host->mmc), err, terri);
+	cmdq_dumpregs(cq_host);
+
+	/* nothing is issued until the block layer has switched us off */
+	spin_lock(&cq_host->lock);
+	cq_host->err = true;
+	spin_unlock(&cq_host->lock);
+
+	if (terri & CQ_DTEFV) {
+		cmdq_finish_data(cq_host, CQ_DTETID(terri), err);
+	} else if (terri & CQ_RMEFV) {
+		cmdq_finish_data(cq_host, CQ_RMETID(terri), err);
+	} else {
+		for (tag = 0; tag < CMDQ_NUM_SLOTS; tag++)
+			cmdq_finish_data(cq_host, tag, err);
+	}
+}
+
+/**
+ * cmdq_irq - handle a command queue engine interrupt
+ * @mmc: host the engine belongs to
+ * @err: error the host controller reported along with it, or 0
+ *
+ * Called by the host controller driver, from its interrupt handler,
+ * while it has the engine enabled.
+ */
+irqreturn_t cmdq_irq(struct mmc_host *mmc, int err)
+{
+	struct cmdq_host *cq_host = mmc->cmdq_private;
+	unsigned long comp;
+	unsigned int tag;
+	u32 status;
+
+	status = cmdq_readl(cq_host, CQIS);
+	cmdq_writel(cq_host, status, CQIS);
+
+	if (err || (status & CQIS_RED))
+		cmdq_handle_error(cq_host, err ? err : -EIO);
+
+	if (status & CQIS_TCC) {
+		comp = cmdq_readl(cq_host, CQTCN);
+		cmdq_writel(cq_host, comp, CQTCN);
+		for_each_set_bit(tag, &comp, CMDQ_NUM_SLOTS)
+			cmdq_finish_data(cq_host, tag, 0);
+	}
+
+	if (status & CQIS_HAC)
+		complete(&cq_host->halt_comp);
+
+	return status || err ? IRQ_HANDLED : IRQ_NONE;
+}
+EXPORT_SYMBOL(cmdq_irq);
+
+static const struct mmc_cmdq_host_ops cmdq_host_ops = {
+	.enable		= cmdq_enable,
+	.disable	= cmdq_disable,
+	.request	= cmdq_request,
+	.post_req	= cmdq_post_req,
+	.halt		= cmdq_halt,
+};
+
+/**
+ * cmdq_init - set up the command queue engine of a host
+ * @mmc: host the engine belongs to
+ * @mmio: the engine's registers
+ * @dma64: whether the controller does 64-bit DMA
+ * @ops: hooks into the host controller driver
+ *
+ * The descriptor lists are allocated on first enable, so hosts that never
+ * see a command queueing card do not pay for them.
+ */
+struct cmdq_host *cmdq_init(struct mmc_host *mmc, void __iomem *mmio,
+			    bool dma64, const struct cmdq_host_ops *ops)
+{
+	struct cmdq_host *cq_host;
+
+	cq_host = devm_kzalloc(mmc_dev(mmc), sizeof(*cq_host), GFP_KERNEL);
+	if (!cq_host)
+		return ERR_PTR(-ENOMEM);
+
+	cq_host->mmc = mmc;
+	cq_host->mmio = mmio;
+	cq_host->ops = ops;
+	cq_host->dma64 = dma64;
+	spin_lock_init(&cq_host->lock);
+	init_completion(&cq_host->halt_comp);
+
+	cq_host->task_desc_len = dma64 ? 16 : 8;
+	cq_host->link_desc_len = dma64 ? 16 : 8;
+	cq_host->trans_desc_len = dma64 ? 16 : 8;
+	cq_host->slot_sz = cq_host->task_desc_len + cq_host->link_desc_len;
+
+	mmc->cmdq_private = cq_host;
+	mmc->cmdq_ops = &cmdq_host_ops;
+	mmc->cmdq_slots = CMDQ_NUM_SLOTS;
+	mmc->cmdq_max_segs = CMDQ_MAX_SEGS;
+
+	pr_info("%s: command queue engine version 0x%08x\n",
+		mmc_hostname(mmc), cmdq_readl(cq_host, CQVER));
+	return cq_host;
+}
+EXPORT_SYMBOL(cmdq_init);
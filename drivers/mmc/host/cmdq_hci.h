@@ -0,0 +1,145 @@
+/*
+ * Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+#ifndef LINUX_MMC_CQ_HCI_H
+#define LINUX_MMC_CQ_HCI_H
+
+#include <linux/completion.h>
+#include <linux/err.h>
+#include <linux/interrupt.h>
+#include <linux/spinlock.h>
+#include <linux/mmc/host.h>
+
+/* registers */
+#define CQVER		0x00
+#define CQCAP		0x04
+#define CQCFG		0x08
+#define  CQ_DCMD		0x00001000
+#define  CQ_TASK_DESC_SZ	0x00000100
+#define  CQ_ENABLE		0x00000001
+
+#define CQCTL		0x0C
+#define  CLEAR_ALL_TASKS	0x00000100
+#define  HALT			0x00000001
+
+#define CQIS		0x10
+#define CQISTE		0x14
+#define CQISGE		0x18
+#define CQIC		0x1C
+#define  CQIS_HAC		(1 << 0)	/* halt complete */
+#define  CQIS_TCC		(1 << 1)	/* task complete */
+#define  CQIS_RED		(1 << 2)	/* response error */
+#define  CQIS_TCL		(1 << 3)	/* task cleared */
+#define  CQIS_MASK		(CQIS_HAC | CQIS_TCC | CQIS_RED | CQIS_TCL)
+
+#define CQTDLBA		0x20
+#define CQTDLBAU	0x24
+#define CQTDBR		0x28
+#define CQTCN		0x2C
+#define CQDQS		0x30
+#define CQDPT		0x34
+#define CQTCLR		0x38
+#define CQSSC1		0x40
+#define CQSSC2		0x44
+#define CQCRDCT		0x48
+#define CQRMEM		0x50
+
+#define CQTERRI		0x54
+#define  CQ_RMETID(x)		(((x) >> 8) & 0x1F)
+#define  CQ_RMEFV		(1 << 15)
+#define  CQ_DTETID(x)		(((x) >> 24) & 0x1F)
+#define  CQ_DTEFV		(1 << 31)
+
+#define CQCRI		0x58
+#define CQCRA		0x5C
+
+/* task descriptor fields */
+#define VALID(x)	(((x) & 1) << 0)
+#define END(x)		(((x) & 1) << 1)
+#define INT(x)		(((x) & 1) << 2)
+#define ACT(x)		(((x) & 7) << 3)
+#define FORCED_PROG(x)	(((x) & 1) << 6)
+#define CONTEXT(x)	(((x) & 0xF) << 7)
+#define DATA_TAG(x)	(((x) & 1) << 11)
+#define DATA_DIR(x)	(((x) & 1) << 12)
+#define PRIORITY(x)	(((x) & 1) << 13)
+#define QBAR(x)		(((x) & 1) << 14)
+#define REL_WRITE(x)	(((x) & 1) << 15)
+#define BLK_COUNT(x)	(((u64)(x) & 0xFFFF) << 16)
+#define BLK_ADDR(x)	(((u64)(x) & 0xFFFFFFFF) << 32)
+
+/* transfer and link descriptor fields */
+#define DAT_LENGTH(x)	(((x) & 0xFFFF) << 16)
+
+#define CMDQ_NUM_SLOTS		32
+#define CMDQ_MAX_SEGS		128
+#define CMDQ_HALT_TIMEOUT_MS	100
+
+struct cmdq_host;
+
+/*
+ * Hooks into the SD host controller the engine sits on. 'enable' routes
+ * the controller interrupts to cmdq_irq() and sets up its DMA mode for
+ * the engine, 'disable' returns both to legacy commands.
+ */
+struct cmdq_host_ops {
+	void (*enable)(struct mmc_host *mmc);
+	void (*disable)(struct mmc_host *mmc, bool recovery);
+	void (*dumpregs)(struct mmc_host *mmc);
+};
+
+struct cmdq_host {
+	const struct cmdq_host_ops *ops;
+	void __iomem *mmio;
+	struct mmc_host *mmc;
+
+	spinlock_t lock;		/* mrq_slot, the state below */
+	bool enabled;
+	bool halted;
+	bool err;			/* failed task, waiting for disable */
+	bool dma64;
+
+	/* task descriptor list, one task and one link descriptor a slot */
+	u8 *desc_base;
+	dma_addr_t desc_dma_base;
+	unsigned int task_desc_len;
+	unsigned int link_desc_len;
+	unsigned int slot_sz;
+
+	/* CMDQ_MAX_SEGS transfer descriptors for every slot */
+	u8 *trans_desc_base;
+	dma_addr_t trans_desc_dma_base;
+	unsigned int trans_desc_len;
+
+	struct mmc_request *mrq_slot[CMDQ_NUM_SLOTS];
+	struct completion halt_comp;
+};
+
+#ifdef CONFIG_MMC_CQ_HCI
+extern struct cmdq_host *cmdq_init(struct mmc_host *mmc, void __iomem *mmio,
+				   bool dma64, const struct cmdq_host_ops *ops);
+extern irqreturn_t cmdq_irq(struct mmc_host *mmc, int err);
+#else
+static inline struct cmdq_host *cmdq_init(struct mmc_host *mmc,
+					  void __iomem *mmio, bool dma64,
+					  const struct cmdq_host_ops *ops)
+{
+	return ERR_PTR(-ENODEV);
+}
+
+static inline irqreturn_t cmdq_irq(struct mmc_host *mmc, int err)
+{
+	return IRQ_NONE;
+}
+#endif
+
+#endif /* LINUX_MMC_CQ_HCI_H */
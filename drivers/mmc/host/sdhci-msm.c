@@ -3540,6 +3540,9 @@ static int sdhci_msm_probe(struct platform_device *pdev)
 	struct sdhci_pltfm_host *pltfm_host;
 	struct sdhci_msm_host *msm_host;
 	struct resource *core_memres = NULL;
+#ifdef CONFIG_MMC_CQ_HCI
+	struct resource *cmdq_memres;
+#endif
 	int ret = 0, dead = 0;
 	u16 host_version;
 	u32 pwr, irq_status, irq_ctl;
@@ -3833,6 +3836,20 @@ static int sdhci_msm_probe(struct platform_device *pdev)
 	if (msm_host->pdata->nonhotplug)
 		msm_host->mmc->caps2 |= MMC_CAP2_NONHOTPLUG;
 
+#ifdef CONFIG_MMC_CQ_HCI
+	/* controllers with a command queue engine expose its registers */
+	cmdq_memres = platform_get_resource_byname(pdev, IORESOURCE_MEM,
+						   "cmdq_mem");
+	if (cmdq_memres) {
+		host->cq_mmio = devm_ioremap(&pdev->dev, cmdq_memres->start,
+					     resource_size(cmdq_memres));
+		if (host->cq_mmio)
+			msm_host->mmc->caps2 |= MMC_CAP2_CMD_QUEUE;
+		else
+			dev_err(&pdev->dev, "Failed to remap cmdq registers\n");
+	}
+#endif
+
 	host->cpu_dma_latency_us = msm_host->pdata->cpu_dma_latency_us;
 	host->cpu_dma_latency_tbl_sz = msm_host->pdata->cpu_dma_latency_tbl_sz;
 	host->pm_qos_req_dma.type = msm_host->pdata->cpu_affinity_type;
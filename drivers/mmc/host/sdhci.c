@@ -34,6 +34,7 @@
 #include <trace/events/mmc.h>
 
 #include "sdhci.h"
+#include "cmdq_hci.h"
 
 #define DRIVER_NAME "sdhci"
 #define SDHCI_SUSPEND_TIMEOUT 300 /* 300 ms */
@@ -642,6 +643,53 @@ static int sdhci_pre_dma_transfer(struct sdhci_host *host,
 	return sg_count;
 }
 
+static void sdhci_adma_table_end(struct sdhci_host *host, u8 *table,
+				 u8 *desc)
+{
+	if (host->quirks & SDHCI_QUIRK_NO_ENDATTR_IN_NOPDESC) {
+		/*
+		* Mark the last descriptor as the terminating descriptor
+		*/
+		if (desc != table) {
+			desc -= host->adma_desc_line_sz;
+			desc[0] |= 0x2; /* end */
+		}
+	} else {
+		/*
+		* Add a terminating entry.
+		*/
+
+		/* nop, end, valid */
+		sdhci_set_adma_desc(host, desc, 0, 0, 0x3);
+	}
+}
+
+/*
+ * Write the table of the request after the current one into the spare
+ * table, called from pre_req with the data already mapped. Only used when
+ * no alignment fixups are needed, those share the one bounce buffer.
+ */
+static void sdhci_adma_table_prepare_next(struct sdhci_host *host,
+					  struct mmc_data *data)
+{
+	u8 *desc = host->adma_desc_next;
+	struct scatterlist *sg;
+	int i, len;
+
+	for_each_sg(data->sg, sg, host->next_data.sg_count, i) {
+		len = sg_dma_len(sg);
+		BUG_ON(len > 65536);
+		if (len) {
+			/* tran, valid */
+			sdhci_set_adma_desc(host, desc, sg_dma_address(sg),
+					    len, 0x21);
+			desc += host->adma_desc_line_sz;
+		}
+	}
+	sdhci_adma_table_end(host, host->adma_desc_next, desc);
+	host->next_data.adma_cookie = data->host_cookie;
+}
+
 static int sdhci_adma_table_pre(struct sdhci_host *host,
 	struct mmc_data *data)
 {
@@ -656,15 +704,28 @@ static int sdhci_adma_table_pre(struct sdhci_host *host,
 	char *buffer;
 	unsigned long flags;
 
+	bool prepared;
+
 	/*
 	 * The spec does not specify endianness of descriptor table.
 	 * We currently guess that it is LE.
 	 */
 
+	prepared = host->adma_desc_next && data->host_cookie &&
+		   data->host_cookie == host->next_data.adma_cookie;
+	host->next_data.adma_cookie = 0;
+
 	host->sg_count = sdhci_pre_dma_transfer(host, data, NULL);
 	if (host->sg_count < 0)
 		goto fail;
 
+	/* pre_req wrote our table already, make it the current one */
+	if (prepared && data->host_cookie) {
+		swap(host->adma_desc, host->adma_desc_next);
+		swap(host->adma_addr, host->adma_addr_next);
+		return 0;
+	}
+
 	desc = host->adma_desc;
 	align = host->align_buffer;
 
@@ -732,22 +793,7 @@ static int sdhci_adma_table_pre(struct sdhci_host *host,
 
 	}
 
-	if (host->quirks & SDHCI_QUIRK_NO_ENDATTR_IN_NOPDESC) {
-		/*
-		* Mark the last descriptor as the terminating descriptor
-		*/
-		if (desc != host->adma_desc) {
-			desc -= host->adma_desc_line_sz;
-			desc[0] |= 0x2; /* end */
-		}
-	} else {
-		/*
-		* Add a terminating entry.
-		*/
-
-		/* nop, end, valid */
-		sdhci_set_adma_desc(host, desc, 0, 0, 0x3);
-	}
+	sdhci_adma_table_end(host, host->adma_desc, desc);
 
 	return 0;
 
@@ -1679,9 +1725,12 @@ static void sdhci_pre_req(struct mmc_host *mmc, struct mmc_request *mrq,
 		return;
 	}
 
-	if (host->flags & SDHCI_REQ_USE_DMA)
+	if (host->flags & SDHCI_REQ_USE_DMA) {
 		if (sdhci_pre_dma_transfer(host, mrq->data, &host->next_data) < 0)
 			mrq->data->host_cookie = 0;
+		else if (host->adma_desc_next && (host->flags & SDHCI_USE_ADMA))
+			sdhci_adma_table_prepare_next(host, mrq->data);
+	}
 }
 
 static void sdhci_post_req(struct mmc_host *mmc, struct mmc_request *mrq,
@@ -3179,6 +3228,111 @@ static void sdhci_data_irq(struct sdhci_host *host, u32 intmask)
 	}
 }
 
+#ifdef CONFIG_MMC_CQ_HCI
+static irqreturn_t sdhci_cmdq_irq(struct sdhci_host *host, u32 intmask)
+{
+	int err = 0;
+
+	if (intmask & SDHCI_INT_CMD_MASK)
+		err = (intmask & SDHCI_INT_TIMEOUT) ? -ETIMEDOUT : -EILSEQ;
+	else if (intmask & (SDHCI_INT_DATA_TIMEOUT | SDHCI_INT_ADMA_ERROR))
+		err = (intmask & SDHCI_INT_DATA_TIMEOUT) ? -ETIMEDOUT : -EIO;
+	else if (intmask & (SDHCI_INT_DATA_CRC | SDHCI_INT_DATA_END_BIT))
+		err = -EILSEQ;
+
+	if (err)
+		pr_err("%s: command queue error interrupt 0x%08x\n",
+		       mmc_hostname(host->mmc), intmask);
+
+	return cmdq_irq(host->mmc, err);
+}
+
+/* hand the controller to the command queue engine */
+static void sdhci_cmdq_enable(struct mmc_host *mmc)
+{
+	struct sdhci_host *host = mmc_priv(mmc);
+	unsigned long flags;
+	u8 ctrl;
+
+	spin_lock_irqsave(&host->lock, flags);
+	if (host->cqe_on)
+		goto out;
+
+	ctrl = sdhci_readb(host, SDHCI_HOST_CONTROL);
+	ctrl &= ~SDHCI_CTRL_DMA_MASK;
+	if (host->flags & SDHCI_USE_ADMA_64BIT)
+		ctrl |= SDHCI_CTRL_ADMA64;
+	else
+		ctrl |= SDHCI_CTRL_ADMA32;
+	sdhci_writeb(host, ctrl, SDHCI_HOST_CONTROL);
+
+	sdhci_writew(host, SDHCI_MAKE_BLKSZ(SDHCI_DEFAULT_BOUNDARY_ARG, 512),
+		     SDHCI_BLOCK_SIZE);
+	sdhci_writeb(host, 0xE, SDHCI_TIMEOUT_CONTROL);
+
+	host->cq_saved_ier = sdhci_readl(host, SDHCI_INT_ENABLE);
+	sdhci_clear_set_irqs(host, SDHCI_INT_ALL_MASK, SDHCI_INT_CQE_MASK);
+	host->cqe_on = true;
+out:
+	spin_unlock_irqrestore(&host->lock, flags);
+}
+
+static void sdhci_cmdq_disable(struct mmc_host *mmc, bool recovery)
+{
+	struct sdhci_host *host = mmc_priv(mmc);
+	unsigned long flags;
+
+	spin_lock_irqsave(&host->lock, flags);
+	if (!host->cqe_on)
+		goto out;
+
+	host->cqe_on = false;
+	if (recovery)
+		sdhci_reset(host, SDHCI_RESET_CMD | SDHCI_RESET_DATA);
+	sdhci_writel(host, SDHCI_INT_CQE_MASK, SDHCI_INT_STATUS);
+	sdhci_clear_set_irqs(host, SDHCI_INT_ALL_MASK, host->cq_saved_ier);
+out:
+	spin_unlock_irqrestore(&host->lock, flags);
+}
+
+static void sdhci_cmdq_dumpregs(struct mmc_host *mmc)
+{
+	sdhci_dumpregs(mmc_priv(mmc));
+}
+
+static const struct cmdq_host_ops sdhci_cmdq_ops = {
+	.enable		= sdhci_cmdq_enable,
+	.disable	= sdhci_cmdq_disable,
+	.dumpregs	= sdhci_cmdq_dumpregs,
+};
+
+static void sdhci_cmdq_init(struct sdhci_host *host)
+{
+	struct mmc_host *mmc = host->mmc;
+
+	if (!host->cq_mmio || !(mmc->caps2 & MMC_CAP2_CMD_QUEUE) ||
+	    !(host->flags & SDHCI_USE_ADMA)) {
+		mmc->caps2 &= ~MMC_CAP2_CMD_QUEUE;
+		return;
+	}
+
+	host->cq_host = cmdq_init(mmc, host->cq_mmio,
+				  !!(host->flags & SDHCI_USE_ADMA_64BIT),
+				  &sdhci_cmdq_ops);
+	if (IS_ERR(host->cq_host)) {
+		pr_err("%s: command queue engine init failed %ld\n",
+		       mmc_hostname(mmc), PTR_ERR(host->cq_host));
+		host->cq_host = NULL;
+		mmc->caps2 &= ~MMC_CAP2_CMD_QUEUE;
+	}
+}
+#else
+static inline void sdhci_cmdq_init(struct sdhci_host *host)
+{
+	host->mmc->caps2 &= ~MMC_CAP2_CMD_QUEUE;
+}
+#endif
+
 static irqreturn_t sdhci_irq(int irq, void *dev_id)
 {
 	irqreturn_t result;
@@ -3228,6 +3382,14 @@ static irqreturn_t sdhci_irq(int irq, void *dev_id)
 		goto out;
 	}
 
+#ifdef CONFIG_MMC_CQ_HCI
+	if (host->cqe_on) {
+		sdhci_writel(host, intmask, SDHCI_INT_STATUS);
+		spin_unlock(&host->lock);
+		return sdhci_cmdq_irq(host, intmask);
+	}
+#endif
+
 again:
 	DBG("*** %s got interrupt: 0x%08x\n",
 		mmc_hostname(host->mmc), intmask);
@@ -3729,6 +3891,28 @@ int sdhci_add_host(struct sdhci_host *host)
 			host->adma_desc = NULL;
 			host->align_buffer = NULL;
 		}
+
+		/*
+		 * Without alignment fixups a table only depends on its own
+		 * request, so the next one can be written while the current
+		 * one is in flight.
+		 */
+		if (host->adma_desc &&
+		    (host->quirks2 & SDHCI_QUIRK2_ADMA_SKIP_DATA_ALIGNMENT)) {
+			host->adma_desc_next = dma_alloc_coherent(
+						mmc_dev(host->mmc),
+						host->adma_desc_sz,
+						&host->adma_addr_next,
+						GFP_KERNEL);
+			if (host->adma_desc_next &&
+			    (host->adma_addr_next & (host->align_bytes - 1))) {
+				dma_free_coherent(mmc_dev(host->mmc),
+						  host->adma_desc_sz,
+						  host->adma_desc_next,
+						  host->adma_addr_next);
+				host->adma_desc_next = NULL;
+			}
+		}
 	}
 
 	host->next_data.cookie = 1;
@@ -4189,6 +4373,8 @@ int sdhci_add_host(struct sdhci_host *host)
 
 	sdhci_enable_card_detection(host);
 
+	sdhci_cmdq_init(host);
+
 	mmc_add_host(mmc);
 	return 0;
 
@@ -4262,11 +4448,15 @@ void sdhci_remove_host(struct sdhci_host *host, int dead)
 	if (host->adma_desc)
 		dma_free_coherent(mmc_dev(host->mmc), host->adma_desc_sz,
 				  host->adma_desc, host->adma_addr);
+	if (host->adma_desc_next)
+		dma_free_coherent(mmc_dev(host->mmc), host->adma_desc_sz,
+				  host->adma_desc_next, host->adma_addr_next);
 	if (host->align_buffer)
 		dma_free_coherent(mmc_dev(host->mmc), host->align_buf_sz,
 				  host->align_buffer, host->align_addr);
 
 	host->adma_desc = NULL;
+	host->adma_desc_next = NULL;
 	host->align_buffer = NULL;
 }
 
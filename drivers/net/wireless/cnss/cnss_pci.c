@@ -39,6 +39,10 @@
 #include <linux/scatterlist.h>
 #include <linux/log2.h>
 #include <linux/etherdevice.h>
+#include <linux/interrupt.h>
+#include <linux/irq.h>
+#include <linux/jiffies.h>
+#include <linux/cpumask.h>
 #ifdef CONFIG_PCI_MSM
 #include <linux/msm_pcie.h>
 #else
@@ -136,6 +140,11 @@ static struct cnss_fw_files FW_FILES_DEFAULT = {
 #define PCIE_ENABLE_DELAY	100000
 #define WLAN_BOOTSTRAP_DELAY	10
 #define EVICT_BIN_MAX_SIZE      (512*1024)
+/* L1 PM Substates, not in this kernel's pci_regs.h */
+#define CNSS_PCI_EXT_CAP_ID_L1SS	0x1E
+#define CNSS_PCI_L1SS_CTL1		0x08
+#define CNSS_PCI_L1SS_CTL1_EN_MASK	0x0000000f
+
 #define CNSS_PINCTRL_STATE_ACTIVE "default"
 
 static DEFINE_SPINLOCK(pci_link_down_lock);
@@ -227,6 +236,34 @@ struct cnss_wlan_mac_addr {
 /* device_info is expected to be fully populated after cnss_config is invoked.
  * The function pointer callbacks are expected to be non null as well.
  */
+/*
+ * Throughput policy, driven by the bus bandwidth votes of the WLAN host
+ * driver. At perf_level and above the WLAN interrupt moves to perf_cpus
+ * and the endpoint L1 substates are disabled; both are put back once the
+ * votes drop to idle.
+ */
+enum cnss_perf_state {
+	CNSS_PERF_NORMAL,
+	CNSS_PERF_HIGH,
+	CNSS_PERF_MAX
+};
+
+struct cnss_perf_info {
+	struct work_struct work;
+	struct mutex lock;
+	int bandwidth;
+	int level;
+	struct cpumask cpus;
+	struct cpumask saved_affinity;
+	bool affinity_saved;
+	u32 l1ss_ctl;
+	bool l1ss_saved;
+	enum cnss_perf_state state;
+	unsigned long state_start;
+	u64 residency_ms[CNSS_PERF_MAX];
+	u32 transitions;
+};
+
 static struct cnss_data {
 	struct platform_device *pldev;
 	struct subsys_device *subsys;
@@ -288,6 +325,7 @@ static struct cnss_data {
 	struct segment_memory bdata_seg_mem[MAX_NUM_OF_SEGMENTS];
 	int wlan_bootstrap_gpio[NUM_OF_BOOTSTRAP];
 	atomic_t auto_suspended;
+	struct cnss_perf_info perf;
 	bool monitor_wake_intr;
 } *penv;
 
@@ -1353,6 +1391,198 @@ static void cnss_wlan_pci_remove(struct pci_dev *pdev)
 	device_remove_file(dev, &dev_attr_wlan_setup);
 }
 
+static void cnss_perf_set_irq(struct cnss_perf_info *perf, bool high)
+{
+	struct irq_data *irq_data;
+	int irq;
+
+	if (!penv->pdev || !penv->pdev->irq)
+		return;
+	irq = penv->pdev->irq;
+
+	if (high) {
+		if (cpumask_empty(&perf->cpus))
+			return;
+		irq_data = irq_get_irq_data(irq);
+		if (!irq_data)
+			return;
+		cpumask_copy(&perf->saved_affinity, irq_data->affinity);
+		if (!irq_set_affinity(irq, &perf->cpus))
+			perf->affinity_saved = true;
+	} else if (perf->affinity_saved) {
+		irq_set_affinity(irq, &perf->saved_affinity);
+		perf->affinity_saved = false;
+	}
+}
+
+static void cnss_perf_set_l1ss(struct cnss_perf_info *perf, bool high)
+{
+	struct pci_dev *pdev = penv->pdev;
+	int pos;
+
+	if (!pdev || !penv->pcie_link_state)
+		return;
+	pos = pci_find_ext_capability(pdev, CNSS_PCI_EXT_CAP_ID_L1SS);
+	if (!pos)
+		return;
+
+	if (high) {
+		pci_read_config_dword(pdev, pos + CNSS_PCI_L1SS_CTL1,
+				      &perf->l1ss_ctl);
+		perf->l1ss_saved = true;
+		pci_write_config_dword(pdev, pos + CNSS_PCI_L1SS_CTL1,
+				       perf->l1ss_ctl &
+				       ~CNSS_PCI_L1SS_CTL1_EN_MASK);
+	} else if (perf->l1ss_saved) {
+		pci_write_config_dword(pdev, pos + CNSS_PCI_L1SS_CTL1,
+				       perf->l1ss_ctl);
+		perf->l1ss_saved = false;
+	}
+}
+
+/* Caller must hold perf->lock */
+static void cnss_perf_set_state(struct cnss_perf_info *perf,
+				enum cnss_perf_state state)
+{
+	unsigned long now = jiffies;
+
+	if (perf->state == state)
+		return;
+
+	perf->residency_ms[perf->state] +=
+		jiffies_to_msecs(now - perf->state_start);
+	perf->state_start = now;
+
+	cnss_perf_set_irq(perf, state == CNSS_PERF_HIGH);
+	cnss_perf_set_l1ss(perf, state == CNSS_PERF_HIGH);
+	perf->state = state;
+	perf->transitions++;
+	pr_debug("cnss: perf state %d bandwidth %d\n", state, perf->bandwidth);
+}
+
+static void cnss_perf_work(struct work_struct *work)
+{
+	struct cnss_perf_info *perf =
+		container_of(work, struct cnss_perf_info, work);
+	int bandwidth;
+
+	mutex_lock(&perf->lock);
+	bandwidth = ACCESS_ONCE(perf->bandwidth);
+	if (perf->state == CNSS_PERF_NORMAL && bandwidth >= perf->level)
+		cnss_perf_set_state(perf, CNSS_PERF_HIGH);
+	else if (perf->state == CNSS_PERF_HIGH &&
+		 bandwidth <= CNSS_BUS_WIDTH_LOW)
+		cnss_perf_set_state(perf, CNSS_PERF_NORMAL);
+	mutex_unlock(&perf->lock);
+}
+
+/* Bus bandwidth votes may come from atomic context */
+static void cnss_perf_update(int bandwidth)
+{
+	struct cnss_perf_info *perf = &penv->perf;
+
+	ACCESS_ONCE(perf->bandwidth) = bandwidth;
+	schedule_work(&perf->work);
+}
+
+/* The link is going down, drop back to the default settings first */
+static void cnss_perf_reset(void)
+{
+	struct cnss_perf_info *perf = &penv->perf;
+
+	mutex_lock(&perf->lock);
+	perf->bandwidth = CNSS_BUS_WIDTH_NONE;
+	cnss_perf_set_state(perf, CNSS_PERF_NORMAL);
+	mutex_unlock(&perf->lock);
+}
+
+static void cnss_perf_init(struct device *dev)
+{
+	struct cnss_perf_info *perf = &penv->perf;
+	u32 cpus = 0;
+	int cpu;
+
+	INIT_WORK(&perf->work, cnss_perf_work);
+	mutex_init(&perf->lock);
+	perf->level = CNSS_BUS_WIDTH_HIGH;
+	perf->state = CNSS_PERF_NORMAL;
+	perf->state_start = jiffies;
+
+	cpumask_clear(&perf->cpus);
+	of_property_read_u32(dev->of_node, "qcom,wlan-perf-cpus", &cpus);
+	for_each_possible_cpu(cpu)
+		if (cpu < 32 && (cpus & BIT(cpu)))
+			cpumask_set_cpu(cpu, &perf->cpus);
+}
+
+static ssize_t wlan_perf_show(struct device *dev,
+			struct device_attribute *attr, char *buf)
+{
+	struct cnss_perf_info *perf;
+	u64 residency_ms[CNSS_PERF_MAX];
+	int len;
+
+	if (!penv)
+		return -ENODEV;
+	perf = &penv->perf;
+
+	mutex_lock(&perf->lock);
+	memcpy(residency_ms, perf->residency_ms, sizeof(residency_ms));
+	residency_ms[perf->state] +=
+		jiffies_to_msecs(jiffies - perf->state_start);
+	len = scnprintf(buf, PAGE_SIZE,
+			"state: %s\nlevel: %d\ncpus: ",
+			perf->state == CNSS_PERF_HIGH ? "high" : "normal",
+			perf->level);
+	len += cpumask_scnprintf(buf + len, PAGE_SIZE - len, &perf->cpus);
+	len += scnprintf(buf + len, PAGE_SIZE - len,
+			 "\nnormal_ms: %llu\nhigh_ms: %llu\ntransitions: %u\n",
+			 residency_ms[CNSS_PERF_NORMAL],
+			 residency_ms[CNSS_PERF_HIGH], perf->transitions);
+	mutex_unlock(&perf->lock);
+
+	return len;
+}
+
+/*
+ * "level <n>" sets the bus width at which the high state is entered,
+ * "cpus <mask>" the cpus the WLAN interrupt moves to.
+ */
+static ssize_t wlan_perf_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count)
+{
+	struct cnss_perf_info *perf;
+	struct cpumask cpus;
+	int level;
+
+	if (!penv)
+		return -ENODEV;
+	perf = &penv->perf;
+
+	if (!strncmp(buf, "level ", 6)) {
+		if (kstrtoint(buf + 6, 0, &level) ||
+		    level <= CNSS_BUS_WIDTH_LOW || level > CNSS_BUS_WIDTH_HIGH)
+			return -EINVAL;
+		mutex_lock(&perf->lock);
+		perf->level = level;
+		mutex_unlock(&perf->lock);
+	} else if (!strncmp(buf, "cpus ", 5)) {
+		if (cpumask_parse(buf + 5, &cpus))
+			return -EINVAL;
+		mutex_lock(&perf->lock);
+		cpumask_and(&perf->cpus, &cpus, cpu_possible_mask);
+		mutex_unlock(&perf->lock);
+	} else {
+		return -EINVAL;
+	}
+	schedule_work(&perf->work);
+
+	return count;
+}
+
+static DEVICE_ATTR(wlan_perf, S_IRUSR | S_IWUSR,
+	wlan_perf_show, wlan_perf_store);
+
 static int cnss_wlan_pci_suspend(struct device *dev)
 {
 	int ret = 0;
@@ -1368,6 +1598,7 @@ static int cnss_wlan_pci_suspend(struct device *dev)
 	if (!wdriver)
 		goto out;
 
+	cnss_perf_reset();
 	if (wdriver->suspend) {
 		ret = wdriver->suspend(pdev, state);
 
@@ -2512,6 +2743,7 @@ static int cnss_probe(struct platform_device *pdev)
 	penv->vreg_info.state = VREG_OFF;
 	penv->pci_register_again = false;
 	mutex_init(&penv->fw_setup_stat_lock);
+	cnss_perf_init(dev);
 
 	ret = cnss_wlan_get_resources(pdev);
 	if (ret)
@@ -2672,6 +2904,8 @@ skip_ramdump:
 		pr_err("cnss: fw_image_setup sys file creation failed\n");
 		goto err_bus_reg;
 	}
+	if (device_create_file(dev, &dev_attr_wlan_perf))
+		pr_err("cnss: wlan_perf sys file creation failed\n");
 	pr_info("cnss: Platform driver probed successfully.\n");
 	return ret;
 
@@ -2726,7 +2960,9 @@ static int cnss_remove(struct platform_device *pdev)
 	int i;
 
 	unregister_pm_notifier(&cnss_pm_notifier);
+	device_remove_file(&pdev->dev, &dev_attr_wlan_perf);
 	device_remove_file(&pdev->dev, &dev_attr_fw_image_setup);
+	cancel_work_sync(&penv->perf.work);
 
 	cnss_pm_wake_lock_destroy(&penv->ws);
 
@@ -2881,6 +3117,7 @@ int cnss_pci_request_bus_bandwidth(int bandwidth)
 			"%s: could not set bus bandwidth %d, ret = %d\n",
 				__func__, bandwidth, ret);
 		}
+		cnss_perf_update(bandwidth);
 		break;
 
 	default:
@@ -2910,6 +3147,7 @@ int cnss_request_bus_bandwidth(int bandwidth)
 		if (ret)
 			pr_err("%s: could not set bus bandwidth %d, ret = %d\n",
 			       __func__, bandwidth, ret);
+		cnss_perf_update(bandwidth);
 		break;
 
 	default:
@@ -2996,6 +3234,7 @@ int cnss_auto_suspend(void)
 
 	pdev = penv->pdev;
 
+	cnss_perf_reset();
 	if (penv->pcie_link_state) {
 		pci_save_state(pdev);
 		penv->saved_state = pci_store_saved_state(pdev);
@@ -864,7 +864,14 @@ static ssize_t ipa_read_stats(struct file *file, char __user *ubuf,
 			"wan_rx_empty=%u\n"
 			"wan_repl_rx_empty=%u\n"
 			"lan_rx_empty=%u\n"
-			"lan_repl_rx_empty=%u\n",
+			"lan_repl_rx_empty=%u\n"
+			"wan_rx_page_recycle=%u\n"
+			"wan_rx_page_alloc=%u\n"
+			"tx_deferred=%u\n"
+			"tx_batches=%u\n"
+			"nat_offload_add=%u\n"
+			"nat_offload_del=%u\n"
+			"nat_offload_full=%u\n",
 			ipa_ctx->stats.tx_sw_pkts,
 			ipa_ctx->stats.tx_hw_pkts,
 			ipa_ctx->stats.tx_pkts_compl,
@@ -877,7 +884,28 @@ static ssize_t ipa_read_stats(struct file *file, char __user *ubuf,
 			ipa_ctx->stats.wan_rx_empty,
 			ipa_ctx->stats.wan_repl_rx_empty,
 			ipa_ctx->stats.lan_rx_empty,
-			ipa_ctx->stats.lan_repl_rx_empty);
+			ipa_ctx->stats.lan_repl_rx_empty,
+			ipa_ctx->stats.wan_rx_page_recycle,
+			ipa_ctx->stats.wan_rx_page_alloc,
+			ipa_ctx->stats.tx_deferred,
+			ipa_ctx->stats.tx_batches,
+			ipa_ctx->stats.nat_offload_add,
+			ipa_ctx->stats.nat_offload_del,
+			ipa_ctx->stats.nat_offload_full);
+		cnt += nbytes;
+
+		/* polls by packets handled, bucket i is [2^(i-1), 2^i) */
+		for (i = 0; i < IPA_WAN_NAPI_HIST - 1; i++) {
+			nbytes = scnprintf(dbg_buff + cnt,
+				IPA_MAX_MSG_LEN - cnt,
+				"wan_napi_polls[%u-%u]=%u\n",
+				i ? 1 << (i - 1) : 0, (1 << i) - 1,
+				ipa_ctx->stats.wan_napi_polls[i]);
+			cnt += nbytes;
+		}
+		nbytes = scnprintf(dbg_buff + cnt, IPA_MAX_MSG_LEN - cnt,
+			"wan_napi_polls[%u+]=%u\n", 1 << (i - 1),
+			ipa_ctx->stats.wan_napi_polls[i]);
 		cnt += nbytes;
 
 		for (i = 0; i < MAX_NUM_EXCP; i++) {
@@ -1074,6 +1102,53 @@ nxt_clnt_cons:
 	return simple_read_from_buffer(ubuf, count, ppos, dbg_buff, cnt);
 }
 
+/* Packet counts at the previous read of the wdi file, for the rates */
+static u32 wdi_last_tx_pkts;
+static u32 wdi_last_rx_pkts;
+static ktime_t wdi_last_read;
+static u64 wdi_tx_rate;
+static u64 wdi_rx_rate;
+
+static int ipa_read_wdi_rates(struct IpaHwStatsWDIInfoData_t *stats,
+		bool update)
+{
+	u32 tx_pkts = stats->tx_ch_stats.num_pkts_processed;
+	u32 rx_pkts = stats->rx_ch_stats.num_pkts_processed;
+	ktime_t now = ktime_get();
+	s64 ms;
+	int nbytes;
+	int i;
+
+	if (update) {
+		ms = ktime_to_ms(ktime_sub(now, wdi_last_read));
+		if (wdi_last_read.tv64 && ms > 0) {
+			wdi_tx_rate = div64_u64((u64)(tx_pkts -
+				wdi_last_tx_pkts) * MSEC_PER_SEC, ms);
+			wdi_rx_rate = div64_u64((u64)(rx_pkts -
+				wdi_last_rx_pkts) * MSEC_PER_SEC, ms);
+		}
+		wdi_last_tx_pkts = tx_pkts;
+		wdi_last_rx_pkts = rx_pkts;
+		wdi_last_read = now;
+	}
+
+	nbytes = scnprintf(dbg_buff, IPA_MAX_MSG_LEN,
+		"TX pkts_per_sec=%llu\n"
+		"RX pkts_per_sec=%llu\n",
+		wdi_tx_rate, wdi_rx_rate);
+
+	for (i = 0; i < IPA_NUM_PIPES; i++) {
+		if (!ipa_ctx->uc_wdi_ctx.wdi_err_cnt[i])
+			continue;
+		nbytes += scnprintf(dbg_buff + nbytes,
+			IPA_MAX_MSG_LEN - nbytes,
+			"ep=%d uc_err_events=%u\n",
+			i, ipa_ctx->uc_wdi_ctx.wdi_err_cnt[i]);
+	}
+
+	return nbytes;
+}
+
 static ssize_t ipa_read_wdi(struct file *file, char __user *ubuf,
 		size_t count, loff_t *ppos)
 {
@@ -1082,7 +1157,9 @@ static ssize_t ipa_read_wdi(struct file *file, char __user *ubuf,
 	int cnt = 0;
 
 	if (!ipa_get_wdi_stats(&stats)) {
-		nbytes = scnprintf(dbg_buff, IPA_MAX_MSG_LEN,
+		/* Only the first chunk of a read advances the rates */
+		cnt += ipa_read_wdi_rates(&stats, *ppos == 0);
+		nbytes = scnprintf(dbg_buff + cnt, IPA_MAX_MSG_LEN - cnt,
 			"TX num_pkts_processed=%u\n"
 			"TX copy_engine_doorbell_value=%u\n"
 			"TX num_db_fired=%u\n"
@@ -49,9 +49,20 @@
 
 #define IPA_HEADROOM 128
 
+/*
+ * NAPI pipes receive into pages that stay DMA mapped. build_skb() wraps a
+ * received page with a reference of its own, and the page waits on
+ * rx_page_recycle until the stack released it to be posted again. A page
+ * that is still held at the head of a list longer than the reserve is
+ * given up to the stack and replaced.
+ */
+#define IPA_RX_PAGE_ORDER get_order(IPA_GENERIC_RX_BUFF_BASE_SZ)
+#define IPA_RX_PAGE_RECYCLE_RESERVE 32
+
 static struct sk_buff *ipa_get_skb_ipa_rx(unsigned int len, gfp_t flags);
 static void ipa_replenish_wlan_rx_cache(struct ipa_sys_context *sys);
 static void ipa_replenish_rx_cache(struct ipa_sys_context *sys);
+static void ipa_page_replenish_rx_cache(struct ipa_sys_context *sys);
 static void replenish_rx_work_func(struct work_struct *work);
 static void ipa_wq_handle_rx(struct work_struct *work);
 static void ipa_wq_handle_tx(struct work_struct *work);
@@ -260,6 +271,21 @@ static void ipa_wq_handle_tx(struct work_struct *work)
 	ipa_handle_tx(sys);
 }
 
+/*
+ * Rings the doorbell for descriptors that ipa_send_one() queued without one,
+ * called with sys->spinlock held.
+ */
+static void ipa_tx_submit_deferred(struct ipa_sys_context *sys)
+{
+	if (!sys->tx_deferred)
+		return;
+
+	if (sps_transfer_submit(sys->ep->ep_hdl))
+		IPAERR("sps_transfer_submit failed\n");
+	IPA_STATS_INC_CNT(ipa_ctx->stats.tx_batches);
+	sys->tx_deferred = 0;
+}
+
 /**
  * ipa_send_one() - Send a single descriptor
  * @sys:	system pipe context
@@ -271,6 +297,10 @@ static void ipa_wq_handle_tx(struct work_struct *work)
  * - after the transfer was done the SPS will
  *   notify the sending user via ipa_sps_irq_comp_tx()
  *
+ * When desc->xmit_more is set the descriptor is written to the FIFO without
+ * a doorbell, up to IPA_TX_BATCH_MAX of them; the first descriptor sent
+ * without xmit_more submits the whole batch.
+ *
  * Return codes: 0: success, -EFAULT: failure
  */
 int ipa_send_one(struct ipa_sys_context *sys, struct ipa_desc *desc,
@@ -334,6 +364,8 @@ int ipa_send_one(struct ipa_sys_context *sys, struct ipa_desc *desc,
 
 	spin_lock_bh(&sys->spinlock);
 	list_add_tail(&tx_pkt->link, &sys->head_desc_list);
+	if (desc->xmit_more && sys->tx_deferred < IPA_TX_BATCH_MAX - 1)
+		sps_flags |= SPS_IOVEC_FLAG_NO_SUBMIT;
 	result = sps_transfer_one(sys->ep->ep_hdl, dma_address, len, tx_pkt,
 			sps_flags);
 	if (result) {
@@ -341,12 +373,21 @@ int ipa_send_one(struct ipa_sys_context *sys, struct ipa_desc *desc,
 		goto fail_sps_send;
 	}
 
+	if (sps_flags & SPS_IOVEC_FLAG_NO_SUBMIT) {
+		sys->tx_deferred++;
+		IPA_STATS_INC_CNT(ipa_ctx->stats.tx_deferred);
+	} else if (sys->tx_deferred) {
+		IPA_STATS_INC_CNT(ipa_ctx->stats.tx_batches);
+		sys->tx_deferred = 0;
+	}
+
 	spin_unlock_bh(&sys->spinlock);
 
 	return 0;
 
 fail_sps_send:
 	list_del(&tx_pkt->link);
+	ipa_tx_submit_deferred(sys);
 	spin_unlock_bh(&sys->spinlock);
 	dma_unmap_single(ipa_ctx->pdev, dma_address, desc->len, DMA_TO_DEVICE);
 fail_dma_map:
@@ -505,6 +546,8 @@ int ipa_send(struct ipa_sys_context *sys, u32 num_desc, struct ipa_desc *desc,
 		goto failure;
 	}
 
+	/* the doorbell above also covered any deferred single descriptors */
+	sys->tx_deferred = 0;
 	spin_unlock_bh(&sys->spinlock);
 	return 0;
 
@@ -591,6 +634,7 @@ int ipa_send_cmd(u16 num_desc, struct ipa_desc *descr)
 
 		descr->callback = ipa_sps_irq_cmd_ack;
 		descr->user1 = descr;
+		descr->xmit_more = false;
 		if (ipa_send_one(sys, descr, true)) {
 			IPAERR("fail to send immediate command\n");
 			result = -EFAULT;
@@ -732,12 +776,43 @@ static int ipa_handle_rx_core(struct ipa_sys_context *sys, bool process_all,
 	return cnt;
 }
 
+/**
+ * ipa_rx_switch_to_poll_mode() - Stop the Rx interrupt and have the pipe
+ * polled from the work queue, unless it is polled already
+ */
+static void ipa_rx_switch_to_poll_mode(struct ipa_sys_context *sys)
+{
+	int ret;
+
+	if (atomic_cmpxchg(&sys->curr_polling_state, 0, 1))
+		return;
+
+	ret = sps_get_config(sys->ep->ep_hdl, &sys->ep->connect);
+	if (ret) {
+		IPAERR("sps_get_config() failed %d\n", ret);
+		goto fail;
+	}
+	sys->ep->connect.options = SPS_O_AUTO_ENABLE |
+		SPS_O_ACK_TRANSFERS | SPS_O_POLL;
+	ret = sps_set_config(sys->ep->ep_hdl, &sys->ep->connect);
+	if (ret) {
+		IPAERR("sps_set_config() failed %d\n", ret);
+		goto fail;
+	}
+	queue_work(sys->wq, &sys->work);
+	return;
+
+fail:
+	atomic_set(&sys->curr_polling_state, 0);
+}
+
 /**
  * ipa_rx_switch_to_intr_mode() - Operate the Rx data path in interrupt mode
  */
 static void ipa_rx_switch_to_intr_mode(struct ipa_sys_context *sys)
 {
 	int ret;
+	u32 empty;
 
 	ret = sps_get_config(sys->ep->ep_hdl, &sys->ep->connect);
 	if (ret) {
@@ -770,6 +845,16 @@ static void ipa_rx_switch_to_intr_mode(struct ipa_sys_context *sys)
 		goto fail;
 	}
 	atomic_set(&sys->curr_polling_state, 0);
+	if (sys->ep->napi_enabled) {
+		/*
+		 * Descriptors completed before EOT was set raise no interrupt,
+		 * poll again for them rather than handle them outside of NAPI
+		 */
+		if (!sps_is_pipe_empty(sys->ep->ep_hdl, &empty) && !empty)
+			ipa_rx_switch_to_poll_mode(sys);
+		ipa_dec_client_disable_clks();
+		return;
+	}
 	ipa_handle_rx_core(sys, true, false);
 	return;
 
@@ -794,30 +879,12 @@ fail:
 static void ipa_sps_irq_rx_notify(struct sps_event_notify *notify)
 {
 	struct ipa_sys_context *sys = (struct ipa_sys_context *)notify->user;
-	int ret;
 
 	IPADBG("event %d notified\n", notify->event_id);
 
 	switch (notify->event_id) {
 	case SPS_EVENT_EOT:
-		if (!atomic_read(&sys->curr_polling_state)) {
-			ret = sps_get_config(sys->ep->ep_hdl,
-					&sys->ep->connect);
-			if (ret) {
-				IPAERR("sps_get_config() failed %d\n", ret);
-				break;
-			}
-			sys->ep->connect.options = SPS_O_AUTO_ENABLE |
-				SPS_O_ACK_TRANSFERS | SPS_O_POLL;
-			ret = sps_set_config(sys->ep->ep_hdl,
-					&sys->ep->connect);
-			if (ret) {
-				IPAERR("sps_set_config() failed %d\n", ret);
-				break;
-			}
-			atomic_set(&sys->curr_polling_state, 1);
-			queue_work(sys->wq, &sys->work);
-		}
+		ipa_rx_switch_to_poll_mode(sys);
 		break;
 	default:
 		IPAERR("recieved unexpected event id %d\n", notify->event_id);
@@ -900,7 +967,18 @@ static void switch_to_intr_rx_work_func(struct work_struct *work)
 	struct ipa_sys_context *sys;
 	dwork = container_of(work, struct delayed_work, work);
 	sys = container_of(dwork, struct ipa_sys_context, switch_to_intr_work);
-	ipa_handle_rx(sys);
+	if (!sys->ep->napi_enabled) {
+		ipa_handle_rx(sys);
+		return;
+	}
+
+	/* NAPI is done polling, ipa_rx_poll_complete() queued this */
+	if (!sys->ep->valid) {
+		atomic_set(&sys->curr_polling_state, 0);
+		ipa_dec_client_disable_clks();
+		return;
+	}
+	ipa_rx_switch_to_intr_mode(sys);
 }
 
 /**
@@ -1003,7 +1081,8 @@ int ipa_setup_sys_pipe(struct ipa_sys_connect_params *sys_in, u32 *clnt_hdl)
 		snprintf(buff, IPA_RESOURCE_NAME_MAX, "iparepwq%d",
 				sys_in->client);
 		ep->sys->repl_wq = alloc_workqueue(buff,
-				WQ_MEM_RECLAIM | WQ_UNBOUND, 1);
+				WQ_MEM_RECLAIM | WQ_UNBOUND |
+				WQ_POWER_EFFICIENT, 1);
 		if (!ep->sys->repl_wq) {
 			IPAERR("failed to create rep wq for client %d\n",
 					sys_in->client);
@@ -1018,6 +1097,12 @@ int ipa_setup_sys_pipe(struct ipa_sys_connect_params *sys_in, u32 *clnt_hdl)
 	}
 
 	ep->skip_ep_cfg = sys_in->skip_ep_cfg;
+	if (sys_in->napi_enabled) {
+		if (sys_in->client == IPA_CLIENT_APPS_WAN_CONS)
+			ep->napi_enabled = true;
+		else
+			IPAERR("no NAPI for client %d\n", sys_in->client);
+	}
 	if (ipa_assign_policy(sys_in, ep->sys)) {
 		IPAERR("failed to sys ctx for client %d\n", sys_in->client);
 		result = -ENOMEM;
@@ -1119,7 +1204,9 @@ int ipa_setup_sys_pipe(struct ipa_sys_connect_params *sys_in, u32 *clnt_hdl)
 
 	*clnt_hdl = ipa_ep_idx;
 
-	if (IPA_CLIENT_IS_CONS(sys_in->client))
+	if (ep->napi_enabled)
+		ipa_page_replenish_rx_cache(ep->sys);
+	else if (IPA_CLIENT_IS_CONS(sys_in->client))
 		ipa_replenish_rx_cache(ep->sys);
 
 	if (IPA_CLIENT_IS_WLAN_CONS(sys_in->client)) {
@@ -1127,7 +1214,7 @@ int ipa_setup_sys_pipe(struct ipa_sys_connect_params *sys_in, u32 *clnt_hdl)
 		atomic_inc(&ipa_ctx->wc_memb.active_clnt_cnt);
 	}
 
-	if (nr_cpu_ids > 1 &&
+	if (nr_cpu_ids > 1 && !ep->napi_enabled &&
 		(sys_in->client == IPA_CLIENT_APPS_LAN_CONS ||
 		 sys_in->client == IPA_CLIENT_APPS_WAN_CONS)) {
 		ep->sys->repl.capacity = ep->sys->rx_pool_sz + 1;
@@ -1393,6 +1480,7 @@ int ipa_tx_dp(enum ipa_client_type dst, struct sk_buff *skb,
 			desc[0].dma_address_valid = true;
 			desc[0].dma_address = meta->dma_address;
 		}
+		desc[0].xmit_more = meta && meta->xmit_more;
 
 		if (ipa_send_one(sys, &desc[0], true)) {
 			IPAERR("fail to send skb\n");
@@ -1410,13 +1498,124 @@ fail_gen:
 }
 EXPORT_SYMBOL(ipa_tx_dp);
 
+/**
+ * ipa_tx_dp_flush() - submit packets held back by ipa_tx_dp()
+ * @dst: [in] same destination client as given to ipa_tx_dp()
+ *
+ * Packets sent with meta->xmit_more set may sit in the descriptor FIFO until
+ * a packet without it is sent. A client that stops sending in the middle of
+ * a batch, e.g. because its queue was stopped, calls this to kick them out.
+ *
+ * Returns:	0 on success, negative on failure
+ */
+int ipa_tx_dp_flush(enum ipa_client_type dst)
+{
+	struct ipa_sys_context *sys;
+	int src_ep_idx;
+
+	if (IPA_CLIENT_IS_CONS(dst))
+		src_ep_idx = ipa_get_ep_mapping(IPA_CLIENT_APPS_LAN_WAN_PROD);
+	else
+		src_ep_idx = ipa_get_ep_mapping(dst);
+
+	if (src_ep_idx < 0) {
+		IPAERR("invalid dst client %d\n", dst);
+		return -EINVAL;
+	}
+
+	sys = ipa_ctx->ep[src_ep_idx].sys;
+	if (!sys || !sys->ep->valid)
+		return -EINVAL;
+
+	spin_lock_bh(&sys->spinlock);
+	ipa_tx_submit_deferred(sys);
+	spin_unlock_bh(&sys->spinlock);
+
+	return 0;
+}
+EXPORT_SYMBOL(ipa_tx_dp_flush);
+
 static void ipa_wq_handle_rx(struct work_struct *work)
 {
 	struct ipa_sys_context *sys;
 	sys = container_of(work, struct ipa_sys_context, work);
+	if (sys->ep->napi_enabled) {
+		/* dropped once the client is done, see ipa_rx_poll_complete */
+		ipa_inc_client_enable_clks();
+		sys->ep->client_notify(sys->ep->priv, IPA_CLIENT_START_POLL, 0);
+		return;
+	}
 	ipa_handle_rx(sys);
 }
 
+/**
+ * ipa_rx_poll() - Pull received packets of a NAPI client pipe
+ * @clnt_hdl:	[in] handle of the pipe
+ * @budget:	[in] packets the caller may take
+ *
+ * Called from the client's NAPI poll after IPA_CLIENT_START_POLL. The
+ * packets are handed to the client notify callback as IPA_RECEIVE in this
+ * context. Whole aggregated buffers are handled, so once at least budget
+ * packets were given this stops and returns budget: the client should keep
+ * polling. Otherwise the pipe is drained and it should complete NAPI and
+ * call ipa_rx_poll_complete().
+ *
+ * Returns:	number of packets handled, at most budget
+ */
+int ipa_rx_poll(u32 clnt_hdl, int budget)
+{
+	struct ipa_ep_context *ep;
+	struct ipa_sys_context *sys;
+	struct sps_iovec iov;
+	int ret;
+
+	if (clnt_hdl >= IPA_NUM_PIPES || !ipa_ctx->ep[clnt_hdl].valid ||
+	    !ipa_ctx->ep[clnt_hdl].napi_enabled) {
+		IPAERR("bad parm.\n");
+		return 0;
+	}
+
+	ep = &ipa_ctx->ep[clnt_hdl];
+	sys = ep->sys;
+	sys->poll_pkts = 0;
+	while (sys->poll_pkts < budget &&
+	       atomic_read(&sys->curr_polling_state)) {
+		ret = sps_get_iovec(ep->ep_hdl, &iov);
+		if (ret) {
+			IPAERR("sps_get_iovec failed %d\n", ret);
+			break;
+		}
+		if (iov.addr == 0)
+			break;
+		ipa_wq_rx_common(sys, iov.size);
+	}
+
+	IPA_STATS_INC_CNT(ipa_ctx->stats.wan_napi_polls[
+		min_t(u32, fls(sys->poll_pkts), IPA_WAN_NAPI_HIST - 1)]);
+
+	return min_t(int, sys->poll_pkts, budget);
+}
+EXPORT_SYMBOL(ipa_rx_poll);
+
+/**
+ * ipa_rx_poll_complete() - Go back to interrupt mode once a NAPI client
+ * completed polling
+ * @clnt_hdl:	[in] handle of the pipe
+ */
+void ipa_rx_poll_complete(u32 clnt_hdl)
+{
+	struct ipa_ep_context *ep;
+
+	if (clnt_hdl >= IPA_NUM_PIPES || !ipa_ctx->ep[clnt_hdl].napi_enabled) {
+		IPAERR("bad parm.\n");
+		return;
+	}
+
+	ep = &ipa_ctx->ep[clnt_hdl];
+	queue_delayed_work(ep->sys->wq, &ep->sys->switch_to_intr_work, 0);
+}
+EXPORT_SYMBOL(ipa_rx_poll_complete);
+
 static void ipa_wq_repl_rx(struct work_struct *work)
 {
 	struct ipa_sys_context *sys;
@@ -1764,12 +1963,123 @@ static void ipa_fast_replenish_rx_cache(struct ipa_sys_context *sys)
 	return;
 }
 
+static void ipa_free_rx_page(struct ipa_sys_context *sys,
+		struct ipa_rx_pkt_wrapper *rx_pkt)
+{
+	dma_unmap_page(ipa_ctx->pdev, rx_pkt->data.dma_addr,
+			sys->rx_buff_sz, DMA_FROM_DEVICE);
+	put_page(rx_pkt->page);
+	kmem_cache_free(ipa_ctx->rx_pkt_wrapper_cache, rx_pkt);
+}
+
+/**
+ * ipa_get_rx_page() - Get a mapped page buffer to post on a NAPI pipe
+ *
+ * Reuses the oldest received page once the stack released it, the hot
+ * path, otherwise allocates and maps a new one.
+ */
+static struct ipa_rx_pkt_wrapper *ipa_get_rx_page(struct ipa_sys_context *sys)
+{
+	struct ipa_rx_pkt_wrapper *rx_pkt;
+	struct page *page;
+	dma_addr_t dma_addr;
+
+	rx_pkt = list_first_entry_or_null(&sys->rx_page_recycle,
+			struct ipa_rx_pkt_wrapper, link);
+	if (rx_pkt && page_count(rx_pkt->page) == 1) {
+		list_del(&rx_pkt->link);
+		sys->rx_page_nr_recycle--;
+		/* the stack may have written to it, drop those lines */
+		dma_sync_single_for_device(ipa_ctx->pdev,
+				rx_pkt->data.dma_addr, sys->rx_buff_sz,
+				DMA_FROM_DEVICE);
+		IPA_STATS_INC_CNT(ipa_ctx->stats.wan_rx_page_recycle);
+		return rx_pkt;
+	}
+
+	if (rx_pkt && sys->rx_page_nr_recycle > IPA_RX_PAGE_RECYCLE_RESERVE) {
+		list_del(&rx_pkt->link);
+		sys->rx_page_nr_recycle--;
+		dma_unmap_page(ipa_ctx->pdev, rx_pkt->data.dma_addr,
+				sys->rx_buff_sz, DMA_FROM_DEVICE);
+		put_page(rx_pkt->page);
+	} else {
+		rx_pkt = kmem_cache_zalloc(ipa_ctx->rx_pkt_wrapper_cache,
+					   GFP_ATOMIC);
+		if (!rx_pkt)
+			return NULL;
+		INIT_LIST_HEAD(&rx_pkt->link);
+		rx_pkt->sys = sys;
+	}
+
+	page = alloc_pages(GFP_ATOMIC | __GFP_COMP | __GFP_NOWARN,
+			IPA_RX_PAGE_ORDER);
+	if (!page)
+		goto fail_page_alloc;
+
+	dma_addr = dma_map_page(ipa_ctx->pdev, page, IPA_HEADROOM,
+			sys->rx_buff_sz, DMA_FROM_DEVICE);
+	if (dma_mapping_error(ipa_ctx->pdev, dma_addr))
+		goto fail_dma_mapping;
+
+	rx_pkt->page = page;
+	rx_pkt->data.dma_addr = dma_addr;
+	IPA_STATS_INC_CNT(ipa_ctx->stats.wan_rx_page_alloc);
+	return rx_pkt;
+
+fail_dma_mapping:
+	__free_pages(page, IPA_RX_PAGE_ORDER);
+fail_page_alloc:
+	kmem_cache_free(ipa_ctx->rx_pkt_wrapper_cache, rx_pkt);
+	return NULL;
+}
+
+/**
+ * ipa_page_replenish_rx_cache() - Post page buffers on a NAPI pipe
+ *
+ * Called for each received buffer from the NAPI poll, so it never sleeps.
+ */
+static void ipa_page_replenish_rx_cache(struct ipa_sys_context *sys)
+{
+	struct ipa_rx_pkt_wrapper *rx_pkt;
+	int ret;
+
+	while (sys->len < sys->rx_pool_sz) {
+		rx_pkt = ipa_get_rx_page(sys);
+		if (!rx_pkt)
+			break;
+
+		list_add_tail(&rx_pkt->link, &sys->head_desc_list);
+		ret = sps_transfer_one(sys->ep->ep_hdl,
+			rx_pkt->data.dma_addr, sys->rx_buff_sz, rx_pkt, 0);
+		if (ret) {
+			IPAERR("sps_transfer_one failed %d\n", ret);
+			list_del(&rx_pkt->link);
+			ipa_free_rx_page(sys, rx_pkt);
+			break;
+		}
+		sys->len++;
+	}
+
+	if (sys->len == 0) {
+		IPA_STATS_INC_CNT(ipa_ctx->stats.wan_rx_empty);
+		queue_delayed_work(sys->wq, &sys->replenish_rx_work,
+				msecs_to_jiffies(1));
+	}
+}
+
 static void replenish_rx_work_func(struct work_struct *work)
 {
 	struct delayed_work *dwork;
 	struct ipa_sys_context *sys;
 	dwork = container_of(work, struct delayed_work, work);
 	sys = container_of(dwork, struct ipa_sys_context, replenish_rx_work);
+	if (sys->ep->napi_enabled && atomic_read(&sys->curr_polling_state)) {
+		/* the NAPI poll owns the descriptor list until it completes */
+		queue_delayed_work(sys->wq, &sys->replenish_rx_work,
+				msecs_to_jiffies(1));
+		return;
+	}
 	ipa_inc_client_enable_clks();
 	sys->repl_hdlr(sys);
 	ipa_dec_client_disable_clks();
@@ -1786,6 +2096,21 @@ static void ipa_cleanup_rx(struct ipa_sys_context *sys)
 	u32 head;
 	u32 tail;
 
+	if (sys->ep->napi_enabled) {
+		list_for_each_entry_safe(rx_pkt, r,
+					 &sys->head_desc_list, link) {
+			list_del(&rx_pkt->link);
+			ipa_free_rx_page(sys, rx_pkt);
+		}
+		list_for_each_entry_safe(rx_pkt, r,
+					 &sys->rx_page_recycle, link) {
+			list_del(&rx_pkt->link);
+			ipa_free_rx_page(sys, rx_pkt);
+		}
+		sys->rx_page_nr_recycle = 0;
+		return;
+	}
+
 	list_for_each_entry_safe(rx_pkt, r,
 				 &sys->head_desc_list, link) {
 		list_del(&rx_pkt->link);
@@ -2053,12 +2378,12 @@ begin:
 }
 
 static struct sk_buff *join_prev_skb(struct sk_buff *prev_skb,
-		struct sk_buff *skb, unsigned int len)
+		struct sk_buff *skb, unsigned int len, gfp_t flags)
 {
 	struct sk_buff *skb2;
 
 	skb2 = skb_copy_expand(prev_skb, 0,
-			len, GFP_KERNEL);
+			len, flags);
 	if (likely(skb2)) {
 		memcpy(skb_put(skb2, len),
 			skb->data, len);
@@ -2075,18 +2400,21 @@ static void wan_rx_handle_splt_pyld(struct sk_buff *skb,
 		struct ipa_sys_context *sys)
 {
 	struct sk_buff *skb2;
+	/* NAPI clients poll from softirq */
+	gfp_t flags = sys->ep->napi_enabled ? GFP_ATOMIC : GFP_KERNEL;
 
 	IPADBG("rem %d skb %d\n", sys->len_rem, skb->len);
 	if (sys->len_rem <= skb->len) {
 		if (sys->prev_skb) {
 			skb2 = join_prev_skb(sys->prev_skb, skb,
-					sys->len_rem);
+					sys->len_rem, flags);
 			if (likely(skb2)) {
 				IPADBG(
 					"removing Status element from skb and sending to WAN client");
 				skb_pull(skb2, IPA_PKT_STATUS_SIZE);
 				skb2->truesize = skb2->len +
 					sizeof(struct sk_buff);
+				sys->poll_pkts++;
 				sys->ep->client_notify(sys->ep->priv,
 					IPA_RECEIVE,
 					(unsigned long)(skb2));
@@ -2098,7 +2426,7 @@ static void wan_rx_handle_splt_pyld(struct sk_buff *skb,
 	} else {
 		if (sys->prev_skb) {
 			skb2 = join_prev_skb(sys->prev_skb, skb,
-					skb->len);
+					skb->len, flags);
 			sys->prev_skb = skb2;
 		}
 		sys->len_rem -= skb->len;
@@ -2202,7 +2530,8 @@ static int ipa_wan_rx_pyld_hdlr(struct sk_buff *skb,
 			frame_len += IPA_DL_CHECKSUM_LENGTH;
 		IPADBG("frame_len %d\n", frame_len);
 
-		skb2 = skb_clone(skb, GFP_KERNEL);
+		skb2 = skb_clone(skb, sys->ep->napi_enabled ?
+				 GFP_ATOMIC : GFP_KERNEL);
 		if (likely(skb2)) {
 			/*
 			 * the len of actual data is smaller than expected
@@ -2225,6 +2554,7 @@ static int ipa_wan_rx_pyld_hdlr(struct sk_buff *skb,
 					sizeof(struct sk_buff) +
 					(ALIGN(frame_len, 32) *
 					 unused / used_align);
+				sys->poll_pkts++;
 				sys->ep->client_notify(sys->ep->priv,
 					IPA_RECEIVE, (unsigned long)(skb2));
 				skb_pull(skb, frame_len);
@@ -2351,6 +2681,34 @@ void ipa_lan_rx_cb(void *priv, enum ipa_dp_evt_type evt, unsigned long data)
 	ep->client_notify(ep->priv, IPA_RECEIVE, (unsigned long)(rx_skb));
 }
 
+static void ipa_wq_rx_page(struct ipa_sys_context *sys,
+		struct ipa_rx_pkt_wrapper *rx_pkt)
+{
+	struct sk_buff *rx_skb;
+
+	dma_sync_single_for_cpu(ipa_ctx->pdev, rx_pkt->data.dma_addr,
+			sys->rx_buff_sz, DMA_FROM_DEVICE);
+	rx_skb = build_skb(page_address(rx_pkt->page),
+			PAGE_SIZE << IPA_RX_PAGE_ORDER);
+	if (likely(rx_skb)) {
+		/* dropped when the last skb using the page is freed */
+		get_page(rx_pkt->page);
+		skb_reserve(rx_skb, IPA_HEADROOM);
+		skb_put(rx_skb, rx_pkt->len);
+		*(unsigned int *)rx_skb->cb = rx_skb->len;
+		rx_skb->truesize = rx_pkt->len + sizeof(struct sk_buff);
+	}
+	list_add_tail(&rx_pkt->link, &sys->rx_page_recycle);
+	sys->rx_page_nr_recycle++;
+
+	if (likely(rx_skb))
+		sys->pyld_hdlr(rx_skb, sys);
+	else
+		pr_err_ratelimited("%s fail to build skb sys=%p\n",
+				__func__, sys);
+	sys->repl_hdlr(sys);
+}
+
 static void ipa_wq_rx_common(struct ipa_sys_context *sys, u32 size)
 {
 	struct ipa_rx_pkt_wrapper *rx_pkt_expected;
@@ -2367,6 +2725,10 @@ static void ipa_wq_rx_common(struct ipa_sys_context *sys, u32 size)
 	sys->len--;
 	if (size)
 		rx_pkt_expected->len = size;
+	if (sys->ep->napi_enabled) {
+		ipa_wq_rx_page(sys, rx_pkt_expected);
+		return;
+	}
 	rx_skb = rx_pkt_expected->data.skb;
 	dma_unmap_single(ipa_ctx->pdev, rx_pkt_expected->data.dma_addr,
 			sys->rx_buff_sz, DMA_FROM_DEVICE);
@@ -2587,7 +2949,11 @@ static int ipa_assign_policy(struct ipa_sys_connect_params *in,
 					sys->rx_pool_sz =
 						ipa_ctx->wan_rx_ring_size;
 				}
-				if (nr_cpu_ids > 1)
+				if (sys->ep->napi_enabled) {
+					INIT_LIST_HEAD(&sys->rx_page_recycle);
+					sys->repl_hdlr =
+						ipa_page_replenish_rx_cache;
+				} else if (nr_cpu_ids > 1)
 					sys->repl_hdlr =
 						ipa_fast_replenish_rx_cache;
 				else
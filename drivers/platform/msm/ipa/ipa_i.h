@@ -65,6 +65,12 @@
 
 #define MAX_NUM_EXCP     8
 
+/* NAPI polls of the WAN pipe by packets handled, 0, 1, 2-3, ... 64+ */
+#define IPA_WAN_NAPI_HIST 8
+
+/* most single descriptors queued on a TX pipe behind one doorbell */
+#define IPA_TX_BATCH_MAX 16
+
 #define IPA_STATS
 
 #ifdef IPA_STATS
@@ -520,6 +526,7 @@ struct ipa_ep_context {
 	u32 dflt_flt6_rule_hdl;
 	bool skip_ep_cfg;
 	bool keep_ipa_awake;
+	bool napi_enabled;
 	struct ipa_wlan_stats wstats;
 	u32 wdi_state;
 
@@ -547,6 +554,10 @@ struct ipa_repl_ctx {
  * @spinlock: protects the list and its size
  * @event: used to request CALLBACK mode from SPS driver
  * @ep: IPA EP context
+ * @poll_pkts: packets handed to the client by the current ipa_rx_poll()
+ * @rx_page_recycle: received page buffers of a NAPI pipe, oldest first,
+ *	waiting for the stack to release them
+ * @rx_page_nr_recycle: the size of the above list
  *
  * IPA context specific to the system-bam pipes a.k.a LAN IN/OUT and WAN
  */
@@ -572,6 +583,10 @@ struct ipa_sys_context {
 	struct work_struct repl_work;
 	void (*repl_hdlr)(struct ipa_sys_context *sys);
 	struct ipa_repl_ctx repl;
+	u32 poll_pkts;
+	struct list_head rx_page_recycle;
+	u32 rx_page_nr_recycle;
+	u32 tx_deferred;
 
 	/* ordering is important - mutable fields go above */
 	struct ipa_ep_context *ep;
@@ -641,6 +656,8 @@ struct ipa_tx_pkt_wrapper {
  * @user1: cookie1 for above callback
  * @user2: cookie2 for above callback
  * @xfer_done: completion object for sync completion
+ * @xmit_more: more descriptors follow, ipa_send_one() may leave this one
+ * in the descriptor FIFO without ringing the doorbell
  */
 struct ipa_desc {
 	enum ipa_desc_type type;
@@ -653,6 +670,7 @@ struct ipa_desc {
 	void *user1;
 	int user2;
 	struct completion xfer_done;
+	bool xmit_more;
 };
 
 /**
@@ -668,6 +686,7 @@ struct ipa_rx_pkt_wrapper {
 	u32 len;
 	struct work_struct work;
 	struct ipa_sys_context *sys;
+	struct page *page;
 };
 
 /**
@@ -752,6 +771,14 @@ struct ipa_stats {
 	u32 wan_repl_rx_empty;
 	u32 lan_rx_empty;
 	u32 lan_repl_rx_empty;
+	u32 wan_napi_polls[IPA_WAN_NAPI_HIST];
+	u32 wan_rx_page_recycle;
+	u32 wan_rx_page_alloc;
+	u32 tx_deferred;
+	u32 tx_batches;
+	u32 nat_offload_add;
+	u32 nat_offload_del;
+	u32 nat_offload_full;
 };
 
 struct ipa_active_clients {
@@ -1024,6 +1051,9 @@ struct ipa_uc_ctx {
  * @wdi_uc_top_mmio:
  * @wdi_uc_stats_ofst:
  * @wdi_uc_stats_mmio:
+ * @wdi_err_work: work notifying clients of pipes the uC reported errors on
+ * @wdi_err_pipes: pipes pending an IPA_WDI_PIPE_ERROR notification
+ * @wdi_err_cnt: uC WDI error events received per pipe
  */
 struct ipa_uc_wdi_ctx {
 	/* WDI specific fields */
@@ -1032,6 +1062,9 @@ struct ipa_uc_wdi_ctx {
 	struct IpaHwStatsWDIInfoData_t *wdi_uc_stats_mmio;
 	void *priv;
 	ipa_uc_ready_cb uc_ready_cb;
+	struct work_struct wdi_err_work;
+	unsigned long wdi_err_pipes;
+	u32 wdi_err_cnt[IPA_NUM_PIPES];
 };
 
 /**
@@ -1570,4 +1603,17 @@ int ipa_uc_mhi_stop_event_update_channel(int channelHandle);
 int ipa_uc_mhi_print_stats(char *dbg_buff, int size);
 int ipa_uc_memcpy(phys_addr_t dest, phys_addr_t src, int len);
 void ipa_sps_irq_rx_notify_all(void);
+
+#ifdef CONFIG_IPA_NAT_OFFLOAD
+void ipa_nat_offload_start(void);
+void ipa_nat_offload_stop(void);
+#else
+static inline void ipa_nat_offload_start(void)
+{
+}
+
+static inline void ipa_nat_offload_stop(void)
+{
+}
+#endif
 #endif /* _IPA_I_H_ */
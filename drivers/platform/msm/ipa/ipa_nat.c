@@ -540,6 +540,8 @@ int ipa_nat_init_cmd(struct ipa_ioc_v4_nat_init *init)
 	IPADBG("size_expansion_tables: %d\n", init->expn_table_entries);
 	ipa_ctx->nat_mem.size_expansion_tables = init->expn_table_entries;
 
+	ipa_nat_offload_start();
+
 	IPADBG("return\n");
 	result = 0;
 free_mem:
@@ -736,6 +738,8 @@ int ipa_nat_del_cmd(struct ipa_ioc_v4_nat_del *del)
 		goto bail;
 	}
 
+	ipa_nat_offload_stop();
+
 	memset(&desc, 0, sizeof(desc));
 	/* NO-OP IC for ensuring that IPA pipeline is empty */
 	reg_write_nop = kzalloc(sizeof(*reg_write_nop), GFP_KERNEL);
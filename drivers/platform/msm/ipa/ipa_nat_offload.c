@@ -0,0 +1,532 @@
+/* Copyright (c) 2012-2016, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * In-kernel programming of the IPA v4 NAT table for forwarded flows.
+ *
+ * Once conntrack has seen both directions of a TCP/UDP flow that is source
+ * NATed to the public address of the NAT table, a rule for it is written
+ * straight into the table, so that the rest of the flow is translated and
+ * routed by IPA. The hardware time stamp of the rule is used to keep the
+ * conntrack entry alive while IPA forwards the flow, and the rule is removed
+ * when the conntrack entry times out.
+ *
+ * The driver owns all rules of the table while this is enabled, the NAT
+ * client must not add its own. Only tables in system memory are supported.
+ */
+
+#include <linux/bitmap.h>
+#include <linux/hashtable.h>
+#include <linux/module.h>
+#include <linux/netfilter.h>
+#include <linux/netfilter_ipv4.h>
+#include <linux/slab.h>
+#include <linux/workqueue.h>
+#include <net/netfilter/nf_conntrack.h>
+#include <net/netfilter/nf_conntrack_helper.h>
+#include "ipa_i.h"
+
+#define IPA_NAT_OFFLOAD_AGE_MSEC 5000
+#define IPA_NAT_OFFLOAD_HASH_BITS 8
+
+#define IPA_NAT_RULE_ENABLE 0x8000
+#define IPA_NAT_RULE_TIME_STAMP 0xFFFFFF
+
+static bool nat_offload;
+module_param(nat_offload, bool, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(nat_offload,
+	"Program the NAT table from conntrack, applied on NAT table init");
+
+/* rule as laid out in the base and expansion tables */
+struct ipa_nat_hw_rule {
+	u32 private_ip;
+	u32 target_ip;
+	u16 next_index;
+	u16 public_port;
+	u16 private_port;
+	u16 target_port;
+	u16 ip_chksum;
+	u16 flags;
+	u32 time_stamp_proto;
+	u16 prev_index;
+	u16 indx_tbl_entry;
+	u16 rsvd;
+	u16 tcp_udp_chksum;
+};
+
+/* entry of the index and index expansion tables */
+struct ipa_nat_hw_index {
+	u16 tbl_entry;
+	u16 next_index;
+};
+
+struct ipa_nat_offload_flow {
+	struct hlist_node node;
+	struct nf_conn *ct;
+	u16 rule;
+	u16 index;
+	u32 time_stamp;
+	unsigned long timeout;
+};
+
+/*
+ * Slots are numbered as the hardware does, the base table first and the
+ * expansion table after it. Slot 0 of either table is never used, a zero
+ * next_index ends a chain. A slot of the expansion tables stays linked into
+ * the chain it was first taken for until the table is deleted and is only
+ * reused for the same chain.
+ */
+struct ipa_nat_offload_ctx {
+	spinlock_t lock;
+	bool ready;
+	u32 base_size;
+	u32 nr_slots;
+	unsigned long *rule_used;
+	unsigned long *rule_linked;
+	unsigned long *index_used;
+	unsigned long *index_linked;
+	DECLARE_HASHTABLE(flows, IPA_NAT_OFFLOAD_HASH_BITS);
+	struct delayed_work age_work;
+};
+
+static struct ipa_nat_offload_ctx ipa_nat_ofl = {
+	.lock = __SPIN_LOCK_UNLOCKED(ipa_nat_ofl.lock),
+};
+
+static struct ipa_nat_hw_rule *ipa_nat_rule(u16 slot)
+{
+	struct ipa_nat_hw_rule *tbl;
+
+	if (slot <= ipa_nat_ofl.base_size)
+		tbl = (struct ipa_nat_hw_rule *)ipa_ctx->nat_mem.ipv4_rules_addr;
+	else
+		tbl = (struct ipa_nat_hw_rule *)
+			ipa_ctx->nat_mem.ipv4_expansion_rules_addr -
+			(ipa_nat_ofl.base_size + 1);
+
+	return tbl + slot;
+}
+
+static struct ipa_nat_hw_index *ipa_nat_index(u16 slot)
+{
+	struct ipa_nat_hw_index *tbl;
+
+	if (slot <= ipa_nat_ofl.base_size)
+		tbl = (struct ipa_nat_hw_index *)
+			ipa_ctx->nat_mem.index_table_addr;
+	else
+		tbl = (struct ipa_nat_hw_index *)
+			ipa_ctx->nat_mem.index_table_expansion_addr -
+			(ipa_nat_ofl.base_size + 1);
+
+	return tbl + slot;
+}
+
+static u16 ipa_nat_hash_fold(u16 hash)
+{
+	hash &= ipa_nat_ofl.base_size;
+
+	return hash ? hash : ipa_nat_ofl.base_size;
+}
+
+/* rules table is looked up by the uplink tuple */
+static u16 ipa_nat_src_hash(u32 priv_ip, u16 priv_port, u32 trgt_ip,
+		u16 trgt_port, u8 proto)
+{
+	return ipa_nat_hash_fold((u16)priv_ip ^ (u16)(priv_ip >> 16) ^
+		priv_port ^ (u16)trgt_ip ^ (u16)(trgt_ip >> 16) ^
+		trgt_port ^ proto);
+}
+
+/* index table is looked up by the downlink tuple */
+static u16 ipa_nat_dst_hash(u32 trgt_ip, u16 trgt_port, u16 pub_port,
+		u8 proto)
+{
+	return ipa_nat_hash_fold((u16)trgt_ip ^ (u16)(trgt_ip >> 16) ^
+		trgt_port ^ pub_port ^ proto);
+}
+
+/* one's complement delta that turns a checksum over @from into one over @to */
+static u16 ipa_nat_csum_delta(u32 from_ip, u16 from_port, u32 to_ip,
+		u16 to_port)
+{
+	u32 sum;
+
+	sum = (to_ip >> 16) + (to_ip & 0xFFFF) + to_port;
+	sum += (~from_ip >> 16) + (~from_ip & 0xFFFF) + (u16)~from_port;
+	while (sum >> 16)
+		sum = (sum & 0xFFFF) + (sum >> 16);
+
+	return sum;
+}
+
+/*
+ * Finds a free slot on the chain starting at @head, or links a new
+ * expansion slot behind its tail. *@tail gets the slot to link the new one
+ * from, 0 if it is already on the chain.
+ */
+static int ipa_nat_chain_slot(u16 head, unsigned long *used,
+		unsigned long *linked, bool rules, u16 *tail)
+{
+	u16 slot = head;
+	u16 prev;
+
+	do {
+		if (!test_bit(slot, used)) {
+			*tail = 0;
+			return slot;
+		}
+		prev = slot;
+		slot = rules ? ipa_nat_rule(slot)->next_index :
+			ipa_nat_index(slot)->next_index;
+	} while (slot);
+
+	slot = find_next_zero_bit(linked, ipa_nat_ofl.nr_slots,
+			ipa_nat_ofl.base_size + 2);
+	if (slot >= ipa_nat_ofl.nr_slots)
+		return -ENOSPC;
+
+	set_bit(slot, linked);
+	*tail = prev;
+	return slot;
+}
+
+static int ipa_nat_offload_program(struct ipa_nat_offload_flow *flow)
+{
+	const struct nf_conntrack_tuple *orig =
+		&flow->ct->tuplehash[IP_CT_DIR_ORIGINAL].tuple;
+	const struct nf_conntrack_tuple *reply =
+		&flow->ct->tuplehash[IP_CT_DIR_REPLY].tuple;
+	u32 priv_ip = ntohl(orig->src.u3.ip);
+	u16 priv_port = ntohs(orig->src.u.all);
+	u32 trgt_ip = ntohl(orig->dst.u3.ip);
+	u16 trgt_port = ntohs(orig->dst.u.all);
+	u32 pub_ip = ntohl(reply->dst.u3.ip);
+	u16 pub_port = ntohs(reply->dst.u.all);
+	u8 proto = nf_ct_protonum(flow->ct);
+	struct ipa_nat_hw_rule *rule;
+	struct ipa_nat_hw_index *index;
+	u16 rule_tail, index_tail;
+	int rule_slot, index_slot;
+
+	rule_slot = ipa_nat_chain_slot(ipa_nat_src_hash(priv_ip, priv_port,
+			trgt_ip, trgt_port, proto), ipa_nat_ofl.rule_used,
+			ipa_nat_ofl.rule_linked, true, &rule_tail);
+	if (rule_slot < 0)
+		return rule_slot;
+
+	index_slot = ipa_nat_chain_slot(ipa_nat_dst_hash(trgt_ip, trgt_port,
+			pub_port, proto), ipa_nat_ofl.index_used,
+			ipa_nat_ofl.index_linked, false, &index_tail);
+	if (index_slot < 0) {
+		if (rule_tail)
+			clear_bit(rule_slot, ipa_nat_ofl.rule_linked);
+		return index_slot;
+	}
+
+	rule = ipa_nat_rule(rule_slot);
+	rule->private_ip = priv_ip;
+	rule->target_ip = trgt_ip;
+	if (rule_tail)
+		rule->next_index = 0;
+	rule->public_port = pub_port;
+	rule->private_port = priv_port;
+	rule->target_port = trgt_port;
+	rule->time_stamp_proto = proto << 24;
+	if (rule_tail)
+		rule->prev_index = rule_tail;
+	rule->indx_tbl_entry = index_slot;
+	rule->rsvd = 0;
+	rule->tcp_udp_chksum = ipa_nat_csum_delta(priv_ip, priv_port,
+			pub_ip, pub_port);
+	rule->ip_chksum = ipa_nat_csum_delta(priv_ip, 0, pub_ip, 0);
+	/* the rule must be complete before IPA can match it */
+	wmb();
+	rule->flags = IPA_NAT_RULE_ENABLE;
+	if (rule_tail)
+		ipa_nat_rule(rule_tail)->next_index = rule_slot;
+
+	index = ipa_nat_index(index_slot);
+	if (index_tail)
+		index->next_index = 0;
+	index->tbl_entry = rule_slot;
+	wmb();
+	if (index_tail)
+		ipa_nat_index(index_tail)->next_index = index_slot;
+
+	set_bit(rule_slot, ipa_nat_ofl.rule_used);
+	set_bit(index_slot, ipa_nat_ofl.index_used);
+	flow->rule = rule_slot;
+	flow->index = index_slot;
+
+	return 0;
+}
+
+/*
+ * The rule is only disabled, it stays on its chain. A stale index entry is
+ * harmless as IPA checks the rule it points to.
+ */
+static void ipa_nat_offload_unprogram(struct ipa_nat_offload_flow *flow)
+{
+	ipa_nat_rule(flow->rule)->flags = 0;
+	clear_bit(flow->rule, ipa_nat_ofl.rule_used);
+	clear_bit(flow->index, ipa_nat_ofl.index_used);
+}
+
+static struct ipa_nat_offload_flow *ipa_nat_offload_find(struct nf_conn *ct)
+{
+	struct ipa_nat_offload_flow *flow;
+
+	hash_for_each_possible(ipa_nat_ofl.flows, flow, node, (unsigned long)ct)
+		if (flow->ct == ct)
+			return flow;
+
+	return NULL;
+}
+
+static void ipa_nat_offload_add(struct nf_conn *ct)
+{
+	struct ipa_nat_offload_flow *flow;
+	long timeout;
+
+	spin_lock_bh(&ipa_nat_ofl.lock);
+	if (!ipa_nat_ofl.ready || ipa_nat_offload_find(ct))
+		goto bail;
+
+	if (ntohl(ct->tuplehash[IP_CT_DIR_REPLY].tuple.dst.u3.ip) !=
+			ipa_ctx->nat_mem.public_ip_addr)
+		goto bail;
+
+	/* the packet that got here just refreshed it to the full timeout */
+	timeout = (long)(ct->timeout.expires - jiffies);
+	if (timeout <= 0)
+		goto bail;
+
+	flow = kzalloc(sizeof(*flow), GFP_ATOMIC);
+	if (!flow)
+		goto bail;
+
+	flow->ct = ct;
+	flow->timeout = timeout;
+	if (ipa_nat_offload_program(flow)) {
+		IPA_STATS_INC_CNT(ipa_ctx->stats.nat_offload_full);
+		kfree(flow);
+		goto bail;
+	}
+
+	nf_conntrack_get(&ct->ct_general);
+	hash_add(ipa_nat_ofl.flows, &flow->node, (unsigned long)ct);
+	IPA_STATS_INC_CNT(ipa_ctx->stats.nat_offload_add);
+bail:
+	spin_unlock_bh(&ipa_nat_ofl.lock);
+}
+
+static unsigned int ipa_nat_offload_hook(unsigned int hooknum,
+		struct sk_buff *skb, const struct net_device *in,
+		const struct net_device *out, int (*okfn)(struct sk_buff *))
+{
+	enum ip_conntrack_info ctinfo;
+	struct nf_conn *ct;
+	u8 proto;
+
+	ct = nf_ct_get(skb, &ctinfo);
+	if (!ct || nf_ct_is_untracked(ct))
+		return NF_ACCEPT;
+
+	if (!test_bit(IPS_ASSURED_BIT, &ct->status) ||
+		!test_bit(IPS_SRC_NAT_DONE_BIT, &ct->status) ||
+		(ct->status & (IPS_SRC_NAT | IPS_DST_NAT)) != IPS_SRC_NAT ||
+		nfct_help(ct))
+		return NF_ACCEPT;
+
+	proto = nf_ct_protonum(ct);
+	if (proto == IPPROTO_TCP || proto == IPPROTO_UDP)
+		ipa_nat_offload_add(ct);
+
+	return NF_ACCEPT;
+}
+
+static struct nf_hook_ops ipa_nat_offload_ops = {
+	.hook = ipa_nat_offload_hook,
+	.owner = THIS_MODULE,
+	.pf = NFPROTO_IPV4,
+	.hooknum = NF_INET_FORWARD,
+	.priority = NF_IP_PRI_LAST,
+};
+
+/*
+ * Keeps the conntrack entries of flows IPA forwarded since the last pass
+ * alive, and removes the rules of the ones that timed out.
+ */
+static void ipa_nat_offload_age(struct work_struct *work)
+{
+	struct ipa_nat_offload_flow *flow;
+	struct hlist_node *tmp;
+	HLIST_HEAD(expired);
+	u32 time_stamp;
+	int bkt;
+
+	spin_lock_bh(&ipa_nat_ofl.lock);
+	if (!ipa_nat_ofl.ready) {
+		spin_unlock_bh(&ipa_nat_ofl.lock);
+		return;
+	}
+
+	hash_for_each_safe(ipa_nat_ofl.flows, bkt, tmp, flow, node) {
+		if (nf_ct_is_dying(flow->ct)) {
+			ipa_nat_offload_unprogram(flow);
+			hash_del(&flow->node);
+			hlist_add_head(&flow->node, &expired);
+			IPA_STATS_INC_CNT(ipa_ctx->stats.nat_offload_del);
+			continue;
+		}
+
+		time_stamp = ipa_nat_rule(flow->rule)->time_stamp_proto &
+			IPA_NAT_RULE_TIME_STAMP;
+		if (time_stamp == flow->time_stamp)
+			continue;
+
+		flow->time_stamp = time_stamp;
+		if (!test_bit(IPS_FIXED_TIMEOUT_BIT, &flow->ct->status))
+			mod_timer_pending(&flow->ct->timeout,
+				jiffies + flow->timeout);
+	}
+	spin_unlock_bh(&ipa_nat_ofl.lock);
+
+	hlist_for_each_entry_safe(flow, tmp, &expired, node) {
+		nf_ct_put(flow->ct);
+		kfree(flow);
+	}
+
+	schedule_delayed_work(&ipa_nat_ofl.age_work,
+		msecs_to_jiffies(IPA_NAT_OFFLOAD_AGE_MSEC));
+}
+
+/**
+ * ipa_nat_offload_start() - start programming the NAT table from conntrack
+ *
+ * Called once a v4 NAT table has been initialized. Does nothing unless the
+ * nat_offload parameter is set and the table is in system memory.
+ */
+void ipa_nat_offload_start(void)
+{
+	u32 nr_slots;
+
+	ipa_nat_offload_stop();
+
+	if (!nat_offload)
+		return;
+
+	if (!ipa_ctx->nat_mem.is_sys_mem) {
+		IPAERR("NAT offload needs the table in system memory\n");
+		return;
+	}
+
+	nr_slots = ipa_ctx->nat_mem.size_base_tables + 1 +
+		ipa_ctx->nat_mem.size_expansion_tables + 1;
+	if (nr_slots > USHRT_MAX) {
+		IPAERR("NAT table too large for offload %u\n", nr_slots);
+		return;
+	}
+
+	ipa_nat_ofl.rule_used = kcalloc(BITS_TO_LONGS(nr_slots),
+			sizeof(long), GFP_KERNEL);
+	ipa_nat_ofl.rule_linked = kcalloc(BITS_TO_LONGS(nr_slots),
+			sizeof(long), GFP_KERNEL);
+	ipa_nat_ofl.index_used = kcalloc(BITS_TO_LONGS(nr_slots),
+			sizeof(long), GFP_KERNEL);
+	ipa_nat_ofl.index_linked = kcalloc(BITS_TO_LONGS(nr_slots),
+			sizeof(long), GFP_KERNEL);
+	if (!ipa_nat_ofl.rule_used || !ipa_nat_ofl.rule_linked ||
+		!ipa_nat_ofl.index_used || !ipa_nat_ofl.index_linked) {
+		IPAERR("failed to alloc NAT offload slots\n");
+		goto fail_alloc;
+	}
+
+	/* slot 0 of the base table, expansion slots are taken from 1 */
+	set_bit(0, ipa_nat_ofl.rule_used);
+	set_bit(0, ipa_nat_ofl.index_used);
+
+	hash_init(ipa_nat_ofl.flows);
+	INIT_DELAYED_WORK(&ipa_nat_ofl.age_work, ipa_nat_offload_age);
+
+	spin_lock_bh(&ipa_nat_ofl.lock);
+	ipa_nat_ofl.base_size = ipa_ctx->nat_mem.size_base_tables;
+	ipa_nat_ofl.nr_slots = nr_slots;
+	ipa_nat_ofl.ready = true;
+	spin_unlock_bh(&ipa_nat_ofl.lock);
+
+	if (nf_register_hook(&ipa_nat_offload_ops)) {
+		IPAERR("failed to register NAT offload hook\n");
+		ipa_nat_ofl.ready = false;
+		goto fail_alloc;
+	}
+
+	schedule_delayed_work(&ipa_nat_ofl.age_work,
+		msecs_to_jiffies(IPA_NAT_OFFLOAD_AGE_MSEC));
+	IPADBG("NAT offload started, %u slots\n", nr_slots);
+	return;
+
+fail_alloc:
+	kfree(ipa_nat_ofl.rule_used);
+	kfree(ipa_nat_ofl.rule_linked);
+	kfree(ipa_nat_ofl.index_used);
+	kfree(ipa_nat_ofl.index_linked);
+	ipa_nat_ofl.rule_used = NULL;
+	ipa_nat_ofl.rule_linked = NULL;
+	ipa_nat_ofl.index_used = NULL;
+	ipa_nat_ofl.index_linked = NULL;
+}
+
+/**
+ * ipa_nat_offload_stop() - stop programming the NAT table
+ *
+ * Called before the v4 NAT table is deleted, drops all offloaded flows. The
+ * rules are left in the table, which goes away with them.
+ */
+void ipa_nat_offload_stop(void)
+{
+	struct ipa_nat_offload_flow *flow;
+	struct hlist_node *tmp;
+	HLIST_HEAD(flows);
+	int bkt;
+
+	if (!ipa_nat_ofl.ready)
+		return;
+
+	nf_unregister_hook(&ipa_nat_offload_ops);
+
+	spin_lock_bh(&ipa_nat_ofl.lock);
+	ipa_nat_ofl.ready = false;
+	hash_for_each_safe(ipa_nat_ofl.flows, bkt, tmp, flow, node) {
+		hash_del(&flow->node);
+		hlist_add_head(&flow->node, &flows);
+	}
+	spin_unlock_bh(&ipa_nat_ofl.lock);
+
+	cancel_delayed_work_sync(&ipa_nat_ofl.age_work);
+
+	hlist_for_each_entry_safe(flow, tmp, &flows, node) {
+		nf_ct_put(flow->ct);
+		kfree(flow);
+	}
+
+	kfree(ipa_nat_ofl.rule_used);
+	kfree(ipa_nat_ofl.rule_linked);
+	kfree(ipa_nat_ofl.index_used);
+	kfree(ipa_nat_ofl.index_linked);
+	ipa_nat_ofl.rule_used = NULL;
+	ipa_nat_ofl.rule_linked = NULL;
+	ipa_nat_ofl.index_used = NULL;
+	ipa_nat_ofl.index_linked = NULL;
+	IPADBG("NAT offload stopped\n");
+}
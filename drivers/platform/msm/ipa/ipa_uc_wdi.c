@@ -366,6 +366,39 @@ static void ipa_uc_wdi_event_handler(struct IpaHwSharedMemCommonMapping_t
 			IPADBG("tx_ch_state=%u rx_ch_state=%u\n",
 				wdi_sram_mmio_ext->wdi_tx_ch_0_state,
 				wdi_sram_mmio_ext->wdi_rx_ch_0_state);
+
+			if (wdi_evt.params.ipa_pipe_number < IPA_NUM_PIPES) {
+				ipa_ctx->uc_wdi_ctx.wdi_err_cnt[
+					wdi_evt.params.ipa_pipe_number]++;
+				set_bit(wdi_evt.params.ipa_pipe_number,
+					&ipa_ctx->uc_wdi_ctx.wdi_err_pipes);
+				schedule_work(&ipa_ctx->uc_wdi_ctx.wdi_err_work);
+			}
+	}
+}
+
+/*
+ * Tell the clients of the pipes the uC reported errors on, so that they
+ * disable offload and carry the traffic on their host path instead.
+ */
+static void ipa_uc_wdi_err_work(struct work_struct *work)
+{
+	struct ipa_ep_context *ep;
+	int pipe;
+
+	for (pipe = 0; pipe < IPA_NUM_PIPES; pipe++) {
+		if (!test_and_clear_bit(pipe,
+				&ipa_ctx->uc_wdi_ctx.wdi_err_pipes))
+			continue;
+
+		ep = &ipa_ctx->ep[pipe];
+		if (!ep->valid || !(ep->wdi_state & IPA_WDI_CONNECTED))
+			continue;
+
+		IPAERR("uC WDI error on ep=%d, falling back to host path\n",
+			pipe);
+		if (ep->client_notify)
+			ep->client_notify(ep->priv, IPA_WDI_PIPE_ERROR, 0);
 	}
 }
 
@@ -447,6 +480,8 @@ int ipa_wdi_init(void)
 		return -ENOMEM;
 	}
 
+	INIT_WORK(&ipa_ctx->uc_wdi_ctx.wdi_err_work, ipa_uc_wdi_err_work);
+
 	uc_wdi_cbs.ipa_uc_event_hdlr = ipa_uc_wdi_event_handler;
 	uc_wdi_cbs.ipa_uc_event_log_info_hdlr =
 		ipa_uc_wdi_event_log_info_handler;
@@ -50,6 +50,15 @@
 #define IPA_QUOTA_REACH_ALERT_MAX_SIZE 64
 #define IPA_QUOTA_REACH_IF_NAME_MAX_SIZE 64
 #define IPA_UEVENT_NUM_EVNP 4 /* number of event pointers */
+#define IPA_WWAN_NAPI_WEIGHT 64
+
+static int napi_weight = IPA_WWAN_NAPI_WEIGHT;
+module_param(napi_weight, int, S_IRUGO);
+MODULE_PARM_DESC(napi_weight, "WAN RX packets handled per NAPI poll");
+
+static int rx_cpu = -1;
+module_param(rx_cpu, int, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(rx_cpu, "CPU polling WAN RX with NAPI, -1 for any");
 
 static struct net_device *ipa_netdevs[IPA_WWAN_DEVICE_COUNT];
 static struct ipa_sys_connect_params apps_to_ipa_ep_cfg, ipa_to_apps_ep_cfg;
@@ -82,8 +91,11 @@ enum wwan_device_status {
 struct ipa_rmnet_plat_drv_res {
 	bool ipa_rmnet_ssr;
 	bool ipa_loaduC;
+	bool ipa_napi_enable;
 };
 
+static struct ipa_rmnet_plat_drv_res ipa_rmnet_res = {0, };
+
 /**
  * struct wwan_private - WWAN private data
  * @net: network interface struct implemented by this driver
@@ -94,6 +106,7 @@ struct ipa_rmnet_plat_drv_res {
  * @ch_id: channel id
  * @lock: spinlock for mutual exclusion
  * @device_status: holds device status
+ * @napi: polls the IPA->APPS pipe when qcom,ipa-napi-enable is set
  *
  * WWAN private - holds all relevant info about WWAN driver
  */
@@ -107,6 +120,7 @@ struct wwan_private {
 	spinlock_t lock;
 	struct completion resource_granted_completion;
 	enum wwan_device_status device_status;
+	struct napi_struct napi;
 };
 
 /**
@@ -948,6 +962,20 @@ static int ipa_wwan_change_mtu(struct net_device *dev, int new_mtu)
 	return 0;
 }
 
+/*
+ * More packets wait in the qdisc and will be sent before the queue stops, so
+ * the doorbell for this one can be left to the last of them.
+ */
+static bool ipa_wwan_xmit_more(struct net_device *dev)
+{
+	struct wwan_private *wwan_ptr = netdev_priv(dev);
+	struct Qdisc *q = rcu_dereference_bh(netdev_get_tx_queue(dev, 0)->qdisc);
+
+	return q && qdisc_qlen(q) &&
+		atomic_read(&wwan_ptr->outstanding_pkts) + 1 <
+					wwan_ptr->outstanding_high;
+}
+
 /**
  * ipa_wwan_xmit() - Transmits an skb.
  *
@@ -964,6 +992,7 @@ static int ipa_wwan_xmit(struct sk_buff *skb, struct net_device *dev)
 {
 	int ret = 0;
 	struct wwan_private *wwan_ptr = netdev_priv(dev);
+	struct ipa_tx_meta meta;
 
 	if (netif_queue_stopped(dev)) {
 		IPAWANERR("[%s]fatal: ipa_wwan_xmit stopped\n", dev->name);
@@ -986,6 +1015,7 @@ static int ipa_wwan_xmit(struct sk_buff *skb, struct net_device *dev)
 		IPAWANDBG
 		("SW filtering out none QMAP packet received from %s",
 		current->comm);
+		ipa_tx_dp_flush(IPA_CLIENT_APPS_LAN_WAN_PROD);
 		ret = NETDEV_TX_OK;
 		goto out;
 	}
@@ -999,7 +1029,9 @@ static int ipa_wwan_xmit(struct sk_buff *skb, struct net_device *dev)
 		ret = NETDEV_TX_BUSY;
 		goto out;
 	}
-	ret = ipa_tx_dp(IPA_CLIENT_APPS_LAN_WAN_PROD, skb, NULL);
+	memset(&meta, 0, sizeof(meta));
+	meta.xmit_more = ipa_wwan_xmit_more(dev);
+	ret = ipa_tx_dp(IPA_CLIENT_APPS_LAN_WAN_PROD, skb, &meta);
 	if (ret) {
 		ret = NETDEV_TX_BUSY;
 		dev->stats.tx_dropped++;
@@ -1009,9 +1041,20 @@ static int ipa_wwan_xmit(struct sk_buff *skb, struct net_device *dev)
 	atomic_inc(&wwan_ptr->outstanding_pkts);
 	dev->stats.tx_packets++;
 	dev->stats.tx_bytes += skb->len;
+	/*
+	 * The TX complete for this skb takes the tx lock held here, so it
+	 * cannot be accounted before it is queued.
+	 */
+	netdev_tx_sent_queue(netdev_get_tx_queue(dev, 0), skb->len);
+	/* BQL stopped the queue: no later xmit will ring the doorbell */
+	if (meta.xmit_more && netif_xmit_stopped(netdev_get_tx_queue(dev, 0)))
+		ipa_tx_dp_flush(IPA_CLIENT_APPS_LAN_WAN_PROD);
 	ret = NETDEV_TX_OK;
 
 out:
+	/* the requeued packet must not hold back the ones before it */
+	if (ret == NETDEV_TX_BUSY)
+		ipa_tx_dp_flush(IPA_CLIENT_APPS_LAN_WAN_PROD);
 	ipa_rm_inactivity_timer_release_resource(
 		IPA_RM_RESOURCE_WWAN_0_PROD);
 	return ret;
@@ -1045,6 +1088,7 @@ static void apps_ipa_tx_complete_notify(void *priv,
 	}
 	atomic_dec(&wwan_ptr->outstanding_pkts);
 	__netif_tx_lock_bh(netdev_get_tx_queue(dev, 0));
+	netdev_tx_completed_queue(netdev_get_tx_queue(dev, 0), 1, skb->len);
 	if (netif_queue_stopped(wwan_ptr->net) &&
 		atomic_read(&wwan_ptr->outstanding_pkts) <
 					(wwan_ptr->outstanding_low)) {
@@ -1068,6 +1112,51 @@ static void apps_ipa_tx_complete_notify(void *priv,
  *
  * IPA will pass a packet to the Linux network stack with skb->data
  */
+static void ipa_wwan_napi_schedule(void *info)
+{
+	napi_schedule(info);
+}
+
+/*
+ * NAPI polls in the NET_RX softirq of the CPU that scheduled it, so
+ * schedule it from rx_cpu when one is set.
+ */
+static void ipa_wwan_start_poll(struct wwan_private *wwan_ptr)
+{
+	int cpu = ACCESS_ONCE(rx_cpu);
+
+	if (cpu >= 0 && cpu < nr_cpu_ids && cpu != get_cpu() &&
+	    !smp_call_function_single(cpu, ipa_wwan_napi_schedule,
+				      &wwan_ptr->napi, 0)) {
+		put_cpu();
+		return;
+	}
+	put_cpu();
+
+	local_bh_disable();
+	napi_schedule(&wwan_ptr->napi);
+	local_bh_enable();
+}
+
+/**
+ * ipa_wwan_poll() - NAPI poll of the IPA->APPS pipe
+ *
+ * @napi: NAPI context of the wwan device
+ * @budget: packets that may be handled
+ *
+ * Return: number of packets handled
+ */
+static int ipa_wwan_poll(struct napi_struct *napi, int budget)
+{
+	int rcvd = ipa_rx_poll(ipa_to_apps_hdl, budget);
+
+	if (rcvd < budget) {
+		napi_complete(napi);
+		ipa_rx_poll_complete(ipa_to_apps_hdl);
+	}
+	return rcvd;
+}
+
 static void apps_ipa_packet_receive_notify(void *priv,
 		enum ipa_dp_evt_type evt,
 		unsigned long data)
@@ -1075,7 +1164,12 @@ static void apps_ipa_packet_receive_notify(void *priv,
 	struct sk_buff *skb = (struct sk_buff *)data;
 	struct net_device *dev = (struct net_device *)priv;
 	int result;
-	unsigned int packet_len = skb->len;
+	unsigned int packet_len;
+
+	if (evt == IPA_CLIENT_START_POLL) {
+		ipa_wwan_start_poll(netdev_priv(dev));
+		return;
+	}
 
 	IPAWANDBG("Rx packet was received");
 	if (evt != IPA_RECEIVE) {
@@ -1083,12 +1177,17 @@ static void apps_ipa_packet_receive_notify(void *priv,
 		return;
 	}
 
+	packet_len = skb->len;
 	skb->dev = ipa_netdevs[0];
 	skb->protocol = htons(ETH_P_MAP);
 
-	result = netif_rx_ni(skb);
+	/* with NAPI this runs from ipa_wwan_poll() */
+	if (ipa_rmnet_res.ipa_napi_enable)
+		result = netif_receive_skb(skb);
+	else
+		result = netif_rx_ni(skb);
 	if (result)	{
-		pr_err_ratelimited(DEV_NAME " %s:%d fail on netif_rx_ni\n",
+		pr_err_ratelimited(DEV_NAME " %s:%d fail on netif_rx\n",
 				__func__, __LINE__);
 		dev->stats.rx_dropped++;
 	}
@@ -1410,6 +1509,8 @@ static int ipa_wwan_ioctl(struct net_device *dev, struct ifreq *ifr, int cmd)
 				apps_ipa_packet_receive_notify;
 			ipa_to_apps_ep_cfg.desc_fifo_sz = IPA_SYS_DESC_FIFO_SZ;
 			ipa_to_apps_ep_cfg.priv = dev;
+			ipa_to_apps_ep_cfg.napi_enabled =
+				ipa_rmnet_res.ipa_napi_enable;
 
 			rc = ipa_setup_sys_pipe(
 				&ipa_to_apps_ep_cfg, &ipa_to_apps_hdl);
@@ -1701,8 +1802,6 @@ static struct notifier_block ssr_notifier = {
 	.notifier_call = ssr_notifier_cb,
 };
 
-static struct ipa_rmnet_plat_drv_res ipa_rmnet_res = {0, };
-
 static int get_ipa_rmnet_dts_configuration(struct platform_device *pdev,
 		struct ipa_rmnet_plat_drv_res *ipa_rmnet_drv_res)
 {
@@ -1716,6 +1815,11 @@ static int get_ipa_rmnet_dts_configuration(struct platform_device *pdev,
 			"qcom,ipa-loaduC");
 	pr_info("IPA ipa-loaduC = %s\n",
 		ipa_rmnet_drv_res->ipa_loaduC ? "True" : "False");
+	ipa_rmnet_drv_res->ipa_napi_enable =
+			of_property_read_bool(pdev->dev.of_node,
+			"qcom,ipa-napi-enable");
+	pr_info("IPA napi-enable = %s\n",
+		ipa_rmnet_drv_res->ipa_napi_enable ? "True" : "False");
 
 	return 0;
 }
@@ -1815,6 +1919,11 @@ static int ipa_wwan_probe(struct platform_device *pdev)
 	atomic_set(&wwan_ptr->outstanding_pkts, 0);
 	spin_lock_init(&wwan_ptr->lock);
 	init_completion(&wwan_ptr->resource_granted_completion);
+	if (ipa_rmnet_res.ipa_napi_enable) {
+		netif_napi_add(dev, &wwan_ptr->napi, ipa_wwan_poll,
+			       napi_weight);
+		napi_enable(&wwan_ptr->napi);
+	}
 
 	if (!atomic_read(&is_ssr)) {
 		/* IPA_RM configuration starts */
@@ -1927,6 +2036,11 @@ static int ipa_wwan_remove(struct platform_device *pdev)
 	int ret;
 
 	pr_info("rmnet_ipa started deinitialization\n");
+	if (ipa_rmnet_res.ipa_napi_enable) {
+		struct wwan_private *wwan_ptr = netdev_priv(ipa_netdevs[0]);
+
+		napi_disable(&wwan_ptr->napi);
+	}
 	ret = ipa_teardown_sys_pipe(ipa_to_apps_hdl);
 	if (ret < 0)
 		IPAWANERR("Failed to teardown IPA->APPS pipe\n");
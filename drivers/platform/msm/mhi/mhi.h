@@ -366,6 +366,14 @@ struct mhi_chan_counters {
 	u32 ev_processed;
 };
 
+/* Per event ring processing statistics, exported through debugfs */
+struct mhi_ev_ring_stats {
+	u64 events;
+	u32 passes;
+	u32 budget_exhausted;
+	u32 max_batch;
+};
+
 struct mhi_counters {
 	u32 m0_m1;
 	u32 m1_m0;
@@ -450,6 +458,8 @@ struct mhi_device_ctxt {
 	u32 alloced_ev_rings[EVENT_RINGS_ALLOCATED];
 	u32 ev_ring_props[EVENT_RINGS_ALLOCATED];
 	u32 msi_counter[EVENT_RINGS_ALLOCATED];
+	unsigned long ev_ring_pending;
+	struct mhi_ev_ring_stats ev_ring_stats[EVENT_RINGS_ALLOCATED];
 	u32 db_mode[MHI_MAX_CHANNELS];
 	u32 uldl_enabled;
 	u32 hw_intmod_rate;
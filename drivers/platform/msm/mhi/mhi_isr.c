@@ -10,6 +10,7 @@
  * GNU General Public License for more details.
  */
 #include <linux/interrupt.h>
+#include <linux/prefetch.h>
 
 #include "mhi_sys.h"
 #include "mhi_trace.h"
@@ -36,6 +37,8 @@ irqreturn_t mhi_msi_handlr(int irq_number, void *dev_id)
 	case 0:
 	case 1:
 	case 2:
+		set_bit(IRQ_TO_MSI(mhi_dev_ctxt, irq_number),
+			&mhi_dev_ctxt->ev_ring_pending);
 		atomic_inc(&mhi_dev_ctxt->flags.events_pending);
 		wake_up_interruptible(mhi_dev_ctxt->event_handle);
 		break;
@@ -62,11 +65,13 @@ irqreturn_t mhi_msi_handlr(int irq_number, void *dev_id)
 	return IRQ_HANDLED;
 }
 
-static enum MHI_STATUS mhi_process_event_ring(
+/* Returns the number of event ring elements processed */
+static u32 mhi_process_event_ring(
 		struct mhi_device_ctxt *mhi_dev_ctxt,
 		u32 ev_index,
 		u32 event_quota)
 {
+	u32 nr_processed = 0;
 	union mhi_event_pkt *local_rp = NULL;
 	union mhi_event_pkt *device_rp = NULL;
 	union mhi_event_pkt event_to_process;
@@ -98,6 +103,8 @@ static enum MHI_STATUS mhi_process_event_ring(
 						MHI_RING_TYPE_EVENT_RING,
 						ev_index)))
 			mhi_log(MHI_MSG_ERROR, "Failed to recycle ev pkt\n");
+		/* Pull in the next element while this one is parsed */
+		prefetch(local_ev_ctxt->rp);
 		switch (MHI_TRB_READ_INFO(EV_TRB_TYPE, (&event_to_process))) {
 		case MHI_PKT_TYPE_CMD_COMPLETION_EVENT:
 			mhi_log(MHI_MSG_INFO,
@@ -157,8 +164,20 @@ static enum MHI_STATUS mhi_process_event_ring(
 					mhi_dev_ctxt->mhi_ctrl_seg_info,
 					(u64)ev_ctxt->mhi_event_read_ptr);
 		--event_quota;
+		++nr_processed;
 	}
-	return MHI_STATUS_SUCCESS;
+	return nr_processed;
+}
+
+static void mhi_ev_ring_account(struct mhi_device_ctxt *mhi_dev_ctxt,
+				u32 ring, u32 nr_processed)
+{
+	struct mhi_ev_ring_stats *stats = &mhi_dev_ctxt->ev_ring_stats[ring];
+
+	stats->events += nr_processed;
+	stats->passes++;
+	if (nr_processed > stats->max_batch)
+		stats->max_batch = nr_processed;
 }
 
 int parse_event_thread(void *ctxt)
@@ -166,6 +185,8 @@ int parse_event_thread(void *ctxt)
 	struct mhi_device_ctxt *mhi_dev_ctxt = ctxt;
 	u32 i = 0;
 	u32 ev_poll_en = 0;
+	u32 budget, nr_processed;
+	unsigned long pending;
 	int ret_val = 0;
 
 	/* Go through all event rings */
@@ -198,30 +219,62 @@ int parse_event_thread(void *ctxt)
 		mhi_dev_ctxt->ev_thread_stopped = 0;
 		atomic_dec(&mhi_dev_ctxt->flags.events_pending);
 
+		/*
+		 * Only look at the rings whose MSI fired. A wakeup without
+		 * one, e.g. after a resume, goes through all of them.
+		 */
+		pending = xchg(&mhi_dev_ctxt->ev_ring_pending, 0);
+		if (!pending)
+			pending = (1UL << EVENT_RINGS_ALLOCATED) - 1;
+		budget = clamp_t(u32, mhi_ev_budget, 1, EV_EL_PER_RING);
+
 		for (i = 0; i < EVENT_RINGS_ALLOCATED; ++i) {
+			if (!(pending & (1UL << i)))
+				continue;
 			MHI_GET_EVENT_RING_INFO(EVENT_RING_POLLING,
 					mhi_dev_ctxt->ev_ring_props[i],
 					ev_poll_en)
-			if (ev_poll_en) {
-				mhi_process_event_ring(mhi_dev_ctxt,
-				 mhi_dev_ctxt->alloced_ev_rings[i],
-				 EV_EL_PER_RING);
+			if (!ev_poll_en)
+				continue;
+			nr_processed = mhi_process_event_ring(mhi_dev_ctxt,
+					mhi_dev_ctxt->alloced_ev_rings[i],
+					budget);
+			mhi_ev_ring_account(mhi_dev_ctxt, i, nr_processed);
+
+			/*
+			 * Out of budget: come back to this ring after the
+			 * others had their turn instead of waiting for the
+			 * next MSI.
+			 */
+			if (nr_processed == budget) {
+				mhi_dev_ctxt->ev_ring_stats[i].budget_exhausted++;
+				set_bit(i, &mhi_dev_ctxt->ev_ring_pending);
+				atomic_inc(&mhi_dev_ctxt->flags.events_pending);
 			}
 		}
+		cond_resched();
 	}
 	return 0;
 }
 
 struct mhi_result *mhi_poll(struct mhi_client_handle *client_handle)
 {
-	enum MHI_STATUS ret_val;
+	struct mhi_device_ctxt *mhi_dev_ctxt = client_handle->mhi_dev_ctxt;
+	u32 nr_processed;
+	u32 i;
+
 	client_handle->result.payload_buf = 0;
 	client_handle->result.bytes_xferd = 0;
-	ret_val = mhi_process_event_ring(client_handle->mhi_dev_ctxt,
+	nr_processed = mhi_process_event_ring(mhi_dev_ctxt,
 				client_handle->event_ring_index,
 				1);
-	if (MHI_STATUS_SUCCESS != ret_val)
-		mhi_log(MHI_MSG_INFO, "NAPI failed to process event ring\n");
+	for (i = 0; i < EVENT_RINGS_ALLOCATED; ++i) {
+		if (mhi_dev_ctxt->alloced_ev_rings[i] ==
+		    client_handle->event_ring_index) {
+			mhi_ev_ring_account(mhi_dev_ctxt, i, nr_processed);
+			break;
+		}
+	}
 	return &(client_handle->result);
 }
 
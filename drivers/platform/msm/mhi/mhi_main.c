@@ -21,6 +21,7 @@
 #include <linux/slab.h>
 #include <linux/interrupt.h>
 #include <linux/completion.h>
+#include <linux/prefetch.h>
 
 #include "mhi_sys.h"
 #include "mhi.h"
@@ -926,6 +927,16 @@ enum MHI_STATUS parse_xfer_event(struct mhi_device_ctxt *ctxt,
 		}
 		do {
 			u64 phy_buf_loc;
+			union mhi_xfer_pkt *next_trb_loc = local_trb_loc + 1;
+
+			/* Start fetching the next TRE of this batch */
+			if ((void *)next_trb_loc >=
+			    (void *)((char *)local_chan_ctxt->base +
+				     local_chan_ctxt->len))
+				next_trb_loc = local_chan_ctxt->base;
+			if (i + 1 < nr_trb_to_parse)
+				prefetch(next_trb_loc);
+
 			MHI_TRB_GET_INFO(TX_TRB_IEOT, local_trb_loc, ieot_flag);
 			phy_buf_loc = local_trb_loc->data_tx_pkt.buffer_ptr;
 			trb_data_loc = (dma_addr_t)phy_buf_loc;
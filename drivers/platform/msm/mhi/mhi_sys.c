@@ -42,6 +42,9 @@ MODULE_PARM_DESC(mhi_msg_class, "dbg class");
 u32 m3_timer_val_ms = 1000;
 module_param(m3_timer_val_ms, uint, S_IRUGO | S_IWUSR);
 MODULE_PARM_DESC(m3_timer_val_ms, "timer val");
+u32 mhi_ev_budget = 64;
+module_param(mhi_ev_budget, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(mhi_ev_budget, "event ring elements per processing pass");
 
 static ssize_t mhi_dbgfs_chan_read(struct file *fp, char __user *buf,
 				size_t count, loff_t *offp)
@@ -238,6 +241,38 @@ static const struct file_operations mhi_dbgfs_state_fops = {
 	.write = NULL,
 };
 
+static ssize_t mhi_dbgfs_ev_ring_read(struct file *fp, char __user *buf,
+				size_t count, loff_t *offp)
+{
+	struct mhi_device_ctxt *mhi_dev_ctxt =
+		&mhi_devices.device_list[0].mhi_ctxt;
+	struct mhi_ev_ring_stats *stats;
+	int amnt_copied = 0;
+	u32 i;
+
+	if (NULL == mhi_dev_ctxt->chan_info)
+		return -EIO;
+	for (i = 0; i < EVENT_RINGS_ALLOCATED; ++i) {
+		stats = &mhi_dev_ctxt->ev_ring_stats[i];
+		amnt_copied += scnprintf(mhi_dev_ctxt->chan_info + amnt_copied,
+			MHI_LOG_SIZE - amnt_copied,
+			"%s 0x%x %s %d %s %llu %s %u %s %u %s %u\n",
+			"Event ring", mhi_dev_ctxt->alloced_ev_rings[i],
+			"MSI:", mhi_dev_ctxt->msi_counter[i],
+			"events:", stats->events,
+			"passes:", stats->passes,
+			"budget_exhausted:", stats->budget_exhausted,
+			"max_batch:", stats->max_batch);
+	}
+	return simple_read_from_buffer(buf, count, offp,
+				mhi_dev_ctxt->chan_info, amnt_copied);
+}
+
+static const struct file_operations mhi_dbgfs_ev_ring_fops = {
+	.read = mhi_dbgfs_ev_ring_read,
+	.write = NULL,
+};
+
 uintptr_t mhi_p2v_addr(struct mhi_meminfo *meminfo, phys_addr_t pa)
 {
 	return meminfo->va_aligned + (pa - meminfo->pa_aligned);
@@ -296,6 +331,7 @@ int mhi_init_debugfs(struct mhi_device_ctxt *mhi_dev_ctxt)
 	struct dentry *mhi_chan_stats;
 	struct dentry *mhi_state_stats;
 	struct dentry *mhi_ev_stats;
+	struct dentry *mhi_ev_ring_stats;
 	mhi_dev_ctxt->mhi_parent_folder =
 					debugfs_create_dir("mhi", NULL);
 	if (mhi_dev_ctxt->mhi_parent_folder == NULL) {
@@ -323,12 +359,21 @@ int mhi_init_debugfs(struct mhi_device_ctxt *mhi_dev_ctxt)
 					&mhi_dbgfs_state_fops);
 	if (mhi_state_stats == NULL)
 		goto clean_ev_stats;
+	mhi_ev_ring_stats = debugfs_create_file("mhi_ev_ring_stats",
+					0444,
+					mhi_dev_ctxt->mhi_parent_folder,
+					mhi_dev_ctxt,
+					&mhi_dbgfs_ev_ring_fops);
+	if (mhi_ev_ring_stats == NULL)
+		goto clean_state_stats;
 
 	mhi_dev_ctxt->chan_info = kmalloc(MHI_LOG_SIZE, GFP_KERNEL);
 	if (mhi_dev_ctxt->chan_info == NULL)
 		goto clean_all;
 	return 0;
 clean_all:
+	debugfs_remove(mhi_ev_ring_stats);
+clean_state_stats:
 	debugfs_remove(mhi_state_stats);
 clean_ev_stats:
 	debugfs_remove(mhi_ev_stats);
@@ -24,6 +24,7 @@ extern enum MHI_DEBUG_LEVEL mhi_msg_lvl;
 extern enum MHI_DEBUG_LEVEL mhi_ipc_log_lvl;
 extern enum MHI_DEBUG_CLASS mhi_msg_class;
 extern u32 m3_timer_val_ms;
+extern u32 mhi_ev_budget;
 
 extern enum MHI_DEBUG_LEVEL mhi_xfer_db_interval;
 extern enum MHI_DEBUG_LEVEL tx_mhi_intmodt;
@@ -119,6 +119,8 @@ struct msm_bus_node_device_type {
 	unsigned int ap_owned;
 	struct nodeclk clk[NUM_CTX];
 	struct nodeclk qos_clk;
+	struct list_head fab_link;
+	struct list_head fab_children;
 };
 
 int msm_bus_enable_limiter(struct msm_bus_node_device_type *nodedev,
@@ -132,6 +134,7 @@ int msm_bus_commit_data(int *dirty_nodes, int ctx, int num_dirty);
 #endif
 int msm_bus_update_bw(struct msm_bus_node_device_type *nodedev, int ctx,
 	int64_t add_bw, int **dirty_nodes, int *num_dirty);
+struct device *msm_bus_find_node_device(unsigned int id);
 void *msm_bus_realloc_devmem(struct device *dev, void *p, size_t old_size,
 					size_t new_size, gfp_t flags);
 
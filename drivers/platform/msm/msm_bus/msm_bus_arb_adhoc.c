@@ -35,6 +35,22 @@ struct handle_type {
 	struct msm_bus_client **cl_list;
 };
 
+/*
+ * Routes found by getpath(). The topology is fixed once the fabrics have
+ * probed, so clients voting on an already known src/dest pair skip the
+ * breadth first search. hops[0] is the destination, the last hop is the
+ * source.
+ */
+struct path_cache_entry {
+	struct list_head link;
+	int src;
+	int dest;
+	int num_hops;
+	struct device *hops[];
+};
+
+static LIST_HEAD(path_cache);
+
 static struct handle_type handle_list;
 struct list_head input_list;
 struct list_head apply_list;
@@ -171,9 +187,7 @@ static int gen_lnode(struct device *dev,
 		lnode->next_dev = NULL;
 	} else {
 		lnode->next = prev_idx;
-		lnode->next_dev = bus_find_device(&msm_bus_type, NULL,
-					(void *) &next_hop,
-					msm_bus_device_match_adhoc);
+		lnode->next_dev = msm_bus_find_node_device(next_hop);
 	}
 
 	memset(lnode->lnode_ib, 0, sizeof(uint64_t) * NUM_CTX);
@@ -220,9 +234,9 @@ static int prune_path(struct list_head *route_list, int dest, int src,
 	struct list_head *bl_list;
 	struct list_head *temp_bl_list;
 	int search_dev_id = dest;
-	struct device *dest_dev = bus_find_device(&msm_bus_type, NULL,
-					(void *) &dest,
-					msm_bus_device_match_adhoc);
+	struct device *dest_dev = msm_bus_find_node_device(dest);
+	struct path_cache_entry *path = NULL;
+	int max_hops = 1;
 	int lnode_hop = -1;
 
 	if (!found)
@@ -233,6 +247,18 @@ static int prune_path(struct list_head *route_list, int dest, int src,
 		goto exit_prune_path;
 	}
 
+	list_for_each_entry(search_node, route_list, link)
+		list_for_each_entry(bus_node, &search_node->node_list, link)
+			max_hops++;
+
+	path = kzalloc(sizeof(*path) + max_hops * sizeof(path->hops[0]),
+								GFP_KERNEL);
+	if (path) {
+		path->src = src;
+		path->dest = dest;
+		path->hops[path->num_hops++] = dest_dev;
+	}
+
 	lnode_hop = gen_lnode(dest_dev, search_dev_id, lnode_hop);
 
 	list_for_each_entry_reverse(search_node, route_list, link) {
@@ -242,19 +268,18 @@ static int prune_path(struct list_head *route_list, int dest, int src,
 									i++) {
 				if (bus_node->node_info->connections[i] ==
 								search_dev_id) {
-					dest_dev = bus_find_device(
-						&msm_bus_type,
-						NULL,
-						(void *)
-						&bus_node->node_info->
-						id,
-						msm_bus_device_match_adhoc);
+					dest_dev = msm_bus_find_node_device(
+						bus_node->node_info->id);
 
 					if (!dest_dev) {
 						lnode_hop = -1;
 						goto reset_links;
 					}
 
+					if (path)
+						path->hops[path->num_hops++] =
+								dest_dev;
+
 					lnode_hop = gen_lnode(dest_dev,
 							search_dev_id,
 							lnode_hop);
@@ -279,10 +304,38 @@ reset_links:
 	list_for_each_safe(bl_list, temp_bl_list, black_list)
 		list_del(bl_list);
 
+	if (path && lnode_hop >= 0) {
+		list_add(&path->link, &path_cache);
+		path = NULL;
+	}
+	kfree(path);
+
 exit_prune_path:
 	return lnode_hop;
 }
 
+/* Set up the link nodes of a path already known from an earlier search */
+static int replay_path(struct path_cache_entry *path)
+{
+	struct msm_bus_node_device_type *prev;
+	int lnode_hop = -1;
+	int next_id = path->dest;
+	int i;
+
+	for (i = 0; i < path->num_hops; i++) {
+		if (i) {
+			prev = path->hops[i - 1]->platform_data;
+			next_id = prev->node_info->id;
+		}
+
+		lnode_hop = gen_lnode(path->hops[i], next_id, lnode_hop);
+		if (lnode_hop < 0)
+			break;
+	}
+
+	return lnode_hop;
+}
+
 static void setup_bl_list(struct msm_bus_node_device_type *node,
 				struct list_head *black_list)
 {
@@ -301,15 +354,19 @@ static int getpath(int src, int dest)
 	struct list_head edge_list;
 	struct list_head route_list;
 	struct list_head black_list;
-	struct device *src_dev = bus_find_device(&msm_bus_type, NULL,
-					(void *) &src,
-					msm_bus_device_match_adhoc);
+	struct device *src_dev = msm_bus_find_node_device(src);
 	struct msm_bus_node_device_type *src_node;
 	struct bus_search_type *search_node;
+	struct path_cache_entry *path;
 	int found = 0;
 	int depth_index = 0;
 	int first_hop = -1;
 
+	list_for_each_entry(path, &path_cache, link) {
+		if (path->src == src && path->dest == dest)
+			return replay_path(path);
+	}
+
 	INIT_LIST_HEAD(&traverse_list);
 	INIT_LIST_HEAD(&edge_list);
 	INIT_LIST_HEAD(&route_list);
@@ -481,9 +538,7 @@ static int msm_bus_apply_rules(struct list_head *list, bool after_clk_commit)
 		if (rule && (rule->after_clk_commit != after_clk_commit))
 			continue;
 
-		dev = bus_find_device(&msm_bus_type, NULL,
-				(void *) &rule->id,
-				msm_bus_device_match_adhoc);
+		dev = msm_bus_find_node_device(rule->id);
 
 		if (!dev) {
 			MSM_BUS_ERR("Can't find dev node for %d", rule->id);
@@ -555,9 +610,7 @@ static int update_path(int src, int dest, uint64_t req_ib, uint64_t req_bw,
 	struct rule_update_path_info *rule_node;
 	bool rules_registered = msm_rule_are_rules_registered();
 
-	src_dev = bus_find_device(&msm_bus_type, NULL,
-				(void *) &src,
-				msm_bus_device_match_adhoc);
+	src_dev = msm_bus_find_node_device(src);
 
 	if (!src_dev) {
 		MSM_BUS_ERR("%s: Can't find source device %d", __func__, src);
@@ -679,9 +732,7 @@ static int remove_path(int src, int dst, uint64_t cur_ib, uint64_t cur_ab,
 		goto exit_remove_path;
 	}
 
-	src_dev = bus_find_device(&msm_bus_type, NULL,
-				(void *) &src,
-				msm_bus_device_match_adhoc);
+	src_dev = msm_bus_find_node_device(src);
 	if (!src_dev) {
 		MSM_BUS_ERR("%s: Can't find source device %d", __func__, src);
 		ret = -ENODEV;
@@ -712,9 +763,7 @@ static void getpath_debug(int src, int curr, int active_only)
 	struct msm_bus_node_device_type *devinfo;
 	int i;
 
-	dev_node = bus_find_device(&msm_bus_type, NULL,
-				(void *) &src,
-				msm_bus_device_match_adhoc);
+	dev_node = msm_bus_find_node_device(src);
 
 	if (!dev_node) {
 		MSM_BUS_ERR("SRC NOT FOUND %d", src);
@@ -936,8 +985,10 @@ static int update_request_adhoc(uint32_t cl, unsigned int index)
 	struct msm_bus_client *client;
 	const char *test_cl = "Null";
 	bool log_transaction = false;
+	ktime_t start;
 
 	rt_mutex_lock(&msm_bus_adhoc_lock);
+	start = ktime_get();
 
 	if (!cl) {
 		MSM_BUS_ERR("%s: Invalid client handle %d", __func__, cl);
@@ -1011,6 +1062,7 @@ static int update_request_adhoc(uint32_t cl, unsigned int index)
 		if (log_transaction)
 			getpath_debug(src, lnode, pdata->active_only);
 	}
+	msm_bus_dbg_rec_latency(MSM_BUS_DBG_LAT_UPDATE, start);
 	trace_bus_update_request_end(pdata->name);
 exit_update_request:
 	rt_mutex_unlock(&msm_bus_adhoc_lock);
@@ -1031,8 +1083,10 @@ static int update_bw_adhoc(struct msm_bus_client_handle *cl, u64 ab, u64 ib)
 	int ret = 0;
 	char *test_cl = "test-client";
 	bool log_transaction = false;
+	ktime_t start;
 
 	rt_mutex_lock(&msm_bus_adhoc_lock);
+	start = ktime_get();
 
 	if (!cl) {
 		MSM_BUS_ERR("%s: Invalid client handle %p", __func__, cl);
@@ -1064,6 +1118,7 @@ static int update_bw_adhoc(struct msm_bus_client_handle *cl, u64 ab, u64 ib)
 
 	if (log_transaction)
 		getpath_debug(cl->mas, cl->first_hop, cl->active_only);
+	msm_bus_dbg_rec_latency(MSM_BUS_DBG_LAT_UPDATE, start);
 	trace_bus_update_request_end(cl->name);
 exit_update_request:
 	rt_mutex_unlock(&msm_bus_adhoc_lock);
@@ -15,6 +15,7 @@
 
 #include <linux/types.h>
 #include <linux/device.h>
+#include <linux/ktime.h>
 #include <linux/radix-tree.h>
 #include <linux/platform_device.h>
 #include <linux/msm-bus-board.h>
@@ -48,6 +49,12 @@ enum msm_bus_dbg_op_type {
 	MSM_BUS_DBG_OP = 1,
 };
 
+enum msm_bus_dbg_lat_type {
+	MSM_BUS_DBG_LAT_UPDATE,
+	MSM_BUS_DBG_LAT_RPM,
+	MSM_BUS_DBG_LAT_MAX,
+};
+
 enum msm_bus_hw_sel {
 	MSM_BUS_RPM = 0,
 	MSM_BUS_NOC,
@@ -284,7 +291,21 @@ int msm_bus_hw_fab_init(struct msm_bus_fabric_registration *pdata,
 void msm_bus_board_init(struct msm_bus_fabric_registration *pdata);
 void msm_bus_board_set_nfab(struct msm_bus_fabric_registration *pdata,
 	int nfab);
+#define MSM_BUS_RPM_BATCH_MAX	32
+
+struct msm_rpm_request;
+
+/* RPM votes sent during one commit whose acks are still outstanding */
+struct msm_bus_rpm_batch {
+	int num;
+	struct msm_rpm_request *req[MSM_BUS_RPM_BATCH_MAX];
+	int msg_id[MSM_BUS_RPM_BATCH_MAX];
+};
+
 #if defined(CONFIG_MSM_RPM_SMD)
+int msm_bus_rpm_batch_add(struct msm_bus_rpm_batch *batch, int ctx,
+	uint32_t rsc_type, uint32_t id, uint32_t key, uint64_t *bw);
+int msm_bus_rpm_batch_commit(struct msm_bus_rpm_batch *batch);
 int msm_bus_rpm_hw_init(struct msm_bus_fabric_registration *pdata,
 	struct msm_bus_hw_algorithm *hw_algo);
 int msm_bus_remote_hw_commit(struct msm_bus_fabric_registration
@@ -307,6 +328,15 @@ static inline void msm_bus_rpm_fill_cdata_buffer(int *curr, char *buf,
 	int ntslaves)
 {
 }
+static inline int msm_bus_rpm_batch_add(struct msm_bus_rpm_batch *batch,
+	int ctx, uint32_t rsc_type, uint32_t id, uint32_t key, uint64_t *bw)
+{
+	return 0;
+}
+static inline int msm_bus_rpm_batch_commit(struct msm_bus_rpm_batch *batch)
+{
+	return 0;
+}
 #endif
 
 int msm_bus_noc_hw_init(struct msm_bus_fabric_registration *pdata,
@@ -322,6 +352,7 @@ int msm_bus_dbg_add_client(const struct msm_bus_client_handle *pdata);
 int msm_bus_dbg_rec_transaction(const struct msm_bus_client_handle *pdata,
 						u64 ab, u64 ib);
 void msm_bus_dbg_remove_client(const struct msm_bus_client_handle *pdata);
+void msm_bus_dbg_rec_latency(int type, ktime_t start);
 
 #else
 static inline void msm_bus_dbg_client_data(struct msm_bus_scale_pdata *pdata,
@@ -350,6 +381,10 @@ msm_bus_dbg_add_client(const struct msm_bus_client_handle *pdata)
 {
 	return 0;
 }
+
+static inline void msm_bus_dbg_rec_latency(int type, ktime_t start)
+{
+}
 #endif
 
 #ifdef CONFIG_CORESIGHT
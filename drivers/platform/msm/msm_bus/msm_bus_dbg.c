@@ -676,6 +676,84 @@ static const struct file_operations rules_dbg_fops = {
 	.read		= rules_dbg_read,
 };
 
+/*
+ * Latency histograms of the vote paths, in power of two microsecond
+ * buckets. The last bucket is open ended.
+ */
+#define MSM_BUS_DBG_LAT_BUCKETS	16
+
+static atomic_t lat_hist[MSM_BUS_DBG_LAT_MAX][MSM_BUS_DBG_LAT_BUCKETS];
+static const char * const lat_names[MSM_BUS_DBG_LAT_MAX] = {
+	[MSM_BUS_DBG_LAT_UPDATE]	= "update_request",
+	[MSM_BUS_DBG_LAT_RPM]		= "rpm_commit",
+};
+
+/**
+ * msm_bus_dbg_rec_latency() - Account one operation in a latency histogram
+ * @type: Histogram to update, one of enum msm_bus_dbg_lat_type
+ * @start: Time at which the operation started
+ */
+void msm_bus_dbg_rec_latency(int type, ktime_t start)
+{
+	s64 us = ktime_us_delta(ktime_get(), start);
+	int bucket = 0;
+
+	if (type < 0 || type >= MSM_BUS_DBG_LAT_MAX)
+		return;
+
+	if (us > 0)
+		bucket = min(fls64(us), MSM_BUS_DBG_LAT_BUCKETS - 1);
+	atomic_inc(&lat_hist[type][bucket]);
+}
+
+static int latency_show(struct seq_file *m, void *unused)
+{
+	int type, i;
+
+	for (type = 0; type < MSM_BUS_DBG_LAT_MAX; type++) {
+		seq_printf(m, "%s:\n", lat_names[type]);
+		for (i = 0; i < MSM_BUS_DBG_LAT_BUCKETS; i++) {
+			unsigned int cnt = atomic_read(&lat_hist[type][i]);
+
+			if (!cnt)
+				continue;
+			if (i == MSM_BUS_DBG_LAT_BUCKETS - 1)
+				seq_printf(m, "  >= %8uus: %u\n",
+						1U << (i - 1), cnt);
+			else
+				seq_printf(m, "  < %9uus: %u\n", 1U << i, cnt);
+		}
+	}
+
+	return 0;
+}
+
+static int latency_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, latency_show, NULL);
+}
+
+/* Any write clears the histograms */
+static ssize_t latency_write(struct file *file, const char __user *ubuf,
+	size_t count, loff_t *ppos)
+{
+	int type, i;
+
+	for (type = 0; type < MSM_BUS_DBG_LAT_MAX; type++)
+		for (i = 0; i < MSM_BUS_DBG_LAT_BUCKETS; i++)
+			atomic_set(&lat_hist[type][i], 0);
+
+	return count;
+}
+
+static const struct file_operations latency_fops = {
+	.open		= latency_open,
+	.read		= seq_read,
+	.write		= latency_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 static int msm_bus_dbg_record_fabric(const char *fabname, struct dentry *file)
 {
 	struct msm_bus_fab_list *fablist;
@@ -875,6 +953,9 @@ static int __init msm_bus_debugfs_init(void)
 	if (debugfs_create_file("update-request", S_IRUGO | S_IWUSR,
 		clients, NULL, &msm_bus_dbg_update_request_fops) == NULL)
 		goto err;
+	if (debugfs_create_file("latency", S_IRUGO | S_IWUSR, dir, NULL,
+		&latency_fops) == NULL)
+		goto err;
 
 	rules_buf = kzalloc(MAX_BUFF_SIZE, GFP_KERNEL);
 	if (!rules_buf) {
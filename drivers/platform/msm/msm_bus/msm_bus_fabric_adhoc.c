@@ -16,6 +16,8 @@
 #include <linux/io.h>
 #include <linux/kernel.h>
 #include <linux/module.h>
+#include <linux/radix-tree.h>
+#include <linux/rcupdate.h>
 #include <linux/slab.h>
 #include <soc/qcom/rpm-smd.h>
 #include <trace/events/trace_msm_bus.h>
@@ -103,70 +105,45 @@ static int setrate_nodeclk(struct nodeclk *nclk, long rate)
 	return ret;
 }
 
-static int msm_bus_agg_fab_clks(struct device *bus_dev, void *data)
-{
-	struct msm_bus_node_device_type *node = NULL;
-	int ret = 0;
-	int ctx = *(int *)data;
-
-	if (ctx >= NUM_CTX) {
-		MSM_BUS_ERR("%s: Invalid Context %d", __func__, ctx);
-		goto exit_agg_fab_clks;
-	}
-
-	node = bus_dev->platform_data;
-	if (!node) {
-		MSM_BUS_ERR("%s: Can't get device info", __func__);
-		goto exit_agg_fab_clks;
-	}
-
-	if (!node->node_info->is_fab_dev) {
-		struct msm_bus_node_device_type *bus_dev = NULL;
+/*
+ * Node id to device map, so that the commit path does not have to walk
+ * the whole msm_bus_type device list for every dirty node.
+ */
+static RADIX_TREE(msm_bus_node_tree, GFP_KERNEL);
 
-		bus_dev = node->node_info->bus_device->platform_data;
+struct device *msm_bus_find_node_device(unsigned int id)
+{
+	struct device *dev;
 
-		if (node->cur_clk_hz[ctx] >= bus_dev->cur_clk_hz[ctx])
-			bus_dev->cur_clk_hz[ctx] = node->cur_clk_hz[ctx];
-	}
+	rcu_read_lock();
+	dev = radix_tree_lookup(&msm_bus_node_tree, id);
+	rcu_read_unlock();
 
-exit_agg_fab_clks:
-	return ret;
+	return dev;
 }
 
-static int msm_bus_reset_fab_clks(struct device *bus_dev, void *data)
+/*
+ * Aggregate the clock of a fabric from the nodes hanging off it. Only done
+ * for the fabrics that are dirty in this commit.
+ */
+static void msm_bus_agg_fab_clks(struct msm_bus_node_device_type *fab,
+								int ctx)
 {
-	struct msm_bus_node_device_type *node = NULL;
-	int ret = 0;
-	int ctx = *(int *)data;
-
-	if (ctx >= NUM_CTX) {
-		MSM_BUS_ERR("%s: Invalid Context %d", __func__, ctx);
-		goto exit_reset_fab_clks;
-	}
-
-	node = bus_dev->platform_data;
-	if (!node) {
-		MSM_BUS_ERR("%s: Can't get device info", __func__);
-		goto exit_reset_fab_clks;
-	}
+	struct msm_bus_node_device_type *node;
 
-	if (node->node_info->is_fab_dev) {
-		node->cur_clk_hz[ctx] = 0;
-		MSM_BUS_DBG("Resetting for node %d", node->node_info->id);
-	}
-exit_reset_fab_clks:
-	return ret;
+	fab->cur_clk_hz[ctx] = 0;
+	list_for_each_entry(node, &fab->fab_children, fab_link)
+		fab->cur_clk_hz[ctx] = max(fab->cur_clk_hz[ctx],
+						node->cur_clk_hz[ctx]);
 }
 
-
-static int send_rpm_msg(struct device *device)
+static int send_rpm_msg(struct device *device, struct msm_bus_rpm_batch *batch)
 {
 	int ret = 0;
 	int ctx;
 	int rsc_type;
 	struct msm_bus_node_device_type *ndev =
 					device->platform_data;
-	struct msm_rpm_kvp rpm_kvp;
 
 	if (!ndev) {
 		MSM_BUS_ERR("%s: Error getting node info.", __func__);
@@ -174,23 +151,13 @@ static int send_rpm_msg(struct device *device)
 		goto exit_send_rpm_msg;
 	}
 
-	rpm_kvp.length = sizeof(uint64_t);
-	rpm_kvp.key = RPM_MASTER_FIELD_BW;
-
 	for (ctx = MSM_RPM_CTX_ACTIVE_SET; ctx <= MSM_RPM_CTX_SLEEP_SET;
 					ctx++) {
-		if (ctx == MSM_RPM_CTX_ACTIVE_SET)
-			rpm_kvp.data =
-			(uint8_t *)&ndev->node_ab.ab[MSM_RPM_CTX_ACTIVE_SET];
-		else {
-			rpm_kvp.data =
-			(uint8_t *) &ndev->node_ab.ab[MSM_RPM_CTX_SLEEP_SET];
-		}
-
 		if (ndev->node_info->mas_rpm_id != -1) {
 			rsc_type = RPM_BUS_MASTER_REQ;
-			ret = msm_rpm_send_message(ctx, rsc_type,
-				ndev->node_info->mas_rpm_id, &rpm_kvp, 1);
+			ret = msm_bus_rpm_batch_add(batch, ctx, rsc_type,
+				ndev->node_info->mas_rpm_id,
+				RPM_MASTER_FIELD_BW, &ndev->node_ab.ab[ctx]);
 			if (ret) {
 				MSM_BUS_ERR("%s: Failed to send RPM message:",
 						__func__);
@@ -206,8 +173,9 @@ static int send_rpm_msg(struct device *device)
 
 		if (ndev->node_info->slv_rpm_id != -1) {
 			rsc_type = RPM_BUS_SLAVE_REQ;
-			ret = msm_rpm_send_message(ctx, rsc_type,
-				ndev->node_info->slv_rpm_id, &rpm_kvp, 1);
+			ret = msm_bus_rpm_batch_add(batch, ctx, rsc_type,
+				ndev->node_info->slv_rpm_id,
+				RPM_MASTER_FIELD_BW, &ndev->node_ab.ab[ctx]);
 			if (ret) {
 				MSM_BUS_ERR("%s: Failed to send RPM message:",
 							__func__);
@@ -225,7 +193,8 @@ exit_send_rpm_msg:
 	return ret;
 }
 
-static int flush_bw_data(struct device *node_device, int ctx)
+static int flush_bw_data(struct device *node_device, int ctx,
+					struct msm_bus_rpm_batch *batch)
 {
 	struct msm_bus_node_device_type *node_info;
 	int ret = 0;
@@ -254,7 +223,7 @@ static int flush_bw_data(struct device *node_device, int ctx)
 							fabdev->qos_off,
 							fabdev->qos_freq);
 		} else {
-			ret = send_rpm_msg(node_device);
+			ret = send_rpm_msg(node_device, batch);
 
 			if (ret)
 				MSM_BUS_ERR("%s: Failed to send RPM msg for%d",
@@ -388,28 +357,54 @@ int msm_bus_commit_data(int *dirty_nodes, int ctx, int num_dirty)
 {
 	int ret = 0;
 	int i = 0;
+	struct msm_bus_rpm_batch batch;
+	struct device **node_devs;
 
-	/* Aggregate the bus clocks */
-	bus_for_each_dev(&msm_bus_type, NULL, (void *)&ctx,
-				msm_bus_agg_fab_clks);
+	node_devs = kcalloc(num_dirty, sizeof(*node_devs), GFP_KERNEL);
+	if (num_dirty && !node_devs) {
+		kfree(dirty_nodes);
+		return -ENOMEM;
+	}
 
+	/* Aggregate the bus clocks of the dirty fabrics */
 	for (i = 0; i < num_dirty; i++) {
-		struct device *node_device =
-					bus_find_device(&msm_bus_type, NULL,
-						(void *)&dirty_nodes[i],
-						msm_bus_device_match_adhoc);
+		struct msm_bus_node_device_type *node;
+
+		node_devs[i] = msm_bus_find_node_device(dirty_nodes[i]);
+		if (!node_devs[i])
+			continue;
+
+		node = node_devs[i]->platform_data;
+		if (node->node_info->is_fab_dev)
+			msm_bus_agg_fab_clks(node, ctx);
+	}
+
+	/* All RPM votes of this commit go out before waiting on any ack */
+	batch.num = 0;
+	for (i = 0; i < num_dirty; i++) {
+		struct device *node_device = node_devs[i];
 
 		if (!node_device) {
 			MSM_BUS_ERR("Can't find device for %d", dirty_nodes[i]);
 			continue;
 		}
 
-		ret = flush_bw_data(node_device, ctx);
+		ret = flush_bw_data(node_device, ctx, &batch);
 		if (ret)
 			MSM_BUS_ERR("%s: Error flushing bw data for node %d",
 					__func__, dirty_nodes[i]);
+	}
+
+	/* Bandwidth votes are acked before any clock is changed */
+	ret = msm_bus_rpm_batch_commit(&batch);
+	if (ret)
+		MSM_BUS_ERR("%s: Error committing RPM votes", __func__);
+
+	for (i = 0; i < num_dirty; i++) {
+		if (!node_devs[i])
+			continue;
 
-		ret = flush_clk_data(node_device, ctx);
+		ret = flush_clk_data(node_devs[i], ctx);
 		if (ret)
 			MSM_BUS_ERR("%s: Error flushing clk data for node %d",
 					__func__, dirty_nodes[i]);
@@ -439,10 +434,20 @@ int msm_bus_commit_data(int *dirty_nodes, int ctx, int num_dirty)
 	}
 #endif
 
+	/* Reset the aggregated clocks of the dirty fabrics */
+	for (i = 0; i < num_dirty; i++) {
+		struct msm_bus_node_device_type *node;
+
+		if (!node_devs[i])
+			continue;
+
+		node = node_devs[i]->platform_data;
+		if (node->node_info->is_fab_dev)
+			node->cur_clk_hz[ctx] = 0;
+	}
+
+	kfree(node_devs);
 	kfree(dirty_nodes);
-	/* Aggregate the bus clocks */
-	bus_for_each_dev(&msm_bus_type, NULL, (void *)&ctx,
-				msm_bus_reset_fab_clks);
 	return ret;
 }
 
@@ -590,7 +595,9 @@ int msm_bus_update_clks(struct msm_bus_node_device_type *nodedev,
 	if (IS_ERR_OR_NULL(nodeclk))
 		goto exit_set_clks;
 
-	if (!nodeclk->dirty || (nodeclk->dirty && (nodeclk->rate < req_clk))) {
+	/* Only touch the node clock if this request changes it */
+	if ((!nodeclk->dirty && (nodeclk->rate != req_clk)) ||
+		(nodeclk->dirty && (nodeclk->rate < req_clk))) {
 		nodeclk->rate = req_clk;
 		nodeclk->dirty = 1;
 		MSM_BUS_DBG("%s: Modifying node clk %d Rate %llu", __func__,
@@ -1085,6 +1092,8 @@ static struct device *msm_bus_device_init(
 
 	bus_node->node_info = node_info;
 	bus_node->ap_owned = pdata->ap_owned;
+	INIT_LIST_HEAD(&bus_node->fab_link);
+	INIT_LIST_HEAD(&bus_node->fab_children);
 	bus_dev->platform_data = bus_node;
 
 	if (msm_bus_copy_node_info(pdata, bus_dev) < 0) {
@@ -1114,6 +1123,11 @@ static struct device *msm_bus_device_init(
 	}
 	device_create_file(bus_dev, &dev_attr_vrail);
 
+	ret = radix_tree_insert(&msm_bus_node_tree, node_info->id, bus_dev);
+	if (ret)
+		MSM_BUS_ERR("%s: Error adding node %d to lookup tree",
+					__func__, node_info->id);
+
 exit_device_init:
 	return bus_dev;
 }
@@ -1133,6 +1147,7 @@ static int msm_bus_setup_dev_conn(struct device *bus_dev, void *data)
 
 	/* Setup parent bus device for this node */
 	if (!bus_node->node_info->is_fab_dev) {
+		struct msm_bus_node_device_type *bus_parent;
 		struct device *bus_parent_device =
 			bus_find_device(&msm_bus_type, NULL,
 				(void *)&bus_node->node_info->bus_device_id,
@@ -1147,6 +1162,8 @@ static int msm_bus_setup_dev_conn(struct device *bus_dev, void *data)
 			goto exit_setup_dev_conn;
 		}
 		bus_node->node_info->bus_device = bus_parent_device;
+		bus_parent = bus_parent_device->platform_data;
+		list_add_tail(&bus_node->fab_link, &bus_parent->fab_children);
 	}
 
 	bus_node->node_info->is_traversed = false;
@@ -1328,9 +1345,13 @@ static int msm_bus_free_dev(struct device *dev, void *data)
 
 	bus_node = dev->platform_data;
 
-	if (bus_node)
+	if (bus_node) {
 		MSM_BUS_ERR("\n%s: Removing device %d", __func__,
 						bus_node->node_info->id);
+		radix_tree_delete(&msm_bus_node_tree, bus_node->node_info->id);
+		list_del_init(&bus_node->fab_link);
+		synchronize_rcu();
+	}
 	device_unregister(dev);
 	return 0;
 }
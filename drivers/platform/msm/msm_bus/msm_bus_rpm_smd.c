@@ -135,6 +135,76 @@ free_rpm_request:
 	return ret;
 }
 
+/*
+ * Queue one bandwidth vote on an RPM batch. The request is sent right away
+ * but its ack is only collected by msm_bus_rpm_batch_commit(), so that the
+ * RPM can process the whole update while more votes are being sent.
+ */
+int msm_bus_rpm_batch_add(struct msm_bus_rpm_batch *batch, int ctx,
+	uint32_t rsc_type, uint32_t id, uint32_t key, uint64_t *bw)
+{
+	struct msm_rpm_request *rpm_req;
+	int ret, msg_id;
+
+	if (batch->num == MSM_BUS_RPM_BATCH_MAX) {
+		ret = msm_bus_rpm_batch_commit(batch);
+		if (ret)
+			return ret;
+	}
+
+	rpm_req = msm_rpm_create_request(ctx, rsc_type, id, 1);
+	if (rpm_req == NULL) {
+		MSM_BUS_WARN("RPM: Couldn't create RPM Request\n");
+		return -ENXIO;
+	}
+
+	ret = msm_rpm_add_kvp_data(rpm_req, key, (const uint8_t *)bw,
+						(int)(sizeof(uint64_t)));
+	if (ret) {
+		MSM_BUS_WARN("RPM: Add KVP failed for RPM Req:%u\n",
+			rsc_type);
+		goto free_rpm_request;
+	}
+
+	msg_id = msm_rpm_send_request(rpm_req);
+	if (!msg_id) {
+		MSM_BUS_WARN("RPM: No message ID for req\n");
+		ret = -ENXIO;
+		goto free_rpm_request;
+	}
+
+	batch->req[batch->num] = rpm_req;
+	batch->msg_id[batch->num] = msg_id;
+	batch->num++;
+	return 0;
+
+free_rpm_request:
+	msm_rpm_free_request(rpm_req);
+	return ret;
+}
+
+/* Wait for the acks of all the votes queued on @batch and release them */
+int msm_bus_rpm_batch_commit(struct msm_bus_rpm_batch *batch)
+{
+	int i, err, ret = 0;
+	ktime_t start = ktime_get();
+
+	for (i = 0; i < batch->num; i++) {
+		err = msm_rpm_wait_for_ack(batch->msg_id[i]);
+		if (err) {
+			MSM_BUS_WARN("RPM: Ack failed\n");
+			ret = err;
+		}
+		msm_rpm_free_request(batch->req[i]);
+	}
+
+	if (batch->num)
+		msm_bus_dbg_rec_latency(MSM_BUS_DBG_LAT_RPM, start);
+	batch->num = 0;
+
+	return ret;
+}
+
 static int msm_bus_rpm_commit_arb(struct msm_bus_fabric_registration
 	*fab_pdata, int ctx, void *rpm_data,
 	struct commit_data *cd, bool valid)
@@ -600,6 +600,24 @@ int sps_bam_device_init(struct sps_bam *dev)
 	return 0;
 }
 
+/**
+ * Free a descriptor cache
+ *
+ * Caches up to a page come from kzalloc, larger ones from vmalloc.
+ *
+ * @cache - descriptor cache and user pointer array
+ *
+ * @size - size of the allocation
+ *
+ */
+static void desc_cache_free(u8 *cache, u32 size)
+{
+	if (size <= PAGE_SIZE)
+		kfree(cache);
+	else
+		vfree(cache);
+}
+
 /**
  * BAM device de-initialization
  *
@@ -607,12 +625,21 @@ int sps_bam_device_init(struct sps_bam *dev)
 int sps_bam_device_de_init(struct sps_bam *dev)
 {
 	int result;
+	u32 n;
 
 	SPS_DBG2("sps:BAM device DEINIT: phys %pa IRQ %d\n",
 		BAM_ID(dev), dev->props.irq);
 
 	result = sps_bam_disable(dev);
 
+	for (n = 0; n < BAM_MAX_PIPES; n++) {
+		if (dev->desc_cache_pool[n] == NULL)
+			continue;
+		desc_cache_free(dev->desc_cache_pool[n],
+				dev->desc_cache_pool_size[n]);
+		dev->desc_cache_pool[n] = NULL;
+	}
+
 	return result;
 }
 
@@ -1048,11 +1075,15 @@ int sps_bam_pipe_disconnect(struct sps_bam *dev, u32 pipe_index)
 		else
 			bam_pipe_exit(dev->base, pipe_index, dev->props.ee);
 		if (pipe->sys.desc_cache != NULL) {
-			u32 size = pipe->num_descs * sizeof(void *);
-			if (pipe->desc_size + size <= PAGE_SIZE)
-				kfree(pipe->sys.desc_cache);
-			else
-				vfree(pipe->sys.desc_cache);
+			u32 size = pipe->desc_size +
+				   pipe->num_descs * sizeof(void *);
+
+			/* Park the cache for the next connection */
+			if (dev->desc_cache_pool[pipe_index] != NULL)
+				desc_cache_free(dev->desc_cache_pool[pipe_index],
+					dev->desc_cache_pool_size[pipe_index]);
+			dev->desc_cache_pool[pipe_index] = pipe->sys.desc_cache;
+			dev->desc_cache_pool_size[pipe_index] = size;
 			pipe->sys.desc_cache = NULL;
 		}
 		dev->pipes[pipe_index] = BAM_PIPE_UNASSIGNED;
@@ -1177,7 +1208,14 @@ int sps_bam_pipe_set_params(struct sps_bam *dev, u32 pipe_index, u32 options)
 		/* Allocate both descriptor cache and user pointer array */
 		size = pipe->num_descs * sizeof(void *);
 
-		if (pipe->desc_size + size <= PAGE_SIZE)
+		if (dev->desc_cache_pool[pipe_index] != NULL &&
+		    dev->desc_cache_pool_size[pipe_index] ==
+		    pipe->desc_size + size) {
+			/* Reuse the cache of the previous connection */
+			pipe->sys.desc_cache = dev->desc_cache_pool[pipe_index];
+			dev->desc_cache_pool[pipe_index] = NULL;
+			memset(pipe->sys.desc_cache, 0, pipe->desc_size + size);
+		} else if (pipe->desc_size + size <= PAGE_SIZE)
 			pipe->sys.desc_cache =
 				kzalloc(pipe->desc_size + size, GFP_KERNEL);
 		else {
@@ -1435,6 +1473,28 @@ int sps_bam_pipe_transfer_one(struct sps_bam *dev,
 	return 0;
 }
 
+/**
+ * Ring the doorbell for descriptors queued with SPS_IOVEC_FLAG_NO_SUBMIT
+ *
+ */
+int sps_bam_pipe_submit(struct sps_bam *dev, u32 pipe_index)
+{
+	struct sps_pipe *pipe = dev->pipes[pipe_index];
+
+	/* Is this a BAM-to-BAM or satellite connection? */
+	if ((pipe->state & (BAM_STATE_BAM2BAM | BAM_STATE_REMOTE))) {
+		SPS_ERR("sps:Submit on BAM-to-BAM: BAM %pa pipe %d\n",
+			BAM_ID(dev), pipe_index);
+		return SPS_ERROR;
+	}
+
+	wmb(); /* Memory Barrier */
+	bam_pipe_set_desc_write_offset(dev->base, pipe_index,
+				       pipe->sys.desc_offset);
+
+	return 0;
+}
+
 /**
  * Submit a transfer to a BAM pipe
  *
@@ -2025,6 +2085,53 @@ int sps_bam_pipe_get_iovec(struct sps_bam *dev, u32 pipe_index,
 	return 0;
 }
 
+/**
+ * Get processed I/O vectors
+ */
+int sps_bam_pipe_get_iovecs(struct sps_bam *dev, u32 pipe_index,
+			    struct sps_iovec *iovec, u32 max, u32 *count)
+{
+	struct sps_pipe *pipe = dev->pipes[pipe_index];
+	u32 read_offset;
+	u32 n = 0;
+
+	*count = 0;
+
+	/* Is this a valid pipe configured for get_iovec use? */
+	if (!pipe->sys.ack_xfers ||
+	    (pipe->state & BAM_STATE_BAM2BAM) != 0 ||
+	    (pipe->state & BAM_STATE_REMOTE)) {
+		return SPS_ERROR;
+	}
+
+	/* Poll once for the whole batch */
+	if ((pipe->polled || pipe->hybrid) && !pipe->sys.no_queue)
+		pipe_handler_eot(dev, pipe);
+
+	if (pipe->sys.no_queue)
+		read_offset =
+		bam_pipe_get_desc_read_offset(dev->base, pipe_index);
+	else
+		read_offset = pipe->sys.cache_offset;
+
+	while (n < max && read_offset != pipe->sys.acked_offset) {
+		iovec[n++] = *(struct sps_iovec *) (pipe->sys.desc_buf +
+						    pipe->sys.acked_offset);
+
+		pipe->sys.acked_offset += sizeof(struct sps_iovec);
+		if (pipe->sys.acked_offset >= pipe->desc_size)
+			pipe->sys.acked_offset = 0;
+	}
+
+#ifdef SPS_BAM_STATISTICS
+	pipe->sys.get_iovecs += n;
+#endif /* SPS_BAM_STATISTICS */
+
+	*count = n;
+
+	return 0;
+}
+
 /**
  * Determine whether a BAM pipe descriptor FIFO is empty
  *
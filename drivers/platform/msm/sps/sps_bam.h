@@ -211,6 +211,13 @@ struct sps_bam {
 	struct sps_pipe *pipes[BAM_MAX_PIPES];
 	struct list_head pipes_q;
 
+	/*
+	 * Descriptor caches of disconnected pipes, kept for the next
+	 * connection on the same pipe so reconnects do not reallocate.
+	 */
+	u8 *desc_cache_pool[BAM_MAX_PIPES];
+	u32 desc_cache_pool_size[BAM_MAX_PIPES];
+
 	/* Statistics */
 	u32 irq_from_disabled_pipe;
 	u32 event_trigger_failures;
@@ -431,6 +438,23 @@ int sps_bam_pipe_reg_event(struct sps_bam *dev, u32 pipe_index,
 int sps_bam_pipe_transfer_one(struct sps_bam *dev, u32 pipe_index, u32 addr,
 			      u32 size, void *user, u32 flags);
 
+/**
+ * Submit queued descriptors of a BAM pipe
+ *
+ * This function writes the descriptor FIFO write offset of a BAM pipe so
+ * that descriptors queued with SPS_IOVEC_FLAG_NO_SUBMIT are processed.
+ *
+ * The pipe mutex must be locked before calling this function.
+ *
+ * @dev - pointer to BAM device descriptor
+ *
+ * @pipe_index - pipe index
+ *
+ * @return 0 on success, negative value on error
+ *
+ */
+int sps_bam_pipe_submit(struct sps_bam *dev, u32 pipe_index);
+
 /**
  * Submit a transfer to a BAM pipe
  *
@@ -482,6 +506,27 @@ int sps_bam_pipe_get_event(struct sps_bam *dev, u32 pipe_index,
 int sps_bam_pipe_get_iovec(struct sps_bam *dev, u32 pipe_index,
 			   struct sps_iovec *iovec);
 
+/**
+ * Get processed I/O vectors
+ *
+ * This function fetches up to max processed I/O vectors with a single
+ * poll of the pipe.
+ *
+ * @dev - pointer to BAM device descriptor
+ *
+ * @pipe_index - pipe index
+ *
+ * @iovec - pointer to array of max I/O vector structs (output)
+ *
+ * @max - size of the iovec array
+ *
+ * @count - number of I/O vectors fetched (output)
+ *
+ * @return 0 on success, negative value on error
+ */
+int sps_bam_pipe_get_iovecs(struct sps_bam *dev, u32 pipe_index,
+			    struct sps_iovec *iovec, u32 max, u32 *count);
+
 /**
  * Determine whether a BAM pipe descriptor FIFO is empty
  *
@@ -38,6 +38,7 @@ struct level_stats {
 	int64_t max_time[CONFIG_MSM_IDLE_STATS_BUCKET_COUNT];
 	int success_count;
 	int failed_count;
+	int mispredict_count;
 	int64_t total_time;
 	uint64_t enter_time;
 };
@@ -123,6 +124,12 @@ static void level_stats_print(struct seq_file *m, struct level_stats *stats)
 		seq_puts(m, seqs);
 	}
 
+	if (stats->mispredict_count) {
+		snprintf(seqs, MAX_STR_LEN, "  mispredicted count: %7d\n",
+			stats->mispredict_count);
+		seq_puts(m, seqs);
+	}
+
 	bucket_time = stats->first_bucket_time;
 	for (i = 0;
 		i < CONFIG_MSM_IDLE_STATS_BUCKET_COUNT - 1;
@@ -189,6 +196,7 @@ static void level_stats_reset(struct level_stats *stats)
 	memset(stats->max_time, 0, sizeof(stats->max_time));
 	stats->success_count = 0;
 	stats->failed_count = 0;
+	stats->mispredict_count = 0;
 	stats->total_time = 0;
 }
 
@@ -747,6 +755,39 @@ void lpm_stats_cpu_exit(uint32_t index, bool success)
 }
 EXPORT_SYMBOL(lpm_stats_cpu_exit);
 
+/**
+ * lpm_stats_cpu_mispredict() - API to report a cpu lpm level entered for
+ * less than its break-even time.
+ *
+ * @index:	cpu's lpm level index.
+ */
+void lpm_stats_cpu_mispredict(uint32_t index)
+{
+	struct lpm_stats *stats = &__get_cpu_var(cpu_stats);
+
+	if (!stats->time_stats)
+		return;
+
+	stats->time_stats[index].mispredict_count++;
+}
+EXPORT_SYMBOL(lpm_stats_cpu_mispredict);
+
+/**
+ * lpm_stats_cluster_mispredict() - API to report a cluster lpm level entered
+ * for less than its break-even time.
+ *
+ * @stats:	Pointer to the cluster's lpm_stats object.
+ * @index:	Index of the cluster lpm level.
+ */
+void lpm_stats_cluster_mispredict(struct lpm_stats *stats, uint32_t index)
+{
+	if (IS_ERR_OR_NULL(stats))
+		return;
+
+	stats->time_stats[index].mispredict_count++;
+}
+EXPORT_SYMBOL(lpm_stats_cluster_mispredict);
+
 /**
  * lpm_stats_suspend_enter() - API to communicate system entering suspend.
  *
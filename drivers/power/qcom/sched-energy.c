@@ -0,0 +1,133 @@
+/* Copyright (c) 2016, HTC Corporation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * Static energy model for the HMP scheduler.
+ *
+ * Provides the per cpu power tables used by power aware task placement
+ * (get_cpu_pwr_stats()) from device tree instead of the temperature
+ * based model of the apss-core-ea driver. Each cpu node points to the
+ * cost node of its cluster, which lists the power at each OPP:
+ *
+ *	CPU0: cpu@0 {
+ *		...
+ *		qcom,sched-energy-costs = <&A53_COSTS>;
+ *	};
+ *
+ *	A53_COSTS: a53-energy-costs {
+ *		qcom,freq-power = <	// kHz	uW
+ *			 384000	 26000
+ *			 960000	 85000
+ *			1555200	220000 >;
+ *	};
+ *
+ * Frequencies must be in ascending order. The capacity of each OPP is
+ * derived by the scheduler from the cpu efficiency and the frequency.
+ */
+
+#define pr_fmt(fmt) "sched-energy: " fmt
+
+#include <linux/cpu.h>
+#include <linux/cpumask.h>
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/of.h>
+#include <linux/slab.h>
+
+static struct cpu_pwr_stats cpu_stats[NR_CPUS];
+
+struct cpu_pwr_stats *get_cpu_pwr_stats(void)
+{
+	return cpu_stats;
+}
+EXPORT_SYMBOL(get_cpu_pwr_stats);
+
+static struct cpu_pstate_pwr * __init sched_energy_parse(struct device_node *np,
+							 int *len)
+{
+	struct cpu_pstate_pwr *ptable;
+	int i, nr;
+	u32 freq, power;
+
+	if (!of_get_property(np, "qcom,freq-power", &nr))
+		return ERR_PTR(-EINVAL);
+	nr /= 2 * sizeof(u32);
+	if (!nr)
+		return ERR_PTR(-EINVAL);
+
+	/* zero terminated, see power_cost_at_freq() */
+	ptable = kcalloc(nr + 1, sizeof(*ptable), GFP_KERNEL);
+	if (!ptable)
+		return ERR_PTR(-ENOMEM);
+
+	for (i = 0; i < nr; i++) {
+		of_property_read_u32_index(np, "qcom,freq-power", 2 * i, &freq);
+		of_property_read_u32_index(np, "qcom,freq-power", 2 * i + 1,
+					   &power);
+		if (!freq || (i && freq <= ptable[i - 1].freq)) {
+			pr_err("%s: frequencies must ascend\n", np->full_name);
+			kfree(ptable);
+			return ERR_PTR(-EINVAL);
+		}
+		ptable[i].freq = freq;
+		ptable[i].power = power;
+	}
+
+	*len = nr;
+	return ptable;
+}
+
+static int __init sched_energy_init(void)
+{
+	struct device_node *cpu_node, *costs[NR_CPUS] = { NULL };
+	struct cpu_pstate_pwr *ptable;
+	int cpu, other, len = 0;
+
+	for_each_possible_cpu(cpu) {
+		cpu_stats[cpu].cpu = cpu;
+
+		cpu_node = of_get_cpu_node(cpu, NULL);
+		if (!cpu_node)
+			continue;
+		costs[cpu] = of_parse_phandle(cpu_node,
+					      "qcom,sched-energy-costs", 0);
+		of_node_put(cpu_node);
+		if (!costs[cpu])
+			continue;
+
+		/* cpus of a cluster share their cost node, and the table */
+		for (other = 0; other < cpu; other++) {
+			if (costs[other] == costs[cpu] &&
+			    cpu_stats[other].ptable) {
+				cpu_stats[cpu].ptable = cpu_stats[other].ptable;
+				cpu_stats[cpu].len = cpu_stats[other].len;
+				break;
+			}
+		}
+		if (cpu_stats[cpu].ptable)
+			continue;
+
+		ptable = sched_energy_parse(costs[cpu], &len);
+		if (IS_ERR(ptable)) {
+			pr_err("cpu%d: no valid energy costs\n", cpu);
+			continue;
+		}
+		cpu_stats[cpu].ptable = ptable;
+		cpu_stats[cpu].len = len;
+		pr_info("cpu%d: %d OPPs, %u-%u uW\n", cpu, len,
+			ptable[0].power, ptable[len - 1].power);
+	}
+
+	for_each_possible_cpu(cpu)
+		of_node_put(costs[cpu]);
+
+	return 0;
+}
+early_initcall(sched_energy_init);
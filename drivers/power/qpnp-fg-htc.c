@@ -313,6 +313,8 @@ struct fg_chip {
 	bool			power_supply_registered;
 	bool			sw_rbias_ctrl;
 	bool			vbat_low_irq_enabled;
+	bool			soc_irq_update;
+	struct delayed_work	notify_work;
 	struct delayed_work	update_jeita_setting;
 	struct delayed_work	update_sram_data;
 	struct delayed_work	update_temp_work;
@@ -1225,6 +1227,25 @@ static int fg_is_batt_id_valid(struct fg_chip *chip)
 #define DECIKELVIN	2730
 #define SRAM_PERIOD_UPDATE_MS	30000
 #define SRAM_PERIOD_NO_ID_UPDATE_MS	100
+#define SRAM_PERIOD_FALLBACK_MS	300000
+
+/*
+ * When the SOC updates are driven by the delta-soc interrupt, the SRAM and
+ * temperature polling is only a fallback while discharging, so that the AP
+ * is not woken up every few seconds just to find that nothing has changed.
+ */
+static bool fg_poll_fallback(struct fg_chip *chip)
+{
+	return chip->soc_irq_update &&
+		chip->chg_status == POWER_SUPPLY_STATUS_DISCHARGING;
+}
+
+static int fg_sram_period_ms(struct fg_chip *chip)
+{
+	return fg_poll_fallback(chip) ? SRAM_PERIOD_FALLBACK_MS
+					: SRAM_PERIOD_UPDATE_MS;
+}
+
 static void update_sram_data(struct fg_chip *chip, int *resched_ms)
 {
 	int i, rc = 0;
@@ -1286,7 +1307,7 @@ static void update_sram_data(struct fg_chip *chip, int *resched_ms)
 
 	if (battid_valid) {
 		complete_all(&chip->batt_id_avail);
-		*resched_ms = SRAM_PERIOD_UPDATE_MS;
+		*resched_ms = fg_sram_period_ms(chip);
 	} else {
 		*resched_ms = SRAM_PERIOD_NO_ID_UPDATE_MS;
 	}
@@ -1312,7 +1333,14 @@ static void update_sram_data_work(struct work_struct *work)
 #define BATT_TEMP_ON		0x16
 #define BATT_TEMP_OFF		0x01
 #define TEMP_PERIOD_UPDATE_MS		10000
+#define TEMP_PERIOD_FALLBACK_MS		60000
 #define TEMP_PERIOD_TIMEOUT_MS		3000
+static int fg_temp_period_ms(struct fg_chip *chip)
+{
+	return fg_poll_fallback(chip) ? TEMP_PERIOD_FALLBACK_MS
+					: TEMP_PERIOD_UPDATE_MS;
+}
+
 static void update_temp_data(struct work_struct *work)
 {
 	s16 temp;
@@ -1381,7 +1409,7 @@ out:
 	}
 	schedule_delayed_work(
 		&chip->update_temp_work,
-		msecs_to_jiffies(TEMP_PERIOD_UPDATE_MS));
+		msecs_to_jiffies(fg_temp_period_ms(chip)));
 	fg_relax(&chip->update_temp_wakeup_source);
 }
 
@@ -1461,7 +1489,14 @@ static void status_change_work(struct work_struct *work)
 static int fg_set_prop_status(struct fg_chip *chip, int status)
 {
        int rc = 0;
+	bool was_fallback = fg_poll_fallback(chip);
+
        chip->chg_status = status;
+	/* Catch up right away when leaving the fallback polling */
+	if (was_fallback && !fg_poll_fallback(chip)) {
+		mod_delayed_work(system_wq, &chip->update_sram_data, 0);
+		mod_delayed_work(system_wq, &chip->update_temp_work, 0);
+	}
 	schedule_work(&chip->status_change_work);
        return rc;
 }
@@ -2047,6 +2082,28 @@ static irqreturn_t fg_mem_avail_irq_handler(int irq, void *_chip)
 	return IRQ_HANDLED;
 }
 
+#define NOTIFY_COALESCE_MS	1000
+static void fg_notify_work(struct work_struct *work)
+{
+	struct fg_chip *chip = container_of(work,
+				struct fg_chip,
+				notify_work.work);
+
+	if (chip->power_supply_registered)
+		power_supply_changed(&chip->bms_psy);
+}
+
+/*
+ * Notifications for events which are not time critical are coalesced so that
+ * a burst of them results in a single uevent to userspace.
+ */
+static void fg_notify_changed(struct fg_chip *chip)
+{
+	if (chip->power_supply_registered)
+		schedule_delayed_work(&chip->notify_work,
+				msecs_to_jiffies(NOTIFY_COALESCE_MS));
+}
+
 static irqreturn_t fg_soc_irq_handler(int irq, void *_chip)
 {
 	struct fg_chip *chip = _chip;
@@ -2062,8 +2119,14 @@ static irqreturn_t fg_soc_irq_handler(int irq, void *_chip)
 	if (fg_debug_mask & FG_IRQS)
 		pr_info("triggered 0x%x\n", soc_rt_sts);
 
-	if (chip->power_supply_registered)
+	if (irq == chip->soc_irq[DELTA_SOC].irq && chip->soc_irq_update) {
+		/* Refresh the SRAM data along with the new SOC */
+		mod_delayed_work(system_wq, &chip->update_sram_data, 0);
+		fg_notify_changed(chip);
+	} else if (chip->power_supply_registered) {
+		cancel_delayed_work(&chip->notify_work);
 		power_supply_changed(&chip->bms_psy);
+	}
 	schedule_work(&chip->update_esr_work);
 	return IRQ_HANDLED;
 }
@@ -2078,8 +2141,7 @@ static irqreturn_t fg_first_soc_irq_handler(int irq, void *_chip)
 	if (fg_est_dump)
 		schedule_work(&chip->dump_sram);
 
-	if (chip->power_supply_registered)
-		power_supply_changed(&chip->bms_psy);
+	fg_notify_changed(chip);
 	return IRQ_HANDLED;
 }
 
@@ -2786,6 +2848,8 @@ static int fg_of_init(struct fg_chip *chip)
 
 	chip->sw_rbias_ctrl = of_property_read_bool(chip->spmi->dev.of_node,
 				"qcom,sw-rbias-control");
+	chip->soc_irq_update = of_property_read_bool(chip->spmi->dev.of_node,
+				"qcom,delta-soc-irq-update");
 	return rc;
 }
 
@@ -2970,6 +3034,7 @@ static int fg_remove(struct spmi_device *spmi)
 
 	cancel_delayed_work_sync(&chip->update_sram_data);
 	cancel_delayed_work_sync(&chip->update_temp_work);
+	cancel_delayed_work_sync(&chip->notify_work);
 	cancel_delayed_work_sync(&chip->update_jeita_setting);
 	cancel_work_sync(&chip->batt_profile_init);
 	cancel_work_sync(&chip->dump_sram);
@@ -3519,7 +3584,7 @@ static int fg_hw_init(struct fg_chip *chip)
 			THERMAL_COEFF_OFFSET, 0);
 	}
 
-	if (chip->sw_rbias_ctrl) {
+	if (chip->sw_rbias_ctrl || chip->soc_irq_update) {
 		rc = fg_mem_masked_write(chip, SOC_CNFG,
 				0xFF,
 				soc_to_setpoint(DELTA_SOC_PERCENT),
@@ -3585,6 +3650,7 @@ static int fg_probe(struct spmi_device *spmi)
 	wakeup_source_init(&chip->update_sram_wakeup_source.source,
 			"qpnp_fg_update_sram");
 	mutex_init(&chip->rw_lock);
+	INIT_DELAYED_WORK(&chip->notify_work, fg_notify_work);
 	INIT_DELAYED_WORK(&chip->update_jeita_setting, update_jeita_setting);
 	INIT_DELAYED_WORK(&chip->update_sram_data, update_sram_data_work);
 	INIT_DELAYED_WORK(&chip->update_temp_work, update_temp_data);
@@ -3737,6 +3803,7 @@ cancel_work:
 	cancel_delayed_work_sync(&chip->update_jeita_setting);
 	cancel_delayed_work_sync(&chip->update_sram_data);
 	cancel_delayed_work_sync(&chip->update_temp_work);
+	cancel_delayed_work_sync(&chip->notify_work);
 	cancel_work_sync(&chip->batt_profile_init);
 	cancel_work_sync(&chip->dump_sram);
 	cancel_work_sync(&chip->status_change_work);
@@ -3798,7 +3865,7 @@ static void check_and_update_sram_data(struct fg_chip *chip)
 	get_current_time(&current_time);
 
 	next_update_time = chip->last_temp_update_time
-		+ (TEMP_PERIOD_UPDATE_MS / 1000);
+		+ (fg_temp_period_ms(chip) / 1000);
 
 	if (next_update_time > current_time)
 		time_left = next_update_time - current_time;
@@ -3809,7 +3876,7 @@ static void check_and_update_sram_data(struct fg_chip *chip)
 		&chip->update_temp_work, msecs_to_jiffies(time_left * 1000));
 
 	next_update_time = chip->last_sram_update_time
-		+ (SRAM_PERIOD_UPDATE_MS / 1000);
+		+ (fg_sram_period_ms(chip) / 1000);
 
 	if (next_update_time > current_time)
 		time_left = next_update_time - current_time;
@@ -19,6 +19,7 @@
 #include <linux/slab.h>
 #include <linux/spinlock.h>
 #include <linux/string.h>
+#include <linux/sched.h>
 #include <linux/of.h>
 #include <linux/of_device.h>
 #include <linux/platform_device.h>
@@ -174,6 +175,13 @@ struct rpm_vreg {
 	bool			apps_only;
 	struct msm_rpm_request	*handle_active;
 	struct msm_rpm_request	*handle_sleep;
+	struct rpm_regulator_batch *batch;
+	struct rpm_regulator	*batch_reg;
+	struct list_head	batch_node;
+	u32			batch_msg_id;
+#ifdef CONFIG_REGULATOR_RPM_SMD_DEFER_SLEEP
+	struct list_head	sleep_node;
+#endif
 };
 
 struct rpm_regulator {
@@ -417,7 +425,12 @@ static int rpm_vreg_add_modified_requests(struct rpm_regulator *regulator,
 	return rc;
 }
 
-static int rpm_vreg_send_request(struct rpm_regulator *regulator, u32 set)
+/*
+ * If msg_id is not NULL, the request is only sent and its message id is
+ * returned there so that the caller can wait for the ack later on.
+ */
+static int rpm_vreg_send_request(struct rpm_regulator *regulator, u32 set,
+				 u32 *msg_id)
 {
 	struct rpm_vreg *rpm_vreg = regulator->rpm_vreg;
 	struct msm_rpm_request *handle
@@ -425,11 +438,15 @@ static int rpm_vreg_send_request(struct rpm_regulator *regulator, u32 set)
 					: rpm_vreg->handle_sleep);
 	int rc;
 
-	if (rpm_vreg->allow_atomic)
+	if (rpm_vreg->allow_atomic) {
 		rc = msm_rpm_wait_for_ack_noirq(msm_rpm_send_request_noirq(
 						  handle));
-	else
+	} else if (msg_id) {
+		*msg_id = msm_rpm_send_request(handle);
+		rc = *msg_id ? 0 : -EIO;
+	} else {
 		rc = msm_rpm_wait_for_ack(msm_rpm_send_request(handle));
+	}
 
 	if (rc)
 		vreg_err(regulator,
@@ -441,6 +458,175 @@ static int rpm_vreg_send_request(struct rpm_regulator *regulator, u32 set)
 	return rc;
 }
 
+#ifdef CONFIG_REGULATOR_RPM_SMD_DEFER_SLEEP
+/*
+ * Sleep set requests only take effect once the Apps processor enters RPM
+ * assisted power collapse, so they are not sent right away.  Instead their
+ * KVPs are accumulated in the sleep set handle and the regulator is queued on
+ * rpm_vreg_sleep_list.  rpm_regulator_flush_sleep_requests() sends all of the
+ * queued requests from lpm-levels just before the RPM is notified of sleep.
+ *
+ * rpm_vreg_sleep_lock protects the list as well as the KVPs of the sleep set
+ * handles since the flush runs with interrupts disabled and cannot take the
+ * mutex of non-atomic regulators.
+ */
+static DEFINE_SPINLOCK(rpm_vreg_sleep_lock);
+static LIST_HEAD(rpm_vreg_sleep_list);
+
+static int rpm_vreg_add_sleep_requests(struct rpm_regulator *regulator,
+		const u32 *param, u32 modified)
+{
+	struct rpm_vreg *rpm_vreg = regulator->rpm_vreg;
+	unsigned long flags;
+	int rc = 0;
+	int i;
+
+	spin_lock_irqsave(&rpm_vreg_sleep_lock, flags);
+	for (i = 0; i < RPM_REGULATOR_PARAM_MAX; i++) {
+		if (!(modified & BIT(i)))
+			continue;
+		rc = msm_rpm_add_kvp_data_noirq(rpm_vreg->handle_sleep,
+				params[i].key, (u8 *)&param[i], 4);
+		if (rc) {
+			vreg_err(regulator, "add KVP failed: %s %u; %s, rc=%d\n",
+				rpm_vreg->resource_name, rpm_vreg->resource_id,
+				params[i].name, rc);
+			break;
+		}
+	}
+	spin_unlock_irqrestore(&rpm_vreg_sleep_lock, flags);
+
+	return rc;
+}
+
+static int rpm_vreg_send_sleep_request(struct rpm_regulator *regulator)
+{
+	struct rpm_vreg *rpm_vreg = regulator->rpm_vreg;
+	unsigned long flags;
+
+	spin_lock_irqsave(&rpm_vreg_sleep_lock, flags);
+	if (list_empty(&rpm_vreg->sleep_node))
+		list_add_tail(&rpm_vreg->sleep_node, &rpm_vreg_sleep_list);
+	spin_unlock_irqrestore(&rpm_vreg_sleep_lock, flags);
+
+	return 0;
+}
+
+static void rpm_vreg_cancel_sleep_request(struct rpm_vreg *rpm_vreg)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&rpm_vreg_sleep_lock, flags);
+	list_del_init(&rpm_vreg->sleep_node);
+	spin_unlock_irqrestore(&rpm_vreg_sleep_lock, flags);
+}
+
+/**
+ * rpm_regulator_flush_sleep_requests() - send all deferred sleep set requests
+ *
+ * Returns 0 on success or errno on failure.  If a request could not be sent,
+ * the RPM sleep set is out of date and the caller must not enter a low power
+ * mode which notifies the RPM.
+ *
+ * This function must be called with interrupts disabled.
+ */
+int rpm_regulator_flush_sleep_requests(void)
+{
+	struct rpm_vreg *rpm_vreg, *rpm_vreg_temp;
+	int rc = 0;
+
+	spin_lock(&rpm_vreg_sleep_lock);
+	list_for_each_entry_safe(rpm_vreg, rpm_vreg_temp, &rpm_vreg_sleep_list,
+			sleep_node) {
+		rc = msm_rpm_wait_for_ack_noirq(msm_rpm_send_request_noirq(
+						  rpm_vreg->handle_sleep));
+		if (rc) {
+			pr_err("%s %u: sleep set flush failed, rc=%d\n",
+				rpm_vreg->resource_name, rpm_vreg->resource_id,
+				rc);
+			break;
+		}
+		list_del_init(&rpm_vreg->sleep_node);
+	}
+	spin_unlock(&rpm_vreg_sleep_lock);
+
+	return rc;
+}
+EXPORT_SYMBOL(rpm_regulator_flush_sleep_requests);
+#else
+static int rpm_vreg_add_sleep_requests(struct rpm_regulator *regulator,
+		const u32 *param, u32 modified)
+{
+	return rpm_vreg_add_modified_requests(regulator, RPM_SET_SLEEP, param,
+						modified);
+}
+
+static int rpm_vreg_send_sleep_request(struct rpm_regulator *regulator)
+{
+	return rpm_vreg_send_request(regulator, RPM_SET_SLEEP, NULL);
+}
+
+static inline void rpm_vreg_cancel_sleep_request(struct rpm_vreg *rpm_vreg) { }
+#endif
+
+/*
+ * Batches of votes are tracked per task.  While a task has a batch open, the
+ * requests of non-atomic regulators that it votes on are only aggregated once
+ * the batch ends, so that several votes for the same regulator result in a
+ * single RPM message, and the messages for all regulators of the batch are
+ * sent back to back before waiting for any of the acks.
+ */
+static DEFINE_SPINLOCK(rpm_vreg_batch_lock);
+static LIST_HEAD(rpm_vreg_batch_list);
+
+static struct rpm_regulator_batch *rpm_vreg_current_batch(void)
+{
+	struct rpm_regulator_batch *batch, *found = NULL;
+
+	if (list_empty(&rpm_vreg_batch_list))
+		return NULL;
+
+	spin_lock(&rpm_vreg_batch_lock);
+	list_for_each_entry(batch, &rpm_vreg_batch_list, list) {
+		if (batch->owner == current) {
+			found = batch;
+			break;
+		}
+	}
+	spin_unlock(&rpm_vreg_batch_lock);
+
+	return found;
+}
+
+/*
+ * Returns true if the aggregation of the requests of this regulator has been
+ * deferred to the end of the batch of the current task.  Must be called with
+ * the rpm_vreg lock held.
+ */
+static bool rpm_vreg_batch_defer(struct rpm_regulator *regulator)
+{
+	struct rpm_vreg *rpm_vreg = regulator->rpm_vreg;
+	struct rpm_regulator_batch *batch;
+
+	if (rpm_vreg->allow_atomic)
+		return false;
+
+	batch = rpm_vreg_current_batch();
+	if (!batch)
+		return false;
+
+	if (!rpm_vreg->batch) {
+		rpm_vreg->batch = batch;
+		list_add_tail(&rpm_vreg->batch_node, &batch->vregs);
+	} else if (rpm_vreg->batch != batch) {
+		/* Part of the batch of another task; send the request now. */
+		return false;
+	}
+	rpm_vreg->batch_reg = regulator;
+
+	return true;
+}
+
 #define RPM_VREG_AGGR_MIN(_idx, _param_aggr, _param_reg) \
 { \
 	_param_aggr[RPM_REGULATOR_PARAM_##_idx] \
@@ -491,7 +677,8 @@ static void rpm_vreg_aggregate_params(u32 *param_aggr, const u32 *param_reg)
 	RPM_VREG_AGGR_MAX(FLOOR_LEVEL, param_aggr, param_reg);
 }
 
-static int rpm_vreg_aggregate_requests(struct rpm_regulator *regulator)
+static int __rpm_vreg_aggregate_requests(struct rpm_regulator *regulator,
+					 u32 *msg_id)
 {
 	struct rpm_vreg *rpm_vreg = regulator->rpm_vreg;
 	u32 param_active[RPM_REGULATOR_PARAM_MAX];
@@ -563,8 +750,8 @@ static int rpm_vreg_aggregate_requests(struct rpm_regulator *regulator)
 		rpm_vreg_check_modified_requests(rpm_vreg->aggr_req_sleep.param,
 			param_sleep, rpm_vreg->aggr_req_sleep.valid,
 			&modified_sleep);
-		rc = rpm_vreg_add_modified_requests(regulator, RPM_SET_SLEEP,
-			param_sleep, modified_sleep);
+		rc = rpm_vreg_add_sleep_requests(regulator, param_sleep,
+			modified_sleep);
 		if (rc)
 			return rc;
 		send_sleep = modified_sleep;
@@ -572,7 +759,7 @@ static int rpm_vreg_aggregate_requests(struct rpm_regulator *regulator)
 
 	/* Send active set request to the RPM if it contains new KVPs. */
 	if (send_active) {
-		rc = rpm_vreg_send_request(regulator, RPM_SET_ACTIVE);
+		rc = rpm_vreg_send_request(regulator, RPM_SET_ACTIVE, msg_id);
 		if (rc)
 			return rc;
 		rpm_vreg->aggr_req_active.valid |= modified_active;
@@ -589,7 +776,7 @@ static int rpm_vreg_aggregate_requests(struct rpm_regulator *regulator)
 
 	/* Send sleep set request to the RPM if it contains new KVPs. */
 	if (send_sleep) {
-		rc = rpm_vreg_send_request(regulator, RPM_SET_SLEEP);
+		rc = rpm_vreg_send_sleep_request(regulator);
 		if (rc)
 			return rc;
 		else
@@ -618,6 +805,14 @@ static int rpm_vreg_aggregate_requests(struct rpm_regulator *regulator)
 	return rc;
 }
 
+static int rpm_vreg_aggregate_requests(struct rpm_regulator *regulator)
+{
+	if (rpm_vreg_batch_defer(regulator))
+		return 0;
+
+	return __rpm_vreg_aggregate_requests(regulator, NULL);
+}
+
 static int rpm_vreg_is_enabled(struct regulator_dev *rdev)
 {
 	struct rpm_regulator *reg = rdev_get_drvdata(rdev);
@@ -1377,6 +1572,97 @@ int rpm_regulator_set_mode(struct rpm_regulator *regulator,
 }
 EXPORT_SYMBOL(rpm_regulator_set_mode);
 
+/**
+ * rpm_regulator_batch_begin() - start batching the regulator votes of a task
+ * @batch:		batch handle owned by the caller
+ *
+ * Until rpm_regulator_batch_end() is called, votes made by the current task
+ * on regulators which are not configured with qcom,allow-atomic are recorded
+ * but not sent to the RPM.  This applies to both the rpm_regulator_*() API
+ * and the regulator framework API.  The rails are only guaranteed to reach
+ * the requested state once rpm_regulator_batch_end() returns, so any settling
+ * delay required by the consumer must be taken after that.
+ *
+ * Batches nest: if the task already has a batch open, the votes are sent at
+ * the end of the outermost batch.
+ *
+ * This function must be called from nonatomic context.
+ */
+void rpm_regulator_batch_begin(struct rpm_regulator_batch *batch)
+{
+	INIT_LIST_HEAD(&batch->vregs);
+
+	if (rpm_vreg_current_batch()) {
+		batch->owner = NULL;
+		return;
+	}
+
+	batch->owner = current;
+	spin_lock(&rpm_vreg_batch_lock);
+	list_add_tail(&batch->list, &rpm_vreg_batch_list);
+	spin_unlock(&rpm_vreg_batch_lock);
+}
+EXPORT_SYMBOL(rpm_regulator_batch_begin);
+
+/**
+ * rpm_regulator_batch_end() - send the regulator votes batched by a task
+ * @batch:		batch handle passed to rpm_regulator_batch_begin()
+ *
+ * Returns 0 on success or the first errno encountered.  A regulator which
+ * failed keeps the votes made during the batch.
+ *
+ * This function must be called from nonatomic context.
+ */
+int rpm_regulator_batch_end(struct rpm_regulator_batch *batch)
+{
+	struct rpm_vreg *rpm_vreg, *rpm_vreg_temp;
+	int rc = 0;
+	int ret;
+
+	if (!batch->owner)
+		return 0;
+
+	spin_lock(&rpm_vreg_batch_lock);
+	list_del(&batch->list);
+	spin_unlock(&rpm_vreg_batch_lock);
+
+	/* Send the requests of all regulators before waiting for the acks. */
+	list_for_each_entry(rpm_vreg, &batch->vregs, batch_node) {
+		rpm_vreg_lock(rpm_vreg);
+		rpm_vreg->batch_msg_id = 0;
+		ret = __rpm_vreg_aggregate_requests(rpm_vreg->batch_reg,
+						    &rpm_vreg->batch_msg_id);
+		rpm_vreg_unlock(rpm_vreg);
+		if (ret && !rc)
+			rc = ret;
+	}
+
+	list_for_each_entry_safe(rpm_vreg, rpm_vreg_temp, &batch->vregs,
+			batch_node) {
+		if (rpm_vreg->batch_msg_id) {
+			ret = msm_rpm_wait_for_ack(rpm_vreg->batch_msg_id);
+			if (ret) {
+				vreg_err(rpm_vreg->batch_reg,
+					"msm rpm send failed: %s %u; set=act, rc=%d\n",
+					rpm_vreg->resource_name,
+					rpm_vreg->resource_id, ret);
+				if (!rc)
+					rc = ret;
+			}
+		}
+
+		rpm_vreg_lock(rpm_vreg);
+		list_del_init(&rpm_vreg->batch_node);
+		rpm_vreg->batch = NULL;
+		rpm_vreg_unlock(rpm_vreg);
+	}
+
+	batch->owner = NULL;
+
+	return rc;
+}
+EXPORT_SYMBOL(rpm_regulator_batch_end);
+
 static struct regulator_ops ldo_ops = {
 	.enable			= rpm_vreg_enable,
 	.disable		= rpm_vreg_disable,
@@ -1567,6 +1853,7 @@ static int rpm_vreg_resource_remove(struct platform_device *pdev)
 		}
 		rpm_vreg_unlock(rpm_vreg);
 
+		rpm_vreg_cancel_sleep_request(rpm_vreg);
 		msm_rpm_free_request(rpm_vreg->handle_active);
 		msm_rpm_free_request(rpm_vreg->handle_sleep);
 
@@ -1916,6 +2203,10 @@ static int rpm_vreg_resource_probe(struct platform_device *pdev)
 	}
 
 	INIT_LIST_HEAD(&rpm_vreg->reg_list);
+	INIT_LIST_HEAD(&rpm_vreg->batch_node);
+#ifdef CONFIG_REGULATOR_RPM_SMD_DEFER_SLEEP
+	INIT_LIST_HEAD(&rpm_vreg->sleep_node);
+#endif
 
 	if (rpm_vreg->allow_atomic)
 		spin_lock_init(&rpm_vreg->slock);
@@ -1024,6 +1024,89 @@ static const struct file_operations ufsdbg_req_stats_desc = {
 	.write		= ufsdbg_req_stats_write,
 };
 
+static int ufsdbg_clkscale_stats_show(struct seq_file *file, void *data)
+{
+	struct ufs_hba *hba = (struct ufs_hba *)file->private;
+	struct ufs_clk_scaling *scaling = &hba->clk_scaling;
+	struct ufs_clk_scaling_stats stats;
+	unsigned long flags;
+	bool scaled_up;
+	u32 gap;
+
+	spin_lock_irqsave(hba->host->host_lock, flags);
+	stats = scaling->stats;
+	scaled_up = scaling->is_scaled_up;
+	gap = scaling->fg_gap_us;
+	spin_unlock_irqrestore(hba->host->host_lock, flags);
+
+	seq_printf(file, "clocks: %s\n", scaled_up ? "max" : "min");
+	seq_printf(file, "foreground boosts: %llu\n", stats.boosts);
+	seq_printf(file, "scale ups: %llu\n", stats.ups);
+	seq_printf(file, "scale downs: %llu\n", stats.downs);
+	seq_printf(file, "scale downs deferred: %llu\n", stats.downs_deferred);
+	seq_printf(file, "foreground gap avg: %u us\n", gap);
+	return 0;
+}
+
+static int ufsdbg_clkscale_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, ufsdbg_clkscale_stats_show, inode->i_private);
+}
+
+static ssize_t ufsdbg_clkscale_stats_write(struct file *filp,
+		const char __user *ubuf, size_t cnt, loff_t *ppos)
+{
+	struct ufs_hba *hba = filp->f_mapping->host->i_private;
+	unsigned long flags;
+
+	spin_lock_irqsave(hba->host->host_lock, flags);
+	memset(&hba->clk_scaling.stats, 0, sizeof(hba->clk_scaling.stats));
+	spin_unlock_irqrestore(hba->host->host_lock, flags);
+	return cnt;
+}
+
+static const struct file_operations ufsdbg_clkscale_stats_desc = {
+	.open		= ufsdbg_clkscale_stats_open,
+	.read		= seq_read,
+	.write		= ufsdbg_clkscale_stats_write,
+};
+
+static int ufsdbg_idle_gaps_show(struct seq_file *file, void *data)
+{
+	struct ufs_hba *hba = (struct ufs_hba *)file->private;
+	struct ufs_idle_gaps gaps;
+	unsigned long flags, h8_ms, gate_ms;
+	int i;
+
+	spin_lock_irqsave(hba->host->host_lock, flags);
+	gaps = hba->idle_gaps;
+	h8_ms = hba->hibern8_on_idle.delay_ms;
+	gate_ms = hba->clk_gating.delay_ms;
+	spin_unlock_irqrestore(hba->host->host_lock, flags);
+
+	seq_printf(file, "auto: %d\n", gaps.auto_enabled);
+	seq_printf(file, "hibern8 delay: %lu ms, exit: %u us\n",
+		   h8_ms, gaps.h8_exit_us);
+	seq_printf(file, "clkgate delay: %lu ms, ungate: %u us\n",
+		   gate_ms, gaps.ungate_us);
+	for (i = 0; i < UFSHCD_IDLE_GAP_BUCKETS - 1; i++)
+		seq_printf(file, "< %6u us: %u\n",
+			   ufshcd_idle_gap_bounds_us[i], gaps.hist[i]);
+	seq_printf(file, ">= %5u us: %u\n",
+		   ufshcd_idle_gap_bounds_us[i - 1], gaps.hist[i]);
+	return 0;
+}
+
+static int ufsdbg_idle_gaps_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, ufsdbg_idle_gaps_show, inode->i_private);
+}
+
+static const struct file_operations ufsdbg_idle_gaps_desc = {
+	.open		= ufsdbg_idle_gaps_open,
+	.read		= seq_read,
+};
+
 void ufsdbg_add_debugfs(struct ufs_hba *hba)
 {
 	if (!hba) {
@@ -1151,6 +1234,50 @@ void ufsdbg_add_debugfs(struct ufs_hba *hba)
 		goto err;
 	}
 
+	hba->debugfs_files.clkscale_stats =
+		debugfs_create_file("clkscale_stats", S_IRUSR | S_IWUSR,
+			hba->debugfs_files.debugfs_root, hba,
+			&ufsdbg_clkscale_stats_desc);
+	if (!hba->debugfs_files.clkscale_stats) {
+		dev_err(hba->dev,
+			"%s:  failed create clkscale_stats debugfs entry\n",
+			__func__);
+		goto err;
+	}
+
+	hba->debugfs_files.clkscale_hold_max_ms =
+		debugfs_create_u32("clkscale_hold_max_ms", S_IRUSR | S_IWUSR,
+			hba->debugfs_files.debugfs_root,
+			&hba->clk_scaling.hold_max_ms);
+	if (!hba->debugfs_files.clkscale_hold_max_ms) {
+		dev_err(hba->dev,
+			"%s:  failed create clkscale_hold_max_ms debugfs entry\n",
+			__func__);
+		goto err;
+	}
+
+	hba->debugfs_files.idle_gaps =
+		debugfs_create_file("idle_gaps", S_IRUSR,
+			hba->debugfs_files.debugfs_root, hba,
+			&ufsdbg_idle_gaps_desc);
+	if (!hba->debugfs_files.idle_gaps) {
+		dev_err(hba->dev,
+			"%s:  failed create idle_gaps debugfs entry\n",
+			__func__);
+		goto err;
+	}
+
+	hba->debugfs_files.idle_latency_weight =
+		debugfs_create_u32("idle_latency_weight", S_IRUSR | S_IWUSR,
+			hba->debugfs_files.debugfs_root,
+			&hba->idle_gaps.latency_weight);
+	if (!hba->debugfs_files.idle_latency_weight) {
+		dev_err(hba->dev,
+			"%s:  failed create idle_latency_weight debugfs entry\n",
+			__func__);
+		goto err;
+	}
+
 	ufsdbg_setup_fault_injection(hba);
 
 	if (hba->vops && hba->vops->add_debugfs)
@@ -16,6 +16,7 @@
 #include <linux/scsi/ufs/ufs-qcom.h>
 #include "qcom-debugfs.h"
 #include "debugfs.h"
+#include "ufshci.h"
 
 #define TESTBUS_CFG_BUFF_LINE_SIZE	sizeof("0xXY, 0xXY")
 
@@ -229,6 +230,134 @@ static const struct file_operations ufs_qcom_dbg_dbg_regs_desc = {
 	.read		= seq_read,
 };
 
+static int ufs_qcom_dbg_intr_aggr_counter_read(void *data, u64 *attr_val)
+{
+	struct ufs_hba *hba = data;
+
+	*attr_val = hba->intr_aggr.counter;
+	return 0;
+}
+
+static int ufs_qcom_dbg_intr_aggr_counter_set(void *data, u64 attr_val)
+{
+	struct ufs_hba *hba = data;
+
+	/* 0 would interrupt on every completion, like no aggregation */
+	if (!attr_val || attr_val > INT_AGGR_COUNTER_THRESHOLD_MASK >> 8)
+		return -EINVAL;
+
+	hba->intr_aggr.counter = (u8)attr_val;
+	return ufshcd_update_intr_aggr(hba);
+}
+
+DEFINE_SIMPLE_ATTRIBUTE(ufs_qcom_dbg_intr_aggr_counter_ops,
+			ufs_qcom_dbg_intr_aggr_counter_read,
+			ufs_qcom_dbg_intr_aggr_counter_set,
+			"%llu\n");
+
+static int ufs_qcom_dbg_intr_aggr_timeout_read(void *data, u64 *attr_val)
+{
+	struct ufs_hba *hba = data;
+
+	*attr_val = hba->intr_aggr.timeout;
+	return 0;
+}
+
+static int ufs_qcom_dbg_intr_aggr_timeout_set(void *data, u64 attr_val)
+{
+	struct ufs_hba *hba = data;
+
+	if (!attr_val || attr_val > INT_AGGR_TIMEOUT_VAL_MASK)
+		return -EINVAL;
+
+	hba->intr_aggr.timeout = (u8)attr_val;
+	return ufshcd_update_intr_aggr(hba);
+}
+
+DEFINE_SIMPLE_ATTRIBUTE(ufs_qcom_dbg_intr_aggr_timeout_ops,
+			ufs_qcom_dbg_intr_aggr_timeout_read,
+			ufs_qcom_dbg_intr_aggr_timeout_set,
+			"%llu\n");
+
+static int ufs_qcom_dbg_intr_aggr_stats_show(struct seq_file *file, void *data)
+{
+	struct ufs_hba *hba = file->private;
+	struct ufs_intr_aggr aggr;
+	unsigned long flags;
+	u64 avg = 0;
+
+	spin_lock_irqsave(hba->host->host_lock, flags);
+	aggr = hba->intr_aggr;
+	spin_unlock_irqrestore(hba->host->host_lock, flags);
+
+	if (aggr.irqs)
+		avg = div64_u64(aggr.completions * 100, aggr.irqs);
+
+	seq_printf(file, "aggregated requests: %llu\n", aggr.aggr_reqs);
+	seq_printf(file, "immediate requests: %llu\n", aggr.immediate_reqs);
+	seq_printf(file, "completion interrupts: %llu\n", aggr.irqs);
+	seq_printf(file, "completions: %llu\n", aggr.completions);
+	seq_printf(file, "completions per interrupt: %llu.%02llu (max %u)\n",
+		   div_u64(avg, 100), avg % 100, aggr.max_completions);
+	return 0;
+}
+
+static int ufs_qcom_dbg_intr_aggr_stats_open(struct inode *inode,
+					     struct file *file)
+{
+	return single_open(file, ufs_qcom_dbg_intr_aggr_stats_show,
+			   inode->i_private);
+}
+
+static ssize_t ufs_qcom_dbg_intr_aggr_stats_write(struct file *file,
+						  const char __user *ubuf,
+						  size_t cnt, loff_t *ppos)
+{
+	struct ufs_hba *hba = ((struct seq_file *)file->private_data)->private;
+	unsigned long flags;
+
+	/* any write resets the counters */
+	spin_lock_irqsave(hba->host->host_lock, flags);
+	hba->intr_aggr.aggr_reqs = 0;
+	hba->intr_aggr.immediate_reqs = 0;
+	hba->intr_aggr.irqs = 0;
+	hba->intr_aggr.completions = 0;
+	hba->intr_aggr.max_completions = 0;
+	spin_unlock_irqrestore(hba->host->host_lock, flags);
+	return cnt;
+}
+
+static const struct file_operations ufs_qcom_dbg_intr_aggr_stats_desc = {
+	.open		= ufs_qcom_dbg_intr_aggr_stats_open,
+	.read		= seq_read,
+	.write		= ufs_qcom_dbg_intr_aggr_stats_write,
+	.release	= single_release,
+};
+
+static int ufs_qcom_dbg_add_intr_aggr(struct ufs_qcom_host *host)
+{
+	struct ufs_hba *hba = host->hba;
+	struct dentry *dir;
+
+	dir = debugfs_create_dir("intr_aggr",
+				 host->debugfs_files.debugfs_root);
+	if (!dir)
+		return -ENOMEM;
+	host->debugfs_files.intr_aggr = dir;
+
+	if (!debugfs_create_u32("qd_threshold", S_IRUSR | S_IWUSR, dir,
+				&hba->intr_aggr.qd_threshold) ||
+	    !debugfs_create_file("counter", S_IRUSR | S_IWUSR, dir, hba,
+				 &ufs_qcom_dbg_intr_aggr_counter_ops) ||
+	    !debugfs_create_file("timeout", S_IRUSR | S_IWUSR, dir, hba,
+				 &ufs_qcom_dbg_intr_aggr_timeout_ops) ||
+	    !debugfs_create_file("stats", S_IRUSR | S_IWUSR, dir, hba,
+				 &ufs_qcom_dbg_intr_aggr_stats_desc))
+		return -ENOMEM;
+
+	return 0;
+}
+
 void ufs_qcom_dbg_add_debugfs(struct ufs_hba *hba, struct dentry *root)
 {
 	struct ufs_qcom_host *host;
@@ -317,6 +446,13 @@ void ufs_qcom_dbg_add_debugfs(struct ufs_hba *hba, struct dentry *root)
 		goto err;
 	}
 
+	if (ufs_qcom_dbg_add_intr_aggr(host)) {
+		dev_err(host->hba->dev,
+			"%s: failed create intr_aggr debugfs entries\n",
+			__func__);
+		goto err;
+	}
+
 	return;
 
 err:
@@ -15,6 +15,7 @@
 #include <linux/of.h>
 #include <linux/async.h>
 #include <linux/blkdev.h>
+#include <linux/blk-crypt.h>
 #include <linux/scsi/ufs/ufshcd.h>
 #include <crypto/ice.h>
 
@@ -280,7 +281,13 @@ int ufs_qcom_ice_cfg(struct ufs_qcom_host *qcom_host, struct scsi_cmnd *cmd)
 	}
 
 	req = cmd->request;
-	if (req->bio)
+	/*
+	 * A bio with its own key brings the tweak along, which stays with the
+	 * file data wherever the filesystem moves it.
+	 */
+	if (bio_crypt_key(req->bio))
+		lba = req->bio->bi_crypt_dun;
+	else if (req->bio)
 		lba = req->bio->bi_sector;
 
 	slot = req->tag;
@@ -290,14 +297,16 @@ int ufs_qcom_ice_cfg(struct ufs_qcom_host *qcom_host, struct scsi_cmnd *cmd)
 		return -EINVAL;
 	}
 
-	memset(&ice_set, sizeof(ice_set), 0);
+	memset(&ice_set, 0, sizeof(ice_set));
 	if (qcom_host->ice.vops->config) {
 		err = qcom_host->ice.vops->config(qcom_host->ice.pdev,
 							req, &ice_set);
 
+		/* -EAGAIN: every key slot is busy, the request is retried */
 		if (err) {
-			dev_err(dev, "%s: error in ice_vops->config %d\n",
-				__func__, err);
+			if (err != -EAGAIN)
+				dev_err(dev, "%s: error in ice_vops->config %d\n",
+					__func__, err);
 			goto out;
 		}
 	}
@@ -352,6 +361,41 @@ out:
 	return err;
 }
 
+/**
+ * ufs_qcom_ice_cfg_end() - releases what ufs_qcom_ice_cfg() held for a
+ * transaction
+ * @qcom_host:	Pointer to a UFS QCom internal host structure.
+ *		qcom_host, qcom_host->hba and qcom_host->hba->dev should all
+ *		be valid pointers.
+ * @cmd:	Pointer to the scsi command ufs_qcom_ice_cfg() configured,
+ *		before it is completed to the scsi mid-layer.
+ *
+ * Return: -EINVAL in-case of an error
+ *         0 otherwise
+ */
+int ufs_qcom_ice_cfg_end(struct ufs_qcom_host *qcom_host,
+			 struct scsi_cmnd *cmd)
+{
+	struct device *dev = qcom_host->hba->dev;
+	int err = 0;
+
+	if (!qcom_host->ice.pdev || !qcom_host->ice.vops) {
+		dev_dbg(dev, "%s: ice device is not enabled\n", __func__);
+		goto out;
+	}
+
+	/* no state check: a slot reference taken must always be dropped */
+	if (qcom_host->ice.vops->config_end) {
+		err = qcom_host->ice.vops->config_end(qcom_host->ice.pdev,
+						      cmd->request);
+		if (err)
+			dev_err(dev, "%s: error in ice_vops->config_end %d\n",
+				__func__, err);
+	}
+out:
+	return err;
+}
+
 /**
  * ufs_qcom_ice_reset() - resets UFS-ICE interface and ICE device
  * @qcom_host:	Pointer to a UFS QCom internal host structure.
@@ -72,6 +72,8 @@ enum {
 int ufs_qcom_ice_get_dev(struct ufs_qcom_host *qcom_host);
 int ufs_qcom_ice_init(struct ufs_qcom_host *qcom_host);
 int ufs_qcom_ice_cfg(struct ufs_qcom_host *qcom_host, struct scsi_cmnd *cmd);
+int ufs_qcom_ice_cfg_end(struct ufs_qcom_host *qcom_host,
+			 struct scsi_cmnd *cmd);
 int ufs_qcom_ice_reset(struct ufs_qcom_host *qcom_host);
 int ufs_qcom_ice_resume(struct ufs_qcom_host *qcom_host);
 int ufs_qcom_ice_suspend(struct ufs_qcom_host *qcom_host);
@@ -95,6 +97,11 @@ inline int ufs_qcom_ice_cfg(struct ufs_qcom_host *qcom_host,
 {
 	return 0;
 }
+inline int ufs_qcom_ice_cfg_end(struct ufs_qcom_host *qcom_host,
+				struct scsi_cmnd *cmd)
+{
+	return 0;
+}
 inline int ufs_qcom_ice_reset(struct ufs_qcom_host *qcom_host)
 {
 	return 0;
@@ -641,6 +641,19 @@ out:
 	return err;
 }
 
+static
+void ufs_qcom_crypto_engine_cfg_end(struct ufs_hba *hba, unsigned int task_tag)
+{
+	struct ufs_qcom_host *host = hba->priv;
+	struct ufshcd_lrb *lrbp = &hba->lrb[task_tag];
+
+	if (!host->ice.pdev ||
+	    !lrbp->cmd || lrbp->command_type != UTP_CMD_TYPE_SCSI)
+		return;
+
+	ufs_qcom_ice_cfg_end(host, lrbp->cmd);
+}
+
 static
 int ufs_qcom_crytpo_engine_reset(struct ufs_hba *hba)
 {
@@ -1266,6 +1279,9 @@ static int ufs_qcom_init(struct ufs_hba *hba)
 	hba->caps |= UFSHCD_CAP_CLK_GATING | UFSHCD_CAP_CLK_SCALING;
 	hba->caps |= UFSHCD_CAP_AUTO_BKOPS_SUSPEND;
 	hba->caps |= UFSHCD_CAP_HIBERN8_ENTER_ON_IDLE;
+	hba->caps |= UFSHCD_CAP_INTR_AGGR;
+	if (host->ice.pdev)
+		hba->caps |= UFSHCD_CAP_INLINE_CRYPT;
 	ufs_qcom_setup_clocks(hba, true);
 
 	/* "dev_ref_clk_ctrl_mem" is optional resource */
@@ -1615,6 +1631,7 @@ const struct ufs_hba_variant_ops ufs_hba_qcom_vops = {
 	.resume			= ufs_qcom_resume,
 	.update_sec_cfg		= ufs_qcom_update_sec_cfg,
 	.crypto_engine_cfg	= ufs_qcom_crytpo_engine_cfg,
+	.crypto_engine_cfg_end	= ufs_qcom_crypto_engine_cfg_end,
 	.crypto_engine_reset	= ufs_qcom_crytpo_engine_reset,
 	.crypto_engine_eh	= ufs_qcom_crypto_engine_eh,
 	.crypto_engine_get_err	= ufs_qcom_crypto_engine_get_err,
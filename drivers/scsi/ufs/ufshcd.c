@@ -40,6 +40,7 @@
 #include <linux/async.h>
 #include <scsi/ufs/ioctl.h>
 #include <linux/devfreq.h>
+#include <linux/ioprio.h>
 #include <linux/nls.h>
 
 #include <linux/scsi/ufs/ufshcd.h>
@@ -209,9 +210,17 @@ static void update_req_stats(struct ufs_hba *hba, struct ufshcd_lrb *lrbp)
 #define ufshcd_hex_dump(prefix_str, buf, len) \
 print_hex_dump(KERN_ERR, prefix_str, DUMP_PREFIX_OFFSET, 16, 4, buf, len, false)
 
+/* Average foreground gaps the clocks are held up for after a burst */
+#define UFSHCD_CLKSCALE_HOLD_GAPS	4
+/* Default upper bound of that hold */
+#define UFSHCD_CLKSCALE_HOLD_MAX_MS	300
+
 /* Interrupt aggregation default timeout, unit: 40us */
 #define INT_AGGR_DEF_TO	0x02
 
+/* Requests in flight from which completions are aggregated by default */
+#define INT_AGGR_DEF_QD	4
+
 static u32 ufs_query_desc_max_size[] = {
 	QUERY_DESC_DEVICE_MAX_SIZE,
 	QUERY_DESC_CONFIGURAION_MAX_SIZE,
@@ -906,6 +915,42 @@ static inline bool ufshcd_is_intr_aggr_allowed(struct ufs_hba *hba)
 		return false;
 }
 
+/**
+ * ufshcd_update_intr_aggr - Program the current interrupt aggregation values
+ * @hba: per adapter instance
+ *
+ * Returns 0 on success, -EOPNOTSUPP if aggregation is not allowed.
+ */
+int ufshcd_update_intr_aggr(struct ufs_hba *hba)
+{
+	if (!ufshcd_is_intr_aggr_allowed(hba))
+		return -EOPNOTSUPP;
+
+	pm_runtime_get_sync(hba->dev);
+	ufshcd_hold(hba, false);
+	ufshcd_config_intr_aggr(hba, hba->intr_aggr.counter,
+				hba->intr_aggr.timeout);
+	ufshcd_release(hba, false);
+	pm_runtime_put_sync(hba->dev);
+	return 0;
+}
+EXPORT_SYMBOL_GPL(ufshcd_update_intr_aggr);
+
+/**
+ * ufshcd_use_intr_aggr - Check whether a request's completion is aggregated
+ * @hba: per adapter instance
+ *
+ * Aggregation only pays when enough requests are in flight to share an
+ * interrupt. At low queue depth, typically a latency sensitive read at
+ * QD1, the request asks for an immediate interrupt instead of waiting
+ * for the aggregation timeout.
+ */
+static inline bool ufshcd_use_intr_aggr(struct ufs_hba *hba)
+{
+	return ufshcd_is_intr_aggr_allowed(hba) &&
+		hweight_long(hba->lrb_in_use) >= hba->intr_aggr.qd_threshold;
+}
+
 /**
  * ufshcd_disable_intr_aggr - Disables interrupt aggregation.
  * @hba: per adapter instance
@@ -1063,12 +1108,139 @@ static int ufshcd_send_request_sense_all_lus(struct ufs_hba *hba)
 	return 0;
 }
 
+/* Upper bounds of the idle gap histogram buckets, the last one is open */
+const u32 ufshcd_idle_gap_bounds_us[UFSHCD_IDLE_GAP_BUCKETS] = {
+	1000, 2000, 5000, 10000, 20000, 50000, 100000, 200000, 500000, UINT_MAX,
+};
+EXPORT_SYMBOL_GPL(ufshcd_idle_gap_bounds_us);
+
+/* Idle delays are picked again every this many gaps */
+#define UFSHCD_IDLE_GAP_SAMPLES		32
+/* The histogram is halved once it holds this many gaps */
+#define UFSHCD_IDLE_GAP_DECAY		1024
+/* Exit latencies assumed until they are measured */
+#define UFSHCD_IDLE_EXIT_DEF_US		1000
+#define UFSHCD_IDLE_LATENCY_WEIGHT	16
+
+static inline bool ufshcd_is_idle_auto(struct ufs_hba *hba)
+{
+	return (ufshcd_is_clkgating_allowed(hba) ||
+		ufshcd_is_hibern8_on_idle_allowed(hba)) &&
+		hba->idle_gaps.auto_enabled;
+}
+
+static u32 ufshcd_idle_gap_mid_us(int i)
+{
+	u32 lo = i ? ufshcd_idle_gap_bounds_us[i - 1] : 0;
+
+	if (i == UFSHCD_IDLE_GAP_BUCKETS - 1)
+		return lo * 2;
+	return lo + (ufshcd_idle_gap_bounds_us[i] - lo) / 2;
+}
+
+/*
+ * Pick the idle delay, among the bucket bounds, that minimizes the cost of
+ * the recorded gaps: a gap shorter than the delay costs its length spent
+ * awake, a longer one costs the delay awake plus the exit latency, which
+ * the request that ends the gap waits for, weighted by latency_weight.
+ * With bimodal gaps this lands past the short mode when the long gaps
+ * are worth saving power for, and never lets short gaps pay the exit.
+ */
+static u32 ufshcd_idle_pick_delay_us(struct ufs_hba *hba, u32 exit_us)
+{
+	struct ufs_idle_gaps *gaps = &hba->idle_gaps;
+	u64 cost, best_cost = ULLONG_MAX;
+	u64 penalty = (u64)exit_us * gaps->latency_weight;
+	u32 delay, best = ufshcd_idle_gap_bounds_us[0];
+	int d, i;
+
+	for (d = 0; d < UFSHCD_IDLE_GAP_BUCKETS - 1; d++) {
+		delay = ufshcd_idle_gap_bounds_us[d];
+		cost = 0;
+		for (i = 0; i < UFSHCD_IDLE_GAP_BUCKETS; i++) {
+			if (i <= d)
+				cost += (u64)gaps->hist[i] *
+					ufshcd_idle_gap_mid_us(i);
+			else
+				cost += (u64)gaps->hist[i] * (delay + penalty);
+		}
+		if (cost < best_cost) {
+			best_cost = cost;
+			best = delay;
+		}
+	}
+	return best;
+}
+
+/* host lock must be held */
+static void ufshcd_idle_update_delays(struct ufs_hba *hba)
+{
+	struct ufs_idle_gaps *gaps = &hba->idle_gaps;
+	unsigned long h8_ms, gate_ms;
+
+	h8_ms = ufshcd_idle_pick_delay_us(hba, gaps->h8_exit_us) /
+		USEC_PER_MSEC;
+	gate_ms = ufshcd_idle_pick_delay_us(hba, gaps->ungate_us) /
+		USEC_PER_MSEC;
+
+	if (ufshcd_is_hibern8_on_idle_allowed(hba)) {
+		hba->hibern8_on_idle.delay_ms = h8_ms;
+		/* gating waits for the hibern8 enter work anyway */
+		gate_ms = max(gate_ms, h8_ms);
+	}
+	if (ufshcd_is_clkgating_allowed(hba))
+		hba->clk_gating.delay_ms = gate_ms;
+}
+
+/* host lock must be held: the host has nothing left to do */
+static void ufshcd_idle_start(struct ufs_hba *hba)
+{
+	if (ufshcd_is_idle_auto(hba) && !hba->idle_gaps.start_t.tv64)
+		hba->idle_gaps.start_t = ktime_get();
+}
+
+/* host lock must be held: the host is getting busy again */
+static void ufshcd_idle_end(struct ufs_hba *hba)
+{
+	struct ufs_idle_gaps *gaps = &hba->idle_gaps;
+	s64 gap;
+	int i;
+
+	if (!gaps->start_t.tv64)
+		return;
+
+	gap = ktime_us_delta(ktime_get(), gaps->start_t);
+	gaps->start_t = ktime_set(0, 0);
+	if (!ufshcd_is_idle_auto(hba))
+		return;
+
+	for (i = 0; i < UFSHCD_IDLE_GAP_BUCKETS - 1; i++)
+		if (gap < ufshcd_idle_gap_bounds_us[i])
+			break;
+	if (++gaps->hist[i] >= UFSHCD_IDLE_GAP_DECAY)
+		for (i = 0; i < UFSHCD_IDLE_GAP_BUCKETS; i++)
+			gaps->hist[i] >>= 1;
+
+	if (++gaps->samples >= UFSHCD_IDLE_GAP_SAMPLES) {
+		gaps->samples = 0;
+		ufshcd_idle_update_delays(hba);
+	}
+}
+
+static void ufshcd_idle_update_exit_us(u32 *avg, ktime_t start)
+{
+	u32 us = ktime_us_delta(ktime_get(), start);
+
+	*avg = (*avg * 3 + us) >> 2;
+}
+
 static void ufshcd_ungate_work(struct work_struct *work)
 {
 	int ret;
 	unsigned long flags;
 	struct ufs_hba *hba = container_of(work, struct ufs_hba,
 			clk_gating.ungate_work);
+	ktime_t start = ktime_get();
 
 	cancel_delayed_work_sync(&hba->clk_gating.gate_work);
 
@@ -1095,6 +1267,7 @@ static void ufshcd_ungate_work(struct work_struct *work)
 		}
 		hba->clk_gating.is_suspended = false;
 	}
+	ufshcd_idle_update_exit_us(&hba->idle_gaps.ungate_us, start);
 unblock_reqs:
 	if (hba->clk_scaling.is_allowed)
 		ufshcd_resume_clkscaling(hba);
@@ -1116,6 +1289,7 @@ int ufshcd_hold(struct ufs_hba *hba, bool async)
 		goto out;
 	spin_lock_irqsave(hba->host->host_lock, flags);
 	hba->clk_gating.active_reqs++;
+	ufshcd_idle_end(hba);
 
 	if (ufshcd_eh_in_progress(hba)) {
 		spin_unlock_irqrestore(hba->host->host_lock, flags);
@@ -1260,6 +1434,7 @@ static void __ufshcd_release(struct ufs_hba *hba, bool no_sched)
 		|| ufshcd_eh_in_progress(hba) || no_sched)
 		return;
 
+	ufshcd_idle_start(hba);
 	hba->clk_gating.state = REQ_CLKS_OFF;
 	trace_ufshcd_clk_gating(dev_name(hba->dev),
 			ufschd_clk_gating_state_to_string(
@@ -1296,6 +1471,8 @@ static ssize_t ufshcd_clkgate_delay_store(struct device *dev,
 
 	spin_lock_irqsave(hba->host->host_lock, flags);
 	hba->clk_gating.delay_ms = value;
+	/* an explicit delay overrides the idle gap histogram */
+	hba->idle_gaps.auto_enabled = false;
 	spin_unlock_irqrestore(hba->host->host_lock, flags);
 	return count;
 }
@@ -1391,6 +1568,7 @@ int ufshcd_hibern8_hold(struct ufs_hba *hba, bool async)
 
 	spin_lock_irqsave(hba->host->host_lock, flags);
 	hba->hibern8_on_idle.active_reqs++;
+	ufshcd_idle_end(hba);
 
 	if (ufshcd_eh_in_progress(hba)) {
 		spin_unlock_irqrestore(hba->host->host_lock, flags);
@@ -1466,6 +1644,7 @@ static void __ufshcd_hibern8_release(struct ufs_hba *hba, bool no_sched)
 		|| ufshcd_eh_in_progress(hba) || no_sched)
 		return;
 
+	ufshcd_idle_start(hba);
 	hba->hibern8_on_idle.state = REQ_HIBERN8_ENTER;
 	trace_ufshcd_hibern8_on_idle(dev_name(hba->dev),
 			ufshcd_hibern8_on_idle_state_to_string(
@@ -1570,10 +1749,14 @@ static void ufshcd_hibern8_exit_work(struct work_struct *work)
 
 	/* Exit from hibern8 */
 	if (ufshcd_is_link_hibern8(hba)) {
+		ktime_t start = ktime_get();
+
 		ufshcd_hold(hba, false);
 		ret = ufshcd_uic_hibern8_exit(hba);
 		ufshcd_release(hba, false);
 		if (!ret) {
+			ufshcd_idle_update_exit_us(&hba->idle_gaps.h8_exit_us,
+						   start);
 			spin_lock_irqsave(hba->host->host_lock, flags);
 			ufshcd_set_link_active(hba);
 			hba->hibern8_on_idle.state = HIBERN8_EXITED;
@@ -1606,6 +1789,8 @@ static ssize_t ufshcd_hibern8_on_idle_delay_store(struct device *dev,
 
 	spin_lock_irqsave(hba->host->host_lock, flags);
 	hba->hibern8_on_idle.delay_ms = value;
+	/* an explicit delay overrides the idle gap histogram */
+	hba->idle_gaps.auto_enabled = false;
 	spin_unlock_irqrestore(hba->host->host_lock, flags);
 	return count;
 }
@@ -1695,6 +1880,62 @@ static void ufshcd_exit_hibern8_on_idle(struct ufs_hba *hba)
 	device_remove_file(hba->dev, &hba->hibern8_on_idle.enable_attr);
 }
 
+static ssize_t ufshcd_idle_delay_auto_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct ufs_hba *hba = dev_get_drvdata(dev);
+
+	return snprintf(buf, PAGE_SIZE, "%d\n", hba->idle_gaps.auto_enabled);
+}
+
+static ssize_t ufshcd_idle_delay_auto_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count)
+{
+	struct ufs_hba *hba = dev_get_drvdata(dev);
+	unsigned long flags;
+	u32 value;
+
+	if (kstrtou32(buf, 0, &value))
+		return -EINVAL;
+
+	spin_lock_irqsave(hba->host->host_lock, flags);
+	hba->idle_gaps.auto_enabled = !!value;
+	hba->idle_gaps.start_t = ktime_set(0, 0);
+	if (hba->idle_gaps.auto_enabled)
+		ufshcd_idle_update_delays(hba);
+	spin_unlock_irqrestore(hba->host->host_lock, flags);
+	return count;
+}
+
+static void ufshcd_init_idle_gaps(struct ufs_hba *hba)
+{
+	if (!ufshcd_is_clkgating_allowed(hba) &&
+	    !ufshcd_is_hibern8_on_idle_allowed(hba))
+		return;
+
+	hba->idle_gaps.h8_exit_us = UFSHCD_IDLE_EXIT_DEF_US;
+	hba->idle_gaps.ungate_us = UFSHCD_IDLE_EXIT_DEF_US;
+	hba->idle_gaps.latency_weight = UFSHCD_IDLE_LATENCY_WEIGHT;
+	/* keep the default delays until there are gaps to go by */
+	hba->idle_gaps.auto_enabled = true;
+
+	hba->idle_gaps.auto_attr.show = ufshcd_idle_delay_auto_show;
+	hba->idle_gaps.auto_attr.store = ufshcd_idle_delay_auto_store;
+	sysfs_attr_init(&hba->idle_gaps.auto_attr.attr);
+	hba->idle_gaps.auto_attr.attr.name = "idle_delay_auto";
+	hba->idle_gaps.auto_attr.attr.mode = S_IRUGO | S_IWUSR;
+	if (device_create_file(hba->dev, &hba->idle_gaps.auto_attr))
+		dev_err(hba->dev, "Failed to create sysfs for idle_delay_auto\n");
+}
+
+static void ufshcd_exit_idle_gaps(struct ufs_hba *hba)
+{
+	if (!ufshcd_is_clkgating_allowed(hba) &&
+	    !ufshcd_is_hibern8_on_idle_allowed(hba))
+		return;
+	device_remove_file(hba->dev, &hba->idle_gaps.auto_attr);
+}
+
 #ifdef CONFIG_SMP
 
 /* Host lock is assumed to be held by caller */
@@ -1865,6 +2106,107 @@ static void ufshcd_release_all(struct ufs_hba *hba)
 	ufshcd_release(hba, false);
 }
 
+/*
+ * Foreground requests are the ones someone waits on: reads and sync
+ * writes, unless the idle class asked to be served last. Background
+ * writeback is async and leaves the scaling to the load. ROW's urgent
+ * requests and the RT class always count.
+ */
+static bool ufshcd_is_fg_req(struct request *rq)
+{
+	int class;
+
+	if (!rq || !(rq->cmd_type & REQ_TYPE_FS))
+		return false;
+	if (rq->cmd_flags & REQ_URGENT)
+		return true;
+
+	class = IOPRIO_PRIO_CLASS(req_get_ioprio(rq));
+	if (class == IOPRIO_CLASS_RT)
+		return true;
+	return rq_is_sync(rq) && class != IOPRIO_CLASS_IDLE;
+}
+
+/* Must be called with host lock acquired */
+static void ufshcd_clk_scaling_boost(struct ufs_hba *hba,
+				     struct ufshcd_lrb *lrbp)
+{
+	struct ufs_clk_scaling *scaling = &hba->clk_scaling;
+
+	if (!ufshcd_is_clkscaling_supported(hba) || !scaling->is_allowed)
+		return;
+	if (scaling->is_scaled_up || scaling->boost)
+		return;
+	if (!lrbp->cmd || !ufshcd_is_fg_req(lrbp->cmd->request))
+		return;
+
+	/* don't wait for the next polling window to raise the clocks */
+	scaling->boost = true;
+	scaling->stats.boosts++;
+	schedule_work(&scaling->boost_work);
+}
+
+static void ufshcd_clk_scaling_boost_work(struct work_struct *work)
+{
+	struct ufs_hba *hba = container_of(work, struct ufs_hba,
+					   clk_scaling.boost_work);
+
+	mutex_lock(&hba->devfreq->lock);
+	update_devfreq(hba->devfreq);
+	mutex_unlock(&hba->devfreq->lock);
+}
+
+/*
+ * Must be called with host lock acquired. Foreground completions feed a
+ * running average of their gaps: while they keep coming at that pace, a
+ * burst is in progress and the clocks should stay up.
+ */
+static void ufshcd_clk_scaling_update_fg(struct ufs_hba *hba,
+					 struct ufshcd_lrb *lrbp)
+{
+	struct ufs_clk_scaling *scaling = &hba->clk_scaling;
+	s64 gap;
+
+	if (!ufshcd_is_clkscaling_supported(hba))
+		return;
+	if (!lrbp->cmd || !ufshcd_is_fg_req(lrbp->cmd->request))
+		return;
+
+	if (scaling->last_fg_t.tv64) {
+		gap = ktime_us_delta(lrbp->complete_time_stamp,
+				     scaling->last_fg_t);
+		gap = clamp_t(s64, gap, 0, scaling->hold_max_ms * USEC_PER_MSEC);
+		if (scaling->fg_gap_us)
+			gap = (scaling->fg_gap_us * 7 + gap) >> 3;
+		scaling->fg_gap_us = gap;
+	}
+	scaling->last_fg_t = lrbp->complete_time_stamp;
+}
+
+/*
+ * Keep the clocks up for a few average foreground gaps after the last
+ * foreground completion, at most hold_max_ms: a burst that pauses for
+ * less than that would otherwise find the clocks down when it resumes.
+ */
+static bool ufshcd_clk_scaling_hold(struct ufs_hba *hba)
+{
+	struct ufs_clk_scaling *scaling = &hba->clk_scaling;
+	unsigned long flags;
+	bool ret = false;
+	s64 hold;
+
+	spin_lock_irqsave(hba->host->host_lock, flags);
+	if (scaling->last_fg_t.tv64) {
+		hold = min_t(s64,
+			     UFSHCD_CLKSCALE_HOLD_GAPS * scaling->fg_gap_us,
+			     scaling->hold_max_ms * USEC_PER_MSEC);
+		ret = ktime_us_delta(ktime_get(), scaling->last_fg_t) < hold;
+	}
+	spin_unlock_irqrestore(hba->host->host_lock, flags);
+
+	return ret;
+}
+
 /* Must be called with host lock acquired */
 static void ufshcd_clk_scaling_start_busy(struct ufs_hba *hba)
 {
@@ -1892,6 +2234,18 @@ static void ufshcd_clk_scaling_update_busy(struct ufs_hba *hba)
 	}
 }
 
+/**
+ * ufshcd_crypto_engine_cfg_end - let the crypto engine release a request
+ * @hba: per adapter instance
+ * @task_tag: Task tag of the command, before its lrb is cleared
+ */
+static inline
+void ufshcd_crypto_engine_cfg_end(struct ufs_hba *hba, unsigned int task_tag)
+{
+	if (hba->vops && hba->vops->crypto_engine_cfg_end)
+		hba->vops->crypto_engine_cfg_end(hba, task_tag);
+}
+
 /**
  * ufshcd_send_command - Send SCSI or device management commands
  * @hba: per adapter instance
@@ -1905,9 +2259,10 @@ int ufshcd_send_command(struct ufs_hba *hba, unsigned int task_tag)
 	if (hba->vops && hba->vops->crypto_engine_cfg) {
 		ret = hba->vops->crypto_engine_cfg(hba, task_tag);
 		if (ret) {
-			dev_err(hba->dev,
-				"%s: failed to configure crypto engine %d\n",
-				__func__, ret);
+			if (ret != -EAGAIN)
+				dev_err(hba->dev,
+					"%s: failed to configure crypto engine %d\n",
+					__func__, ret);
 			return ret;
 		}
 	}
@@ -1915,6 +2270,7 @@ int ufshcd_send_command(struct ufs_hba *hba, unsigned int task_tag)
 	hba->lrb[task_tag].issue_time_stamp = ktime_get();
 	hba->lrb[task_tag].complete_time_stamp = ktime_set(0, 0);
 	ufshcd_clk_scaling_start_busy(hba);
+	ufshcd_clk_scaling_boost(hba, &hba->lrb[task_tag]);
 	__set_bit(task_tag, &hba->outstanding_reqs);
 	ufshcd_writel(hba, 1 << task_tag, REG_UTP_TRANSFER_REQ_DOOR_BELL);
 	/* Make sure that doorbell is committed immediately */
@@ -2498,7 +2854,7 @@ static int ufshcd_queuecommand(struct Scsi_Host *host, struct scsi_cmnd *cmd)
 	lrbp->sense_buffer = cmd->sense_buffer;
 	lrbp->task_tag = tag;
 	lrbp->lun = ufshcd_scsi_to_upiu_lun(cmd->device->lun);
-	lrbp->intr_cmd = !ufshcd_is_intr_aggr_allowed(hba) ? true : false;
+	lrbp->intr_cmd = !ufshcd_use_intr_aggr(hba);
 	lrbp->command_type = UTP_CMD_TYPE_SCSI;
 	lrbp->req_abort_skip = false;
 
@@ -2517,6 +2873,11 @@ static int ufshcd_queuecommand(struct Scsi_Host *host, struct scsi_cmnd *cmd)
 	/* issue command to the controller */
 	spin_lock_irqsave(hba->host->host_lock, flags);
 
+	if (lrbp->intr_cmd)
+		hba->intr_aggr.immediate_reqs++;
+	else
+		hba->intr_aggr.aggr_reqs++;
+
 	err = ufshcd_send_command(hba, tag);
 	if (err) {
 		spin_unlock_irqrestore(hba->host->host_lock, flags);
@@ -2524,6 +2885,11 @@ static int ufshcd_queuecommand(struct Scsi_Host *host, struct scsi_cmnd *cmd)
 		lrbp->cmd = NULL;
 		clear_bit_unlock(tag, &hba->lrb_in_use);
 		ufshcd_release_all(hba);
+		/* crypto engine key slots all busy, retry after completions */
+		if (err == -EAGAIN) {
+			err = SCSI_MLQUEUE_HOST_BUSY;
+			goto out;
+		}
 		dev_err(hba->dev, "%s: failed sending command, %d\n",
 							__func__, err);
 		err = DID_ERROR;
@@ -4092,7 +4458,8 @@ static int ufshcd_make_hba_operational(struct ufs_hba *hba)
 
 	/* Configure interrupt aggregation */
 	if (ufshcd_is_intr_aggr_allowed(hba))
-		ufshcd_config_intr_aggr(hba, hba->nutrs - 1, INT_AGGR_DEF_TO);
+		ufshcd_config_intr_aggr(hba, hba->intr_aggr.counter,
+					hba->intr_aggr.timeout);
 	else
 		ufshcd_disable_intr_aggr(hba);
 
@@ -4503,11 +4870,24 @@ static int ufshcd_slave_alloc(struct scsi_device *sdev)
  */
 static int ufshcd_slave_configure(struct scsi_device *sdev)
 {
+	struct ufs_hba *hba = shost_priv(sdev->host);
 	struct request_queue *q = sdev->request_queue;
 
 	blk_queue_update_dma_pad(q, PRDT_DATA_BYTE_COUNT_PAD - 1);
 	blk_queue_max_segment_size(q, PRDT_DATA_BYTE_COUNT_MAX);
 
+	/*
+	 * UFS is flash: don't wait for sd to read the rotation rate from
+	 * the characteristics VPD page, and don't feed the entropy pool
+	 * from completion timings that have little randomness in them.
+	 * QUEUE_FLAG_SAME_COMP is left on, so completions already run on
+	 * the cluster of the submitting cpu rather than the irq cpu.
+	 */
+	queue_flag_set_unlocked(QUEUE_FLAG_NONROT, q);
+	queue_flag_clear_unlocked(QUEUE_FLAG_ADD_RANDOM, q);
+	if (ufshcd_can_inline_crypt(hba))
+		queue_flag_set_unlocked(QUEUE_FLAG_INLINE_CRYPT, q);
+
 	sdev->autosuspend_delay = UFSHCD_AUTO_SUSPEND_DELAY_MS;
 	sdev->use_rpm_auto = 1;
 
@@ -4783,6 +5163,7 @@ void ufshcd_abort_outstanding_transfer_requests(struct ufs_hba *hba, int result)
 			clear_bit_unlock(index, &hba->lrb_in_use);
 			lrbp->complete_time_stamp = ktime_get();
 			update_req_stats(hba, lrbp);
+			ufshcd_crypto_engine_cfg_end(hba, index);
 			/* Mark completed command as NULL in LRB */
 			lrbp->cmd = NULL;
 			/* Do not touch lrbp after scsi done */
@@ -4824,6 +5205,8 @@ static void __ufshcd_transfer_req_compl(struct ufs_hba *hba,
 			clear_bit_unlock(index, &hba->lrb_in_use);
 			lrbp->complete_time_stamp = ktime_get();
 			update_req_stats(hba, lrbp);
+			ufshcd_clk_scaling_update_fg(hba, lrbp);
+			ufshcd_crypto_engine_cfg_end(hba, index);
 			/* Mark completed command as NULL in LRB */
 			lrbp->cmd = NULL;
 			/* Do not touch lrbp after scsi done */
@@ -4871,6 +5254,15 @@ static void ufshcd_transfer_req_compl(struct ufs_hba *hba)
 	tr_doorbell = ufshcd_readl(hba, REG_UTP_TRANSFER_REQ_DOOR_BELL);
 	completed_reqs = tr_doorbell ^ hba->outstanding_reqs;
 
+	if (completed_reqs) {
+		u32 nr = hweight_long(completed_reqs);
+
+		hba->intr_aggr.irqs++;
+		hba->intr_aggr.completions += nr;
+		if (nr > hba->intr_aggr.max_completions)
+			hba->intr_aggr.max_completions = nr;
+	}
+
 	__ufshcd_transfer_req_compl(hba, completed_reqs);
 }
 
@@ -5915,6 +6307,7 @@ static int ufshcd_abort(struct scsi_cmnd *cmd)
 
 	spin_lock_irqsave(host->host_lock, flags);
 	ufshcd_outstanding_req_clear(hba, tag);
+	ufshcd_crypto_engine_cfg_end(hba, tag);
 	hba->lrb[tag].cmd = NULL;
 	spin_unlock_irqrestore(host->host_lock, flags);
 
@@ -7990,6 +8383,7 @@ void ufshcd_remove(struct ufs_hba *hba)
 
 	ufshcd_exit_clk_gating(hba);
 	ufshcd_exit_hibern8_on_idle(hba);
+	ufshcd_exit_idle_gaps(hba);
 	if (ufshcd_is_clkscaling_supported(hba)) {
 		device_remove_file(hba->dev, &hba->clk_scaling.enable_attr);
 		devfreq_remove_device(hba->devfreq);
@@ -8130,6 +8524,18 @@ static int ufshcd_scale_clks(struct ufs_hba *hba, bool scale_up)
 
 	if (clk_state_changed && hba->vops && hba->vops->clk_scale_notify)
 		hba->vops->clk_scale_notify(hba);
+
+	if (!ret) {
+		spin_lock_irqsave(hba->host->host_lock, flags);
+		if (clk_state_changed) {
+			if (scale_up)
+				hba->clk_scaling.stats.ups++;
+			else
+				hba->clk_scaling.stats.downs++;
+		}
+		hba->clk_scaling.is_scaled_up = scale_up;
+		spin_unlock_irqrestore(hba->host->host_lock, flags);
+	}
 out:
 	if (clk_state_changed)
 		trace_ufshcd_profile_clk_scaling(dev_name(hba->dev),
@@ -8143,6 +8549,7 @@ static void ufshcd_suspend_clkscaling(struct ufs_hba *hba)
 	if (!ufshcd_is_clkscaling_supported(hba))
 		return;
 
+	cancel_work_sync(&hba->clk_scaling.boost_work);
 	devfreq_suspend_device(hba->devfreq);
 	hba->clk_scaling.window_start_t = 0;
 }
@@ -8203,10 +8610,17 @@ static int ufshcd_devfreq_target(struct device *dev,
 	if (!ufshcd_is_clkscaling_supported(hba))
 		return -EINVAL;
 
-	if (*freq == UINT_MAX)
+	if (*freq == UINT_MAX) {
 		err = ufshcd_scale_clks(hba, true);
-	else if (*freq == 0)
-		err = ufshcd_scale_clks(hba, false);
+	} else if (*freq == 0) {
+		if (hba->clk_scaling.is_scaled_up &&
+		    ufshcd_clk_scaling_hold(hba)) {
+			hba->clk_scaling.stats.downs_deferred++;
+			*freq = UINT_MAX;
+		} else {
+			err = ufshcd_scale_clks(hba, false);
+		}
+	}
 
 	return err;
 }
@@ -8235,6 +8649,13 @@ static int ufshcd_devfreq_get_dev_status(struct device *dev,
 				(long)scaling->window_start_t);
 	stat->busy_time = scaling->tot_busy_t;
 start_window:
+	/* a foreground request is waiting: look fully busy */
+	if (scaling->boost) {
+		scaling->boost = false;
+		stat->total_time = max_t(unsigned long, stat->total_time, 1);
+		stat->busy_time = stat->total_time;
+	}
+
 	scaling->window_start_t = jiffies;
 	scaling->tot_busy_t = 0;
 
@@ -8307,6 +8728,11 @@ int ufshcd_init(struct ufs_hba *hba, void __iomem *mmio_base, unsigned int irq)
 	/* Read capabilities registers */
 	ufshcd_hba_capabilities(hba);
 
+	/* Aggregate up to a full doorbell, the timeout caps the latency */
+	hba->intr_aggr.qd_threshold = INT_AGGR_DEF_QD;
+	hba->intr_aggr.counter = hba->nutrs - 1;
+	hba->intr_aggr.timeout = INT_AGGR_DEF_TO;
+
 	/* Get UFS version supported by the controller */
 	hba->ufs_version = ufshcd_get_ufs_version(hba);
 
@@ -8358,6 +8784,9 @@ int ufshcd_init(struct ufs_hba *hba, void __iomem *mmio_base, unsigned int irq)
 	/* Initialize work queues */
 	INIT_WORK(&hba->eh_work, ufshcd_err_handler);
 	INIT_WORK(&hba->eeh_work, ufshcd_exception_event_handler);
+	INIT_WORK(&hba->clk_scaling.boost_work, ufshcd_clk_scaling_boost_work);
+	hba->clk_scaling.is_scaled_up = true;
+	hba->clk_scaling.hold_max_ms = UFSHCD_CLKSCALE_HOLD_MAX_MS;
 
 	/* Initialize UIC command mutex */
 	mutex_init(&hba->uic_cmd_mutex);
@@ -8370,6 +8799,7 @@ int ufshcd_init(struct ufs_hba *hba, void __iomem *mmio_base, unsigned int irq)
 
 	ufshcd_init_clk_gating(hba);
 	ufshcd_init_hibern8_on_idle(hba);
+	ufshcd_init_idle_gaps(hba);
 
 	/*
 	 * In order to avoid any spurious interrupt immediately after
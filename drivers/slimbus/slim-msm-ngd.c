@@ -660,6 +660,55 @@ ngd_xfer_err:
 	return ret ? ret : dev->err;
 }
 
+/*
+ * With the BAM TX message queue, value element writes that carry a
+ * completion are queued without waiting for TX done. The whole batch
+ * shares one completion that is awaited once per message at the end,
+ * so the messages go out back to back.
+ */
+static int ngd_bulk_msg(struct slim_controller *ctrl,
+			struct slim_msg_txn *txns, int n)
+{
+	DECLARE_COMPLETION_ONSTACK(done);
+	struct msm_slim_ctrl *dev = slim_get_ctrldata(ctrl);
+	bool async = dev->use_tx_msgqs == MSM_MSGQ_ENABLED;
+	int i, queued = 0;
+	int ret = 0;
+
+	for (i = 0; i < n; i++) {
+		txns[i].comp = async ? &done : NULL;
+		ret = ngd_xfer_msg(ctrl, &txns[i]);
+		if (ret)
+			break;
+		queued++;
+	}
+
+	for (i = 0; i < queued; i++) {
+		if (!wait_for_completion_timeout(&done, HZ)) {
+			SLIM_WARN(dev, "bulk write timeout: %d of %d sent\n",
+					i, queued);
+			ret = -ETIMEDOUT;
+			break;
+		}
+	}
+
+	if (ret == -ETIMEDOUT) {
+		/* Don't let a late TX done complete our stack */
+		mutex_lock(&dev->tx_buf_lock);
+		for (i = 0; i < MSM_TX_BUFS; i++) {
+			if (dev->wr_comp[i] == &done)
+				dev->wr_comp[i] = NULL;
+		}
+		mutex_unlock(&dev->tx_buf_lock);
+	}
+
+	if (!ret)
+		ret = dev->err;
+	if (ret)
+		SLIM_ERR(dev, "bulk write of %d msgs failed:%d\n", n, ret);
+	return ret;
+}
+
 static int ngd_user_msg(struct slim_controller *ctrl, u8 la, u8 mt, u8 mc,
 				struct slim_ele_access *msg, u8 *buf, u8 len)
 {
@@ -1467,6 +1516,7 @@ static int ngd_slim_probe(struct platform_device *pdev)
 	dev->ctrl.allocbw = ngd_allocbw;
 	dev->ctrl.xfer_msg = ngd_xfer_msg;
 	dev->ctrl.xfer_user_msg = ngd_user_msg;
+	dev->ctrl.xfer_bulk_msg = ngd_bulk_msg;
 	dev->ctrl.wakeup = NULL;
 	dev->ctrl.alloc_port = msm_alloc_port;
 	dev->ctrl.dealloc_port = msm_dealloc_port;
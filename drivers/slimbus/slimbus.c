@@ -1008,6 +1008,64 @@ int slim_request_clear_inf_element(struct slim_device *sb,
 }
 EXPORT_SYMBOL_GPL(slim_request_clear_inf_element);
 
+int slim_bulk_change_val_element(struct slim_device *sb,
+				struct slim_val_inf *msgs, int n)
+{
+	struct slim_controller *ctrl = sb->ctrl;
+	struct slim_msg_txn *txns;
+	int i, ret;
+
+	if (!ctrl || !msgs || n <= 0)
+		return -EINVAL;
+
+	if (!ctrl->xfer_bulk_msg) {
+		for (i = 0; i < n; i++) {
+			struct slim_ele_access msg = {
+				.start_offset = msgs[i].start_offset,
+				.num_bytes = msgs[i].num_bytes,
+			};
+
+			ret = slim_change_val_element(sb, &msg, msgs[i].wbuf,
+						msgs[i].num_bytes);
+			if (ret)
+				return ret;
+		}
+		return 0;
+	}
+
+	txns = kcalloc(n, sizeof(*txns), GFP_KERNEL);
+	if (!txns)
+		return -ENOMEM;
+
+	for (i = 0; i < n; i++) {
+		struct slim_ele_access msg = {
+			.start_offset = msgs[i].start_offset,
+			.num_bytes = msgs[i].num_bytes,
+		};
+		DEFINE_SLIM_LDEST_TXN(txn, SLIM_MSG_MC_CHANGE_VALUE,
+				msgs[i].num_bytes, 6, NULL, msgs[i].wbuf,
+				sb->laddr);
+		u16 sl;
+
+		ret = slim_ele_access_sanity(&msg, SLIM_MSG_MC_CHANGE_VALUE,
+					NULL, msgs[i].wbuf, msgs[i].num_bytes);
+		if (ret)
+			goto bulk_err;
+
+		sl = slim_slicesize(msgs[i].num_bytes);
+		txn.ec = ((sl | (1 << 3)) |
+				((msgs[i].start_offset & 0xFFF) << 4));
+		txn.rl += msgs[i].num_bytes;
+		txns[i] = txn;
+	}
+
+	ret = ctrl->xfer_bulk_msg(ctrl, txns, n);
+bulk_err:
+	kfree(txns);
+	return ret;
+}
+EXPORT_SYMBOL_GPL(slim_bulk_change_val_element);
+
 /*
  * Broadcast message API:
  * call this API directly with sbdev = NULL.
@@ -33,6 +33,14 @@
 #define MEM_SHARE_SERVICE_INS_ID 1
 #define MEM_SHARE_SERVICE_VERS 1
 
+/*
+ * Blocks of on request clients are kept for this long after the
+ * peripheral frees them, so that a quick re-request reuses the block
+ * instead of another CMA allocation. 0 releases them immediately.
+ */
+static unsigned int release_delay_ms = 30000;
+module_param(release_delay_ms, uint, S_IRUGO | S_IWUSR);
+
 static struct qmi_handle *mem_share_svc_handle;
 static void mem_share_svc_recv_msg(struct work_struct *work);
 static DECLARE_DELAYED_WORK(work_recv_msg, mem_share_svc_recv_msg);
@@ -44,6 +52,7 @@ struct memshare_driver {
 	struct mutex mem_share;
 	struct mutex mem_free;
 	struct work_struct memshare_init_work;
+	struct delayed_work release_work;
 };
 
 struct memshare_child {
@@ -144,12 +153,45 @@ void free_client(int id)
 	memblock[id].alloted = 0;
 	memblock[id].client_id = DHMS_MEM_CLIENT_INVALID;
 	memblock[id].guarantee = 0;
+	memblock[id].on_request = 0;
 	memblock[id].peripheral = -1;
 	memblock[id].sequence_id = -1;
 	memblock[id].memory_type = MEMORY_CMA;
 
 }
 
+/*
+ * Return the block of an on request client to CMA, keeping the client
+ * registered so that its next request allocates again.
+ */
+static void release_client_mem(int id)
+{
+	if (!memblock[id].virtual_addr)
+		return;
+
+	pr_debug("memshare: releasing %d bytes of client id: %d\n",
+			memblock[id].size, memblock[id].client_id);
+	dma_free_coherent(memsh_drv->dev, memblock[id].size,
+		memblock[id].virtual_addr, memblock[id].phy_addr);
+	memblock[id].virtual_addr = 0;
+	memblock[id].phy_addr = 0;
+	memblock[id].alloted = 0;
+}
+
+static void memshare_release_worker(struct work_struct *work)
+{
+	int i;
+
+	mutex_lock(&memsh_drv->mem_free);
+	mutex_lock(&memsh_drv->mem_share);
+	for (i = 0; i < MAX_CLIENTS; i++) {
+		if (memblock[i].on_request && !memblock[i].alloted)
+			release_client_mem(i);
+	}
+	mutex_unlock(&memsh_drv->mem_share);
+	mutex_unlock(&memsh_drv->mem_free);
+}
+
 void free_mem_clients(int proc)
 {
 	int i;
@@ -157,8 +199,11 @@ void free_mem_clients(int proc)
 	pr_debug("memshare: freeing clients\n");
 
 	for (i = 0; i < MAX_CLIENTS; i++) {
-		if (memblock[i].peripheral == proc &&
-				!memblock[i].guarantee) {
+		if (memblock[i].peripheral != proc)
+			continue;
+		if (memblock[i].on_request) {
+			release_client_mem(i);
+		} else if (!memblock[i].guarantee) {
 			pr_debug("Freeing memory for client id: %d\n",
 					memblock[i].client_id);
 			dma_free_coherent(memsh_drv->dev, memblock[i].size,
@@ -195,6 +240,7 @@ void initialize_client(void)
 		memblock[i].alloted = 0;
 		memblock[i].size = 0;
 		memblock[i].guarantee = 0;
+		memblock[i].on_request = 0;
 		memblock[i].phy_addr = 0;
 		memblock[i].virtual_addr = 0;
 		memblock[i].client_id = DHMS_MEM_CLIENT_INVALID;
@@ -298,6 +344,14 @@ static int handle_alloc_generic_req(void *req_h, void *req)
 			alloc_req->client_id, alloc_req->proc_id);
 	client_id = check_client(alloc_req->client_id, alloc_req->proc_id,
 								CHECK);
+	if (memblock[client_id].on_request && !memblock[client_id].alloted &&
+			memblock[client_id].virtual_addr) {
+		/* Block kept after the last free is still pending release */
+		if (memblock[client_id].size >= alloc_req->num_bytes)
+			memblock[client_id].alloted = 1;
+		else
+			release_client_mem(client_id);
+	}
 	if (!memblock[client_id].alloted) {
 		rc = memshare_alloc(memsh_drv->dev, alloc_req->num_bytes,
 					&memblock[client_id]);
@@ -386,6 +440,17 @@ static int handle_free_generic_req(void *req_h, void *req)
 		pr_err("In %s, Invalid client request to free memory\n",
 					__func__);
 		flag = 1;
+	} else if (memblock[client_id].on_request) {
+		/*
+		 * The peripheral no longer uses the block: return it to CMA
+		 * once it has stayed unused for release_delay_ms.
+		 */
+		memblock[client_id].alloted = 0;
+		if (!release_delay_ms)
+			release_client_mem(client_id);
+		else
+			mod_delayed_work(system_wq, &memsh_drv->release_work,
+					msecs_to_jiffies(release_delay_ms));
 	} else if (!memblock[client_id].guarantee &&
 					memblock[client_id].alloted) {
 		pr_debug("In %s: pblk->virtual_addr :%lx, pblk->phy_addr: %lx\n,size: %d",
@@ -649,6 +714,17 @@ static int memshare_child_probe(struct platform_device *pdev)
 	memblock[num_clients].client_id = client_table[num_clients];
 	memblock[num_clients].guarantee = 1;
 
+	/*
+	 * Clients that can wait for the allocation at request time are
+	 * served from CMA when they ask for it, and may free it again.
+	 */
+	if (of_property_read_bool(pdev->dev.of_node,
+					"qcom,allocate-on-request")) {
+		memblock[num_clients].on_request = 1;
+		num_clients++;
+		return 0;
+	}
+
 	rc = memshare_alloc(memsh_child->dev, memblock[num_clients].size,
 					&memblock[num_clients]);
 	if (rc) {
@@ -681,6 +757,7 @@ static int memshare_probe(struct platform_device *pdev)
 
 	INIT_WORK(&drv->memshare_init_work, memshare_init_worker);
 	schedule_work(&drv->memshare_init_work);
+	INIT_DELAYED_WORK(&drv->release_work, memshare_release_worker);
 
 	drv->dev = &pdev->dev;
 	memsh_drv = drv;
@@ -709,6 +786,7 @@ static int memshare_remove(struct platform_device *pdev)
 	flush_workqueue(mem_share_svc_workqueue);
 	qmi_handle_destroy(mem_share_svc_handle);
 	destroy_workqueue(mem_share_svc_workqueue);
+	cancel_delayed_work_sync(&memsh_drv->release_work);
 
 	return 0;
 }
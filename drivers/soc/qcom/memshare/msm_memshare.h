@@ -41,6 +41,8 @@ struct mem_blocks {
 	uint32_t guarantee;
 	/* Memory alloted or not */
 	uint32_t alloted;
+	/* Guaranteed client allocated on its first request, not at boot */
+	uint32_t on_request;
 	/* Size required for client */
 	uint32_t size;
 	/* start address of the memory block reserved by server memory
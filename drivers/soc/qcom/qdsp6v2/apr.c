@@ -267,7 +267,7 @@ int apr_send_pkt(void *handle, uint32_t *buf)
 	uint16_t dest_id;
 	uint16_t client_id;
 	uint16_t w_len;
-	unsigned long flags;
+	struct apr_svc_ch_dev *ch;
 
 	if (!handle || !buf) {
 		pr_err("APR: Wrong parameters\n");
@@ -288,14 +288,19 @@ int apr_send_pkt(void *handle, uint32_t *buf)
 		return -ENETRESET;
 	}
 
-	spin_lock_irqsave(&svc->w_lock, flags);
+	/*
+	 * The channel serializes the writes, holding a lock with interrupts
+	 * off here as well would keep them off for as long as the channel
+	 * stays full. The channel devices are static, a handle that is being
+	 * closed makes apr_tal_write() fail.
+	 */
 	dest_id = svc->dest_id;
 	client_id = svc->client_id;
 	clnt = &client[dest_id][client_id];
 
-	if (!client[dest_id][client_id].handle) {
+	ch = ACCESS_ONCE(clnt->handle);
+	if (!ch) {
 		pr_err("APR: Still service is not yet opened\n");
-		spin_unlock_irqrestore(&svc->w_lock, flags);
 		return -EINVAL;
 	}
 	hdr = (struct apr_hdr *)buf;
@@ -305,10 +310,9 @@ int apr_send_pkt(void *handle, uint32_t *buf)
 	hdr->dest_domain = svc->dest_domain;
 	hdr->dest_svc = svc->id;
 
-	w_len = apr_tal_write(clnt->handle, buf, hdr->pkt_size);
+	w_len = apr_tal_write(ch, buf, hdr->pkt_size);
 	if (w_len != hdr->pkt_size)
 		pr_err("Unable to write APR pkt successfully: %d\n", w_len);
-	spin_unlock_irqrestore(&svc->w_lock, flags);
 
 	return w_len;
 }
@@ -396,6 +400,9 @@ struct apr_svc *apr_register(char *dest, char *svc_name, apr_fn svc_fn,
 	svc->dest_id = dest_id;
 	svc->client_id = client_id;
 	svc->dest_domain = domain_id;
+	/* Publish the service to apr_cb_func() once it is filled in */
+	smp_wmb();
+	ACCESS_ONCE(clnt->svc_map[svc_id]) = svc;
 	if (src_port != 0xFFFFFFFF) {
 		temp_port = ((src_port >> 8) * 8) + (src_port & 0xFF);
 		pr_debug("port = %d t_port = %d\n", src_port, temp_port);
@@ -438,17 +445,11 @@ void apr_cb_func(void *buf, int len, void *priv)
 	uint16_t src;
 	uint16_t svc;
 	uint16_t clnt;
-	int i;
 	int temp_port = 0;
-	uint32_t *ptr;
 
 	pr_debug("APR2: len = %d\n", len);
-	ptr = buf;
-	pr_debug("\n*****************\n");
-	for (i = 0; i < len/4; i++)
-		pr_debug("%x  ", ptr[i]);
-	pr_debug("\n");
-	pr_debug("\n*****************\n");
+	print_hex_dump_debug("APR2: ", DUMP_PREFIX_OFFSET, 16, 4, buf,
+			len, false);
 
 	if (!buf || len <= APR_HDR_SIZE) {
 		pr_err("APR: Improper apr pkt received:%pK %d\n", buf, len);
@@ -531,18 +532,12 @@ void apr_cb_func(void *buf, int len, void *priv)
 
 	pr_debug("src =%d clnt = %d\n", src, clnt);
 	apr_client = &client[src][clnt];
-	for (i = 0; i < APR_SVC_MAX; i++)
-		if (apr_client->svc[i].id == svc) {
-			pr_debug("%d\n", apr_client->svc[i].id);
-			c_svc = &apr_client->svc[i];
-			break;
-		}
-
-	if (i == APR_SVC_MAX) {
+	c_svc = ACCESS_ONCE(apr_client->svc_map[svc]);
+	if (!c_svc) {
 		pr_err("APR: service is not registered\n");
 		return;
 	}
-	pr_debug("svc_idx = %d\n", i);
+	smp_rmb();
 	pr_debug("%x %x %x %pK %pK\n", c_svc->id, c_svc->dest_id,
 		 c_svc->client_id, c_svc->fn, c_svc->priv);
 	data.payload_size = hdr->pkt_size - hdr_size;
@@ -645,6 +640,8 @@ int apr_deregister(void *handle)
 	}
 
 	if (!svc->port_cnt && !svc->svc_cnt) {
+		if (clnt->svc_map[svc->id] == svc)
+			ACCESS_ONCE(clnt->svc_map[svc->id]) = NULL;
 		svc->priv = NULL;
 		svc->id = 0;
 		svc->fn = NULL;
@@ -856,7 +853,6 @@ static int __init apr_init(void)
 			mutex_init(&client[i][j].m_lock);
 			for (k = 0; k < APR_SVC_MAX; k++) {
 				mutex_init(&client[i][j].svc[k].m_lock);
-				spin_lock_init(&client[i][j].svc[k].w_lock);
 			}
 		}
 	apr_set_subsys_state();
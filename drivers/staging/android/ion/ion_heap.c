@@ -57,7 +57,7 @@ void *ion_heap_map_kernel(struct ion_heap *heap,
 		for (j = 0; j < npages_this_entry; j++)
 			*(tmp++) = page++;
 	}
-	vaddr = vmap(pages, npages, VM_MAP, pgprot);
+	vaddr = vm_map_ram(pages, npages, -1, pgprot);
 	vfree(pages);
 
 	if (vaddr == NULL)
@@ -69,7 +69,7 @@ void *ion_heap_map_kernel(struct ion_heap *heap,
 void ion_heap_unmap_kernel(struct ion_heap *heap,
 			   struct ion_buffer *buffer)
 {
-	vunmap(buffer->vaddr);
+	vm_unmap_ram(buffer->vaddr, PAGE_ALIGN(buffer->size) / PAGE_SIZE);
 }
 
 int ion_heap_map_user(struct ion_heap *heap, struct ion_buffer *buffer,
@@ -0,0 +1,150 @@
+/*
+ * drivers/staging/android/ion/ion_kbench.c
+ *
+ * Copyright (C) 2016 HTC Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * ion allocation benchmark. Every operation allocates size bytes from
+ * the heap with id target with flags n, and frees them again. mode picks
+ * what is timed: alloc, free, or both (alloc_free).
+ */
+
+#include <linux/err.h>
+#include <linux/kbench.h>
+#include <linux/module.h>
+#include <linux/msm_ion.h>
+#include <linux/string.h>
+
+#include "ion.h"
+
+enum {
+	ION_KBENCH_ALLOC,
+	ION_KBENCH_FREE,
+	ION_KBENCH_ALLOC_FREE,
+};
+
+struct ion_kbench {
+	struct ion_client *client;
+	struct ion_handle *handle;
+	unsigned int heap_mask;
+	int mode;
+};
+
+static struct ion_kbench ion_kbench_state;
+
+static int ion_kbench_alloc(struct kbench_ctx *ctx)
+{
+	struct ion_kbench *ib = ctx->priv;
+
+	/* n defaults to 1, which is ION_FLAG_CACHED */
+	ib->handle = ion_alloc(ib->client, ctx->size, PAGE_SIZE, ib->heap_mask,
+			       ctx->n);
+	if (IS_ERR_OR_NULL(ib->handle)) {
+		int ret = ib->handle ? PTR_ERR(ib->handle) : -ENOMEM;
+
+		ib->handle = NULL;
+		return ret;
+	}
+	return 0;
+}
+
+static void ion_kbench_free(struct kbench_ctx *ctx)
+{
+	struct ion_kbench *ib = ctx->priv;
+
+	if (ib->handle)
+		ion_free(ib->client, ib->handle);
+	ib->handle = NULL;
+}
+
+static int ion_kbench_setup(struct kbench_ctx *ctx)
+{
+	struct ion_kbench *ib = &ion_kbench_state;
+	unsigned int heap_id = ION_SYSTEM_HEAP_ID;
+	int ret;
+
+	if (!ctx->mode[0] || !strcmp(ctx->mode, "alloc"))
+		ib->mode = ION_KBENCH_ALLOC;
+	else if (!strcmp(ctx->mode, "free"))
+		ib->mode = ION_KBENCH_FREE;
+	else if (!strcmp(ctx->mode, "alloc_free"))
+		ib->mode = ION_KBENCH_ALLOC_FREE;
+	else
+		return -EINVAL;
+
+	if (ctx->target[0]) {
+		ret = kstrtouint(ctx->target, 0, &heap_id);
+		if (ret)
+			return ret;
+	}
+	if (heap_id >= 32 || !ctx->size)
+		return -EINVAL;
+	ib->heap_mask = ION_HEAP(heap_id);
+
+	ib->client = msm_ion_client_create("kbench");
+	if (IS_ERR_OR_NULL(ib->client))
+		return ib->client ? PTR_ERR(ib->client) : -ENODEV;
+
+	ib->handle = NULL;
+	ctx->bytes = ctx->size;
+	ctx->priv = ib;
+	return 0;
+}
+
+static int ion_kbench_prepare(struct kbench_ctx *ctx, unsigned int i)
+{
+	struct ion_kbench *ib = ctx->priv;
+
+	if (ib->mode == ION_KBENCH_FREE)
+		return ion_kbench_alloc(ctx);
+	return 0;
+}
+
+static int ion_kbench_op(struct kbench_ctx *ctx, unsigned int i)
+{
+	struct ion_kbench *ib = ctx->priv;
+	int ret = 0;
+
+	if (ib->mode != ION_KBENCH_FREE)
+		ret = ion_kbench_alloc(ctx);
+	if (!ret && ib->mode != ION_KBENCH_ALLOC)
+		ion_kbench_free(ctx);
+	return ret;
+}
+
+static void ion_kbench_post(struct kbench_ctx *ctx, unsigned int i)
+{
+	ion_kbench_free(ctx);
+}
+
+static void ion_kbench_teardown(struct kbench_ctx *ctx)
+{
+	struct ion_kbench *ib = ctx->priv;
+
+	ion_kbench_free(ctx);
+	ion_client_destroy(ib->client);
+}
+
+static struct kbench ion_kbench = {
+	.name		= "ion",
+	.help		= "mode=alloc|free|alloc_free target=heap id size=bytes n=flags",
+	.setup		= ion_kbench_setup,
+	.prepare	= ion_kbench_prepare,
+	.op		= ion_kbench_op,
+	.post		= ion_kbench_post,
+	.teardown	= ion_kbench_teardown,
+};
+
+static int __init ion_kbench_init(void)
+{
+	return kbench_register(&ion_kbench);
+}
+late_initcall(ion_kbench_init);
@@ -100,12 +100,61 @@ void *ion_page_pool_alloc(struct ion_page_pool *pool, bool *from_pool)
 		mutex_unlock(&pool->mutex);
 	}
 	if (!page) {
+		atomic_inc(&pool->misses);
 		page = ion_page_pool_alloc_pages(pool);
 		*from_pool = false;
+	} else {
+		atomic_inc(&pool->hits);
 	}
 	return page;
 }
 
+/*
+ * Adds up to nr_pages zeroed pages to the pool, only from memory that is
+ * free right now. Returns the number of pages added.
+ */
+int ion_page_pool_refill(struct ion_page_pool *pool, int nr_pages)
+{
+	gfp_t gfp_mask = (pool->gfp_mask | __GFP_NORETRY | __GFP_NO_KSWAPD |
+			  __GFP_NOWARN) & ~(__GFP_WAIT | __GFP_ZERO);
+	int i;
+
+	for (i = 0; i < nr_pages; i++) {
+		struct page *page = alloc_pages(gfp_mask, pool->order);
+
+		if (!page)
+			break;
+		if (msm_ion_heap_high_order_page_zero(page, pool->order)) {
+			__free_pages(page, pool->order);
+			break;
+		}
+		ion_alloc_inc_usage(ION_TOTAL, 1 << pool->order);
+		ion_page_pool_add(pool, page);
+		cond_resched();
+	}
+
+	return i;
+}
+
+/* Takes a page that is in the pool, NULL if it is empty */
+struct page *ion_page_pool_take(struct ion_page_pool *pool)
+{
+	struct page *page = NULL;
+
+	mutex_lock(&pool->mutex);
+	if (pool->high_count)
+		page = ion_page_pool_remove(pool, true);
+	else if (pool->low_count)
+		page = ion_page_pool_remove(pool, false);
+	mutex_unlock(&pool->mutex);
+	return page;
+}
+
+int ion_page_pool_count(struct ion_page_pool *pool)
+{
+	return ACCESS_ONCE(pool->high_count) + ACCESS_ONCE(pool->low_count);
+}
+
 void ion_page_pool_free(struct ion_page_pool *pool, struct page *page)
 {
 	int ret;
@@ -167,6 +216,8 @@ struct ion_page_pool *ion_page_pool_create(gfp_t gfp_mask, unsigned int order)
 	INIT_LIST_HEAD(&pool->high_items);
 	pool->gfp_mask = gfp_mask;
 	pool->order = order;
+	atomic_set(&pool->hits, 0);
+	atomic_set(&pool->misses, 0);
 	mutex_init(&pool->mutex);
 	plist_node_init(&pool->list, order);
 
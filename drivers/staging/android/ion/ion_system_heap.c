@@ -20,10 +20,14 @@
 #include <linux/err.h>
 #include <linux/highmem.h>
 #include <linux/mm.h>
+#include <linux/mutex.h>
+#include <linux/sched.h>
 #include <linux/scatterlist.h>
 #include <linux/seq_file.h>
+#include <linux/sizes.h>
 #include <linux/slab.h>
 #include <linux/vmalloc.h>
+#include <linux/workqueue.h>
 #include "ion.h"
 #include "ion_priv.h"
 #include <linux/dma-mapping.h>
@@ -36,10 +40,33 @@ static gfp_t low_order_gfp_flags  = (GFP_HIGHUSER | __GFP_NOWARN);
 
 #ifndef CONFIG_ALLOC_BUFFERS_IN_4K_CHUNKS
 static const unsigned int orders[] = {9, 8, 4, 0};
+/* zeroed pages the refill work keeps in each uncached pool */
+static const unsigned int pool_watermarks[] = {4, 4, 16, 128};
 #else
 static const unsigned int orders[] = {0};
+static const unsigned int pool_watermarks[] = {256};
 #endif
 
+/*
+ * The pools are topped up once the allocations stop for
+ * ION_POOL_REFILL_DELAY, and not at all for ION_POOL_SHRINK_BACKOFF
+ * after the shrinker took pages back.
+ */
+#define ION_POOL_REFILL_DELAY	msecs_to_jiffies(500)
+#define ION_POOL_SHRINK_BACKOFF	msecs_to_jiffies(10000)
+
+/*
+ * The pages of a freed buffer go to a local pool of the process that last
+ * held a handle to it, without being zeroed: that process had access to
+ * them already. Its next allocations take them back before the shared
+ * pools. Pages only move to the shared pools zeroed, once the process
+ * didn't allocate or free for ION_LOCAL_POOL_IDLE or when its slot is
+ * needed by another process.
+ */
+#define ION_LOCAL_POOLS		4
+#define ION_LOCAL_POOL_MAX	(SZ_64M >> PAGE_SHIFT)
+#define ION_LOCAL_POOL_IDLE	msecs_to_jiffies(2000)
+
 static const int num_orders = ARRAY_SIZE(orders);
 static int order_to_index(unsigned int order)
 {
@@ -57,15 +84,194 @@ static unsigned int order_to_size(int order)
 	return PAGE_SIZE << order;
 }
 
+struct ion_local_pool {
+	struct mutex lock;
+	pid_t tgid;			/* owner, 0 if the slot is free */
+	unsigned long last_use;
+	unsigned long nr_pages;
+	struct ion_page_pool *uncached_pools[ARRAY_SIZE(orders)];
+	struct ion_page_pool *cached_pools[ARRAY_SIZE(orders)];
+};
+
 struct ion_system_heap {
 	struct ion_heap heap;
 	struct ion_page_pool **uncached_pools;
 	struct ion_page_pool **cached_pools;
+	struct delayed_work refill_work;
+	unsigned long last_shrink;
+	struct mutex local_lock;	/* owners of the local pools */
+	struct ion_local_pool local_pools[ION_LOCAL_POOLS];
 };
 
+static struct ion_page_pool *ion_local_pool_find(struct ion_local_pool *lp,
+						 bool cached,
+						 unsigned int order)
+{
+	if (cached)
+		return lp->cached_pools[order_to_index(order)];
+	return lp->uncached_pools[order_to_index(order)];
+}
+
+/* Hands a page of a local pool to a shared pool, zeroed */
+static void ion_local_page_release(struct ion_page_pool *to,
+				   struct page *page)
+{
+	if (msm_ion_heap_high_order_page_zero(page, to->order)) {
+		ion_alloc_dec_usage(ION_TOTAL, 1 << to->order);
+		__free_pages(page, to->order);
+		return;
+	}
+	ion_page_pool_free(to, page);
+}
+
+static void ion_local_pool_move(struct ion_page_pool *from,
+				struct ion_page_pool *to)
+{
+	struct page *page;
+
+	while ((page = ion_page_pool_take(from))) {
+		ion_local_page_release(to, page);
+		cond_resched();
+	}
+}
+
+/* Zeroes the pages of a local pool into the shared pools, lp->lock held */
+static void ion_local_pool_drain(struct ion_system_heap *sys_heap,
+				 struct ion_local_pool *lp)
+{
+	int i;
+
+	for (i = 0; i < num_orders; i++) {
+		ion_local_pool_move(lp->uncached_pools[i],
+				    sys_heap->uncached_pools[i]);
+		ion_local_pool_move(lp->cached_pools[i],
+				    sys_heap->cached_pools[i]);
+	}
+	lp->nr_pages = 0;
+}
+
+/*
+ * Returns the local pool of tgid locked, or NULL if it has none. With
+ * assign a process without a pool gets a free slot, or the least
+ * recently used one once its pages are moved out.
+ */
+static struct ion_local_pool *ion_local_pool_get(
+		struct ion_system_heap *sys_heap, pid_t tgid, bool assign)
+{
+	struct ion_local_pool *lp = NULL, *victim = NULL;
+	int i;
+
+	if (!tgid)
+		return NULL;
+
+	mutex_lock(&sys_heap->local_lock);
+	for (i = 0; i < ION_LOCAL_POOLS; i++) {
+		struct ion_local_pool *p = &sys_heap->local_pools[i];
+
+		if (p->tgid == tgid) {
+			lp = p;
+			break;
+		}
+		if (!victim || (victim->tgid && (!p->tgid ||
+		    time_before(p->last_use, victim->last_use))))
+			victim = p;
+	}
+
+	if (lp) {
+		mutex_lock(&lp->lock);
+	} else if (assign) {
+		lp = victim;
+		mutex_lock(&lp->lock);
+		if (lp->tgid)
+			ion_local_pool_drain(sys_heap, lp);
+		lp->tgid = tgid;
+	}
+	if (lp)
+		lp->last_use = jiffies;
+	mutex_unlock(&sys_heap->local_lock);
+
+	return lp;
+}
+
+static void ion_local_pool_put(struct ion_local_pool *lp)
+{
+	mutex_unlock(&lp->lock);
+}
+
+static unsigned long ion_local_pool_pages(struct ion_local_pool *lp)
+{
+	unsigned long nr_pages = 0;
+	int i;
+
+	for (i = 0; i < num_orders; i++)
+		nr_pages += (ion_page_pool_count(lp->uncached_pools[i]) +
+			     ion_page_pool_count(lp->cached_pools[i])) <<
+			    orders[i];
+	return nr_pages;
+}
+
+/* Gives up the idle local pools, true if some are still in use */
+static bool ion_local_pools_expire(struct ion_system_heap *sys_heap)
+{
+	bool busy = false;
+	int i;
+
+	mutex_lock(&sys_heap->local_lock);
+	for (i = 0; i < ION_LOCAL_POOLS; i++) {
+		struct ion_local_pool *lp = &sys_heap->local_pools[i];
+
+		if (!lp->tgid)
+			continue;
+
+		mutex_lock(&lp->lock);
+		if (time_after_eq(jiffies,
+				  lp->last_use + ION_LOCAL_POOL_IDLE)) {
+			ion_local_pool_drain(sys_heap, lp);
+			lp->tgid = 0;
+		} else {
+			busy = true;
+		}
+		mutex_unlock(&lp->lock);
+	}
+	mutex_unlock(&sys_heap->local_lock);
+
+	return busy;
+}
+
+static void ion_system_heap_refill(struct work_struct *work)
+{
+	struct ion_system_heap *sys_heap = container_of(to_delayed_work(work),
+							struct ion_system_heap,
+							refill_work);
+	int i;
+
+	if (ion_local_pools_expire(sys_heap))
+		mod_delayed_work(system_unbound_wq, &sys_heap->refill_work,
+				 ION_LOCAL_POOL_IDLE);
+
+	if (time_before(jiffies, ACCESS_ONCE(sys_heap->last_shrink) +
+			ION_POOL_SHRINK_BACKOFF))
+		return;
+
+	for (i = 0; i < num_orders; i++) {
+		struct ion_page_pool *pool = sys_heap->uncached_pools[i];
+		int nr = pool_watermarks[i] - ion_page_pool_count(pool);
+
+		if (nr > 0)
+			ion_page_pool_refill(pool, nr);
+	}
+}
+
+static void ion_system_heap_schedule_refill(struct ion_system_heap *sys_heap)
+{
+	mod_delayed_work(system_unbound_wq, &sys_heap->refill_work,
+			 ION_POOL_REFILL_DELAY);
+}
+
 struct page_info {
 	struct page *page;
 	bool from_pool;
+	bool from_local;
 	unsigned int order;
 	struct list_head list;
 };
@@ -113,6 +319,7 @@ static void free_buffer_page(struct ion_system_heap *heap,
 
 static struct page_info *alloc_largest_available(struct ion_system_heap *heap,
 						 struct ion_buffer *buffer,
+						 struct ion_local_pool *lp,
 						 unsigned long size,
 						 unsigned int max_order)
 {
@@ -120,6 +327,7 @@ static struct page_info *alloc_largest_available(struct ion_system_heap *heap,
 	struct page_info *info;
 	int i;
 	bool from_pool;
+	bool from_local;
 
 	info = kmalloc(sizeof(struct page_info), GFP_KERNEL);
 	if (!info)
@@ -131,13 +339,25 @@ static struct page_info *alloc_largest_available(struct ion_system_heap *heap,
 		if (max_order < orders[i])
 			continue;
 
-		page = alloc_buffer_page(heap, buffer, orders[i], &from_pool);
+		page = NULL;
+		if (lp)
+			page = ion_page_pool_take(ion_local_pool_find(lp,
+					ion_buffer_cached(buffer), orders[i]));
+		from_local = page != NULL;
+		if (from_local) {
+			lp->nr_pages -= 1 << orders[i];
+			from_pool = true;
+		} else {
+			page = alloc_buffer_page(heap, buffer, orders[i],
+						 &from_pool);
+		}
 		if (!page)
 			continue;
 
 		info->page = page;
 		info->order = orders[i];
 		info->from_pool = from_pool;
+		info->from_local = from_local;
 		INIT_LIST_HEAD(&info->list);
 		return info;
 	}
@@ -196,6 +416,7 @@ static int ion_system_heap_allocate(struct ion_heap *heap,
 	unsigned int max_order = orders[0];
 	struct pages_mem data;
 	unsigned int sz;
+	struct ion_local_pool *lp;
 
 	if (align > PAGE_SIZE)
 		return -EINVAL;
@@ -206,9 +427,10 @@ static int ion_system_heap_allocate(struct ion_heap *heap,
 	data.size = 0;
 	INIT_LIST_HEAD(&pages);
 	INIT_LIST_HEAD(&pages_from_pool);
+	lp = ion_local_pool_get(sys_heap, task_tgid_nr(current), false);
 	while (size_remaining > 0) {
-		info = alloc_largest_available(sys_heap, buffer, size_remaining,
-						max_order);
+		info = alloc_largest_available(sys_heap, buffer, lp,
+						size_remaining, max_order);
 		if (!info)
 			goto err;
 
@@ -226,6 +448,10 @@ static int ion_system_heap_allocate(struct ion_heap *heap,
 		max_order = info->order;
 		i++;
 	}
+	if (lp) {
+		ion_local_pool_put(lp);
+		lp = NULL;
+	}
 
 	ret = msm_ion_heap_alloc_pages_mem(&data);
 
@@ -291,13 +517,14 @@ static int ion_system_heap_allocate(struct ion_heap *heap,
 
 	buffer->priv_virt = table;
 	ion_alloc_inc_usage(ION_IN_USE, total_pages);
+	ion_system_heap_schedule_refill(sys_heap);
 	if (nents_sync)
 		sg_free_table(&table_sync);
 	msm_ion_heap_free_pages_mem(&data);
 	return 0;
 err_free_sg2:
 	/* We failed to zero buffers. Bypass pool */
-	buffer->flags |= ION_PRIV_FLAG_SHRINKER_FREE;
+	buffer->private_flags |= ION_PRIV_FLAG_SHRINKER_FREE;
 
 	for_each_sg(table->sgl, sg, table->nents, i)
 		free_buffer_page(sys_heap, buffer, sg_page(sg),
@@ -311,12 +538,22 @@ err1:
 err_free_data_pages:
 	msm_ion_heap_free_pages_mem(&data);
 err:
+	if (lp)
+		ion_local_pool_put(lp);
 	list_for_each_entry_safe(info, tmp_info, &pages, list) {
 		free_buffer_page(sys_heap, buffer, info->page, info->order);
 		kfree(info);
 	}
 	list_for_each_entry_safe(info, tmp_info, &pages_from_pool, list) {
-		free_buffer_page(sys_heap, buffer, info->page, info->order);
+		/* Never hand out the pages of a local pool unzeroed */
+		if (info->from_local)
+			ion_local_page_release(ion_buffer_cached(buffer) ?
+				sys_heap->cached_pools[order_to_index(info->order)] :
+				sys_heap->uncached_pools[order_to_index(info->order)],
+				info->page);
+		else
+			free_buffer_page(sys_heap, buffer, info->page,
+					 info->order);
 		kfree(info);
 	}
 	return -ENOMEM;
@@ -330,19 +567,41 @@ void ion_system_heap_free(struct ion_buffer *buffer)
 							heap);
 	struct sg_table *table = buffer->sg_table;
 	struct scatterlist *sg;
+	struct ion_local_pool *lp = NULL;
+	unsigned long nr_pages = PAGE_ALIGN(buffer->size) >> PAGE_SHIFT;
 	LIST_HEAD(pages);
 	int i;
 
-	if (!(buffer->private_flags & ION_PRIV_FLAG_SHRINKER_FREE))
-		msm_ion_heap_buffer_zero(buffer);
+	if (!(buffer->private_flags & ION_PRIV_FLAG_SHRINKER_FREE)) {
+		lp = ion_local_pool_get(sys_heap, buffer->pid, true);
+		if (lp && lp->nr_pages + nr_pages > ION_LOCAL_POOL_MAX) {
+			ion_local_pool_put(lp);
+			lp = NULL;
+		}
+		if (!lp)
+			msm_ion_heap_buffer_zero(buffer);
+	}
 
 	for_each_sg(table->sgl, sg, table->nents, i) {
-		ion_alloc_dec_usage(ION_IN_USE, 1 << get_order(sg->length));
-		free_buffer_page(sys_heap, buffer, sg_page(sg),
-				get_order(sg->length));
+		unsigned int order = get_order(sg->length);
+
+		ion_alloc_dec_usage(ION_IN_USE, 1 << order);
+		if (lp) {
+			ion_page_pool_free(ion_local_pool_find(lp,
+					ion_buffer_cached(buffer), order),
+					sg_page(sg));
+			lp->nr_pages += 1 << order;
+		} else {
+			free_buffer_page(sys_heap, buffer, sg_page(sg), order);
+		}
 	}
 	sg_free_table(table);
 	kfree(table);
+
+	if (lp) {
+		ion_local_pool_put(lp);
+		ion_system_heap_schedule_refill(sys_heap);
+	}
 }
 
 struct sg_table *ion_system_heap_map_dma(struct ion_heap *heap,
@@ -366,6 +625,9 @@ static int ion_system_heap_shrink(struct ion_heap *heap, gfp_t gfp_mask,
 
 	sys_heap = container_of(heap, struct ion_system_heap, heap);
 
+	if (nr_to_scan)
+		ACCESS_ONCE(sys_heap->last_shrink) = jiffies;
+
 	for (i = 0; i < num_orders; i++) {
 		struct ion_page_pool *pool = sys_heap->uncached_pools[i];
 
@@ -376,6 +638,23 @@ static int ion_system_heap_shrink(struct ion_heap *heap, gfp_t gfp_mask,
 		nr_total += ion_page_pool_shrink(pool, gfp_mask, nr_to_scan);
 	}
 
+	/* An allocation of the owner may be what is reclaiming */
+	for (i = 0; i < ION_LOCAL_POOLS; i++) {
+		struct ion_local_pool *lp = &sys_heap->local_pools[i];
+		int j;
+
+		if (!mutex_trylock(&lp->lock))
+			continue;
+		for (j = 0; j < num_orders; j++) {
+			nr_total += ion_page_pool_shrink(lp->uncached_pools[j],
+						gfp_mask, nr_to_scan);
+			nr_total += ion_page_pool_shrink(lp->cached_pools[j],
+						gfp_mask, nr_to_scan);
+		}
+		lp->nr_pages = ion_local_pool_pages(lp);
+		mutex_unlock(&lp->lock);
+	}
+
 	return nr_total;
 }
 
@@ -418,6 +697,10 @@ static int ion_system_heap_debug_show(struct ion_heap *heap, struct seq_file *s,
 				pool->low_count, pool->order,
 				(1 << pool->order) * PAGE_SIZE *
 					pool->low_count);
+			seq_printf(s,
+				"order %u uncached pool: %d hits %d misses, refilled to %u\n",
+				pool->order, atomic_read(&pool->hits),
+				atomic_read(&pool->misses), pool_watermarks[i]);
 		} else {
 			uncached_total += (1 << pool->order) * PAGE_SIZE *
 						pool->high_count;
@@ -439,6 +722,10 @@ static int ion_system_heap_debug_show(struct ion_heap *heap, struct seq_file *s,
 				pool->low_count, pool->order,
 				(1 << pool->order) * PAGE_SIZE *
 					pool->low_count);
+			seq_printf(s,
+				"order %u cached pool: %d hits %d misses\n",
+				pool->order, atomic_read(&pool->hits),
+				atomic_read(&pool->misses));
 		} else {
 			cached_total += (1 << pool->order) * PAGE_SIZE *
 						pool->high_count;
@@ -448,6 +735,15 @@ static int ion_system_heap_debug_show(struct ion_heap *heap, struct seq_file *s,
 		total_pages += (1 << pool->order) * (pool->high_count + pool->low_count);
 	}
 
+	for (i = 0; i < ION_LOCAL_POOLS; i++) {
+		struct ion_local_pool *lp = &sys_heap->local_pools[i];
+
+		if (use_seq && lp->tgid)
+			seq_printf(s, "local pool of pid %d: %lu pages\n",
+				lp->tgid, lp->nr_pages);
+		total_pages += lp->nr_pages;
+	}
+
 	if (!use_seq)
 		pr_info("uncached pool total = %lu cached pool total %lu\n",
 				uncached_total, cached_total);
@@ -500,6 +796,7 @@ struct ion_heap *ion_system_heap_create(struct ion_platform_heap *unused)
 {
 	struct ion_system_heap *heap;
 	int pools_size = sizeof(struct ion_page_pool *) * num_orders;
+	int i;
 
 	heap = kzalloc(sizeof(struct ion_system_heap), GFP_KERNEL);
 	if (!heap)
@@ -522,9 +819,30 @@ struct ion_heap *ion_system_heap_create(struct ion_platform_heap *unused)
 	if (ion_system_heap_create_pools(heap->cached_pools))
 		goto err_create_cached_pools;
 
+	mutex_init(&heap->local_lock);
+	for (i = 0; i < ION_LOCAL_POOLS; i++) {
+		struct ion_local_pool *lp = &heap->local_pools[i];
+
+		mutex_init(&lp->lock);
+		if (ion_system_heap_create_pools(lp->uncached_pools))
+			goto err_create_local_pools;
+		if (ion_system_heap_create_pools(lp->cached_pools)) {
+			ion_system_heap_destroy_pools(lp->uncached_pools);
+			goto err_create_local_pools;
+		}
+	}
+
 	heap->heap.debug_show = ion_system_heap_debug_show;
+	INIT_DELAYED_WORK(&heap->refill_work, ion_system_heap_refill);
+	ion_system_heap_schedule_refill(heap);
 	return &heap->heap;
 
+err_create_local_pools:
+	while (--i >= 0) {
+		ion_system_heap_destroy_pools(heap->local_pools[i].uncached_pools);
+		ion_system_heap_destroy_pools(heap->local_pools[i].cached_pools);
+	}
+	ion_system_heap_destroy_pools(heap->cached_pools);
 err_create_cached_pools:
 	ion_system_heap_destroy_pools(heap->uncached_pools);
 err_create_uncached_pools:
@@ -542,6 +860,15 @@ void ion_system_heap_destroy(struct ion_heap *heap)
 							struct ion_system_heap,
 							heap);
 
+	int i;
+
+	cancel_delayed_work_sync(&sys_heap->refill_work);
+	for (i = 0; i < ION_LOCAL_POOLS; i++) {
+		ion_system_heap_destroy_pools(
+				sys_heap->local_pools[i].uncached_pools);
+		ion_system_heap_destroy_pools(
+				sys_heap->local_pools[i].cached_pools);
+	}
 	ion_system_heap_destroy_pools(sys_heap->uncached_pools);
 	ion_system_heap_destroy_pools(sys_heap->cached_pools);
 	kfree(sys_heap->uncached_pools);
@@ -29,6 +29,8 @@
 #include <linux/time.h>
 #include <linux/vmalloc.h>
 #include <linux/aio.h>
+#include <linux/mm.h>
+#include <linux/timer.h>
 #include "logger.h"
 
 #include <asm/ioctls.h>
@@ -48,6 +50,12 @@
  * @head:	The head, or location that readers start reading at.
  * @size:	The size of the log
  * @logs:	The list of log channels
+ * @ring_area:	The per-CPU rings, allocated on first LOGGER_RING_ENABLE
+ * @ring_stride: Distance between two rings in @ring_area
+ * @ring_owner:	The reader that enabled the rings
+ * @ring_enabled: Whether writes go to the rings
+ * @ring_wake_pending: A coalesced reader wakeup is pending
+ * @ring_wake_timer: Fires the coalesced reader wakeup
  *
  * This structure lives from module insertion until module removal, so it does
  * not need additional reference counting. The structure is protected by the
@@ -63,6 +71,14 @@ struct logger_log {
 	size_t			head;
 	size_t			size;
 	struct list_head	logs;
+#ifdef CONFIG_ANDROID_LOGGER_RING
+	void			*ring_area;
+	size_t			ring_stride;
+	struct logger_reader	*ring_owner;
+	bool			ring_enabled;
+	unsigned long		ring_wake_pending;
+	struct timer_list	ring_wake_timer;
+#endif
 };
 
 static LIST_HEAD(log_list);
@@ -465,6 +481,321 @@ static ssize_t do_write_log_from_user(struct logger_log *log,
 	return count;
 }
 
+#ifdef CONFIG_ANDROID_LOGGER_RING
+
+#define LOGGER_RING_SIZE	(CONFIG_ANDROID_LOGGER_RING_SIZE * 1024)
+
+/* Coalesce reader wakeups for the rings over this many ms, 0 for none */
+static unsigned int ring_wakeup_ms = 20;
+module_param(ring_wakeup_ms, uint, 0644);
+
+static struct logger_ring_header *log_ring(struct logger_log *log, int cpu)
+{
+	return log->ring_area + cpu * log->ring_stride;
+}
+
+static void logger_ring_wake(unsigned long data)
+{
+	struct logger_log *log = (struct logger_log *)data;
+
+	clear_bit(0, &log->ring_wake_pending);
+	wake_up_interruptible(&log->wq);
+}
+
+static void logger_ring_kick(struct logger_log *log)
+{
+	unsigned int ms = ACCESS_ONCE(ring_wakeup_ms);
+
+	if (!ms) {
+		wake_up_interruptible(&log->wq);
+		return;
+	}
+
+	if (!test_and_set_bit(0, &log->ring_wake_pending))
+		mod_timer(&log->ring_wake_timer,
+			  jiffies + msecs_to_jiffies(ms));
+}
+
+/*
+ * logger_ring_append - appends one entry to the ring of this CPU
+ *
+ * Writers of a ring are serialized by disabling preemption and the reader
+ * only ever moves the tail, so no lock is needed. Without 'kbuf' the
+ * payload is copied straight from 'iov' with page faults disabled, and
+ * -EFAULT is returned if that would have faulted.
+ */
+static int logger_ring_append(struct logger_log *log,
+			      struct logger_entry *header,
+			      const struct iovec *iov, unsigned long nr_segs,
+			      const void *kbuf)
+{
+	size_t total = ALIGN(sizeof(struct logger_entry) + header->len, 8);
+	struct logger_ring_header *ring;
+	unsigned char *data;
+	size_t off, pad, left, len;
+	u64 head;
+	int ret = 0;
+
+	ring = log_ring(log, get_cpu());
+
+	/* The rings may have been disabled and reset under us */
+	if (unlikely(!ACCESS_ONCE(log->ring_enabled)))
+		goto out;
+
+	data = (unsigned char *)ring + ring->data_offset;
+	head = ring->head;
+	off = head & (ring->size - 1);
+	pad = ring->size - off < total ? ring->size - off : 0;
+
+	if (head + pad + total - ACCESS_ONCE(ring->tail) > ring->size) {
+		ring->dropped++;
+		goto out;
+	}
+	/* Don't overwrite anything before the tail says it was consumed */
+	smp_mb();
+
+	if (pad) {
+		memset(data + off, 0, 8);
+		off = 0;
+	}
+
+	memcpy(data + off, header, sizeof(struct logger_entry));
+	off += sizeof(struct logger_entry);
+
+	if (kbuf) {
+		memcpy(data + off, kbuf, header->len);
+	} else {
+		left = header->len;
+		pagefault_disable();
+		for (; left && nr_segs; nr_segs--, iov++) {
+			len = min_t(size_t, iov->iov_len, left);
+			if (__copy_from_user_inatomic(data + off,
+						      iov->iov_base, len)) {
+				ret = -EFAULT;
+				break;
+			}
+			off += len;
+			left -= len;
+		}
+		pagefault_enable();
+		if (ret)
+			goto out;
+	}
+
+	/* Publish the entry only once it is complete */
+	smp_wmb();
+	ACCESS_ONCE(ring->head) = head + pad + total;
+out:
+	put_cpu();
+	return ret;
+}
+
+static ssize_t logger_ring_write(struct logger_log *log,
+				 struct logger_entry *header,
+				 const struct iovec *iov, unsigned long nr_segs)
+{
+	size_t off = 0, len;
+	void *kbuf;
+	int ret;
+
+	ret = logger_ring_append(log, header, iov, nr_segs, NULL);
+	if (ret == -EFAULT) {
+		/* Take the faults here, then copy from a bounce buffer */
+		kbuf = kmalloc(header->len, GFP_KERNEL);
+		if (!kbuf)
+			return -ENOMEM;
+
+		for (; off < header->len && nr_segs; nr_segs--, iov++) {
+			len = min_t(size_t, iov->iov_len, header->len - off);
+			if (copy_from_user(kbuf + off, iov->iov_base, len)) {
+				kfree(kbuf);
+				return -EFAULT;
+			}
+			off += len;
+		}
+
+		ret = logger_ring_append(log, header, NULL, 0, kbuf);
+		kfree(kbuf);
+	}
+	if (ret)
+		return ret;
+
+	logger_ring_kick(log);
+
+	return header->len;
+}
+
+/*
+ * The caller needs to hold log->mutex.
+ */
+static long logger_ring_enable(struct logger_log *log,
+			       struct logger_reader *reader)
+{
+	struct logger_ring_header *ring;
+	int cpu;
+
+	if (!reader->r_all)
+		return -EPERM;
+	if (log->ring_owner)
+		return log->ring_owner == reader ? 0 : -EBUSY;
+
+	if (!log->ring_area) {
+		log->ring_stride = PAGE_SIZE + LOGGER_RING_SIZE;
+		log->ring_area = vmalloc_user(nr_cpu_ids * log->ring_stride);
+		if (!log->ring_area)
+			return -ENOMEM;
+	}
+
+	for_each_possible_cpu(cpu) {
+		ring = log_ring(log, cpu);
+		memset(ring, 0, sizeof(*ring));
+		ring->size = LOGGER_RING_SIZE;
+		ring->data_offset = PAGE_SIZE;
+	}
+
+	log->ring_owner = reader;
+	smp_wmb();
+	ACCESS_ONCE(log->ring_enabled) = true;
+
+	return 0;
+}
+
+/*
+ * The caller needs to hold log->mutex.
+ */
+static void logger_ring_disable(struct logger_log *log,
+				struct logger_reader *reader)
+{
+	if (log->ring_owner != reader)
+		return;
+
+	ACCESS_ONCE(log->ring_enabled) = false;
+	log->ring_owner = NULL;
+
+	/* Wait for writers still appending to the rings */
+	synchronize_sched();
+	del_timer_sync(&log->ring_wake_timer);
+	clear_bit(0, &log->ring_wake_pending);
+}
+
+/*
+ * The caller needs to hold log->mutex.
+ */
+static long logger_ring_release(struct logger_log *log,
+				struct logger_reader *reader, void __user *arg)
+{
+	struct logger_ring_release rel;
+	struct logger_ring_header *ring;
+
+	if (log->ring_owner != reader)
+		return -EPERM;
+	if (copy_from_user(&rel, arg, sizeof(rel)))
+		return -EFAULT;
+	if (rel.__pad || rel.cpu >= nr_cpu_ids || !cpu_possible(rel.cpu))
+		return -EINVAL;
+
+	ring = log_ring(log, rel.cpu);
+	if (rel.tail < ring->tail || rel.tail > ACCESS_ONCE(ring->head))
+		return -EINVAL;
+
+	/* The reader is done with the data before writers may reuse it */
+	smp_mb();
+	ACCESS_ONCE(ring->tail) = rel.tail;
+
+	return 0;
+}
+
+static long logger_ring_dropped(struct logger_log *log)
+{
+	long dropped = 0;
+	int cpu;
+
+	if (!log->ring_area)
+		return 0;
+
+	for_each_possible_cpu(cpu)
+		dropped += ACCESS_ONCE(log_ring(log, cpu)->dropped);
+
+	return dropped;
+}
+
+static bool logger_ring_readable(struct logger_log *log,
+				 struct logger_reader *reader)
+{
+	struct logger_ring_header *ring;
+	int cpu;
+
+	if (ACCESS_ONCE(log->ring_owner) != reader)
+		return false;
+
+	for_each_possible_cpu(cpu) {
+		ring = log_ring(log, cpu);
+		if (ACCESS_ONCE(ring->head) != ring->tail)
+			return true;
+	}
+
+	return false;
+}
+
+/*
+ * logger_mmap - maps the rings read-only for the reader that enabled them
+ */
+static int logger_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct logger_reader *reader;
+	struct logger_log *log;
+	int ret = -EINVAL;
+
+	if (!(file->f_mode & FMODE_READ))
+		return -EBADF;
+	if (vma->vm_flags & VM_WRITE)
+		return -EPERM;
+
+	reader = file->private_data;
+	log = reader->log;
+
+	mutex_lock(&log->mutex);
+	if (log->ring_owner == reader) {
+		vma->vm_flags &= ~VM_MAYWRITE;
+		ret = remap_vmalloc_range(vma, log->ring_area, vma->vm_pgoff);
+	}
+	mutex_unlock(&log->mutex);
+
+	return ret;
+}
+
+#else
+
+static inline ssize_t logger_ring_write(struct logger_log *log,
+					struct logger_entry *header,
+					const struct iovec *iov,
+					unsigned long nr_segs)
+{
+	return -EINVAL;
+}
+
+static inline void logger_ring_disable(struct logger_log *log,
+				       struct logger_reader *reader)
+{
+}
+
+static inline bool logger_ring_readable(struct logger_log *log,
+					struct logger_reader *reader)
+{
+	return false;
+}
+
+#endif /* CONFIG_ANDROID_LOGGER_RING */
+
+static inline bool logger_ring_enabled(struct logger_log *log)
+{
+#ifdef CONFIG_ANDROID_LOGGER_RING
+	return ACCESS_ONCE(log->ring_enabled);
+#else
+	return false;
+#endif
+}
+
 /*
  * logger_aio_write - our write method, implementing support for write(),
  * writev(), and aio_write(). Writes are our fast path, and we try to optimize
@@ -493,6 +824,10 @@ static ssize_t logger_aio_write(struct kiocb *iocb, const struct iovec *iov,
 	if (unlikely(!header.len))
 		return 0;
 
+	/* logd reads the per-CPU rings, skip the log mutex */
+	if (logger_ring_enabled(log))
+		return logger_ring_write(log, &header, iov, nr_segs);
+
 	mutex_lock(&log->mutex);
 
 	orig = log->w_off;
@@ -601,6 +936,7 @@ static int logger_release(struct inode *ignored, struct file *file)
 
 		mutex_lock(&log->mutex);
 		list_del(&reader->list);
+		logger_ring_disable(log, reader);
 		mutex_unlock(&log->mutex);
 
 		kfree(reader);
@@ -632,6 +968,9 @@ static unsigned int logger_poll(struct file *file, poll_table *wait)
 
 	poll_wait(file, &log->wq, wait);
 
+	if (logger_ring_readable(log, reader))
+		return ret | POLLIN | POLLRDNORM;
+
 	mutex_lock(&log->mutex);
 	if (!reader->r_all)
 		reader->r_off = get_next_entry_by_uid(log,
@@ -730,6 +1069,25 @@ static long logger_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 		reader = file->private_data;
 		ret = logger_set_version(reader, argp);
 		break;
+#ifdef CONFIG_ANDROID_LOGGER_RING
+	case LOGGER_RING_ENABLE:
+		if (!(file->f_mode & FMODE_READ)) {
+			ret = -EBADF;
+			break;
+		}
+		ret = logger_ring_enable(log, file->private_data);
+		break;
+	case LOGGER_RING_RELEASE:
+		if (!(file->f_mode & FMODE_READ)) {
+			ret = -EBADF;
+			break;
+		}
+		ret = logger_ring_release(log, file->private_data, argp);
+		break;
+	case LOGGER_GET_DROPPED:
+		ret = logger_ring_dropped(log);
+		break;
+#endif
 	}
 
 	mutex_unlock(&log->mutex);
@@ -744,6 +1102,9 @@ static const struct file_operations logger_fops = {
 	.poll = logger_poll,
 	.unlocked_ioctl = logger_ioctl,
 	.compat_ioctl = logger_ioctl,
+#ifdef CONFIG_ANDROID_LOGGER_RING
+	.mmap = logger_mmap,
+#endif
 	.open = logger_open,
 	.release = logger_release,
 };
@@ -785,6 +1146,10 @@ static int __init create_log(char *log_name, int size)
 	log->w_off = 0;
 	log->head = 0;
 	log->size = size;
+#ifdef CONFIG_ANDROID_LOGGER_RING
+	setup_timer(&log->ring_wake_timer, logger_ring_wake,
+		    (unsigned long)log);
+#endif
 
 	INIT_LIST_HEAD(&log->logs);
 	list_add_tail(&log->logs, &log_list);
@@ -844,6 +1209,10 @@ static void __exit logger_exit(void)
 	list_for_each_entry_safe(current_log, next_log, &log_list, logs) {
 		/* we have to delete all the entry inside log_list */
 		misc_deregister(&current_log->misc);
+#ifdef CONFIG_ANDROID_LOGGER_RING
+		del_timer_sync(&current_log->ring_wake_timer);
+		vfree(current_log->ring_area);
+#endif
 		vfree(current_log->buffer);
 		kfree(current_log->misc.name);
 		list_del(&current_log->logs);
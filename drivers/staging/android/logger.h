@@ -86,4 +86,44 @@ struct logger_entry {
 #define LOGGER_GET_VERSION		_IO(__LOGGERIO, 5) /* abi version */
 #define LOGGER_SET_VERSION		_IO(__LOGGERIO, 6) /* abi version */
 
+/**
+ * struct logger_ring_header - head of a per-CPU log ring
+ * @head:	Bytes ever written to the ring, updated by the kernel
+ * @tail:	Bytes ever consumed, updated through LOGGER_RING_RELEASE
+ * @dropped:	Entries dropped because the ring was full
+ * @size:	Size of the data area, a power of two
+ * @data_offset: Offset of the data area from the start of this header
+ *
+ * With LOGGER_RING_ENABLE, writes no longer go to the log buffer but to
+ * one ring per possible CPU, which the enabling reader mmap()s read-only.
+ * Ring n starts at n * (@data_offset + @size) in the mapping. Entries are
+ * a struct logger_entry followed by the payload, padded to 8 bytes, and
+ * never wrap: an entry with a zero @len and @hdr_size means the rest of
+ * the data area is padding. Data between @tail and @head is valid.
+ */
+struct logger_ring_header {
+	__u64		head;
+	__u64		tail;
+	__u64		dropped;
+	__u32		size;
+	__u32		data_offset;
+};
+
+/**
+ * struct logger_ring_release - hands consumed ring space back to writers
+ * @cpu:	The ring
+ * @__pad:	Must be zero
+ * @tail:	The new consumer position, between the old tail and head
+ */
+struct logger_ring_release {
+	__u32		cpu;
+	__u32		__pad;
+	__u64		tail;
+};
+
+#define LOGGER_RING_ENABLE		_IO(__LOGGERIO, 7) /* switch to rings */
+#define LOGGER_RING_RELEASE		_IOW(__LOGGERIO, 8, \
+					     struct logger_ring_release)
+#define LOGGER_GET_DROPPED		_IO(__LOGGERIO, 9) /* ring drops */
+
 #endif /* _LINUX_LOGGER_H */
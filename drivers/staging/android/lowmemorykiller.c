@@ -46,6 +46,8 @@
 #include <linux/cpuset.h>
 #include <linux/show_mem_notifier.h>
 #include <linux/vmpressure.h>
+#include <linux/kthread.h>
+#include <linux/ktime.h>
 
 #define CREATE_TRACE_POINTS
 #include <trace/events/almk.h>
@@ -135,6 +137,10 @@ int adjust_minadj(short *min_score_adj)
 	return ret;
 }
 
+#ifdef CONFIG_ANDROID_LMK_KILL_QUEUE
+static void lmk_queue_kill(void);
+#endif
+
 static int lmk_vmpressure_notifier(struct notifier_block *nb,
 			unsigned long action, void *data)
 {
@@ -142,6 +148,11 @@ static int lmk_vmpressure_notifier(struct notifier_block *nb,
 	unsigned long pressure = action;
 	int array_size = ARRAY_SIZE(lowmem_adj);
 
+#ifdef CONFIG_ANDROID_LMK_KILL_QUEUE
+	/* let the kill thread re-evaluate minfree on every vmpressure event */
+	lmk_queue_kill();
+#endif
+
 	if (!enable_adaptive_lmk)
 		return 0;
 
@@ -378,52 +389,329 @@ void tune_lmk_param(int *other_free, int *other_file, struct shrink_control *sc)
 
 #define REVERT_ADJ(x)  (x * (-OOM_DISABLE + 1) / OOM_SCORE_ADJ_MAX)
 
+static void lowmem_other_pages(int *other_free, int *other_file)
+{
+	*other_free = global_page_state(NR_FREE_PAGES);
+
+	if (global_page_state(NR_SHMEM) + global_page_state(NR_MLOCK) + total_swapcache_pages() <
+		global_page_state(NR_FILE_PAGES))
+		*other_file = global_page_state(NR_FILE_PAGES) -
+						global_page_state(NR_SHMEM) -
+						global_page_state(NR_MLOCK) -
+						total_swapcache_pages();
+	else
+		*other_file = 0;
+}
+
+/* OOM_SCORE_ADJ_MAX + 1 if no minfree level is crossed */
+static short lowmem_min_score_adj(int other_free, int other_file,
+				  int *minfree)
+{
+	int array_size = ARRAY_SIZE(lowmem_adj);
+	int i;
+
+	*minfree = 0;
+	if (lowmem_adj_size < array_size)
+		array_size = lowmem_adj_size;
+	if (lowmem_minfree_size < array_size)
+		array_size = lowmem_minfree_size;
+	for (i = 0; i < array_size; i++) {
+		*minfree = lowmem_minfree[i];
+		if (other_free < *minfree && other_file < *minfree)
+			return lowmem_adj[i];
+	}
+
+	return OOM_SCORE_ADJ_MAX + 1;
+}
+
+#ifdef CONFIG_ANDROID_LMK_KILL_QUEUE
+/*
+ * Thread group leaders are kept in lists bucketed by oom_score_adj, kept
+ * up to date from fork, exit and the /proc adj writes, so that picking a
+ * victim only looks at the buckets at or above min_score_adj. Kills are
+ * requested from reclaim and vmpressure and carried out by lmk_kill_task,
+ * which re-evaluates the minfree levels itself.
+ */
+#define LMK_ADJ_BUCKETS		64
+#define LMK_ADJ_BUCKET_WIDTH	DIV_ROUND_UP(OOM_SCORE_ADJ_MAX - \
+					OOM_SCORE_ADJ_MIN + 1, LMK_ADJ_BUCKETS)
+
+static struct list_head lmk_adj_buckets[LMK_ADJ_BUCKETS];
+static DEFINE_SPINLOCK(lmk_adj_lock);
+static bool lmk_adj_index_ready;
+
+static struct task_struct *lmk_kill_task;
+static DECLARE_WAIT_QUEUE_HEAD(lmk_kill_wait);
+/* ktime in ns of the oldest pending kill request, 0 if none */
+static atomic64_t lmk_kill_queued = ATOMIC64_INIT(0);
+
+static inline int lmk_adj_bucket(short adj)
+{
+	return (adj - OOM_SCORE_ADJ_MIN) / LMK_ADJ_BUCKET_WIDTH;
+}
+
+void lmk_adj_index_add(struct task_struct *p)
+{
+	if (!thread_group_leader(p) || (p->flags & PF_KTHREAD))
+		return;
+
+	spin_lock(&lmk_adj_lock);
+	if (lmk_adj_index_ready)
+		list_move_tail(&p->lmk_adj_node,
+			&lmk_adj_buckets[lmk_adj_bucket(p->signal->oom_score_adj)]);
+	spin_unlock(&lmk_adj_lock);
+}
+
+void lmk_adj_index_del(struct task_struct *p)
+{
+	spin_lock(&lmk_adj_lock);
+	list_del_init(&p->lmk_adj_node);
+	spin_unlock(&lmk_adj_lock);
+}
+
+void lmk_adj_index_update(struct task_struct *p)
+{
+	struct task_struct *leader;
+
+	rcu_read_lock();
+	leader = p->group_leader;
+	spin_lock(&lmk_adj_lock);
+	if (!list_empty(&leader->lmk_adj_node))
+		list_move_tail(&leader->lmk_adj_node,
+			&lmk_adj_buckets[lmk_adj_bucket(p->signal->oom_score_adj)]);
+	spin_unlock(&lmk_adj_lock);
+	rcu_read_unlock();
+}
+
+static void lmk_adj_index_init(void)
+{
+	struct task_struct *p;
+	int i;
+
+	for (i = 0; i < LMK_ADJ_BUCKETS; i++)
+		INIT_LIST_HEAD(&lmk_adj_buckets[i]);
+
+	spin_lock(&lmk_adj_lock);
+	lmk_adj_index_ready = true;
+	spin_unlock(&lmk_adj_lock);
+
+	/* tasks forked from now on add themselves, adding twice is fine */
+	read_lock(&tasklist_lock);
+	for_each_process(p)
+		lmk_adj_index_add(p);
+	read_unlock(&tasklist_lock);
+}
+
+static void lmk_queue_kill(void)
+{
+	if (!lmk_kill_task || atomic64_read(&lmk_kill_queued))
+		return;
+
+	if (!atomic64_cmpxchg(&lmk_kill_queued, 0, ktime_to_ns(ktime_get())))
+		wake_up(&lmk_kill_wait);
+}
+
+/*
+ * Pick the task with the highest oom_score_adj >= min_score_adj, the
+ * largest one on ties. Returns it with a reference held, NULL if there is
+ * none, or ERR_PTR(-EAGAIN) while a previous victim is still exiting.
+ */
+static struct task_struct *lmk_select_victim(short min_score_adj,
+					     int *selected_tasksize,
+					     short *selected_oom_score_adj)
+{
+	struct task_struct *tsk, *next, *p;
+	struct task_struct *selected = NULL;
+	short oom_score_adj;
+	int tasksize;
+	int i;
+
+	rcu_read_lock();
+	spin_lock(&lmk_adj_lock);
+	for (i = LMK_ADJ_BUCKETS - 1;
+	     i >= lmk_adj_bucket(min_score_adj) && !selected; i--) {
+		list_for_each_entry_safe(tsk, next, &lmk_adj_buckets[i],
+					 lmk_adj_node) {
+			if (time_before_eq(jiffies, lowmem_deathpending_timeout) &&
+			    test_task_flag(tsk, TIF_MEMDIE)) {
+				selected = ERR_PTR(-EAGAIN);
+				goto out;
+			}
+
+			p = find_lock_task_mm(tsk);
+			if (!p)
+				continue;
+
+			oom_score_adj = p->signal->oom_score_adj;
+			if (oom_score_adj < min_score_adj) {
+				task_unlock(p);
+				continue;
+			}
+#ifdef CONFIG_LMK_ZYGOTE_PROTECT
+			if (!strncmp("main", p->comm, 4) &&
+			    p->parent->pid == 1 &&
+			    oom_score_adj != OOM_SCORE_ADJ_MIN) {
+				p->signal->oom_score_adj = OOM_SCORE_ADJ_MIN;
+				task_unlock(p);
+				list_move_tail(&tsk->lmk_adj_node,
+					&lmk_adj_buckets[lmk_adj_bucket(OOM_SCORE_ADJ_MIN)]);
+				lowmem_print(2, "reset the '%s' (%d) adj values: oom_score_adj %d, oom_adj %d\n",
+					p->comm, p->pid, OOM_SCORE_ADJ_MIN,
+					REVERT_ADJ(OOM_SCORE_ADJ_MIN));
+				continue;
+			}
+#endif
+			tasksize = get_mm_rss(p->mm);
+			task_unlock(p);
+			if (tasksize <= 0)
+				continue;
+			if (selected) {
+				if (oom_score_adj < *selected_oom_score_adj)
+					continue;
+				if (oom_score_adj == *selected_oom_score_adj &&
+				    tasksize <= *selected_tasksize)
+					continue;
+			}
+			selected = p;
+			*selected_tasksize = tasksize;
+			*selected_oom_score_adj = oom_score_adj;
+		}
+	}
+	if (selected)
+		get_task_struct(selected);
+out:
+	spin_unlock(&lmk_adj_lock);
+	rcu_read_unlock();
+
+	return selected;
+}
+
+static void lmk_kill(ktime_t queued)
+{
+	struct shrink_control sc = {
+		.gfp_mask = GFP_HIGHUSER_MOVABLE,
+	};
+	struct task_struct *selected;
+	int other_free, other_file;
+	int minfree, selected_tasksize = 0;
+	short min_score_adj, selected_oom_score_adj = 0;
+	long cache_size, cache_limit, free;
+	s64 latency_us;
+
+	lowmem_other_pages(&other_free, &other_file);
+	tune_lmk_param(&other_free, &other_file, &sc);
+	min_score_adj = lowmem_min_score_adj(other_free, other_file, &minfree);
+	adjust_minadj(&min_score_adj);
+	if (min_score_adj == OOM_SCORE_ADJ_MAX + 1)
+		return;
+
+	selected = lmk_select_victim(min_score_adj, &selected_tasksize,
+				     &selected_oom_score_adj);
+	if (IS_ERR_OR_NULL(selected)) {
+		/* give the system time to free up the memory */
+		if (selected)
+			msleep_interruptible(20);
+		return;
+	}
+
+	cache_size = other_file * (long)(PAGE_SIZE / 1024);
+	cache_limit = minfree * (long)(PAGE_SIZE / 1024);
+	free = other_free * (long)(PAGE_SIZE / 1024);
+	latency_us = ktime_us_delta(ktime_get(), queued);
+
+	lowmem_print(1, "Killing '%s' (%d), adj %hd,\n" \
+			"   to free %ldkB because\n" \
+			"   cache %ldkB is below limit %ldkB for oom_score_adj %hd\n" \
+			"   Free memory is %ldkB above reserved.\n" \
+			"   Kill requested %lldus ago\n",
+		     selected->comm, selected->pid, selected_oom_score_adj,
+		     selected_tasksize * (long)(PAGE_SIZE / 1024),
+		     cache_size, cache_limit, min_score_adj, free, latency_us);
+
+	lowmem_deathpending_timeout = jiffies + HZ;
+	mark_tsk_oom_victim(selected);
+	send_sig(SIGKILL, selected, 0);
+	set_tsk_thread_flag(selected, TIF_MEMDIE);
+
+	trace_lowmemory_kill(selected, cache_size, cache_limit, free);
+	trace_lowmemory_kill_latency(selected, selected_oom_score_adj,
+			selected_tasksize * (long)(PAGE_SIZE / 1024),
+			latency_us);
+	put_task_struct(selected);
+
+	/* give the system time to free up the memory */
+	msleep_interruptible(20);
+}
+
+static int lmk_kill_thread(void *unused)
+{
+	s64 queued;
+
+	while (!kthread_should_stop()) {
+		wait_event_interruptible(lmk_kill_wait,
+				atomic64_read(&lmk_kill_queued) ||
+				kthread_should_stop());
+
+		queued = atomic64_xchg(&lmk_kill_queued, 0);
+		if (queued)
+			lmk_kill(ns_to_ktime(queued));
+	}
+
+	return 0;
+}
+
+/* reclaim only requests a kill, the task walk happens in lmk_kill_task */
+static int lowmem_shrink_queue(struct shrink_control *sc)
+{
+	int other_free, other_file, minfree;
+	int rem;
+
+	rem = global_page_state(NR_ACTIVE_ANON) +
+		global_page_state(NR_ACTIVE_FILE) +
+		global_page_state(NR_INACTIVE_ANON) +
+		global_page_state(NR_INACTIVE_FILE);
+	if (sc->nr_to_scan <= 0)
+		return rem;
+
+	lowmem_other_pages(&other_free, &other_file);
+	tune_lmk_param(&other_free, &other_file, sc);
+	if (lowmem_min_score_adj(other_free, other_file, &minfree) !=
+			OOM_SCORE_ADJ_MAX + 1 || atomic_read(&shift_adj))
+		lmk_queue_kill();
+
+	return rem;
+}
+#endif
+
 static int lowmem_shrink(struct shrinker *s, struct shrink_control *sc)
 {
 	struct task_struct *tsk;
 	struct task_struct *selected = NULL;
 	int rem = 0;
 	int tasksize;
-	int i;
 	int ret = 0;
-	short min_score_adj = OOM_SCORE_ADJ_MAX + 1;
+	short min_score_adj;
 	int minfree = 0;
 	int selected_tasksize = 0;
 	short selected_oom_score_adj;
-	int array_size = ARRAY_SIZE(lowmem_adj);
 	int other_free;
 	int other_file;
 	unsigned long nr_to_scan = sc->nr_to_scan;
 
+#ifdef CONFIG_ANDROID_LMK_KILL_QUEUE
+	if (lmk_kill_task)
+		return lowmem_shrink_queue(sc);
+#endif
+
 	if (nr_to_scan > 0) {
 		if (mutex_lock_interruptible(&scan_mutex) < 0)
 			return 0;
 	}
 
-	other_free = global_page_state(NR_FREE_PAGES);
-
-	if (global_page_state(NR_SHMEM) + global_page_state(NR_MLOCK) + total_swapcache_pages() <
-		global_page_state(NR_FILE_PAGES))
-		other_file = global_page_state(NR_FILE_PAGES) -
-						global_page_state(NR_SHMEM) -
-						global_page_state(NR_MLOCK) -
-						total_swapcache_pages();
-	else
-		other_file = 0;
-
+	lowmem_other_pages(&other_free, &other_file);
 	tune_lmk_param(&other_free, &other_file, sc);
+	min_score_adj = lowmem_min_score_adj(other_free, other_file, &minfree);
 
-	if (lowmem_adj_size < array_size)
-		array_size = lowmem_adj_size;
-	if (lowmem_minfree_size < array_size)
-		array_size = lowmem_minfree_size;
-	for (i = 0; i < array_size; i++) {
-		minfree = lowmem_minfree[i];
-		if (other_free < minfree && other_file < minfree) {
-			min_score_adj = lowmem_adj[i];
-			break;
-		}
-	}
 	if (nr_to_scan > 0) {
 		ret = adjust_minadj(&min_score_adj);
 		lowmem_print(3, "lowmem_shrink %lu, %x, ofree %d %d, ma %hd\n",
@@ -618,6 +906,16 @@ static struct shrinker lowmem_shrinker = {
 
 static int __init lowmem_init(void)
 {
+#ifdef CONFIG_ANDROID_LMK_KILL_QUEUE
+	struct task_struct *task;
+
+	lmk_adj_index_init();
+	task = kthread_run(lmk_kill_thread, NULL, "lmk_kill");
+	if (IS_ERR(task))
+		pr_err("failed to start kill thread, falling back to the shrinker scan\n");
+	else
+		lmk_kill_task = task;
+#endif
 	register_shrinker(&lowmem_shrinker);
 	vmpressure_notifier_register(&lmk_vmpr_nb);
 	return 0;
@@ -626,6 +924,10 @@ static int __init lowmem_init(void)
 static void __exit lowmem_exit(void)
 {
 	unregister_shrinker(&lowmem_shrinker);
+#ifdef CONFIG_ANDROID_LMK_KILL_QUEUE
+	if (lmk_kill_task)
+		kthread_stop(lmk_kill_task);
+#endif
 }
 
 #ifdef CONFIG_ANDROID_LOW_MEMORY_KILLER_AUTODETECT_OOM_ADJ_VALUES
@@ -40,6 +40,13 @@ static DEFINE_SPINLOCK(sync_timeline_list_lock);
 static LIST_HEAD(sync_fence_list_head);
 static DEFINE_SPINLOCK(sync_fence_list_lock);
 
+/*
+ * Compositing creates and merges fences at a high rate, so they get their
+ * own cache. sync_pts are driver subclasses of varying size and stay on
+ * the kmalloc caches.
+ */
+static struct kmem_cache *sync_fence_cachep;
+
 struct sync_timeline *sync_timeline_create(const struct sync_timeline_ops *ops,
 					   int size, const char *name)
 {
@@ -254,7 +261,7 @@ static struct sync_fence *sync_fence_alloc(const char *name)
 	struct sync_fence *fence;
 	unsigned long flags;
 
-	fence = kzalloc(sizeof(struct sync_fence), GFP_KERNEL);
+	fence = kmem_cache_zalloc(sync_fence_cachep, GFP_KERNEL);
 	if (fence == NULL)
 		return NULL;
 
@@ -279,7 +286,7 @@ static struct sync_fence *sync_fence_alloc(const char *name)
 	return fence;
 
 err:
-	kfree(fence);
+	kmem_cache_free(sync_fence_cachep, fence);
 	return NULL;
 }
 
@@ -309,15 +316,24 @@ struct sync_fence *sync_fence_create(const char *name, struct sync_pt *pt)
 }
 EXPORT_SYMBOL(sync_fence_create);
 
-static int sync_fence_copy_pts(struct sync_fence *dst, struct sync_fence *src)
+/*
+ * pts that have already signaled add nothing to a merged fence, so they
+ * are not copied unless @all is set. A stale status only costs a dup.
+ */
+static int sync_fence_copy_pts(struct sync_fence *dst, struct sync_fence *src,
+			       bool all)
 {
 	struct list_head *pos;
 
 	list_for_each(pos, &src->pt_list_head) {
 		struct sync_pt *orig_pt =
 			container_of(pos, struct sync_pt, pt_list);
-		struct sync_pt *new_pt = sync_pt_dup(orig_pt);
+		struct sync_pt *new_pt;
 
+		if (!all && orig_pt->status == 1)
+			continue;
+
+		new_pt = sync_pt_dup(orig_pt);
 		if (new_pt == NULL)
 			return -ENOMEM;
 
@@ -337,6 +353,9 @@ static int sync_fence_merge_pts(struct sync_fence *dst, struct sync_fence *src)
 			container_of(src_pos, struct sync_pt, pt_list);
 		bool collapsed = false;
 
+		if (src_pt->status == 1)
+			continue;
+
 		list_for_each_safe(dst_pos, n, &dst->pt_list_head) {
 			struct sync_pt *dst_pt =
 				container_of(dst_pos, struct sync_pt, pt_list);
@@ -455,11 +474,25 @@ struct sync_fence *sync_fence_merge(const char *name,
 	struct list_head *pos;
 	int err;
 
+	/*
+	 * Merging with a fence that has signaled without error yields the
+	 * other fence, so hand that out again instead of building a copy.
+	 * The caller gets a new reference either way.
+	 */
+	if (a->status == 1) {
+		get_file(b->file);
+		return b;
+	}
+	if (b->status == 1) {
+		get_file(a->file);
+		return a;
+	}
+
 	fence = sync_fence_alloc(name);
 	if (fence == NULL)
 		return NULL;
 
-	err = sync_fence_copy_pts(fence, a);
+	err = sync_fence_copy_pts(fence, a, false);
 	if (err < 0)
 		goto err;
 
@@ -467,6 +500,13 @@ struct sync_fence *sync_fence_merge(const char *name,
 	if (err < 0)
 		goto err;
 
+	/* Everything signaled while we looked, a fence needs one pt */
+	if (list_empty(&fence->pt_list_head)) {
+		err = sync_fence_copy_pts(fence, a, true);
+		if (err < 0)
+			goto err;
+	}
+
 	list_for_each(pos, &fence->pt_list_head) {
 		struct sync_pt *pt =
 			container_of(pos, struct sync_pt, pt_list);
@@ -484,7 +524,7 @@ struct sync_fence *sync_fence_merge(const char *name,
 	return fence;
 err:
 	sync_fence_free_pts(fence);
-	kfree(fence);
+	kmem_cache_free(sync_fence_cachep, fence);
 	return NULL;
 }
 EXPORT_SYMBOL(sync_fence_merge);
@@ -498,6 +538,10 @@ static void sync_fence_signal_pt(struct sync_pt *pt)
 	unsigned long flags;
 	int status;
 
+	/* Already signaled through another of its pts */
+	if (fence->status)
+		return;
+
 	status = sync_fence_get_status(fence);
 
 	spin_lock_irqsave(&fence->waiter_list_lock, flags);
@@ -524,7 +568,11 @@ static void sync_fence_signal_pt(struct sync_pt *pt)
 			list_del(pos);
 			waiter->callback(fence, waiter);
 		}
-		wake_up(&fence->wq);
+
+		/* Most fences are only waited on asynchronously or polled */
+		smp_mb();
+		if (waitqueue_active(&fence->wq))
+			wake_up(&fence->wq);
 	}
 }
 
@@ -709,7 +757,7 @@ static void sync_fence_free(struct kref *kref)
 
 	sync_fence_free_pts(fence);
 
-	kfree(fence);
+	kmem_cache_free(sync_fence_cachep, fence);
 }
 
 static int sync_fence_release(struct inode *inode, struct file *file)
@@ -916,6 +964,13 @@ static long sync_fence_ioctl(struct file *file, unsigned int cmd,
 	}
 }
 
+static int __init sync_init(void)
+{
+	sync_fence_cachep = KMEM_CACHE(sync_fence, SLAB_PANIC);
+	return 0;
+}
+core_initcall(sync_init);
+
 #ifdef CONFIG_DEBUG_FS
 static void sync_print_pt(struct seq_file *s, struct sync_pt *pt, bool fence)
 {
@@ -0,0 +1,200 @@
+/*
+ * drivers/staging/android/sync_kbench.c
+ *
+ * Copyright (C) 2016 HTC Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * Fence benchmarks on a private sw_sync timeline:
+ *
+ *  create - create a fence on a new pt.
+ *  merge  - merge n + 1 pending fences into one, n merges.
+ *  signal - signal n pending fences with one timeline increment.
+ *
+ * Fences are put right away, their files are released when the run
+ * returns to user space.
+ */
+
+#include <linux/kbench.h>
+#include <linux/module.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+#include <linux/sw_sync.h>
+
+#define SYNC_KBENCH_MAX_N	64
+
+enum {
+	SYNC_KBENCH_CREATE,
+	SYNC_KBENCH_MERGE,
+	SYNC_KBENCH_SIGNAL,
+};
+
+struct sync_kbench {
+	struct sw_sync_timeline *obj;
+	int mode;
+	unsigned int nr;
+	struct sync_fence *fences[SYNC_KBENCH_MAX_N + 1];
+	struct sync_fence *merged;
+};
+
+static struct sync_fence *sync_kbench_fence(struct sync_kbench *sb, u32 value)
+{
+	struct sync_fence *fence;
+	struct sync_pt *pt;
+
+	pt = sw_sync_pt_create(sb->obj, value);
+	if (!pt)
+		return NULL;
+
+	fence = sync_fence_create("kbench", pt);
+	if (!fence)
+		sync_pt_free(pt);
+	return fence;
+}
+
+static void sync_kbench_put_all(struct sync_kbench *sb)
+{
+	unsigned int i;
+
+	for (i = 0; i < sb->nr; i++)
+		sync_fence_put(sb->fences[i]);
+	sb->nr = 0;
+
+	if (sb->merged)
+		sync_fence_put(sb->merged);
+	sb->merged = NULL;
+}
+
+static int sync_kbench_setup(struct kbench_ctx *ctx)
+{
+	struct sync_kbench *sb;
+
+	if (!ctx->n || ctx->n > SYNC_KBENCH_MAX_N)
+		return -EINVAL;
+
+	sb = kzalloc(sizeof(*sb), GFP_KERNEL);
+	if (!sb)
+		return -ENOMEM;
+
+	if (!ctx->mode[0] || !strcmp(ctx->mode, "create"))
+		sb->mode = SYNC_KBENCH_CREATE;
+	else if (!strcmp(ctx->mode, "merge"))
+		sb->mode = SYNC_KBENCH_MERGE;
+	else if (!strcmp(ctx->mode, "signal"))
+		sb->mode = SYNC_KBENCH_SIGNAL;
+	else
+		goto err;
+
+	sb->obj = sw_sync_timeline_create("kbench");
+	if (!sb->obj)
+		goto err;
+
+	ctx->priv = sb;
+	return 0;
+err:
+	kfree(sb);
+	return -EINVAL;
+}
+
+static int sync_kbench_prepare(struct kbench_ctx *ctx, unsigned int i)
+{
+	struct sync_kbench *sb = ctx->priv;
+	unsigned int nr;
+
+	switch (sb->mode) {
+	case SYNC_KBENCH_MERGE:
+		nr = ctx->n + 1;
+		break;
+	case SYNC_KBENCH_SIGNAL:
+		nr = ctx->n;
+		break;
+	default:
+		return 0;
+	}
+
+	/* Merge on distinct values so that no pt gets dropped */
+	while (sb->nr < nr) {
+		u32 value = sb->obj->value + 1;
+
+		if (sb->mode == SYNC_KBENCH_MERGE)
+			value += sb->nr;
+		sb->fences[sb->nr] = sync_kbench_fence(sb, value);
+		if (!sb->fences[sb->nr])
+			return -ENOMEM;
+		sb->nr++;
+	}
+	return 0;
+}
+
+static int sync_kbench_op(struct kbench_ctx *ctx, unsigned int i)
+{
+	struct sync_kbench *sb = ctx->priv;
+	struct sync_fence *fence;
+	unsigned int j;
+
+	switch (sb->mode) {
+	case SYNC_KBENCH_MERGE:
+		sb->merged = sync_fence_merge("kbench", sb->fences[0],
+					      sb->fences[1]);
+		for (j = 2; sb->merged && j < sb->nr; j++) {
+			fence = sync_fence_merge("kbench", sb->merged,
+						 sb->fences[j]);
+			sync_fence_put(sb->merged);
+			sb->merged = fence;
+		}
+		return sb->merged ? 0 : -ENOMEM;
+	case SYNC_KBENCH_SIGNAL:
+		sw_sync_timeline_inc(sb->obj, 1);
+		return 0;
+	default:
+		sb->merged = sync_kbench_fence(sb, sb->obj->value + 1);
+		return sb->merged ? 0 : -ENOMEM;
+	}
+}
+
+static void sync_kbench_post(struct kbench_ctx *ctx, unsigned int i)
+{
+	struct sync_kbench *sb = ctx->priv;
+
+	switch (sb->mode) {
+	case SYNC_KBENCH_MERGE:
+		sw_sync_timeline_inc(sb->obj, sb->nr);
+		break;
+	case SYNC_KBENCH_CREATE:
+		sw_sync_timeline_inc(sb->obj, 1);
+		break;
+	}
+	sync_kbench_put_all(sb);
+}
+
+static void sync_kbench_teardown(struct kbench_ctx *ctx)
+{
+	struct sync_kbench *sb = ctx->priv;
+
+	sync_kbench_put_all(sb);
+	sync_timeline_destroy(&sb->obj->obj);
+	kfree(sb);
+}
+
+static struct kbench sync_kbench = {
+	.name		= "fence",
+	.help		= "mode=create|merge|signal n=fences (max 64)",
+	.setup		= sync_kbench_setup,
+	.prepare	= sync_kbench_prepare,
+	.op		= sync_kbench_op,
+	.post		= sync_kbench_post,
+	.teardown	= sync_kbench_teardown,
+};
+
+static int __init sync_kbench_init(void)
+{
+	return kbench_register(&sync_kbench);
+}
+late_initcall(sync_kbench_init);
@@ -34,6 +34,32 @@ TRACE_EVENT(lowmemory_kill,
 		__entry->pagecache_limit, __entry->free)
 );
 
+TRACE_EVENT(lowmemory_kill_latency,
+	TP_PROTO(struct task_struct *killed_task, short oom_score_adj,
+		 long rss, s64 latency_us),
+
+	TP_ARGS(killed_task, oom_score_adj, rss, latency_us),
+
+	TP_STRUCT__entry(
+			__array(char, comm, TASK_COMM_LEN)
+			__field(pid_t, pid)
+			__field(short, oom_score_adj)
+			__field(long, rss)
+			__field(s64, latency_us)
+	),
+
+	TP_fast_assign(
+			memcpy(__entry->comm, killed_task->comm, TASK_COMM_LEN);
+			__entry->pid = killed_task->pid;
+			__entry->oom_score_adj = oom_score_adj;
+			__entry->rss = rss;
+			__entry->latency_us = latency_us;
+	),
+
+	TP_printk("%s (%d), adj %hd, rss %ldkB, %lldus after the request",
+		__entry->comm, __entry->pid, __entry->oom_score_adj,
+		__entry->rss, __entry->latency_us)
+);
 
 #endif /* if !defined(_TRACE_LOWMEMORYKILLER_H) || defined(TRACE_HEADER_MULTI_READ) */
 
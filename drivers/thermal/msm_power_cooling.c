@@ -0,0 +1,464 @@
+/* Copyright (c) 2016, HTC Corporation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * Shared cpu and GPU power cooling device.
+ *
+ * A single cooling device covers every cpufreq cluster and the GPU.
+ * Each cooling state is a fraction of the power the SoC can draw:
+ *
+ *	budget = max_power * (max_state - state) / max_state
+ *
+ * While the state is non zero the budget is reallocated every poll_ms.
+ * Each device requests the power it draws now, its power at the current
+ * frequency times its utilization, and the request is weighted by the
+ * utilization again, so that a mostly idle device gets a smaller share
+ * and is throttled first. Power a device cannot use at its max frequency
+ * is handed to the others. Each device is then capped to the highest
+ * frequency at which its current load fits in its share.
+ *
+ * cpu power comes from the get_cpu_pwr_stats() tables, GPU power from
+ * the qcom,gpu-freq-power table (<Hz uW> pairs in ascending order, the
+ * frequencies matching the GPU pwrlevels). All powers are in uW.
+ */
+
+#define pr_fmt(fmt) "power-cooling: " fmt
+
+#include <linux/cpu.h>
+#include <linux/cpufreq.h>
+#include <linux/err.h>
+#include <linux/module.h>
+#include <linux/msm_kgsl.h>
+#include <linux/mutex.h>
+#include <linux/of.h>
+#include <linux/platform_device.h>
+#include <linux/slab.h>
+#include <linux/thermal.h>
+#include <linux/workqueue.h>
+
+#define POWER_COOLING_NAME	"msm-power-cooling"
+#define DEFAULT_MAX_STATE	10
+#define DEFAULT_POLL_MS		100
+
+/**
+ * struct power_actor - a device sharing the power budget
+ * @cpus:	cpus of a cluster, empty for the GPU
+ * @ptable:	power at each frequency, the cpu pwr stats of the first cpu
+ *		for a cluster
+ * @len:	number of entries in @ptable
+ * @util:	utilization in percent over the last period
+ * @req:	power drawn at the current frequency
+ * @max_power:	power the current load would draw at the max frequency
+ * @granted:	share of the budget
+ * @cap:	frequency limit, 0 when not limited
+ */
+struct power_actor {
+	cpumask_t cpus;
+	struct cpu_pstate_pwr *ptable;
+	int len;
+	uint32_t util;
+	uint32_t req;
+	uint32_t max_power;
+	uint32_t granted;
+	unsigned int cap;
+};
+
+struct power_cooling {
+	struct thermal_cooling_device *cdev;
+	struct delayed_work work;
+	struct mutex lock;
+	unsigned long state;
+	unsigned long max_state;
+	unsigned int poll_ms;
+	uint32_t max_power;
+	struct power_actor actors[NR_CPUS + 1];
+	int nr_clusters;
+	struct power_actor *gpu;
+	void *gpu_limit;
+	u64 prev_idle[NR_CPUS];
+	u64 prev_wall[NR_CPUS];
+	uint32_t cpu_util[NR_CPUS];
+};
+
+static struct power_cooling *pcool;
+static unsigned int cpu_cap[NR_CPUS];
+
+static uint32_t ptable_power(struct cpu_pstate_pwr *ptable, int len,
+		unsigned int freq)
+{
+	int i;
+
+	for (i = 0; i < len - 1; i++)
+		if (ptable[i].freq >= freq)
+			break;
+	return ptable[i].power;
+}
+
+/* power of @actor at @freq with its current load */
+static uint32_t actor_power(struct power_actor *actor, unsigned int freq)
+{
+	uint32_t power, total = 0;
+	int cpu;
+
+	power = ptable_power(actor->ptable, actor->len, freq);
+	if (actor == pcool->gpu)
+		return power * actor->util / 100;
+
+	for_each_cpu_and(cpu, &actor->cpus, cpu_online_mask)
+		total += power * pcool->cpu_util[cpu] / 100;
+	return total;
+}
+
+static void update_cpu_util(void)
+{
+	u64 idle, wall, d_idle, d_wall;
+	int cpu;
+
+	for_each_online_cpu(cpu) {
+		idle = get_cpu_idle_time(cpu, &wall, 0);
+		d_idle = idle - pcool->prev_idle[cpu];
+		d_wall = wall - pcool->prev_wall[cpu];
+		pcool->prev_idle[cpu] = idle;
+		pcool->prev_wall[cpu] = wall;
+
+		if (!d_wall || d_idle >= d_wall)
+			pcool->cpu_util[cpu] = 0;
+		else
+			pcool->cpu_util[cpu] = div64_u64((d_wall - d_idle) * 100,
+							 d_wall);
+	}
+}
+
+static void update_requests(void)
+{
+	struct power_actor *actor;
+	int i, cpu;
+
+	update_cpu_util();
+	for (i = 0; i < pcool->nr_clusters; i++) {
+		actor = &pcool->actors[i];
+		actor->util = 0;
+		for_each_cpu_and(cpu, &actor->cpus, cpu_online_mask)
+			actor->util = max(actor->util, pcool->cpu_util[cpu]);
+
+		cpu = cpumask_any_and(&actor->cpus, cpu_online_mask);
+		if (cpu >= nr_cpu_ids) {
+			actor->req = actor->max_power = 0;
+			continue;
+		}
+		actor->req = actor_power(actor, cpufreq_quick_get(cpu));
+		actor->max_power = actor_power(actor,
+					actor->ptable[actor->len - 1].freq);
+	}
+
+	actor = pcool->gpu;
+	if (!actor)
+		return;
+	if (IS_ERR_OR_NULL(pcool->gpu_limit))
+		pcool->gpu_limit = kgsl_pwr_limits_add(KGSL_DEVICE_3D0);
+	if (IS_ERR_OR_NULL(pcool->gpu_limit)) {
+		actor->util = actor->req = actor->max_power = 0;
+		return;
+	}
+	/* the thermal limit stands in for the current GPU frequency */
+	actor->util = kgsl_pwr_limits_get_busy(KGSL_DEVICE_3D0);
+	actor->req = actor_power(actor,
+				 kgsl_pwr_limits_get_freq(KGSL_DEVICE_3D0));
+	actor->max_power = actor_power(actor,
+				       actor->ptable[actor->len - 1].freq);
+}
+
+static void allocate_power(uint32_t budget)
+{
+	struct power_actor *actor;
+	u64 weighted[NR_CPUS + 1], total_weighted = 0;
+	uint32_t extra = 0, total_room = 0;
+	int i, nr = pcool->nr_clusters + (pcool->gpu ? 1 : 0);
+
+	for (i = 0; i < nr; i++) {
+		actor = &pcool->actors[i];
+		weighted[i] = (u64)actor->req * actor->util;
+		total_weighted += weighted[i];
+	}
+
+	for (i = 0; i < nr; i++) {
+		actor = &pcool->actors[i];
+		if (total_weighted)
+			actor->granted = div64_u64(budget * weighted[i],
+						   total_weighted);
+		else
+			actor->granted = actor->max_power;
+		if (actor->granted > actor->max_power) {
+			extra += actor->granted - actor->max_power;
+			actor->granted = actor->max_power;
+		}
+		total_room += actor->max_power - actor->granted;
+	}
+
+	/* hand the power some devices cannot use to the others */
+	for (i = 0; extra && total_room && i < nr; i++) {
+		actor = &pcool->actors[i];
+		actor->granted += div_u64((u64)extra *
+				(actor->max_power - actor->granted),
+				total_room);
+	}
+}
+
+static unsigned int actor_cap(struct power_actor *actor)
+{
+	int i;
+
+	for (i = actor->len - 1; i > 0; i--)
+		if (actor_power(actor, actor->ptable[i].freq) <= actor->granted)
+			break;
+
+	return i == actor->len - 1 ? 0 : actor->ptable[i].freq;
+}
+
+static void apply_caps(void)
+{
+	struct power_actor *actor;
+	unsigned int cap;
+	int i, cpu;
+
+	for (i = 0; i < pcool->nr_clusters; i++) {
+		actor = &pcool->actors[i];
+		cap = pcool->state ? actor_cap(actor) : 0;
+		if (cap == actor->cap)
+			continue;
+		actor->cap = cap;
+		for_each_cpu_mask(cpu, actor->cpus)
+			cpu_cap[cpu] = cap;
+		pr_debug("cluster%d util:%u req:%u granted:%u cap:%u\n", i,
+			 actor->util, actor->req, actor->granted, cap);
+
+		cpu = cpumask_any_and(&actor->cpus, cpu_online_mask);
+		if (cpu < nr_cpu_ids)
+			cpufreq_update_policy(cpu);
+	}
+
+	actor = pcool->gpu;
+	if (!actor || IS_ERR_OR_NULL(pcool->gpu_limit))
+		return;
+	cap = pcool->state ? actor_cap(actor) : 0;
+	if (cap == actor->cap)
+		return;
+	actor->cap = cap;
+	pr_debug("gpu util:%u req:%u granted:%u cap:%u\n", actor->util,
+		 actor->req, actor->granted, cap);
+	if (cap)
+		kgsl_pwr_limits_set_freq(pcool->gpu_limit, cap);
+	else
+		kgsl_pwr_limits_set_default(pcool->gpu_limit);
+}
+
+static void power_cooling_work(struct work_struct *work)
+{
+	uint32_t budget;
+
+	mutex_lock(&pcool->lock);
+	get_online_cpus();
+	if (pcool->state) {
+		update_requests();
+		budget = div_u64((u64)pcool->max_power *
+				 (pcool->max_state - pcool->state),
+				 pcool->max_state);
+		allocate_power(budget);
+	}
+	apply_caps();
+	put_online_cpus();
+
+	if (pcool->state)
+		schedule_delayed_work(&pcool->work,
+				      msecs_to_jiffies(pcool->poll_ms));
+	mutex_unlock(&pcool->lock);
+}
+
+static int power_cooling_notifier(struct notifier_block *nb,
+		unsigned long event, void *data)
+{
+	struct cpufreq_policy *policy = data;
+
+	if (event != CPUFREQ_ADJUST || !cpu_cap[policy->cpu])
+		return NOTIFY_OK;
+
+	cpufreq_verify_within_limits(policy, 0, cpu_cap[policy->cpu]);
+	return NOTIFY_OK;
+}
+
+static struct notifier_block power_cooling_nb = {
+	.notifier_call = power_cooling_notifier,
+};
+
+static int power_cooling_get_max_state(struct thermal_cooling_device *cdev,
+		unsigned long *state)
+{
+	*state = pcool->max_state;
+	return 0;
+}
+
+static int power_cooling_get_cur_state(struct thermal_cooling_device *cdev,
+		unsigned long *state)
+{
+	*state = pcool->state;
+	return 0;
+}
+
+static int power_cooling_set_cur_state(struct thermal_cooling_device *cdev,
+		unsigned long state)
+{
+	if (state > pcool->max_state)
+		return -EINVAL;
+
+	mutex_lock(&pcool->lock);
+	pcool->state = state;
+	mutex_unlock(&pcool->lock);
+	mod_delayed_work(system_wq, &pcool->work, 0);
+
+	return 0;
+}
+
+static struct thermal_cooling_device_ops power_cooling_ops = {
+	.get_max_state = power_cooling_get_max_state,
+	.get_cur_state = power_cooling_get_cur_state,
+	.set_cur_state = power_cooling_set_cur_state,
+};
+
+static int power_cooling_add_clusters(void)
+{
+	struct cpu_pwr_stats *stats = get_cpu_pwr_stats();
+	struct cpufreq_policy *policy;
+	struct power_actor *actor;
+	cpumask_t done;
+	int cpu;
+
+	if (!stats)
+		return -EPROBE_DEFER;
+
+	cpumask_clear(&done);
+	for_each_possible_cpu(cpu) {
+		if (cpumask_test_cpu(cpu, &done))
+			continue;
+		policy = cpufreq_cpu_get(cpu);
+		if (!policy)
+			continue;
+		cpumask_or(&done, &done, policy->related_cpus);
+
+		if (stats[cpu].ptable && stats[cpu].len) {
+			actor = &pcool->actors[pcool->nr_clusters++];
+			cpumask_copy(&actor->cpus, policy->related_cpus);
+			actor->ptable = stats[cpu].ptable;
+			actor->len = stats[cpu].len;
+			pcool->max_power += cpumask_weight(&actor->cpus) *
+				actor->ptable[actor->len - 1].power;
+		}
+		cpufreq_cpu_put(policy);
+	}
+
+	return pcool->nr_clusters ? 0 : -EPROBE_DEFER;
+}
+
+static int power_cooling_add_gpu(struct device *dev)
+{
+	struct device_node *node = dev->of_node;
+	char *key = "qcom,gpu-freq-power";
+	struct power_actor *actor;
+	int i, len;
+
+	if (!of_get_property(node, key, &len))
+		return 0;
+	len /= 2 * sizeof(u32);
+	if (!len)
+		return -EINVAL;
+
+	actor = &pcool->actors[pcool->nr_clusters];
+	actor->ptable = devm_kzalloc(dev, len * sizeof(*actor->ptable),
+				     GFP_KERNEL);
+	if (!actor->ptable)
+		return -ENOMEM;
+	for (i = 0; i < len; i++) {
+		of_property_read_u32_index(node, key, 2 * i,
+					   &actor->ptable[i].freq);
+		of_property_read_u32_index(node, key, 2 * i + 1,
+					   &actor->ptable[i].power);
+	}
+	actor->len = len;
+	pcool->max_power += actor->ptable[len - 1].power;
+	pcool->gpu = actor;
+
+	return 0;
+}
+
+static int power_cooling_probe(struct platform_device *pdev)
+{
+	struct device_node *node = pdev->dev.of_node;
+	u32 val;
+	int ret;
+
+	pcool = devm_kzalloc(&pdev->dev, sizeof(*pcool), GFP_KERNEL);
+	if (!pcool)
+		return -ENOMEM;
+
+	pcool->max_state = DEFAULT_MAX_STATE;
+	if (!of_property_read_u32(node, "qcom,max-state", &val) && val)
+		pcool->max_state = val;
+	pcool->poll_ms = DEFAULT_POLL_MS;
+	if (!of_property_read_u32(node, "qcom,poll-ms", &val) && val)
+		pcool->poll_ms = val;
+
+	ret = power_cooling_add_clusters();
+	if (ret)
+		goto fail;
+	ret = power_cooling_add_gpu(&pdev->dev);
+	if (ret)
+		goto fail;
+
+	mutex_init(&pcool->lock);
+	INIT_DELAYED_WORK(&pcool->work, power_cooling_work);
+	cpufreq_register_notifier(&power_cooling_nb, CPUFREQ_POLICY_NOTIFIER);
+
+	pcool->cdev = thermal_cooling_device_register("msm-power", pcool,
+						      &power_cooling_ops);
+	if (IS_ERR(pcool->cdev)) {
+		ret = PTR_ERR(pcool->cdev);
+		cpufreq_unregister_notifier(&power_cooling_nb,
+					    CPUFREQ_POLICY_NOTIFIER);
+		goto fail;
+	}
+
+	dev_info(&pdev->dev, "%d clusters%s, max power %uuW\n",
+		 pcool->nr_clusters, pcool->gpu ? " and gpu" : "",
+		 pcool->max_power);
+	return 0;
+
+fail:
+	pcool = NULL;
+	return ret;
+}
+
+static const struct of_device_id power_cooling_match[] = {
+	{ .compatible = "qcom,msm-power-cooling" },
+	{},
+};
+
+static struct platform_driver power_cooling_driver = {
+	.driver = {
+		.owner = THIS_MODULE,
+		.name = POWER_COOLING_NAME,
+		.of_match_table = power_cooling_match,
+	},
+	.probe = power_cooling_probe,
+};
+
+static int __init power_cooling_init(void)
+{
+	return platform_driver_register(&power_cooling_driver);
+}
+late_initcall(power_cooling_init);
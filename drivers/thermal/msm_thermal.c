@@ -50,6 +50,7 @@
 #include <linux/delay.h>
 #include <linux/cpumask.h>
 #include <linux/suspend.h>
+#include <linux/msm_kgsl.h>
 
 #define CREATE_TRACE_POINTS
 #define TRACE_MSM_THERMAL
@@ -284,6 +285,42 @@ static struct cluster_info *core_ptr;
 static struct msm_thermal_debugfs_entry *msm_therm_debugfs;
 static struct devmgr_devices *devices;
 
+/*
+ * Power budget controller. A PID loop on the distance to the control
+ * temperature turns the sustainable power into a budget, which is split
+ * between the cpu clusters and the GPU in proportion to the power they
+ * currently draw, i.e. power at the current frequency times utilization.
+ * Each device then gets the highest frequency at which its current load
+ * fits in its share. All powers are in uW.
+ */
+struct power_budget {
+	bool enabled;
+	bool engaged;
+	uint32_t sustainable_power;
+	long control_temp;
+	long switch_on_temp;
+	const char *lmh_sensor;
+	int lmh_sensor_id;
+	struct cpu_pstate_pwr *gpu_ptable;
+	int gpu_len;
+	void *gpu_limit;
+	long err_integral;
+	long prev_err;
+	uint32_t cpu_util[NR_CPUS];
+	u64 prev_idle[NR_CPUS];
+	u64 prev_wall[NR_CPUS];
+};
+
+static struct power_budget budget = {
+	.lmh_sensor_id = -1,
+};
+static int budget_kp = 250000;
+static int budget_ki = 25000;
+static int budget_kd;
+module_param_named(budget_kp, budget_kp, int, 0644);
+module_param_named(budget_ki, budget_ki, int, 0644);
+module_param_named(budget_kd, budget_kd, int, 0644);
+
 struct vdd_rstr_enable {
 	struct kobj_attribute ko_attr;
 	uint32_t enabled;
@@ -2946,6 +2983,230 @@ static void lower_thermal_threshold(int threshold){
     msm_thermal_info.limit_temp_degC, msm_thermal_info.core_limit_temp_degC, msm_thermal_info.hotplug_temp_degC);
 }
 
+static void budget_update_cpu_util(void)
+{
+	u64 idle, wall, d_idle, d_wall;
+	int cpu;
+
+	for_each_online_cpu(cpu) {
+		idle = get_cpu_idle_time(cpu, &wall, 0);
+		d_idle = idle - budget.prev_idle[cpu];
+		d_wall = wall - budget.prev_wall[cpu];
+		budget.prev_idle[cpu] = idle;
+		budget.prev_wall[cpu] = wall;
+
+		if (!d_wall || d_idle >= d_wall)
+			budget.cpu_util[cpu] = 0;
+		else
+			budget.cpu_util[cpu] = div64_u64((d_wall - d_idle) * 100,
+							 d_wall);
+	}
+}
+
+static uint32_t budget_ptable_power(struct cpu_pstate_pwr *ptable, int len,
+		unsigned int freq)
+{
+	int i;
+
+	for (i = 0; i < len - 1; i++)
+		if (ptable[i].freq >= freq)
+			break;
+	return ptable[i].power;
+}
+
+static uint32_t budget_cluster_power(struct cpu_pwr_stats *stats,
+		struct cluster_info *cluster_ptr, unsigned int freq)
+{
+	uint32_t power = 0;
+	int cpu;
+
+	for_each_cpu_and(cpu, &cluster_ptr->cluster_cores, cpu_online_mask) {
+		if (!stats[cpu].ptable)
+			continue;
+		power += budget_ptable_power(stats[cpu].ptable, stats[cpu].len,
+					     freq) * budget.cpu_util[cpu] / 100;
+	}
+	return power;
+}
+
+static void budget_set_cluster_freq(struct cluster_info *cluster_ptr,
+		uint32_t max_freq)
+{
+	int cpu;
+
+	for_each_cpu_mask(cpu, cluster_ptr->cluster_cores) {
+		if (!(msm_thermal_info.bootup_freq_control_mask & BIT(cpu)))
+			continue;
+		if (cpus[cpu].limited_max_freq == max_freq)
+			continue;
+		cpus[cpu].limited_max_freq = max_freq;
+		if (!SYNC_CORE(cpu))
+			update_cpu_freq(cpu);
+	}
+}
+
+static void budget_release(void)
+{
+	uint32_t _cluster;
+
+	get_online_cpus();
+	for (_cluster = 0; _cluster < core_ptr->entity_count; _cluster++)
+		budget_set_cluster_freq(&core_ptr->child_entity_ptr[_cluster],
+					UINT_MAX);
+	update_cluster_freq();
+	put_online_cpus();
+
+#if IS_BUILTIN(CONFIG_MSM_KGSL)
+	if (!IS_ERR_OR_NULL(budget.gpu_limit))
+		kgsl_pwr_limits_set_default(budget.gpu_limit);
+#endif
+	budget.engaged = false;
+	budget.err_integral = 0;
+}
+
+#if IS_BUILTIN(CONFIG_MSM_KGSL)
+static uint32_t budget_gpu_request(uint32_t *util)
+{
+	if (!budget.gpu_ptable)
+		return 0;
+	if (IS_ERR_OR_NULL(budget.gpu_limit))
+		budget.gpu_limit = kgsl_pwr_limits_add(KGSL_DEVICE_3D0);
+	if (IS_ERR_OR_NULL(budget.gpu_limit))
+		return 0;
+
+	/* the thermal limit stands in for the current frequency */
+	*util = kgsl_pwr_limits_get_busy(KGSL_DEVICE_3D0);
+	return budget_ptable_power(budget.gpu_ptable, budget.gpu_len,
+			kgsl_pwr_limits_get_freq(KGSL_DEVICE_3D0)) * *util / 100;
+}
+
+static void budget_gpu_apply(uint32_t util, uint32_t req, uint32_t granted)
+{
+	int idx;
+
+	if (IS_ERR_OR_NULL(budget.gpu_limit))
+		return;
+
+	for (idx = budget.gpu_len - 1; idx > 0; idx--)
+		if (budget.gpu_ptable[idx].power * util / 100 <= granted)
+			break;
+
+	trace_thermal_power_actor("gpu", 0, util, req, granted,
+				  budget.gpu_ptable[idx].freq);
+	if (idx == budget.gpu_len - 1)
+		kgsl_pwr_limits_set_default(budget.gpu_limit);
+	else
+		kgsl_pwr_limits_set_freq(budget.gpu_limit,
+					 budget.gpu_ptable[idx].freq);
+}
+#else
+static uint32_t budget_gpu_request(uint32_t *util)
+{
+	return 0;
+}
+
+static void budget_gpu_apply(uint32_t util, uint32_t req, uint32_t granted)
+{
+}
+#endif
+
+static uint32_t budget_get_power(long temp, bool hw_limited)
+{
+	long err = budget.control_temp - temp;
+	long power;
+
+	/* don't wind up while the hardware limits are already in effect */
+	if (!hw_limited) {
+		budget.err_integral += budget_ki * err;
+		budget.err_integral = clamp_t(long, budget.err_integral,
+				-(long)budget.sustainable_power,
+				(long)budget.sustainable_power);
+	}
+
+	power = (long)budget.sustainable_power + budget_kp * err
+		+ budget.err_integral + budget_kd * (err - budget.prev_err);
+	budget.prev_err = err;
+
+	return power > 0 ? power : 0;
+}
+
+static void do_power_budget(long temp)
+{
+	struct cpu_pwr_stats *stats = get_cpu_pwr_stats();
+	struct cluster_info *cluster_ptr;
+	uint32_t req[NR_CPUS] = {0}, util[NR_CPUS] = {0};
+	uint32_t granted, total_req = 0, power, max_freq;
+	unsigned int freq;
+	uint32_t _cluster;
+	uint32_t gpu_util = 0, gpu_req;
+	long lmh_intensity = 0;
+	int cpu, idx;
+
+	budget_update_cpu_util();
+
+	if (temp < budget.switch_on_temp) {
+		if (budget.engaged)
+			budget_release();
+		budget.prev_err = budget.control_temp - temp;
+		return;
+	}
+	budget.engaged = true;
+
+	for (_cluster = 0; stats && _cluster < core_ptr->entity_count;
+			_cluster++) {
+		cluster_ptr = &core_ptr->child_entity_ptr[_cluster];
+		cpu = cpumask_any_and(&cluster_ptr->cluster_cores,
+				      cpu_online_mask);
+		if (cpu >= nr_cpu_ids || !cluster_ptr->freq_table)
+			continue;
+		req[_cluster] = budget_cluster_power(stats, cluster_ptr,
+						     cpufreq_quick_get(cpu));
+		util[_cluster] = budget.cpu_util[cpu];
+		total_req += req[_cluster];
+	}
+
+	gpu_req = budget_gpu_request(&gpu_util);
+	total_req += gpu_req;
+
+	/* LMH registers its sensors as thermal zones, possibly after us */
+	if (budget.lmh_sensor && budget.lmh_sensor_id < 0)
+		budget.lmh_sensor_id = sensor_get_id((char *)budget.lmh_sensor);
+	if (budget.lmh_sensor_id >= 0)
+		therm_get_temp(budget.lmh_sensor_id, THERM_ZONE_ID,
+			       &lmh_intensity);
+	power = budget_get_power(temp, lmh_intensity > 0);
+	trace_thermal_power_budget(temp, budget.err_integral, power,
+				   total_req);
+
+	get_online_cpus();
+	for (_cluster = 0; stats && _cluster < core_ptr->entity_count;
+			_cluster++) {
+		cluster_ptr = &core_ptr->child_entity_ptr[_cluster];
+		if (!cluster_ptr->freq_table)
+			continue;
+		granted = total_req ?
+			div_u64((u64)power * req[_cluster], total_req) : power;
+
+		for (idx = cluster_ptr->freq_idx_high;
+				idx > cluster_ptr->freq_idx_low; idx--) {
+			freq = cluster_ptr->freq_table[idx].frequency;
+			if (budget_cluster_power(stats, cluster_ptr, freq)
+					<= granted)
+				break;
+		}
+		max_freq = cluster_ptr->freq_table[idx].frequency;
+		trace_thermal_power_actor("cluster", _cluster, util[_cluster],
+					  req[_cluster], granted, max_freq);
+		budget_set_cluster_freq(cluster_ptr,
+			idx == cluster_ptr->freq_idx_high ? UINT_MAX : max_freq);
+	}
+	update_cluster_freq();
+	put_online_cpus();
+
+	budget_gpu_apply(gpu_util, gpu_req, total_req ?
+			 div_u64((u64)power * gpu_req, total_req) : power);
+}
+
 static void do_freq_control(long temp)
 {
 	uint32_t cpu = 0;
@@ -3024,11 +3285,14 @@ static void check_temp(struct work_struct *work)
 		check_freq_table();
 
 	do_vdd_restriction();
-	do_freq_control(temp);
+	if (budget.enabled && core_ptr)
+		do_power_budget(temp);
+	else
+		do_freq_control(temp);
 
 reschedule:
 	if (polling_enabled)
-		schedule_delayed_work(&check_temp_work,
+		queue_delayed_work(system_power_efficient_wq, &check_temp_work,
 				msecs_to_jiffies(msm_thermal_info.poll_ms));
 }
 
@@ -4651,7 +4915,7 @@ int msm_thermal_init(struct msm_thermal_data *pdata)
 	register_reboot_notifier(&msm_thermal_reboot_notifier);
 	pm_notifier(msm_thermal_suspend_callback, 0);
 	INIT_DELAYED_WORK(&check_temp_work, check_temp);
-	schedule_delayed_work(&check_temp_work, 0);
+	queue_delayed_work(system_power_efficient_wq, &check_temp_work, 0);
 
 	if (num_possible_cpus() > 1) {
 		cpus_previously_online_update();
@@ -5845,6 +6109,72 @@ PROBE_FREQ_EXIT:
 	return ret;
 }
 
+static int probe_power_budget(struct device_node *node,
+		struct msm_thermal_data *data,
+		struct platform_device *pdev)
+{
+	struct device_node *child_node;
+	char *key = NULL;
+	uint32_t val = 0;
+	int ret = 0, i, len;
+
+	child_node = of_get_child_by_name(node, "qcom,power-budget");
+	if (!child_node)
+		return -ENODEV;
+
+	key = "qcom,sustainable-power";
+	ret = of_property_read_u32(child_node, key, &val);
+	if (ret)
+		goto PROBE_BUDGET_EXIT;
+	budget.sustainable_power = val * 1000;
+
+	key = "qcom,control-temp";
+	ret = of_property_read_u32(child_node, key, &val);
+	if (ret)
+		goto PROBE_BUDGET_EXIT;
+	budget.control_temp = val;
+
+	key = "qcom,switch-on-temp";
+	ret = of_property_read_u32(child_node, key, &val);
+	if (ret)
+		goto PROBE_BUDGET_EXIT;
+	budget.switch_on_temp = val;
+
+	key = "qcom,lmh-sensor";
+	of_property_read_string(child_node, key, &budget.lmh_sensor);
+
+	/* <Hz uW> pairs in ascending order, matching the GPU pwrlevels */
+	key = "qcom,gpu-freq-power";
+	if (of_get_property(child_node, key, &len)) {
+		len /= 2 * sizeof(u32);
+		budget.gpu_ptable = devm_kzalloc(&pdev->dev,
+				len * sizeof(*budget.gpu_ptable), GFP_KERNEL);
+		if (!budget.gpu_ptable) {
+			ret = -ENOMEM;
+			goto PROBE_BUDGET_EXIT;
+		}
+		for (i = 0; i < len; i++) {
+			of_property_read_u32_index(child_node, key, 2 * i,
+					&budget.gpu_ptable[i].freq);
+			of_property_read_u32_index(child_node, key, 2 * i + 1,
+					&budget.gpu_ptable[i].power);
+		}
+		budget.gpu_len = len;
+	}
+
+	budget.enabled = true;
+
+PROBE_BUDGET_EXIT:
+	of_node_put(child_node);
+	if (ret) {
+		dev_info(&pdev->dev,
+		"%s:Failed reading node=%s, key=%s. err=%d. KTM continues\n",
+			__func__, node->full_name, key, ret);
+		budget.enabled = false;
+	}
+	return ret;
+}
+
 static int msm_thermal_dev_probe(struct platform_device *pdev)
 {
 	int ret = 0;
@@ -5898,6 +6228,7 @@ static int msm_thermal_dev_probe(struct platform_device *pdev)
 	ret = probe_cc(node, &data, pdev);
 
 	ret = probe_freq_mitigation(node, &data, pdev);
+	ret = probe_power_budget(node, &data, pdev);
 	ret = probe_cx_phase_ctrl(node, &data, pdev);
 	ret = probe_gfx_phase_ctrl(node, &data, pdev);
 	ret = probe_therm_reset(node, &data, pdev);
@@ -4834,6 +4834,8 @@ static int android_probe(struct platform_device *pdev)
 		} else {
 			pr_info("pm_qos latency not specified %d\n", prop_len);
 		}
+		of_property_read_u32(pdev->dev.of_node, "qcom,pm-qos-cpumask",
+				     &pdata->pm_qos_cpumask);
 
 /*++ 2014/09/23 USB Team, PCN00010 ++*/
 		ret = of_property_read_string(pdev->dev.of_node, "htc,fserial-init-string", &buf);
@@ -4978,6 +4980,20 @@ static int android_probe(struct platform_device *pdev)
 	/* pm qos request to prevent apps idle power collapse */
 	android_dev->curr_pm_qos_state = NO_USB_VOTE;
 	if (pdata && pdata->pm_qos_latency[0]) {
+		/*
+		 * Keep only the cpus servicing USB out of deep idle, e.g. the
+		 * little cluster, instead of every core.
+		 */
+		if (pdata->pm_qos_cpumask) {
+			struct pm_qos_request *req = &android_dev->pm_qos_req_dma;
+			int cpu;
+
+			for_each_possible_cpu(cpu)
+				if (cpu < 32 && (pdata->pm_qos_cpumask & BIT(cpu)))
+					cpumask_set_cpu(cpu, &req->cpus_affine);
+			if (!cpumask_empty(&req->cpus_affine))
+				req->type = PM_QOS_REQ_AFFINE_CORES;
+		}
 		pm_qos_add_request(&android_dev->pm_qos_req_dma,
 			PM_QOS_CPU_DMA_LATENCY, PM_QOS_DEFAULT_VALUE);
 		android_dev->down_pm_qos_sample_sec = DOWN_PM_QOS_SAMPLE_SEC;
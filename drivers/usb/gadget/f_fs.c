@@ -24,6 +24,11 @@
 #include <linux/export.h>
 #include <linux/hid.h>
 #include <linux/workqueue.h>
+#include <linux/aio.h>
+#include <linux/mmu_context.h>
+#include <linux/uio.h>
+#include <linux/vmalloc.h>
+#include <linux/scatterlist.h>
 #include <asm/unaligned.h>
 
 #include <linux/usb/composite.h>
@@ -356,6 +361,28 @@ struct ffs_epfile {
 	unsigned char			isoc;	/* P: ffs->eps_lock */
 
 	unsigned char			_pad;
+
+	/* last synchronous I/O buffer, kept for the next call */
+	void				*buf_cache;	/* P: xchg() */
+};
+
+/* One asynchronous transfer on an endpoint file */
+struct ffs_io_data {
+	struct kiocb			*kiocb;
+	struct ffs_epfile		*epfile;
+	struct iovec			*iovec;	/* reads only */
+	unsigned long			nr_segs;
+	size_t				len;
+	bool				read;
+	bool				use_sg;
+
+	struct mm_struct		*mm;
+	struct work_struct		work;
+
+	struct usb_ep			*ep;
+	struct usb_request		*req;
+	void				*buf;
+	struct sg_table			sgt;
 };
 
 static int  __must_check ffs_epfiles_create(struct ffs_data *ffs);
@@ -792,6 +819,26 @@ static void ffs_epfile_io_complete(struct usb_ep *_ep, struct usb_request *req)
 }
 
 #define MAX_BUF_LEN	4096
+#define FFS_BUF_CACHE_MAX	(64 * 1024)
+
+static void *ffs_epfile_buf_get(struct ffs_epfile *epfile, size_t len)
+{
+	void *buf = xchg(&epfile->buf_cache, NULL);
+
+	if (buf && ksize(buf) >= len)
+		return buf;
+	kfree(buf);
+	return kmalloc(len, GFP_KERNEL);
+}
+
+static void ffs_epfile_buf_put(struct ffs_epfile *epfile, void *buf)
+{
+	if (buf && ksize(buf) <= FFS_BUF_CACHE_MAX &&
+	    !cmpxchg(&epfile->buf_cache, NULL, buf))
+		return;
+	kfree(buf);
+}
+
 static ssize_t ffs_epfile_io(struct file *file,
 			     char __user *buf, size_t len, int read)
 {
@@ -875,7 +922,7 @@ first_try:
 
 		/* Allocate & copy */
 		if (!halt && !data) {
-			data = kzalloc(buffer_len, GFP_KERNEL);
+			data = ffs_epfile_buf_get(epfile, buffer_len);
 			if (unlikely(!data))
 				return -ENOMEM;
 
@@ -973,7 +1020,7 @@ first_try:
 
 	mutex_unlock(&epfile->mutex);
 error:
-	kfree(data);
+	ffs_epfile_buf_put(epfile, data);
 	if (ret < 0)
 		pr_err_ratelimited("%s(): Error: returning %zd value\n",
 							__func__, ret);
@@ -997,6 +1044,289 @@ ffs_epfile_read(struct file *file, char __user *buf, size_t len, loff_t *ptr)
 	return ffs_epfile_io(file, buf, len, 1);
 }
 
+/*
+ * Asynchronous I/O: each call gets its own request, so any number of
+ * transfers may be queued on the endpoint. Large ones are backed by
+ * vmalloc()ed pages and go out as a scatterlist when the controller
+ * takes those, rather than needing one physically contiguous buffer.
+ */
+static void *ffs_build_sg_list(struct sg_table *sgt, size_t sz)
+{
+	unsigned int n_pages = PAGE_ALIGN(sz) >> PAGE_SHIFT;
+	struct page **pages;
+	void *vaddr;
+	unsigned int i;
+
+	vaddr = vmalloc(sz);
+	if (!vaddr)
+		return NULL;
+
+	pages = kmalloc(n_pages * sizeof(*pages), GFP_KERNEL);
+	if (!pages) {
+		vfree(vaddr);
+		return NULL;
+	}
+	for (i = 0; i < n_pages; ++i)
+		pages[i] = vmalloc_to_page(vaddr + i * PAGE_SIZE);
+
+	if (sg_alloc_table_from_pages(sgt, pages, n_pages, 0, sz,
+				      GFP_KERNEL)) {
+		kfree(pages);
+		vfree(vaddr);
+		return NULL;
+	}
+	kfree(pages);
+
+	return vaddr;
+}
+
+static void ffs_io_data_free(struct ffs_io_data *io_data)
+{
+	if (io_data->req)
+		usb_ep_free_request(io_data->ep, io_data->req);
+	if (io_data->use_sg) {
+		sg_free_table(&io_data->sgt);
+		vfree(io_data->buf);
+	} else {
+		kfree(io_data->buf);
+	}
+	kfree(io_data->iovec);
+	kfree(io_data);
+}
+
+static int ffs_copy_from_iovec(void *buf, const struct iovec *iov,
+			       unsigned long nr_segs)
+{
+	unsigned long i;
+
+	for (i = 0; i < nr_segs; buf += iov[i].iov_len, ++i)
+		if (copy_from_user(buf, iov[i].iov_base, iov[i].iov_len))
+			return -EFAULT;
+	return 0;
+}
+
+static int ffs_copy_to_iovec(const struct iovec *iov, unsigned long nr_segs,
+			     void *buf, size_t len)
+{
+	unsigned long i;
+	size_t n;
+
+	for (i = 0; i < nr_segs && len; buf += n, len -= n, ++i) {
+		n = min(iov[i].iov_len, len);
+		if (copy_to_user(iov[i].iov_base, buf, n))
+			return -EFAULT;
+	}
+	return 0;
+}
+
+static void ffs_user_copy_worker(struct work_struct *work)
+{
+	struct ffs_io_data *io_data = container_of(work, struct ffs_io_data,
+						   work);
+	struct ffs_data *ffs = io_data->epfile->ffs;
+	struct usb_request *req = io_data->req;
+	long ret = req->status ? req->status : req->actual;
+
+	if (io_data->read && ret > 0) {
+		if (ret > io_data->len) {
+			ret = -EOVERFLOW;
+		} else {
+			use_mm(io_data->mm);
+			if (ffs_copy_to_iovec(io_data->iovec, io_data->nr_segs,
+					      io_data->buf, ret))
+				ret = -EFAULT;
+			unuse_mm(io_data->mm);
+		}
+	}
+
+	/* past this point ffs_aio_cancel() can no longer see us */
+	spin_lock_irq(&ffs->eps_lock);
+	io_data->kiocb->private = NULL;
+	spin_unlock_irq(&ffs->eps_lock);
+
+	aio_complete(io_data->kiocb, ret, ret);
+	ffs_io_data_free(io_data);
+}
+
+static void ffs_epfile_async_io_complete(struct usb_ep *_ep,
+					 struct usb_request *req)
+{
+	struct ffs_io_data *io_data = req->context;
+
+	ENTER();
+
+	/* user memory can only be touched from process context */
+	schedule_work(&io_data->work);
+}
+
+static int ffs_aio_cancel(struct kiocb *kiocb, struct io_event *event)
+{
+	struct ffs_epfile *epfile = kiocb->ki_filp->private_data;
+	struct ffs_io_data *io_data;
+	int ret = -EINVAL;
+
+	ENTER();
+
+	spin_lock_irq(&epfile->ffs->eps_lock);
+	io_data = kiocb->private;
+	if (io_data && epfile->ep && epfile->ep->ep == io_data->ep)
+		ret = usb_ep_dequeue(io_data->ep, io_data->req);
+	spin_unlock_irq(&epfile->ffs->eps_lock);
+
+	return ret;
+}
+
+static ssize_t ffs_epfile_loop_io(struct file *file, const struct iovec *iov,
+				  unsigned long nr_segs, int read)
+{
+	ssize_t ret = 0, n;
+	unsigned long i;
+
+	for (i = 0; i < nr_segs; ++i) {
+		n = ffs_epfile_io(file, iov[i].iov_base, iov[i].iov_len, read);
+		if (n < 0)
+			return ret ? ret : n;
+		ret += n;
+		if (n != iov[i].iov_len)
+			break;
+	}
+	return ret;
+}
+
+static ssize_t ffs_epfile_aio_io(struct kiocb *kiocb, const struct iovec *iovec,
+				 unsigned long nr_segs, bool read)
+{
+	struct ffs_epfile *epfile = kiocb->ki_filp->private_data;
+	struct ffs_data *ffs = epfile->ffs;
+	struct ffs_io_data *io_data;
+	struct usb_request *req;
+	struct ffs_ep *ep;
+	size_t len = iov_length(iovec, nr_segs);
+	size_t buffer_len;
+	int ret;
+
+	if (atomic_read(&epfile->error))
+		return -ENODEV;
+	if (WARN_ON(ffs->state != FFS_ACTIVE))
+		return -ENODEV;
+
+	/* readv() and writev() keep the blocking, per segment behaviour */
+	if (is_sync_kiocb(kiocb))
+		return ffs_epfile_loop_io(kiocb->ki_filp, iovec, nr_segs,
+					  read);
+
+	/* No waiting for the endpoint and no halting here */
+	spin_lock_irq(&ffs->eps_lock);
+	ep = epfile->ep;
+	if (!ep || !read == !epfile->in) {
+		spin_unlock_irq(&ffs->eps_lock);
+		return ep ? -EINVAL : -ENODEV;
+	}
+	buffer_len = !read ? len : round_up(len,
+					    ep->ep->desc->wMaxPacketSize);
+	spin_unlock_irq(&ffs->eps_lock);
+
+	io_data = kzalloc(sizeof(*io_data), GFP_KERNEL);
+	if (unlikely(!io_data))
+		return -ENOMEM;
+
+	io_data->kiocb = kiocb;
+	io_data->epfile = epfile;
+	io_data->len = len;
+	io_data->read = read;
+	io_data->mm = current->mm;
+	io_data->ep = ep->ep;
+	INIT_WORK(&io_data->work, ffs_user_copy_worker);
+
+	io_data->use_sg = ffs->gadget->sg_supported &&
+			  buffer_len > PAGE_SIZE;
+	if (io_data->use_sg)
+		io_data->buf = ffs_build_sg_list(&io_data->sgt, buffer_len);
+	else
+		io_data->buf = kmalloc(buffer_len, GFP_KERNEL);
+	if (unlikely(!io_data->buf)) {
+		io_data->use_sg = false;
+		ret = -ENOMEM;
+		goto error;
+	}
+
+	if (read) {
+		io_data->iovec = kmemdup(iovec, nr_segs * sizeof(*iovec),
+					 GFP_KERNEL);
+		io_data->nr_segs = nr_segs;
+		if (unlikely(!io_data->iovec)) {
+			ret = -ENOMEM;
+			goto error;
+		}
+	} else if (ffs_copy_from_iovec(io_data->buf, iovec, nr_segs)) {
+		ret = -EFAULT;
+		goto error;
+	}
+
+	req = usb_ep_alloc_request(io_data->ep, GFP_KERNEL);
+	if (unlikely(!req)) {
+		ret = -ENOMEM;
+		goto error;
+	}
+	io_data->req = req;
+
+	if (io_data->use_sg) {
+		req->buf = NULL;
+		req->sg = io_data->sgt.sgl;
+		req->num_sgs = io_data->sgt.nents;
+	} else {
+		req->buf = io_data->buf;
+	}
+	req->length = buffer_len;
+	req->complete = ffs_epfile_async_io_complete;
+	req->context = io_data;
+
+	/*
+	 * Once the cancel callback is set, errors have to be reported
+	 * through aio_complete() so the kiocb leaves the active list.
+	 */
+	kiocb->private = io_data;
+	kiocb_set_cancel_fn(kiocb, ffs_aio_cancel);
+
+	spin_lock_irq(&ffs->eps_lock);
+	if (epfile->ep == ep)
+		ret = usb_ep_queue(ep->ep, req, GFP_ATOMIC);
+	else
+		ret = -ENODEV;
+	if (unlikely(ret))
+		kiocb->private = NULL;
+	spin_unlock_irq(&ffs->eps_lock);
+
+	if (likely(!ret))
+		return -EIOCBQUEUED;
+
+	ffs_io_data_free(io_data);
+	aio_complete(kiocb, -EIO, 0);
+	return -EIOCBQUEUED;
+
+error:
+	ffs_io_data_free(io_data);
+	return ret;
+}
+
+static ssize_t ffs_epfile_aio_write(struct kiocb *kiocb,
+				    const struct iovec *iovec,
+				    unsigned long nr_segs, loff_t loff)
+{
+	ENTER();
+
+	return ffs_epfile_aio_io(kiocb, iovec, nr_segs, false);
+}
+
+static ssize_t ffs_epfile_aio_read(struct kiocb *kiocb,
+				   const struct iovec *iovec,
+				   unsigned long nr_segs, loff_t loff)
+{
+	ENTER();
+
+	return ffs_epfile_aio_io(kiocb, iovec, nr_segs, true);
+}
+
 static int
 ffs_epfile_open(struct inode *inode, struct file *file)
 {
@@ -1072,6 +1402,8 @@ static const struct file_operations ffs_epfile_operations = {
 	.open =		ffs_epfile_open,
 	.write =	ffs_epfile_write,
 	.read =		ffs_epfile_read,
+	.aio_write =	ffs_epfile_aio_write,
+	.aio_read =	ffs_epfile_aio_read,
 	.release =	ffs_epfile_release,
 	.unlocked_ioctl =	ffs_epfile_ioctl,
 };
@@ -1639,6 +1971,7 @@ static void ffs_epfiles_destroy(struct ffs_epfile *epfiles, unsigned count)
 			dput(epfile->dentry);
 			epfile->dentry = NULL;
 		}
+		kfree(epfile->buf_cache);
 	}
 
 	kfree(epfiles);
@@ -30,6 +30,10 @@
 #include <linux/file.h>
 #include <linux/device.h>
 #include <linux/miscdevice.h>
+#include <linux/fs.h>
+#include <linux/mm.h>
+#include <linux/pagemap.h>
+#include <linux/scatterlist.h>
 
 #include <linux/usb.h>
 #include <linux/usb_usual.h>
@@ -86,6 +90,16 @@ module_param(mtp_tx_req_len, uint, S_IRUGO | S_IWUSR);
 
 unsigned int mtp_tx_reqs = MTP_TX_REQ_MAX;
 module_param(mtp_tx_reqs, uint, S_IRUGO | S_IWUSR);
+
+unsigned int mtp_rx_reqs = MTP_RX_REQ_MAX;
+module_param(mtp_rx_reqs, uint, S_IRUGO | S_IWUSR);
+
+/*
+ * Queue page cache pages of the file straight to the IN endpoint for
+ * MTP_SEND_FILE, when the controller takes scatter-gather requests.
+ */
+static bool mtp_tx_zero_copy = true;
+module_param(mtp_tx_zero_copy, bool, S_IRUGO | S_IWUSR);
 /*++ 2014/10/21, USB Team, PCN00019 ++*/
 static int htc_mtp_open_state;
 /*-- 2014/10/21, USB Team, PCN00019 --*/
@@ -126,6 +140,8 @@ struct mtp_dev {
 
 	struct list_head tx_idle;
 	struct list_head intr_idle;
+	/* scatterlist entries of each tx request, 0 if none */
+	unsigned int tx_sg_nents;
 
 	wait_queue_head_t read_wq;
 	wait_queue_head_t write_wq;
@@ -478,6 +494,7 @@ static struct usb_request *mtp_request_new(struct usb_ep *ep, int buffer_size)
 static void mtp_request_free(struct usb_request *req, struct usb_ep *ep)
 {
 	if (req) {
+		kfree(req->sg);
 		kfree(req->buf);
 		usb_ep_free_request(ep, req);
 	}
@@ -527,6 +544,17 @@ static struct usb_request
 	return req;
 }
 
+/* drop the page cache references of a zero copy tx request */
+static void mtp_tx_put_pages(struct usb_request *req)
+{
+	struct scatterlist *sg;
+	int i;
+
+	for_each_sg(req->sg, sg, req->num_sgs, i)
+		page_cache_release(sg_page(sg));
+	req->num_sgs = 0;
+}
+
 static void mtp_complete_in(struct usb_ep *ep, struct usb_request *req)
 {
 	struct mtp_dev *dev = _mtp_dev;
@@ -534,6 +562,9 @@ static void mtp_complete_in(struct usb_ep *ep, struct usb_request *req)
 	if (req->status != 0)
 		dev->state = STATE_ERROR;
 
+	if (req->num_sgs)
+		mtp_tx_put_pages(req);
+
 	mtp_req_put(dev, &dev->tx_idle, req);
 
 	wake_up(&dev->write_wq);
@@ -615,6 +646,11 @@ retry_tx_alloc:
 	if (mtp_tx_req_len > MTP_BULK_BUFFER_SIZE)
 		mtp_tx_reqs = 4;
 
+	/* one more entry for a range that does not start on a page */
+	dev->tx_sg_nents = 0;
+	if (cdev->gadget->sg_supported)
+		dev->tx_sg_nents = DIV_ROUND_UP(mtp_tx_req_len, PAGE_SIZE) + 1;
+
 	/* now allocate requests for our endpoints */
 	for (i = 0; i < mtp_tx_reqs; i++) {
 		req = mtp_request_new(dev->ep_in, mtp_tx_req_len);
@@ -627,6 +663,13 @@ retry_tx_alloc:
 			mtp_tx_reqs = MTP_TX_REQ_MAX;
 			goto retry_tx_alloc;
 		}
+		if (dev->tx_sg_nents) {
+			req->sg = kmalloc(dev->tx_sg_nents *
+					  sizeof(struct scatterlist),
+					  GFP_KERNEL);
+			if (!req->sg)
+				dev->tx_sg_nents = 0;
+		}
 		req->complete = mtp_complete_in;
 		mtp_req_put(dev, &dev->tx_idle, req);
 	}
@@ -640,9 +683,12 @@ retry_tx_alloc:
 	if (mtp_rx_req_len % 1024)
 		mtp_rx_req_len = MTP_BULK_BUFFER_SIZE;
 
+	if (!mtp_rx_reqs)
+		mtp_rx_reqs = MTP_RX_REQ_MAX;
+
 /*-- 2014/11/20, USB Team, PCN00042 --*/
 retry_rx_alloc:
-	for (i = 0; i < MTP_RX_REQ_MAX; i++) {
+	for (i = 0; i < mtp_rx_reqs; i++) {
 		req = mtp_request_new(dev->ep_out, mtp_rx_req_len);
 		if (!req) {
 			if (mtp_rx_req_len <= MTP_BULK_BUFFER_SIZE)
@@ -938,6 +984,50 @@ static ssize_t mtp_write(struct file *fp, const char __user *buf,
 	return r;
 }
 
+/*
+ * Point a tx request at the page cache pages backing [offset, offset +
+ * len) of the file, reading them in first if needed. The pages are
+ * released when the request completes. Returns -EOPNOTSUPP when the
+ * range has to go through vfs_read() instead.
+ */
+static int mtp_tx_map_pages(struct mtp_dev *dev, struct usb_request *req,
+			    struct file *filp, loff_t offset, int len)
+{
+	struct address_space *mapping = filp->f_mapping;
+	pgoff_t index = offset >> PAGE_CACHE_SHIFT;
+	unsigned int poff = offset & ~PAGE_CACHE_MASK;
+	unsigned int plen;
+	struct page *page;
+	int done = 0;
+
+	if (!mtp_tx_zero_copy || !req->sg || !dev->tx_sg_nents ||
+	    !mapping || !mapping->a_ops->readpage ||
+	    (filp->f_flags & O_DIRECT) ||
+	    offset + len > i_size_read(mapping->host))
+		return -EOPNOTSUPP;
+
+	sg_init_table(req->sg, dev->tx_sg_nents);
+	req->num_sgs = 0;
+	page_cache_sync_readahead(mapping, &filp->f_ra, filp, index,
+				  DIV_ROUND_UP(poff + len, PAGE_CACHE_SIZE));
+
+	while (done < len) {
+		page = read_mapping_page(mapping, index, filp);
+		if (IS_ERR(page)) {
+			mtp_tx_put_pages(req);
+			return PTR_ERR(page);
+		}
+		plen = min_t(unsigned int, PAGE_CACHE_SIZE - poff, len - done);
+		sg_set_page(&req->sg[req->num_sgs++], page, plen, poff);
+		done += plen;
+		poff = 0;
+		index++;
+	}
+	sg_mark_end(&req->sg[req->num_sgs - 1]);
+
+	return 0;
+}
+
 /* read from a local file and write to USB */
 static void send_file_work(struct work_struct *data)
 {
@@ -1008,8 +1098,18 @@ static void send_file_work(struct work_struct *data)
 					__cpu_to_le32(dev->xfer_transaction_id);
 		}
 
-		ret = vfs_read(filp, req->buf + hdr_size, xfer - hdr_size,
-								&offset);
+		/* the request carrying the data header is always copied */
+		ret = -EOPNOTSUPP;
+		if (!hdr_size && xfer) {
+			ret = mtp_tx_map_pages(dev, req, filp, offset, xfer);
+			if (!ret) {
+				offset += xfer;
+				ret = xfer;
+			}
+		}
+		if (ret == -EOPNOTSUPP)
+			ret = vfs_read(filp, req->buf + hdr_size,
+				       xfer - hdr_size, &offset);
 		if (ret < 0) {
 			r = ret;
 			break;
@@ -1020,6 +1120,8 @@ static void send_file_work(struct work_struct *data)
 		req->length = xfer;
 		ret = usb_ep_queue(dev->ep_in, req, GFP_KERNEL);
 		if (ret < 0) {
+			if (req->num_sgs)
+				mtp_tx_put_pages(req);
 			DBG(cdev, "send_file_work: xfer error %d\n", ret);
 			if (dev->state != STATE_OFFLINE)
 				dev->state = STATE_ERROR;
@@ -1099,7 +1201,7 @@ requeue_req:
 			#if 0
 			req->length = dev->maxsize?dev->maxsize:512;
 			#endif
-			req->length = MTP_BULK_BUFFER_SIZE;
+			req->length = mtp_rx_req_len;
 			DBG(cdev, "%s: queue request(%p) on %s\n", __func__, req, dev->ep_out->name);
 			ret = usb_ep_queue(dev->ep_out, req, GFP_ATOMIC);
 			if (ret < 0) {
@@ -1145,7 +1247,7 @@ requeue_req:
 			}
 
 			/* short packet found */
-			if (xfer < MTP_BULK_BUFFER_SIZE) {
+			if (xfer < mtp_rx_req_len) {
 				break;
 			}
 			continue;
@@ -116,6 +116,8 @@ struct eth_dev {
 	struct work_struct	work;
 	struct work_struct	rx_work;
 	struct work_struct	tx_work;
+	struct napi_struct	napi;
+	bool			rx_napi;
 
 	unsigned long		todo;
 	unsigned long		flags;
@@ -133,6 +135,8 @@ struct eth_dev {
 	unsigned int		tx_aggr_cnt[DL_MAX_PKTS_PER_XFER];
 	unsigned int		tx_pkts_rcvd;
 	unsigned int		loop_brk_cnt;
+	unsigned long		rx_napi_polls;
+	unsigned long		rx_napi_full;
 	struct dentry		*uether_dent;
 	struct dentry		*uether_dfile;
 
@@ -193,6 +197,19 @@ static inline int qlen(struct usb_gadget *gadget)
 static unsigned int u_ether_rx_pending_thld = U_ETHER_RX_PENDING_TSHOLD;
 module_param(u_ether_rx_pending_thld, uint, S_IRUGO | S_IWUSR);
 
+/*
+ * De-aggregated rx frames are normally handed to the stack from rx_work
+ * through netif_rx_ni(), which costs a workqueue wakeup plus a backlog
+ * softirq per burst.  With rx_napi the completion handler schedules a
+ * NAPI poll instead, and frames go through GRO straight from softirq.
+ * Latched on every gether_connect().
+ */
+#define U_ETHER_NAPI_WEIGHT	64
+
+static bool u_ether_rx_napi = true;
+module_param(u_ether_rx_napi, bool, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(u_ether_rx_napi, "Deliver rx frames from NAPI poll context");
+
 
 /* REVISIT there must be a better way than having two sets
  * of debug calls ...
@@ -481,8 +498,12 @@ clean:
 		spin_unlock(&dev->req_lock);
 	}
 
-	if (queue)
-		queue_work(uether_wq, &dev->rx_work);
+	if (queue) {
+		if (dev->rx_napi)
+			napi_schedule(&dev->napi);
+		else
+			queue_work(uether_wq, &dev->rx_work);
+	}
 }
 
 static int prealloc(struct list_head *list,
@@ -641,45 +662,61 @@ static __be16 ether_ip_type_trans(struct sk_buff *skb,
 	return protocol;
 }
 
+/*++ 2014/12/02, USB Team, PCN00052 ++*/
+static unsigned int eth_rx_max_frame(struct eth_dev *dev)
+{
+	unsigned int uiCurMtu = dev->net->mtu + ETH_HLEN;
+
+	if ((uiCurMtu <= ETH_HLEN) || (uiCurMtu > ETH_FRAME_LEN_MAX))
+	    uiCurMtu = ETH_FRAME_LEN;
+	return uiCurMtu;
+}
+/*-- 2014/12/02, USB Team, PCN00052 --*/
+
+/*
+ * Validate one de-aggregated frame and set up its protocol; returns false
+ * (and frees the skb) if it has to be dropped.
+ */
+static bool eth_rx_prepare(struct eth_dev *dev, struct sk_buff *skb,
+		unsigned int max_frame, bool drop)
+{
+	if (drop
+			|| ETH_HLEN > skb->len
+/*++ 2014/12/02, USB Team, PCN00052 ++*/
+			|| (skb->len > max_frame &&
+/*-- 2014/12/02, USB Team, PCN00052 --*/
+			test_bit(RMNET_MODE_LLP_ETH, &dev->flags))) {
+		dev->net->stats.rx_errors++;
+		dev->net->stats.rx_length_errors++;
+		DBG(dev, "rx length %d\n", skb->len);
+		dev_kfree_skb_any(skb);
+		return false;
+	}
+	if (test_bit(RMNET_MODE_LLP_IP, &dev->flags))
+		skb->protocol = ether_ip_type_trans(skb, dev->net);
+	else
+		skb->protocol = eth_type_trans(skb, dev->net);
+
+	dev->net->stats.rx_packets++;
+	dev->net->stats.rx_bytes += skb->len;
+	return true;
+}
+
 static void process_rx_w(struct work_struct *work)
 {
 	struct eth_dev	*dev = container_of(work, struct eth_dev, rx_work);
 	struct sk_buff	*skb;
 	int		status = 0;
-/*++ 2014/12/02, USB Team, PCN00052 ++*/
-	unsigned int uiCurMtu = 0;
-/*-- 2014/12/02, USB Team, PCN00052 --*/
+	unsigned int	max_frame;
 
 	if (!dev->port_usb)
 		return;
 
 	set_wake_up_idle(true);
-/*++ 2014/12/02, USB Team, PCN00052 ++*/
-	uiCurMtu = dev->net->mtu + ETH_HLEN;
-	if ((uiCurMtu <= ETH_HLEN) || (uiCurMtu > ETH_FRAME_LEN_MAX))
-	    uiCurMtu = ETH_FRAME_LEN;
-/*-- 2014/12/02, USB Team, PCN00052 --*/
+	max_frame = eth_rx_max_frame(dev);
 	while ((skb = skb_dequeue(&dev->rx_frames))) {
-		if (status < 0
-				|| ETH_HLEN > skb->len
-/*++ 2014/12/02, USB Team, PCN00052 ++*/
-				|| (skb->len > uiCurMtu &&
-/*-- 2014/12/02, USB Team, PCN00052 --*/
-				test_bit(RMNET_MODE_LLP_ETH, &dev->flags))) {
-			dev->net->stats.rx_errors++;
-			dev->net->stats.rx_length_errors++;
-			DBG(dev, "rx length %d\n", skb->len);
-			dev_kfree_skb_any(skb);
+		if (!eth_rx_prepare(dev, skb, max_frame, status < 0))
 			continue;
-		}
-		if (test_bit(RMNET_MODE_LLP_IP, &dev->flags))
-			skb->protocol = ether_ip_type_trans(skb, dev->net);
-		else
-			skb->protocol = eth_type_trans(skb, dev->net);
-
-		dev->net->stats.rx_packets++;
-		dev->net->stats.rx_bytes += skb->len;
-
 		status = netif_rx_ni(skb);
 	}
 	set_wake_up_idle(false);
@@ -688,6 +725,41 @@ static void process_rx_w(struct work_struct *work)
 		rx_fill(dev, GFP_KERNEL);
 }
 
+/*
+ * NAPI counterpart of process_rx_w(): drain at most @budget frames that
+ * rx_complete() de-aggregated, feed them through GRO and recycle the
+ * rx requests that were parked because rx_frames ran over the threshold.
+ */
+static int eth_rx_poll(struct napi_struct *napi, int budget)
+{
+	struct eth_dev	*dev = container_of(napi, struct eth_dev, napi);
+	struct sk_buff	*skb;
+	unsigned int	max_frame = eth_rx_max_frame(dev);
+	int		work_done = 0;
+
+	dev->rx_napi_polls++;
+	while (work_done < budget &&
+			(skb = skb_dequeue(&dev->rx_frames))) {
+		work_done++;
+		if (eth_rx_prepare(dev, skb, max_frame, false))
+			napi_gro_receive(napi, skb);
+	}
+
+	if (netif_running(dev->net))
+		rx_fill(dev, GFP_ATOMIC);
+
+	if (work_done < budget) {
+		napi_complete(napi);
+		/* rx_complete() may have queued frames after the last dequeue */
+		if (!skb_queue_empty(&dev->rx_frames))
+			napi_schedule(napi);
+	} else {
+		dev->rx_napi_full++;
+	}
+
+	return work_done;
+}
+
 static void eth_work(struct work_struct *work)
 {
 	struct eth_dev	*dev = container_of(work, struct eth_dev, work);
@@ -1281,6 +1353,8 @@ static int eth_open(struct net_device *net)
 	wait_for_rx_trigger = dev->rx_trigger_enabled && link &&
 		!link->rx_triggered;
 
+	napi_enable(&dev->napi);
+
 	if (netif_carrier_ok(dev->net) && !wait_for_rx_trigger)
 		eth_start(dev, GFP_KERNEL);
 
@@ -1306,6 +1380,7 @@ static int eth_stop(struct net_device *net)
 	VDBG(dev, "%s\n", __func__);
 
 	netif_stop_queue(net);
+	napi_disable(&dev->napi);
 
 	DBG(dev, "stop stats: rx/tx %ld/%ld, errs %ld/%ld\n",
 		dev->net->stats.rx_packets, dev->net->stats.tx_packets,
@@ -1661,6 +1736,7 @@ struct eth_dev *gether_setup_name(struct usb_gadget *g, u8 ethaddr[ETH_ALEN],
 	INIT_LIST_HEAD(&dev->tx_reqs);
 	INIT_LIST_HEAD(&dev->rx_reqs);
 	INIT_WORK(&dev->cpu_policy_w, update_cpu_policy_w);
+	netif_napi_add(net, &dev->napi, eth_rx_poll, U_ETHER_NAPI_WEIGHT);
 
 	skb_queue_head_init(&dev->rx_frames);
 	skb_queue_head_init(&dev->tx_skb_q);
@@ -1855,6 +1931,7 @@ struct net_device *gether_connect(struct gether *link)
 	dev->dl_max_pkts_per_xfer = link->dl_max_pkts_per_xfer;
 	dev->dl_max_xfer_size = link->dl_max_xfer_size;
 	dev->rx_trigger_enabled = link->rx_trigger_enabled;
+	dev->rx_napi = u_ether_rx_napi;
 
 	if (result == 0)
 		result = alloc_requests(dev, link, qlen(dev->gadget));
@@ -2037,6 +2114,9 @@ static int uether_stat_show(struct seq_file *s, void *unused)
 		seq_printf(s, "\nloop_brk_cnt = %u\n tx_pkts_rcvd=%u\n",
 					dev->loop_brk_cnt,
 					dev->tx_pkts_rcvd);
+		seq_printf(s, "rx_napi=%d polls=%lu budget_exhausted=%lu\n",
+					dev->rx_napi, dev->rx_napi_polls,
+					dev->rx_napi_full);
 	}
 
 	return ret;
@@ -2058,6 +2138,8 @@ static ssize_t uether_stat_reset(struct file *file,
 	/* Reset tx_throttle */
 	dev->tx_throttle = 0;
 	dev->rx_throttle = 0;
+	dev->rx_napi_polls = 0;
+	dev->rx_napi_full = 0;
 	spin_unlock_irqrestore(&dev->lock, flags);
 	return count;
 }
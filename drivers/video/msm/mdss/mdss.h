@@ -296,6 +296,9 @@ struct mdss_data_type {
 	int handoff_pending;
 	bool idle_pc;
 	struct mdss_perf_tune perf_tune;
+	u32 perf_cache_hits;
+	u32 perf_cache_misses;
+	u32 perf_lower_hold;
 	bool traffic_shaper_en;
 	int iommu_ref_cnt;
 	u32 latency_buff_per;
@@ -50,6 +50,8 @@
 #define MSMFB_BUFFER_SYNC32  _IOW(MSMFB_IOCTL_MAGIC, 162, struct mdp_buf_sync32)
 #define MSMFB_OVERLAY_PREPARE32		_IOWR(MSMFB_IOCTL_MAGIC, 169, \
 						struct mdp_overlay_list32)
+#define MSMFB_ATOMIC_COMMIT32		_IOWR(MSMFB_IOCTL_MAGIC, 171, \
+						struct mdp_atomic_commit32)
 
 static unsigned int __do_compat_ioctl_nr(unsigned int cmd32)
 {
@@ -95,6 +97,9 @@ static unsigned int __do_compat_ioctl_nr(unsigned int cmd32)
 	case MSMFB_OVERLAY_PREPARE32:
 		cmd = MSMFB_OVERLAY_PREPARE;
 		break;
+	case MSMFB_ATOMIC_COMMIT32:
+		cmd = MSMFB_ATOMIC_COMMIT;
+		break;
 	default:
 		cmd = cmd32;
 		break;
@@ -2625,6 +2630,73 @@ void mdss_compat_align_list(void __user *total_mem_chunk,
 		list_ptr[i] = contig_overlays + i;
 }
 
+static int mdss_compat_atomic_commit(struct fb_info *info, unsigned int cmd,
+			 unsigned long arg)
+{
+	struct mdp_atomic_commit32 __user *commit32 = compat_ptr(arg);
+	struct mdp_atomic_commit __user *commit;
+	struct mdp_overlay __user **layers_head;
+	struct mdp_overlay __user *layers;
+	size_t layers_refs_sz, layers_sz, commit_sz;
+	void __user *total_mem_chunk;
+	uint32_t num_overlays, data;
+	int i, ret;
+
+	if (get_user(num_overlays, &commit32->ovlist.num_overlays)) {
+		pr_err("compat atomic commit failed: invalid arg\n");
+		return -EFAULT;
+	}
+
+	if (num_overlays >= OVERLAY_MAX) {
+		pr_err("%s: No: of overlays exceeds max\n", __func__);
+		return -EINVAL;
+	}
+
+	layers_sz = num_overlays * sizeof(struct mdp_overlay);
+	commit_sz = sizeof(struct mdp_atomic_commit);
+	layers_refs_sz = num_overlays * sizeof(struct mdp_overlay *);
+
+	total_mem_chunk = compat_alloc_user_space(
+		commit_sz + layers_refs_sz + layers_sz);
+	if (!total_mem_chunk) {
+		pr_err("%s:%u: compat alloc error [%zu] bytes\n",
+			 __func__, __LINE__,
+			 layers_refs_sz + layers_sz + commit_sz);
+		return -EINVAL;
+	}
+
+	commit = total_mem_chunk;
+	layers_head = total_mem_chunk + commit_sz;
+	layers = total_mem_chunk + commit_sz + layers_refs_sz;
+	for (i = 0; i < num_overlays; i++)
+		layers_head[i] = layers + i;
+
+	/* msmfb_overlay_data and mdp_display_commit are the same for both */
+	if (get_user(data, &commit32->data_list) ||
+	    put_user(compat_ptr(data), &commit->data_list) ||
+	    copy_in_user(&commit->commit, &commit32->commit,
+			 sizeof(commit->commit)))
+		return -EFAULT;
+
+	ret = __from_user_mdp_overlaylist(&commit->ovlist, &commit32->ovlist,
+				layers_head);
+	if (ret) {
+		pr_err("compat mdp atomic commit failed\n");
+		return ret;
+	}
+
+	ret = mdss_fb_do_ioctl(info, cmd, (unsigned long) commit);
+	if (!ret)
+		ret = __to_user_mdp_overlaylist(&commit32->ovlist,
+					&commit->ovlist, layers_head);
+	else if (copy_in_user(&commit32->ovlist.processed_overlays,
+			&commit->ovlist.processed_overlays,
+			sizeof(commit32->ovlist.processed_overlays)))
+		ret = -EFAULT;
+
+	return ret;
+}
+
 int mdss_compat_overlay_ioctl(struct fb_info *info, unsigned int cmd,
 			 unsigned long arg)
 {
@@ -2729,6 +2801,9 @@ int mdss_compat_overlay_ioctl(struct fb_info *info, unsigned int cmd,
 							 ovlist, layers_head);
 		}
 		break;
+	case MSMFB_ATOMIC_COMMIT:
+		ret = mdss_compat_atomic_commit(info, cmd, arg);
+		break;
 	case MSMFB_OVERLAY_UNSET:
 	case MSMFB_OVERLAY_PLAY_ENABLE:
 	case MSMFB_OVERLAY_PLAY:
@@ -2791,6 +2866,7 @@ int mdss_fb_compat_ioctl(struct fb_info *info, unsigned int cmd,
 	case MSMFB_METADATA_SET:
 	case MSMFB_METADATA_GET:
 	case MSMFB_OVERLAY_PREPARE:
+	case MSMFB_ATOMIC_COMMIT:
 		ret = mdss_compat_overlay_ioctl(info, cmd, arg);
 		break;
 	case MSMFB_NOTIFY_UPDATE:
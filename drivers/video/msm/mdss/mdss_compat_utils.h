@@ -411,4 +411,10 @@ struct mdp_overlay_list32 {
 	uint32_t processed_overlays;
 };
 
+struct mdp_atomic_commit32 {
+	struct mdp_overlay_list32 ovlist;
+	compat_caddr_t data_list;
+	struct mdp_display_commit commit;
+};
+
 #endif
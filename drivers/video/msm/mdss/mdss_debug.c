@@ -1055,6 +1055,17 @@ static int mdss_debugfs_perf_init(struct mdss_debug_data *mdd,
 	debugfs_create_file("perf_mode", 0644, mdd->perf,
 		(u32 *)&mdata->perf_tune, &mdss_perf_mode_fops);
 
+	/* pipe perf calculations that were reused or had to be redone */
+	debugfs_create_u32("perf_cache_hits", 0444, mdd->perf,
+		(u32 *)&mdata->perf_cache_hits);
+
+	debugfs_create_u32("perf_cache_misses", 0444, mdd->perf,
+		(u32 *)&mdata->perf_cache_misses);
+
+	/* frames that need less before the votes are lowered, 0 at once */
+	debugfs_create_u32("perf_lower_hold", 0644, mdd->perf,
+		(u32 *)&mdata->perf_lower_hold);
+
 	/* Initialize percentage to 0% */
 	mdata->latency_buff_per = 0;
 	debugfs_create_u32("latency_buff_per", 0644, mdd->perf,
@@ -248,6 +248,8 @@ static int mdss_dsi_panel_power_on(struct mdss_panel_data *pdata)
 		return 0;
 	}
 
+	ATRACE_BEGIN("dsi_panel_power_on");
+
 	//TODO: move to pwrctrl
 	if (gpio_is_valid(ctrl_pdata->lcmio_1v8_en))
 		gpio_set_value((ctrl_pdata->lcmio_1v8_en), 1);
@@ -315,6 +317,7 @@ error:
 				ctrl_pdata->power_data[i].vreg_config,
 				ctrl_pdata->power_data[i].num_vreg, 0);
 	}
+	ATRACE_END("dsi_panel_power_on");
 	return ret;
 }
 
@@ -329,12 +332,16 @@ static int mdss_dsi_panel_power_ctrl(struct mdss_panel_data *pdata,
 {
 	int ret;
 	struct mdss_panel_info *pinfo;
+	struct mdss_dsi_ctrl_pdata *ctrl_pdata = NULL;
 
 	if (pdata == NULL) {
 		pr_err("%s: Invalid input data\n", __func__);
 		return -EINVAL;
 	}
 
+	ctrl_pdata = container_of(pdata, struct mdss_dsi_ctrl_pdata,
+				panel_data);
+
 	pinfo = &pdata->panel_info;
 	pr_debug("%s: cur_power_state=%d req_power_state=%d\n", __func__,
 		pinfo->panel_power_state, power_state);
@@ -358,8 +365,11 @@ static int mdss_dsi_panel_power_ctrl(struct mdss_panel_data *pdata,
 	case MDSS_PANEL_POWER_ON:
 		if (mdss_dsi_is_panel_on_lp(pdata))
 			ret = mdss_dsi_panel_power_lp(pdata, false);
+		else if (ctrl_pdata->early_power_on)
+			ret = 0;
 		else
 			ret = mdss_dsi_panel_power_on(pdata);
+		ctrl_pdata->early_power_on = false;
 		break;
 	case MDSS_PANEL_POWER_LP1:
 	case MDSS_PANEL_POWER_LP2:
@@ -377,6 +387,53 @@ static int mdss_dsi_panel_power_ctrl(struct mdss_panel_data *pdata,
 	return ret;
 }
 
+/*
+ * The regulator ramp and reset timing of the panel don't depend on the MDP
+ * or on the DSI link, so on an unblank from power off the panel is powered
+ * up here while the MDP is restored. mdss_dsi_on() waits for this work and
+ * only does the power up itself if it didn't happen.
+ */
+static void mdss_dsi_early_power_work(struct work_struct *work)
+{
+	struct mdss_dsi_ctrl_pdata *ctrl_pdata;
+	struct mdss_panel_data *pdata;
+
+	ctrl_pdata = container_of(work, struct mdss_dsi_ctrl_pdata,
+				early_power_work);
+	pdata = &ctrl_pdata->panel_data;
+
+	if (!mdss_panel_is_power_off(pdata->panel_info.panel_power_state) ||
+		pdata->panel_info.dynamic_switch_pending ||
+		ctrl_pdata->early_power_on)
+		return;
+
+	if (!mdss_dsi_panel_power_on(pdata))
+		ctrl_pdata->early_power_on = true;
+}
+
+static int mdss_dsi_early_power(struct mdss_panel_data *pdata, int enable)
+{
+	struct mdss_dsi_ctrl_pdata *ctrl_pdata;
+
+	ctrl_pdata = container_of(pdata, struct mdss_dsi_ctrl_pdata,
+				panel_data);
+
+	if (enable) {
+		queue_work(system_unbound_wq, &ctrl_pdata->early_power_work);
+		return 0;
+	}
+
+	flush_work(&ctrl_pdata->early_power_work);
+	if (ctrl_pdata->early_power_on) {
+		pr_debug("%s: unblank failed, undo early power on\n",
+			__func__);
+		mdss_dsi_panel_power_off(pdata);
+		ctrl_pdata->early_power_on = false;
+	}
+
+	return 0;
+}
+
 static void mdss_dsi_put_dt_vreg_data(struct device *dev,
 	struct dss_module_power *module_power)
 {
@@ -597,6 +654,8 @@ static int mdss_dsi_off(struct mdss_panel_data *pdata, int power_state)
 	ctrl_pdata = container_of(pdata, struct mdss_dsi_ctrl_pdata,
 				panel_data);
 
+	flush_work(&ctrl_pdata->early_power_work);
+
 	mutex_lock(&ctrl_pdata->mutex);
 	panel_info = &ctrl_pdata->panel_data.panel_info;
 
@@ -761,6 +820,9 @@ int mdss_dsi_on(struct mdss_panel_data *pdata)
 	ctrl_pdata = container_of(pdata, struct mdss_dsi_ctrl_pdata,
 				panel_data);
 
+	/* let an early panel power up started at unblank complete */
+	flush_work(&ctrl_pdata->early_power_work);
+
 	cur_power_state = pdata->panel_info.panel_power_state;
 	pr_debug("%s+: ctrl=%pK ndx=%d cur_power_state=%d\n", __func__,
 		ctrl_pdata, ctrl_pdata->ndx, cur_power_state);
@@ -796,6 +858,7 @@ int mdss_dsi_on(struct mdss_panel_data *pdata)
 	 * Phy. Phy and ctrl setup need to be done before enabling the link
 	 * clocks.
 	 */
+	ATRACE_BEGIN("dsi_link_on");
 	mdss_dsi_clk_ctrl(ctrl_pdata, DSI_BUS_CLKS, 1);
 
 	/*
@@ -840,6 +903,7 @@ int mdss_dsi_on(struct mdss_panel_data *pdata)
 
 	if (pdata->panel_info.type == MIPI_CMD_PANEL)
 		mdss_dsi_clk_ctrl(ctrl_pdata, DSI_ALL_CLKS, 0);
+	ATRACE_END("dsi_link_on");
 
 end:
 	pr_debug("%s-:\n", __func__);
@@ -929,7 +993,9 @@ static int mdss_dsi_unblank(struct mdss_panel_data *pdata)
 
 	if (!(ctrl_pdata->ctrl_state & CTRL_STATE_PANEL_INIT)) {
 		if (!pdata->panel_info.dynamic_switch_pending) {
+			ATRACE_BEGIN("dsi_panel_on_cmds");
 			ret = ctrl_pdata->on(pdata);
+			ATRACE_END("dsi_panel_on_cmds");
 			if (ret) {
 				pr_err("%s: unable to initialize the panel\n",
 							__func__);
@@ -1599,6 +1665,9 @@ static int mdss_dsi_event_handler(struct mdss_panel_data *pdata,
 		if (ctrl_pdata->check_status)
 			rc = ctrl_pdata->check_status(ctrl_pdata);
 		break;
+	case MDSS_EVENT_PANEL_EARLY_POWER:
+		rc = mdss_dsi_early_power(pdata, (int) (unsigned long) arg);
+		break;
 	case MDSS_EVENT_PANEL_TIMING_SWITCH:
 		rc = mdss_dsi_panel_timing_switch(ctrl_pdata, arg);
 		break;
@@ -2308,6 +2377,7 @@ int dsi_panel_device_register(struct device_node *pan_node,
 			ctrl_pdata->pclk_rate, ctrl_pdata->byte_clk_rate);
 
 	ctrl_pdata->ctrl_state = CTRL_STATE_UNKNOWN;
+	INIT_WORK(&ctrl_pdata->early_power_work, mdss_dsi_early_power_work);
 
 	/*
 	 * If ULPS during suspend is enabled, add an extra vote for the
@@ -430,6 +430,8 @@ struct mdss_dsi_ctrl_pdata {
 	u32 ulps_phyrst_ctrl_off;
 	bool ulps;
 	bool core_power;
+	bool early_power_on;
+	struct work_struct early_power_work;
 	bool mmss_clamp;
 	bool timing_db_mode;
 
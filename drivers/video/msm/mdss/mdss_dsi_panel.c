@@ -1620,12 +1620,58 @@ static int mdss_dsi_panel_timing_from_dt(struct device_node *np,
 	return 0;
 }
 
+/* largest run of commands packed into one DMA transfer by the batching */
+#define DSI_CMD_BATCH_MAX_LEN	256
+
+/*
+ * Every command marked last is its own DMA transfer, with an IOMMU map and
+ * a wait for the DMA done interrupt. Panel init tables mostly mark every
+ * command last, even the ones without a delay, so at unblank the time
+ * goes to the transfers rather than to the panel. Runs of commands that
+ * need no delay and no ack are packed into one transfer here, once when
+ * the commands are parsed. HS commands of a video mode panel have to fit
+ * into the blanking period, so those are only packed if @hs_ok.
+ */
+static void mdss_dsi_panel_batch_cmds(struct dsi_panel_cmds *pcmds,
+		bool hs_ok)
+{
+	struct dsi_ctrl_hdr *dchdr, *next;
+	int i, len = 0, packed = 0;
+
+	if (!pcmds->cmds || (pcmds->link_state != DSI_LP_MODE && !hs_ok))
+		return;
+
+	for (i = 0; i < pcmds->cmd_cnt - 1; i++) {
+		dchdr = &pcmds->cmds[i].dchdr;
+		next = &pcmds->cmds[i + 1].dchdr;
+
+		len += DSI_HOST_HDR_SIZE + ALIGN(dchdr->dlen, 4);
+		if (dchdr->wait || dchdr->ack || next->ack ||
+			len + DSI_HOST_HDR_SIZE + ALIGN(next->dlen, 4) >
+				DSI_CMD_BATCH_MAX_LEN) {
+			if (dchdr->last)
+				len = 0;
+			continue;
+		}
+
+		if (dchdr->last) {
+			dchdr->last = 0;
+			packed++;
+		}
+	}
+
+	pr_debug("%s: packed %d of %d commands\n", __func__, packed,
+		pcmds->cmd_cnt);
+}
+
 static void  mdss_dsi_panel_config_res_properties(struct device_node *np,
 		u32 sim_panel_mode, struct dsi_panel_timing *pt)
 {
 	mdss_dsi_parse_dcs_cmds(np, &pt->on_cmds,
 			"qcom,mdss-dsi-on-command",
 			"qcom,mdss-dsi-on-command-state");
+	if (of_property_read_bool(np, "qcom,mdss-dsi-on-command-batch"))
+		mdss_dsi_panel_batch_cmds(&pt->on_cmds, false);
 	mdss_dsi_parse_dcs_cmds(np, &pt->switch_cmds,
 			"qcom,mdss-dsi-timing-switch-command",
 			"qcom,mdss-dsi-timing-switch-command-state");
@@ -2143,6 +2189,22 @@ static int mdss_panel_parse_dt(struct device_node *np,
 	rc = of_property_read_u32(np, "htc,mdss-sre-ebi-level", &tmp);
 	ctrl_pdata->sre_ebi_value = (!rc ? tmp : 0);
 
+	/*
+	 * The CABC, dimming and SRE sets go out on brightness changes from
+	 * the DSI thread, in HS mode unless the panel says otherwise. HS is
+	 * only safe to pack on a command mode panel.
+	 */
+	if (of_property_read_bool(np, "htc,mdss-dsi-runtime-command-batch")) {
+		bool hs_ok = pinfo->mipi.mode == DSI_CMD_MODE;
+
+		mdss_dsi_panel_batch_cmds(&ctrl_pdata->cabc_off_cmds, hs_ok);
+		mdss_dsi_panel_batch_cmds(&ctrl_pdata->cabc_ui_cmds, hs_ok);
+		mdss_dsi_panel_batch_cmds(&ctrl_pdata->cabc_video_cmds, hs_ok);
+		mdss_dsi_panel_batch_cmds(&ctrl_pdata->dimming_on_cmds, hs_ok);
+		mdss_dsi_panel_batch_cmds(&ctrl_pdata->sre_on_cmds, hs_ok);
+		mdss_dsi_panel_batch_cmds(&ctrl_pdata->sre_off_cmds, hs_ok);
+	}
+
 	/* Suported brightness transfer for Backlight 1.0*/
 	pinfo->brt_bl_table.size = 0;
 	htc_mdss_dsi_parse_brt_bl_table(np, pinfo, "htc,brt-bl-table");
@@ -18,6 +18,7 @@
 
 #include <linux/bootmem.h>
 #include <linux/console.h>
+#include <linux/cpu_boost.h>
 #include <linux/debugfs.h>
 #include <linux/delay.h>
 #include <linux/device.h>
@@ -1688,9 +1689,19 @@ static int mdss_fb_blank_unblank(struct msm_fb_data_type *mfd)
 		return 0;
 	}
 
+	/* panel power up runs while the MDP and its clocks are restored */
+	if (mdss_panel_is_power_off(cur_power_state))
+		mdss_fb_send_panel_event(mfd, MDSS_EVENT_PANEL_EARLY_POWER,
+			(void *) 1);
+
 	if (mfd->mdp.on_fnc) {
+		ATRACE_BEGIN("mdp_on");
 		ret = mfd->mdp.on_fnc(mfd);
+		ATRACE_END("mdp_on");
 		if (ret) {
+			if (mdss_panel_is_power_off(cur_power_state))
+				mdss_fb_send_panel_event(mfd,
+					MDSS_EVENT_PANEL_EARLY_POWER, NULL);
 			mdss_fb_stop_disp_thread(mfd);
 			goto error;
 		}
@@ -3133,6 +3144,7 @@ static int mdss_fb_pan_display_ex(struct fb_info *info,
 	atomic_inc(&mfd->kickoff_pending);
 	wake_up_all(&mfd->commit_wait_q);
 	mutex_unlock(&mfd->mdp_sync_pt_data.sync_mutex);
+	cpu_boost_frame_event();
 	if (wait_for_finish) {
 		ret = mdss_fb_pan_idle(mfd);
 		if (ret)
@@ -3925,6 +3937,37 @@ static int mdss_fb_display_commit(struct fb_info *info,
 	return ret;
 }
 
+static int mdss_fb_atomic_commit(struct fb_info *info,
+						unsigned long *argp)
+{
+	struct msm_fb_data_type *mfd = (struct msm_fb_data_type *)info->par;
+	struct mdp_atomic_commit commit;
+	int ret;
+
+	if (!mfd->mdp.atomic_validate)
+		return -ENOSYS;
+
+	/* A dynamic mode switch is staged by the separate ioctls */
+	if (mfd->switch_state != MDSS_MDP_NO_UPDATE_REQUESTED)
+		return -EBUSY;
+
+	ret = copy_from_user(&commit, argp, sizeof(commit));
+	if (ret) {
+		pr_err("%s:copy_from_user failed\n", __func__);
+		return -EFAULT;
+	}
+
+	ret = mfd->mdp.atomic_validate(mfd, &commit);
+
+	if (copy_to_user(argp, &commit, sizeof(commit)))
+		ret = -EFAULT;
+
+	if (ret)
+		return ret;
+
+	return mdss_fb_pan_display_ex(info, &commit.commit);
+}
+
 int mdss_fb_switch_check(struct msm_fb_data_type *mfd, u32 mode)
 {
 	struct mdss_panel_info *pinfo = NULL;
@@ -4032,6 +4075,7 @@ static int __ioctl_wait_idle(struct msm_fb_data_type *mfd, u32 cmd)
 
 	if (mfd->wait_for_kickoff &&
 		((cmd == MSMFB_OVERLAY_PREPARE) ||
+		(cmd == MSMFB_ATOMIC_COMMIT) ||
 		(cmd == MSMFB_BUFFER_SYNC) ||
 		(cmd == MSMFB_OVERLAY_PLAY) ||
 		(cmd == MSMFB_OVERLAY_UNSET) ||
@@ -4047,7 +4091,8 @@ static int __ioctl_wait_idle(struct msm_fb_data_type *mfd, u32 cmd)
 		(cmd != MSMFB_HISTOGRAM_START) &&
 		(cmd != MSMFB_HISTOGRAM_STOP) &&
 		(cmd != MSMFB_HISTOGRAM) &&
-		(cmd != MSMFB_OVERLAY_PREPARE)) {
+		(cmd != MSMFB_OVERLAY_PREPARE) &&
+		(cmd != MSMFB_ATOMIC_COMMIT)) {
 		ret = mdss_fb_pan_idle(mfd);
 	}
 
@@ -4177,6 +4222,10 @@ int mdss_fb_do_ioctl(struct fb_info *info, unsigned int cmd,
 		ret = mdss_fb_display_commit(info, argp);
 		break;
 
+	case MSMFB_ATOMIC_COMMIT:
+		ret = mdss_fb_atomic_commit(info, argp);
+		break;
+
 	case MSMFB_LPM_ENABLE:
 		ret = copy_from_user(&dsi_mode, argp, sizeof(dsi_mode));
 		if (ret) {
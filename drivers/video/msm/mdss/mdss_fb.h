@@ -199,6 +199,8 @@ struct msm_mdp_interface {
 					struct mdp_display_commit *data);
 	int (*pre_commit_fnc)(struct msm_fb_data_type *mfd);
 	int (*ioctl_handler)(struct msm_fb_data_type *mfd, u32 cmd, void *arg);
+	int (*atomic_validate)(struct msm_fb_data_type *mfd,
+				struct mdp_atomic_commit *commit);
 	void (*dma_fnc)(struct msm_fb_data_type *mfd);
 	int (*cursor_update)(struct msm_fb_data_type *mfd,
 				struct fb_cursor *cursor);
@@ -15,6 +15,7 @@
 #ifndef MDSS_MDP_H
 #define MDSS_MDP_H
 
+#include <linux/input.h>
 #include <linux/io.h>
 #include <linux/msm_mdp.h>
 #include <linux/platform_device.h>
@@ -30,6 +31,9 @@
 #define MDSS_MDP_DEFAULT_INTR_MASK 0
 #define MDSS_MDP_PIXEL_RAM_SIZE (50 * 1024)
 
+/* frames in a row that need less before the bus and clock votes go down */
+#define MDSS_MDP_PERF_LOWER_HOLD 3
+
 #define SVS_PLUS_MIN_HW_110 171430000
 #define SVS_PLUS_MAX_HW_110 266670000
 
@@ -265,9 +269,14 @@ struct mdss_mdp_ctl {
 	int force_screen_state;
 	struct mdss_mdp_perf_params cur_perf;
 	struct mdss_mdp_perf_params new_perf;
+	struct mdss_mdp_perf_params next_perf; /* validated next commit */
 	u32 perf_transaction_status;
 	bool perf_release_ctl_bw;
 	u64 bw_pending;
+	u32 perf_lower_cnt;
+	ktime_t perf_raise_time;
+	u32 underrun_late_vote_cnt;
+	u32 underrun_low_vote_cnt;
 	bool disable_prefill;
 
 	bool traffic_shaper_enabled;
@@ -413,6 +422,9 @@ struct pp_hist_col_info {
 	char __iomem *base;
 	u32 intr_shift;
 	u32 disp_num;
+	u32 event_ms;
+	unsigned long next_event;
+	struct work_struct event_work;
 };
 
 struct mdss_mdp_ad {
@@ -478,6 +490,48 @@ struct mdss_mdp_shared_reg_ctrl {
 	u32 bit_off;
 };
 
+/*
+ * struct mdss_mdp_perf_key - inputs of the perf calculation of a pipe
+ *
+ * Cleared before it is filled so two keys can be compared with memcmp().
+ */
+struct mdss_mdp_perf_key {
+	struct mdss_mdp_mixer *mixer;
+	struct mdss_mdp_format_params *src_fmt;
+	struct mdss_rect src;
+	struct mdss_rect dst;
+	u32 calc_flags;
+	u32 pipe_flags;
+	u32 bwc_mode;
+	u32 fps;
+	u32 v_total;
+	u32 xres;
+	u32 h_total;
+	u32 smp_bytes;
+	u32 h_overfetch;
+	u32 latency_buff_per;
+	u8 horz_deci;
+	u8 vert_deci;
+	u8 enable_pxl_ext;
+	u8 is_fbc;
+	u8 is_cmd;
+	u8 is_caf;
+	u8 no_prefill;
+};
+
+/*
+ * struct mdss_mdp_perf_cache - last perf calculation of a pipe
+ * @valid: the results below were calculated for @key
+ * @rate: mdp clock rate before the clock fudge factor is applied
+ */
+struct mdss_mdp_perf_cache {
+	bool valid;
+	struct mdss_mdp_perf_key key;
+	u64 bw_overlap;
+	u32 rate;
+	u32 prefill_bytes;
+};
+
 struct mdss_mdp_pipe {
 	u32 num;
 	u32 type;
@@ -541,6 +595,8 @@ struct mdss_mdp_pipe {
 	u8 chroma_sample_h;
 	u8 chroma_sample_v;
 	uint8_t color_space;
+
+	struct mdss_mdp_perf_cache perf_cache;
 };
 
 struct mdss_mdp_writeback_arg {
@@ -594,6 +650,21 @@ struct mdss_overlay_private {
 	struct kthread_worker worker;
 	struct kthread_work vsync_work;
 	struct task_struct *thread;
+
+	/* refresh rate that follows the content, video mode panels only */
+	bool dfps_auto;
+	atomic_t dfps_commit_cnt;
+	ktime_t dfps_window_start;
+	int dfps_pending_fps;
+	u32 dfps_hold_cnt;
+	unsigned long dfps_input_time;
+	struct delayed_work dfps_auto_work;
+	struct work_struct dfps_input_work;
+	struct input_handler dfps_input_handler;
+
+	struct mdp_hist_ring *hist_ring;
+	struct mutex hist_ring_lock;
+	u32 hist_event_ms;
 };
 
 struct mdss_mdp_set_ot_params {
@@ -984,6 +1055,7 @@ int mdss_mdp_mixer_handoff(struct mdss_mdp_ctl *ctl, u32 num,
 void mdss_mdp_ctl_perf_set_transaction_status(struct mdss_mdp_ctl *ctl,
 	enum mdss_mdp_perf_state_type component, bool new_status);
 void mdss_mdp_ctl_perf_release_bw(struct mdss_mdp_ctl *ctl);
+void mdss_mdp_ctl_perf_prevote(struct mdss_mdp_ctl *ctl);
 void mdss_mdp_get_interface_type(struct mdss_mdp_ctl *ctl, int *intf_type,
 		int *split_needed);
 struct mdss_mdp_mixer *mdss_mdp_wb_mixer_alloc(int rotator);
@@ -1015,6 +1087,7 @@ int mdss_mdp_pp_resume(struct mdss_mdp_ctl *ctl, u32 mixer_num);
 
 int mdss_mdp_pp_setup(struct mdss_mdp_ctl *ctl);
 int mdss_mdp_pp_setup_locked(struct mdss_mdp_ctl *ctl);
+bool mdss_mdp_pp_pending(struct mdss_mdp_ctl *ctl);
 int mdss_mdp_pipe_pp_setup(struct mdss_mdp_pipe *pipe, u32 *op);
 int mdss_mdp_pipe_sspp_setup(struct mdss_mdp_pipe *pipe, u32 *op);
 void mdss_mdp_pipe_sspp_term(struct mdss_mdp_pipe *pipe);
@@ -1037,6 +1110,7 @@ int mdss_mdp_hist_intr_setup(struct mdss_intr *intr, int state);
 int mdss_mdp_hist_start(struct mdp_histogram_start_req *req);
 int mdss_mdp_hist_stop(u32 block);
 int mdss_mdp_hist_collect(struct mdp_histogram_data *hist);
+int mdss_mdp_hist_event_config(struct msm_fb_data_type *mfd, u32 ms);
 void mdss_mdp_hist_intr_done(u32 isr);
 
 void mdss_mdp_hscl_init(struct mdss_mdp_pipe *pipe);
@@ -1103,6 +1177,9 @@ int mdss_mdp_calc_phase_step(u32 src, u32 dst, u32 *out_phase);
 void mdss_mdp_intersect_rect(struct mdss_rect *res_rect,
 	const struct mdss_rect *dst_rect,
 	const struct mdss_rect *sci_rect);
+void mdss_mdp_combine_rect(struct mdss_rect *res_rect,
+	const struct mdss_rect *rect1,
+	const struct mdss_rect *rect2);
 void mdss_mdp_crop_rect(struct mdss_rect *src_rect,
 	struct mdss_rect *dst_rect,
 	const struct mdss_rect *sci_rect);
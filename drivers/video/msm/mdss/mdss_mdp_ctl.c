@@ -523,11 +523,17 @@ int mdss_mdp_perf_calc_pipe(struct mdss_mdp_pipe *pipe,
 	bool is_fbc = false;
 	struct mdss_mdp_prefill_params prefill_params;
 	struct mdss_data_type *mdata = mdss_mdp_get_mdata();
+	struct mdss_mdp_perf_cache *cache;
+	struct mdss_mdp_perf_key key;
 	bool calc_smp_size = false;
+	bool no_prefill;
+	u32 smp_bytes = 0;
 
 	if (!pipe || !perf || !pipe->mixer_left)
 		return -EINVAL;
 
+	cache = &pipe->perf_cache;
+
 	mixer = pipe->mixer_left;
 
 	dst = pipe->dst;
@@ -568,6 +574,58 @@ int mdss_mdp_perf_calc_pipe(struct mdss_mdp_pipe *pipe,
 
 	pr_debug("v_total=%d, xres=%d fps=%d\n", v_total, xres, fps);
 
+	no_prefill = mixer->ctl->intf_num == MDSS_MDP_NO_INTF ||
+		mdata->disable_prefill ||
+		mixer->ctl->disable_prefill ||
+		(pipe->flags & MDP_SOLID_FILL);
+
+	if (!no_prefill) {
+		calc_smp_size = (flags & PERF_CALC_PIPE_CALC_SMP_SIZE) ?
+			true : false;
+		smp_bytes = mdss_mdp_perf_calc_smp_size(pipe, calc_smp_size);
+	}
+
+	/*
+	 * Most commits don't change the layers, only their buffers. The
+	 * numbers of the last calculation are kept with the pipe together
+	 * with everything they were calculated from and used again when none
+	 * of that changed.
+	 */
+	memset(&key, 0, sizeof(key));
+	key.mixer = mixer;
+	key.src_fmt = pipe->src_fmt;
+	key.src = src;
+	key.dst = dst;
+	key.calc_flags = flags & ~PERF_CALC_PIPE_APPLY_CLK_FUDGE;
+	key.pipe_flags = pipe->flags;
+	key.bwc_mode = pipe->bwc_mode;
+	key.fps = fps;
+	key.v_total = v_total;
+	key.xres = xres;
+	key.h_total = h_total;
+	key.smp_bytes = smp_bytes;
+	key.h_overfetch = pipe->scale.left_ftch[0] + pipe->scale.right_ftch[0];
+	key.latency_buff_per = mdata->latency_buff_per;
+	key.horz_deci = pipe->horz_deci;
+	key.vert_deci = pipe->vert_deci;
+	key.enable_pxl_ext = pipe->scale.enable_pxl_ext;
+	key.is_fbc = is_fbc;
+	key.is_cmd = !mixer->ctl->is_video_mode;
+	key.is_caf = mdss_mdp_perf_is_caf(pipe);
+	key.no_prefill = no_prefill;
+
+	if (cache->valid && !memcmp(&cache->key, &key, sizeof(key))) {
+		mdata->perf_cache_hits++;
+		perf->bw_overlap = cache->bw_overlap;
+		perf->prefill_bytes = cache->prefill_bytes;
+		rate = cache->rate;
+		if (!no_prefill)
+			mdss_mdp_get_bw_vote_mode(mixer, mdata->mdp_rev, perf,
+				PERF_CALC_VOTE_MODE_PER_PIPE, flags);
+		goto apply_fudge;
+	}
+	mdata->perf_cache_misses++;
+
 	/*
 	 * when doing vertical decimation lines will be skipped, hence there is
 	 * no need to account for these lines in MDP clock or request bus
@@ -644,22 +702,12 @@ int mdss_mdp_perf_calc_pipe(struct mdss_mdp_pipe *pipe,
 		}
 	}
 
-	if (flags & PERF_CALC_PIPE_APPLY_CLK_FUDGE)
-		perf->mdp_clk_rate = mdss_mdp_clk_fudge_factor(mixer, rate);
-	else
-		perf->mdp_clk_rate = rate;
-
-	if (mixer->ctl->intf_num == MDSS_MDP_NO_INTF ||
-		mdata->disable_prefill ||
-		mixer->ctl->disable_prefill ||
-		(pipe->flags & MDP_SOLID_FILL)) {
+	if (no_prefill) {
 		perf->prefill_bytes = 0;
-		goto exit;
+		goto store;
 	}
 
-	calc_smp_size = (flags & PERF_CALC_PIPE_CALC_SMP_SIZE) ? true : false;
-	prefill_params.smp_bytes = mdss_mdp_perf_calc_smp_size(pipe,
-			calc_smp_size);
+	prefill_params.smp_bytes = smp_bytes;
 	prefill_params.xres = xres;
 	prefill_params.src_w = src.w;
 	prefill_params.src_h = src_h;
@@ -668,7 +716,7 @@ int mdss_mdp_perf_calc_pipe(struct mdss_mdp_pipe *pipe,
 	prefill_params.dst_y = dst.y;
 	prefill_params.bpp = pipe->src_fmt->bpp;
 	prefill_params.is_yuv = pipe->src_fmt->is_yuv;
-	prefill_params.is_caf = mdss_mdp_perf_is_caf(pipe);
+	prefill_params.is_caf = key.is_caf;
 	prefill_params.is_fbc = is_fbc;
 	prefill_params.is_bwc = pipe->bwc_mode;
 	prefill_params.is_tile = pipe->src_fmt->tile;
@@ -689,7 +737,19 @@ int mdss_mdp_perf_calc_pipe(struct mdss_mdp_pipe *pipe,
 		perf->prefill_bytes =
 			mdss_mdp_perf_calc_pipe_prefill_cmd(&prefill_params);
 
-exit:
+store:
+	cache->key = key;
+	cache->bw_overlap = perf->bw_overlap;
+	cache->rate = rate;
+	cache->prefill_bytes = perf->prefill_bytes;
+	cache->valid = true;
+
+apply_fudge:
+	if (flags & PERF_CALC_PIPE_APPLY_CLK_FUDGE)
+		perf->mdp_clk_rate = mdss_mdp_clk_fudge_factor(mixer, rate);
+	else
+		perf->mdp_clk_rate = rate;
+
 	pr_debug("mixer=%d pnum=%d clk_rate=%u bw_overlap=%llu prefill=%d %s\n",
 		 mixer->num, pipe->num, perf->mdp_clk_rate, perf->bw_overlap,
 		 perf->prefill_bytes, mdata->disable_prefill ?
@@ -1073,6 +1133,23 @@ static void __mdss_mdp_perf_calc_ctl_helper(struct mdss_mdp_ctl *ctl,
 			*(perf->bw_vote_mode));
 }
 
+/* the ib fudge factors that the bus vote of @ctl is made with */
+static void __mdss_mdp_perf_ctl_ib_fudge(struct mdss_mdp_ctl *ctl,
+		struct mdss_mdp_perf_params *perf)
+{
+	if (ctl->is_video_mode || ((ctl->intf_type != MDSS_MDP_NO_INTF) &&
+		mdss_mdp_video_mode_intf_connected(ctl))) {
+		perf->bw_ctl =
+			max(apply_fudge_factor(perf->bw_overlap,
+				&mdss_res->ib_factor_overlap),
+			apply_fudge_factor(perf->bw_prefill,
+				&mdss_res->ib_factor));
+	} else if (ctl->intf_num != MDSS_MDP_NO_INTF) {
+		perf->bw_ctl = apply_fudge_factor(perf->bw_ctl,
+				&mdss_res->ib_factor_cmd);
+	}
+}
+
 int mdss_mdp_perf_bw_check(struct mdss_mdp_ctl *ctl,
 		struct mdss_mdp_pipe **left_plist, int left_cnt,
 		struct mdss_mdp_pipe **right_plist, int right_cnt,
@@ -1114,6 +1191,10 @@ int mdss_mdp_perf_bw_check(struct mdss_mdp_ctl *ctl,
 		return -E2BIG;
 	}
 
+	/* what mdss_mdp_ctl_perf_prevote() votes for */
+	__mdss_mdp_perf_ctl_ib_fudge(ctl, &perf);
+	ctl->next_perf = perf;
+
 	return 0;
 }
 
@@ -1173,18 +1254,8 @@ static void mdss_mdp_perf_calc_ctl(struct mdss_mdp_ctl *ctl,
 
 	__mdss_mdp_perf_calc_ctl_helper(ctl, perf,
 		left_plist, left_cnt, right_plist, right_cnt, 0);
+	__mdss_mdp_perf_ctl_ib_fudge(ctl, perf);
 
-	if (ctl->is_video_mode || ((ctl->intf_type != MDSS_MDP_NO_INTF) &&
-		mdss_mdp_video_mode_intf_connected(ctl))) {
-		perf->bw_ctl =
-			max(apply_fudge_factor(perf->bw_overlap,
-				&mdss_res->ib_factor_overlap),
-			apply_fudge_factor(perf->bw_prefill,
-				&mdss_res->ib_factor));
-	} else if (ctl->intf_num != MDSS_MDP_NO_INTF) {
-		perf->bw_ctl = apply_fudge_factor(perf->bw_ctl,
-				&mdss_res->ib_factor_cmd);
-	}
 	pr_debug("ctl=%d clk_rate=%u\n", ctl->num, perf->mdp_clk_rate);
 	pr_debug("bw_overlap=%llu bw_prefill=%llu prefill_bytes=%d\n",
 		 perf->bw_overlap, perf->bw_prefill, perf->prefill_bytes);
@@ -1512,7 +1583,7 @@ static void mdss_mdp_ctl_perf_update(struct mdss_mdp_ctl *ctl,
 	struct mdss_mdp_perf_params *new, *old;
 	int update_bus = 0, update_clk = 0;
 	struct mdss_data_type *mdata;
-	bool is_bw_released;
+	bool is_bw_released, lower;
 	u32 clk_rate = 0;
 
 	if (!ctl || !ctl->mdata)
@@ -1531,21 +1602,46 @@ static void mdss_mdp_ctl_perf_update(struct mdss_mdp_ctl *ctl,
 	is_bw_released = !mdss_mdp_ctl_perf_get_transaction_status(ctl);
 
 	if (mdss_mdp_ctl_is_power_on(ctl)) {
+		bool release = false;
+
 		if (ctl->perf_release_ctl_bw &&
-			mdata->enable_rotator_bw_release)
+			mdata->enable_rotator_bw_release) {
 			mdss_mdp_perf_release_ctl_bw(ctl, new);
-		else if (is_bw_released || params_changed)
+			release = true;
+		} else if (is_bw_released || params_changed) {
 			mdss_mdp_perf_calc_ctl(ctl, new);
+		}
+
+		/*
+		 * Votes only go down once that many frames in a row needed
+		 * less, so a light frame between heavy ones doesn't make the
+		 * next heavy frame wait for the bus to ramp up again.
+		 */
+		if (!params_changed && !release &&
+		    ((new->bw_ctl < old->bw_ctl) ||
+		     (new->mdp_clk_rate < old->mdp_clk_rate))) {
+			lower = (++ctl->perf_lower_cnt >=
+				mdata->perf_lower_hold);
+		} else {
+			ctl->perf_lower_cnt = 0;
+			lower = release;
+		}
+		if (lower)
+			ctl->perf_lower_cnt = 0;
+
 		/*
 		 * If params have just changed delay the update until
 		 * later once the hw configuration has been flushed to
 		 * MDP.
 		 */
 		if ((params_changed && (new->bw_ctl > old->bw_ctl)) ||
-		    (!params_changed && (new->bw_ctl < old->bw_ctl))) {
+		    (!params_changed && lower &&
+		     (new->bw_ctl < old->bw_ctl))) {
 			pr_debug("c=%d p=%d new_bw=%llu,old_bw=%llu\n",
 				ctl->num, params_changed, new->bw_ctl,
 				old->bw_ctl);
+			if (new->bw_ctl > old->bw_ctl)
+				ctl->perf_raise_time = ktime_get();
 			old->bw_ctl = new->bw_ctl;
 			bitmap_copy(old->bw_vote_mode, new->bw_vote_mode,
 				MDSS_MDP_BW_MODE_MAX);
@@ -1558,7 +1654,7 @@ static void mdss_mdp_ctl_perf_update(struct mdss_mdp_ctl *ctl,
 		 * would be decreased after traffic shaper is done.
 		 */
 		if ((params_changed && (new->mdp_clk_rate > old->mdp_clk_rate))
-			 || (!params_changed &&
+			 || (!params_changed && lower &&
 			 (new->mdp_clk_rate < old->mdp_clk_rate) &&
 			(false == is_traffic_shaper_enabled(mdata)))) {
 			old->mdp_clk_rate = new->mdp_clk_rate;
@@ -1597,6 +1693,71 @@ static void mdss_mdp_ctl_perf_update(struct mdss_mdp_ctl *ctl,
 	ATRACE_END(__func__);
 }
 
+/**
+ * mdss_mdp_ctl_perf_prevote() - raise the votes for a validated commit
+ * @ctl: ctl that the next commit passed mdss_mdp_perf_bw_check() for
+ *
+ * Raising the bus vote at kickoff has to go through msm_bus and the RPM,
+ * which can still be in flight when the frame starts fetching. The votes
+ * the next commit needs are raised here instead, as soon as it has been
+ * validated, which is well ahead of its kickoff. Nothing is lowered here,
+ * that is left to mdss_mdp_ctl_perf_update() after the frame.
+ */
+void mdss_mdp_ctl_perf_prevote(struct mdss_mdp_ctl *ctl)
+{
+	struct mdss_mdp_perf_params *cur, *next;
+	struct mdss_data_type *mdata;
+	bool update_bus = false, update_clk = false;
+	u32 clk_rate = 0;
+
+	if (!ctl || !ctl->mdata || (ctl->intf_type == MDSS_MDP_NO_INTF))
+		return;
+
+	mdata = ctl->mdata;
+	mutex_lock(&mdss_mdp_ctl_lock);
+	if (!mdss_mdp_ctl_is_power_on(ctl))
+		goto done;
+
+	cur = &ctl->cur_perf;
+	next = &ctl->next_perf;
+
+	if (next->bw_ctl > cur->bw_ctl) {
+		cur->bw_ctl = next->bw_ctl;
+		bitmap_or(cur->bw_vote_mode, cur->bw_vote_mode,
+			next->bw_vote_mode, MDSS_MDP_BW_MODE_MAX);
+		update_bus = true;
+	}
+
+	if (next->mdp_clk_rate > cur->mdp_clk_rate) {
+		cur->mdp_clk_rate = next->mdp_clk_rate;
+		update_clk = true;
+	}
+
+	if (!update_bus && !update_clk)
+		goto done;
+
+	pr_debug("c=%d prevote bw=%llu clk=%u\n", ctl->num, cur->bw_ctl,
+		cur->mdp_clk_rate);
+	ctl->perf_lower_cnt = 0;
+
+	/* same order as mdss_mdp_ctl_perf_update(), bus before clock */
+	if (update_clk)
+		clk_rate = mdss_mdp_get_mdp_clk_rate(mdata);
+
+	if (update_bus) {
+		ctl->perf_raise_time = ktime_get();
+		mdss_mdp_ctl_perf_update_bus(mdata,
+			mdss_mdp_is_nrt_ctl_path(ctl), clk_rate);
+	}
+
+	if (update_clk) {
+		ATRACE_INT("mdp_clk", clk_rate);
+		mdss_mdp_set_clk_rate(clk_rate);
+	}
+done:
+	mutex_unlock(&mdss_mdp_ctl_lock);
+}
+
 static struct mdss_mdp_ctl *mdss_mdp_ctl_alloc(struct mdss_data_type *mdata,
 					       u32 off)
 {
@@ -449,6 +449,9 @@ static void __stats_ctl_dump(struct mdss_mdp_ctl *ctl, struct seq_file *s)
 				ctl->intf_num, ctl->play_cnt);
 		seq_printf(s, "vsync: %08u \tunderrun: %08u\n",
 				ctl->vsync_cnt, ctl->underrun_cnt);
+		seq_printf(s, "underrun low vote: %08u \tlate vote: %08u\n",
+				ctl->underrun_low_vote_cnt,
+				ctl->underrun_late_vote_cnt);
 		if (ctl->mfd) {
 			seq_printf(s, "user_bl: %08u \tmod_bl: %08u\n",
 				ctl->mfd->bl_level, ctl->mfd->bl_level_scaled);
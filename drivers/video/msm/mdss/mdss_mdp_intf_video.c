@@ -663,6 +663,21 @@ static void recover_underrun_work(struct work_struct *work)
 	mdss_mdp_clk_ctrl(MDP_BLOCK_POWER_OFF);
 }
 
+/*
+ * Tell the underruns that came with a bus vote below what the frame needs,
+ * or within a frame of the vote being raised, from the other ones.
+ */
+static void mdss_mdp_video_underrun_account(struct mdss_mdp_ctl *ctl)
+{
+	u32 fps = mdss_panel_get_framerate(&ctl->panel_data->panel_info);
+	s64 since_raise = ktime_us_delta(ktime_get(), ctl->perf_raise_time);
+
+	if (ctl->cur_perf.bw_ctl < ctl->new_perf.bw_ctl)
+		ctl->underrun_low_vote_cnt++;
+	else if (fps && (since_raise < USEC_PER_SEC / fps))
+		ctl->underrun_late_vote_cnt++;
+}
+
 static void mdss_mdp_video_underrun_intr_done(void *arg)
 {
 	struct mdss_mdp_ctl *ctl = arg;
@@ -676,6 +691,7 @@ static void mdss_mdp_video_underrun_intr_done(void *arg)
 	cur_perf = &ctl->cur_perf;
 
 	ctl->underrun_cnt++;
+	mdss_mdp_video_underrun_account(ctl);
 	MDSS_XLOG(ctl->num, ctl->underrun_cnt);
 	trace_mdp_video_underrun_done(ctl->num, ctl->underrun_cnt);
 	pr_err("display underrun detected for ctl=%d count=%d\n", ctl->num,
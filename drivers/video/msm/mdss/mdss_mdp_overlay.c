@@ -26,6 +26,7 @@
 #include <linux/memblock.h>
 #include <linux/sort.h>
 #include <linux/sw_sync.h>
+#include <linux/vmalloc.h>
 
 #include <linux/msm_iommu_domains.h>
 #include <soc/qcom/event_timer.h>
@@ -54,6 +55,7 @@
 static int mdss_mdp_overlay_free_fb_pipe(struct msm_fb_data_type *mfd);
 static int mdss_mdp_overlay_fb_parse_dt(struct msm_fb_data_type *mfd);
 static int mdss_mdp_overlay_off(struct msm_fb_data_type *mfd);
+static void __dfps_auto_commit(struct msm_fb_data_type *mfd);
 static void __overlay_kickoff_requeue(struct msm_fb_data_type *mfd);
 static void __vsync_retire_signal(struct msm_fb_data_type *mfd, int val);
 static int __vsync_set_vsync_handler(struct msm_fb_data_type *mfd);
@@ -1640,9 +1642,11 @@ static int mdss_mdp_commit_cb(enum mdp_commit_stage_type commit_stage,
  * 1. Pipe has scaling and pipe's destination is intersecting with roi.
  * 2. Pipe's destination and roi do not overlap, In such cases, pipe should
  *    not be part of used list and should have been omitted by user program.
+ *
+ * The failures are only logged if @verbose is set.
  */
 static bool __is_roi_valid(struct mdss_mdp_pipe *pipe,
-	struct mdss_rect *l_roi, struct mdss_rect *r_roi)
+	struct mdss_rect *l_roi, struct mdss_rect *r_roi, bool verbose)
 {
 	bool ret = true;
 	bool is_right_mixer = pipe->mixer_left->is_right_mixer;
@@ -1665,11 +1669,13 @@ static bool __is_roi_valid(struct mdss_mdp_pipe *pipe,
 		mdss_mdp_intersect_rect(&res, &dst, &roi);
 
 		if (!mdss_rect_cmp(&res, &dst)) {
-			pr_err("error. pipe%d has scaling and its output is interesecting with roi.\n",
-				pipe->num);
-			pr_err("pipe_dst:-> %d %d %d %d roi:-> %d %d %d %d\n",
-				dst.x, dst.y, dst.w, dst.h,
-				roi.x, roi.y, roi.w, roi.h);
+			if (verbose) {
+				pr_err("error. pipe%d has scaling and its output is interesecting with roi.\n",
+					pipe->num);
+				pr_err("pipe_dst:-> %d %d %d %d roi:-> %d %d %d %d\n",
+					dst.x, dst.y, dst.w, dst.h,
+					roi.x, roi.y, roi.w, roi.h);
+			}
 			ret = false;
 			goto end;
 		}
@@ -1677,8 +1683,9 @@ static bool __is_roi_valid(struct mdss_mdp_pipe *pipe,
 
 	/* condition #2 above */
 	if (!mdss_rect_overlap_check(&dst, &roi)) {
-		pr_err("error. pipe%d's output is outside of ROI.\n",
-			pipe->num);
+		if (verbose)
+			pr_err("error. pipe%d's output is outside of ROI.\n",
+				pipe->num);
 		ret = false;
 	}
 end:
@@ -1796,6 +1803,142 @@ int mdss_mode_switch_post(struct msm_fb_data_type *mfd, u32 mode)
 	return rc;
 }
 
+/* true if the next kickoff shows something new on @pipe */
+static bool __pipe_has_update(struct mdss_mdp_pipe *pipe)
+{
+	struct mdss_mdp_data *buf;
+
+	if (pipe->params_changed)
+		return true;
+
+	buf = list_first_entry_or_null(&pipe->buf_queue,
+			struct mdss_mdp_data, pipe_list);
+	if (!buf)
+		return false;
+
+	return (buf->state == MDP_BUF_STATE_READY) ||
+		!list_is_last(&buf->pipe_list, &pipe->buf_queue);
+}
+
+/*
+ * Area of the left mixer that changes with the next kickoff: the output of
+ * the pipes with a new buffer or new parameters and of the pipes that are
+ * taken off. Called with the list lock held.
+ */
+static void __overlay_get_damage(struct msm_fb_data_type *mfd,
+	struct mdss_rect *damage)
+{
+	struct mdss_overlay_private *mdp5_data = mfd_to_mdp5_data(mfd);
+	struct mdss_mdp_pipe *pipe;
+
+	*damage = (struct mdss_rect) {0, 0, 0, 0};
+
+	list_for_each_entry(pipe, &mdp5_data->pipes_used, list) {
+		if (!pipe->dirty && __pipe_has_update(pipe))
+			mdss_mdp_combine_rect(damage, damage, &pipe->dst);
+	}
+
+	list_for_each_entry(pipe, &mdp5_data->pipes_cleanup, list)
+		mdss_mdp_combine_rect(damage, damage, &pipe->dst);
+}
+
+/*
+ * Grow @roi to the start and size alignment and the minimum size that the
+ * panel needs for a partial update. Returns false if the aligned roi no
+ * longer fits in the @max_w x @max_h mixer.
+ */
+static bool __roi_align(struct mdss_rect *roi, struct mdss_panel_info *pinfo,
+	u32 max_w, u32 max_h)
+{
+	u32 x = roi->x, y = roi->y;
+	u32 r = roi->x + roi->w, b = roi->y + roi->h;
+
+	if (pinfo->xstart_pix_align)
+		x = rounddown(x, pinfo->xstart_pix_align);
+	if (pinfo->width_pix_align)
+		r = x + roundup(r - x, pinfo->width_pix_align);
+	if (pinfo->ystart_pix_align)
+		y = rounddown(y, pinfo->ystart_pix_align);
+	if (pinfo->height_pix_align)
+		b = y + roundup(b - y, pinfo->height_pix_align);
+
+	if (r - x < pinfo->min_width)
+		r = x + pinfo->min_width;
+	if (b - y < pinfo->min_height)
+		b = y + pinfo->min_height;
+
+	if ((r > max_w) || (b > max_h))
+		return false;
+
+	*roi = (struct mdss_rect) {x, y, r - x, b - y};
+	return true;
+}
+
+/*
+ * Shrink the roi given by the user program to the part of the panel that
+ * actually changes, aligned for the panel. The user roi is kept if the
+ * smaller one would cut into a scaled pipe or miss a staged pipe.
+ * Only done for a single layer mixer, called with the list lock held.
+ */
+static void __overlay_narrow_roi(struct msm_fb_data_type *mfd,
+	struct mdss_rect *l_roi)
+{
+	struct mdss_overlay_private *mdp5_data = mfd_to_mdp5_data(mfd);
+	struct mdss_mdp_ctl *ctl = mfd_to_ctl(mfd);
+	struct mdss_mdp_pipe *pipe;
+	struct mdss_rect damage, roi;
+
+	__overlay_get_damage(mfd, &damage);
+	mdss_mdp_intersect_rect(&roi, &damage, l_roi);
+	if (!roi.w || !roi.h)
+		return;
+
+	if (!__roi_align(&roi, &ctl->panel_data->panel_info,
+			ctl->mixer_left->width, ctl->mixer_left->height))
+		return;
+
+	if (mdss_rect_cmp(&roi, l_roi))
+		return;
+
+	list_for_each_entry(pipe, &mdp5_data->pipes_used, list)
+		if (!__is_roi_valid(pipe, &roi, &roi, false))
+			return;
+
+	pr_debug("roi narrowed to damage: %d %d %d %d\n",
+		roi.x, roi.y, roi.w, roi.h);
+	*l_roi = roi;
+}
+
+/*
+ * A command mode panel keeps showing the last frame from its own memory,
+ * so a commit that changes nothing on the panel doesn't need a transfer.
+ * Called with the list lock held.
+ */
+static bool __overlay_skip_update(struct msm_fb_data_type *mfd,
+	struct mdp_display_commit *commit)
+{
+	struct mdss_overlay_private *mdp5_data = mfd_to_mdp5_data(mfd);
+	struct mdss_mdp_ctl *ctl = mfd_to_ctl(mfd);
+	struct mdss_rect damage;
+
+	if (!commit || ctl->is_video_mode ||
+	    (mfd->panel.type != MIPI_CMD_PANEL) ||
+	    !ctl->panel_data->panel_info.partial_update_enabled)
+		return false;
+
+	if (!ctl->play_cnt || ctl->mixer_right || ctl->shared_lock ||
+	    ctl->cmd_autorefresh_en || ctl->pending_mode_switch ||
+	    mdp5_data->dyn_mode_switch || ctl->mixer_left->params_changed ||
+	    ctl->mixer_left->cursor_enabled)
+		return false;
+
+	__overlay_get_damage(mfd, &damage);
+	if (damage.w && damage.h)
+		return false;
+
+	return !mdss_mdp_pp_pending(ctl);
+}
+
 static void __validate_and_set_roi(struct msm_fb_data_type *mfd,
 	struct mdp_display_commit *commit)
 {
@@ -1848,7 +1991,7 @@ static void __validate_and_set_roi(struct msm_fb_data_type *mfd,
 		}
 
 		list_for_each_entry(pipe, &mdp5_data->pipes_used, list) {
-			if (!__is_roi_valid(pipe, &l_roi, &r_roi)) {
+			if (!__is_roi_valid(pipe, &l_roi, &r_roi, true)) {
 				skip_partial_update = true;
 				pr_err("error. invalid pu config for pipe%d: %d,%d,%d,%d\n",
 					pipe->num,
@@ -1857,6 +2000,9 @@ static void __validate_and_set_roi(struct msm_fb_data_type *mfd,
 				break;
 			}
 		}
+
+		if (!skip_partial_update && !ctl->mixer_right)
+			__overlay_narrow_roi(mfd, &l_roi);
 	}
 
 set_roi:
@@ -1945,6 +2091,19 @@ int mdss_mdp_overlay_kickoff(struct msm_fb_data_type *mfd,
 	mdss_mdp_clk_ctrl(MDP_BLOCK_POWER_ON);
 
 	__vsync_set_vsync_handler(mfd);
+
+	/*
+	 * Without a flush the release fences are signaled by the caller and
+	 * the retire fence by the vsync handler on the next read pointer.
+	 */
+	if (__overlay_skip_update(mfd, data)) {
+		pr_debug("fb%d: nothing changed, skipping transfer\n",
+			mfd->index);
+		mutex_unlock(&mdp5_data->list_lock);
+		mdss_mdp_clk_ctrl(MDP_BLOCK_POWER_OFF);
+		goto skip_update;
+	}
+
 	__validate_and_set_roi(mfd, data);
 
 	if (ctl->ops.wait_pingpong && mdp5_data->mdata->serialize_wait4pp)
@@ -2019,6 +2178,7 @@ int mdss_mdp_overlay_kickoff(struct msm_fb_data_type *mfd,
 	}
 
 	mdss_fb_update_notify_update(mfd);
+	__dfps_auto_commit(mfd);
 commit_fail:
 	ATRACE_BEGIN("overlay_cleanup");
 	mdss_mdp_overlay_cleanup(mfd, &destroy_pipes);
@@ -2028,6 +2188,7 @@ commit_fail:
 	if (!mdp5_data->kickoff_released)
 		mdss_mdp_ctl_notify(ctl, MDP_NOTIFY_FRAME_CTX_DONE);
 
+skip_update:
 	mutex_unlock(&mdp5_data->ov_lock);
 	if (ctl->shared_lock)
 		mutex_unlock(ctl->shared_lock);
@@ -2648,23 +2809,12 @@ static ssize_t dynamic_fps_sysfs_rda_dfps(struct device *dev,
 	return ret;
 } /* dynamic_fps_sysfs_rda_dfps */
 
-static ssize_t dynamic_fps_sysfs_wta_dfps(struct device *dev,
-	struct device_attribute *attr, const char *buf, size_t count)
+/* Called with the dfps lock held */
+static int __mdss_mdp_overlay_set_fps(struct msm_fb_data_type *mfd, int dfps)
 {
-	int dfps, rc = 0;
-	struct mdss_panel_data *pdata;
-	struct fb_info *fbi = dev_get_drvdata(dev);
-	struct msm_fb_data_type *mfd = (struct msm_fb_data_type *)fbi->par;
 	struct mdss_overlay_private *mdp5_data = mfd_to_mdp5_data(mfd);
-
-	rc = kstrtoint(buf, 10, &dfps);
-	if (rc) {
-		pr_err("%s: kstrtoint failed. rc=%d\n", __func__, rc);
-		return rc;
-	}
-
-	if (!mdp5_data->ctl || !mdss_mdp_ctl_is_power_on(mdp5_data->ctl))
-		return 0;
+	struct mdss_panel_data *pdata;
+	int rc;
 
 	pdata = dev_get_platdata(&mfd->pdev->dev);
 	if (!pdata) {
@@ -2675,42 +2825,354 @@ static ssize_t dynamic_fps_sysfs_wta_dfps(struct device *dev,
 	if (dfps == pdata->panel_info.mipi.frame_rate) {
 		pr_debug("%s: FPS is already %d\n",
 			__func__, dfps);
-		return count;
+		return 0;
 	}
 
-	mutex_lock(&mdp5_data->dfps_lock);
 	if (dfps < pdata->panel_info.min_fps) {
 		pr_err("Unsupported FPS. min_fps = %d\n",
 				pdata->panel_info.min_fps);
-		mutex_unlock(&mdp5_data->dfps_lock);
 		return -EINVAL;
 	} else if (dfps > pdata->panel_info.max_fps) {
 		pr_warn("Unsupported FPS. Configuring to max_fps = %d\n",
 				pdata->panel_info.max_fps);
 		dfps = pdata->panel_info.max_fps;
-		rc = mdss_mdp_ctl_update_fps(mdp5_data->ctl, dfps);
-	} else {
-		rc = mdss_mdp_ctl_update_fps(mdp5_data->ctl, dfps);
 	}
-	if (!rc) {
-		pr_debug("%s: configured to '%d' FPS\n", __func__, dfps);
-	} else {
+
+	rc = mdss_mdp_ctl_update_fps(mdp5_data->ctl, dfps);
+	if (rc) {
 		pr_err("Failed to configure '%d' FPS. rc = %d\n",
 							dfps, rc);
-		mutex_unlock(&mdp5_data->dfps_lock);
 		return rc;
 	}
+
+	pr_debug("%s: configured to '%d' FPS\n", __func__, dfps);
 	pdata->panel_info.new_fps = dfps;
+	return 0;
+}
+
+static ssize_t dynamic_fps_sysfs_wta_dfps(struct device *dev,
+	struct device_attribute *attr, const char *buf, size_t count)
+{
+	int dfps, rc = 0;
+	struct fb_info *fbi = dev_get_drvdata(dev);
+	struct msm_fb_data_type *mfd = (struct msm_fb_data_type *)fbi->par;
+	struct mdss_overlay_private *mdp5_data = mfd_to_mdp5_data(mfd);
+
+	rc = kstrtoint(buf, 10, &dfps);
+	if (rc) {
+		pr_err("%s: kstrtoint failed. rc=%d\n", __func__, rc);
+		return rc;
+	}
+
+	if (!mdp5_data->ctl || !mdss_mdp_ctl_is_power_on(mdp5_data->ctl))
+		return 0;
+
+	mutex_lock(&mdp5_data->dfps_lock);
+	/* a rate set from user space isn't overridden by the content */
+	mdp5_data->dfps_auto = false;
+	rc = __mdss_mdp_overlay_set_fps(mfd, dfps);
 	mutex_unlock(&mdp5_data->dfps_lock);
-	return count;
+
+	return rc ? rc : count;
 } /* dynamic_fps_sysfs_wta_dfps */
 
 
 static DEVICE_ATTR(dynamic_fps, S_IRUGO | S_IWUSR, dynamic_fps_sysfs_rda_dfps,
 	dynamic_fps_sysfs_wta_dfps);
 
+/*
+ * Content driven refresh rate for video mode panels with an immediate dfps
+ * mode (porch or clock update).
+ *
+ * Every DFPS_AUTO_WINDOW_MS the commits of the window give the frame rate
+ * of the content. 24, 25 and 30 fps content (video playback) runs the
+ * panel at the lowest multiple of that rate, at least twice over, that
+ * the panel supports, and a screen that updates less often than that
+ * drops to min_fps. Content that keeps up with the refresh rate or any
+ * other rate goes back to the panel's rate right away, while a lower
+ * rate has to hold for DFPS_AUTO_HOLD_WINDOWS windows. Touch input snaps
+ * the panel back to its rate and keeps it there for
+ * DFPS_AUTO_INPUT_HOLD_MS.
+ */
+#define DFPS_AUTO_WINDOW_MS		1000
+#define DFPS_AUTO_HOLD_WINDOWS		2
+#define DFPS_AUTO_INPUT_HOLD_MS		3000
+
+static int __dfps_auto_target(struct mdss_panel_info *pinfo, u32 rate)
+{
+	u32 cur_fps = pinfo->mipi.frame_rate;
+	u32 def_fps = min_t(u32, pinfo->panel_max_fps, pinfo->max_fps);
+	u32 content, fps;
+
+	/* the content may be held back by the refresh rate */
+	if (rate + 2 >= cur_fps)
+		return def_fps;
+
+	if (rate < 23)
+		return pinfo->min_fps;
+	else if (rate <= 24)
+		content = 24;
+	else if (rate <= 26)
+		content = 25;
+	else if ((rate >= 29) && (rate <= 31))
+		content = 30;
+	else
+		return def_fps;
+
+	fps = content * max_t(u32, 2, DIV_ROUND_UP(pinfo->min_fps, content));
+
+	return min(fps, def_fps);
+}
+
+static void __dfps_auto_work(struct work_struct *work)
+{
+	struct mdss_overlay_private *mdp5_data = container_of(
+		to_delayed_work(work), struct mdss_overlay_private,
+		dfps_auto_work);
+	struct mdss_mdp_ctl *ctl = mdp5_data->ctl;
+	struct mdss_panel_info *pinfo;
+	ktime_t now = ktime_get();
+	s64 elapsed;
+	u32 cnt, rate;
+	int fps;
+
+	if (!ctl || !mdss_mdp_ctl_is_power_on(ctl))
+		return;
+
+	pinfo = &ctl->panel_data->panel_info;
+	cnt = atomic_xchg(&mdp5_data->dfps_commit_cnt, 0);
+	elapsed = ktime_to_ms(ktime_sub(now, mdp5_data->dfps_window_start));
+	mdp5_data->dfps_window_start = now;
+	rate = elapsed > 0 ? DIV_ROUND_CLOSEST(cnt * MSEC_PER_SEC,
+			(u32)elapsed) : 0;
+
+	mutex_lock(&mdp5_data->dfps_lock);
+	if (!mdp5_data->dfps_auto)
+		goto unlock;
+
+	if (time_before(jiffies, mdp5_data->dfps_input_time +
+			msecs_to_jiffies(DFPS_AUTO_INPUT_HOLD_MS)))
+		fps = min_t(u32, pinfo->panel_max_fps, pinfo->max_fps);
+	else
+		fps = __dfps_auto_target(pinfo, rate);
+
+	if (fps < pinfo->mipi.frame_rate) {
+		if (fps != mdp5_data->dfps_pending_fps) {
+			mdp5_data->dfps_pending_fps = fps;
+			mdp5_data->dfps_hold_cnt = 0;
+		}
+		if (++mdp5_data->dfps_hold_cnt < DFPS_AUTO_HOLD_WINDOWS)
+			goto resched;
+	}
+
+	mdp5_data->dfps_pending_fps = 0;
+	mdp5_data->dfps_hold_cnt = 0;
+	if (fps != pinfo->mipi.frame_rate) {
+		pr_debug("fb%d: content at %u fps, panel to %d fps\n",
+			ctl->mfd->index, rate, fps);
+		__mdss_mdp_overlay_set_fps(ctl->mfd, fps);
+	}
+
+resched:
+	/* an idle screen at the lowest rate is picked up by the next commit */
+	if (cnt || (pinfo->mipi.frame_rate > pinfo->min_fps))
+		schedule_delayed_work(&mdp5_data->dfps_auto_work,
+			msecs_to_jiffies(DFPS_AUTO_WINDOW_MS));
+unlock:
+	mutex_unlock(&mdp5_data->dfps_lock);
+}
+
+static void __dfps_auto_commit(struct msm_fb_data_type *mfd)
+{
+	struct mdss_overlay_private *mdp5_data = mfd_to_mdp5_data(mfd);
+
+	if (!mdp5_data->dfps_auto)
+		return;
+
+	atomic_inc(&mdp5_data->dfps_commit_cnt);
+	if (schedule_delayed_work(&mdp5_data->dfps_auto_work,
+			msecs_to_jiffies(DFPS_AUTO_WINDOW_MS)))
+		mdp5_data->dfps_window_start = ktime_get();
+}
+
+static void __dfps_input_work(struct work_struct *work)
+{
+	struct mdss_overlay_private *mdp5_data = container_of(work,
+		struct mdss_overlay_private, dfps_input_work);
+	struct mdss_mdp_ctl *ctl = mdp5_data->ctl;
+	struct mdss_panel_info *pinfo;
+
+	if (!ctl || !mdss_mdp_ctl_is_power_on(ctl))
+		return;
+
+	pinfo = &ctl->panel_data->panel_info;
+
+	mutex_lock(&mdp5_data->dfps_lock);
+	if (mdp5_data->dfps_auto) {
+		mdp5_data->dfps_pending_fps = 0;
+		mdp5_data->dfps_hold_cnt = 0;
+		__mdss_mdp_overlay_set_fps(ctl->mfd,
+			min_t(u32, pinfo->panel_max_fps, pinfo->max_fps));
+		schedule_delayed_work(&mdp5_data->dfps_auto_work,
+			msecs_to_jiffies(DFPS_AUTO_WINDOW_MS));
+	}
+	mutex_unlock(&mdp5_data->dfps_lock);
+}
+
+static void __dfps_input_event(struct input_handle *handle,
+		unsigned int type, unsigned int code, int value)
+{
+	struct mdss_overlay_private *mdp5_data = container_of(handle->handler,
+		struct mdss_overlay_private, dfps_input_handler);
+	struct mdss_mdp_ctl *ctl = mdp5_data->ctl;
+
+	if (!mdp5_data->dfps_auto || !ctl)
+		return;
+
+	mdp5_data->dfps_input_time = jiffies;
+	if (ctl->panel_data->panel_info.mipi.frame_rate <
+			ctl->panel_data->panel_info.panel_max_fps)
+		schedule_work(&mdp5_data->dfps_input_work);
+}
+
+static int __dfps_input_connect(struct input_handler *handler,
+		struct input_dev *dev, const struct input_device_id *id)
+{
+	struct input_handle *handle;
+	int error;
+
+	handle = kzalloc(sizeof(struct input_handle), GFP_KERNEL);
+	if (!handle)
+		return -ENOMEM;
+
+	handle->dev = dev;
+	handle->handler = handler;
+	handle->name = handler->name;
+
+	error = input_register_handle(handle);
+	if (error)
+		goto err2;
+
+	error = input_open_device(handle);
+	if (error)
+		goto err1;
+
+	return 0;
+err1:
+	input_unregister_handle(handle);
+err2:
+	kfree(handle);
+	return error;
+}
+
+static void __dfps_input_disconnect(struct input_handle *handle)
+{
+	input_close_device(handle);
+	input_unregister_handle(handle);
+	kfree(handle);
+}
+
+static const struct input_device_id dfps_input_ids[] = {
+	/* multi-touch touchscreen */
+	{
+		.flags = INPUT_DEVICE_ID_MATCH_EVBIT |
+			INPUT_DEVICE_ID_MATCH_ABSBIT,
+		.evbit = { BIT_MASK(EV_ABS) },
+		.absbit = { [BIT_WORD(ABS_MT_POSITION_X)] =
+			BIT_MASK(ABS_MT_POSITION_X) |
+			BIT_MASK(ABS_MT_POSITION_Y) },
+	},
+	{ },
+};
+
+static void __dfps_auto_setup(struct msm_fb_data_type *mfd)
+{
+	struct mdss_overlay_private *mdp5_data = mfd_to_mdp5_data(mfd);
+	struct mdss_panel_info *pinfo = mfd->panel_info;
+	struct input_handler *handler = &mdp5_data->dfps_input_handler;
+	int rc;
+
+	INIT_DELAYED_WORK(&mdp5_data->dfps_auto_work, __dfps_auto_work);
+	INIT_WORK(&mdp5_data->dfps_input_work, __dfps_input_work);
+
+	if ((pinfo->type != MIPI_VIDEO_PANEL) || !pinfo->dynamic_fps ||
+	    (pinfo->dfps_update == DFPS_SUSPEND_RESUME_MODE) ||
+	    (pinfo->min_fps >= pinfo->max_fps))
+		return;
+
+	handler->event = __dfps_input_event;
+	handler->connect = __dfps_input_connect;
+	handler->disconnect = __dfps_input_disconnect;
+	handler->name = "mdss_dfps";
+	handler->id_table = dfps_input_ids;
+
+	rc = input_register_handler(handler);
+	if (rc) {
+		pr_warn("fb%d: no input for dfps, ret=%d\n", mfd->index, rc);
+		handler->name = NULL;
+		return;
+	}
+
+	mdp5_data->dfps_auto = true;
+}
+
+static void __dfps_auto_stop(struct msm_fb_data_type *mfd)
+{
+	struct mdss_overlay_private *mdp5_data = mfd_to_mdp5_data(mfd);
+
+	/* the input work queues the auto work */
+	cancel_work_sync(&mdp5_data->dfps_input_work);
+	cancel_delayed_work_sync(&mdp5_data->dfps_auto_work);
+	atomic_set(&mdp5_data->dfps_commit_cnt, 0);
+	mdp5_data->dfps_pending_fps = 0;
+	mdp5_data->dfps_hold_cnt = 0;
+}
+
+static ssize_t dynamic_fps_sysfs_rda_auto(struct device *dev,
+	struct device_attribute *attr, char *buf)
+{
+	struct fb_info *fbi = dev_get_drvdata(dev);
+	struct msm_fb_data_type *mfd = (struct msm_fb_data_type *)fbi->par;
+	struct mdss_overlay_private *mdp5_data = mfd_to_mdp5_data(mfd);
+
+	return snprintf(buf, PAGE_SIZE, "%d\n", mdp5_data->dfps_auto);
+}
+
+static ssize_t dynamic_fps_sysfs_wta_auto(struct device *dev,
+	struct device_attribute *attr, const char *buf, size_t count)
+{
+	struct fb_info *fbi = dev_get_drvdata(dev);
+	struct msm_fb_data_type *mfd = (struct msm_fb_data_type *)fbi->par;
+	struct mdss_overlay_private *mdp5_data = mfd_to_mdp5_data(mfd);
+	struct mdss_panel_info *pinfo = mfd->panel_info;
+	bool enable;
+	int rc;
+
+	rc = strtobool(buf, &enable);
+	if (rc)
+		return rc;
+
+	/* the handler is only registered for panels that can follow */
+	if (enable && !mdp5_data->dfps_input_handler.name)
+		return -EINVAL;
+
+	mutex_lock(&mdp5_data->dfps_lock);
+	mdp5_data->dfps_auto = enable;
+	if (!enable && mdp5_data->ctl &&
+	    mdss_mdp_ctl_is_power_on(mdp5_data->ctl))
+		__mdss_mdp_overlay_set_fps(mfd,
+			min_t(u32, pinfo->panel_max_fps, pinfo->max_fps));
+	mutex_unlock(&mdp5_data->dfps_lock);
+
+	return count;
+}
+
+static DEVICE_ATTR(dynamic_fps_auto, S_IRUGO | S_IWUSR,
+	dynamic_fps_sysfs_rda_auto, dynamic_fps_sysfs_wta_auto);
+
 static struct attribute *dynamic_fps_fs_attrs[] = {
 	&dev_attr_dynamic_fps.attr,
+	&dev_attr_dynamic_fps_auto.attr,
 	NULL,
 };
 static struct attribute_group dynamic_fps_fs_attrs_group = {
@@ -2945,10 +3407,89 @@ static ssize_t mdss_mdp_cmd_autorefresh_store(struct device *dev,
 	return len;
 }
 
+static ssize_t mdss_mdp_hist_show_event(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct fb_info *fbi = dev_get_drvdata(dev);
+	struct msm_fb_data_type *mfd = (struct msm_fb_data_type *)fbi->par;
+	struct mdss_overlay_private *mdp5_data = mfd_to_mdp5_data(mfd);
+	u32 head = 0;
+
+	mutex_lock(&mdp5_data->hist_ring_lock);
+	if (mdp5_data->hist_ring)
+		head = mdp5_data->hist_ring->head;
+	mutex_unlock(&mdp5_data->hist_ring_lock);
+
+	return scnprintf(buf, PAGE_SIZE, "HIST=%u\n", head);
+}
+
+static ssize_t mdss_mdp_hist_event_ms_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct fb_info *fbi = dev_get_drvdata(dev);
+	struct msm_fb_data_type *mfd = (struct msm_fb_data_type *)fbi->par;
+	struct mdss_overlay_private *mdp5_data = mfd_to_mdp5_data(mfd);
+
+	return scnprintf(buf, PAGE_SIZE, "%u\n", mdp5_data->hist_event_ms);
+}
+
+static ssize_t mdss_mdp_hist_event_ms_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct fb_info *fbi = dev_get_drvdata(dev);
+	struct msm_fb_data_type *mfd = (struct msm_fb_data_type *)fbi->par;
+	u32 ms;
+	int rc;
+
+	rc = kstrtou32(buf, 10, &ms);
+	if (rc) {
+		pr_err("kstrtou32 failed. rc=%d\n", rc);
+		return rc;
+	}
+
+	rc = mdss_mdp_hist_event_config(mfd, ms);
+	if (rc)
+		return rc;
+
+	return len;
+}
+
+static int mdss_mdp_hist_ring_mmap(struct file *filp, struct kobject *kobj,
+		struct bin_attribute *attr, struct vm_area_struct *vma)
+{
+	struct device *dev = container_of(kobj, struct device, kobj);
+	struct fb_info *fbi = dev_get_drvdata(dev);
+	struct msm_fb_data_type *mfd = (struct msm_fb_data_type *)fbi->par;
+	struct mdss_overlay_private *mdp5_data = mfd_to_mdp5_data(mfd);
+	int rc;
+
+	if (vma->vm_flags & VM_WRITE)
+		return -EPERM;
+	vma->vm_flags &= ~VM_MAYWRITE;
+
+	mutex_lock(&mdp5_data->hist_ring_lock);
+	if (mdp5_data->hist_ring)
+		rc = remap_vmalloc_range(vma, mdp5_data->hist_ring,
+				vma->vm_pgoff);
+	else
+		rc = -ENODEV;
+	mutex_unlock(&mdp5_data->hist_ring_lock);
+
+	return rc;
+}
+
+static struct bin_attribute mdp_hist_ring_attr = {
+	.attr = { .name = "hist_ring", .mode = S_IRUGO },
+	.size = PAGE_ALIGN(sizeof(struct mdp_hist_ring)),
+	.mmap = mdss_mdp_hist_ring_mmap,
+};
 
 static DEVICE_ATTR(msm_cmd_autorefresh_en, S_IRUGO | S_IWUSR,
 	mdss_mdp_cmd_autorefresh_show, mdss_mdp_cmd_autorefresh_store);
 static DEVICE_ATTR(vsync_event, S_IRUGO, mdss_mdp_vsync_show_event, NULL);
+static DEVICE_ATTR(hist_event, S_IRUGO, mdss_mdp_hist_show_event, NULL);
+static DEVICE_ATTR(hist_event_ms, S_IRUGO | S_IWUSR | S_IWGRP,
+	mdss_mdp_hist_event_ms_show, mdss_mdp_hist_event_ms_store);
 static DEVICE_ATTR(ad, S_IRUGO | S_IWUSR | S_IWGRP, mdss_mdp_ad_show,
 	mdss_mdp_ad_store);
 static DEVICE_ATTR(dyn_pu, S_IRUGO | S_IWUSR | S_IWGRP, mdss_mdp_dyn_pu_show,
@@ -2959,6 +3500,8 @@ static struct attribute *mdp_overlay_sysfs_attrs[] = {
 	&dev_attr_ad.attr,
 	&dev_attr_dyn_pu.attr,
 	&dev_attr_msm_cmd_autorefresh_en.attr,
+	&dev_attr_hist_event.attr,
+	&dev_attr_hist_event_ms.attr,
 	NULL,
 };
 
@@ -4153,7 +4696,8 @@ static int __mdss_overlay_src_split_sort(struct msm_fb_data_type *mfd,
 	return 0;
 }
 
-static int __handle_overlay_prepare(struct msm_fb_data_type *mfd,
+/* Set up the pipes of all layers of a frame, called with ov_lock held */
+static int __overlay_prepare_locked(struct msm_fb_data_type *mfd,
 	struct mdp_overlay_list *ovlist, struct mdp_overlay *ip_ovs)
 {
 	int ret, i;
@@ -4175,15 +4719,6 @@ static int __handle_overlay_prepare(struct msm_fb_data_type *mfd,
 
 	bool sort_needed = mdata->has_src_split && (num_ovs > 1);
 
-	ret = mutex_lock_interruptible(&mdp5_data->ov_lock);
-	if (ret)
-		return ret;
-
-	if (mdss_fb_is_power_off(mfd)) {
-		mutex_unlock(&mdp5_data->ov_lock);
-		return -EPERM;
-	}
-
 	if (sort_needed) {
 		sorted_ovs = kzalloc(num_ovs * sizeof(*ip_ovs), GFP_KERNEL);
 		if (!sorted_ovs) {
@@ -4277,6 +4812,8 @@ static int __handle_overlay_prepare(struct msm_fb_data_type *mfd,
 
 	ret = mdss_mdp_perf_bw_check(mdp5_data->ctl, left_plist, left_cnt,
 			right_plist, right_cnt, mdp5_data->dyn_mode_switch);
+	if (!ret)
+		mdss_mdp_ctl_perf_prevote(mdp5_data->ctl);
 
 validate_exit:
 	if (sort_needed)
@@ -4291,13 +4828,32 @@ validate_exit:
 			right_lm_ovs);
 		mdss_mdp_overlay_release(mfd, new_reqs);
 	}
-	mutex_unlock(&mdp5_data->ov_lock);
 
 	kfree(sorted_ovs);
 
 	return ret;
 }
 
+static int __handle_overlay_prepare(struct msm_fb_data_type *mfd,
+	struct mdp_overlay_list *ovlist, struct mdp_overlay *ip_ovs)
+{
+	struct mdss_overlay_private *mdp5_data = mfd_to_mdp5_data(mfd);
+	int ret;
+
+	ret = mutex_lock_interruptible(&mdp5_data->ov_lock);
+	if (ret)
+		return ret;
+
+	if (mdss_fb_is_power_off(mfd))
+		ret = -EPERM;
+	else
+		ret = __overlay_prepare_locked(mfd, ovlist, ip_ovs);
+
+	mutex_unlock(&mdp5_data->ov_lock);
+
+	return ret;
+}
+
 static int __handle_ioctl_overlay_prepare(struct msm_fb_data_type *mfd,
 		void __user *argp)
 {
@@ -4358,6 +4914,105 @@ validate_exit:
 	return ret;
 }
 
+/**
+ * mdss_mdp_overlay_atomic_validate() - Set up and queue all layers of a frame
+ * @mfd: msm frame buffer data structure associated with the fb device.
+ * @commit: the atomic commit request, its lists are in user memory
+ *
+ * Sets up the pipes of all layers the way MSMFB_OVERLAY_PREPARE does, with
+ * the SMP allocation and the bandwidth of the mixers checked once for the
+ * whole frame, and queues the buffer of every layer like MSMFB_OVERLAY_PLAY.
+ * ov_lock is held across both so the next kickoff picks up the frame as a
+ * whole. On error processed_overlays is the index of the failing layer.
+ */
+static int mdss_mdp_overlay_atomic_validate(struct msm_fb_data_type *mfd,
+		struct mdp_atomic_commit *commit)
+{
+	struct mdss_overlay_private *mdp5_data = mfd_to_mdp5_data(mfd);
+	struct mdp_overlay_list *ovlist = &commit->ovlist;
+	struct mdp_overlay *req_list[OVERLAY_MAX];
+	struct mdp_overlay *overlays;
+	struct msmfb_overlay_data *data;
+	int i, ret;
+
+	if (!mfd_to_ctl(mfd))
+		return -ENODEV;
+
+	if (ovlist->num_overlays > OVERLAY_MAX) {
+		pr_err("Number of overlays exceeds max\n");
+		return -EINVAL;
+	}
+
+	overlays = kmalloc(ovlist->num_overlays * sizeof(*overlays),
+			GFP_KERNEL);
+	data = kmalloc(ovlist->num_overlays * sizeof(*data), GFP_KERNEL);
+	if (!overlays || !data) {
+		pr_err("Unable to allocate memory for the atomic commit\n");
+		ret = -ENOMEM;
+		goto exit;
+	}
+
+	if (copy_from_user(req_list, ovlist->overlay_list,
+				sizeof(struct mdp_overlay *) *
+				ovlist->num_overlays) ||
+		copy_from_user(data, commit->data_list,
+				sizeof(*data) * ovlist->num_overlays)) {
+		ret = -EFAULT;
+		goto exit;
+	}
+
+	for (i = 0; i < ovlist->num_overlays; i++) {
+		if (copy_from_user(overlays + i, req_list[i],
+				sizeof(struct mdp_overlay))) {
+			ret = -EFAULT;
+			goto exit;
+		}
+	}
+
+	ret = mutex_lock_interruptible(&mdp5_data->ov_lock);
+	if (ret)
+		goto exit;
+
+	if (mdss_fb_is_power_off(mfd)) {
+		ret = -EPERM;
+		goto unlock;
+	}
+
+	ret = __overlay_prepare_locked(mfd, ovlist, overlays);
+	if (IS_ERR_VALUE(ret))
+		goto unlock;
+
+	for (i = 0; i < ovlist->num_overlays; i++) {
+		data[i].id = overlays[i].id;
+		ret = mdss_mdp_overlay_queue(mfd, &data[i]);
+		if (IS_ERR_VALUE(ret)) {
+			pr_debug("atomic commit: queue of layer %d failed %d\n",
+				i, ret);
+			ovlist->processed_overlays = i;
+			break;
+		}
+	}
+
+unlock:
+	mutex_unlock(&mdp5_data->ov_lock);
+
+	if (!IS_ERR_VALUE(ret)) {
+		for (i = 0; i < ovlist->num_overlays; i++) {
+			if (copy_to_user(req_list[i], overlays + i,
+					sizeof(struct mdp_overlay))) {
+				ret = -EFAULT;
+				break;
+			}
+		}
+	}
+
+exit:
+	kfree(data);
+	kfree(overlays);
+
+	return ret;
+}
+
 static int mdss_mdp_overlay_ioctl_handler(struct msm_fb_data_type *mfd,
 					  u32 cmd, void __user *argp)
 {
@@ -4652,6 +5307,8 @@ static int mdss_mdp_overlay_off(struct msm_fb_data_type *mfd)
 		return 0;
 	}
 
+	__dfps_auto_stop(mfd);
+
 	/*
 	 * Keep a reference to the runtime pm until the overlay is turned
 	 * off, and then release this last reference at the end. This will
@@ -5120,6 +5777,7 @@ int mdss_mdp_overlay_init(struct msm_fb_data_type *mfd)
 		mdp5_interface->cursor_update = mdss_mdp_hw_cursor_update;
 	mdp5_interface->dma_fnc = mdss_mdp_overlay_pan_display;
 	mdp5_interface->ioctl_handler = mdss_mdp_overlay_ioctl_handler;
+	mdp5_interface->atomic_validate = mdss_mdp_overlay_atomic_validate;
 	mdp5_interface->kickoff_fnc = mdss_mdp_overlay_kickoff;
 	mdp5_interface->mode_switch = mdss_mode_switch;
 	mdp5_interface->pend_mode_switch = mdss_pend_mode_switch;
@@ -5139,6 +5797,7 @@ int mdss_mdp_overlay_init(struct msm_fb_data_type *mfd)
 	mutex_init(&mdp5_data->list_lock);
 	mutex_init(&mdp5_data->ov_lock);
 	mutex_init(&mdp5_data->dfps_lock);
+	mutex_init(&mdp5_data->hist_ring_lock);
 	mdp5_data->hw_refresh = true;
 	mdp5_data->overlay_play_enable = true;
 	mdp5_data->cursor_ndx[CURSOR_PIPE_LEFT] = MSMFB_NEW_REQUEST;
@@ -5186,6 +5845,10 @@ int mdss_mdp_overlay_init(struct msm_fb_data_type *mfd)
 		goto init_fail;
 	}
 
+	rc = sysfs_create_bin_file(&dev->kobj, &mdp_hist_ring_attr);
+	if (rc)
+		pr_warn("problem creating hist_ring sysfs file\n");
+
 	rc = sysfs_create_link_nowarn(&dev->kobj,
 			&mdp5_data->mdata->pdev->dev.kobj, "mdp");
 	if (rc)
@@ -5204,6 +5867,7 @@ int mdss_mdp_overlay_init(struct msm_fb_data_type *mfd)
 			goto init_fail;
 		}
 	}
+	__dfps_auto_setup(mfd);
 
 	if (mfd->panel_info->mipi.dms_mode ||
 			mfd->panel_info->type == MIPI_CMD_PANEL) {
@@ -20,6 +20,7 @@
 #include <linux/uaccess.h>
 #include <linux/spinlock.h>
 #include <linux/delay.h>
+#include <linux/vmalloc.h>
 #include <linux/msm-bus.h>
 #include <linux/msm-bus-board.h>
 #include <linux/msm_mdp.h>
@@ -133,6 +134,8 @@ static struct mdp_ar_gc_lut_data lin_gc_data[GC_LUT_SEGMENTS] = {
 #define HIST_V1_INTR_BIT_MASK		0X333333
 #define HIST_WAIT_TIMEOUT(frame) ((75 * HZ * (frame)) / 1000)
 #define HIST_KICKOFF_WAIT_FRACTION 4
+/* read_request of a histogram locked by the ISR for the event ring */
+#define HIST_READ_EVENT 3
 
 /* hist collect state */
 enum {
@@ -473,6 +476,8 @@ static int pp_num_to_side(struct mdss_mdp_ctl *ctl, u32 num);
 static inline bool pp_sts_is_enabled(u32 sts, int side);
 static inline void pp_sts_set_split_bits(u32 *sts, u32 bits);
 static struct msm_fb_data_type *mdss_get_mfd_from_index(int index);
+static void pp_hist_event_work(struct work_struct *work);
+static u32 pp_hist_event_ms(u32 disp_num);
 
 static u32 last_sts, last_state;
 
@@ -1862,6 +1867,32 @@ dspp_exit:
 	return ret;
 }
 
+/*
+ * True if the next commit of @ctl has post processing or assertive display
+ * registers to program, so it can't be dropped even if no layer changed.
+ */
+bool mdss_mdp_pp_pending(struct mdss_mdp_ctl *ctl)
+{
+	struct mdss_data_type *mdata = mdss_mdp_get_mdata();
+	u32 disp_num;
+	bool pending;
+
+	if (!ctl->mfd || !mdss_pp_res || !mdata)
+		return false;
+
+	disp_num = ctl->mfd->index;
+	if (disp_num >= MDSS_MAX_MIXER_DISP_NUM)
+		return false;
+
+	mutex_lock(&mdss_pp_mutex);
+	pending = mdss_pp_res->pp_disp_flags[disp_num] ||
+		((disp_num < mdata->nad_cfgs) &&
+		 mdata->ad_cfgs[disp_num].reg_sts);
+	mutex_unlock(&mdss_pp_mutex);
+
+	return pending;
+}
+
 int mdss_mdp_pp_setup(struct mdss_mdp_ctl *ctl)
 {
 	int ret = 0;
@@ -2162,6 +2193,8 @@ int mdss_mdp_pp_init(struct device *dev)
 					+ MDSS_MDP_REG_DSPP_HIST_CTL_BASE;
 				init_completion(&hist[i].comp);
 				init_completion(&hist[i].first_kick);
+				INIT_WORK(&hist[i].event_work,
+					pp_hist_event_work);
 			}
 			if (mdata->ndspp == 4)
 				hist[3].intr_shift = 22;
@@ -3748,6 +3781,8 @@ int mdss_mdp_hist_start(struct mdp_histogram_start_req *req)
 			}
 			hist_info = &mdss_pp_res->dspp_hist[dspp_num];
 			hist_info->disp_num = PP_BLOCK(req->block);
+			hist_info->event_ms = pp_hist_event_ms(disp_num);
+			hist_info->next_event = jiffies;
 			ret = pp_hist_enable(hist_info, req);
 			mdss_pp_res->pp_disp_flags[disp_num] |=
 							PP_FLAGS_DIRTY_HIST_COL;
@@ -4437,6 +4472,7 @@ void mdss_mdp_hist_intr_done(u32 isr)
 	struct mdss_data_type *mdata = mdss_mdp_get_mdata();
 	bool is_hist_v2 = mdata->mdp_rev >= MDSS_MDP_HW_REV_103;
 	bool need_complete = false;
+	bool need_event;
 	u32 isr_mask = (is_hist_v2) ? HIST_V2_INTR_BIT_MASK :
 			HIST_V1_INTR_BIT_MASK;
 
@@ -4451,6 +4487,7 @@ void mdss_mdp_hist_intr_done(u32 isr)
 		isr_blk = (isr_tmp >> hist_info->intr_shift) & 0x3;
 		is_hist_done = isr_blk & 0x1;
 		is_hist_reset_done = isr_blk & 0x2;
+		need_event = false;
 		/* Histogram Done Interrupt */
 		if (hist_info && is_hist_done && (hist_info->col_en)) {
 			spin_lock(&hist_info->hist_lock);
@@ -4463,10 +4500,22 @@ void mdss_mdp_hist_intr_done(u32 isr)
 					writel_relaxed(1, hist_info->base);
 				}
 				need_complete = true;
+			} else if (is_hist_v2 && hist_info->event_ms &&
+					!hist_info->read_request &&
+					time_after_eq(jiffies,
+						hist_info->next_event)) {
+				/* lock the bins until the event work read them */
+				hist_info->read_request = HIST_READ_EVENT;
+				hist_info->col_state = HIST_READY;
+				writel_relaxed(1, hist_info->base);
+				need_event = true;
 			}
 			spin_unlock(&hist_info->hist_lock);
 			if (need_complete)
 				complete(&hist_info->comp);
+			if (need_event)
+				queue_work(system_unbound_wq,
+					&hist_info->event_work);
 		} else if (hist_info && is_hist_done &&
 				!(hist_info->col_en)) {
 			/*
@@ -4503,6 +4552,129 @@ static struct msm_fb_data_type *mdss_get_mfd_from_index(int index)
 	return out;
 }
 
+static u32 pp_hist_event_ms(u32 disp_num)
+{
+	struct msm_fb_data_type *mfd = mdss_get_mfd_from_index(disp_num);
+	struct mdss_overlay_private *mdp5_data;
+
+	if (!mfd || mfd->panel_info->type == WRITEBACK_PANEL)
+		return 0;
+	mdp5_data = mfd_to_mdp5_data(mfd);
+	return mdp5_data ? mdp5_data->hist_event_ms : 0;
+}
+
+static void pp_hist_ring_push(struct msm_fb_data_type *mfd,
+				struct pp_hist_col_info *hist_info)
+{
+	struct mdss_overlay_private *mdp5_data = mfd_to_mdp5_data(mfd);
+	struct mdp_hist_ring *ring;
+	struct mdp_hist_ring_entry *entry;
+
+	mutex_lock(&mdp5_data->hist_ring_lock);
+	ring = mdp5_data->hist_ring;
+	if (!ring) {
+		mutex_unlock(&mdp5_data->hist_ring_lock);
+		return;
+	}
+	entry = &ring->entry[ring->head % MDP_HIST_RING_ENTRIES];
+	entry->seq++;
+	smp_wmb();
+	entry->block = hist_info - mdss_pp_res->dspp_hist;
+	entry->bin_cnt = HIST_V_SIZE;
+	memcpy(entry->c0, hist_info->data, sizeof(entry->c0));
+	smp_wmb();
+	entry->seq++;
+	ring->head++;
+	mutex_unlock(&mdp5_data->hist_ring_lock);
+
+	sysfs_notify(&mfd->fbi->dev->kobj, NULL, "hist_event");
+}
+
+/*
+ * Reads the bins the ISR locked for the event ring. Nothing is done if a
+ * collect ioctl got to them first or the histogram was stopped.
+ */
+static void pp_hist_event_work(struct work_struct *work)
+{
+	struct pp_hist_col_info *hist_info = container_of(work,
+				struct pp_hist_col_info, event_work);
+	struct msm_fb_data_type *mfd;
+	unsigned long flag;
+
+	mutex_lock(&hist_info->hist_mutex);
+	spin_lock_irqsave(&hist_info->hist_lock, flag);
+	if (!hist_info->col_en || hist_info->col_state != HIST_READY ||
+			hist_info->read_request != HIST_READ_EVENT) {
+		spin_unlock_irqrestore(&hist_info->hist_lock, flag);
+		mutex_unlock(&hist_info->hist_mutex);
+		return;
+	}
+	hist_info->col_state = HIST_IDLE;
+	hist_info->read_request = 0;
+	spin_unlock_irqrestore(&hist_info->hist_lock, flag);
+
+	mdss_mdp_clk_ctrl(MDP_BLOCK_POWER_ON);
+	pp_hist_read(hist_info->base + 0x1C, hist_info);
+	writel_relaxed(0, hist_info->base);
+	mdss_mdp_clk_ctrl(MDP_BLOCK_POWER_OFF);
+	hist_info->next_event = jiffies +
+		msecs_to_jiffies(hist_info->event_ms);
+
+	mfd = mdss_get_mfd_from_index(hist_info->disp_num -
+					MDP_LOGICAL_BLOCK_DISP_0);
+	if (mfd)
+		pp_hist_ring_push(mfd, hist_info);
+	mutex_unlock(&hist_info->hist_mutex);
+}
+
+/**
+ * mdss_mdp_hist_event_config() - push the DSPP histograms to the ring
+ * @mfd: framebuffer whose DSPP histograms are pushed
+ * @ms: least interval between two pushes, 0 to stop pushing
+ *
+ * The ring is allocated on first use and kept for the life of the
+ * framebuffer since it may still be mapped. The histogram itself is still
+ * started and stopped through MSMFB_HISTOGRAM_START/STOP.
+ */
+int mdss_mdp_hist_event_config(struct msm_fb_data_type *mfd, u32 ms)
+{
+	struct mdss_overlay_private *mdp5_data = mfd_to_mdp5_data(mfd);
+	struct mdss_data_type *mdata = mdss_mdp_get_mdata();
+	struct pp_hist_col_info *hist_info;
+	u32 mixer_cnt, mixer_id[MDSS_MDP_INTF_MAX_LAYERMIXER];
+	unsigned long flag;
+	int i;
+
+	if (!mdss_is_ready())
+		return -EPROBE_DEFER;
+	if (mdata->mdp_rev < MDSS_MDP_HW_REV_103)
+		return -EOPNOTSUPP;
+
+	mutex_lock(&mdp5_data->hist_ring_lock);
+	if (ms && !mdp5_data->hist_ring) {
+		mdp5_data->hist_ring = vmalloc_user(
+				PAGE_ALIGN(sizeof(struct mdp_hist_ring)));
+		if (!mdp5_data->hist_ring) {
+			mutex_unlock(&mdp5_data->hist_ring_lock);
+			return -ENOMEM;
+		}
+	}
+	mdp5_data->hist_event_ms = ms;
+	mutex_unlock(&mdp5_data->hist_ring_lock);
+
+	mixer_cnt = mdss_mdp_get_ctl_mixers(mfd->index, mixer_id);
+	for (i = 0; i < mixer_cnt; i++) {
+		if (mixer_id[i] >= mdata->ndspp)
+			continue;
+		hist_info = &mdss_pp_res->dspp_hist[mixer_id[i]];
+		spin_lock_irqsave(&hist_info->hist_lock, flag);
+		hist_info->event_ms = ms;
+		hist_info->next_event = jiffies;
+		spin_unlock_irqrestore(&hist_info->hist_lock, flag);
+	}
+	return 0;
+}
+
 static int pp_num_to_side(struct mdss_mdp_ctl *ctl, u32 num)
 {
 	u32 mixer_id[MDSS_MDP_INTF_MAX_LAYERMIXER];
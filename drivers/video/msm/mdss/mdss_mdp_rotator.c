@@ -27,6 +27,8 @@
 
 #define MAX_ROTATOR_PIPE_COUNT 2
 #define PIPE_ACQUIRE_TIMEOUT_IN_MS 400
+/* jobs, with their mapped buffers, an async session can have in flight */
+#define MAX_ROTATOR_QUEUED_JOBS 3
 
 #define MAX_ROTATOR_SESSION_ID 0xfffffff
 
@@ -238,6 +240,18 @@ static void mdss_mdp_rot_mgr_release_pipe(struct mdss_mdp_rot_pipe *pipe)
 	mutex_unlock(&rot_mgr->pipe_lock);
 }
 
+/* true if no other session is waiting for the pipe held by the caller */
+static bool mdss_mdp_rot_mgr_pipe_uncontended(struct mdss_mdp_rot_pipe *pipe)
+{
+	bool uncontended;
+
+	mutex_lock(&rot_mgr->pipe_lock);
+	uncontended = (pipe->wait_count == 1);
+	mutex_unlock(&rot_mgr->pipe_lock);
+
+	return uncontended;
+}
+
 static int mdss_mdp_rot_mgr_remove_free_pipe(void)
 {
 	struct mdss_mdp_pipe *pipe;
@@ -403,8 +417,11 @@ static struct mdss_mdp_rotator_session *mdss_mdp_rotator_session_alloc(void)
 	}
 
 	mutex_init(&rot->lock);
+	mutex_init(&rot->job_lock);
 	INIT_LIST_HEAD(&rot->head);
 	INIT_LIST_HEAD(&rot->list);
+	INIT_LIST_HEAD(&rot->job_queue);
+	init_waitqueue_head(&rot->job_wq);
 	mdss_mdp_rot_mgr_get_id(&rot->session_id);
 
 	return rot;
@@ -613,26 +630,116 @@ error:
 	return ret;
 }
 
+static struct mdss_mdp_rotator_job *mdss_mdp_rotator_job_pop(
+	struct mdss_mdp_rotator_session *rot)
+{
+	struct mdss_mdp_rotator_job *job;
+
+	mutex_lock(&rot->job_lock);
+	job = list_first_entry_or_null(&rot->job_queue,
+			struct mdss_mdp_rotator_job, list);
+	if (job)
+		list_del_init(&job->list);
+	mutex_unlock(&rot->job_lock);
+
+	return job;
+}
+
+static void mdss_mdp_rotator_job_done(struct mdss_mdp_rotator_session *rot,
+	struct mdss_mdp_rotator_job *job)
+{
+	kfree(job);
+
+	mutex_lock(&rot->job_lock);
+	rot->job_cnt--;
+	mutex_unlock(&rot->job_lock);
+	wake_up(&rot->job_wq);
+}
+
+/* drop the jobs that never ran, called once the session is out of use */
+static void mdss_mdp_rotator_job_drop_all(struct mdss_mdp_rotator_session *rot)
+{
+	struct mdss_mdp_rotator_job *job;
+	int i;
+
+	while ((job = mdss_mdp_rotator_job_pop(rot))) {
+		for (i = 0; i < job->acq_fen_cnt; i++)
+			sync_fence_put(job->acq_fen[i]);
+		mdss_mdp_data_free(&job->src_buf);
+		mdss_mdp_data_free(&job->dst_buf);
+		mdss_mdp_rotator_job_done(rot, job);
+	}
+}
+
+/*
+ * Runs the queued jobs of an async session back to back. The rotator pipe
+ * is kept between the jobs of a batch so the session doesn't pay for a
+ * pipe switch and SMP reprogramming every frame, but it is given up as
+ * soon as another session waits for it. The writeback shared lock is
+ * dropped after every job, so a display commit that needs the writeback
+ * block gets in ahead of the rest of the batch.
+ */
 static void mdss_mdp_rotator_commit_wq_handler(struct work_struct *work)
 {
 	struct mdss_mdp_rotator_session *rot;
+	struct mdss_mdp_rotator_job *job;
+	struct mdss_mdp_rot_pipe *rot_pipe = NULL;
 	int ret;
 
 	rot = container_of(work, struct mdss_mdp_rotator_session, commit_work);
 
-	mutex_lock(&rot->lock);
+	mdss_iommu_ctrl(1);
+	while ((job = mdss_mdp_rotator_job_pop(rot))) {
+		if (job->acq_fen_cnt)
+			mdss_fb_wait_for_fences(rot->rot_sync_pt_data,
+					job->acq_fen, job->acq_fen_cnt);
 
-	ret = mdss_mdp_rotator_queue_helper(rot);
-	if (ret)
-		pr_err("rotator queue failed\n");
+		mutex_lock(&rot->lock);
+		mdss_mdp_data_free(&rot->src_buf);
+		memcpy(&rot->src_buf, &job->src_buf,
+				sizeof(struct mdss_mdp_data));
+		mdss_mdp_data_free(&rot->dst_buf);
+		memcpy(&rot->dst_buf, &job->dst_buf,
+				sizeof(struct mdss_mdp_data));
+
+		pr_debug("rotator session=%x start\n", rot->session_id);
+
+		if (!rot_pipe)
+			rot_pipe = mdss_mdp_rot_mgr_acquire_pipe(rot);
+
+		if (rot_pipe) {
+			ret = mdss_mdp_rotator_queue_sub(rot, rot_pipe);
+			if (ret) {
+				pr_err("rotation failed %d for rot=%d\n",
+						ret, rot->session_id);
+				mdss_mdp_rot_mgr_release_pipe(rot_pipe);
+				rot_pipe = NULL;
+			} else {
+				mdss_mdp_rotator_busy_wait(rot,
+						rot_pipe->pipe);
+				/* the pipe now holds this session's setup */
+				rot_pipe->context_switched = false;
+			}
+		} else {
+			pr_err("fail to get pipe for session = %d\n",
+					rot->session_id);
+		}
 
-	if (rot->rot_sync_pt_data) {
 		mdss_fb_signal_timeline(rot->rot_sync_pt_data);
-	} else {
-		pr_err("rot_sync_pt_data is NULL\n");
+		mutex_unlock(&rot->lock);
+
+		mdss_mdp_rotator_job_done(rot, job);
+
+		if (rot_pipe && (list_empty_careful(&rot->job_queue) ||
+				!mdss_mdp_rot_mgr_pipe_uncontended(rot_pipe))) {
+			mdss_mdp_rot_mgr_release_pipe(rot_pipe);
+			rot_pipe = NULL;
+		}
 	}
 
-	mutex_unlock(&rot->lock);
+	if (rot_pipe)
+		mdss_mdp_rot_mgr_release_pipe(rot_pipe);
+	mdss_iommu_ctrl(0);
 }
 
 static struct msm_sync_pt_data *mdss_mdp_rotator_sync_pt_create(
@@ -672,13 +779,6 @@ static int mdss_mdp_rotator_queue_helper(struct mdss_mdp_rotator_session *rot)
 
 	pr_debug("rotator session=%x start\n", rot->session_id);
 
-	if (rot->use_sync_pt && rot->rot_sync_pt_data->temp_fen_cnt) {
-		mdss_fb_wait_for_fences(rot->rot_sync_pt_data,
-				rot->rot_sync_pt_data->temp_fen,
-				rot->rot_sync_pt_data->temp_fen_cnt);
-		rot->rot_sync_pt_data->temp_fen_cnt = 0;
-	}
-
 	rot_pipe = mdss_mdp_rot_mgr_acquire_pipe(rot);
 	if (!rot_pipe) {
 		pr_err("fail to get pipe for session = %d\n", rot->session_id);
@@ -699,22 +799,78 @@ static int mdss_mdp_rotator_queue_helper(struct mdss_mdp_rotator_session *rot)
 	return ret;
 }
 
-static int mdss_mdp_rotator_queue(struct mdss_mdp_rotator_session *rot)
+/**
+ * mdss_mdp_rotator_queue_job() - queue a rotation of an async session
+ * @rot:	Pointer to rotator session
+ * @req:	Source and destination buffers of the rotation
+ * @flgs:	Flags to get the buffers with
+ *
+ * The buffers are mapped and the acquire fences are taken here, the
+ * rotation itself runs later from the session work, which signals the
+ * release fence the buffer sync ioctl handed out when it is done. The
+ * caller only waits when MAX_ROTATOR_QUEUED_JOBS are already in flight.
+ */
+static int mdss_mdp_rotator_queue_job(struct mdss_mdp_rotator_session *rot,
+	struct msmfb_overlay_data *req, u32 flgs)
 {
-	int ret = 0;
+	struct mdss_mdp_rotator_job *job;
+	int ret;
 
-	if (rot->use_sync_pt) {
-		mdss_fb_copy_fence(rot->rot_sync_pt_data,
-				rot->rot_sync_pt_data->temp_fen,
-				&rot->rot_sync_pt_data->temp_fen_cnt);
-		atomic_inc(&rot->rot_sync_pt_data->commit_cnt);
-		queue_work(rot_mgr->rot_work_queue, &rot->commit_work);
-	} else {
-		ret = mdss_mdp_rotator_queue_helper(rot);
+	job = kzalloc(sizeof(*job), GFP_KERNEL);
+	if (!job) {
+		pr_err("unable to allocate rotator job\n");
+		return -ENOMEM;
+	}
+
+	wait_event(rot->job_wq,
+		ACCESS_ONCE(rot->job_cnt) < MAX_ROTATOR_QUEUED_JOBS);
+
+	mdss_iommu_ctrl(1);
+	ret = mdss_mdp_data_get(&job->src_buf, &req->data, 1, flgs);
+	if (ret) {
+		pr_err("src_data pmem error\n");
+		goto src_buf_fail;
 	}
 
+	ret = mdss_mdp_data_map(&job->src_buf);
+	if (ret) {
+		pr_err("unable to map source buffer\n");
+		goto dst_buf_fail;
+	}
+
+	ret = mdss_mdp_data_get(&job->dst_buf, &req->dst_data, 1, flgs);
+	if (ret) {
+		pr_err("dst_data pmem error\n");
+		goto dst_buf_fail;
+	}
+
+	ret = mdss_mdp_data_map(&job->dst_buf);
+	if (ret) {
+		pr_err("unable to map destination buffer\n");
+		mdss_mdp_data_free(&job->dst_buf);
+		goto dst_buf_fail;
+	}
+	mdss_iommu_ctrl(0);
+
+	mutex_lock(&rot->job_lock);
+	mdss_fb_copy_fence(rot->rot_sync_pt_data, job->acq_fen,
+			&job->acq_fen_cnt);
+	list_add_tail(&job->list, &rot->job_queue);
+	rot->job_cnt++;
+	atomic_inc(&rot->rot_sync_pt_data->commit_cnt);
+	mutex_unlock(&rot->job_lock);
+
+	queue_work(rot_mgr->rot_work_queue, &rot->commit_work);
+
 	pr_debug("rotator session=%x queue done\n", rot->session_id);
 
+	return 0;
+
+dst_buf_fail:
+	mdss_mdp_data_free(&job->src_buf);
+src_buf_fail:
+	mdss_iommu_ctrl(0);
+	kfree(job);
 	return ret;
 }
 
@@ -982,6 +1138,7 @@ int mdss_mdp_rotator_release(struct mdss_mdp_rotator_session *rot)
 	int rc;
 
 	rc = mdss_mdp_rotator_finish(rot);
+	mdss_mdp_rotator_job_drop_all(rot);
 	mdss_mdp_data_free(&rot->src_buf);
 	mdss_mdp_data_free(&rot->dst_buf);
 	mdss_mdp_rotator_session_free(rot);
@@ -1027,7 +1184,12 @@ int mdss_mdp_rotator_play(struct msm_fb_data_type *mfd,
 
 	flgs = rot->flags & MDP_SECURE_OVERLAY_SESSION;
 
-	flush_work(&rot->commit_work);
+	if (rot->use_sync_pt) {
+		ret = mdss_mdp_rotator_queue_job(rot, req, flgs);
+		if (ret)
+			pr_err("rotator queue error session id=%x\n", req->id);
+		return ret;
+	}
 
 	mdss_iommu_ctrl(1);
 	mutex_lock(&rot->lock);
@@ -1063,7 +1225,7 @@ int mdss_mdp_rotator_play(struct msm_fb_data_type *mfd,
 		goto dst_buf_fail;
 	}
 
-	ret = mdss_mdp_rotator_queue(rot);
+	ret = mdss_mdp_rotator_queue_helper(rot);
 
 	if (ret)
 		pr_err("rotator queue error session id=%x\n", req->id);
@@ -14,11 +14,24 @@
 #define MDSS_MDP_ROTATOR_H
 
 #include <linux/types.h>
+#include <linux/wait.h>
 
 #include "mdss_mdp.h"
 
 #define MDSS_MDP_ROT_SESSION_MASK	0x40000000
 
+/*
+ * A rotation queued by an asynchronous (sync pt) session, with the buffers
+ * already mapped and the acquire fences taken from the buffer sync ioctl.
+ */
+struct mdss_mdp_rotator_job {
+	struct list_head list;
+	struct mdss_mdp_data src_buf;
+	struct mdss_mdp_data dst_buf;
+	u32 acq_fen_cnt;
+	struct sync_fence *acq_fen[MDP_MAX_FENCE_FD];
+};
+
 struct mdss_mdp_rotator_session {
 	u32 session_id;
 	u32 params_changed;
@@ -49,6 +62,11 @@ struct mdss_mdp_rotator_session {
 	struct msm_sync_pt_data *rot_sync_pt_data;
 	struct work_struct commit_work;
 
+	struct mutex job_lock;
+	struct list_head job_queue;
+	u32 job_cnt;
+	wait_queue_head_t job_wq;
+
 	struct mdp_overlay req_data;
 };
 
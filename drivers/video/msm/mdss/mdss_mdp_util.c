@@ -264,6 +264,30 @@ void mdss_mdp_intersect_rect(struct mdss_rect *res_rect,
 		*res_rect = (struct mdss_rect){l, t, (r-l), (b-t)};
 }
 
+/* smallest rect that covers both, an empty rect doesn't count */
+void mdss_mdp_combine_rect(struct mdss_rect *res_rect,
+	const struct mdss_rect *rect1,
+	const struct mdss_rect *rect2)
+{
+	int l, t, r, b;
+
+	if (!rect1->w || !rect1->h) {
+		*res_rect = *rect2;
+		return;
+	}
+	if (!rect2->w || !rect2->h) {
+		*res_rect = *rect1;
+		return;
+	}
+
+	l = min(rect1->x, rect2->x);
+	t = min(rect1->y, rect2->y);
+	r = max((rect1->x + rect1->w), (rect2->x + rect2->w));
+	b = max((rect1->y + rect1->h), (rect2->y + rect2->h));
+
+	*res_rect = (struct mdss_rect){l, t, (r-l), (b-t)};
+}
+
 void mdss_mdp_crop_rect(struct mdss_rect *src_rect,
 	struct mdss_rect *dst_rect,
 	const struct mdss_rect *sci_rect)
@@ -14,12 +14,15 @@
 #define pr_fmt(fmt)	"%s: " fmt, __func__
 
 #include <linux/errno.h>
+#include <linux/file.h>
 #include <linux/kernel.h>
 #include <linux/major.h>
 #include <linux/module.h>
 #include <linux/uaccess.h>
 #include <linux/iommu.h>
 #include <linux/switch.h>
+#include <linux/sync.h>
+#include <linux/sw_sync.h>
 
 #include <linux/qcom_iommu.h>
 #include <linux/msm_iommu_domains.h>
@@ -46,6 +49,10 @@ struct mdss_mdp_wb {
 	u32 state;
 	int is_secure;
 	struct mdss_mdp_pipe *secure_pipe;
+
+	/* out fences of buffers queued with MSMFB_WRITEBACK_QUEUE_FENCED */
+	struct sw_sync_timeline *timeline;
+	u32 timeline_max;
 };
 
 enum mdss_mdp_wb_node_state {
@@ -63,6 +70,8 @@ struct mdss_mdp_wb_data {
 	struct mdss_mdp_data buf_data;
 	int state;
 	bool user_alloc;
+	bool fenced;
+	struct sync_fence *acq_fen;
 };
 
 static DEFINE_MUTEX(mdss_mdp_wb_buf_lock);
@@ -297,12 +306,21 @@ static int mdss_mdp_wb_terminate(struct msm_fb_data_type *mfd)
 		struct mdss_mdp_wb_data *node, *temp;
 		list_for_each_entry_safe(node, temp, &wb->register_queue,
 					 registered_entry) {
+			if (node->acq_fen)
+				sync_fence_put(node->acq_fen);
 			mdss_mdp_wb_free_node(node);
 			list_del(&node->registered_entry);
 			kfree(node);
 		}
 	}
 
+	/* fences of buffers that never got a frame signal with an error */
+	if (wb->timeline) {
+		sync_timeline_destroy(&wb->timeline->obj);
+		wb->timeline = NULL;
+		wb->timeline_max = 0;
+	}
+
 	wb->is_secure = false;
 	if (wb->secure_pipe)
 		mdss_mdp_pipe_destroy(wb->secure_pipe);
@@ -512,6 +530,69 @@ static void mdss_mdp_wb_free_node(struct mdss_mdp_wb_data *node)
 	}
 }
 
+/*
+ * Set up the fences of a buffer queued with MSMFB_WRITEBACK_QUEUE_FENCED.
+ * Buffers are written in the order they are queued, so the out fence of a
+ * buffer is the next point on the writeback timeline. Called with the
+ * writeback lock held.
+ */
+static int mdss_mdp_wb_node_fence(struct mdss_mdp_wb *wb,
+		struct mdss_mdp_wb_data *node, struct msmfb_data *data)
+{
+	struct sync_fence *fence;
+	int acq_fen_fd = (int) data->priv;
+	int fd, ret;
+
+	node->fenced = false;
+	if (!(data->flags & MSMFB_WRITEBACK_QUEUE_FENCED))
+		return 0;
+
+	if (!wb->timeline) {
+		wb->timeline = sw_sync_timeline_create("mdss_wb");
+		if (!wb->timeline) {
+			pr_err("cannot create writeback timeline\n");
+			return -ENOMEM;
+		}
+	}
+
+	if (acq_fen_fd >= 0) {
+		node->acq_fen = sync_fence_fdget(acq_fen_fd);
+		if (!node->acq_fen) {
+			pr_err("invalid acquire fence fd=%d\n", acq_fen_fd);
+			return -EINVAL;
+		}
+	}
+
+	fence = mdss_fb_sync_get_fence(wb->timeline, "wb-out",
+			wb->timeline_max + 1);
+	if (!fence) {
+		ret = -ENOMEM;
+		goto fence_fail;
+	}
+
+	fd = get_unused_fd_flags(0);
+	if (fd < 0) {
+		pr_err("get_unused_fd_flags failed error:0x%x\n", fd);
+		sync_fence_put(fence);
+		ret = fd;
+		goto fence_fail;
+	}
+	sync_fence_install(fence, fd);
+
+	wb->timeline_max++;
+	node->fenced = true;
+	data->priv = fd;
+
+	return 0;
+
+fence_fail:
+	if (node->acq_fen) {
+		sync_fence_put(node->acq_fen);
+		node->acq_fen = NULL;
+	}
+	return ret;
+}
+
 static int mdss_mdp_wb_queue(struct msm_fb_data_type *mfd,
 				struct msmfb_data *data, int local)
 {
@@ -552,8 +633,12 @@ static int mdss_mdp_wb_queue(struct msm_fb_data_type *mfd,
 			pr_debug("node 0x%pa re-queueded without dequeue\n",
 				&buf->addr);
 			list_del(&node->active_entry);
+			node->state = WITH_CLIENT;
 		case WITH_CLIENT:
 		case REGISTERED:
+			ret = mdss_mdp_wb_node_fence(wb, node, data);
+			if (ret)
+				break;
 			list_add_tail(&node->active_entry, &wb->free_queue);
 			node->state = IN_FREE_QUEUE;
 			break;
@@ -569,6 +654,28 @@ static int mdss_mdp_wb_queue(struct msm_fb_data_type *mfd,
 	return ret;
 }
 
+/*
+ * A fenced buffer goes straight back to the client and its out fence is
+ * signalled, other buffers wait in the busy queue to be dequeued.
+ */
+static void mdss_mdp_wb_node_done(struct mdss_mdp_wb *wb,
+		struct mdss_mdp_wb_data *node)
+{
+	mutex_lock(&wb->lock);
+	if (node->fenced) {
+		node->fenced = false;
+		node->state = WITH_CLIENT;
+		sw_sync_timeline_inc(wb->timeline, 1);
+		mutex_unlock(&wb->lock);
+		return;
+	}
+
+	list_add_tail(&node->active_entry, &wb->busy_queue);
+	node->state = WB_BUFFER_READY;
+	mutex_unlock(&wb->lock);
+	wake_up(&wb->wait_q);
+}
+
 static int is_buffer_ready(struct mdss_mdp_wb *wb)
 {
 	int rc;
@@ -678,9 +785,19 @@ int mdss_mdp_wb_kickoff(struct msm_fb_data_type *mfd,
 		goto kickoff_fail;
 	}
 
+	/* the encoder may still be reading the buffer */
+	if (node && node->acq_fen) {
+		mdss_fb_wait_for_fences(&mfd->mdp_sync_pt_data,
+				&node->acq_fen, 1);
+		node->acq_fen = NULL;
+	}
+
 	ret = mdss_mdp_writeback_display_commit(ctl, &wb_args);
 	if (ret) {
 		pr_err("error on commit ctl=%d\n", ctl->num);
+		/* keep the out fences of the later buffers in order */
+		if (node && node->fenced)
+			mdss_mdp_wb_node_done(wb, node);
 		goto kickoff_fail;
 	}
 
@@ -695,13 +812,8 @@ int mdss_mdp_wb_kickoff(struct msm_fb_data_type *mfd,
 		commit_cb->commit_cb_fnc(MDP_COMMIT_STAGE_READY_FOR_KICKOFF,
 			commit_cb->data);
 
-	if (wb && node) {
-		mutex_lock(&wb->lock);
-		list_add_tail(&node->active_entry, &wb->busy_queue);
-		node->state = WB_BUFFER_READY;
-		mutex_unlock(&wb->lock);
-		wake_up(&wb->wait_q);
-	}
+	if (wb && node)
+		mdss_mdp_wb_node_done(wb, node);
 
 kickoff_fail:
 	mutex_unlock(&mdss_mdp_wb_buf_lock);
@@ -786,7 +898,8 @@ int mdss_mdp_wb_ioctl_handler(struct msm_fb_data_type *mfd, u32 cmd,
 	case MSMFB_WRITEBACK_QUEUE_BUFFER:
 		if (!copy_from_user(&data, arg, sizeof(data))) {
 			ret = mdss_mdp_wb_queue(mfd, &data, false);
-			ret = copy_to_user(arg, &data, sizeof(data));
+			if (copy_to_user(arg, &data, sizeof(data)))
+				ret = -EFAULT;
 		} else {
 			pr_err("wb queue buf failed on copy_from_user\n");
 			ret = -EFAULT;
@@ -217,6 +217,11 @@ struct mdss_intf_recovery {
  *				the panel.
  * @MDSS_EVENT_PANEL_TIMING_SWITCH: Panel timing switch is requested.
  *				Argument provided is new panel timing.
+ * @MDSS_EVENT_PANEL_EARLY_POWER: Sent at the start of an unblank from power
+ *				off, before the MDP is restored. Argument is 1
+ *				to let the panel start its power up in the
+ *				background, or 0 to undo one that the unblank
+ *				did not get to use.
  */
 enum mdss_intf_events {
 	MDSS_EVENT_RESET = 1,
@@ -244,6 +249,7 @@ enum mdss_intf_events {
 	MDSS_EVENT_DSI_RECONFIG_CMD,
 	MDSS_EVENT_DSI_RESET_WRITE_PTR,
 	MDSS_EVENT_PANEL_TIMING_SWITCH,
+	MDSS_EVENT_PANEL_EARLY_POWER,
 };
 
 struct lcd_panel_info {
@@ -19,6 +19,7 @@
 #include <linux/swap.h>
 #include <linux/bio.h>
 #include <linux/blkdev.h>
+#include <linux/blk-crypt.h>
 #include <linux/uio.h>
 #include <linux/iocontext.h>
 #include <linux/slab.h>
@@ -244,6 +245,8 @@ static void __bio_free(struct bio *bio)
 
 	if (bio_integrity(bio))
 		bio_integrity_free(bio);
+
+	bio_crypt_free(bio);
 }
 
 static void bio_free(struct bio *bio)
@@ -541,6 +544,7 @@ void __bio_clone(struct bio *bio, struct bio *bio_src)
 	bio->bi_size = bio_src->bi_size;
 	bio->bi_idx = bio_src->bi_idx;
 	bio->bi_dio_inode = bio_src->bi_dio_inode;
+	bio_crypt_clone(bio, bio_src);
 }
 EXPORT_SYMBOL(__bio_clone);
 
@@ -1775,6 +1779,10 @@ struct bio_pair *bio_split(struct bio *bi, int first_sectors)
 	bp->bio2.bi_sector += first_sectors;
 	bp->bio2.bi_size -= first_sectors << 9;
 	bp->bio1.bi_size = first_sectors << 9;
+#ifdef CONFIG_BLK_INLINE_ENCRYPTION
+	/* both halves borrow the reference of @bi */
+	bp->bio2.bi_crypt_dun = bio_crypt_dun_at(bi, first_sectors);
+#endif
 
 	if (bi->bi_vcnt != 0) {
 		bp->bv1 = *bio_iovec(bi);
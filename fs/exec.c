@@ -997,6 +997,7 @@ static int de_thread(struct task_struct *tsk)
 		threadgroup_change_end(tsk);
 
 		release_task(leader);
+		lmk_adj_index_add(tsk);
 	}
 
 	sig->group_exit_task = NULL;
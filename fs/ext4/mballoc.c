@@ -1943,15 +1943,15 @@ void ext4_mb_complex_scan_group(struct ext4_allocation_context *ac,
 }
 
 /*
- * This is a special case for storages like raid5
- * we try to find stripe-aligned chunks for stripe-size-multiple requests
+ * This is a special case for storages like raid5, and for flash that
+ * wants whole write units: we try to find stride-aligned chunks for
+ * stride-size-multiple requests
  */
 static noinline_for_stack
 void ext4_mb_scan_aligned(struct ext4_allocation_context *ac,
-				 struct ext4_buddy *e4b)
+				 struct ext4_buddy *e4b, unsigned int stride)
 {
 	struct super_block *sb = ac->ac_sb;
-	struct ext4_sb_info *sbi = EXT4_SB(sb);
 	void *bitmap = e4b->bd_bitmap;
 	struct ext4_free_extent ex;
 	ext4_fsblk_t first_group_block;
@@ -1959,29 +1959,41 @@ void ext4_mb_scan_aligned(struct ext4_allocation_context *ac,
 	ext4_grpblk_t i;
 	int max;
 
-	BUG_ON(sbi->s_stripe == 0);
+	BUG_ON(stride == 0);
 
-	/* find first stripe-aligned block in group */
+	/* find first stride-aligned block in group */
 	first_group_block = ext4_group_first_block_no(sb, e4b->bd_group);
 
-	a = first_group_block + sbi->s_stripe - 1;
-	do_div(a, sbi->s_stripe);
-	i = (a * sbi->s_stripe) - first_group_block;
+	a = first_group_block + stride - 1;
+	do_div(a, stride);
+	i = (a * stride) - first_group_block;
 
 	while (i < EXT4_CLUSTERS_PER_GROUP(sb)) {
 		if (!mb_test_bit(i, bitmap)) {
-			max = mb_find_extent(e4b, i, sbi->s_stripe, &ex);
-			if (max >= sbi->s_stripe) {
+			max = mb_find_extent(e4b, i, stride, &ex);
+			if (max >= stride) {
 				ac->ac_found++;
 				ac->ac_b_ex = ex;
 				ext4_mb_use_best_found(ac, e4b);
 				break;
 			}
 		}
-		i += sbi->s_stripe;
+		i += stride;
 	}
 }
 
+/* alignment cr 1 scans with, 0 if the request needs none */
+static unsigned int ext4_mb_scan_stride(struct ext4_allocation_context *ac)
+{
+	struct ext4_sb_info *sbi = EXT4_SB(ac->ac_sb);
+
+	if (sbi->s_stripe)
+		return sbi->s_stripe;
+	if (sbi->s_mb_flash && (ac->ac_flags & EXT4_MB_HINT_GROUP_ALLOC))
+		return sbi->s_mb_flash_align;
+	return 0;
+}
+
 /* This is now called BEFORE we load the buddy bitmap. */
 static int ext4_mb_good_group(struct ext4_allocation_context *ac,
 				ext4_group_t group, int cr)
@@ -2028,6 +2040,14 @@ static int ext4_mb_good_group(struct ext4_allocation_context *ac,
 
 		return 1;
 	case 1:
+		/*
+		 * A free extent of fe_len holds a buddy chunk of at least a
+		 * quarter of it, so with no such chunk in the histogram the
+		 * bitmap scan would come back empty.
+		 */
+		if (EXT4_SB(ac->ac_sb)->s_mb_flash &&
+		    grp->bb_largest_free_order < fls(ac->ac_g_ex.fe_len) - 2)
+			return 0;
 		if ((free / fragments) >= ac->ac_g_ex.fe_len)
 			return 1;
 		break;
@@ -2050,6 +2070,7 @@ ext4_mb_regular_allocator(struct ext4_allocation_context *ac)
 	ext4_group_t ngroups, group, i;
 	int cr;
 	int err = 0;
+	unsigned int stride;
 	struct ext4_sb_info *sbi;
 	struct super_block *sb;
 	struct ext4_buddy e4b;
@@ -2100,6 +2121,8 @@ ext4_mb_regular_allocator(struct ext4_allocation_context *ac)
 		spin_unlock(&sbi->s_md_lock);
 	}
 
+	stride = ext4_mb_scan_stride(ac);
+
 	/* Let's just scan groups to find more-less suitable blocks */
 	cr = ac->ac_2order ? 0 : 1;
 	/*
@@ -2146,9 +2169,9 @@ repeat:
 			ac->ac_groups_scanned++;
 			if (cr == 0 && ac->ac_2order < sb->s_blocksize_bits+2)
 				ext4_mb_simple_scan_group(ac, &e4b);
-			else if (cr == 1 && sbi->s_stripe &&
-					!(ac->ac_g_ex.fe_len % sbi->s_stripe))
-				ext4_mb_scan_aligned(ac, &e4b);
+			else if (cr == 1 && stride &&
+					!(ac->ac_g_ex.fe_len % stride))
+				ext4_mb_scan_aligned(ac, &e4b, stride);
 			else
 				ext4_mb_complex_scan_group(ac, &e4b);
 
@@ -2599,6 +2622,19 @@ int ext4_mb_init(struct super_block *sb)
 			sbi->s_mb_group_prealloc, sbi->s_stripe);
 	}
 
+	/*
+	 * The flash allocation mode aligns group preallocations to the
+	 * device write unit, or failing that to its erase block, both in
+	 * clusters. A unit beyond the preallocation size is not worth it.
+	 */
+	sbi->s_mb_flash = MB_DEFAULT_FLASH;
+	i = queue_io_opt(bdev_get_queue(sb->s_bdev));
+	if (!i)
+		i = bdev_get_queue(sb->s_bdev)->limits.discard_granularity;
+	i >>= sb->s_blocksize_bits + sbi->s_cluster_bits;
+	sbi->s_mb_flash_align = (i > 1 && i <= sbi->s_mb_group_prealloc) ?
+									i : 0;
+
 	sbi->s_locality_groups = alloc_percpu(struct ext4_locality_group);
 	if (sbi->s_locality_groups == NULL) {
 		ret = -ENOMEM;
@@ -2965,6 +3001,9 @@ static void ext4_mb_normalize_group_request(struct ext4_allocation_context *ac)
 
 	BUG_ON(lg == NULL);
 	ac->ac_g_ex.fe_len = EXT4_SB(sb)->s_mb_group_prealloc;
+	if (EXT4_SB(sb)->s_mb_flash && EXT4_SB(sb)->s_mb_flash_align)
+		ac->ac_g_ex.fe_len = roundup(ac->ac_g_ex.fe_len,
+					     EXT4_SB(sb)->s_mb_flash_align);
 	mb_debug(1, "#%u: goal %u blocks for locality group\n",
 		current->pid, ac->ac_g_ex.fe_len);
 }
@@ -4118,6 +4157,20 @@ static void ext4_mb_group_or_file(struct ext4_allocation_context *ac)
 	 */
 	ac->ac_lg = __this_cpu_ptr(sbi->s_locality_groups);
 
+	/*
+	 * On flash nothing is gained by keeping small files near their
+	 * directory, so each cpu gets its own slice of the groups instead
+	 * and cpus unpacking files at once stay off each other's group
+	 * locks.
+	 */
+	if (sbi->s_mb_flash &&
+	    ext4_test_inode_flag(ac->ac_inode, EXT4_INODE_EXTENTS)) {
+		ac->ac_g_ex.fe_group = div_u64((u64)raw_smp_processor_id() *
+					ext4_get_groups_count(ac->ac_sb),
+					nr_cpu_ids);
+		ac->ac_g_ex.fe_start = 0;
+	}
+
 	/* we're going to use group allocation */
 	ac->ac_flags |= EXT4_MB_HINT_GROUP_ALLOC;
 
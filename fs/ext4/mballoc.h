@@ -89,6 +89,13 @@ extern ushort ext4_mballoc_debug;
  */
 #define MB_DEFAULT_GROUP_PREALLOC	512
 
+/*
+ * flash allocation mode: per-cpu groups for small files, write unit
+ * aligned group preallocations, groups filtered by the buddy histogram.
+ * We can tune it via /sys/fs/ext4/<partition>/mb_flash
+ */
+#define MB_DEFAULT_FLASH		0
+
 
 struct ext4_free_data {
 	/* MUST be the first member */
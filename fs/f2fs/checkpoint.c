@@ -886,7 +886,7 @@ retry_flush_nodes:
 
 	if (get_pages(sbi, F2FS_DIRTY_NODES)) {
 		up_write(&sbi->node_write);
-		sync_node_pages(sbi, 0, &wbc);
+		sync_node_pages(sbi, 0, &wbc, false);
 		if (unlikely(f2fs_cp_error(sbi))) {
 			f2fs_unlock_all(sbi);
 			err = -EIO;
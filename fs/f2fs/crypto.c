@@ -58,6 +58,17 @@ module_param(num_prealloc_crypto_ctxs, uint, 0444);
 MODULE_PARM_DESC(num_prealloc_crypto_ctxs,
 		"Number of crypto contexts to preallocate");
 
+/*
+ * The pages of a read bio are decrypted in windows of this many requests,
+ * submitted back to back so an asynchronous engine can queue and chain
+ * them, with one wait per window instead of one per page.
+ */
+#define F2FS_MAX_CRYPTO_BATCH	64
+static unsigned int num_batched_crypto_pages = 16;
+module_param(num_batched_crypto_pages, uint, 0644);
+MODULE_PARM_DESC(num_batched_crypto_pages,
+		"Number of pages of a read bio decrypted concurrently");
+
 static mempool_t *f2fs_bounce_page_pool;
 
 static LIST_HEAD(f2fs_free_crypto_ctxs);
@@ -142,8 +153,11 @@ struct f2fs_crypto_ctx *f2fs_get_crypto_ctx(struct inode *inode)
 	return ctx;
 }
 
+static bool f2fs_decrypt_bio(struct bio *bio);
+
 /*
- * Call f2fs_decrypt on every single page, reusing the encryption
+ * Decrypt every page of the bio, in batches when possible, else by
+ * calling f2fs_decrypt on every single page, reusing the encryption
  * context.
  */
 static void completion_pages(struct work_struct *work)
@@ -154,6 +168,9 @@ static void completion_pages(struct work_struct *work)
 	struct bio_vec *bv;
 	int i;
 
+	if (f2fs_decrypt_bio(bio))
+		goto out;
+
 	bio_for_each_segment_all(bv, bio, i) {
 		struct page *page = bv->bv_page;
 		int ret = f2fs_decrypt(ctx, page);
@@ -165,6 +182,7 @@ static void completion_pages(struct work_struct *work)
 			SetPageUptodate(page);
 		unlock_page(page);
 	}
+out:
 	f2fs_release_crypto_ctx(ctx);
 	bio_put(bio);
 }
@@ -320,6 +338,14 @@ typedef enum {
 	F2FS_ENCRYPT,
 } f2fs_direction_t;
 
+static void f2fs_xts_tweak(u8 *xts_tweak, pgoff_t index)
+{
+	BUILD_BUG_ON(F2FS_XTS_TWEAK_SIZE < sizeof(index));
+	memcpy(xts_tweak, &index, sizeof(index));
+	memset(&xts_tweak[sizeof(index)], 0,
+			F2FS_XTS_TWEAK_SIZE - sizeof(index));
+}
+
 static int f2fs_page_crypto(struct f2fs_crypto_ctx *ctx,
 				struct inode *inode,
 				f2fs_direction_t rw,
@@ -346,10 +372,7 @@ static int f2fs_page_crypto(struct f2fs_crypto_ctx *ctx,
 		req, CRYPTO_TFM_REQ_MAY_BACKLOG | CRYPTO_TFM_REQ_MAY_SLEEP,
 		f2fs_crypt_complete, &ecr);
 
-	BUILD_BUG_ON(F2FS_XTS_TWEAK_SIZE < sizeof(index));
-	memcpy(xts_tweak, &index, sizeof(index));
-	memset(&xts_tweak[sizeof(index)], 0,
-			F2FS_XTS_TWEAK_SIZE - sizeof(index));
+	f2fs_xts_tweak(xts_tweak, index);
 
 	sg_init_table(&dst, 1);
 	sg_set_page(&dst, dest_page, PAGE_CACHE_SIZE, 0);
@@ -376,6 +399,129 @@ static int f2fs_page_crypto(struct f2fs_crypto_ctx *ctx,
 	return 0;
 }
 
+struct f2fs_crypt_batch {
+	atomic_t pending;
+	struct completion completion;
+};
+
+struct f2fs_crypt_page_req {
+	struct ablkcipher_request *req;
+	struct f2fs_crypt_batch *batch;
+	struct page *page;
+	struct scatterlist sg;
+	u8 xts_tweak[F2FS_XTS_TWEAK_SIZE];
+	int res;
+};
+
+static void f2fs_crypt_batch_complete(struct crypto_async_request *req,
+					int res)
+{
+	struct f2fs_crypt_page_req *preq = req->data;
+
+	if (res == -EINPROGRESS)
+		return;
+	preq->res = res;
+	if (atomic_dec_and_test(&preq->batch->pending))
+		complete(&preq->batch->completion);
+}
+
+/*
+ * Submit the in-place decryption of @n pages without waiting in between,
+ * then wait for all of them and finish the pages as completion_pages()
+ * does. The batch holds one extra pending count until everything has been
+ * submitted.
+ */
+static void f2fs_decrypt_window(struct f2fs_crypt_page_req *preqs, int n)
+{
+	struct f2fs_crypt_batch batch;
+	struct f2fs_crypt_page_req *preq;
+	struct crypto_ablkcipher *tfm;
+	int i, res;
+
+	atomic_set(&batch.pending, 1);
+	init_completion(&batch.completion);
+
+	for (i = 0; i < n; i++) {
+		preq = &preqs[i];
+		preq->batch = &batch;
+		preq->res = 0;
+		tfm = F2FS_I(preq->page->mapping->host)->i_crypt_info->ci_ctfm;
+		preq->req = ablkcipher_request_alloc(tfm, GFP_NOFS);
+		if (!preq->req) {
+			preq->res = -ENOMEM;
+			continue;
+		}
+		ablkcipher_request_set_callback(preq->req,
+			CRYPTO_TFM_REQ_MAY_BACKLOG | CRYPTO_TFM_REQ_MAY_SLEEP,
+			f2fs_crypt_batch_complete, preq);
+		f2fs_xts_tweak(preq->xts_tweak, preq->page->index);
+		sg_init_table(&preq->sg, 1);
+		sg_set_page(&preq->sg, preq->page, PAGE_CACHE_SIZE, 0);
+		ablkcipher_request_set_crypt(preq->req, &preq->sg, &preq->sg,
+					PAGE_CACHE_SIZE, preq->xts_tweak);
+
+		atomic_inc(&batch.pending);
+		res = crypto_ablkcipher_decrypt(preq->req);
+		if (res != -EINPROGRESS && res != -EBUSY) {
+			/* completed synchronously, no callback */
+			preq->res = res;
+			atomic_dec(&batch.pending);
+		}
+	}
+	if (!atomic_dec_and_test(&batch.pending))
+		wait_for_completion(&batch.completion);
+
+	for (i = 0; i < n; i++) {
+		preq = &preqs[i];
+		ablkcipher_request_free(preq->req);
+		if (preq->res) {
+			printk_ratelimited(KERN_ERR
+				"%s: crypto_ablkcipher_decrypt() returned %d\n",
+				__func__, preq->res);
+			WARN_ON_ONCE(1);
+			SetPageError(preq->page);
+		} else
+			SetPageUptodate(preq->page);
+		unlock_page(preq->page);
+	}
+}
+
+/*
+ * Decrypt the pages of a read bio in windows of num_batched_crypto_pages.
+ * Returns false, with no page touched, when batching is off or the window
+ * can not be allocated, so the caller goes page by page.
+ */
+static bool f2fs_decrypt_bio(struct bio *bio)
+{
+	struct f2fs_crypt_page_req *preqs;
+	struct bio_vec *bv;
+	unsigned int window;
+	int i, n = 0;
+
+	window = min_t(unsigned int, num_batched_crypto_pages,
+			F2FS_MAX_CRYPTO_BATCH);
+	window = min_t(unsigned int, window, bio->bi_vcnt);
+	if (window <= 1)
+		return false;
+
+	preqs = kcalloc(window, sizeof(*preqs), GFP_NOFS);
+	if (!preqs)
+		return false;
+
+	bio_for_each_segment_all(bv, bio, i) {
+		BUG_ON(!PageLocked(bv->bv_page));
+		preqs[n++].page = bv->bv_page;
+		if (n == window) {
+			f2fs_decrypt_window(preqs, n);
+			n = 0;
+		}
+	}
+	if (n)
+		f2fs_decrypt_window(preqs, n);
+	kfree(preqs);
+	return true;
+}
+
 static struct page *alloc_bounce_page(struct f2fs_crypto_ctx *ctx)
 {
 	ctx->w.bounce_page = mempool_alloc(f2fs_bounce_page_pool, GFP_NOWAIT);
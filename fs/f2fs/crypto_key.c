@@ -94,6 +94,11 @@ static void f2fs_free_crypt_info(struct f2fs_crypt_info *ci)
 
 	key_put(ci->ci_keyring_key);
 	crypto_free_ablkcipher(ci->ci_ctfm);
+#ifdef CONFIG_BLK_INLINE_ENCRYPTION
+	/* bios in flight keep their own reference */
+	if (ci->ci_blk_key)
+		blk_crypt_key_put(ci->ci_blk_key);
+#endif
 	kmem_cache_free(f2fs_crypt_info_cachep, ci);
 }
 
@@ -113,6 +118,39 @@ void f2fs_free_encryption_info(struct inode *inode, struct f2fs_crypt_info *ci)
 	f2fs_free_crypt_info(ci);
 }
 
+/*
+ * With inlinecrypt, the contents of regular files are encrypted by the
+ * storage controller on the way to the device, with the page index as the
+ * tweak, rather than by ci_ctfm in f2fs_encrypt() and f2fs_decrypt().
+ */
+static bool f2fs_use_inline_crypt(struct inode *inode, char mode)
+{
+#ifdef CONFIG_BLK_INLINE_ENCRYPTION
+	return S_ISREG(inode->i_mode) &&
+		mode == F2FS_ENCRYPTION_MODE_AES_256_XTS &&
+		test_opt(F2FS_I_SB(inode), INLINE_CRYPT);
+#else
+	return false;
+#endif
+}
+
+static int f2fs_setup_blk_key(struct f2fs_crypt_info *ci, const char *raw_key,
+			      char mode)
+{
+#ifdef CONFIG_BLK_INLINE_ENCRYPTION
+	struct blk_crypt_key *key;
+
+	key = blk_crypt_key_alloc(raw_key, f2fs_encryption_key_size(mode),
+				  GFP_NOFS);
+	if (IS_ERR(key))
+		return PTR_ERR(key);
+	ci->ci_blk_key = key;
+	return 0;
+#else
+	return -EOPNOTSUPP;
+#endif
+}
+
 int _f2fs_get_encryption_info(struct inode *inode)
 {
 	struct f2fs_inode_info *fi = F2FS_I(inode);
@@ -160,6 +198,9 @@ retry:
 	crypt_info->ci_filename_mode = ctx.filenames_encryption_mode;
 	crypt_info->ci_ctfm = NULL;
 	crypt_info->ci_keyring_key = NULL;
+#ifdef CONFIG_BLK_INLINE_ENCRYPTION
+	crypt_info->ci_blk_key = NULL;
+#endif
 	memcpy(crypt_info->ci_master_key, ctx.master_key_descriptor,
 				sizeof(crypt_info->ci_master_key));
 	if (S_ISREG(inode->i_mode))
@@ -213,22 +254,28 @@ retry:
 	if (res)
 		goto out;
 
-	ctfm = crypto_alloc_ablkcipher(cipher_str, 0, 0);
-	if (!ctfm || IS_ERR(ctfm)) {
-		res = ctfm ? PTR_ERR(ctfm) : -ENOMEM;
-		printk(KERN_DEBUG
-		       "%s: error %d (inode %u) allocating crypto tfm\n",
-		       __func__, res, (unsigned) inode->i_ino);
-		goto out;
-	}
-	crypt_info->ci_ctfm = ctfm;
-	crypto_ablkcipher_clear_flags(ctfm, ~0);
-	crypto_tfm_set_flags(crypto_ablkcipher_tfm(ctfm),
-			     CRYPTO_TFM_REQ_WEAK_KEY);
-	res = crypto_ablkcipher_setkey(ctfm, raw_key,
+	if (f2fs_use_inline_crypt(inode, mode)) {
+		res = f2fs_setup_blk_key(crypt_info, raw_key, mode);
+		if (res)
+			goto out;
+	} else {
+		ctfm = crypto_alloc_ablkcipher(cipher_str, 0, 0);
+		if (!ctfm || IS_ERR(ctfm)) {
+			res = ctfm ? PTR_ERR(ctfm) : -ENOMEM;
+			printk(KERN_DEBUG
+			       "%s: error %d (inode %u) allocating crypto tfm\n",
+			       __func__, res, (unsigned) inode->i_ino);
+			goto out;
+		}
+		crypt_info->ci_ctfm = ctfm;
+		crypto_ablkcipher_clear_flags(ctfm, ~0);
+		crypto_tfm_set_flags(crypto_ablkcipher_tfm(ctfm),
+				     CRYPTO_TFM_REQ_WEAK_KEY);
+		res = crypto_ablkcipher_setkey(ctfm, raw_key,
 					f2fs_encryption_key_size(mode));
-	if (res)
-		goto out;
+		if (res)
+			goto out;
+	}
 
 	memzero_explicit(raw_key, sizeof(raw_key));
 	if (cmpxchg(&fi->i_crypt_info, NULL, crypt_info) != NULL) {
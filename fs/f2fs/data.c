@@ -83,6 +83,18 @@ static void f2fs_write_end_io(struct bio *bio, int err)
 	bio_put(bio);
 }
 
+/*
+ * The key a data page goes to the device with, or NULL. GC copies the
+ * ciphertext of encrypted files through META_MAPPING as it is, so do pages
+ * that f2fs_encrypt() already encrypted.
+ */
+static struct blk_crypt_key *f2fs_fio_blk_key(struct f2fs_io_info *fio)
+{
+	if (fio->type != DATA || fio->encrypted_page)
+		return NULL;
+	return f2fs_inode_blk_key(fio->page->mapping->host);
+}
+
 /*
  * Low-level block read/write IO operations.
  */
@@ -145,6 +157,7 @@ void f2fs_submit_merged_bio(struct f2fs_sb_info *sbi,
  */
 int f2fs_submit_page_bio(struct f2fs_io_info *fio)
 {
+	struct blk_crypt_key *key;
 	struct bio *bio;
 	struct page *page = fio->encrypted_page ? fio->encrypted_page : fio->page;
 
@@ -153,6 +166,9 @@ int f2fs_submit_page_bio(struct f2fs_io_info *fio)
 
 	/* Allocate a new bio */
 	bio = __bio_alloc(fio->sbi, fio->blk_addr, 1, is_read_io(fio->rw));
+	key = f2fs_fio_blk_key(fio);
+	if (key)
+		bio_set_crypt_key(bio, key, page->index);
 
 	if (bio_add_page(bio, page, PAGE_CACHE_SIZE, 0) < PAGE_CACHE_SIZE) {
 		bio_put(bio);
@@ -169,6 +185,7 @@ void f2fs_submit_page_mbio(struct f2fs_io_info *fio)
 	enum page_type btype = PAGE_TYPE_OF_BIO(fio->type);
 	struct f2fs_bio_info *io;
 	bool is_read = is_read_io(fio->rw);
+	struct blk_crypt_key *key = f2fs_fio_blk_key(fio);
 	struct page *bio_page;
 
 	io = is_read ? &sbi->read_io : &sbi->write_io[btype];
@@ -181,13 +198,16 @@ void f2fs_submit_page_mbio(struct f2fs_io_info *fio)
 		inc_page_count(sbi, F2FS_WRITEBACK);
 
 	if (io->bio && (io->last_block_in_bio != fio->blk_addr - 1 ||
-						io->fio.rw != fio->rw))
+			io->fio.rw != fio->rw ||
+			!bio_crypt_can_append(io->bio, key, fio->page->index)))
 		__submit_merged_bio(io);
 alloc_new:
 	if (io->bio == NULL) {
 		int bio_blocks = MAX_BIO_BLOCKS(sbi);
 
 		io->bio = __bio_alloc(sbi, fio->blk_addr, bio_blocks, is_read);
+		if (key)
+			bio_set_crypt_key(io->bio, key, fio->page->index);
 		io->fio = *fio;
 	}
 
@@ -886,6 +906,7 @@ static int f2fs_mpage_readpages(struct address_space *mapping,
 	sector_t last_block_in_file;
 	sector_t block_nr;
 	struct block_device *bdev = inode->i_sb->s_bdev;
+	struct blk_crypt_key *key = f2fs_inode_blk_key(inode);
 	struct f2fs_map_blocks map;
 
 	map.m_pblk = 0;
@@ -899,7 +920,7 @@ static int f2fs_mpage_readpages(struct address_space *mapping,
 		if (pages) {
 			page = list_entry(pages->prev, struct page, lru);
 			list_del(&page->lru);
-			if (add_to_page_cache_lru(page, mapping,
+			if (add_to_page_cache_lru_batch(page, mapping,
 						  page->index, GFP_KERNEL))
 				goto next_page;
 		}
@@ -953,7 +974,8 @@ got_it:
 		 * This page will go to BIO.  Do we need to send this
 		 * BIO off first?
 		 */
-		if (bio && (last_block_in_bio != block_nr - 1)) {
+		if (bio && (last_block_in_bio != block_nr - 1 ||
+			    !bio_crypt_can_append(bio, key, page->index))) {
 submit_and_realloc:
 			submit_bio(READ, bio);
 			bio = NULL;
@@ -964,9 +986,11 @@ submit_and_realloc:
 			if (f2fs_encrypted_inode(inode) &&
 					S_ISREG(inode->i_mode)) {
 
-				ctx = f2fs_get_crypto_ctx(inode);
-				if (IS_ERR(ctx))
-					goto set_error_page;
+				if (!key) {
+					ctx = f2fs_get_crypto_ctx(inode);
+					if (IS_ERR(ctx))
+						goto set_error_page;
+				}
 
 				/* wait the page to be moved by cleaning */
 				f2fs_wait_on_encrypted_page_writeback(
@@ -984,6 +1008,8 @@ submit_and_realloc:
 			bio->bi_sector = SECTOR_FROM_BLOCK(block_nr);
 			bio->bi_end_io = f2fs_read_end_io;
 			bio->bi_private = ctx;
+			if (key)
+				bio_set_crypt_key(bio, key, page->index);
 		}
 
 		if (bio_add_page(bio, page, blocksize, 0) < blocksize)
@@ -1069,10 +1095,13 @@ int do_write_data_page(struct f2fs_io_info *fio)
 		f2fs_wait_on_encrypted_page_writeback(F2FS_I_SB(inode),
 							fio->blk_addr);
 
-		fio->encrypted_page = f2fs_encrypt(inode, fio->page);
-		if (IS_ERR(fio->encrypted_page)) {
-			err = PTR_ERR(fio->encrypted_page);
-			goto out_writepage;
+		/* with inlinecrypt the storage controller encrypts it */
+		if (!f2fs_inode_blk_key(inode)) {
+			fio->encrypted_page = f2fs_encrypt(inode, fio->page);
+			if (IS_ERR(fio->encrypted_page)) {
+				err = PTR_ERR(fio->encrypted_page);
+				goto out_writepage;
+			}
 		}
 	}
 
@@ -1501,7 +1530,8 @@ put_next:
 		}
 
 		/* avoid symlink page */
-		if (f2fs_encrypted_inode(inode) && S_ISREG(inode->i_mode)) {
+		if (f2fs_encrypted_inode(inode) && S_ISREG(inode->i_mode) &&
+				!f2fs_inode_blk_key(inode)) {
 			err = f2fs_decrypt_one(inode, page);
 			if (err)
 				goto fail;
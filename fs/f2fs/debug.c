@@ -90,6 +90,22 @@ static void update_general_status(struct f2fs_sb_info *sbi)
 	}
 
 	si->inplace_count = atomic_read(&sbi->inplace_count);
+
+	si->fsync_count = atomic_read(&sbi->fsync_count);
+	si->flush_count = atomic_read(&sbi->flush_count);
+	si->flush_merged = atomic_read(&sbi->flush_merged);
+	si->fsync_p99 = 0;
+	if (si->fsync_count) {
+		int below = si->fsync_count / 100;
+
+		/* walk down from the slowest slot until 1% is passed */
+		for (i = F2FS_FSYNC_LAT_SLOTS - 1; i > 0; i--) {
+			below -= atomic_read(&sbi->fsync_lat[i]);
+			if (below < 0)
+				break;
+		}
+		si->fsync_p99 = 1U << i;
+	}
 }
 
 /*
@@ -270,6 +286,10 @@ static int stat_show(struct seq_file *s, void *v)
 		seq_printf(s, "  - Prefree: %d\n  - Free: %d (%d)\n\n",
 			   si->prefree_count, si->free_segs, si->free_secs);
 		seq_printf(s, "CP calls: %d\n", si->cp_count);
+		seq_printf(s, "fsync calls: %d (p99 < %u us)\n",
+			   si->fsync_count, si->fsync_p99);
+		seq_printf(s, "  - flushes: %d (merged: %d)\n",
+			   si->flush_count, si->flush_merged);
 		seq_printf(s, "GC calls: %d (BG: %d)\n",
 			   si->call_count, si->bg_gc);
 		seq_printf(s, "  - data segments : %d (%d)\n",
@@ -363,6 +383,7 @@ int f2fs_build_stats(struct f2fs_sb_info *sbi)
 {
 	struct f2fs_super_block *raw_super = F2FS_RAW_SUPER(sbi);
 	struct f2fs_stat_info *si;
+	int i;
 
 	si = kzalloc(sizeof(struct f2fs_stat_info), GFP_KERNEL);
 	if (!si)
@@ -388,6 +409,11 @@ int f2fs_build_stats(struct f2fs_sb_info *sbi)
 	atomic_set(&sbi->inline_inode, 0);
 	atomic_set(&sbi->inline_dir, 0);
 	atomic_set(&sbi->inplace_count, 0);
+	atomic_set(&sbi->fsync_count, 0);
+	atomic_set(&sbi->flush_count, 0);
+	atomic_set(&sbi->flush_merged, 0);
+	for (i = 0; i < F2FS_FSYNC_LAT_SLOTS; i++)
+		atomic_set(&sbi->fsync_lat[i], 0);
 
 	mutex_lock(&f2fs_stat_mutex);
 	list_add_tail(&si->stat_list, &f2fs_stat_list);
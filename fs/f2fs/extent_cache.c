@@ -70,8 +70,12 @@ static struct extent_tree *__grab_extent_tree(struct inode *inode)
 		rwlock_init(&et->lock);
 		atomic_set(&et->refcount, 0);
 		et->count = 0;
+		INIT_LIST_HEAD(&et->list);
 		sbi->total_ext_tree++;
 	}
+	/* the tree outlived its last inode, take it off the lru */
+	if (!atomic_read(&et->refcount))
+		list_del_init(&et->list);
 	atomic_inc(&et->refcount);
 	up_write(&sbi->extent_tree_lock);
 
@@ -549,6 +553,7 @@ static unsigned int f2fs_update_extent_tree_range(struct inode *inode,
 unsigned int f2fs_shrink_extent_tree(struct f2fs_sb_info *sbi, int nr_shrink)
 {
 	struct extent_tree *treevec[EXT_TREE_VEC_SIZE];
+	struct extent_tree *et, *next;
 	struct extent_node *en, *tmp;
 	unsigned long ino = F2FS_ROOT_INO(sbi);
 	struct radix_tree_root *root = &sbi->extent_tree_root;
@@ -562,29 +567,20 @@ unsigned int f2fs_shrink_extent_tree(struct f2fs_sb_info *sbi, int nr_shrink)
 	if (!down_write_trylock(&sbi->extent_tree_lock))
 		goto out;
 
-	/* 1. remove unreferenced extent tree */
-	while ((found = radix_tree_gang_lookup(root,
-				(void **)treevec, ino, EXT_TREE_VEC_SIZE))) {
-		unsigned i;
-
-		ino = treevec[found - 1]->ino + 1;
-		for (i = 0; i < found; i++) {
-			struct extent_tree *et = treevec[i];
-
-			if (!atomic_read(&et->refcount)) {
-				write_lock(&et->lock);
-				node_cnt += __free_extent_tree(sbi, et, true);
-				write_unlock(&et->lock);
+	/* 1. remove unreferenced extent trees, least recently released first */
+	list_for_each_entry_safe(et, next, &sbi->extent_tree_list, list) {
+		write_lock(&et->lock);
+		node_cnt += __free_extent_tree(sbi, et, true);
+		write_unlock(&et->lock);
 
-				radix_tree_delete(root, et->ino);
-				kmem_cache_free(extent_tree_slab, et);
-				sbi->total_ext_tree--;
-				tree_cnt++;
+		list_del(&et->list);
+		radix_tree_delete(root, et->ino);
+		kmem_cache_free(extent_tree_slab, et);
+		sbi->total_ext_tree--;
+		tree_cnt++;
 
-				if (node_cnt + tree_cnt >= nr_shrink)
-					goto unlock_out;
-			}
-		}
+		if (node_cnt + tree_cnt >= nr_shrink)
+			goto unlock_out;
 	}
 	up_write(&sbi->extent_tree_lock);
 
@@ -613,7 +609,7 @@ unsigned int f2fs_shrink_extent_tree(struct f2fs_sb_info *sbi, int nr_shrink)
 
 		ino = treevec[found - 1]->ino + 1;
 		for (i = 0; i < found; i++) {
-			struct extent_tree *et = treevec[i];
+			et = treevec[i];
 
 			write_lock(&et->lock);
 			node_cnt += __free_extent_tree(sbi, et, false);
@@ -657,7 +653,11 @@ void f2fs_destroy_extent_tree(struct inode *inode)
 		return;
 
 	if (inode->i_nlink && !is_bad_inode(inode) && et->count) {
-		atomic_dec(&et->refcount);
+		/* keep it for the next open until the shrinker wants it */
+		down_write(&sbi->extent_tree_lock);
+		if (atomic_dec_and_test(&et->refcount))
+			list_add_tail(&et->list, &sbi->extent_tree_list);
+		up_write(&sbi->extent_tree_lock);
 		return;
 	}
 
@@ -678,6 +678,65 @@ void f2fs_destroy_extent_tree(struct inode *inode)
 	trace_f2fs_destroy_extent_tree(inode, node_cnt);
 }
 
+/*
+ * Reads only look the extent cache up, they never fill it, so a big file
+ * that is only read is mapped through its node pages on every miss. Walk
+ * its dnodes once, reading them ahead, and cache every long run of blocks.
+ */
+void f2fs_preload_extent_tree(struct inode *inode)
+{
+	struct f2fs_inode_info *fi = F2FS_I(inode);
+	struct extent_tree *et = fi->extent_tree;
+	struct dnode_of_data dn;
+	pgoff_t pgofs = 0, end;
+	unsigned int end_offset;
+	pgoff_t fofs = 0;
+	block_t blk = NULL_ADDR;
+	unsigned int len = 0;
+
+	if (!f2fs_may_extent_tree(inode) || !et)
+		return;
+
+	end = DIV_ROUND_UP(i_size_read(inode), F2FS_BLKSIZE);
+	if (end < F2FS_PRELOAD_EXTENT_BLOCKS)
+		return;
+
+	/* a tree kept over eviction, or a file read before, already has them */
+	if (et->count > 1)
+		return;
+
+	while (pgofs < end) {
+		set_new_dnode(&dn, inode, NULL, NULL, 0);
+		if (get_dnode_of_data(&dn, pgofs, LOOKUP_NODE_RA))
+			break;
+
+		end_offset = ADDRS_PER_PAGE(dn.node_page, fi);
+		for (; dn.ofs_in_node < end_offset && pgofs < end;
+					dn.ofs_in_node++, pgofs++) {
+			block_t blkaddr = datablock_addr(dn.node_page,
+							dn.ofs_in_node);
+
+			if (len && blkaddr == blk + len) {
+				len++;
+				continue;
+			}
+			if (len >= F2FS_MIN_EXTENT_LEN)
+				f2fs_update_extent_tree_range(inode, fofs,
+								blk, len);
+			len = 0;
+			if (blkaddr == NULL_ADDR || blkaddr == NEW_ADDR)
+				continue;
+			fofs = pgofs;
+			blk = blkaddr;
+			len = 1;
+		}
+		f2fs_put_dnode(&dn);
+	}
+
+	if (len >= F2FS_MIN_EXTENT_LEN)
+		f2fs_update_extent_tree_range(inode, fofs, blk, len);
+}
+
 bool f2fs_lookup_extent_cache(struct inode *inode, pgoff_t pgofs,
 					struct extent_info *ei)
 {
@@ -721,6 +780,7 @@ void init_extent_cache_info(struct f2fs_sb_info *sbi)
 	INIT_RADIX_TREE(&sbi->extent_tree_root, GFP_NOIO);
 	init_rwsem(&sbi->extent_tree_lock);
 	INIT_LIST_HEAD(&sbi->extent_list);
+	INIT_LIST_HEAD(&sbi->extent_tree_list);
 	spin_lock_init(&sbi->extent_lock);
 	sbi->total_ext_tree = 0;
 	atomic_set(&sbi->total_ext_node, 0);
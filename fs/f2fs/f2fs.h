@@ -54,6 +54,7 @@
 #define F2FS_MOUNT_FASTBOOT		0x00001000
 #define F2FS_MOUNT_EXTENT_CACHE		0x00002000
 #define F2FS_MOUNT_FORCE_FG_GC		0x00004000
+#define F2FS_MOUNT_INLINE_CRYPT		0x00008000
 
 #define clear_opt(sbi, option)	(sbi->mount_opt.opt &= ~F2FS_MOUNT_##option)
 #define set_opt(sbi, option)	(sbi->mount_opt.opt |= F2FS_MOUNT_##option)
@@ -339,6 +340,9 @@ enum {
 /* number of extent info in extent cache we try to shrink */
 #define EXTENT_CACHE_SHRINK_NUMBER	128
 
+/* read-only opens of files this large fill their extent tree up front */
+#define F2FS_PRELOAD_EXTENT_BLOCKS	1024
+
 struct extent_info {
 	unsigned int fofs;		/* start offset in a file */
 	u32 blk;			/* start block address of the extent */
@@ -359,6 +363,7 @@ struct extent_tree {
 	rwlock_t lock;			/* protect extent info rb-tree */
 	atomic_t refcount;		/* reference count of rb-tree */
 	unsigned int count;		/* # of extent node in rb-tree*/
+	struct list_head list;		/* lru of trees without an inode */
 };
 
 /*
@@ -584,6 +589,9 @@ enum {
 	CURSEG_DIRECT_IO,	/* to use for the direct IO path */
 };
 
+/* fsync latency histogram, slot n counts calls below 2^n usec */
+#define F2FS_FSYNC_LAT_SLOTS	24
+
 struct flush_cmd {
 	struct completion wait;
 	struct llist_node llnode;
@@ -751,6 +759,7 @@ struct f2fs_sb_info {
 	struct radix_tree_root extent_tree_root;/* cache extent cache entries */
 	struct rw_semaphore extent_tree_lock;	/* locking extent radix tree */
 	struct list_head extent_list;		/* lru list for shrinker */
+	struct list_head extent_tree_list;	/* lru list of released trees */
 	spinlock_t extent_lock;			/* locking extent lru list */
 	int total_ext_tree;			/* extent tree count */
 	atomic_t total_ext_node;		/* extent info count */
@@ -791,6 +800,13 @@ struct f2fs_sb_info {
 	/* maximum # of trials to find a victim segment for SSR and GC */
 	unsigned int max_victim_search;
 
+	/*
+	 * GC_AT leaves alone the youngest gc_young_ratio percent of the
+	 * sections of every log, and sections younger than gc_min_age secs.
+	 */
+	unsigned int gc_young_ratio;
+	unsigned int gc_min_age;
+
 	/*
 	 * for stat information.
 	 * one is for the LFS mode, and the other is for the SSR mode.
@@ -809,8 +825,12 @@ struct f2fs_sb_info {
 	atomic_t inline_dir;			/* # of inline_dentry inodes */
 	int bg_gc;				/* background gc calls */
 	unsigned int n_dirty_dirs;		/* # of dir inodes */
+	atomic_t fsync_count;			/* # of fsync calls */
+	atomic_t flush_count;			/* # of device flushes */
+	atomic_t flush_merged;			/* # of flushes merged away */
+	atomic_t fsync_lat[F2FS_FSYNC_LAT_SLOTS];	/* log2 usec buckets */
 #endif
-	unsigned int last_victim[2];		/* last victim segment # */
+	unsigned int last_victim[3];		/* last victim seg # per gc_mode */
 	spinlock_t stat_lock;			/* lock for stat operations */
 
 	/* For sysfs suppport */
@@ -1411,6 +1431,7 @@ enum {
 	FI_NEED_IPU,		/* used for ipu per file */
 	FI_ATOMIC_FILE,		/* indicate atomic file */
 	FI_VOLATILE_FILE,	/* indicate volatile file */
+	FI_ATOMIC_COMMIT,	/* atomic pages are being committed */
 	FI_FIRST_BLOCK_WRITTEN,	/* indicate #0 data block was written */
 	FI_DROP_CACHE,		/* drop dirty page cache */
 	FI_DATA_EXIST,		/* indicate data exists */
@@ -1525,6 +1546,11 @@ static inline bool f2fs_is_atomic_file(struct inode *inode)
 	return is_inode_flag_set(F2FS_I(inode), FI_ATOMIC_FILE);
 }
 
+static inline bool f2fs_is_atomic_commit(struct inode *inode)
+{
+	return is_inode_flag_set(F2FS_I(inode), FI_ATOMIC_COMMIT);
+}
+
 static inline bool f2fs_is_volatile_file(struct inode *inode)
 {
 	return is_inode_flag_set(F2FS_I(inode), FI_VOLATILE_FILE);
@@ -1744,7 +1770,8 @@ void ra_node_page(struct f2fs_sb_info *, nid_t);
 struct page *get_node_page(struct f2fs_sb_info *, pgoff_t);
 struct page *get_node_page_ra(struct page *, int);
 void sync_inode_page(struct dnode_of_data *);
-int sync_node_pages(struct f2fs_sb_info *, nid_t, struct writeback_control *);
+int sync_node_pages(struct f2fs_sb_info *, nid_t, struct writeback_control *,
+								bool);
 bool alloc_nid(struct f2fs_sb_info *, nid_t *);
 void alloc_nid_done(struct f2fs_sb_info *, nid_t);
 void alloc_nid_failed(struct f2fs_sb_info *, nid_t);
@@ -1898,6 +1925,8 @@ struct f2fs_stat_info {
 	unsigned int segment_count[2];
 	unsigned int block_count[2];
 	unsigned int inplace_count;
+	int fsync_count, flush_count, flush_merged;
+	unsigned int fsync_p99;
 	unsigned long long base_mem, cache_mem, page_mem;
 };
 
@@ -1951,6 +1980,17 @@ static inline struct f2fs_stat_info *F2FS_STAT(struct f2fs_sb_info *sbi)
 		((sbi)->block_count[(curseg)->alloc_type]++)
 #define stat_inc_inplace_blocks(sbi)					\
 		(atomic_inc(&(sbi)->inplace_count))
+#define stat_inc_fsync_count(sbi, usecs)				\
+	do {								\
+		atomic_inc(&(sbi)->fsync_count);			\
+		atomic_inc(&(sbi)->fsync_lat[min_t(int, fls(usecs),	\
+					F2FS_FSYNC_LAT_SLOTS - 1)]);	\
+	} while (0)
+#define stat_inc_flush_count(sbi, merged)				\
+	do {								\
+		atomic_inc(&(sbi)->flush_count);			\
+		atomic_add(merged, &(sbi)->flush_merged);		\
+	} while (0)
 #define stat_inc_seg_count(sbi, type, gc_type)				\
 	do {								\
 		struct f2fs_stat_info *si = F2FS_STAT(sbi);		\
@@ -2006,6 +2046,8 @@ void f2fs_destroy_root_stats(void);
 #define stat_inc_seg_type(sbi, curseg)
 #define stat_inc_block_count(sbi, curseg)
 #define stat_inc_inplace_blocks(sbi)
+#define stat_inc_fsync_count(sbi, usecs)
+#define stat_inc_flush_count(sbi, merged)
 #define stat_inc_seg_count(sbi, type, gc_type)
 #define stat_inc_tot_blk_count(si, blks)
 #define stat_inc_data_blk_count(sbi, blks, gc_type)
@@ -2070,6 +2112,7 @@ void f2fs_drop_largest_extent(struct inode *, pgoff_t);
 void f2fs_init_extent_tree(struct inode *, struct f2fs_extent *);
 unsigned int f2fs_destroy_extent_node(struct inode *);
 void f2fs_destroy_extent_tree(struct inode *);
+void f2fs_preload_extent_tree(struct inode *);
 bool f2fs_lookup_extent_cache(struct inode *, pgoff_t, struct extent_info *);
 void f2fs_update_extent_cache(struct dnode_of_data *);
 void f2fs_update_extent_cache_range(struct dnode_of_data *dn,
@@ -2106,6 +2149,22 @@ static inline bool f2fs_bio_encrypted(struct bio *bio)
 #endif
 }
 
+/*
+ * The key the storage controller encrypts the contents of @inode with, for
+ * an encrypted regular file on a filesystem mounted with inlinecrypt. NULL
+ * when the contents go through f2fs_encrypt() and f2fs_decrypt() instead.
+ */
+static inline struct blk_crypt_key *f2fs_inode_blk_key(struct inode *inode)
+{
+#if defined(CONFIG_F2FS_FS_ENCRYPTION) && defined(CONFIG_BLK_INLINE_ENCRYPTION)
+	struct f2fs_crypt_info *ci = F2FS_I(inode)->i_crypt_info;
+
+	return ci ? ci->ci_blk_key : NULL;
+#else
+	return NULL;
+#endif
+}
+
 static inline int f2fs_sb_has_crypto(struct super_block *sb)
 {
 #ifdef CONFIG_F2FS_FS_ENCRYPTION
@@ -14,6 +14,7 @@
 #define _F2FS_CRYPTO_H
 
 #include <linux/fs.h>
+#include <linux/blk-crypt.h>
 
 #define F2FS_KEY_DESCRIPTOR_SIZE	8
 
@@ -81,6 +82,10 @@ struct f2fs_crypt_info {
 	struct crypto_ablkcipher *ci_ctfm;
 	struct key	*ci_keyring_key;
 	char		ci_master_key[F2FS_KEY_DESCRIPTOR_SIZE];
+#ifdef CONFIG_BLK_INLINE_ENCRYPTION
+	/* contents key for the storage controller, instead of ci_ctfm */
+	struct blk_crypt_key *ci_blk_key;
+#endif
 };
 
 #define F2FS_CTX_REQUIRES_FREE_ENCRYPT_FL             0x00000001
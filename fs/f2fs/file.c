@@ -101,6 +101,7 @@ out:
 
 static const struct vm_operations_struct f2fs_file_vm_ops = {
 	.fault		= filemap_fault,
+	.map_pages	= filemap_map_pages,
 	.page_mkwrite	= f2fs_vm_page_mkwrite,
 };
 
@@ -133,6 +134,9 @@ static inline bool need_do_checkpoint(struct inode *inode)
 		need_cp = true;
 	else if (file_enc_name(inode) && need_dentry_mark(sbi, inode->i_ino))
 		need_cp = true;
+	else if (f2fs_is_atomic_commit(inode) &&
+			need_dentry_mark(sbi, inode->i_ino))
+		need_cp = true;
 	else if (file_wrong_pino(inode))
 		need_cp = true;
 	else if (!space_for_roll_forward(sbi))
@@ -188,6 +192,7 @@ int f2fs_sync_file(struct file *file, loff_t start, loff_t end, int datasync)
 	nid_t ino = inode->i_ino;
 	int ret = 0;
 	bool need_cp = false;
+	ktime_t start_time;
 	struct writeback_control wbc = {
 		.sync_mode = WB_SYNC_ALL,
 		.nr_to_write = LONG_MAX,
@@ -197,7 +202,12 @@ int f2fs_sync_file(struct file *file, loff_t start, loff_t end, int datasync)
 	if (unlikely(f2fs_readonly(inode->i_sb)))
 		return 0;
 
+	/* volatile data is not kept over a crash, its journal is rebuilt */
+	if (f2fs_is_volatile_file(inode))
+		return 0;
+
 	trace_f2fs_sync_file_enter(inode);
+	start_time = ktime_get();
 
 	/* if fdatasync is triggered, let's do in-place-update */
 	if (get_dirty_pages(inode) <= SM_I(sbi)->min_fsync_blocks)
@@ -257,7 +267,7 @@ go_write:
 		goto out;
 	}
 sync_nodes:
-	sync_node_pages(sbi, ino, &wbc);
+	sync_node_pages(sbi, ino, &wbc, f2fs_is_atomic_commit(inode));
 
 	/* if cp_error was enabled, we should avoid infinite loop */
 	if (unlikely(f2fs_cp_error(sbi)))
@@ -281,6 +291,8 @@ flush_out:
 	clear_inode_flag(fi, FI_UPDATE_WRITE);
 	ret = f2fs_issue_flush(sbi);
 out:
+	stat_inc_fsync_count(sbi, (unsigned int)ktime_us_delta(ktime_get(),
+							start_time));
 	trace_f2fs_sync_file_exit(inode, need_cp, datasync, ret);
 	f2fs_trace_ios(NULL, 1);
 	return ret;
@@ -464,6 +476,9 @@ static int f2fs_file_open(struct inode *inode, struct file *filp)
 		if (ret)
 			ret = -EACCES;
 	}
+
+	if (!ret && S_ISREG(inode->i_mode) && !(filp->f_mode & FMODE_WRITE))
+		f2fs_preload_extent_tree(inode);
 	return ret;
 }
 
@@ -1402,14 +1417,22 @@ static int f2fs_ioc_commit_atomic_write(struct file *filp)
 	if (ret)
 		return ret;
 
-	if (f2fs_is_atomic_file(inode)) {
-		clear_inode_flag(F2FS_I(inode), FI_ATOMIC_FILE);
-		ret = commit_inmem_pages(inode, false);
-		if (ret)
-			goto err_out;
+	if (!f2fs_is_atomic_file(inode)) {
+		ret = f2fs_sync_file(filp, 0, LLONG_MAX, 0);
+		goto err_out;
 	}
 
-	ret = f2fs_sync_file(filp, 0, LLONG_MAX, 0);
+	/*
+	 * The staged pages go out of place as one batch, then a single node
+	 * flush puts the fsync mark on the last dnode only. Until that dnode
+	 * is on disk, roll forward recovery keeps the old data.
+	 */
+	set_inode_flag(F2FS_I(inode), FI_ATOMIC_COMMIT);
+	clear_inode_flag(F2FS_I(inode), FI_ATOMIC_FILE);
+	ret = commit_inmem_pages(inode, false);
+	if (!ret)
+		ret = f2fs_sync_file(filp, 0, LLONG_MAX, 0);
+	clear_inode_flag(F2FS_I(inode), FI_ATOMIC_COMMIT);
 err_out:
 	mnt_drop_write_file(filp);
 	return ret;
@@ -48,13 +48,20 @@ static int gc_thread_func(void *data)
 			continue;
 		}
 
+		if (gc_th->gc_urgent) {
+			wait_ms = gc_th->urgent_sleep_time;
+			mutex_lock(&sbi->gc_mutex);
+			goto do_gc;
+		}
+
 		/*
 		 * [GC triggering condition]
 		 * 0. GC is not conducted currently.
 		 * 1. There are enough dirty segments.
 		 * 2. IO subsystem is idle by checking the # of writeback pages.
 		 * 3. IO subsystem is idle by checking the # of requests in
-		 *    bdev's request list.
+		 *    bdev's request list, and no foreground I/O was submitted
+		 *    for idle_interval.
 		 *
 		 * Note) We have to avoid triggering GCs frequently.
 		 * Because it is possible that some segments can be
@@ -74,11 +81,15 @@ static int gc_thread_func(void *data)
 			decrease_sleep_time(gc_th, &wait_ms);
 		else
 			increase_sleep_time(gc_th, &wait_ms);
-
+do_gc:
 		stat_inc_bggc_count(sbi);
 
+		gc_th->fg_io_count = blk_queue_fg_io_count(
+					bdev_get_queue(sbi->sb->s_bdev));
+
 		/* if return value is not zero, no victim was selected */
-		if (f2fs_gc(sbi, test_opt(sbi, FORCE_FG_GC)))
+		if (f2fs_gc(sbi, test_opt(sbi, FORCE_FG_GC)) &&
+				!gc_th->gc_urgent)
 			wait_ms = gc_th->no_gc_sleep_time;
 
 		trace_f2fs_background_gc(sbi->sb, wait_ms,
@@ -108,6 +119,10 @@ int start_gc_thread(struct f2fs_sb_info *sbi)
 	gc_th->no_gc_sleep_time = DEF_GC_THREAD_NOGC_SLEEP_TIME;
 
 	gc_th->gc_idle = 0;
+	gc_th->gc_urgent = 0;
+	gc_th->urgent_sleep_time = DEF_GC_THREAD_URGENT_SLEEP_TIME;
+	gc_th->idle_interval = DEF_GC_THREAD_IDLE_INTERVAL;
+	gc_th->fg_io_count = 0;
 
 	sbi->gc_thread = gc_th;
 	init_waitqueue_head(&sbi->gc_thread->gc_wait_queue_head);
@@ -134,13 +149,15 @@ void stop_gc_thread(struct f2fs_sb_info *sbi)
 
 static int select_gc_type(struct f2fs_gc_kthread *gc_th, int gc_type)
 {
-	int gc_mode = (gc_type == BG_GC) ? GC_CB : GC_GREEDY;
+	int gc_mode = (gc_type == BG_GC) ? GC_AT : GC_GREEDY;
 
 	if (gc_th && gc_th->gc_idle) {
 		if (gc_th->gc_idle == 1)
 			gc_mode = GC_CB;
 		else if (gc_th->gc_idle == 2)
 			gc_mode = GC_GREEDY;
+		else if (gc_th->gc_idle == 3)
+			gc_mode = GC_AT;
 	}
 	return gc_mode;
 }
@@ -176,7 +193,7 @@ static unsigned int get_max_cost(struct f2fs_sb_info *sbi,
 		return 1 << sbi->log_blocks_per_seg;
 	if (p->gc_mode == GC_GREEDY)
 		return (1 << sbi->log_blocks_per_seg) * p->ofs_unit;
-	else if (p->gc_mode == GC_CB)
+	else if (p->gc_mode == GC_CB || p->gc_mode == GC_AT)
 		return UINT_MAX;
 	else /* No other gc_mode */
 		return 0;
@@ -233,6 +250,70 @@ static unsigned int get_cb_cost(struct f2fs_sb_info *sbi, unsigned int segno)
 	return UINT_MAX - ((100 * (100 - u) * age) / (100 + u));
 }
 
+static unsigned int age_bucket(unsigned long long age)
+{
+	return min_t(unsigned int, fls64(age), GC_AGE_BUCKETS - 1);
+}
+
+/*
+ * Account the age of a section in the histogram of its log, and tell if it
+ * is old enough to be a GC_AT victim.
+ */
+static bool check_section_age(struct f2fs_sb_info *sbi, unsigned int segno)
+{
+	struct sit_info *sit_i = SIT_I(sbi);
+	unsigned int start = GET_SECNO(sbi, segno) * sbi->segs_per_sec;
+	unsigned int type = get_seg_entry(sbi, start)->type;
+	unsigned long long mtime = 0, now = get_mtime(sbi), age = 0;
+	unsigned int i;
+
+	if (type >= NR_CURSEG_TYPE)
+		return true;
+
+	for (i = 0; i < sbi->segs_per_sec; i++)
+		mtime += get_seg_entry(sbi, start + i)->mtime;
+	mtime = div_u64(mtime, sbi->segs_per_sec);
+	if (now > mtime)
+		age = now - mtime;
+
+	sit_i->age_hist[type][age_bucket(age)]++;
+	return age >= sit_i->age_threshold[type];
+}
+
+/*
+ * Once a search is over, move the threshold of every log to the age below
+ * which its youngest gc_young_ratio percent of sections were, and start
+ * the histograms over for the next search.
+ */
+static void update_age_threshold(struct f2fs_sb_info *sbi)
+{
+	struct sit_info *sit_i = SIT_I(sbi);
+	unsigned int type, i;
+
+	for (type = 0; type < NR_CURSEG_TYPE; type++) {
+		unsigned int *hist = sit_i->age_hist[type];
+		unsigned long long threshold = 0;
+		unsigned int total = 0, young = 0;
+
+		for (i = 0; i < GC_AGE_BUCKETS; i++)
+			total += hist[i];
+		if (!total)
+			continue;
+
+		for (i = 0; i < GC_AGE_BUCKETS; i++) {
+			young += hist[i];
+			if (young * 100ULL > (u64)total * sbi->gc_young_ratio)
+				break;
+		}
+		if (i && i < GC_AGE_BUCKETS)
+			threshold = 1ULL << (i - 1);
+
+		sit_i->age_threshold[type] = max_t(unsigned long long,
+						threshold, sbi->gc_min_age);
+		memset(hist, 0, sizeof(sit_i->age_hist[type]));
+	}
+}
+
 static inline unsigned int get_gc_cost(struct f2fs_sb_info *sbi,
 			unsigned int segno, struct victim_sel_policy *p)
 {
@@ -270,6 +351,8 @@ static int get_victim_by_default(struct f2fs_sb_info *sbi,
 
 	p.min_segno = NULL_SEGNO;
 	p.min_cost = max_cost = get_max_cost(sbi, &p);
+	p.young_segno = NULL_SEGNO;
+	p.young_cost = max_cost;
 
 	if (p.max_search == 0)
 		goto out;
@@ -308,7 +391,13 @@ static int get_victim_by_default(struct f2fs_sb_info *sbi,
 
 		cost = get_gc_cost(sbi, segno, &p);
 
-		if (p.min_cost > cost) {
+		if (p.gc_mode == GC_AT && !check_section_age(sbi, segno)) {
+			/* too young, taken only if nothing is old enough */
+			if (p.young_cost > cost) {
+				p.young_segno = segno;
+				p.young_cost = cost;
+			}
+		} else if (p.min_cost > cost) {
 			p.min_segno = segno;
 			p.min_cost = cost;
 		} else if (unlikely(cost == max_cost)) {
@@ -320,6 +409,13 @@ static int get_victim_by_default(struct f2fs_sb_info *sbi,
 			break;
 		}
 	}
+	if (p.gc_mode == GC_AT) {
+		update_age_threshold(sbi);
+		if (p.min_segno == NULL_SEGNO) {
+			p.min_segno = p.young_segno;
+			p.min_cost = p.young_cost;
+		}
+	}
 	if (p.min_segno != NULL_SEGNO) {
 got_it:
 		if (p.alloc_mode == LFS) {
@@ -422,6 +518,10 @@ next_step:
 		if (gc_type == BG_GC && has_not_enough_free_secs(sbi, 0))
 			return 0;
 
+		/* stop BG_GC at once if foreground I/O shows up */
+		if (gc_preempted(sbi, gc_type))
+			return 0;
+
 		if (check_valid_map(sbi, segno, off) == 0)
 			continue;
 
@@ -468,7 +568,7 @@ next_step:
 			.nr_to_write = LONG_MAX,
 			.for_reclaim = 0,
 		};
-		sync_node_pages(sbi, 0, &wbc);
+		sync_node_pages(sbi, 0, &wbc, false);
 
 		/* return 1 only if FG_GC succefully reclaimed one */
 		if (get_valid_blocks(sbi, segno, 1) == 0)
@@ -687,6 +787,10 @@ next_step:
 		if (gc_type == BG_GC && has_not_enough_free_secs(sbi, 0))
 			return 0;
 
+		/* stop BG_GC at once if foreground I/O shows up */
+		if (gc_preempted(sbi, gc_type))
+			return 0;
+
 		if (check_valid_map(sbi, segno, off) == 0)
 			continue;
 
@@ -856,6 +960,8 @@ gc_more:
 		if (!do_garbage_collect(sbi, segno + i, &gc_list, gc_type) &&
 				gc_type == FG_GC)
 			break;
+		if (gc_preempted(sbi, gc_type))
+			break;
 	}
 
 	if (i == sbi->segs_per_sec && gc_type == FG_GC)
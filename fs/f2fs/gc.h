@@ -16,12 +16,18 @@
 #define DEF_GC_THREAD_MIN_SLEEP_TIME	30000	/* milliseconds */
 #define DEF_GC_THREAD_MAX_SLEEP_TIME	60000
 #define DEF_GC_THREAD_NOGC_SLEEP_TIME	300000	/* wait 5 min */
+#define DEF_GC_THREAD_URGENT_SLEEP_TIME	500
+#define DEF_GC_THREAD_IDLE_INTERVAL	1000	/* no foreground I/O for 1s */
 #define LIMIT_INVALID_BLOCK	40 /* percentage over total user space */
 #define LIMIT_FREE_BLOCK	40 /* percentage over invalid + free space */
 
 /* Search max. number of dirty segments to select a victim segment */
 #define DEF_MAX_VICTIM_SEARCH 4096 /* covers 8GB */
 
+/* defaults for the age threshold of GC_AT */
+#define DEF_GC_YOUNG_RATIO	40	/* percentage of sections of a log */
+#define DEF_GC_MIN_AGE		600	/* seconds */
+
 struct f2fs_gc_kthread {
 	struct task_struct *f2fs_gc_task;
 	wait_queue_head_t gc_wait_queue_head;
@@ -33,6 +39,17 @@ struct f2fs_gc_kthread {
 
 	/* for changing gc mode */
 	unsigned int gc_idle;
+
+	/*
+	 * gc_urgent is set from userspace (screen off and charging), GC then
+	 * runs every urgent_sleep_time regardless of foreground I/O.
+	 */
+	unsigned int gc_urgent;
+	unsigned int urgent_sleep_time;
+
+	/* the device counts as idle after idle_interval ms of no fg I/O */
+	unsigned int idle_interval;
+	unsigned long fg_io_count;	/* when the current round started */
 };
 
 struct gc_inode_list {
@@ -106,5 +123,23 @@ static inline int is_idle(struct f2fs_sb_info *sbi)
 	struct block_device *bdev = sbi->sb->s_bdev;
 	struct request_queue *q = bdev_get_queue(bdev);
 	struct request_list *rl = &q->root_rl;
-	return !(rl->count[BLK_RW_SYNC]) && !(rl->count[BLK_RW_ASYNC]);
+
+	if (rl->count[BLK_RW_SYNC] || rl->count[BLK_RW_ASYNC])
+		return 0;
+	return blk_queue_fg_idle(q, sbi->gc_thread->idle_interval);
+}
+
+/*
+ * Background GC of the gc thread gives way as soon as a foreground bio
+ * was submitted since its round started, unless in urgent mode.
+ */
+static inline bool gc_preempted(struct f2fs_sb_info *sbi, int gc_type)
+{
+	struct f2fs_gc_kthread *gc_th = sbi->gc_thread;
+
+	if (gc_type != BG_GC || !gc_th || gc_th->gc_urgent ||
+			current != gc_th->f2fs_gc_task)
+		return false;
+	return blk_queue_fg_io_count(bdev_get_queue(sbi->sb->s_bdev)) !=
+							gc_th->fg_io_count;
 }
@@ -1152,13 +1152,36 @@ void sync_inode_page(struct dnode_of_data *dn)
 	}
 }
 
+static int write_last_dnode(struct f2fs_sb_info *sbi, nid_t ino,
+			struct page *page, struct writeback_control *wbc,
+			bool last)
+{
+	int wrote = 0;
+
+	set_fsync_mark(page, last);
+	set_dentry_mark(page, last && IS_INODE(page) &&
+					need_dentry_mark(sbi, ino));
+
+	if (NODE_MAPPING(sbi)->a_ops->writepage(page, wbc))
+		unlock_page(page);
+	else
+		wrote++;
+	f2fs_put_page(page, 0);
+	return wrote;
+}
+
+/*
+ * If @atomic, only the last dnode of @ino gets the fsync mark, so roll
+ * forward recovery finds either all the dnodes of an atomic commit or none.
+ */
 int sync_node_pages(struct f2fs_sb_info *sbi, nid_t ino,
-					struct writeback_control *wbc)
+				struct writeback_control *wbc, bool atomic)
 {
 	pgoff_t index, end;
 	struct pagevec pvec;
 	int step = ino ? 2 : 0;
 	int nwritten = 0, wrote = 0;
+	struct page *last_page = NULL;
 
 	pagevec_init(&pvec, 0);
 
@@ -1217,6 +1240,18 @@ continue_unlock:
 			if (!clear_page_dirty_for_io(page))
 				goto continue_unlock;
 
+			/* hold each dnode back until the next one shows up */
+			if (atomic && ino && IS_DNODE(page)) {
+				get_page(page);
+				swap(page, last_page);
+				if (page) {
+					wrote += write_last_dnode(sbi, ino,
+							page, wbc, false);
+					nwritten++;
+				}
+				continue;
+			}
+
 			/* called by fsync() */
 			if (ino && IS_DNODE(page)) {
 				set_fsync_mark(page, 1);
@@ -1251,6 +1286,11 @@ continue_unlock:
 		goto next_step;
 	}
 
+	if (last_page) {
+		wrote += write_last_dnode(sbi, ino, last_page, wbc, true);
+		nwritten++;
+	}
+
 	if (wrote)
 		f2fs_submit_merged_bio(sbi, NODE, WRITE);
 	return nwritten;
@@ -1378,7 +1418,7 @@ static int f2fs_write_node_pages(struct address_space *mapping,
 
 	diff = nr_pages_to_write(sbi, NODE, wbc);
 	wbc->sync_mode = WB_SYNC_NONE;
-	sync_node_pages(sbi, 0, wbc);
+	sync_node_pages(sbi, 0, wbc, false);
 	wbc->nr_to_write = max((long)0, wbc->nr_to_write - diff);
 	return 0;
 
@@ -43,6 +43,14 @@
  * 8. CP | dnode(F) | inode(x)
  * -> If f2fs_iget fails, then goto next to find inode(DF).
  *    But it will fail due to no inode(DF).
+ *
+ * An atomic commit marks only its last dnode:
+ *
+ * 9. CP | dnode(x) | inode(x) | dnode(F)
+ * -> Recover all of them, the commit is complete.
+ *
+ * 10. CP | dnode(F) | dnode(x) | inode(x)
+ * -> Recover up to dnode(F) only, the torn commit after it is dropped.
  */
 
 static struct kmem_cache *fsync_entry_slab;
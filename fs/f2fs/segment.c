@@ -384,7 +384,7 @@ repeat:
 	if (!llist_empty(&fcc->issue_list)) {
 		struct bio *bio;
 		struct flush_cmd *cmd, *next;
-		int ret;
+		int ret, nr = 0;
 
 		bio = f2fs_bio_alloc(0);
 
@@ -398,8 +398,10 @@ repeat:
 					  fcc->dispatch_list, llnode) {
 			cmd->ret = ret;
 			complete(&cmd->wait);
+			nr++;
 		}
 		bio_put(bio);
+		stat_inc_flush_count(sbi, nr - 1);
 		fcc->dispatch_list = NULL;
 	}
 
@@ -426,6 +428,7 @@ int f2fs_issue_flush(struct f2fs_sb_info *sbi)
 		bio->bi_bdev = sbi->sb->s_bdev;
 		ret = submit_bio_wait(WRITE_FLUSH, bio);
 		bio_put(bio);
+		stat_inc_flush_count(sbi, 0);
 		return ret;
 	}
 
@@ -761,9 +764,22 @@ static void update_sit_entry(struct f2fs_sb_info *sbi, block_t blkaddr, int del)
 	f2fs_bug_on(sbi, (new_vblocks >> (sizeof(unsigned short) << 3) ||
 				(new_vblocks > sbi->blocks_per_seg)));
 
+	/*
+	 * mtime averages the write times of the valid blocks, so a section
+	 * holding old data doesn't look fresh because of a few invalidations
+	 * or one new block.
+	 */
+	if (del > 0) {
+		unsigned long long mtime = get_mtime(sbi);
+
+		if (se->valid_blocks)
+			se->mtime = div_u64(se->mtime * se->valid_blocks + mtime,
+						se->valid_blocks + 1);
+		else
+			se->mtime = mtime;
+		SIT_I(sbi)->max_mtime = mtime;
+	}
 	se->valid_blocks = new_vblocks;
-	se->mtime = get_mtime(sbi);
-	SIT_I(sbi)->max_mtime = se->mtime;
 
 	/* Update valid block bitmap */
 	if (del > 0) {
@@ -124,13 +124,16 @@ enum {
 };
 
 /*
- * In the victim_sel_policy->gc_mode, there are two gc, aka cleaning, modes.
+ * In the victim_sel_policy->gc_mode, there are three gc, aka cleaning, modes.
  * GC_CB is based on cost-benefit algorithm.
  * GC_GREEDY is based on greedy algorithm.
+ * GC_AT is cost-benefit over the sections older than the age threshold of
+ * their log only, so fresh data that is about to be invalidated stays put.
  */
 enum {
 	GC_CB = 0,
-	GC_GREEDY
+	GC_GREEDY,
+	GC_AT,
 };
 
 /*
@@ -154,8 +157,12 @@ struct victim_sel_policy {
 	unsigned int ofs_unit;		/* bitmap search unit */
 	unsigned int min_cost;		/* minimum cost */
 	unsigned int min_segno;		/* segment # having min. cost */
+	unsigned int young_cost;	/* GC_AT: min. cost under the threshold */
+	unsigned int young_segno;	/* GC_AT: segment # having young_cost */
 };
 
+#define GC_AGE_BUCKETS	32
+
 struct seg_entry {
 	unsigned short valid_blocks;	/* # of valid blocks */
 	unsigned char *cur_valid_map;	/* validity bitmap of blocks */
@@ -167,7 +174,7 @@ struct seg_entry {
 	unsigned char *ckpt_valid_map;
 	unsigned char *discard_map;
 	unsigned char type;		/* segment type like CURSEG_XXX_TYPE */
-	unsigned long long mtime;	/* modification time of the segment */
+	unsigned long long mtime;	/* avg. write time of its valid blocks */
 };
 
 struct sec_entry {
@@ -214,6 +221,13 @@ struct sit_info {
 	unsigned long long mounted_time;	/* mount time */
 	unsigned long long min_mtime;		/* min. modification time */
 	unsigned long long max_mtime;		/* max. modification time */
+
+	/*
+	 * for age threshold GC, the ages of the sections seen by the last
+	 * victim searches, one log2(seconds) histogram for every log.
+	 */
+	unsigned int age_hist[NR_CURSEG_TYPE][GC_AGE_BUCKETS];
+	unsigned long long age_threshold[NR_CURSEG_TYPE];
 };
 
 struct free_segmap_info {
@@ -523,7 +537,8 @@ static inline bool need_inplace_update(struct inode *inode)
 	unsigned int policy = SM_I(sbi)->ipu_policy;
 
 	/* IPU can be done only for the user data */
-	if (S_ISDIR(inode->i_mode) || f2fs_is_atomic_file(inode))
+	if (S_ISDIR(inode->i_mode) || f2fs_is_atomic_file(inode) ||
+					f2fs_is_atomic_commit(inode))
 		return false;
 
 	if (policy & (0x1 << F2FS_IPU_FORCE))
@@ -23,6 +23,7 @@
 #include <linux/errno.h>
 #include <linux/slab.h>
 #include <linux/blkdev.h>
+#include <linux/workqueue.h>
 #include <trace/events/jbd2.h>
 
 /*
@@ -175,6 +176,58 @@ void __jbd2_log_wait_for_space(journal_t *journal)
 	}
 }
 
+#ifdef CONFIG_JBD2_BG_CHECKPOINT
+/*
+ * Background checkpointing: keep twice the space a new transaction
+ * needs free, so that __jbd2_log_wait_for_space() rarely has to
+ * checkpoint in the context of a task starting a handle.
+ */
+static int jbd2_bg_checkpoint_needed(journal_t *journal)
+{
+	int ret;
+
+	if (is_journal_aborted(journal))
+		return 0;
+
+	read_lock(&journal->j_state_lock);
+	ret = __jbd2_log_space_left(journal) < 2 * jbd_space_needed(journal);
+	read_unlock(&journal->j_state_lock);
+	return ret;
+}
+
+void jbd2_log_bg_checkpoint_work(struct work_struct *work)
+{
+	journal_t *journal = container_of(work, journal_t, j_checkpoint_work);
+	int chkpt;
+
+	mutex_lock(&journal->j_checkpoint_mutex);
+	while (jbd2_bg_checkpoint_needed(journal)) {
+		spin_lock(&journal->j_list_lock);
+		chkpt = journal->j_checkpoint_transactions != NULL;
+		spin_unlock(&journal->j_list_lock);
+		if (!chkpt) {
+			jbd2_cleanup_journal_tail(journal);
+			break;
+		}
+		if (jbd2_log_do_checkpoint(journal) < 0)
+			break;
+		cond_resched();
+	}
+	mutex_unlock(&journal->j_checkpoint_mutex);
+}
+
+/*
+ * Called by the commit thread after each commit.  Never blocks; a
+ * foreground task short of space still checkpoints itself, after the
+ * worker drops j_checkpoint_mutex.
+ */
+void jbd2_log_start_bg_checkpoint(journal_t *journal)
+{
+	if (jbd2_bg_checkpoint_needed(journal))
+		queue_work(system_unbound_wq, &journal->j_checkpoint_work);
+}
+#endif /* CONFIG_JBD2_BG_CHECKPOINT */
+
 /*
  * Clean up transaction's list of buffers submitted for io.
  * We wait for any pending IO to complete and remove any clean
@@ -202,6 +202,7 @@ loop:
 		write_unlock(&journal->j_state_lock);
 		del_timer_sync(&journal->j_commit_timer);
 		jbd2_journal_commit_transaction(journal);
+		jbd2_log_start_bg_checkpoint(journal);
 		write_lock(&journal->j_state_lock);
 		goto loop;
 	}
@@ -1076,6 +1077,9 @@ static journal_t * journal_init_common (void)
 	init_waitqueue_head(&journal->j_wait_updates);
 	mutex_init(&journal->j_barrier);
 	mutex_init(&journal->j_checkpoint_mutex);
+#ifdef CONFIG_JBD2_BG_CHECKPOINT
+	INIT_WORK(&journal->j_checkpoint_work, jbd2_log_bg_checkpoint_work);
+#endif
 	spin_lock_init(&journal->j_revoke_lock);
 	spin_lock_init(&journal->j_list_lock);
 	rwlock_init(&journal->j_state_lock);
@@ -1673,6 +1677,9 @@ int jbd2_journal_destroy(journal_t *journal)
 
 	/* Wait for the commit thread to wake up and die. */
 	journal_kill_thread(journal);
+#ifdef CONFIG_JBD2_BG_CHECKPOINT
+	cancel_work_sync(&journal->j_checkpoint_work);
+#endif
 
 	/* Force a final log commit */
 	if (journal->j_running_transaction)
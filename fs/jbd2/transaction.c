@@ -1452,10 +1452,15 @@ int jbd2_journal_stop(handle_t *handle)
 	 * case where a single process is doing a stream of sync
 	 * writes.  No point in waiting for joiners in that case.
 	 *
+	 * Nor when this is the only handle open against the transaction:
+	 * with no other updates in flight there is nobody to batch with,
+	 * and the wait only adds to the latency of this fsync.
+	 *
 	 * Setting max_batch_time to 0 disables this completely.
 	 */
 	pid = current->pid;
 	if (handle->h_sync && journal->j_last_sync_writer != pid &&
+	    atomic_read(&transaction->t_updates) > 1 &&
 	    journal->j_max_batch_time) {
 		u64 commit_time, trans_time;
 
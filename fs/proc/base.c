@@ -1006,6 +1006,8 @@ err_sighand:
 	unlock_task_sighand(task, &flags);
 err_task_lock:
 	task_unlock(task);
+	if (!err)
+		lmk_adj_index_update(task);
 	put_task_struct(task);
 out:
 	return err < 0 ? err : count;
@@ -1098,6 +1100,8 @@ err_sighand:
 	unlock_task_sighand(task, &flags);
 err_task_lock:
 	task_unlock(task);
+	if (!err)
+		lmk_adj_index_update(task);
 	put_task_struct(task);
 out:
 	return err < 0 ? err : count;
@@ -2683,6 +2687,60 @@ static int proc_tgid_io_accounting(struct task_struct *task, char *buffer)
 }
 #endif /* CONFIG_TASK_IO_ACCOUNTING */
 
+#ifdef CONFIG_TASK_PMU_ACCOUNTING
+static int do_pmu_accounting(struct task_struct *task, char *buffer, int whole)
+{
+	struct task_pmu_accounting acct = task->pmuac;
+	unsigned long flags;
+	int result;
+
+	result = mutex_lock_killable(&task->signal->cred_guard_mutex);
+	if (result)
+		return result;
+
+	if (!ptrace_may_access(task, PTRACE_MODE_READ_FSCREDS)) {
+		result = -EACCES;
+		goto out_unlock;
+	}
+
+	if (whole && lock_task_sighand(task, &flags)) {
+		struct task_struct *t = task;
+
+		task_pmu_accounting_add(&acct, &task->signal->pmuac);
+		while_each_thread(task, t)
+			task_pmu_accounting_add(&acct, &t->pmuac);
+
+		unlock_task_sighand(task, &flags);
+	}
+	result = sprintf(buffer,
+			"cycles: %llu %llu\n"
+			"instructions: %llu %llu\n"
+			"l2_refills: %llu %llu\n"
+			"sampled_ns: %llu %llu\n",
+			(unsigned long long)acct.cycles[0],
+			(unsigned long long)acct.cycles[1],
+			(unsigned long long)acct.instructions[0],
+			(unsigned long long)acct.instructions[1],
+			(unsigned long long)acct.l2_refills[0],
+			(unsigned long long)acct.l2_refills[1],
+			(unsigned long long)acct.sampled_ns[0],
+			(unsigned long long)acct.sampled_ns[1]);
+out_unlock:
+	mutex_unlock(&task->signal->cred_guard_mutex);
+	return result;
+}
+
+static int proc_tid_pmu_accounting(struct task_struct *task, char *buffer)
+{
+	return do_pmu_accounting(task, buffer, 0);
+}
+
+static int proc_tgid_pmu_accounting(struct task_struct *task, char *buffer)
+{
+	return do_pmu_accounting(task, buffer, 1);
+}
+#endif /* CONFIG_TASK_PMU_ACCOUNTING */
+
 #ifdef CONFIG_USER_NS
 static int proc_id_map_open(struct inode *inode, struct file *file,
 	struct seq_operations *seq_ops)
@@ -2923,6 +2981,9 @@ static const struct pid_entry tgid_base_stuff[] = {
 #ifdef CONFIG_TASK_IO_ACCOUNTING
 	INF("io",	S_IRUSR, proc_tgid_io_accounting),
 #endif
+#ifdef CONFIG_TASK_PMU_ACCOUNTING
+	INF("pmu",	S_IRUSR, proc_tgid_pmu_accounting),
+#endif
 #ifdef CONFIG_HARDWALL
 	INF("hardwall",   S_IRUGO, proc_pid_hardwall),
 #endif
@@ -3280,6 +3341,9 @@ static const struct pid_entry tid_base_stuff[] = {
 #ifdef CONFIG_TASK_IO_ACCOUNTING
 	INF("io",	S_IRUSR, proc_tid_io_accounting),
 #endif
+#ifdef CONFIG_TASK_PMU_ACCOUNTING
+	INF("pmu",	S_IRUSR, proc_tid_pmu_accounting),
+#endif
 #ifdef CONFIG_HARDWALL
 	INF("hardwall",   S_IRUGO, proc_pid_hardwall),
 #endif
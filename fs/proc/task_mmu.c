@@ -12,6 +12,7 @@
 #include <linux/swap.h>
 #include <linux/swapops.h>
 #include <linux/mm_inline.h>
+#include <linux/ctype.h>
 
 #include <asm/elf.h>
 #include <asm/uaccess.h>
@@ -1232,6 +1233,10 @@ cont:
 		if (!page)
 			continue;
 
+		/* leave pages shared with other processes to global reclaim */
+		if (page_mapcount(page) != 1)
+			continue;
+
 		if (isolate_lru_page(page))
 			continue;
 
@@ -1244,7 +1249,7 @@ cont:
 	}
 	pte_unmap_unlock(pte - 1, ptl);
 	reclaim_pages_from_list(&page_list);
-	if (addr != end)
+	if (addr != end && !fatal_signal_pending(current))
 		goto cont;
 
 	cond_resched();
@@ -1262,11 +1267,13 @@ static ssize_t reclaim_write(struct file *file, const char __user *buf,
 				size_t count, loff_t *ppos)
 {
 	struct task_struct *task;
-	char buffer[PROC_NUMBUF];
+	char buffer[64];
 	struct mm_struct *mm;
 	struct vm_area_struct *vma;
 	enum reclaim_type type;
-	char *type_buf;
+	char *type_buf, *token;
+	unsigned long long tmp, len;
+	unsigned long start = 0, end = 0;
 
 	memset(buffer, 0, sizeof(buffer));
 	if (count > sizeof(buffer) - 1)
@@ -1282,9 +1289,28 @@ static ssize_t reclaim_write(struct file *file, const char __user *buf,
 		type = RECLAIM_ANON;
 	else if (!strcmp(type_buf, "all"))
 		type = RECLAIM_ALL;
+	else if (isdigit(*type_buf))
+		type = RECLAIM_RANGE;
 	else
 		return -EINVAL;
 
+	if (type == RECLAIM_RANGE) {
+		/* "<start> <length>", page aligned start */
+		token = strsep(&type_buf, " ");
+		if (!token || !type_buf)
+			return -EINVAL;
+		tmp = memparse(token, &token);
+		if (tmp & ~PAGE_MASK || tmp > ULONG_MAX)
+			return -EINVAL;
+		start = tmp;
+
+		tmp = memparse(skip_spaces(type_buf), &token);
+		len = PAGE_ALIGN(tmp);
+		if (!len || len > ULONG_MAX || start + len < start)
+			return -EINVAL;
+		end = start + len;
+	}
+
 	task = get_proc_task(file->f_path.dentry->d_inode);
 	if (!task)
 		return -ESRCH;
@@ -1297,9 +1323,15 @@ static ssize_t reclaim_write(struct file *file, const char __user *buf,
 		};
 
 		down_read(&mm->mmap_sem);
-		for (vma = mm->mmap; vma; vma = vma->vm_next) {
+		vma = type == RECLAIM_RANGE ? find_vma(mm, start) : mm->mmap;
+		for (; vma; vma = vma->vm_next) {
 			reclaim_walk.private = vma;
 
+			if (type == RECLAIM_RANGE && vma->vm_start >= end)
+				break;
+			if (fatal_signal_pending(current))
+				break;
+
 			if (is_vm_hugetlb_page(vma))
 				continue;
 
@@ -1308,8 +1340,13 @@ static ssize_t reclaim_write(struct file *file, const char __user *buf,
 			if (type == RECLAIM_FILE && !vma->vm_file)
 				continue;
 
-			walk_page_range(vma->vm_start, vma->vm_end,
-					&reclaim_walk);
+			if (type == RECLAIM_RANGE)
+				walk_page_range(max(vma->vm_start, start),
+						min(vma->vm_end, end),
+						&reclaim_walk);
+			else
+				walk_page_range(vma->vm_start, vma->vm_end,
+						&reclaim_walk);
 		}
 		flush_tlb_mm(mm);
 		up_read(&mm->mmap_sem);
@@ -112,6 +112,9 @@ static int sdcardfs_d_revalidate(struct dentry *dentry, unsigned int flags)
 		}
 		if (data)
 			data_put(data);
+		/* the packagelist changed since we derived, do it again */
+		if (err && !derived_perm_fresh(dentry))
+			update_derived_permission_lock(dentry);
 		iput(inode);
 	}
 
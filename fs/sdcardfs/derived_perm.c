@@ -75,6 +75,7 @@ void get_derived_permission_new(struct dentry *parent, struct dentry *dentry,
 	 * of using the inode permissions.
 	 */
 
+	SDCARDFS_D(dentry)->perm_gen = atomic_read(&packagelist_gen);
 	inherit_derived_state(parent->d_inode, dentry->d_inode);
 
 	/* Files don't get special labels */
@@ -332,10 +333,9 @@ inline void update_derived_permission_lock(struct dentry *dentry)
 		return;
 	}
 	/* FIXME:
-	 * 1. need to check whether the dentry is updated or not
-	 * 2. remove the root dentry update
+	 * 1. remove the root dentry update
 	 */
-	if (!IS_ROOT(dentry)) {
+	if (!IS_ROOT(dentry) && !derived_perm_fresh(dentry)) {
 		parent = dget_parent(dentry);
 		if (parent) {
 			get_derived_permission(parent, dentry);
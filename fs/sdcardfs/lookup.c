@@ -446,9 +446,11 @@ struct dentry *sdcardfs_lookup(struct inode *dir, struct dentry *dentry,
 	if (dentry->d_inode) {
 		fsstack_copy_attr_times(dentry->d_inode,
 					sdcardfs_lower_inode(dentry->d_inode));
-		/* get derived permission */
-		get_derived_permission(parent, dentry);
-		fixup_tmp_permissions(dentry->d_inode);
+		/* get derived permission, unless interpose just did */
+		if (!derived_perm_fresh(dentry)) {
+			get_derived_permission(parent, dentry);
+			fixup_tmp_permissions(dentry->d_inode);
+		}
 		fixup_lower_ownership(dentry, dentry->d_name.name);
 	}
 	/* update parent directory's atime */
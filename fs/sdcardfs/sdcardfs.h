@@ -212,6 +212,8 @@ struct sdcardfs_dentry_info {
 	spinlock_t lock;	/* protects lower_path */
 	struct path lower_path;
 	struct path orig_path;
+	/* packagelist generation the derived permission was computed at */
+	unsigned int perm_gen;
 };
 
 struct sdcardfs_mount_options {
@@ -517,6 +519,14 @@ extern appid_t is_excluded(const char *app_name, userid_t userid);
 extern int check_caller_access_to_name(struct inode *parent_node, const struct qstr *name);
 extern int packagelist_init(void);
 extern void packagelist_exit(void);
+extern atomic_t packagelist_gen;
+
+/* derived permission of @dentry is still valid for the packagelist */
+static inline bool derived_perm_fresh(struct dentry *dentry)
+{
+	return dentry->d_inode && SDCARDFS_D(dentry)->perm_gen ==
+					(unsigned int)atomic_read(&packagelist_gen);
+}
 
 /* for derived_perm.c */
 #define BY_NAME		(1 << 0)
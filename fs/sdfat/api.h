@@ -287,6 +287,12 @@ typedef struct __FS_INFO_T {
 	s32       reserved_clusters;  // # of reserved clusters (DA)
 	void        *amap;                  // AU Allocation Map
 
+	u32      *au_used;           // used clusters per AU (exFAT)
+	u32      au_clu_bits;        // log2 of clusters per AU
+	u32      n_au;               // num of AUs
+	u32      n_clean_au;         // num of AUs without used cluster
+	u32      n_full_au;          // num of AUs without free cluster
+
 	/* fat cache */
 	struct {
 		cache_ent_t pool[FAT_CACHE_SIZE];
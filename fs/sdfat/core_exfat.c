@@ -32,6 +32,7 @@
 #include <linux/workqueue.h>
 #include <linux/kernel.h>
 #include <linux/log2.h>
+#include <linux/vmalloc.h>
 
 #include "sdfat.h"
 #include "core.h"
@@ -41,6 +42,7 @@
 /*----------------------------------------------------------------------*/
 /*  Constant & Macro Definitions                                        */
 /*----------------------------------------------------------------------*/
+#define EXFAT_DEF_AU_SIZE	(4 << 20)	/* 4MB, AU of most SD cards */
 
 /*----------------------------------------------------------------------*/
 /*  Global Variable Definitions                                         */
@@ -1027,6 +1029,121 @@ static s32 exfat_check_max_dentries(FILE_ID_T *fid)
 /*
  *  Allocation Bitmap Management Functions
  */
+static inline u32 get_au_clusters(FS_INFO_T *fsi, u32 au)
+{
+	u32 num_clu = fsi->num_clusters - CLUS_BASE;
+
+	return min(1U << fsi->au_clu_bits, num_clu - (au << fsi->au_clu_bits));
+}
+
+/* Index of used clusters per AU, built from the allocation bitmap.
+ * It is a hint for the allocator and the AU statistics only,
+ * so the volume is used without it if it can not be built.
+ */
+static void init_au_map(struct super_block *sb)
+{
+	u32 i, j, au, clu, num_clu, clu_per_au;
+	u8 *map;
+	FS_INFO_T *fsi = &(SDFAT_SB(sb)->fsi);
+	struct sdfat_mount_options *opts = &(SDFAT_SB(sb)->options);
+
+	fsi->au_used = NULL;
+	fsi->n_au = fsi->n_clean_au = fsi->n_full_au = 0;
+
+	if (opts->amap_opt.sect_per_au)
+		clu_per_au = opts->amap_opt.sect_per_au >> fsi->sect_per_clus_bits;
+	else
+		clu_per_au = EXFAT_DEF_AU_SIZE >> fsi->cluster_size_bits;
+
+	/* the bitmap is counted bytewise */
+	if ((clu_per_au < 8) || !is_power_of_2(clu_per_au))
+		return;
+
+	num_clu = fsi->num_clusters - CLUS_BASE;
+	fsi->au_clu_bits = ilog2(clu_per_au);
+	fsi->n_au = ((num_clu - 1) >> fsi->au_clu_bits) + 1;
+	fsi->au_used = vzalloc(fsi->n_au * sizeof(u32));
+	if (!fsi->au_used) {
+		fsi->n_au = 0;
+		return;
+	}
+
+	for (i = 0; i < fsi->map_sectors; i++) {
+		map = (u8 *) fsi->vol_amap[i]->b_data;
+		for (j = 0; j < (u32)sb->s_blocksize; j++) {
+			clu = ((i << sb->s_blocksize_bits) + j) << 3;
+			if (clu >= num_clu)
+				break;
+			fsi->au_used[clu >> fsi->au_clu_bits] += used_bit[map[j]];
+		}
+	}
+
+	for (au = 0; au < fsi->n_au; au++) {
+		if (!fsi->au_used[au])
+			fsi->n_clean_au++;
+		else if (fsi->au_used[au] >= get_au_clusters(fsi, au))
+			fsi->n_full_au++;
+	}
+}
+
+static void update_au_map(FS_INFO_T *fsi, u32 clu, s32 delta)
+{
+	u32 au, total;
+
+	if (!fsi->au_used)
+		return;
+
+	au = clu >> fsi->au_clu_bits;
+	total = get_au_clusters(fsi, au);
+
+	if (!fsi->au_used[au])
+		fsi->n_clean_au--;
+	else if (fsi->au_used[au] >= total)
+		fsi->n_full_au--;
+
+	fsi->au_used[au] += delta;
+
+	if (!fsi->au_used[au])
+		fsi->n_clean_au++;
+	else if (fsi->au_used[au] >= total)
+		fsi->n_full_au++;
+}
+
+/* first cluster of a clean AU, searching from the AU of clu */
+static u32 find_clean_au(struct super_block *sb, u32 clu)
+{
+	u32 i, au;
+	FS_INFO_T *fsi = &(SDFAT_SB(sb)->fsi);
+
+	if (!fsi->au_used || !fsi->n_clean_au)
+		return CLUS_EOF;
+
+	au = (clu - CLUS_BASE) >> fsi->au_clu_bits;
+	for (i = 0; i < fsi->n_au; i++) {
+		if (au >= fsi->n_au)
+			au = 0;
+		if (!fsi->au_used[au])
+			return (au << fsi->au_clu_bits) + CLUS_BASE;
+		au++;
+	}
+
+	return CLUS_EOF;
+}
+
+static u32 exfat_get_au_stat(struct super_block *sb, s32 mode)
+{
+	FS_INFO_T *fsi = &(SDFAT_SB(sb)->fsi);
+
+	if (mode == VOL_AU_STAT_TOTAL)
+		return fsi->n_au;
+	else if (mode == VOL_AU_STAT_CLEAN)
+		return fsi->n_clean_au;
+	else if (mode == VOL_AU_STAT_FULL)
+		return fsi->n_full_au;
+
+	return 0;
+}
+
 s32 load_alloc_bmp(struct super_block *sb)
 {
 	s32 ret;
@@ -1090,6 +1207,7 @@ s32 load_alloc_bmp(struct super_block *sb)
 				}
 
 				fsi->pbr_bh = NULL;
+				init_au_map(sb);
 				return 0;
 			}
 		}
@@ -1114,6 +1232,9 @@ void free_alloc_bmp(struct super_block *sb)
 	/* kfree(NULL) is safe */
 	kfree(fsi->vol_amap);
 	fsi->vol_amap = NULL;
+
+	vfree(fsi->au_used);
+	fsi->au_used = NULL;
 }
 
 /* WARN :
@@ -1130,6 +1251,8 @@ static s32 set_alloc_bitmap(struct super_block *sb, u32 clu)
 	b = clu & (u32)((sb->s_blocksize << 3) - 1);
 
 	sector = CLUS_TO_SECT(fsi, fsi->map_clu) + i;
+	if (!test_bit(b, (unsigned long *)(fsi->vol_amap[i]->b_data)))
+		update_au_map(fsi, clu, 1);
 	bitmap_set((unsigned long *)(fsi->vol_amap[i]->b_data), b, 1);
 
 	return write_sect(sb, sector, fsi->vol_amap[i], 0);
@@ -1153,6 +1276,8 @@ static s32 clr_alloc_bitmap(struct super_block *sb, u32 clu)
 
 	sector = CLUS_TO_SECT(fsi, fsi->map_clu) + i;
 
+	if (test_bit(b, (unsigned long *)(fsi->vol_amap[i]->b_data)))
+		update_au_map(fsi, clu, -1);
 	bitmap_clear((unsigned long *)(fsi->vol_amap[i]->b_data), b, 1);
 
 	ret = write_sect(sb, sector, fsi->vol_amap[i], 0);
@@ -1174,6 +1299,21 @@ static s32 clr_alloc_bitmap(struct super_block *sb, u32 clu)
 	return ret;
 } /* end of clr_alloc_bitmap */
 
+/* WARN :
+ * If the value of "clu" is 0, it means cluster 2 which is
+ * the first cluster of cluster heap.
+ */
+static inline s32 is_alloc_bitmap(struct super_block *sb, u32 clu)
+{
+	s32 i, b;
+	FS_INFO_T *fsi = &(SDFAT_SB(sb)->fsi);
+
+	i = clu >> (sb->s_blocksize_bits + 3);
+	b = clu & (u32)((sb->s_blocksize << 3) - 1);
+
+	return test_bit(b, (unsigned long *)(fsi->vol_amap[i]->b_data));
+} /* end of is_alloc_bitmap */
+
 /* WARN :
  * If the value of "clu" is 0, it means cluster 2 which is
  * the first cluster of cluster heap.
@@ -1372,6 +1512,27 @@ static s32 exfat_alloc_cluster(struct super_block *sb, u32 num_alloc, CHAIN_T *p
 		}
 	}
 
+	/* The cluster after the end of the chain is taken, typically by
+	 * another file being written at the same time. Continue in a clean
+	 * AU rather than in the next free cluster, which would interleave
+	 * the files cluster by cluster. Only for file data, directories
+	 * are kept packed.
+	 */
+	if ((dest == ALLOC_COLD) && !IS_CLUS_EOF(p_chain->dir) &&
+			(hint_clu < fsi->num_clusters)) {
+		s32 frag = is_alloc_bitmap(sb, hint_clu - CLUS_BASE);
+		u32 au_clu = CLUS_EOF;
+
+		if (frag)
+			au_clu = find_clean_au(sb, hint_clu);
+		if (!IS_CLUS_EOF(au_clu)) {
+			hint_clu = au_clu;
+			/* nothing allocated yet, the chain just loses 0x03 */
+			p_chain->flags = 0x01;
+		}
+		sdfat_statistics_set_alloc(frag, !IS_CLUS_EOF(au_clu));
+	}
+
 	set_sb_dirty(sb);
 
 	p_chain->dir = CLUS_EOF;
@@ -1473,6 +1634,7 @@ static FS_FUNC_T exfat_fs_func = {
 	.alloc_cluster = exfat_alloc_cluster,
 	.free_cluster = exfat_free_cluster,
 	.count_used_clusters = exfat_count_used_clusters,
+	.get_au_stat = exfat_get_au_stat,
 
 	.init_dir_entry = exfat_init_dir_entry,
 	.init_ext_entry = exfat_init_ext_entry,
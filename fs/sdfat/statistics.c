@@ -22,6 +22,13 @@ enum {
 	SDFAT_OP_MAX
 };
 
+enum {
+	SDFAT_ALLOC_APPEND,
+	SDFAT_ALLOC_FRAG,
+	SDFAT_ALLOC_CLEAN_AU,
+	SDFAT_ALLOC_MAX
+};
+
 enum {
 	SDFAT_VOL_4G,
 	SDFAT_VOL_8G,
@@ -41,6 +48,7 @@ static struct sdfat_statistics {
 	u32 mnt_cnt[SDFAT_MNT_MAX];
 	u32 nofat_op[SDFAT_OP_MAX];
 	u32 vol_size[SDFAT_VOL_MAX];
+	u32 alloc[SDFAT_ALLOC_MAX];
 } statistics;
 
 static struct kset *sdfat_statistics_kset;
@@ -128,11 +136,22 @@ static ssize_t vol_size_show(struct kobject *kobj,
 			statistics.vol_size[SDFAT_VOL_XTB]);
 }
 
+static ssize_t alloc_show(struct kobject *kobj,
+				struct kobj_attribute *attr, char *buff)
+{
+	return snprintf(buff, PAGE_SIZE, "\"ALLOC_APPEND_I\":\"%u\","
+			"\"ALLOC_FRAG_I\":\"%u\",\"ALLOC_CLEAN_AU_I\":\"%u\"\n",
+			statistics.alloc[SDFAT_ALLOC_APPEND],
+			statistics.alloc[SDFAT_ALLOC_FRAG],
+			statistics.alloc[SDFAT_ALLOC_CLEAN_AU]);
+}
+
 static struct kobj_attribute vfat_cl_attr = __ATTR_RO(vfat_cl);
 static struct kobj_attribute exfat_cl_attr = __ATTR_RO(exfat_cl);
 static struct kobj_attribute mount_attr = __ATTR_RO(mount);
 static struct kobj_attribute nofat_op_attr = __ATTR_RO(nofat_op);
 static struct kobj_attribute vol_size_attr = __ATTR_RO(vol_size);
+static struct kobj_attribute alloc_attr = __ATTR_RO(alloc);
 
 static struct attribute *attributes_statistics[] = {
 	&vfat_cl_attr.attr,
@@ -140,6 +159,7 @@ static struct attribute *attributes_statistics[] = {
 	&mount_attr.attr,
 	&nofat_op_attr.attr,
 	&vol_size_attr.attr,
+	&alloc_attr.attr,
 	NULL,
 };
 
@@ -279,3 +299,17 @@ void sdfat_statistics_set_vol_size(struct super_block *sb)
 	else
 		statistics.vol_size[SDFAT_VOL_XTB]++;
 }
+
+/* frag : the cluster after the end of the chain was already used
+ * clean_au : allocation went on in a clean AU instead
+ *
+ * Counted for every appending allocation of file data on exFAT.
+ */
+void sdfat_statistics_set_alloc(s32 frag, s32 clean_au)
+{
+	statistics.alloc[SDFAT_ALLOC_APPEND]++;
+	if (frag)
+		statistics.alloc[SDFAT_ALLOC_FRAG]++;
+	if (clean_au)
+		statistics.alloc[SDFAT_ALLOC_CLEAN_AU]++;
+}
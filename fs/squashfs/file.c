@@ -47,6 +47,7 @@
 #include <linux/string.h>
 #include <linux/pagemap.h>
 #include <linux/mutex.h>
+#include <linux/workqueue.h>
 
 #include "squashfs_fs.h"
 #include "squashfs_fs_sb.h"
@@ -497,7 +498,112 @@ out:
 	return 0;
 }
 
+/*
+ * Readahead decompresses the datablocks of the window in parallel.  Each
+ * block is read by its own work item on the unbound workqueue, so with
+ * more than one decompressor the blocks are decompressed on several CPUs
+ * at once, straight into the page cache when SQUASHFS_FILE_DIRECT is set.
+ */
+static struct workqueue_struct *squashfs_read_wq;
+
+struct squashfs_read_work {
+	struct work_struct	work;
+	struct page		*page;
+};
+
+static void squashfs_read_work_fn(struct work_struct *work)
+{
+	struct squashfs_read_work *rw = container_of(work,
+		struct squashfs_read_work, work);
+
+	squashfs_readpage(NULL, rw->page);
+	page_cache_release(rw->page);
+	kfree(rw);
+}
+
+static int squashfs_readpages(struct file *file, struct address_space *mapping,
+	struct list_head *pages, unsigned nr_pages)
+{
+	struct inode *inode = mapping->host;
+	struct squashfs_sb_info *msblk = inode->i_sb->s_fs_info;
+	int shift = msblk->block_log - PAGE_CACHE_SHIFT;
+	bool parallel = squashfs_max_decompressors() > 1;
+	struct page *page, *head = NULL, *first = NULL;
+	pgoff_t block, last_block = 0;
+
+	/* pages come lowest index first */
+	while (!list_empty(pages)) {
+		page = list_entry(pages->prev, struct page, lru);
+		list_del(&page->lru);
+		block = page->index >> shift;
+
+		/*
+		 * Only the first page of each block is added, reading that
+		 * page fills the rest of the block.  Keep the async readahead
+		 * marker on the block that is read instead.
+		 */
+		if (head && block == last_block) {
+			if (PageReadahead(page))
+				SetPageReadahead(head);
+			page_cache_release(page);
+			continue;
+		}
+
+		if (add_to_page_cache_lru(page, mapping, page->index,
+				GFP_KERNEL)) {
+			page_cache_release(page);
+			continue;
+		}
+		head = page;
+		last_block = block;
+
+		if (first == NULL) {
+			first = page;
+			continue;
+		}
+
+		if (parallel) {
+			struct squashfs_read_work *rw = kmalloc(sizeof(*rw),
+				GFP_KERNEL);
+
+			if (rw) {
+				INIT_WORK(&rw->work, squashfs_read_work_fn);
+				rw->page = page;
+				queue_work(squashfs_read_wq, &rw->work);
+				continue;
+			}
+		}
+
+		squashfs_readpage(file, page);
+		page_cache_release(page);
+	}
+
+	/* the caller waits on the first block, read it here */
+	if (first) {
+		squashfs_readpage(file, first);
+		page_cache_release(first);
+	}
+
+	return 0;
+}
+
+
+int __init squashfs_init_read_wq(void)
+{
+	squashfs_read_wq = alloc_workqueue("squashfs_read",
+		WQ_UNBOUND | WQ_MEM_RECLAIM, 0);
+
+	return squashfs_read_wq ? 0 : -ENOMEM;
+}
+
+
+void squashfs_destroy_read_wq(void)
+{
+	destroy_workqueue(squashfs_read_wq);
+}
+
 
 const struct address_space_operations squashfs_aops = {
-	.readpage = squashfs_readpage
+	.readpage = squashfs_readpage,
+	.readpages = squashfs_readpages
 };
@@ -108,8 +108,13 @@ static int lz4_uncompress(struct squashfs_sb_info *msblk, void *strm,
 		put_bh(bh[i]);
 	}
 
+#ifdef CONFIG_LZ4_DECOMPRESS_ARM64
+	res = lz4_decompress_arm64(stream->input, length,
+					stream->output, &dest_len);
+#else
 	res = lz4_decompress_unknownoutputsize(stream->input, length,
 					stream->output, &dest_len);
+#endif
 	if (res)
 		return -EIO;
 
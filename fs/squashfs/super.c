@@ -49,6 +49,24 @@
 static struct file_system_type squashfs_fs_type;
 static const struct super_operations squashfs_super_ops;
 
+/*
+ * Every decompressor working on tail-end packed files at the same time
+ * needs a fragment cache entry of its own, so by default the fragment
+ * cache grows with the number of decompressors (one per CPU with
+ * SQUASHFS_DECOMP_MULTI_PERCPU).
+ */
+static unsigned int fragment_cache_size;
+module_param(fragment_cache_size, uint, 0644);
+MODULE_PARM_DESC(fragment_cache_size,
+	"Fragment cache entries per mount, 0 sizes it by decompressors");
+
+static int squashfs_fragment_cache_size(void)
+{
+	if (fragment_cache_size)
+		return fragment_cache_size;
+	return max(SQUASHFS_CACHED_FRAGMENTS, squashfs_max_decompressors());
+}
+
 static const struct squashfs_decompressor *supported_squashfs_filesystem(short
 	major, short minor, short id)
 {
@@ -278,7 +296,7 @@ handle_fragments:
 		goto check_directory_table;
 
 	msblk->fragment_cache = squashfs_cache_init("fragment",
-		SQUASHFS_CACHED_FRAGMENTS, msblk->block_size);
+		squashfs_fragment_cache_size(), msblk->block_size);
 	if (msblk->fragment_cache == NULL) {
 		err = -ENOMEM;
 		goto failed_mount;
@@ -444,8 +462,15 @@ static int __init init_squashfs_fs(void)
 	if (err)
 		return err;
 
+	err = squashfs_init_read_wq();
+	if (err) {
+		destroy_inodecache();
+		return err;
+	}
+
 	err = register_filesystem(&squashfs_fs_type);
 	if (err) {
+		squashfs_destroy_read_wq();
 		destroy_inodecache();
 		return err;
 	}
@@ -459,6 +484,7 @@ static int __init init_squashfs_fs(void)
 static void __exit exit_squashfs_fs(void)
 {
 	unregister_filesystem(&squashfs_fs_type);
+	squashfs_destroy_read_wq();
 	destroy_inodecache();
 }
 
@@ -84,6 +84,7 @@ struct qcom_ice_variant_ops {
 	int	(*suspend)(struct platform_device *);
 	int	(*config)(struct platform_device *, struct request* ,
 				struct ice_data_setting*);
+	int	(*config_end)(struct platform_device *, struct request *);
 	int	(*status)(struct platform_device *);
 };
 
@@ -120,6 +120,8 @@ struct mnemosyne_platform_data {
 	u64 size;
 };
 
+extern unsigned long long mnemosyne_size;
+
 struct mnemosyne_data *mnemosyne_get_base(void);
 int mnemosyne_is_ready(void);
 int mnemosyne_early_init(void);
@@ -0,0 +1,86 @@
+/* include/htc_mnemosyne/htc_perf_footprint.h
+ * Copyright (C) 2016 HTC Corporation.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+#ifndef __HTC_PERF_FOOTPRINT_H
+#define __HTC_PERF_FOOTPRINT_H
+
+#include <linux/jump_label.h>
+#include <linux/sched.h>
+#include <linux/types.h>
+
+#define PERF_FOOT_PRINT_MAGIC			0xACBDCE00
+
+/*
+ * Per cpu rings of these records follow struct mnemosyne_data in the
+ * reserved area, at perf_footprint_offset bytes from its start, with
+ * perf_footprint_nr records per hw cpu index. perf_footprint_head[cpu]
+ * counts the records written, the newest one is at (head - 1) % nr.
+ * A record with type 0 was being written when the system went down.
+ */
+enum PERF_FOOTPRINT_TYPE {
+	PERF_FP_IRQ = 1,	/* id: irq, value: ns, arg: handler */
+	PERF_FP_SCHED_DELAY,	/* id: pid, value: ns runnable, arg: comm[0..7] */
+	PERF_FP_FREQ_LIMIT,	/* id: cpu, value: max khz, arg: min khz */
+};
+
+struct perf_footprint_rec {
+	u64 ts;			/* sched_clock() */
+	u32 type;
+	u32 id;
+	u64 value;
+	u64 arg;
+};
+
+#ifdef CONFIG_HTC_PERF_FOOTPRINT
+extern struct static_key htc_perf_footprint_key;
+
+void __htc_perf_footprint_irq(unsigned int irq, void *handler, u64 ns);
+void __htc_perf_footprint_sched(struct task_struct *p, u64 ns);
+
+static inline u64 htc_perf_footprint_irq_enter(void)
+{
+	if (static_key_false(&htc_perf_footprint_key))
+		return local_clock();
+	return 0;
+}
+
+static inline void htc_perf_footprint_irq_exit(unsigned int irq,
+					       void *handler, u64 start)
+{
+	if (start)
+		__htc_perf_footprint_irq(irq, handler, local_clock() - start);
+}
+
+/* p waited ns on the runqueue before getting the cpu */
+static inline void htc_perf_footprint_sched(struct task_struct *p, u64 ns)
+{
+	if (static_key_false(&htc_perf_footprint_key))
+		__htc_perf_footprint_sched(p, ns);
+}
+#else
+static inline u64 htc_perf_footprint_irq_enter(void)
+{
+	return 0;
+}
+
+static inline void htc_perf_footprint_irq_exit(unsigned int irq,
+					       void *handler, u64 start)
+{
+}
+
+static inline void htc_perf_footprint_sched(struct task_struct *p, u64 ns)
+{
+}
+#endif /* CONFIG_HTC_PERF_FOOTPRINT */
+
+#endif
@@ -0,0 +1,138 @@
+/*
+ * Inline encryption keys carried by bios
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef _LINUX_BLK_CRYPT_H
+#define _LINUX_BLK_CRYPT_H
+
+#include <linux/atomic.h>
+#include <linux/bio.h>
+#include <linux/types.h>
+
+#define BLK_CRYPT_MAX_KEY_SIZE		64	/* AES-256-XTS */
+
+/* the data unit is 4k, so the dun advances by one every 8 sectors */
+#define BLK_CRYPT_DUN_SECTOR_SHIFT	3
+
+/*
+ * A raw key handed to the inline crypto engine. The filesystem owns one
+ * reference, every bio that carries the key owns another, so the key
+ * outlives the I/O even when the filesystem drops it mid flight.
+ */
+struct blk_crypt_key {
+	atomic_t	ref;
+	unsigned int	size;
+	u8		raw[BLK_CRYPT_MAX_KEY_SIZE];
+};
+
+#ifdef CONFIG_BLK_INLINE_ENCRYPTION
+extern struct blk_crypt_key *blk_crypt_key_alloc(const u8 *raw,
+						 unsigned int size, gfp_t gfp);
+extern void blk_crypt_key_put(struct blk_crypt_key *key);
+
+static inline struct blk_crypt_key *blk_crypt_key_get(struct blk_crypt_key *key)
+{
+	atomic_inc(&key->ref);
+	return key;
+}
+
+/**
+ * bio_set_crypt_key - have the storage controller encrypt a bio
+ * @bio: bio that is not submitted yet
+ * @key: key to encrypt and decrypt with, a reference is taken
+ * @dun: data unit number of the first 4k of the bio
+ */
+static inline void bio_set_crypt_key(struct bio *bio,
+				     struct blk_crypt_key *key, u64 dun)
+{
+	bio->bi_crypt_key = blk_crypt_key_get(key);
+	bio->bi_crypt_dun = dun;
+}
+
+static inline struct blk_crypt_key *bio_crypt_key(struct bio *bio)
+{
+	return bio ? bio->bi_crypt_key : NULL;
+}
+
+static inline void bio_crypt_free(struct bio *bio)
+{
+	if (bio->bi_crypt_key) {
+		blk_crypt_key_put(bio->bi_crypt_key);
+		bio->bi_crypt_key = NULL;
+	}
+}
+
+static inline void bio_crypt_clone(struct bio *bio, struct bio *bio_src)
+{
+	if (bio_src->bi_crypt_key)
+		bio_set_crypt_key(bio, bio_src->bi_crypt_key,
+				  bio_src->bi_crypt_dun);
+}
+
+/* the dun of the data unit @sectors into the bio */
+static inline u64 bio_crypt_dun_at(struct bio *bio, unsigned int sectors)
+{
+	return bio->bi_crypt_dun + (sectors >> BLK_CRYPT_DUN_SECTOR_SHIFT);
+}
+
+/*
+ * @next may follow @prev in one request only if both use the same key and
+ * the tweak carries on where @prev stops.
+ */
+static inline bool bio_crypt_mergeable(struct bio *prev, struct bio *next)
+{
+	if (prev->bi_crypt_key != next->bi_crypt_key)
+		return false;
+	return !prev->bi_crypt_key ||
+		bio_crypt_dun_at(prev, bio_sectors(prev)) == next->bi_crypt_dun;
+}
+
+/* whether data unit @dun under @key may be added at the end of @bio */
+static inline bool bio_crypt_can_append(struct bio *bio,
+					struct blk_crypt_key *key, u64 dun)
+{
+	if (bio->bi_crypt_key != key)
+		return false;
+	return !key || bio_crypt_dun_at(bio, bio_sectors(bio)) == dun;
+}
+#else
+static inline void bio_set_crypt_key(struct bio *bio,
+				     struct blk_crypt_key *key, u64 dun)
+{
+}
+
+static inline struct blk_crypt_key *bio_crypt_key(struct bio *bio)
+{
+	return NULL;
+}
+
+static inline void bio_crypt_free(struct bio *bio)
+{
+}
+
+static inline void bio_crypt_clone(struct bio *bio, struct bio *bio_src)
+{
+}
+
+static inline bool bio_crypt_mergeable(struct bio *prev, struct bio *next)
+{
+	return true;
+}
+
+static inline bool bio_crypt_can_append(struct bio *bio,
+					struct blk_crypt_key *key, u64 dun)
+{
+	return true;
+}
+#endif /* CONFIG_BLK_INLINE_ENCRYPTION */
+
+#endif /* _LINUX_BLK_CRYPT_H */
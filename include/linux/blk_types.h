@@ -16,6 +16,7 @@ struct page;
 struct block_device;
 struct io_context;
 struct cgroup_subsys_state;
+struct blk_crypt_key;
 typedef void (bio_end_io_t) (struct bio *, int);
 typedef void (bio_destructor_t) (struct bio *);
 
@@ -81,6 +82,16 @@ struct bio {
 	 */
 	struct inode		*bi_dio_inode;
 
+#ifdef CONFIG_BLK_INLINE_ENCRYPTION
+	/*
+	 * Key for the inline crypto engine of the storage controller and the
+	 * data unit number of the first 4k of the bio, which the engine uses
+	 * as the tweak. NULL key for plaintext. See bio_set_crypt_key().
+	 */
+	struct blk_crypt_key	*bi_crypt_key;
+	u64			bi_crypt_dun;
+#endif
+
 	/*
 	 * Everything starting with bi_max_vecs will be preserved by bio_reset()
 	 */
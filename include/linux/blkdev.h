@@ -163,6 +163,9 @@ struct request {
 #endif
 
 	unsigned short ioprio;
+#ifdef CONFIG_BLK_WBT
+	unsigned short wbt_flags;
+#endif
 
 	int ref_count;
 
@@ -390,6 +393,10 @@ struct request_queue {
 
 	unsigned int		nr_sorted;
 	unsigned int		in_flight[2];
+
+	/* bios someone waits on: reads except readahead, sync writes */
+	unsigned long		fg_io_count;
+	unsigned long		fg_io_stamp;	/* jiffies of the last one */
 	/*
 	 * Number of active block driver functions for which blk_drain_queue()
 	 * must wait. Must be incremented around functions that unlock the
@@ -450,6 +457,9 @@ struct request_queue {
 #ifdef CONFIG_BLK_DEV_THROTTLING
 	/* Throttle data */
 	struct throtl_data *td;
+#endif
+#ifdef CONFIG_BLK_WBT
+	struct rq_wb		*rq_wb;
 #endif
 	struct rcu_head		rcu_head;
 };
@@ -475,6 +485,7 @@ struct request_queue {
 #define QUEUE_FLAG_SAME_FORCE  18	/* force complete on same CPU */
 #define QUEUE_FLAG_DEAD        19	/* queue tear-down finished */
 #define QUEUE_FLAG_FAST        20	/* fast block device (e.g. ram based) */
+#define QUEUE_FLAG_INLINE_CRYPT 21	/* honours bio->bi_crypt_key */
 
 #define QUEUE_FLAG_DEFAULT	((1 << QUEUE_FLAG_IO_STAT) |		\
 				 (1 << QUEUE_FLAG_STACKABLE)	|	\
@@ -559,6 +570,8 @@ static inline void queue_flag_clear(unsigned int flag, struct request_queue *q)
 #define blk_queue_secdiscard(q)	(blk_queue_discard(q) && \
 	test_bit(QUEUE_FLAG_SECDISCARD, &(q)->queue_flags))
 #define blk_queue_fast(q)	test_bit(QUEUE_FLAG_FAST, &(q)->queue_flags)
+#define blk_queue_inline_crypt(q)	\
+	test_bit(QUEUE_FLAG_INLINE_CRYPT, &(q)->queue_flags)
 
 #define blk_noretry_request(rq) \
 	((rq)->cmd_flags & (REQ_FAILFAST_DEV|REQ_FAILFAST_TRANSPORT| \
@@ -1316,6 +1329,23 @@ static inline bool queue_flush_queueable(struct request_queue *q)
 	return !q->flush_not_queueable;
 }
 
+/*
+ * Background work (filesystem GC and the like) uses these to stay out of
+ * the way of foreground I/O: it runs once no foreground bio was submitted
+ * for a while and backs off as soon as the count moves again.
+ */
+static inline unsigned long blk_queue_fg_io_count(struct request_queue *q)
+{
+	return ACCESS_ONCE(q->fg_io_count);
+}
+
+static inline bool blk_queue_fg_idle(struct request_queue *q,
+				     unsigned int msecs)
+{
+	return time_after_eq(jiffies, ACCESS_ONCE(q->fg_io_stamp) +
+			     msecs_to_jiffies(msecs));
+}
+
 typedef struct {struct page *v;} Sector;
 
 unsigned char *read_dev_sector(struct block_device *, sector_t, Sector *);
@@ -0,0 +1,67 @@
+/*
+ * Boot phase profiler: records the duration of each initcall and driver
+ * probe executed before userspace is started.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#ifndef _LINUX_BOOT_PROFILE_H
+#define _LINUX_BOOT_PROFILE_H
+
+#include <linux/init.h>
+#include <linux/ktime.h>
+#include <linux/smp.h>
+
+struct device;
+struct device_driver;
+
+struct boot_profile_mark {
+	ktime_t start;
+	int cpu;
+};
+
+#ifdef CONFIG_BOOT_PROFILER
+extern bool boot_profile_active;
+
+extern void __boot_profile_initcall_end(struct boot_profile_mark *m,
+					initcall_t fn, int ret);
+extern void __boot_profile_probe_end(struct boot_profile_mark *m,
+				     struct device *dev,
+				     struct device_driver *drv, int ret);
+extern void boot_profile_stop(void);
+
+static inline void boot_profile_begin(struct boot_profile_mark *m)
+{
+	if (boot_profile_active) {
+		m->start = ktime_get();
+		m->cpu = raw_smp_processor_id();
+	}
+}
+
+static inline void boot_profile_initcall_end(struct boot_profile_mark *m,
+					     initcall_t fn, int ret)
+{
+	if (boot_profile_active)
+		__boot_profile_initcall_end(m, fn, ret);
+}
+
+static inline void boot_profile_probe_end(struct boot_profile_mark *m,
+					  struct device *dev,
+					  struct device_driver *drv, int ret)
+{
+	if (boot_profile_active)
+		__boot_profile_probe_end(m, dev, drv, ret);
+}
+#else
+static inline void boot_profile_begin(struct boot_profile_mark *m) { }
+static inline void boot_profile_initcall_end(struct boot_profile_mark *m,
+					     initcall_t fn, int ret) { }
+static inline void boot_profile_probe_end(struct boot_profile_mark *m,
+					  struct device *dev,
+					  struct device_driver *drv,
+					  int ret) { }
+static inline void boot_profile_stop(void) { }
+#endif
+
+#endif /* _LINUX_BOOT_PROFILE_H */
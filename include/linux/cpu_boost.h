@@ -0,0 +1,12 @@
+#ifndef _LINUX_CPU_BOOST_H
+#define _LINUX_CPU_BOOST_H
+
+#ifdef CONFIG_CPU_BOOST
+extern void cpu_boost_frame_event(void);
+extern void cpu_boost_kick(void);
+#else
+static inline void cpu_boost_frame_event(void) { }
+static inline void cpu_boost_kick(void) { }
+#endif
+
+#endif /* _LINUX_CPU_BOOST_H */
@@ -445,6 +445,9 @@ extern struct cpufreq_governor cpufreq_gov_darkness;
 #elif defined(CONFIG_CPU_FREQ_DEFAULT_GOV_LIONFISH)
 extern struct cpufreq_governor cpufreq_gov_lionfish;
 #define CPUFREQ_DEFAULT_GOVERNOR       (&cpufreq_gov_lionfish)
+#elif defined(CONFIG_CPU_FREQ_DEFAULT_GOV_SCHED)
+extern struct cpufreq_governor cpufreq_gov_sched;
+#define CPUFREQ_DEFAULT_GOVERNOR	(&cpufreq_gov_sched)
 #endif
 
 /*********************************************************************
@@ -508,4 +511,13 @@ void cpufreq_task_stats_remove_uids(uid_t uid_start, uid_t uid_end);
 int  proc_time_in_state_show(struct seq_file *m, struct pid_namespace *ns,
 	struct pid *pid, struct task_struct *p);
 
+#ifdef CONFIG_CPU_FREQ_UID_STATS
+void cpufreq_uid_stats_account(struct task_struct *p);
+void cpufreq_uid_stats_remove_uids(uid_t uid_start, uid_t uid_end);
+#else
+static inline void cpufreq_uid_stats_account(struct task_struct *p) {}
+static inline void cpufreq_uid_stats_remove_uids(uid_t uid_start,
+						 uid_t uid_end) {}
+#endif
+
 #endif /* _LINUX_CPUFREQ_H */
@@ -22,6 +22,7 @@ extern void cpuset_init_smp(void);
 extern void cpuset_force_rebuild(void);
 extern void cpuset_update_active_cpus(bool cpu_online);
 extern void cpuset_wait_for_hotplug(void);
+extern void cpuset_post_attach_flush(void);
 extern void cpuset_cpus_allowed(struct task_struct *p, struct cpumask *mask);
 extern void cpuset_cpus_allowed_fallback(struct task_struct *p);
 extern nodemask_t cpuset_mems_allowed(struct task_struct *p);
@@ -133,6 +134,8 @@ static inline void cpuset_update_active_cpus(bool cpu_online)
 
 static inline void cpuset_wait_for_hotplug(void) { }
 
+static inline void cpuset_post_attach_flush(void) { }
+
 static inline void cpuset_cpus_allowed(struct task_struct *p,
 				       struct cpumask *mask)
 {
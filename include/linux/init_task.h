@@ -153,6 +153,13 @@ extern struct task_group root_task_group;
 # define INIT_VTIME(tsk)
 #endif
 
+#ifdef CONFIG_SCHED_HMP
+# define INIT_UTIL_CLAMP						\
+	.util_max	= 100,
+#else
+# define INIT_UTIL_CLAMP
+#endif
+
 #define INIT_TASK_COMM "swapper"
 
 /*
@@ -224,6 +231,7 @@ extern struct task_group root_task_group;
 	INIT_TASK_RCU_PREEMPT(tsk)					\
 	INIT_CPUSET_SEQ							\
 	INIT_VTIME(tsk)							\
+	INIT_UTIL_CLAMP							\
 }
 
 
@@ -80,10 +80,16 @@ enum ipa_aggr_mode {
  * invoked for on data path
  * @IPA_RECEIVE: data is struct sk_buff
  * @IPA_WRITE_DONE: data is struct sk_buff
+ * @IPA_CLIENT_START_POLL: data is not used, packets are pending on a pipe
+ *	set up with napi_enabled and should be pulled with ipa_rx_poll()
+ * @IPA_WDI_PIPE_ERROR: data is not used, the uC reported an error on a WDI
+ *	pipe and the client should move its traffic back to the host path
  */
 enum ipa_dp_evt_type {
 	IPA_RECEIVE,
 	IPA_WRITE_DONE,
+	IPA_CLIENT_START_POLL,
+	IPA_WDI_PIPE_ERROR,
 };
 
 /**
@@ -490,6 +496,9 @@ struct ipa_ext_intf {
  * @skip_ep_cfg: boolean field that determines if EP should be configured
  *  by IPA driver
  * @keep_ipa_awake: when true, IPA will not be clock gated
+ * @napi_enabled: RX is pulled by the client from its NAPI poll through
+ *  ipa_rx_poll() after an IPA_CLIENT_START_POLL event, instead of being
+ *  pushed from an IPA workqueue. Only for IPA_CLIENT_APPS_WAN_CONS.
  */
 struct ipa_sys_connect_params {
 	struct ipa_ep_cfg ipa_ep_cfg;
@@ -499,6 +508,7 @@ struct ipa_sys_connect_params {
 	ipa_notify_cb notify;
 	bool skip_ep_cfg;
 	bool keep_ipa_awake;
+	bool napi_enabled;
 };
 
 /**
@@ -507,6 +517,8 @@ struct ipa_sys_connect_params {
  * @mbim_stream_id_valid:	 is above field valid?
  * @dma_address: dma mapped address of TX packet
  * @dma_address_valid: is above field valid?
+ * @xmit_more: more packets are queued behind this one, the doorbell may be
+ *	deferred until a packet without it or ipa_tx_dp_flush()
  */
 struct ipa_tx_meta {
 	u8 mbim_stream_id;
@@ -516,6 +528,7 @@ struct ipa_tx_meta {
 	bool pkt_init_dst_ep_remote;
 	dma_addr_t dma_address;
 	bool dma_address_valid;
+	bool xmit_more;
 };
 
 /**
@@ -1169,6 +1182,8 @@ int ipa_set_single_ndp_per_mbim(bool enable);
 int ipa_tx_dp(enum ipa_client_type dst, struct sk_buff *skb,
 		struct ipa_tx_meta *metadata);
 
+int ipa_tx_dp_flush(enum ipa_client_type dst);
+
 /*
  * To transfer multiple data packets
  * While passing the data descriptor list, the anchor node
@@ -1186,6 +1201,10 @@ int ipa_setup_sys_pipe(struct ipa_sys_connect_params *sys_in, u32 *clnt_hdl);
 
 int ipa_teardown_sys_pipe(u32 clnt_hdl);
 
+int ipa_rx_poll(u32 clnt_hdl, int budget);
+
+void ipa_rx_poll_complete(u32 clnt_hdl);
+
 int ipa_connect_wdi_pipe(struct ipa_wdi_in_params *in,
 		struct ipa_wdi_out_params *out);
 int ipa_disconnect_wdi_pipe(u32 clnt_hdl);
@@ -1673,6 +1692,11 @@ static inline int ipa_tx_dp(enum ipa_client_type dst, struct sk_buff *skb,
 	return -EPERM;
 }
 
+static inline int ipa_tx_dp_flush(enum ipa_client_type dst)
+{
+	return -EPERM;
+}
+
 /*
  * To transfer multiple data packets
  */
@@ -1707,6 +1731,15 @@ static inline int ipa_teardown_sys_pipe(u32 clnt_hdl)
 	return -EPERM;
 }
 
+static inline int ipa_rx_poll(u32 clnt_hdl, int budget)
+{
+	return 0;
+}
+
+static inline void ipa_rx_poll_complete(u32 clnt_hdl)
+{
+}
+
 static inline int ipa_connect_wdi_pipe(struct ipa_wdi_in_params *in,
 		struct ipa_wdi_out_params *out)
 {
@@ -117,7 +117,7 @@ struct msm_ipc_port {
 	int conn_status;
 
 	struct list_head port_rx_q;
-	struct mutex port_rx_q_lock_lhc3;
+	spinlock_t port_rx_q_lock_lhc3;
 	char rx_ws_name[MAX_WS_NAME_SZ];
 	struct wakeup_source *port_rx_ws;
 	wait_queue_head_t port_rx_wait_q;
@@ -24,6 +24,12 @@
 #define IPC_ROUTER_XPRT_EVENT_DATA  1
 #define IPC_ROUTER_XPRT_EVENT_OPEN  2
 #define IPC_ROUTER_XPRT_EVENT_CLOSE 3
+/*
+ * Like IPC_ROUTER_XPRT_EVENT_DATA, but ownership of the packet passes to
+ * IPC Router, which queues it without cloning and releases it when done.
+ * The transport must not touch or release the packet after notifying.
+ */
+#define IPC_ROUTER_XPRT_EVENT_DATA_HANDOFF 4
 
 #define FRAG_PKT_WRITE_ENABLE 0x1
 
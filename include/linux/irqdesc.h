@@ -37,6 +37,9 @@ struct irq_desc;
  * @threads_oneshot:	bitfield to handle shared oneshot threads
  * @threads_active:	number of irqaction threads currently running
  * @wait_for_threads:	wait queue for sync_irq to wait for threaded handlers
+ * @handler_ns:		time spent in the hard irq handlers
+ * @handler_max_ns:	longest single run of the hard irq handlers
+ * @bal:		state of the cluster irq balancer
  * @dir:		/proc/irq/ procfs entry
  * @name:		flow handler name for /proc/interrupts output
  */
@@ -70,6 +73,17 @@ struct irq_desc {
 	unsigned long		threads_oneshot;
 	atomic_t		threads_active;
 	wait_queue_head_t       wait_for_threads;
+#ifdef CONFIG_IRQ_CLUSTER_BALANCE
+	u64			handler_ns;
+	u64			handler_max_ns;
+	struct {
+		unsigned int	last_count;
+		u64		last_ns;
+		unsigned int	rate;		/* irqs per second */
+		unsigned int	load;		/* per mille of a cpu */
+		int		cpu;		/* -1 if not placed */
+	} bal;
+#endif
 #ifdef CONFIG_PROC_FS
 	struct proc_dir_entry	*dir;
 #endif
@@ -677,6 +677,7 @@ jbd2_time_diff(unsigned long start, unsigned long end)
  * @j_wait_commit: Wait queue to trigger commit
  * @j_wait_updates: Wait queue to wait for updates to complete
  * @j_checkpoint_mutex: Mutex for locking against concurrent checkpoints
+ * @j_checkpoint_work: Work item for background checkpointing
  * @j_head: Journal head - identifies the first unused block in the journal
  * @j_tail: Journal tail - identifies the oldest still-used block in the
  *  journal.
@@ -796,6 +797,11 @@ struct journal_s
 	/* Semaphore for locking against concurrent checkpoints */
 	struct mutex		j_checkpoint_mutex;
 
+#ifdef CONFIG_JBD2_BG_CHECKPOINT
+	/* Background checkpointing, see jbd2_log_start_bg_checkpoint() */
+	struct work_struct	j_checkpoint_work;
+#endif
+
 	/*
 	 * List of buffer heads used by the checkpoint routine.  This
 	 * was moved from jbd2_log_do_checkpoint() to reduce stack
@@ -1207,6 +1213,14 @@ int jbd2_log_do_checkpoint(journal_t *journal);
 int jbd2_trans_will_send_data_barrier(journal_t *journal, tid_t tid);
 
 void __jbd2_log_wait_for_space(journal_t *journal);
+#ifdef CONFIG_JBD2_BG_CHECKPOINT
+void jbd2_log_bg_checkpoint_work(struct work_struct *work);
+void jbd2_log_start_bg_checkpoint(journal_t *journal);
+#else
+static inline void jbd2_log_start_bg_checkpoint(journal_t *journal)
+{
+}
+#endif
 extern void __jbd2_journal_drop_transaction(journal_t *, transaction_t *);
 extern int jbd2_cleanup_journal_tail(journal_t *);
 
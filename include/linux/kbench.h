@@ -0,0 +1,73 @@
+/*
+ * In-kernel microbenchmark framework
+ *
+ * Copyright (C) 2016 HTC Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef _LINUX_KBENCH_H
+#define _LINUX_KBENCH_H
+
+#include <linux/list.h>
+#include <linux/types.h>
+
+#define KBENCH_MODE_LEN		16
+#define KBENCH_TARGET_LEN	64
+
+/**
+ * struct kbench_ctx - parameters and state of one benchmark run
+ * @iterations:	number of timed operations
+ * @size:	size of one operation in bytes, meaning is up to the benchmark
+ * @n:		count parameter, e.g. fences per operation
+ * @mode:	variant of the benchmark
+ * @target:	object to run against, e.g. a heap id or a block device
+ * @bytes:	bytes moved by one operation, set by the benchmark to get
+ *		a throughput figure
+ * @priv:	benchmark private data
+ */
+struct kbench_ctx {
+	unsigned int	iterations;
+	unsigned int	size;
+	unsigned int	n;
+	char		mode[KBENCH_MODE_LEN];
+	char		target[KBENCH_TARGET_LEN];
+	u64		bytes;
+	void		*priv;
+};
+
+/**
+ * struct kbench - a benchmark
+ * @name:	name used to run it
+ * @help:	one line describing the parameters it takes
+ * @setup:	optional, called once before the run
+ * @prepare:	optional, untimed, called before every operation
+ * @op:		the timed operation
+ * @post:	optional, untimed, called after every operation
+ * @teardown:	optional, called once after the run, also on failure
+ *
+ * Callbacks run in the context of the task that started the run and
+ * may sleep. Returning an error from any of them ends the run.
+ */
+struct kbench {
+	const char	*name;
+	const char	*help;
+	int		(*setup)(struct kbench_ctx *ctx);
+	int		(*prepare)(struct kbench_ctx *ctx, unsigned int i);
+	int		(*op)(struct kbench_ctx *ctx, unsigned int i);
+	void		(*post)(struct kbench_ctx *ctx, unsigned int i);
+	void		(*teardown)(struct kbench_ctx *ctx);
+	struct list_head list;
+};
+
+int kbench_register(struct kbench *bench);
+void kbench_unregister(struct kbench *bench);
+
+#endif /* _LINUX_KBENCH_H */
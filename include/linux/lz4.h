@@ -84,4 +84,14 @@ int lz4_decompress(const unsigned char *src, size_t *src_len,
  */
 int lz4_decompress_unknownoutputsize(const unsigned char *src, size_t src_len,
 		unsigned char *dest, size_t *dest_len);
+
+#ifdef CONFIG_LZ4_DECOMPRESS_ARM64
+/*
+ * lz4_decompress_arm64()
+ *	same as lz4_decompress_unknownoutputsize(), tuned for ARMv8.
+ *	note :  Never writes past dest + *dest_len.
+ */
+int lz4_decompress_arm64(const unsigned char *src, size_t src_len,
+		unsigned char *dest, size_t *dest_len);
+#endif
 #endif
@@ -107,6 +107,26 @@ struct mmc_request {
 	struct completion	completion;
 	void			(*done)(struct mmc_request *);/* completion function */
 	struct mmc_host		*host;
+	struct mmc_cmdq_req	*cmdq_req;	/* set for command queue tasks */
+};
+
+/*
+ * A data transfer queued on the eMMC 5.1 command queue. The host engine
+ * sends it as CMD44/CMD45 and executes it once the device reports the
+ * task ready, so up to host->cmdq_slots of them can be in flight.
+ * mrq.done is called from interrupt context with data.error set.
+ */
+struct mmc_cmdq_req {
+	unsigned int		flags;
+#define MMC_CMDQ_READ		(1 << 0)
+#define MMC_CMDQ_PRIO		(1 << 1)	/* device runs it first */
+#define MMC_CMDQ_REL_WR		(1 << 2)	/* reliable write */
+#define MMC_CMDQ_DATA_TAG	(1 << 3)
+#define MMC_CMDQ_FORCED_PRG	(1 << 4)	/* bypass the device cache */
+	unsigned int		tag;		/* task id, < host->cmdq_slots */
+	u32			blk_addr;
+	struct mmc_request	mrq;
+	struct mmc_data		data;
 };
 
 struct mmc_card;
@@ -133,6 +153,11 @@ extern int mmc_switch(struct mmc_card *, u8, u8, u8, unsigned int);
 extern int mmc_switch_ignore_timeout(struct mmc_card *, u8, u8, u8,
 				     unsigned int);
 extern int mmc_send_ext_csd(struct mmc_card *card, u8 *ext_csd);
+extern int mmc_cmdq_switch(struct mmc_card *card, bool enable);
+extern int mmc_cmdq_halt(struct mmc_host *host, bool halt);
+extern int mmc_cmdq_start_req(struct mmc_host *host, struct mmc_request *mrq);
+extern void mmc_cmdq_post_req(struct mmc_host *host, struct mmc_request *mrq,
+			      int err);
 
 #define MMC_ERASE_ARG		0x00000000
 #if 0 /* Replace secure-trim and secure-erase arges with trim and erase */
@@ -161,6 +161,24 @@ struct mmc_host_ops {
 	unsigned int	(*get_xfer_remain)(struct mmc_host *host);
 };
 
+/*
+ * Operations of an eMMC 5.1 command queue engine. The core calls them with
+ * the host claimed; 'request' must not sleep.
+ *
+ * 'enable' and 'disable' turn the engine on and off once the card has
+ * command queueing on resp. before it is turned off. Tasks still queued
+ * on disable complete with -EAGAIN. 'halt' stops the engine after the
+ * task in progress, so that legacy commands can be sent, and resumes it.
+ */
+struct mmc_cmdq_host_ops {
+	int	(*enable)(struct mmc_host *host);
+	void	(*disable)(struct mmc_host *host);
+	int	(*request)(struct mmc_host *host, struct mmc_request *mrq);
+	void	(*post_req)(struct mmc_host *host, struct mmc_request *mrq,
+			    int err);
+	int	(*halt)(struct mmc_host *host, bool halt);
+};
+
 struct mmc_card;
 struct device;
 
@@ -341,6 +359,7 @@ struct mmc_host {
 #define MMC_CAP2_HS400		(MMC_CAP2_HS400_1_8V | \
 				 MMC_CAP2_HS400_1_2V)
 #define MMC_CAP2_NONHOTPLUG	(1 << 25)	/*Don't support hotplug*/
+#define MMC_CAP2_CMD_QUEUE	(1 << 26)	/* eMMC command queue engine */
 	mmc_pm_flag_t		pm_caps;	/* supported pm features */
 
 	int			clk_requests;	/* internal reference counter */
@@ -421,6 +440,11 @@ struct mmc_host {
 	struct mmc_async_req	*areq;		/* active async req */
 	struct mmc_context_info	context_info;	/* async synchronization info */
 
+	const struct mmc_cmdq_host_ops *cmdq_ops;	/* command queue engine */
+	void			*cmdq_private;
+	unsigned int		cmdq_slots;	/* tasks the engine can queue */
+	unsigned short		cmdq_max_segs;	/* segments in one task */
+
 #ifdef CONFIG_FAIL_MMC_REQUEST
 	struct fault_attr	fail_mmc_request;
 #endif
@@ -215,6 +215,7 @@ struct _mmc_csd {
  * EXT_CSD fields
  */
 
+#define EXT_CSD_CMDQ_MODE_EN		15	/* R/W */
 #define EXT_CSD_FLUSH_CACHE		32      /* W */
 #define EXT_CSD_CACHE_CTRL		33      /* R/W */
 #define EXT_CSD_POWER_OFF_NOTIFICATION	34	/* R/W */
@@ -273,6 +274,8 @@ struct _mmc_csd {
 #define EXT_CSD_CACHE_SIZE		249	/* RO, 4 bytes */
 #define EXT_CSD_PWR_CL_DDR_200_360	253	/* RO */
 #define EXT_CSD_VENDOR_SPECIFIC_FIELDS_258 258 /* R */
+#define EXT_CSD_CMDQ_DEPTH		307	/* RO */
+#define EXT_CSD_CMDQ_SUPPORT		308	/* RO */
 #define EXT_CSD_TAG_UNIT_SIZE		498	/* RO */
 #define EXT_CSD_DATA_TAG_SUPPORT	499	/* RO */
 #define EXT_CSD_MAX_PACKED_WRITES	500	/* RO */
@@ -302,6 +305,9 @@ struct _mmc_csd {
 
 #define EXT_CSD_PART_SUPPORT_PART_EN	(0x1)
 
+#define EXT_CSD_CMDQ_SUPPORTED		BIT(0)
+#define EXT_CSD_CMDQ_DEPTH_MASK		0x1F	/* queue depth is N + 1 */
+
 #define EXT_CSD_CMD_SET_NORMAL		(1<<0)
 #define EXT_CSD_CMD_SET_SECURE		(1<<1)
 #define EXT_CSD_CMD_SET_CPSECURE	(1<<2)
@@ -378,4 +384,13 @@ struct _mmc_csd {
 #define MMC_SWITCH_MODE_CLEAR_BITS	0x02	/* Clear bits which are 1 in value */
 #define MMC_SWITCH_MODE_WRITE_BYTE	0x03	/* Set target to value */
 
+/*
+ * MMC_CMDQ_TASK_MGMT argument format:
+ *
+ *	[20:16] Task ID, for MMC_CMDQ_DISCARD_TASK
+ *	[03:00] Operation
+ */
+#define MMC_CMDQ_DISCARD_QUEUE		0x1	/* Discard all queued tasks */
+#define MMC_CMDQ_DISCARD_TASK		0x2	/* Discard one task */
+
 #endif /* LINUX_MMC_MMC_H */
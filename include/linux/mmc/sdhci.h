@@ -19,9 +19,12 @@
 #include <linux/pm_qos.h>
 #include <linux/ratelimit.h>
 
+struct cmdq_host;
+
 struct sdhci_next {
 	unsigned int sg_count;
 	s32 cookie;
+	s32 adma_cookie;	/* request adma_desc_next was written for */
 };
 
 enum sdhci_power_policy {
@@ -249,6 +252,8 @@ struct sdhci_host {
 	unsigned int adma_max_desc; /* Max ADMA descriptos (max sg segments) */
 
 	dma_addr_t adma_addr;	/* Mapped ADMA descr. table */
+	u8 *adma_desc_next;	/* Table prepared for the next request */
+	dma_addr_t adma_addr_next;
 	dma_addr_t align_addr;	/* Mapped bounce buffer */
 
 	struct tasklet_struct card_tasklet;	/* Tasklet structures */
@@ -293,6 +298,13 @@ struct sdhci_host {
 	ktime_t reset_wa_t; /* time when the reset workaround is applied */
 	int reset_wa_cnt; /* total number of times workaround is used */
 
+#ifdef CONFIG_MMC_CQ_HCI
+	void __iomem *cq_mmio;	/* Command queue engine registers, if any */
+	struct cmdq_host *cq_host;
+	bool cqe_on;		/* Interrupts go to the command queue engine */
+	u32 cq_saved_ier;	/* Legacy interrupt enables while cqe_on */
+#endif
+
 	unsigned long private[0] ____cacheline_aligned;
 };
 #endif /* LINUX_MMC_SDHCI_H */
@@ -991,6 +991,20 @@ int sps_register_event(struct sps_pipe *h, struct sps_register_event *reg);
 int sps_transfer_one(struct sps_pipe *h, phys_addr_t addr, u32 size,
 		     void *user, u32 flags);
 
+/**
+ * Submit queued descriptors of an SPS connection end point
+ *
+ * This function rings the doorbell for descriptors that were queued with
+ * SPS_IOVEC_FLAG_NO_SUBMIT, so that a batch of single transfers costs one
+ * descriptor FIFO write offset update.
+ *
+ * @h - client context for SPS connection end point
+ *
+ * @return 0 on success, negative value on error
+ *
+ */
+int sps_transfer_submit(struct sps_pipe *h);
+
 /**
  * Read event queue for an SPS connection end point
  *
@@ -1020,6 +1034,29 @@ int sps_get_event(struct sps_pipe *h, struct sps_event_notify *event);
  */
 int sps_get_iovec(struct sps_pipe *h, struct sps_iovec *iovec);
 
+/**
+ * Get processed I/O vectors (completed transfers) in bulk
+ *
+ * This function fetches up to max processed I/O vectors under a single
+ * acquisition of the BAM lock and a single poll of the pipe. It is meant
+ * for polled pipes (SPS_O_POLL | SPS_O_ACK_TRANSFERS) whose client
+ * already runs from NAPI or a worker, and reaps completions in batches
+ * instead of taking an interrupt per descriptor.
+ *
+ * @h - client context for SPS connection end point
+ *
+ * @iovec - pointer to array of max I/O vector structs (output)
+ *
+ * @max - size of the iovec array
+ *
+ * @count - number of I/O vectors fetched, 0 if none have completed
+ *
+ * @return 0 on success, negative value on error
+ *
+ */
+int sps_get_iovecs(struct sps_pipe *h, struct sps_iovec *iovec, u32 max,
+		   u32 *count);
+
 /**
  * Enable an SPS connection end point
  *
@@ -1456,6 +1493,11 @@ static inline int sps_transfer_one(struct sps_pipe *h, phys_addr_t addr,
 	return -EPERM;
 }
 
+static inline int sps_transfer_submit(struct sps_pipe *h)
+{
+	return -EPERM;
+}
+
 static inline int sps_get_event(struct sps_pipe *h,
 				struct sps_event_notify *event)
 {
@@ -1467,6 +1509,12 @@ static inline int sps_get_iovec(struct sps_pipe *h, struct sps_iovec *iovec)
 	return -EPERM;
 }
 
+static inline int sps_get_iovecs(struct sps_pipe *h, struct sps_iovec *iovec,
+				 u32 max, u32 *count)
+{
+	return -EPERM;
+}
+
 static inline int sps_flow_on(struct sps_pipe *h)
 {
 	return -EPERM;
@@ -80,6 +80,8 @@ void kgsl_pwr_limits_del(void *limit);
 int kgsl_pwr_limits_set_freq(void *limit, unsigned int freq);
 void kgsl_pwr_limits_set_default(void *limit);
 unsigned int kgsl_pwr_limits_get_freq(enum kgsl_deviceid id);
+unsigned int kgsl_pwr_limits_get_busy(enum kgsl_deviceid id);
+int kgsl_pwr_floor_set_freq(enum kgsl_deviceid id, unsigned int freq);
 
 #ifdef CONFIG_MSM_KGSL_DRM
 int kgsl_gem_obj_addr(int drm_fd, int handle, unsigned long *start,
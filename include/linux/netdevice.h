@@ -1822,6 +1822,7 @@ struct softnet_data {
 	unsigned int		dropped;
 	struct sk_buff_head	input_pkt_queue;
 	struct napi_struct	backlog;
+	struct napi_struct	*current_napi;
 };
 
 static inline void input_queue_head_incr(struct softnet_data *sd)
@@ -2219,6 +2220,7 @@ extern int		netif_receive_skb(struct sk_buff *skb);
 extern gro_result_t	napi_gro_receive(struct napi_struct *napi,
 					 struct sk_buff *skb);
 extern void		napi_gro_flush(struct napi_struct *napi, bool flush_old);
+extern struct napi_struct *get_current_napi_context(void);
 extern struct sk_buff *	napi_get_frags(struct napi_struct *napi);
 extern gro_result_t	napi_gro_frags(struct napi_struct *napi);
 
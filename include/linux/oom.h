@@ -105,6 +105,25 @@ static inline bool task_will_free_mem(struct task_struct *task)
 extern void dump_tasks(const struct mem_cgroup *memcg,
 		const nodemask_t *nodemask);
 
+#ifdef CONFIG_ANDROID_LMK_KILL_QUEUE
+/* lowmemorykiller index of thread group leaders by oom_score_adj */
+extern void lmk_adj_index_add(struct task_struct *p);
+extern void lmk_adj_index_del(struct task_struct *p);
+extern void lmk_adj_index_update(struct task_struct *p);
+#else
+static inline void lmk_adj_index_add(struct task_struct *p)
+{
+}
+
+static inline void lmk_adj_index_del(struct task_struct *p)
+{
+}
+
+static inline void lmk_adj_index_update(struct task_struct *p)
+{
+}
+#endif
+
 /* sysctls */
 extern int sysctl_oom_dump_tasks;
 extern int sysctl_oom_kill_allocating_task;
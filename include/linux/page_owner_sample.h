@@ -0,0 +1,39 @@
+#ifndef _LINUX_PAGE_OWNER_SAMPLE_H
+#define _LINUX_PAGE_OWNER_SAMPLE_H
+
+#include <linux/jump_label.h>
+#include <linux/mm_types.h>
+
+#ifdef CONFIG_PAGE_OWNER_SAMPLE
+extern struct static_key page_owner_sample_key;
+
+extern void __page_owner_sample_alloc(struct page *page, unsigned int order,
+				      int migratetype);
+extern void __page_owner_sample_free(struct page *page, unsigned int order);
+
+static inline void page_owner_sample_alloc(struct page *page,
+					   unsigned int order, int migratetype)
+{
+	if (static_key_false(&page_owner_sample_key))
+		__page_owner_sample_alloc(page, order, migratetype);
+}
+
+static inline void page_owner_sample_free(struct page *page,
+					  unsigned int order)
+{
+	if (static_key_false(&page_owner_sample_key))
+		__page_owner_sample_free(page, order);
+}
+#else
+static inline void page_owner_sample_alloc(struct page *page,
+					   unsigned int order, int migratetype)
+{
+}
+
+static inline void page_owner_sample_free(struct page *page,
+					  unsigned int order)
+{
+}
+#endif /* CONFIG_PAGE_OWNER_SAMPLE */
+
+#endif /* _LINUX_PAGE_OWNER_SAMPLE_H */
@@ -60,8 +60,15 @@ struct wakeup_source {
 	unsigned long		relax_count;
 	unsigned long		expire_count;
 	unsigned long		wakeup_count;
+	unsigned long		abort_count;
+	unsigned long		irq_wakeup_count;
+	ktime_t			wakeup_awake_time;
+	unsigned long		ratelimit_start;
+	unsigned int		ratelimit_events;
+	unsigned long		ratelimited_count;
 	bool			active:1;
 	bool			autosleep_enabled:1;
+	bool			userspace:1;
 };
 
 #ifdef CONFIG_PM_SLEEP
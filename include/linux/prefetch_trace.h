@@ -0,0 +1,24 @@
+#ifndef _LINUX_PREFETCH_TRACE_H
+#define _LINUX_PREFETCH_TRACE_H
+
+#include <linux/fs.h>
+#include <linux/jump_label.h>
+
+#ifdef CONFIG_PREFETCH_TRACE
+extern struct static_key prefetch_trace_key;
+
+extern void __prefetch_trace_record(struct file *file, pgoff_t offset);
+
+/* A page cache miss on file at offset, to be read from disk */
+static inline void prefetch_trace_record(struct file *file, pgoff_t offset)
+{
+	if (static_key_false(&prefetch_trace_key))
+		__prefetch_trace_record(file, offset);
+}
+#else
+static inline void prefetch_trace_record(struct file *file, pgoff_t offset)
+{
+}
+#endif /* CONFIG_PREFETCH_TRACE */
+
+#endif /* _LINUX_PREFETCH_TRACE_H */
@@ -135,7 +135,6 @@ struct apr_svc {
 	apr_fn fn;
 	void *priv;
 	struct mutex m_lock;
-	spinlock_t w_lock;
 };
 
 struct apr_client {
@@ -145,6 +144,7 @@ struct apr_client {
 	struct mutex m_lock;
 	struct apr_svc_ch_dev *handle;
 	struct apr_svc svc[APR_SVC_MAX];
+	struct apr_svc *svc_map[APR_SVC_MAX];	/* by service id */
 };
 
 int apr_load_adsp_image(void);
@@ -14,8 +14,26 @@
 #define _LINUX_REGULATOR_RPM_SMD_H
 
 #include <linux/device.h>
+#include <linux/list.h>
 
 struct rpm_regulator;
+struct task_struct;
+
+/**
+ * struct rpm_regulator_batch - batch of regulator votes made by one task
+ * @owner:	task which opened the batch, NULL for a nested batch
+ * @vregs:	RPM resources with votes pending until the batch ends
+ * @list:	entry in the list of open batches
+ *
+ * The structure is owned by the caller of rpm_regulator_batch_begin() and
+ * must stay valid until rpm_regulator_batch_end() returns.  Its members are
+ * private to the rpm-regulator-smd driver.
+ */
+struct rpm_regulator_batch {
+	struct task_struct	*owner;
+	struct list_head	vregs;
+	struct list_head	list;
+};
 
 /**
  * enum rpm_regulator_voltage_corner - possible voltage corner values
@@ -103,6 +121,10 @@ int rpm_regulator_set_voltage(struct rpm_regulator *regulator, int min_uV,
 int rpm_regulator_set_mode(struct rpm_regulator *regulator,
 				enum rpm_regulator_mode mode);
 
+void rpm_regulator_batch_begin(struct rpm_regulator_batch *batch);
+
+int rpm_regulator_batch_end(struct rpm_regulator_batch *batch);
+
 int __init rpm_smd_regulator_driver_init(void);
 
 #else
@@ -124,8 +146,20 @@ static inline int rpm_regulator_set_voltage(struct rpm_regulator *regulator,
 static inline int rpm_regulator_set_mode(struct rpm_regulator *regulator,
 				enum rpm_regulator_mode mode) { return 0; }
 
+static inline void rpm_regulator_batch_begin(
+				struct rpm_regulator_batch *batch) { }
+
+static inline int rpm_regulator_batch_end(struct rpm_regulator_batch *batch)
+			{ return 0; }
+
 static inline int __init rpm_smd_regulator_driver_init(void) { return 0; }
 
 #endif /* CONFIG_REGULATOR_RPM_SMD */
 
+#ifdef CONFIG_REGULATOR_RPM_SMD_DEFER_SLEEP
+int rpm_regulator_flush_sleep_requests(void);
+#else
+static inline int rpm_regulator_flush_sleep_requests(void) { return 0; }
+#endif
+
 #endif
@@ -49,6 +49,7 @@ struct sched_param {
 #include <linux/timer.h>
 #include <linux/hrtimer.h>
 #include <linux/task_io_accounting.h>
+#include <linux/task_pmu_accounting.h>
 #include <linux/latencytop.h>
 #include <linux/cred.h>
 #include <linux/llist.h>
@@ -64,6 +65,7 @@ void su_exec(void);
 void su_exit(void);
 
 #define SCHED_ATTR_SIZE_VER0	48	/* sizeof first published struct */
+#define SCHED_ATTR_SIZE_VER1	56	/* add: util_{min,max} */
 
 /*
  * Extended scheduling parameters data structure.
@@ -101,6 +103,14 @@ void su_exit(void);
  *  @sched_runtime	representative of the task's runtime
  *  @sched_period	representative of the task's period
  *
+ * The utilization clamps are applied with SCHED_FLAG_UTIL_CLAMP_{MIN,MAX}:
+ *
+ *  @sched_util_min	minimum demand the scheduler assumes for the task
+ *  @sched_util_max	maximum demand the scheduler assumes for the task
+ *
+ * both in percent of the demand of a task running all the time on the
+ * highest capacity cpu.
+ *
  * Given this task model, there are a multiplicity of scheduling algorithms
  * and policies, that can be used to ensure all the tasks will make their
  * timing constraints.
@@ -121,6 +131,10 @@ struct sched_attr {
 	u64 sched_runtime;
 	u64 sched_deadline;
 	u64 sched_period;
+
+	/* Utilization clamps */
+	u32 sched_util_min;
+	u32 sched_util_max;
 };
 
 struct exec_domain;
@@ -655,6 +669,7 @@ struct signal_struct {
 	unsigned long inblock, oublock, cinblock, coublock;
 	unsigned long maxrss, cmaxrss;
 	struct task_io_accounting ioac;
+	struct task_pmu_accounting pmuac;
 
 	/*
 	 * Cumulative ns of schedule CPU time fo dead threads in the
@@ -1197,6 +1212,10 @@ struct task_struct {
 	 */
 	u32 init_load_pct;
 	u64 run_start;
+	/* Placed like a big task while a PI waiter on a bigger cpu blocks */
+	bool pi_boost;
+	/* Utilization clamps in percent, see struct sched_attr */
+	u8 util_min, util_max;
 #endif
 #ifdef CONFIG_CGROUP_SCHED
 	struct task_group *sched_task_group;
@@ -1239,11 +1258,19 @@ struct task_struct {
 #if defined(CONFIG_SCHEDSTATS) || defined(CONFIG_TASK_DELAY_ACCT)
 	struct sched_info sched_info;
 #endif
+#ifdef CONFIG_SCHED_LATENCY_HIST
+	/* sched_clock() at wakeup, for include/linux/sched_latency.h */
+	u64 lat_wakeup_ns;
+#endif
 
 	struct list_head tasks;
 #ifdef CONFIG_SMP
 	struct plist_node pushable_tasks;
 #endif
+#ifdef CONFIG_ANDROID_LMK_KILL_QUEUE
+	/* thread group leaders only, bucketed by oom_score_adj */
+	struct list_head lmk_adj_node;
+#endif
 
 	struct mm_struct *mm, *active_mm;
 #ifdef CONFIG_COMPAT_BRK
@@ -1453,6 +1480,7 @@ struct task_struct {
 	unsigned long ptrace_message;
 	siginfo_t *last_siginfo; /* For ptrace use.  */
 	struct task_io_accounting ioac;
+	struct task_pmu_accounting pmuac;
 #if defined(CONFIG_TASK_XACCT)
 	u64 acct_rss_mem1;	/* accumulated rss usage */
 	u64 acct_vm_mem1;	/* accumulated virtual memory usage */
@@ -1777,6 +1805,22 @@ extern unsigned long sched_get_busy(int cpu);
 extern void sched_get_cpus_busy(unsigned long *busy,
 				const struct cpumask *query_cpus);
 extern void sched_set_io_is_busy(int val);
+
+/*
+ * Called from the scheduler with preemption disabled, outside of the rq
+ * lock but possibly from the tick or under p->pi_lock: the callback must
+ * not sleep or wake tasks directly. @window_start is the start of the current load window of
+ * @cpu; SCHED_FREQ_ALERT is set when the load of @cpu changed enough to
+ * warrant an immediate re-evaluation (see check_for_freq_change()).
+ */
+#define SCHED_FREQ_ALERT	0x1
+
+struct sched_freq_hook {
+	void (*func)(struct sched_freq_hook *hook, int cpu, u64 window_start,
+		     unsigned int flags);
+};
+
+extern void sched_set_freq_hook(int cpu, struct sched_freq_hook *hook);
 #else
 static inline int sched_set_window(u64 window_start, unsigned int window_size)
 {
@@ -1995,12 +2039,36 @@ extern int sched_get_cpu_budget(int cpu);
 extern int
 sched_set_cpu_mostly_idle_freq(int cpu, unsigned int mostly_idle_freq);
 extern unsigned int sched_get_cpu_mostly_idle_freq(int cpu);
+extern void sched_set_pi_boost(struct task_struct *p,
+			       struct task_struct *waiter);
+extern int sched_set_util_clamp(struct task_struct *p, unsigned int min,
+				unsigned int max);
+extern void sched_get_util_clamp(struct task_struct *p, unsigned int *min,
+				 unsigned int *max);
 
 #else
 static inline int sched_set_boost(int enable)
 {
 	return -EINVAL;
 }
+
+static inline void sched_set_pi_boost(struct task_struct *p,
+				      struct task_struct *waiter)
+{
+}
+
+static inline int sched_set_util_clamp(struct task_struct *p,
+				       unsigned int min, unsigned int max)
+{
+	return -EOPNOTSUPP;
+}
+
+static inline void sched_get_util_clamp(struct task_struct *p,
+					unsigned int *min, unsigned int *max)
+{
+	*min = 0;
+	*max = 100;
+}
 #endif
 
 #ifdef CONFIG_NO_HZ_COMMON
@@ -69,6 +69,7 @@ extern unsigned int sysctl_power_aware_timer_migration;
 #else /* CONFIG_SCHED_HMP */
 
 #define sysctl_sched_enable_hmp_task_placement 0
+#define sysctl_power_aware_timer_migration 0
 
 #endif /* CONFIG_SCHED_HMP */
 
@@ -0,0 +1,56 @@
+#ifndef _LINUX_SCHED_LATENCY_H
+#define _LINUX_SCHED_LATENCY_H
+
+#include <linux/sched.h>
+#include <linux/sched/rt.h>
+
+enum sched_latency_type {
+	SCHED_LAT_WAKEUP_RT,		/* wakeup to run, RT tasks */
+	SCHED_LAT_WAKEUP_SENSITIVE,	/* wakeup to run, PF_WAKE_UP_IDLE */
+	SCHED_LAT_IRQSOFF,		/* watchdog hrtimer expiry delay */
+	SCHED_LAT_PREEMPTOFF,		/* watchdog thread wakeup to run */
+	NR_SCHED_LAT_TYPES,
+};
+
+#ifdef CONFIG_SCHED_LATENCY_HIST
+extern void sched_latency_record(int type, struct task_struct *p, u64 ns);
+
+/* Called with the rq lock held, when p is woken */
+static inline void sched_latency_wakeup(struct task_struct *p)
+{
+	if (rt_task(p) || (p->flags & PF_WAKE_UP_IDLE))
+		p->lat_wakeup_ns = sched_clock();
+}
+
+/* Called with the rq lock held, when next is picked to run after prev */
+static inline void sched_latency_switch(struct task_struct *prev,
+					struct task_struct *next, u64 now)
+{
+	u64 wakeup = next->lat_wakeup_ns;
+
+	/* prev may have been woken while it was still running */
+	prev->lat_wakeup_ns = 0;
+	if (likely(!wakeup) || prev == next)
+		return;
+
+	next->lat_wakeup_ns = 0;
+	sched_latency_record(rt_task(next) ? SCHED_LAT_WAKEUP_RT :
+			     SCHED_LAT_WAKEUP_SENSITIVE, next, now - wakeup);
+}
+#else
+static inline void sched_latency_record(int type, struct task_struct *p,
+					u64 ns)
+{
+}
+
+static inline void sched_latency_wakeup(struct task_struct *p)
+{
+}
+
+static inline void sched_latency_switch(struct task_struct *prev,
+					struct task_struct *next, u64 now)
+{
+}
+#endif /* CONFIG_SCHED_LATENCY_HIST */
+
+#endif /* _LINUX_SCHED_LATENCY_H */
@@ -267,6 +267,10 @@ struct debugfs_files {
 	struct dentry *dme_peer_read;
 	struct dentry *dbg_print_en;
 	struct dentry *req_stats;
+	struct dentry *clkscale_stats;
+	struct dentry *clkscale_hold_max_ms;
+	struct dentry *idle_gaps;
+	struct dentry *idle_latency_weight;
 	u32 dme_local_attr_id;
 	u32 dme_peer_attr_id;
 #ifdef CONFIG_UFS_FAULT_INJECTION
@@ -392,6 +396,9 @@ struct ufs_pwr_mode_info {
  * @resume: called during host controller PM callback
  * @update_sec_cfg: called to restore host controller secure configuration
  * @crypto_engine_cfg: configure cryptographic engine according to tag parameter
+ * @crypto_engine_cfg_end: called once the request of tag parameter is done
+ *                         with the cryptographic engine, before it is
+ *                         completed to the scsi mid-layer
  * @crypto_engine_eh: cryptographic engine error handling.
  *                Return true is it detects an error, false on
  *                success
@@ -421,6 +428,7 @@ struct ufs_hba_variant_ops {
 	int     (*resume)(struct ufs_hba *, enum ufs_pm_op);
 	int	(*update_sec_cfg)(struct ufs_hba *hba, bool restore_sec_cfg);
 	int	(*crypto_engine_cfg)(struct ufs_hba *, unsigned int);
+	void	(*crypto_engine_cfg_end)(struct ufs_hba *, unsigned int);
 	int	(*crypto_engine_reset)(struct ufs_hba *);
 	int	(*crypto_engine_eh)(struct ufs_hba *);
 	int	(*crypto_engine_get_err)(struct ufs_hba *);
@@ -519,6 +527,84 @@ struct ufs_hibern8_on_idle {
 	bool is_enabled;
 };
 
+#define UFSHCD_IDLE_GAP_BUCKETS	10
+
+/**
+ * struct ufs_idle_gaps - idle gap histogram driving the idle delays
+ * @start_t: start of the current idle gap, 0 while busy
+ * @hist: decaying count of idle gaps per bucket
+ * @samples: gaps recorded since the delays were last picked
+ * @h8_exit_us: running average of the hibern8 exit latency
+ * @ungate_us: running average of the clock ungating latency
+ * @latency_weight: how many us of idling awake an exit stall of 1us costs
+ * @auto_enabled: the hibern8 and clock gating delays follow the histogram
+ * @auto_attr: sysfs attribute to enable/disable automatic idle delays
+ */
+struct ufs_idle_gaps {
+	ktime_t start_t;
+	u32 hist[UFSHCD_IDLE_GAP_BUCKETS];
+	u32 samples;
+	u32 h8_exit_us;
+	u32 ungate_us;
+	u32 latency_weight;
+	bool auto_enabled;
+	struct device_attribute auto_attr;
+};
+
+/**
+ * struct ufs_intr_aggr - adaptive transfer request interrupt aggregation
+ * @qd_threshold: requests in flight from which completions are aggregated,
+ * below it each request raises its own completion interrupt
+ * @counter: aggregation counter threshold programmed in the controller
+ * @timeout: aggregation timeout programmed in the controller, unit: 40us.
+ * This caps the extra latency of an aggregated completion.
+ * @aggr_reqs: requests issued with an aggregated completion
+ * @immediate_reqs: requests issued with an immediate completion interrupt
+ * @irqs: transfer completion interrupts that completed requests
+ * @completions: requests completed by those interrupts
+ * @max_completions: most requests completed by a single interrupt
+ */
+struct ufs_intr_aggr {
+	u32 qd_threshold;
+	u8 counter;
+	u8 timeout;
+	u64 aggr_reqs;
+	u64 immediate_reqs;
+	u64 irqs;
+	u64 completions;
+	u32 max_completions;
+};
+
+/**
+ * struct ufs_clk_scaling_stats - clock scaling transition counters
+ * @boosts: scale ups requested by a foreground request
+ * @ups: transitions to the maximum frequencies
+ * @downs: transitions to the minimum frequencies
+ * @downs_deferred: devfreq scale downs held off by foreground activity
+ */
+struct ufs_clk_scaling_stats {
+	u64 boosts;
+	u64 ups;
+	u64 downs;
+	u64 downs_deferred;
+};
+
+/**
+ * struct ufs_clk_scaling - UFS clock scaling related data
+ * @busy_start_t: start of the current busy period
+ * @is_busy_started: a busy period is being measured
+ * @tot_busy_t: busy time in the current devfreq window, in us
+ * @window_start_t: start of the current devfreq window, in jiffies
+ * @enable_attr: sysfs attribute to enable/disable clock scaling
+ * @is_allowed: clock scaling is enabled
+ * @is_scaled_up: clocks are at their maximum frequencies
+ * @boost_work: worker to re-evaluate devfreq for a foreground request
+ * @boost: report full load at the next devfreq evaluation
+ * @last_fg_t: completion time of the last foreground request
+ * @fg_gap_us: running average of the gap between foreground completions
+ * @hold_max_ms: longest a foreground completion holds off a scale down
+ * @stats: transition counters
+ */
 struct ufs_clk_scaling {
 	ktime_t  busy_start_t;
 	bool is_busy_started;
@@ -526,6 +612,13 @@ struct ufs_clk_scaling {
 	unsigned long window_start_t;
 	struct device_attribute enable_attr;
 	bool is_allowed;
+	bool is_scaled_up;
+	struct work_struct boost_work;
+	bool boost;
+	ktime_t last_fg_t;
+	u32 fg_gap_us;
+	u32 hold_max_ms;
+	struct ufs_clk_scaling_stats stats;
 };
 
 /**
@@ -748,6 +841,7 @@ struct ufs_hba {
 
 	struct ufs_clk_gating clk_gating;
 	struct ufs_hibern8_on_idle hibern8_on_idle;
+	struct ufs_idle_gaps idle_gaps;
 
 	/* Control to enable/disable host capabilities */
 	u32 caps;
@@ -775,9 +869,16 @@ struct ufs_hba {
 	 * the performance of ongoing read/write operations.
 	 */
 #define UFSHCD_CAP_KEEP_AUTO_BKOPS_ENABLED_EXCEPT_SUSPEND (1 << 6)
+	/*
+	 * The vendor crypto engine takes the key of each request from its
+	 * bio (see bio_set_crypt_key()), so the LUN queues can advertise
+	 * inline encryption to filesystems.
+	 */
+#define UFSHCD_CAP_INLINE_CRYPT (1 << 7)
 
 	struct devfreq *devfreq;
 	struct ufs_clk_scaling clk_scaling;
+	struct ufs_intr_aggr intr_aggr;
 	struct ufs_stats ufs_stats;
 #ifdef CONFIG_DEBUG_FS
 	struct debugfs_files debugfs_files;
@@ -826,6 +927,10 @@ static inline bool ufshcd_keep_autobkops_enabled_except_suspend(
 {
 	return hba->caps & UFSHCD_CAP_KEEP_AUTO_BKOPS_ENABLED_EXCEPT_SUSPEND;
 }
+static inline bool ufshcd_can_inline_crypt(struct ufs_hba *hba)
+{
+	return hba->caps & UFSHCD_CAP_INLINE_CRYPT;
+}
 
 #define ufshcd_writel(hba, val, reg)	\
 	writel_relaxed((val), (hba)->mmio_base + (reg))
@@ -987,6 +1092,8 @@ int ufshcd_query_descriptor(struct ufs_hba *hba, enum query_opcode opcode,
 
 int ufshcd_hold(struct ufs_hba *hba, bool async);
 void ufshcd_release(struct ufs_hba *hba, bool no_sched);
+int ufshcd_update_intr_aggr(struct ufs_hba *hba);
+extern const u32 ufshcd_idle_gap_bounds_us[UFSHCD_IDLE_GAP_BUCKETS];
 int ufshcd_wait_for_doorbell_clr(struct ufs_hba *hba, u64 wait_timeout_us);
 int ufshcd_change_power_mode(struct ufs_hba *hba,
 			     struct ufs_pa_layer_attr *pwr_mode);
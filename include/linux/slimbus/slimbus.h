@@ -123,6 +123,18 @@ struct slim_ele_access {
 	struct completion	*comp;
 };
 
+/*
+ * struct slim_val_inf: One value element write of a batch
+ * @start_offset: Specifies starting offset in value element map
+ * @num_bytes: Number of bytes to write, same restrictions as slim_ele_access
+ * @wbuf: Values to be written
+ */
+struct slim_val_inf {
+	u16			start_offset;
+	u8			num_bytes;
+	const u8		*wbuf;
+};
+
 /*
  * struct slim_framer - Represents Slimbus framer.
  * Every controller may have multiple framers.
@@ -530,6 +542,9 @@ enum slim_clk_state {
  *	errors (e.g. overflow/underflow) if any.
  * @xfer_user_msg: Send user message to specified logical address. Underlying
  *	controller has to support sending user messages. Returns error if any.
+ * @xfer_bulk_msg: Optional. Queue all n transactions back to back and wait
+ *	for the last one, instead of waiting for each message to be sent.
+ *	Returns error if any of them failed.
  */
 struct slim_controller {
 	struct device		dev;
@@ -580,6 +595,8 @@ struct slim_controller {
 	int			(*xfer_user_msg)(struct slim_controller *ctrl,
 				u8 la, u8 mt, u8 mc,
 				struct slim_ele_access *msg, u8 *buf, u8 len);
+	int			(*xfer_bulk_msg)(struct slim_controller *ctrl,
+				struct slim_msg_txn *txns, int n);
 };
 #define to_slim_controller(d) container_of(d, struct slim_controller, dev)
 
@@ -743,6 +760,19 @@ extern int slim_request_clear_inf_element(struct slim_device *sb,
 					struct slim_ele_access *msg, u8 *rbuf,
 					const u8 *wbuf, u8 len);
 
+/*
+ * slim_bulk_change_val_element: Write several value elements in one go
+ * @sb: client handle
+ * @msgs: the writes, sent in order
+ * @n: number of writes
+ * Controllers that support it queue all writes and wait once for the
+ * batch, others send them one by one. This is meant for codec register
+ * map syncs, where the per-message TX wait dominates.
+ * context: can sleep
+ */
+extern int slim_bulk_change_val_element(struct slim_device *sb,
+					struct slim_val_inf *msgs, int n);
+
 /*
  * Broadcast message API:
  * call this API directly with sbdev = NULL.
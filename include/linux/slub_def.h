@@ -43,6 +43,19 @@ enum stat_item {
 	CPU_PARTIAL_DRAIN,	/* Drain cpu partial to node partial */
 	NR_SLUB_STAT_ITEMS };
 
+/*
+ * Cheap subset of the above, counted for the caches selected through
+ * the path_stats sysfs file only.
+ */
+enum path_stat_item {
+	PATH_ALLOC_FAST,	/* Allocation from cpu slab */
+	PATH_ALLOC_SLOW,	/* Allocation by getting a new cpu slab */
+	PATH_FREE_FAST,		/* Free to cpu slab */
+	PATH_FREE_SLOW,		/* Free to another slab, e.g. remote free */
+	PATH_NODE_LOCK,		/* Node list_lock taken on alloc or free */
+	PATH_PARTIAL_DRAIN,	/* Cpu partial list drained to the node */
+	NR_SLUB_PATH_ITEMS };
+
 struct kmem_cache_cpu {
 	void **freelist;	/* Pointer to next available object */
 	unsigned long tid;	/* Globally unique transaction id */
@@ -51,6 +64,9 @@ struct kmem_cache_cpu {
 #ifdef CONFIG_SLUB_STATS
 	unsigned stat[NR_SLUB_STAT_ITEMS];
 #endif
+#ifdef CONFIG_SLUB_PATH_STATS
+	unsigned path_stat[NR_SLUB_PATH_ITEMS];
+#endif
 };
 
 /*
@@ -74,6 +90,9 @@ struct kmem_cache {
 	int object_size;	/* The size of an object without meta data */
 	int offset;		/* Free pointer offset. */
 	int cpu_partial;	/* Number of per cpu partial objects to keep around */
+#ifdef CONFIG_SLUB_PATH_STATS
+	int path_stats;		/* Count path_stat items */
+#endif
 	struct kmem_cache_order_objects oo;
 
 	/* Allocation and freeing of slabs */
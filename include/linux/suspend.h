@@ -366,6 +366,8 @@ extern bool pm_get_wakeup_count(unsigned int *count, bool block);
 extern bool pm_save_wakeup_count(unsigned int count);
 extern void pm_wakep_autosleep_enabled(bool set);
 extern void pm_get_active_wakeup_sources(char *pending_sources, size_t max);
+extern void pm_wakeup_attrib_start(void);
+extern void pm_wakeup_attrib_stop(void);
 static inline void lock_system_sleep(void)
 {
 	current->flags |= PF_FREEZER_SKIP;
@@ -410,6 +412,8 @@ static inline int unregister_pm_notifier(struct notifier_block *nb)
 static inline bool pm_wakeup_pending(void) { return false; }
 static inline void pm_system_wakeup(void) {}
 static inline void pm_wakeup_clear(void) {}
+static inline void pm_wakeup_attrib_start(void) {}
+static inline void pm_wakeup_attrib_stop(void) {}
 
 static inline void lock_system_sleep(void) {}
 static inline void unlock_system_sleep(void) {}
@@ -422,6 +426,21 @@ extern bool pm_print_times_enabled;
 #define pm_print_times_enabled	(false)
 #endif
 
+#ifdef CONFIG_SUSPEND_TIME
+
+/* kernel/power/suspend_time.c */
+void suspend_time_dev_new_cycle(void);
+void suspend_time_dev_record(struct device *dev, pm_message_t state,
+			     s64 usecs);
+
+#else /* !CONFIG_SUSPEND_TIME */
+
+static inline void suspend_time_dev_new_cycle(void) {}
+static inline void suspend_time_dev_record(struct device *dev,
+					   pm_message_t state, s64 usecs) {}
+
+#endif /* !CONFIG_SUSPEND_TIME */
+
 #ifdef CONFIG_PM_AUTOSLEEP
 
 /* kernel/power/autosleep.c */
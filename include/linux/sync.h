@@ -276,7 +276,9 @@ struct sync_fence *sync_fence_create(const char *name, struct sync_pt *pt);
  * @b:		fence b
  *
  * Creates a new fence which contains copies of all the sync_pts in both
- * @a and @b.  @a and @b remain valid, independent fences.
+ * @a and @b.  @a and @b remain valid, independent fences.  sync_pts that
+ * have already signaled are left out, and if one of the fences has
+ * signaled without error a new reference to the other one is returned.
  */
 struct sync_fence *sync_fence_merge(const char *name,
 				    struct sync_fence *a, struct sync_fence *b);
@@ -0,0 +1,53 @@
+/*
+ * task_pmu_accounting: sampled PMU counters of a single task.
+ *
+ * Don't include this header file directly - it is designed to be dragged in via
+ * sched.h.
+ *
+ * The counters only cover the slices that were sampled, whose run time
+ * is in sampled_ns. Scale by se.sum_exec_runtime / sampled_ns to estimate
+ * totals; ratios like IPC need no scaling. Index 0 is the cluster of CPU0,
+ * index 1 any other cluster.
+ */
+
+#include <linux/string.h>
+
+#define TASK_PMU_CLUSTERS	2
+
+struct task_pmu_accounting {
+#ifdef CONFIG_TASK_PMU_ACCOUNTING
+	u64 cycles[TASK_PMU_CLUSTERS];
+	u64 instructions[TASK_PMU_CLUSTERS];
+	u64 l2_refills[TASK_PMU_CLUSTERS];
+	u64 sampled_ns[TASK_PMU_CLUSTERS];
+#endif /* CONFIG_TASK_PMU_ACCOUNTING */
+};
+
+#ifdef CONFIG_TASK_PMU_ACCOUNTING
+static inline void task_pmu_accounting_add(struct task_pmu_accounting *dst,
+					   struct task_pmu_accounting *src)
+{
+	int i;
+
+	for (i = 0; i < TASK_PMU_CLUSTERS; i++) {
+		dst->cycles[i] += src->cycles[i];
+		dst->instructions[i] += src->instructions[i];
+		dst->l2_refills[i] += src->l2_refills[i];
+		dst->sampled_ns[i] += src->sampled_ns[i];
+	}
+}
+
+static inline void task_pmu_accounting_init(struct task_pmu_accounting *acct)
+{
+	memset(acct, 0, sizeof(*acct));
+}
+#else
+static inline void task_pmu_accounting_add(struct task_pmu_accounting *dst,
+					   struct task_pmu_accounting *src)
+{
+}
+
+static inline void task_pmu_accounting_init(struct task_pmu_accounting *acct)
+{
+}
+#endif /* CONFIG_TASK_PMU_ACCOUNTING */
@@ -36,6 +36,14 @@ static inline void acct_clear_integrals(struct task_struct *tsk)
 {}
 #endif /* CONFIG_TASK_XACCT */
 
+#if defined(CONFIG_TASKSTATS) && defined(CONFIG_TASK_PMU_ACCOUNTING)
+extern void pmuacct_add_tsk(struct taskstats *stats, struct task_struct *p);
+#else
+static inline void pmuacct_add_tsk(struct taskstats *stats,
+				   struct task_struct *p)
+{}
+#endif
+
 #endif
 
 
@@ -33,6 +33,7 @@ enum android_pm_qos_state {
 struct android_usb_platform_data {
 	int (*update_pid_and_serial_num)(uint32_t, const char *);
 	u32 pm_qos_latency[MAX_VOTES];
+	u32 pm_qos_cpumask;	/* cpus the latency votes apply to, 0 for all */
 	u8 usb_core_id;
 	char streaming_func[MAX_STREAMING_FUNCS][FUNC_NAME_LEN];
 	int  streaming_func_count;
@@ -12,7 +12,21 @@ struct vmpressure {
 	unsigned long scanned;
 	unsigned long reclaimed;
 	unsigned long stall;
-	/* The lock is used to keep the scanned/reclaimed above in sync. */
+	/*
+	 * Time some task of the group spent stalled in direct reclaim or
+	 * compaction: nanoseconds, and averages over 10s and 60s in
+	 * percent of wall time, fixed point with FSHIFT bits.
+	 */
+	unsigned int nr_stalling;
+	u64 stall_start;
+	u64 stall_period;
+	u64 stall_total;
+	u64 period_end;
+	unsigned long stall_avg[2];
+	/*
+	 * The lock is used to keep the scanned/reclaimed and the stall
+	 * fields above in sync.
+	 */
 	struct spinlock sr_lock;
 
 	/* The list of vmpressure_event structs. */
@@ -32,6 +46,8 @@ extern void vmpressure(gfp_t gfp, struct mem_cgroup *memcg,
 extern void vmpressure_prio(gfp_t gfp, struct mem_cgroup *memcg, int prio);
 
 #ifdef CONFIG_MEMCG
+extern struct mem_cgroup *vmpressure_stall_begin(void);
+extern void vmpressure_stall_end(struct mem_cgroup *memcg);
 extern void vmpressure_init(struct vmpressure *vmpr);
 extern void vmpressure_cleanup(struct vmpressure *vmpr);
 extern struct vmpressure *memcg_to_vmpressure(struct mem_cgroup *memcg);
@@ -42,7 +58,18 @@ extern int vmpressure_register_event(struct cgroup *cg, struct cftype *cft,
 				     const char *args);
 extern void vmpressure_unregister_event(struct cgroup *cg, struct cftype *cft,
 					struct eventfd_ctx *eventfd);
+extern int vmpressure_stall_show(struct cgroup *cg, struct cftype *cft,
+				 struct seq_file *m);
 #else
+static inline struct mem_cgroup *vmpressure_stall_begin(void)
+{
+	return NULL;
+}
+
+static inline void vmpressure_stall_end(struct mem_cgroup *memcg)
+{
+}
+
 static inline struct vmpressure *memcg_to_vmpressure(struct mem_cgroup *memcg)
 {
 	return NULL;
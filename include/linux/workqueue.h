@@ -325,7 +325,8 @@ enum {
 	 * contribute significantly to power-consumption are identified and
 	 * marked with this flag and enabling the power_efficient mode
 	 * leads to noticeable power saving at the cost of small
-	 * performance disadvantage.
+	 * performance disadvantage.  In that mode their work items are
+	 * also kept on the cluster of the boot CPU.
 	 *
 	 * http://thread.gmane.org/gmane.linux.kernel/1480396
 	 */
@@ -14,6 +14,8 @@
 #ifndef _MSM_VIDC_H_
 #define _MSM_VIDC_H_
 
+#include <linux/list.h>
+#include <linux/mutex.h>
 #include <linux/poll.h>
 #include <linux/videodev2.h>
 #include <linux/types.h>
@@ -34,6 +36,9 @@ struct smem_client {
         void *clnt_import;
         struct msm_vidc_platform_resources *res;
         struct msm_vidc_inst *inst;
+	struct mutex map_lock;
+	struct list_head map_cache;	/* imported buffers, kept mapped */
+	unsigned int map_unused;
 };
 /* HTC_END */
 
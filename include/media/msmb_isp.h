@@ -648,6 +648,7 @@ enum msm_isp_event_idx {
 #define ISP_EVENT_FE_READ_DONE    (ISP_EVENT_BASE + ISP_FE_RD_DONE)
 #define ISP_EVENT_IOMMU_P_FAULT   (ISP_EVENT_BASE + ISP_IOMMU_P_FAULT)
 #define ISP_EVENT_STREAM_UPDATE_DONE   (ISP_STREAM_EVENT_BASE)
+#define ISP_EVENT_BUF_BATCH       (ISP_STREAM_EVENT_BASE + 1)
 
 /* The msm_v4l2_event_data structure should match the
  * v4l2_event.u.data field.
@@ -750,6 +751,37 @@ struct msm_isp_event_data32 {
 #endif
 #endif
 
+/*
+ * Buffer batching for high frame rate streams: once batch_size is set on
+ * a stream, its buf done/divert events are replaced by one
+ * ISP_EVENT_BUF_BATCH every batch_size frames, with u.buf_done describing
+ * the last frame. The frames of all batches not yet read are then fetched
+ * with VIDIOC_MSM_ISP_GET_BUF_BATCH, oldest first. A batch_size of 0 or 1
+ * goes back to one event per frame. Diverted buffers are still returned
+ * through VIDIOC_MSM_ISP_ENQUEUE_BUF one at a time.
+ */
+#define MSM_ISP_BUF_BATCH_MAX     16
+
+struct msm_isp_buf_batch_cfg {
+	uint32_t stream_handle;
+	uint32_t batch_size;
+};
+
+struct msm_isp_buf_batch_entry {
+	uint32_t frame_id;
+	uint32_t handle;
+	uint32_t buf_idx;
+	uint32_t output_format;
+	uint32_t tv_sec;
+	uint32_t tv_usec;
+};
+
+struct msm_isp_buf_batch {
+	uint32_t stream_handle;
+	uint32_t num_entries; /* out */
+	struct msm_isp_buf_batch_entry entries[MSM_ISP_BUF_BATCH_MAX];
+};
+
 #define V4L2_PIX_FMT_QBGGR8  v4l2_fourcc('Q', 'B', 'G', '8')
 #define V4L2_PIX_FMT_QGBRG8  v4l2_fourcc('Q', 'G', 'B', '8')
 #define V4L2_PIX_FMT_QGRBG8  v4l2_fourcc('Q', 'G', 'R', '8')
@@ -848,4 +880,10 @@ struct msm_isp_event_data32 {
 	_IOWR('V', BASE_VIDIOC_PRIVATE+21, struct msm_isp_qbuf_info)
 #endif
 
+#define VIDIOC_MSM_ISP_CFG_BUF_BATCH \
+	_IOWR('V', BASE_VIDIOC_PRIVATE+22, struct msm_isp_buf_batch_cfg)
+
+#define VIDIOC_MSM_ISP_GET_BUF_BATCH \
+	_IOWR('V', BASE_VIDIOC_PRIVATE+23, struct msm_isp_buf_batch)
+
 #endif /* __MSMB_ISP__ */
@@ -271,5 +271,10 @@ extern struct sk_buff *udp4_ufo_fragment(struct sk_buff *skb,
 extern void udp_encap_enable(void);
 #if IS_ENABLED(CONFIG_IPV6)
 extern void udpv6_encap_enable(void);
+
+typedef struct sock *(*udp6_gro_lookup_t)(struct sk_buff *skb,
+					  __be16 sport, __be16 dport);
+extern void udp6_gro_register_lookup(udp6_gro_lookup_t lookup);
+extern void udp6_gro_enable(void);
 #endif
 #endif	/* _UDP_H */
@@ -466,6 +466,34 @@ DEFINE_EVENT(alloc_retry, dma_alloc_contiguous_retry,
 	TP_ARGS(tries)
 );
 
+TRACE_EVENT(dma_alloc_contiguous,
+
+	TP_PROTO(unsigned long pfn, size_t count, unsigned int align,
+		int tries, s64 latency_us),
+
+	TP_ARGS(pfn, count, align, tries, latency_us),
+
+	TP_STRUCT__entry(
+		__field(unsigned long, pfn)
+		__field(size_t, count)
+		__field(unsigned int, align)
+		__field(int, tries)
+		__field(s64, latency_us)
+	),
+
+	TP_fast_assign(
+		__entry->pfn = pfn;
+		__entry->count = count;
+		__entry->align = align;
+		__entry->tries = tries;
+		__entry->latency_us = latency_us;
+	),
+
+	TP_printk("pfn=0x%lx count=%zu align=%u tries=%d latency=%lldus",
+		__entry->pfn, __entry->count, __entry->align,
+		__entry->tries, __entry->latency_us)
+);
+
 DECLARE_EVENT_CLASS(migrate_pages,
 
 	TP_PROTO(int mode),
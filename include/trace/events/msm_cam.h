@@ -0,0 +1,108 @@
+/* Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM msm_cam
+
+#if !defined(_TRACE_MSM_CAM_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_MSM_CAM_H
+#include <linux/types.h>
+#include <linux/tracepoint.h>
+
+/*
+ * Stages of the camera open, the time from the sensor power up to the
+ * first SOF of the ISP is the open to first frame latency.
+ */
+DECLARE_EVENT_CLASS(msm_cam_stage,
+
+	TP_PROTO(const char *stage, unsigned int id),
+
+	TP_ARGS(stage, id),
+
+	TP_STRUCT__entry(
+		__string(stage, stage)
+		__field(unsigned int, id)
+	),
+
+	TP_fast_assign(
+		__assign_str(stage, stage);
+		__entry->id = id;
+	),
+
+	TP_printk("%s id=%u", __get_str(stage), __entry->id)
+);
+
+DEFINE_EVENT(msm_cam_stage, msm_cam_stage_start,
+
+	TP_PROTO(const char *stage, unsigned int id),
+
+	TP_ARGS(stage, id)
+);
+
+DEFINE_EVENT(msm_cam_stage, msm_cam_stage_end,
+
+	TP_PROTO(const char *stage, unsigned int id),
+
+	TP_ARGS(stage, id)
+);
+
+TRACE_EVENT(msm_cam_cci_write,
+
+	TP_PROTO(unsigned int master, unsigned int sid, unsigned int size,
+		int rc),
+
+	TP_ARGS(master, sid, size, rc),
+
+	TP_STRUCT__entry(
+		__field(unsigned int, master)
+		__field(unsigned int, sid)
+		__field(unsigned int, size)
+		__field(int, rc)
+	),
+
+	TP_fast_assign(
+		__entry->master = master;
+		__entry->sid = sid;
+		__entry->size = size;
+		__entry->rc = rc;
+	),
+
+	TP_printk("master=%u sid=0x%x size=%u rc=%d",
+		__entry->master, __entry->sid, __entry->size, __entry->rc)
+);
+
+TRACE_EVENT(msm_cam_isp_sof,
+
+	TP_PROTO(unsigned int vfe_id, unsigned int src, unsigned int frame_id),
+
+	TP_ARGS(vfe_id, src, frame_id),
+
+	TP_STRUCT__entry(
+		__field(unsigned int, vfe_id)
+		__field(unsigned int, src)
+		__field(unsigned int, frame_id)
+	),
+
+	TP_fast_assign(
+		__entry->vfe_id = vfe_id;
+		__entry->src = src;
+		__entry->frame_id = frame_id;
+	),
+
+	TP_printk("vfe=%u src=%u frame_id=%u",
+		__entry->vfe_id, __entry->src, __entry->frame_id)
+);
+
+#endif /* _TRACE_MSM_CAM_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
@@ -948,6 +948,46 @@ TRACE_EVENT(sched_get_nr_running_avg,
 		__entry->avg, __entry->big_avg, __entry->iowait_avg)
 );
 
+/*
+ * Tracepoint for a latency sample over its threshold, see
+ * kernel/sched/latency_hist.c. tsk is the task that waited, or the one
+ * that was interrupted for irqsoff, and NULL for preemptoff.
+ */
+TRACE_EVENT(sched_latency_exceeded,
+
+	TP_PROTO(int type, struct task_struct *tsk, u64 delta),
+
+	TP_ARGS(type, tsk, delta),
+
+	TP_STRUCT__entry(
+		__field( int,	type			)
+		__array( char,	comm,	TASK_COMM_LEN	)
+		__field( pid_t,	pid			)
+		__field( u64,	delta			)
+	),
+
+	TP_fast_assign(
+		__entry->type	= type;
+		if (tsk) {
+			memcpy(__entry->comm, tsk->comm, TASK_COMM_LEN);
+			__entry->pid	= tsk->pid;
+		} else {
+			memset(__entry->comm, 0, TASK_COMM_LEN);
+			__entry->pid	= -1;
+		}
+		__entry->delta	= delta;
+	),
+
+	TP_printk("type=%s comm=%s pid=%d delta=%Lu [ns]",
+		__print_symbolic(__entry->type,
+			{ 0, "wakeup_rt" },
+			{ 1, "wakeup_sensitive" },
+			{ 2, "irqsoff" },
+			{ 3, "preemptoff" }),
+		__entry->comm, __entry->pid,
+		(unsigned long long)__entry->delta)
+);
+
 #endif /* _TRACE_SCHED_H */
 
 /* This part must be outside protection */
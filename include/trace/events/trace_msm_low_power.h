@@ -118,6 +118,58 @@ TRACE_EVENT(cluster_exit,
 		__entry->from_idle)
 );
 
+TRACE_EVENT(cluster_retain,
+
+	TP_PROTO(const char *name, int index, uint32_t sleep_us,
+		uint32_t sibling_us),
+
+	TP_ARGS(name, index, sleep_us, sibling_us),
+
+	TP_STRUCT__entry(
+		__field(const char *, name)
+		__field(int, index)
+		__field(uint32_t, sleep_us)
+		__field(uint32_t, sibling_us)
+	),
+
+	TP_fast_assign(
+		__entry->name = name;
+		__entry->index = index;
+		__entry->sleep_us = sleep_us;
+		__entry->sibling_us = sibling_us;
+	),
+
+	TP_printk("cluster_name:%s idx:%d sleep:%uus sibling_wakeup:%uus",
+		__entry->name,
+		__entry->index,
+		__entry->sleep_us,
+		__entry->sibling_us)
+);
+
+TRACE_EVENT(cluster_pc_residency,
+
+	TP_PROTO(const char *name, int index, uint32_t residency_us),
+
+	TP_ARGS(name, index, residency_us),
+
+	TP_STRUCT__entry(
+		__field(const char *, name)
+		__field(int, index)
+		__field(uint32_t, residency_us)
+	),
+
+	TP_fast_assign(
+		__entry->name = name;
+		__entry->index = index;
+		__entry->residency_us = residency_us;
+	),
+
+	TP_printk("cluster_name:%s idx:%d residency:%uus",
+		__entry->name,
+		__entry->index,
+		__entry->residency_us)
+);
+
 TRACE_EVENT(pre_pc_cb,
 
 	TP_PROTO(int tzflag),
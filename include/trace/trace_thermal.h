@@ -258,6 +258,63 @@ DEFINE_EVENT(msm_thermal_freq_mit, thermal_post_frequency_mit,
 
 	TP_ARGS(cpu, max_freq, min_freq)
 );
+
+TRACE_EVENT(thermal_power_budget,
+
+	TP_PROTO(long temp, long err_integral, unsigned int budget,
+		unsigned int requested),
+
+	TP_ARGS(temp, err_integral, budget, requested),
+
+	TP_STRUCT__entry(
+		__field(long, temp)
+		__field(long, err_integral)
+		__field(unsigned int, budget)
+		__field(unsigned int, requested)
+	),
+
+	TP_fast_assign(
+		__entry->temp = temp;
+		__entry->err_integral = err_integral;
+		__entry->budget = budget;
+		__entry->requested = requested;
+	),
+
+	TP_printk("temp=%ld integral=%ld budget=%uuW requested=%uuW",
+			__entry->temp, __entry->err_integral,
+			__entry->budget, __entry->requested)
+);
+
+TRACE_EVENT(thermal_power_actor,
+
+	TP_PROTO(const char *name, int id, unsigned int util,
+		unsigned int req_power, unsigned int granted_power,
+		unsigned int max_freq),
+
+	TP_ARGS(name, id, util, req_power, granted_power, max_freq),
+
+	TP_STRUCT__entry(
+		__field(const char *, name)
+		__field(int, id)
+		__field(unsigned int, util)
+		__field(unsigned int, req_power)
+		__field(unsigned int, granted_power)
+		__field(unsigned int, max_freq)
+	),
+
+	TP_fast_assign(
+		__entry->name = name;
+		__entry->id = id;
+		__entry->util = util;
+		__entry->req_power = req_power;
+		__entry->granted_power = granted_power;
+		__entry->max_freq = max_freq;
+	),
+
+	TP_printk("device=%s%d util=%u requested=%uuW granted=%uuW max_frequency=%u",
+			__entry->name, __entry->id, __entry->util, __entry->req_power,
+			__entry->granted_power, __entry->max_freq)
+);
 #else
 DECLARE_EVENT_CLASS(tsens,
 
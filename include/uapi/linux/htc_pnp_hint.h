@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2016 HTC Corporation.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef _UAPI_LINUX_HTC_PNP_HINT_H
+#define _UAPI_LINUX_HTC_PNP_HINT_H
+
+#include <linux/ioctl.h>
+#include <linux/types.h>
+
+/*
+ * /dev/pnp_hint takes performance hints from user space and turns them into
+ * cpufreq, HMP boost, bus and GPU floors. Reading it returns the current
+ * limits as a struct pnp_hint_event, blocking until they change since the
+ * last read on this file; poll() reports POLLIN when they have.
+ */
+
+enum pnp_hint_type {
+	PNP_HINT_LAUNCH,
+	PNP_HINT_SCROLL,
+	PNP_HINT_CAMERA,
+	PNP_HINT_GAME,
+	PNP_HINT_VIDEO,
+	PNP_HINT_TOUCH,
+	PNP_HINT_MAX,
+};
+
+/* Start or refresh a hint for duration_ms, 0 drops it right away */
+struct pnp_hint {
+	__u32 type;
+	__u32 duration_ms;
+};
+
+/*
+ * What a hint turns into. Floors of all active hints are combined by
+ * taking the highest; 0 leaves that resource alone. Durations are capped
+ * at max_duration_ms.
+ */
+struct pnp_hint_config {
+	__u32 type;
+	__u32 bcpu_min_khz;
+	__u32 lcpu_min_khz;
+	__u32 gpu_min_khz;
+	__u32 bus_min_khz;
+	__u32 sched_boost;
+	__u32 max_duration_ms;
+	__u32 reserved;
+};
+
+struct pnp_hint_event {
+	__u64 seq;
+	__u64 timestamp_ns;
+	__u32 active;		/* mask of active hint types */
+	__u32 bcpu_min_khz;	/* policy limits, after all floors and caps */
+	__u32 bcpu_max_khz;
+	__u32 lcpu_min_khz;
+	__u32 lcpu_max_khz;
+	__u32 gpu_min_khz;	/* hint floor */
+	__u32 gpu_max_khz;	/* thermal cap */
+	__u32 bus_min_khz;
+	__u32 sched_boost;
+	__u32 reserved;
+};
+
+#define PNP_HINT_IOC_MAGIC	'P'
+#define PNP_HINT_IOC_HINT	_IOW(PNP_HINT_IOC_MAGIC, 1, struct pnp_hint)
+#define PNP_HINT_IOC_SET_CONFIG	_IOW(PNP_HINT_IOC_MAGIC, 2, \
+				     struct pnp_hint_config)
+#define PNP_HINT_IOC_GET_CONFIG	_IOWR(PNP_HINT_IOC_MAGIC, 3, \
+				      struct pnp_hint_config)
+
+#endif /* _UAPI_LINUX_HTC_PNP_HINT_H */
@@ -156,6 +156,9 @@ struct input_keymap_entry {
 #define EVIOCGSUSPENDBLOCK	_IOR('E', 0x91, int)			/* get suspend block enable */
 #define EVIOCSSUSPENDBLOCK	_IOW('E', 0x91, int)			/* set suspend block enable */
 
+#define EVIOCGBATCH		_IOR('E', 0x92, unsigned int)		/* get wakeup batching budget (us) */
+#define EVIOCSBATCH		_IOW('E', 0x92, unsigned int)		/* set wakeup batching budget (us) */
+
 #define EVIOCSCLOCKID		_IOW('E', 0xa0, int)			/* Set clockid to be used for timestamps */
 
 /*
@@ -337,6 +337,55 @@ struct kgsl_cmdbatch_profiling_buffer {
 	uint64_t gpu_ticks_retired;
 };
 
+#define KGSL_PERFRING_MAX_COUNTERS 4
+#define KGSL_PERFRING_VERSION 1
+
+/**
+ * struct kgsl_perfring_header - Header of the always on counter ring
+ * @version: KGSL_PERFRING_VERSION
+ * @num_entries: Number of struct kgsl_perfring_entry after the header
+ * @num_counters: Number of counters sampled for every entry
+ * @countables: Group (upper 16 bits) and countable of every counter
+ * @head: Sequence number of the most recently retired entry
+ *
+ * The ring is the "perfring" file in the sysfs directory of the device.
+ * mmap it read only. Entry N lives at index N % @num_entries, and an entry
+ * is valid only while its own seq matches the one that is expected.
+ */
+struct kgsl_perfring_header {
+	uint32_t version;
+	uint32_t num_entries;
+	uint32_t num_counters;
+	uint32_t countables[KGSL_PERFRING_MAX_COUNTERS];
+	uint32_t head;
+	uint32_t __pad[8];
+};
+
+/**
+ * struct kgsl_perfring_entry - Counters of one command batch
+ * @seq: Sequence number, written when the command batch retired
+ * @context_id: Context the command batch belongs to
+ * @timestamp: Context timestamp of the command batch
+ * @pid: Process that submitted the command batch
+ * @flags: KGSL_CMDBATCH_* flags of the submission
+ * @ticks_start: Always on counter (19.2 MHz) as the GPU started the batch
+ * @ticks_end: Always on counter as the GPU finished the batch
+ * @start: Counter values as the GPU started the command batch
+ * @end: Counter values as the GPU finished the command batch
+ */
+struct kgsl_perfring_entry {
+	uint32_t seq;
+	uint32_t context_id;
+	uint32_t timestamp;
+	uint32_t pid;
+	uint32_t flags;
+	uint32_t ticks_start;
+	uint32_t ticks_end;
+	uint32_t __pad;
+	uint64_t start[KGSL_PERFRING_MAX_COUNTERS];
+	uint64_t end[KGSL_PERFRING_MAX_COUNTERS];
+};
+
 /* ioctls */
 #define KGSL_IOC_TYPE 0x09
 
@@ -69,6 +69,8 @@
 #define MSMFB_OVERLAY_PREPARE		_IOWR(MSMFB_IOCTL_MAGIC, 169, \
 						struct mdp_overlay_list)
 #define MSMFB_LPM_ENABLE	_IOWR(MSMFB_IOCTL_MAGIC, 170, unsigned int)
+#define MSMFB_ATOMIC_COMMIT	_IOWR(MSMFB_IOCTL_MAGIC, 171, \
+						struct mdp_atomic_commit)
 
 /* HTC custom ioctls */
 #define MSMFB_USBFB_INIT _IOW(MSMFB_IOCTL_MAGIC, 304, struct minifb_session)
@@ -357,6 +359,13 @@ struct msmfb_img {
 };
 
 #define MSMFB_WRITEBACK_DEQUEUE_BLOCKING 0x1
+/*
+ * MSMFB_WRITEBACK_QUEUE_BUFFER flag: priv carries a fence fd (or -1) that
+ * has to signal before the MDP writes into the buffer. On return priv is a
+ * fence fd that signals once a frame has been written into the buffer, so
+ * the buffer can go to the encoder without a dequeue.
+ */
+#define MSMFB_WRITEBACK_QUEUE_FENCED 0x2
 struct msmfb_writeback_data {
 	struct msmfb_data buf_info;
 	struct msmfb_img img;
@@ -777,6 +786,32 @@ struct mdp_histogram_data {
 	uint32_t *extra_info;
 };
 
+/*
+ * mdp_hist_ring is the read only histogram ring that is mapped from the
+ * hist_ring file of the framebuffer device. Once the hist_event_ms file is
+ * set, a DSPP histogram is pushed every hist_event_ms and hist_event is
+ * notified; head counts the entries pushed so far, the newest one being
+ * entry[(head - 1) % MDP_HIST_RING_ENTRIES]. The seq of an entry is odd
+ * while it is being written, an entry is valid if seq is even and didn't
+ * change while it was copied.
+ */
+#define MDP_HIST_RING_ENTRIES	4
+#define MDP_HIST_RING_BINS	256
+
+struct mdp_hist_ring_entry {
+	uint32_t seq;
+	uint32_t block;
+	uint32_t bin_cnt;
+	uint32_t reserved;
+	uint32_t c0[MDP_HIST_RING_BINS];
+};
+
+struct mdp_hist_ring {
+	uint32_t head;
+	uint32_t reserved[3];
+	struct mdp_hist_ring_entry entry[MDP_HIST_RING_ENTRIES];
+};
+
 struct mdp_pcc_coeff {
 	uint32_t c, r, g, b, rr, gg, bb, rg, gb, rb, rgb_0, rgb_1;
 };
@@ -1143,6 +1178,26 @@ struct mdp_overlay_list {
 	uint32_t processed_overlays;
 };
 
+/**
+ * struct mdp_atomic_commit - argument for ioctl MSMFB_ATOMIC_COMMIT
+ * @ovlist:	The layers of the frame, set up and validated together as
+ *		with MSMFB_OVERLAY_PREPARE. The pipe id of each layer is
+ *		returned in its overlay.
+ * @data_list:	Pointer to an array of num_overlays buffers, one for each
+ *		overlay in the same order, queued as with MSMFB_OVERLAY_PLAY.
+ *		The id of each entry is taken from its overlay.
+ * @commit:	Display commit of the frame, as with MSMFB_DISPLAY_COMMIT.
+ *
+ * Replaces the MSMFB_OVERLAY_PREPARE, MSMFB_OVERLAY_PLAY and
+ * MSMFB_DISPLAY_COMMIT sequence of a frame with a single call. The buffer
+ * fences are still set up with MSMFB_BUFFER_SYNC before the commit.
+ */
+struct mdp_atomic_commit {
+	struct mdp_overlay_list ovlist;
+	struct msmfb_overlay_data *data_list;
+	struct mdp_display_commit commit;
+};
+
 struct mdp_page_protection {
 	uint32_t page_protection;
 };
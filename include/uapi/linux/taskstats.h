@@ -33,7 +33,7 @@
  */
 
 
-#define TASKSTATS_VERSION	8
+#define TASKSTATS_VERSION	9
 #define TS_COMM_LEN		32	/* should be >= TASK_COMM_LEN
 					 * in linux/sched.h */
 
@@ -163,6 +163,16 @@ struct taskstats {
 	/* Delay waiting for memory reclaim */
 	__u64	freepages_count;
 	__u64	freepages_delay_total;
+	/* version 8 ends here */
+
+	/*
+	 * Sampled PMU counters, indexed by CPU cluster: 0 is the cluster
+	 * of CPU0. Only the slices that make up pmu_sampled_ns are counted.
+	 */
+	__u64	pmu_cycles[2];
+	__u64	pmu_instructions[2];
+	__u64	pmu_l2_refills[2];
+	__u64	pmu_sampled_ns[2];
 };
 
 
@@ -0,0 +1,149 @@
+/*
+ * Boot phase profiler
+ *
+ * Records how long every initcall and every driver probe run before
+ * userspace is started took, and on which CPU it ran (asynchronous probes
+ * run on other CPUs than the init task), and exports the log as a single
+ * report in debugfs (boot_profile).
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <linux/atomic.h>
+#include <linux/boot_profile.h>
+#include <linux/debugfs.h>
+#include <linux/device.h>
+#include <linux/kernel.h>
+#include <linux/seq_file.h>
+
+#define BOOT_PROFILE_NAME_LEN	64
+
+enum {
+	BOOT_PROFILE_INITCALL,
+	BOOT_PROFILE_PROBE,
+};
+
+struct boot_profile_entry {
+	u64	start_us;
+	u32	duration_us;
+	int	ret;
+	u16	cpu;
+	u8	type;
+	char	name[BOOT_PROFILE_NAME_LEN];
+};
+
+static struct boot_profile_entry boot_profile_log[CONFIG_BOOT_PROFILER_ENTRIES];
+static atomic_t boot_profile_count = ATOMIC_INIT(0);
+static u64 boot_profile_end_us;
+
+bool boot_profile_active __read_mostly = true;
+
+static struct boot_profile_entry *
+boot_profile_record(struct boot_profile_mark *m, int type, int ret)
+{
+	struct boot_profile_entry *e;
+	ktime_t end = ktime_get();
+	int idx;
+
+	idx = atomic_inc_return(&boot_profile_count) - 1;
+	if (idx >= ARRAY_SIZE(boot_profile_log))
+		return NULL;
+
+	e = &boot_profile_log[idx];
+	e->start_us = ktime_to_us(m->start);
+	e->duration_us = ktime_us_delta(end, m->start);
+	e->ret = ret;
+	e->cpu = m->cpu;
+	e->type = type;
+	return e;
+}
+
+void __boot_profile_initcall_end(struct boot_profile_mark *m,
+				 initcall_t fn, int ret)
+{
+	struct boot_profile_entry *e;
+
+	e = boot_profile_record(m, BOOT_PROFILE_INITCALL, ret);
+	if (e)
+		snprintf(e->name, sizeof(e->name), "%pf", fn);
+}
+
+void __boot_profile_probe_end(struct boot_profile_mark *m,
+			      struct device *dev,
+			      struct device_driver *drv, int ret)
+{
+	struct boot_profile_entry *e;
+
+	e = boot_profile_record(m, BOOT_PROFILE_PROBE, ret);
+	if (e)
+		snprintf(e->name, sizeof(e->name), "%s %s",
+			 drv->name, dev_name(dev));
+}
+
+/*
+ * Called once all initcalls and asynchronous probes are done, right
+ * before the init process is started.
+ */
+void boot_profile_stop(void)
+{
+	boot_profile_end_us = ktime_to_us(ktime_get());
+	boot_profile_active = false;
+}
+
+static int boot_profile_show(struct seq_file *s, void *unused)
+{
+	static const char * const type_name[] = {
+		[BOOT_PROFILE_INITCALL]	= "initcall",
+		[BOOT_PROFILE_PROBE]	= "probe",
+	};
+	int count = atomic_read(&boot_profile_count);
+	int i;
+
+	if (boot_profile_active) {
+		seq_puts(s, "boot in progress\n");
+		return 0;
+	}
+
+	seq_printf(s, "kernel boot took %llu us, %d events", boot_profile_end_us,
+		   count);
+	if (count > ARRAY_SIZE(boot_profile_log)) {
+		seq_printf(s, " (%d dropped)",
+			   count - (int)ARRAY_SIZE(boot_profile_log));
+		count = ARRAY_SIZE(boot_profile_log);
+	}
+	seq_puts(s, "\n\n");
+
+	seq_printf(s, "%-8s %3s %12s %10s %6s  %s\n",
+		   "type", "cpu", "start_us", "dur_us", "ret", "name");
+	for (i = 0; i < count; i++) {
+		struct boot_profile_entry *e = &boot_profile_log[i];
+
+		seq_printf(s, "%-8s %3u %12llu %10u %6d  %s\n",
+			   type_name[e->type], e->cpu, e->start_us,
+			   e->duration_us, e->ret, e->name);
+	}
+
+	return 0;
+}
+
+static int boot_profile_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, boot_profile_show, NULL);
+}
+
+static const struct file_operations boot_profile_fops = {
+	.open		= boot_profile_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init boot_profile_init(void)
+{
+	debugfs_create_file("boot_profile", S_IRUSR, NULL, NULL,
+			    &boot_profile_fops);
+	return 0;
+}
+late_initcall(boot_profile_init);
@@ -76,6 +76,7 @@
 #include <linux/elevator.h>
 #include <linux/sched_clock.h>
 #include <linux/random.h>
+#include <linux/boot_profile.h>
 
 #include <asm/io.h>
 #include <asm/bugs.h>
@@ -741,15 +742,18 @@ static int __init_or_module do_one_initcall_debug(initcall_t fn)
 int __init_or_module do_one_initcall(initcall_t fn)
 {
 	int count = preempt_count();
+	struct boot_profile_mark bp;
 	int ret;
 
 #if defined(CONFIG_HTC_EARLY_RTB) && defined(CONFIG_HTC_DEBUG_RTB)
 	uncached_logk_pc(LOGK_INITCALL, (void *)fn, (void *)(0x00000000));
 #endif
+	boot_profile_begin(&bp);
 	if (initcall_debug)
 		ret = do_one_initcall_debug(fn);
 	else
 		ret = fn();
+	boot_profile_initcall_end(&bp, fn, ret);
 #if defined(CONFIG_HTC_EARLY_RTB) && defined(CONFIG_HTC_DEBUG_RTB)
 	uncached_logk_pc(LOGK_INITCALL, (void *)fn, (void *)(0xffffffff));
 #endif
@@ -883,6 +887,7 @@ static int __ref kernel_init(void *unused)
 	kernel_init_freeable();
 	/* need to finish all async __init code before freeing the memory */
 	async_synchronize_full();
+	boot_profile_stop();
 	free_initmem();
 	mark_rodata_ro();
 	system_state = SYSTEM_RUNNING;
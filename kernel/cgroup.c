@@ -60,6 +60,7 @@
 #include <linux/poll.h>
 #include <linux/flex_array.h> /* used in cgroup_attach_task */
 #include <linux/kthread.h>
+#include <linux/cpuset.h>
 
 #include <linux/atomic.h>
 
@@ -2052,7 +2053,20 @@ next:
 	 * we use find_css_set, which allocates a new one if necessary.
 	 */
 	for (i = 0; i < group_size; i++) {
+		struct task_and_cgroup *prev = i ? flex_array_get(group, i - 1) :
+						   NULL;
+
 		tc = flex_array_get(group, i);
+		/*
+		 * Threads of a group nearly always share their css_set, so
+		 * reuse the one just looked up rather than hashing and
+		 * comparing it again under css_set_lock for every thread.
+		 */
+		if (prev && prev->task->cgroups == tc->task->cgroups) {
+			tc->cg = prev->cg;
+			get_css_set(tc->cg);
+			continue;
+		}
 		tc->cg = find_css_set(tc->task->cgroups, cgrp);
 		if (!tc->cg) {
 			retval = -ENOMEM;
@@ -2185,6 +2199,7 @@ retry_find_task:
 	put_task_struct(tsk);
 out_unlock_cgroup:
 	mutex_unlock(&cgroup_mutex);
+	cpuset_post_attach_flush();
 	return ret;
 }
 
@@ -0,0 +1,148 @@
+/*
+ * cgroup_timer_slack.c - control group timer slack subsystem
+ *
+ * Copyright (C) 2016 HTC Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <linux/cgroup.h>
+#include <linux/err.h>
+#include <linux/sched.h>
+#include <linux/slab.h>
+
+/*
+ * Tasks of a cgroup with a non-zero timer_slack.min_slack_ns run with at
+ * least that much timer slack, so that the sleeps of e.g. background
+ * applications get coalesced with other wakeups instead of pulling an
+ * idle CPU out of a deep low power mode on their own.
+ *
+ * The value is applied to the tasks' timer_slack_ns when they join the
+ * cgroup and whenever it is written. default_timer_slack_ns is left
+ * alone, so moving a task back to a cgroup without a minimum restores
+ * the slack it had before. prctl(PR_SET_TIMERSLACK) still works and
+ * holds until the next update.
+ */
+struct timer_slack_cgroup {
+	struct cgroup_subsys_state	css;
+	u64				min_slack_ns;
+};
+
+static DEFINE_MUTEX(timer_slack_mutex);
+
+static inline struct timer_slack_cgroup *cgroup_tslack(struct cgroup *cgroup)
+{
+	return container_of(cgroup_subsys_state(cgroup, timer_slack_subsys_id),
+			    struct timer_slack_cgroup, css);
+}
+
+static inline struct timer_slack_cgroup *task_tslack(struct task_struct *task)
+{
+	return container_of(task_subsys_state(task, timer_slack_subsys_id),
+			    struct timer_slack_cgroup, css);
+}
+
+static void tslack_apply(struct task_struct *task, u64 min_slack_ns)
+{
+	task->timer_slack_ns = max_t(u64, task->default_timer_slack_ns,
+				     min_slack_ns);
+}
+
+static struct cgroup_subsys_state *tslack_css_alloc(struct cgroup *cgroup)
+{
+	struct timer_slack_cgroup *tslack;
+
+	tslack = kzalloc(sizeof(*tslack), GFP_KERNEL);
+	if (!tslack)
+		return ERR_PTR(-ENOMEM);
+
+	/* New cgroups start out with the minimum of their parent */
+	if (cgroup->parent)
+		tslack->min_slack_ns = cgroup_tslack(cgroup->parent)->min_slack_ns;
+
+	return &tslack->css;
+}
+
+static void tslack_css_free(struct cgroup *cgroup)
+{
+	kfree(cgroup_tslack(cgroup));
+}
+
+static void tslack_attach(struct cgroup *cgroup, struct cgroup_taskset *tset)
+{
+	struct timer_slack_cgroup *tslack = cgroup_tslack(cgroup);
+	struct task_struct *task;
+
+	mutex_lock(&timer_slack_mutex);
+	cgroup_taskset_for_each(task, cgroup, tset)
+		tslack_apply(task, tslack->min_slack_ns);
+	mutex_unlock(&timer_slack_mutex);
+}
+
+static void tslack_fork(struct task_struct *task)
+{
+	/*
+	 * copy_process() seeds the child's default slack from the parent's
+	 * current slack, which may be the cgroup minimum. Inherit the real
+	 * default instead so the child can drop back to it later.
+	 */
+	task->default_timer_slack_ns = current->default_timer_slack_ns;
+
+	rcu_read_lock();
+	tslack_apply(task, task_tslack(task)->min_slack_ns);
+	rcu_read_unlock();
+}
+
+static u64 tslack_min_read(struct cgroup *cgroup, struct cftype *cft)
+{
+	return cgroup_tslack(cgroup)->min_slack_ns;
+}
+
+static int tslack_min_write(struct cgroup *cgroup, struct cftype *cft,
+			    u64 val)
+{
+	struct timer_slack_cgroup *tslack = cgroup_tslack(cgroup);
+	struct cgroup_iter it;
+	struct task_struct *task;
+
+	if (val > ULONG_MAX)
+		return -EINVAL;
+
+	mutex_lock(&timer_slack_mutex);
+	tslack->min_slack_ns = val;
+
+	cgroup_iter_start(cgroup, &it);
+	while ((task = cgroup_iter_next(cgroup, &it)))
+		tslack_apply(task, val);
+	cgroup_iter_end(cgroup, &it);
+	mutex_unlock(&timer_slack_mutex);
+
+	return 0;
+}
+
+static struct cftype files[] = {
+	{
+		.name = "min_slack_ns",
+		.flags = CFTYPE_NOT_ON_ROOT,
+		.read_u64 = tslack_min_read,
+		.write_u64 = tslack_min_write,
+	},
+	{ }	/* terminate */
+};
+
+struct cgroup_subsys timer_slack_subsys = {
+	.name		= "timer_slack",
+	.css_alloc	= tslack_css_alloc,
+	.css_free	= tslack_css_free,
+	.subsys_id	= timer_slack_subsys_id,
+	.attach		= tslack_attach,
+	.fork		= tslack_fork,
+	.base_cftypes	= files,
+};
@@ -270,6 +270,12 @@ static DEFINE_MUTEX(callback_mutex);
  */
 static struct workqueue_struct *cpuset_propagate_hotplug_wq;
 
+/*
+ * Page migration for memory_migrate is done asynchronously too, so that
+ * moving tasks between cpusets doesn't wait for it under the locks.
+ */
+static struct workqueue_struct *cpuset_migrate_mm_wq;
+
 static void cpuset_hotplug_workfn(struct work_struct *work);
 static void cpuset_propagate_hotplug_workfn(struct work_struct *work);
 static void schedule_cpuset_propagate_hotplug(struct cpuset *cs);
@@ -928,31 +934,60 @@ static int update_cpumask(struct cpuset *cs, struct cpuset *trialcs,
  *
  *    Migrate memory region from one set of nodes to another.
  *
- *    Temporarilly set tasks mems_allowed to target nodes of migration,
- *    so that the migration code can allocate pages on these nodes.
- *
- *    Call holding cpuset_mutex, so current's cpuset won't change
- *    during this call, as manage_mutex holds off any cpuset_attach()
- *    calls.  Therefore we don't need to take task_lock around the
- *    call to guarantee_online_mems(), as we know no one is changing
- *    our task's cpuset.
- *
- *    While the mm_struct we are migrating is typically from some
- *    other task, the task_struct mems_allowed that we are hacking
- *    is for our current task, which must allocate new pages for that
- *    migrating memory region.
+ *    The migration is queued on cpuset_migrate_mm_wq and done by a
+ *    worker of the top cpuset, which may allocate on any node.  Takes
+ *    over the caller's reference on @mm.  Use cpuset_post_attach_flush()
+ *    to wait for it once the cgroup locks are dropped.
  */
 
+struct cpuset_migrate_mm_work {
+	struct work_struct	work;
+	struct mm_struct	*mm;
+	nodemask_t		from;
+	nodemask_t		to;
+};
+
+static void cpuset_migrate_mm_workfn(struct work_struct *work)
+{
+	struct cpuset_migrate_mm_work *mwork =
+		container_of(work, struct cpuset_migrate_mm_work, work);
+
+	do_migrate_pages(mwork->mm, &mwork->from, &mwork->to, MPOL_MF_MOVE_ALL);
+	mmput(mwork->mm);
+	kfree(mwork);
+}
+
 static void cpuset_migrate_mm(struct mm_struct *mm, const nodemask_t *from,
 							const nodemask_t *to)
 {
-	struct task_struct *tsk = current;
+	struct cpuset_migrate_mm_work *mwork;
 
-	tsk->mems_allowed = *to;
+	if (nodes_equal(*from, *to)) {
+		mmput(mm);
+		return;
+	}
 
-	do_migrate_pages(mm, from, to, MPOL_MF_MOVE_ALL);
+	mwork = kzalloc(sizeof(*mwork), GFP_KERNEL);
+	if (mwork) {
+		mwork->mm = mm;
+		mwork->from = *from;
+		mwork->to = *to;
+		INIT_WORK(&mwork->work, cpuset_migrate_mm_workfn);
+		queue_work(cpuset_migrate_mm_wq, &mwork->work);
+	} else {
+		mmput(mm);
+	}
+}
 
-	guarantee_online_mems(task_cs(tsk),&tsk->mems_allowed);
+/**
+ * cpuset_post_attach_flush - wait for page migrations queued by an attach
+ *
+ * Called by cgroup core after dropping cgroup_mutex, so that writers of
+ * a memory_migrate cpuset still return with the pages moved.
+ */
+void cpuset_post_attach_flush(void)
+{
+	flush_workqueue(cpuset_migrate_mm_wq);
 }
 
 /*
@@ -1035,7 +1070,8 @@ static void cpuset_change_nodemask(struct task_struct *p,
 	mpol_rebind_mm(mm, &cs->mems_allowed);
 	if (migrate)
 		cpuset_migrate_mm(mm, oldmem, &cs->mems_allowed);
-	mmput(mm);
+	else
+		mmput(mm);
 }
 
 static void *cpuset_being_rebound;
@@ -1463,25 +1499,37 @@ static void cpuset_attach(struct cgroup *cgrp, struct cgroup_taskset *tset)
 		 */
 		WARN_ON_ONCE(set_cpus_allowed_ptr(task, cpus_attach));
 
-		cpuset_change_task_nodemask(task, &cpuset_attach_nodemask_to);
+		/* Cheap on its own, but it bumps mems_allowed_seq */
+		if (!nodes_equal(task->mems_allowed,
+				 cpuset_attach_nodemask_to))
+			cpuset_change_task_nodemask(task,
+						    &cpuset_attach_nodemask_to);
 		cpuset_update_task_spread_flag(cs, task);
 	}
 
 	/*
 	 * Change mm, possibly for multiple threads in a threadgroup. This is
-	 * expensive and may sleep.
+	 * expensive and may sleep, as mpol_rebind_mm() takes mmap_sem for
+	 * writing. Moving between cpusets that only differ in their CPUs,
+	 * the usual case, leaves the mm alone.
 	 */
 	cpuset_attach_nodemask_from = oldcs->mems_allowed;
 	cpuset_attach_nodemask_to = cs->mems_allowed;
+	if (nodes_equal(cpuset_attach_nodemask_from, cpuset_attach_nodemask_to))
+		goto out;
+
 	mm = get_task_mm(leader);
 	if (mm) {
 		mpol_rebind_mm(mm, &cpuset_attach_nodemask_to);
 		if (is_memory_migrate(cs))
 			cpuset_migrate_mm(mm, &cpuset_attach_nodemask_from,
 					  &cpuset_attach_nodemask_to);
-		mmput(mm);
+		else
+			mmput(mm);
 	}
 
+out:
+
 	cs->attach_in_progress--;
 
 	/*
@@ -2269,6 +2317,9 @@ void __init cpuset_init_smp(void)
 	cpuset_propagate_hotplug_wq =
 		alloc_ordered_workqueue("cpuset_hotplug", 0);
 	BUG_ON(!cpuset_propagate_hotplug_wq);
+
+	cpuset_migrate_mm_wq = alloc_ordered_workqueue("cpuset_migrate_mm", 0);
+	BUG_ON(!cpuset_migrate_mm_wq);
 }
 
 /**
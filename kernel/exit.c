@@ -135,6 +135,7 @@ static void __exit_signal(struct task_struct *tsk)
 	sig->inblock += task_io_get_inblock(tsk);
 	sig->oublock += task_io_get_oublock(tsk);
 	task_io_accounting_add(&sig->ioac, &tsk->ioac);
+	task_pmu_accounting_add(&sig->pmuac, &tsk->pmuac);
 	sig->sum_sched_runtime += tsk->se.sum_exec_runtime;
 	sig->nr_threads--;
 	__unhash_process(tsk, group_dead);
@@ -202,6 +203,7 @@ repeat:
 	}
 
 	write_unlock_irq(&tasklist_lock);
+	lmk_adj_index_del(p);
 	release_thread(p);
 	call_rcu(&p->rcu, delayed_put_task_struct);
 
@@ -0,0 +1,237 @@
+/*
+ * linux/kernel/irq/balance.c
+ *
+ * Copyright (C) 2016 HTC Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * Cluster aware interrupt balancing.
+ *
+ * Every interval the rate and the hard irq handler time of each
+ * balanceable interrupt are sampled. Interrupts above either threshold
+ * are heavy and get placed on the least loaded CPU of the heavy cluster,
+ * all others on the least loaded CPU of the cluster of CPU0. CPU load is
+ * the non-idle time from kernel_cpustat, so CPUs the scheduler keeps busy
+ * with tasks are avoided as well.
+ *
+ * Interrupts whose driver set an affinity hint, or that someone else
+ * pinned to a single CPU, are not touched.
+ */
+
+#include <linux/irq.h>
+#include <linux/interrupt.h>
+#include <linux/kernel_stat.h>
+#include <linux/cpumask.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/moduleparam.h>
+#include <linux/workqueue.h>
+
+#include "internals.h"
+
+#ifdef MODULE_PARAM_PREFIX
+#undef MODULE_PARAM_PREFIX
+#endif
+#define MODULE_PARAM_PREFIX "irq_balance."
+
+static bool enabled = true;
+module_param(enabled, bool, 0644);
+
+static unsigned int interval_ms = 2000;
+module_param(interval_ms, uint, 0644);
+
+/* An interrupt is heavy above this many irqs per second... */
+static unsigned int heavy_rate = 2000;
+module_param(heavy_rate, uint, 0644);
+
+/* ...or above this much handler time, in per mille of a CPU */
+static unsigned int heavy_load = 20;
+module_param(heavy_load, uint, 0644);
+
+/* Any CPU of the cluster that takes heavy interrupts, -1 for the last */
+static int heavy_cluster_cpu = -1;
+module_param(heavy_cluster_cpu, int, 0644);
+
+/* Only move an interrupt if it gains at least this much, in per mille */
+static unsigned int hysteresis = 100;
+module_param(hysteresis, uint, 0644);
+
+static void irq_balance_work_fn(struct work_struct *work);
+static DECLARE_DEFERRABLE_WORK(irq_balance_work, irq_balance_work_fn);
+
+static DEFINE_PER_CPU(u64, last_busy_us);
+static unsigned int cpu_load[NR_CPUS];
+static ktime_t last_sample;
+
+static u64 cpu_busy_us(int cpu)
+{
+	u64 *cpustat = kcpustat_cpu(cpu).cpustat;
+	u64 busy;
+
+	busy = cpustat[CPUTIME_USER] + cpustat[CPUTIME_NICE] +
+	       cpustat[CPUTIME_SYSTEM] + cpustat[CPUTIME_IRQ] +
+	       cpustat[CPUTIME_SOFTIRQ];
+
+	return cputime64_to_jiffies64(busy) * USEC_PER_SEC / HZ;
+}
+
+static void sample_cpu_load(u64 elapsed_us)
+{
+	u64 busy, delta;
+	int cpu;
+
+	for_each_online_cpu(cpu) {
+		busy = cpu_busy_us(cpu);
+		delta = busy - per_cpu(last_busy_us, cpu);
+		per_cpu(last_busy_us, cpu) = busy;
+
+		delta = div64_u64(delta * 1000, elapsed_us);
+		cpu_load[cpu] = min_t(u64, delta, 1000);
+	}
+}
+
+static int least_loaded_cpu(const struct cpumask *mask, int cur)
+{
+	int cpu, best = -1;
+
+	for_each_cpu_and(cpu, mask, cpu_online_mask) {
+		if (best < 0 || cpu_load[cpu] < cpu_load[best])
+			best = cpu;
+	}
+
+	/* Stay put unless the move is worth it */
+	if (best >= 0 && cur >= 0 && cpumask_test_cpu(cur, mask) &&
+	    cpu_online(cur) && cpu_load[cur] < cpu_load[best] + hysteresis)
+		return cur;
+
+	return best;
+}
+
+/*
+ * Called with desc->lock held. Returns false if the irq is not ours to
+ * move. The balancer pins everything it places to one CPU, so a single
+ * CPU mask other than the one we chose means somebody else placed it.
+ */
+static bool irq_balanceable(struct irq_desc *desc)
+{
+	struct irq_data *data = &desc->irq_data;
+	const struct cpumask *mask = data->affinity;
+
+	if (!desc->action || irqd_is_per_cpu(data) ||
+	    !irqd_can_balance(data) || desc->affinity_hint ||
+	    !data->chip || !data->chip->irq_set_affinity)
+		return false;
+
+	if (desc->bal.cpu >= 0) {
+		if (!cpu_online(desc->bal.cpu))
+			return true;
+		return cpumask_equal(mask, cpumask_of(desc->bal.cpu));
+	}
+
+	return cpumask_weight(mask) > 1;
+}
+
+static void irq_balance_one(unsigned int irq, struct irq_desc *desc,
+			    u64 elapsed_us, const struct cpumask *heavy,
+			    const struct cpumask *light)
+{
+	unsigned long flags;
+	unsigned int count, load;
+	u64 ns;
+	int cur, target;
+	bool is_heavy;
+
+	count = kstat_irqs(irq);
+
+	raw_spin_lock_irqsave(&desc->lock, flags);
+	if (!irq_balanceable(desc)) {
+		desc->bal.cpu = -1;
+		raw_spin_unlock_irqrestore(&desc->lock, flags);
+		return;
+	}
+
+	ns = desc->handler_ns - desc->bal.last_ns;
+	desc->bal.last_ns = desc->handler_ns;
+	desc->bal.rate = div64_u64((u64)(count - desc->bal.last_count) *
+				   USEC_PER_SEC, elapsed_us);
+	desc->bal.last_count = count;
+	desc->bal.load = load = div64_u64(ns, elapsed_us);
+	cur = desc->bal.cpu;
+	raw_spin_unlock_irqrestore(&desc->lock, flags);
+
+	/* Nothing happened, don't bother */
+	if (!desc->bal.rate && cur >= 0)
+		return;
+
+	is_heavy = desc->bal.rate >= heavy_rate || load >= heavy_load;
+	target = least_loaded_cpu(is_heavy ? heavy : light, cur);
+	if (target < 0)
+		return;
+
+	if (target != cur) {
+		if (irq_set_affinity(irq, cpumask_of(target)))
+			return;
+		if (cur >= 0 && cpu_online(cur))
+			cpu_load[cur] -= min(load, cpu_load[cur]);
+	}
+
+	/* Account for it so the next irqs spread over the cluster */
+	if (target != cur || cur < 0)
+		cpu_load[target] += max(load, 1U);
+
+	raw_spin_lock_irqsave(&desc->lock, flags);
+	desc->bal.cpu = target;
+	raw_spin_unlock_irqrestore(&desc->lock, flags);
+}
+
+static void irq_balance_work_fn(struct work_struct *work)
+{
+	const struct cpumask *heavy, *light;
+	struct irq_desc *desc;
+	unsigned int irq;
+	ktime_t now;
+	u64 elapsed_us;
+	int cpu;
+
+	if (!enabled)
+		goto out;
+
+	now = ktime_get();
+	elapsed_us = ktime_us_delta(now, last_sample);
+	last_sample = now;
+	if (!elapsed_us)
+		goto out;
+
+	get_online_cpus();
+	cpu = heavy_cluster_cpu;
+	if (cpu < 0 || cpu >= nr_cpu_ids)
+		cpu = nr_cpu_ids - 1;
+	heavy = topology_core_cpumask(cpu);
+	light = topology_core_cpumask(0);
+
+	sample_cpu_load(elapsed_us);
+
+	for_each_irq_desc(irq, desc)
+		irq_balance_one(irq, desc, elapsed_us, heavy, light);
+	put_online_cpus();
+
+out:
+	queue_delayed_work(system_power_efficient_wq, &irq_balance_work,
+			   msecs_to_jiffies(max(interval_ms, 100U)));
+}
+
+static int __init irq_balance_init(void)
+{
+	last_sample = ktime_get();
+	queue_delayed_work(system_power_efficient_wq, &irq_balance_work,
+			   msecs_to_jiffies(interval_ms));
+	return 0;
+}
+late_initcall(irq_balance_init);
@@ -17,6 +17,7 @@
 #include <linux/kernel_stat.h>
 
 #include <trace/events/irq.h>
+#include <htc_mnemosyne/htc_perf_footprint.h>
 
 #include "internals.h"
 
@@ -183,14 +184,30 @@ irqreturn_t handle_irq_event(struct irq_desc *desc)
 {
 	struct irqaction *action = desc->action;
 	irqreturn_t ret;
+	u64 fp_start;
+#ifdef CONFIG_IRQ_CLUSTER_BALANCE
+	u64 start, delta;
+#endif
 
 	desc->istate &= ~IRQS_PENDING;
 	irqd_set(&desc->irq_data, IRQD_IRQ_INPROGRESS);
 	raw_spin_unlock(&desc->lock);
 
+#ifdef CONFIG_IRQ_CLUSTER_BALANCE
+	start = local_clock();
+#endif
+	fp_start = htc_perf_footprint_irq_enter();
 	ret = handle_irq_event_percpu(desc, action);
+	htc_perf_footprint_irq_exit(desc->irq_data.irq, action->handler,
+				    fp_start);
 
 	raw_spin_lock(&desc->lock);
+#ifdef CONFIG_IRQ_CLUSTER_BALANCE
+	delta = local_clock() - start;
+	desc->handler_ns += delta;
+	if (delta > desc->handler_max_ns)
+		desc->handler_max_ns = delta;
+#endif
 	irqd_clear(&desc->irq_data, IRQD_IRQ_INPROGRESS);
 	return ret;
 }
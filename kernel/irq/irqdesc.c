@@ -91,6 +91,12 @@ static void desc_set_defaults(unsigned int irq, struct irq_desc *desc, int node,
 	for_each_possible_cpu(cpu)
 		*per_cpu_ptr(desc->kstat_irqs, cpu) = 0;
 	desc_smp_init(desc, node);
+#ifdef CONFIG_IRQ_CLUSTER_BALANCE
+	desc->handler_ns = 0;
+	desc->handler_max_ns = 0;
+	memset(&desc->bal, 0, sizeof(desc->bal));
+	desc->bal.cpu = -1;
+#endif
 #ifdef CONFIG_SMP
 	INIT_LIST_HEAD(&desc->affinity_notify);
 	INIT_WORK(&desc->affinity_work, irq_affinity_notify);
@@ -267,6 +267,37 @@ static const struct file_operations irq_spurious_proc_fops = {
 	.release	= single_release,
 };
 
+#ifdef CONFIG_IRQ_CLUSTER_BALANCE
+static int irq_handler_time_proc_show(struct seq_file *m, void *v)
+{
+	struct irq_desc *desc = irq_to_desc((long) m->private);
+	unsigned long flags;
+	u64 total, max;
+
+	raw_spin_lock_irqsave(&desc->lock, flags);
+	total = desc->handler_ns;
+	max = desc->handler_max_ns;
+	raw_spin_unlock_irqrestore(&desc->lock, flags);
+
+	seq_printf(m, "total %llu ns\n" "max %llu ns\n" "rate %u/s\n"
+		   "load %u permille\n" "balanced_cpu %d\n",
+		   total, max, desc->bal.rate, desc->bal.load, desc->bal.cpu);
+	return 0;
+}
+
+static int irq_handler_time_proc_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, irq_handler_time_proc_show, PDE_DATA(inode));
+}
+
+static const struct file_operations irq_handler_time_proc_fops = {
+	.open		= irq_handler_time_proc_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+#endif
+
 static int irq_wake_depth_proc_show(struct seq_file *m, void *v)
 {
 	struct irq_desc *desc = irq_to_desc((long) m->private);
@@ -396,6 +427,10 @@ void register_irq_proc(unsigned int irq, struct irq_desc *desc)
 			 &irq_disable_depth_proc_fops, (void *)(long)irq);
 	proc_create_data("wake_depth", 0444, desc->dir,
 			 &irq_wake_depth_proc_fops, (void *)(long)irq);
+#ifdef CONFIG_IRQ_CLUSTER_BALANCE
+	proc_create_data("handler_time", 0444, desc->dir,
+			 &irq_handler_time_proc_fops, (void *)(long)irq);
+#endif
 
 out_unlock:
 	mutex_unlock(&register_lock);
@@ -414,6 +449,9 @@ void unregister_irq_proc(unsigned int irq, struct irq_desc *desc)
 	remove_proc_entry("node", desc->dir);
 #endif
 	remove_proc_entry("spurious", desc->dir);
+#ifdef CONFIG_IRQ_CLUSTER_BALANCE
+	remove_proc_entry("handler_time", desc->dir);
+#endif
 
 	memset(name, 0, MAX_NAMELEN);
 	sprintf(name, "%u", irq);
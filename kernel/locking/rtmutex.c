@@ -233,6 +233,9 @@ static void __rt_mutex_adjust_prio(struct task_struct *task)
 
 	if (task->prio != prio)
 		rt_mutex_setprio(task, prio);
+
+	sched_set_pi_boost(task, task_has_pi_waiters(task) ?
+			   task_top_pi_waiter(task)->task : NULL);
 }
 
 /*
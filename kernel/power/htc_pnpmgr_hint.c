@@ -0,0 +1,474 @@
+/* linux/kernel/power/htc_pnpmgr_hint.c
+ *
+ * Copyright (C) 2016 HTC Corporation.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * Performance hint device for the pnp daemon. A hint names a use case and
+ * a duration; its configured floors are combined with those of the other
+ * active hints and applied right away from the ioctl, instead of the
+ * daemon writing a handful of sysfs nodes per boost. Floors only ever
+ * raise minimums, user and thermal caps still win. The resulting limits
+ * are reported back through read()/poll() whenever they change.
+ */
+
+#define pr_fmt(fmt) "pnp_hint: " fmt
+
+#include <linux/cpu.h>
+#include <linux/cpufreq.h>
+#include <linux/fs.h>
+#include <linux/htc_pnp_hint.h>
+#include <linux/jiffies.h>
+#include <linux/ktime.h>
+#include <linux/miscdevice.h>
+#include <linux/module.h>
+#include <linux/msm-bus.h>
+#include <linux/mutex.h>
+#include <linux/poll.h>
+#include <linux/sched.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/uaccess.h>
+#include <linux/wait.h>
+#include <linux/workqueue.h>
+#ifdef CONFIG_MSM_KGSL
+#include <linux/msm_kgsl.h>
+#endif
+
+enum {
+	BC_TYPE = 0,
+	LC_TYPE,
+	MAX_TYPE,
+};
+
+#define PNP_HINT_DEF_MAX_MS	5000
+#define PNP_HINT_BUS_NODE_LEN	32
+
+static const unsigned long big_cluster_mask = CONFIG_PERFORMANCE_CLUSTER_CPU_MASK;
+
+struct pnp_hint_state {
+	struct pnp_hint_config config;
+	unsigned long expires;
+	bool active;
+};
+
+struct pnp_hint_client {
+	u64 seq;
+};
+
+static void pnp_hint_expire(struct work_struct *work);
+
+/* hint_lock serializes hint changes and the floors they apply */
+static DEFINE_MUTEX(hint_lock);
+static struct pnp_hint_state hints[PNP_HINT_MAX];
+static DECLARE_DELAYED_WORK(hint_expire_work, pnp_hint_expire);
+static bool hint_ready;
+static unsigned int hint_cpu_floor[MAX_TYPE];
+static unsigned int hint_gpu_floor;
+static unsigned int hint_bus_floor;
+static bool hint_sched_boost;
+static char hint_bus_node[PNP_HINT_BUS_NODE_LEN];
+
+/* hint_event_lock protects the event and the policy limits it reports */
+static DEFINE_SPINLOCK(hint_event_lock);
+static struct pnp_hint_event hint_event;
+static unsigned int hint_policy_min[MAX_TYPE];
+static unsigned int hint_policy_max[MAX_TYPE];
+static DECLARE_WAIT_QUEUE_HEAD(hint_wq);
+
+static int hint_cluster(unsigned int cpu)
+{
+	return (big_cluster_mask & BIT(cpu)) ? BC_TYPE : LC_TYPE;
+}
+
+static u32 hint_active_mask(void)
+{
+	u32 mask = 0;
+	int i;
+
+	for (i = 0; i < PNP_HINT_MAX; i++)
+		if (hints[i].active)
+			mask |= BIT(i);
+	return mask;
+}
+
+/*
+ * Publish the current limits. The event only moves on when one of them
+ * changed, so readers are not woken for policy updates that did nothing.
+ */
+static void pnp_hint_event_update(void)
+{
+	struct pnp_hint_event ev;
+	unsigned long flags;
+
+	memset(&ev, 0, sizeof(ev));
+#ifdef CONFIG_MSM_KGSL
+	ev.gpu_max_khz = kgsl_pwr_limits_get_freq(KGSL_DEVICE_3D0) / 1000;
+#endif
+
+	spin_lock_irqsave(&hint_event_lock, flags);
+	ev.active = hint_event.active;
+	ev.bcpu_min_khz = hint_policy_min[BC_TYPE];
+	ev.bcpu_max_khz = hint_policy_max[BC_TYPE];
+	ev.lcpu_min_khz = hint_policy_min[LC_TYPE];
+	ev.lcpu_max_khz = hint_policy_max[LC_TYPE];
+	ev.gpu_min_khz = hint_gpu_floor;
+	ev.bus_min_khz = hint_bus_floor;
+	ev.sched_boost = hint_sched_boost;
+
+	ev.seq = hint_event.seq;
+	ev.timestamp_ns = hint_event.timestamp_ns;
+	if (memcmp(&ev, &hint_event, sizeof(ev))) {
+		ev.seq++;
+		ev.timestamp_ns = ktime_to_ns(ktime_get());
+		hint_event = ev;
+		wake_up_interruptible(&hint_wq);
+	}
+	spin_unlock_irqrestore(&hint_event_lock, flags);
+}
+
+static void pnp_hint_set_active(u32 mask)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&hint_event_lock, flags);
+	hint_event.active = mask;
+	spin_unlock_irqrestore(&hint_event_lock, flags);
+}
+
+static void pnp_hint_update_cpus(int type)
+{
+	unsigned int cpu;
+
+	get_online_cpus();
+	for_each_online_cpu(cpu)
+		if (hint_cluster(cpu) == type)
+			cpufreq_update_policy(cpu);
+	put_online_cpus();
+}
+
+/* Called with hint_lock held */
+static void pnp_hint_apply(void)
+{
+	unsigned int cpu_floor[MAX_TYPE] = { 0 };
+	unsigned int gpu_floor = 0, bus_floor = 0;
+	unsigned long now = jiffies, next = 0;
+	bool boost = false;
+	int i;
+
+	for (i = 0; i < PNP_HINT_MAX; i++) {
+		struct pnp_hint_state *h = &hints[i];
+
+		if (h->active && time_after_eq(now, h->expires))
+			h->active = false;
+		if (!h->active)
+			continue;
+
+		cpu_floor[BC_TYPE] = max(cpu_floor[BC_TYPE],
+					 h->config.bcpu_min_khz);
+		cpu_floor[LC_TYPE] = max(cpu_floor[LC_TYPE],
+					 h->config.lcpu_min_khz);
+		gpu_floor = max(gpu_floor, h->config.gpu_min_khz);
+		bus_floor = max(bus_floor, h->config.bus_min_khz);
+		boost |= !!h->config.sched_boost;
+
+		if (!next || time_before(h->expires, next))
+			next = h->expires;
+	}
+	pnp_hint_set_active(hint_active_mask());
+
+	/* Bring up the CPUs first, they are what a boost waits on the most */
+	for (i = 0; i < MAX_TYPE; i++) {
+		if (cpu_floor[i] == hint_cpu_floor[i])
+			continue;
+		ACCESS_ONCE(hint_cpu_floor[i]) = cpu_floor[i];
+		pnp_hint_update_cpus(i);
+	}
+
+	if (boost != hint_sched_boost) {
+		if (!sched_set_boost(boost) || !boost)
+			hint_sched_boost = boost;
+	}
+
+#ifdef CONFIG_MSM_KGSL
+	if (gpu_floor != hint_gpu_floor &&
+	    !kgsl_pwr_floor_set_freq(KGSL_DEVICE_3D0, gpu_floor * 1000))
+		hint_gpu_floor = gpu_floor;
+#endif
+
+	if (bus_floor != hint_bus_floor && hint_bus_node[0] &&
+	    !msm_bus_floor_vote(hint_bus_node, (u64)bus_floor * 1000))
+		hint_bus_floor = bus_floor;
+
+	if (next)
+		mod_delayed_work(system_wq, &hint_expire_work,
+				 time_after(next, now) ? next - now : 0);
+	else
+		cancel_delayed_work(&hint_expire_work);
+
+	pnp_hint_event_update();
+}
+
+static void pnp_hint_expire(struct work_struct *work)
+{
+	mutex_lock(&hint_lock);
+	pnp_hint_apply();
+	mutex_unlock(&hint_lock);
+}
+
+static int pnp_hint_set_bus_node(const char *val, const struct kernel_param *kp)
+{
+	char node[PNP_HINT_BUS_NODE_LEN];
+
+	if (strlcpy(node, val, sizeof(node)) >= sizeof(node))
+		return -EINVAL;
+
+	/* Move an active floor over to the new node */
+	mutex_lock(&hint_lock);
+	if (hint_bus_floor && hint_bus_node[0])
+		msm_bus_floor_vote(hint_bus_node, 0);
+	hint_bus_floor = 0;
+	strlcpy(hint_bus_node, strim(node), sizeof(hint_bus_node));
+	if (hint_ready)
+		pnp_hint_apply();
+	mutex_unlock(&hint_lock);
+	return 0;
+}
+
+static const struct kernel_param_ops param_ops_bus_node = {
+	.set = pnp_hint_set_bus_node,
+	.get = param_get_string,
+};
+
+static struct kparam_string hint_bus_node_str = {
+	.maxlen = sizeof(hint_bus_node),
+	.string = hint_bus_node,
+};
+module_param_cb(bus_floor_node, &param_ops_bus_node, &hint_bus_node_str,
+		0644);
+MODULE_PARM_DESC(bus_floor_node, "msm_bus floor voter the bus floors go to");
+
+static int pnp_hint_policy_notify(struct notifier_block *nb,
+				  unsigned long val, void *data)
+{
+	struct cpufreq_policy *policy = data;
+	int type = hint_cluster(policy->cpu);
+	unsigned int floor = ACCESS_ONCE(hint_cpu_floor[type]);
+	unsigned long flags;
+
+	switch (val) {
+	case CPUFREQ_ADJUST:
+		if (floor)
+			cpufreq_verify_within_limits(policy,
+					min(floor, policy->max), policy->max);
+		break;
+	case CPUFREQ_NOTIFY:
+		spin_lock_irqsave(&hint_event_lock, flags);
+		hint_policy_min[type] = policy->min;
+		hint_policy_max[type] = policy->max;
+		spin_unlock_irqrestore(&hint_event_lock, flags);
+		pnp_hint_event_update();
+		break;
+	}
+
+	return NOTIFY_OK;
+}
+
+/* Run after the thermal and user limits have been adjusted in */
+static struct notifier_block pnp_hint_policy_nb = {
+	.notifier_call = pnp_hint_policy_notify,
+	.priority = INT_MIN + 1,
+};
+
+static int pnp_hint_do_hint(struct pnp_hint __user *arg)
+{
+	struct pnp_hint hint;
+	struct pnp_hint_state *h;
+	unsigned int ms;
+
+	if (copy_from_user(&hint, arg, sizeof(hint)))
+		return -EFAULT;
+	if (hint.type >= PNP_HINT_MAX)
+		return -EINVAL;
+
+	mutex_lock(&hint_lock);
+	h = &hints[hint.type];
+	ms = min(hint.duration_ms, h->config.max_duration_ms);
+	h->active = ms > 0;
+	h->expires = jiffies + msecs_to_jiffies(ms);
+	pnp_hint_apply();
+	mutex_unlock(&hint_lock);
+	return 0;
+}
+
+static int pnp_hint_set_config(struct pnp_hint_config __user *arg)
+{
+	struct pnp_hint_config config;
+
+	if (copy_from_user(&config, arg, sizeof(config)))
+		return -EFAULT;
+	if (config.type >= PNP_HINT_MAX)
+		return -EINVAL;
+
+	mutex_lock(&hint_lock);
+	hints[config.type].config = config;
+	pnp_hint_apply();
+	mutex_unlock(&hint_lock);
+	return 0;
+}
+
+static int pnp_hint_get_config(struct pnp_hint_config __user *arg)
+{
+	struct pnp_hint_config config;
+	u32 type;
+
+	if (get_user(type, &arg->type))
+		return -EFAULT;
+	if (type >= PNP_HINT_MAX)
+		return -EINVAL;
+
+	mutex_lock(&hint_lock);
+	config = hints[type].config;
+	mutex_unlock(&hint_lock);
+
+	return copy_to_user(arg, &config, sizeof(config)) ? -EFAULT : 0;
+}
+
+static long pnp_hint_ioctl(struct file *file, unsigned int cmd,
+			   unsigned long arg)
+{
+	void __user *argp = (void __user *)arg;
+
+	switch (cmd) {
+	case PNP_HINT_IOC_HINT:
+		return pnp_hint_do_hint(argp);
+	case PNP_HINT_IOC_SET_CONFIG:
+		return pnp_hint_set_config(argp);
+	case PNP_HINT_IOC_GET_CONFIG:
+		return pnp_hint_get_config(argp);
+	default:
+		return -ENOTTY;
+	}
+}
+
+static bool pnp_hint_changed(struct pnp_hint_client *client)
+{
+	unsigned long flags;
+	bool changed;
+
+	spin_lock_irqsave(&hint_event_lock, flags);
+	changed = hint_event.seq != client->seq;
+	spin_unlock_irqrestore(&hint_event_lock, flags);
+	return changed;
+}
+
+static ssize_t pnp_hint_read(struct file *file, char __user *buf,
+			     size_t count, loff_t *ppos)
+{
+	struct pnp_hint_client *client = file->private_data;
+	struct pnp_hint_event ev;
+	unsigned long flags;
+	int ret;
+
+	if (count < sizeof(ev))
+		return -EINVAL;
+
+	if (!pnp_hint_changed(client)) {
+		if (file->f_flags & O_NONBLOCK)
+			return -EAGAIN;
+		ret = wait_event_interruptible(hint_wq,
+					       pnp_hint_changed(client));
+		if (ret)
+			return ret;
+	}
+
+	spin_lock_irqsave(&hint_event_lock, flags);
+	ev = hint_event;
+	spin_unlock_irqrestore(&hint_event_lock, flags);
+	client->seq = ev.seq;
+
+	if (copy_to_user(buf, &ev, sizeof(ev)))
+		return -EFAULT;
+	return sizeof(ev);
+}
+
+static unsigned int pnp_hint_poll(struct file *file, poll_table *wait)
+{
+	struct pnp_hint_client *client = file->private_data;
+
+	poll_wait(file, &hint_wq, wait);
+	return pnp_hint_changed(client) ? POLLIN | POLLRDNORM : 0;
+}
+
+static int pnp_hint_open(struct inode *inode, struct file *file)
+{
+	struct pnp_hint_client *client;
+
+	client = kzalloc(sizeof(*client), GFP_KERNEL);
+	if (!client)
+		return -ENOMEM;
+	file->private_data = client;
+	return nonseekable_open(inode, file);
+}
+
+static int pnp_hint_release(struct inode *inode, struct file *file)
+{
+	kfree(file->private_data);
+	return 0;
+}
+
+static const struct file_operations pnp_hint_fops = {
+	.owner		= THIS_MODULE,
+	.open		= pnp_hint_open,
+	.release	= pnp_hint_release,
+	.read		= pnp_hint_read,
+	.poll		= pnp_hint_poll,
+	.unlocked_ioctl	= pnp_hint_ioctl,
+	.compat_ioctl	= pnp_hint_ioctl,
+	.llseek		= no_llseek,
+};
+
+static struct miscdevice pnp_hint_misc = {
+	.minor	= MISC_DYNAMIC_MINOR,
+	.name	= "pnp_hint",
+	.fops	= &pnp_hint_fops,
+};
+
+static int __init pnp_hint_init(void)
+{
+	int i, ret;
+
+	for (i = 0; i < PNP_HINT_MAX; i++) {
+		hints[i].config.type = i;
+		hints[i].config.max_duration_ms = PNP_HINT_DEF_MAX_MS;
+	}
+	hints[PNP_HINT_LAUNCH].config.sched_boost = 1;
+
+	/* Readers get the first event without waiting */
+	hint_event.seq = 1;
+
+	ret = cpufreq_register_notifier(&pnp_hint_policy_nb,
+					CPUFREQ_POLICY_NOTIFIER);
+	if (ret)
+		return ret;
+
+	ret = misc_register(&pnp_hint_misc);
+	if (ret) {
+		cpufreq_unregister_notifier(&pnp_hint_policy_nb,
+					    CPUFREQ_POLICY_NOTIFIER);
+		return ret;
+	}
+
+	mutex_lock(&hint_lock);
+	hint_ready = true;
+	mutex_unlock(&hint_lock);
+	return 0;
+}
+late_initcall(pnp_hint_init);
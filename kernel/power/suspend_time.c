@@ -15,16 +15,97 @@
  */
 
 #include <linux/debugfs.h>
+#include <linux/device.h>
 #include <linux/err.h>
 #include <linux/init.h>
 #include <linux/kernel.h>
 #include <linux/seq_file.h>
+#include <linux/spinlock.h>
+#include <linux/string.h>
+#include <linux/suspend.h>
 #include <linux/syscore_ops.h>
 #include <linux/time.h>
 
 static struct timespec suspend_time_before;
 static unsigned int time_in_suspend_bins[32];
 
+/*
+ * Time spent in the suspend and resume callbacks of each device, for the
+ * last cycle and the worst cycle seen.
+ */
+#define DEV_TIME_ENTRIES	256
+#define DEV_TIME_NAME_LEN	40
+
+struct dev_time {
+	const struct device *dev;
+	char name[DEV_TIME_NAME_LEN];
+	u32 suspend_us;
+	u32 resume_us;
+	u32 max_suspend_us;
+	u32 max_resume_us;
+};
+
+static struct dev_time dev_times[DEV_TIME_ENTRIES];
+static unsigned int dev_times_used;
+static DEFINE_SPINLOCK(dev_times_lock);
+
+void suspend_time_dev_new_cycle(void)
+{
+	unsigned long flags;
+	int i;
+
+	spin_lock_irqsave(&dev_times_lock, flags);
+	for (i = 0; i < dev_times_used; i++) {
+		dev_times[i].suspend_us = 0;
+		dev_times[i].resume_us = 0;
+	}
+	spin_unlock_irqrestore(&dev_times_lock, flags);
+}
+
+static struct dev_time *dev_time_find(struct device *dev)
+{
+	const char *name = dev_name(dev);
+	struct dev_time *t;
+	int i;
+
+	for (i = 0; i < dev_times_used; i++) {
+		t = &dev_times[i];
+		if (t->dev == dev &&
+		    !strncmp(t->name, name, DEV_TIME_NAME_LEN - 1))
+			return t;
+	}
+
+	if (dev_times_used == DEV_TIME_ENTRIES)
+		return NULL;
+
+	t = &dev_times[dev_times_used++];
+	memset(t, 0, sizeof(*t));
+	t->dev = dev;
+	strlcpy(t->name, name, DEV_TIME_NAME_LEN);
+	return t;
+}
+
+/* Called by the PM core after each suspend or resume callback of @dev. */
+void suspend_time_dev_record(struct device *dev, pm_message_t state,
+			     s64 usecs)
+{
+	bool resume = state.event & (PM_EVENT_RESUME | PM_EVENT_THAW |
+				     PM_EVENT_RESTORE | PM_EVENT_RECOVER);
+	struct dev_time *t;
+	unsigned long flags;
+
+	spin_lock_irqsave(&dev_times_lock, flags);
+	t = dev_time_find(dev);
+	if (t && resume) {
+		t->resume_us += usecs;
+		t->max_resume_us = max(t->max_resume_us, t->resume_us);
+	} else if (t) {
+		t->suspend_us += usecs;
+		t->max_suspend_us = max(t->max_suspend_us, t->suspend_us);
+	}
+	spin_unlock_irqrestore(&dev_times_lock, flags);
+}
+
 #ifdef CONFIG_DEBUG_FS
 static int suspend_time_debug_show(struct seq_file *s, void *data)
 {
@@ -53,6 +134,39 @@ static const struct file_operations suspend_time_debug_fops = {
 	.release	= single_release,
 };
 
+static int suspend_dev_time_show(struct seq_file *s, void *data)
+{
+	struct dev_time t;
+	unsigned int i;
+
+	seq_printf(s, "%-40s %10s %10s %10s %10s\n", "device",
+		   "suspend", "resume", "max_susp", "max_resume");
+	for (i = 0; i < ACCESS_ONCE(dev_times_used); i++) {
+		spin_lock_irq(&dev_times_lock);
+		t = dev_times[i];
+		spin_unlock_irq(&dev_times_lock);
+
+		if (!t.max_suspend_us && !t.max_resume_us)
+			continue;
+		seq_printf(s, "%-40s %10u %10u %10u %10u\n", t.name,
+			   t.suspend_us, t.resume_us,
+			   t.max_suspend_us, t.max_resume_us);
+	}
+	return 0;
+}
+
+static int suspend_dev_time_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, suspend_dev_time_show, NULL);
+}
+
+static const struct file_operations suspend_dev_time_fops = {
+	.open		= suspend_dev_time_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 static int __init suspend_time_debug_init(void)
 {
 	struct dentry *d;
@@ -64,6 +178,13 @@ static int __init suspend_time_debug_init(void)
 		return -ENOMEM;
 	}
 
+	d = debugfs_create_file("suspend_dev_time", 0444, NULL, NULL,
+		&suspend_dev_time_fops);
+	if (!d) {
+		pr_err("Failed to create suspend_dev_time debug file\n");
+		return -ENOMEM;
+	}
+
 	return 0;
 }
 
@@ -44,6 +44,7 @@
 #include <linux/rculist.h>
 #include <linux/poll.h>
 #include <linux/irq_work.h>
+#include <linux/kthread.h>
 #include <linux/utsname.h>
 #include <linux/ctype.h>
 
@@ -1071,6 +1072,20 @@ module_param(ignore_loglevel, bool, S_IRUGO | S_IWUSR);
 MODULE_PARM_DESC(ignore_loglevel, "ignore loglevel setting, to"
 	"print all kernel messages to the console.");
 
+#ifdef CONFIG_PRINTK_ASYNC
+static bool __read_mostly printk_async = true;
+module_param_named(async, printk_async, bool, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(async, "print to the consoles from a kthread");
+
+static struct task_struct *printk_kthread;
+static bool printk_async_kick(void);
+#else
+static inline bool printk_async_kick(void)
+{
+	return false;
+}
+#endif
+
 #ifdef CONFIG_BOOT_PRINTK_DELAY
 
 static int boot_delay; /* msecs delay after each printk during bootup */
@@ -2141,7 +2156,7 @@ asmlinkage int vprintk_emit(int facility, int level,
 	local_irq_restore(flags);
 
 	/* If called from the scheduler, we can not call up(). */
-	if (!in_sched) {
+	if (!in_sched && !printk_async_kick()) {
 		lockdep_off();
 		/*
 		 * Disable preemption to avoid being preempted while holding
@@ -3040,6 +3055,7 @@ late_initcall(printk_late_init);
  */
 #define PRINTK_PENDING_WAKEUP	0x01
 #define PRINTK_PENDING_OUTPUT	0x02
+#define PRINTK_PENDING_ASYNC	0x04
 
 static DEFINE_PER_CPU(int, printk_pending);
 
@@ -3055,6 +3071,11 @@ static void wake_up_klogd_work_func(struct irq_work *irq_work)
 
 	if (pending & PRINTK_PENDING_WAKEUP)
 		wake_up_interruptible(&log_wait);
+
+#ifdef CONFIG_PRINTK_ASYNC
+	if (pending & PRINTK_PENDING_ASYNC)
+		wake_up_process(printk_kthread);
+#endif
 }
 
 static DEFINE_PER_CPU(struct irq_work, wake_up_klogd_work) = {
@@ -3072,6 +3093,78 @@ void wake_up_klogd(void)
 	preempt_enable();
 }
 
+#ifdef CONFIG_PRINTK_ASYNC
+/*
+ * Hands the console output of a message off to printk_kthread. Returns
+ * false if the caller has to print it: early in boot, when the console
+ * output may be the last thing to happen (oops, panic, reboot) or when
+ * turned off by printk.async=0.
+ *
+ * The kthread is woken from irq_work since printk may be called with
+ * scheduler or wait queue locks held.
+ */
+static bool printk_async_kick(void)
+{
+	if (!printk_async || !printk_kthread || oops_in_progress ||
+	    system_state != SYSTEM_RUNNING)
+		return false;
+
+	preempt_disable();
+	this_cpu_or(printk_pending, PRINTK_PENDING_ASYNC);
+	irq_work_queue(&__get_cpu_var(wake_up_klogd_work));
+	preempt_enable();
+
+	return true;
+}
+
+static bool console_has_pending(void)
+{
+	unsigned long flags;
+	bool ret;
+
+	raw_spin_lock_irqsave(&logbuf_lock, flags);
+	ret = console_seq != log_next_seq;
+	raw_spin_unlock_irqrestore(&logbuf_lock, flags);
+
+	return ret;
+}
+
+static int printk_kthread_func(void *unused)
+{
+	while (!kthread_should_stop()) {
+		/*
+		 * New messages are stored under logbuf_lock before the kick,
+		 * so checking after setting the task state can't miss one.
+		 * resume_console() flushes whatever came in while suspended.
+		 */
+		set_current_state(TASK_INTERRUPTIBLE);
+		if (console_suspended || !console_has_pending())
+			schedule();
+		__set_current_state(TASK_RUNNING);
+
+		console_lock();
+		console_unlock();
+	}
+
+	return 0;
+}
+
+static int __init printk_kthread_init(void)
+{
+	struct task_struct *p;
+
+	p = kthread_run(printk_kthread_func, NULL, "printk");
+	if (IS_ERR(p)) {
+		pr_err("printk: unable to start printk kthread\n");
+		return PTR_ERR(p);
+	}
+
+	printk_kthread = p;
+	return 0;
+}
+late_initcall(printk_kthread_init);
+#endif
+
 int printk_deferred(const char *fmt, ...)
 {
 	va_list args;
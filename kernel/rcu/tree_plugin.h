@@ -43,6 +43,12 @@ static cpumask_var_t rcu_nocb_mask; /* CPUs to have callbacks offloaded. */
 static bool have_rcu_nocb_mask;	    /* Was rcu_nocb_mask allocated? */
 static bool __read_mostly rcu_nocb_poll;    /* Offload kthread are to poll. */
 static char __initdata nocb_buf[NR_CPUS * 5];
+static cpumask_var_t rcu_nocb_affinity; /* CPUs to run the kthreads on. */
+static bool have_rcu_nocb_affinity; /* Was rcu_nocb_affinity allocated? */
+
+/* Delay invocation of all-lazy (kfree_rcu()) batches by up to this long. */
+static int rcu_nocb_lazy_delay = HZ;
+module_param(rcu_nocb_lazy_delay, int, 0644);
 #endif /* #ifdef CONFIG_RCU_NOCB_CPU */
 
 /*
@@ -2053,6 +2059,16 @@ static int __init rcu_nocb_setup(char *str)
 }
 __setup("rcu_nocbs=", rcu_nocb_setup);
 
+/* Parse the boot-time CPU list the rcuo kthreads are bound to. */
+static int __init rcu_nocb_affinity_setup(char *str)
+{
+	alloc_bootmem_cpumask_var(&rcu_nocb_affinity);
+	have_rcu_nocb_affinity = true;
+	cpulist_parse(str, rcu_nocb_affinity);
+	return 1;
+}
+__setup("rcu_nocb_affinity=", rcu_nocb_affinity_setup);
+
 static int __init parse_rcu_nocb_poll(char *arg)
 {
 	rcu_nocb_poll = 1;
@@ -2152,6 +2168,13 @@ static void __call_rcu_nocb_enqueue(struct rcu_data *rdp,
 					    TPS("WakeEmptyIsDeferred"));
 		}
 		rdp->qlen_last_fqs_check = 0;
+	} else if (rhcount != rhcount_lazy && ACCESS_ONCE(rdp->nocb_lazy_wait)) {
+		/* ... or if it is holding back a lazy batch ... */
+		if (!irqs_disabled_flags(flags))
+			wake_up(&rdp->nocb_wq);
+		else
+			rdp->nocb_defer_wakeup = true;
+		trace_rcu_nocb_wake(rdp->rsp->name, rdp->cpu, TPS("WakeLazy"));
 	} else if (len > rdp->qlen_last_fqs_check + qhimark) {
 		wake_up_process(t); /* ... or if many callbacks queued. */
 		rdp->qlen_last_fqs_check = LONG_MAX / 2;
@@ -2259,6 +2282,37 @@ static void rcu_nocb_wait_gp(struct rcu_data *rdp)
 	smp_mb(); /* Ensure that CB invocation happens after GP end. */
 }
 
+/*
+ * A batch that holds nothing but lazy callbacks only frees memory, so it
+ * can wait for more callbacks to share its grace period and its wakeup.
+ */
+static bool rcu_nocb_lazy_ready(struct rcu_data *rdp)
+{
+	long c = atomic_long_read(&rdp->nocb_q_count);
+
+	return c != atomic_long_read(&rdp->nocb_q_count_lazy) || c >= qhimark;
+}
+
+static void rcu_nocb_wait_lazy(struct rcu_data *rdp)
+{
+	int delay = ACCESS_ONCE(rcu_nocb_lazy_delay);
+
+	if (rcu_nocb_poll || delay <= 0 || rcu_nocb_lazy_ready(rdp))
+		return;
+
+	ACCESS_ONCE(rdp->nocb_lazy_wait) = true;
+	/*
+	 * Order against enqueuers checking ->nocb_lazy_wait.  A wakeup lost
+	 * to the race only costs the timeout below.
+	 */
+	smp_mb();
+	trace_rcu_nocb_wake(rdp->rsp->name, rdp->cpu, TPS("LazyWait"));
+	wait_event_interruptible_timeout(rdp->nocb_wq,
+					 rcu_nocb_lazy_ready(rdp), delay);
+	ACCESS_ONCE(rdp->nocb_lazy_wait) = false;
+	flush_signals(current);
+}
+
 /*
  * Per-rcu_data kthread, but only for no-CBs CPUs.  Each kthread invokes
  * callbacks queued by the corresponding no-CBs CPU.
@@ -2297,6 +2351,7 @@ static int rcu_nocb_kthread(void *arg)
 		firsttime = 1;
 		trace_rcu_nocb_wake(rdp->rsp->name, rdp->cpu,
 				    TPS("WokeNonEmpty"));
+		rcu_nocb_wait_lazy(rdp);
 
 		/*
 		 * Extract queued callbacks, update counts, and wait
@@ -2382,6 +2437,48 @@ static void __init rcu_spawn_nocb_kthreads(struct rcu_state *rsp)
 	}
 }
 
+/*
+ * Bind the kthreads to the CPUs given by rcu_nocb_affinity=, or else to
+ * the cluster of CPU 0.  This has to wait until all CPUs are up, as the
+ * cluster topology is only known then.
+ */
+static int __init rcu_nocb_affine_kthreads(void)
+{
+	const struct cpumask *mask = NULL;
+	struct rcu_state *rsp;
+	struct rcu_data *rdp;
+	struct task_struct *t;
+	int cpu;
+
+	if (!have_rcu_nocb_mask)
+		return 0;
+	if (have_rcu_nocb_affinity)
+		mask = rcu_nocb_affinity;
+#ifdef CONFIG_RCU_NOCB_CPU_CLUSTER0
+	else
+		mask = topology_core_cpumask(0);
+#endif
+	if (!mask)
+		return 0;
+	if (!cpumask_intersects(mask, cpu_online_mask)) {
+		pr_info("\tOffload kthread affinity has no online CPUs, ignored.\n");
+		return 0;
+	}
+
+	for_each_rcu_flavor(rsp) {
+		for_each_cpu(cpu, rcu_nocb_mask) {
+			rdp = per_cpu_ptr(rsp->rda, cpu);
+			t = ACCESS_ONCE(rdp->nocb_kthread);
+			if (t)
+				set_cpus_allowed_ptr(t, mask);
+		}
+	}
+	cpulist_scnprintf(nocb_buf, sizeof(nocb_buf), mask);
+	pr_info("\tOffload kthreads bound to CPUs %s.\n", nocb_buf);
+	return 0;
+}
+late_initcall(rcu_nocb_affine_kthreads);
+
 /* Prevent __call_rcu() from enqueuing callbacks on no-CBs CPUs */
 static bool init_nocb_callback_list(struct rcu_data *rdp)
 {
@@ -75,6 +75,7 @@
 #include <linux/context_tracking.h>
 #include <linux/cpufreq.h>
 #include <linux/nospec.h>
+#include <linux/sched_latency.h>
 
 #include <asm/switch_to.h>
 #include <asm/tlb.h>
@@ -679,6 +680,12 @@ void resched_cpu(int cpu)
  * In the semi idle case, use the nearest busy cpu for migrating timers
  * from an idle cpu.  This is good for power-savings.
  *
+ * The cluster of the idle cpu is searched first, as its caches and clock
+ * domain are shared and the topology may not have a sched domain for it.
+ * With sysctl_power_aware_timer_migration set the search stops there, so
+ * timers don't get queued on a busy cpu of another cluster that would
+ * then have to wake up from its low power mode to run them.
+ *
  * We don't do similar optimization for completely idle system, as
  * selecting an idle cpu will add more delays to the timers than intended
  * (as that cpu's timer base may not be uptodate wrt jiffies etc).
@@ -692,6 +699,14 @@ int get_nohz_timer_target(int pinned)
 	if (pinned || !get_sysctl_timer_migration() || !idle_cpu(cpu))
 		return cpu;
 
+	for_each_cpu(i, topology_core_cpumask(cpu)) {
+		if (!idle_cpu(i))
+			return i;
+	}
+
+	if (sysctl_power_aware_timer_migration)
+		return cpu;
+
 	rcu_read_lock();
 	for_each_domain(cpu, sd) {
 		for_each_cpu(i, sched_domain_span(sd)) {
@@ -1423,8 +1438,12 @@ static inline unsigned int load_to_freq(struct rq *rq, u64 load)
 	return freq;
 }
 
-/* Should scheduler alert governor for changing frequency? */
-static int send_notification(struct rq *rq)
+/*
+ * Should scheduler alert governor for changing frequency? @check_freq is
+ * false when the load of @rq is known to have changed, regardless of the
+ * sched_freq_inc_notify/dec_notify thresholds.
+ */
+static int send_notification(struct rq *rq, bool check_freq)
 {
 	unsigned int cur_freq, freq_required;
 	unsigned long flags;
@@ -1436,7 +1455,7 @@ static int send_notification(struct rq *rq)
 	cur_freq = load_to_freq(rq, rq->old_busy_time);
 	freq_required = load_to_freq(rq, rq->prev_runnable_sum);
 
-	if (nearly_same_freq(cur_freq, freq_required))
+	if (check_freq && nearly_same_freq(cur_freq, freq_required))
 		return 0;
 
 	raw_spin_lock_irqsave(&rq->lock, flags);
@@ -1449,12 +1468,38 @@ static int send_notification(struct rq *rq)
 	return rc;
 }
 
-/* Alert governor if there is a need to change frequency */
-void check_for_freq_change(struct rq *rq)
+static DEFINE_PER_CPU(struct sched_freq_hook *, sched_freq_hook);
+
+/**
+ * sched_set_freq_hook - install a frequency governor hook for a cpu
+ * @cpu: the cpu
+ * @hook: the hook, or NULL to remove the current one
+ *
+ * The hook is called on every scheduler tick of @cpu and whenever a load
+ * alert is raised for it. After removing a hook the caller must wait for
+ * synchronize_sched() before freeing it.
+ */
+void sched_set_freq_hook(int cpu, struct sched_freq_hook *hook)
+{
+	rcu_assign_pointer(per_cpu(sched_freq_hook, cpu), hook);
+}
+
+static inline void sched_freq_hook_call(struct rq *rq, unsigned int flags)
+{
+	struct sched_freq_hook *hook;
+
+	rcu_read_lock_sched();
+	hook = rcu_dereference_sched(per_cpu(sched_freq_hook, cpu_of(rq)));
+	if (hook)
+		hook->func(hook, cpu_of(rq), rq->window_start, flags);
+	rcu_read_unlock_sched();
+}
+
+static void __check_for_freq_change(struct rq *rq, bool check_freq)
 {
 	int cpu = cpu_of(rq);
 
-	if (!send_notification(rq))
+	if (!send_notification(rq, check_freq))
 		return;
 
 	trace_sched_freq_alert(cpu, rq->old_busy_time, rq->prev_runnable_sum);
@@ -1462,6 +1507,41 @@ void check_for_freq_change(struct rq *rq)
 	atomic_notifier_call_chain(
 		&load_alert_notifier_head, 0,
 		(void *)(long)cpu);
+
+	sched_freq_hook_call(rq, SCHED_FREQ_ALERT);
+}
+
+/* Alert governor if there is a need to change frequency */
+void check_for_freq_change(struct rq *rq)
+{
+	__check_for_freq_change(rq, true);
+}
+
+/**
+ * check_for_freq_change_migrate - alert governors after a migration
+ * @src_rq: runqueue the load was taken from
+ * @dest_rq: runqueue the load was moved to
+ * @demand_moved: window based demand moved along with the task(s)
+ *
+ * Called after moving tasks between cpus of different frequency domains.
+ * fixup_busy_time() has already moved the demand of the migrated tasks
+ * from the busy time of @src_rq to that of @dest_rq, so when it did, both
+ * domains are due a frequency update right away rather than at the next
+ * governor sample, whatever the notification thresholds.
+ */
+void check_for_freq_change_migrate(struct rq *src_rq, struct rq *dest_rq,
+				   bool demand_moved)
+{
+	bool check_freq = !(demand_moved && sched_migration_fixup);
+
+	__check_for_freq_change(src_rq, check_freq);
+	__check_for_freq_change(dest_rq, check_freq);
+}
+
+void sched_freq_tick(struct rq *rq)
+{
+	if (sched_enable_hmp)
+		sched_freq_hook_call(rq, 0);
 }
 
 static int account_busy_for_cpu_time(struct rq *rq, struct task_struct *p,
@@ -2320,7 +2400,7 @@ void sched_get_cpus_busy(unsigned long *busy, const struct cpumask *query_cpus)
 	unsigned long flags;
 	struct rq *rq;
 	const int cpus = cpumask_weight(query_cpus);
-	u64 load[cpus];
+	u64 load[cpus], floor[cpus];
 	unsigned int cur_freq[cpus], max_freq[cpus];
 	int notifier_sent[cpus];
 	int cpu, i = 0;
@@ -2353,6 +2433,13 @@ void sched_get_cpus_busy(unsigned long *busy, const struct cpumask *query_cpus)
 		 */
 		load[i] = scale_load_to_cpu(load[i], cpu);
 
+		/*
+		 * Tasks with a minimum utilization clamp hold the busy time
+		 * up to their combined minimum demand.
+		 */
+		floor[i] = div64_u64((u64)rq->hmp_stats.util_min_pct *
+				     window_size, 100);
+
 		notifier_sent[i] = rq->notifier_sent;
 		rq->notifier_sent = 0;
 		cur_freq[i] = rq->cur_freq;
@@ -2380,6 +2467,8 @@ void sched_get_cpus_busy(unsigned long *busy, const struct cpumask *query_cpus)
 						     rq->max_possible_freq);
 		}
 
+		load[i] = max(load[i], min_t(u64, floor[i], window_size));
+
 		busy[i] = div64_u64(load[i], NSEC_PER_USEC);
 
 		trace_sched_get_busy(cpu, busy[i]);
@@ -3251,6 +3340,7 @@ ttwu_do_wakeup(struct rq *rq, struct task_struct *p, int wake_flags)
 {
 	check_preempt_curr(rq, p, wake_flags);
 	trace_sched_wakeup(p, true);
+	sched_latency_wakeup(p);
 
 	p->state = TASK_RUNNING;
 #ifdef CONFIG_SMP
@@ -3558,8 +3648,9 @@ out:
 
 	if (freq_notif_allowed) {
 		if (!same_freq_domain(src_cpu, cpu)) {
-			check_for_freq_change(cpu_rq(cpu));
-			check_for_freq_change(cpu_rq(src_cpu));
+			check_for_freq_change_migrate(cpu_rq(src_cpu),
+						      cpu_rq(cpu),
+						      p->ravg.prev_window);
 		} else if (heavy_task) {
 			check_for_freq_change(cpu_rq(cpu));
 		}
@@ -3664,6 +3755,9 @@ int wake_up_state(struct task_struct *p, unsigned int state)
 static void __sched_fork(struct task_struct *p)
 {
 	p->on_rq			= 0;
+#ifdef CONFIG_SCHED_LATENCY_HIST
+	p->lat_wakeup_ns		= 0;
+#endif
 
 	p->se.on_rq			= 0;
 	p->se.exec_start		= 0;
@@ -3966,6 +4060,7 @@ static void finish_task_switch(struct rq *rq, struct task_struct *prev)
 	perf_event_task_sched_in(prev, current);
 	finish_lock_switch(rq, prev);
 	finish_arch_post_lock_switch();
+	cpufreq_uid_stats_account(prev);
 
 	fire_sched_in_preempt_notifiers(current);
 	if (mm)
@@ -4838,6 +4933,8 @@ void scheduler_tick(void)
 	update_task_ravg(rq->curr, rq, TASK_UPDATE, sched_clock(), 0);
 	raw_spin_unlock(&rq->lock);
 
+	sched_freq_tick(rq);
+	cpufreq_uid_stats_account(curr);
 	perf_event_task_tick();
 
 #ifdef CONFIG_SMP
@@ -4847,6 +4944,7 @@ void scheduler_tick(void)
 	rq_last_tick_reset(rq);
 	if (curr->sched_class == &fair_sched_class)
 		check_for_migration(rq, curr);
+	core_ctl_check();
 }
 
 #ifdef CONFIG_NO_HZ_FULL
@@ -5116,6 +5214,7 @@ need_resched:
 	wallclock = sched_clock();
 	update_task_ravg(prev, rq, PUT_PREV_TASK, wallclock, 0);
 	update_task_ravg(next, rq, PICK_NEXT_TASK, wallclock, 0);
+	sched_latency_switch(prev, next, wallclock);
 	clear_tsk_need_resched(prev);
 	rq->skip_clock_update = 0;
 
@@ -6169,9 +6268,44 @@ int sched_setscheduler(struct task_struct *p, int policy,
 }
 EXPORT_SYMBOL_GPL(sched_setscheduler);
 
+/**
+ * sched_setattr - change the scheduling policy and hints of a thread.
+ * @p: the task in question.
+ * @attr: the new policy and parameters.
+ *
+ * Besides the policy, @attr may carry the utilization clamps, applied
+ * according to SCHED_FLAG_UTIL_CLAMP_{MIN,MAX}, and marks the task latency
+ * sensitive if SCHED_FLAG_LATENCY_SENSITIVE is set. A latency sensitive
+ * task is woken up on an idle cpu where possible. May sleep.
+ */
 int sched_setattr(struct task_struct *p, const struct sched_attr *attr)
 {
-	return __sched_setscheduler(p, attr, true);
+	unsigned int util_min, util_max;
+	int retval;
+
+	if (attr->sched_flags & ~SCHED_FLAG_ALL)
+		return -EINVAL;
+
+	sched_get_util_clamp(p, &util_min, &util_max);
+	if (attr->sched_flags & SCHED_FLAG_UTIL_CLAMP_MIN)
+		util_min = attr->sched_util_min;
+	if (attr->sched_flags & SCHED_FLAG_UTIL_CLAMP_MAX)
+		util_max = attr->sched_util_max;
+	if (util_min > util_max || util_max > 100)
+		return -EINVAL;
+
+	retval = __sched_setscheduler(p, attr, true);
+	if (retval)
+		return retval;
+
+	if (attr->sched_flags & SCHED_FLAG_UTIL_CLAMP) {
+		retval = sched_set_util_clamp(p, util_min, util_max);
+		if (retval)
+			return retval;
+	}
+
+	return sched_set_wake_up_idle(p,
+			!!(attr->sched_flags & SCHED_FLAG_LATENCY_SENSITIVE));
 }
 EXPORT_SYMBOL_GPL(sched_setattr);
 
@@ -6337,12 +6471,18 @@ SYSCALL_DEFINE3(sched_setattr, pid_t, pid, struct sched_attr __user *, uattr,
 		return -EFAULT;
 
 	rcu_read_lock();
-	retval = -ESRCH;
 	p = find_process_by_pid(pid);
-	if (p != NULL)
-		retval = sched_setattr(p, &attr);
+	if (!p) {
+		rcu_read_unlock();
+		return -ESRCH;
+	}
+	/* Applying the utilization clamps may sleep */
+	get_task_struct(p);
 	rcu_read_unlock();
 
+	retval = sched_setattr(p, &attr);
+	put_task_struct(p);
+
 	return retval;
 }
 
@@ -6486,6 +6626,16 @@ SYSCALL_DEFINE4(sched_getattr, pid_t, pid, struct sched_attr __user *, uattr,
 	else
 		attr.sched_nice = task_nice(p);
 
+	if (sched_get_wake_up_idle(p))
+		attr.sched_flags |= SCHED_FLAG_LATENCY_SENSITIVE;
+
+	/* Keep returning a VER0 struct to callers that only know that one */
+	if (size >= SCHED_ATTR_SIZE_VER1) {
+		sched_get_util_clamp(p, &attr.sched_util_min,
+				     &attr.sched_util_max);
+		attr.sched_flags |= SCHED_FLAG_UTIL_CLAMP;
+	}
+
 	rcu_read_unlock();
 
 	retval = sched_read_attr(uattr, &attr, size);
@@ -7272,10 +7422,9 @@ done:
 fail:
 	double_rq_unlock(rq_src, rq_dest);
 	raw_spin_unlock(&p->pi_lock);
-	if (moved && !same_freq_domain(src_cpu, dest_cpu)) {
-		check_for_freq_change(rq_src);
-		check_for_freq_change(rq_dest);
-	}
+	if (moved && !same_freq_domain(src_cpu, dest_cpu))
+		check_for_freq_change_migrate(rq_src, rq_dest,
+					      p->ravg.prev_window);
 	if (moved && task_notify_on_migrate(p)) {
 		struct migration_notify_data mnd;
 
@@ -7307,6 +7456,110 @@ static int migration_cpu_stop(void *data)
 	return 0;
 }
 
+#ifdef CONFIG_SCHED_CORE_CTL
+
+struct cpumask __cpu_isolated_mask __read_mostly;
+
+/*
+ * Pick the next queued fair task of @rq that is allowed to run on some
+ * active, non isolated cpu, and that cpu.
+ */
+static struct task_struct *pick_isolation_victim(struct rq *rq, int *dest)
+{
+	struct task_struct *p;
+	struct cpumask avail;
+
+	cpumask_andnot(&avail, cpu_active_mask, cpu_isolated_mask);
+
+	list_for_each_entry(p, &rq->cfs_tasks, se.group_node) {
+		if (p == rq->curr)
+			continue;
+
+		*dest = cpumask_any_and(tsk_cpus_allowed(p), &avail);
+		if (*dest < nr_cpu_ids) {
+			get_task_struct(p);
+			return p;
+		}
+	}
+
+	return NULL;
+}
+
+/* runs on the isolated cpu, so none of its fair tasks is running */
+static int isolate_cpu_stop(void *data)
+{
+	int cpu = raw_smp_processor_id();
+	struct rq *rq = cpu_rq(cpu);
+	struct task_struct *p;
+	unsigned int budget;
+	int dest;
+
+	local_irq_disable();
+	budget = rq->nr_running;
+	while (budget--) {
+		raw_spin_lock(&rq->lock);
+		p = pick_isolation_victim(rq, &dest);
+		raw_spin_unlock(&rq->lock);
+		if (!p)
+			break;
+
+		__migrate_task(p, cpu, dest);
+		put_task_struct(p);
+	}
+	local_irq_enable();
+
+	return 0;
+}
+
+/**
+ * sched_isolate_cpu - stop placing work on a cpu without taking it down
+ * @cpu: the cpu to isolate
+ *
+ * Queued fair tasks are moved to other cpus; rt tasks and sleeping tasks
+ * leave at their next wakeup. Tasks bound to @cpu, such as per-cpu kernel
+ * threads, keep running there. May sleep.
+ *
+ * Returns 0 on success, -EINVAL if @cpu is offline or the last active
+ * non isolated cpu.
+ */
+int sched_isolate_cpu(int cpu)
+{
+	struct cpumask avail;
+
+	get_online_cpus();
+	cpumask_andnot(&avail, cpu_active_mask, cpu_isolated_mask);
+	cpumask_clear_cpu(cpu, &avail);
+	if (!cpu_active(cpu) || cpumask_empty(&avail)) {
+		put_online_cpus();
+		return -EINVAL;
+	}
+
+	cpumask_set_cpu(cpu, &__cpu_isolated_mask);
+	/* placement done before the stopper runs must see @cpu isolated */
+	smp_mb();
+	stop_one_cpu(cpu, isolate_cpu_stop, NULL);
+	put_online_cpus();
+
+	return 0;
+}
+
+/**
+ * sched_unisolate_cpu - make an isolated cpu available again
+ * @cpu: the cpu to release
+ *
+ * The load balancer and wakeup placement start using @cpu again right
+ * away; a nohz balance kick fills it if other cpus are busy.
+ */
+void sched_unisolate_cpu(int cpu)
+{
+	cpumask_clear_cpu(cpu, &__cpu_isolated_mask);
+	smp_mb();
+	if (cpu_online(cpu))
+		smp_send_reschedule(cpu);
+}
+
+#endif /* CONFIG_SCHED_CORE_CTL */
+
 #ifdef CONFIG_HOTPLUG_CPU
 
 /*
@@ -9389,6 +9642,9 @@ void __init sched_init(void)
 #ifdef CONFIG_CGROUP_SCHED
 	list_add(&root_task_group.list, &task_groups);
 	INIT_LIST_HEAD(&root_task_group.children);
+#ifdef CONFIG_SCHED_HMP
+	root_task_group.util_max = 100;
+#endif
 	INIT_LIST_HEAD(&root_task_group.siblings);
 	autogroup_init(&init_task);
 
@@ -9726,6 +9982,10 @@ struct task_group *sched_create_group(struct task_group *parent)
 	if (!tg)
 		return ERR_PTR(-ENOMEM);
 
+#ifdef CONFIG_SCHED_HMP
+	tg->util_max = 100;
+#endif
+
 	if (!alloc_fair_sched_group(tg, parent))
 		goto err;
 
@@ -10275,8 +10535,66 @@ static int cpu_upmigrate_discourage_write_u64(struct cgroup *cgrp,
 	return 0;
 }
 
+static u64 cpu_util_min_read_u64(struct cgroup *cgrp, struct cftype *cft)
+{
+	return cgroup_tg(cgrp)->util_min;
+}
+
+static u64 cpu_util_max_read_u64(struct cgroup *cgrp, struct cftype *cft)
+{
+	return cgroup_tg(cgrp)->util_max;
+}
+
+/*
+ * The clamps of a group apply to each of its tasks, in addition to their
+ * own. Like upmigrate_discourage they change big/small classification.
+ */
+static int cpu_util_clamp_write_u64(struct cgroup *cgrp, struct cftype *cft,
+				    u64 val)
+{
+	struct task_group *tg = cgroup_tg(cgrp);
+	bool is_min = cft->private;
+	static DEFINE_MUTEX(util_clamp_mutex);
+	int ret = 0;
+
+	mutex_lock(&util_clamp_mutex);
+	if (val > 100 || (is_min && val > tg->util_max) ||
+	    (!is_min && val < tg->util_min)) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	get_online_cpus();
+	pre_big_small_task_count_change(cpu_online_mask);
+
+	if (is_min)
+		tg->util_min = val;
+	else
+		tg->util_max = val;
+
+	post_big_small_task_count_change(cpu_online_mask);
+	put_online_cpus();
+out:
+	mutex_unlock(&util_clamp_mutex);
+
+	return ret;
+}
+
 #endif	/* CONFIG_SCHED_HMP */
 
+static u64 cpu_wake_up_idle_read_u64(struct cgroup *cgrp, struct cftype *cft)
+{
+	return cgroup_tg(cgrp)->wake_up_idle;
+}
+
+static int cpu_wake_up_idle_write_u64(struct cgroup *cgrp, struct cftype *cft,
+				      u64 wake_up_idle)
+{
+	cgroup_tg(cgrp)->wake_up_idle = !!wake_up_idle;
+
+	return 0;
+}
+
 #ifdef CONFIG_FAIR_GROUP_SCHED
 static int cpu_shares_write_u64(struct cgroup *cgrp, struct cftype *cftype,
 				u64 shareval)
@@ -10566,7 +10884,24 @@ static struct cftype cpu_files[] = {
 		.read_u64 = cpu_upmigrate_discourage_read_u64,
 		.write_u64 = cpu_upmigrate_discourage_write_u64,
 	},
+	{
+		.name = "util_min",
+		.private = 1,
+		.read_u64 = cpu_util_min_read_u64,
+		.write_u64 = cpu_util_clamp_write_u64,
+	},
+	{
+		.name = "util_max",
+		.private = 0,
+		.read_u64 = cpu_util_max_read_u64,
+		.write_u64 = cpu_util_clamp_write_u64,
+	},
 #endif
+	{
+		.name = "wake_up_idle",
+		.read_u64 = cpu_wake_up_idle_read_u64,
+		.write_u64 = cpu_wake_up_idle_write_u64,
+	},
 #ifdef CONFIG_FAIR_GROUP_SCHED
 	{
 		.name = "shares",
@@ -0,0 +1,572 @@
+/* Copyright (c) 2016, HTC Corporation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * Load based core control
+ *
+ * Decides per cluster how many cpus are needed, from the HMP window
+ * demand of each cpu and from sched_get_nr_running_avg(), and isolates
+ * the cpus that are not (see sched_isolate_cpu()). Isolation keeps the
+ * cpu online, so bringing it back is a matter of clearing a bit and
+ * takes effect within the tick that noticed the load, instead of the
+ * tens of milliseconds of a cpu_up().
+ *
+ * The tunables of each cluster live in
+ * /sys/devices/system/cpu/cpuN/core_ctl/, N being the first cpu of the
+ * cluster.
+ */
+
+#define pr_fmt(fmt) "core_ctl: " fmt
+
+#include <linux/cpu.h>
+#include <linux/cpumask.h>
+#include <linux/init.h>
+#include <linux/kobject.h>
+#include <linux/kthread.h>
+#include <linux/mutex.h>
+#include <linux/sched.h>
+#include <linux/sched/rt.h>
+#include <linux/slab.h>
+#include <linux/topology.h>
+
+#include "sched.h"
+
+#define MAX_CLUSTERS	2
+
+struct cluster_data {
+	bool inited;
+	unsigned int first_cpu;
+	struct cpumask cpus;
+	unsigned int num_cpus;
+	bool is_big_cluster;
+	unsigned int min_cpus;
+	unsigned int max_cpus;
+	unsigned int busy_up_thres;
+	unsigned int busy_down_thres;
+	unsigned int offline_delay_ms;
+	unsigned int need_cpus;
+	unsigned long need_ts;
+	bool pending;
+	spinlock_t pending_lock;
+	struct mutex lock;
+	struct task_struct *thread;
+	struct kobject kobj;
+};
+
+struct cpu_data {
+	struct cluster_data *cluster;
+	unsigned int busy;
+	bool is_busy;
+	bool isolated;
+};
+
+static struct cluster_data cluster_state[MAX_CLUSTERS];
+static DEFINE_PER_CPU(struct cpu_data, cpu_state);
+static unsigned int num_clusters;
+static bool core_ctl_ready;
+
+static DEFINE_SPINLOCK(eval_lock);
+static unsigned long last_eval;
+
+/* ========================= sysfs interface =========================== */
+
+static unsigned int cluster_active_cpus(struct cluster_data *cluster)
+{
+	unsigned int cpu, active = 0;
+
+	for_each_cpu(cpu, &cluster->cpus)
+		if (cpu_online(cpu) && !cpu_isolated(cpu))
+			active++;
+
+	return active;
+}
+
+static void wake_up_core_ctl_thread(struct cluster_data *cluster)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&cluster->pending_lock, flags);
+	cluster->pending = true;
+	spin_unlock_irqrestore(&cluster->pending_lock, flags);
+
+	wake_up_process(cluster->thread);
+}
+
+static ssize_t store_min_cpus(struct cluster_data *state,
+			      const char *buf, size_t count)
+{
+	unsigned int val;
+
+	if (sscanf(buf, "%u\n", &val) != 1)
+		return -EINVAL;
+
+	state->min_cpus = min(val, state->max_cpus);
+	wake_up_core_ctl_thread(state);
+
+	return count;
+}
+
+static ssize_t show_min_cpus(struct cluster_data *state, char *buf)
+{
+	return snprintf(buf, PAGE_SIZE, "%u\n", state->min_cpus);
+}
+
+static ssize_t store_max_cpus(struct cluster_data *state,
+			      const char *buf, size_t count)
+{
+	unsigned int val;
+
+	if (sscanf(buf, "%u\n", &val) != 1)
+		return -EINVAL;
+
+	val = min(val, state->num_cpus);
+	state->max_cpus = val;
+	state->min_cpus = min(state->min_cpus, state->max_cpus);
+	wake_up_core_ctl_thread(state);
+
+	return count;
+}
+
+static ssize_t show_max_cpus(struct cluster_data *state, char *buf)
+{
+	return snprintf(buf, PAGE_SIZE, "%u\n", state->max_cpus);
+}
+
+static ssize_t store_busy_up_thres(struct cluster_data *state,
+				   const char *buf, size_t count)
+{
+	unsigned int val;
+
+	if (sscanf(buf, "%u\n", &val) != 1 || val > 100)
+		return -EINVAL;
+
+	state->busy_up_thres = val;
+	return count;
+}
+
+static ssize_t show_busy_up_thres(struct cluster_data *state, char *buf)
+{
+	return snprintf(buf, PAGE_SIZE, "%u\n", state->busy_up_thres);
+}
+
+static ssize_t store_busy_down_thres(struct cluster_data *state,
+				     const char *buf, size_t count)
+{
+	unsigned int val;
+
+	if (sscanf(buf, "%u\n", &val) != 1 || val > 100)
+		return -EINVAL;
+
+	state->busy_down_thres = val;
+	return count;
+}
+
+static ssize_t show_busy_down_thres(struct cluster_data *state, char *buf)
+{
+	return snprintf(buf, PAGE_SIZE, "%u\n", state->busy_down_thres);
+}
+
+static ssize_t store_offline_delay_ms(struct cluster_data *state,
+				      const char *buf, size_t count)
+{
+	unsigned int val;
+
+	if (sscanf(buf, "%u\n", &val) != 1)
+		return -EINVAL;
+
+	state->offline_delay_ms = val;
+	return count;
+}
+
+static ssize_t show_offline_delay_ms(struct cluster_data *state, char *buf)
+{
+	return snprintf(buf, PAGE_SIZE, "%u\n", state->offline_delay_ms);
+}
+
+static ssize_t show_need_cpus(struct cluster_data *state, char *buf)
+{
+	return snprintf(buf, PAGE_SIZE, "%u\n", state->need_cpus);
+}
+
+static ssize_t show_active_cpus(struct cluster_data *state, char *buf)
+{
+	return snprintf(buf, PAGE_SIZE, "%u\n", cluster_active_cpus(state));
+}
+
+static ssize_t show_global_state(struct cluster_data *state, char *buf)
+{
+	struct cpu_data *c;
+	unsigned int cpu;
+	ssize_t count = 0;
+
+	for_each_cpu(cpu, &state->cpus) {
+		c = &per_cpu(cpu_state, cpu);
+		count += snprintf(buf + count, PAGE_SIZE - count,
+				  "CPU%u: online %u isolated %u busy %u%%%s\n",
+				  cpu, cpu_online(cpu), cpu_isolated(cpu),
+				  c->busy, c->is_busy ? " (busy)" : "");
+	}
+
+	return count;
+}
+
+struct core_ctl_attr {
+	struct attribute attr;
+	ssize_t (*show)(struct cluster_data *, char *);
+	ssize_t (*store)(struct cluster_data *, const char *, size_t count);
+};
+
+#define core_ctl_attr_ro(_name)		\
+static struct core_ctl_attr _name =	\
+__ATTR(_name, 0444, show_##_name, NULL)
+
+#define core_ctl_attr_rw(_name)			\
+static struct core_ctl_attr _name =		\
+__ATTR(_name, 0644, show_##_name, store_##_name)
+
+core_ctl_attr_rw(min_cpus);
+core_ctl_attr_rw(max_cpus);
+core_ctl_attr_rw(busy_up_thres);
+core_ctl_attr_rw(busy_down_thres);
+core_ctl_attr_rw(offline_delay_ms);
+core_ctl_attr_ro(need_cpus);
+core_ctl_attr_ro(active_cpus);
+core_ctl_attr_ro(global_state);
+
+static struct attribute *default_attrs[] = {
+	&min_cpus.attr,
+	&max_cpus.attr,
+	&busy_up_thres.attr,
+	&busy_down_thres.attr,
+	&offline_delay_ms.attr,
+	&need_cpus.attr,
+	&active_cpus.attr,
+	&global_state.attr,
+	NULL
+};
+
+#define to_cluster_data(k) container_of(k, struct cluster_data, kobj)
+#define to_attr(a) container_of(a, struct core_ctl_attr, attr)
+
+static ssize_t show(struct kobject *kobj, struct attribute *attr, char *buf)
+{
+	struct cluster_data *data = to_cluster_data(kobj);
+	struct core_ctl_attr *cattr = to_attr(attr);
+
+	if (!cattr->show)
+		return -EIO;
+
+	return cattr->show(data, buf);
+}
+
+static ssize_t store(struct kobject *kobj, struct attribute *attr,
+		     const char *buf, size_t count)
+{
+	struct cluster_data *data = to_cluster_data(kobj);
+	struct core_ctl_attr *cattr = to_attr(attr);
+
+	if (!cattr->store)
+		return -EIO;
+
+	return cattr->store(data, buf, count);
+}
+
+static const struct sysfs_ops sysfs_ops = {
+	.show	= show,
+	.store	= store,
+};
+
+static struct kobj_type ktype_core_ctl = {
+	.sysfs_ops	= &sysfs_ops,
+	.default_attrs	= default_attrs,
+};
+
+/* ========================= load evaluation =========================== */
+
+static unsigned int cpu_busy_pct(int cpu)
+{
+	u64 load = scale_load_to_cpu(cpu_rq(cpu)->hmp_stats.cumulative_runnable_avg,
+				     cpu);
+
+	return min_t(u64, div64_u64(load * 100, max_task_load()), 100);
+}
+
+static unsigned int compute_need_cpus(struct cluster_data *cluster,
+				      int nr_avg, int big_avg)
+{
+	struct cpu_data *c;
+	unsigned int cpu, need = 0;
+
+	for_each_cpu(cpu, &cluster->cpus) {
+		c = &per_cpu(cpu_state, cpu);
+		c->busy = cpu_online(cpu) ? cpu_busy_pct(cpu) : 0;
+		c->is_busy = c->busy >= (c->is_busy ? cluster->busy_down_thres :
+					 cluster->busy_up_thres);
+		if (c->is_busy)
+			need++;
+	}
+
+	/*
+	 * Runnable tasks that are not reflected in the demand yet: big
+	 * tasks want a big cpu each, and on other clusters every runnable
+	 * task wants a cpu.
+	 */
+	if (cluster->is_big_cluster)
+		need = max_t(unsigned int, need, DIV_ROUND_UP(big_avg, 100));
+	else
+		need = max_t(unsigned int, need,
+			     DIV_ROUND_UP(max(nr_avg - big_avg, 0), 100));
+
+	return clamp(need, cluster->min_cpus, cluster->max_cpus);
+}
+
+/**
+ * core_ctl_check - re-evaluate the number of cpus each cluster needs
+ *
+ * Called from scheduler_tick() on every cpu; the evaluation runs at most
+ * once per jiffy. More cpus are granted at once, fewer only after the need
+ * has stayed lower for offline_delay_ms.
+ */
+void core_ctl_check(void)
+{
+	struct cluster_data *cluster;
+	unsigned int i, need;
+	int nr_avg, iowait_avg, big_avg;
+	bool changed;
+
+	if (unlikely(!core_ctl_ready) || !sched_enable_hmp)
+		return;
+
+	if (time_before_eq(jiffies, ACCESS_ONCE(last_eval)))
+		return;
+
+	if (!spin_trylock(&eval_lock))
+		return;
+
+	if (time_before_eq(jiffies, last_eval)) {
+		spin_unlock(&eval_lock);
+		return;
+	}
+	last_eval = jiffies;
+
+	sched_get_nr_running_avg(&nr_avg, &iowait_avg, &big_avg);
+
+	for (i = 0; i < num_clusters; i++) {
+		cluster = &cluster_state[i];
+		need = compute_need_cpus(cluster, nr_avg, big_avg);
+
+		changed = false;
+		if (need > cluster->need_cpus) {
+			changed = true;
+		} else if (need < cluster->need_cpus) {
+			changed = time_after(jiffies, cluster->need_ts +
+				msecs_to_jiffies(cluster->offline_delay_ms));
+		}
+
+		if (need >= cluster->need_cpus)
+			cluster->need_ts = jiffies;
+
+		if (changed) {
+			cluster->need_cpus = need;
+			wake_up_core_ctl_thread(cluster);
+		}
+	}
+
+	spin_unlock(&eval_lock);
+}
+
+/* ========================= isolation ================================= */
+
+static void update_isolated_cpus(struct cluster_data *cluster)
+{
+	unsigned int cpu, victim_cpu = 0, need, active;
+	struct cpu_data *c, *victim;
+
+	mutex_lock(&cluster->lock);
+
+	need = clamp(cluster->need_cpus, cluster->min_cpus, cluster->max_cpus);
+	active = cluster_active_cpus(cluster);
+
+	/* release isolated cpus first, they are ready at once */
+	for_each_cpu(cpu, &cluster->cpus) {
+		if (active >= need)
+			break;
+		c = &per_cpu(cpu_state, cpu);
+		if (!c->isolated || !cpu_online(cpu))
+			continue;
+		sched_unisolate_cpu(cpu);
+		c->isolated = false;
+		active++;
+	}
+
+	/* then isolate the least busy ones, never the first cpu of the cluster */
+	while (active > need) {
+		victim = NULL;
+		for_each_cpu(cpu, &cluster->cpus) {
+			c = &per_cpu(cpu_state, cpu);
+			if (cpu == cluster->first_cpu || c->isolated ||
+			    !cpu_online(cpu))
+				continue;
+			if (!victim || c->busy < victim->busy) {
+				victim = c;
+				victim_cpu = cpu;
+			}
+		}
+		if (!victim)
+			break;
+
+		if (sched_isolate_cpu(victim_cpu))
+			break;
+		victim->isolated = true;
+		active--;
+	}
+
+	mutex_unlock(&cluster->lock);
+}
+
+static int try_core_ctl(void *data)
+{
+	struct cluster_data *cluster = data;
+	unsigned long flags;
+
+	while (1) {
+		set_current_state(TASK_INTERRUPTIBLE);
+		spin_lock_irqsave(&cluster->pending_lock, flags);
+		if (!cluster->pending) {
+			spin_unlock_irqrestore(&cluster->pending_lock, flags);
+			schedule();
+			if (kthread_should_stop())
+				break;
+			spin_lock_irqsave(&cluster->pending_lock, flags);
+		}
+		__set_current_state(TASK_RUNNING);
+		cluster->pending = false;
+		spin_unlock_irqrestore(&cluster->pending_lock, flags);
+
+		update_isolated_cpus(cluster);
+	}
+
+	return 0;
+}
+
+static int __ref cpu_callback(struct notifier_block *nfb,
+			      unsigned long action, void *hcpu)
+{
+	unsigned int cpu = (unsigned long)hcpu;
+	struct cpu_data *c = &per_cpu(cpu_state, cpu);
+
+	if (!c->cluster)
+		return NOTIFY_OK;
+
+	switch (action & ~CPU_TASKS_FROZEN) {
+	case CPU_DEAD:
+		/*
+		 * An offline cpu is not isolated, it comes back usable. No
+		 * cluster lock here: the core_ctl thread takes the hotplug
+		 * lock in sched_isolate_cpu() while holding it.
+		 */
+		if (c->isolated) {
+			sched_unisolate_cpu(cpu);
+			c->isolated = false;
+		}
+		wake_up_core_ctl_thread(c->cluster);
+		break;
+	case CPU_ONLINE:
+		wake_up_core_ctl_thread(c->cluster);
+		break;
+	}
+
+	return NOTIFY_OK;
+}
+
+static struct notifier_block __refdata cpu_notifier = {
+	.notifier_call = cpu_callback,
+};
+
+/* ========================= init ====================================== */
+
+static int __init cluster_init(const struct cpumask *mask)
+{
+	struct sched_param param = { .sched_priority = MAX_RT_PRIO - 1 };
+	struct cluster_data *cluster;
+	struct device *dev;
+	unsigned int first_cpu = cpumask_first(mask);
+	unsigned int cpu;
+	int ret;
+
+	if (num_clusters == MAX_CLUSTERS) {
+		pr_err("unsupported number of clusters\n");
+		return -EINVAL;
+	}
+
+	dev = get_cpu_device(first_cpu);
+	if (!dev)
+		return -ENODEV;
+
+	cluster = &cluster_state[num_clusters];
+	cluster->first_cpu = first_cpu;
+	cpumask_copy(&cluster->cpus, mask);
+	cluster->num_cpus = cpumask_weight(mask);
+	cluster->is_big_cluster = !!(CONFIG_PERFORMANCE_CLUSTER_CPU_MASK &
+				     (1UL << first_cpu));
+	cluster->max_cpus = cluster->num_cpus;
+	cluster->min_cpus = cluster->is_big_cluster ? 1 : cluster->num_cpus;
+	cluster->need_cpus = cluster->num_cpus;
+	cluster->busy_up_thres = 60;
+	cluster->busy_down_thres = 30;
+	cluster->offline_delay_ms = 100;
+	cluster->need_ts = jiffies;
+	spin_lock_init(&cluster->pending_lock);
+	mutex_init(&cluster->lock);
+
+	for_each_cpu(cpu, mask)
+		per_cpu(cpu_state, cpu).cluster = cluster;
+
+	cluster->thread = kthread_run(try_core_ctl, cluster, "core_ctl/%d",
+				      first_cpu);
+	if (IS_ERR(cluster->thread))
+		return PTR_ERR(cluster->thread);
+	sched_setscheduler_nocheck(cluster->thread, SCHED_FIFO, &param);
+
+	ret = kobject_init_and_add(&cluster->kobj, &ktype_core_ctl,
+				   &dev->kobj, "core_ctl");
+	if (ret)
+		return ret;
+
+	cluster->inited = true;
+	num_clusters++;
+	return 0;
+}
+
+static int __init core_ctl_init(void)
+{
+	struct cpumask done;
+	unsigned int cpu;
+	int ret;
+
+	cpumask_clear(&done);
+	for_each_possible_cpu(cpu) {
+		if (cpumask_test_cpu(cpu, &done))
+			continue;
+		ret = cluster_init(topology_core_cpumask(cpu));
+		if (ret) {
+			pr_err("cluster of cpu%u: init failed, %d\n", cpu, ret);
+			return ret;
+		}
+		cpumask_or(&done, &done, topology_core_cpumask(cpu));
+	}
+
+	register_cpu_notifier(&cpu_notifier);
+	core_ctl_ready = true;
+	return 0;
+}
+late_initcall(core_ctl_init);
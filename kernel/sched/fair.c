@@ -1163,6 +1163,16 @@ int sched_set_wake_up_idle(struct task_struct *p, int wake_up_idle)
 	return 0;
 }
 
+/* The cpu cgroup of the task asks for wakeups on idle cpus */
+static inline bool tg_wake_up_idle(struct task_struct *p)
+{
+#ifdef CONFIG_CGROUP_SCHED
+	return task_group(p)->wake_up_idle;
+#else
+	return false;
+#endif
+}
+
 #endif	/* CONFIG_SMP */
 
 /* Only depends on SMP, FAIR_GROUP_SCHED may be removed when useful in lb */
@@ -1273,12 +1283,43 @@ unsigned int __read_mostly sysctl_sched_init_task_load_pct = 15;
 unsigned int __read_mostly sysctl_sched_min_runtime = 0; /* 0 ms */
 u64 __read_mostly sched_min_runtime = 0; /* 0 ms */
 
+/*
+ * Effective utilization clamps of a task in percent: its own clamps
+ * restricted by those of its cgroup.
+ */
+static inline void
+task_util_clamps(struct task_struct *p, unsigned int *min, unsigned int *max)
+{
+	unsigned int lo = p->util_min, hi = p->util_max;
+#ifdef CONFIG_CGROUP_SCHED
+	struct task_group *tg = task_group(p);
+
+	lo = max(lo, tg->util_min);
+	hi = min(hi, tg->util_max);
+#endif
+
+	*min = min(lo, hi);
+	*max = hi;
+}
+
+/*
+ * Demand of a task as seen by task placement. The clamps don't change
+ * the demand accounted to the cpus in cumulative_runnable_avg.
+ */
 static inline unsigned int task_load(struct task_struct *p)
 {
+	unsigned int load, min, max;
+
 	if (sched_use_pelt)
-		return p->se.avg.runnable_avg_sum_scaled;
+		load = p->se.avg.runnable_avg_sum_scaled;
+	else
+		load = p->ravg.demand;
 
-	return p->ravg.demand;
+	task_util_clamps(p, &min, &max);
+	if (likely(!min && max >= 100))
+		return load;
+
+	return clamp_t(unsigned int, load, pct_to_real(min), pct_to_real(max));
 }
 
 unsigned int max_task_load(void)
@@ -1306,6 +1347,13 @@ unsigned int __read_mostly sysctl_sched_spill_nr_run = 10;
  */
 unsigned int __read_mostly sysctl_sched_enable_power_aware = 0;
 
+/*
+ * Keep timers that are migrated away from an idle CPU within its cluster,
+ * so that they don't keep a cluster from its low power modes only because
+ * one of its CPUs happened to be busy when the timer was armed.
+ */
+unsigned int __read_mostly sysctl_power_aware_timer_migration;
+
 /*
  * This specifies the maximum percent power difference between 2
  * CPUs for them to be considered identical in terms of their
@@ -1561,6 +1609,29 @@ static inline int is_big_task(struct task_struct *p)
 	return load > sched_upmigrate;
 }
 
+/*
+ * Called by the rt_mutex code with p->pi_lock held whenever the top PI
+ * waiter of @p changes. A lock holder that keeps a waiter on a higher
+ * capacity cpu, or a big waiter, blocked is placed as if sched_boost was
+ * set for it, so it isn't left to finish its critical section on a
+ * little cpu.
+ */
+void sched_set_pi_boost(struct task_struct *p, struct task_struct *waiter)
+{
+	bool boost = false;
+
+	if (waiter && sched_enable_hmp)
+		boost = cpu_rq(task_cpu(waiter))->capacity >
+			cpu_rq(task_cpu(p))->capacity || is_big_task(waiter);
+
+	p->pi_boost = boost;
+}
+
+static inline int task_sched_boost(struct task_struct *p)
+{
+	return sched_boost() || p->pi_boost;
+}
+
 /* Is a task "small" on the minimum capacity CPU */
 static inline int is_small_task(struct task_struct *p)
 {
@@ -1730,7 +1801,7 @@ static int task_load_will_fit(struct task_struct *p, u64 task_load, int cpu)
 	if (rq->capacity == max_capacity)
 		return 1;
 
-	if (sched_boost()) {
+	if (task_sched_boost(p)) {
 		if (rq->capacity > prev_rq->capacity)
 			return 1;
 	} else {
@@ -1831,6 +1902,7 @@ static unsigned int power_cost(u64 task_load, int cpu)
 	int i, end;
 	struct rq *rq = cpu_rq(cpu);
 	struct hmp_power_cost_table *ptr = &rq->pwr_cost_table;
+	struct hmp_power_cost *opp;
 
 	if (!sysctl_sched_enable_power_aware || !ptr->len)
 		return rq->max_possible_capacity;
@@ -1844,9 +1916,19 @@ static unsigned int power_cost(u64 task_load, int cpu)
 	for (; i < end; i++) {
 		if (task_load <= ptr->map[i].demand &&
 		    ptr->map[i].freq >= rq->cur_freq)
-			return *(ptr->map[i].power_cost);
+			break;
 	}
-	return *(ptr->map[i - 1].power_cost);
+	opp = &ptr->map[min(i, end - 1)];
+
+	if (!sched_feat(ENERGY_COST) || !opp->demand ||
+	    task_load >= opp->demand)
+		return *(opp->power_cost);
+
+	/*
+	 * A bigger cpu draws more power at the OPP that fits the task, but
+	 * also finishes it sooner: scale by the busy time at that OPP.
+	 */
+	return div64_u64((u64)*(opp->power_cost) * task_load, opp->demand);
 }
 
 static int best_small_task_cpu(struct task_struct *p, int sync)
@@ -1867,6 +1949,7 @@ static int best_small_task_cpu(struct task_struct *p, int sync)
 	hmp_capable = !cpumask_full(&temp);
 
 	cpumask_and(&search_cpu, tsk_cpus_allowed(p), cpu_online_mask);
+	sched_clear_isolated(&search_cpu);
 	if (unlikely(cpumask_empty(&search_cpu)))
 		return task_cpu(p);
 	if (unlikely(!cpumask_test_cpu(i, &search_cpu)))
@@ -1915,6 +1998,7 @@ static int best_small_task_cpu(struct task_struct *p, int sync)
 		return min_cstate_cpu;
 
 	cpumask_and(&search_cpu, tsk_cpus_allowed(p), cpu_online_mask);
+	sched_clear_isolated(&search_cpu);
 	cpumask_andnot(&search_cpu, &search_cpu, &fb_search_cpu);
 	for_each_cpu(i, &search_cpu) {
 		rq = cpu_rq(i);
@@ -2062,7 +2146,7 @@ static int select_packing_target(struct task_struct *p, int best_cpu)
 static inline int wake_to_idle(struct task_struct *p)
 {
 	return (current->flags & PF_WAKE_UP_IDLE) ||
-			 (p->flags & PF_WAKE_UP_IDLE);
+			 (p->flags & PF_WAKE_UP_IDLE) || tg_wake_up_idle(p);
 }
 
 /* return cheapest cpu that can fit this task */
@@ -2076,7 +2160,7 @@ static int select_best_cpu(struct task_struct *p, int target, int reason,
 	u64 tload, cpu_load;
 	u64 min_load = ULLONG_MAX, min_fallback_load = ULLONG_MAX;
 	int small_task = is_small_task(p);
-	int boost = sched_boost();
+	int boost = task_sched_boost(p);
 	int cstate, min_cstate = INT_MAX;
 	int prefer_idle = -1;
 	int prefer_idle_override = 0;
@@ -2108,6 +2192,7 @@ static int select_best_cpu(struct task_struct *p, int target, int reason,
 	trq = task_rq(p);
 	i = task_cpu(p);
 	cpumask_and(&search_cpus, tsk_cpus_allowed(p), cpu_online_mask);
+	sched_clear_isolated(&search_cpus);
 	if (sync) {
 		unsigned int cpuid = smp_processor_id();
 		if (cpumask_test_cpu(cpuid, &search_cpus)) {
@@ -2295,6 +2380,15 @@ done:
 	return best_cpu;
 }
 
+static inline unsigned int task_util_min(struct task_struct *p)
+{
+	unsigned int min, max;
+
+	task_util_clamps(p, &min, &max);
+
+	return min;
+}
+
 static void
 inc_nr_big_small_task(struct hmp_sched_stats *stats, struct task_struct *p)
 {
@@ -2305,6 +2399,8 @@ inc_nr_big_small_task(struct hmp_sched_stats *stats, struct task_struct *p)
 		stats->nr_big_tasks++;
 	else if (is_small_task(p))
 		stats->nr_small_tasks++;
+
+	stats->util_min_pct += task_util_min(p);
 }
 
 static void
@@ -2318,6 +2414,8 @@ dec_nr_big_small_task(struct hmp_sched_stats *stats, struct task_struct *p)
 	else if (is_small_task(p))
 		stats->nr_small_tasks--;
 
+	stats->util_min_pct -= task_util_min(p);
+
 	BUG_ON(stats->nr_big_tasks < 0 || stats->nr_small_tasks < 0);
 }
 
@@ -2340,6 +2438,7 @@ dec_rq_hmp_stats(struct rq *rq, struct task_struct *p, int change_cra)
 static void reset_hmp_stats(struct hmp_sched_stats *stats, int reset_cra)
 {
 	stats->nr_big_tasks = stats->nr_small_tasks = 0;
+	stats->util_min_pct = 0;
 	if (reset_cra)
 		stats->cumulative_runnable_avg = 0;
 }
@@ -2565,6 +2664,38 @@ void post_big_small_task_count_change(const struct cpumask *cpus)
 	local_irq_enable();
 }
 
+/*
+ * The clamps decide whether a task is big or small, so like a change of
+ * upmigrate_discourage this recounts the big and small tasks of all cpus.
+ */
+int sched_set_util_clamp(struct task_struct *p, unsigned int min,
+			 unsigned int max)
+{
+	if (min > max || max > 100)
+		return -EINVAL;
+
+	if (p->util_min == min && p->util_max == max)
+		return 0;
+
+	get_online_cpus();
+	pre_big_small_task_count_change(cpu_online_mask);
+
+	p->util_min = min;
+	p->util_max = max;
+
+	post_big_small_task_count_change(cpu_online_mask);
+	put_online_cpus();
+
+	return 0;
+}
+
+void sched_get_util_clamp(struct task_struct *p, unsigned int *min,
+			  unsigned int *max)
+{
+	*min = p->util_min;
+	*max = p->util_max;
+}
+
 DEFINE_MUTEX(policy_mutex);
 
 #ifdef CONFIG_SCHED_FREQ_INPUT
@@ -2825,7 +2956,7 @@ static inline int migration_needed(struct rq *rq, struct task_struct *p)
 	if (task_will_be_throttled(p))
 		return 0;
 
-	if (sched_boost()) {
+	if (task_sched_boost(p)) {
 		if (rq->capacity != max_capacity)
 			return UP_MIGRATION;
 
@@ -3035,6 +3166,7 @@ void init_new_task_load(struct task_struct *p)
 	u32 init_load_pct = current->init_load_pct;
 
 	p->init_load_pct = 0;
+	p->pi_boost = false;
 	memset(&p->ravg, 0, sizeof(struct ravg));
 	p->se.avg.decay_count	= 0;
 
@@ -5401,7 +5533,7 @@ static int select_idle_sibling(struct task_struct *p, int target)
 
 	if (!sysctl_sched_wake_to_idle &&
 	    !(current->flags & PF_WAKE_UP_IDLE) &&
-	    !(p->flags & PF_WAKE_UP_IDLE))
+	    !(p->flags & PF_WAKE_UP_IDLE) && !tg_wake_up_idle(p))
 		return target;
 
 	/*
@@ -7427,6 +7559,10 @@ static int load_balance(int this_cpu, struct rq *this_rq,
 		.loop			= 0,
 	};
 
+	/* isolated cpus never pull work, but may still be pulled from */
+	if (cpu_isolated(this_cpu))
+		return 0;
+
 	/*
 	 * For NEWLY_IDLE load_balancing, we don't need to consider
 	 * other cpus in our group
@@ -7628,10 +7764,8 @@ no_move:
 		}
 
 		/* Assumes one 'busiest' cpu that we pulled tasks from */
-		if (!same_freq_domain(this_cpu, cpu_of(busiest))) {
-			check_for_freq_change(this_rq);
-			check_for_freq_change(busiest);
-		}
+		if (!same_freq_domain(this_cpu, cpu_of(busiest)))
+			check_for_freq_change_migrate(busiest, this_rq, true);
 	}
 	if (likely(!active_balance)) {
 		/* We were unbalanced, so reset the balancing interval */
@@ -7857,10 +7991,8 @@ out_unlock:
 	}
 	raw_spin_unlock_irq(&busiest_rq->lock);
 
-	if (moved && !same_freq_domain(busiest_cpu, target_cpu)) {
-		check_for_freq_change(busiest_rq);
-		check_for_freq_change(target_rq);
-	}
+	if (moved && !same_freq_domain(busiest_cpu, target_cpu))
+		check_for_freq_change_migrate(busiest_rq, target_rq, true);
 
 	if (per_cpu(dbs_boost_needed, target_cpu)) {
 		struct migration_notify_data mnd;
@@ -7995,6 +8127,10 @@ void nohz_balance_enter_idle(int cpu)
 	if (test_bit(NOHZ_TICK_STOPPED, nohz_flags(cpu)))
 		return;
 
+	/* keep isolated cpus idle: not an idle load balancer, nor balanced */
+	if (cpu_isolated(cpu))
+		return;
+
 	cpumask_set_cpu(cpu, nohz.idle_cpus_mask);
 	atomic_inc(&nohz.nr_cpus);
 	set_bit(NOHZ_TICK_STOPPED, nohz_flags(cpu));
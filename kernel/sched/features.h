@@ -72,3 +72,10 @@ SCHED_FEAT(NUMA_FORCE,	false)
 #endif
 
 SCHED_FEAT(FORCE_CPU_THROTTLING_IMMINENT, false)
+
+/*
+ * Compare cpus by the energy a task would use on them, power at the OPP
+ * that fits it times the fraction of the window it keeps the cpu busy,
+ * rather than by power alone.
+ */
+SCHED_FEAT(ENERGY_COST, true)
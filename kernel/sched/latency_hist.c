@@ -0,0 +1,160 @@
+/* Copyright (c) 2016, HTC Corporation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * Scheduling and interrupt latency histograms
+ *
+ * Per cpu log2 histograms, in microseconds, of:
+ *
+ *  wakeup_rt         - wakeup to run of RT tasks
+ *  wakeup_sensitive  - wakeup to run of latency sensitive tasks
+ *                      (PF_WAKE_UP_IDLE, see sched_setattr())
+ *  irqsoff           - how late the softlockup watchdog hrtimer ran,
+ *                      mostly time spent with interrupts off
+ *  preemptoff        - wakeup to run of the FIFO 99 softlockup watchdog
+ *                      thread, mostly time spent with preemption off
+ *
+ * The wakeup histograms reuse the clock read of __schedule(), and the
+ * other two sample the existing watchdog timer and thread, so that the
+ * histograms are cheap enough to leave on. A sample above the type's
+ * threshold also fires the sched_latency_exceeded tracepoint.
+ *
+ * The histograms are in /sys/kernel/debug/sched_latency/hist, writing
+ * to reset clears them.
+ */
+
+#include <linux/debugfs.h>
+#include <linux/init.h>
+#include <linux/log2.h>
+#include <linux/percpu.h>
+#include <linux/sched_latency.h>
+#include <linux/seq_file.h>
+
+#include <trace/events/sched.h>
+
+#define SCHED_LAT_BUCKETS	16
+
+struct sched_latency_hist {
+	unsigned long count[SCHED_LAT_BUCKETS];
+	u64 max_ns;
+};
+
+static DEFINE_PER_CPU(struct sched_latency_hist [NR_SCHED_LAT_TYPES],
+		      sched_latency_hists);
+
+static const char * const sched_latency_names[NR_SCHED_LAT_TYPES] = {
+	"wakeup_rt",
+	"wakeup_sensitive",
+	"irqsoff",
+	"preemptoff",
+};
+
+static u32 sched_latency_threshold_us[NR_SCHED_LAT_TYPES] = {
+	2000,
+	8000,
+	2000,
+	4000,
+};
+
+void sched_latency_record(int type, struct task_struct *p, u64 ns)
+{
+	struct sched_latency_hist *hist;
+	u64 us = div_u64(ns, NSEC_PER_USEC);
+	int bucket = 0;
+
+	if (us)
+		bucket = min_t(int, ilog2(us), SCHED_LAT_BUCKETS - 1);
+
+	hist = &get_cpu_var(sched_latency_hists)[type];
+	hist->count[bucket]++;
+	if (ns > hist->max_ns)
+		hist->max_ns = ns;
+	put_cpu_var(sched_latency_hists);
+
+	if (us > sched_latency_threshold_us[type])
+		trace_sched_latency_exceeded(type, p, ns);
+}
+
+static int sched_latency_hist_show(struct seq_file *m, void *v)
+{
+	struct sched_latency_hist *hist;
+	int type, cpu, i;
+
+	for (type = 0; type < NR_SCHED_LAT_TYPES; type++) {
+		seq_printf(m, "%s\ncpu", sched_latency_names[type]);
+		for (i = 0; i < SCHED_LAT_BUCKETS - 1; i++)
+			seq_printf(m, " <%luus", 2UL << i);
+		seq_puts(m, " more max_us\n");
+
+		for_each_possible_cpu(cpu) {
+			hist = &per_cpu(sched_latency_hists, cpu)[type];
+			seq_printf(m, "%3d", cpu);
+			for (i = 0; i < SCHED_LAT_BUCKETS; i++)
+				seq_printf(m, " %lu", hist->count[i]);
+			seq_printf(m, " %llu\n",
+				   div_u64(hist->max_ns, NSEC_PER_USEC));
+		}
+	}
+	return 0;
+}
+
+static int sched_latency_hist_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, sched_latency_hist_show, NULL);
+}
+
+static const struct file_operations sched_latency_hist_fops = {
+	.open		= sched_latency_hist_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static ssize_t sched_latency_reset_write(struct file *file,
+		const char __user *buf, size_t count, loff_t *ppos)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		memset(per_cpu(sched_latency_hists, cpu), 0,
+		       sizeof(struct sched_latency_hist) * NR_SCHED_LAT_TYPES);
+	return count;
+}
+
+static const struct file_operations sched_latency_reset_fops = {
+	.write		= sched_latency_reset_write,
+	.llseek		= noop_llseek,
+};
+
+static int __init sched_latency_hist_init(void)
+{
+	struct dentry *dir;
+	char name[40];
+	int type;
+
+	dir = debugfs_create_dir("sched_latency", NULL);
+	if (IS_ERR_OR_NULL(dir))
+		return -ENOMEM;
+
+	debugfs_create_file("hist", S_IRUGO, dir, NULL,
+			    &sched_latency_hist_fops);
+	debugfs_create_file("reset", S_IWUSR, dir, NULL,
+			    &sched_latency_reset_fops);
+	for (type = 0; type < NR_SCHED_LAT_TYPES; type++) {
+		snprintf(name, sizeof(name), "threshold_%s_us",
+			 sched_latency_names[type]);
+		debugfs_create_u32(name, S_IRUGO | S_IWUSR, dir,
+				   &sched_latency_threshold_us[type]);
+	}
+	return 0;
+}
+late_initcall(sched_latency_hist_init);
@@ -1585,6 +1585,10 @@ static int find_lowest_rq_hmp(struct task_struct *task)
 	 */
 	for_each_cpu(i, lowest_mask) {
 		struct rq *rq = cpu_rq(i);
+
+		if (cpu_isolated(i))
+			continue;
+
 		cpu_cost = power_cost_at_freq(i, ACCESS_ONCE(rq->min_freq));
 		trace_sched_cpu_load(rq, idle_cpu(i), mostly_idle_cpu(i),
 				     sched_irqload(i), cpu_cost, cpu_temp(i));
@@ -6,6 +6,7 @@
 #include <linux/spinlock.h>
 #include <linux/stop_machine.h>
 #include <linux/tick.h>
+#include <htc_mnemosyne/htc_perf_footprint.h>
 
 #include "cpupri.h"
 #include "cpuacct.h"
@@ -121,8 +122,11 @@ struct task_group {
 	struct cgroup_subsys_state css;
 
 	bool notify_on_migrate;
+	bool wake_up_idle;
 #ifdef CONFIG_SCHED_HMP
 	bool upmigrate_discouraged;
+	/* Utilization clamps for the tasks, in percent */
+	unsigned int util_min, util_max;
 #endif
 
 #ifdef CONFIG_FAIR_GROUP_SCHED
@@ -233,6 +237,8 @@ struct cfs_bandwidth { };
 struct hmp_sched_stats {
 	int nr_big_tasks, nr_small_tasks;
 	u64 cumulative_runnable_avg;
+	/* Sum of the minimum utilization clamps of the tasks, in percent */
+	unsigned int util_min_pct;
 };
 
 struct hmp_power_cost {
@@ -892,6 +898,9 @@ static inline int sched_cpu_high_irqload(int cpu) { return 0; }
 
 #ifdef CONFIG_SCHED_FREQ_INPUT
 extern void check_for_freq_change(struct rq *rq);
+extern void check_for_freq_change_migrate(struct rq *src_rq,
+					  struct rq *dest_rq, bool demand_moved);
+extern void sched_freq_tick(struct rq *rq);
 
 /* Is frequency of two cpus synchronized with each other? */
 static inline int same_freq_domain(int src_cpu, int dst_cpu)
@@ -909,6 +918,10 @@ static inline int same_freq_domain(int src_cpu, int dst_cpu)
 #define sched_migration_fixup	0
 
 static inline void check_for_freq_change(struct rq *rq) { }
+/* a macro, so callers may pass fields that only exist with HMP */
+#define check_for_freq_change_migrate(src_rq, dest_rq, demand_moved) \
+	do { } while (0)
+static inline void sched_freq_tick(struct rq *rq) { }
 
 static inline int same_freq_domain(int src_cpu, int dst_cpu)
 {
@@ -973,6 +986,35 @@ static inline void clear_reserved(int cpu) { }
 
 #endif /* CONFIG_SCHED_HMP */
 
+#ifdef CONFIG_SCHED_CORE_CTL
+
+/*
+ * Isolated cpus stay online but get no new work: wakeup placement and
+ * load balancing skip them, and their queued tasks are pushed away when
+ * they are isolated. Only tasks bound to the cpu keep running there.
+ */
+extern struct cpumask __cpu_isolated_mask;
+#define cpu_isolated_mask ((const struct cpumask *)&__cpu_isolated_mask)
+#define cpu_isolated(cpu) cpumask_test_cpu((cpu), cpu_isolated_mask)
+
+static inline void sched_clear_isolated(struct cpumask *mask)
+{
+	cpumask_andnot(mask, mask, cpu_isolated_mask);
+}
+
+extern int sched_isolate_cpu(int cpu);
+extern void sched_unisolate_cpu(int cpu);
+extern void core_ctl_check(void);
+
+#else /* CONFIG_SCHED_CORE_CTL */
+
+#define cpu_isolated(cpu) 0
+
+static inline void sched_clear_isolated(struct cpumask *mask) { }
+static inline void core_ctl_check(void) { }
+
+#endif /* CONFIG_SCHED_CORE_CTL */
+
 #ifdef CONFIG_CGROUP_SCHED
 
 /*
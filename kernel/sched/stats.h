@@ -89,6 +89,7 @@ static void sched_info_arrive(struct task_struct *t)
 	t->sched_info.pcount++;
 
 	rq_sched_info_arrive(task_rq(t), delta);
+	htc_perf_footprint_sched(t, delta);
 }
 
 /*
@@ -25,6 +25,9 @@
 #include <linux/of.h>
 #include <linux/of_address.h>
 #include <linux/io.h>
+#include <linux/mutex.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 #include <asm-generic/sizes.h>
 #include <linux/msm_rtb.h>
 
@@ -71,14 +74,33 @@ struct msm_rtb_state {
 	int initialized;
 	uint32_t filter;
 	int step_size;
+	int seg_entries;
 };
 
 #if defined(CONFIG_MSM_RTB_SEPARATE_CPUS)
 DEFINE_PER_CPU(atomic_t, msm_rtb_idx_cpu);
+#elif defined(CONFIG_MSM_RTB_PERCPU_SEGMENTS)
+/* only ever touched by the owning cpu with interrupts disabled */
+static DEFINE_PER_CPU(unsigned int, msm_rtb_seq);
 #else
 static atomic_t msm_rtb_idx;
 #endif
 
+/*
+ * Optional io address ranges for LOGK_READL/LOGK_WRITEL. When no range is
+ * set every access is logged.
+ */
+#define MSM_RTB_MAX_ADDR_RANGES	8
+
+struct msm_rtb_addr_range {
+	unsigned long start;
+	unsigned long end;
+};
+
+static struct msm_rtb_addr_range msm_rtb_ranges[MSM_RTB_MAX_ADDR_RANGES];
+static int msm_rtb_nr_ranges;
+static DEFINE_MUTEX(msm_rtb_range_lock);
+
 static struct msm_rtb_state msm_rtb = {
 #if defined(CONFIG_HTC_DEBUG_RTB)
 	/* remove msm_rtb.filter from cmdline to control the filter here */
@@ -92,6 +114,75 @@ static struct msm_rtb_state msm_rtb = {
 module_param_named(filter, msm_rtb.filter, uint, 0644);
 module_param_named(enable, msm_rtb.enabled, int, 0644);
 
+/*
+ * Ranges are given as "start-end[,start-end...]" with end exclusive, an
+ * empty string clears the filter. This may run from the kernel command
+ * line before the allocators are up, so parse from a stack copy.
+ */
+static int msm_rtb_addr_filter_set(const char *val,
+				   const struct kernel_param *kp)
+{
+	struct msm_rtb_addr_range ranges[MSM_RTB_MAX_ADDR_RANGES];
+	char buf[MSM_RTB_MAX_ADDR_RANGES * 40];
+	char *p, *tok, *end;
+	int n = 0;
+
+	if (strlcpy(buf, val, sizeof(buf)) >= sizeof(buf))
+		return -ENOSPC;
+
+	p = strstrip(buf);
+	while ((tok = strsep(&p, ",")) != NULL) {
+		if (!*tok)
+			continue;
+		if (n == MSM_RTB_MAX_ADDR_RANGES)
+			return -ENOSPC;
+		end = strchr(tok, '-');
+		if (!end)
+			return -EINVAL;
+		*end++ = '\0';
+		if (kstrtoul(tok, 0, &ranges[n].start) ||
+		    kstrtoul(end, 0, &ranges[n].end) ||
+		    ranges[n].start >= ranges[n].end)
+			return -EINVAL;
+		n++;
+	}
+
+	/*
+	 * A logger racing with an update may briefly match against a mix of
+	 * old and new ranges, which is acceptable for a debug filter.
+	 */
+	mutex_lock(&msm_rtb_range_lock);
+	msm_rtb_nr_ranges = 0;
+	smp_wmb();
+	memcpy(msm_rtb_ranges, ranges, n * sizeof(ranges[0]));
+	smp_wmb();
+	msm_rtb_nr_ranges = n;
+	mutex_unlock(&msm_rtb_range_lock);
+
+	return 0;
+}
+
+static int msm_rtb_addr_filter_get(char *buf, const struct kernel_param *kp)
+{
+	int i, len = 0;
+
+	mutex_lock(&msm_rtb_range_lock);
+	for (i = 0; i < msm_rtb_nr_ranges; i++)
+		len += scnprintf(buf + len, PAGE_SIZE - len, "%s%#lx-%#lx",
+				 i ? "," : "", msm_rtb_ranges[i].start,
+				 msm_rtb_ranges[i].end);
+	mutex_unlock(&msm_rtb_range_lock);
+	len += scnprintf(buf + len, PAGE_SIZE - len, "\n");
+
+	return len;
+}
+
+static struct kernel_param_ops msm_rtb_addr_filter_ops = {
+	.set = msm_rtb_addr_filter_set,
+	.get = msm_rtb_addr_filter_get,
+};
+module_param_cb(addr_filter, &msm_rtb_addr_filter_ops, NULL, 0644);
+
 #if defined(CONFIG_HTC_DEBUG_RTB)
 void msm_rtb_disable(void)
 {
@@ -125,6 +216,28 @@ int notrace msm_rtb_event_should_log(enum logk_event_type log_type)
 }
 EXPORT_SYMBOL(msm_rtb_event_should_log);
 
+static bool notrace msm_rtb_addr_should_log(enum logk_event_type log_type,
+					    unsigned long addr)
+{
+	int i, n;
+
+	log_type &= ~LOGTYPE_NOPC;
+	if (log_type != LOGK_READL && log_type != LOGK_WRITEL)
+		return true;
+
+	n = ACCESS_ONCE(msm_rtb_nr_ranges);
+	if (!n)
+		return true;
+	smp_rmb();
+
+	for (i = 0; i < n; i++)
+		if (addr >= msm_rtb_ranges[i].start &&
+		    addr < msm_rtb_ranges[i].end)
+			return true;
+
+	return false;
+}
+
 static void msm_rtb_emit_sentinel(struct msm_rtb_layout *start)
 {
 	start->sentinel[0] = SENTINEL_BYTE_1;
@@ -159,13 +272,10 @@ static void msm_rtb_write_timestamp(struct msm_rtb_layout *start)
 	start->timestamp = sched_clock();
 }
 
-static void uncached_logk_pc_idx(enum logk_event_type log_type, uint64_t caller,
-				 uint64_t data, int idx)
+static void uncached_logk_pc_entry(struct msm_rtb_layout *start,
+				   enum logk_event_type log_type,
+				   uint64_t caller, uint64_t data, int idx)
 {
-	struct msm_rtb_layout *start;
-
-	start = &msm_rtb.rtb[idx & (msm_rtb.nentries - 1)];
-
 	msm_rtb_emit_sentinel(start);
 	msm_rtb_write_type(log_type, start);
 	msm_rtb_write_caller(caller, start);
@@ -177,6 +287,14 @@ static void uncached_logk_pc_idx(enum logk_event_type log_type, uint64_t caller,
 	return;
 }
 
+#if !defined(CONFIG_MSM_RTB_PERCPU_SEGMENTS)
+static void uncached_logk_pc_idx(enum logk_event_type log_type, uint64_t caller,
+				 uint64_t data, int idx)
+{
+	uncached_logk_pc_entry(&msm_rtb.rtb[idx & (msm_rtb.nentries - 1)],
+			       log_type, caller, data, idx);
+}
+
 static void uncached_logk_timestamp(int idx)
 {
 	unsigned long long timestamp;
@@ -186,6 +304,7 @@ static void uncached_logk_timestamp(int idx)
 			(uint64_t)lower_32_bits(timestamp),
 			(uint64_t)upper_32_bits(timestamp), idx);
 }
+#endif
 
 #if defined(CONFIG_MSM_RTB_SEPARATE_CPUS)
 /*
@@ -232,6 +351,27 @@ static int msm_rtb_get_idx(void)
 
 	return i;
 }
+#elif defined(CONFIG_MSM_RTB_PERCPU_SEGMENTS)
+/*
+ * Each cpu owns seg_entries consecutive entries and a private sequence
+ * number, so there is no shared index and no wraparound marker: readers
+ * order entries across cpus by their timestamps.
+ */
+static struct msm_rtb_layout *msm_rtb_get_entry(int *idx)
+{
+	unsigned long flags;
+	unsigned int i;
+	int cpu;
+
+	local_irq_save(flags);
+	cpu = smp_processor_id();
+	i = __this_cpu_inc_return(msm_rtb_seq) - 1;
+	local_irq_restore(flags);
+
+	*idx = i;
+	return &msm_rtb.rtb[cpu * msm_rtb.seg_entries +
+			    (i & (msm_rtb.seg_entries - 1))];
+}
 #else
 static int msm_rtb_get_idx(void)
 {
@@ -257,13 +397,26 @@ int notrace uncached_logk_pc(enum logk_event_type log_type, void *caller,
 				void *data)
 {
 	int i;
+#if defined(CONFIG_MSM_RTB_PERCPU_SEGMENTS)
+	struct msm_rtb_layout *start;
+#endif
 
 	if (!msm_rtb_event_should_log(log_type))
 		return 0;
 
+	if (!msm_rtb_addr_should_log(log_type, (unsigned long)data))
+		return 0;
+
+#if defined(CONFIG_MSM_RTB_PERCPU_SEGMENTS)
+	start = msm_rtb_get_entry(&i);
+	uncached_logk_pc_entry(start, log_type,
+			       (uint64_t)((unsigned long) caller),
+			       (uint64_t)((unsigned long) data), i);
+#else
 	i = msm_rtb_get_idx();
 	uncached_logk_pc_idx(log_type, (uint64_t)((unsigned long) caller),
 				(uint64_t)((unsigned long) data), i);
+#endif
 
 	return 1;
 }
@@ -275,12 +428,34 @@ noinline int notrace uncached_logk(enum logk_event_type log_type, void *data)
 }
 EXPORT_SYMBOL(uncached_logk);
 
-#ifdef CONFIG_HTC_EARLY_RTB
-int htc_early_rtb_init(void)
+static void msm_rtb_init_idx(void)
 {
+#if defined(CONFIG_MSM_RTB_SEPARATE_CPUS) || \
+	defined(CONFIG_MSM_RTB_PERCPU_SEGMENTS)
+	unsigned int cpu;
+#endif
+
 #if defined(CONFIG_MSM_RTB_SEPARATE_CPUS)
-        unsigned int cpu;
+	for_each_possible_cpu(cpu) {
+		atomic_t *a = &per_cpu(msm_rtb_idx_cpu, cpu);
+		atomic_set(a, cpu);
+	}
+	msm_rtb.step_size = num_possible_cpus();
+#elif defined(CONFIG_MSM_RTB_PERCPU_SEGMENTS)
+	for_each_possible_cpu(cpu)
+		per_cpu(msm_rtb_seq, cpu) = 0;
+	msm_rtb.seg_entries =
+		__rounddown_pow_of_two(msm_rtb.nentries / nr_cpu_ids);
+	msm_rtb.step_size = 1;
+#else
+	atomic_set(&msm_rtb_idx, 0);
+	msm_rtb.step_size = 1;
 #endif
+}
+
+#ifdef CONFIG_HTC_EARLY_RTB
+int htc_early_rtb_init(void)
+{
 	struct device_node *dt_node = NULL;
 	char* rtb_node_name = "qcom,msm-rtb";
 	char* rtb_resource_name = "msm_rtb_res";
@@ -344,16 +519,7 @@ int htc_early_rtb_init(void)
 	msm_rtb.nentries = __rounddown_pow_of_two(msm_rtb.nentries);
 	memset_io(msm_rtb.rtb, 0, msm_rtb.size);
 
-#if defined(CONFIG_MSM_RTB_SEPARATE_CPUS)
-        for_each_possible_cpu(cpu) {
-                atomic_t *a = &per_cpu(msm_rtb_idx_cpu, cpu);
-                atomic_set(a, cpu);
-        }
-        msm_rtb.step_size = num_possible_cpus();
-#else
-        atomic_set(&msm_rtb_idx, 0);
-        msm_rtb.step_size = 1;
-#endif
+	msm_rtb_init_idx();
 
 	early_rtb_stat = EARLY_RTB_RUNNING;
 	smp_mb();
@@ -390,13 +556,129 @@ int htc_early_rtb_deinit(void)
 }
 #endif
 
+#if defined(CONFIG_MSM_RTB_PERCPU_SEGMENTS) && defined(CONFIG_DEBUG_FS)
+struct msm_rtb_iter {
+	unsigned int next[NR_CPUS];
+	unsigned int end[NR_CPUS];
+	int cpu;	/* cpu holding the oldest unread entry, -1 when done */
+};
+
+static struct msm_rtb_layout *msm_rtb_iter_entry(struct msm_rtb_iter *it,
+						 int cpu)
+{
+	return &msm_rtb.rtb[cpu * msm_rtb.seg_entries +
+			    (it->next[cpu] & (msm_rtb.seg_entries - 1))];
+}
+
+static void msm_rtb_iter_pick(struct msm_rtb_iter *it)
+{
+	uint64_t ts, oldest = 0;
+	int cpu;
+
+	it->cpu = -1;
+	for_each_possible_cpu(cpu) {
+		if (it->next[cpu] == it->end[cpu])
+			continue;
+		ts = msm_rtb_iter_entry(it, cpu)->timestamp;
+		if (it->cpu < 0 || ts < oldest) {
+			oldest = ts;
+			it->cpu = cpu;
+		}
+	}
+}
+
+static void *msm_rtb_seq_start(struct seq_file *m, loff_t *pos)
+{
+	struct msm_rtb_iter *it = m->private;
+
+	return it->cpu < 0 ? NULL : it;
+}
+
+static void *msm_rtb_seq_next(struct seq_file *m, void *v, loff_t *pos)
+{
+	struct msm_rtb_iter *it = v;
+
+	it->next[it->cpu]++;
+	msm_rtb_iter_pick(it);
+	++*pos;
+
+	return it->cpu < 0 ? NULL : it;
+}
+
+static void msm_rtb_seq_stop(struct seq_file *m, void *v)
+{
+}
+
+static int msm_rtb_seq_show(struct seq_file *m, void *v)
+{
+	struct msm_rtb_iter *it = v;
+	struct msm_rtb_layout *e = msm_rtb_iter_entry(it, it->cpu);
+
+	seq_printf(m, "[%llu] cpu%d idx %u type %u caller %pS data %#llx\n",
+		   (unsigned long long)e->timestamp, it->cpu, e->idx,
+		   e->log_type & ~LOGTYPE_NOPC,
+		   (void *)(unsigned long)e->caller,
+		   (unsigned long long)e->data);
+	return 0;
+}
+
+static const struct seq_operations msm_rtb_seq_ops = {
+	.start	= msm_rtb_seq_start,
+	.next	= msm_rtb_seq_next,
+	.stop	= msm_rtb_seq_stop,
+	.show	= msm_rtb_seq_show,
+};
+
+/* Merge the per-cpu segments into one timestamp ordered log */
+static int msm_rtb_log_open(struct inode *inode, struct file *file)
+{
+	struct msm_rtb_iter *it;
+	unsigned int seq;
+	int cpu;
+
+	if (!msm_rtb.initialized)
+		return -ENODEV;
+
+	it = __seq_open_private(file, &msm_rtb_seq_ops, sizeof(*it));
+	if (!it)
+		return -ENOMEM;
+
+	for_each_possible_cpu(cpu) {
+		seq = ACCESS_ONCE(per_cpu(msm_rtb_seq, cpu));
+		it->end[cpu] = seq;
+		it->next[cpu] = seq - min_t(unsigned int, seq,
+					    msm_rtb.seg_entries);
+	}
+	msm_rtb_iter_pick(it);
+
+	/* the merge cursor cannot be rewound */
+	return nonseekable_open(inode, file);
+}
+
+static const struct file_operations msm_rtb_log_fops = {
+	.open		= msm_rtb_log_open,
+	.read		= seq_read,
+	.llseek		= no_llseek,
+	.release	= seq_release_private,
+};
+
+static void msm_rtb_debugfs_init(void)
+{
+	struct dentry *dir;
+
+	dir = debugfs_create_dir("msm_rtb", NULL);
+	if (IS_ERR_OR_NULL(dir))
+		return;
+	debugfs_create_file("log", S_IRUSR, dir, NULL, &msm_rtb_log_fops);
+}
+#else
+static inline void msm_rtb_debugfs_init(void) { }
+#endif
+
 static int msm_rtb_probe(struct platform_device *pdev)
 {
 	struct msm_rtb_platform_data *d = pdev->dev.platform_data;
 	struct resource *res = NULL;
-#if defined(CONFIG_MSM_RTB_SEPARATE_CPUS)
-	unsigned int cpu;
-#endif
 	int ret;
 
 #ifdef CONFIG_HTC_EARLY_RTB
@@ -461,21 +743,12 @@ static int msm_rtb_probe(struct platform_device *pdev)
 
 	memset_io(msm_rtb.rtb, 0, msm_rtb.size);
 
-
-#if defined(CONFIG_MSM_RTB_SEPARATE_CPUS)
-	for_each_possible_cpu(cpu) {
-		atomic_t *a = &per_cpu(msm_rtb_idx_cpu, cpu);
-		atomic_set(a, cpu);
-	}
-	msm_rtb.step_size = num_possible_cpus();
-#else
-	atomic_set(&msm_rtb_idx, 0);
-	msm_rtb.step_size = 1;
-#endif
+	msm_rtb_init_idx();
 
 	atomic_notifier_chain_register(&panic_notifier_list,
 						&msm_rtb_panic_blk);
 	msm_rtb.initialized = 1;
+	msm_rtb_debugfs_init();
 	return 0;
 }
 
@@ -179,3 +179,20 @@ void acct_clear_integrals(struct task_struct *tsk)
 	tsk->acct_vm_mem1 = 0;
 }
 #endif
+
+#ifdef CONFIG_TASK_PMU_ACCOUNTING
+/*
+ * add the sampled PMU counters of a task
+ */
+void pmuacct_add_tsk(struct taskstats *stats, struct task_struct *p)
+{
+	int i;
+
+	for (i = 0; i < TASK_PMU_CLUSTERS; i++) {
+		stats->pmu_cycles[i] += p->pmuac.cycles[i];
+		stats->pmu_instructions[i] += p->pmuac.instructions[i];
+		stats->pmu_l2_refills[i] += p->pmuac.l2_refills[i];
+		stats->pmu_sampled_ns[i] += p->pmuac.sampled_ns[i];
+	}
+}
+#endif
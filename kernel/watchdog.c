@@ -24,6 +24,7 @@
 #include <linux/sysctl.h>
 #include <linux/smpboot.h>
 #include <linux/sched/rt.h>
+#include <linux/sched_latency.h>
 
 #include <asm/irq_regs.h>
 #include <linux/kvm_para.h>
@@ -40,6 +41,9 @@ static DEFINE_PER_CPU(struct hrtimer, watchdog_hrtimer);
 static DEFINE_PER_CPU(bool, softlockup_touch_sync);
 static DEFINE_PER_CPU(bool, soft_watchdog_warn);
 static DEFINE_PER_CPU(unsigned long, hrtimer_interrupts);
+#ifdef CONFIG_SCHED_LATENCY_HIST
+static DEFINE_PER_CPU(u64, softlockup_wakeup_ns);
+#endif
 static DEFINE_PER_CPU(unsigned long, soft_lockup_hrtimer_cnt);
 #ifdef CONFIG_HARDLOCKUP_DETECTOR
 static DEFINE_PER_CPU(bool, hard_watchdog_warn);
@@ -349,6 +353,14 @@ static enum hrtimer_restart watchdog_timer_fn(struct hrtimer *hrtimer)
 	/* test for hardlockups on the next cpu */
 	watchdog_check_hardlockup_other_cpu();
 
+#ifdef CONFIG_SCHED_LATENCY_HIST
+	/* How late we run is mostly how long interrupts were off */
+	sched_latency_record(SCHED_LAT_IRQSOFF, current,
+		ktime_to_ns(ktime_sub(hrtimer_cb_get_time(hrtimer),
+				      hrtimer_get_expires(hrtimer))));
+	__this_cpu_write(softlockup_wakeup_ns, sched_clock());
+#endif
+
 	/* kick the softlockup detector */
 	wake_up_process(__this_cpu_read(softlockup_watchdog));
 
@@ -468,6 +480,16 @@ static int watchdog_should_run(unsigned int cpu)
  */
 static void watchdog(unsigned int cpu)
 {
+#ifdef CONFIG_SCHED_LATENCY_HIST
+	u64 wakeup = per_cpu(softlockup_wakeup_ns, cpu);
+
+	/* A FIFO 99 thread only waits for preemption to be enabled */
+	if (wakeup) {
+		per_cpu(softlockup_wakeup_ns, cpu) = 0;
+		sched_latency_record(SCHED_LAT_PREEMPTOFF, NULL,
+				     sched_clock() - wakeup);
+	}
+#endif
 	__this_cpu_write(soft_lockup_hrtimer_cnt,
 			 __this_cpu_read(hrtimer_interrupts));
 	__touch_watchdog();
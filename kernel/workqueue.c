@@ -48,6 +48,9 @@
 #include <linux/moduleparam.h>
 #include <linux/uaccess.h>
 #include <linux/bug.h>
+#include <linux/topology.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 #include "workqueue_internal.h"
 
@@ -255,6 +258,12 @@ struct workqueue_struct {
 #endif
 #ifdef CONFIG_LOCKDEP
 	struct lockdep_map	lockdep_map;
+#endif
+#ifdef CONFIG_WQ_EXEC_STATS
+	atomic64_t		exec_ns;	/* total execution time */
+	atomic_long_t		exec_count;	/* executed work items */
+	unsigned long		exec_max_us;	/* racy: longest work item */
+	work_func_t		exec_max_func;	/* racy: and its function */
 #endif
 	char			name[WQ_NAME_LEN]; /* I: workqueue name */
 
@@ -301,6 +310,9 @@ static DEFINE_HASHTABLE(unbound_pool_hash, UNBOUND_POOL_HASH_ORDER);
 /* I: attributes used when instantiating standard unbound pools on demand */
 static struct workqueue_attrs *unbound_std_wq_attrs[NR_STD_WORKER_POOLS];
 
+/* I: attributes of unbound power-efficient wqs, see wq_pe_cluster_init() */
+static struct workqueue_attrs *power_efficient_wq_attrs[NR_STD_WORKER_POOLS];
+
 /* I: attributes used when instantiating ordered pools on demand */
 static struct workqueue_attrs *ordered_wq_attrs[NR_STD_WORKER_POOLS];
 
@@ -2117,6 +2129,36 @@ static bool manage_workers(struct worker *worker)
 	return true;
 }
 
+#ifdef CONFIG_WQ_EXEC_STATS
+static u64 wq_exec_start(void)
+{
+	return local_clock();
+}
+
+/*
+ * Accumulate the execution time of the work item which just finished.  The
+ * maximum is tracked without synchronization, a concurrent update may get
+ * lost but that's fine for finding heavy work items.
+ */
+static void wq_exec_end(struct worker *worker, struct workqueue_struct *wq,
+			u64 start)
+{
+	u64 delta = local_clock() - start;
+	unsigned long us = div_u64(delta, NSEC_PER_USEC);
+
+	atomic64_add(delta, &wq->exec_ns);
+	atomic_long_inc(&wq->exec_count);
+	if (us > ACCESS_ONCE(wq->exec_max_us)) {
+		wq->exec_max_us = us;
+		wq->exec_max_func = worker->current_func;
+	}
+}
+#else
+static inline u64 wq_exec_start(void) { return 0; }
+static inline void wq_exec_end(struct worker *worker,
+			       struct workqueue_struct *wq, u64 start) { }
+#endif
+
 /**
  * process_one_work - process single work
  * @worker: self
@@ -2140,6 +2182,7 @@ __acquires(&pool->lock)
 	bool cpu_intensive = pwq->wq->flags & WQ_CPU_INTENSIVE;
 	int work_color;
 	struct worker *collision;
+	u64 exec_start;
 #ifdef CONFIG_LOCKDEP
 	/*
 	 * It is permissible to free the struct work_struct from
@@ -2210,7 +2253,9 @@ __acquires(&pool->lock)
 	lock_map_acquire_read(&pwq->wq->lockdep_map);
 	lock_map_acquire(&lockdep_map);
 	trace_workqueue_execute_start(work);
+	exec_start = wq_exec_start();
 	worker->current_func(work);
+	wq_exec_end(worker, pwq->wq, exec_start);
 	/*
 	 * While we must be careful to not use "work" after this, the trace
 	 * point will only record its address.
@@ -3964,28 +4009,16 @@ static struct pool_workqueue *numa_pwq_tbl_install(struct workqueue_struct *wq,
 	return old_pwq;
 }
 
-/**
- * apply_workqueue_attrs - apply new workqueue_attrs to an unbound workqueue
- * @wq: the target workqueue
- * @attrs: the workqueue_attrs to apply, allocated with alloc_workqueue_attrs()
- *
- * Apply @attrs to an unbound workqueue @wq.  Unless disabled, on NUMA
- * machines, this function maps a separate pwq to each NUMA node with
- * possibles CPUs in @attrs->cpumask so that work items are affine to the
- * NUMA node it was issued on.  Older pwqs are released as in-flight work
- * items finish.  Note that a work item which repeatedly requeues itself
- * back-to-back will stay on its current pwq.
- *
- * Performs GFP_KERNEL allocations.  Returns 0 on success and -errno on
- * failure.
- */
-int apply_workqueue_attrs(struct workqueue_struct *wq,
-			  const struct workqueue_attrs *attrs)
+/* apply_workqueue_attrs() with CPUs pinned and wq_pool_mutex held */
+static int apply_workqueue_attrs_locked(struct workqueue_struct *wq,
+					const struct workqueue_attrs *attrs)
 {
 	struct workqueue_attrs *new_attrs, *tmp_attrs;
 	struct pool_workqueue **pwq_tbl, *dfl_pwq;
 	int node, ret;
 
+	lockdep_assert_held(&wq_pool_mutex);
+
 	/* only unbound workqueues can change attributes */
 	if (WARN_ON(!(wq->flags & WQ_UNBOUND)))
 		return -EINVAL;
@@ -4015,15 +4048,6 @@ int apply_workqueue_attrs(struct workqueue_struct *wq,
 	 */
 	copy_workqueue_attrs(tmp_attrs, new_attrs);
 
-	/*
-	 * CPUs should stay stable across pwq creations and installations.
-	 * Pin CPUs, determine the target cpumask for each node and create
-	 * pwqs accordingly.
-	 */
-	get_online_cpus();
-
-	mutex_lock(&wq_pool_mutex);
-
 	/*
 	 * If something goes wrong during CPU up/down, we'll fall back to
 	 * the default pwq covering whole @attrs->cpumask.  Always create
@@ -4044,8 +4068,6 @@ int apply_workqueue_attrs(struct workqueue_struct *wq,
 		}
 	}
 
-	mutex_unlock(&wq_pool_mutex);
-
 	/* all pwqs have been created successfully, let's install'em */
 	mutex_lock(&wq->mutex);
 
@@ -4066,7 +4088,6 @@ int apply_workqueue_attrs(struct workqueue_struct *wq,
 		put_pwq_unlocked(pwq_tbl[node]);
 	put_pwq_unlocked(dfl_pwq);
 
-	put_online_cpus();
 	ret = 0;
 	/* fall through */
 out_free:
@@ -4080,13 +4101,45 @@ enomem_pwq:
 	for_each_node(node)
 		if (pwq_tbl && pwq_tbl[node] != dfl_pwq)
 			free_unbound_pwq(pwq_tbl[node]);
-	mutex_unlock(&wq_pool_mutex);
-	put_online_cpus();
 enomem:
 	ret = -ENOMEM;
 	goto out_free;
 }
 
+/**
+ * apply_workqueue_attrs - apply new workqueue_attrs to an unbound workqueue
+ * @wq: the target workqueue
+ * @attrs: the workqueue_attrs to apply, allocated with alloc_workqueue_attrs()
+ *
+ * Apply @attrs to an unbound workqueue @wq.  Unless disabled, on NUMA
+ * machines, this function maps a separate pwq to each NUMA node with
+ * possibles CPUs in @attrs->cpumask so that work items are affine to the
+ * NUMA node it was issued on.  Older pwqs are released as in-flight work
+ * items finish.  Note that a work item which repeatedly requeues itself
+ * back-to-back will stay on its current pwq.
+ *
+ * Performs GFP_KERNEL allocations.  Returns 0 on success and -errno on
+ * failure.
+ */
+int apply_workqueue_attrs(struct workqueue_struct *wq,
+			  const struct workqueue_attrs *attrs)
+{
+	int ret;
+
+	/*
+	 * CPUs should stay stable across pwq creations and installations.
+	 * Pin CPUs, determine the target cpumask for each node and create
+	 * pwqs accordingly.
+	 */
+	get_online_cpus();
+	mutex_lock(&wq_pool_mutex);
+	ret = apply_workqueue_attrs_locked(wq, attrs);
+	mutex_unlock(&wq_pool_mutex);
+	put_online_cpus();
+
+	return ret;
+}
+
 /**
  * wq_update_unbound_numa - update NUMA affinity of a wq for CPU hot[un]plug
  * @wq: the target workqueue
@@ -4209,6 +4262,10 @@ static int alloc_and_link_pwqs(struct workqueue_struct *wq)
 			mutex_unlock(&wq->mutex);
 		}
 		return 0;
+	} else if (wq_power_efficient && (wq->flags & WQ_POWER_EFFICIENT)) {
+		/* no_numa, so a single pwq keeps ordered wqs ordered */
+		return apply_workqueue_attrs(wq,
+					     power_efficient_wq_attrs[highpri]);
 	} else if (wq->flags & __WQ_ORDERED) {
 		ret = apply_workqueue_attrs(wq, ordered_wq_attrs[highpri]);
 		/* there should only be single pwq for ordering guarantee */
@@ -5183,6 +5240,16 @@ static int __init init_workqueues(void)
 		attrs->nice = std_nice[i];
 		attrs->no_numa = true;
 		ordered_wq_attrs[i] = attrs;
+
+		/*
+		 * Power-efficient wqs which are unbound start out on all
+		 * CPUs.  The cpumask is narrowed by wq_pe_cluster_init()
+		 * once the CPU topology is known.
+		 */
+		BUG_ON(!(attrs = alloc_workqueue_attrs(GFP_KERNEL)));
+		attrs->nice = std_nice[i];
+		attrs->no_numa = true;
+		power_efficient_wq_attrs[i] = attrs;
 	}
 
 	system_wq = alloc_workqueue("events", 0, 0);
@@ -5204,3 +5271,94 @@ static int __init init_workqueues(void)
 	return 0;
 }
 early_initcall(init_workqueues);
+
+/*
+ * Power-efficient workqueues are meant for housekeeping that doesn't care
+ * where it runs.  Once they are unbound, keep them on the cluster of the
+ * boot CPU, which is the little cluster on big.LITTLE parts, so that their
+ * work items don't wake up the big cores.  Unbound pools are keyed by
+ * attrs, so all such wqs share the pools of that cluster.
+ *
+ * This runs after SMP bring-up as the sibling masks aren't complete
+ * before.  Ordered wqs which already exist are left alone as switching
+ * their pwq would break the ordering guarantee; wqs allocated from now on
+ * use the cluster right away.
+ */
+static int __init wq_pe_cluster_init(void)
+{
+	const struct cpumask *cluster = topology_core_cpumask(0);
+	struct workqueue_struct *wq;
+	char buf[64];
+	int i;
+
+	if (!wq_power_efficient || cpumask_empty(cluster) ||
+	    cpumask_equal(cluster, cpu_possible_mask))
+		return 0;
+
+	get_online_cpus();
+	mutex_lock(&wq_pool_mutex);
+
+	for (i = 0; i < NR_STD_WORKER_POOLS; i++)
+		cpumask_copy(power_efficient_wq_attrs[i]->cpumask, cluster);
+
+	list_for_each_entry(wq, &workqueues, list) {
+		if (!(wq->flags & WQ_POWER_EFFICIENT) ||
+		    !(wq->flags & WQ_UNBOUND) || (wq->flags & __WQ_ORDERED))
+			continue;
+		apply_workqueue_attrs_locked(wq,
+			power_efficient_wq_attrs[!!(wq->flags & WQ_HIGHPRI)]);
+	}
+
+	mutex_unlock(&wq_pool_mutex);
+	put_online_cpus();
+
+	cpulist_scnprintf(buf, sizeof(buf), cluster);
+	pr_info("workqueue: power-efficient wqs on CPUs %s\n", buf);
+	return 0;
+}
+core_initcall(wq_pe_cluster_init);
+
+#ifdef CONFIG_WQ_EXEC_STATS
+static int wq_exec_stats_show(struct seq_file *m, void *unused)
+{
+	struct workqueue_struct *wq;
+
+	seq_printf(m, "%-24s %10s %12s %10s  %s\n",
+		   "workqueue", "count", "total_us", "max_us", "max_func");
+
+	mutex_lock(&wq_pool_mutex);
+	list_for_each_entry(wq, &workqueues, list) {
+		unsigned long count = atomic_long_read(&wq->exec_count);
+
+		if (!count)
+			continue;
+		seq_printf(m, "%-24s %10lu %12llu %10lu  %pf\n", wq->name,
+			   count,
+			   div_u64(atomic64_read(&wq->exec_ns), NSEC_PER_USEC),
+			   wq->exec_max_us, wq->exec_max_func);
+	}
+	mutex_unlock(&wq_pool_mutex);
+
+	return 0;
+}
+
+static int wq_exec_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, wq_exec_stats_show, NULL);
+}
+
+static const struct file_operations wq_exec_stats_fops = {
+	.open		= wq_exec_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init wq_exec_stats_init(void)
+{
+	debugfs_create_file("workqueue_stats", S_IRUGO, NULL, NULL,
+			    &wq_exec_stats_fops);
+	return 0;
+}
+late_initcall(wq_exec_stats_init);
+#endif
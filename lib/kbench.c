@@ -0,0 +1,319 @@
+/*
+ * In-kernel microbenchmark framework
+ *
+ * Copyright (C) 2016 HTC Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * Subsystems register benchmarks with kbench_register(). They are run
+ * through debugfs:
+ *
+ *   echo "<name> [iters=N] [size=N] [n=N] [mode=S] [target=S]" \
+ *	> /sys/kernel/debug/kbench/run
+ *   cat /sys/kernel/debug/kbench/run
+ *
+ * The write returns once the run is done, or with its error. Reading
+ * gives the result of the last successful run as one line of key=value
+ * pairs: the parameters, the latency percentiles of the timed operation
+ * in ns, and throughput. "list" shows the registered benchmarks and the
+ * parameters they take.
+ */
+
+#define pr_fmt(fmt) "kbench: " fmt
+
+#include <linux/debugfs.h>
+#include <linux/kbench.h>
+#include <linux/kernel.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/module.h>
+#include <linux/mutex.h>
+#include <linux/sched.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/sort.h>
+#include <linux/string.h>
+#include <linux/uaccess.h>
+#include <linux/vmalloc.h>
+
+#define KBENCH_DEF_ITERATIONS	1000
+#define KBENCH_MAX_ITERATIONS	1000000
+#define KBENCH_CMD_LEN		256
+#define KBENCH_RESULT_LEN	512
+
+static LIST_HEAD(kbench_list);
+static DEFINE_MUTEX(kbench_mutex);
+static char kbench_result[KBENCH_RESULT_LEN];
+static struct dentry *kbench_dir;
+
+int kbench_register(struct kbench *bench)
+{
+	struct kbench *b;
+	int ret = 0;
+
+	if (!bench->name || !bench->op)
+		return -EINVAL;
+
+	mutex_lock(&kbench_mutex);
+	list_for_each_entry(b, &kbench_list, list) {
+		if (!strcmp(b->name, bench->name)) {
+			ret = -EEXIST;
+			goto out;
+		}
+	}
+	list_add_tail(&bench->list, &kbench_list);
+out:
+	mutex_unlock(&kbench_mutex);
+	return ret;
+}
+EXPORT_SYMBOL_GPL(kbench_register);
+
+void kbench_unregister(struct kbench *bench)
+{
+	mutex_lock(&kbench_mutex);
+	list_del(&bench->list);
+	mutex_unlock(&kbench_mutex);
+}
+EXPORT_SYMBOL_GPL(kbench_unregister);
+
+static struct kbench *kbench_find(const char *name)
+{
+	struct kbench *b;
+
+	list_for_each_entry(b, &kbench_list, list)
+		if (!strcmp(b->name, name))
+			return b;
+	return NULL;
+}
+
+static int kbench_cmp(const void *a, const void *b)
+{
+	u32 x = *(const u32 *)a, y = *(const u32 *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static u32 kbench_pct(const u32 *samples, unsigned int nr, unsigned int pm)
+{
+	return samples[(u64)(nr - 1) * pm / 1000];
+}
+
+static int kbench_parse(char *cmd, struct kbench **bench,
+			struct kbench_ctx *ctx)
+{
+	char *tok, *val;
+	int ret = 0;
+
+	ctx->iterations = KBENCH_DEF_ITERATIONS;
+	ctx->size = PAGE_SIZE;
+	ctx->n = 1;
+
+	*bench = NULL;
+	while ((tok = strsep(&cmd, " \t\n"))) {
+		if (!*tok)
+			continue;
+		if (!*bench) {
+			*bench = kbench_find(tok);
+			if (!*bench)
+				return -ENOENT;
+			continue;
+		}
+
+		val = strchr(tok, '=');
+		if (!val)
+			return -EINVAL;
+		*val++ = '\0';
+
+		if (!strcmp(tok, "iters"))
+			ret = kstrtouint(val, 0, &ctx->iterations);
+		else if (!strcmp(tok, "size"))
+			ret = kstrtouint(val, 0, &ctx->size);
+		else if (!strcmp(tok, "n"))
+			ret = kstrtouint(val, 0, &ctx->n);
+		else if (!strcmp(tok, "mode"))
+			strlcpy(ctx->mode, val, sizeof(ctx->mode));
+		else if (!strcmp(tok, "target"))
+			strlcpy(ctx->target, val, sizeof(ctx->target));
+		else
+			ret = -EINVAL;
+		if (ret)
+			return ret;
+	}
+
+	if (!*bench)
+		return -EINVAL;
+	if (!ctx->iterations || ctx->iterations > KBENCH_MAX_ITERATIONS)
+		return -EINVAL;
+	return 0;
+}
+
+/* Called with kbench_mutex held */
+static int kbench_run(struct kbench *bench, struct kbench_ctx *ctx)
+{
+	unsigned int i, nr = ctx->iterations;
+	u64 total = 0, ops, bps = 0;
+	ktime_t start, wall;
+	u32 *samples;
+	s64 delta;
+	int ret = 0;
+
+	samples = vmalloc(nr * sizeof(*samples));
+	if (!samples)
+		return -ENOMEM;
+
+	if (bench->setup) {
+		ret = bench->setup(ctx);
+		if (ret)
+			goto out_free;
+	}
+
+	wall = ktime_get();
+	for (i = 0; i < nr; i++) {
+		if (bench->prepare) {
+			ret = bench->prepare(ctx, i);
+			if (ret)
+				break;
+		}
+
+		start = ktime_get();
+		ret = bench->op(ctx, i);
+		delta = ktime_to_ns(ktime_sub(ktime_get(), start));
+		if (ret)
+			break;
+
+		samples[i] = min_t(s64, delta, U32_MAX);
+		total += samples[i];
+
+		if (bench->post)
+			bench->post(ctx, i);
+
+		if (fatal_signal_pending(current)) {
+			ret = -EINTR;
+			break;
+		}
+		cond_resched();
+	}
+	wall = ktime_sub(ktime_get(), wall);
+
+	if (bench->teardown)
+		bench->teardown(ctx);
+	if (ret)
+		goto out_free;
+
+	sort(samples, nr, sizeof(*samples), kbench_cmp, NULL);
+
+	total = max_t(u64, total, 1);
+	ops = div64_u64((u64)nr * NSEC_PER_SEC, total);
+	if (ctx->bytes)
+		bps = div64_u64(ctx->bytes * nr * NSEC_PER_SEC, total);
+
+	snprintf(kbench_result, sizeof(kbench_result),
+		"bench=%s mode=%s target=%s iters=%u size=%u n=%u "
+		"min_ns=%u p50_ns=%u p90_ns=%u p99_ns=%u p999_ns=%u max_ns=%u "
+		"mean_ns=%llu wall_ns=%lld ops_per_sec=%llu bytes_per_sec=%llu\n",
+		bench->name, ctx->mode[0] ? ctx->mode : "-",
+		ctx->target[0] ? ctx->target : "-", nr, ctx->size, ctx->n,
+		samples[0], kbench_pct(samples, nr, 500),
+		kbench_pct(samples, nr, 900), kbench_pct(samples, nr, 990),
+		kbench_pct(samples, nr, 999), samples[nr - 1],
+		div_u64(total, nr), ktime_to_ns(wall), ops, bps);
+
+out_free:
+	vfree(samples);
+	return ret;
+}
+
+static ssize_t kbench_run_write(struct file *file, const char __user *ubuf,
+				size_t count, loff_t *ppos)
+{
+	struct kbench_ctx ctx;
+	struct kbench *bench;
+	char *cmd;
+	int ret;
+
+	if (count >= KBENCH_CMD_LEN)
+		return -EINVAL;
+
+	cmd = kzalloc(KBENCH_CMD_LEN, GFP_KERNEL);
+	if (!cmd)
+		return -ENOMEM;
+	if (copy_from_user(cmd, ubuf, count)) {
+		ret = -EFAULT;
+		goto out;
+	}
+
+	memset(&ctx, 0, sizeof(ctx));
+	mutex_lock(&kbench_mutex);
+	ret = kbench_parse(cmd, &bench, &ctx);
+	if (!ret)
+		ret = kbench_run(bench, &ctx);
+	if (ret)
+		pr_err("run failed: %d\n", ret);
+	mutex_unlock(&kbench_mutex);
+out:
+	kfree(cmd);
+	return ret ? ret : count;
+}
+
+static int kbench_run_show(struct seq_file *m, void *unused)
+{
+	mutex_lock(&kbench_mutex);
+	seq_puts(m, kbench_result);
+	mutex_unlock(&kbench_mutex);
+	return 0;
+}
+
+static int kbench_run_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, kbench_run_show, NULL);
+}
+
+static const struct file_operations kbench_run_fops = {
+	.open		= kbench_run_open,
+	.read		= seq_read,
+	.write		= kbench_run_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int kbench_list_show(struct seq_file *m, void *unused)
+{
+	struct kbench *b;
+
+	mutex_lock(&kbench_mutex);
+	list_for_each_entry(b, &kbench_list, list)
+		seq_printf(m, "%s: %s\n", b->name, b->help ? b->help : "");
+	mutex_unlock(&kbench_mutex);
+	return 0;
+}
+
+static int kbench_list_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, kbench_list_show, NULL);
+}
+
+static const struct file_operations kbench_list_fops = {
+	.open		= kbench_list_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init kbench_init(void)
+{
+	kbench_dir = debugfs_create_dir("kbench", NULL);
+	if (IS_ERR_OR_NULL(kbench_dir))
+		return -ENODEV;
+
+	debugfs_create_file("run", 0600, kbench_dir, NULL, &kbench_run_fops);
+	debugfs_create_file("list", 0400, kbench_dir, NULL, &kbench_list_fops);
+	return 0;
+}
+late_initcall(kbench_init);
@@ -18,6 +18,10 @@
 #include <linux/errno.h>
 #include <linux/io.h>
 #include <linux/string.h>
+#include <linux/hashtable.h>
+#include <linux/rculist.h>
+#include <linux/debugfs.h>
+#include <linux/ktime.h>
 #include <linux/qmi_encdec.h>
 
 #include "qmi_encdec_priv.h"
@@ -192,6 +196,167 @@ static int qmi_calc_min_msg_len(struct elem_info *ei_array,
 	return min_msg_len;
 }
 
+/*
+ * Element info tables are static data, yet every encode and decode walks
+ * them from scratch. The first time a table is seen, the facts that do not
+ * depend on the message contents are worked out once and cached: the
+ * min/max encoded lengths, a TLV type index for the decoder, and whether a
+ * nested structure is "flat", i.e. made only of fixed size basic elements
+ * packed back to back, so that its C layout is its wire format and arrays
+ * of it can be copied in one go. Entries live until the module owning the
+ * table goes away.
+ */
+#define QMI_EI_CACHE_BITS	6
+#define QMI_EI_NO_INDEX		0
+
+struct qmi_ei_info {
+	struct hlist_node node;
+	struct rcu_head rcu;
+	struct elem_info *ei_array;
+	int max_msg_len;
+	int min_msg_len;
+	uint32_t flat_size;
+	bool top_level;
+	bool indexed;
+	/* 1 + position of the first element for each TLV type, or 0 */
+	uint8_t tlv_index[256];
+};
+
+static bool qmi_ei_cache_enable = true;
+module_param_named(ei_cache, qmi_ei_cache_enable, bool, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(ei_cache, "Cache flattened element info tables");
+
+static DEFINE_HASHTABLE(qmi_ei_cache, QMI_EI_CACHE_BITS);
+static DEFINE_SPINLOCK(qmi_ei_cache_lock);
+
+static bool qmi_is_basic_type(enum elem_type data_type)
+{
+	switch (data_type) {
+	case QMI_UNSIGNED_1_BYTE:
+	case QMI_UNSIGNED_2_BYTE:
+	case QMI_UNSIGNED_4_BYTE:
+	case QMI_UNSIGNED_8_BYTE:
+	case QMI_SIGNED_2_BYTE_ENUM:
+	case QMI_SIGNED_4_BYTE_ENUM:
+		return true;
+	default:
+		return false;
+	}
+}
+
+/* Wire size of a nested table if it is flat, 0 otherwise */
+static uint32_t qmi_calc_flat_size(struct elem_info *ei_array)
+{
+	struct elem_info *temp_ei;
+	uint32_t size = 0;
+
+	for (temp_ei = ei_array; temp_ei->data_type != QMI_EOTI; temp_ei++) {
+		if (!qmi_is_basic_type(temp_ei->data_type) ||
+		    temp_ei->is_array == VAR_LEN_ARRAY ||
+		    temp_ei->offset != size)
+			return 0;
+		size += (temp_ei->is_array == STATIC_ARRAY ?
+			 temp_ei->elem_len : 1) * temp_ei->elem_size;
+	}
+	return size;
+}
+
+static struct qmi_ei_info *qmi_ei_info_create(struct elem_info *ei_array)
+{
+	struct qmi_ei_info *info, *old;
+	struct elem_info *temp_ei;
+	unsigned long flags;
+	int i;
+
+	info = kzalloc(sizeof(*info), GFP_ATOMIC);
+	if (!info)
+		return NULL;
+
+	info->ei_array = ei_array;
+	info->max_msg_len = qmi_calc_max_msg_len(ei_array, 1);
+	info->min_msg_len = qmi_calc_min_msg_len(ei_array, 1);
+	info->flat_size = qmi_calc_flat_size(ei_array);
+	info->indexed = true;
+	for (temp_ei = ei_array, i = 1; temp_ei->data_type != QMI_EOTI;
+	     temp_ei++, i++) {
+		if (i > U8_MAX) {
+			info->indexed = false;
+			break;
+		}
+		if (info->tlv_index[temp_ei->tlv_type] == QMI_EI_NO_INDEX)
+			info->tlv_index[temp_ei->tlv_type] = i;
+	}
+
+	spin_lock_irqsave(&qmi_ei_cache_lock, flags);
+	hash_for_each_possible(qmi_ei_cache, old, node,
+			       (unsigned long)ei_array) {
+		if (old->ei_array == ei_array) {
+			spin_unlock_irqrestore(&qmi_ei_cache_lock, flags);
+			kfree(info);
+			return old;
+		}
+	}
+	hash_add_rcu(qmi_ei_cache, &info->node, (unsigned long)ei_array);
+	spin_unlock_irqrestore(&qmi_ei_cache_lock, flags);
+	return info;
+}
+
+/*
+ * Returned entries are only freed when the owning module unloads, which
+ * cannot happen while one of its tables is being encoded or decoded.
+ */
+static struct qmi_ei_info *qmi_ei_lookup(struct elem_info *ei_array,
+					 bool top_level)
+{
+	struct qmi_ei_info *info;
+
+	if (!qmi_ei_cache_enable || !ei_array)
+		return NULL;
+
+	rcu_read_lock();
+	hash_for_each_possible_rcu(qmi_ei_cache, info, node,
+				   (unsigned long)ei_array) {
+		if (info->ei_array == ei_array)
+			goto out;
+	}
+	info = NULL;
+out:
+	rcu_read_unlock();
+
+	if (!info)
+		info = qmi_ei_info_create(ei_array);
+	if (info && top_level)
+		info->top_level = true;
+	return info;
+}
+
+static int qmi_ei_module_notify(struct notifier_block *nb,
+				unsigned long action, void *data)
+{
+	struct module *mod = data;
+	struct qmi_ei_info *info;
+	struct hlist_node *tmp;
+	unsigned long flags;
+	int bkt;
+
+	if (action != MODULE_STATE_GOING)
+		return NOTIFY_DONE;
+
+	spin_lock_irqsave(&qmi_ei_cache_lock, flags);
+	hash_for_each_safe(qmi_ei_cache, bkt, tmp, info, node) {
+		if (within_module_core((unsigned long)info->ei_array, mod)) {
+			hash_del_rcu(&info->node);
+			kfree_rcu(info, rcu);
+		}
+	}
+	spin_unlock_irqrestore(&qmi_ei_cache_lock, flags);
+	return NOTIFY_OK;
+}
+
+static struct notifier_block qmi_ei_module_nb = {
+	.notifier_call = qmi_ei_module_notify,
+};
+
 /**
  * qmi_verify_max_msg_len() - Verify the maximum length of a QMI message
  * @desc: Pointer to structure descriptor.
@@ -230,13 +395,17 @@ int qmi_kernel_encode(struct msg_desc *desc,
 {
 	int enc_level = 1;
 	int ret, calc_max_msg_len, calc_min_msg_len;
+	struct qmi_ei_info *info;
 
 	if (!desc)
 		return -EINVAL;
 
+	info = qmi_ei_lookup(desc->ei_array, true);
+
 	/* Check the possibility of a zero length QMI message */
 	if (!in_c_struct) {
-		calc_min_msg_len = qmi_calc_min_msg_len(desc->ei_array, 1);
+		calc_min_msg_len = info ? info->min_msg_len :
+			qmi_calc_min_msg_len(desc->ei_array, 1);
 		if (calc_min_msg_len) {
 			pr_err("%s: Calc. len %d != 0, but NULL in_c_struct\n",
 				__func__, calc_min_msg_len);
@@ -259,7 +428,8 @@ int qmi_kernel_encode(struct msg_desc *desc,
 	ret = _qmi_kernel_encode(desc->ei_array, out_buf,
 				 in_c_struct, out_buf_len, enc_level);
 	if (ret == -ETOOSMALL) {
-		calc_max_msg_len = qmi_calc_max_msg_len(desc->ei_array, 1);
+		calc_max_msg_len = info ? info->max_msg_len :
+			qmi_calc_max_msg_len(desc->ei_array, 1);
 		pr_err("%s: Calc. len %d != Out buf len %d\n",
 			__func__, calc_max_msg_len, out_buf_len);
 	}
@@ -285,13 +455,10 @@ EXPORT_SYMBOL(qmi_kernel_encode);
 static int qmi_encode_basic_elem(void *buf_dst, void *buf_src,
 				 uint32_t elem_len, uint32_t elem_size)
 {
-	uint32_t i, rc = 0;
-
-	for (i = 0; i < elem_len; i++) {
-		QMI_ENCDEC_ENCODE_N_BYTES(buf_dst, buf_src, elem_size);
-		rc += elem_size;
-	}
+	uint32_t rc = elem_len * elem_size;
 
+	/* Consecutive elements are contiguous on both sides */
+	QMI_ENCDEC_ENCODE_N_BYTES(buf_dst, buf_src, rc);
 	return rc;
 }
 
@@ -320,6 +487,19 @@ static int qmi_encode_struct_elem(struct elem_info *ei_array,
 {
 	int i, rc, encoded_bytes = 0;
 	struct elem_info *temp_ei = ei_array;
+	struct qmi_ei_info *info = qmi_ei_lookup(temp_ei->ei_array, false);
+	uint32_t flat_len = elem_len * temp_ei->elem_size;
+
+	/*
+	 * A flat structure encodes to its own C layout. Only take the fast
+	 * path if the whole array fits; otherwise let the element by element
+	 * encoder report the failure.
+	 */
+	if (info && info->flat_size && info->flat_size == temp_ei->elem_size &&
+	    flat_len + TLV_LEN_SIZE + TLV_TYPE_SIZE <= out_buf_len) {
+		memcpy(buf_dst, buf_src, flat_len);
+		return flat_len;
+	}
 
 	for (i = 0; i < elem_len; i++) {
 		rc = _qmi_kernel_encode(temp_ei->ei_array, buf_dst, buf_src,
@@ -583,6 +763,8 @@ int qmi_kernel_decode(struct msg_desc *desc, void *out_c_struct,
 	if (!desc || !desc->ei_array)
 		return -EINVAL;
 
+	qmi_ei_lookup(desc->ei_array, true);
+
 	if (!out_c_struct || !in_buf || !in_buf_len)
 		return -EINVAL;
 
@@ -616,13 +798,9 @@ EXPORT_SYMBOL(qmi_kernel_decode);
 static int qmi_decode_basic_elem(void *buf_dst, void *buf_src,
 				 uint32_t elem_len, uint32_t elem_size)
 {
-	uint32_t i, rc = 0;
-
-	for (i = 0; i < elem_len; i++) {
-		QMI_ENCDEC_DECODE_N_BYTES(buf_dst, buf_src, elem_size);
-		rc += elem_size;
-	}
+	uint32_t rc = elem_len * elem_size;
 
+	QMI_ENCDEC_DECODE_N_BYTES(buf_dst, buf_src, rc);
 	return rc;
 }
 
@@ -651,6 +829,16 @@ static int qmi_decode_struct_elem(struct elem_info *ei_array, void *buf_dst,
 {
 	int i, rc, decoded_bytes = 0;
 	struct elem_info *temp_ei = ei_array;
+	struct qmi_ei_info *info = qmi_ei_lookup(temp_ei->ei_array, false);
+	uint32_t flat_len = elem_len * temp_ei->elem_size;
+
+	if (info && info->flat_size && info->flat_size == temp_ei->elem_size &&
+	    flat_len <= tlv_len) {
+		memcpy(buf_dst, buf_src, flat_len);
+		decoded_bytes = flat_len;
+		i = elem_len;
+		goto check;
+	}
 
 	for (i = 0; i < elem_len && decoded_bytes < tlv_len; i++) {
 		rc = _qmi_kernel_decode(temp_ei->ei_array, buf_dst, buf_src,
@@ -662,6 +850,7 @@ static int qmi_decode_struct_elem(struct elem_info *ei_array, void *buf_dst,
 		decoded_bytes += rc;
 	}
 
+check:
 	if ((dec_level <= 2 && decoded_bytes != tlv_len) ||
 	    (dec_level > 2 && (i < elem_len || decoded_bytes > tlv_len))) {
 		pr_err("%s: Fault in decoding: dl(%d), db(%d), tl(%d), i(%d), el(%d)\n",
@@ -743,6 +932,14 @@ static struct elem_info *find_ei(struct elem_info *ei_array,
 				   uint32_t type)
 {
 	struct elem_info *temp_ei = ei_array;
+	struct qmi_ei_info *info = qmi_ei_lookup(ei_array, false);
+	uint8_t idx;
+
+	if (info && info->indexed) {
+		idx = info->tlv_index[(uint8_t)type];
+		return idx == QMI_EI_NO_INDEX ? NULL : &ei_array[idx - 1];
+	}
+
 	while (temp_ei->data_type != QMI_EOTI) {
 		if (temp_ei->tlv_type == (uint8_t)type)
 			return temp_ei;
@@ -871,5 +1068,192 @@ static int _qmi_kernel_decode(struct elem_info *ei_array,
 	}
 	return decoded_bytes;
 }
+#ifdef CONFIG_DEBUG_FS
+#define QMI_BENCH_MAX_MSGS	128
+#define QMI_BENCH_LOOPS		1000
+#define QMI_BENCH_PATTERN	0x5a
+
+/* Size of the C structure described by a table */
+static uint32_t qmi_calc_c_struct_size(struct elem_info *ei_array)
+{
+	struct elem_info *temp_ei;
+	uint32_t end, size = 0;
+
+	for (temp_ei = ei_array; temp_ei->data_type != QMI_EOTI; temp_ei++) {
+		end = temp_ei->offset +
+			(temp_ei->is_array == NO_ARRAY ? 1 :
+			 temp_ei->elem_len) * temp_ei->elem_size;
+		/* room for the terminating NUL written by the string decoder */
+		if (temp_ei->data_type == QMI_STRING)
+			end++;
+		size = max(size, end);
+	}
+	return size;
+}
+
+/*
+ * Fill a C structure so that every element of the table is encoded once:
+ * optional elements present, variable length arrays of length one and
+ * short strings.
+ */
+static void qmi_fill_sample(struct elem_info *ei_array, uint8_t *c_struct)
+{
+	struct elem_info *temp_ei;
+	uint32_t n, j, data_len;
+	uint8_t *p;
+
+	for (temp_ei = ei_array; temp_ei->data_type != QMI_EOTI; temp_ei++) {
+		p = c_struct + temp_ei->offset;
+		n = temp_ei->is_array == STATIC_ARRAY ? temp_ei->elem_len : 1;
+		switch (temp_ei->data_type) {
+		case QMI_OPT_FLAG:
+			*p = 1;
+			break;
+		case QMI_DATA_LEN:
+			data_len = temp_ei[1].elem_len ? 1 : 0;
+			memcpy(p, &data_len, min_t(uint32_t, temp_ei->elem_size,
+						   sizeof(data_len)));
+			break;
+		case QMI_STRUCT:
+			for (j = 0; j < n; j++)
+				qmi_fill_sample(temp_ei->ei_array,
+						p + j * temp_ei->elem_size);
+			break;
+		case QMI_STRING:
+			strlcpy(p, "qmi", min_t(uint32_t, temp_ei->elem_len + 1,
+						sizeof("qmi")));
+			break;
+		default:
+			memset(p, QMI_BENCH_PATTERN, n * temp_ei->elem_size);
+			break;
+		}
+	}
+}
+
+static u64 qmi_bench_one(struct msg_desc *desc, void *c_in, void *c_out,
+			 uint32_t c_size, void *wire, int *enc_len)
+{
+	ktime_t start;
+	int i, len = 0;
+
+	start = ktime_get();
+	for (i = 0; i < QMI_BENCH_LOOPS; i++) {
+		len = qmi_kernel_encode(desc, wire, desc->max_msg_len, c_in);
+		if (len <= 0)
+			break;
+		memset(c_out, 0, c_size);
+		if (qmi_kernel_decode(desc, c_out, wire, len) < 0) {
+			len = -EINVAL;
+			break;
+		}
+	}
+	*enc_len = len;
+	return div_u64(ktime_to_ns(ktime_sub(ktime_get(), start)),
+		       QMI_BENCH_LOOPS);
+}
+
+/*
+ * Encode and decode a sample of every message table that has gone through
+ * the library since boot, once with the cache disabled and once with it
+ * enabled, and check that both produce the same wire format and structure.
+ */
+static ssize_t qmi_bench_read(struct file *file, char __user *ubuf,
+			      size_t count, loff_t *ppos)
+{
+	struct elem_info **tables;
+	struct qmi_ei_info *info;
+	struct msg_desc desc;
+	uint8_t *c_in, *c_out, *c_ref, *wire, *wire_ref;
+	uint32_t c_size;
+	u64 slow_ns, fast_ns;
+	int n = 0, i, bkt, len, ref_len, ret;
+	bool saved = qmi_ei_cache_enable;
+	char *buf;
+	size_t buf_size = PAGE_SIZE * 4, used = 0;
+
+	if (*ppos)
+		return 0;
+
+	tables = kcalloc(QMI_BENCH_MAX_MSGS, sizeof(*tables), GFP_KERNEL);
+	buf = kzalloc(buf_size, GFP_KERNEL);
+	if (!tables || !buf) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	rcu_read_lock();
+	hash_for_each_rcu(qmi_ei_cache, bkt, info, node) {
+		if (info->top_level && n < QMI_BENCH_MAX_MSGS)
+			tables[n++] = info->ei_array;
+	}
+	rcu_read_unlock();
+
+	for (i = 0; i < n; i++) {
+		desc.msg_id = 0;
+		desc.ei_array = tables[i];
+		desc.max_msg_len = qmi_calc_max_msg_len(tables[i], 1);
+		c_size = qmi_calc_c_struct_size(tables[i]);
+		if (!desc.max_msg_len || !c_size)
+			continue;
+
+		c_in = kzalloc(3 * c_size + 2 * desc.max_msg_len, GFP_KERNEL);
+		if (!c_in)
+			break;
+		c_out = c_in + c_size;
+		c_ref = c_out + c_size;
+		wire_ref = c_ref + c_size;
+		wire = wire_ref + desc.max_msg_len;
+		qmi_fill_sample(tables[i], c_in);
+
+		qmi_ei_cache_enable = false;
+		slow_ns = qmi_bench_one(&desc, c_in, c_ref, c_size, wire_ref,
+					&ref_len);
+		qmi_ei_cache_enable = true;
+		fast_ns = qmi_bench_one(&desc, c_in, c_out, c_size, wire,
+					&len);
+		qmi_ei_cache_enable = saved;
+
+		used += scnprintf(buf + used, buf_size - used,
+			"%-56ps len %5d uncached %6llu ns cached %6llu ns %s\n",
+			tables[i], len, slow_ns, fast_ns,
+			len != ref_len ? "LEN MISMATCH" :
+			len > 0 && memcmp(wire, wire_ref, len) ? "WIRE MISMATCH" :
+			memcmp(c_out, c_ref, c_size) ? "DECODE MISMATCH" :
+			len <= 0 ? "FAILED" : "ok");
+		kfree(c_in);
+	}
+
+	ret = simple_read_from_buffer(ubuf, count, ppos, buf, used);
+out:
+	kfree(buf);
+	kfree(tables);
+	return ret;
+}
+
+static const struct file_operations qmi_bench_fops = {
+	.read = qmi_bench_read,
+};
+
+static void qmi_encdec_debugfs_init(void)
+{
+	struct dentry *dent;
+
+	dent = debugfs_create_dir("qmi_encdec", NULL);
+	if (IS_ERR_OR_NULL(dent))
+		return;
+	debugfs_create_file("bench", S_IRUSR, dent, NULL, &qmi_bench_fops);
+}
+#else
+static inline void qmi_encdec_debugfs_init(void) { }
+#endif
+
+static int __init qmi_encdec_init(void)
+{
+	register_module_notifier(&qmi_ei_module_nb);
+	qmi_encdec_debugfs_init();
+	return 0;
+}
+late_initcall(qmi_encdec_init);
+
 MODULE_DESCRIPTION("QMI kernel enc/dec");
 MODULE_LICENSE("GPL v2");
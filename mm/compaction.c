@@ -16,6 +16,8 @@
 #include <linux/sysfs.h>
 #include <linux/balloon_compaction.h>
 #include <linux/page-isolation.h>
+#include <linux/kthread.h>
+#include <linux/freezer.h>
 #include "internal.h"
 
 #ifdef CONFIG_COMPACTION
@@ -1204,6 +1206,152 @@ static void compact_nodes(void)
 		compact_node(nid);
 }
 
+/*
+ * Background compaction. kswapd wakes kcompactd when it goes to sleep
+ * and a zone of its node is fragmented for sysctl_kcompactd_order
+ * allocations, so that they find free pages of that order before they
+ * have to enter direct compaction.
+ */
+int sysctl_kcompactd_order = 4;
+int sysctl_kcompactd_extfrag_threshold = 500;
+
+static bool kcompactd_zone_suitable(struct zone *zone, int order)
+{
+	if (!populated_zone(zone))
+		return false;
+	if (fragmentation_index(zone, order) <=
+			sysctl_kcompactd_extfrag_threshold)
+		return false;
+	return compaction_suitable(zone, order) == COMPACT_CONTINUE;
+}
+
+static bool kcompactd_node_suitable(pg_data_t *pgdat, int order)
+{
+	int zoneid;
+
+	for (zoneid = 0; zoneid < MAX_NR_ZONES; zoneid++)
+		if (kcompactd_zone_suitable(&pgdat->node_zones[zoneid], order))
+			return true;
+	return false;
+}
+
+static void kcompactd_do_work(pg_data_t *pgdat)
+{
+	int zoneid, order = sysctl_kcompactd_order;
+	struct zone *zone;
+	struct compact_control cc = {
+		.order = order,
+		.sync = true,
+	};
+
+	for (zoneid = 0; zoneid < MAX_NR_ZONES; zoneid++) {
+		if (kthread_should_stop())
+			return;
+
+		zone = &pgdat->node_zones[zoneid];
+		if (!kcompactd_zone_suitable(zone, order) ||
+		    compaction_deferred(zone, order))
+			continue;
+
+		cc.nr_freepages = 0;
+		cc.nr_migratepages = 0;
+		cc.zone = zone;
+		INIT_LIST_HEAD(&cc.freepages);
+		INIT_LIST_HEAD(&cc.migratepages);
+
+		compact_zone(zone, &cc);
+
+		if (zone_watermark_ok(zone, order, low_wmark_pages(zone), 0, 0))
+			zone->compact_order_failed = max(zone->compact_order_failed,
+							 order + 1);
+		else
+			defer_compaction(zone, order);
+
+		VM_BUG_ON(!list_empty(&cc.freepages));
+		VM_BUG_ON(!list_empty(&cc.migratepages));
+	}
+}
+
+static int kcompactd(void *p)
+{
+	pg_data_t *pgdat = p;
+	const struct cpumask *cpumask = cpumask_of_node(pgdat->node_id);
+
+	if (!cpumask_empty(cpumask))
+		set_cpus_allowed_ptr(current, cpumask);
+	set_freezable();
+
+	while (!kthread_should_stop()) {
+		wait_event_freezable(pgdat->kcompactd_wait,
+				     pgdat->kcompactd_pending ||
+				     kthread_should_stop());
+		pgdat->kcompactd_pending = false;
+		kcompactd_do_work(pgdat);
+	}
+
+	return 0;
+}
+
+/* Called by kswapd when its node is balanced and it is going to sleep */
+void wakeup_kcompactd(pg_data_t *pgdat)
+{
+	int order = sysctl_kcompactd_order;
+
+	if (!pgdat->kcompactd || order <= 0 || order >= MAX_ORDER)
+		return;
+	if (!waitqueue_active(&pgdat->kcompactd_wait))
+		return;
+	if (!kcompactd_node_suitable(pgdat, order))
+		return;
+
+	pgdat->kcompactd_pending = true;
+	wake_up_interruptible(&pgdat->kcompactd_wait);
+}
+
+/*
+ * Called at boot and by memory hotplug when memory of a node is onlined.
+ */
+int kcompactd_run(int nid)
+{
+	pg_data_t *pgdat = NODE_DATA(nid);
+	int ret = 0;
+
+	if (pgdat->kcompactd)
+		return 0;
+
+	pgdat->kcompactd = kthread_run(kcompactd, pgdat, "kcompactd%d", nid);
+	if (IS_ERR(pgdat->kcompactd)) {
+		pr_err("Failed to start kcompactd on node %d\n", nid);
+		ret = PTR_ERR(pgdat->kcompactd);
+		pgdat->kcompactd = NULL;
+	}
+	return ret;
+}
+
+/*
+ * Called by memory hotplug when all memory in a node is offlined. Caller must
+ * hold lock_memory_hotplug().
+ */
+void kcompactd_stop(int nid)
+{
+	struct task_struct *kcompactd = NODE_DATA(nid)->kcompactd;
+
+	if (kcompactd) {
+		kthread_stop(kcompactd);
+		NODE_DATA(nid)->kcompactd = NULL;
+	}
+}
+
+static int __init kcompactd_init(void)
+{
+	int nid;
+
+	for_each_node_state(nid, N_MEMORY)
+		kcompactd_run(nid);
+	return 0;
+}
+subsys_initcall(kcompactd_init)
+
 /* The written value is actually unused, all memory is compacted */
 int sysctl_compact_memory;
 
@@ -227,6 +227,30 @@ static unsigned int ksm_thread_sleep_millisecs = 20;
 /* Boolean to indicate whether to use deferred timer or not */
 static bool use_deferred_timer;
 
+/* Scale the batch with the unmerged pages, within a cpu time budget */
+static bool ksm_adaptive_scan;
+
+/* Milliseconds of cpu time ksmd may use per second in adaptive mode */
+static unsigned int ksm_cpu_budget_millisecs = 50;
+
+/* Adaptive mode aims at scanning all unmerged pages in this many batches */
+#define KSM_ADAPTIVE_BATCHES	100
+
+static struct ksm_budget {
+	unsigned long window_end;	/* jiffies */
+	u64 used;			/* ns of cpu time in this window */
+	u64 ns_per_page;		/* running average of the scan cost */
+} ksm_budget;
+
+/* Map zero filled pages to the zero page, bypassing the stable tree */
+static bool ksm_use_zero_pages = true;
+
+/* Checksum of an empty page, to spot zero page candidates */
+static u32 zero_checksum __read_mostly;
+
+/* The number of pages ever replaced by the zero page */
+static unsigned long ksm_zero_pages_merged;
+
 #ifdef CONFIG_NUMA
 /* Zeroed when merging across nodes is not allowed */
 static unsigned int ksm_merge_across_nodes = 1;
@@ -940,7 +964,7 @@ out:
  * replace_page - replace page in vma by new ksm page
  * @vma:      vma that holds the pte pointing to page
  * @page:     the page we are replacing by kpage
- * @kpage:    the ksm page we replace page by
+ * @kpage:    the ksm page, or the zero page, we replace page by
  * @orig_pte: the original value of the pte
  *
  * Returns 0 on success, -EFAULT on failure.
@@ -951,6 +975,7 @@ static int replace_page(struct vm_area_struct *vma, struct page *page,
 	struct mm_struct *mm = vma->vm_mm;
 	pmd_t *pmd;
 	pte_t *ptep;
+	pte_t newpte;
 	spinlock_t *ptl;
 	unsigned long addr;
 	int err = -EFAULT;
@@ -976,12 +1001,22 @@ static int replace_page(struct vm_area_struct *vma, struct page *page,
 		goto out_mn;
 	}
 
-	get_page(kpage);
-	page_add_anon_rmap(kpage, vma, addr);
+	/*
+	 * The zero page is never refcounted nor on the rmap: map it the
+	 * way do_anonymous_page() does, a write fault will then cow it.
+	 */
+	if (!is_zero_pfn(page_to_pfn(kpage))) {
+		get_page(kpage);
+		page_add_anon_rmap(kpage, vma, addr);
+		newpte = mk_pte(kpage, vma->vm_page_prot);
+	} else {
+		newpte = pte_mkspecial(pfn_pte(page_to_pfn(kpage),
+					       vma->vm_page_prot));
+	}
 
 	flush_cache_page(vma, addr, pte_pfn(*ptep));
 	ptep_clear_flush(vma, addr, ptep);
-	set_pte_at_notify(mm, addr, ptep, mk_pte(kpage, vma->vm_page_prot));
+	set_pte_at_notify(mm, addr, ptep, newpte);
 
 	page_remove_rmap(page);
 	if (!page_mapped(page))
@@ -1128,6 +1163,40 @@ out:
 	return err;
 }
 
+/*
+ * try_to_merge_zero_page - map the zero page instead of an empty page.
+ *
+ * Unlike a ksm page, the zero page is left out of the stable tree: the
+ * rmap_item stays unmerged and the scan skips the address from then on,
+ * as it no longer maps an anonymous page.
+ *
+ * This function returns 0 if the page was replaced, -EFAULT otherwise.
+ */
+static int try_to_merge_zero_page(struct rmap_item *rmap_item,
+				  struct page *page)
+{
+	struct mm_struct *mm = rmap_item->mm;
+	struct vm_area_struct *vma;
+	int err = -EFAULT;
+
+	down_read(&mm->mmap_sem);
+	if (ksm_test_exit(mm))
+		goto out;
+	vma = find_vma(mm, rmap_item->address);
+	if (!vma || vma->vm_start > rmap_item->address)
+		goto out;
+	/* The zero page cannot be mlocked: leave these to the stable tree */
+	if (vma->vm_flags & VM_LOCKED)
+		goto out;
+
+	err = try_to_merge_one_page(vma, page, ZERO_PAGE(rmap_item->address));
+	if (!err)
+		ksm_zero_pages_merged++;
+out:
+	up_read(&mm->mmap_sem);
+	return err;
+}
+
 /*
  * try_to_merge_two_pages - take two identical pages and prepare them
  * to be merged into one page.
@@ -1491,6 +1560,14 @@ static void cmp_and_merge_page(struct page *page, struct rmap_item *rmap_item)
 		return;
 	}
 
+	/*
+	 * An empty page needs no stable tree node: map the zero page.
+	 * If it was not empty after all, go on with the unstable tree.
+	 */
+	if (ksm_use_zero_pages && checksum == zero_checksum &&
+	    !try_to_merge_zero_page(rmap_item, page))
+		return;
+
 	tree_rmap_item =
 		unstable_tree_search_insert(rmap_item, page, &tree_page);
 	if (tree_rmap_item) {
@@ -1709,19 +1786,79 @@ next_mm:
 /**
  * ksm_do_scan  - the ksm scanner main worker function.
  * @scan_npages - number of pages we want to scan before we return.
+ *
+ * Returns the number of pages scanned.
  */
-static void ksm_do_scan(unsigned int scan_npages)
+static unsigned int ksm_do_scan(unsigned int scan_npages)
 {
 	struct rmap_item *rmap_item;
 	struct page *uninitialized_var(page);
+	unsigned int scanned = 0;
 
-	while (scan_npages-- && likely(!freezing(current))) {
+	while (scanned < scan_npages && likely(!freezing(current))) {
 		cond_resched();
 		rmap_item = scan_get_next_rmap_item(&page);
 		if (!rmap_item)
-			return;
+			break;
 		cmp_and_merge_page(page, rmap_item);
 		put_page(page);
+		scanned++;
+	}
+	return scanned;
+}
+
+/*
+ * The pages ksmd has seen but not merged: those in the unstable tree and
+ * those changing too fast to get there. A fork storm of MADV_MERGEABLE
+ * processes makes it grow as soon as the scan reaches their mm_slots.
+ */
+static unsigned long ksm_unmerged_pages(void)
+{
+	long nr = ksm_rmap_items - ksm_pages_shared - ksm_pages_sharing;
+
+	return nr > 0 ? nr : 0;
+}
+
+/*
+ * ksm_do_adaptive_scan - scan a batch sized to the unmerged pages.
+ *
+ * The batch grows so a pass over the unmerged pages takes about
+ * KSM_ADAPTIVE_BATCHES batches, but never below pages_to_scan, and is
+ * cut to what the cpu time left in the current second allows at the
+ * recent cost per page. Once the budget is spent, batches are skipped
+ * until the next second.
+ */
+static void ksm_do_adaptive_scan(void)
+{
+	u64 budget = (u64)ksm_cpu_budget_millisecs * NSEC_PER_MSEC;
+	unsigned long nr_pages;
+	unsigned int scanned;
+	u64 start, used;
+
+	if (time_after_eq(jiffies, ksm_budget.window_end)) {
+		ksm_budget.window_end = jiffies + HZ;
+		ksm_budget.used = 0;
+	}
+	if (ksm_budget.used >= budget)
+		return;
+
+	nr_pages = max_t(unsigned long, ksm_thread_pages_to_scan,
+			 ksm_unmerged_pages() / KSM_ADAPTIVE_BATCHES);
+	if (ksm_budget.ns_per_page)
+		nr_pages = min_t(u64, nr_pages,
+				 div64_u64(budget - ksm_budget.used,
+					   ksm_budget.ns_per_page) + 1);
+
+	start = task_sched_runtime(current);
+	scanned = ksm_do_scan(min_t(unsigned long, nr_pages, UINT_MAX));
+	used = task_sched_runtime(current) - start;
+
+	ksm_budget.used += used;
+	if (scanned) {
+		used = div_u64(used, scanned) ?: 1;
+		if (ksm_budget.ns_per_page)
+			used = (ksm_budget.ns_per_page * 3 + used) >> 2;
+		ksm_budget.ns_per_page = used;
 	}
 }
 
@@ -1773,8 +1910,12 @@ static int ksm_scan_thread(void *nothing)
 	while (!kthread_should_stop()) {
 		mutex_lock(&ksm_thread_mutex);
 		wait_while_offlining();
-		if (ksmd_should_run())
-			ksm_do_scan(ksm_thread_pages_to_scan);
+		if (ksmd_should_run()) {
+			if (ksm_adaptive_scan)
+				ksm_do_adaptive_scan();
+			else
+				ksm_do_scan(ksm_thread_pages_to_scan);
+		}
 		mutex_unlock(&ksm_thread_mutex);
 
 		try_to_freeze();
@@ -2353,6 +2494,78 @@ static ssize_t deferred_timer_store(struct kobject *kobj,
 }
 KSM_ATTR(deferred_timer);
 
+static ssize_t adaptive_scan_show(struct kobject *kobj,
+				  struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", ksm_adaptive_scan);
+}
+
+static ssize_t adaptive_scan_store(struct kobject *kobj,
+				   struct kobj_attribute *attr,
+				   const char *buf, size_t count)
+{
+	unsigned long enable;
+	int err;
+
+	err = kstrtoul(buf, 10, &enable);
+	if (err || enable > 1)
+		return -EINVAL;
+
+	mutex_lock(&ksm_thread_mutex);
+	ksm_adaptive_scan = enable;
+	memset(&ksm_budget, 0, sizeof(ksm_budget));
+	mutex_unlock(&ksm_thread_mutex);
+
+	return count;
+}
+KSM_ATTR(adaptive_scan);
+
+static ssize_t cpu_budget_millisecs_show(struct kobject *kobj,
+					 struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", ksm_cpu_budget_millisecs);
+}
+
+static ssize_t cpu_budget_millisecs_store(struct kobject *kobj,
+					  struct kobj_attribute *attr,
+					  const char *buf, size_t count)
+{
+	unsigned long msecs;
+	int err;
+
+	err = kstrtoul(buf, 10, &msecs);
+	if (err || !msecs || msecs > MSEC_PER_SEC)
+		return -EINVAL;
+
+	ksm_cpu_budget_millisecs = msecs;
+
+	return count;
+}
+KSM_ATTR(cpu_budget_millisecs);
+
+static ssize_t use_zero_pages_show(struct kobject *kobj,
+				   struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", ksm_use_zero_pages);
+}
+
+static ssize_t use_zero_pages_store(struct kobject *kobj,
+				    struct kobj_attribute *attr,
+				    const char *buf, size_t count)
+{
+	unsigned long enable;
+	int err;
+
+	err = kstrtoul(buf, 10, &enable);
+	if (err || enable > 1)
+		return -EINVAL;
+
+	ksm_use_zero_pages = enable;
+
+	return count;
+}
+KSM_ATTR(use_zero_pages);
+
 #ifdef CONFIG_NUMA
 static ssize_t merge_across_nodes_show(struct kobject *kobj,
 				struct kobj_attribute *attr, char *buf)
@@ -2456,6 +2669,13 @@ static ssize_t full_scans_show(struct kobject *kobj,
 }
 KSM_ATTR_RO(full_scans);
 
+static ssize_t zero_pages_merged_show(struct kobject *kobj,
+				      struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%lu\n", ksm_zero_pages_merged);
+}
+KSM_ATTR_RO(zero_pages_merged);
+
 static struct attribute *ksm_attrs[] = {
 	&sleep_millisecs_attr.attr,
 	&pages_to_scan_attr.attr,
@@ -2466,6 +2686,10 @@ static struct attribute *ksm_attrs[] = {
 	&pages_volatile_attr.attr,
 	&full_scans_attr.attr,
 	&deferred_timer_attr.attr,
+	&adaptive_scan_attr.attr,
+	&cpu_budget_millisecs_attr.attr,
+	&use_zero_pages_attr.attr,
+	&zero_pages_merged_attr.attr,
 #ifdef CONFIG_NUMA
 	&merge_across_nodes_attr.attr,
 #endif
@@ -2487,6 +2711,8 @@ static int __init ksm_init(void)
 	if (err)
 		goto out;
 
+	zero_checksum = calc_checksum(ZERO_PAGE(0));
+
 	ksm_thread = kthread_run(ksm_scan_thread, NULL, "ksmd");
 	if (IS_ERR(ksm_thread)) {
 		printk(KERN_ERR "ksm: creating kthread failed\n");
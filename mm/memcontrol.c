@@ -313,6 +313,15 @@ struct mem_cgroup {
 	/* set when res.limit == memsw.limit */
 	bool		memsw_is_minimum;
 
+	/*
+	 * Asynchronous reclaim: once usage comes within high_wmark_distance
+	 * of the limit, a worker reclaims until it is low_wmark_distance
+	 * below it, so charges rarely have to reclaim directly. 0 disables.
+	 */
+	unsigned long long high_wmark_distance;
+	unsigned long long low_wmark_distance;
+	struct work_struct async_reclaim_work;
+
 	/* protect arrays of thresholds */
 	struct mutex thresholds_lock;
 
@@ -1032,6 +1041,60 @@ static bool mem_cgroup_event_ratelimit(struct mem_cgroup *memcg,
 	return false;
 }
 
+static struct workqueue_struct *memcg_async_reclaim_wq;
+
+static bool mem_cgroup_above_wmark(struct mem_cgroup *memcg,
+				   unsigned long long distance)
+{
+	unsigned long long limit;
+
+	if (!distance)
+		return false;
+	limit = res_counter_read_u64(&memcg->res, RES_LIMIT);
+	if (limit == RESOURCE_MAX || limit <= distance)
+		return false;
+	return res_counter_read_u64(&memcg->res, RES_USAGE) > limit - distance;
+}
+
+#define MEM_CGROUP_ASYNC_RECLAIM_LOOPS	64
+
+static void mem_cgroup_async_reclaim(struct work_struct *work)
+{
+	struct mem_cgroup *memcg = container_of(work, struct mem_cgroup,
+						async_reclaim_work);
+	unsigned long long low;
+	int loop;
+
+	for (loop = 0; loop < MEM_CGROUP_ASYNC_RECLAIM_LOOPS; loop++) {
+		low = max(memcg->low_wmark_distance,
+			  memcg->high_wmark_distance);
+		if (!mem_cgroup_above_wmark(memcg, low))
+			break;
+		if (!try_to_free_mem_cgroup_pages(memcg, GFP_KERNEL,
+						  memcg->memsw_is_minimum))
+			break;
+		cond_resched();
+	}
+	css_put(&memcg->css);
+}
+
+/*
+ * Queue asynchronous reclaim for @memcg and every ancestor whose usage,
+ * which includes the charges of @memcg, is above its high watermark.
+ */
+static void mem_cgroup_check_wmarks(struct mem_cgroup *memcg)
+{
+	for (; memcg; memcg = parent_mem_cgroup(memcg)) {
+		if (!mem_cgroup_above_wmark(memcg, memcg->high_wmark_distance))
+			continue;
+		if (!css_tryget(&memcg->css))
+			continue;
+		if (!queue_work(memcg_async_reclaim_wq,
+				&memcg->async_reclaim_work))
+			css_put(&memcg->css);
+	}
+}
+
 /*
  * Check events in order.
  *
@@ -1054,6 +1117,7 @@ static void memcg_check_events(struct mem_cgroup *memcg, struct page *page)
 		preempt_enable();
 
 		mem_cgroup_threshold(memcg);
+		mem_cgroup_check_wmarks(memcg);
 		if (unlikely(do_softlimit))
 			mem_cgroup_update_tree(memcg, page);
 #if MAX_NUMNODES > 1
@@ -2606,7 +2670,7 @@ static int mem_cgroup_do_charge(struct mem_cgroup *memcg, gfp_t gfp_mask,
 				bool invoke_oom)
 {
 	unsigned long csize = nr_pages * PAGE_SIZE;
-	struct mem_cgroup *mem_over_limit;
+	struct mem_cgroup *mem_over_limit, *stall_memcg;
 	struct res_counter *fail_res;
 	unsigned long flags = 0;
 	int ret;
@@ -2638,7 +2702,9 @@ static int mem_cgroup_do_charge(struct mem_cgroup *memcg, gfp_t gfp_mask,
 	if (gfp_mask & __GFP_NORETRY)
 		return CHARGE_NOMEM;
 
+	stall_memcg = vmpressure_stall_begin();
 	ret = mem_cgroup_reclaim(mem_over_limit, gfp_mask, flags);
+	vmpressure_stall_end(stall_memcg);
 	if (mem_cgroup_margin(mem_over_limit) >= nr_pages)
 		return CHARGE_RETRY;
 	/*
@@ -5518,6 +5584,38 @@ static int memcg_stat_show(struct cgroup *cont, struct cftype *cft,
 	return 0;
 }
 
+static u64 mem_cgroup_wmark_read(struct cgroup *cgrp, struct cftype *cft)
+{
+	struct mem_cgroup *memcg = mem_cgroup_from_cont(cgrp);
+
+	if (cft->private)
+		return memcg->low_wmark_distance;
+	return memcg->high_wmark_distance;
+}
+
+static int mem_cgroup_wmark_write(struct cgroup *cgrp, struct cftype *cft,
+				  const char *buffer)
+{
+	struct mem_cgroup *memcg = mem_cgroup_from_cont(cgrp);
+	unsigned long long val;
+	int ret;
+
+	if (mem_cgroup_is_root(memcg))
+		return -EINVAL;
+
+	ret = res_counter_memparse_write_strategy(buffer, &val);
+	if (ret)
+		return ret;
+
+	if (cft->private)
+		memcg->low_wmark_distance = val;
+	else
+		memcg->high_wmark_distance = val;
+
+	mem_cgroup_check_wmarks(memcg);
+	return 0;
+}
+
 static u64 mem_cgroup_swappiness_read(struct cgroup *cgrp, struct cftype *cft)
 {
 	struct mem_cgroup *memcg = mem_cgroup_from_cont(cgrp);
@@ -5969,6 +6067,18 @@ static struct cftype mem_cgroup_files[] = {
 		.trigger = mem_cgroup_reset,
 		.read = mem_cgroup_read,
 	},
+	{
+		.name = "high_wmark_distance",
+		.private = 0,
+		.write_string = mem_cgroup_wmark_write,
+		.read_u64 = mem_cgroup_wmark_read,
+	},
+	{
+		.name = "low_wmark_distance",
+		.private = 1,
+		.write_string = mem_cgroup_wmark_write,
+		.read_u64 = mem_cgroup_wmark_read,
+	},
 	{
 		.name = "stat",
 		.read_seq_string = memcg_stat_show,
@@ -6006,6 +6116,10 @@ static struct cftype mem_cgroup_files[] = {
 		.register_event = vmpressure_register_event,
 		.unregister_event = vmpressure_unregister_event,
 	},
+	{
+		.name = "stall",
+		.read_seq_string = vmpressure_stall_show,
+	},
 #ifdef CONFIG_NUMA
 	{
 		.name = "numa_stat",
@@ -6288,6 +6402,7 @@ mem_cgroup_css_alloc(struct cgroup *cont)
 	mutex_init(&memcg->thresholds_lock);
 	spin_lock_init(&memcg->move_lock);
 	vmpressure_init(&memcg->vmpressure);
+	INIT_WORK(&memcg->async_reclaim_work, mem_cgroup_async_reclaim);
 
 	return &memcg->css;
 
@@ -7056,6 +7171,10 @@ static int __init mem_cgroup_init(void)
 	enable_swap_cgroup();
 	mem_cgroup_soft_limit_tree_init();
 	memcg_stock_init();
+	memcg_async_reclaim_wq = alloc_workqueue("memcg_async_reclaim",
+						 WQ_UNBOUND | WQ_MEM_RECLAIM |
+						 WQ_FREEZABLE, 0);
+	BUG_ON(!memcg_async_reclaim_wq);
 	return 0;
 }
 subsys_initcall(mem_cgroup_init);
@@ -61,6 +61,8 @@
 #include <linux/page-debug-flags.h>
 #include <linux/hugetlb.h>
 #include <linux/sched/rt.h>
+#include <linux/page_owner_sample.h>
+#include <linux/vmpressure.h>
 
 #include <asm/sections.h>
 #include <asm/tlbflush.h>
@@ -758,6 +760,7 @@ static bool free_pages_prepare(struct page *page, unsigned int order)
 		p->order = -1;
 	}
 #endif
+	page_owner_sample_free(page, order);
 
 	if (!PageHighMem(page)) {
 		debug_check_no_locks_freed(page_address(page),PAGE_SIZE<<order);
@@ -1242,13 +1245,31 @@ retry_reserve:
 	return page;
 }
 
+#ifdef CONFIG_CMA
+/*
+ * Every movable page placed in CMA has to be migrated away again by the
+ * next alloc_contig_range() over it, so __GFP_CMA allocations only
+ * prefer CMA once the zone runs low on other free pages.
+ */
+static inline bool cma_preferred(struct zone *zone)
+{
+	return zone_page_state(zone, NR_FREE_PAGES) -
+		zone_page_state(zone, NR_FREE_CMA_PAGES) <
+		high_wmark_pages(zone);
+}
+#endif
+
 static struct page *__rmqueue_cma(struct zone *zone, unsigned int order,
 							int migratetype)
 {
 	struct page *page = 0;
 #ifdef CONFIG_CMA
-	if (migratetype == MIGRATE_MOVABLE && !zone->cma_alloc)
-		page = __rmqueue_smallest(zone, order, MIGRATE_CMA);
+	if (migratetype == MIGRATE_MOVABLE && !zone->cma_alloc) {
+		if (!cma_preferred(zone))
+			page = __rmqueue_smallest(zone, order, migratetype);
+		if (!page)
+			page = __rmqueue_smallest(zone, order, MIGRATE_CMA);
+	}
 	if (!page)
 #endif
 retry_reserve :
@@ -2353,6 +2374,8 @@ __alloc_pages_direct_compact(gfp_t gfp_mask, unsigned int order,
 	bool *contended_compaction, bool *deferred_compaction,
 	unsigned long *did_some_progress)
 {
+	struct mem_cgroup *stall_memcg;
+
 	if (!order)
 		return NULL;
 
@@ -2361,11 +2384,13 @@ __alloc_pages_direct_compact(gfp_t gfp_mask, unsigned int order,
 		return NULL;
 	}
 
+	stall_memcg = vmpressure_stall_begin();
 	current->flags |= PF_MEMALLOC;
 	*did_some_progress = try_to_compact_pages(zonelist, order, gfp_mask,
 						nodemask, sync_migration,
 						contended_compaction);
 	current->flags &= ~PF_MEMALLOC;
+	vmpressure_stall_end(stall_memcg);
 
 	if (*did_some_progress != COMPACT_SKIPPED) {
 		struct page *page;
@@ -2426,12 +2451,14 @@ __perform_reclaim(gfp_t gfp_mask, unsigned int order, struct zonelist *zonelist,
 		  nodemask_t *nodemask)
 {
 	struct reclaim_state reclaim_state;
+	struct mem_cgroup *stall_memcg;
 	int progress;
 
 	cond_resched();
 
 	/* We now go into synchronous reclaim */
 	cpuset_memory_pressure_bump();
+	stall_memcg = vmpressure_stall_begin();
 	current->flags |= PF_MEMALLOC;
 	lockdep_set_current_reclaim_state(gfp_mask);
 	reclaim_state.reclaimed_slab = 0;
@@ -2442,6 +2469,7 @@ __perform_reclaim(gfp_t gfp_mask, unsigned int order, struct zonelist *zonelist,
 	current->reclaim_state = NULL;
 	lockdep_clear_current_reclaim_state();
 	current->flags &= ~PF_MEMALLOC;
+	vmpressure_stall_end(stall_memcg);
 
 	cond_resched();
 
@@ -2858,8 +2886,10 @@ out:
 
 	memcg_kmem_commit_charge(page, memcg, order);
 
-	if (page)
+	if (page) {
 		set_page_owner(page, order, gfp_mask);
+		page_owner_sample_alloc(page, order, migratetype);
+	}
 
 	return page;
 }
@@ -4794,6 +4824,9 @@ static void __paginginit free_area_init_core(struct pglist_data *pgdat,
 #endif
 	init_waitqueue_head(&pgdat->kswapd_wait);
 	init_waitqueue_head(&pgdat->pfmemalloc_wait);
+#ifdef CONFIG_COMPACTION
+	init_waitqueue_head(&pgdat->kcompactd_wait);
+#endif
 	pgdat_page_cgroup_init(pgdat);
 
 	for (j = 0; j < MAX_NR_ZONES; j++) {
@@ -6136,14 +6169,95 @@ static unsigned long pfn_max_align_up(unsigned long pfn)
 				pageblock_nr_pages));
 }
 
+/* pages isolated for each round of migration */
+#define CONTIG_MIGRATE_BATCH	(8 * COMPACT_CLUSTER_MAX)
+/* smallest share of a round worth handing to another cpu */
+#define CONTIG_MIGRATE_CHUNK	(2 * COMPACT_CLUSTER_MAX)
+#define CONTIG_MIGRATE_WORKERS	4
+
+struct contig_migrate_work {
+	struct work_struct work;
+	struct list_head pages;
+	int ret;
+};
+
+static void contig_migrate_workfn(struct work_struct *work)
+{
+	struct contig_migrate_work *w =
+		container_of(work, struct contig_migrate_work, work);
+
+	w->ret = migrate_pages(&w->pages, alloc_migrate_target, 0,
+			       MIGRATE_SYNC, MR_CMA);
+}
+
+/*
+ * Migrate the @nr pages on @pages, spreading large rounds over the
+ * online cpus. Returns the number of pages left on @pages, which could
+ * not be migrated, or an error code.
+ */
+static int contig_migrate_pages(struct list_head *pages, unsigned long nr)
+{
+	struct contig_migrate_work works[CONTIG_MIGRATE_WORKERS];
+	struct page *page, *next;
+	int nr_works, i = 0, cpu, this_cpu, ret = 0;
+
+	get_online_cpus();
+	nr_works = min_t(unsigned long, nr / CONTIG_MIGRATE_CHUNK,
+			 min_t(int, num_online_cpus(), CONTIG_MIGRATE_WORKERS));
+	if (nr_works < 2) {
+		put_online_cpus();
+		return migrate_pages(pages, alloc_migrate_target, 0,
+				     MIGRATE_SYNC, MR_CMA);
+	}
+
+	for (i = 0; i < nr_works; i++)
+		INIT_LIST_HEAD(&works[i].pages);
+	i = 0;
+	list_for_each_entry_safe(page, next, pages, lru) {
+		list_move(&page->lru, &works[i].pages);
+		i = (i + 1) % nr_works;
+	}
+
+	/* the first share is migrated here, the others on other cpus */
+	i = 1;
+	this_cpu = get_cpu();
+	for_each_online_cpu(cpu) {
+		if (i == nr_works)
+			break;
+		if (cpu == this_cpu)
+			continue;
+		INIT_WORK_ONSTACK(&works[i].work, contig_migrate_workfn);
+		queue_work_on(cpu, system_highpri_wq, &works[i].work);
+		i++;
+	}
+	put_cpu();
+
+	contig_migrate_workfn(&works[0].work);
+	for (i = 0; i < nr_works; i++) {
+		if (i) {
+			flush_work(&works[i].work);
+			destroy_work_on_stack(&works[i].work);
+		}
+		if (works[i].ret < 0)
+			ret = ret < 0 ? ret : works[i].ret;
+		else if (ret >= 0)
+			ret += works[i].ret;
+		list_splice(&works[i].pages, pages);
+	}
+	put_online_cpus();
+
+	return ret;
+}
+
 /* [start, end) must belong to a single zone. */
 static int __alloc_contig_migrate_range(struct compact_control *cc,
 					unsigned long start, unsigned long end)
 {
 	/* This function is based on compact_zone() from compaction.c. */
-	unsigned long nr_reclaimed;
+	unsigned long nr_reclaimed, nr_isolated;
 	unsigned long pfn = start;
 	unsigned int tries = 0;
+	LIST_HEAD(isolated);
 	int ret = 0;
 
 	migrate_prep();
@@ -6155,9 +6269,22 @@ static int __alloc_contig_migrate_range(struct compact_control *cc,
 		}
 
 		if (list_empty(&cc->migratepages)) {
-			cc->nr_migratepages = 0;
-			pfn = isolate_migratepages_range(cc->zone, cc,
-							 pfn, end, true);
+			/*
+			 * isolate_migratepages_range() stops at
+			 * COMPACT_CLUSTER_MAX pages, gather a few of its
+			 * batches to migrate them together.
+			 */
+			nr_isolated = 0;
+			do {
+				cc->nr_migratepages = 0;
+				pfn = isolate_migratepages_range(cc->zone, cc,
+								 pfn, end, true);
+				nr_isolated += cc->nr_migratepages;
+				list_splice_init(&cc->migratepages, &isolated);
+			} while (pfn && pfn < end &&
+				 nr_isolated < CONTIG_MIGRATE_BATCH);
+			list_splice_init(&isolated, &cc->migratepages);
+			cc->nr_migratepages = nr_isolated;
 			if (!pfn) {
 				ret = -EINTR;
 				break;
@@ -6172,8 +6299,8 @@ static int __alloc_contig_migrate_range(struct compact_control *cc,
 							&cc->migratepages);
 		cc->nr_migratepages -= nr_reclaimed;
 
-		ret = migrate_pages(&cc->migratepages, alloc_migrate_target,
-				    0, MIGRATE_SYNC, MR_CMA);
+		ret = contig_migrate_pages(&cc->migratepages,
+					   cc->nr_migratepages);
 	}
 	if (ret < 0) {
 		putback_movable_pages(&cc->migratepages);
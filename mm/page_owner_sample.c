@@ -0,0 +1,341 @@
+/*
+ * Sampled page allocation profiler
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * A production friendly relative of PAGE_OWNER: instead of a stack trace
+ * in every struct page, every Nth allocation of each order and migratetype
+ * on a cpu records its call site in a fixed size table of stack traces.
+ * Each entry counts the sampled allocations and, for the pages that are
+ * still tracked, their frees, so allocs - frees estimates the long lived
+ * pages of a call site. Allocations that fell back to a pageblock of
+ * another migratetype are kept apart, as they are what fragments memory.
+ *
+ * Disabled, the allocator hooks are a static branch. Everything lives in
+ * debugfs, under page_owner_sample/:
+ *
+ *	enable	1 to start sampling, 0 to stop; the tables are kept
+ *	rate	sample one in this many allocations (default 1024)
+ *	reset	write to clear the tables
+ *	stacks	the recorded call sites
+ */
+
+#define pr_fmt(fmt) "page_owner_sample: " fmt
+
+#include <linux/debugfs.h>
+#include <linux/hash.h>
+#include <linux/init.h>
+#include <linux/jhash.h>
+#include <linux/mm.h>
+#include <linux/mmzone.h>
+#include <linux/mutex.h>
+#include <linux/page_owner_sample.h>
+#include <linux/percpu.h>
+#include <linux/seq_file.h>
+#include <linux/spinlock.h>
+#include <linux/stacktrace.h>
+#include <linux/vmalloc.h>
+
+#define POS_STACK_DEPTH		16
+#define POS_STACK_BITS		10
+#define POS_STACK_PROBES	16
+#define POS_PAGE_BITS		13
+#define POS_NO_PFN		(~0UL)
+
+struct pos_stack {
+	u32 hash;
+	u8 order;
+	u8 migratetype;
+	u8 fallback;
+	u8 nr_entries;		/* 0 for an unused slot */
+	unsigned long allocs;
+	unsigned long frees;
+	unsigned long entries[POS_STACK_DEPTH];
+};
+
+/* a sampled page that has not been freed yet */
+struct pos_page {
+	unsigned long pfn;
+	unsigned int stack;
+};
+
+struct static_key page_owner_sample_key = STATIC_KEY_INIT_FALSE;
+
+static u32 pos_rate = 1024;
+static bool pos_enabled;
+static DEFINE_MUTEX(pos_mutex);		/* pos_enabled, table allocation */
+
+static DEFINE_SPINLOCK(pos_lock);	/* the tables below */
+static struct pos_stack *pos_stacks;
+static struct pos_page *pos_pages;
+static unsigned long pos_dropped;	/* stack table full */
+static unsigned long pos_evicted;	/* tracked page slot reused */
+
+static DEFINE_PER_CPU(int, pos_countdown[MAX_ORDER][MIGRATE_TYPES]);
+
+static int pos_find_stack(struct pos_stack *key)
+{
+	struct pos_stack *s;
+	unsigned int i, idx;
+
+	for (i = 0; i < POS_STACK_PROBES; i++) {
+		idx = (key->hash + i) & ((1 << POS_STACK_BITS) - 1);
+		s = &pos_stacks[idx];
+		if (!s->nr_entries) {
+			*s = *key;
+			return idx;
+		}
+		if (s->hash == key->hash && s->order == key->order &&
+		    s->migratetype == key->migratetype &&
+		    s->fallback == key->fallback &&
+		    s->nr_entries == key->nr_entries &&
+		    !memcmp(s->entries, key->entries,
+			    key->nr_entries * sizeof(key->entries[0])))
+			return idx;
+	}
+	return -1;
+}
+
+void __page_owner_sample_alloc(struct page *page, unsigned int order,
+			       int migratetype)
+{
+	struct stack_trace trace;
+	struct pos_stack key;
+	struct pos_page *p;
+	unsigned long flags;
+	int idx;
+
+	if (unlikely(order >= MAX_ORDER || migratetype >= MIGRATE_TYPES))
+		return;
+	if (likely(this_cpu_dec_return(pos_countdown[order][migratetype]) > 0))
+		return;
+	this_cpu_write(pos_countdown[order][migratetype], max(pos_rate, 1U));
+
+	trace.nr_entries = 0;
+	trace.max_entries = POS_STACK_DEPTH;
+	trace.entries = key.entries;
+	trace.skip = 2;
+	save_stack_trace(&trace);
+	if (!trace.nr_entries)
+		return;
+
+	key.order = order;
+	key.migratetype = migratetype;
+	key.fallback = get_pageblock_migratetype(page) != migratetype;
+	key.nr_entries = trace.nr_entries;
+	key.allocs = 0;
+	key.frees = 0;
+	key.hash = jhash(key.entries, key.nr_entries * sizeof(key.entries[0]),
+			 order << 16 | migratetype << 8 | key.fallback);
+
+	spin_lock_irqsave(&pos_lock, flags);
+	idx = pos_find_stack(&key);
+	if (idx < 0) {
+		pos_dropped++;
+		goto out;
+	}
+	pos_stacks[idx].allocs++;
+
+	p = &pos_pages[hash_long(page_to_pfn(page), POS_PAGE_BITS)];
+	if (p->pfn != POS_NO_PFN)
+		pos_evicted++;
+	p->pfn = page_to_pfn(page);
+	p->stack = idx;
+out:
+	spin_unlock_irqrestore(&pos_lock, flags);
+}
+
+void __page_owner_sample_free(struct page *page, unsigned int order)
+{
+	unsigned long pfn = page_to_pfn(page);
+	struct pos_page *p;
+	unsigned long flags;
+
+	/* allocated on first enable and never freed, see pos_enable_set() */
+	if (unlikely(!pos_pages))
+		return;
+
+	p = &pos_pages[hash_long(pfn, POS_PAGE_BITS)];
+	if (likely(ACCESS_ONCE(p->pfn) != pfn))
+		return;
+
+	spin_lock_irqsave(&pos_lock, flags);
+	if (p->pfn == pfn) {
+		pos_stacks[p->stack].frees++;
+		p->pfn = POS_NO_PFN;
+	}
+	spin_unlock_irqrestore(&pos_lock, flags);
+}
+
+/* caller holds pos_lock */
+static void pos_reset_tables(void)
+{
+	int i;
+
+	memset(pos_stacks, 0, sizeof(*pos_stacks) << POS_STACK_BITS);
+	for (i = 0; i < 1 << POS_PAGE_BITS; i++)
+		pos_pages[i].pfn = POS_NO_PFN;
+	pos_dropped = 0;
+	pos_evicted = 0;
+}
+
+static int pos_enable_get(void *data, u64 *val)
+{
+	*val = pos_enabled;
+	return 0;
+}
+
+static int pos_enable_set(void *data, u64 val)
+{
+	struct pos_stack *stacks;
+	struct pos_page *pages;
+	unsigned long flags;
+	int ret = 0;
+
+	mutex_lock(&pos_mutex);
+	if (!!val == pos_enabled)
+		goto out;
+
+	if (val && !pos_stacks) {
+		stacks = vmalloc(sizeof(*stacks) << POS_STACK_BITS);
+		pages = vmalloc(sizeof(*pages) << POS_PAGE_BITS);
+		if (!stacks || !pages) {
+			vfree(stacks);
+			vfree(pages);
+			ret = -ENOMEM;
+			goto out;
+		}
+		spin_lock_irqsave(&pos_lock, flags);
+		pos_stacks = stacks;
+		pos_pages = pages;
+		pos_reset_tables();
+		spin_unlock_irqrestore(&pos_lock, flags);
+	}
+
+	pos_enabled = !!val;
+	if (pos_enabled)
+		static_key_slow_inc(&page_owner_sample_key);
+	else
+		static_key_slow_dec(&page_owner_sample_key);
+out:
+	mutex_unlock(&pos_mutex);
+	return ret;
+}
+DEFINE_SIMPLE_ATTRIBUTE(pos_enable_fops, pos_enable_get, pos_enable_set,
+			"%llu\n");
+
+static ssize_t pos_reset_write(struct file *file, const char __user *buf,
+			       size_t count, loff_t *ppos)
+{
+	unsigned long flags;
+
+	mutex_lock(&pos_mutex);
+	if (pos_stacks) {
+		spin_lock_irqsave(&pos_lock, flags);
+		pos_reset_tables();
+		spin_unlock_irqrestore(&pos_lock, flags);
+	}
+	mutex_unlock(&pos_mutex);
+	return count;
+}
+
+static const struct file_operations pos_reset_fops = {
+	.write		= pos_reset_write,
+	.llseek		= noop_llseek,
+};
+
+static void *pos_stacks_start(struct seq_file *m, loff_t *pos)
+{
+	mutex_lock(&pos_mutex);
+	if (!pos_stacks)
+		return NULL;
+	if (!*pos)
+		return SEQ_START_TOKEN;
+	return *pos <= 1 << POS_STACK_BITS ? pos : NULL;
+}
+
+static void *pos_stacks_next(struct seq_file *m, void *v, loff_t *pos)
+{
+	++*pos;
+	return *pos <= 1 << POS_STACK_BITS ? pos : NULL;
+}
+
+static void pos_stacks_stop(struct seq_file *m, void *v)
+{
+	mutex_unlock(&pos_mutex);
+}
+
+static int pos_stacks_show(struct seq_file *m, void *v)
+{
+	static struct pos_stack s;	/* serialized by pos_mutex */
+	unsigned long flags;
+	int i;
+
+	if (v == SEQ_START_TOKEN) {
+		spin_lock_irqsave(&pos_lock, flags);
+		seq_printf(m, "rate %u dropped %lu evicted %lu\n\n",
+			   pos_rate, pos_dropped, pos_evicted);
+		spin_unlock_irqrestore(&pos_lock, flags);
+		return 0;
+	}
+
+	/* copy the entry out, symbol lookup is too slow for the lock */
+	spin_lock_irqsave(&pos_lock, flags);
+	s = pos_stacks[*(loff_t *)v - 1];
+	spin_unlock_irqrestore(&pos_lock, flags);
+	if (!s.nr_entries)
+		return 0;
+
+	seq_printf(m, "order %u migratetype %u%s allocs %lu frees %lu\n",
+		   s.order, s.migratetype, s.fallback ? " fallback" : "",
+		   s.allocs, s.frees);
+	for (i = 0; i < s.nr_entries; i++)
+		seq_printf(m, " %pS\n", (void *)s.entries[i]);
+	seq_putc(m, '\n');
+	return 0;
+}
+
+static const struct seq_operations pos_stacks_seq_ops = {
+	.start	= pos_stacks_start,
+	.next	= pos_stacks_next,
+	.stop	= pos_stacks_stop,
+	.show	= pos_stacks_show,
+};
+
+static int pos_stacks_open(struct inode *inode, struct file *file)
+{
+	return seq_open(file, &pos_stacks_seq_ops);
+}
+
+static const struct file_operations pos_stacks_fops = {
+	.open		= pos_stacks_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= seq_release,
+};
+
+static int __init page_owner_sample_init(void)
+{
+	struct dentry *dir;
+
+	dir = debugfs_create_dir("page_owner_sample", NULL);
+	if (IS_ERR_OR_NULL(dir)) {
+		pr_err("failed to create debugfs directory\n");
+		return -ENOMEM;
+	}
+
+	debugfs_create_file("enable", S_IRUSR | S_IWUSR, dir, NULL,
+			    &pos_enable_fops);
+	debugfs_create_u32("rate", S_IRUSR | S_IWUSR, dir, &pos_rate);
+	debugfs_create_file("reset", S_IWUSR, dir, NULL, &pos_reset_fops);
+	debugfs_create_file("stacks", S_IRUSR, dir, NULL, &pos_stacks_fops);
+	return 0;
+}
+late_initcall(page_owner_sample_init);
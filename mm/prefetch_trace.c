@@ -0,0 +1,512 @@
+/*
+ * Page cache prefetch from recorded traces
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * Readahead only helps sequential access. App launch and boot mostly
+ * fault in scattered pages of APKs, odex files and libraries, one
+ * synchronous read at a time. This records the page cache misses of a
+ * window, merged into ranges per file, so that user space can save the
+ * trace and replay it as large asynchronous readahead the next time,
+ * e.g. right after forking the app process or early in init.
+ *
+ * Everything lives in debugfs, under prefetch_trace/:
+ *
+ *	record	"start [tgid [ms]]" records the misses of thread group tgid,
+ *		all tasks if 0, for ms (default 10000, 0 until stopped).
+ *		"stop" ends the window. Reading shows the state.
+ *	trace	reading gives the last trace, one "start nr path" line per
+ *		range of pages. Lines written are queued for replay.
+ *
+ * prefetch_trace.boot_ms=N on the command line records all tasks for
+ * the first N ms after the initcalls, to capture a boot trace.
+ */
+
+#define pr_fmt(fmt) "prefetch_trace: " fmt
+
+#include <linux/ctype.h>
+#include <linux/dcache.h>
+#include <linux/debugfs.h>
+#include <linux/fs.h>
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/mm.h>
+#include <linux/mutex.h>
+#include <linux/prefetch_trace.h>
+#include <linux/sched.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/uaccess.h>
+#include <linux/vmalloc.h>
+#include <linux/workqueue.h>
+
+#define PT_MAX_FILES		512
+#define PT_MAX_RANGES		8192
+#define PT_MERGE_GAP		16	/* pages read in between to merge */
+#define PT_MERGE_LOOKBACK	8	/* ranges searched for a merge */
+#define PT_DEF_WINDOW_MS	10000
+#define PT_LINE_MAX		(PATH_MAX + 32)
+
+struct pt_file {
+	struct inode *inode;	/* only compared, never dereferenced */
+	char *path;
+};
+
+struct pt_range {
+	pgoff_t start;
+	unsigned int nr;
+	unsigned int file;
+};
+
+struct pt_replay {
+	struct list_head list;
+	pgoff_t start;
+	unsigned long nr;
+	char path[];
+};
+
+struct pt_writer {
+	size_t len;
+	char line[PT_LINE_MAX];
+};
+
+struct static_key prefetch_trace_key = STATIC_KEY_INIT_FALSE;
+
+static unsigned int pt_boot_ms;
+module_param_named(boot_ms, pt_boot_ms, uint, 0444);
+
+static DEFINE_MUTEX(pt_mutex);		/* recording state, the tables */
+static bool pt_recording;
+static pid_t pt_tgid;
+
+static DEFINE_SPINLOCK(pt_lock);	/* the tables while recording */
+static struct pt_file *pt_files;
+static struct pt_range *pt_ranges;
+static char *pt_pathbuf;
+static unsigned int pt_nr_files;
+static unsigned int pt_nr_ranges;
+static unsigned int pt_last_file;
+static unsigned long pt_dropped;
+
+static LIST_HEAD(pt_replay_list);
+static DEFINE_SPINLOCK(pt_replay_lock);
+static unsigned long pt_replayed;	/* pages requested */
+
+static void pt_stop_workfn(struct work_struct *work);
+static void pt_replay_workfn(struct work_struct *work);
+static DECLARE_DELAYED_WORK(pt_stop_work, pt_stop_workfn);
+static DECLARE_WORK(pt_replay_work, pt_replay_workfn);
+
+/* Called with pt_lock held */
+static int pt_find_file(struct file *file)
+{
+	struct inode *inode = file->f_mapping->host;
+	unsigned int i;
+	char *path;
+
+	if (pt_last_file < pt_nr_files &&
+	    pt_files[pt_last_file].inode == inode)
+		return pt_last_file;
+
+	for (i = 0; i < pt_nr_files; i++) {
+		if (pt_files[i].inode == inode) {
+			pt_last_file = i;
+			return i;
+		}
+	}
+
+	if (pt_nr_files >= PT_MAX_FILES)
+		return -ENOSPC;
+
+	/* only files that can be opened again by name */
+	if (!S_ISREG(inode->i_mode) || d_unlinked(file->f_path.dentry))
+		return -EINVAL;
+
+	path = d_path(&file->f_path, pt_pathbuf, PATH_MAX);
+	if (IS_ERR(path))
+		return PTR_ERR(path);
+
+	path = kstrdup(path, GFP_ATOMIC);
+	if (!path)
+		return -ENOMEM;
+
+	i = pt_nr_files++;
+	pt_files[i].inode = inode;
+	pt_files[i].path = path;
+	pt_last_file = i;
+	return i;
+}
+
+void __prefetch_trace_record(struct file *file, pgoff_t offset)
+{
+	struct pt_range *r;
+	unsigned int i;
+	int idx;
+
+	if (pt_tgid && current->tgid != pt_tgid)
+		return;
+
+	spin_lock(&pt_lock);
+	if (!pt_recording)
+		goto out;
+
+	idx = pt_find_file(file);
+	if (idx < 0) {
+		pt_dropped++;
+		goto out;
+	}
+
+	/* most misses extend one of the last few ranges */
+	for (i = 0; i < min(pt_nr_ranges, PT_MERGE_LOOKBACK); i++) {
+		r = &pt_ranges[pt_nr_ranges - 1 - i];
+		if (r->file != idx)
+			continue;
+		if (offset >= r->start && offset <= r->start + r->nr +
+		    PT_MERGE_GAP) {
+			r->nr = max_t(unsigned long, r->nr,
+				      offset - r->start + 1);
+			goto out;
+		}
+		if (offset < r->start && offset + PT_MERGE_GAP >= r->start) {
+			r->nr += r->start - offset;
+			r->start = offset;
+			goto out;
+		}
+	}
+
+	if (pt_nr_ranges >= PT_MAX_RANGES) {
+		pt_dropped++;
+		goto out;
+	}
+	r = &pt_ranges[pt_nr_ranges++];
+	r->start = offset;
+	r->nr = 1;
+	r->file = idx;
+out:
+	spin_unlock(&pt_lock);
+}
+
+/* Called with pt_mutex held */
+static void pt_free_trace(void)
+{
+	unsigned int i;
+
+	for (i = 0; i < pt_nr_files; i++)
+		kfree(pt_files[i].path);
+	pt_nr_files = 0;
+	pt_nr_ranges = 0;
+	pt_last_file = 0;
+	pt_dropped = 0;
+}
+
+/* Called with pt_mutex held */
+static int pt_start(pid_t tgid)
+{
+	if (pt_recording)
+		return -EBUSY;
+
+	if (!pt_files) {
+		pt_files = vzalloc(PT_MAX_FILES * sizeof(*pt_files));
+		pt_ranges = vzalloc(PT_MAX_RANGES * sizeof(*pt_ranges));
+		pt_pathbuf = kmalloc(PATH_MAX, GFP_KERNEL);
+		if (!pt_files || !pt_ranges || !pt_pathbuf) {
+			vfree(pt_files);
+			vfree(pt_ranges);
+			kfree(pt_pathbuf);
+			pt_files = NULL;
+			pt_ranges = NULL;
+			pt_pathbuf = NULL;
+			return -ENOMEM;
+		}
+	}
+
+	pt_free_trace();
+	pt_tgid = tgid;
+
+	spin_lock(&pt_lock);
+	pt_recording = true;
+	spin_unlock(&pt_lock);
+	static_key_slow_inc(&prefetch_trace_key);
+	return 0;
+}
+
+/* Called with pt_mutex held */
+static void pt_stop(void)
+{
+	if (!pt_recording)
+		return;
+
+	static_key_slow_dec(&prefetch_trace_key);
+	spin_lock(&pt_lock);
+	pt_recording = false;
+	spin_unlock(&pt_lock);
+	pr_info("recorded %u ranges in %u files, %lu dropped\n",
+		pt_nr_ranges, pt_nr_files, pt_dropped);
+}
+
+static void pt_stop_workfn(struct work_struct *work)
+{
+	mutex_lock(&pt_mutex);
+	pt_stop();
+	mutex_unlock(&pt_mutex);
+}
+
+static int pt_record_start(pid_t tgid, unsigned int ms)
+{
+	int ret;
+
+	mutex_lock(&pt_mutex);
+	ret = pt_start(tgid);
+	mutex_unlock(&pt_mutex);
+
+	if (!ret && ms)
+		mod_delayed_work(system_wq, &pt_stop_work,
+				 msecs_to_jiffies(ms));
+	return ret;
+}
+
+static void pt_replay_workfn(struct work_struct *work)
+{
+	struct pt_replay *rp;
+	struct file *filp = NULL;
+	char *path = NULL;
+
+	for (;;) {
+		spin_lock(&pt_replay_lock);
+		rp = list_first_entry_or_null(&pt_replay_list,
+					      struct pt_replay, list);
+		if (rp)
+			list_del(&rp->list);
+		spin_unlock(&pt_replay_lock);
+		if (!rp)
+			break;
+
+		/* traces come grouped by file, keep it open meanwhile */
+		if (!path || strcmp(path, rp->path)) {
+			if (!IS_ERR_OR_NULL(filp))
+				filp_close(filp, NULL);
+			kfree(path);
+			path = kstrdup(rp->path, GFP_KERNEL);
+			filp = filp_open(rp->path, O_RDONLY | O_LARGEFILE, 0);
+		}
+
+		if (!IS_ERR_OR_NULL(filp) &&
+		    !force_page_cache_readahead(filp->f_mapping, filp,
+						rp->start, rp->nr))
+			pt_replayed += rp->nr;
+		kfree(rp);
+		cond_resched();
+	}
+
+	if (!IS_ERR_OR_NULL(filp))
+		filp_close(filp, NULL);
+	kfree(path);
+}
+
+/* "start nr path", the path being the rest of the line */
+static int pt_queue_line(char *line)
+{
+	unsigned long start, nr;
+	struct pt_replay *rp;
+	char *p = skip_spaces(line), *tok;
+
+	if (!*p)
+		return 0;
+
+	tok = strsep(&p, " ");
+	if (!p || kstrtoul(tok, 10, &start))
+		return -EINVAL;
+	p = skip_spaces(p);
+	tok = strsep(&p, " ");
+	if (!p || kstrtoul(tok, 10, &nr) || !nr)
+		return -EINVAL;
+	p = skip_spaces(p);
+	if (*p != '/')
+		return -EINVAL;
+
+	rp = kmalloc(sizeof(*rp) + strlen(p) + 1, GFP_KERNEL);
+	if (!rp)
+		return -ENOMEM;
+	rp->start = start;
+	rp->nr = nr;
+	strcpy(rp->path, p);
+
+	spin_lock(&pt_replay_lock);
+	list_add_tail(&rp->list, &pt_replay_list);
+	spin_unlock(&pt_replay_lock);
+	return 0;
+}
+
+static int pt_trace_show(struct seq_file *m, void *unused)
+{
+	struct pt_range *r;
+	unsigned int i;
+	int ret = 0;
+
+	mutex_lock(&pt_mutex);
+	if (pt_recording) {
+		ret = -EBUSY;
+		goto out;
+	}
+	for (i = 0; i < pt_nr_ranges; i++) {
+		r = &pt_ranges[i];
+		seq_printf(m, "%lu %u %s\n", r->start, r->nr,
+			   pt_files[r->file].path);
+	}
+out:
+	mutex_unlock(&pt_mutex);
+	return ret;
+}
+
+static int pt_trace_open(struct inode *inode, struct file *file)
+{
+	struct pt_writer *w;
+
+	if (!(file->f_mode & FMODE_WRITE))
+		return single_open(file, pt_trace_show, NULL);
+	if (file->f_mode & FMODE_READ)
+		return -EINVAL;
+
+	w = kzalloc(sizeof(*w), GFP_KERNEL);
+	if (!w)
+		return -ENOMEM;
+	file->private_data = w;
+	return nonseekable_open(inode, file);
+}
+
+static ssize_t pt_trace_write(struct file *file, const char __user *ubuf,
+			      size_t count, loff_t *ppos)
+{
+	struct pt_writer *w = file->private_data;
+	size_t done = 0, n, i;
+	char buf[128];
+
+	while (done < count) {
+		n = min(count - done, sizeof(buf));
+		if (copy_from_user(buf, ubuf + done, n))
+			return -EFAULT;
+
+		for (i = 0; i < n; i++) {
+			if (buf[i] != '\n') {
+				/* overlong lines are dropped */
+				if (w->len < PT_LINE_MAX)
+					w->line[w->len++] = buf[i];
+				continue;
+			}
+			if (w->len < PT_LINE_MAX) {
+				w->line[w->len] = '\0';
+				if (pt_queue_line(w->line))
+					pr_debug("bad line: %s\n", w->line);
+			}
+			w->len = 0;
+		}
+		done += n;
+		queue_work(system_unbound_wq, &pt_replay_work);
+	}
+	return count;
+}
+
+static int pt_trace_release(struct inode *inode, struct file *file)
+{
+	struct pt_writer *w = file->private_data;
+
+	if (!(file->f_mode & FMODE_WRITE))
+		return single_release(inode, file);
+
+	if (w->len && w->len < PT_LINE_MAX) {
+		w->line[w->len] = '\0';
+		pt_queue_line(w->line);
+		queue_work(system_unbound_wq, &pt_replay_work);
+	}
+	kfree(w);
+	return 0;
+}
+
+static const struct file_operations pt_trace_fops = {
+	.open		= pt_trace_open,
+	.read		= seq_read,
+	.write		= pt_trace_write,
+	.llseek		= no_llseek,
+	.release	= pt_trace_release,
+};
+
+static int pt_record_show(struct seq_file *m, void *unused)
+{
+	mutex_lock(&pt_mutex);
+	seq_printf(m, "recording=%d tgid=%d files=%u ranges=%u dropped=%lu "
+		   "replayed_pages=%lu\n", pt_recording, pt_tgid, pt_nr_files,
+		   pt_nr_ranges, pt_dropped, pt_replayed);
+	mutex_unlock(&pt_mutex);
+	return 0;
+}
+
+static int pt_record_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, pt_record_show, NULL);
+}
+
+static ssize_t pt_record_write(struct file *file, const char __user *ubuf,
+			       size_t count, loff_t *ppos)
+{
+	unsigned int ms = PT_DEF_WINDOW_MS;
+	char buf[48], cmd[8];
+	int tgid = 0, ret, n;
+
+	if (count >= sizeof(buf))
+		return -EINVAL;
+	if (copy_from_user(buf, ubuf, count))
+		return -EFAULT;
+	buf[count] = '\0';
+
+	n = sscanf(buf, "%7s %d %u", cmd, &tgid, &ms);
+	if (n < 1)
+		return -EINVAL;
+
+	if (!strcmp(cmd, "start")) {
+		if (tgid < 0)
+			return -EINVAL;
+		ret = pt_record_start(tgid, ms);
+	} else if (!strcmp(cmd, "stop")) {
+		cancel_delayed_work_sync(&pt_stop_work);
+		mutex_lock(&pt_mutex);
+		pt_stop();
+		mutex_unlock(&pt_mutex);
+		ret = 0;
+	} else {
+		ret = -EINVAL;
+	}
+	return ret ? ret : count;
+}
+
+static const struct file_operations pt_record_fops = {
+	.open		= pt_record_open,
+	.read		= seq_read,
+	.write		= pt_record_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init prefetch_trace_init(void)
+{
+	struct dentry *dir;
+
+	dir = debugfs_create_dir("prefetch_trace", NULL);
+	if (IS_ERR_OR_NULL(dir))
+		return -ENODEV;
+
+	debugfs_create_file("record", 0600, dir, NULL, &pt_record_fops);
+	debugfs_create_file("trace", 0600, dir, NULL, &pt_trace_fops);
+
+	if (pt_boot_ms && pt_record_start(0, pt_boot_ms))
+		pr_err("boot recording failed\n");
+	return 0;
+}
+late_initcall(prefetch_trace_init);
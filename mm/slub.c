@@ -33,6 +33,7 @@
 #include <linux/stacktrace.h>
 #include <linux/prefetch.h>
 #include <linux/memcontrol.h>
+#include <linux/jump_label.h>
 
 #include <trace/events/kmem.h>
 
@@ -229,6 +230,20 @@ static inline void stat(const struct kmem_cache *s, enum stat_item si)
 #endif
 }
 
+#ifdef CONFIG_SLUB_PATH_STATS
+/* Number of caches with path_stats set */
+static struct static_key slub_path_stats_key = STATIC_KEY_INIT_FALSE;
+#endif
+
+static inline void path_stat(const struct kmem_cache *s,
+				enum path_stat_item si)
+{
+#ifdef CONFIG_SLUB_PATH_STATS
+	if (static_key_false(&slub_path_stats_key) && s->path_stats)
+		__this_cpu_inc(s->cpu_slab->path_stat[si]);
+#endif
+}
+
 /********************************************************************
  * 			Core slab cache functions
  *******************************************************************/
@@ -1609,6 +1624,7 @@ static void *get_partial_node(struct kmem_cache *s, struct kmem_cache_node *n,
 	if (!n || !n->nr_partial)
 		return NULL;
 
+	path_stat(s, PATH_NODE_LOCK);
 	spin_lock(&n->list_lock);
 	list_for_each_entry_safe(page, page2, &n->partial, lru) {
 		void *t;
@@ -1875,6 +1891,7 @@ redo:
 			 * that acquire_slab() will see a slab page that
 			 * is frozen
 			 */
+			path_stat(s, PATH_NODE_LOCK);
 			spin_lock(&n->list_lock);
 		}
 	} else {
@@ -1886,6 +1903,7 @@ redo:
 			 * slabs from diagnostic functions will not see
 			 * any frozen slabs.
 			 */
+			path_stat(s, PATH_NODE_LOCK);
 			spin_lock(&n->list_lock);
 		}
 	}
@@ -1955,6 +1973,7 @@ static void unfreeze_partials(struct kmem_cache *s,
 				spin_unlock(&n->list_lock);
 
 			n = n2;
+			path_stat(s, PATH_NODE_LOCK);
 			spin_lock(&n->list_lock);
 		}
 
@@ -2032,6 +2051,7 @@ static void put_cpu_partial(struct kmem_cache *s, struct page *page, int drain)
 				pobjects = 0;
 				pages = 0;
 				stat(s, CPU_PARTIAL_DRAIN);
+				path_stat(s, PATH_PARTIAL_DRAIN);
 			}
 		}
 
@@ -2308,6 +2328,7 @@ redo:
 		goto load_freelist;
 
 	stat(s, ALLOC_SLOWPATH);
+	path_stat(s, PATH_ALLOC_SLOW);
 
 	freelist = get_freelist(s, page);
 
@@ -2442,6 +2463,7 @@ redo:
 		}
 		prefetch_freepointer(s, next_object);
 		stat(s, ALLOC_FASTPATH);
+		path_stat(s, PATH_ALLOC_FAST);
 	}
 
 	if (unlikely(gfpflags & __GFP_ZERO) && object)
@@ -2533,6 +2555,7 @@ static void __slab_free(struct kmem_cache *s, struct page *page,
 	unsigned long uninitialized_var(flags);
 
 	stat(s, FREE_SLOWPATH);
+	path_stat(s, PATH_FREE_SLOW);
 
 	if (kmem_cache_debug(s) &&
 		!(n = free_debug_processing(s, page, x, addr, &flags)))
@@ -2570,6 +2593,7 @@ static void __slab_free(struct kmem_cache *s, struct page *page,
 				 * Otherwise the list_lock will synchronize with
 				 * other processors updating the list of slabs.
 				 */
+				path_stat(s, PATH_NODE_LOCK);
 				spin_lock_irqsave(&n->list_lock, flags);
 
 			}
@@ -2675,6 +2699,7 @@ redo:
 			goto redo;
 		}
 		stat(s, FREE_FASTPATH);
+		path_stat(s, PATH_FREE_FAST);
 	} else
 		__slab_free(s, page, x, addr);
 
@@ -2719,6 +2744,12 @@ static int slub_min_objects;
  */
 static int slub_nomerge;
 
+/*
+ * Per cache override of the cpu_partial default, as a list of
+ * name:objects pairs, e.g. slub_cpu_partial=dentry:60,skbuff_head_cache:60
+ */
+static char *slub_cpu_partial_str;
+
 /*
  * Calculate the order of allocation given an slab object size.
  *
@@ -3062,6 +3093,22 @@ static int calculate_sizes(struct kmem_cache *s, int forced_order)
 	return !!oo_objects(s->oo);
 }
 
+static void set_cpu_partial_override(struct kmem_cache *s)
+{
+	const char *p = slub_cpu_partial_str;
+	size_t len = strlen(s->name);
+
+	while (p && *p) {
+		if (!strncmp(p, s->name, len) && p[len] == ':') {
+			s->cpu_partial = simple_strtoul(p + len + 1, NULL, 10);
+			return;
+		}
+		p = strchr(p, ',');
+		if (p)
+			p++;
+	}
+}
+
 static int kmem_cache_open(struct kmem_cache *s, unsigned long flags)
 {
 	s->flags = kmem_cache_flags(s->size, flags, s->name, s->ctor);
@@ -3126,6 +3173,9 @@ static int kmem_cache_open(struct kmem_cache *s, unsigned long flags)
 	else
 		s->cpu_partial = 30;
 
+	if (!kmem_cache_debug(s))
+		set_cpu_partial_override(s);
+
 #ifdef CONFIG_NUMA
 	s->remote_node_defrag_ratio = 1000;
 #endif
@@ -3274,6 +3324,14 @@ static int __init setup_slub_nomerge(char *str)
 
 __setup("slub_nomerge", setup_slub_nomerge);
 
+static int __init setup_slub_cpu_partial(char *str)
+{
+	slub_cpu_partial_str = str;
+	return 1;
+}
+
+__setup("slub_cpu_partial=", setup_slub_cpu_partial);
+
 void *__kmalloc(size_t size, gfp_t flags)
 {
 	struct kmem_cache *s;
@@ -4529,6 +4587,53 @@ static ssize_t cpu_partial_store(struct kmem_cache *s, const char *buf,
 }
 SLAB_ATTR(cpu_partial);
 
+#ifdef CONFIG_SLUB_PATH_STATS
+static ssize_t path_stats_show(struct kmem_cache *s, char *buf)
+{
+	unsigned long sum[NR_SLUB_PATH_ITEMS] = { 0 };
+	int cpu, si;
+
+	for_each_online_cpu(cpu)
+		for (si = 0; si < NR_SLUB_PATH_ITEMS; si++)
+			sum[si] += per_cpu_ptr(s->cpu_slab, cpu)->path_stat[si];
+
+	return sprintf(buf, "enabled=%d alloc_fast=%lu alloc_slow=%lu "
+		"free_fast=%lu free_slow=%lu node_lock=%lu partial_drain=%lu\n",
+		s->path_stats, sum[PATH_ALLOC_FAST], sum[PATH_ALLOC_SLOW],
+		sum[PATH_FREE_FAST], sum[PATH_FREE_SLOW], sum[PATH_NODE_LOCK],
+		sum[PATH_PARTIAL_DRAIN]);
+}
+
+/* 1 starts counting, 0 stops and clears the counters */
+static ssize_t path_stats_store(struct kmem_cache *s, const char *buf,
+				size_t length)
+{
+	static DEFINE_MUTEX(path_stats_mutex);
+	unsigned long enable;
+	int cpu, err;
+
+	err = kstrtoul(buf, 10, &enable);
+	if (err)
+		return err;
+
+	mutex_lock(&path_stats_mutex);
+	if (enable && !s->path_stats) {
+		s->path_stats = 1;
+		static_key_slow_inc(&slub_path_stats_key);
+	} else if (!enable && s->path_stats) {
+		s->path_stats = 0;
+		static_key_slow_dec(&slub_path_stats_key);
+	}
+	if (!enable)
+		for_each_online_cpu(cpu)
+			memset(per_cpu_ptr(s->cpu_slab, cpu)->path_stat, 0,
+			       NR_SLUB_PATH_ITEMS * sizeof(unsigned));
+	mutex_unlock(&path_stats_mutex);
+	return length;
+}
+SLAB_ATTR(path_stats);
+#endif
+
 static ssize_t ctor_show(struct kmem_cache *s, char *buf)
 {
 	if (!s->ctor)
@@ -4935,6 +5040,9 @@ static struct attribute *slab_attrs[] = {
 	&order_attr.attr,
 	&min_partial_attr.attr,
 	&cpu_partial_attr.attr,
+#ifdef CONFIG_SLUB_PATH_STATS
+	&path_stats_attr.attr,
+#endif
 	&objects_attr.attr,
 	&objects_partial_attr.attr,
 	&partial_attr.attr,
@@ -42,6 +42,21 @@ static DEFINE_PER_CPU(struct pagevec[NR_LRU_LISTS], lru_add_pvecs);
 static DEFINE_PER_CPU(struct pagevec, lru_rotate_pvecs);
 static DEFINE_PER_CPU(struct pagevec, lru_deactivate_pvecs);
 
+/*
+ * Readahead adds a whole window of file pages at a time. Batch those in a
+ * larger vector than a pagevec, so a launch storm takes the lru_lock once
+ * per LRU_ADD_BATCH pages rather than once per PAGEVEC_SIZE.
+ */
+#define LRU_ADD_BATCH	64
+
+struct lru_add_batch {
+	unsigned int nr;
+	struct page *pages[LRU_ADD_BATCH];
+};
+static DEFINE_PER_CPU(struct lru_add_batch, lru_add_file_batch);
+
+static void lru_add_batch_drain(struct lru_add_batch *batch);
+
 /*
  * This path almost never happens for VM activity - pages are normally
  * freed via pagevecs.  But it gets used by networking.
@@ -339,7 +354,7 @@ int get_kernel_page(unsigned long start, int write, struct page **pages)
 }
 EXPORT_SYMBOL_GPL(get_kernel_page);
 
-static void pagevec_lru_move_fn(struct pagevec *pvec,
+static void lru_move_pages_fn(struct page **pages, int nr, int cold,
 	void (*move_fn)(struct page *page, struct lruvec *lruvec, void *arg),
 	void *arg)
 {
@@ -348,8 +363,8 @@ static void pagevec_lru_move_fn(struct pagevec *pvec,
 	struct lruvec *lruvec;
 	unsigned long flags = 0;
 
-	for (i = 0; i < pagevec_count(pvec); i++) {
-		struct page *page = pvec->pages[i];
+	for (i = 0; i < nr; i++) {
+		struct page *page = pages[i];
 		struct zone *pagezone = page_zone(page);
 
 		if (pagezone != zone) {
@@ -364,7 +379,14 @@ static void pagevec_lru_move_fn(struct pagevec *pvec,
 	}
 	if (zone)
 		spin_unlock_irqrestore(&zone->lru_lock, flags);
-	release_pages(pvec->pages, pvec->nr, pvec->cold);
+	release_pages(pages, nr, cold);
+}
+
+static void pagevec_lru_move_fn(struct pagevec *pvec,
+	void (*move_fn)(struct page *page, struct lruvec *lruvec, void *arg),
+	void *arg)
+{
+	lru_move_pages_fn(pvec->pages, pvec->nr, pvec->cold, move_fn, arg);
 	pagevec_reinit(pvec);
 }
 
@@ -517,6 +539,25 @@ void __lru_cache_add(struct page *page, enum lru_list lru)
 }
 EXPORT_SYMBOL(__lru_cache_add);
 
+/**
+ * lru_cache_add_file_batch - add a readahead page to the inactive file list
+ * @page: the page to be added to the LRU.
+ *
+ * Like lru_cache_add_file(), but through the larger per cpu batch that
+ * readahead uses.
+ */
+void lru_cache_add_file_batch(struct page *page)
+{
+	struct lru_add_batch *batch = &get_cpu_var(lru_add_file_batch);
+
+	page_cache_get(page);
+	if (batch->nr == LRU_ADD_BATCH)
+		lru_add_batch_drain(batch);
+	batch->pages[batch->nr++] = page;
+	put_cpu_var(lru_add_file_batch);
+}
+EXPORT_SYMBOL(lru_cache_add_file_batch);
+
 /**
  * lru_cache_add_lru - add a page to a page list
  * @page: the page to be added to the LRU.
@@ -643,6 +684,8 @@ void lru_add_drain_cpu(int cpu)
 			__pagevec_lru_add(pvec, lru);
 	}
 
+	lru_add_batch_drain(&per_cpu(lru_add_file_batch, cpu));
+
 	pvec = &per_cpu(lru_rotate_pvecs, cpu);
 	if (pagevec_count(pvec)) {
 		unsigned long flags;
@@ -860,6 +903,15 @@ static void __pagevec_lru_add_fn(struct page *page, struct lruvec *lruvec,
 	update_page_reclaim_stat(lruvec, file, active);
 }
 
+static void lru_add_batch_drain(struct lru_add_batch *batch)
+{
+	if (!batch->nr)
+		return;
+	lru_move_pages_fn(batch->pages, batch->nr, 0, __pagevec_lru_add_fn,
+			  (void *)LRU_INACTIVE_FILE);
+	batch->nr = 0;
+}
+
 /*
  * Add the passed pages to the LRU, then drop the caller's refcount
  * on them.  Reinitialises the caller's pagevec.
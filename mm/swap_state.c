@@ -53,6 +53,9 @@ static struct {
 	unsigned long find_total;
 } swap_cache_info;
 
+/* readahead pages faulted in since the last readahead window was sized */
+static atomic_t swapin_readahead_hits = ATOMIC_INIT(4);
+
 unsigned long total_swapcache_pages(void)
 {
 	int i;
@@ -153,6 +156,9 @@ void __delete_from_swap_cache(struct page *page)
 	__dec_zone_page_state(page, NR_FILE_PAGES);
 	__dec_zone_page_state(page, NR_SWAPCACHE);
 	INC_CACHE_INFO(del_total);
+	/* read ahead and dropped again without ever being faulted in */
+	if (TestClearPageReadahead(page))
+		__count_vm_event(SWAP_RA_MISS);
 }
 
 /**
@@ -288,8 +294,13 @@ struct page * lookup_swap_cache(swp_entry_t entry)
 
 	page = find_get_page(swap_address_space(entry), entry.val);
 
-	if (page)
+	if (page) {
 		INC_CACHE_INFO(find_success);
+		if (TestClearPageReadahead(page)) {
+			count_vm_event(SWAP_RA_HIT);
+			atomic_inc(&swapin_readahead_hits);
+		}
+	}
 
 	INC_CACHE_INFO(find_total);
 	return page;
@@ -301,12 +312,15 @@ struct page * lookup_swap_cache(swp_entry_t entry)
  * A failure return means that either the page allocation failed or that
  * the swap entry is no longer in use.
  */
-struct page *read_swap_cache_async(swp_entry_t entry, gfp_t gfp_mask,
-			struct vm_area_struct *vma, unsigned long addr)
+static struct page *__read_swap_cache_async(swp_entry_t entry, gfp_t gfp_mask,
+			struct vm_area_struct *vma, unsigned long addr,
+			bool *new_page_allocated)
 {
 	struct page *found_page, *new_page = NULL;
 	int err;
 
+	*new_page_allocated = false;
+
 	do {
 		/*
 		 * First check the swap cache.  Since this is normally
@@ -374,6 +388,7 @@ struct page *read_swap_cache_async(swp_entry_t entry, gfp_t gfp_mask,
 			 */
 			lru_cache_add_anon(new_page);
 			swap_readpage(new_page);
+			*new_page_allocated = true;
 			return new_page;
 		}
 		radix_tree_preload_end();
@@ -391,6 +406,74 @@ struct page *read_swap_cache_async(swp_entry_t entry, gfp_t gfp_mask,
 	return found_page;
 }
 
+struct page *read_swap_cache_async(swp_entry_t entry, gfp_t gfp_mask,
+			struct vm_area_struct *vma, unsigned long addr)
+{
+	bool page_allocated;
+
+	return __read_swap_cache_async(entry, gfp_mask, vma, addr,
+				       &page_allocated);
+}
+
+/*
+ * Readahead window sizing: every readahead page that is faulted in before
+ * it is reclaimed is counted in swapin_readahead_hits. The next window is
+ * grown to cover those hits, and shrinks by at most half per readahead so
+ * a short gap in a sequential pattern does not collapse it. Without hits
+ * only a fault next to the previous one reads ahead at all.
+ */
+static unsigned long swapin_nr_pages(unsigned long offset)
+{
+	static unsigned long prev_offset;
+	static atomic_t last_readahead_pages;
+	unsigned int pages, max_pages, last_ra;
+
+	max_pages = 1 << ACCESS_ONCE(page_cluster);
+	if (max_pages <= 1)
+		return 1;
+
+	pages = atomic_xchg(&swapin_readahead_hits, 0) + 2;
+	if (pages == 2) {
+		if (offset != prev_offset + 1 && offset != prev_offset - 1)
+			pages = 1;
+		prev_offset = offset;
+	} else {
+		unsigned int roundup = 4;
+
+		while (roundup < pages)
+			roundup <<= 1;
+		pages = roundup;
+	}
+
+	if (pages > max_pages)
+		pages = max_pages;
+
+	last_ra = atomic_read(&last_readahead_pages) / 2;
+	if (pages < last_ra)
+		pages = last_ra;
+	atomic_set(&last_readahead_pages, pages);
+
+	return pages;
+}
+
+static void swap_ra_page(swp_entry_t entry, gfp_t gfp_mask,
+			 struct vm_area_struct *vma, unsigned long addr,
+			 bool readahead)
+{
+	struct page *page;
+	bool page_allocated;
+
+	page = __read_swap_cache_async(entry, gfp_mask, vma, addr,
+				       &page_allocated);
+	if (!page)
+		return;
+	if (page_allocated && readahead) {
+		SetPageReadahead(page);
+		count_vm_event(SWAP_RA);
+	}
+	page_cache_release(page);
+}
+
 /**
  * swapin_readahead - swap in pages in hope we need them soon
  * @entry: swap entry of this memory
@@ -401,10 +484,13 @@ struct page *read_swap_cache_async(swp_entry_t entry, gfp_t gfp_mask,
  * Returns the struct page for entry and addr, after queueing swapin.
  *
  * Primitive swap readahead code. We simply read an aligned block of
- * (1 << page_cluster) entries in the swap area. This method is chosen
+ * up to (1 << page_cluster) entries in the swap area. This method is chosen
  * because it doesn't cost us any seek time.  We also make sure to queue
  * the 'original' request together with the readahead ones...
  *
+ * RAM backed swap devices (SWP_FAST, e.g. zram) get no readahead: a read
+ * costs a decompression, not a seek, so only the page asked for is read.
+ *
  * This has been extended to use the NUMA policies from the mm triggering
  * the readahead.
  *
@@ -413,14 +499,20 @@ struct page *read_swap_cache_async(swp_entry_t entry, gfp_t gfp_mask,
 struct page *swapin_readahead(swp_entry_t entry, gfp_t gfp_mask,
 			struct vm_area_struct *vma, unsigned long addr)
 {
-	struct page *page;
-	unsigned long offset = swp_offset(entry);
+	unsigned long entry_offset = swp_offset(entry);
+	unsigned long offset = entry_offset;
 	unsigned long start_offset, end_offset;
-	unsigned long mask = is_swap_fast(entry) ? 0 :
-				(1UL << page_cluster) - 1;
+	unsigned long mask;
 	struct blk_plug plug;
 
-	/* Read a page_cluster sized and aligned cluster around offset. */
+	if (is_swap_fast(entry))
+		goto skip;
+
+	mask = swapin_nr_pages(offset) - 1;
+	if (!mask)
+		goto skip;
+
+	/* Read a window sized and aligned cluster around offset. */
 	start_offset = offset & ~mask;
 	end_offset = offset | mask;
 	if (!start_offset)	/* First page is swap header. */
@@ -429,14 +521,86 @@ struct page *swapin_readahead(swp_entry_t entry, gfp_t gfp_mask,
 	blk_start_plug(&plug);
 	for (offset = start_offset; offset <= end_offset ; offset++) {
 		/* Ok, do the async read-ahead now */
-		page = read_swap_cache_async(swp_entry(swp_type(entry), offset),
-						gfp_mask, vma, addr);
-		if (!page)
-			continue;
-		page_cache_release(page);
+		swap_ra_page(swp_entry(swp_type(entry), offset),
+			     gfp_mask, vma, addr, offset != entry_offset);
 	}
 	blk_finish_plug(&plug);
 
 	lru_add_drain();	/* Push any new pages onto the LRU now */
+skip:
 	return read_swap_cache_async(entry, gfp_mask, vma, addr);
 }
+
+#define SWAP_RA_VMA_MAX		16
+
+/**
+ * swap_vma_readahead - swap in the neighbours of a faulting address
+ * @fentry: swap entry of the faulting pte
+ * @gfp_mask: memory allocation flags
+ * @vma: user vma the fault is in
+ * @addr: faulting address
+ * @pmd: pmd covering @addr
+ *
+ * Returns the struct page for @fentry, after queueing swapin.
+ *
+ * Swapped out neighbours of a page in the address space are often not
+ * neighbours in the swap area, as reclaim writes pages out in LRU order.
+ * Instead of the swap slots around @fentry, read the swap entries of the
+ * ptes in an aligned window around @addr, clipped to @vma, so readahead
+ * follows the access pattern of the task. The window is sized like the
+ * one of swapin_readahead(), from the readahead hits.
+ *
+ * RAM backed swap devices get no readahead, see swapin_readahead().
+ *
+ * Caller must hold down_read on the vma->vm_mm.
+ */
+struct page *swap_vma_readahead(swp_entry_t fentry, gfp_t gfp_mask,
+			struct vm_area_struct *vma, unsigned long addr,
+			pmd_t *pmd)
+{
+	pte_t ptes[SWAP_RA_VMA_MAX], *pte;
+	unsigned long start, end, win, ra_addr;
+	swp_entry_t entry;
+	struct blk_plug plug;
+	int i, nr;
+
+	if (is_swap_fast(fentry))
+		goto skip;
+
+	win = min_t(unsigned long, swapin_nr_pages(addr >> PAGE_SHIFT),
+		    SWAP_RA_VMA_MAX);
+	if (win <= 1)
+		goto skip;
+
+	/* the window is smaller than a pmd, so one pte table covers it */
+	start = addr & ~(win * PAGE_SIZE - 1);
+	end = start + win * PAGE_SIZE;
+	start = max(start, vma->vm_start);
+	end = min(end, vma->vm_end);
+	nr = (end - start) >> PAGE_SHIFT;
+
+	/* pte table is mapped atomically, copy the entries out first */
+	pte = pte_offset_map(pmd, start);
+	for (i = 0; i < nr; i++)
+		ptes[i] = pte[i];
+	pte_unmap(pte);
+
+	blk_start_plug(&plug);
+	for (i = 0, ra_addr = start; i < nr; i++, ra_addr += PAGE_SIZE) {
+		if (ra_addr == (addr & PAGE_MASK)) {
+			swap_ra_page(fentry, gfp_mask, vma, addr, false);
+			continue;
+		}
+		if (!is_swap_pte(ptes[i]))
+			continue;
+		entry = pte_to_swp_entry(ptes[i]);
+		if (unlikely(non_swap_entry(entry)) || is_swap_fast(entry))
+			continue;
+		swap_ra_page(entry, gfp_mask, vma, ra_addr, true);
+	}
+	blk_finish_plug(&plug);
+
+	lru_add_drain();	/* Push any new pages onto the LRU now */
+skip:
+	return read_swap_cache_async(fentry, gfp_mask, vma, addr);
+}
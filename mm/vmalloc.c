@@ -695,18 +695,32 @@ static void vmap_debug_free_range(unsigned long start, unsigned long end)
  * a less aggressive log scale. It will still be an improvement over the old
  * code, and it will be simple to change the scale factor if we find that it
  * becomes a problem on bigger systems.
+ *
+ * With a 64 bit address space the vmalloc area is large enough to scale
+ * linearly. The purge flush is broadcast to every CPU, and on phones the
+ * frequent small vmaps of GPU, ion and camera buffers otherwise purge
+ * several times a second.
  */
 static unsigned long lazy_max_pages(void)
 {
-	unsigned int log;
+	unsigned int scale;
 
-	log = fls(num_online_cpus());
+#ifdef CONFIG_64BIT
+	scale = num_online_cpus();
+#else
+	scale = fls(num_online_cpus());
+#endif
 
-	return log * (32UL * 1024 * 1024 / PAGE_SIZE);
+	return scale * (32UL * 1024 * 1024 / PAGE_SIZE);
 }
 
 static atomic_t vmap_lazy_nr = ATOMIC_INIT(0);
 
+/* Purge statistics for /proc/vmallocinfo, under purge_lock */
+static unsigned long vmap_purge_nr;
+static unsigned long vmap_purge_pages;
+static unsigned long vmap_purge_flushes;
+
 /* for per-CPU blocks */
 static void purge_fragmented_blocks_allcpus(void);
 
@@ -767,11 +781,16 @@ static void __purge_vmap_area_lazy(unsigned long *start, unsigned long *end,
 	}
 	rcu_read_unlock();
 
-	if (nr)
+	if (nr) {
 		atomic_sub(nr, &vmap_lazy_nr);
+		vmap_purge_nr++;
+		vmap_purge_pages += nr;
+	}
 
-	if (nr || force_flush)
+	if (nr || force_flush) {
 		flush_tlb_kernel_range(*start, *end);
+		vmap_purge_flushes++;
+	}
 
 	if (nr) {
 		spin_lock(&vmap_area_lock);
@@ -2779,11 +2798,22 @@ static void show_numa_info(struct seq_file *m, struct vm_struct *v)
 	}
 }
 
+static void show_purge_info(struct seq_file *m)
+{
+	seq_printf(m, "lazy purges=%lu purged_pages=%lu flushes=%lu "
+		   "lazy_pages=%d lazy_max_pages=%lu\n", vmap_purge_nr,
+		   vmap_purge_pages, vmap_purge_flushes,
+		   atomic_read(&vmap_lazy_nr), lazy_max_pages());
+}
+
 static int s_show(struct seq_file *m, void *p)
 {
 	struct vmap_area *va = p;
 	struct vm_struct *v;
 
+	if (list_is_last(&va->list, &vmap_area_list))
+		show_purge_info(m);
+
 	/*
 	 * s_show can encounter race with remove_vm_area, !VM_VM_AREA on
 	 * behalf of vmap area is being tear down or vm_map_ram allocation.
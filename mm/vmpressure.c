@@ -25,6 +25,9 @@
 #include <linux/init.h>
 #include <linux/module.h>
 #include <linux/vmpressure.h>
+#include <linux/ktime.h>
+#include <linux/seq_file.h>
+#include <linux/memcontrol.h>
 
 /*
  * The window size (vmpressure_win) is the number of scanned pages before
@@ -200,6 +203,10 @@ static unsigned long vmpressure_account_stall(unsigned long pressure,
 struct vmpressure_event {
 	struct eventfd_ctx *efd;
 	enum vmpressure_levels level;
+	/* stall events: threshold in percent << FSHIFT, over stall_avg[] */
+	bool stall;
+	unsigned long stall_threshold;
+	int stall_window;
 	struct list_head node;
 };
 
@@ -217,6 +224,8 @@ static bool vmpressure_event(struct vmpressure *vmpr,
 	mutex_lock(&vmpr->events_lock);
 
 	list_for_each_entry(ev, &vmpr->events, node) {
+		if (ev->stall)
+			continue;
 		if (level >= ev->level) {
 			eventfd_signal(ev->efd, 1);
 			signalled = true;
@@ -425,6 +434,198 @@ void vmpressure_prio(gfp_t gfp, struct mem_cgroup *memcg, int prio)
 	vmpressure(gfp, memcg, vmpressure_win, 0);
 }
 
+/*
+ * Stall tracking: the time during which at least one task of a group is
+ * stalled in direct reclaim or direct compaction (including memcg limit
+ * reclaim), folded every VMPRESSURE_STALL_PERIOD into running averages
+ * over 10 and 60 seconds, the same way the load average is computed.
+ * Unlike the scanned/reclaimed ratio, this tells how much time tasks
+ * actually lose waiting for memory, however efficient reclaim is.
+ */
+#define VMPRESSURE_STALL_PERIOD		(2 * NSEC_PER_SEC)
+#define VMPRESSURE_STALL_EXP_10S	1677	/* 1/exp(2s/10s) */
+#define VMPRESSURE_STALL_EXP_60S	1981	/* 1/exp(2s/60s) */
+/* after this many idle periods both averages are down to zero anyway */
+#define VMPRESSURE_STALL_MISSED_MAX	150
+
+#define LOAD_INT(x) ((x) >> FSHIFT)
+#define LOAD_FRAC(x) LOAD_INT(((x) & (FIXED_1-1)) * 100)
+
+static const unsigned long vmpressure_stall_exp[] = {
+	VMPRESSURE_STALL_EXP_10S,
+	VMPRESSURE_STALL_EXP_60S,
+};
+
+/*
+ * Close the stall periods that ended before @now. Returns true if any did.
+ * Caller holds sr_lock.
+ */
+static bool vmpressure_stall_update(struct vmpressure *vmpr, u64 now)
+{
+	u64 periods, sample;
+	int i, n;
+
+	if (vmpr->nr_stalling) {
+		vmpr->stall_period += now - vmpr->stall_start;
+		vmpr->stall_start = now;
+	}
+	if (now < vmpr->period_end)
+		return false;
+
+	/* spread what was accumulated evenly over the elapsed periods */
+	periods = div64_u64(now - vmpr->period_end,
+			    VMPRESSURE_STALL_PERIOD) + 1;
+	sample = div64_u64(vmpr->stall_period * (100 * FIXED_1),
+			   periods * VMPRESSURE_STALL_PERIOD);
+	sample = min_t(u64, sample, 100 * FIXED_1);
+
+	n = min_t(u64, periods, VMPRESSURE_STALL_MISSED_MAX);
+	while (n--) {
+		for (i = 0; i < ARRAY_SIZE(vmpr->stall_avg); i++)
+			vmpr->stall_avg[i] = (vmpr->stall_avg[i] *
+					vmpressure_stall_exp[i] +
+					sample * (FIXED_1 -
+					vmpressure_stall_exp[i])) >> FSHIFT;
+	}
+
+	vmpr->stall_total += vmpr->stall_period;
+	vmpr->stall_period = 0;
+	vmpr->period_end += periods * VMPRESSURE_STALL_PERIOD;
+	return true;
+}
+
+/*
+ * Signal the stall events of @vmpr whose threshold is reached. Called in
+ * process context by the stalling tasks themselves, at most once per
+ * closed stall period, so it needs no work item of its own.
+ */
+static void vmpressure_stall_events(struct vmpressure *vmpr)
+{
+	struct vmpressure_event *ev;
+	unsigned long avg[ARRAY_SIZE(vmpr->stall_avg)];
+
+	spin_lock(&vmpr->sr_lock);
+	memcpy(avg, vmpr->stall_avg, sizeof(avg));
+	spin_unlock(&vmpr->sr_lock);
+
+	mutex_lock(&vmpr->events_lock);
+	list_for_each_entry(ev, &vmpr->events, node) {
+		if (ev->stall && avg[ev->stall_window] >= ev->stall_threshold)
+			eventfd_signal(ev->efd, 1);
+	}
+	mutex_unlock(&vmpr->events_lock);
+}
+
+#ifdef CONFIG_MEMCG
+static void vmpressure_stall_account(struct vmpressure *vmpr, bool begin)
+{
+	u64 now = ktime_to_ns(ktime_get());
+	bool closed;
+
+	spin_lock(&vmpr->sr_lock);
+	closed = vmpressure_stall_update(vmpr, now);
+	if (begin) {
+		if (!vmpr->nr_stalling++)
+			vmpr->stall_start = now;
+	} else if (vmpr->nr_stalling) {
+		vmpr->nr_stalling--;
+	}
+	spin_unlock(&vmpr->sr_lock);
+
+	if (closed)
+		vmpressure_stall_events(vmpr);
+}
+
+/**
+ * vmpressure_stall_begin() - Account the start of a memory stall
+ *
+ * To be called by the current task before it enters direct reclaim or
+ * direct compaction. The stall is accounted to the memory cgroup of the
+ * task and its ancestors.
+ *
+ * Returns the memory cgroup to pass to vmpressure_stall_end().
+ */
+struct mem_cgroup *vmpressure_stall_begin(void)
+{
+	struct mem_cgroup *memcg, *iter;
+
+	if (mem_cgroup_disabled() || !current->mm)
+		return NULL;
+
+	memcg = try_get_mem_cgroup_from_mm(current->mm);
+	for (iter = memcg; iter; iter = parent_mem_cgroup(iter))
+		vmpressure_stall_account(memcg_to_vmpressure(iter), true);
+	return memcg;
+}
+
+/**
+ * vmpressure_stall_end() - Account the end of a memory stall
+ * @memcg:	the value returned by vmpressure_stall_begin()
+ */
+void vmpressure_stall_end(struct mem_cgroup *memcg)
+{
+	struct mem_cgroup *iter;
+
+	if (!memcg)
+		return;
+
+	for (iter = memcg; iter; iter = parent_mem_cgroup(iter))
+		vmpressure_stall_account(memcg_to_vmpressure(iter), false);
+	css_put(mem_cgroup_css(memcg));
+}
+#endif /* CONFIG_MEMCG */
+
+/**
+ * vmpressure_stall_show() - Show the stall averages of a cgroup
+ * @cg:		cgroup handle
+ * @cft:	cgroup control files handle
+ * @m:		seq_file to print to
+ *
+ * Prints the share of wall time during which some task of the cgroup was
+ * stalled on memory, averaged over 10 and 60 seconds, and the total stall
+ * time in microseconds.
+ */
+int vmpressure_stall_show(struct cgroup *cg, struct cftype *cft,
+			  struct seq_file *m)
+{
+	struct vmpressure *vmpr = cg_to_vmpressure(cg);
+	unsigned long avg10, avg60;
+	bool closed;
+	u64 total;
+
+	spin_lock(&vmpr->sr_lock);
+	closed = vmpressure_stall_update(vmpr, ktime_to_ns(ktime_get()));
+	avg10 = vmpr->stall_avg[0];
+	avg60 = vmpr->stall_avg[1];
+	total = vmpr->stall_total + vmpr->stall_period;
+	spin_unlock(&vmpr->sr_lock);
+
+	if (closed)
+		vmpressure_stall_events(vmpr);
+
+	seq_printf(m, "avg10=%lu.%02lu avg60=%lu.%02lu total=%llu\n",
+		   LOAD_INT(avg10), LOAD_FRAC(avg10),
+		   LOAD_INT(avg60), LOAD_FRAC(avg60),
+		   (unsigned long long)div_u64(total, NSEC_PER_USEC));
+	return 0;
+}
+
+static int vmpressure_parse_stall(struct vmpressure_event *ev,
+				  const char *args)
+{
+	unsigned int threshold, window;
+
+	if (sscanf(args, "stall %u %u", &threshold, &window) != 2)
+		return -EINVAL;
+	if (!threshold || threshold > 100 || (window != 10 && window != 60))
+		return -EINVAL;
+
+	ev->stall = true;
+	ev->stall_threshold = threshold * FIXED_1;
+	ev->stall_window = window == 60;
+	return 0;
+}
+
 /**
  * vmpressure_register_event() - Bind vmpressure notifications to an eventfd
  * @cg:		cgroup that is interested in vmpressure notifications
@@ -436,7 +637,9 @@ void vmpressure_prio(gfp_t gfp, struct mem_cgroup *memcg, int prio)
  * infrastructure, so that the notifications will be delivered to the
  * @eventfd. The @args parameter is a string that denotes pressure level
  * threshold (one of vmpressure_str_levels, i.e. "low", "medium", or
- * "critical").
+ * "critical"), or "stall <percent> <10|60>" for a notification every
+ * VMPRESSURE_STALL_PERIOD while the 10s or 60s stall average is at or
+ * above <percent>.
  *
  * This function should not be used directly, just pass it to (struct
  * cftype).register_event, and then cgroup core will handle everything by
@@ -447,24 +650,34 @@ int vmpressure_register_event(struct cgroup *cg, struct cftype *cft,
 {
 	struct vmpressure *vmpr = cg_to_vmpressure(cg);
 	struct vmpressure_event *ev;
-	int level;
+	int level, ret;
 
 	BUG_ON(!vmpr);
 
-	for (level = 0; level < VMPRESSURE_NUM_LEVELS; level++) {
-		if (!strcmp(vmpressure_str_levels[level], args))
-			break;
-	}
-
-	if (level >= VMPRESSURE_NUM_LEVELS)
-		return -EINVAL;
-
 	ev = kzalloc(sizeof(*ev), GFP_KERNEL);
 	if (!ev)
 		return -ENOMEM;
 
+	if (!strncmp(args, "stall ", 6)) {
+		ret = vmpressure_parse_stall(ev, args);
+		if (ret) {
+			kfree(ev);
+			return ret;
+		}
+	} else {
+		for (level = 0; level < VMPRESSURE_NUM_LEVELS; level++) {
+			if (!strcmp(vmpressure_str_levels[level], args))
+				break;
+		}
+
+		if (level >= VMPRESSURE_NUM_LEVELS) {
+			kfree(ev);
+			return -EINVAL;
+		}
+		ev->level = level;
+	}
+
 	ev->efd = eventfd;
-	ev->level = level;
 
 	mutex_lock(&vmpr->events_lock);
 	list_add(&ev->node, &vmpr->events);
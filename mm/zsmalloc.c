@@ -69,6 +69,9 @@
 #include <linux/debugfs.h>
 #include <linux/zsmalloc.h>
 #include <linux/zpool.h>
+#include <linux/kthread.h>
+#include <linux/freezer.h>
+#include <linux/moduleparam.h>
 
 /*
  * This must be power of 2 and greater than of equal to sizeof(link_free).
@@ -174,16 +177,27 @@ enum zs_stat_type {
 	NR_ZS_STAT_TYPE,
 };
 
-#ifdef CONFIG_ZSMALLOC_STAT
-
-static struct dentry *zs_stat_root;
-
 struct zs_size_stat {
 	unsigned long objs[NR_ZS_STAT_TYPE];
 };
 
+#ifdef CONFIG_ZSMALLOC_STAT
+static struct dentry *zs_stat_root;
 #endif
 
+/*
+ * Background compaction kicks in once the pages that compaction could
+ * release exceed this percentage of the pages used by a pool. 0 disables
+ * the per-pool compaction thread's work entirely.
+ */
+static unsigned int zs_compact_watermark;
+module_param_named(compact_watermark, zs_compact_watermark, uint, 0644);
+MODULE_PARM_DESC(compact_watermark,
+	"Percentage of freeable pages that triggers background compaction");
+
+/* minimal interval between two fragmentation checks of a pool */
+#define ZS_COMPACTD_INTERVAL	(HZ)
+
 /*
  * number of size_classes
  */
@@ -218,9 +232,7 @@ struct size_class {
 	/* huge object: pages_per_zspage == 1 && maxobj_per_zspage == 1 */
 	bool huge;
 
-#ifdef CONFIG_ZSMALLOC_STAT
 	struct zs_size_stat stats;
-#endif
 
 	spinlock_t lock;
 
@@ -253,9 +265,14 @@ struct zs_pool {
 	struct size_class **size_class;
 	struct kmem_cache *handle_cachep;
 
-	gfp_t flags;	/* allocation flags used when growing pool */
 	atomic_long_t pages_allocated;
 
+	/* background compaction */
+	struct task_struct *compactd;
+	wait_queue_head_t compact_wait;
+	bool compact_requested;
+	unsigned long next_compact_check;	/* jiffies */
+
 #ifdef CONFIG_ZSMALLOC_STAT
 	struct dentry *stat_dentry;
 #endif
@@ -294,10 +311,10 @@ static void destroy_handle_cache(struct zs_pool *pool)
 		kmem_cache_destroy(pool->handle_cachep);
 }
 
-static unsigned long alloc_handle(struct zs_pool *pool)
+static unsigned long alloc_handle(struct zs_pool *pool, gfp_t gfp)
 {
 	return (unsigned long)kmem_cache_alloc(pool->handle_cachep,
-		pool->flags & ~__GFP_HIGHMEM);
+		gfp & ~__GFP_HIGHMEM);
 }
 
 static void free_handle(struct zs_pool *pool, unsigned long handle)
@@ -316,7 +333,7 @@ static void record_obj(unsigned long handle, unsigned long obj)
 
 static void *zs_zpool_create(char *name, gfp_t gfp, struct zpool_ops *zpool_ops)
 {
-	return zs_create_pool(name, gfp);
+	return zs_create_pool(name);
 }
 
 static void zs_zpool_destroy(void *pool)
@@ -327,7 +344,7 @@ static void zs_zpool_destroy(void *pool)
 static int zs_zpool_malloc(void *pool, size_t size, gfp_t gfp,
 			unsigned long *handle)
 {
-	*handle = zs_malloc(pool, size);
+	*handle = zs_malloc(pool, size, gfp);
 	return *handle ? 0 : -1;
 }
 static void zs_zpool_free(void *pool, unsigned long handle)
@@ -445,8 +462,6 @@ static int get_size_class_index(int size)
 	return min(zs_size_classes - 1, idx);
 }
 
-#ifdef CONFIG_ZSMALLOC_STAT
-
 static inline void zs_stat_inc(struct size_class *class,
 				enum zs_stat_type type, unsigned long cnt)
 {
@@ -465,6 +480,8 @@ static inline unsigned long zs_stat_get(struct size_class *class,
 	return class->stats.objs[type];
 }
 
+#ifdef CONFIG_ZSMALLOC_STAT
+
 static int __init zs_stat_init(void)
 {
 	if (!debugfs_initialized())
@@ -581,22 +598,6 @@ static void zs_pool_stat_destroy(struct zs_pool *pool)
 
 #else /* CONFIG_ZSMALLOC_STAT */
 
-static inline void zs_stat_inc(struct size_class *class,
-				enum zs_stat_type type, unsigned long cnt)
-{
-}
-
-static inline void zs_stat_dec(struct size_class *class,
-				enum zs_stat_type type, unsigned long cnt)
-{
-}
-
-static inline unsigned long zs_stat_get(struct size_class *class,
-				enum zs_stat_type type)
-{
-	return 0;
-}
-
 static int __init zs_stat_init(void)
 {
 	return 0;
@@ -1379,12 +1380,13 @@ static unsigned long obj_malloc(struct page *first_page,
  * zs_malloc - Allocate block of given size from pool.
  * @pool: pool to allocate from
  * @size: size of block to allocate
+ * @gfp: gfp flags when allocating object
  *
  * On success, handle to the allocated object is returned,
  * otherwise 0.
  * Allocation requests with size > ZS_MAX_ALLOC_SIZE will fail.
  */
-unsigned long zs_malloc(struct zs_pool *pool, size_t size)
+unsigned long zs_malloc(struct zs_pool *pool, size_t size, gfp_t gfp)
 {
 	unsigned long handle, obj;
 	struct size_class *class;
@@ -1393,7 +1395,7 @@ unsigned long zs_malloc(struct zs_pool *pool, size_t size)
 	if (unlikely(!size || size > ZS_MAX_ALLOC_SIZE))
 		return 0;
 
-	handle = alloc_handle(pool);
+	handle = alloc_handle(pool, gfp);
 	if (!handle)
 		return 0;
 
@@ -1406,7 +1408,7 @@ unsigned long zs_malloc(struct zs_pool *pool, size_t size)
 
 	if (!first_page) {
 		spin_unlock(&class->lock);
-		first_page = alloc_zspage(class, pool->flags);
+		first_page = alloc_zspage(class, gfp);
 		if (unlikely(!first_page)) {
 			free_handle(pool, handle);
 			return 0;
@@ -1463,6 +1465,25 @@ static void obj_free(struct zs_pool *pool, struct size_class *class,
 	zs_stat_dec(class, OBJ_USED, 1);
 }
 
+/*
+ * Called on frees that leave a zspage sparsely used, which is when
+ * fragmentation grows. The fragmentation check itself is left to the
+ * compaction thread and rate limited to once per ZS_COMPACTD_INTERVAL.
+ */
+static void zs_compactd_wakeup(struct zs_pool *pool)
+{
+	if (!zs_compact_watermark || !pool->compactd)
+		return;
+
+	if (pool->compact_requested ||
+			time_before(jiffies, pool->next_compact_check))
+		return;
+
+	pool->next_compact_check = jiffies + ZS_COMPACTD_INTERVAL;
+	pool->compact_requested = true;
+	wake_up_interruptible(&pool->compact_wait);
+}
+
 void zs_free(struct zs_pool *pool, unsigned long handle)
 {
 	struct page *first_page, *f_page;
@@ -1496,6 +1517,9 @@ void zs_free(struct zs_pool *pool, unsigned long handle)
 	unpin_tag(handle);
 
 	free_handle(pool, handle);
+
+	if (fullness == ZS_ALMOST_EMPTY)
+		zs_compactd_wakeup(pool);
 }
 EXPORT_SYMBOL_GPL(zs_free);
 
@@ -1776,9 +1800,71 @@ unsigned long zs_compact(struct zs_pool *pool)
 }
 EXPORT_SYMBOL_GPL(zs_compact);
 
+/*
+ * Number of pages that compacting this class could release: the unused
+ * object slots, rounded down to whole zspages.
+ */
+static unsigned long zs_can_compact(struct size_class *class)
+{
+	unsigned long obj_wasted;
+
+	obj_wasted = zs_stat_get(class, OBJ_ALLOCATED) -
+		zs_stat_get(class, OBJ_USED);
+	obj_wasted /= get_maxobj_per_zspage(class->size,
+			class->pages_per_zspage);
+
+	return obj_wasted * class->pages_per_zspage;
+}
+
+static bool zs_pool_fragmented(struct zs_pool *pool)
+{
+	unsigned long pages_total, pages_freeable = 0;
+	unsigned int watermark = ACCESS_ONCE(zs_compact_watermark);
+	struct size_class *class;
+	int i;
+
+	pages_total = zs_get_total_pages(pool);
+	if (!watermark || !pages_total)
+		return false;
+
+	for (i = zs_size_classes - 1; i >= 0; i--) {
+		class = pool->size_class[i];
+		if (!class)
+			continue;
+		if (class->index != i)
+			continue;
+
+		spin_lock(&class->lock);
+		pages_freeable += zs_can_compact(class);
+		spin_unlock(&class->lock);
+	}
+
+	return pages_freeable * 100 > pages_total * watermark;
+}
+
+static int zs_compactd(void *data)
+{
+	struct zs_pool *pool = data;
+
+	set_freezable();
+	while (!kthread_should_stop()) {
+		wait_event_freezable(pool->compact_wait,
+				pool->compact_requested ||
+				kthread_should_stop());
+		if (kthread_should_stop())
+			break;
+
+		if (zs_pool_fragmented(pool))
+			zs_compact(pool);
+		pool->compact_requested = false;
+	}
+
+	return 0;
+}
+
 /**
  * zs_create_pool - Creates an allocation pool to work from.
- * @flags: allocation flags used to allocate pool metadata
+ * @name: pool name to be created
  *
  * This function must be called before anything when using
  * the zsmalloc allocator.
@@ -1786,7 +1872,7 @@ EXPORT_SYMBOL_GPL(zs_compact);
  * On success, a pointer to the newly created pool is returned,
  * otherwise NULL.
  */
-struct zs_pool *zs_create_pool(char *name, gfp_t flags)
+struct zs_pool *zs_create_pool(char *name)
 {
 	int i;
 	struct zs_pool *pool;
@@ -1856,11 +1942,18 @@ struct zs_pool *zs_create_pool(char *name, gfp_t flags)
 		prev_class = class;
 	}
 
-	pool->flags = flags;
-
 	if (zs_pool_stat_create(name, pool))
 		goto err;
 
+	init_waitqueue_head(&pool->compact_wait);
+	pool->compactd = kthread_run(zs_compactd, pool, "zs_compactd/%s",
+				name);
+	if (IS_ERR(pool->compactd)) {
+		/* compaction on demand through zs_compact() still works */
+		pr_warn("%s: failed to start compaction thread\n", name);
+		pool->compactd = NULL;
+	}
+
 	return pool;
 
 err:
@@ -1873,6 +1966,8 @@ void zs_destroy_pool(struct zs_pool *pool)
 {
 	int i;
 
+	if (pool->compactd)
+		kthread_stop(pool->compactd);
 	zs_pool_stat_destroy(pool);
 
 	for (i = 0; i < zs_size_classes; i++) {
@@ -3938,6 +3938,19 @@ gro_result_t napi_gro_receive(struct napi_struct *napi, struct sk_buff *skb)
 }
 EXPORT_SYMBOL(napi_gro_receive);
 
+/**
+ * get_current_napi_context - NAPI instance being polled on this CPU
+ *
+ * Lets a receive path that runs below a driver's NAPI poll, such as an
+ * rx_handler delivering to virtual devices, feed GRO with it. Returns
+ * NULL outside of a driver's poll.
+ */
+struct napi_struct *get_current_napi_context(void)
+{
+	return __this_cpu_read(softnet_data.current_napi);
+}
+EXPORT_SYMBOL(get_current_napi_context);
+
 static void napi_reuse_skb(struct napi_struct *napi, struct sk_buff *skb)
 {
 	__skb_pull(skb, skb_headlen(skb));
@@ -4250,7 +4263,11 @@ static void net_rx_action(struct softirq_action *h)
 		 */
 		work = 0;
 		if (test_bit(NAPI_STATE_SCHED, &n->state)) {
+			/* the backlog does not flush GRO when it completes */
+			if (n != &sd->backlog)
+				sd->current_napi = n;
 			work = n->poll(n, weight);
+			sd->current_napi = NULL;
 			trace_napi_poll(n);
 		}
 
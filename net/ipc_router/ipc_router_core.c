@@ -26,6 +26,7 @@
 #include <linux/uaccess.h>
 #include <linux/debugfs.h>
 #include <linux/rwsem.h>
+#include <linux/rculist.h>
 #include <linux/ipc_logging.h>
 #include <linux/uaccess.h>
 #include <linux/ipc_router.h>
@@ -158,6 +159,7 @@ struct msm_ipc_routing_table_entry {
 	struct rw_semaphore lock_lha4;
 	unsigned long num_tx_bytes;
 	unsigned long num_rx_bytes;
+	struct rcu_head rcu;
 };
 
 #define LOG_CTX_NAME_LEN 32
@@ -358,14 +360,18 @@ static void ipc_router_log_msg(void *log_ctx, uint32_t xchng_type,
 	}
 }
 
-/* Must be called with routing_table_lock_lha3 locked. */
+/*
+ * Must be called with routing_table_lock_lha3 locked or inside an RCU read
+ * side critical section. Entries are added and removed with the RCU list
+ * primitives under the write lock and freed after a grace period.
+ */
 static struct msm_ipc_routing_table_entry *lookup_routing_table(
 	uint32_t node_id)
 {
 	uint32_t key = (node_id % RT_HASH_SIZE);
 	struct msm_ipc_routing_table_entry *rt_entry;
 
-	list_for_each_entry(rt_entry, &routing_table[key], list) {
+	list_for_each_entry_rcu(rt_entry, &routing_table[key], list) {
 		if (rt_entry->node_id == node_id)
 			return rt_entry;
 	}
@@ -409,7 +415,7 @@ static struct msm_ipc_routing_table_entry *create_routing_table_entry(
 		rt_entry->neighbor_node_id = xprt_info->remote_node_id;
 
 	key = (node_id % RT_HASH_SIZE);
-	list_add_tail(&rt_entry->list, &routing_table[key]);
+	list_add_tail_rcu(&rt_entry->list, &routing_table[key]);
 out_create_rtentry1:
 	kref_get(&rt_entry->ref);
 out_create_rtentry2:
@@ -424,18 +430,20 @@ out_create_rtentry2:
  * @return: a reference to the routing table entry on success, NULL on failure.
  *
  * This function is used to obtain a reference to the rounting table entry
- * corresponding to a node id.
+ * corresponding to a node id. It runs for every packet sent or received,
+ * so the lookup is done under RCU rather than the routing table rwsem; an
+ * entry whose last reference is already gone is treated as absent.
  */
 static struct msm_ipc_routing_table_entry *ipc_router_get_rtentry_ref(
 	uint32_t node_id)
 {
 	struct msm_ipc_routing_table_entry *rt_entry;
 
-	down_read(&routing_table_lock_lha3);
+	rcu_read_lock();
 	rt_entry = lookup_routing_table(node_id);
-	if (rt_entry)
-		kref_get(&rt_entry->ref);
-	up_read(&routing_table_lock_lha3);
+	if (rt_entry && !kref_get_unless_zero(&rt_entry->ref))
+		rt_entry = NULL;
+	rcu_read_unlock();
 	return rt_entry;
 }
 
@@ -454,9 +462,10 @@ void ipc_router_release_rtentry(struct kref *ref)
 	/*
 	 * All references to a routing entry will be put only under SSR.
 	 * As part of SSR, all the internals of the routing table entry
-	 * are cleaned. So just free the routing table entry.
+	 * are cleaned. So just free the routing table entry, once lockless
+	 * lookups that may still be walking past it are done.
 	 */
-	kfree(rt_entry);
+	kfree_rcu(rt_entry, rcu);
 }
 
 struct rr_packet *rr_read(struct msm_ipc_router_xprt_info *xprt_info)
@@ -1034,6 +1043,7 @@ static int post_pkt_to_port(struct msm_ipc_port *port_ptr,
 		       size_t oob_data_len, void *priv);
 	void (*data_ready)(struct sock *sk, int bytes) = NULL;
 	struct sock *sk;
+	uint32_t pkt_type, pkt_size;
 
 	if (unlikely(!port_ptr || !pkt))
 		return -EINVAL;
@@ -1049,7 +1059,11 @@ static int post_pkt_to_port(struct msm_ipc_port *port_ptr,
 		}
 	}
 
-	mutex_lock(&port_ptr->port_rx_q_lock_lhc3);
+	/* A reader may consume temp_pkt as soon as it is queued */
+	pkt_type = temp_pkt->hdr.type;
+	pkt_size = temp_pkt->hdr.size;
+
+	spin_lock(&port_ptr->port_rx_q_lock_lhc3);
 	__pm_stay_awake(port_ptr->port_rx_ws);
 	list_add_tail(&temp_pkt->list, &port_ptr->port_rx_q);
 	wake_up(&port_ptr->port_rx_wait_q);
@@ -1060,11 +1074,11 @@ static int post_pkt_to_port(struct msm_ipc_port *port_ptr,
 		data_ready = sk->sk_data_ready;
 		read_unlock(&sk->sk_callback_lock);
 	}
-	mutex_unlock(&port_ptr->port_rx_q_lock_lhc3);
+	spin_unlock(&port_ptr->port_rx_q_lock_lhc3);
 	if (notify)
-		notify(pkt->hdr.type, NULL, 0, port_ptr->priv);
+		notify(pkt_type, NULL, 0, port_ptr->priv);
 	else if (sk && data_ready)
-		data_ready(sk, pkt->hdr.size);
+		data_ready(sk, pkt_size);
 
 	return 0;
 }
@@ -1201,7 +1215,7 @@ struct msm_ipc_port *msm_ipc_router_create_raw_port(void *endpoint,
 
 	mutex_init(&port_ptr->port_lock_lhc3);
 	INIT_LIST_HEAD(&port_ptr->port_rx_q);
-	mutex_init(&port_ptr->port_rx_q_lock_lhc3);
+	spin_lock_init(&port_ptr->port_rx_q_lock_lhc3);
 	init_waitqueue_head(&port_ptr->port_rx_wait_q);
 	snprintf(port_ptr->rx_ws_name, MAX_WS_NAME_SZ,
 		 "ipc%08x_%s",
@@ -1261,12 +1275,12 @@ void ipc_router_release_port(struct kref *ref)
 	struct msm_ipc_port *port_ptr =
 		container_of(ref, struct msm_ipc_port, ref);
 
-	mutex_lock(&port_ptr->port_rx_q_lock_lhc3);
+	spin_lock(&port_ptr->port_rx_q_lock_lhc3);
 	list_for_each_entry_safe(pkt, temp_pkt, &port_ptr->port_rx_q, list) {
 		list_del(&pkt->list);
 		release_pkt(pkt);
 	}
-	mutex_unlock(&port_ptr->port_rx_q_lock_lhc3);
+	spin_unlock(&port_ptr->port_rx_q_lock_lhc3);
 	wakeup_source_unregister(port_ptr->port_rx_ws);
 	if (port_ptr->endpoint)
 		sock_put(ipc_port_sk(port_ptr->endpoint));
@@ -2106,7 +2120,7 @@ static void msm_ipc_cleanup_routing_table(
 			cleanup_rmt_ports(xprt_info, rt_entry);
 			rt_entry->xprt_info = NULL;
 			up_write(&rt_entry->lock_lha4);
-			list_del(&rt_entry->list);
+			list_del_rcu(&rt_entry->list);
 			kref_put(&rt_entry->ref, ipc_router_release_rtentry);
 		}
 	}
@@ -3098,22 +3112,22 @@ int msm_ipc_router_read(struct msm_ipc_port *port_ptr,
 	if (!port_ptr || !read_pkt)
 		return -EINVAL;
 
-	mutex_lock(&port_ptr->port_rx_q_lock_lhc3);
+	spin_lock(&port_ptr->port_rx_q_lock_lhc3);
 	if (list_empty(&port_ptr->port_rx_q)) {
-		mutex_unlock(&port_ptr->port_rx_q_lock_lhc3);
+		spin_unlock(&port_ptr->port_rx_q_lock_lhc3);
 		return -EAGAIN;
 	}
 
 	pkt = list_first_entry(&port_ptr->port_rx_q, struct rr_packet, list);
 	if ((buf_len) && (pkt->hdr.size > buf_len)) {
-		mutex_unlock(&port_ptr->port_rx_q_lock_lhc3);
+		spin_unlock(&port_ptr->port_rx_q_lock_lhc3);
 		return -ETOOSMALL;
 	}
 	list_del(&pkt->list);
 	if (list_empty(&port_ptr->port_rx_q))
 		__pm_relax(port_ptr->port_rx_ws);
 	*read_pkt = pkt;
-	mutex_unlock(&port_ptr->port_rx_q_lock_lhc3);
+	spin_unlock(&port_ptr->port_rx_q_lock_lhc3);
 	if (pkt->hdr.control_flag & CONTROL_FLAG_CONFIRM_RX)
 		msm_ipc_router_send_resume_tx(&pkt->hdr);
 
@@ -3136,9 +3150,9 @@ int msm_ipc_router_rx_data_wait(struct msm_ipc_port *port_ptr, long timeout)
 {
 	int ret = 0;
 
-	mutex_lock(&port_ptr->port_rx_q_lock_lhc3);
+	spin_lock(&port_ptr->port_rx_q_lock_lhc3);
 	while (list_empty(&port_ptr->port_rx_q)) {
-		mutex_unlock(&port_ptr->port_rx_q_lock_lhc3);
+		spin_unlock(&port_ptr->port_rx_q_lock_lhc3);
 		if (timeout < 0) {
 			ret = wait_event_interruptible(
 					port_ptr->port_rx_wait_q,
@@ -3155,9 +3169,9 @@ int msm_ipc_router_rx_data_wait(struct msm_ipc_port *port_ptr, long timeout)
 		}
 		if (timeout == 0)
 			return -ENOMSG;
-		mutex_lock(&port_ptr->port_rx_q_lock_lhc3);
+		spin_lock(&port_ptr->port_rx_q_lock_lhc3);
 	}
-	mutex_unlock(&port_ptr->port_rx_q_lock_lhc3);
+	spin_unlock(&port_ptr->port_rx_q_lock_lhc3);
 
 	return ret;
 }
@@ -3371,13 +3385,13 @@ int msm_ipc_router_get_curr_pkt_size(struct msm_ipc_port *port_ptr)
 	if (!port_ptr)
 		return -EINVAL;
 
-	mutex_lock(&port_ptr->port_rx_q_lock_lhc3);
+	spin_lock(&port_ptr->port_rx_q_lock_lhc3);
 	if (!list_empty(&port_ptr->port_rx_q)) {
 		pkt = list_first_entry(&port_ptr->port_rx_q,
 					struct rr_packet, list);
 		rc = pkt->hdr.size;
 	}
-	mutex_unlock(&port_ptr->port_rx_q_lock_lhc3);
+	spin_unlock(&port_ptr->port_rx_q_lock_lhc3);
 
 	return rc;
 }
@@ -3860,7 +3874,10 @@ void msm_ipc_router_xprt_notify(struct msm_ipc_router_xprt *xprt,
 		xprt_info = xprt->priv;
 	}
 
-	pkt = clone_pkt((struct rr_packet *)data);
+	if (event == IPC_ROUTER_XPRT_EVENT_DATA_HANDOFF)
+		pkt = (struct rr_packet *)data;
+	else
+		pkt = clone_pkt((struct rr_packet *)data);
 	if (!pkt)
 		return;
 
@@ -353,6 +353,17 @@ struct sock *udp6_lib_lookup(struct net *net, const struct in6_addr *saddr, __be
 }
 EXPORT_SYMBOL_GPL(udp6_lib_lookup);
 
+/* Called from GRO, before the input path has set up IP6CB() */
+static struct sock *udp6_gro_lookup(struct sk_buff *skb,
+				    __be16 sport, __be16 dport)
+{
+	const struct ipv6hdr *iph = skb_gro_network_header(skb);
+
+	return __udp6_lib_lookup(dev_net(skb->dev), &iph->saddr, sport,
+				 &iph->daddr, dport, skb->dev->ifindex,
+				 &udp_table);
+}
+
 
 /*
  * 	This should be easy, if there is something there we
@@ -468,6 +479,11 @@ try_again:
 		if (np->rxopt.all)
 			ip6_datagram_recv_ctl(sk, msg, skb);
 	}
+	if (udp_sk(sk)->gro_enabled && skb_is_gso(skb)) {
+		int gso_size = skb_shinfo(skb)->gso_size;
+
+		put_cmsg(msg, SOL_UDP, UDP_GRO, sizeof(gso_size), &gso_size);
+	}
 
 	err = copied;
 	if (flags & MSG_TRUNC)
@@ -577,7 +593,7 @@ void udpv6_encap_enable(void)
 }
 EXPORT_SYMBOL(udpv6_encap_enable);
 
-int udpv6_queue_rcv_skb(struct sock *sk, struct sk_buff *skb)
+static int udpv6_queue_rcv_one_skb(struct sock *sk, struct sk_buff *skb)
 {
 	struct udp_sock *up = udp_sk(sk);
 	int rc;
@@ -666,6 +682,55 @@ drop:
 	return -1;
 }
 
+/*
+ * A GRO train can still reach a socket that does not take it whole,
+ * e.g. when UDP_GRO was turned off in the meantime. Split it back into
+ * datagrams, keeping the control block the input path filled in.
+ */
+static struct sk_buff *udpv6_rcv_segment(struct sock *sk, struct sk_buff *skb)
+{
+	char cb[sizeof(skb->cb)];
+	struct sk_buff *segs, *seg;
+
+	memcpy(cb, skb->cb, sizeof(cb));
+	__skb_push(skb, skb->data - skb_network_header(skb));
+	segs = __skb_gso_segment(skb, NETIF_F_SG | NETIF_F_HW_CSUM, false);
+	if (IS_ERR_OR_NULL(segs)) {
+		UDP6_INC_STATS_BH(sock_net(sk), UDP_MIB_INERRORS,
+				  IS_UDPLITE(sk));
+		atomic_inc(&sk->sk_drops);
+		kfree_skb(skb);
+		return NULL;
+	}
+	consume_skb(skb);
+
+	for (seg = segs; seg; seg = seg->next) {
+		memcpy(seg->cb, cb, sizeof(cb));
+		__skb_pull(seg, skb_transport_offset(seg));
+	}
+	return segs;
+}
+
+int udpv6_queue_rcv_skb(struct sock *sk, struct sk_buff *skb)
+{
+	struct udp_sock *up = udp_sk(sk);
+	struct sk_buff *segs, *next;
+
+	if (likely(!(skb_shinfo(skb)->gso_type & SKB_GSO_UDP_L4) ||
+		   (up->gro_enabled && !up->encap_type)))
+		return udpv6_queue_rcv_one_skb(sk, skb);
+
+	segs = udpv6_rcv_segment(sk, skb);
+	for (skb = segs; skb; skb = next) {
+		next = skb->next;
+		skb->next = NULL;
+		/* Resubmission is not possible for a single segment */
+		if (udpv6_queue_rcv_one_skb(sk, skb) > 0)
+			kfree_skb(skb);
+	}
+	return 0;
+}
+
 static struct sock *udp_v6_mcast_next(struct net *net, struct sock *sk,
 				      __be16 loc_port, const struct in6_addr *loc_addr,
 				      __be16 rmt_port, const struct in6_addr *rmt_addr,
@@ -1316,9 +1381,50 @@ void udpv6_destroy_sock(struct sock *sk)
 /*
  *	Socket option code for UDP
  */
+static int udpv6_set_gro(struct sock *sk, char __user *optval,
+			 unsigned int optlen)
+{
+	int val;
+
+	if (optlen < sizeof(int))
+		return -EINVAL;
+
+	if (get_user(val, (int __user *)optval))
+		return -EFAULT;
+
+	if (val)
+		udp6_gro_enable();
+	lock_sock(sk);
+	udp_sk(sk)->gro_enabled = !!val;
+	release_sock(sk);
+	return 0;
+}
+
+static int udpv6_get_gro(struct sock *sk, char __user *optval,
+			 int __user *optlen)
+{
+	int val, len;
+
+	if (get_user(len, optlen))
+		return -EFAULT;
+
+	len = min_t(unsigned int, len, sizeof(int));
+	if (len < 0)
+		return -EINVAL;
+
+	val = udp_sk(sk)->gro_enabled;
+	if (put_user(len, optlen))
+		return -EFAULT;
+	if (copy_to_user(optval, &val, len))
+		return -EFAULT;
+	return 0;
+}
+
 int udpv6_setsockopt(struct sock *sk, int level, int optname,
 		     char __user *optval, unsigned int optlen)
 {
+	if (level == SOL_UDP && optname == UDP_GRO)
+		return udpv6_set_gro(sk, optval, optlen);
 	if (level == SOL_UDP  ||  level == SOL_UDPLITE)
 		return udp_lib_setsockopt(sk, level, optname, optval, optlen,
 					  udp_v6_push_pending_frames);
@@ -1329,6 +1435,8 @@ int udpv6_setsockopt(struct sock *sk, int level, int optname,
 int compat_udpv6_setsockopt(struct sock *sk, int level, int optname,
 			    char __user *optval, unsigned int optlen)
 {
+	if (level == SOL_UDP && optname == UDP_GRO)
+		return udpv6_set_gro(sk, optval, optlen);
 	if (level == SOL_UDP  ||  level == SOL_UDPLITE)
 		return udp_lib_setsockopt(sk, level, optname, optval, optlen,
 					  udp_v6_push_pending_frames);
@@ -1339,6 +1447,8 @@ int compat_udpv6_setsockopt(struct sock *sk, int level, int optname,
 int udpv6_getsockopt(struct sock *sk, int level, int optname,
 		     char __user *optval, int __user *optlen)
 {
+	if (level == SOL_UDP && optname == UDP_GRO)
+		return udpv6_get_gro(sk, optval, optlen);
 	if (level == SOL_UDP  ||  level == SOL_UDPLITE)
 		return udp_lib_getsockopt(sk, level, optname, optval, optlen);
 	return ipv6_getsockopt(sk, level, optname, optval, optlen);
@@ -1348,6 +1458,8 @@ int udpv6_getsockopt(struct sock *sk, int level, int optname,
 int compat_udpv6_getsockopt(struct sock *sk, int level, int optname,
 			    char __user *optval, int __user *optlen)
 {
+	if (level == SOL_UDP && optname == UDP_GRO)
+		return udpv6_get_gro(sk, optval, optlen);
 	if (level == SOL_UDP  ||  level == SOL_UDPLITE)
 		return udp_lib_getsockopt(sk, level, optname, optval, optlen);
 	return compat_ipv6_getsockopt(sk, level, optname, optval, optlen);
@@ -1505,6 +1617,8 @@ int __init udpv6_init(void)
 	ret = inet6_register_protosw(&udpv6_protosw);
 	if (ret)
 		goto out_udpv6_protocol;
+
+	udp6_gro_register_lookup(udp6_gro_lookup);
 out:
 	return ret;
 
@@ -1515,6 +1629,7 @@ out_udpv6_protocol:
 
 void udpv6_exit(void)
 {
+	udp6_gro_register_lookup(NULL);
 	inet6_unregister_protosw(&udpv6_protosw);
 	inet6_del_protocol(&udpv6_protocol, IPPROTO_UDP);
 }
@@ -10,12 +10,39 @@
  *      UDPv6 GSO support
  */
 #include <linux/skbuff.h>
+#include <linux/static_key.h>
 #include <net/protocol.h>
 #include <net/ipv6.h>
 #include <net/udp.h>
 #include <net/ip6_checksum.h>
 #include "ip6_offload.h"
 
+/* Upper bound of datagrams merged into one GRO train */
+#define UDP_GRO_CNT_MAX 64
+
+/*
+ * The socket lookup lives in udp.c, which may be built as part of the
+ * ipv6 module, so it is handed to us at init time. GRO stays off until
+ * the first socket opts in with UDP_GRO.
+ */
+static udp6_gro_lookup_t __rcu udp6_gro_lookup __read_mostly;
+static struct static_key udp6_gro_needed __read_mostly;
+
+void udp6_gro_register_lookup(udp6_gro_lookup_t lookup)
+{
+	rcu_assign_pointer(udp6_gro_lookup, lookup);
+	if (!lookup)
+		synchronize_net();
+}
+EXPORT_SYMBOL(udp6_gro_register_lookup);
+
+void udp6_gro_enable(void)
+{
+	if (!static_key_enabled(&udp6_gro_needed))
+		static_key_slow_inc(&udp6_gro_needed);
+}
+EXPORT_SYMBOL(udp6_gro_enable);
+
 static int udp6_ufo_send_check(struct sk_buff *skb)
 {
 	const struct ipv6hdr *ipv6h;
@@ -39,6 +66,53 @@ static int udp6_ufo_send_check(struct sk_buff *skb)
 	return 0;
 }
 
+/*
+ * Splits a GRO train back into datagrams, for paths that cannot take it
+ * whole. Each segment gets its own UDP length and checksum; the latter
+ * is left to the device when skb_segment() did not compute it already.
+ */
+static struct sk_buff *udp6_gso_segment(struct sk_buff *skb,
+	netdev_features_t features)
+{
+	struct sk_buff *segs, *seg;
+	const struct ipv6hdr *ipv6h;
+	struct udphdr *uh;
+	unsigned int ulen;
+
+	if (unlikely(skb->len <= sizeof(*uh) + skb_shinfo(skb)->gso_size))
+		return ERR_PTR(-EINVAL);
+
+	if (!pskb_may_pull(skb, sizeof(*uh)))
+		return ERR_PTR(-EINVAL);
+
+	__skb_pull(skb, sizeof(*uh));
+	segs = skb_segment(skb, features);
+	if (IS_ERR_OR_NULL(segs))
+		return segs;
+
+	for (seg = segs; seg; seg = seg->next) {
+		ipv6h = ipv6_hdr(seg);
+		uh = udp_hdr(seg);
+		ulen = seg->len - skb_transport_offset(seg);
+
+		uh->len = htons(ulen);
+		uh->check = ~csum_ipv6_magic(&ipv6h->saddr, &ipv6h->daddr,
+					     ulen, IPPROTO_UDP, 0);
+		if (seg->ip_summed == CHECKSUM_NONE) {
+			uh->check = csum_fold(csum_partial(uh, sizeof(*uh),
+							   seg->csum));
+			if (!uh->check)
+				uh->check = CSUM_MANGLED_0;
+			continue;
+		}
+		seg->csum_start = skb_transport_header(seg) - seg->head;
+		seg->csum_offset = offsetof(struct udphdr, check);
+		seg->ip_summed = CHECKSUM_PARTIAL;
+	}
+
+	return segs;
+}
+
 static struct sk_buff *udp6_ufo_fragment(struct sk_buff *skb,
 	netdev_features_t features)
 {
@@ -53,6 +127,9 @@ static struct sk_buff *udp6_ufo_fragment(struct sk_buff *skb,
 	__wsum csum;
 	int tnl_hlen;
 
+	if (skb_shinfo(skb)->gso_type & SKB_GSO_UDP_L4)
+		return udp6_gso_segment(skb, features);
+
 	mss = skb_shinfo(skb)->gso_size;
 	if (unlikely(skb->len <= mss))
 		goto out;
@@ -118,10 +195,128 @@ static struct sk_buff *udp6_ufo_fragment(struct sk_buff *skb,
 out:
 	return segs;
 }
+
+static bool udp6_gro_sk_enabled(struct sk_buff *skb, struct udphdr *uh)
+{
+	udp6_gro_lookup_t lookup;
+	struct sock *sk;
+	bool enabled;
+
+	lookup = rcu_dereference(udp6_gro_lookup);
+	if (!lookup)
+		return false;
+
+	sk = lookup(skb, uh->source, uh->dest);
+	if (!sk)
+		return false;
+	enabled = udp_sk(sk)->gro_enabled && !udp_sk(sk)->encap_type;
+	sock_put(sk);
+
+	return enabled;
+}
+
+static struct sk_buff **udp6_gro_receive(struct sk_buff **head,
+					 struct sk_buff *skb)
+{
+	const struct ipv6hdr *iph = skb_gro_network_header(skb);
+	struct sk_buff **pp;
+	struct sk_buff *p;
+	struct udphdr *uh, *uh2;
+	unsigned int hlen, off, ulen;
+	__wsum wsum;
+
+	if (!static_key_false(&udp6_gro_needed))
+		goto flush;
+
+	off = skb_gro_offset(skb);
+	hlen = off + sizeof(*uh);
+	uh = skb_gro_header_fast(skb, off);
+	if (skb_gro_header_hard(skb, hlen)) {
+		uh = skb_gro_header_slow(skb, hlen, off);
+		if (unlikely(!uh))
+			goto flush;
+	}
+
+	ulen = ntohs(uh->len);
+	if (ulen <= sizeof(*uh) || ulen != skb_gro_len(skb) || !uh->check ||
+	    ipv6_addr_is_multicast(&iph->daddr))
+		goto flush;
+
+	if (!udp6_gro_sk_enabled(skb, uh))
+		goto flush;
+
+	switch (skb->ip_summed) {
+	case CHECKSUM_COMPLETE:
+		if (!csum_ipv6_magic(&iph->saddr, &iph->daddr, ulen,
+				     IPPROTO_UDP, skb->csum)) {
+			skb->ip_summed = CHECKSUM_UNNECESSARY;
+			break;
+		}
+		goto flush;
+	case CHECKSUM_NONE:
+		wsum = ~csum_unfold(csum_ipv6_magic(&iph->saddr, &iph->daddr,
+						    ulen, IPPROTO_UDP, 0));
+		if (csum_fold(skb_checksum(skb, off, ulen, wsum)))
+			goto flush;
+		skb->ip_summed = CHECKSUM_UNNECESSARY;
+		break;
+	}
+
+	skb_gro_pull(skb, sizeof(*uh));
+
+	for (pp = head; (p = *pp); pp = &p->next) {
+		if (!NAPI_GRO_CB(p)->same_flow)
+			continue;
+
+		uh2 = udp_hdr(p);
+		if (*(u32 *)&uh->source != *(u32 *)&uh2->source) {
+			NAPI_GRO_CB(p)->same_flow = 0;
+			continue;
+		}
+
+		/*
+		 * A train carries datagrams of one size, only the last one
+		 * may be shorter. It is completed on a longer datagram, on
+		 * a short one that ends it, or once it has grown enough.
+		 */
+		if (ulen > ntohs(uh2->len) || skb_gro_receive(pp, skb) ||
+		    ulen != ntohs(uh2->len) ||
+		    NAPI_GRO_CB(*pp)->count >= UDP_GRO_CNT_MAX)
+			return pp;
+		return NULL;
+	}
+
+	return NULL;
+
+flush:
+	NAPI_GRO_CB(skb)->flush = 1;
+	return NULL;
+}
+
+static int udp6_gro_complete(struct sk_buff *skb)
+{
+	const struct ipv6hdr *iph = ipv6_hdr(skb);
+	struct udphdr *uh = udp_hdr(skb);
+	unsigned int ulen = skb->len - skb_transport_offset(skb);
+
+	uh->len = htons(ulen);
+	uh->check = ~csum_ipv6_magic(&iph->saddr, &iph->daddr, ulen,
+				     IPPROTO_UDP, 0);
+	skb->csum_start = skb_transport_header(skb) - skb->head;
+	skb->csum_offset = offsetof(struct udphdr, check);
+	skb->ip_summed = CHECKSUM_PARTIAL;
+
+	skb_shinfo(skb)->gso_type |= SKB_GSO_UDP_L4;
+	skb_shinfo(skb)->gso_segs = NAPI_GRO_CB(skb)->count;
+	return 0;
+}
+
 static const struct net_offload udpv6_offload = {
 	.callbacks = {
 		.gso_send_check =	udp6_ufo_send_check,
 		.gso_segment	=	udp6_ufo_fragment,
+		.gro_receive	=	udp6_gro_receive,
+		.gro_complete	=	udp6_gro_complete,
 	},
 };
 
@@ -127,12 +127,26 @@ static struct proc_dir_entry *iface_stat_fmt_procfile;
 static LIST_HEAD(iface_stat_list);
 static DEFINE_SPINLOCK(iface_stat_list_lock);
 
+/*
+ * The rb trees are what the control and proc paths walk, under the locks.
+ * The match path only does lookups, so it uses the RCU hashes which carry
+ * the same entries and takes no lock. Entries are freed after a grace
+ * period.
+ */
 static struct rb_root sock_tag_tree = RB_ROOT;
+static DEFINE_HASHTABLE(sock_tag_hash, 8);
 static DEFINE_SPINLOCK(sock_tag_list_lock);
 
 static struct rb_root tag_counter_set_tree = RB_ROOT;
+static DEFINE_HASHTABLE(tag_counter_set_hash, 6);
 static DEFINE_SPINLOCK(tag_counter_set_list_lock);
 
+/* tag_stats waiting for their per-cpu counters */
+static LIST_HEAD(tag_stat_pcpu_list);
+static DEFINE_SPINLOCK(tag_stat_pcpu_list_lock);
+static void tag_stat_pcpu_worker(struct work_struct *work);
+static DECLARE_WORK(tag_stat_pcpu_work, tag_stat_pcpu_worker);
+
 static struct rb_root uid_tag_data_tree = RB_ROOT;
 static DEFINE_SPINLOCK(uid_tag_data_tree_lock);
 
@@ -173,6 +187,38 @@ static inline void dc_add_byte_packets(struct data_counters *counters, int set,
 	counters->bpc[set][direction][ifs_proto].packets += packets;
 }
 
+/* Adds all the cpus' counters to sum */
+static void dc_sum_pcpu(struct data_counters *sum,
+			struct data_counters __percpu *pcpu_counters)
+{
+	int cpu, set, direction, ifs_proto;
+
+	if (!pcpu_counters)
+		return;
+	for_each_possible_cpu(cpu) {
+		struct data_counters *dc = per_cpu_ptr(pcpu_counters, cpu);
+
+		for (set = 0; set < IFS_MAX_COUNTER_SETS; set++)
+			for (direction = 0; direction < IFS_MAX_DIRECTIONS;
+			     direction++)
+				for (ifs_proto = 0; ifs_proto < IFS_MAX_PROTOS;
+				     ifs_proto++)
+					dc_add_byte_packets(sum, set,
+						direction, ifs_proto,
+						dc->bpc[set][direction]
+							[ifs_proto].bytes,
+						dc->bpc[set][direction]
+							[ifs_proto].packets);
+	}
+}
+
+static void tag_stat_get_counters(struct tag_stat *ts_entry,
+				  struct data_counters *sum)
+{
+	*sum = ts_entry->counters;
+	dc_sum_pcpu(sum, ACCESS_ONCE(ts_entry->pcpu_counters));
+}
+
 static struct tag_node *tag_node_tree_search(struct rb_root *root, tag_t tag)
 {
 	struct rb_node *node = root->rb_node;
@@ -228,6 +274,58 @@ static void tag_stat_tree_insert(struct tag_stat *data, struct rb_root *root)
 	tag_node_tree_insert(&data->tn, root);
 }
 
+/* Caller must be in an RCU read-side section */
+static struct tag_stat *tag_stat_hash_search(struct iface_stat *iface_entry,
+					     tag_t tag)
+{
+	struct tag_stat *ts_entry;
+
+	hash_for_each_possible_rcu(iface_entry->tag_stat_hash, ts_entry,
+				   hnode, tag)
+		if (ts_entry->tn.tag == tag)
+			return ts_entry;
+	return NULL;
+}
+
+static void tag_stat_free_rcu(struct rcu_head *head)
+{
+	struct tag_stat *ts_entry = container_of(head, struct tag_stat, rcu);
+
+	free_percpu(ts_entry->pcpu_counters);
+	kfree(ts_entry);
+}
+
+/*
+ * alloc_percpu() may sleep, and tag_stats are created from the match path,
+ * so their per-cpu counters are attached from here.
+ */
+static void tag_stat_pcpu_worker(struct work_struct *work)
+{
+	struct data_counters __percpu *pcpu_counters;
+	struct tag_stat *ts_entry;
+
+	for (;;) {
+		pcpu_counters = alloc_percpu(struct data_counters);
+		if (!pcpu_counters) {
+			pr_err_ratelimited("qtaguid: tag_stat: "
+					   "per-cpu counters alloc failed\n");
+			return;
+		}
+		spin_lock_bh(&tag_stat_pcpu_list_lock);
+		if (list_empty(&tag_stat_pcpu_list)) {
+			spin_unlock_bh(&tag_stat_pcpu_list_lock);
+			free_percpu(pcpu_counters);
+			return;
+		}
+		ts_entry = list_first_entry(&tag_stat_pcpu_list,
+					    struct tag_stat, pcpu_list);
+		list_del_init(&ts_entry->pcpu_list);
+		rcu_assign_pointer(ts_entry->pcpu_counters, pcpu_counters);
+		spin_unlock_bh(&tag_stat_pcpu_list_lock);
+		cond_resched();
+	}
+}
+
 static struct tag_stat *tag_stat_tree_search(struct rb_root *root, tag_t tag)
 {
 	struct tag_node *node = tag_node_tree_search(root, tag);
@@ -252,6 +350,17 @@ static struct tag_counter_set *tag_counter_set_tree_search(struct rb_root *root,
 
 }
 
+/* Caller must be in an RCU read-side section */
+static struct tag_counter_set *tag_counter_set_hash_search(tag_t tag)
+{
+	struct tag_counter_set *tcs;
+
+	hash_for_each_possible_rcu(tag_counter_set_hash, tcs, hnode, tag)
+		if (tcs->tn.tag == tag)
+			return tcs;
+	return NULL;
+}
+
 static void tag_ref_tree_insert(struct tag_ref *data, struct rb_root *root)
 {
 	tag_node_tree_insert(&data->tn, root);
@@ -321,7 +430,8 @@ static void sock_tag_tree_erase(struct rb_root *st_to_free_tree)
 			 get_uid_from_tag(st_entry->tag));
 		rb_erase(&st_entry->sock_node, st_to_free_tree);
 		sockfd_put(st_entry->socket);
-		kfree(st_entry);
+		/* Already out of sock_tag_hash, the match path might see it */
+		kfree_rcu(st_entry, rcu);
 	}
 }
 
@@ -626,17 +736,18 @@ static int get_active_counter_set(tag_t tag)
 		 tag, get_uid_from_tag(tag));
 	/* For now we only handle UID tags for active sets */
 	tag = get_utag_from_tag(tag);
-	spin_lock_bh(&tag_counter_set_list_lock);
-	tcs = tag_counter_set_tree_search(&tag_counter_set_tree, tag);
+	rcu_read_lock();
+	tcs = tag_counter_set_hash_search(tag);
 	if (tcs)
-		active_set = tcs->active_set;
-	spin_unlock_bh(&tag_counter_set_list_lock);
+		active_set = ACCESS_ONCE(tcs->active_set);
+	rcu_read_unlock();
 	return active_set;
 }
 
 /*
  * Find the entry for tracking the specified interface.
- * Caller must hold iface_stat_list_lock
+ * Caller must hold iface_stat_list_lock or be in an RCU read-side section.
+ * iface_stats are never deleted.
  */
 static struct iface_stat *get_iface_entry(const char *ifname)
 {
@@ -649,7 +760,7 @@ static struct iface_stat *get_iface_entry(const char *ifname)
 	}
 
 	/* Iterate over interfaces */
-	list_for_each_entry(iface_entry, &iface_stat_list, list) {
+	list_for_each_entry_rcu(iface_entry, &iface_stat_list, list) {
 		if (!strcmp(ifname, iface_entry->ifname))
 			goto done;
 	}
@@ -677,9 +788,11 @@ static void pp_iface_stat_header(struct seq_file *m)
 static void pp_iface_stat_line(struct seq_file *m,
 			       struct iface_stat *iface_entry)
 {
-	struct data_counters *cnts;
+	struct data_counters dc, *cnts = &dc;
 	int cnt_set = 0;   /* We only use one set for the device */
-	cnts = &iface_entry->totals_via_skb;
+
+	dc = iface_entry->totals_via_skb;
+	dc_sum_pcpu(&dc, ACCESS_ONCE(iface_entry->pcpu_totals_via_skb));
 	seq_printf(m, "%s %llu %llu %llu %llu %llu %llu %llu %llu "
 		   "%llu %llu %llu %llu %llu %llu %llu %llu\n",
 		   iface_entry->ifname,
@@ -788,11 +901,20 @@ static const struct file_operations read_bool_fops = {
 static void iface_create_proc_worker(struct work_struct *work)
 {
 	struct proc_dir_entry *proc_entry;
+	struct data_counters __percpu *pcpu_counters;
 	struct iface_stat_work *isw = container_of(work, struct iface_stat_work,
 						   iface_work);
 	struct iface_stat *new_iface  = isw->iface_entry;
 
 	/* iface_entries are not deleted, so safe to manipulate. */
+	pcpu_counters = alloc_percpu(struct data_counters);
+	if (pcpu_counters)
+		rcu_assign_pointer(new_iface->pcpu_totals_via_skb,
+				   pcpu_counters);
+	else
+		pr_err("qtaguid: iface_stat: create_proc(): "
+		       "per-cpu counters alloc failed.\n");
+
 	proc_entry = proc_mkdir(new_iface->ifname, iface_stat_procdir);
 	if (IS_ERR_OR_NULL(proc_entry)) {
 		pr_err("qtaguid: iface_stat: create_proc(): alloc failed.\n");
@@ -869,6 +991,7 @@ static struct iface_stat *iface_alloc(struct net_device *net_dev)
 	}
 	spin_lock_init(&new_iface->tag_stat_list_lock);
 	new_iface->tag_stat_tree = RB_ROOT;
+	hash_init(new_iface->tag_stat_hash);
 	_iface_stat_set_active(new_iface, net_dev, true);
 
 	/*
@@ -887,7 +1010,7 @@ static struct iface_stat *iface_alloc(struct net_device *net_dev)
 	isw->iface_entry = new_iface;
 	INIT_WORK(&isw->iface_work, iface_create_proc_worker);
 	schedule_work(&isw->iface_work);
-	list_add(&new_iface->list, &iface_stat_list);
+	list_add_rcu(&new_iface->list, &iface_stat_list);
 	return new_iface;
 }
 
@@ -1068,16 +1191,18 @@ static struct sock_tag *get_sock_stat_nl(const struct sock *sk)
 	return sock_tag_tree_search(&sock_tag_tree, sk);
 }
 
+/* Caller must be in an RCU read-side section */
 static struct sock_tag *get_sock_stat(const struct sock *sk)
 {
 	struct sock_tag *sock_tag_entry;
 	MT_DEBUG("qtaguid: get_sock_stat(sk=%p)\n", sk);
 	if (!sk)
 		return NULL;
-	spin_lock_bh(&sock_tag_list_lock);
-	sock_tag_entry = get_sock_stat_nl(sk);
-	spin_unlock_bh(&sock_tag_list_lock);
-	return sock_tag_entry;
+	hash_for_each_possible_rcu(sock_tag_hash, sock_tag_entry, sock_hnode,
+				   (unsigned long)sk)
+		if (sock_tag_entry->sk == sk)
+			return sock_tag_entry;
+	return NULL;
 }
 
 static int ipx_proto(const struct sk_buff *skb,
@@ -1101,25 +1226,37 @@ static int ipx_proto(const struct sk_buff *skb,
 	return tproto;
 }
 
-static void
-data_counters_update(struct data_counters *dc, int set,
-		     enum ifs_tx_rx direction, int proto, int bytes)
+static enum ifs_proto ipx_to_ifs_proto(int proto)
 {
 	switch (proto) {
 	case IPPROTO_TCP:
-		dc_add_byte_packets(dc, set, direction, IFS_TCP, bytes, 1);
-		break;
+		return IFS_TCP;
 	case IPPROTO_UDP:
-		dc_add_byte_packets(dc, set, direction, IFS_UDP, bytes, 1);
-		break;
+		return IFS_UDP;
 	case IPPROTO_IP:
 	default:
-		dc_add_byte_packets(dc, set, direction, IFS_PROTO_OTHER, bytes,
-				    1);
-		break;
+		return IFS_PROTO_OTHER;
 	}
 }
 
+static void
+data_counters_update(struct data_counters *dc, int set,
+		     enum ifs_tx_rx direction, int proto, int bytes)
+{
+	dc_add_byte_packets(dc, set, direction, ipx_to_ifs_proto(proto),
+			    bytes, 1);
+}
+
+static void
+data_counters_update_pcpu(struct data_counters __percpu *dc, int set,
+			  enum ifs_tx_rx direction, int proto, int bytes)
+{
+	enum ifs_proto ifs_proto = ipx_to_ifs_proto(proto);
+
+	this_cpu_add(dc->bpc[set][direction][ifs_proto].bytes, bytes);
+	this_cpu_inc(dc->bpc[set][direction][ifs_proto].packets);
+}
+
 /*
  * Update stats for the specified interface. Do nothing if the entry
  * does not exist (when a device was never configured with an IP address).
@@ -1216,6 +1353,7 @@ static void iface_stat_update_from_skb(const struct sk_buff *skb,
 				       struct xt_action_param *par)
 {
 	struct iface_stat *entry;
+	struct data_counters __percpu *pcpu_counters;
 	const struct net_device *el_dev;
 	enum ifs_tx_rx direction;
 	int bytes = skb->len;
@@ -1228,23 +1366,61 @@ static void iface_stat_update_from_skb(const struct sk_buff *skb,
 		 par->hooknum, __func__, el_dev->name, el_dev->type,
 		 par->family, proto, direction);
 
-	spin_lock_bh(&iface_stat_list_lock);
+	rcu_read_lock();
 	entry = get_iface_entry(el_dev->name);
 	if (entry == NULL) {
 		IF_DEBUG("qtaguid[%d]: iface_stat: %s(%s): not tracked\n",
 			 par->hooknum, __func__, el_dev->name);
-		spin_unlock_bh(&iface_stat_list_lock);
+		rcu_read_unlock();
 		return;
 	}
 
 	IF_DEBUG("qtaguid[%d]: %s(%s): entry=%p\n", par->hooknum,  __func__,
 		 el_dev->name, entry);
 
-	data_counters_update(&entry->totals_via_skb, 0, direction, proto,
-			     bytes);
-	spin_unlock_bh(&iface_stat_list_lock);
+	pcpu_counters = rcu_dereference(entry->pcpu_totals_via_skb);
+	if (likely(pcpu_counters)) {
+		data_counters_update_pcpu(pcpu_counters, 0, direction, proto,
+					  bytes);
+	} else {
+		spin_lock_bh(&iface_stat_list_lock);
+		data_counters_update(&entry->totals_via_skb, 0, direction,
+				     proto, bytes);
+		spin_unlock_bh(&iface_stat_list_lock);
+	}
+	rcu_read_unlock();
 }
 
+/*
+ * True once the tag_stat and its parent have per-cpu counters, and can be
+ * updated without iface_entry->tag_stat_list_lock.
+ */
+static bool tag_stat_is_pcpu(struct tag_stat *tag_entry)
+{
+	return rcu_access_pointer(tag_entry->pcpu_counters) &&
+		(!tag_entry->parent ||
+		 rcu_access_pointer(tag_entry->parent->pcpu_counters));
+}
+
+static void tag_stat_counters_update(struct tag_stat *tag_entry, int set,
+				     enum ifs_tx_rx direction, int proto,
+				     int bytes)
+{
+	struct data_counters __percpu *pcpu_counters;
+
+	pcpu_counters = rcu_dereference(tag_entry->pcpu_counters);
+	if (likely(pcpu_counters))
+		data_counters_update_pcpu(pcpu_counters, set, direction,
+					  proto, bytes);
+	else
+		data_counters_update(&tag_entry->counters, set, direction,
+				     proto, bytes);
+}
+
+/*
+ * Caller must be in an RCU read-side section, and hold
+ * iface_entry->tag_stat_list_lock unless tag_stat_is_pcpu().
+ */
 static void tag_stat_update(struct tag_stat *tag_entry,
 			enum ifs_tx_rx direction, int proto, int bytes)
 {
@@ -1254,11 +1430,11 @@ static void tag_stat_update(struct tag_stat *tag_entry,
 		 "dir=%d proto=%d bytes=%d)\n",
 		 tag_entry->tn.tag, get_uid_from_tag(tag_entry->tn.tag),
 		 active_set, direction, proto, bytes);
-	data_counters_update(&tag_entry->counters, active_set, direction,
-			     proto, bytes);
-	if (tag_entry->parent_counters)
-		data_counters_update(tag_entry->parent_counters, active_set,
-				     direction, proto, bytes);
+	tag_stat_counters_update(tag_entry, active_set, direction, proto,
+				 bytes);
+	if (tag_entry->parent)
+		tag_stat_counters_update(tag_entry->parent, active_set,
+					 direction, proto, bytes);
 }
 
 /*
@@ -1267,7 +1443,7 @@ static void tag_stat_update(struct tag_stat *tag_entry,
  * iface_entry->tag_stat_list_lock should be held.
  */
 static struct tag_stat *create_if_tag_stat(struct iface_stat *iface_entry,
-					   tag_t tag)
+					   tag_t tag, struct tag_stat *parent)
 {
 	struct tag_stat *new_tag_stat_entry = NULL;
 	IF_DEBUG("qtaguid: iface_stat: %s(): ife=%p tag=0x%llx"
@@ -1279,7 +1455,15 @@ static struct tag_stat *create_if_tag_stat(struct iface_stat *iface_entry,
 		goto done;
 	}
 	new_tag_stat_entry->tn.tag = tag;
+	new_tag_stat_entry->parent = parent;
 	tag_stat_tree_insert(new_tag_stat_entry, &iface_entry->tag_stat_tree);
+	hash_add_rcu(iface_entry->tag_stat_hash, &new_tag_stat_entry->hnode,
+		     tag);
+
+	spin_lock(&tag_stat_pcpu_list_lock);
+	list_add_tail(&new_tag_stat_entry->pcpu_list, &tag_stat_pcpu_list);
+	spin_unlock(&tag_stat_pcpu_list_lock);
+	schedule_work(&tag_stat_pcpu_work);
 done:
 	return new_tag_stat_entry;
 }
@@ -1291,7 +1475,7 @@ static void if_tag_stat_update(const char *ifname, uid_t uid,
 	struct tag_stat *tag_stat_entry;
 	tag_t tag, acct_tag;
 	tag_t uid_tag;
-	struct data_counters *uid_tag_counters;
+	struct tag_stat *uid_tag_stat;
 	struct sock_tag *sock_tag_entry;
 	struct iface_stat *iface_entry;
 	struct tag_stat *new_tag_stat = NULL;
@@ -1300,15 +1484,14 @@ static void if_tag_stat_update(const char *ifname, uid_t uid,
 		 ifname, uid, sk, direction, proto, bytes);
 
 
-	spin_lock_bh(&iface_stat_list_lock);
+	rcu_read_lock();
 	iface_entry = get_iface_entry(ifname);
 	if (!iface_entry) {
-		spin_unlock_bh(&iface_stat_list_lock);
+		rcu_read_unlock();
 		pr_err_ratelimited("qtaguid: tag_stat: stat_update() "
 				   "%s not found\n", ifname);
 		return;
 	}
-	spin_unlock_bh(&iface_stat_list_lock);
 	/* It is ok to process data when an iface_entry is inactive */
 
 	MT_DEBUG("qtaguid: tag_stat: stat_update() dev=%s entry=%p\n",
@@ -1320,7 +1503,7 @@ static void if_tag_stat_update(const char *ifname, uid_t uid,
 	 */
 	sock_tag_entry = get_sock_stat(sk);
 	if (sock_tag_entry) {
-		tag = sock_tag_entry->tag;
+		tag = ACCESS_ONCE(sock_tag_entry->tag);
 		acct_tag = get_atag_from_tag(tag);
 		uid_tag = get_utag_from_tag(tag);
 	} else {
@@ -1331,19 +1514,26 @@ static void if_tag_stat_update(const char *ifname, uid_t uid,
 	MT_DEBUG("qtaguid: tag_stat: stat_update(): "
 		 " looking for tag=0x%llx (uid=%u) in ife=%p\n",
 		 tag, get_uid_from_tag(tag), iface_entry);
-	/* Loop over tag list under this interface for {acct_tag,uid_tag} */
+	/*
+	 * Look for {acct_tag,uid_tag} under this interface.
+	 * Updating the {acct_tag, uid_tag} entry handles both stats:
+	 * {0, uid_tag} will also get updated.
+	 */
+	tag_stat_entry = tag_stat_hash_search(iface_entry, tag);
+	if (likely(tag_stat_entry && tag_stat_is_pcpu(tag_stat_entry))) {
+		tag_stat_update(tag_stat_entry, direction, proto, bytes);
+		rcu_read_unlock();
+		return;
+	}
+
+	/* New, or young, entry: serialize with the other writers */
 	spin_lock_bh(&iface_entry->tag_stat_list_lock);
 
 	tag_stat_entry = tag_stat_tree_search(&iface_entry->tag_stat_tree,
 					      tag);
 	if (tag_stat_entry) {
-		/*
-		 * Updating the {acct_tag, uid_tag} entry handles both stats:
-		 * {0, uid_tag} will also get updated.
-		 */
 		tag_stat_update(tag_stat_entry, direction, proto, bytes);
-		spin_unlock_bh(&iface_entry->tag_stat_list_lock);
-		return;
+		goto unlock;
 	}
 
 	/* Loop over tag list under this interface for {0,uid_tag} */
@@ -1355,20 +1545,20 @@ static void if_tag_stat_update(const char *ifname, uid_t uid,
 		 * No parent counters. So
 		 *  - No {0, uid_tag} stats and no {acc_tag, uid_tag} stats.
 		 */
-		new_tag_stat = create_if_tag_stat(iface_entry, uid_tag);
+		new_tag_stat = create_if_tag_stat(iface_entry, uid_tag, NULL);
 		if (!new_tag_stat)
 			goto unlock;
-		uid_tag_counters = &new_tag_stat->counters;
+		uid_tag_stat = new_tag_stat;
 	} else {
-		uid_tag_counters = &tag_stat_entry->counters;
+		uid_tag_stat = tag_stat_entry;
 	}
 
 	if (acct_tag) {
 		/* Create the child {acct_tag, uid_tag} and hook up parent. */
-		new_tag_stat = create_if_tag_stat(iface_entry, tag);
+		new_tag_stat = create_if_tag_stat(iface_entry, tag,
+						  uid_tag_stat);
 		if (!new_tag_stat)
 			goto unlock;
-		new_tag_stat->parent_counters = uid_tag_counters;
 	} else {
 		/*
 		 * For new_tag_stat to be still NULL here would require:
@@ -1383,6 +1573,7 @@ static void if_tag_stat_update(const char *ifname, uid_t uid,
 	tag_stat_update(new_tag_stat, direction, proto, bytes);
 unlock:
 	spin_unlock_bh(&iface_entry->tag_stat_list_lock);
+	rcu_read_unlock();
 }
 
 static int iface_netdev_event_handler(struct notifier_block *nb,
@@ -2041,6 +2232,7 @@ static int ctrl_cmd_delete(const char *input)
 
 		if (!acct_tag || st_entry->tag == tag) {
 			rb_erase(&st_entry->sock_node, &sock_tag_tree);
+			hash_del_rcu(&st_entry->sock_hnode);
 			/* Can't sockfd_put() within spinlock, do it later. */
 			sock_tag_tree_insert(st_entry, &st_to_free_tree);
 			tr_entry = lookup_tag_ref(st_entry->tag, NULL);
@@ -2073,7 +2265,8 @@ static int ctrl_cmd_delete(const char *input)
 			 get_uid_from_tag(tcs_entry->tn.tag),
 			 tcs_entry->active_set);
 		rb_erase(&tcs_entry->tn.node, &tag_counter_set_tree);
-		kfree(tcs_entry);
+		hash_del_rcu(&tcs_entry->hnode);
+		kfree_rcu(tcs_entry, rcu);
 	}
 	spin_unlock_bh(&tag_counter_set_list_lock);
 
@@ -2104,7 +2297,11 @@ static int ctrl_cmd_delete(const char *input)
 					 entry_uid);
 				rb_erase(&ts_entry->tn.node,
 					 &iface_entry->tag_stat_tree);
-				kfree(ts_entry);
+				hash_del_rcu(&ts_entry->hnode);
+				spin_lock_bh(&tag_stat_pcpu_list_lock);
+				list_del_init(&ts_entry->pcpu_list);
+				spin_unlock_bh(&tag_stat_pcpu_list_lock);
+				call_rcu(&ts_entry->rcu, tag_stat_free_rcu);
 			}
 		}
 		spin_unlock_bh(&iface_entry->tag_stat_list_lock);
@@ -2187,11 +2384,12 @@ static int ctrl_cmd_counter_set(const char *input)
 		}
 		tcs->tn.tag = tag;
 		tag_counter_set_tree_insert(tcs, &tag_counter_set_tree);
+		hash_add_rcu(tag_counter_set_hash, &tcs->hnode, tag);
 		CT_DEBUG("qtaguid: ctrl_counterset(%s): added tcs tag=0x%llx "
 			 "(uid=%u) set=%d\n",
 			 input, tag, get_uid_from_tag(tag), counter_set);
 	}
-	tcs->active_set = counter_set;
+	ACCESS_ONCE(tcs->active_set) = counter_set;
 	spin_unlock_bh(&tag_counter_set_list_lock);
 	atomic64_inc(&qtu_events.counter_set_changes);
 	res = 0;
@@ -2300,7 +2498,7 @@ static int ctrl_cmd_tag(const char *input)
 		BUG_ON(IS_ERR_OR_NULL(prev_tag_ref_entry));
 		BUG_ON(prev_tag_ref_entry->num_sock_tags <= 0);
 		prev_tag_ref_entry->num_sock_tags--;
-		sock_tag_entry->tag = full_tag;
+		ACCESS_ONCE(sock_tag_entry->tag) = full_tag;
 	} else {
 		CT_DEBUG("qtaguid: ctrl_tag(%s): newtag for sk=%p\n",
 			 input, el_socket->sk);
@@ -2340,6 +2538,8 @@ static int ctrl_cmd_tag(const char *input)
 		spin_unlock_bh(&uid_tag_data_tree_lock);
 
 		sock_tag_tree_insert(sock_tag_entry, &sock_tag_tree);
+		hash_add_rcu(sock_tag_hash, &sock_tag_entry->sock_hnode,
+			     (unsigned long)sock_tag_entry->sk);
 		atomic64_inc(&qtu_events.sockets_tagged);
 	}
 	spin_unlock_bh(&sock_tag_list_lock);
@@ -2406,6 +2606,7 @@ static int ctrl_cmd_untag(const char *input)
 	 * so it can do whatever it wants to it.
 	 */
 	rb_erase(&sock_tag_entry->sock_node, &sock_tag_tree);
+	hash_del_rcu(&sock_tag_entry->sock_hnode);
 
 	tag_ref_entry = lookup_tag_ref(sock_tag_entry->tag, &utd_entry);
 	BUG_ON(!tag_ref_entry);
@@ -2453,7 +2654,7 @@ static int ctrl_cmd_untag(const char *input)
 		 atomic_long_read(&el_socket->file->f_count) - 1);
 	sockfd_put(el_socket);
 
-	kfree(sock_tag_entry);
+	kfree_rcu(sock_tag_entry, rcu);
 	atomic64_inc(&qtu_events.sockets_untagged);
 
 	return 0;
@@ -2552,10 +2753,9 @@ static void pp_stats_header(struct seq_file *m)
 }
 
 static int pp_stats_line(struct seq_file *m, struct tag_stat *ts_entry,
-			 int cnt_set)
+			 struct data_counters *cnts, int cnt_set)
 {
 	int ret;
-	struct data_counters *cnts;
 	tag_t tag = ts_entry->tn.tag;
 	uid_t stat_uid = get_uid_from_tag(tag);
 	struct proc_print_info *ppi = m->private;
@@ -2571,7 +2771,6 @@ static int pp_stats_line(struct seq_file *m, struct tag_stat *ts_entry,
 		return 0;
 	}
 	ppi->item_index++;
-	cnts = &ts_entry->counters;
 	ret = seq_printf(m, "%d %s 0x%llx %u %u "
 		"%llu %llu "
 		"%llu %llu "
@@ -2609,9 +2808,12 @@ static bool pp_sets(struct seq_file *m, struct tag_stat *ts_entry)
 {
 	int ret;
 	int counter_set;
+	struct data_counters cnts;
+
+	tag_stat_get_counters(ts_entry, &cnts);
 	for (counter_set = 0; counter_set < IFS_MAX_COUNTER_SETS;
 	     counter_set++) {
-		ret = pp_stats_line(m, ts_entry, counter_set);
+		ret = pp_stats_line(m, ts_entry, &cnts, counter_set);
 		if (ret < 0)
 			return false;
 	}
@@ -2874,6 +3076,7 @@ static int qtudev_release(struct inode *inode, struct file *file)
 		free_tag_ref_from_utd_entry(tr, utd_entry);
 
 		rb_erase(&st_entry->sock_node, &sock_tag_tree);
+		hash_del_rcu(&st_entry->sock_hnode);
 		list_del(&st_entry->list);
 		/* Can't sockfd_put() within spinlock, do it later. */
 		sock_tag_tree_insert(st_entry, &st_to_free_tree);
@@ -11,7 +11,10 @@
 #define __XT_QTAGUID_INTERNAL_H__
 
 #include <linux/types.h>
+#include <linux/hashtable.h>
+#include <linux/percpu.h>
 #include <linux/rbtree.h>
+#include <linux/rcupdate.h>
 #include <linux/spinlock_types.h>
 #include <linux/workqueue.h>
 
@@ -206,14 +209,26 @@ struct tag_node {
 
 struct tag_stat {
 	struct tag_node tn;
+	/* Looked up locklessly by the match path, under RCU */
+	struct hlist_node hnode;  /* in iface_stat.tag_stat_hash */
+	/*
+	 * Created from atomic context, so the per-cpu counters are attached
+	 * later by a worker. Until then the packets are counted in counters,
+	 * under iface_stat.tag_stat_list_lock. Readers sum both.
+	 */
 	struct data_counters counters;
+	struct data_counters __percpu *pcpu_counters;
+	struct list_head pcpu_list;  /* in tag_stat_pcpu_list */
 	/*
 	 * If this tag is acct_tag based, we need to count against the
 	 * matching parent uid_tag.
 	 */
-	struct data_counters *parent_counters;
+	struct tag_stat *parent;
+	struct rcu_head rcu;
 };
 
+#define IFS_TAG_STAT_HASH_BITS 6
+
 struct iface_stat {
 	struct list_head list;  /* in iface_stat_list */
 	char *ifname;
@@ -222,7 +237,12 @@ struct iface_stat {
 	struct net_device *net_dev;
 
 	struct byte_packet_counters totals_via_dev[IFS_MAX_DIRECTIONS];
+	/*
+	 * totals_via_skb is used, under iface_stat_list_lock, until the
+	 * proc worker has attached pcpu_totals_via_skb.
+	 */
 	struct data_counters totals_via_skb;
+	struct data_counters __percpu *pcpu_totals_via_skb;
 	/*
 	 * We keep the last_known, because some devices reset their counters
 	 * just before NETDEV_UP, while some will reset just before
@@ -238,6 +258,8 @@ struct iface_stat {
 	struct proc_dir_entry *proc_ptr;
 
 	struct rb_root tag_stat_tree;
+	/* Same entries as tag_stat_tree, for the RCU lookups */
+	DECLARE_HASHTABLE(tag_stat_hash, IFS_TAG_STAT_HASH_BITS);
 	spinlock_t tag_stat_list_lock;
 };
 
@@ -255,6 +277,9 @@ struct iface_stat_work {
  */
 struct sock_tag {
 	struct rb_node sock_node;
+	/* Looked up locklessly by the match path, under RCU */
+	struct hlist_node sock_hnode;  /* in sock_tag_hash */
+	struct rcu_head rcu;
 	struct sock *sk;  /* Only used as a number, never dereferenced */
 	/* The socket is needed for sockfd_put() */
 	struct socket *socket;
@@ -300,6 +325,8 @@ struct qtaguid_event_counts {
 /* Track the set active_set for the given tag. */
 struct tag_counter_set {
 	struct tag_node tn;
+	struct hlist_node hnode;  /* in tag_counter_set_hash */
+	struct rcu_head rcu;
 	int active_set;
 };
 
@@ -163,7 +163,8 @@ char *pp_tag_stat(struct tag_stat *ts)
 	}
 	tn_str = pp_tag_node(&ts->tn);
 	counters_str = pp_data_counters(&ts->counters, true);
-	parent_counters_str = pp_data_counters(ts->parent_counters, false);
+	parent_counters_str = pp_data_counters(ts->parent ? &ts->parent->counters : NULL,
+					       false);
 	res = kasprintf(GFP_ATOMIC,
 			"tag_stat@%p{%s, counters=%s, parent_counters=%s}",
 			ts, tn_str, counters_str, parent_counters_str);
@@ -1238,6 +1238,7 @@ int rmnet_config_notify_cb(struct notifier_block *nb,
 		trace_rmnet_unregister_cb_entry(dev);
 		if (_rmnet_is_physical_endpoint_associated(dev)) {
 			LOGH("Kernel is trying to unregister %s", dev->name);
+			rmnet_map_steer_flush(dev);
 			rmnet_force_unassociate_device(dev);
 		}
 		trace_rmnet_unregister_cb_exit(dev);
@@ -20,6 +20,14 @@
 #include <linux/rmnet_data.h>
 #include <linux/net_map.h>
 #include <linux/netdev_features.h>
+#include <linux/ip.h>
+#include <linux/ipv6.h>
+#include <linux/jhash.h>
+#include <linux/percpu.h>
+#include <linux/random.h>
+#include <linux/smp.h>
+#include <net/ip.h>
+#include <net/ipv6.h>
 #include "rmnet_data_private.h"
 #include "rmnet_data_config.h"
 #include "rmnet_data_vnd.h"
@@ -177,6 +185,8 @@ static rx_handler_result_t rmnet_bridge_handler(struct sk_buff *skb,
 static rx_handler_result_t __rmnet_deliver_skb(struct sk_buff *skb,
 					 struct rmnet_logical_ep_conf_s *ep)
 {
+	struct napi_struct *napi;
+
 	trace___rmnet_deliver_skb(skb);
 	switch (ep->rmnet_mode) {
 	case RMNET_EPMODE_NONE:
@@ -194,7 +204,12 @@ static rx_handler_result_t __rmnet_deliver_skb(struct sk_buff *skb,
 
 		case RX_HANDLER_PASS:
 			skb->pkt_type = PACKET_HOST;
-			netif_receive_skb(skb);
+			/* GRO when the physical device delivers from NAPI */
+			napi = get_current_napi_context();
+			if (napi)
+				napi_gro_receive(napi, skb);
+			else
+				netif_receive_skb(skb);
 			return RX_HANDLER_CONSUMED;
 		}
 		return RX_HANDLER_PASS;
@@ -310,6 +325,233 @@ static rx_handler_result_t _rmnet_map_ingress_handler(struct sk_buff *skb,
 	return __rmnet_deliver_skb(skb, ep);
 }
 
+#ifdef CONFIG_RMNET_DATA_RX_STEERING
+/* ***************** RX Steering ******************************************** */
+
+struct rmnet_steer_cpu_s {
+	struct sk_buff_head queue;
+	struct napi_struct napi;
+	struct call_single_data csd;
+};
+
+static DEFINE_PER_CPU(struct rmnet_steer_cpu_s, rmnet_steer_cpu);
+static struct net_device rmnet_steer_dev;
+static u32 rmnet_steer_hashrnd __read_mostly;
+
+/**
+ * rmnet_map_flow_hash() - Hash the flow of a de-aggregated MAP packet
+ * @skb:        Packet with the MAP header still in front of the IP header
+ *
+ * Return:
+ *      - hash of the addresses, protocol and, if not a fragment, the ports
+ */
+static uint32_t rmnet_map_flow_hash(struct sk_buff *skb)
+{
+	unsigned int off = sizeof(struct rmnet_map_header_s);
+	uint32_t saddr, daddr, ports = 0;
+	uint8_t proto;
+	union {
+		struct iphdr v4;
+		struct ipv6hdr v6;
+	} _iph, *iph;
+	__be32 _ports, *portp;
+
+	iph = skb_header_pointer(skb, off, sizeof(struct iphdr), &_iph);
+	if (!iph)
+		return 0;
+
+	switch (iph->v4.version) {
+	case 4:
+		saddr = (__force uint32_t) iph->v4.saddr;
+		daddr = (__force uint32_t) iph->v4.daddr;
+		proto = iph->v4.protocol;
+		if (ip_is_fragment(&iph->v4))
+			proto = 0;
+		off += iph->v4.ihl * 4;
+		break;
+
+	case 6:
+		iph = skb_header_pointer(skb, off, sizeof(struct ipv6hdr),
+					 &_iph);
+		if (!iph)
+			return 0;
+		saddr = ipv6_addr_hash(&iph->v6.saddr);
+		daddr = ipv6_addr_hash(&iph->v6.daddr);
+		proto = iph->v6.nexthdr;
+		off += sizeof(struct ipv6hdr);
+		break;
+
+	default:
+		return 0;
+	}
+
+	if (proto == IPPROTO_TCP || proto == IPPROTO_UDP) {
+		portp = skb_header_pointer(skb, off, sizeof(_ports), &_ports);
+		if (portp)
+			ports = (__force uint32_t) *portp;
+	}
+
+	return jhash_3words(saddr, daddr, ports ^ proto, rmnet_steer_hashrnd);
+}
+
+/**
+ * rmnet_map_steer() - Process a de-aggregated packet on its flow's CPU
+ * @skb:        De-aggregated packet, MAP header still in place
+ * @config:     Physical endpoint configuration for the ingress device
+ * @ipi_mask:   CPUs to kick once the aggregate has been de-aggregated
+ *
+ * Packets for a VND with an rx_steer_cpus mask are queued to the CPU picked
+ * by their flow hash, others are processed here. The per-CPU queues are
+ * drained by a NAPI context, so GRO also happens on the steered CPU.
+ */
+static void rmnet_map_steer(struct sk_buff *skb,
+			    struct rmnet_phys_ep_conf_s *config,
+			    struct cpumask *ipi_mask)
+{
+	struct rmnet_logical_ep_conf_s *ep;
+	struct rmnet_steer_cpu_s *sc;
+	uint8_t mux_id;
+	uint32_t hash;
+	int cpu;
+
+	mux_id = RMNET_MAP_GET_MUX_ID(skb);
+	if (mux_id >= RMNET_DATA_MAX_LOGICAL_EP ||
+	    !(config->ingress_data_format & RMNET_INGRESS_FORMAT_DEMUXING))
+		goto process;
+
+	ep = &(config->muxed_ep[mux_id]);
+	if (!ep->refcount)
+		goto process;
+
+	hash = rmnet_map_flow_hash(skb);
+	cpu = rmnet_vnd_get_steer_cpu(ep->egress_dev, hash);
+	if (cpu < 0 || cpu == smp_processor_id() || !cpu_online(cpu))
+		goto process;
+
+	skb->rxhash = hash;
+	sc = &per_cpu(rmnet_steer_cpu, cpu);
+	if (skb_queue_len(&sc->queue) >= netdev_max_backlog) {
+		rmnet_kfree_skb(skb, RMNET_STATS_SKBFREE_STEER_BACKLOG);
+		return;
+	}
+
+	skb_queue_tail(&sc->queue, skb);
+	if (napi_schedule_prep(&sc->napi))
+		cpumask_set_cpu(cpu, ipi_mask);
+	return;
+
+process:
+	_rmnet_map_ingress_handler(skb, config);
+}
+
+static void rmnet_map_steer_kick(struct cpumask *ipi_mask)
+{
+	int cpu;
+
+	for_each_cpu(cpu, ipi_mask)
+		__smp_call_function_single(cpu,
+			&per_cpu(rmnet_steer_cpu, cpu).csd, 0);
+}
+
+static void rmnet_map_steer_ipi(void *info)
+{
+	struct rmnet_steer_cpu_s *sc = (struct rmnet_steer_cpu_s *)info;
+
+	__napi_schedule(&sc->napi);
+}
+
+static int rmnet_map_steer_poll(struct napi_struct *napi, int budget)
+{
+	struct rmnet_steer_cpu_s *sc;
+	struct rmnet_phys_ep_conf_s *config;
+	struct sk_buff *skb;
+	int work = 0;
+
+	sc = container_of(napi, struct rmnet_steer_cpu_s, napi);
+
+	/* covers skb->dev until rmnet_map_steer_flush() has run */
+	rcu_read_lock();
+	while (work < budget && (skb = skb_dequeue(&sc->queue))) {
+		config = (struct rmnet_phys_ep_conf_s *)
+			rcu_dereference(skb->dev->rx_handler_data);
+		if (config)
+			_rmnet_map_ingress_handler(skb, config);
+		else
+			rmnet_kfree_skb(skb,
+				RMNET_STATS_SKBFREE_MAPINGRESS_MUX_NO_EP);
+		work++;
+	}
+	rcu_read_unlock();
+
+	if (work < budget) {
+		napi_complete(napi);
+		/* a packet queued before the complete found the napi busy */
+		smp_mb();
+		if (!skb_queue_empty(&sc->queue))
+			napi_schedule(napi);
+	}
+
+	return work;
+}
+
+/**
+ * rmnet_map_steer_flush() - Drop steered packets of a departing device
+ * @dev:        Physical device being unregistered
+ */
+void rmnet_map_steer_flush(struct net_device *dev)
+{
+	struct rmnet_steer_cpu_s *sc;
+	struct sk_buff *skb, *tmp;
+	unsigned long flags;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		sc = &per_cpu(rmnet_steer_cpu, cpu);
+		spin_lock_irqsave(&sc->queue.lock, flags);
+		skb_queue_walk_safe(&sc->queue, skb, tmp) {
+			if (skb->dev == dev) {
+				__skb_unlink(skb, &sc->queue);
+				kfree_skb(skb);
+			}
+		}
+		spin_unlock_irqrestore(&sc->queue.lock, flags);
+	}
+}
+
+/**
+ * rmnet_map_steer_init() - Set up the per-CPU steering queues
+ */
+void rmnet_map_steer_init(void)
+{
+	struct rmnet_steer_cpu_s *sc;
+	int cpu;
+
+	get_random_bytes(&rmnet_steer_hashrnd, sizeof(rmnet_steer_hashrnd));
+	init_dummy_netdev(&rmnet_steer_dev);
+
+	for_each_possible_cpu(cpu) {
+		sc = &per_cpu(rmnet_steer_cpu, cpu);
+		skb_queue_head_init(&sc->queue);
+		sc->csd.func = rmnet_map_steer_ipi;
+		sc->csd.info = sc;
+		netif_napi_add(&rmnet_steer_dev, &sc->napi,
+			       rmnet_map_steer_poll, NAPI_POLL_WEIGHT);
+		napi_enable(&sc->napi);
+	}
+}
+#else
+static inline void rmnet_map_steer(struct sk_buff *skb,
+				   struct rmnet_phys_ep_conf_s *config,
+				   struct cpumask *ipi_mask)
+{
+	_rmnet_map_ingress_handler(skb, config);
+}
+
+static inline void rmnet_map_steer_kick(struct cpumask *ipi_mask)
+{
+}
+#endif /* CONFIG_RMNET_DATA_RX_STEERING */
+
 /**
  * rmnet_map_ingress_handler() - MAP ingress handler
  * @skb:        Packet being received
@@ -328,14 +570,17 @@ static rx_handler_result_t rmnet_map_ingress_handler(struct sk_buff *skb,
 					    struct rmnet_phys_ep_conf_s *config)
 {
 	struct sk_buff *skbn;
+	struct cpumask ipi_mask;
 	int rc, co = 0;
 
 	if (config->ingress_data_format & RMNET_INGRESS_FORMAT_DEAGGREGATION) {
 		trace_rmnet_start_deaggregation(skb);
+		cpumask_clear(&ipi_mask);
 		while ((skbn = rmnet_map_deaggregate(skb, config)) != 0) {
-			_rmnet_map_ingress_handler(skbn, config);
+			rmnet_map_steer(skbn, config, &ipi_mask);
 			co++;
 		}
+		rmnet_map_steer_kick(&ipi_mask);
 		trace_rmnet_end_deaggregation(skb, co);
 		LOGD("De-aggregated %d packets", co);
 		rmnet_stats_deagg_pkts(co);
@@ -22,4 +22,17 @@ void rmnet_egress_handler(struct sk_buff *skb,
 
 rx_handler_result_t rmnet_rx_handler(struct sk_buff **pskb);
 
+#ifdef CONFIG_RMNET_DATA_RX_STEERING
+void rmnet_map_steer_init(void);
+void rmnet_map_steer_flush(struct net_device *dev);
+#else
+static inline void rmnet_map_steer_init(void)
+{
+}
+
+static inline void rmnet_map_steer_flush(struct net_device *dev)
+{
+}
+#endif /* CONFIG_RMNET_DATA_RX_STEERING */
+
 #endif /* _RMNET_DATA_HANDLERS_H_ */
@@ -39,6 +39,7 @@ enum rmnet_skb_free_e {
 	RMNET_STATS_SKBFREE_DEAGG_UNKOWN_IP_TYP,
 	RMNET_STATS_SKBFREE_DEAGG_DATA_LEN_0,
 	RMNET_STATS_SKBFREE_INGRESS_BAD_MAP_CKSUM,
+	RMNET_STATS_SKBFREE_STEER_BACKLOG,
 	RMNET_STATS_SKBFREE_MAX
 };
 
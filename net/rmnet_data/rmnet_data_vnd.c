@@ -24,6 +24,9 @@
 #include <net/pkt_sched.h>
 #include <linux/atomic.h>
 #include <linux/net_map.h>
+#include <linux/cpumask.h>
+#include <linux/mutex.h>
+#include <linux/slab.h>
 #include "rmnet_data_config.h"
 #include "rmnet_data_handlers.h"
 #include "rmnet_data_private.h"
@@ -55,6 +58,14 @@ struct rmnet_map_flow_mapping_s {
 	atomic_t v6_seq;
 };
 
+#ifdef CONFIG_RMNET_DATA_RX_STEERING
+struct rmnet_vnd_steer_map {
+	unsigned int len;
+	struct rcu_head rcu;
+	uint16_t cpus[0];
+};
+#endif /* CONFIG_RMNET_DATA_RX_STEERING */
+
 struct rmnet_vnd_private_s {
 	uint32_t qos_version;
 	struct rmnet_logical_ep_conf_s local_ep;
@@ -62,6 +73,9 @@ struct rmnet_vnd_private_s {
 	rwlock_t flow_map_lock;
 	struct list_head flow_head;
 	struct rmnet_map_flow_mapping_s root_flow;
+#ifdef CONFIG_RMNET_DATA_RX_STEERING
+	struct rmnet_vnd_steer_map __rcu *steer_map;
+#endif /* CONFIG_RMNET_DATA_RX_STEERING */
 };
 
 #define RMNET_VND_FC_QUEUED      0
@@ -521,6 +535,7 @@ void rmnet_vnd_exit(void)
 	for (i = 0; i < RMNET_DATA_MAX_VND; i++)
 		if (rmnet_devices[i]) {
 			unregister_netdev(rmnet_devices[i]);
+			rmnet_vnd_free_steer_map(rmnet_devices[i]);
 			free_netdev(rmnet_devices[i]);
 	}
 }
@@ -537,6 +552,145 @@ int rmnet_vnd_init(void)
 	return 0;
 }
 
+#ifdef CONFIG_RMNET_DATA_RX_STEERING
+static DEFINE_MUTEX(rmnet_vnd_steer_lock);
+
+/**
+ * rmnet_vnd_get_steer_cpu() - Pick the CPU to process a downlink packet on
+ * @dev:        Virtual network device the packet is for
+ * @hash:       Flow hash of the packet
+ *
+ * Called from the ingress data path under rcu_read_lock().
+ *
+ * Return:
+ *      - CPU from the rx_steer_cpus mask of the device
+ *      - -1 if the device has no mask or is not a VND
+ */
+int rmnet_vnd_get_steer_cpu(struct net_device *dev, uint32_t hash)
+{
+	struct rmnet_vnd_private_s *dev_conf;
+	struct rmnet_vnd_steer_map *map;
+
+	if (!dev || dev->netdev_ops != &rmnet_data_vnd_ops)
+		return -1;
+
+	dev_conf = (struct rmnet_vnd_private_s *) netdev_priv(dev);
+	map = rcu_dereference(dev_conf->steer_map);
+	if (!map)
+		return -1;
+
+	return map->cpus[((uint64_t) hash * map->len) >> 32];
+}
+
+static ssize_t rmnet_vnd_show_steer_cpus(struct device *d,
+					 struct device_attribute *attr,
+					 char *buf)
+{
+	struct rmnet_vnd_private_s *dev_conf;
+	struct rmnet_vnd_steer_map *map;
+	cpumask_var_t mask;
+	size_t len;
+	int i;
+
+	if (!zalloc_cpumask_var(&mask, GFP_KERNEL))
+		return -ENOMEM;
+
+	dev_conf = (struct rmnet_vnd_private_s *) netdev_priv(to_net_dev(d));
+	rcu_read_lock();
+	map = rcu_dereference(dev_conf->steer_map);
+	if (map)
+		for (i = 0; i < map->len; i++)
+			cpumask_set_cpu(map->cpus[i], mask);
+	rcu_read_unlock();
+
+	len = cpumask_scnprintf(buf, PAGE_SIZE, mask);
+	len += scnprintf(buf + len, PAGE_SIZE - len, "\n");
+	free_cpumask_var(mask);
+	return len;
+}
+
+static ssize_t rmnet_vnd_store_steer_cpus(struct device *d,
+					  struct device_attribute *attr,
+					  const char *buf, size_t len)
+{
+	struct rmnet_vnd_private_s *dev_conf;
+	struct rmnet_vnd_steer_map *map, *old_map;
+	cpumask_var_t mask;
+	int rc, cpu, i;
+
+	if (!capable(CAP_NET_ADMIN))
+		return -EPERM;
+
+	if (!alloc_cpumask_var(&mask, GFP_KERNEL))
+		return -ENOMEM;
+
+	rc = bitmap_parse(buf, len, cpumask_bits(mask), nr_cpumask_bits);
+	if (rc) {
+		free_cpumask_var(mask);
+		return rc;
+	}
+	cpumask_and(mask, mask, cpu_possible_mask);
+
+	map = 0;
+	if (!cpumask_empty(mask)) {
+		map = kzalloc(sizeof(*map) +
+			      cpumask_weight(mask) * sizeof(uint16_t),
+			      GFP_KERNEL);
+		if (!map) {
+			free_cpumask_var(mask);
+			return -ENOMEM;
+		}
+		i = 0;
+		for_each_cpu(cpu, mask)
+			map->cpus[i++] = cpu;
+		map->len = i;
+	}
+	free_cpumask_var(mask);
+
+	dev_conf = (struct rmnet_vnd_private_s *) netdev_priv(to_net_dev(d));
+	mutex_lock(&rmnet_vnd_steer_lock);
+	old_map = rcu_dereference_protected(dev_conf->steer_map,
+				lockdep_is_held(&rmnet_vnd_steer_lock));
+	rcu_assign_pointer(dev_conf->steer_map, map);
+	mutex_unlock(&rmnet_vnd_steer_lock);
+
+	if (old_map)
+		kfree_rcu(old_map, rcu);
+
+	LOGM("%s RX steering set to %u CPUs", to_net_dev(d)->name,
+	     map ? map->len : 0);
+	return len;
+}
+
+static DEVICE_ATTR(rx_steer_cpus, S_IRUGO | S_IWUSR,
+		   rmnet_vnd_show_steer_cpus, rmnet_vnd_store_steer_cpus);
+
+static struct attribute *rmnet_vnd_attrs[] = {
+	&dev_attr_rx_steer_cpus.attr,
+	NULL,
+};
+
+static const struct attribute_group rmnet_vnd_attr_group = {
+	.attrs = rmnet_vnd_attrs,
+};
+
+static void rmnet_vnd_free_steer_map(struct net_device *dev)
+{
+	struct rmnet_vnd_private_s *dev_conf;
+	struct rmnet_vnd_steer_map *map;
+
+	dev_conf = (struct rmnet_vnd_private_s *) netdev_priv(dev);
+	map = rcu_dereference_protected(dev_conf->steer_map, 1);
+	RCU_INIT_POINTER(dev_conf->steer_map, 0);
+	if (map)
+		kfree_rcu(map, rcu);
+}
+#else
+static inline void rmnet_vnd_free_steer_map(struct net_device *dev)
+{
+}
+#endif /* CONFIG_RMNET_DATA_RX_STEERING */
+
 /**
  * rmnet_vnd_create_dev() - Create a new virtual network device node.
  * @id:         Virtual device node id
@@ -601,6 +755,10 @@ int rmnet_vnd_create_dev(int id, struct net_device **new_device,
 			NETIF_F_IPV6_UDP_CSUM;
 	}
 
+#ifdef CONFIG_RMNET_DATA_RX_STEERING
+	dev->sysfs_groups[0] = &rmnet_vnd_attr_group;
+#endif /* CONFIG_RMNET_DATA_RX_STEERING */
+
 	rc = register_netdevice(dev);
 	if (rc != 0) {
 		LOGE("Failed to to register netdev [%s]", dev->name);
@@ -656,6 +814,7 @@ int rmnet_vnd_free_dev(int id)
 
 	if (dev) {
 		unregister_netdev(dev);
+		rmnet_vnd_free_steer_map(dev);
 		free_netdev(dev);
 		return 0;
 	} else {
@@ -37,5 +37,8 @@ int rmnet_vnd_del_tc_flow(uint32_t id, uint32_t map_flow, uint32_t tc_flow);
 int rmnet_vnd_init(void);
 void rmnet_vnd_exit(void);
 struct net_device *rmnet_vnd_get_by_id(int id);
+#ifdef CONFIG_RMNET_DATA_RX_STEERING
+int rmnet_vnd_get_steer_cpu(struct net_device *dev, uint32_t hash);
+#endif /* CONFIG_RMNET_DATA_RX_STEERING */
 
 #endif /* _RMNET_DATA_VND_H_ */
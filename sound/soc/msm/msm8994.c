@@ -4715,6 +4715,28 @@ static struct snd_soc_dai_link msm8994_common_dai_links[] = {
 
 };
 
+/*
+ * MMAP no-IRQ front end: the ADSP reads and writes a circular buffer that
+ * is mapped to userspace and publishes its position in shared memory, so
+ * nothing is exchanged per period. Boards that want it give up the
+ * MultiMedia8 compress link for it, see msm8994_asoc_machine_probe().
+ */
+static struct snd_soc_dai_link msm8994_ull_noirq_dai_link = {
+	.name = "MSM8994 ULL NOIRQ",
+	.stream_name = "MM_NOIRQ",
+	.cpu_dai_name = "MultiMedia8",
+	.platform_name = "msm-pcm-dsp-noirq",
+	.dynamic = 1,
+	.trigger = {SND_SOC_DPCM_TRIGGER_POST,
+		SND_SOC_DPCM_TRIGGER_POST},
+	.codec_dai_name = "snd-soc-dummy-dai",
+	.codec_name = "snd-soc-dummy",
+	.ignore_suspend = 1,
+	.ignore_pmdown_time = 1,
+	/* this dainlink has playback and capture support */
+	.be_id = MSM_FRONTEND_DAI_MULTIMEDIA8,
+};
+
 static struct snd_soc_dai_link msm8994_hdmi_dai_link[] = {
 /* HDMI BACK END DAI Link */
 	{
@@ -5530,6 +5552,18 @@ static int msm8994_asoc_machine_probe(struct platform_device *pdev)
 		}
 	}
 //htc audio --
+	if (of_property_read_bool(pdev->dev.of_node, "qcom,ull-noirq-support")) {
+		for (i = 0; i < ARRAY_SIZE(msm8994_common_dai_links); i++) {
+			if (msm8994_common_dai_links[i].be_id !=
+					MSM_FRONTEND_DAI_MULTIMEDIA8)
+				continue;
+			dev_info(&pdev->dev, "%s: %s replaced by %s\n",
+				__func__, msm8994_common_dai_links[i].name,
+				msm8994_ull_noirq_dai_link.name);
+			msm8994_common_dai_links[i] =
+				msm8994_ull_noirq_dai_link;
+		}
+	}
 	if (of_property_read_bool(pdev->dev.of_node, "qcom,hdmi-audio-rx")) {
 		dev_info(&pdev->dev, "%s: hdmi audio support present\n",
 				__func__);
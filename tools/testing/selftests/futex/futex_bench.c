@@ -0,0 +1,299 @@
+/*
+ * futex_bench.c - futex contention benchmark
+ *
+ * Copyright (C) 2016 HTC Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * Three workloads:
+ *
+ *  lock     - all threads hammer one lock, either a plain futex mutex or,
+ *             with -p, a PI futex (FUTEX_LOCK_PI/FUTEX_UNLOCK_PI), like
+ *             contended ART monitors.
+ *  pingpong - pairs of threads hand a token back and forth through
+ *             FUTEX_WAIT/FUTEX_WAKE, like the UI and RenderThread handoff.
+ *  spread   - every thread waits on and wakes its own futex, so only the
+ *             kernel hash buckets are shared between them.
+ *
+ * Results are operations per second, in total and per thread.
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+enum mode { MODE_LOCK, MODE_PINGPONG, MODE_SPREAD };
+
+static enum mode mode = MODE_LOCK;
+static int nthreads = 4;
+static int seconds = 2;
+static int use_pi;
+static int hold_loops = 100;
+
+static volatile int stop;
+static int lock_word;
+
+struct worker {
+	pthread_t thread;
+	int id;
+	int cpu;
+	int *futex;		/* pingpong: shared with the peer */
+	int own_futex;		/* spread */
+	unsigned long ops;
+} __attribute__((aligned(64)));
+
+static struct worker *workers;
+
+static long sys_futex(int *uaddr, int op, int val, void *timeout,
+		      int *uaddr2, int val3)
+{
+	return syscall(SYS_futex, uaddr, op, val, timeout, uaddr2, val3);
+}
+
+static pid_t sys_gettid(void)
+{
+	return syscall(SYS_gettid);
+}
+
+/* Mutex from "Futexes Are Tricky", 0 unlocked, 1 locked, 2 contended */
+static void plain_lock(int *f)
+{
+	int c = __sync_val_compare_and_swap(f, 0, 1);
+
+	if (!c)
+		return;
+	if (c != 2)
+		c = __sync_lock_test_and_set(f, 2);
+	while (c) {
+		sys_futex(f, FUTEX_WAIT_PRIVATE, 2, NULL, NULL, 0);
+		c = __sync_lock_test_and_set(f, 2);
+	}
+}
+
+static void plain_unlock(int *f)
+{
+	if (__sync_fetch_and_sub(f, 1) != 1) {
+		*f = 0;
+		sys_futex(f, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+	}
+}
+
+static void pi_lock(int *f, pid_t tid)
+{
+	if (__sync_bool_compare_and_swap(f, 0, tid))
+		return;
+	while (sys_futex(f, FUTEX_LOCK_PI_PRIVATE, 0, NULL, NULL, 0) &&
+	       errno == EINTR)
+		;
+}
+
+static void pi_unlock(int *f, pid_t tid)
+{
+	if (__sync_bool_compare_and_swap(f, tid, 0))
+		return;
+	sys_futex(f, FUTEX_UNLOCK_PI_PRIVATE, 0, NULL, NULL, 0);
+}
+
+static void hold(void)
+{
+	volatile int i;
+
+	for (i = 0; i < hold_loops; i++)
+		;
+}
+
+static void bind_cpu(struct worker *w)
+{
+	cpu_set_t set;
+
+	if (w->cpu < 0)
+		return;
+	CPU_ZERO(&set);
+	CPU_SET(w->cpu, &set);
+	sched_setaffinity(0, sizeof(set), &set);
+}
+
+static void *lock_worker(void *arg)
+{
+	struct worker *w = arg;
+	pid_t tid = sys_gettid();
+
+	bind_cpu(w);
+	while (!stop) {
+		if (use_pi)
+			pi_lock(&lock_word, tid);
+		else
+			plain_lock(&lock_word);
+		hold();
+		if (use_pi)
+			pi_unlock(&lock_word, tid);
+		else
+			plain_unlock(&lock_word);
+		w->ops++;
+	}
+	return NULL;
+}
+
+/* The token is the id of the side that may run next: 0 or 1 */
+static void *pingpong_worker(void *arg)
+{
+	struct worker *w = arg;
+	int me = w->id & 1;
+
+	bind_cpu(w);
+	while (!stop) {
+		while (*w->futex != me && !stop)
+			sys_futex(w->futex, FUTEX_WAIT_PRIVATE, !me, NULL,
+				  NULL, 0);
+		hold();
+		*w->futex = !me;
+		sys_futex(w->futex, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+		w->ops++;
+	}
+	/* Let the peer notice the stop */
+	*w->futex = !me;
+	sys_futex(w->futex, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+	return NULL;
+}
+
+static void *spread_worker(void *arg)
+{
+	struct worker *w = arg;
+	struct timespec zero = { 0, 0 };
+
+	bind_cpu(w);
+	while (!stop) {
+		/* Value mismatch or zero timeout: goes through the bucket */
+		sys_futex(&w->own_futex, FUTEX_WAIT_PRIVATE, 0, &zero,
+			  NULL, 0);
+		sys_futex(&w->own_futex, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+		w->ops++;
+	}
+	return NULL;
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s [-m lock|pingpong|spread] [-t threads] [-s seconds]\n"
+		"          [-p] [-l hold_loops] [-c first_cpu]\n"
+		"  -p  use PI futexes in lock mode\n"
+		"  -c  bind thread n to cpu first_cpu + n\n", prog);
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	void *(*fn)(void *) = lock_worker;
+	int *tokens = NULL;
+	int first_cpu = -1;
+	unsigned long total = 0;
+	struct timeval start, end;
+	double elapsed;
+	int opt, i;
+
+	while ((opt = getopt(argc, argv, "m:t:s:pl:c:h")) != -1) {
+		switch (opt) {
+		case 'm':
+			if (!strcmp(optarg, "lock"))
+				mode = MODE_LOCK;
+			else if (!strcmp(optarg, "pingpong"))
+				mode = MODE_PINGPONG;
+			else if (!strcmp(optarg, "spread"))
+				mode = MODE_SPREAD;
+			else
+				usage(argv[0]);
+			break;
+		case 't':
+			nthreads = atoi(optarg);
+			break;
+		case 's':
+			seconds = atoi(optarg);
+			break;
+		case 'p':
+			use_pi = 1;
+			break;
+		case 'l':
+			hold_loops = atoi(optarg);
+			break;
+		case 'c':
+			first_cpu = atoi(optarg);
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+
+	if (nthreads < 1 || seconds < 1)
+		usage(argv[0]);
+	if (mode == MODE_PINGPONG) {
+		nthreads = (nthreads + 1) & ~1;
+		tokens = calloc(nthreads / 2, 64);
+		if (!tokens)
+			return 1;
+		fn = pingpong_worker;
+	} else if (mode == MODE_SPREAD) {
+		fn = spread_worker;
+	}
+
+	if (posix_memalign((void **)&workers, 64, nthreads * sizeof(*workers)))
+		return 1;
+	memset(workers, 0, nthreads * sizeof(*workers));
+
+	gettimeofday(&start, NULL);
+	for (i = 0; i < nthreads; i++) {
+		struct worker *w = &workers[i];
+
+		w->id = i;
+		w->cpu = first_cpu < 0 ? -1 : first_cpu + i;
+		if (tokens)
+			w->futex = &tokens[(i / 2) * 16];
+		w->own_futex = 1;
+		if (pthread_create(&w->thread, NULL, fn, w)) {
+			perror("pthread_create");
+			return 1;
+		}
+	}
+
+	sleep(seconds);
+	stop = 1;
+	if (mode == MODE_LOCK && !use_pi)
+		sys_futex(&lock_word, FUTEX_WAKE_PRIVATE, INT_MAX, NULL,
+			  NULL, 0);
+
+	for (i = 0; i < nthreads; i++) {
+		pthread_join(workers[i].thread, NULL);
+		total += workers[i].ops;
+	}
+	gettimeofday(&end, NULL);
+
+	elapsed = (end.tv_sec - start.tv_sec) +
+		  (end.tv_usec - start.tv_usec) / 1e6;
+
+	printf("mode %s%s threads %d hold %d: %.0f ops/s, %.0f ops/s/thread\n",
+	       mode == MODE_LOCK ? "lock" :
+	       mode == MODE_PINGPONG ? "pingpong" : "spread",
+	       mode == MODE_LOCK && use_pi ? " (pi)" : "",
+	       nthreads, hold_loops, total / elapsed,
+	       total / elapsed / nthreads);
+
+	free(tokens);
+	free(workers);
+	return 0;
+}
@@ -0,0 +1,299 @@
+/*
+ * sync_bench.c - sync fence throughput benchmark on sw_sync
+ *
+ * Copyright (C) 2016 HTC Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * Every thread opens its own sw_sync timeline and loops over one of:
+ *
+ *  create - create a fence, signal it, close it.
+ *  merge  - create two pending fences on the timeline and merge them,
+ *           like a compositor collecting the acquire fences of a frame.
+ *  signal - create -b fences, signal them with a single increment and
+ *           wait on each, the batched release of a display frame.
+ *
+ * Results are operations per second, in total and per thread.
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/types.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+/* From include/linux/sw_sync.h and include/linux/sync.h */
+struct sw_sync_create_fence_data {
+	__u32	value;
+	char	name[32];
+	__s32	fence;
+};
+
+struct sync_merge_data {
+	__s32	fd2;
+	char	name[32];
+	__s32	fence;
+};
+
+#define SW_SYNC_IOC_MAGIC		'W'
+#define SW_SYNC_IOC_CREATE_FENCE	_IOWR(SW_SYNC_IOC_MAGIC, 0, \
+					      struct sw_sync_create_fence_data)
+#define SW_SYNC_IOC_INC			_IOW(SW_SYNC_IOC_MAGIC, 1, __u32)
+
+#define SYNC_IOC_MAGIC			'>'
+#define SYNC_IOC_WAIT			_IOW(SYNC_IOC_MAGIC, 0, __s32)
+#define SYNC_IOC_MERGE			_IOWR(SYNC_IOC_MAGIC, 1, \
+					      struct sync_merge_data)
+
+#define MAX_BATCH	64
+
+enum mode { MODE_CREATE, MODE_MERGE, MODE_SIGNAL };
+
+static enum mode mode = MODE_CREATE;
+static int nthreads = 1;
+static int seconds = 2;
+static int batch = 8;
+static const char *dev = "/dev/sw_sync";
+
+static volatile int stop;
+static volatile int failed;
+
+struct worker {
+	pthread_t thread;
+	int timeline;
+	unsigned int value;
+	unsigned long ops;
+} __attribute__((aligned(64)));
+
+static struct worker *workers;
+
+static int create_fence(struct worker *w, unsigned int value)
+{
+	struct sw_sync_create_fence_data data;
+
+	memset(&data, 0, sizeof(data));
+	data.value = value;
+	strcpy(data.name, "bench");
+	if (ioctl(w->timeline, SW_SYNC_IOC_CREATE_FENCE, &data) < 0)
+		return -1;
+	return data.fence;
+}
+
+static int inc(struct worker *w, unsigned int count)
+{
+	if (ioctl(w->timeline, SW_SYNC_IOC_INC, &count) < 0)
+		return -1;
+	w->value += count;
+	return 0;
+}
+
+static int merge(int a, int b)
+{
+	struct sync_merge_data data;
+
+	memset(&data, 0, sizeof(data));
+	data.fd2 = b;
+	strcpy(data.name, "bench_merge");
+	if (ioctl(a, SYNC_IOC_MERGE, &data) < 0)
+		return -1;
+	return data.fence;
+}
+
+static int wait_fence(int fd)
+{
+	__s32 timeout = 1000;
+
+	return ioctl(fd, SYNC_IOC_WAIT, &timeout);
+}
+
+static int create_op(struct worker *w)
+{
+	int fd = create_fence(w, w->value + 1);
+
+	if (fd < 0)
+		return -1;
+	if (inc(w, 1)) {
+		close(fd);
+		return -1;
+	}
+	close(fd);
+	return 0;
+}
+
+static int merge_op(struct worker *w)
+{
+	int a, b, m;
+
+	a = create_fence(w, w->value + 1);
+	b = create_fence(w, w->value + 2);
+	m = a >= 0 && b >= 0 ? merge(a, b) : -1;
+	if (m >= 0)
+		close(m);
+	if (a >= 0)
+		close(a);
+	if (b >= 0)
+		close(b);
+	if (inc(w, 2))
+		return -1;
+	return m < 0 ? -1 : 0;
+}
+
+static int signal_op(struct worker *w)
+{
+	int fds[MAX_BATCH];
+	int i, n, ret = 0;
+
+	for (n = 0; n < batch; n++) {
+		fds[n] = create_fence(w, w->value + 1);
+		if (fds[n] < 0) {
+			ret = -1;
+			break;
+		}
+	}
+	if (inc(w, 1))
+		ret = -1;
+	for (i = 0; i < n; i++) {
+		if (!ret && wait_fence(fds[i]))
+			ret = -1;
+		close(fds[i]);
+	}
+	return ret;
+}
+
+static void *worker_fn(void *arg)
+{
+	struct worker *w = arg;
+	int ret;
+
+	while (!stop) {
+		switch (mode) {
+		case MODE_MERGE:
+			ret = merge_op(w);
+			break;
+		case MODE_SIGNAL:
+			ret = signal_op(w);
+			break;
+		default:
+			ret = create_op(w);
+			break;
+		}
+		if (ret) {
+			perror("sync_bench");
+			failed = 1;
+			stop = 1;
+			break;
+		}
+		w->ops += mode == MODE_SIGNAL ? batch : 1;
+	}
+	return NULL;
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s [-m create|merge|signal] [-t threads] [-s seconds]\n"
+		"          [-b batch] [-d device]\n"
+		"  -b  fences signaled per increment in signal mode (max %d)\n",
+		prog, MAX_BATCH);
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long total = 0;
+	struct timeval start, end;
+	double elapsed;
+	int opt, i;
+
+	while ((opt = getopt(argc, argv, "m:t:s:b:d:h")) != -1) {
+		switch (opt) {
+		case 'm':
+			if (!strcmp(optarg, "create"))
+				mode = MODE_CREATE;
+			else if (!strcmp(optarg, "merge"))
+				mode = MODE_MERGE;
+			else if (!strcmp(optarg, "signal"))
+				mode = MODE_SIGNAL;
+			else
+				usage(argv[0]);
+			break;
+		case 't':
+			nthreads = atoi(optarg);
+			break;
+		case 's':
+			seconds = atoi(optarg);
+			break;
+		case 'b':
+			batch = atoi(optarg);
+			break;
+		case 'd':
+			dev = optarg;
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+
+	if (nthreads < 1 || seconds < 1 || batch < 1 || batch > MAX_BATCH)
+		usage(argv[0]);
+
+	if (posix_memalign((void **)&workers, 64, nthreads * sizeof(*workers)))
+		return 1;
+	memset(workers, 0, nthreads * sizeof(*workers));
+
+	for (i = 0; i < nthreads; i++) {
+		workers[i].timeline = open(dev, O_RDWR);
+		if (workers[i].timeline < 0) {
+			fprintf(stderr, "%s: %s\n", dev, strerror(errno));
+			return 1;
+		}
+	}
+
+	gettimeofday(&start, NULL);
+	for (i = 0; i < nthreads; i++) {
+		if (pthread_create(&workers[i].thread, NULL, worker_fn,
+				   &workers[i])) {
+			perror("pthread_create");
+			return 1;
+		}
+	}
+
+	for (i = 0; i < seconds * 10 && !stop; i++)
+		usleep(100000);
+	stop = 1;
+
+	for (i = 0; i < nthreads; i++) {
+		pthread_join(workers[i].thread, NULL);
+		close(workers[i].timeline);
+		total += workers[i].ops;
+	}
+	gettimeofday(&end, NULL);
+
+	if (failed)
+		return 1;
+
+	elapsed = (end.tv_sec - start.tv_sec) +
+		  (end.tv_usec - start.tv_usec) / 1e6;
+
+	printf("mode %s threads %d batch %d: %.0f fences/s, %.0f fences/s/thread\n",
+	       mode == MODE_CREATE ? "create" :
+	       mode == MODE_MERGE ? "merge" : "signal",
+	       nthreads, mode == MODE_SIGNAL ? batch : 1, total / elapsed,
+	       total / elapsed / nthreads);
+
+	free(workers);
+	return 0;
+}